@@ -6,6 +6,10 @@ namespace {
 class BilateralGrid : public Halide::Generator<BilateralGrid> {
 public:
     GeneratorParam<int> s_sigma{"s_sigma", 8};
+    // On GPU targets, splat the input into the grid with atomic adds from
+    // one thread per pixel, and do the last blur in the same kernel as the
+    // slicing. This does not change the CPU schedule.
+    GeneratorParam<bool> atomic_splat{"atomic_splat", false};
 
     Input<Buffer<float, 2>> input{"input"};
     Input<float> r_sigma{"r_sigma"};
@@ -87,19 +91,39 @@ public:
 
             Var xi("xi"), yi("yi"), zi("zi");
 
-            // Schedule blurz in 8x8 tiles. This is a tile in
-            // grid-space, which means it represents something like
-            // 64x64 pixels in the input (if s_sigma is 8).
-            blurz.compute_root().reorder(c, z, x, y).gpu_tile(x, y, xi, yi, 8, 8);
-
-            // Schedule histogram to happen per-tile of blurz, with
-            // intermediate results in shared memory. This means histogram
-            // and blurz makes a three-stage kernel:
-            // 1) Zero out the 8x8 set of histograms
-            // 2) Compute those histogram by iterating over lots of the input image
-            // 3) Blur the set of histograms in z
-            histogram.reorder(c, z, x, y).compute_at(blurz, x).gpu_threads(x, y);
-            histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+            if (atomic_splat) {
+                // Give each thread a column of s_sigma pixels, so the
+                // threads of a warp read consecutive pixels of a row,
+                // and add them into the grid with atomics. Cells are
+                // shared between neighboring threads, but there is far
+                // more parallelism than with a thread per grid cell.
+                Var xo("xo");
+                histogram.compute_root()
+                    .reorder(c, z, x, y)
+                    .gpu_tile(x, y, xi, yi, 8, 8);
+                histogram.update()
+                    .atomic()
+                    .split(x, xo, xi, 16)
+                    .reorder(c, r.y, r.x, xi, xo, y)
+                    .unroll(c)
+                    .gpu_blocks(xo, y)
+                    .gpu_threads(r.x, xi);
+                blurz.compute_root().reorder(c, z, x, y).gpu_tile(x, y, xi, yi, 8, 8);
+            } else {
+                // Schedule blurz in 8x8 tiles. This is a tile in
+                // grid-space, which means it represents something like
+                // 64x64 pixels in the input (if s_sigma is 8).
+                blurz.compute_root().reorder(c, z, x, y).gpu_tile(x, y, xi, yi, 8, 8);
+
+                // Schedule histogram to happen per-tile of blurz, with
+                // intermediate results in shared memory. This means histogram
+                // and blurz makes a three-stage kernel:
+                // 1) Zero out the 8x8 set of histograms
+                // 2) Compute those histogram by iterating over lots of the input image
+                // 3) Blur the set of histograms in z
+                histogram.reorder(c, z, x, y).compute_at(blurz, x).gpu_threads(x, y);
+                histogram.update().reorder(c, r.x, r.y, x, y).gpu_threads(x, y).unroll(c);
+            }
 
             // Schedule the remaining blurs and the sampling at the end similarly.
             blurx
@@ -109,14 +133,28 @@ public:
                 .vectorize(c)
                 .unroll(y, 2, TailStrategy::RoundUp)
                 .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
-            blury
-                .compute_root()
-                .reorder(c, x, y, z)
-                .reorder_storage(c, x, y, z)
-                .vectorize(c)
-                .unroll(y, 2, TailStrategy::RoundUp)
-                .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
-            bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+            if (atomic_splat) {
+                // Blur in y into shared memory, per tile of the output,
+                // and slice from there. The channels and then z are
+                // innermost, so the two channels of a sample are one
+                // load, and the two z planes of a trilinear sample are
+                // adjacent.
+                bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+                blury.compute_at(bilateral_grid, x)
+                    .reorder_storage(c, z, x, y)
+                    .reorder(c, z, x, y)
+                    .unroll(c)
+                    .gpu_threads(x, y);
+            } else {
+                blury
+                    .compute_root()
+                    .reorder(c, x, y, z)
+                    .reorder_storage(c, x, y, z)
+                    .vectorize(c)
+                    .unroll(y, 2, TailStrategy::RoundUp)
+                    .gpu_tile(x, y, z, xi, yi, zi, 32, 8, 1, TailStrategy::RoundUp);
+                bilateral_grid.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+            }
             interpolated.compute_at(bilateral_grid, xi).vectorize(c);
         } else {
             // CPU schedule.
@@ -1,9 +1,12 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 
 #include "bilateral_grid.h"
 #ifndef NO_AUTO_SCHEDULE
+#include "bilateral_grid_atomic.h"
 #include "bilateral_grid_auto_schedule.h"
 #endif
 
@@ -46,6 +49,28 @@ int main(int argc, char **argv) {
         output.device_sync();
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
+
+    // Atomic splatting, with the last blur fused into the slicing
+    Buffer<float, 2> output_atomic(input.width(), input.height());
+    double min_t_atomic = benchmark(timing_iterations, 10, [&]() {
+        bilateral_grid_atomic(input, r_sigma, output_atomic);
+        output_atomic.device_sync();
+    });
+    printf("Atomic splat time: %gms\n", min_t_atomic * 1e3);
+
+    // The atomic adds happen in any order, so the results only match up
+    // to rounding.
+    output_atomic.copy_to_host();
+    bilateral_grid(input, r_sigma, output);
+    output.copy_to_host();
+    float max_diff = 0.0f;
+    output.for_each_element([&](int x, int y) {
+        max_diff = std::max(max_diff, std::abs(output(x, y) - output_atomic(x, y)));
+    });
+    if (max_diff > 1e-4f) {
+        printf("Atomic splat output differs by up to %g\n", max_diff);
+        return 1;
+    }
 #endif
 
     convert_and_save_image(output, argv[2]);
@@ -216,7 +216,13 @@ public:
     // currently allow 8-bit computations
     GeneratorParam<Type> result_type{"result_type", UInt(8)};
 
-    Input<Buffer<uint16_t, 2>> input{"input"};
+    // The bit depth of the raw input. 0 means one pixel per uint16 element,
+    // holding 10-bit values. 12 and 14 mean MIPI CSI-2 RAW12 and RAW14
+    // packed rows of uint8 bytes, which are unpacked in the pipeline.
+    GeneratorParam<int> packed_bits{"packed_bits", 0};
+
+    // The type of the input depends on packed_bits.
+    Input<Buffer<void, 2>> input{"input"};
     Input<Buffer<float, 2>> matrix_3200{"matrix_3200"};
     Input<Buffer<float, 2>> matrix_7000{"matrix_7000"};
     Input<float> color_temp{"color_temp"};
@@ -227,9 +233,21 @@ public:
     Input<int> whiteLevel{"whiteLevel"};
     Output<Buffer<uint8_t, 3>> processed{"processed"};
 
+    void configure() {
+        user_assert(packed_bits == 0 || packed_bits == 12 || packed_bits == 14)
+            << "packed_bits must be 0, 12 or 14\n";
+        input.set_type(packed_bits == 0 ? UInt(16) : UInt(8));
+    }
+
     void generate();
 
 private:
+    // The largest raw value.
+    int raw_max() const {
+        return (1 << (packed_bits == 0 ? 10 : (int)packed_bits)) - 1;
+    }
+
+    Func unpack(Func packed);
     Func hot_pixel_suppression(Func input);
     Func deinterleave(Func raw);
     Func apply_curve(Func input);
@@ -237,6 +255,42 @@ private:
     Func sharpen(Func input);
 };
 
+Func CameraPipe::unpack(Func packed) {
+    // Each group of pixels is packed as a byte of the most significant
+    // bits of each pixel, followed by the remaining bits of all of them,
+    // least significant pixel first. The pixels of each phase within a
+    // group are unpacked separately, and then interleaved, so that the
+    // loads of each group vectorize into dense loads and shuffles.
+    auto byte = [&](Expr i) {
+        return cast<uint16_t>(packed(i, y));
+    };
+
+    Func pixels("pixels");
+    if (packed_bits == 12) {
+        // Two pixels in three bytes.
+        Func p0, p1;
+        Expr lo = byte(3 * x + 2);
+        p0(x, y) = (byte(3 * x) << 4) | (lo & 0xf);
+        p1(x, y) = (byte(3 * x + 1) << 4) | (lo >> 4);
+        pixels = interleave_x(p0, p1);
+    } else {
+        // Four pixels in seven bytes.
+        Func p0, p1, p2, p3;
+        Expr lo0 = byte(7 * x + 4);
+        Expr lo1 = byte(7 * x + 5);
+        Expr lo2 = byte(7 * x + 6);
+        p0(x, y) = (byte(7 * x) << 6) | (lo0 & 0x3f);
+        p1(x, y) = (byte(7 * x + 1) << 6) | (lo0 >> 6) | ((lo1 & 0xf) << 2);
+        p2(x, y) = (byte(7 * x + 2) << 6) | (lo1 >> 4) | ((lo2 & 0x3) << 4);
+        p3(x, y) = (byte(7 * x + 3) << 6) | (lo2 >> 2);
+        pixels = interleave_x(interleave_x(p0, p2), interleave_x(p1, p3));
+    }
+
+    Func unpacked("unpacked");
+    unpacked(x, y) = pixels(x, y);
+    return unpacked;
+}
+
 Func CameraPipe::hot_pixel_suppression(Func input) {
 
     Expr a = max(input(x - 2, y), input(x + 2, y),
@@ -286,9 +340,16 @@ Func CameraPipe::color_correct(Func input) {
     Expr g = matrix(3, 1) + matrix(0, 1) * ir + matrix(1, 1) * ig + matrix(2, 1) * ib;
     Expr b = matrix(3, 2) + matrix(0, 2) * ir + matrix(1, 2) * ig + matrix(2, 2) * ib;
 
-    r = cast<int16_t>(r / 256);
-    g = cast<int16_t>(g / 256);
-    b = cast<int16_t>(b / 256);
+    if (packed_bits == 0) {
+        r = cast<int16_t>(r / 256);
+        g = cast<int16_t>(g / 256);
+        b = cast<int16_t>(b / 256);
+    } else {
+        // Bright pixels of deeper raw data can overflow 16 bits.
+        r = i16_sat(r / 256);
+        g = i16_sat(g / 256);
+        b = i16_sat(b / 256);
+    }
     corrected(x, y, c) = mux(c, {r, g, b});
 
     return corrected;
@@ -352,14 +413,14 @@ Func CameraPipe::apply_curve(Func input) {
 
     if (lutResample == 1) {
         // Use clamp to restrict size of LUT as allocated by compute_root
-        curved(x, y, c) = curve(clamp(input(x, y, c), 0, 1023));
+        curved(x, y, c) = curve(clamp(input(x, y, c), 0, raw_max()));
     } else {
         // Use linear interpolation to sample the LUT.
         Expr in = input(x, y, c);
         Expr u0 = in / lutResample;
         Expr u = in % lutResample;
-        Expr y0 = curve(clamp(u0, 0, 127));
-        Expr y1 = curve(clamp(u0 + 1, 0, 127));
+        Expr y0 = curve(clamp(u0, 0, raw_max() / lutResample));
+        Expr y1 = curve(clamp(u0 + 1, 0, raw_max() / lutResample));
         curved(x, y, c) = cast<uint8_t>((cast<uint16_t>(y0) * lutResample + (y1 - y0) * u) / lutResample);
     }
 
@@ -408,8 +469,15 @@ void CameraPipe::generate() {
     // boundaries so that we don't need to check bounds. We're going
     // to make a 2560x1920 output image, just like the FCam pipe, so
     // shift by 16, 12.
+    Func raw;
+    if (packed_bits == 0) {
+        raw = input;
+    } else {
+        raw = unpack(input);
+    }
+
     Func shifted;
-    shifted(x, y) = input(x + 16, y + 12);
+    shifted(x, y) = raw(x + 16, y + 12);
 
     Func denoised = hot_pixel_suppression(shifted);
 
@@ -427,7 +495,7 @@ void CameraPipe::generate() {
     /* ESTIMATES */
     // (This can be useful in conjunction with RunGen and benchmarks as well
     // as auto-schedule, so we do it in all cases.)
-    input.set_estimates({{0, 2592}, {0, 1968}});
+    input.set_estimates({{0, packed_bits == 0 ? 2592 : 2592 * packed_bits / 8}, {0, 1968}});
     matrix_3200.set_estimates({{0, 4}, {0, 3}});
     matrix_7000.set_estimates({{0, 4}, {0, 3}});
     color_temp.set_estimate(3700);
@@ -435,10 +503,14 @@ void CameraPipe::generate() {
     contrast.set_estimate(50);
     sharpen_strength.set_estimate(1.0);
     blackLevel.set_estimate(25);
-    whiteLevel.set_estimate(1023);
+    whiteLevel.set_estimate(raw_max());
     processed.set_estimates({{0, 2592}, {0, 1968}, {0, 3}});
 
-    // Schedule
+    // Schedule. The manual schedules put no bounds on the min row of the
+    // output, so the pipeline can be run on one strip of rows at a time
+    // (of a multiple of the strip size), as they arrive from the sensor,
+    // given the input rows that strip needs.
+    Expr out_min_y = processed.dim(1).min();
     if (using_autoscheduler()) {
         // nothing
     } else if (get_target().has_gpu_feature()) {
@@ -451,7 +523,7 @@ void CameraPipe::generate() {
             Expr out_height = processed.height();
             processed.bound(c, 0, 3)
                 .bound(x, 0, (out_width / 2) * 2)
-                .bound(y, 0, (out_height / 2) * 2);
+                .bound(y, out_min_y, (out_height / 2) * 2);
         }
 
         Var xi, yi, xii, xio;
@@ -530,12 +602,23 @@ void CameraPipe::generate() {
         denoised
             .compute_at(processed, yi)
             .store_at(processed, yo)
-            .prefetch(input, y, y, 2)
             .fold_storage(y, 4)
             .tile(x, y, x, y, xi, yi, 2 * vec, 2)
             .vectorize(xi)
             .unroll(yi);
 
+        if (packed_bits == 0) {
+            denoised.prefetch(input, y, y, 2);
+        } else {
+            // Unpack rows into a rolling buffer of the ones the hot
+            // pixel suppression still needs.
+            raw.compute_at(processed, yi)
+                .store_at(processed, yo)
+                .prefetch(input, y, y, 2)
+                .fold_storage(y, 8)
+                .vectorize(x, 2 * vec);
+        }
+
         deinterleaved
             .compute_at(processed, yi)
             .store_at(processed, yo)
@@ -574,7 +657,7 @@ void CameraPipe::generate() {
         processed
             .bound(c, 0, 3)
             .bound(x, 0, ((out_width) / (2 * vec)) * (2 * vec))
-            .bound(y, 0, (out_height / strip_size) * strip_size);
+            .bound(y, out_min_y, (out_height / strip_size) * strip_size);
 
         /* Optional tags to specify layout for HalideTraceViz */
         {
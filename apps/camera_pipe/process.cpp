@@ -3,6 +3,8 @@
 #include "camera_pipe.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "camera_pipe_auto_schedule.h"
+#include "camera_pipe_raw12.h"
+#include "camera_pipe_raw14.h"
 #endif
 
 #include "HalideBuffer.h"
@@ -10,6 +12,7 @@
 #include "halide_malloc_trace.h"
 
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstdlib>
@@ -17,6 +20,38 @@
 using namespace Halide::Runtime;
 using namespace Halide::Tools;
 
+// Pack the rows of a raw image as MIPI CSI-2 RAW12 or RAW14, scaling the
+// 10-bit values up to the packed bit depth.
+Buffer<uint8_t, 2> pack_raw(const Buffer<uint16_t, 2> &raw, int bits) {
+    const int group = bits == 12 ? 2 : 4;
+    const int group_bytes = group * bits / 8;
+    Buffer<uint8_t, 2> packed(raw.width() / group * group_bytes, raw.height());
+    for (int y = 0; y < raw.height(); y++) {
+        for (int g = 0; g < raw.width() / group; g++) {
+            uint8_t *bytes = &packed(g * group_bytes, y);
+            uint32_t lo = 0;
+            for (int k = 0; k < group; k++) {
+                int p = raw(g * group + k, y) << (bits - 10);
+                bytes[k] = (uint8_t)(p >> (bits - 8));
+                lo |= (uint32_t)(p & ((1 << (bits - 8)) - 1)) << (k * (bits - 8));
+            }
+            for (int i = group; i < group_bytes; i++) {
+                bytes[i] = (uint8_t)(lo >> (8 * (i - group)));
+            }
+        }
+    }
+    return packed;
+}
+
+// The mean absolute difference between two images.
+double mean_difference(const Buffer<uint8_t, 3> &a, const Buffer<uint8_t, 3> &b) {
+    double sum = 0;
+    a.for_each_element([&](int x, int y, int c) {
+        sum += std::abs(a(x, y, c) - b(x, y, c));
+    });
+    return sum / a.number_of_elements();
+}
+
 int main(int argc, char **argv) {
     if (argc < 8) {
         printf("Usage: ./process raw.png color_temp gamma contrast sharpen timing_iterations output.png\n"
@@ -75,6 +110,57 @@ int main(int argc, char **argv) {
     fprintf(stderr, "Halide (manual):\t%gus\n", best * 1e6);
 
 #ifndef NO_AUTO_SCHEDULE
+    // The visualization build only has the main pipeline.
+    output.copy_to_host();
+
+    // Process the image one strip of rows at a time, as a sensor would
+    // deliver it, passing each call only the input rows it needs. The
+    // result should be the same.
+    const int strip_size = 64;
+    Buffer<uint8_t, 3> streamed(output.width(), output.height(), 3);
+    best = benchmark(timing_iterations, 1, [&]() {
+        for (int y = 0; y < output.height(); y += strip_size) {
+            Buffer<uint8_t, 3> strip = streamed.cropped(1, y, strip_size);
+            // A bounds query gives the input rows this strip needs.
+            Buffer<uint16_t, 2> rows((uint16_t *)nullptr, 0, 0);
+            camera_pipe(rows, matrix_3200, matrix_7000,
+                        color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                        strip);
+            rows = input.cropped(1, rows.dim(1).min(), rows.dim(1).extent());
+            camera_pipe(rows, matrix_3200, matrix_7000,
+                        color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
+                        strip);
+            strip.copy_to_host();
+        }
+    });
+    fprintf(stderr, "Halide (strips of %d rows):\t%gus\n", strip_size, best * 1e6);
+    if (mean_difference(streamed, output) != 0) {
+        fprintf(stderr, "Processing in strips does not match processing the whole image\n");
+        return 1;
+    }
+
+    // Packed 12 and 14-bit raw data, with the same image content. The
+    // results differ from the 10-bit results only by rounding.
+    for (int bits : {12, 14}) {
+        Buffer<uint8_t, 2> packed = pack_raw(input, bits);
+        Buffer<uint8_t, 3> packed_output(output.width(), output.height(), 3);
+        const int scale = 1 << (bits - 10);
+        auto camera_pipe_packed = bits == 12 ? camera_pipe_raw12 : camera_pipe_raw14;
+        best = benchmark(timing_iterations, 1, [&]() {
+            camera_pipe_packed(packed, matrix_3200, matrix_7000,
+                               color_temp, gamma, contrast, sharpen,
+                               blackLevel * scale, (whiteLevel + 1) * scale - 1,
+                               packed_output);
+            packed_output.device_sync();
+        });
+        fprintf(stderr, "Halide (packed %d-bit):\t%gus\n", bits, best * 1e6);
+        packed_output.copy_to_host();
+        double diff = mean_difference(packed_output, output);
+        if (diff > 1.0) {
+            fprintf(stderr, "Packed %d-bit output differs from the 10-bit output by %f on average\n", bits, diff);
+            return 1;
+        }
+    }
     best = benchmark(timing_iterations, 1, [&]() {
         camera_pipe_auto_schedule(input, matrix_3200, matrix_7000,
                                   color_temp, gamma, contrast, sharpen, blackLevel, whiteLevel,
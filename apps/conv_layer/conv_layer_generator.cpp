@@ -4,22 +4,53 @@ namespace {
 
 using namespace Halide;
 
+enum class ConvAlgorithm {
+    Direct,    // Accumulate the products of the filter and the input directly.
+    Winograd,  // Winograd F(2x2, 3x3), for 3x3 filters.
+    GEMM,      // Copy the input to im2col form, and multiply it by the filter.
+};
+
+std::map<std::string, ConvAlgorithm> convAlgorithmEnumMap() {
+    return {
+        {"direct", ConvAlgorithm::Direct},
+        {"winograd", ConvAlgorithm::Winograd},
+        {"gemm", ConvAlgorithm::GEMM},
+    };
+};
+
 class ConvolutionLayer : public Halide::Generator<ConvolutionLayer> {
 public:
+    GeneratorParam<ConvAlgorithm> algorithm{"algorithm", ConvAlgorithm::Direct, convAlgorithmEnumMap()};
+    // The width and height of the filter.
+    GeneratorParam<int> kernel_size{"kernel_size", 3};
+
     Input<Buffer<float, 4>> input{"input"};
     Input<Buffer<float, 4>> filter{"filter"};
     Input<Buffer<float, 1>> bias{"bias"};
     Output<Buffer<float, 4>> relu{"relu"};
 
     void generate() {
-        const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
+        const int K = kernel_size;
 
-        /* THE ALGORITHM */
+        user_assert(algorithm != ConvAlgorithm::Winograd || K == 3)
+            << "The winograd algorithm needs a 3x3 filter\n";
+        user_assert(algorithm == ConvAlgorithm::Direct || !get_target().has_gpu_feature())
+            << "Only the direct algorithm has a GPU schedule\n";
+
+        set_bounds();
 
-        Var x("x"), y("y"), c("c"), n("n");
+        if (algorithm == ConvAlgorithm::Winograd) {
+            generate_winograd();
+            return;
+        } else if (algorithm == ConvAlgorithm::GEMM) {
+            generate_gemm();
+            return;
+        }
+
+        /* THE ALGORITHM */
 
         Func conv("conv");
-        RDom r(0, CI, 0, 3, 0, 3);
+        RDom r(0, CI, 0, K, 0, K);
 
         conv(c, x, y, n) = bias(c);
         conv(c, x, y, n) += filter(c, r.y, r.z, r.x) * input(r.x, x + r.y, y + r.z, n);
@@ -28,36 +59,15 @@ public:
 
         /* THE SCHEDULE */
 
-        // MKL JITs code for the specific size and strides, so we'll
-        // do the same and ask Halide to compile for this specific
-        // size:
-
-        relu.dim(0).set_bounds(0, CO).set_stride(1);
-        relu.dim(1).set_bounds(0, W).set_stride(CO);
-        relu.dim(2).set_bounds(0, H).set_stride(CO * W);
-        relu.dim(3).set_bounds(0, N).set_stride(CO * H * W);
-
-        input.dim(0).set_bounds(0, CI).set_stride(1);
-        input.dim(1).set_bounds(0, W + 2).set_stride(CI);
-        input.dim(2).set_bounds(0, H + 2).set_stride(CI * (W + 2));
-        input.dim(3).set_bounds(0, N).set_stride(CI * (W + 2) * (H + 2));
-
-        filter.dim(0).set_bounds(0, CO).set_stride(1);
-        filter.dim(1).set_bounds(0, 3).set_stride(CO);
-        filter.dim(2).set_bounds(0, 3).set_stride(CO * 3);
-        filter.dim(3).set_bounds(0, CI).set_stride(CO * 3 * 3);
-
-        bias.dim(0).set_bounds(0, CO).set_stride(1);
-
         if (using_autoscheduler()) {
             input.dim(0).set_estimate(0, CI);
-            input.dim(1).set_estimate(0, W + 2);
-            input.dim(2).set_estimate(0, H + 2);
+            input.dim(1).set_estimate(0, W + K - 1);
+            input.dim(2).set_estimate(0, H + K - 1);
             input.dim(3).set_estimate(0, N);
 
             filter.dim(0).set_estimate(0, CO);
-            filter.dim(1).set_estimate(0, 3);
-            filter.dim(2).set_estimate(0, 3);
+            filter.dim(1).set_estimate(0, K);
+            filter.dim(2).set_estimate(0, K);
             filter.dim(3).set_estimate(0, CI);
 
             bias.dim(0).set_estimate(0, CO);
@@ -132,43 +142,11 @@ public:
 
             // The ratio of actual to theoretical flops hit is 0.9458
 
-            int tile_w = 1;
-            int tile_h = 1;
+            int tile_w, tile_h;
+            accumulator_tile(&tile_w, &tile_h);
             const int vec = natural_vector_size<float>();
 
-            if (get_target().has_feature(Target::AVX512_Skylake) ||
-                (get_target().arch == Target::ARM &&
-                 get_target().bits == 64)) {
-                // On Skylake we have one load per fma and 32
-                // registers available, so there's considerable
-                // flexibility in the schedule. We'll use 20 accumulator
-                // registers in a 4x5 tile. This is also a reasonable
-                // choice for ARMv8, which also has 32 registers.
-                tile_w = 4;
-                tile_h = 5;
-            } else if (get_target().arch == Target::X86) {
-                // With 16-register ISAs like x86 with AVX2, we can
-                // only do one load per two fmas, which constrains the
-                // schedule to have to be a squarish 12-register tile
-                // of the output.
-                tile_w = 3;
-                tile_h = 4;
-            } else {
-                // The above should also be reasonable schedule for
-                // ARMv7 and other 16-register machines, but I see
-                // some spills on arm-32, so we use a 2x4 block of 8
-                // accumulators instead. This could probably be better
-                // tuned, because in principle 12 accumulators should
-                // be possible. I believe the issue is that there's no
-                // fused multiply-add instruction, and so we're
-                // fighting llvm's instruction scheduler, which wants
-                // to move the muls well ahead of the adds to cover
-                // instruction latencies.
-                tile_w = 2;
-                tile_h = 4;
-            }
-
-            Var co, ci, xo, xi, yo, yi, t;
+            Var co, ci, xo, xi;
             relu.split(c, co, ci, vec * tile_w)
                 .split(x, xo, xi, tile_h)
                 .reorder(ci, xi, xo, y, n, co)
@@ -200,6 +178,233 @@ public:
                 .unroll(_0);
         }
     }
+
+private:
+    const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
+
+    Var x{"x"}, y{"y"}, c{"c"}, n{"n"};
+
+    void set_bounds() {
+        const int K = kernel_size;
+
+        // MKL JITs code for the specific size and strides, so we'll
+        // do the same and ask Halide to compile for this specific
+        // size:
+
+        relu.dim(0).set_bounds(0, CO).set_stride(1);
+        relu.dim(1).set_bounds(0, W).set_stride(CO);
+        relu.dim(2).set_bounds(0, H).set_stride(CO * W);
+        relu.dim(3).set_bounds(0, N).set_stride(CO * H * W);
+
+        input.dim(0).set_bounds(0, CI).set_stride(1);
+        input.dim(1).set_bounds(0, W + K - 1).set_stride(CI);
+        input.dim(2).set_bounds(0, H + K - 1).set_stride(CI * (W + K - 1));
+        input.dim(3).set_bounds(0, N).set_stride(CI * (W + K - 1) * (H + K - 1));
+
+        filter.dim(0).set_bounds(0, CO).set_stride(1);
+        filter.dim(1).set_bounds(0, K).set_stride(CO);
+        filter.dim(2).set_bounds(0, K).set_stride(CO * K);
+        filter.dim(3).set_bounds(0, CI).set_stride(CO * K * K);
+
+        bias.dim(0).set_bounds(0, CO).set_stride(1);
+    }
+
+    // The size of the block of the output computed in registers, in vectors
+    // of channels by pixels.
+    void accumulator_tile(int *tile_w, int *tile_h) {
+        if (get_target().has_feature(Target::AVX512_Skylake) ||
+            (get_target().arch == Target::ARM &&
+             get_target().bits == 64)) {
+            // On Skylake we have one load per fma and 32
+            // registers available, so there's considerable
+            // flexibility in the schedule. We'll use 20 accumulator
+            // registers in a 4x5 tile. This is also a reasonable
+            // choice for ARMv8, which also has 32 registers.
+            *tile_w = 4;
+            *tile_h = 5;
+        } else if (get_target().arch == Target::X86) {
+            // With 16-register ISAs like x86 with AVX2, we can
+            // only do one load per two fmas, which constrains the
+            // schedule to have to be a squarish 12-register tile
+            // of the output.
+            *tile_w = 3;
+            *tile_h = 4;
+        } else {
+            // The above should also be reasonable schedule for
+            // ARMv7 and other 16-register machines, but I see
+            // some spills on arm-32, so we use a 2x4 block of 8
+            // accumulators instead. This could probably be better
+            // tuned, because in principle 12 accumulators should
+            // be possible. I believe the issue is that there's no
+            // fused multiply-add instruction, and so we're
+            // fighting llvm's instruction scheduler, which wants
+            // to move the muls well ahead of the adds to cover
+            // instruction latencies.
+            *tile_w = 2;
+            *tile_h = 4;
+        }
+    }
+
+    // Winograd F(2x2, 3x3) (Lavin and Gray, "Fast Algorithms for
+    // Convolutional Neural Networks", 2015). Each 2x2 tile of the output is
+    // computed from a 4x4 tile of the input with 16 multiplies per pair of
+    // channels instead of 36. The transformed input and filter are multiplied
+    // as 16 independent matrix products over the input channels.
+    void generate_winograd() {
+        /* THE ALGORITHM */
+
+        Var a("a"), b("b"), k("k"), ci("ci"), tx("tx"), ty("ty");
+
+        // The filter transform, U = G g G^T.
+        auto G = [](const Expr &g0, const Expr &g1, const Expr &g2, const Expr &i) {
+            return mux(i, {g0, (g0 + g1 + g2) * 0.5f, (g0 - g1 + g2) * 0.5f, g2});
+        };
+        Func filter_x("filter_x"), U("U");
+        filter_x(c, a, k, ci) = G(filter(c, 0, k, ci), filter(c, 1, k, ci), filter(c, 2, k, ci), a);
+        U(c, a, b, ci) = G(filter_x(c, a, 0, ci), filter_x(c, a, 1, ci), filter_x(c, a, 2, ci), b);
+
+        // The input transform, V = B^T d B, of the tile of the input at
+        // (2 * tx, 2 * ty).
+        auto BT = [](const Expr &d0, const Expr &d1, const Expr &d2, const Expr &d3, const Expr &i) {
+            return mux(i, {d0 - d2, d1 + d2, d2 - d1, d1 - d3});
+        };
+        Func input_x("input_x"), V("V");
+        input_x(ci, a, k, tx, ty, n) = BT(input(ci, 2 * tx, 2 * ty + k, n),
+                                          input(ci, 2 * tx + 1, 2 * ty + k, n),
+                                          input(ci, 2 * tx + 2, 2 * ty + k, n),
+                                          input(ci, 2 * tx + 3, 2 * ty + k, n), a);
+        V(ci, a, b, tx, ty, n) = BT(input_x(ci, a, 0, tx, ty, n), input_x(ci, a, 1, tx, ty, n),
+                                    input_x(ci, a, 2, tx, ty, n), input_x(ci, a, 3, tx, ty, n), b);
+
+        // The products of the transforms, summed over the input channels.
+        Func M("M");
+        RDom r(0, CI);
+        M(c, a, b, tx, ty, n) += U(c, a, b, r) * V(r, a, b, tx, ty, n);
+
+        // The output transform, Y = A^T M A.
+        auto AT = [](const Expr &m0, const Expr &m1, const Expr &m2, const Expr &m3, const Expr &i) {
+            return mux(i, {m0 + m1 + m2, m1 - m2 - m3});
+        };
+        Func M_x("M_x");
+        M_x(c, k, b, tx, ty, n) = AT(M(c, 0, b, tx, ty, n), M(c, 1, b, tx, ty, n),
+                                     M(c, 2, b, tx, ty, n), M(c, 3, b, tx, ty, n), k);
+        Expr Y = AT(M_x(c, x % 2, 0, x / 2, y / 2, n), M_x(c, x % 2, 1, x / 2, y / 2, n),
+                    M_x(c, x % 2, 2, x / 2, y / 2, n), M_x(c, x % 2, 3, x / 2, y / 2, n), y % 2);
+
+        relu(c, x, y, n) = max(0, bias(c) + Y);
+
+        /* THE SCHEDULE */
+
+        if (using_autoscheduler()) {
+            return;
+        }
+
+        int tile_w, tile_h;
+        accumulator_tile(&tile_w, &tile_h);
+        const int vec = natural_vector_size<float>();
+
+        // Compute a row of tiles of the output at a time. Unrolling the
+        // pixels of a tile makes the output transform a constant
+        // combination of the products.
+        Var xo, xi, yo, yi, co, cii, txo, txi;
+        relu.split(x, xo, xi, 2)
+            .split(y, yo, yi, 2)
+            .reorder(c, xi, yi, xo, yo, n)
+            .vectorize(c, vec)
+            .unroll(xi)
+            .unroll(yi)
+            .parallel(yo)
+            .parallel(n);
+
+        // The filter transform only depends on the filter.
+        U.compute_root()
+            .vectorize(c, vec)
+            .unroll(a)
+            .unroll(b)
+            .parallel(ci);
+
+        V.compute_at(relu, yo)
+            .vectorize(ci, vec)
+            .unroll(a)
+            .unroll(b);
+
+        // Each of the 16 matrix products is blocked like the direct
+        // convolution.
+        M.compute_at(relu, yo)
+            .vectorize(c, vec);
+        M.update()
+            .split(c, co, cii, vec * tile_w)
+            .split(tx, txo, txi, tile_h)
+            .reorder(cii, txi, r, txo, co, a, b, ty, n)
+            .vectorize(cii, vec)
+            .unroll(cii)
+            .unroll(txi);
+    }
+
+    // im2col + GEMM. The input is copied one row at a time to a matrix with
+    // the input channels and filter taps of each pixel contiguous, so the
+    // reduction is one stream through memory, and is multiplied by the
+    // filter. For 1x1 filters the input is already in that form, so it is
+    // used as is.
+    void generate_gemm() {
+        const int K = kernel_size;
+
+        /* THE ALGORITHM */
+
+        Func im2col("im2col");
+        Var ci("ci"), kx("kx"), ky("ky");
+        if (K > 1) {
+            im2col(ci, kx, ky, x, y, n) = input(ci, x + kx, y + ky, n);
+        } else {
+            im2col(ci, kx, ky, x, y, n) = input(ci, x, y, n);
+        }
+
+        Func gemm("gemm");
+        RDom r(0, CI, 0, K, 0, K);
+        gemm(c, x, y, n) = bias(c);
+        gemm(c, x, y, n) += filter(c, r.y, r.z, r.x) * im2col(r.x, r.y, r.z, x, y, n);
+
+        relu(c, x, y, n) = max(0, gemm(c, x, y, n));
+
+        /* THE SCHEDULE */
+
+        if (using_autoscheduler()) {
+            return;
+        }
+
+        int tile_w, tile_h;
+        accumulator_tile(&tile_w, &tile_h);
+        const int vec = natural_vector_size<float>();
+
+        Var co, cii, xo, xi;
+        relu.split(c, co, cii, vec * tile_w)
+            .split(x, xo, xi, tile_h)
+            .reorder(cii, xi, xo, y, n, co)
+            .vectorize(cii, vec)
+            .unroll(cii)
+            .unroll(xi)
+            .parallel(y)
+            .parallel(n)
+            .parallel(co);
+        gemm.compute_at(relu, xo)
+            .vectorize(c, vec)
+            .unroll(c)
+            .unroll(x)
+            .unroll(y)
+            .update()
+            .reorder(c, x, y, r.x, r.y, r.z, n)
+            .vectorize(c, vec)
+            .unroll(c)
+            .unroll(x)
+            .unroll(y)
+            .unroll(r.x, 2);
+        if (K > 1) {
+            im2col.compute_at(relu, y)
+                .vectorize(ci, vec);
+        } else {
+            im2col.compute_inline();
+        }
+    }
 };
 
 }  // namespace
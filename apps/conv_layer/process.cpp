@@ -1,8 +1,13 @@
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 
 #include "conv_layer.h"
+#include "conv_layer_1x1.h"
+#include "conv_layer_1x1_gemm.h"
 #include "conv_layer_auto_schedule.h"
+#include "conv_layer_gemm.h"
+#include "conv_layer_winograd.h"
 
 #include "HalideBuffer.h"
 #include "halide_benchmark.h"
@@ -10,6 +15,35 @@
 using namespace Halide::Tools;
 using namespace Halide::Runtime;
 
+typedef int (*conv_layer_fn)(halide_buffer_t *, halide_buffer_t *, halide_buffer_t *, halide_buffer_t *);
+
+// Pick the algorithm for a layer from the shape of its filter: Winograd for
+// 3x3 filters, and GEMM for 1x1 filters.
+conv_layer_fn select_conv_layer(const Buffer<float, 4> &filter) {
+    if (filter.dim(1).extent() == 3 && filter.dim(2).extent() == 3) {
+        return conv_layer_winograd;
+    } else if (filter.dim(1).extent() == 1 && filter.dim(2).extent() == 1) {
+        return conv_layer_1x1_gemm;
+    } else {
+        return conv_layer;
+    }
+}
+
+// Check that the output of another algorithm matches the direct convolution,
+// relative to the size of the output.
+bool check(const Buffer<float, 4> &correct, const Buffer<float, 4> &output, const char *name) {
+    bool ok = true;
+    correct.for_each_element([&](int c, int x, int y, int n) {
+        const float tolerance = 1e-3f * std::abs(correct(c, x, y, n)) + 1e-3f;
+        if (ok && std::abs(output(c, x, y, n) - correct(c, x, y, n)) > tolerance) {
+            printf("%s: output(%d, %d, %d, %d) = %f instead of %f\n",
+                   name, c, x, y, n, output(c, x, y, n), correct(c, x, y, n));
+            ok = false;
+        }
+    });
+    return ok;
+}
+
 int main(int argc, char **argv) {
     const int N = 5, CI = 128, CO = 128, W = 100, H = 80;
 
@@ -70,6 +104,58 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // The other algorithms
+    conv_layer(input, filter, bias, output);
+    Buffer<float, 4> output_alt(CO, W, H, N);
+
+    double min_t_winograd = benchmark(10, 10, [&]() {
+        conv_layer_winograd(input, filter, bias, output_alt);
+    });
+    printf("Winograd time: %gms\n", min_t_winograd * 1e3);
+    if (!check(output, output_alt, "winograd")) {
+        return 1;
+    }
+
+    double min_t_gemm = benchmark(10, 10, [&]() {
+        conv_layer_gemm(input, filter, bias, output_alt);
+    });
+    printf("GEMM time: %gms\n", min_t_gemm * 1e3);
+    if (!check(output, output_alt, "gemm")) {
+        return 1;
+    }
+
+    // A 1x1 convolution of the same size
+    Buffer<float, 4> input_1x1(CI, W, H, N);
+    Buffer<float, 4> filter_1x1(CO, 1, 1, CI);
+    input_1x1.for_each_value([](float &v) { v = rand(); });
+    filter_1x1.for_each_value([](float &v) { v = rand(); });
+
+    double min_t_1x1 = benchmark(10, 10, [&]() {
+        conv_layer_1x1(input_1x1, filter_1x1, bias, output);
+    });
+    printf("1x1 direct time: %gms\n", min_t_1x1 * 1e3);
+
+    double min_t_1x1_gemm = benchmark(10, 10, [&]() {
+        conv_layer_1x1_gemm(input_1x1, filter_1x1, bias, output_alt);
+    });
+    printf("1x1 GEMM time: %gms\n", min_t_1x1_gemm * 1e3);
+    if (!check(output, output_alt, "1x1 gemm")) {
+        return 1;
+    }
+
+    // The algorithms picked by shape
+    for (Buffer<float, 4> *f : {&filter, &filter_1x1}) {
+        conv_layer_fn fn = select_conv_layer(*f);
+        Buffer<float, 4> &in = f == &filter ? input : input_1x1;
+        double t = benchmark(10, 10, [&]() {
+            fn(in, *f, bias, output_alt);
+        });
+        printf("Selected algorithm for %dx%d filter: %s, %gms\n",
+               f->dim(1).extent(), f->dim(2).extent(),
+               fn == conv_layer_winograd ? "winograd" : fn == conv_layer_1x1_gemm ? "gemm" : "direct",
+               t * 1e3);
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -5,10 +5,12 @@
 #include "fft.h"
 
 #include <cassert>
+#include <chrono>
 #include <cmath>
 #include <cstddef>
 #include <limits>
 #include <map>
+#include <mutex>
 #include <ostream>
 #include <string>
 
@@ -228,6 +230,52 @@ ComplexFunc dft8(ComplexFunc f, int sign, const string &prefix) {
     return F;
 }
 
+// DFT of odd size N of the first dimension of a Func f. Pairing x[m] with
+// x[N - m] halves the number of multiplications needed compared to dftN.
+ComplexFunc dft_odd(ComplexFunc f, int N, int sign, const string &prefix) {
+    assert(N % 2 == 1);
+    const int H = N / 2;
+
+    Type type = f.types()[0];
+
+    ComplexFunc F(prefix + "X" + std::to_string(N));
+    F(f.args()) = undef_z(type);
+
+    vector<ComplexFuncRef> x = get_func_refs(f, N);
+    vector<ComplexFuncRef> X = get_func_refs(F, N);
+    vector<ComplexFuncRef> T = get_func_refs(F, 2 * H, true);
+
+    // T[2 * m] = x[m + 1] + x[N - m - 1], T[2 * m + 1] = j * sign * (x[m + 1] - x[N - m - 1])
+    for (int m = 0; m < H; m++) {
+        T[2 * m] = x[m + 1] + x[N - m - 1];
+        T[2 * m + 1] = (x[m + 1] - x[N - m - 1]) * j * sign;
+    }
+
+    for (int k = 1; k <= H; k++) {
+        ComplexExpr even = x[0];
+        ComplexExpr odd;
+        for (int m = 0; m < H; m++) {
+            float w = 2 * kPi * (((m + 1) * k) % N) / N;
+            even += T[2 * m] * std::cos(w);
+            if (m == 0) {
+                odd = T[2 * m + 1] * std::sin(w);
+            } else {
+                odd += T[2 * m + 1] * std::sin(w);
+            }
+        }
+        X[k] = even + odd;
+        X[N - k] = even - odd;
+    }
+
+    ComplexExpr dc = x[0];
+    for (int m = 0; m < H; m++) {
+        dc += T[2 * m];
+    }
+    X[0] = dc;
+
+    return F;
+}
+
 // Compute the complex DFT of size N on dimension 0 of x.
 ComplexFunc dftN(ComplexFunc x, int N, int sign, const string &prefix) {
     vector<Var> args(x.args());
@@ -256,6 +304,10 @@ ComplexFunc dft1d_c2c(ComplexFunc x, int N, int sign,
     switch (N) {
     case 2:
         return dft2(x, prefix);
+    case 3:
+    case 5:
+    case 7:
+        return dft_odd(x, N, sign, prefix);
     case 4:
         return dft4(x, sign, prefix);
     case 6:
@@ -420,6 +472,171 @@ ComplexFunc fft_dim1(ComplexFunc x,
     return x;
 }
 
+// Compute the N = N1 * N2 point DFT of dimension 1 of x with the four-step
+// algorithm, where N1 = product(R1) and N2 = product(R2):
+//
+//   X[k1 + N1 * k2] = sum_n2 W_N^(n2 * k1) * W_N2^(n2 * k2) *
+//                     sum_n1 x[N2 * n1 + n2] * W_N1^(n1 * k1)
+//
+// The inner sums are N2 FFTs of size N1, and the outer sums are N1 FFTs of
+// size N2. Each of those FFTs (and the intermediate stages they produce) only
+// touches a block of N1 or N2 points per group of columns, rather than N.
+ComplexFunc fft_dim1_four_step(ComplexFunc x,
+                               const vector<int> &R1,
+                               const vector<int> &R2,
+                               int sign,
+                               int extent_0,
+                               Expr gain,
+                               bool parallel,
+                               const string &prefix,
+                               const Target &target,
+                               TwiddleFactorSet *twiddle_cache) {
+    const int N1 = product(R1);
+    const int N2 = product(R2);
+    const int N = N1 * N2;
+
+    vector<Var> args = x.args();
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    Var n2("n2"), k1("k1");
+
+    // Step 1: FFTs of size N1 of the subsequences x[N2 * n1 + n2].
+    ComplexFunc strided(prefix + "four_step_in");
+    strided(A({n0, n1, n2}, args)) = x(A({n0, N2 * n1 + n2}, args));
+    ComplexFunc step1 = fft_dim1(strided, R1, sign, extent_0, 1.0f, false,
+                                 prefix + "step1_", target, twiddle_cache);
+
+    // Step 2: Apply the twiddle factors (and the gain), and make n2 the
+    // dimension to transform next.
+    ComplexFunc W = twiddle_factors(N, gain, sign, prefix + "four_step_", twiddle_cache);
+    ComplexFunc twiddled(prefix + "four_step_twiddled");
+    twiddled(A({n0, n2, k1}, args)) = step1(A({n0, k1, n2}, args)) * W(n2 * k1);
+
+    // Step 3: FFTs of size N2.
+    ComplexFunc step2 = fft_dim1(twiddled, R2, sign, extent_0, 1.0f, false,
+                                 prefix + "step2_", target, twiddle_cache);
+
+    // Step 4: The result is transposed, X[k1 + N1 * k2] = step2[k2, k1].
+    ComplexFunc X(prefix + "four_step");
+    X(A({n0, n1}, args)) = step2(A({n0, n1 / N1, n1 % N1}, args));
+    X.bound(n1, 0, N);
+
+    const int vector_width = gcd(target.natural_vector_size<float>(), extent_0);
+    X.split(n0, group, n0, vector_width)
+        .reorder(n0, n1, group)
+        .vectorize(n0);
+    if (parallel) {
+        X.parallel(group);
+    }
+    step1.compute_at(X, group);
+    step2.compute_at(X, group);
+
+    return X;
+}
+
+// Compute the N point DFT of dimension 1 of x with Bluestein's algorithm. With
+// the chirp w[n] = W_2N^(n^2), n * k = (n^2 + k^2 - (k - n)^2) / 2 gives
+//
+//   X[k] = w[k] * sum_n (x[n] * w[n]) * conj(w[k - n])
+//
+// which is a convolution, computed as a circular convolution of size
+// M = product(RM) >= 2 * N - 1 using FFTs.
+ComplexFunc fft_dim1_bluestein(ComplexFunc x,
+                               int N,
+                               const vector<int> &RM,
+                               int sign,
+                               int extent_0,
+                               Expr gain,
+                               bool parallel,
+                               const string &prefix,
+                               const Target &target,
+                               TwiddleFactorSet *twiddle_cache) {
+    const int M = product(RM);
+    assert(M >= 2 * N - 1);
+
+    vector<Var> args = x.args();
+    Var n0(args[0]), n1(args[1]);
+    args.erase(args.begin());
+    args.erase(args.begin());
+
+    // n^2 is reduced modulo 2N to keep the argument of expj small.
+    Var n("n"), u("u");
+    ComplexFunc w(prefix + "chirp");
+    Expr n_sq = cast<int>((cast<int64_t>(n) * n) % (2 * N));
+    w(n) = expj((sign * kPi * cast<float>(n_sq)) / N);
+    w.compute_root();
+
+    // The chirped input, padded with zeros to M points.
+    ComplexFunc padded(prefix + "bluestein_in");
+    Expr n1_clamped = min(n1, N - 1);
+    padded(A({n0, n1}, args)) =
+        select(n1 < N, cast<float>(ComplexExpr(x(A({n0, n1_clamped}, args)))) * w(n1_clamped),
+               ComplexExpr(0.0f, 0.0f));
+    ComplexFunc padded_dft = fft_dim1(padded, RM, -1, extent_0, 1.0f, false,
+                                      prefix + "bluestein_in_", target, twiddle_cache);
+
+    // The DFT of the convolution kernel conj(w), wrapped around to make the
+    // convolution circular. This is the same for every column, and includes
+    // the 1 / M normalization of the inverse FFT below. We only need one
+    // column of it, but compute a vector's worth so it can be vectorized like
+    // the other FFTs.
+    const int kernel_columns = target.natural_vector_size<float>();
+    ComplexFunc kernel(prefix + "bluestein_kernel");
+    kernel(u, n) = select(n < N, conj(w(min(n, N - 1))),
+                          n > M - N, conj(w(clamp(M - n, 0, N - 1))),
+                          ComplexExpr(0.0f, 0.0f));
+    ComplexFunc kernel_dft = fft_dim1(kernel, RM, -1, kernel_columns, 1.0f / M, false,
+                                      prefix + "bluestein_kernel_", target, twiddle_cache);
+    kernel_dft.compute_root().bound(kernel_dft.args()[0], 0, kernel_columns);
+
+    // Multiply, and transform back.
+    ComplexFunc product_dft(prefix + "bluestein_product");
+    product_dft(A({n0, n1}, args)) = padded_dft(A({n0, n1}, args)) * kernel_dft(0, n1);
+    ComplexFunc conv = fft_dim1(product_dft, RM, 1, extent_0, 1.0f, false,
+                                prefix + "bluestein_conv_", target, twiddle_cache);
+
+    ComplexFunc X(prefix + "bluestein");
+    X(A({n0, n1}, args)) = conv(A({n0, n1}, args)) * w(n1) * gain;
+    X.bound(n1, 0, N);
+
+    const int vector_width = gcd(target.natural_vector_size<float>(), extent_0);
+    X.split(n0, group, n0, vector_width)
+        .reorder(n0, n1, group)
+        .vectorize(n0);
+    if (parallel) {
+        X.parallel(group);
+    }
+    padded_dft.compute_at(X, group);
+    conv.compute_at(X, group);
+
+    return X;
+}
+
+// Compute the DFT of dimension 1 of x according to plan.
+ComplexFunc fft_dim1(ComplexFunc x,
+                     const Fft1dPlan &plan,
+                     int sign,
+                     int extent_0,
+                     Expr gain,
+                     bool parallel,
+                     const string &prefix,
+                     const Target &target,
+                     TwiddleFactorSet *twiddle_cache) {
+    switch (plan.algorithm) {
+    case Fft1dPlan::FourStep:
+        return fft_dim1_four_step(x, plan.radices, plan.radices2, sign, extent_0, gain,
+                                  parallel, prefix, target, twiddle_cache);
+    case Fft1dPlan::Bluestein:
+        return fft_dim1_bluestein(x, plan.size, plan.radices, sign, extent_0, gain,
+                                  parallel, prefix, target, twiddle_cache);
+    default:
+        return fft_dim1(x, plan.radices, sign, extent_0, gain,
+                        parallel, prefix, target, twiddle_cache);
+    }
+}
+
 // transpose the first two dimensions of x.
 template<typename FuncType>
 FuncType transpose(FuncType f) {
@@ -479,15 +696,15 @@ std::pair<FuncType, FuncType> tiled_transpose(FuncType f, int max_tile_size,
 }  // namespace
 
 ComplexFunc fft2d_c2c(ComplexFunc x,
-                      vector<int> R0,
-                      vector<int> R1,
+                      const Fft1dPlan &plan0,
+                      const Fft1dPlan &plan1,
                       int sign,
                       const Target &target,
                       const Fft2dDesc &desc) {
     string prefix = desc.name.empty() ? "c2c_" : desc.name + "_";
 
-    int N0 = product(R0);
-    int N1 = product(R1);
+    int N0 = plan0.size;
+    int N1 = plan1.size;
 
     // Get the innermost variable outside the FFT.
     Var outer = Var::outermost();
@@ -505,7 +722,7 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
 
     // Compute the DFT of dimension 1 (originally dimension 0).
     ComplexFunc dft1T = fft_dim1(xT,
-                                 R0,
+                                 plan0,
                                  sign,
                                  N1,  // extent of dim 0.
                                  1.0f,
@@ -519,7 +736,7 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
 
     // Compute the DFT of dimension 1.
     ComplexFunc dft = fft_dim1(dft1,
-                               R1,
+                               plan1,
                                sign,
                                N0,  // extent of dim 0
                                desc.gain,
@@ -665,8 +882,8 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
 // can be recovered using (3) and (4) again.
 
 ComplexFunc fft2d_r2c(Func r,
-                      const vector<int> &R0,
-                      const vector<int> &R1,
+                      const Fft1dPlan &plan0,
+                      const Fft1dPlan &plan1,
                       const Target &target,
                       const Fft2dDesc &desc) {
     string prefix = desc.name.empty() ? "r2c_" : desc.name + "_";
@@ -682,8 +899,8 @@ ComplexFunc fft2d_r2c(Func r,
         outer = args.front();
     }
 
-    int N0 = product(R0);
-    int N1 = product(R1);
+    int N0 = plan0.size;
+    int N1 = plan1.size;
 
     const int natural_vector_size = target.natural_vector_size(r.types()[0]);
 
@@ -691,13 +908,16 @@ ComplexFunc fft2d_r2c(Func r,
     // the FFT may be expensive compared to just brute forcing with a complex
     // FFT.
     bool skip_zip = N0 < natural_vector_size * 2;
+    // The zipping below pairs up columns, and the DC and Nyquist rows, which
+    // requires even sizes.
+    skip_zip = skip_zip || (N0 % 2 != 0) || (N1 % 2 != 0);
     // We also are bad at handling zipping when the zip size is a small non-integer
     // factor of the vector size.
     skip_zip = skip_zip || (N0 < natural_vector_size * 4 && (N0 % (natural_vector_size * 2) != 0));
     if (skip_zip) {
         ComplexFunc r_complex("r_complex");
         r_complex(A({n0, n1}, args)) = ComplexExpr(r(A({n0, n1}, args)), 0.0f);
-        ComplexFunc dft = fft2d_c2c(r_complex, R0, R1, -1, target, desc);
+        ComplexFunc dft = fft2d_c2c(r_complex, plan0, plan1, -1, target, desc);
 
         // fft2d_c2c produces a N0 x N1 buffer, but the caller of this probably only expects
         // an N0 x N1 / 2 + 1 buffer.
@@ -742,7 +962,7 @@ ComplexFunc fft2d_r2c(Func r,
 
     // DFT down the columns first.
     ComplexFunc dft1 = fft_dim1(zipped,
-                                R1,
+                                plan1,
                                 -1,      // sign
                                 N0 / 2,  // extent of dim 0
                                 1.0f,
@@ -785,7 +1005,7 @@ ComplexFunc fft2d_r2c(Func r,
 
     // DFT down the columns again (the rows of the original).
     ComplexFunc dftT = fft_dim1(unzippedT,
-                                R0,
+                                plan0,
                                 -1,  // sign
                                 zipped_extent0,
                                 gain,
@@ -883,8 +1103,8 @@ ComplexFunc fft2d_r2c(Func r,
 }
 
 Func fft2d_c2r(ComplexFunc c,
-               vector<int> R0,
-               vector<int> R1,
+               const Fft1dPlan &plan0,
+               const Fft1dPlan &plan1,
                const Target &target,
                const Fft2dDesc &desc) {
     string prefix = desc.name.empty() ? "c2r_" : desc.name + "_";
@@ -900,8 +1120,8 @@ Func fft2d_c2r(ComplexFunc c,
         outer = args.front();
     }
 
-    int N0 = product(R0);
-    int N1 = product(R1);
+    int N0 = plan0.size;
+    int N1 = plan1.size;
 
     // Add a boundary condition to prevent scheduling from causing the
     // algorithms below to reach out of the bounds we promise to define in
@@ -914,6 +1134,7 @@ Func fft2d_c2r(ComplexFunc c,
     const int natural_vector_size = target.natural_vector_size(c.types()[0]);
 
     bool skip_zip = N0 < natural_vector_size * 2;
+    skip_zip = skip_zip || (N0 % 2 != 0) || (N1 % 2 != 0);
 
     ComplexFunc dft;
     Func unzipped(prefix + "unzipped");
@@ -923,7 +1144,7 @@ Func fft2d_c2r(ComplexFunc c,
         ComplexFunc c_extended(prefix + "c_extended");
         c_extended(A({n0, n1}, args)) =
             select(n1 <= (N1 + 1) / 2, c(A({n0, n1}, args)), conj(c(A({(N0 - n0) % N0, (N1 - n1) % N1}, args))));
-        dft = fft2d_c2c(c_extended, R0, R1, 1, target, desc);
+        dft = fft2d_c2c(c_extended, plan0, plan1, 1, target, desc);
         unzipped(A({n0, n1}, args)) = re(dft(A({n0, n1}, args)));
 
         dft.compute_at(unzipped, outer);
@@ -955,7 +1176,7 @@ Func fft2d_c2r(ComplexFunc c,
 
         // Take the inverse DFT of the columns (rows in the final result).
         ComplexFunc dft0T = fft_dim1(cT,
-                                     R0,
+                                     plan0,
                                      1,  // sign
                                      zipped_extent0,
                                      1.0f,
@@ -1010,7 +1231,7 @@ Func fft2d_c2r(ComplexFunc c,
 
         // Take the inverse DFT of the columns again.
         dft = fft_dim1(zipped,
-                       R1,
+                       plan1,
                        1,                            // sign
                        std::min(zip_width, N0 / 2),  // extent of dim 0
                        desc.gain,
@@ -1062,6 +1283,18 @@ Func fft2d_c2r(ComplexFunc c,
 
 namespace {
 
+// Factor N into the given radices, trying them in order. Returns the factor of
+// N that remains.
+int factor(int N, const vector<int> &radices, vector<int> *R) {
+    for (int r : radices) {
+        while (N % r == 0) {
+            R->push_back(r);
+            N /= r;
+        }
+    }
+    return N;
+}
+
 // Compute a factorization of N suitable for use in the FFT.
 vector<int> radix_factor(int N) {
     // Some special cases to optimize.
@@ -1079,14 +1312,8 @@ vector<int> radix_factor(int N) {
     }
 
     // Factor N into factors found in the 'radices' set.
-    static const int radices[] = {8, 6, 4, 2};
     vector<int> R;
-    for (int r : radices) {
-        while (N % r == 0) {
-            R.push_back(r);
-            N /= r;
-        }
-    }
+    N = factor(N, {8, 6, 4, 2, 7, 5, 3}, &R);
 
     // If there are still factors left over, just include them as a radix.
     if (N != 1 || R.empty()) {
@@ -1096,6 +1323,215 @@ vector<int> radix_factor(int N) {
     return R;
 }
 
+// Prime factors up to this size are computed directly as one radix. Sizes
+// with larger prime factors use Bluestein's algorithm.
+const int max_direct_radix = 13;
+
+// FFTs at least this big use the four-step algorithm by default.
+const int min_four_step_size = 2048;
+
+bool is_smooth(int N) {
+    vector<int> R;
+    return factor(N, {2, 3, 5, 7, 11, 13}, &R) == 1;
+}
+
+// The smallest even M >= 2 * N - 1 made of the radices 2, 3 and 5.
+int bluestein_size(int N) {
+    for (int M = 2 * N - 1;; M++) {
+        vector<int> R;
+        if (M % 2 == 0 && factor(M, {2, 3, 5}, &R) == 1) {
+            return M;
+        }
+    }
+}
+
+Fft1dPlan radix_plan(int N, vector<int> R) {
+    Fft1dPlan plan;
+    plan.algorithm = Fft1dPlan::Radix;
+    plan.size = N;
+    plan.radices = std::move(R);
+    return plan;
+}
+
+Fft1dPlan four_step_plan(int N, int N1) {
+    Fft1dPlan plan;
+    plan.algorithm = Fft1dPlan::FourStep;
+    plan.size = N;
+    plan.radices = radix_factor(N1);
+    plan.radices2 = radix_factor(N / N1);
+    return plan;
+}
+
+Fft1dPlan bluestein_plan(int N) {
+    Fft1dPlan plan;
+    plan.algorithm = Fft1dPlan::Bluestein;
+    plan.size = N;
+    plan.radices = radix_factor(bluestein_size(N));
+    return plan;
+}
+
+// The factors of N no bigger than sqrt(N), largest first.
+vector<int> four_step_splits(int N, size_t max_count) {
+    vector<int> splits;
+    for (int N1 = (int)std::sqrt((double)N); N1 >= 4 && splits.size() < max_count; N1--) {
+        if (N % N1 == 0) {
+            splits.push_back(N1);
+        }
+    }
+    return splits;
+}
+
+bool same_plan(const Fft1dPlan &a, const Fft1dPlan &b) {
+    return a.algorithm == b.algorithm && a.size == b.size &&
+           a.radices == b.radices && a.radices2 == b.radices2;
+}
+
+// The plans fft_plan_measure chooses from.
+vector<Fft1dPlan> candidate_plans(int N) {
+    vector<Fft1dPlan> plans;
+    auto add = [&](const Fft1dPlan &plan) {
+        for (const Fft1dPlan &i : plans) {
+            if (same_plan(i, plan)) {
+                return;
+            }
+        }
+        plans.push_back(plan);
+    };
+
+    add(fft_plan_estimate(N));
+    if (is_smooth(N)) {
+        vector<int> R = radix_factor(N);
+        add(radix_plan(N, R));
+        std::reverse(R.begin(), R.end());
+        add(radix_plan(N, R));
+
+        // Prefer the smaller radices.
+        R.clear();
+        int rest = factor(N, {4, 2, 3, 5, 6, 7, 8}, &R);
+        if (rest != 1 || R.empty()) {
+            R.push_back(rest);
+        }
+        add(radix_plan(N, R));
+
+        if (N >= 256) {
+            for (int N1 : four_step_splits(N, 2)) {
+                add(four_step_plan(N, N1));
+            }
+        }
+    }
+    // Radices larger than 8 are computed with a slow generic DFT, so
+    // Bluestein's algorithm might be faster even when N is smooth.
+    const vector<int> R = radix_factor(N);
+    if (*std::max_element(R.begin(), R.end()) > 8) {
+        add(bluestein_plan(N));
+    }
+    return plans;
+}
+
+}  // namespace
+
+std::ostream &operator<<(std::ostream &stream, const Fft1dPlan &plan) {
+    auto print_radices = [&](const vector<int> &R) {
+        for (size_t i = 0; i < R.size(); i++) {
+            stream << (i > 0 ? "x" : "") << R[i];
+        }
+    };
+    switch (plan.algorithm) {
+    case Fft1dPlan::Radix:
+        stream << "radix(";
+        print_radices(plan.radices);
+        break;
+    case Fft1dPlan::FourStep:
+        stream << "four_step(";
+        print_radices(plan.radices);
+        stream << ", ";
+        print_radices(plan.radices2);
+        break;
+    case Fft1dPlan::Bluestein:
+        stream << "bluestein(" << product(plan.radices) << " = ";
+        print_radices(plan.radices);
+        break;
+    }
+    return stream << ")";
+}
+
+Fft1dPlan fft_plan_estimate(int N) {
+    if (N > 1 && !is_smooth(N)) {
+        return bluestein_plan(N);
+    }
+    if (N >= min_four_step_size) {
+        vector<int> splits = four_step_splits(N, 1);
+        if (!splits.empty()) {
+            return four_step_plan(N, splits[0]);
+        }
+    }
+    return radix_plan(N, radix_factor(N));
+}
+
+Fft1dPlan fft_plan_measure(int N, const Target &target) {
+    const Target host = get_host_target();
+    if (target.os != host.os || target.arch != host.arch || target.bits != host.bits) {
+        return fft_plan_estimate(N);
+    }
+
+    static std::mutex mutex;
+    static std::map<std::pair<int, string>, Fft1dPlan> cache;
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto key = std::make_pair(N, target.to_string());
+    auto cached = cache.find(key);
+    if (cached != cache.end()) {
+        return cached->second;
+    }
+
+    vector<Fft1dPlan> candidates = candidate_plans(N);
+    Fft1dPlan best = candidates.front();
+    if (candidates.size() > 1) {
+        // Time a batch of FFTs of the columns of the input, enough to fill a
+        // few vectors.
+        const int columns = 4 * target.natural_vector_size<float>();
+        Buffer<float, 3> input(columns, N, 2);
+        input.fill(0.0f);
+        Var n0("n0"), n1("n1");
+        ComplexFunc in("plan_in");
+        in(n0, n1) = ComplexExpr(input(n0, n1, 0), input(n0, n1, 1));
+
+        // Repeat each sample enough to make the timer resolution and
+        // pipeline overhead insignificant.
+        const int reps = std::max(1, (1 << 20) / (columns * N));
+        double best_time = std::numeric_limits<double>::infinity();
+        for (const Fft1dPlan &plan : candidates) {
+            TwiddleFactorSet twiddle_cache;
+            ComplexFunc dft = fft_dim1(in, plan, -1, columns, 1.0f, false, "plan_", target, &twiddle_cache);
+            // The first realization also JIT compiles the pipeline.
+            Realization result = dft.realize({columns, N}, target);
+
+            double time = std::numeric_limits<double>::infinity();
+            for (int sample = 0; sample < 3; sample++) {
+                auto start = std::chrono::high_resolution_clock::now();
+                for (int rep = 0; rep < reps; rep++) {
+                    dft.realize(result, target);
+                }
+                auto end = std::chrono::high_resolution_clock::now();
+                time = std::min(time, std::chrono::duration<double>(end - start).count());
+            }
+            if (time < best_time) {
+                best_time = time;
+                best = plan;
+            }
+        }
+    }
+
+    cache[key] = best;
+    return best;
+}
+
+namespace {
+
+Fft1dPlan choose_plan(int N, const Target &target, const Fft2dDesc &desc) {
+    return desc.measure ? fft_plan_measure(N, target) : fft_plan_estimate(N);
+}
+
 }  // namespace
 
 ComplexFunc fft2d_c2c(ComplexFunc x,
@@ -1103,19 +1539,19 @@ ComplexFunc fft2d_c2c(ComplexFunc x,
                       int sign,
                       const Target &target,
                       const Fft2dDesc &desc) {
-    return fft2d_c2c(x, radix_factor(N0), radix_factor(N1), sign, target, desc);
+    return fft2d_c2c(x, choose_plan(N0, target, desc), choose_plan(N1, target, desc), sign, target, desc);
 }
 
 ComplexFunc fft2d_r2c(Func r,
                       int N0, int N1,
                       const Target &target,
                       const Fft2dDesc &desc) {
-    return fft2d_r2c(r, radix_factor(N0), radix_factor(N1), target, desc);
+    return fft2d_r2c(r, choose_plan(N0, target, desc), choose_plan(N1, target, desc), target, desc);
 }
 
 Func fft2d_c2r(ComplexFunc c,
                int N0, int N1,
                const Target &target,
                const Fft2dDesc &desc) {
-    return fft2d_c2r(c, radix_factor(N0), radix_factor(N1), target, desc);
+    return fft2d_c2r(c, choose_plan(N0, target, desc), choose_plan(N1, target, desc), target, desc);
 }
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <limits>
+#include <ostream>
 #include <string>
 #include <vector>
 
@@ -36,8 +37,50 @@ struct Fft2dDesc {
 
     // A name to prepend to the name of the Funcs the FFT defines.
     std::string name = "";
+
+    // If true, the overloads below taking sizes choose their plans with
+    // fft_plan_measure instead of fft_plan_estimate.
+    bool measure = false;
+};
+
+// A description of how to compute a 1D FFT of a particular size.
+struct Fft1dPlan {
+    enum Algorithm {
+        // A Stockham FFT with one pass per radix. The product of the radices
+        // is the size of the FFT.
+        Radix,
+        // A four-step FFT of size N = N1 * N2: N2 FFTs of size N1 over
+        // strided subsequences, a twiddle factor multiplication, and N1 FFTs
+        // of size N2. N1 and N2 are the products of radices and radices2.
+        // Each step works on a block much smaller than N, which keeps large
+        // FFTs in cache.
+        FourStep,
+        // Bluestein's algorithm: the DFT is computed as a circular
+        // convolution using FFTs of size M = product(radices) >= 2 * size - 1.
+        // This handles sizes with large prime factors.
+        Bluestein,
+    };
+
+    Algorithm algorithm = Radix;
+    int size = 0;
+    std::vector<int> radices;
+    // The radices of the second step of a four-step FFT.
+    std::vector<int> radices2;
 };
 
+std::ostream &operator<<(std::ostream &stream, const Fft1dPlan &plan);
+
+// Choose a plan for a 1D FFT of size N using heuristics only. This uses
+// radices 2 to 8 when N factors into them, the four-step algorithm for large
+// N, and Bluestein's algorithm when N has a prime factor larger than 13.
+Fft1dPlan fft_plan_estimate(int N);
+
+// Choose a plan for a 1D FFT of size N by compiling and timing a few
+// candidate plans on a batch of FFTs, as FFTW_MEASURE does. Results are
+// cached, so each size is timed once per process and target. If the target
+// can't be run by the JIT on this machine, this is fft_plan_estimate.
+Fft1dPlan fft_plan_measure(int N, const Halide::Target &target);
+
 // Compute the N0 x N1 2D complex DFT of the first 2 dimensions of a complex
 // valued function x. The first 2 dimensions of x should be defined on at least
 // [0, N0) and [0, N1) for dimensions 0, 1, respectively. sign = -1 indicates a
@@ -49,6 +92,9 @@ struct Fft2dDesc {
 ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
                       const Halide::Target &target,
                       const Fft2dDesc &desc = Fft2dDesc());
+ComplexFunc fft2d_c2c(ComplexFunc x, const Fft1dPlan &plan0, const Fft1dPlan &plan1,
+                      int sign, const Halide::Target &target,
+                      const Fft2dDesc &desc = Fft2dDesc());
 
 // Compute the N0 x N1 2D complex DFT of the first 2 dimensions of a real valued
 // function r. The first 2 dimensions of r should be defined on at least [0, N0)
@@ -58,6 +104,9 @@ ComplexFunc fft2d_c2c(ComplexFunc x, int N0, int N1, int sign,
 ComplexFunc fft2d_r2c(Halide::Func r, int N0, int N1,
                       const Halide::Target &target,
                       const Fft2dDesc &desc = Fft2dDesc());
+ComplexFunc fft2d_r2c(Halide::Func r, const Fft1dPlan &plan0, const Fft1dPlan &plan1,
+                      const Halide::Target &target,
+                      const Fft2dDesc &desc = Fft2dDesc());
 
 // Compute the real valued N0 x N1 2D inverse DFT of dimensions 0, 1 of c. Note
 // that the transform domain has dimensions N0 x N1 / 2 + 1 due to the conjugate
@@ -65,5 +114,8 @@ ComplexFunc fft2d_r2c(Halide::Func r, int N0, int N1,
 Halide::Func fft2d_c2r(ComplexFunc c, int N0, int N1,
                        const Halide::Target &target,
                        const Fft2dDesc &desc = Fft2dDesc());
+Halide::Func fft2d_c2r(ComplexFunc c, const Fft1dPlan &plan0, const Fft1dPlan &plan1,
+                       const Halide::Target &target,
+                       const Fft2dDesc &desc = Fft2dDesc());
 
 #endif
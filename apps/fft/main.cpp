@@ -6,6 +6,8 @@
 #include "Halide.h"
 #include <cmath>  // for log2
 #include <cstdio>
+#include <iostream>
+#include <string>
 #include <vector>
 
 #include "fft.h"
@@ -45,6 +47,8 @@ int main(int argc, char **argv) {
     if (argc >= 4) {
         output_dir = argv[3];
     }
+    // Pass "measure" to choose FFT plans by timing them.
+    bool measure = argc >= 5 && std::string(argv[4]) == "measure";
 
     // Generate a random image to convolve with.
     Buffer<float, 2> in(W, H);
@@ -70,6 +74,12 @@ int main(int argc, char **argv) {
     Fft2dDesc fwd_desc;
     Fft2dDesc inv_desc;
     inv_desc.gain = 1.0f / (W * H);
+    fwd_desc.measure = measure;
+    inv_desc.measure = measure;
+
+    Fft1dPlan plan_W = measure ? fft_plan_measure(W, target) : fft_plan_estimate(W);
+    Fft1dPlan plan_H = measure ? fft_plan_measure(H, target) : fft_plan_estimate(H);
+    std::cout << "Plans: " << plan_W << " x " << plan_H << "\n";
 
     Func filtered_c2c;
     {
@@ -110,6 +120,10 @@ int main(int argc, char **argv) {
     Buffer<float, 2> result_c2c = filtered_c2c.realize({W, H}, target);
     Buffer<float, 2> result_r2c = filtered_r2c.realize({W, H}, target);
 
+    // Bluestein's algorithm computes three FFTs and a pair of chirps per
+    // dimension, so it accumulates more rounding error.
+    const bool bluestein = plan_W.algorithm == Fft1dPlan::Bluestein || plan_H.algorithm == Fft1dPlan::Bluestein;
+    const float tolerance = bluestein ? 1e-5f : 1e-6f;
     for (int y = 0; y < H; y++) {
         for (int x = 0; x < W; x++) {
             float correct = 0;
@@ -119,11 +133,11 @@ int main(int argc, char **argv) {
                 }
             }
             correct /= box * box;
-            if (fabs(result_c2c(x, y) - correct) > 1e-6f) {
+            if (fabs(result_c2c(x, y) - correct) > tolerance) {
                 printf("result_c2c(%d, %d) = %f instead of %f\n", x, y, result_c2c(x, y), correct);
                 return -1;
             }
-            if (fabs(result_r2c(x, y) - correct) > 1e-6f) {
+            if (fabs(result_r2c(x, y) - correct) > tolerance) {
                 printf("result_r2c(%d, %d) = %f instead of %f\n", x, y, result_r2c(x, y), correct);
                 return -1;
             }
@@ -12,7 +12,7 @@
 
 namespace hannk {
 
-void run_benchmark(const std::string &filename, const InterpreterOptions &options) {
+void run_benchmark(const std::string &filename, InterpreterOptions options, bool prepared_models, bool profile_json) {
     if (!options.trace) {
         // In trace mode, don't send *anything* to stdout
         std::cout << filename;
@@ -25,6 +25,13 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
         model->dump(std::cout);
     }
 
+    const std::string prepared_filename = filename + ".prepared";
+    const bool load_prepared = prepared_models && std::ifstream(prepared_filename).good();
+    const auto prepare_start = std::chrono::steady_clock::now();
+    if (load_prepared) {
+        options.prepared_model = PreparedModel::load(prepared_filename);
+    }
+
     Interpreter interpreter(std::move(model), options);
     if (!interpreter.prepare()) {
         std::cerr << "hannk::Interpreter::prepare() failed\n";
@@ -32,9 +39,30 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
         exit(-1);
     }
 
+    const std::chrono::duration<double> prepare_time = std::chrono::steady_clock::now() - prepare_start;
+    if (prepared_models && !load_prepared) {
+        if (!interpreter.save_prepared_model(prepared_filename)) {
+            std::cerr << "hannk::Interpreter::save_prepared_model() failed\n";
+            exit(-1);
+        }
+    }
+
     if (!options.trace) {
         auto result = Halide::Tools::benchmark([&]() { interpreter.execute(); });
-        std::cout << ": " << result.wall_time * 1e6 << " us" << std::endl;
+        std::cout << ": " << result.wall_time * 1e6 << " us";
+        if (prepared_models) {
+            std::cout << " (prepare" << (load_prepared ? " from prepared model" : "") << ": "
+                      << prepare_time.count() * 1e6 << " us)";
+        }
+        std::cout << std::endl;
+
+        if (OpProfiler *profiler = interpreter.profiler()) {
+            profiler->report(std::cout);
+            if (profile_json) {
+                std::ofstream json(filename + ".profile.json");
+                profiler->write_json(json);
+            }
+        }
 
         halide_profiler_report(nullptr);
         halide_profiler_reset();
@@ -51,6 +79,8 @@ void run_benchmark(const std::string &filename, const InterpreterOptions &option
 // from other targets where we compile the file into an executable.
 __attribute__((visibility("default"))) int main(int argc, char **argv) {
     hannk::InterpreterOptions options;
+    bool prepared_models = false;
+    bool profile_json = false;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) {
@@ -61,6 +91,31 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
             options.trace = true;
             continue;
         }
+        if (!strncmp(argv[i], "--inter_op_threads=", 19)) {
+            options.inter_op_threads = atoi(argv[i] + 19);
+            continue;
+        }
+        if (!strcmp(argv[i], "--prepared_models")) {
+            prepared_models = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--profile")) {
+            options.profile = true;
+            continue;
+        }
+        if (!strcmp(argv[i], "--profile_json")) {
+            options.profile = true;
+            profile_json = true;
+            continue;
+        }
+        if (!strncmp(argv[i], "--max_threads_per_op=", 21)) {
+            options.max_threads_per_op = atoi(argv[i] + 21);
+            continue;
+        }
+        if (!strncmp(argv[i], "--op_chain_tile_bytes=", 22)) {
+            options.op_chain_tile_bytes = atoi(argv[i] + 22);
+            continue;
+        }
         if (argv[i][0] == '-') {
             HLOG(ERROR) << "Unknown flag: " << argv[i] << ".\n";
             exit(-1);
@@ -76,7 +131,7 @@ __attribute__((visibility("default"))) int main(int argc, char **argv) {
         if (!strncmp(argv[i], "--", 2)) {
             continue;
         }
-        hannk::run_benchmark(argv[i], options);
+        hannk::run_benchmark(argv[i], options, prepared_models, profile_json);
     }
 
     std::cout << "Done!\n";
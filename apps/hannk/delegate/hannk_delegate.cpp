@@ -1,6 +1,8 @@
 #include "delegate/hannk_delegate.h"
 
+#include <algorithm>
 #include <memory>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -431,6 +433,10 @@ public:
                 // TODO: should this be upgraded to a runtime-check-and-return-error?
                 const auto &old_buf = t->buffer();
                 assert(old_buf.size_in_bytes() == tensor.bytes);
+                if (old_buf.data() == tensor.data.data) {
+                    // Still aliasing the same TFLite memory.
+                    return;
+                }
                 // We must reset it every time, as the tensor's data pointer
                 // can vary between calls in some scenatrios.
                 const auto *raw_buf = old_buf.raw_buffer();
@@ -461,18 +467,29 @@ public:
                 TfLiteTensor &tensor = context->tensors[tensor_id];
                 assert(IsDynamicTensor(tensor));
                 const Box b = t->bounds();
-                if (options_.verbosity >= 2) {
-                    HLOG(INFO) << "ResizeTensor " << tensor_id << " to " << b;
-                }
-                TfLiteIntArray *new_size = TfLiteIntArrayCreate((int)b.size());
-                for (size_t i = 0; i < b.size(); i++) {
-                    new_size->data[b.size() - i - 1] = b[i].extent();
+                // If the shape is the same as last time, the TFLite tensor
+                // can be reused as-is; this also saves TFLite from
+                // re-preparing the nodes that consume it.
+                bool same_shape = tensor.data.data != nullptr &&
+                                  tensor.dims != nullptr &&
+                                  tensor.dims->size == (int)b.size();
+                for (size_t i = 0; same_shape && i < b.size(); i++) {
+                    same_shape = tensor.dims->data[b.size() - i - 1] == b[i].extent();
                 }
-                // (Note that ResizeTensor takes ownership of new_size, even if an error is returned.)
-                auto status = context->ResizeTensor(context, &tensor, new_size);
-                if (status != kTfLiteOk) {
-                    context->ReportError(context, "ResizeTensor() failed:", status);
-                    return status;
+                if (!same_shape) {
+                    if (options_.verbosity >= 2) {
+                        HLOG(INFO) << "ResizeTensor " << tensor_id << " to " << b;
+                    }
+                    TfLiteIntArray *new_size = TfLiteIntArrayCreate((int)b.size());
+                    for (size_t i = 0; i < b.size(); i++) {
+                        new_size->data[b.size() - i - 1] = b[i].extent();
+                    }
+                    // (Note that ResizeTensor takes ownership of new_size, even if an error is returned.)
+                    auto status = context->ResizeTensor(context, &tensor, new_size);
+                    if (status != kTfLiteOk) {
+                        context->ReportError(context, "ResizeTensor() failed:", status);
+                        return status;
+                    }
                 }
                 auto buf = t->buffer();
                 assert(tensor.data.data != nullptr);
@@ -1674,6 +1691,134 @@ public:
     }
 };
 
+// A rough estimate of the work a node does: one unit per output element,
+// times the number of multiply-adds per output element for the ops that
+// reduce over a filter. This only needs to be good enough to tell a tiny
+// partition (a lone Reshape, or an Add of a handful of values) from one
+// worth handing to hannk.
+double EstimateNodeCost(TfLiteContext *context, TfLiteNode *node, TfLiteRegistration *registration) {
+    double output_elements = 0;
+    for (int tensor_id : TfLiteIntArrayView(node->outputs)) {
+        if (tensor_id == kTfLiteOptionalTensor) {
+            continue;
+        }
+        const TfLiteTensor &tensor = context->tensors[tensor_id];
+        if (tensor.dims == nullptr) {
+            continue;
+        }
+        double elements = 1;
+        for (int i = 0; i < tensor.dims->size; i++) {
+            elements *= tensor.dims->data[i];
+        }
+        output_elements += elements;
+    }
+
+    // The index of the filter among the inputs, and the dimension of the
+    // filter that corresponds to the output channels.
+    int filter_input = -1, filter_channel_dim = 0;
+    switch (registration->builtin_code) {
+    case kTfLiteBuiltinConv2d:
+    case kTfLiteBuiltinFullyConnected:
+        filter_input = 1;
+        filter_channel_dim = 0;
+        break;
+    case kTfLiteBuiltinDepthwiseConv2d:
+        filter_input = 1;
+        filter_channel_dim = 3;
+        break;
+    case kTfLiteBuiltinLstm:
+        // Close enough: each gate is a fully connected layer.
+        filter_input = 1;
+        filter_channel_dim = 0;
+        break;
+    default:
+        return output_elements;
+    }
+
+    if (filter_input >= node->inputs->size ||
+        node->inputs->data[filter_input] == kTfLiteOptionalTensor) {
+        return output_elements;
+    }
+    const TfLiteTensor &filter = context->tensors[node->inputs->data[filter_input]];
+    if (filter.dims == nullptr || filter_channel_dim >= filter.dims->size ||
+        filter.dims->data[filter_channel_dim] <= 0) {
+        return output_elements;
+    }
+    double filter_elements = 1;
+    for (int i = 0; i < filter.dims->size; i++) {
+        filter_elements *= filter.dims->data[i];
+    }
+    return output_elements * (filter_elements / filter.dims->data[filter_channel_dim]);
+}
+
+// Drop the nodes of any partitions that aren't worth delegating (see
+// HannkDelegateOptions::min_partition_cost and max_partitions) from
+// supported_nodes. Removing a whole partition can't change the shape of
+// any of the others, so a single pass suffices.
+TfLiteStatus PrunePartitions(TfLiteContext *context, const HannkDelegateOptions &options, std::vector<int> &supported_nodes) {
+    TfLiteStatus status;
+
+    TfLiteDelegateParams *partitions = nullptr;
+    int num_partitions = 0;
+    if ((status = context->PreviewDelegatePartitioning(context,
+                                                       BuildTfLiteIntArray(supported_nodes).get(),
+                                                       &partitions,
+                                                       &num_partitions)) != kTfLiteOk) {
+        HLOG(ERROR) << "PreviewDelegatePartitioning failed";
+        return status;
+    }
+
+    std::vector<std::pair<double, int>> costs;
+    for (int i = 0; i < num_partitions; i++) {
+        double cost = 0;
+        for (int node_index : TfLiteIntArrayView(partitions[i].nodes_to_replace)) {
+            TfLiteNode *node;
+            TfLiteRegistration *registration;
+            if ((status = context->GetNodeAndRegistration(context, node_index, &node, &registration)) != kTfLiteOk) {
+                HLOG(ERROR) << "GetNodeAndRegistration failed";
+                return status;
+            }
+            cost += EstimateNodeCost(context, node, registration);
+        }
+        costs.emplace_back(cost, i);
+    }
+    // Most expensive first.
+    std::sort(costs.begin(), costs.end(), [](const std::pair<double, int> &a, const std::pair<double, int> &b) {
+        return a.first > b.first;
+    });
+
+    std::set<int> rejected_nodes;
+    for (size_t i = 0; i < costs.size(); i++) {
+        const double cost = costs[i].first;
+        const TfLiteDelegateParams &partition = partitions[costs[i].second];
+        const bool too_cheap = cost < options.min_partition_cost;
+        const bool too_many = options.max_partitions > 0 && (int)i >= options.max_partitions;
+        if (!too_cheap && !too_many) {
+            continue;
+        }
+        if (options.verbosity >= 1) {
+            HLOG(INFO) << "Leaving a partition of " << partition.nodes_to_replace->size
+                       << " node(s) with estimated cost " << cost << " to TFLite"
+                       << (too_cheap ? " (too cheap)" : " (too many partitions)");
+        }
+        for (int node_index : TfLiteIntArrayView(partition.nodes_to_replace)) {
+            rejected_nodes.insert(node_index);
+        }
+    }
+
+    if (!rejected_nodes.empty()) {
+        std::vector<int> kept_nodes;
+        for (int node_index : supported_nodes) {
+            if (!rejected_nodes.count(node_index)) {
+                kept_nodes.push_back(node_index);
+            }
+        }
+        supported_nodes = std::move(kept_nodes);
+    }
+
+    return kTfLiteOk;
+}
+
 /*static*/ TfLiteStatus HannkDelegate::DelegatePrepare(TfLiteContext *context, TfLiteDelegate *delegate) {
     HannkDelegate *self = (HannkDelegate *)delegate;
     const int verbosity = self->options_.verbosity;
@@ -1717,6 +1862,13 @@ public:
         }
     }
 
+    if (!supported_nodes.empty() &&
+        (self->options_.min_partition_cost > 0 || self->options_.max_partitions > 0)) {
+        if ((status = PrunePartitions(context, self->options_, supported_nodes)) != kTfLiteOk) {
+            return status;
+        }
+    }
+
     if ((status = context->ReplaceNodeSubsetsWithDelegateKernels(context,
                                                                  HannkDelegateKernel::GetRegistration(),
                                                                  BuildTfLiteIntArray(supported_nodes).get(),
@@ -19,9 +19,19 @@ struct TFL_CAPI_EXPORT HannkDelegateOptions {
     // higher numbers may produce additional output
     int verbosity;
 
+    // Partitions of the graph whose estimated cost (roughly, the number
+    // of multiply-adds they do) is below this are left to TFLite, so that
+    // a few unsupported ops don't leave a trail of tiny delegated pieces.
+    // 0 means "delegate every supported node".
+    int min_partition_cost;
+
+    // If > 0, at most this many partitions (the most expensive ones) are
+    // delegated.
+    int max_partitions;
+
 #ifdef __cplusplus
     HannkDelegateOptions()
-        : verbosity(0) {
+        : verbosity(0), min_partition_cost(16384), max_partitions(0) {
     }
 #endif
 };
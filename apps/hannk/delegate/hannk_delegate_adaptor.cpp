@@ -28,6 +28,16 @@ bool ParseOptions(char **options_keys,
                 HLOG(WARNING) << "ParseOptions: malformed option " << options_keys[i] << "\n";
                 return false;
             }
+        } else if (!strcmp(options_keys[i], "min_partition_cost")) {
+            if (!ParseValue(options_values[i], options->min_partition_cost)) {
+                HLOG(WARNING) << "ParseOptions: malformed option " << options_keys[i] << "\n";
+                return false;
+            }
+        } else if (!strcmp(options_keys[i], "max_partitions")) {
+            if (!ParseValue(options_values[i], options->max_partitions)) {
+                HLOG(WARNING) << "ParseOptions: malformed option " << options_keys[i] << "\n";
+                return false;
+            }
         } else {
             HLOG(WARNING) << "ParseOptions: unknown option " << options_keys[i] << "\n";
             return false;
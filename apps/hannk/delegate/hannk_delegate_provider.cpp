@@ -10,12 +10,16 @@ public:
     HannkDelegateProvider() {
         default_params_.AddParam("use_hannk", ToolParam::Create<bool>(false));
         default_params_.AddParam("hannk_verbosity", ToolParam::Create<int>(0));
+        default_params_.AddParam("hannk_min_partition_cost", ToolParam::Create<int>(HannkDelegateOptions().min_partition_cost));
+        default_params_.AddParam("hannk_max_partitions", ToolParam::Create<int>(0));
     }
 
     std::vector<Flag> CreateFlags(ToolParams *params) const final {
         std::vector<Flag> flags = {
             CreateFlag<bool>("use_hannk", params, "use HANNK"),
             CreateFlag<int>("hannk_verbosity", params, "Verbosity of HANNK debug logging"),
+            CreateFlag<int>("hannk_min_partition_cost", params, "Leave partitions cheaper than this to TFLite"),
+            CreateFlag<int>("hannk_max_partitions", params, "Maximum number of partitions to delegate to HANNK (0 = no limit)"),
         };
         return flags;
     }
@@ -23,12 +27,16 @@ public:
     void LogParams(const ToolParams &params, bool verbose) const final {
         LOG_TOOL_PARAM(params, bool, "use_hannk", "Use HANNK", verbose);
         LOG_TOOL_PARAM(params, int, "hannk_verbosity", "HANNK verbosity", verbose);
+        LOG_TOOL_PARAM(params, int, "hannk_min_partition_cost", "HANNK min partition cost", verbose);
+        LOG_TOOL_PARAM(params, int, "hannk_max_partitions", "HANNK max partitions", verbose);
     }
 
     TfLiteDelegatePtr CreateTfLiteDelegate(const ToolParams &params) const final {
         if (params.Get<bool>("use_hannk")) {
             HannkDelegateOptions options = {};
             options.verbosity = params.Get<int32_t>("hannk_verbosity");
+            options.min_partition_cost = params.Get<int32_t>("hannk_min_partition_cost");
+            options.max_partitions = params.Get<int32_t>("hannk_max_partitions");
             if (options.verbosity >= 1) {
                 HLOG(INFO) << "Registrar HannkDelegate: verbosity set to "
                            << options.verbosity << ".";
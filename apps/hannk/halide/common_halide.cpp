@@ -1,4 +1,5 @@
 #include "halide/common_halide.h"
+#include "interpreter/elementwise_program.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -247,4 +248,75 @@ Expr quantize_and_relu_u8(const Expr &x, const Expr &multiplier, const Expr &shi
     }
 }
 
+Func interpret_elementwise_program(const std::vector<Expr> &inputs, const std::vector<Var> &args,
+                                   const ImageParam &program, const Type &intermediate_type,
+                                   int max_instructions) {
+    Type unsigned_intermediate = intermediate_type.with_code(halide_type_uint);
+    const int q = intermediate_type.bits() - (intermediate_type.is_int() ? 1 : 0);
+
+    Var u("u");
+    std::vector<Var> args_u = args;
+    args_u.push_back(u);
+    auto at_slot = [&](Expr slot) {
+        std::vector<Expr> result(args.begin(), args.end());
+        result.push_back(std::move(slot));
+        return result;
+    };
+
+    Func scratch("scratch");
+    scratch(args_u) = undef(intermediate_type);
+
+    // Load the inputs into the scratch memory.
+    const int input_count = inputs.size();
+    for (int i = 0; i < input_count; i++) {
+        scratch(at_slot(-i - 1)) = cast(intermediate_type, inputs[i]);
+    }
+
+    // scratch slot 0 is a constant 0.
+    scratch(at_slot(0)) = cast(intermediate_type, 0);
+
+    RDom r(0, ElementwiseAssembler::OpCodeCount, 0, program.dim(1).extent());
+    Expr op = program(0, r.y);
+    Expr arg1 = program(1, r.y);
+    Expr arg2 = program(2, r.y);
+    Expr arg3 = cast(intermediate_type, program(3, r.y));
+    Expr arg4 = cast(intermediate_type, program(4, r.y));
+
+    Expr slot = r.y + 1;
+
+    const int max_input = input_count - 1;
+    Expr input1 = scratch(at_slot(unsafe_promise_clamped(i32(arg1), -max_input - 1, slot)));
+    Expr input2 = scratch(at_slot(unsafe_promise_clamped(i32(arg2), -max_input - 1, slot)));
+
+    std::vector<Expr> instructions = {
+        scratch(at_slot(slot)),
+        saturating_add(input1, input2 + arg3),
+        saturating_sub(input1, input2 + arg3),
+        saturating_add(multiply_2x_high(input1, input2 + arg3), arg4),
+        rounding_mul_shift_right(input1, input2 + arg3, cast(unsigned_intermediate, arg4)),
+        rounding_shift_right(input1, input2 + arg3),
+        min(input1, input2 + arg3),
+        max(input1, input2 + arg3),
+        clamp(input1, arg3, arg4),
+        rounding_shift_right(approx_logistic(q, input1, input2 + arg3, intermediate_type), q - arg4),
+        rounding_shift_right(approx_tanh(q, input1, input2 + arg3, intermediate_type), q - arg4),
+    };
+    r.where(r.x == op);
+    scratch(at_slot(slot)) = mux(r.x, instructions);
+
+    // Schedule.
+    scratch.update(input_count).unscheduled();  // constant zero
+
+    scratch
+        .bound_extent(u, input_count + max_instructions + 1)
+        .store_in(MemoryType::Register)
+        .update(input_count + 1)
+        .unroll(r.x);
+
+    program.dim(0).set_min(0).set_extent(ElementwiseAssembler::InstructionSize).set_stride(1);
+    program.dim(1).set_min(0).set_stride(ElementwiseAssembler::InstructionSize);
+
+    return scratch;
+}
+
 }  // namespace hannk
@@ -69,6 +69,15 @@ Halide::Expr quantize_i16(const Halide::Expr &x, const Halide::Expr &multiplier,
 Halide::Expr quantize_and_relu_u8(const Halide::Expr &x, const Halide::Expr &multiplier, const Halide::Expr &shift, const Halide::Expr &zero,
                                   const Halide::Expr &min, const Halide::Expr &max, const Halide::Target &target);
 
+// Make a Func that runs an elementwise program (see interpreter/elementwise_program.h)
+// on the given inputs, which are expressions in args. The result is a function of
+// args and a scratch slot u, where slot -i - 1 is input i, slot 0 is the constant 0,
+// and slot k > 0 is the result of instruction k - 1. At most max_instructions
+// instructions are supported, so scratch can be stored in registers.
+Halide::Func interpret_elementwise_program(const std::vector<Halide::Expr> &inputs, const std::vector<Halide::Var> &args,
+                                          const Halide::ImageParam &program, const Halide::Type &intermediate_type,
+                                          int max_instructions);
+
 }  // namespace hannk
 
 #endif  // HANNK_COMMON_HALIDE_H
@@ -13,6 +13,16 @@ constexpr int mul_input_shift = 6;
 
 constexpr int softmax_input_shift = 6;
 
+// The maximum number of instructions in an elementwise program fused
+// into the output of a convolution.
+constexpr int max_output_program_size = 8;
+
+// The shape of the blocks of a block sparse fully connected filter: the
+// number of input channels reduced by each dot product instruction, by the
+// number of output channels that share the same pattern of blocks.
+constexpr int sparse_block_channels = 4;
+constexpr int sparse_block_outputs = 16;
+
 }  // namespace hannk
 
 #endif  // HANNK_CONSTANTS_H
@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
+#include "halide/constants.h"
 
 using namespace Halide;
 using namespace Halide::BoundaryConditions;
@@ -42,6 +43,12 @@ public:
     // to load vectors, so making this value larger helps for big reductions.
     GeneratorParam<int> unroll_reduction_{"unroll_reduction", 4};
 
+    // When true, the quantized 16-bit result of the convolution is not written
+    // to the output directly. Instead, it is input 0 of an elementwise program
+    // (see interpreter/elementwise_program.h), and elementwise_input is input 1.
+    // The result of the program is saturated to 8 bits and written to the output.
+    GeneratorParam<bool> elementwise_{"elementwise", false};
+
     // Unsigned 8-bit input tensor, indexed by c, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -72,12 +79,20 @@ public:
 
     Output<Buffer<void, 4>> output_{"output"};
 
+    // Only present when elementwise is true.
+    GeneratorInput<Buffer<uint8_t, 4>> *elementwise_input_ = nullptr;
+    GeneratorInput<Buffer<int16_t, 2>> *program_ = nullptr;
+
     void configure() {
         if (use_8bit_multiply(target)) {
             filter_.set_type(UInt(8));
         } else {
             filter_.set_type(Int(16));
         }
+        if (elementwise_) {
+            elementwise_input_ = add_input<Buffer<uint8_t, 4>>("elementwise_input");
+            program_ = add_input<Buffer<int16_t, 2>>("program");
+        }
     }
 
     void generate() {
@@ -150,7 +165,12 @@ public:
 
         // Saturate and narrow the output.
         Expr output;
-        if (output_.type() == halide_type_of<uint8_t>()) {
+        if (elementwise_) {
+            Expr convolved_i16 = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
+            Func program = interpret_elementwise_program({convolved_i16, (*elementwise_input_)(c, x, y, b)},
+                                                         {c, x, y, b}, *program_, Int(16), max_output_program_size);
+            output = u8_sat(program(c, x, y, b, program_->dim(1).extent()));
+        } else if (output_.type() == halide_type_of<uint8_t>()) {
             output = quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_, output_zero_,
                                           output_min_, output_max_, target);
         } else {
@@ -164,6 +184,9 @@ public:
         interpret_as_tensor(output_);
         require_same_min_extent(3, input_, output_);
         require_same_min_extent(0, bias_, output_);
+        if (elementwise_) {
+            interpret_as_tensor(*elementwise_input_);
+        }
 
         const int filter_alignment = vector_reduction * accum_vector_size;
         filter_.set_host_alignment(filter_alignment * filter_.type().bytes());
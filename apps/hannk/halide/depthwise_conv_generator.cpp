@@ -1,5 +1,6 @@
 #include "Halide.h"
 #include "halide/common_halide.h"
+#include "halide/constants.h"
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -19,6 +20,12 @@ public:
     // x of the input, instead of the x dimension of the buffer.
     GeneratorParam<bool> shallow_{"shallow", false};
 
+    // When true, the quantized 16-bit result of the convolution is input 0 of
+    // an elementwise program (see interpreter/elementwise_program.h), and
+    // elementwise_input is input 1. The result of the program is saturated to
+    // 8 bits and written to the output. This is not supported with shallow.
+    GeneratorParam<bool> elementwise_{"elementwise", false};
+
     // Unsigned 8-bit input tensor, indexed by ci, x, y, b.
     Input<Buffer<uint8_t, 4>> input_{"input"};
     Input<uint8_t> input_zero_{"input_zero"};
@@ -53,6 +60,17 @@ public:
 
     Output<Buffer<uint8_t, 4>> output_{"output"};
 
+    // Only present when elementwise is true.
+    GeneratorInput<Buffer<uint8_t, 4>> *elementwise_input_ = nullptr;
+    GeneratorInput<Buffer<int16_t, 2>> *program_ = nullptr;
+
+    void configure() {
+        if (elementwise_) {
+            elementwise_input_ = add_input<Buffer<uint8_t, 4>>("elementwise_input");
+            program_ = add_input<Buffer<int16_t, 2>>("program");
+        }
+    }
+
     void generate() {
         // The algorithm.
 
@@ -130,9 +148,17 @@ public:
         convolved(c, x, y, b) = offset_c(filter_c);
         convolved(c, x, y, b) += i32(filter_zeroed_rdxy) * i32(input_rdxy);
 
-        output_(c, x, y, b) =
-            quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_,
-                                 output_zero_, output_min_, output_max_, target);
+        if (elementwise_) {
+            assert(!shallow_);
+            Expr convolved_i16 = quantize_i16(convolved(c, x, y, b), output_multiplier_, output_shift_, target);
+            Func program = interpret_elementwise_program({convolved_i16, (*elementwise_input_)(c, x, y, b)},
+                                                         {c, x, y, b}, *program_, Int(16), max_output_program_size);
+            output_(c, x, y, b) = u8_sat(program(c, x, y, b, program_->dim(1).extent()));
+        } else {
+            output_(c, x, y, b) =
+                quantize_and_relu_u8(convolved(c, x, y, b), output_multiplier_, output_shift_,
+                                     output_zero_, output_min_, output_max_, target);
+        }
 
         // Schedule.
         interpret_as_tensor(input_);
@@ -147,6 +173,9 @@ public:
             require_same_min_extent(0, output_, bias_);
             require_same_min_extent(0, output_, filter_);
         }
+        if (elementwise_) {
+            interpret_as_tensor(*elementwise_input_);
+        }
 
         if (inv_depth_multiplier_ == 0) {
             // When we're broadcasting input channels, require that the input has only
@@ -0,0 +1,325 @@
+#include "Halide.h"
+#include "halide/common_halide.h"
+#include "halide/constants.h"
+
+using namespace Halide;
+using namespace Halide::ConciseCasts;
+
+namespace hannk {
+
+Var c("c"), co("co"), b("b");
+
+// vpdpbusd (VNNI) multiplies unsigned 8-bit values by signed 8-bit values.
+bool has_vnni(const Target &target) {
+    return target.arch == Target::X86 &&
+           (target.has_feature(Target::AVX512_VNNI) || target.has_feature(Target::AVXVNNI));
+}
+
+// How many 8-bit products the target can add to each lane of a 32-bit
+// accumulator in one instruction. Targets with dot product instructions
+// (udot/sdot on ARM, vpdpbusd on x86, vrmpy on Hexagon) can do 4, most
+// other targets can do 2 with widening multiply-adds (e.g. pmaddwd).
+int get_dot_product_factor(const Target &target) {
+    if (target.arch == Target::Hexagon ||
+        target.has_feature(Target::ARMDotProd) ||
+        has_vnni(target)) {
+        return 4;
+    }
+    return 2;
+}
+
+// A matrix-vector (or small matrix-matrix) product for fully connected
+// layers. Unlike Conv, the filter is used in the layout it has in the model,
+// each output channel is reduced with vectors along the input channels.
+// This doesn't require tiling the filter or padding the input, and reads
+// the filter exactly once for the (typical) batch of 1.
+class FullyConnected : public Generator<FullyConnected> {
+public:
+    // 8-bit input tensor, indexed by c, b.
+    Input<Buffer<void, 2>> input_{"input"};
+    Input<int32_t> input_zero_{"input_zero"};
+
+    // 8-bit filter coefficients of the same type as the input, indexed by
+    // c, co.
+    Input<Buffer<void, 2>> filter_{"filter"};
+    Input<int32_t> filter_zero_{"filter_zero"};
+    // The sum of the filter coefficients over c, for each co. This is
+    // needed to subtract the zero point of the input.
+    Input<Buffer<int32_t, 1>> filter_sums_{"filter_sums"};
+
+    // A 1D array of 32-bit biases, indexed by co.
+    Input<Buffer<int32_t, 1>> bias_{"bias"};
+
+    // The multiplier and shift are indexed by co, to support filters
+    // quantized per channel.
+    Input<Buffer<int32_t, 1>> output_multiplier_{"output_multiplier"};
+    Input<Buffer<int32_t, 1>> output_shift_{"output_shift"};
+    Input<int32_t> output_zero_{"output_zero"};
+    Input<int32_t> output_min_{"output_min"};
+    Input<int32_t> output_max_{"output_max"};
+
+    // 8-bit output tensor, indexed by co, b.
+    Output<Buffer<void, 2>> output_{"output"};
+
+    void generate() {
+        // The algorithm.
+
+        // vpdpbusd needs the input to be unsigned, and the filter to be
+        // signed. Flipping the sign bit of either of them offsets it by 128,
+        // which is removed along with the zero points below.
+        Expr input_cb = input_(c, b);
+        Expr filter_cco = filter_(c, co);
+        int input_offset = 0;
+        int filter_offset = 0;
+        if (has_vnni(target)) {
+            if (input_.type().is_int()) {
+                input_cb = reinterpret(UInt(8), input_cb) ^ u8(0x80);
+                input_offset = 128;
+            }
+            if (filter_.type().is_uint()) {
+                filter_cco = reinterpret(Int(8), filter_cco ^ u8(0x80));
+                filter_offset = -128;
+            }
+        }
+        Func input("input_wrapper");
+        Func filter("filter_wrapper");
+        input(c, b) = input_cb;
+        filter(c, co) = filter_cco;
+
+        const int vector_reduction = get_dot_product_factor(target);
+        const int accum_vector_size = natural_vector_size<int32_t>();
+        const int block_size = vector_reduction * accum_vector_size;
+
+        // Reduce most of the channels in blocks of one vector of each of
+        // the inputs, into accum_vector_size partial sums of each output.
+        Expr depth = input_.dim(0).extent();
+        Expr block_count = depth / block_size;
+        RDom rb(0, block_count, 0, vector_reduction, "rb");
+        Var u("u");
+        Expr rc = rb.x * block_size + u * vector_reduction + rb.y;
+        Func partial("partial");
+        partial(u, co, b) += i32(filter(rc, co)) * i32(input(rc, b));
+
+        // Add up the partial sums, and the channels that don't fill a block.
+        RDom ru(0, accum_vector_size, "ru");
+        RDom rt(block_count * block_size, depth - block_count * block_size, "rt");
+        Func dot("dot");
+        dot(co, b) += partial(ru, co, b);
+        dot(co, b) += i32(filter(rt, co)) * i32(input(rt, b));
+
+        RDom rs(0, depth, "rs");
+        Func sum_input("sum_input");
+        sum_input(b) += i32(input(rs, b));
+
+        // dot is the sum of a * w, where a = input + input_offset and
+        // w = filter + filter_offset. We want the sum of
+        // (a - a_zero) * (w - w_zero), which expands to:
+        // sum(a * w) - a_zero * sum(w) - w_zero * sum(a) + depth * a_zero * w_zero.
+        Expr a_zero = input_zero_ + input_offset;
+        Expr w_zero = filter_zero_ + filter_offset;
+        Expr sum_filter = filter_sums_(co) + depth * filter_offset;
+        Expr offset_c = bias_(co) - a_zero * sum_filter + depth * a_zero * w_zero;
+        Expr accum = dot(co, b) + offset_c - w_zero * sum_input(b);
+
+        Expr output = quantize_i16(accum, output_multiplier_(co), output_shift_(co), target);
+        output = saturating_add(output, i16(output_zero_));
+        output = clamp(output, i16(output_min_), i16(output_max_));
+        output_(co, b) = saturating_cast(output_.type(), output);
+
+        // Schedule.
+        interpret_as_tensor(input_);
+        interpret_as_tensor(filter_);
+        interpret_as_tensor(output_);
+        require_same_min_extent(0, input_, filter_);
+        require_same_min_extent(1, input_, output_);
+        filter_.dim(1).set_min(0);
+        filter_.dim(1).set_extent(output_.dim(0).extent());
+        filter_sums_.dim(0).set_min(0);
+        bias_.dim(0).set_min(0);
+        output_multiplier_.dim(0).set_min(0);
+        output_shift_.dim(0).set_min(0);
+
+        // Each inner iteration of the reduction loads co_tile vectors of the
+        // filter and b_tile vectors of the input, and computes co_tile * b_tile
+        // dot products. Batches of 1 are memory bound on the filter, so we
+        // just want enough accumulators to hide the latency. For bigger
+        // batches, computing several batches at once reuses the filter
+        // from registers.
+        const int accumulators = get_register_count(target) >= 32 ? 16 : 8;
+        Expr output_channels = output_.dim(0).extent();
+        Expr batches = output_.dim(1).extent();
+        Var coi("coi"), bi("bi");
+        for (int b_tile : {4, 2, 1}) {
+            const int co_tile = accumulators / b_tile;
+            output_.specialize(batches >= b_tile && output_channels >= co_tile)
+                .split(co, co, coi, co_tile, TailStrategy::ShiftInwards)
+                .split(b, b, bi, b_tile, TailStrategy::ShiftInwards)
+                .reorder(coi, bi, co, b)
+                .vectorize(coi)
+                .unroll(bi);
+        }
+        // Tiny outputs.
+        output_
+            .split(co, co, coi, 1)
+            .split(b, b, bi, 1)
+            .reorder(coi, bi, co, b);
+
+        sum_input.compute_at(output_, b);
+        RVar rso("rso"), rsi("rsi");
+        sum_input.update()
+            .split(rs.x, rso, rsi, block_size)
+            .atomic()
+            .vectorize(rsi);
+
+        dot.compute_at(output_, co)
+            .unroll(co)
+            .unroll(b);
+        dot.update(0)
+            .reorder(ru, co, b)
+            .atomic()
+            .vectorize(ru)
+            .unroll(co)
+            .unroll(b);
+        dot.update(1)
+            .reorder(co, b, rt)
+            .unroll(co)
+            .unroll(b);
+
+        partial.compute_at(output_, co)
+            .vectorize(u)
+            .unroll(co)
+            .unroll(b);
+        partial.update()
+            .reorder(rb.y, u, co, b, rb.x)
+            .vectorize(u)
+            .unroll(co)
+            .unroll(b)
+            .atomic()
+            .vectorize(rb.y);
+    }
+};
+
+// A fully connected layer with a block sparse filter. The filter is divided
+// into blocks of sparse_block_channels input channels by sparse_block_outputs
+// output channels, and only the blocks that have a non-zero coefficient are
+// stored (see FullyConnectedOp). Each block is a dot product of a vector of
+// the filter with sparse_block_channels values of the input broadcast to every
+// lane, which maps to sdot/udot (by element) on ARM, vpdpbusd on x86, and
+// vrmpy on Hexagon.
+class FullyConnectedSparse : public Generator<FullyConnectedSparse> {
+public:
+    // 8-bit input tensor, indexed by c, b.
+    Input<Buffer<void, 2>> input_{"input"};
+    Input<int32_t> input_zero_{"input_zero"};
+
+    // The non-zero blocks of the filter, with the zero point of the filter
+    // subtracted, indexed by the channel in the block, the output channel in
+    // the block, the index of the block, and the group of output channels.
+    Input<Buffer<int8_t, 4>> filter_{"filter"};
+    // The first input channel of each block, indexed by the index of the
+    // block and the group of output channels.
+    Input<Buffer<int32_t, 2>> block_offsets_{"block_offsets"};
+    // The number of non-zero blocks in each group of output channels.
+    Input<Buffer<int32_t, 1>> block_counts_{"block_counts"};
+    // The sum of the filter coefficients (with the zero point subtracted)
+    // over c, for each co.
+    Input<Buffer<int32_t, 1>> filter_sums_{"filter_sums"};
+
+    // A 1D array of 32-bit biases, indexed by co.
+    Input<Buffer<int32_t, 1>> bias_{"bias"};
+
+    Input<Buffer<int32_t, 1>> output_multiplier_{"output_multiplier"};
+    Input<Buffer<int32_t, 1>> output_shift_{"output_shift"};
+    Input<int32_t> output_zero_{"output_zero"};
+    Input<int32_t> output_min_{"output_min"};
+    Input<int32_t> output_max_{"output_max"};
+
+    // 8-bit output tensor, indexed by co, b.
+    Output<Buffer<void, 2>> output_{"output"};
+
+    void generate() {
+        // The algorithm.
+
+        // The filter is signed. ARM's dot products need the input to have
+        // the same sign, and vpdpbusd needs it to be unsigned. Flipping the
+        // sign bit of the input offsets it by 128, which is removed along
+        // with the zero point below.
+        Expr input_cb = input_(c, b);
+        int input_offset = 0;
+        if (get_target().arch == Target::ARM && input_.type().is_uint()) {
+            input_cb = reinterpret(Int(8), input_cb ^ u8(0x80));
+            input_offset = 128;
+        } else if (has_vnni(target) && input_.type().is_int()) {
+            input_cb = reinterpret(UInt(8), input_cb) ^ u8(0x80);
+            input_offset = -128;
+        }
+        Func input("input_wrapper");
+        input(c, b) = input_cb;
+
+        const int G = sparse_block_outputs;
+        Expr depth = input_.dim(0).extent();
+        Expr max_blocks = filter_.dim(2).extent();
+
+        // Add up the products of each non-zero block. The last block may
+        // extend past the input channels; its filter is zero there.
+        Var coi("coi"), g("g");
+        RDom r(0, sparse_block_channels, 0, max_blocks, "r");
+        r.where(r.y < block_counts_(g));
+        Expr rc = min(block_offsets_(r.y, g) + r.x, depth - 1);
+        Func dot("dot");
+        dot(coi, g, b) += i32(filter_(r.x, coi, r.y, g)) * i32(input(rc, b));
+
+        // The filter has the zero point subtracted, so the zero point of the
+        // input only needs the sum of the filter:
+        // sum((a - a_zero) * w) = sum(a * w) - a_zero * sum(w).
+        Expr a_zero = input_zero_ + input_offset;
+        Expr accum = dot(co % G, co / G, b) + bias_(co) - a_zero * filter_sums_(co);
+
+        Expr output = quantize_i16(accum, output_multiplier_(co), output_shift_(co), target);
+        output = saturating_add(output, i16(output_zero_));
+        output = clamp(output, i16(output_min_), i16(output_max_));
+        output_(co, b) = saturating_cast(output_.type(), output);
+
+        // Schedule.
+        interpret_as_tensor(input_);
+        interpret_as_tensor(output_);
+        require_same_min_extent(1, input_, output_);
+        input_.dim(0).set_min(0);
+        filter_.dim(0).set_bounds(0, sparse_block_channels);
+        filter_.dim(1).set_bounds(0, G);
+        filter_.dim(2).set_min(0);
+        filter_.dim(3).set_min(0);
+        block_offsets_.dim(0).set_min(0);
+        block_offsets_.dim(1).set_min(0);
+        block_counts_.dim(0).set_min(0);
+        filter_sums_.dim(0).set_min(0);
+        bias_.dim(0).set_min(0);
+        output_.dim(0).set_min(0);
+        output_multiplier_.dim(0).set_min(0);
+        output_shift_.dim(0).set_min(0);
+
+        // Compute one group of output channels at a time, for every batch.
+        Expr output_channels = output_.dim(0).extent();
+        Var coo("coo");
+        output_.specialize(output_channels >= G)
+            .split(co, coo, coi, G, TailStrategy::ShiftInwards)
+            .reorder(coi, b, coo)
+            .vectorize(coi);
+        output_
+            .split(co, coo, coi, 1)
+            .reorder(coi, b, coo);
+
+        dot.compute_at(output_, coo)
+            .vectorize(coi);
+        dot.update()
+            .reorder(r.x, coi, r.y, g, b)
+            .atomic()
+            .vectorize(r.x)
+            .vectorize(coi);
+    }
+};
+
+}  // namespace hannk
+
+HALIDE_REGISTER_GENERATOR(hannk::FullyConnected, FullyConnected)
+HALIDE_REGISTER_GENERATOR(hannk::FullyConnectedSparse, FullyConnectedSparse)
@@ -1,12 +1,17 @@
 #include "interpreter/interpreter.h"
 #include "interpreter/allocation_planner.h"
+#include "interpreter/op_scheduler.h"
 #include "interpreter/transforms.h"
 #include "util/error_util.h"
 
 #include "HalideRuntime.h"
 
+#include <algorithm>
+#include <chrono>
 #include <map>
 #include <set>
+#include <thread>
+#include <unordered_map>
 #include <unordered_set>
 
 // TODO: apparently not part of the public Halide API. Should it be?
@@ -89,7 +94,57 @@ public:
     std::map<TensorStoragePtr, TensorAllocationInfo> tensor_info;
 };
 
-std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOptions &options) {
+size_t arena_alignment() {
+    // Let's assume that whatever alignment halide_malloc() needs is necessary here, too.
+    // (Note that TFLite will complain if alignment is less than 64...)
+    constexpr int kTfLiteDefaultTensorAlignment = 64;
+    return (size_t)std::max(halide_malloc_alignment(), kTfLiteDefaultTensorAlignment);
+}
+
+// Return the key to save the placement of the storage shared by the given
+// Tensors in a PreparedModel.
+std::string block_key(const std::set<TensorPtr> &tensors) {
+    std::string key;
+    for (const TensorPtr &t : tensors) {
+        if (key.empty() || t->name() < key) {
+            key = t->name();
+        }
+    }
+    return key;
+}
+
+// Use the allocation plan saved in a PreparedModel, if it describes
+// exactly the same blocks (with the same lifetimes) as we're planning.
+bool use_prepared_plan(const PreparedModel *prepared, size_t alignment,
+                       std::map<TensorStoragePtr, TensorAllocationInfo> &tensor_info,
+                       std::vector<PreparedModel::Block> &plan) {
+    const std::vector<PreparedModel::Block> *blocks = prepared ? prepared->blocks(alignment) : nullptr;
+    if (!blocks || blocks->size() != tensor_info.size()) {
+        return false;
+    }
+    std::unordered_map<std::string, const PreparedModel::Block *> by_key;
+    for (const auto &b : *blocks) {
+        by_key[b.key] = &b;
+    }
+    std::vector<PreparedModel::Block> result;
+    for (const auto &it : tensor_info) {
+        const auto &info = it.second;
+        auto b = by_key.find(block_key(info.tensors));
+        if (b == by_key.end() ||
+            b->second->size != info.size_needed ||
+            b->second->first_use != info.first_use ||
+            b->second->last_use != info.last_use) {
+            return false;
+        }
+        result.push_back(*b->second);
+    }
+    plan = std::move(result);
+    return true;
+}
+
+TensorArena::Allocation allocate_tensors(const Op *root, const InterpreterOptions &options,
+                                         std::vector<PreparedModel::Block> &plan, size_t &memory_needed,
+                                         std::vector<TensorArena::Placement> &placements) {
     // Find the tensors that we want to allocate in an arena,
     // along the needed storage size and lifetime for each.
     FindAllocatableTensors find_tensors;
@@ -106,51 +161,65 @@ std::unique_ptr<char[]> allocate_tensors(const Op *root, const InterpreterOption
     }
 
     // Feed this info to the allocation planner.
-    // Let's assume that whatever alignment halide_malloc() needs is necessary here, too.
-    // (Note that TFLite will complain if alignment is less than 64...)
-    constexpr int kTfLiteDefaultTensorAlignment = 64;
-    const size_t alignment = (size_t)std::max(halide_malloc_alignment(), kTfLiteDefaultTensorAlignment);
-    AllocationPlanner planner(alignment);
-    for (auto &it : find_tensors.tensor_info) {
-        auto &info = it.second;
-        info.block_index = planner.add_block(info.size_needed, info.first_use, info.last_use);
-        assert(info.block_index >= 0);
-    }
-    planner.commit();
-
-    if (options.verbosity >= 1) {
-        std::ostringstream oss;
-        oss << "Arena memory needed: " << planner.memory_needed() << '\n';
-        oss << "    Offsets:";
-        for (int i = 0; i < planner.block_count(); i++) {
-            oss << ' ' << planner.get_block_offset(i);
+    const size_t alignment = arena_alignment();
+    plan.clear();
+    if (use_prepared_plan(options.prepared_model.get(), alignment, find_tensors.tensor_info, plan)) {
+        memory_needed = options.prepared_model->arena_size();
+        if (options.verbosity >= 1) {
+            HLOG(INFO) << "Arena memory needed (from prepared model): " << memory_needed;
         }
-        if (options.verbosity >= 2) {
-            oss << "\nUsage Map:\n";
-            planner.dump(oss);
+    } else {
+        AllocationPlanner planner(alignment);
+        for (auto &it : find_tensors.tensor_info) {
+            auto &info = it.second;
+            info.block_index = planner.add_block(info.size_needed, info.first_use, info.last_use);
+            assert(info.block_index >= 0);
+        }
+        planner.commit();
+
+        if (options.verbosity >= 1) {
+            std::ostringstream oss;
+            oss << "Arena memory needed: " << planner.memory_needed() << '\n';
+            oss << "    Offsets:";
+            for (int i = 0; i < planner.block_count(); i++) {
+                oss << ' ' << planner.get_block_offset(i);
+            }
+            if (options.verbosity >= 2) {
+                oss << "\nUsage Map:\n";
+                planner.dump(oss);
+            }
+            HLOG(INFO) << oss.str();
         }
-        HLOG(INFO) << oss.str();
-    }
-
-    // Allocate the chunk we need. Be sure to over-allocate for alignment.
-    std::unique_ptr<char[]> arena(new char[planner.memory_needed() + alignment]);
-    assert(arena != nullptr);
-
-    // Point all the tensors at the correct offsets.
-    char *arena_base = arena.get();
 
-    // Make sure that the 'base' we start from is aligned.
-    arena_base = (char *)(((uintptr_t)arena_base + alignment - 1) & ~(alignment - 1));
+        memory_needed = planner.memory_needed();
+        for (const auto &it : find_tensors.tensor_info) {
+            const auto &info = it.second;
+            plan.push_back({block_key(info.tensors), info.size_needed, info.first_use, info.last_use,
+                            planner.get_block_offset(info.block_index)});
+        }
+    }
 
+    // Point all the tensors at the correct offsets in the arena
+    // (which will grow if it's shared, and too small for us).
+    placements.clear();
+    size_t block = 0;
     for (const auto &it : find_tensors.tensor_info) {
         const auto &info = it.second;
-        char *new_host = arena_base + planner.get_block_offset(info.block_index);
-        for (const auto &t : info.tensors) {
-            t->allocate_from_arena_pointer(new_host);
-        }
+        placements.push_back({plan[block++].offset,
+                              std::vector<TensorPtr>(info.tensors.begin(), info.tensors.end())});
     }
 
-    return arena;
+    std::shared_ptr<TensorArena> arena = options.arena;
+    if (!arena) {
+        arena = std::make_shared<TensorArena>();
+    }
+    const int id = arena->add(memory_needed, alignment, placements);
+
+    if (options.verbosity >= 1 && options.arena) {
+        HLOG(INFO) << "Shared arena size: " << arena->memory_size();
+    }
+
+    return TensorArena::Allocation(std::move(arena), id);
 }
 
 class VerifyAllAllocated : public TensorVisitor {
@@ -246,6 +315,14 @@ bool Interpreter::prepare() {
 
     dump_model("Model after prepare():", 3);
 
+    model_ = fuse_conv_elementwise(std::move(model_));
+    if (!model_) {
+        HLOG(ERROR) << "fuse_conv_elementwise() failed.";
+        return false;
+    }
+    model_ = remove_dead_ops(std::move(model_));
+    dump_model("Model after fuse_conv_elementwise():", 3);
+
     model_ = pad_for_ops(std::move(model_));
     if (!model_) {
         HLOG(ERROR) << "pad_for_ops() failed.";
@@ -253,21 +330,33 @@ bool Interpreter::prepare() {
     }
     dump_model("Model after pad_for_ops():", 3);
 
-    model_ = in_place(std::move(model_));
-    dump_model("Model after in_place():", 3);
+    if (options_.op_chain_tile_bytes > 0) {
+        model_ = tile_op_chains(std::move(model_), options_.op_chain_tile_bytes);
+        dump_model("Model after tile_op_chains():", 3);
+    }
+
+    // Aliasing Tensors depends on their shapes, so don't do it if the
+    // shapes may change.
+    if (!options_.dynamic_shapes) {
+        model_ = in_place(std::move(model_));
+        dump_model("Model after in_place():", 3);
+    }
 
-    model_ = fold_constants(std::move(model_));
+    model_ = fold_constants(std::move(model_), options_.prepared_model.get(), &folded_constants_);
     dump_model("Model after fold_constants():", 3);
 
     model_ = flatten_groups(std::move(model_));
     dump_model("Model after flatten_groups:", 3);
 
-    model_ = fuse_pad_ops(std::move(model_));
-    if (!model_) {
-        HLOG(ERROR) << "fuse_pad_ops() failed.";
-        return false;
+    // Fusing pads loses track of which pads depend on the shapes of their inputs.
+    if (!options_.dynamic_shapes) {
+        model_ = fuse_pad_ops(std::move(model_));
+        if (!model_) {
+            HLOG(ERROR) << "fuse_pad_ops() failed.";
+            return false;
+        }
+        dump_model("Model after fuse_pad_ops:", 3);
     }
-    dump_model("Model after fuse_pad_ops:", 3);
 
     model_ = remove_dead_ops(std::move(model_));
     dump_model("Model after remove_dead_ops:", 3);
@@ -275,8 +364,15 @@ bool Interpreter::prepare() {
 #ifndef NDEBUG
     do_check_op_order(model_.get());
 #endif
-    assert(tensor_storage_arena_ == nullptr);
-    tensor_storage_arena_ = allocate_tensors(model_.get(), options_);
+    assert(tensor_allocation_.arena() == nullptr);
+    tensor_allocation_ = allocate_tensors(model_.get(), options_, allocation_plan_, arena_size_, placements_);
+    if (options_.dynamic_shapes) {
+        std::vector<size_t> offsets;
+        for (const auto &p : placements_) {
+            offsets.push_back(p.offset);
+        }
+        arena_layouts_[shape_key(model_->inputs())] = {arena_size_, std::move(offsets)};
+    }
 
 #ifndef NDEBUG
     VerifyAllAllocated verify_all;
@@ -285,6 +381,26 @@ bool Interpreter::prepare() {
 
     dump_model("Model after all transformations:", 2);
 
+    if (options_.inter_op_threads != 1) {
+        HCHECK(options_.inter_op_threads >= 0);
+        int num_threads = options_.inter_op_threads;
+        if (num_threads == 0) {
+            num_threads = std::max(1, (int)std::thread::hardware_concurrency());
+        }
+        OpGroup *root = dynamic_cast<OpGroup *>(model_.get());
+        HCHECK(root) << "Expected the model to be an OpGroup after flatten_groups().";
+        scheduler_ = std::make_unique<OpScheduler>(root, num_threads, options_.max_threads_per_op);
+    }
+
+    if (options_.profile) {
+        OpGroup *root = dynamic_cast<OpGroup *>(model_.get());
+        HCHECK(root) << "Expected the model to be an OpGroup after flatten_groups().";
+        profiler_ = std::make_unique<OpProfiler>(root);
+        if (scheduler_) {
+            scheduler_->set_profiler(profiler_.get());
+        }
+    }
+
     prepared_ = true;
     return true;
 }
@@ -294,7 +410,153 @@ void Interpreter::execute() {
         HLOG(ERROR) << "Must call prepare() before execute()";
         return;
     }
-    model_->execute();
+    tensor_allocation_.arena()->begin_execution();
+    if (scheduler_) {
+        scheduler_->execute();
+    } else if (profiler_) {
+        OpGroup *root = static_cast<OpGroup *>(model_.get());
+        for (int i = 0; i < root->op_count(); i++) {
+            const auto start = std::chrono::steady_clock::now();
+            root->op(i)->execute();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            profiler_->record(i, elapsed.count());
+        }
+    } else {
+        model_->execute();
+    }
+    if (profiler_) {
+        profiler_->end_execution();
+    }
+    tensor_allocation_.arena()->end_execution();
+}
+
+/*static*/ std::vector<int> Interpreter::shape_key(const std::vector<TensorPtr> &tensors) {
+    std::vector<int> key;
+    for (const TensorPtr &t : tensors) {
+        key.push_back(t->rank());
+        for (int d = 0; d < t->rank(); d++) {
+            key.push_back(t->bounds(d).min);
+            key.push_back(t->extent(d));
+        }
+    }
+    return key;
+}
+
+bool Interpreter::resize_tensors(const std::vector<Box> &shapes) {
+    for (int i = 0; i < model_->input_count(); i++) {
+        const TensorPtr &t = model_->input(i);
+        const Box old_shape = t->bounds();
+        if (old_shape.size() == shapes[i].size() &&
+            std::equal(old_shape.begin(), old_shape.end(), shapes[i].begin())) {
+            continue;
+        }
+        if ((int)shapes[i].size() != t->rank() || t->is_constant() || t->is_external() || t->is_dynamic()) {
+            HLOG(ERROR) << "Input " << t->name() << " can't be resized.";
+            return false;
+        }
+        t->resize(shapes[i]);
+    }
+
+    if (!model_->resize_outputs()) {
+        return false;
+    }
+
+    // Make sure every op's inputs still cover the bounds it needs; e.g.
+    // alignment padding added by pad_for_ops() may no longer be enough.
+    const OpGroup *root = dynamic_cast<const OpGroup *>(model_.get());
+    HCHECK(root) << "Expected the model to be an OpGroup after flatten_groups().";
+    for (int i = 0; i < root->op_count(); i++) {
+        const Op *op = root->op(i);
+        for (int j = 0; j < op->input_count(); j++) {
+            const TensorPtr &in = op->input(j);
+            if (!in || in->is_constant()) {
+                continue;
+            }
+            for (int k = 0; k < op->output_count(); k++) {
+                const Box required = op->map_bounds(j, k).evaluate(op->output(k)->bounds());
+                if (!is_subset_of(required, in->bounds())) {
+                    HLOG(ERROR) << op->name() << " needs more of " << in->name() << " than is available with the new input shapes.";
+                    return false;
+                }
+            }
+        }
+    }
+
+    // Find (or make) the layout of the arena for these shapes.
+    const std::vector<int> key = shape_key(model_->inputs());
+    auto it = arena_layouts_.find(key);
+    if (it == arena_layouts_.end()) {
+        AllocationPlanner planner(arena_alignment());
+        for (size_t i = 0; i < placements_.size(); i++) {
+            allocation_plan_[i].size = placements_[i].tensors.front()->storage()->storage_size();
+            planner.add_block(allocation_plan_[i].size, allocation_plan_[i].first_use, allocation_plan_[i].last_use);
+        }
+        planner.commit();
+        ArenaLayout layout = {planner.memory_needed(), {}};
+        for (size_t i = 0; i < placements_.size(); i++) {
+            layout.offsets.push_back(planner.get_block_offset(i));
+        }
+        if (options_.verbosity >= 1) {
+            HLOG(INFO) << "Arena memory needed for new input shapes: " << layout.memory_needed;
+        }
+        it = arena_layouts_.emplace(key, std::move(layout)).first;
+    }
+    const ArenaLayout &layout = it->second;
+    for (size_t i = 0; i < placements_.size(); i++) {
+        placements_[i].offset = layout.offsets[i];
+        allocation_plan_[i].size = placements_[i].tensors.front()->storage()->storage_size();
+        allocation_plan_[i].offset = layout.offsets[i];
+    }
+    arena_size_ = layout.memory_needed;
+    tensor_allocation_.update(arena_size_, arena_alignment(), placements_);
+
+    if (scheduler_) {
+        scheduler_->recompute_dependencies();
+    }
+    return true;
+}
+
+bool Interpreter::resize_inputs(const std::vector<Box> &shapes) {
+    if (!prepared_) {
+        HLOG(ERROR) << "Must call prepare() before resize_inputs()";
+        return false;
+    }
+    if (!options_.dynamic_shapes) {
+        HLOG(ERROR) << "resize_inputs() requires InterpreterOptions::dynamic_shapes";
+        return false;
+    }
+    if ((int)shapes.size() != model_->input_count()) {
+        HLOG(ERROR) << "Expected " << model_->input_count() << " input shapes, got " << shapes.size();
+        return false;
+    }
+
+    std::vector<Box> old_shapes;
+    bool all_same = true;
+    for (int i = 0; i < model_->input_count(); i++) {
+        old_shapes.push_back(model_->input(i)->bounds());
+        const Box &old_shape = old_shapes.back();
+        if (old_shape.size() != shapes[i].size() ||
+            !std::equal(old_shape.begin(), old_shape.end(), shapes[i].begin())) {
+            all_same = false;
+        }
+    }
+    if (all_same) {
+        return true;
+    }
+    if (!resize_tensors(shapes)) {
+        // Put everything back the way it was; this should always work.
+        HCHECK(resize_tensors(old_shapes));
+        return false;
+    }
+    return true;
+}
+
+bool Interpreter::save_prepared_model(const std::string &path) const {
+    if (!prepared_) {
+        HLOG(ERROR) << "Must call prepare() before save_prepared_model()";
+        return false;
+    }
+    return PreparedModel::save(path, folded_constants_, allocation_plan_, arena_size_, arena_alignment());
 }
 
 TensorPtr Interpreter::get_tensor(const std::string &name) {
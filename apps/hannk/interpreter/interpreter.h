@@ -1,10 +1,15 @@
 #ifndef HANNK_INTERPRETER_H
 #define HANNK_INTERPRETER_H
 
+#include <map>
 #include <string>
 #include <vector>
 
 #include "interpreter/model.h"
+#include "interpreter/op_profiler.h"
+#include "interpreter/op_scheduler.h"
+#include "interpreter/prepared_model.h"
+#include "interpreter/tensor_arena.h"
 
 namespace hannk {
 
@@ -14,14 +19,75 @@ struct InterpreterOptions {
 
     // Whether to enable tracing.
     bool trace = false;
+
+    // Whether to time each op of the model on every execute(), along with
+    // the bytes it reads and writes and the multiply-accumulates it does.
+    // The results are available from Interpreter::profiler().
+    bool profile = false;
+
+    // The arena to allocate Tensors from. If null, the Interpreter
+    // allocates one of its own. Interpreters that never execute
+    // concurrently can share an arena to reduce their total memory
+    // use; see TensorArena for the caveats.
+    std::shared_ptr<TensorArena> arena;
+
+    // The number of threads to execute ops on. If greater than one, each
+    // op is executed as soon as the ops it depends on have finished, so
+    // independent ops can run concurrently; otherwise ops run one at a
+    // time, in model order. Zero means one thread per core.
+    int inter_op_threads = 1;
+
+    // If greater than zero, the most threads each op's parallel loops are
+    // split across. Only used if inter_op_threads is not one.
+    int max_threads_per_op = 0;
+
+    // If greater than zero, chains of elementwise ops and pools are executed
+    // together, in parallel tiles of about this many bytes of the tensors they
+    // touch, instead of one whole op at a time. The intermediate results then
+    // stay in cache and don't need to be allocated. Something near the size of
+    // the L2 cache is a good choice.
+    int op_chain_tile_bytes = 0;
+
+    // If not null, the results of a previous prepare() of the same model,
+    // saved with Interpreter::save_prepared_model(), used to skip computing
+    // the constant Tensors and the allocation plan again. Anything in it
+    // that doesn't match the model is ignored.
+    std::shared_ptr<const PreparedModel> prepared_model;
+
+    // If true, the shapes of the inputs can be changed after prepare() with
+    // Interpreter::resize_inputs(). This skips the transforms that depend on
+    // the shapes of the Tensors staying the same (in_place() and
+    // fuse_pad_ops()), so it costs some extra copies.
+    bool dynamic_shapes = false;
 };
 
 class Interpreter {
     OpPtr model_;
-    std::unique_ptr<char[]> tensor_storage_arena_;
+    TensorArena::Allocation tensor_allocation_;
+    std::unique_ptr<OpScheduler> scheduler_;
+    std::unique_ptr<OpProfiler> profiler_;
     InterpreterOptions options_;
     bool prepared_ = false;
 
+    // What prepare() computed that can be saved in a PreparedModel.
+    std::vector<TensorPtr> folded_constants_;
+    std::vector<PreparedModel::Block> allocation_plan_;
+    size_t arena_size_ = 0;
+
+    // Where the blocks of allocation_plan_ are placed in the arena.
+    std::vector<TensorArena::Placement> placements_;
+
+    // The offsets of the blocks in the arena for each distinct set of input
+    // shapes seen so far, if dynamic_shapes is set.
+    struct ArenaLayout {
+        size_t memory_needed;
+        std::vector<size_t> offsets;
+    };
+    std::map<std::vector<int>, ArenaLayout> arena_layouts_;
+
+    static std::vector<int> shape_key(const std::vector<TensorPtr> &tensors);
+    bool resize_tensors(const std::vector<Box> &shapes);
+
 public:
     explicit Interpreter(OpPtr m, InterpreterOptions options = InterpreterOptions());
     ~Interpreter();
@@ -42,6 +108,29 @@ public:
 
     void execute();
 
+    // Change the shapes of the inputs, and recompute the shapes of all the
+    // other Tensors from them, without preparing the model again. Requires
+    // InterpreterOptions::dynamic_shapes. The arena layout for each distinct
+    // set of input shapes is computed once and cached, and the arena only
+    // grows, so switching between a few shapes is cheap after the first time
+    // each is seen. Calling this with the current shapes does nothing.
+    // Returns false (leaving the shapes unchanged) if any op doesn't support
+    // the new shapes. The contents of all the non-constant Tensors,
+    // including the inputs, are undefined afterwards.
+    [[nodiscard]] bool resize_inputs(const std::vector<Box> &shapes);
+
+    // Save the constant Tensors and allocation plan computed by prepare(),
+    // to be loaded with PreparedModel::load() and passed in
+    // InterpreterOptions::prepared_model the next time this model is
+    // prepared. Returns false if an error occurs.
+    [[nodiscard]] bool save_prepared_model(const std::string &path) const;
+
+    // Return the profile of the executions so far, or null if
+    // InterpreterOptions::profile is not set.
+    OpProfiler *profiler() {
+        return profiler_.get();
+    }
+
     // Return the Tensor(s) that are the initial input(s) of the Model.
     std::vector<TensorPtr> inputs();
 
@@ -96,9 +96,19 @@ OpPtr lower_tflite_fullyconnected(const TensorPtr &input, const TensorPtr &filte
     const std::array<int, 2> stride = {{1, 1}};
     const std::array<int, 2> dilation_factor = {{1, 1}};
 
-    if (input->rank() == 2) {
-        return make_op<ConvOp>(input, filter, bias, output,
+    // Use the dedicated fully connected pipelines where we can. They don't need
+    // the filter to be tiled, and handle filters quantized per channel.
+    // Otherwise (e.g. for 16-bit outputs), this is a 1x1 convolution.
+    auto make_fully_connected = [&](const TensorPtr &fc_input) -> OpPtr {
+        if (FullyConnectedOp::is_supported(fc_input, filter, output)) {
+            return make_op<FullyConnectedOp>(fc_input, filter, bias, output, activation);
+        }
+        return make_op<ConvOp>(fc_input, filter, bias, output,
                                stride, dilation_factor, Padding::Same, activation);
+    };
+
+    if (input->rank() == 2) {
+        return make_fully_connected(input);
     } else {
         // Sometimes, fully connected op inputs contain extra dimensions, with the expectation that they
         // are reshaped into a flat buffer.
@@ -124,15 +134,14 @@ OpPtr lower_tflite_fullyconnected(const TensorPtr &input, const TensorPtr &filte
             std::make_shared<Tensor>(input->name() + ".reshaped", input->type(), std::move(reshaped_bounds), input->quantization());
         OpPtr reshape_input_op = make_op<ReshapeOp>(input, make_shape_tensor(input_reshaped), input_reshaped);
 
-        OpPtr conv_op = make_op<ConvOp>(input_reshaped, filter, bias, output,
-                                        stride, dilation_factor, Padding::Same, activation);
+        OpPtr fc_op = make_fully_connected(input_reshaped);
 
         std::vector<TensorPtr> inputs = {input, filter, bias};
         std::vector<TensorPtr> outputs = {output};
         // std::initializer_list doesn't work well with move-only types, alas
         std::vector<OpPtr> ops(2);
         ops[0] = std::move(reshape_input_op);
-        ops[1] = std::move(conv_op);
+        ops[1] = std::move(fc_op);
         return make_op<OpGroup>(std::move(inputs), std::move(outputs), std::move(ops));
     }
 }
@@ -2,6 +2,7 @@
 #include "interpreter/ops.h"
 #include "util/error_util.h"
 
+#include <algorithm>
 #include <cmath>
 #include <list>
 
@@ -40,6 +41,20 @@ void Op::set_input(int idx, TensorPtr t) {
     }
 }
 
+bool Op::resize_output(int idx, const Box &bounds) {
+    const TensorPtr &t = output(idx);
+    const Box old_bounds = t->bounds();
+    if (old_bounds.size() == bounds.size() &&
+        std::equal(bounds.begin(), bounds.end(), old_bounds.begin())) {
+        return true;
+    }
+    if (t->is_constant() || t->is_external() || t->is_dynamic() || t->alias_type() != AliasType::None) {
+        return false;
+    }
+    t->resize(bounds);
+    return true;
+}
+
 bool Op::is_input(const TensorPtr &t) const {
     for (auto &i : inputs_) {
         if (i == t) {
@@ -88,6 +103,16 @@ void OpGroup::execute() {
     }
 }
 
+bool OpGroup::resize_outputs() {
+    for (int i = 0; i < op_count(); i++) {
+        if (!op(i)->resize_outputs()) {
+            HLOG(ERROR) << op(i)->name() << " does not support resizing its inputs.";
+            return false;
+        }
+    }
+    return true;
+}
+
 BoundsMap OpGroup::map_bounds(int input_idx, int output_idx) const {
     BoundsMap result(input(input_idx)->rank(), output(output_idx)->rank());
     // TODO
@@ -264,6 +264,10 @@ protected:
 
     Op(std::vector<TensorPtr> inputs, std::vector<TensorPtr> outputs);
 
+    // Helper for resize_outputs(): set the bounds of an output, returning
+    // false if the output can't be resized.
+    bool resize_output(int idx, const Box &bounds);
+
 public:
     virtual ~Op();
 
@@ -288,6 +292,13 @@ public:
     // Execute the op on a given crop.
     virtual void execute() = 0;
 
+    // Recompute the bounds of the outputs from the bounds of the inputs,
+    // after the shapes of the model's inputs have changed since prepare().
+    // Return false if this op doesn't support its input shapes changing.
+    virtual bool resize_outputs() {
+        return false;
+    }
+
     // Call the visitor's appropriate methods for this op, and any sub-ops.
     inline void accept(OpVisitor *v) const {
         return accept_impl(v);
@@ -363,6 +374,7 @@ public:
 
     bool prepare() override;
     void execute() override;
+    bool resize_outputs() override;
 
     int op_count() const {
         return ops_.size();
@@ -0,0 +1,189 @@
+#include "interpreter/op_profiler.h"
+#include "interpreter/ops.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+
+namespace hannk {
+
+namespace {
+
+int64_t size_in_bytes(const TensorPtr &t) {
+    if (!t) {
+        return 0;
+    }
+    return (int64_t)t->number_of_elements() * t->type().bytes();
+}
+
+// The number of multiply-accumulates done by the convolutions and the
+// fully connected ops, or zero for other ops.
+int64_t macs(const Op *op) {
+    if (const ConvOp *conv = dynamic_cast<const ConvOp *>(op)) {
+        return (int64_t)conv->output()->number_of_elements() * conv->input()->extent(0) *
+               conv->filter_extent(1) * conv->filter_extent(2);
+    } else if (const DepthwiseConv2DOp *conv = dynamic_cast<const DepthwiseConv2DOp *>(op)) {
+        return (int64_t)conv->output()->number_of_elements() *
+               conv->filter()->extent(1) * conv->filter()->extent(2);
+    } else if (const FullyConnectedOp *fc = dynamic_cast<const FullyConnectedOp *>(op)) {
+        return (int64_t)fc->output()->number_of_elements() * fc->filter()->extent(0);
+    }
+    return 0;
+}
+
+std::string json_string(const std::string &s) {
+    std::string result = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if ((unsigned char)c < 0x20) {
+            result += ' ';
+        } else {
+            result += c;
+        }
+    }
+    return result + "\"";
+}
+
+void write_stats_json(std::ostream &os, const OpProfiler::Stats &s, double executions) {
+    os << "\"time_us\": " << s.seconds * 1e6 / executions
+       << ", \"bytes_read\": " << s.bytes_read
+       << ", \"bytes_written\": " << s.bytes_written
+       << ", \"macs\": " << s.macs;
+}
+
+void print_stats(std::ostream &os, const OpProfiler::Stats &s, double executions, double total) {
+    const double us = s.seconds * 1e6 / executions;
+    os << std::setw(12) << us
+       << std::setw(8) << (total > 0 ? 100 * s.seconds / total : 0)
+       << std::setw(14) << s.bytes_read
+       << std::setw(14) << s.bytes_written
+       << std::setw(14) << s.macs
+       << std::setw(10) << (us > 0 ? s.macs / us / 1e3 : 0) << "\n";
+}
+
+const char *stats_header = "     time_us       %    bytes_read bytes_written          MACs    GMAC/s\n";
+
+}  // namespace
+
+OpProfiler::OpProfiler(const OpGroup *group) {
+    for (int i = 0; i < group->op_count(); i++) {
+        const Op *op = group->op(i);
+        ops_.push_back(op);
+        LayerStats layer;
+        layer.index = i;
+        layer.type = op->name();
+        layer.output = op->output_count() > 0 && op->output() ? op->output()->name() : "";
+        layers_.push_back(layer);
+    }
+}
+
+void OpProfiler::record(int index, double seconds) {
+    // The shapes of the tensors can change between executions, so the sizes
+    // and the MACs are recomputed each time.
+    const Op *op = ops_[index];
+    LayerStats &layer = layers_[index];
+    layer.seconds += seconds;
+    layer.bytes_read = 0;
+    for (int i = 0; i < op->input_count(); i++) {
+        layer.bytes_read += size_in_bytes(op->input(i));
+    }
+    layer.bytes_written = 0;
+    for (int i = 0; i < op->output_count(); i++) {
+        layer.bytes_written += size_in_bytes(op->output(i));
+    }
+    layer.macs = macs(op);
+}
+
+void OpProfiler::reset() {
+    for (LayerStats &layer : layers_) {
+        layer.seconds = 0;
+    }
+    executions_ = 0;
+}
+
+double OpProfiler::total_seconds() const {
+    double total = 0;
+    for (const LayerStats &layer : layers_) {
+        total += layer.seconds;
+    }
+    return total;
+}
+
+std::vector<OpProfiler::OpTypeStats> OpProfiler::op_types() const {
+    std::map<std::string, OpTypeStats> by_type;
+    for (const LayerStats &layer : layers_) {
+        OpTypeStats &s = by_type[layer.type];
+        s.type = layer.type;
+        s.count++;
+        s.seconds += layer.seconds;
+        s.bytes_read += layer.bytes_read;
+        s.bytes_written += layer.bytes_written;
+        s.macs += layer.macs;
+    }
+    std::vector<OpTypeStats> result;
+    for (const auto &i : by_type) {
+        result.push_back(i.second);
+    }
+    std::stable_sort(result.begin(), result.end(), [](const OpTypeStats &a, const OpTypeStats &b) {
+        return a.seconds > b.seconds;
+    });
+    return result;
+}
+
+void OpProfiler::report(std::ostream &os) const {
+    const double executions = std::max<int64_t>(executions_, 1);
+    const double total = total_seconds();
+    const auto old_flags = os.flags();
+    const auto old_precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+
+    os << "Profile of " << executions_ << " executions (" << total * 1e6 / executions
+       << " us of ops per execution):\n";
+    os << "\nBy layer:\n";
+    os << std::setw(6) << "index" << std::setw(24) << "type" << stats_header;
+    for (const LayerStats &layer : layers_) {
+        os << std::setw(6) << layer.index << std::setw(24) << layer.type;
+        print_stats(os, layer, executions, total);
+        os << "        " << layer.output << "\n";
+    }
+
+    os << "\nBy op type:\n";
+    os << std::setw(24) << "type" << std::setw(6) << "count" << stats_header;
+    for (const OpTypeStats &s : op_types()) {
+        os << std::setw(24) << s.type << std::setw(6) << s.count;
+        print_stats(os, s, executions, total);
+    }
+
+    os.flags(old_flags);
+    os.precision(old_precision);
+}
+
+void OpProfiler::write_json(std::ostream &os) const {
+    const double executions = std::max<int64_t>(executions_, 1);
+    os << "{\"executions\": " << executions_
+       << ", \"total_us\": " << total_seconds() * 1e6 / executions
+       << ",\n \"layers\": [";
+    for (size_t i = 0; i < layers_.size(); i++) {
+        const LayerStats &layer = layers_[i];
+        os << (i > 0 ? ",\n  " : "\n  ")
+           << "{\"index\": " << layer.index
+           << ", \"type\": " << json_string(layer.type)
+           << ", \"output\": " << json_string(layer.output) << ", ";
+        write_stats_json(os, layer, executions);
+        os << "}";
+    }
+    os << "],\n \"op_types\": [";
+    const std::vector<OpTypeStats> types = op_types();
+    for (size_t i = 0; i < types.size(); i++) {
+        os << (i > 0 ? ",\n  " : "\n  ")
+           << "{\"type\": " << json_string(types[i].type)
+           << ", \"count\": " << types[i].count << ", ";
+        write_stats_json(os, types[i], executions);
+        os << "}";
+    }
+    os << "]}\n";
+}
+
+}  // namespace hannk
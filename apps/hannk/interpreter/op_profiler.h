@@ -0,0 +1,93 @@
+#ifndef HANNK_OP_PROFILER_H
+#define HANNK_OP_PROFILER_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "interpreter/model.h"
+
+namespace hannk {
+
+// OpProfiler accumulates the time spent in each op of a model over many
+// executions, along with the bytes each op reads and writes and the
+// multiply-accumulates it does, to break the latency of the model down by
+// layer (each op of the model) and by op type. It is enabled with
+// InterpreterOptions::profile.
+class OpProfiler {
+public:
+    struct Stats {
+        // The total time over all executions.
+        double seconds = 0;
+        // Per execution.
+        int64_t bytes_read = 0;
+        int64_t bytes_written = 0;
+        int64_t macs = 0;
+    };
+
+    struct LayerStats : public Stats {
+        // The position of the op in the model.
+        int index;
+        std::string type;
+        // The name of the op's first output, which identifies the layer.
+        std::string output;
+    };
+
+    struct OpTypeStats : public Stats {
+        std::string type;
+        // The number of layers of this op type.
+        int count = 0;
+    };
+
+    explicit OpProfiler(const OpGroup *group);
+
+    // Add the time of an execution of op 'index' of the group. Different
+    // ops can be recorded concurrently.
+    void record(int index, double seconds);
+
+    // Count one execution of the whole group.
+    void end_execution() {
+        executions_++;
+    }
+
+    void reset();
+
+    int64_t executions() const {
+        return executions_;
+    }
+
+    // The sum of the times of all of the ops, over all executions. If the
+    // ops run concurrently, this may be more than the wall time.
+    double total_seconds() const;
+
+    const std::vector<LayerStats> &layers() const {
+        return layers_;
+    }
+
+    // The stats of the layers summed by op type, in descending order of time.
+    std::vector<OpTypeStats> op_types() const;
+
+    // Print tables of the average time per execution of each layer, and of
+    // each op type.
+    void report(std::ostream &os) const;
+
+    // Write the same information as report() as a JSON object.
+    void write_json(std::ostream &os) const;
+
+    // Neither movable nor copyable.
+    OpProfiler() = delete;
+    OpProfiler(const OpProfiler &) = delete;
+    OpProfiler &operator=(const OpProfiler &) = delete;
+    OpProfiler(OpProfiler &&) = delete;
+    OpProfiler &operator=(OpProfiler &&) = delete;
+
+private:
+    std::vector<const Op *> ops_;
+    std::vector<LayerStats> layers_;
+    int64_t executions_ = 0;
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_OP_PROFILER_H
@@ -0,0 +1,255 @@
+#include "interpreter/op_scheduler.h"
+#include "util/error_util.h"
+
+#include "HalideRuntime.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <functional>
+
+namespace hannk {
+
+namespace {
+
+// The most tasks a parallel loop of the op running on this thread may be
+// split into, or 0 for no limit.
+thread_local int max_threads_for_this_thread = 0;
+
+halide_do_par_for_t previous_do_par_for = nullptr;
+
+struct CappedParFor {
+    halide_task_t f;
+    int min;
+    int size;
+    int tasks;
+    uint8_t *closure;
+};
+
+// Run a contiguous slice of the iterations of a CappedParFor.
+int capped_par_for_task(void *user_context, int idx, uint8_t *closure) {
+    const CappedParFor *c = (const CappedParFor *)closure;
+    const int begin = c->min + (int)((int64_t)c->size * idx / c->tasks);
+    const int end = c->min + (int)((int64_t)c->size * (idx + 1) / c->tasks);
+
+    // This task already occupies one of the op's threads, so any parallel
+    // loops nested inside it must run serially.
+    const int old_max_threads = max_threads_for_this_thread;
+    max_threads_for_this_thread = 1;
+    int result = 0;
+    for (int i = begin; i < end && result == 0; i++) {
+        result = c->f(user_context, i, c->closure);
+    }
+    max_threads_for_this_thread = old_max_threads;
+    return result;
+}
+
+int capped_do_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+    const int max_threads = max_threads_for_this_thread;
+    if (max_threads == 1) {
+        for (int i = min; i < min + size; i++) {
+            int result = f(user_context, i, closure);
+            if (result != 0) {
+                return result;
+            }
+        }
+        return 0;
+    }
+    if (max_threads <= 0 || size <= max_threads) {
+        return previous_do_par_for(user_context, f, min, size, closure);
+    }
+    CappedParFor c = {f, min, size, max_threads, closure};
+    return previous_do_par_for(user_context, capped_par_for_task, 0, max_threads, (uint8_t *)&c);
+}
+
+void install_capped_do_par_for() {
+    static std::once_flag once;
+    std::call_once(once, []() {
+        previous_do_par_for = halide_set_custom_do_par_for(capped_do_par_for);
+    });
+}
+
+// A Tensor accessed by an op, and whether it is written.
+struct TensorAccess {
+    TensorStorage *storage;
+    // The memory the Tensor occupies, if it is fixed once the Tensors
+    // are allocated, otherwise null.
+    const uint8_t *begin;
+    const uint8_t *end;
+    bool is_write;
+};
+
+void add_accesses(const TensorPtr &t, bool is_write, std::vector<TensorAccess> &accesses) {
+    if (!t) {
+        return;
+    }
+    TensorAccess a = {t->storage().get(), nullptr, nullptr, is_write};
+    if (t->is_allocated() && !t->is_external() && !t->is_dynamic()) {
+        const halide_buffer_t *buf = t->buffer().raw_buffer();
+        a.begin = buf->begin();
+        a.end = buf->end();
+    }
+    accesses.push_back(a);
+}
+
+// Find all the Tensors accessed by an op, including those internal to an OpGroup.
+void find_accesses(const Op *op, std::vector<TensorAccess> &accesses) {
+    for (int i = 0; i < op->input_count(); i++) {
+        add_accesses(op->input(i), false, accesses);
+    }
+    for (int i = 0; i < op->output_count(); i++) {
+        add_accesses(op->output(i), true, accesses);
+    }
+    if (const OpGroup *group = dynamic_cast<const OpGroup *>(op)) {
+        for (int i = 0; i < group->op_count(); i++) {
+            find_accesses(group->op(i), accesses);
+        }
+    }
+}
+
+bool conflicts(const TensorAccess &a, const TensorAccess &b) {
+    if (!a.is_write && !b.is_write) {
+        return false;
+    }
+    if (a.storage == b.storage) {
+        return true;
+    }
+    return a.begin && b.begin && a.begin < b.end && b.begin < a.end;
+}
+
+bool conflicts(const std::vector<TensorAccess> &a, const std::vector<TensorAccess> &b) {
+    for (const auto &i : a) {
+        for (const auto &j : b) {
+            if (conflicts(i, j)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+OpScheduler::OpScheduler(OpGroup *group, int num_threads, int max_threads_per_op)
+    : group_(group), max_threads_per_op_(max_threads_per_op) {
+    HCHECK(num_threads >= 1);
+    if (max_threads_per_op_ > 0) {
+        install_capped_do_par_for();
+    }
+
+    recompute_dependencies();
+
+    // The thread calling execute() runs ops too.
+    for (int i = 1; i < num_threads; i++) {
+        workers_.emplace_back([this]() { worker_loop(); });
+    }
+}
+
+void OpScheduler::recompute_dependencies() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    assert(unfinished_ == 0);
+
+    const int op_count = group_->op_count();
+    std::vector<std::vector<TensorAccess>> accesses(op_count);
+    nodes_.clear();
+    nodes_.resize(op_count);
+    for (int i = 0; i < op_count; i++) {
+        nodes_[i].op = group_->op(i);
+        find_accesses(nodes_[i].op, accesses[i]);
+    }
+
+    // Ops are in a valid serial order already, so each op need only be
+    // checked against the ones that come before it.
+    for (int j = 0; j < op_count; j++) {
+        for (int i = 0; i < j; i++) {
+            if (conflicts(accesses[i], accesses[j])) {
+                nodes_[i].successors.push_back(j);
+                nodes_[j].predecessor_count++;
+            }
+        }
+    }
+}
+
+OpScheduler::~OpScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shutting_down_ = true;
+    }
+    wakeup_.notify_all();
+    for (auto &w : workers_) {
+        w.join();
+    }
+}
+
+void OpScheduler::execute() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    assert(unfinished_ == 0);
+
+    pending_predecessors_.resize(nodes_.size());
+    for (size_t i = 0; i < nodes_.size(); i++) {
+        pending_predecessors_[i] = nodes_[i].predecessor_count;
+        if (pending_predecessors_[i] == 0) {
+            ready_.push_back((int)i);
+            std::push_heap(ready_.begin(), ready_.end(), std::greater<int>());
+        }
+    }
+    unfinished_ = (int)nodes_.size();
+    wakeup_.notify_all();
+
+    while (unfinished_ > 0) {
+        if (ready_.empty()) {
+            wakeup_.wait(lock);
+        } else {
+            run_next_op(lock);
+        }
+    }
+}
+
+void OpScheduler::worker_loop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!shutting_down_) {
+        if (ready_.empty()) {
+            wakeup_.wait(lock);
+        } else {
+            run_next_op(lock);
+        }
+    }
+}
+
+void OpScheduler::run_next_op(std::unique_lock<std::mutex> &lock) {
+    // Prefer the earliest ready op in model order, as its outputs are the
+    // most likely to be needed soon.
+    std::pop_heap(ready_.begin(), ready_.end(), std::greater<int>());
+    const int i = ready_.back();
+    ready_.pop_back();
+
+    lock.unlock();
+    max_threads_for_this_thread = max_threads_per_op_;
+    if (profiler_) {
+        const auto start = std::chrono::steady_clock::now();
+        nodes_[i].op->execute();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        profiler_->record(i, elapsed.count());
+    } else {
+        nodes_[i].op->execute();
+    }
+    max_threads_for_this_thread = 0;
+    lock.lock();
+
+    int newly_ready = 0;
+    for (int j : nodes_[i].successors) {
+        if (--pending_predecessors_[j] == 0) {
+            ready_.push_back(j);
+            std::push_heap(ready_.begin(), ready_.end(), std::greater<int>());
+            newly_ready++;
+        }
+    }
+    unfinished_--;
+    if (newly_ready > 1 || unfinished_ == 0) {
+        wakeup_.notify_all();
+    } else if (newly_ready == 1) {
+        wakeup_.notify_one();
+    }
+}
+
+}  // namespace hannk
@@ -0,0 +1,80 @@
+#ifndef HANNK_OP_SCHEDULER_H
+#define HANNK_OP_SCHEDULER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "interpreter/model.h"
+#include "interpreter/op_profiler.h"
+
+namespace hannk {
+
+// OpScheduler executes the ops of an OpGroup on several threads at once,
+// starting each op as soon as every op it depends on has finished, rather
+// than one after another in model order. This helps models with
+// independent branches (e.g. Inception-style models), whose individual ops
+// are often too small to keep all the cores busy on their own.
+//
+// Op B depends on an earlier op A if B reads what A writes, or writes what
+// A reads or writes; this includes Tensors that merely overlap in memory
+// (e.g. arena-allocated Tensors with disjoint lifetimes), so the
+// dependencies must be computed after all Tensors are allocated.
+class OpScheduler {
+public:
+    // Execute the ops of 'group' on 'num_threads' threads in total (including
+    // the caller of execute()). If 'max_threads_per_op' is greater than zero,
+    // the parallel loops of each op are split into at most that many tasks,
+    // so that one large op can't monopolize the Halide thread pool.
+    OpScheduler(OpGroup *group, int num_threads, int max_threads_per_op);
+    ~OpScheduler();
+
+    // Execute all of the ops once, returning when they have all finished.
+    void execute();
+
+    // Recompute the dependencies between the ops, after the Tensors have
+    // been resized or moved to different offsets in their arena.
+    void recompute_dependencies();
+
+    // If not null, record the time of each op in 'profiler'.
+    void set_profiler(OpProfiler *profiler) {
+        profiler_ = profiler;
+    }
+
+    // Neither movable nor copyable.
+    OpScheduler() = delete;
+    OpScheduler(const OpScheduler &) = delete;
+    OpScheduler &operator=(const OpScheduler &) = delete;
+    OpScheduler(OpScheduler &&) = delete;
+    OpScheduler &operator=(OpScheduler &&) = delete;
+
+private:
+    struct Node {
+        Op *op;
+        std::vector<int> successors;
+        int predecessor_count = 0;
+    };
+    OpGroup *group_;
+    std::vector<Node> nodes_;
+    const int max_threads_per_op_;
+    OpProfiler *profiler_ = nullptr;
+
+    // Everything below is guarded by mutex_.
+    std::mutex mutex_;
+    std::condition_variable wakeup_;
+    std::vector<int> ready_;
+    std::vector<int> pending_predecessors_;
+    int unfinished_ = 0;
+    bool shutting_down_ = false;
+    std::vector<std::thread> workers_;
+
+    void worker_loop();
+    // Take an op off the ready list and execute it, releasing 'lock' (which
+    // must hold mutex_) while it runs.
+    void run_next_op(std::unique_lock<std::mutex> &lock);
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_OP_SCHEDULER_H
@@ -5,6 +5,7 @@
 #include "halide/add_uint8_uint8.h"
 #include "halide/average_pool_uint8.h"
 #include "halide/constants.h"
+#include "halide/conv_elementwise_u8_u8_u8.h"
 #include "halide/conv_u8_u8_i16.h"
 #include "halide/conv_u8_u8_u8.h"
 #ifdef CONV_R16
@@ -13,11 +14,16 @@
 #endif
 #include "halide/copy_uint8_uint8.h"
 #include "halide/depthwise_conv_broadcast_uint8.h"
+#include "halide/depthwise_conv_elementwise_uint8.h"
 #include "halide/depthwise_conv_shallow_uint8.h"
 #include "halide/depthwise_conv_uint8.h"
 #include "halide/elementwise_5xint16_1xuint8int16.h"
 #include "halide/elementwise_5xuint8_1xuint8.h"
 #include "halide/fill_uint8.h"
+#include "halide/fully_connected_i8.h"
+#include "halide/fully_connected_sparse_i8.h"
+#include "halide/fully_connected_sparse_u8.h"
+#include "halide/fully_connected_u8.h"
 #include "halide/l2_normalization_uint8.h"
 #include "halide/max_pool_uint8.h"
 #include "halide/mean_uint8.h"
@@ -399,6 +405,49 @@ Interval get_quantized_min_max(ActivationFunction activation, int zero_point, do
     return {std::max(min, 0), std::min(max, 255)};
 }
 
+// Make an interval with the same min as i, and the given extent.
+Interval with_extent(const Interval &i, int extent) {
+    return Interval(i.min, i.min + extent - 1);
+}
+
+// If t is padded by pad_for_ops() for the op consuming it, return the PadOp.
+PadOp *padded_for_consumer(const TensorPtr &t) {
+    if (t->producers().size() == 1) {
+        PadOp *pad = dynamic_cast<PadOp *>(t->producers().front());
+        if (pad && pad->pads_for_consumer()) {
+            return pad;
+        }
+    }
+    return nullptr;
+}
+
+// Compute the bounds of the output of a convolution or pooling op, with
+// spatial dimensions 1 to rank - 2, from the bounds of its (unpadded)
+// input. Returns an empty box if the output would be empty.
+Box conv_output_bounds(const Box &output, const Box &input, Padding padding,
+                       const std::array<int, 2> &stride, const std::array<int, 2> &dilation,
+                       const std::array<int, 2> &filter_extent) {
+    const int rank = input.size();
+    Box result = output;
+    for (int i = 1; i < rank - 1; i++) {
+        const int input_extent = input[i].extent();
+        int extent;
+        if (padding == Padding::Same) {
+            extent = ceil_div(input_extent, stride[i - 1]);
+        } else {
+            extent = ceil_div(input_extent - dilation[i - 1] * (filter_extent[i - 1] - 1), stride[i - 1]);
+        }
+        if (extent <= 0) {
+            return Box();
+        }
+        result[i] = with_extent(output[i], extent);
+    }
+    result[rank - 1] = input[rank - 1];
+    return result;
+}
+
+}  // namespace
+
 Interval get_output_range(ActivationFunction activation, const QuantizationInfo &quantization) {
     const int output_zero = quantization.uniform_zero();
     assert(output_zero >= 0 && output_zero <= 255);
@@ -413,6 +462,8 @@ Interval get_output_range(ActivationFunction activation, const QuantizationInfo
     return output_range;
 }
 
+namespace {
+
 struct MultiplyParams {
     int a_zero;
     int b_zero;
@@ -547,6 +598,28 @@ BoundsMap ElementwiseOp::map_bounds(int input_idx, int output_idx) const {
     return BoundsMap::elementwise(rank);
 }
 
+bool ElementwiseOp::resize_outputs() {
+    for (int o = 0; o < output_count(); o++) {
+        // Inputs may be broadcast in any dimension, so take the bounds of
+        // each dimension from any input that isn't broadcast in it.
+        Box bounds = input(0)->bounds();
+        for (int d = 0; d < (int)bounds.size(); d++) {
+            for (int i = 1; i < input_count(); i++) {
+                const Interval b = input(i)->bounds(d);
+                if (bounds[d].extent() == 1) {
+                    bounds[d] = b;
+                } else if (b.extent() != 1 && b != bounds[d]) {
+                    return false;
+                }
+            }
+        }
+        if (!resize_output(o, bounds)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 const char *BinaryOp::to_string(BinaryOp::Operator op) {
     switch (op) {
     case Add:
@@ -733,6 +806,16 @@ BoundsMap ConcatenationOp::map_bounds(int input_idx, int output_idx) const {
     return result;
 }
 
+bool ConcatenationOp::resize_outputs() {
+    Box bounds = input(0)->bounds();
+    int extent = 0;
+    for (int i = 0; i < input_count(); i++) {
+        extent += input(i)->extent(axis_);
+    }
+    bounds[axis_] = with_extent(bounds[axis_], extent);
+    return resize_output(0, bounds);
+}
+
 void ConcatenationOp::execute() {
     if (is_no_op_) {
         return;
@@ -769,6 +852,11 @@ halide_type_t ConvOp::filter_type() const {
     }
 }
 
+int ConvOp::filter_extent(int i) const {
+    // A tiled filter has 3 more dimensions than the input; see map_bounds().
+    return filter()->rank() == input()->rank() ? filter()->extent(i) : filter()->extent(i + 3);
+}
+
 BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
     assert(vector_reduction_ > 0);
     assert(vector_tile_ > 0);
@@ -784,7 +872,7 @@ BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
             .constant(0, align_up(input()->extent(0), unroll_reduction))
             .elementwise(input()->rank() - 1, input()->rank() - 1);
         for (int i = 1; i < input()->rank() - 1; i++) {
-            result.downsample(i, i, stride_[i - 1], Interval(0, dilation_[i - 1] * (filter()->extent(i) - 1)));
+            result.downsample(i, i, stride_[i - 1], Interval(0, dilation_[i - 1] * (filter_extent(i) - 1)));
         }
         return result;
     } else if (input_idx == 1) {
@@ -799,9 +887,11 @@ BoundsMap ConvOp::map_bounds(int input_idx, int output_idx) const {
             result.constant(i + 3, filter()->bounds(i));
         }
         return result;
-    } else {
-        assert(input_idx == 2);
+    } else if (input_idx == 2) {
         return BoundsMap(1, output()->rank()).elementwise(0, 0);
+    } else {
+        assert(input_idx == 3);
+        return BoundsMap::elementwise(output()->rank());
     }
 }
 
@@ -831,8 +921,30 @@ void call_conv2d(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_
        output);
 }
 
+void call_conv2d_elementwise(halide_buffer_t *input, halide_buffer_t *filter, halide_buffer_t *bias,
+                             const MultiplyParams &params, const std::array<int, 2> &stride,
+                             const std::array<int, 2> &dilation, halide_buffer_t *elementwise_input,
+                             halide_buffer_t *program, halide_buffer_t *output) {
+    // The output range and zero are handled by the program.
+    assert(params.c_zero == 0);
+    conv_elementwise_u8_u8_u8(input, (uint8_t)params.a_zero, filter, (uint8_t)params.b_zero, bias,
+                              stride[0], stride[1], dilation[0], dilation[1], params.c.mantissa(),
+                              -params.c.exponent(), 0, 0, 255, elementwise_input, program, output);
+}
+
 }  // namespace
 
+bool ConvOp::resize_outputs() {
+    PadOp *pad = padded_for_consumer(input());
+    const TensorPtr &in = pad ? pad->input() : input();
+    const Box bounds = conv_output_bounds(output()->bounds(), in->bounds(), padding_, stride_, dilation_,
+                                          {filter_extent(1), in->rank() > 3 ? filter_extent(2) : 1});
+    if (bounds.empty() || !resize_output(0, bounds)) {
+        return false;
+    }
+    return !pad || pad->resize_for_consumer(map_bounds(0, 0).evaluate(output()->bounds()));
+}
+
 bool ConvOp::prepare() {
     // Pass minimal sized buffers to learn about the alignment requirements.
     // TODO: need to adapt this to the types of in, filt, out once we support multiple variants
@@ -860,9 +972,13 @@ void ConvOp::execute() {
         auto filter_buf = filt->buffer();
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
+        // If there is no output program, this is just an alias of the output,
+        // so we can treat it the same without checking.
+        HalideBuffer<void> elementwise_buf = has_output_program() ? elementwise_input()->buffer() : output_buf;
+        const QuantizationInfo &outq = has_output_program() ? output_program_.quantization : out->quantization();
 
         MultiplyParams params =
-            get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
+            get_quantized_multiply_params(in->quantization(), filt->quantization(), outq);
 
         const auto output_range = get_output_range(activation_, out->quantization());
 
@@ -870,6 +986,7 @@ void ConvOp::execute() {
         while (input_buf.dimensions() < 4) {
             input_buf.embed(input_buf.dimensions() - 1, 1);
             output_buf.embed(output_buf.dimensions() - 1, 1);
+            elementwise_buf.embed(elementwise_buf.dimensions() - 1, 1);
             filter_buf.add_dimension();
         }
 
@@ -883,9 +1000,11 @@ void ConvOp::execute() {
             // them all where possible, which might be a further improvement.
             while (can_fuse_xy(FuseType::Pad, input_buf) &&
                    can_fuse_xy(FuseType::Pad, output_buf) &&
+                   can_fuse_xy(FuseType::Pad, elementwise_buf) &&
                    input_buf.dim(1).extent() == output_buf.dim(1).extent()) {
                 fuse_xy(FuseType::Pad, input_buf);
                 fuse_xy(FuseType::Pad, output_buf);
+                fuse_xy(FuseType::Pad, elementwise_buf);
             }
 
             if (output_buf.dim(1).extent() < output_buf.dim(2).extent()) {
@@ -894,10 +1013,18 @@ void ConvOp::execute() {
                 // if we tiled y instead. We can do this by just swapping the x and y dimensions.
                 input_buf.transpose(1, 2);
                 output_buf.transpose(1, 2);
+                elementwise_buf.transpose(1, 2);
             }
         }
 
-        call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+        if (has_output_program()) {
+            // TODO: There is no CONV_R16 variant of the fused pipeline.
+            assert(out->type() == halide_type_of<uint8_t>());
+            call_conv2d_elementwise(input_buf, filter_buf, bias_buf, params, stride_, dilation_,
+                                    elementwise_buf, output_program_.program, output_buf);
+        } else {
+            call_conv2d(input_buf, filter_buf, bias_buf, params, stride_, dilation_, output_range, output_buf);
+        }
     } else {
         HLOG(FATAL) << "Unsupported type " << out->type() << "\n";
     }
@@ -952,7 +1079,7 @@ BoundsMap DepthwiseConv2DOp::map_bounds(int input_idx, int output_idx) const {
             .downsample(2, 2, stride_[1], Interval(0, dilation_[1] * (filter()->extent(2) - 1)))
             .elementwise(3, 3);
         if (depth_multiplier_ == 1) {
-            if (stride_[0] == 1 &&
+            if (stride_[0] == 1 && !has_output_program() &&
                 can_be_shallow(channel_alignment_, input()->extent(0), input()->extent(1))) {
                 // We can use the shallow version of depthwise here.
             } else {
@@ -967,11 +1094,24 @@ BoundsMap DepthwiseConv2DOp::map_bounds(int input_idx, int output_idx) const {
             .constant(2, filter()->bounds(2));
     } else if (input_idx == 2) {
         return BoundsMap(1, 4).elementwise(0, 0);
+    } else if (input_idx == 3) {
+        return BoundsMap::elementwise(4);
     } else {
         return BoundsMap(0, 4);
     }
 }
 
+bool DepthwiseConv2DOp::resize_outputs() {
+    PadOp *pad = padded_for_consumer(input());
+    const TensorPtr &in = pad ? pad->input() : input();
+    const Box bounds = conv_output_bounds(output()->bounds(), in->bounds(), padding_, stride_, dilation_,
+                                          {filter()->extent(1), filter()->extent(2)});
+    if (bounds.empty() || !resize_output(0, bounds)) {
+        return false;
+    }
+    return !pad || pad->resize_for_consumer(map_bounds(0, 0).evaluate(output()->bounds()));
+}
+
 bool DepthwiseConv2DOp::prepare() {
     // Pass minimal sized buffers to learn about the alignment requirements.
     // TODO: need to adapt this to the types of in, filt, out once we support multiple variants
@@ -999,6 +1139,21 @@ void DepthwiseConv2DOp::execute() {
         auto bias_buf = bias()->buffer();
         auto output_buf = out->buffer();
 
+        if (has_output_program()) {
+            MultiplyParams params =
+                get_quantized_multiply_params(in->quantization(), filt->quantization(), output_program_.quantization);
+            assert(params.c_zero == 0);
+            assert(depth_multiplier_ == 1);
+
+            // The output range and zero are handled by the program.
+            auto elementwise_buf = elementwise_input()->buffer();
+            depthwise_conv_elementwise_uint8(
+                input_buf, (uint8_t)params.a_zero, filter_buf, (uint8_t)params.b_zero, bias_buf,
+                stride_[0], stride_[1], dilation_[0], dilation_[1], 0, params.c.mantissa(), -params.c.exponent(),
+                0, 0, 255, elementwise_buf, output_program_.program, output_buf);
+            return;
+        }
+
         MultiplyParams params =
             get_quantized_multiply_params(in->quantization(), filt->quantization(), out->quantization());
 
@@ -1101,6 +1256,221 @@ void ElementwiseProgramOp::execute() {
     HLOG(FATAL) << "Unsupported elementwise program\n";
 }
 
+/*static*/ bool FullyConnectedOp::is_supported(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &output) {
+    if (!filter->is_constant() || input->rank() != 2 || filter->rank() != 2) {
+        return false;
+    }
+    for (halide_type_t t : {halide_type_of<uint8_t>(), halide_type_of<int8_t>()}) {
+        if (input->type() == t && filter->type() == t && output->type() == t) {
+            return true;
+        }
+    }
+    return false;
+}
+
+BoundsMap FullyConnectedOp::map_bounds(int input_idx, int output_idx) const {
+    assert(output_idx == 0);
+    if (input_idx == 0) {
+        return BoundsMap(2, 2).constant(0, input()->bounds(0)).elementwise(1, 1);
+    } else if (input_idx == 1) {
+        return BoundsMap(2, 2).constant(0, filter()->bounds(0)).elementwise(1, 0);
+    } else {
+        assert(input_idx == 2);
+        return BoundsMap(1, 2).elementwise(0, 0);
+    }
+}
+
+bool FullyConnectedOp::resize_outputs() {
+    Box bounds = output()->bounds();
+    bounds[1] = input()->bounds(1);
+    return resize_output(0, bounds);
+}
+
+namespace {
+
+// Pack the blocks of a fully connected filter that have a coefficient
+// different from the zero point, in the layout fully_connected_sparse
+// expects. Returns false if that wouldn't skip enough of the filter to be
+// worth it, or if the coefficients minus the zero point don't fit in 8 bits.
+template<typename T>
+bool pack_sparse_filter(const HalideBuffer<const T> &filter, int filter_zero,
+                        HalideBuffer<int8_t> &packed, HalideBuffer<int32_t> &offsets,
+                        HalideBuffer<int32_t> &counts, HalideBuffer<int32_t> &sums) {
+    const int depth = filter.dim(0).extent();
+    const int output_channels = filter.dim(1).extent();
+    const int c_min = filter.dim(0).min();
+    const int co_min = filter.dim(1).min();
+    const int block_count = ceil_div(depth, sparse_block_channels);
+    const int group_count = ceil_div(output_channels, sparse_block_outputs);
+
+    auto coefficient = [&](int c, int co) {
+        if (c >= depth || co >= output_channels) {
+            return 0;
+        }
+        return (int)filter(c_min + c, co_min + co) - filter_zero;
+    };
+
+    std::vector<std::vector<int>> nonzero_blocks(group_count);
+    int total_nonzero = 0;
+    int max_nonzero = 1;
+    for (int g = 0; g < group_count; g++) {
+        for (int k = 0; k < block_count; k++) {
+            bool is_zero = true;
+            for (int co = g * sparse_block_outputs; co < (g + 1) * sparse_block_outputs; co++) {
+                for (int c = k * sparse_block_channels; c < (k + 1) * sparse_block_channels; c++) {
+                    const int w = coefficient(c, co);
+                    if (w < -128 || w > 127) {
+                        return false;
+                    }
+                    is_zero = is_zero && w == 0;
+                }
+            }
+            if (!is_zero) {
+                nonzero_blocks[g].push_back(k);
+            }
+        }
+        total_nonzero += nonzero_blocks[g].size();
+        max_nonzero = std::max<int>(max_nonzero, nonzero_blocks[g].size());
+    }
+    // Skipping blocks costs some overhead, so only do it if most of them
+    // are zero.
+    if (2 * total_nonzero > block_count * group_count) {
+        return false;
+    }
+
+    packed = HalideBuffer<int8_t>(sparse_block_channels, sparse_block_outputs, max_nonzero, group_count);
+    offsets = HalideBuffer<int32_t>(max_nonzero, group_count);
+    counts = HalideBuffer<int32_t>(group_count);
+    sums = HalideBuffer<int32_t>(output_channels);
+    packed.fill(0);
+    offsets.fill(0);
+    sums.fill(0);
+    for (int g = 0; g < group_count; g++) {
+        counts(g) = nonzero_blocks[g].size();
+        for (int i = 0; i < (int)nonzero_blocks[g].size(); i++) {
+            const int k = nonzero_blocks[g][i];
+            offsets(i, g) = k * sparse_block_channels;
+            for (int coi = 0; coi < sparse_block_outputs; coi++) {
+                const int co = g * sparse_block_outputs + coi;
+                for (int ci = 0; ci < sparse_block_channels; ci++) {
+                    const int w = coefficient(k * sparse_block_channels + ci, co);
+                    packed(ci, coi, i, g) = w;
+                    if (co < output_channels) {
+                        sums(co) += w;
+                    }
+                }
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+bool FullyConnectedOp::prepare() {
+    if (!is_supported(input(), filter(), output())) {
+        return false;
+    }
+
+    const QuantizationInfo &inq = input()->quantization();
+    const QuantizationInfo &filterq = filter()->quantization();
+    const QuantizationInfo &outq = output()->quantization();
+
+    const int output_channels = filter()->extent(1);
+    if (filterq.scale.size() != 1 && (int)filterq.scale.size() != output_channels) {
+        HLOG(ERROR) << "FullyConnectedOp: unexpected number of filter scales " << filterq.scale.size();
+        return false;
+    }
+    // The zero point of the filter must be the same for all channels.
+    for (int32_t zero : filterq.zero) {
+        if (zero != filterq.zero.front()) {
+            HLOG(ERROR) << "FullyConnectedOp: filter zero points must be uniform";
+            return false;
+        }
+    }
+
+    output_multiplier_ = HalideBuffer<int32_t>(output_channels);
+    output_shift_ = HalideBuffer<int32_t>(output_channels);
+    for (int c = 0; c < output_channels; c++) {
+        const float filter_scale = filterq.scale.size() == 1 ? filterq.scale[0] : filterq.scale[c];
+        const IntFloat<int32_t> multiplier(inq.uniform_scale() * filter_scale / outq.uniform_scale());
+        output_multiplier_(c) = multiplier.mantissa();
+        output_shift_(c) = -multiplier.exponent();
+    }
+    return true;
+}
+
+void FullyConnectedOp::execute() {
+    const TensorPtr &in = input();
+    const TensorPtr &filt = filter();
+    const TensorPtr &out = output();
+
+    auto input_buf = in->buffer();
+    auto filter_buf = filt->buffer();
+    auto bias_buf = bias()->buffer();
+    auto output_buf = out->buffer();
+
+    const bool is_signed = out->type() == halide_type_of<int8_t>();
+
+    if (!filter_sums_.data()) {
+        // The filter is constant, so we only need to do this once.
+        const int depth = filter_buf.dim(0).extent();
+        const int output_channels = filter_buf.dim(1).extent();
+        filter_sums_ = HalideBuffer<int32_t>(output_channels);
+        for (int c = 0; c < output_channels; c++) {
+            int32_t sum = 0;
+            for (int i = 0; i < depth; i++) {
+                if (is_signed) {
+                    sum += filter_buf.as<const int8_t>()(i, c);
+                } else {
+                    sum += filter_buf.as<const uint8_t>()(i, c);
+                }
+            }
+            filter_sums_(c) = sum;
+        }
+
+        const int filter_zero = filt->quantization().zero.front();
+        if (is_signed) {
+            pack_sparse_filter(filter_buf.as<const int8_t>(), filter_zero, sparse_filter_,
+                               sparse_block_offsets_, sparse_block_counts_, sparse_filter_sums_);
+        } else {
+            pack_sparse_filter(filter_buf.as<const uint8_t>(), filter_zero, sparse_filter_,
+                               sparse_block_offsets_, sparse_block_counts_, sparse_filter_sums_);
+        }
+    }
+
+    const int input_zero = in->quantization().uniform_zero();
+    const int filter_zero = filt->quantization().zero.front();
+    const QuantizationInfo &outq = out->quantization();
+    const int output_zero = outq.uniform_zero();
+
+    Interval output_range;
+    if (is_signed) {
+        // get_output_range works with unsigned values, so offset the zero point.
+        QuantizationInfo unsigned_outq = outq;
+        unsigned_outq.zero = {output_zero + 128};
+        output_range = get_output_range(activation_, unsigned_outq);
+        output_range -= 128;
+    } else {
+        output_range = get_output_range(activation_, outq);
+    }
+
+    if (sparse_filter_.data()) {
+        using FullyConnectedSparseFn = decltype(&::hannk::fully_connected_sparse_u8);
+        FullyConnectedSparseFn fn = is_signed ? ::hannk::fully_connected_sparse_i8 : ::hannk::fully_connected_sparse_u8;
+        fn(input_buf, input_zero, sparse_filter_, sparse_block_offsets_, sparse_block_counts_, sparse_filter_sums_,
+           bias_buf, output_multiplier_, output_shift_, output_zero, output_range.min, output_range.max,
+           output_buf);
+        return;
+    }
+
+    using FullyConnectedFn = decltype(&::hannk::fully_connected_u8);
+    FullyConnectedFn fn = is_signed ? ::hannk::fully_connected_i8 : ::hannk::fully_connected_u8;
+    fn(input_buf, input_zero, filter_buf, filter_zero, filter_sums_, bias_buf,
+       output_multiplier_, output_shift_, output_zero, output_range.min, output_range.max,
+       output_buf);
+}
+
 BoundsMap GatherOp::map_bounds(int input_idx, int output_idx) const {
     if (input_idx == 0) {
         BoundsMap result = BoundsMap::elementwise(output()->rank());
@@ -1170,6 +1540,10 @@ BoundsMap L2NormalizationOp::map_bounds(int input_idx, int output_idx) const {
         .elementwise(1, 1);
 }
 
+bool L2NormalizationOp::resize_outputs() {
+    return resize_output(0, input()->bounds());
+}
+
 void L2NormalizationOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1227,6 +1601,41 @@ BoundsMap PadOp::map_bounds(int input_idx, int output_idx) const {
     }
 }
 
+bool PadOp::resize_outputs() {
+    if (pads_for_consumer_) {
+        // Our consumer resizes us, once it knows the bounds it needs.
+        return true;
+    }
+    if (!padding() || !padding()->is_constant()) {
+        return false;
+    }
+    const auto &padding_buf = padding()->buffer<const int32_t>();
+    const int dims = input()->rank();
+    Box bounds = input()->bounds();
+    for (int d = 0; d < dims; ++d) {
+        const int idx = dims - d - 1;
+        bounds[d].max += padding_buf(0, idx) + padding_buf(1, idx);
+    }
+    return resize_output(0, bounds);
+}
+
+bool PadOp::resize_for_consumer(const Box &required) {
+    assert(pads_for_consumer_);
+    const TensorPtr &in = input();
+    HalideBuffer<int32_t> padding_buf = padding()->buffer<int32_t>();
+    // This matches the padding made by pad_for_ops().
+    const int r = in->rank();
+    for (int i = 1; i < r; i++) {
+        const int extra = required[i].extent() - in->extent(i);
+        if (extra < 0) {
+            return false;
+        }
+        padding_buf(0, r - i - 1) = extra / 2;
+        padding_buf(1, r - i - 1) = (extra + 1) / 2;
+    }
+    return resize_output(0, required);
+}
+
 void PadOp::execute() {
     const TensorPtr &in = input(0);
     const TensorPtr &padding = input(1);
@@ -1333,6 +1742,30 @@ BoundsMap Pool2DOp::map_bounds(int input_idx, int output_idx) const {
         .elementwise(3, 3);
 }
 
+Box Pool2DOp::input_crop(const Box &output_crop) const {
+    // Each dimension of the input depends only on the same dimension of the
+    // output, so evaluate the maps one dimension at a time.
+    const BoundsMap map = map_bounds(0, 0);
+    Box result(output_crop.size());
+    for (int d = 0; d < (int)output_crop.size(); d++) {
+        result[d] = map.at(d, d).evaluate(output_crop[d]);
+    }
+    for (int d = 1; d <= 2; d++) {
+        result[d] -= compute_padding(stride_[d - 1], input()->extent(d), filter_size_[d - 1], output()->extent(d));
+    }
+    return result;
+}
+
+bool Pool2DOp::resize_outputs() {
+    PadOp *pad = padded_for_consumer(input());
+    const TensorPtr &in = pad ? pad->input() : input();
+    const Box bounds = conv_output_bounds(output()->bounds(), in->bounds(), padding_, stride_, {1, 1}, filter_size_);
+    if (bounds.empty() || !resize_output(0, bounds)) {
+        return false;
+    }
+    return !pad || pad->resize_for_consumer(map_bounds(0, 0).evaluate(output()->bounds()));
+}
+
 void Pool2DOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1344,10 +1777,12 @@ void Pool2DOp::execute() {
 
         const auto output_range = get_output_range(activation_, out->quantization());
 
-        const int in_width = input_buf.dim(1).extent();
-        const int in_height = input_buf.dim(2).extent();
-        const int out_width = output_buf.dim(1).extent();
-        const int out_height = output_buf.dim(2).extent();
+        // The padding depends on the shape of the tensors, not the buffers,
+        // which may be crops of them (see TiledChainOp).
+        const int in_width = in->extent(1);
+        const int in_height = in->extent(2);
+        const int out_width = out->extent(1);
+        const int out_height = out->extent(2);
         input_buf.translate(1, compute_padding(stride_[0], in_width, filter_size_[0], out_width));
         input_buf.translate(2, compute_padding(stride_[1], in_height, filter_size_[1], out_height));
 
@@ -1478,13 +1913,28 @@ SmallVector<int, max_rank> ReshapeOp::calc_new_shape() const {
     }
     if (stretch_dim != -1) {
         new_shape[stretch_dim] = in->number_of_elements() / output_elements;
-        output_elements *= new_shape[stretch_dim];
-        assert(output_elements == (int)output()->number_of_elements());
     }
 
     return new_shape;
 }
 
+bool ReshapeOp::resize_outputs() {
+    if (output()->is_dynamic()) {
+        // The new shape isn't known until we execute.
+        return false;
+    }
+    Box bounds;
+    int elements = 1;
+    for (int i : calc_new_shape()) {
+        bounds.emplace_back(0, i - 1);
+        elements *= i;
+    }
+    if (elements != input()->number_of_elements()) {
+        return false;
+    }
+    return resize_output(0, bounds);
+}
+
 void ReshapeOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1553,6 +2003,10 @@ BoundsMap SoftmaxOp::map_bounds(int input_idx, int output_idx) const {
         .elementwise(1, 1);
 }
 
+bool SoftmaxOp::resize_outputs() {
+    return resize_output(0, input()->bounds());
+}
+
 void SoftmaxOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1648,6 +2102,21 @@ BoundsMap SpaceDepthOp::map_bounds(int input_idx, int output_idx) const {
     return result;
 }
 
+bool SpaceDepthOp::resize_outputs() {
+    const TensorPtr &in = input();
+    Box bounds = in->bounds();
+    if (block_size_ > 0) {
+        bounds[0] = with_extent(bounds[0], in->extent(0) * block_size_ * block_size_);
+        bounds[1] = with_extent(bounds[1], in->extent(1) / block_size_);
+        bounds[2] = with_extent(bounds[2], in->extent(2) / block_size_);
+    } else {
+        bounds[0] = with_extent(bounds[0], in->extent(0) / (block_size_ * block_size_));
+        bounds[1] = with_extent(bounds[1], in->extent(1) * -block_size_);
+        bounds[2] = with_extent(bounds[2], in->extent(2) * -block_size_);
+    }
+    return resize_output(0, bounds);
+}
+
 void SpaceDepthOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1730,6 +2199,235 @@ void TileConvFilterOp::execute() {
     }
 }
 
+namespace {
+
+// Compose the dimension maps of ops along a chain: given the map from the
+// output of an op to the chain output (outer), and the map from an input of
+// the op to its output (inner), make the map from that input to the chain
+// output. This only handles maps from each dimension of the output to the same
+// dimension of the input without upsampling, which is all TiledChainOp needs.
+DimMap compose(const DimMap &inner, const DimMap &outer) {
+    assert(inner.inv_stride == 1 && outer.inv_stride == 1);
+    assert(inner.pre_bounds == Interval(0, 0) && outer.pre_bounds == Interval(0, 0));
+    return DimMap(inner.stride * outer.stride, 1, outer.bounds * inner.stride + inner.bounds);
+}
+
+// The region of input input_idx of op needed to compute the crop of its output.
+Box required_input_crop(const Op *op, int input_idx, const Box &output_crop) {
+    if (const Pool2DOp *pool = dynamic_cast<const Pool2DOp *>(op)) {
+        return pool->input_crop(output_crop);
+    }
+    // Elementwise ops need the same region of their inputs as their output.
+    return output_crop;
+}
+
+HalideBuffer<void> crop_buffer(HalideBuffer<void> buf, const Box &crop) {
+    for (int d = 0; d < (int)crop.size(); d++) {
+        buf.crop(d, crop[d].min, crop[d].extent());
+    }
+    return buf;
+}
+
+// Scratch memory for the intermediate tensors of a tile. A thread waiting for
+// the thread pool in one tile can run another tile, so tiles take their
+// memory from a per-thread free list instead of sharing one block.
+constexpr size_t scratch_alignment = 128;
+
+struct ScratchBlock {
+    std::unique_ptr<uint8_t[]> data;
+    size_t size = 0;
+
+    uint8_t *aligned() const {
+        uintptr_t p = reinterpret_cast<uintptr_t>(data.get());
+        p = (p + scratch_alignment - 1) & ~(uintptr_t)(scratch_alignment - 1);
+        return reinterpret_cast<uint8_t *>(p);
+    }
+};
+
+thread_local std::vector<ScratchBlock> free_scratch_blocks;
+
+ScratchBlock take_scratch(size_t size) {
+    ScratchBlock result;
+    if (!free_scratch_blocks.empty()) {
+        result = std::move(free_scratch_blocks.back());
+        free_scratch_blocks.pop_back();
+    }
+    if (result.size < size) {
+        result.data.reset(new uint8_t[size + scratch_alignment]);
+        result.size = size;
+    }
+    return result;
+}
+
+void release_scratch(ScratchBlock block) {
+    free_scratch_blocks.push_back(std::move(block));
+}
+
+size_t align_scratch(size_t size) {
+    return (size + scratch_alignment - 1) & ~(scratch_alignment - 1);
+}
+
+size_t crop_bytes(const TensorPtr &t, const Box &crop) {
+    size_t result = t->type().bytes();
+    for (const Interval &i : crop) {
+        result *= std::max(0, i.extent());
+    }
+    return result;
+}
+
+// Run each tile on the outermost dimension other than the innermost one, so
+// the tiles don't split the vectorized dimension.
+int tile_dim(const TensorPtr &t) {
+    for (int d = t->rank() - 1; d > 0; d--) {
+        if (t->extent(d) > 1) {
+            return d;
+        }
+    }
+    return t->rank() - 1;
+}
+
+struct TiledChainClosure {
+    TiledChainOp *op;
+    int dim;
+    int tile_extent;
+};
+
+}  // namespace
+
+BoundsMap TiledChainOp::map_bounds(int input_idx, int output_idx) const {
+    assert(output_idx == 0);
+    const TensorPtr &in = input(input_idx);
+    const int rank = output()->rank();
+    SmallVector<DimMap, max_rank> dims(rank);
+    for (int d = 0; d < rank; d++) {
+        dims[d].elementwise();
+    }
+    // Walk back along the chain from the output to the op that consumes the input.
+    for (int k = op_count() - 1; k >= 0; k--) {
+        const Op *op_k = op(k);
+        const TensorPtr *prev = k > 0 ? &op(k - 1)->output() : nullptr;
+        int path_input = -1;
+        for (int j = 0; j < op_k->input_count(); j++) {
+            if (op_k->input(j) == in) {
+                path_input = j;
+                break;
+            } else if (prev && op_k->input(j) == *prev) {
+                path_input = j;
+            }
+        }
+        assert(path_input >= 0);
+        const BoundsMap map_k = op_k->map_bounds(path_input, 0);
+        for (int d = 0; d < rank; d++) {
+            dims[d] = compose(map_k.at(d, d), dims[d]);
+        }
+        if (op_k->input(path_input) == in) {
+            break;
+        }
+    }
+    BoundsMap result(in->rank(), rank);
+    for (int d = 0; d < rank; d++) {
+        result.at(d, d) = dims[d];
+    }
+    return result;
+}
+
+bool TiledChainOp::resize_outputs() {
+    for (int i = 0; i < op_count(); i++) {
+        if (!ops_[i]->resize_outputs()) {
+            HLOG(ERROR) << ops_[i]->name() << " does not support resizing its inputs.";
+            return false;
+        }
+    }
+    return true;
+}
+
+void TiledChainOp::execute_tile(const Box &crop) {
+    const int n = op_count();
+
+    // Find the crop of each op's output needed to compute this tile, working
+    // back from the output. The chain inputs are crops of their own buffers.
+    TensorBufferOverrides overrides;
+    std::vector<Box> crops(n);
+    crops[n - 1] = crop;
+    for (int k = n - 1; k >= 0; k--) {
+        Op *op_k = ops_[k].get();
+        for (int j = 0; j < op_k->input_count(); j++) {
+            const TensorPtr &in = op_k->input(j);
+            const Box in_crop = intersect(required_input_crop(op_k, j, crops[k]), in->bounds());
+            if (k > 0 && in == ops_[k - 1]->output()) {
+                crops[k - 1] = in_crop;
+            } else {
+                overrides.set(in.get(), crop_buffer(in->buffer(), in_crop));
+            }
+        }
+    }
+
+    // The intermediate tensors are dense buffers in scratch memory.
+    size_t scratch_size = 0;
+    for (int k = 0; k < n - 1; k++) {
+        scratch_size += align_scratch(crop_bytes(ops_[k]->output(), crops[k]));
+    }
+    ScratchBlock scratch = take_scratch(scratch_size);
+    uint8_t *scratch_data = scratch.aligned();
+    for (int k = 0; k < n - 1; k++) {
+        const TensorPtr &t = ops_[k]->output();
+        SmallVector<halide_dimension_t, max_rank> dims(t->rank());
+        int stride = 1;
+        for (int d = 0; d < t->rank(); d++) {
+            dims[d] = halide_dimension_t(crops[k][d].min, crops[k][d].extent(), stride);
+            stride *= crops[k][d].extent();
+        }
+        overrides.set(t.get(), HalideBuffer<void>(t->type(), scratch_data, t->rank(), dims.data()));
+        scratch_data += align_scratch(crop_bytes(t, crops[k]));
+    }
+    overrides.set(output().get(), crop_buffer(output()->buffer(), crop));
+
+    for (int k = 0; k < n; k++) {
+        ops_[k]->execute();
+    }
+
+    release_scratch(std::move(scratch));
+}
+
+void TiledChainOp::execute() {
+    const TensorPtr &out = output();
+    const int dim = tile_dim(out);
+    const int extent = out->extent(dim);
+
+    // Choose the size of the tiles so everything one tile touches fits in
+    // tile_bytes_. Pools touch more of their inputs than the tile, this is
+    // just an estimate.
+    size_t bytes = 0;
+    for (int i = 0; i < input_count(); i++) {
+        bytes += crop_bytes(input(i), input(i)->bounds());
+    }
+    for (int k = 0; k < op_count(); k++) {
+        bytes += crop_bytes(ops_[k]->output(), ops_[k]->output()->bounds());
+    }
+    const size_t bytes_per_slice = std::max<size_t>(1, bytes / std::max(1, extent));
+    const int tile_extent = std::min<size_t>(extent, std::max<size_t>(1, tile_bytes_ / bytes_per_slice));
+    const int tile_count = ceil_div(extent, tile_extent);
+
+    auto task = [](void *user_context, int tile, uint8_t *closure) -> int {
+        const TiledChainClosure *c = (const TiledChainClosure *)closure;
+        Box crop = c->op->output()->bounds();
+        const int min = crop[c->dim].min + tile * c->tile_extent;
+        crop[c->dim] = Interval(min, std::min(min + c->tile_extent - 1, crop[c->dim].max));
+        c->op->execute_tile(crop);
+        return 0;
+    };
+    TiledChainClosure closure = {this, dim, tile_extent};
+    halide_do_par_for(nullptr, task, 0, tile_count, (uint8_t *)&closure);
+}
+
+void TiledChainOp::dump(std::ostream &os, int indent) const {
+    Op::dump(os, indent);
+    for (const auto &i : ops_) {
+        i->dump(os, indent + 4);
+    }
+    os << "\n";
+}
+
 BoundsMap TransposeOp::map_bounds(int input_idx, int output_idx) const {
     assert(output_idx == 0);
     if (input_idx == 0) {
@@ -1862,6 +2560,12 @@ BoundsMap UpsampleChannelsOp::map_bounds(int input_idx, int output_idx) const {
     return BoundsMap::elementwise(rank).upsample(0, 0, factor_);
 }
 
+bool UpsampleChannelsOp::resize_outputs() {
+    Box bounds = input()->bounds();
+    bounds[0] = with_extent(bounds[0], input()->extent(0) * factor_);
+    return resize_output(0, bounds);
+}
+
 void UpsampleChannelsOp::execute() {
     const TensorPtr &in = input();
     const TensorPtr &out = output();
@@ -1892,6 +2596,7 @@ ACCEPT_AND_MUTATE_IMPL(ConcatenationOp)
 ACCEPT_AND_MUTATE_IMPL(ConvOp)
 ACCEPT_AND_MUTATE_IMPL(DepthwiseConv2DOp)
 ACCEPT_AND_MUTATE_IMPL(ElementwiseProgramOp)
+ACCEPT_AND_MUTATE_IMPL(FullyConnectedOp)
 ACCEPT_AND_MUTATE_IMPL(GatherOp)
 ACCEPT_AND_MUTATE_IMPL(L2NormalizationOp)
 ACCEPT_AND_MUTATE_IMPL(PadOp)
@@ -1903,6 +2608,7 @@ ACCEPT_AND_MUTATE_IMPL(SplitOp)
 ACCEPT_AND_MUTATE_IMPL(ReductionOp)
 ACCEPT_AND_MUTATE_IMPL(ReshapeOp)
 ACCEPT_AND_MUTATE_IMPL(TileConvFilterOp)
+ACCEPT_AND_MUTATE_IMPL(TiledChainOp)
 ACCEPT_AND_MUTATE_IMPL(TransposeOp)
 ACCEPT_AND_MUTATE_IMPL(UpsampleChannelsOp)
 ACCEPT_AND_MUTATE_IMPL(UnaryOp)
@@ -22,6 +22,18 @@ enum class Padding {
     Valid,
 };
 
+// Get the range of 8-bit quantized values allowed by an activation function.
+Interval get_output_range(ActivationFunction activation, const QuantizationInfo &quantization);
+
+// An elementwise program (see elementwise_program.h) that an op runs on its
+// result before writing it to its output. Input 0 of the program is the result
+// of the op, quantized to 16 bits as described by quantization. Input 1 of the
+// program is the op's elementwise input.
+struct OutputProgram {
+    HalideBuffer<int16_t, 2> program;
+    QuantizationInfo quantization;
+};
+
 // This is an abstract helper op for elementwise operations.
 class ElementwiseOp : public Op {
 public:
@@ -30,6 +42,7 @@ public:
     }
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
+    bool resize_outputs() override;
 };
 
 class BinaryOp : public ElementwiseOp {
@@ -55,6 +68,13 @@ public:
         : ElementwiseOp({a, b}, {output}), op_(op), activation_(activation) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+    ActivationFunction activation() const {
+        return activation_;
+    }
+
     void execute() override;
 
     std::string name() const override {
@@ -85,6 +105,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "ConcatenationOp";
@@ -100,6 +121,7 @@ class ConvOp : public Op {
     std::array<int, 2> dilation_;
     Padding padding_;
     ActivationFunction activation_;
+    OutputProgram output_program_;
 
     // calculated in prepare()
     int vector_reduction_ = 0;
@@ -115,6 +137,19 @@ public:
           padding_(padding),
           activation_(activation) {
     }
+    // Make a convolution that runs output_program on its result, with
+    // elementwise_input as the second input of the program.
+    ConvOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias,
+           const TensorPtr &elementwise_input, const TensorPtr &output,
+           std::array<int, 2> stride, std::array<int, 2> dilation, Padding padding,
+           OutputProgram output_program)
+        : Op({input, filter, bias, elementwise_input}, {output}),
+          stride_(stride),
+          dilation_(dilation),
+          padding_(padding),
+          activation_(ActivationFunction::None),
+          output_program_(std::move(output_program)) {
+    }
 
     const TensorPtr &filter() const {
         return Op::input(1);
@@ -122,6 +157,15 @@ public:
     const TensorPtr &bias() const {
         return Op::input(2);
     }
+    const TensorPtr &elementwise_input() const {
+        return Op::input(3);
+    }
+    bool has_output_program() const {
+        return input_count() > 3;
+    }
+    const OutputProgram &output_program() const {
+        return output_program_;
+    }
 
     std::array<int, 2> stride() const {
         return stride_;
@@ -137,10 +181,14 @@ public:
     }
 
     halide_type_t filter_type() const;
+    // The extent of the filter in spatial dimension i (counting from 1, like
+    // the dimensions of the input), whether or not it has been tiled yet.
+    int filter_extent(int i) const;
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     bool prepare() override;
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "ConvOp";
@@ -157,6 +205,7 @@ class DepthwiseConv2DOp : public Op {
     std::array<int, 2> dilation_;
     Padding padding_;
     ActivationFunction activation_;
+    OutputProgram output_program_;
 
     // calculated in prepare()
     int channel_alignment_ = 0;
@@ -172,6 +221,21 @@ public:
           padding_(padding),
           activation_(activation) {
     }
+    // Make a depthwise convolution that runs output_program on its result, with
+    // elementwise_input as the second input of the program. The depth multiplier
+    // must be 1.
+    DepthwiseConv2DOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias,
+                      const TensorPtr &elementwise_input, const TensorPtr &output,
+                      std::array<int, 2> stride, std::array<int, 2> dilation,
+                      Padding padding, OutputProgram output_program)
+        : Op({input, filter, bias, elementwise_input}, {output}),
+          depth_multiplier_(1),
+          stride_(stride),
+          dilation_(dilation),
+          padding_(padding),
+          activation_(ActivationFunction::None),
+          output_program_(std::move(output_program)) {
+    }
 
     int depth_multiplier() const {
         return depth_multiplier_;
@@ -182,6 +246,15 @@ public:
     const TensorPtr &bias() const {
         return Op::input(2);
     }
+    const TensorPtr &elementwise_input() const {
+        return Op::input(3);
+    }
+    bool has_output_program() const {
+        return input_count() > 3;
+    }
+    const OutputProgram &output_program() const {
+        return output_program_;
+    }
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
@@ -200,6 +273,7 @@ public:
 
     bool prepare() override;
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "DepthwiseConv2DOp";
@@ -233,6 +307,59 @@ private:
     OpMutatorFn mutate_impl() const override;
 };
 
+class FullyConnectedOp : public Op {
+    ActivationFunction activation_;
+
+    // The per-channel multipliers and shifts, calculated in prepare().
+    HalideBuffer<int32_t> output_multiplier_;
+    HalideBuffer<int32_t> output_shift_;
+    // The sums of the filter coefficients for each output channel,
+    // calculated on the first call to execute().
+    HalideBuffer<int32_t> filter_sums_;
+    // If the filter is sparse enough, its non-zero blocks packed for
+    // fully_connected_sparse, also calculated on the first call to execute().
+    HalideBuffer<int8_t> sparse_filter_;
+    HalideBuffer<int32_t> sparse_block_offsets_;
+    HalideBuffer<int32_t> sparse_block_counts_;
+    HalideBuffer<int32_t> sparse_filter_sums_;
+
+public:
+    FullyConnectedOp(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &bias, const TensorPtr &output,
+                     ActivationFunction activation)
+        : Op({input, filter, bias}, {output}),
+          activation_(activation) {
+    }
+
+    // Returns true if there is an implementation for the types of these
+    // tensors. The filter must be constant.
+    static bool is_supported(const TensorPtr &input, const TensorPtr &filter, const TensorPtr &output);
+
+    const TensorPtr &filter() const {
+        return Op::input(1);
+    }
+    const TensorPtr &bias() const {
+        return Op::input(2);
+    }
+
+    ActivationFunction activation() const {
+        return activation_;
+    }
+
+    BoundsMap map_bounds(int input_idx, int output_idx) const override;
+
+    bool prepare() override;
+    void execute() override;
+    bool resize_outputs() override;
+
+    std::string name() const override {
+        return "FullyConnectedOp";
+    }
+
+private:
+    void accept_impl(OpVisitor *v) const override;
+    OpMutatorFn mutate_impl() const override;
+};
+
 class GatherOp : public Op {
     const int axis_;
     const int batch_dims_;
@@ -266,6 +393,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "L2NormalizationOp";
@@ -277,6 +405,8 @@ private:
 };
 
 class PadOp : public Op {
+    bool pads_for_consumer_ = false;
+
 public:
     PadOp(const TensorPtr &input, const TensorPtr &padding, const TensorPtr &output)
         : Op({input, padding}, {output}) {
@@ -289,9 +419,26 @@ public:
         return Op::input(1);
     }
 
+    // Whether this pad was added by pad_for_ops() to provide the bounds
+    // required by the op consuming its output. If so, the padding depends
+    // on the shape of the input, and is recomputed by the consumer (via
+    // resize_for_consumer()) when that changes.
+    bool pads_for_consumer() const {
+        return pads_for_consumer_;
+    }
+    void set_pads_for_consumer() {
+        pads_for_consumer_ = true;
+    }
+
+    // Recompute the padding so that the output has the given bounds, centered
+    // around the input (except in dimension 0). Returns false if the output
+    // can't be resized.
+    bool resize_for_consumer(const Box &required);
+
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "PadOp";
@@ -339,7 +486,13 @@ public:
 
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
+    // The region of the input needed to compute the crop of the output,
+    // accounting for the padding. This is not clamped to the bounds of the
+    // input; the pool ignores anything outside of the input buffer.
+    Box input_crop(const Box &output_crop) const;
+
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return std::string("Pool2DOp(") + to_string(op_) + ")";
@@ -395,6 +548,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "ReshapeOp";
@@ -436,6 +590,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "SoftmaxOp";
@@ -457,6 +612,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return block_size_ > 0 ? "SpaceToDepthOp" : "DepthToSpaceOp";
@@ -515,6 +671,46 @@ private:
     OpMutatorFn mutate_impl() const override;
 };
 
+// Executes a chain of ops, each of which consumes the output of the one
+// before it, a tile of the output at a time. The tiles are computed in
+// parallel, and the intermediate tensors live only in per-tile scratch
+// memory, so they stay in cache and are never allocated in the arena.
+// The ops must each map each dimension of their output to the same
+// dimension of their inputs (elementwise ops and pools).
+class TiledChainOp : public Op {
+    std::vector<OpPtr> ops_;
+    int tile_bytes_;
+
+    void execute_tile(const Box &crop);
+
+public:
+    TiledChainOp(std::vector<TensorPtr> inputs, const TensorPtr &output, std::vector<OpPtr> ops, int tile_bytes)
+        : Op(std::move(inputs), {output}), ops_(std::move(ops)), tile_bytes_(tile_bytes) {
+    }
+
+    int op_count() const {
+        return ops_.size();
+    }
+    const Op *op(int i) const {
+        return ops_[i].get();
+    }
+
+    BoundsMap map_bounds(int input_idx, int output_idx) const override;
+
+    void execute() override;
+    bool resize_outputs() override;
+
+    void dump(std::ostream &os, int indent = 0) const override;
+
+    std::string name() const override {
+        return "TiledChainOp";
+    }
+
+private:
+    void accept_impl(OpVisitor *v) const override;
+    OpMutatorFn mutate_impl() const override;
+};
+
 class TransposeOp : public Op {
 public:
     TransposeOp(const TensorPtr &input, const TensorPtr &dims, const TensorPtr &output)
@@ -556,6 +752,10 @@ public:
         : ElementwiseOp({input}, {output}), op_(op) {
     }
 
+    Operator op() const {
+        return op_;
+    }
+
     void execute() override;
 
     std::string name() const override {
@@ -578,6 +778,7 @@ public:
     BoundsMap map_bounds(int input_idx, int output_idx) const override;
 
     void execute() override;
+    bool resize_outputs() override;
 
     std::string name() const override {
         return "UpsampleChannelsOp";
@@ -599,6 +800,7 @@ protected:
     friend class ConvOp;
     friend class DepthwiseConv2DOp;
     friend class ElementwiseProgramOp;
+    friend class FullyConnectedOp;
     friend class GatherOp;
     friend class L2NormalizationOp;
     friend class PadOp;
@@ -610,6 +812,7 @@ protected:
     friend class SpaceDepthOp;
     friend class SplitOp;
     friend class TileConvFilterOp;
+    friend class TiledChainOp;
     friend class TransposeOp;
     friend class UnaryOp;
     friend class UpsampleChannelsOp;
@@ -622,6 +825,7 @@ protected:
     virtual void visit(const ConvOp *op) { visit_leaf(op); }
     virtual void visit(const DepthwiseConv2DOp *op) { visit_leaf(op); }
     virtual void visit(const ElementwiseProgramOp *op) { visit_leaf(op); }
+    virtual void visit(const FullyConnectedOp *op) { visit_leaf(op); }
     virtual void visit(const GatherOp *op) { visit_leaf(op); }
     virtual void visit(const L2NormalizationOp *op) { visit_leaf(op); }
     virtual void visit(const PadOp *op) { visit_leaf(op); }
@@ -633,6 +837,7 @@ protected:
     virtual void visit(const SpaceDepthOp *op) { visit_leaf(op); }
     virtual void visit(const SplitOp *op) { visit_leaf(op); }
     virtual void visit(const TileConvFilterOp *op) { visit_leaf(op); }
+    virtual void visit(const TiledChainOp *op) { visit_leaf(op); }
     virtual void visit(const TransposeOp *op) { visit_leaf(op); }
     virtual void visit(const UnaryOp *op) { visit_leaf(op); }
     virtual void visit(const UpsampleChannelsOp *op) { visit_leaf(op); }
@@ -657,6 +862,7 @@ protected:
     friend class ConvOp;
     friend class DepthwiseConv2DOp;
     friend class ElementwiseProgramOp;
+    friend class FullyConnectedOp;
     friend class GatherOp;
     friend class L2NormalizationOp;
     friend class PadOp;
@@ -668,6 +874,7 @@ protected:
     friend class SpaceDepthOp;
     friend class SplitOp;
     friend class TileConvFilterOp;
+    friend class TiledChainOp;
     friend class TransposeOp;
     friend class UnaryOp;
     friend class UpsampleChannelsOp;
@@ -680,6 +887,7 @@ protected:
     virtual OpPtr visit(std::unique_ptr<ConvOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<DepthwiseConv2DOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<ElementwiseProgramOp> op) { return visit_leaf(std::move(op)); }
+    virtual OpPtr visit(std::unique_ptr<FullyConnectedOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<GatherOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<L2NormalizationOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<PadOp> op) { return visit_leaf(std::move(op)); }
@@ -691,6 +899,7 @@ protected:
     virtual OpPtr visit(std::unique_ptr<SpaceDepthOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<SplitOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<TileConvFilterOp> op) { return visit_leaf(std::move(op)); }
+    virtual OpPtr visit(std::unique_ptr<TiledChainOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<TransposeOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<UnaryOp> op) { return visit_leaf(std::move(op)); }
     virtual OpPtr visit(std::unique_ptr<UpsampleChannelsOp> op) { return visit_leaf(std::move(op)); }
@@ -0,0 +1,312 @@
+#include "interpreter/prepared_model.h"
+#include "util/error_util.h"
+#include "util/file_util.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hannk {
+
+namespace {
+
+// The file starts with a Header, followed by a table describing the
+// constants and blocks, followed by the data of the constants. Everything
+// is stored in native byte order; the version field doubles as a byte
+// order check.
+constexpr char kMagic[8] = "hannkpm";
+constexpr uint32_t kVersion = 1;
+
+// The data of each constant is aligned to this (relative to the start of
+// the file, which mmap aligns to a page).
+constexpr size_t kDataAlignment = 128;
+
+struct Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t constant_count;
+    uint32_t block_count;
+    uint32_t reserved;
+    uint64_t arena_size;
+    uint64_t alignment;
+    uint64_t data_offset;
+};
+
+size_t align_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+template<typename T>
+void append(std::string &s, const T &value) {
+    s.append((const char *)&value, sizeof(value));
+}
+
+void append_string(std::string &s, const std::string &value) {
+    append(s, (uint32_t)value.size());
+    s.append(value);
+}
+
+// Reads the table, failing (rather than reading out of bounds) if the
+// file is truncated.
+class Reader {
+    const char *p_;
+    const char *end_;
+
+public:
+    Reader(const char *begin, const char *end)
+        : p_(begin), end_(end) {
+    }
+
+    bool ok = true;
+
+    template<typename T>
+    T read() {
+        T value = T();
+        if (ok && (size_t)(end_ - p_) >= sizeof(T)) {
+            memcpy(&value, p_, sizeof(T));
+            p_ += sizeof(T);
+        } else {
+            ok = false;
+        }
+        return value;
+    }
+
+    std::string read_string() {
+        const uint32_t size = read<uint32_t>();
+        if (!ok || (size_t)(end_ - p_) < size) {
+            ok = false;
+            return std::string();
+        }
+        std::string value(p_, size);
+        p_ += size;
+        return value;
+    }
+};
+
+bool is_saveable(const Tensor &t) {
+    const halide_buffer_t *buf = t.buffer().raw_buffer();
+    if (!t.is_allocated() || !t.is_dense()) {
+        return false;
+    }
+    for (int d = 0; d < buf->dimensions; d++) {
+        if (buf->dim[d].stride < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+/*static*/ std::unique_ptr<PreparedModel> PreparedModel::load(const std::string &path) {
+    std::unique_ptr<PreparedModel> result(new PreparedModel());
+#ifndef _WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        HLOG(ERROR) << "Unable to open prepared model: " << path;
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        HLOG(ERROR) << "Unable to read prepared model: " << path;
+        return nullptr;
+    }
+    // The mapping is private and writable so that the folded constants can
+    // be used like any other allocated Tensor; nothing writes to them.
+    void *mapping = mmap(nullptr, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        HLOG(ERROR) << "Unable to map prepared model: " << path;
+        return nullptr;
+    }
+    result->mapping_ = mapping;
+    result->mapping_size_ = (size_t)st.st_size;
+#else
+    result->contents_ = read_entire_file(path);
+    result->mapping_ = result->contents_.data();
+    result->mapping_size_ = result->contents_.size();
+#endif
+    if (!result->parse()) {
+        HLOG(ERROR) << "Invalid prepared model: " << path;
+        return nullptr;
+    }
+    return result;
+}
+
+bool PreparedModel::parse() {
+    const char *begin = (const char *)mapping_;
+    if (mapping_size_ < sizeof(Header)) {
+        return false;
+    }
+    Header header;
+    memcpy(&header, begin, sizeof(header));
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion) {
+        return false;
+    }
+    if (header.data_offset > mapping_size_) {
+        return false;
+    }
+    arena_size_ = header.arena_size;
+    alignment_ = header.alignment;
+
+    Reader r(begin + sizeof(Header), begin + header.data_offset);
+    for (uint32_t i = 0; i < header.constant_count && r.ok; i++) {
+        std::string name = r.read_string();
+        Constant c;
+        c.type.code = (halide_type_code_t)r.read<uint8_t>();
+        c.type.bits = r.read<uint8_t>();
+        c.type.lanes = r.read<uint16_t>();
+        const uint32_t rank = r.read<uint32_t>();
+        if (rank > max_rank) {
+            return false;
+        }
+        for (uint32_t d = 0; d < rank; d++) {
+            const int32_t min = r.read<int32_t>();
+            const int32_t extent = r.read<int32_t>();
+            const int32_t stride = r.read<int32_t>();
+            c.dims.emplace_back(min, extent, stride);
+        }
+        const uint64_t offset = r.read<uint64_t>();
+        const uint64_t size = r.read<uint64_t>();
+        if (offset % kDataAlignment != 0 || offset > mapping_size_ || size > mapping_size_ - offset) {
+            return false;
+        }
+        c.data = begin + offset;
+        c.size_in_bytes = size;
+        constants_[name] = std::move(c);
+    }
+    for (uint32_t i = 0; i < header.block_count && r.ok; i++) {
+        Block b;
+        b.key = r.read_string();
+        b.size = r.read<uint64_t>();
+        b.first_use = r.read<int32_t>();
+        b.last_use = r.read<int32_t>();
+        b.offset = r.read<uint64_t>();
+        blocks_.push_back(std::move(b));
+    }
+    return r.ok;
+}
+
+/*static*/ bool PreparedModel::save(const std::string &path,
+                                    const std::vector<TensorPtr> &constants,
+                                    const std::vector<Block> &blocks,
+                                    size_t arena_size, size_t alignment) {
+    std::vector<const Tensor *> saved;
+    for (const TensorPtr &t : constants) {
+        if (is_saveable(*t)) {
+            saved.push_back(t.get());
+        }
+    }
+
+    // The offsets of the data depend on the size of the table, so compute
+    // the size of the table first.
+    auto make_table = [&](size_t data_offset) {
+        std::string table;
+        size_t offset = data_offset;
+        for (const Tensor *t : saved) {
+            const halide_buffer_t *buf = t->buffer().raw_buffer();
+            append_string(table, t->name());
+            append(table, (uint8_t)buf->type.code);
+            append(table, (uint8_t)buf->type.bits);
+            append(table, (uint16_t)buf->type.lanes);
+            append(table, (uint32_t)buf->dimensions);
+            for (int d = 0; d < buf->dimensions; d++) {
+                append(table, (int32_t)buf->dim[d].min);
+                append(table, (int32_t)buf->dim[d].extent);
+                append(table, (int32_t)buf->dim[d].stride);
+            }
+            const size_t size = t->buffer().size_in_bytes();
+            append(table, (uint64_t)offset);
+            append(table, (uint64_t)size);
+            offset = align_up(offset + size, kDataAlignment);
+        }
+        for (const Block &b : blocks) {
+            append_string(table, b.key);
+            append(table, (uint64_t)b.size);
+            append(table, (int32_t)b.first_use);
+            append(table, (int32_t)b.last_use);
+            append(table, (uint64_t)b.offset);
+        }
+        return table;
+    };
+    const size_t table_size = make_table(0).size();
+    const size_t data_offset = align_up(sizeof(Header) + table_size, kDataAlignment);
+    const std::string table = make_table(data_offset);
+
+    Header header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.constant_count = (uint32_t)saved.size();
+    header.block_count = (uint32_t)blocks.size();
+    header.reserved = 0;
+    header.arena_size = arena_size;
+    header.alignment = alignment;
+    header.data_offset = data_offset;
+
+    std::ofstream f(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!f.is_open()) {
+        HLOG(ERROR) << "Unable to open file: " << path;
+        return false;
+    }
+    const std::string padding(kDataAlignment, '\0');
+    f.write((const char *)&header, sizeof(header));
+    f.write(table.data(), table.size());
+    f.write(padding.data(), data_offset - sizeof(Header) - table.size());
+    for (const Tensor *t : saved) {
+        const size_t size = t->buffer().size_in_bytes();
+        f.write((const char *)t->buffer().data(), size);
+        f.write(padding.data(), align_up(size, kDataAlignment) - size);
+    }
+    f.close();
+    if (!f.good()) {
+        HLOG(ERROR) << "Unable to write file: " << path;
+        return false;
+    }
+    return true;
+}
+
+PreparedModel::~PreparedModel() {
+#ifndef _WIN32
+    if (mapping_) {
+        munmap(mapping_, mapping_size_);
+    }
+#endif
+}
+
+const PreparedModel::Constant *PreparedModel::find_constant(const Tensor &t) const {
+    auto it = constants_.find(t.name());
+    if (it == constants_.end()) {
+        return nullptr;
+    }
+    const Constant &c = it->second;
+    const halide_buffer_t *buf = t.buffer().raw_buffer();
+    if (c.type != buf->type || (int)c.dims.size() != buf->dimensions) {
+        return nullptr;
+    }
+    for (int d = 0; d < buf->dimensions; d++) {
+        if (c.dims[d] != buf->dim[d]) {
+            return nullptr;
+        }
+    }
+    if (c.size_in_bytes != t.buffer().size_in_bytes()) {
+        return nullptr;
+    }
+    return &c;
+}
+
+const std::vector<PreparedModel::Block> *PreparedModel::blocks(size_t alignment) const {
+    if (alignment != alignment_ || blocks_.empty()) {
+        return nullptr;
+    }
+    return &blocks_;
+}
+
+}  // namespace hannk
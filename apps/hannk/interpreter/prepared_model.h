@@ -0,0 +1,94 @@
+#ifndef HANNK_PREPARED_MODEL_H
+#define HANNK_PREPARED_MODEL_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "interpreter/tensor.h"
+
+namespace hannk {
+
+// A PreparedModel holds the results of the expensive parts of
+// Interpreter::prepare() for one model, so that they can be saved after
+// preparing the model once and reused when it is loaded again: the
+// constant Tensors computed by fold_constants() (most importantly, the
+// tiled filters of the convolutions), and the offsets chosen by the
+// allocation planner. The op graph itself is still rebuilt from the model
+// file, which is cheap; loading a PreparedModel is a single mmap, after
+// which the folded constants point directly into the mapped file.
+//
+// Everything in a PreparedModel is looked up by name when it is used, and
+// checked against the Tensors of the model being prepared; anything that
+// doesn't match (e.g. because the PreparedModel was saved for a different
+// model or an older version of hannk) is ignored and recomputed as usual.
+class PreparedModel {
+public:
+    struct Constant {
+        halide_type_t type;
+        TensorDimensions dims;
+        const void *data = nullptr;
+        size_t size_in_bytes = 0;
+    };
+
+    // The placement of one block of storage in the arena. The key is the
+    // name of one of the Tensors sharing the storage.
+    struct Block {
+        std::string key;
+        size_t size = 0;
+        int first_use = 0;
+        int last_use = 0;
+        size_t offset = 0;
+    };
+
+    // Map the PreparedModel saved at the given path. Returns null if the
+    // file can't be read or isn't a valid PreparedModel.
+    static std::unique_ptr<PreparedModel> load(const std::string &path);
+
+    // Save the given folded constants and allocation plan to the given path.
+    // Returns false if an error occurs.
+    [[nodiscard]] static bool save(const std::string &path,
+                                   const std::vector<TensorPtr> &constants,
+                                   const std::vector<Block> &blocks,
+                                   size_t arena_size, size_t alignment);
+
+    ~PreparedModel();
+
+    // Return the constant saved for the Tensor, or null if there is no
+    // saved constant with the same name, type, and shape.
+    const Constant *find_constant(const Tensor &t) const;
+
+    // Return the saved allocation plan, or null if it was saved with a
+    // different alignment.
+    const std::vector<Block> *blocks(size_t alignment) const;
+
+    size_t arena_size() const {
+        return arena_size_;
+    }
+
+    // Not movable or copyable: Tensors point into the mapping.
+    PreparedModel(const PreparedModel &) = delete;
+    PreparedModel &operator=(const PreparedModel &) = delete;
+    PreparedModel(PreparedModel &&) = delete;
+    PreparedModel &operator=(PreparedModel &&) = delete;
+
+private:
+    PreparedModel() = default;
+
+    bool parse();
+
+    void *mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    // Used instead of the mapping where mmap isn't available.
+    std::vector<char> contents_;
+
+    std::unordered_map<std::string, Constant> constants_;
+    std::vector<Block> blocks_;
+    size_t arena_size_ = 0;
+    size_t alignment_ = 0;
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_PREPARED_MODEL_H
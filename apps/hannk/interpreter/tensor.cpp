@@ -22,6 +22,16 @@ HalideBuffer<void> make_unallocated_buffer(halide_type_t type, const Box &bounds
 
 }  // namespace
 
+thread_local TensorBufferOverrides *TensorBufferOverrides::current_ = nullptr;
+
+void TensorBufferOverrides::set(const Tensor *t, HalideBuffer<void> buffer) {
+    if (HalideBuffer<void> *b = find(t)) {
+        *b = std::move(buffer);
+    } else {
+        overrides_.emplace_back(t, std::move(buffer));
+    }
+}
+
 TensorStorage::TensorStorage(halide_type_t type, int rank, const halide_dimension_t *dimensions)
     : buffer(type, nullptr, rank, dimensions) {
 }
@@ -106,6 +116,16 @@ void Tensor::allocate_from_arena_pointer(void *host) {
     finish_buffer_allocation();
 }
 
+void Tensor::reallocate_from_arena_pointer(void *host) {
+    assert(!is_dynamic());
+    assert(!is_external());
+    assert(is_allocated());
+
+    storage()->buffer.raw_buffer()->host = (uint8_t *)host;
+
+    finish_buffer_allocation();
+}
+
 void Tensor::allocate_from_heap() {
     assert(!is_dynamic());
     assert(!is_external());
@@ -197,6 +217,16 @@ void Tensor::resize_dynamic(const Box &new_shape) {
     storage_ = nullptr;
 }
 
+void Tensor::resize(const Box &new_shape) {
+    assert(!is_constant());
+    assert(!is_external());
+    assert(!is_dynamic());
+    assert(alias_type() == AliasType::None);
+
+    buffer_ = make_unallocated_buffer(buffer_.type(), new_shape);
+    storage_ = nullptr;
+}
+
 bool Tensor::has_external_alias() const {
     if (alias_info_ != nullptr) {
         for (const auto &weak : alias_info_->aliases) {
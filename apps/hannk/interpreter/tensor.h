@@ -62,6 +62,48 @@ public:
 };
 using TensorStoragePtr = std::shared_ptr<TensorStorage>;
 
+// While a TensorBufferOverrides is alive, buffer() and raw_buffer() of the
+// Tensors in it return the buffers given here instead of their own, on the
+// thread that created it (only). This lets an op be executed on a crop of its
+// Tensors, or with some of its Tensors held in scratch memory, without
+// changing the Tensors themselves, which other threads may be using.
+class TensorBufferOverrides {
+    std::vector<std::pair<const Tensor *, HalideBuffer<void>>> overrides_;
+    TensorBufferOverrides *previous_;
+
+    static thread_local TensorBufferOverrides *current_;
+
+    friend class Tensor;
+
+    HalideBuffer<void> *find(const Tensor *t) {
+        for (auto &i : overrides_) {
+            if (i.first == t) {
+                return &i.second;
+            }
+        }
+        return nullptr;
+    }
+
+public:
+    TensorBufferOverrides()
+        : previous_(current_) {
+        current_ = this;
+    }
+    ~TensorBufferOverrides() {
+        assert(current_ == this);
+        current_ = previous_;
+    }
+
+    // Use buffer in place of the buffer of t.
+    void set(const Tensor *t, HalideBuffer<void> buffer);
+
+    // Neither movable nor copyable.
+    TensorBufferOverrides(const TensorBufferOverrides &) = delete;
+    TensorBufferOverrides &operator=(const TensorBufferOverrides &) = delete;
+    TensorBufferOverrides(TensorBufferOverrides &&) = delete;
+    TensorBufferOverrides &operator=(TensorBufferOverrides &&) = delete;
+};
+
 enum class AliasType {
     None,
     Offset,    // The aliased Tensors are translated/cropped views of the same buffer.
@@ -121,6 +163,16 @@ class Tensor {
 
     void finish_buffer_allocation();
 
+    // The buffer to use on this thread; see TensorBufferOverrides.
+    HalideBuffer<void> &current_buffer() {
+        HalideBuffer<void> *b = TensorBufferOverrides::current_ ? TensorBufferOverrides::current_->find(this) : nullptr;
+        return b ? *b : buffer_;
+    }
+    const HalideBuffer<void> &current_buffer() const {
+        HalideBuffer<void> *b = TensorBufferOverrides::current_ ? TensorBufferOverrides::current_->find(this) : nullptr;
+        return b ? *b : buffer_;
+    }
+
     bool has_external_alias() const;
 
 public:
@@ -213,16 +265,16 @@ public:
 
     template<class T = void>
     const HalideBuffer<T> &buffer() {
-        return buffer_.as<T>();
+        return current_buffer().as<T>();
     }
 
     template<class T = void>
     const HalideBuffer<const T> &buffer() const {
-        return buffer_.as_const().as<const T>();
+        return current_buffer().as_const().as<const T>();
     }
 
     halide_buffer_t *raw_buffer() {
-        return buffer_.raw_buffer();
+        return current_buffer().raw_buffer();
     }
 
     bool is_allocated() const {
@@ -230,9 +282,18 @@ public:
     }
     void allocate_from_heap();
     void allocate_from_arena_pointer(void *host);
+    // Like allocate_from_arena_pointer(), but for a Tensor that is already
+    // allocated in an arena that has since moved.
+    void reallocate_from_arena_pointer(void *host);
 
     void resize_dynamic(const Box &new_shape);
 
+    // Change the bounds of a Tensor that is allocated from an arena (or is
+    // not allocated yet). The Tensor is left unallocated, and must be placed
+    // in the arena again before it is used. It is an error to call this on a
+    // Tensor that is constant, external, dynamic, or aliased.
+    void resize(const Box &new_shape);
+
     AliasType alias_type() const {
         return alias_info_ != nullptr ? alias_info_->alias_type : AliasType::None;
     }
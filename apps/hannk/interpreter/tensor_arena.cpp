@@ -0,0 +1,144 @@
+#include "interpreter/tensor_arena.h"
+#include "util/error_util.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+namespace hannk {
+
+TensorArena::Allocation::Allocation(std::shared_ptr<TensorArena> arena, int id)
+    : arena_(std::move(arena)), id_(id) {
+}
+
+TensorArena::Allocation::~Allocation() {
+    if (arena_) {
+        arena_->remove(id_);
+    }
+}
+
+TensorArena::Allocation::Allocation(Allocation &&other)
+    : arena_(std::move(other.arena_)), id_(other.id_) {
+    other.arena_ = nullptr;
+}
+
+TensorArena::Allocation &TensorArena::Allocation::operator=(Allocation &&other) {
+    if (this != &other) {
+        if (arena_) {
+            arena_->remove(id_);
+        }
+        arena_ = std::move(other.arena_);
+        id_ = other.id_;
+        other.arena_ = nullptr;
+    }
+    return *this;
+}
+
+int TensorArena::add(size_t size, size_t alignment, std::vector<Placement> placements) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HCHECK(!executing_) << "Can't prepare an Interpreter while another one sharing its TensorArena is executing.";
+    HCHECK(alignment > 0 && (alignment & (alignment - 1)) == 0);
+
+    const int id = next_id_++;
+    const Layout &layout = layouts_[id] = Layout{size, alignment, std::move(placements)};
+    if (memory_ == nullptr || size > size_ || alignment > alignment_) {
+        reallocate();
+    } else {
+        place(layout);
+    }
+    return id;
+}
+
+void TensorArena::remove(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HCHECK(!executing_) << "Can't destroy an Interpreter while another one sharing its TensorArena is executing.";
+    auto it = layouts_.find(id);
+    HCHECK(it != layouts_.end());
+    layouts_.erase(it);
+
+    // Give the memory back if the largest remaining layout is smaller.
+    size_t size_needed = 0;
+    for (const auto &l : layouts_) {
+        size_needed = std::max(size_needed, l.second.size);
+    }
+    if (layouts_.empty()) {
+        memory_.reset();
+        base_ = nullptr;
+        size_ = 0;
+        alignment_ = 1;
+    } else if (size_needed < size_) {
+        reallocate();
+    }
+}
+
+void TensorArena::update(int id, size_t size, size_t alignment, std::vector<Placement> placements) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    HCHECK(!executing_) << "Can't resize an Interpreter while another one sharing its TensorArena is executing.";
+    HCHECK(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    auto it = layouts_.find(id);
+    HCHECK(it != layouts_.end());
+
+    Layout &layout = it->second;
+    layout.size = std::max(layout.size, size);
+    layout.alignment = std::max(layout.alignment, alignment);
+    layout.placements = std::move(placements);
+    if (layout.size > size_ || layout.alignment > alignment_) {
+        reallocate();
+    } else {
+        place(layout);
+    }
+}
+
+size_t TensorArena::memory_size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return size_;
+}
+
+void TensorArena::begin_execution() {
+    const bool was_executing = executing_.exchange(true);
+    HCHECK(!was_executing) << "Interpreters sharing a TensorArena must not execute concurrently.";
+}
+
+void TensorArena::end_execution() {
+    executing_ = false;
+}
+
+void TensorArena::reallocate() {
+    size_t size = 0;
+    size_t alignment = 1;
+    for (const auto &l : layouts_) {
+        size = std::max(size, l.second.size);
+        alignment = std::max(alignment, l.second.alignment);
+    }
+
+    // Free the old memory first, so we don't need room for both.
+    memory_.reset();
+
+    // Be sure to over-allocate for alignment.
+    memory_.reset(new char[size + alignment]);
+    assert(memory_ != nullptr);
+
+    // Make sure that the 'base' we start from is aligned.
+    base_ = (char *)(((uintptr_t)memory_.get() + alignment - 1) & ~(alignment - 1));
+    size_ = size;
+    alignment_ = alignment;
+
+    for (const auto &l : layouts_) {
+        place(l.second);
+    }
+}
+
+void TensorArena::place(const Layout &layout) {
+    for (const auto &p : layout.placements) {
+        char *new_host = base_ + p.offset;
+        for (const auto &t : p.tensors) {
+            if (t->is_allocated()) {
+                t->reallocate_from_arena_pointer(new_host);
+            } else {
+                t->allocate_from_arena_pointer(new_host);
+            }
+        }
+    }
+}
+
+}  // namespace hannk
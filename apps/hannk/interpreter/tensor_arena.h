@@ -0,0 +1,121 @@
+#ifndef HANNK_TENSOR_ARENA_H
+#define HANNK_TENSOR_ARENA_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "interpreter/tensor.h"
+
+namespace hannk {
+
+// TensorArena owns the memory that Interpreters allocate their Tensors from.
+// By default, each Interpreter gets an arena of its own, but several
+// Interpreters can share one (via InterpreterOptions::arena), in which case
+// the arena is only as large as the largest of their layouts, rather than
+// the sum of them. This is only safe if the Interpreters never execute
+// concurrently; it is intended for (e.g.) a pipeline of models that run one
+// after another, or models that are alive at the same time but only one of
+// which is in use at any given moment.
+//
+// Note that the Tensors of all the Interpreters sharing an arena overlap,
+// so the contents of any of them (including the inputs and outputs) are
+// clobbered by executing a different Interpreter. Also, preparing (or
+// destroying) an Interpreter can change the size of the arena, moving all
+// of the Tensors in it, so pointers into them should not be retained
+// across those calls.
+class TensorArena {
+public:
+    // A group of Tensors that all share the same storage, and the offset
+    // of that storage from the start of the arena.
+    struct Placement {
+        size_t offset;
+        std::vector<TensorPtr> tensors;
+    };
+
+    // Removes the Tensors it was created for from the arena when destroyed.
+    class Allocation {
+        std::shared_ptr<TensorArena> arena_;
+        int id_ = -1;
+
+    public:
+        Allocation() = default;
+        Allocation(std::shared_ptr<TensorArena> arena, int id);
+        ~Allocation();
+
+        TensorArena *arena() const {
+            return arena_.get();
+        }
+
+        // See TensorArena::update().
+        void update(size_t size, size_t alignment, std::vector<Placement> placements) {
+            arena_->update(id_, size, alignment, std::move(placements));
+        }
+
+        // Movable but not copyable.
+        Allocation(const Allocation &) = delete;
+        Allocation &operator=(const Allocation &) = delete;
+        Allocation(Allocation &&other);
+        Allocation &operator=(Allocation &&other);
+    };
+
+    TensorArena() = default;
+
+    // Point the given Tensors into the arena, which must be at least 'size'
+    // bytes long and aligned to 'alignment' (a power of two) to hold them.
+    // The arena is reallocated if it is too small, which moves every other
+    // Tensor in it as well. Return an id to pass to remove().
+    int add(size_t size, size_t alignment, std::vector<Placement> placements);
+
+    // Forget the Tensors added with the given id, shrinking the arena if it
+    // is now larger than needed.
+    void remove(int id);
+
+    // Replace the Tensors added with the given id (e.g. because they have
+    // been resized). The size reserved for the id only ever grows, so
+    // switching back and forth between layouts of different sizes doesn't
+    // reallocate the arena after the first time.
+    void update(int id, size_t size, size_t alignment, std::vector<Placement> placements);
+
+    // The number of usable bytes in the arena.
+    size_t memory_size() const;
+
+    // Bracket a call to execute() on an Interpreter using this arena; used
+    // to enforce that Interpreters sharing an arena never run concurrently.
+    void begin_execution();
+    void end_execution();
+
+    // Not movable or copyable: Tensors point into it.
+    TensorArena(const TensorArena &) = delete;
+    TensorArena &operator=(const TensorArena &) = delete;
+    TensorArena(TensorArena &&) = delete;
+    TensorArena &operator=(TensorArena &&) = delete;
+
+private:
+    struct Layout {
+        size_t size;
+        size_t alignment;
+        std::vector<Placement> placements;
+    };
+
+    // Guards everything below, except executing_.
+    mutable std::mutex mutex_;
+    std::map<int, Layout> layouts_;
+    int next_id_ = 0;
+    std::unique_ptr<char[]> memory_;
+    char *base_ = nullptr;
+    size_t size_ = 0;
+    size_t alignment_ = 1;
+    std::atomic<bool> executing_{false};
+
+    // Reallocate the memory to fit the largest layout, and point all the
+    // Tensors into the new memory.
+    void reallocate();
+    void place(const Layout &layout);
+};
+
+}  // namespace hannk
+
+#endif  // HANNK_TENSOR_ARENA_H
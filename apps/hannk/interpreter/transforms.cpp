@@ -1,6 +1,11 @@
 #include "interpreter/transforms.h"
+#include "halide/constants.h"
+#include "interpreter/elementwise_program.h"
 #include "util/small_vector.h"
 
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
 #include <unordered_set>
 
 namespace hannk {
@@ -158,8 +163,10 @@ class InPlace : public OpMutator {
     using OpMutator::visit;
 
     // We can alias two tensors if the input is not used after the output is written,
-    // and we meet a number of other requirements.
-    bool maybe_alias_tensors(TensorPtr input, TensorPtr output, TensorOffset offset = {}) const {
+    // and we meet a number of other requirements. If the op never writes the part of
+    // the output that aliases the input, the input can have other consumers.
+    bool maybe_alias_tensors(TensorPtr input, TensorPtr output, TensorOffset offset = {},
+                             bool allow_other_consumers = false) const {
         // We can't alias an input that is an input or output of the root graph.
         // TODO: We could, if we don't change the shape.
         if (is_root_input_or_output(input)) {
@@ -168,7 +175,7 @@ class InPlace : public OpMutator {
 
         // If the input is used anywhere else, we should not alias it.
         // TODO: This is conservative, we could alias it if it is the *last* use.
-        if (input->consumers().size() != 1) {
+        if (input->consumers().size() != 1 && !allow_other_consumers) {
             return false;
         }
 
@@ -265,7 +272,13 @@ class InPlace : public OpMutator {
             offset[d] = padding(0, d);
         }
 
-        maybe_alias_tensors(op->input(), op->output(), offset);
+        // When the input and output are aliased, PadOp only writes the padding,
+        // unless it pads dimension 0 (see PadOp::execute). This makes the padding
+        // a boundary condition on the storage of the input, so the producer of the
+        // input writes directly into the padded buffer, even if the input is also
+        // used by other ops.
+        const bool pads_dim0 = op->input()->rank() > 0 && op->input()->bounds()[0] != op->output()->bounds()[0];
+        maybe_alias_tensors(op->input(), op->output(), offset, !pads_dim0);
         return op;
     }
 
@@ -304,6 +317,297 @@ OpPtr in_place(OpPtr op) {
 
 namespace {
 
+bool same_bounds(const Box &a, const Box &b) {
+    return is_subset_of(a, b) && is_subset_of(b, a);
+}
+
+bool is_uint8(const TensorPtr &t) {
+    return t->type() == halide_type_of<uint8_t>();
+}
+
+bool is_quantized_activation(ActivationFunction activation) {
+    switch (activation) {
+    case ActivationFunction::None:
+    case ActivationFunction::Relu:
+    case ActivationFunction::Relu6:
+    case ActivationFunction::ReluN1To1:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Find a multiplier and shift such that x ~= multiplier / 2^shift, where
+// multiplier is a 16-bit value with as much precision as possible.
+bool get_multiplier_i16(double x, int16_t &multiplier, int16_t &shift) {
+    if (x == 0.0) {
+        multiplier = 0;
+        shift = 0;
+        return true;
+    }
+    int exponent;
+    double mantissa = std::frexp(std::abs(x), &exponent);
+    int m = (int)std::lround(mantissa * (1 << 15));
+    int s = 15 - exponent;
+    if (m == 1 << 15) {
+        m /= 2;
+        s -= 1;
+    }
+    // The shift of MulShift must be non-negative, and must be less than the
+    // number of bits in the widened product.
+    if (s < 0 || s >= 31) {
+        return false;
+    }
+    multiplier = (int16_t)(x < 0 ? -m : m);
+    shift = (int16_t)s;
+    return true;
+}
+
+int16_t saturate_i16(double x) {
+    return (int16_t)std::max(-32768.0, std::min(32767.0, std::round(x)));
+}
+
+// Build an elementwise program that computes `op` of the result of a
+// convolution producing conv_output (after the convolution's activation)
+// and other, followed by the activation of `op` and requantization to output.
+// If conv_is_rhs is true, the convolution result is the second operand of op.
+// Returns false if the quantization parameters make this impossible.
+bool make_output_program(const TensorPtr &conv_output, ActivationFunction conv_activation,
+                         const TensorPtr &other, BinaryOp::Operator op, bool conv_is_rhs,
+                         ActivationFunction activation, const TensorPtr &output,
+                         OutputProgram &result) {
+    const QuantizationInfo &conv_q = conv_output->quantization();
+    const QuantizationInfo &other_q = other->quantization();
+    const QuantizationInfo &output_q = output->quantization();
+
+    const double conv_scale = conv_q.uniform_scale();
+    const double other_scale = other_q.uniform_scale();
+    const double output_scale = output_q.uniform_scale();
+    const int conv_zero = conv_q.uniform_zero();
+    const int other_zero = other_q.uniform_zero();
+    const int output_zero = output_q.uniform_zero();
+
+    // Each instruction in the program computes a 16-bit result. The result of
+    // the convolution is passed to the program with some extra bits of precision
+    // below its quantization.
+    int precision_shift = 0;
+    double conv_multiplier = 0.0;
+    if (op == BinaryOp::Add || op == BinaryOp::Sub) {
+        // Use as much precision as possible, leaving room for the sum.
+        const double max_ratio = std::max(conv_scale, other_scale) / output_scale;
+        while (precision_shift < add_input_shift &&
+               256 * max_ratio * (1 << (precision_shift + 1)) <= (1 << 14)) {
+            precision_shift++;
+        }
+        if (256 * max_ratio * (1 << precision_shift) > (1 << 14)) {
+            return false;
+        }
+        // The convolution result is in the units of the output.
+        conv_multiplier = conv_scale / output_scale * (1 << precision_shift);
+    } else {
+        assert(op == BinaryOp::Mul);
+        precision_shift = mul_input_shift;
+        conv_multiplier = 1 << precision_shift;
+    }
+
+    result.quantization.scale = {(float)(conv_scale / conv_multiplier)};
+    result.quantization.zero = {0};
+    result.quantization.dimension = conv_q.dimension;
+
+    std::array<int16_t, max_output_program_size * ElementwiseAssembler::InstructionSize> program_buffer;
+    ElementwiseAssembler p(program_buffer);
+
+    // Replicate the activation (and saturation) of the unfused convolution.
+    const Interval conv_range = get_output_range(conv_activation, conv_q);
+    auto conv = p.clamp(p.input(0),
+                        saturate_i16((conv_range.min - conv_zero) * conv_multiplier),
+                        saturate_i16((conv_range.max - conv_zero) * conv_multiplier));
+    auto other_offset = p.sub(p.input(1), other_zero);
+
+    int16_t multiplier, shift;
+    ElementwiseAssembler::Slot value;
+    if (op == BinaryOp::Add || op == BinaryOp::Sub) {
+        const bool negate_conv = op == BinaryOp::Sub && conv_is_rhs;
+        const bool negate_other = op == BinaryOp::Sub && !conv_is_rhs;
+        double other_multiplier = other_scale / output_scale * (1 << precision_shift);
+        if (negate_other) {
+            other_multiplier = -other_multiplier;
+        }
+        if (!get_multiplier_i16(other_multiplier, multiplier, shift)) {
+            return false;
+        }
+        auto other_scaled = p.mul_shift(other_offset, multiplier, shift);
+        if (negate_conv) {
+            value = p.sub(other_scaled, conv);
+        } else {
+            value = p.add(conv, other_scaled);
+        }
+        if (precision_shift > 0) {
+            value = p.shift(value, precision_shift);
+        }
+    } else {
+        // The product of the two operands can have 15 + 8 bits. Drop the extra
+        // bits, and then scale the result to the output.
+        const int product_shift = precision_shift + 1;
+        const double product_multiplier =
+            conv_scale * other_scale / output_scale * (1 << product_shift) / (1 << precision_shift);
+        if (!get_multiplier_i16(product_multiplier, multiplier, shift)) {
+            return false;
+        }
+        auto product = p.mul_shift(conv, other_offset, product_shift);
+        value = p.mul_shift(product, multiplier, shift);
+    }
+
+    const Interval output_range = get_output_range(activation, output_q);
+    value = p.add(value, output_zero);
+    value = p.clamp(value, output_range.min, output_range.max);
+
+    result.program = p.assemble({value}).copy();
+    assert(result.program.dim(1).extent() <= max_output_program_size);
+    return true;
+}
+
+// Fuse elementwise ops that consume the output of a convolution into the
+// convolution.
+class FuseConvElementwise : public OpMutator {
+    using OpMutator::visit;
+
+    std::unordered_set<Tensor *> root_outputs_;
+
+    // Returns true if the only use of t is by the op we are fusing.
+    bool can_fuse_output(const TensorPtr &t) const {
+        return root_outputs_.count(t.get()) == 0 &&
+               t->producers().size() == 1 &&
+               t->consumers().size() == 1 &&
+               is_uint8(t);
+    }
+
+    // Returns nullptr if op is not a convolution that we can fuse into.
+    static const ConvOp *get_fusable_conv(const Op *op) {
+        const ConvOp *conv = cast_op<ConvOp>(op);
+        if (!conv || conv->has_output_program() || !is_uint8(conv->input())) {
+            return nullptr;
+        }
+        return conv;
+    }
+
+    static const DepthwiseConv2DOp *get_fusable_depthwise_conv(const Op *op) {
+        const DepthwiseConv2DOp *conv = cast_op<DepthwiseConv2DOp>(op);
+        if (!conv || conv->has_output_program() || conv->depth_multiplier() != 1 ||
+            !is_uint8(conv->input()) || !is_uint8(conv->filter())) {
+            return nullptr;
+        }
+        return conv;
+    }
+
+    OpPtr visit(std::unique_ptr<BinaryOp> op) override {
+        if (op->op() != BinaryOp::Add && op->op() != BinaryOp::Sub && op->op() != BinaryOp::Mul) {
+            return op;
+        }
+        if (!is_quantized_activation(op->activation()) || !is_uint8(op->output())) {
+            return op;
+        }
+        for (int i = 0; i < 2; i++) {
+            const TensorPtr &conv_output = op->input(i);
+            const TensorPtr &other = op->input(1 - i);
+            if (conv_output == other || !can_fuse_output(conv_output) || !is_uint8(other) ||
+                !same_bounds(conv_output->bounds(), op->output()->bounds()) ||
+                !same_bounds(other->bounds(), op->output()->bounds())) {
+                continue;
+            }
+
+            const Op *producer = conv_output->producers().front();
+            if (const ConvOp *conv = get_fusable_conv(producer)) {
+                OutputProgram program;
+                if (make_output_program(conv_output, conv->activation(), other, op->op(), i == 1,
+                                        op->activation(), op->output(), program)) {
+                    return make_prepared_op<ConvOp>(conv->input(), conv->filter(), conv->bias(), other, op->output(),
+                                                    conv->stride(), conv->dilation(), conv->padding(), std::move(program));
+                }
+            } else if (const DepthwiseConv2DOp *conv = get_fusable_depthwise_conv(producer)) {
+                OutputProgram program;
+                if (make_output_program(conv_output, conv->activation(), other, op->op(), i == 1,
+                                        op->activation(), op->output(), program)) {
+                    return make_prepared_op<DepthwiseConv2DOp>(conv->input(), conv->filter(), conv->bias(), other, op->output(),
+                                                               conv->stride(), conv->dilation(), conv->padding(), std::move(program));
+                }
+            }
+        }
+        return op;
+    }
+
+    OpPtr visit(std::unique_ptr<UnaryOp> op) override {
+        ActivationFunction activation;
+        switch (op->op()) {
+        case UnaryOp::Relu:
+            activation = ActivationFunction::Relu;
+            break;
+        case UnaryOp::Relu6:
+            activation = ActivationFunction::Relu6;
+            break;
+        case UnaryOp::ReluN1To1:
+            activation = ActivationFunction::ReluN1To1;
+            break;
+        default:
+            return op;
+        }
+
+        // An activation following a convolution without its own activation can
+        // just be the activation of the convolution. The convolution requantizes
+        // its result to the output, so that is fused as well.
+        const TensorPtr &conv_output = op->input();
+        if (!can_fuse_output(conv_output) || !is_uint8(op->output())) {
+            return op;
+        }
+        const Op *producer = conv_output->producers().front();
+        if (const ConvOp *conv = get_fusable_conv(producer)) {
+            if (conv->activation() == ActivationFunction::None) {
+                return make_prepared_op<ConvOp>(conv->input(), conv->filter(), conv->bias(), op->output(),
+                                                conv->stride(), conv->dilation(), conv->padding(), activation);
+            }
+        } else if (const DepthwiseConv2DOp *conv = get_fusable_depthwise_conv(producer)) {
+            if (conv->activation() == ActivationFunction::None) {
+                return make_prepared_op<DepthwiseConv2DOp>(conv->input(), conv->filter(), conv->bias(), op->output(),
+                                                           conv->depth_multiplier(), conv->stride(), conv->dilation(),
+                                                           conv->padding(), activation);
+            }
+        }
+        return op;
+    }
+
+    template<class T, class... Args>
+    std::unique_ptr<T> make_prepared_op(Args &&...args) {
+        auto op = std::make_unique<T>(std::forward<Args>(args)...);
+        if (!op->prepare()) {
+            HLOG(ERROR) << "fuse_conv_elementwise: new_op " << op->name() << " failed prepare()";
+            prepare_failed = true;
+        }
+        return op;
+    }
+
+public:
+    explicit FuseConvElementwise(const Op *root) {
+        for (int i = 0; i < root->output_count(); i++) {
+            root_outputs_.insert(root->output(i).get());
+        }
+    }
+
+    bool prepare_failed = false;
+};
+
+}  // namespace
+
+OpPtr fuse_conv_elementwise(OpPtr op) {
+    FuseConvElementwise fuser(op.get());
+    op = fuser.mutate(std::move(op));
+    if (fuser.prepare_failed) {
+        return nullptr;
+    }
+    return op;
+}
+
+namespace {
+
 void replace_consumers(const TensorPtr &from, const TensorPtr &to) {
     // We need to make a copy of the list of consumers so it doesn't get invalidated
     // by set_input below.
@@ -349,7 +653,9 @@ class PadForOps : public OpMutator {
         padding->set_constant();
 
         // Add the new tensor, op, and update the input.
-        return make_prepared_op<PadOp>(input, padding, padded);
+        auto pad = make_prepared_op<PadOp>(input, padding, padded);
+        pad->set_pads_for_consumer();
+        return pad;
     }
 
     OpPtr visit(std::unique_ptr<ConvOp> op) override {
@@ -394,8 +700,13 @@ class PadForOps : public OpMutator {
 
             auto inputs = op->inputs();
             auto outputs = op->outputs();
-            op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
-                                          op->stride(), op->dilation(), op->padding(), op->activation());
+            if (op->has_output_program()) {
+                op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->elementwise_input(), op->output(),
+                                              op->stride(), op->dilation(), op->padding(), op->output_program());
+            } else {
+                op = make_prepared_op<ConvOp>(conv_input, conv_filter, op->bias(), op->output(),
+                                              op->stride(), op->dilation(), op->padding(), op->activation());
+            }
             new_ops.push_back(std::move(op));
 
             return make_prepared_op<OpGroup>(std::move(inputs), std::move(outputs), std::move(new_ops));
@@ -437,9 +748,16 @@ class PadForOps : public OpMutator {
             if (padding_op) {
                 TensorPtr padding_output = padding_op->output();
                 new_ops.push_back(std::move(padding_op));
-                op = make_prepared_op<DepthwiseConv2DOp>(padding_output, op->filter(), op->bias(), op->output(),
-                                                         op->depth_multiplier(), op->stride(), op->dilation(),
-                                                         op->padding(), op->activation());
+                if (op->has_output_program()) {
+                    op = make_prepared_op<DepthwiseConv2DOp>(padding_output, op->filter(), op->bias(),
+                                                             op->elementwise_input(), op->output(),
+                                                             op->stride(), op->dilation(), op->padding(),
+                                                             op->output_program());
+                } else {
+                    op = make_prepared_op<DepthwiseConv2DOp>(padding_output, op->filter(), op->bias(), op->output(),
+                                                             op->depth_multiplier(), op->stride(), op->dilation(),
+                                                             op->padding(), op->activation());
+                }
             }
 
             auto inputs = op->inputs();
@@ -479,6 +797,190 @@ OpPtr pad_for_ops(OpPtr op) {
 
 namespace {
 
+// Replace chains of elementwise ops and pools, each of which consumes only
+// the output of the one before it, with a TiledChainOp.
+class TileOpChains : public OpMutator {
+    using OpMutator::visit;
+
+    std::unordered_set<Tensor *> root_outputs_;
+    int tile_bytes_;
+
+    // Returns true if op can be computed a tile of its output at a time.
+    static bool can_tile(const Op *op) {
+        if (op->output_count() != 1 || op->output()->rank() < 1 || op->output()->is_dynamic()) {
+            return false;
+        }
+        for (int i = 0; i < op->input_count(); i++) {
+            if (op->input(i)->is_dynamic()) {
+                return false;
+            }
+        }
+
+        if (const Pool2DOp *pool = cast_op<Pool2DOp>(op)) {
+            return is_uint8(pool->input()) && is_uint8(pool->output());
+        }
+
+        bool is_elementwise = false;
+        if (const BinaryOp *binary = cast_op<BinaryOp>(op)) {
+            is_elementwise = (binary->op() == BinaryOp::Add || binary->op() == BinaryOp::Sub || binary->op() == BinaryOp::Mul) &&
+                             is_uint8(binary->input(0)) && is_uint8(binary->input(1)) && is_uint8(binary->output());
+        } else if (const UnaryOp *unary = cast_op<UnaryOp>(op)) {
+            is_elementwise = is_uint8(unary->input()) && is_uint8(unary->output());
+        } else if (cast_op<ElementwiseProgramOp>(op)) {
+            is_elementwise = true;
+        }
+        if (!is_elementwise) {
+            return false;
+        }
+        // A crop of the output must only need the same crop of the inputs,
+        // so the inputs can't be broadcast.
+        const Box bounds = op->output()->bounds();
+        for (int i = 0; i < op->input_count(); i++) {
+            const TensorPtr &in = op->input(i);
+            if (in->rank() != (int)bounds.size() || !is_subset_of(bounds, in->bounds())) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Returns true if t can live only in the scratch memory of the tiles.
+    bool can_be_intermediate(const TensorPtr &t) const {
+        return root_outputs_.count(t.get()) == 0 &&
+               t->producers().size() == 1 &&
+               t->consumers().size() == 1 &&
+               !t->is_external() &&
+               !t->is_dynamic() &&
+               !t->is_constant() &&
+               !t->is_allocated() &&
+               t->alias_type() == AliasType::None;
+    }
+
+    static bool has_non_constant_input(const Op *op) {
+        for (int i = 0; i < op->input_count(); i++) {
+            if (!op->input(i)->is_constant()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    OpPtr visit(std::unique_ptr<OpGroup> op) override {
+        std::vector<TensorPtr> inputs = op->inputs();
+        std::vector<TensorPtr> outputs = op->outputs();
+
+        const int old_op_count = op->op_count();
+        std::unordered_map<const Op *, int> index;
+        for (int i = 0; i < old_op_count; i++) {
+            index[op->op(i)] = i;
+        }
+
+        // Find the chains, as the indices of their ops. Each op is in at
+        // most one chain, and each input of a chain is consumed by only one
+        // op of it.
+        std::vector<std::vector<int>> chains;
+        std::vector<int> chain_of(old_op_count, -1);
+        for (int i = 0; i < old_op_count; i++) {
+            if (chain_of[i] >= 0 || !can_tile(op->op(i)) || !has_non_constant_input(op->op(i))) {
+                continue;
+            }
+            std::vector<int> chain = {i};
+            std::unordered_set<Tensor *> chain_inputs;
+            for (int j = 0; j < op->op(i)->input_count(); j++) {
+                chain_inputs.insert(op->op(i)->input(j).get());
+            }
+            while (true) {
+                const TensorPtr &t = op->op(chain.back())->output();
+                if (!can_be_intermediate(t)) {
+                    break;
+                }
+                auto next = index.find(t->consumers().front());
+                if (next == index.end() || chain_of[next->second] >= 0 || !can_tile(next->first)) {
+                    break;
+                }
+                const Op *next_op = next->first;
+                bool inputs_ok = true;
+                for (int j = 0; j < next_op->input_count(); j++) {
+                    const TensorPtr &in = next_op->input(j);
+                    if (in != t && chain_inputs.count(in.get())) {
+                        inputs_ok = false;
+                    }
+                }
+                if (!inputs_ok) {
+                    break;
+                }
+                for (int j = 0; j < next_op->input_count(); j++) {
+                    if (next_op->input(j) != t) {
+                        chain_inputs.insert(next_op->input(j).get());
+                    }
+                }
+                chain.push_back(next->second);
+            }
+            if (chain.size() < 2) {
+                continue;
+            }
+            for (int j : chain) {
+                chain_of[j] = chains.size();
+            }
+            chains.push_back(std::move(chain));
+        }
+
+        // Each chain replaces its last op; the ops before that in the chain
+        // don't have any other consumers, so they can be delayed until then.
+        std::vector<std::vector<OpPtr>> chain_ops(chains.size());
+        std::vector<OpPtr> ops_new;
+        ops_new.reserve(old_op_count);
+        for (int i = 0; i < old_op_count; i++) {
+            if (chain_of[i] < 0) {
+                OpPtr sub_op_new = mutate(op->take_op(i));
+                if (sub_op_new != nullptr) {
+                    ops_new.push_back(std::move(sub_op_new));
+                }
+                continue;
+            }
+            const std::vector<int> &chain = chains[chain_of[i]];
+            std::vector<OpPtr> &ops = chain_ops[chain_of[i]];
+            ops.push_back(op->take_op(i));
+            if (i != chain.back()) {
+                continue;
+            }
+
+            std::vector<TensorPtr> chain_inputs;
+            for (size_t k = 0; k < ops.size(); k++) {
+                for (int j = 0; j < ops[k]->input_count(); j++) {
+                    const TensorPtr &in = ops[k]->input(j);
+                    if (k > 0 && in == ops[k - 1]->output()) {
+                        continue;
+                    }
+                    if (std::find(chain_inputs.begin(), chain_inputs.end(), in) == chain_inputs.end()) {
+                        chain_inputs.push_back(in);
+                    }
+                }
+            }
+            TensorPtr chain_output = ops.back()->output();
+            ops_new.push_back(make_op<TiledChainOp>(std::move(chain_inputs), chain_output, std::move(ops), tile_bytes_));
+        }
+        return make_op<OpGroup>(inputs, outputs, std::move(ops_new));
+    }
+
+public:
+    TileOpChains(const Op *root, int tile_bytes)
+        : tile_bytes_(tile_bytes) {
+        for (int i = 0; i < root->output_count(); i++) {
+            root_outputs_.insert(root->output(i).get());
+        }
+    }
+};
+
+}  // namespace
+
+OpPtr tile_op_chains(OpPtr op, int tile_bytes) {
+    TileOpChains tiler(op.get(), tile_bytes);
+    return tiler.mutate(std::move(op));
+}
+
+namespace {
+
 class FusePadOps : public OpMutator {
     using OpMutator::visit;
 
@@ -548,21 +1050,60 @@ bool can_execute_with_all_constant_inputs(const Op *op) {
 class ConstantFolder : public OpMutator {
     using OpMutator::visit;
 
+    const PreparedModel *prepared_;
+    std::vector<TensorPtr> *folded_;
+
+    // If every output that needs to be computed was saved in the prepared
+    // model, point them at the saved data and return true.
+    bool load_prepared_outputs(Op *op) {
+        if (!prepared_) {
+            return false;
+        }
+        std::vector<const PreparedModel::Constant *> saved(op->output_count());
+        for (int j = 0; j < op->output_count(); j++) {
+            const TensorPtr &output = op->output(j);
+            if (output->is_allocated()) {
+                continue;
+            }
+            if (output->alias_type() != AliasType::None) {
+                return false;
+            }
+            saved[j] = prepared_->find_constant(*output);
+            if (!saved[j]) {
+                return false;
+            }
+        }
+        for (int j = 0; j < op->output_count(); j++) {
+            if (saved[j]) {
+                op->output(j)->allocate_from_arena_pointer(const_cast<void *>(saved[j]->data));
+                if (folded_) {
+                    folded_->push_back(op->output(j));
+                }
+            }
+        }
+        return true;
+    }
+
     OpPtr visit_leaf(OpPtr op) override {
         if (can_execute_with_all_constant_inputs(op.get())) {
-            // Allocate all the outputs.
-            // Since we aren't ready for arena allocation,
-            // we'll just do these as one-off heap allocs.
-            for (int j = 0; j < op->output_count(); j++) {
-                // Note that an output could be 'allocated' here if it
-                // is the result of a ReshapeOp that aliases constant data.
-                if (!op->output(j)->is_allocated()) {
-                    op->output(j)->allocate_from_heap();
+            if (!load_prepared_outputs(op.get())) {
+                // Allocate all the outputs.
+                // Since we aren't ready for arena allocation,
+                // we'll just do these as one-off heap allocs.
+                for (int j = 0; j < op->output_count(); j++) {
+                    // Note that an output could be 'allocated' here if it
+                    // is the result of a ReshapeOp that aliases constant data.
+                    if (!op->output(j)->is_allocated()) {
+                        op->output(j)->allocate_from_heap();
+                        if (folded_ && op->output(j)->alias_type() == AliasType::None) {
+                            folded_->push_back(op->output(j));
+                        }
+                    }
                 }
-            }
 
-            // Run the whole op.
-            op->execute();
+                // Run the whole op.
+                op->execute();
+            }
 
             // Mark the outputs constant.
             for (int j = 0; j < op->output_count(); j++) {
@@ -574,12 +1115,17 @@ class ConstantFolder : public OpMutator {
             return op;
         }
     }
+
+public:
+    ConstantFolder(const PreparedModel *prepared, std::vector<TensorPtr> *folded)
+        : prepared_(prepared), folded_(folded) {
+    }
 };
 
 }  // namespace
 
-OpPtr fold_constants(OpPtr op) {
-    ConstantFolder folder;
+OpPtr fold_constants(OpPtr op, const PreparedModel *prepared, std::vector<TensorPtr> *folded) {
+    ConstantFolder folder(prepared, folded);
     return folder.mutate(std::move(op));
 }
 
@@ -2,6 +2,7 @@
 #define HANNK_TRANSFORMS_H
 
 #include "interpreter/ops.h"
+#include "interpreter/prepared_model.h"
 
 namespace hannk {
 
@@ -11,15 +12,32 @@ namespace hannk {
 // Remove ops that are unused.
 [[nodiscard]] OpPtr remove_dead_ops(OpPtr op);
 
+// Fuse elementwise ops (add, sub, mul, activations and requantization) that
+// consume the result of a convolution into the convolution, so the result
+// doesn't need to be written to memory. The fused ops are left dead, so
+// remove_dead_ops() should be run after this.
+// New ops will have prepare() called on them; this will return nullptr
+// if any of those calls fail.
+[[nodiscard]] OpPtr fuse_conv_elementwise(OpPtr op);
+
 // Add pad ops before ops that need it, so those ops can
 // assume everything needed of the input is in bounds.
 // New ops will have prepare() called on them; this will return nullptr
 // if any of those calls fail.
 [[nodiscard]] OpPtr pad_for_ops(OpPtr op);
 
+// Replace chains of elementwise ops and pools in which each op consumes only
+// the output of the one before it with TiledChainOps, which compute the chain
+// a tile of about tile_bytes at a time without allocating the intermediate
+// tensors. This should be run before in_place().
+[[nodiscard]] OpPtr tile_op_chains(OpPtr op, int tile_bytes);
+
 // Execute ops that are constant, and mark the results
-// constant as well.
-[[nodiscard]] OpPtr fold_constants(OpPtr op);
+// constant as well. If prepared is not null, outputs that were saved in it
+// are pointed at the saved data instead of executing the op that produces
+// them. If folded is not null, the outputs computed here are appended to it.
+[[nodiscard]] OpPtr fold_constants(OpPtr op, const PreparedModel *prepared = nullptr,
+                                   std::vector<TensorPtr> *folded = nullptr);
 
 // Flatten all nested OpGroups into a single OpGroup.
 // TODO: OpGroups that represent subgraphs shouldn't be flattened;
@@ -1,7 +1,11 @@
+#include <algorithm>
 #include <chrono>
 #include <dlfcn.h>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <random>
+#include <sstream>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -155,6 +159,134 @@ static const char *const RunNames[ModelRunner::kNumRuns] = {
     "HannkInternalDelegate",
 };
 
+// The name TFLite gives the node type that a hannk op type implements.
+// hannk fuses and rewrites ops, so this is only a rough correspondence.
+std::string tflite_node_type(const std::string &op_type) {
+    static const std::map<std::string, std::string> special = {
+        {"ConvOp", "CONV_2D"},
+        {"DepthwiseConv2DOp", "DEPTHWISE_CONV_2D"},
+        {"Pool2DOp(Average)", "AVERAGE_POOL_2D"},
+        {"Pool2DOp(Max)", "MAX_POOL_2D"},
+    };
+    auto it = special.find(op_type);
+    if (it != special.end()) {
+        return it->second;
+    }
+    // BinaryOp(Add) -> ADD, FullyConnectedOp -> FULLY_CONNECTED.
+    std::string name = op_type;
+    const auto paren = name.find('(');
+    if (paren != std::string::npos) {
+        name = name.substr(paren + 1, name.size() - paren - 2);
+    } else if (name.size() > 2 && name.compare(name.size() - 2, 2, "Op") == 0) {
+        name = name.substr(0, name.size() - 2);
+    }
+    std::string result;
+    for (size_t i = 0; i < name.size(); i++) {
+        if (i > 0 && isupper(name[i]) && !isupper(name[i - 1])) {
+            result += '_';
+        }
+        result += toupper(name[i]);
+    }
+    return result;
+}
+
+// Read the average time in microseconds of each node type from a CSV
+// profile written by TFLite's benchmark_model tool, with
+// --enable_op_profiling=true --profiling_output_csv_file=<file>. This uses
+// the "Summary by node type" table if there is one, and otherwise sums the
+// first table with "node type" and "avg_ms" columns by node type.
+std::map<std::string, double> read_tflite_op_profile(const std::string &filename) {
+    std::map<std::string, double> result;
+    std::ifstream f(filename);
+    if (!f.good()) {
+        std::cerr << "Unable to open " << filename << "\n";
+        return result;
+    }
+    std::vector<std::string> lines;
+    std::string line;
+    bool has_summary = false;
+    while (std::getline(f, line)) {
+        has_summary |= line.find("Summary by node type") != std::string::npos;
+        lines.push_back(line);
+    }
+
+    const auto split = [](const std::string &s) {
+        std::vector<std::string> fields;
+        std::stringstream ss(s);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            field.erase(std::remove(field.begin(), field.end(), '"'), field.end());
+            const auto begin = field.find_first_not_of(" \t\r");
+            const auto end = field.find_last_not_of(" \t\r");
+            fields.push_back(begin == std::string::npos ? "" : field.substr(begin, end - begin + 1));
+        }
+        return fields;
+    };
+
+    bool in_summary = !has_summary;
+    for (size_t i = 0; i < lines.size(); i++) {
+        if (lines[i].find("Summary by node type") != std::string::npos) {
+            in_summary = true;
+            continue;
+        }
+        if (!in_summary) {
+            continue;
+        }
+        const std::vector<std::string> header = split(lines[i]);
+        const auto type_col = std::find(header.begin(), header.end(), "node type") - header.begin();
+        const auto time_col = std::find(header.begin(), header.end(), "avg_ms") - header.begin();
+        if (type_col == (int)header.size() || time_col == (int)header.size()) {
+            continue;
+        }
+        for (size_t j = i + 1; j < lines.size(); j++) {
+            const std::vector<std::string> row = split(lines[j]);
+            if (row.size() <= (size_t)std::max(type_col, time_col) || row[type_col].empty()) {
+                break;
+            }
+            result[row[type_col]] += std::atof(row[time_col].c_str()) * 1e3;
+        }
+        break;
+    }
+    return result;
+}
+
+// Print the time per execution of each op type in hannk next to the time
+// TFLite spent in the corresponding node type.
+void compare_with_tflite_op_profile(const OpProfiler &profiler, const std::map<std::string, double> &tflite, std::ostream &os) {
+    struct Row {
+        double hannk_us = 0;
+        double tflite_us = 0;
+        std::string hannk_types;
+    };
+    std::map<std::string, Row> rows;
+    const double executions = std::max<int64_t>(profiler.executions(), 1);
+    for (const auto &s : profiler.op_types()) {
+        Row &row = rows[tflite_node_type(s.type)];
+        row.hannk_us += s.seconds * 1e6 / executions;
+        row.hannk_types += (row.hannk_types.empty() ? "" : " ") + s.type;
+    }
+    for (const auto &i : tflite) {
+        rows[i.first].tflite_us += i.second;
+    }
+    std::vector<std::pair<std::string, Row>> sorted(rows.begin(), rows.end());
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) {
+        return std::max(a.second.hannk_us, a.second.tflite_us) > std::max(b.second.hannk_us, b.second.tflite_us);
+    });
+
+    const auto old_flags = os.flags();
+    const auto old_precision = os.precision();
+    os << std::fixed << std::setprecision(2);
+    os << "\nBy op type, hannk vs. TFLite (us per execution):\n";
+    os << std::setw(24) << "TFLite node type" << std::setw(12) << "hannk" << std::setw(12) << "TFLite"
+       << "  hannk op types\n";
+    for (const auto &i : sorted) {
+        os << std::setw(24) << i.first << std::setw(12) << i.second.hannk_us
+           << std::setw(12) << i.second.tflite_us << "  " << i.second.hannk_types << "\n";
+    }
+    os.flags(old_flags);
+    os.precision(old_precision);
+}
+
 }  // namespace
 
 int FlagProcessor::handle_nonflag(const std::string &s) {
@@ -395,7 +527,7 @@ void ModelRunner::status() {
     }
 }
 
-ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer) {
+ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer, const std::string &filename) {
     RunResult result;
 
     std::unique_ptr<OpGroup> model = parse_tflite_model_from_buffer(buffer.data());
@@ -406,6 +538,7 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
 
     InterpreterOptions options;
     options.verbosity = verbosity;
+    options.profile = profile || profile_json || !tflite_op_profile.empty();
     Interpreter interpreter(std::move(model), std::move(options));
     if (!interpreter.prepare()) {
         std::cerr << "hannk::Interpreter::prepare() failed\n";
@@ -450,6 +583,19 @@ ModelRunner::RunResult ModelRunner::run_in_hannk(const std::vector<char> &buffer
         });
     }
 
+    if (OpProfiler *profiler = interpreter.profiler()) {
+        if (profile) {
+            profiler->report(std::cout);
+        }
+        if (!tflite_op_profile.empty()) {
+            compare_with_tflite_op_profile(*profiler, read_tflite_op_profile(tflite_op_profile), std::cout);
+        }
+        if (profile_json) {
+            std::ofstream json(filename + ".profile.json");
+            profiler->write_json(json);
+        }
+    }
+
     return result;
 }
 
@@ -576,10 +722,22 @@ int ModelRunner::parse_flags(int argc, char **argv, std::vector<std::string> &fi
              seed = std::stoi(value);
              return 0;
          }},
+        {"profile", [this](const std::string &value) {
+             this->profile = std::stoi(value) != 0;
+             return 0;
+         }},
+        {"profile_json", [this](const std::string &value) {
+             this->profile_json = std::stoi(value) != 0;
+             return 0;
+         }},
         {"threads", [this](const std::string &value) {
              this->threads = std::stoi(value);
              return 0;
          }},
+        {"tflite_op_profile", [this](const std::string &value) {
+             this->tflite_op_profile = value;
+             return 0;
+         }},
         {"tolerance", [this](const std::string &value) {
              this->tolerance = std::stof(value);
              return 0;
@@ -654,8 +812,8 @@ void ModelRunner::run(const std::string &filename) {
     const auto exec_tflite = [this, &buffer]() {
         return run_in_tflite(buffer);
     };
-    const auto exec_hannk = [this, &buffer]() {
-        return run_in_hannk(buffer);
+    const auto exec_hannk = [this, &buffer, &filename]() {
+        return run_in_hannk(buffer, filename);
     };
     const auto exec_hannk_external_delegate = [this, &buffer]() {
         DelegatePtr delegate_ptr;
@@ -686,7 +844,7 @@ void ModelRunner::run(const std::string &filename) {
             std::cerr << "Only kHannk is available in this build.\n";
             exit(1);
         }
-        results[i] = run_in_hannk(buffer);
+        results[i] = run_in_hannk(buffer, filename);
 #endif
     }
 
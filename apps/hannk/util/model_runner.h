@@ -110,6 +110,13 @@ struct ModelRunner {
     bool csv_output = false;
     int run_count = 0;
     std::string external_delegate_path;
+    // If set, print the time of each op and op type in hannk, averaged over
+    // the benchmark runs, and/or write it to <model>.profile.json.
+    bool profile = false;
+    bool profile_json = false;
+    // If not empty, a CSV op profile of the same model from TFLite's
+    // benchmark_model tool, to print next to the hannk profile by op type.
+    std::string tflite_op_profile;
     std::vector<WhichRun> active_runs;
 
     ModelRunner();
@@ -133,7 +140,7 @@ private:
         std::vector<HalideBuffer<const void>> outputs;
         std::chrono::duration<double> time{0};
     };
-    RunResult run_in_hannk(const std::vector<char> &buffer);
+    RunResult run_in_hannk(const std::vector<char> &buffer, const std::string &filename);
 #if HANNK_BUILD_TFLITE
     RunResult run_in_tflite(const std::vector<char> &buffer, TfLiteDelegate *delegate = nullptr);
 #endif
@@ -26,6 +26,11 @@ public:
 
     GeneratorParam<bool> use_dma_for_output{"use_dma_for_output", true};
 
+    // How many tiles ahead of the compute the async schedules may
+    // DMA. The folded storage holds one extra tile per tile of
+    // prefetch, so the default of one double-buffers the input.
+    GeneratorParam<int> prefetch_tiles{"prefetch_tiles", 1, 1, 7};
+
     void generate() {
         Var x{"x"}, y{"y"}, c{"c"};
 
@@ -55,6 +60,7 @@ public:
         const int bytes_per_pixel = std::max(input.type().bytes(), output.type().bytes());
         const int tile_width = 128 / bytes_per_pixel;
         const int tile_height = 32;
+        const int async_fold = tile_width * (1 + prefetch_tiles);
 
         switch ((Schedule)schedule) {
         case Schedule::Basic:
@@ -88,7 +94,7 @@ public:
                 .compute_at(output, tx)
                 .store_at(output, ty)
                 .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
             break;
         case Schedule::Split: {
             Var yo, yi;
@@ -117,7 +123,7 @@ public:
                 .store_at(output, ty)
                 .async()
                 .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
         } break;
         }
 
@@ -126,7 +132,7 @@ public:
             work
                 .async()
                 .store_at(output, ty)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
         }
 
         // Schedule the work in tiles (same for all DMA schedules).
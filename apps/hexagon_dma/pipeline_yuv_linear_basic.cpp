@@ -29,6 +29,11 @@ public:
 
     GeneratorParam<bool> use_dma_for_output{"use_dma_for_output", true};
 
+    // How many tiles ahead of the compute the async schedules may
+    // DMA. The folded storage holds one extra tile per tile of
+    // prefetch, so the default of one double-buffers the input.
+    GeneratorParam<int> prefetch_tiles{"prefetch_tiles", 1, 1, 7};
+
     void generate() {
         // Y and UV need to be the same type (?).
         assert(input_y.type() == input_uv.type());
@@ -76,6 +81,7 @@ public:
         const int bytes_per_pixel = std::max(input_y.type().bytes(), output_y.type().bytes());
         const int tile_width = 128 / bytes_per_pixel;
         const int tile_height = 32;
+        const int async_fold = tile_width * (1 + prefetch_tiles);
 
         switch ((Schedule)schedule) {
         case Schedule::Basic:
@@ -127,7 +133,7 @@ public:
                 .async()
                 .compute_at(output_y, tx)
                 .store_at(output_y, ty)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
 
             input_uv_copy
                 .copy_to_host()
@@ -135,7 +141,7 @@ public:
                 .compute_at(output_uv, tx)
                 .store_at(output_uv, ty)
                 .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
             break;
         case Schedule::Split: {
             Var yo, yi;
@@ -181,7 +187,7 @@ public:
                 .compute_at(output_y, tx)
                 .store_at(output_y, ty)
                 .async()
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
 
             input_uv_copy
                 .copy_to_host()
@@ -189,7 +195,7 @@ public:
                 .store_at(output_uv, ty)
                 .async()
                 .reorder_storage(c, x, y)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
         } break;
         }
 
@@ -198,12 +204,12 @@ public:
             work_y
                 .async()
                 .store_at(output_y, ty)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
 
             work_uv
                 .async()
                 .store_at(output_uv, ty)
-                .fold_storage(x, tile_width * 2);
+                .fold_storage(x, async_fold);
         }
 
         // Schedule the work in tiles (same for all DMA schedules).
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
 
@@ -7,12 +9,22 @@
 
 #include "iir_blur.h"
 #include "iir_blur_auto_schedule.h"
+#include "iir_blur_blocked.h"
+#include "iir_blur_stream.h"
 
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
 using namespace Halide::Tools;
 
+float max_difference(const Halide::Runtime::Buffer<float, 3> &a, const Halide::Runtime::Buffer<float, 3> &b) {
+    float result = 0.0f;
+    a.for_each_element([&](int x, int y, int c) {
+        result = std::max(result, std::abs(a(x, y, c) - b(x, y, c)));
+    });
+    return result;
+}
+
 int main(int argc, char **argv) {
     if (argc != 3) {
         printf("Usage: %s in out\n", argv[0]);
@@ -21,19 +33,61 @@ int main(int argc, char **argv) {
 
     Halide::Runtime::Buffer<float, 3> input = load_and_convert_image(argv[1]);
     Halide::Runtime::Buffer<float, 3> output(input.width(), input.height(), input.channels());
+    const float alpha = 0.5f;
 
     double best_manual = benchmark([&]() {
-        iir_blur(input, 0.5f, output);
+        iir_blur(input, alpha, output);
         output.device_sync();
     });
     printf("Manually-tuned time: %gms\n", best_manual * 1e3);
 
     double best_auto = benchmark([&]() {
-        iir_blur_auto_schedule(input, 0.5f, output);
+        iir_blur_auto_schedule(input, alpha, output);
         output.device_sync();
     });
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
 
+    Halide::Runtime::Buffer<float, 3> output_blocked(input.width(), input.height(), input.channels());
+    double best_blocked = benchmark([&]() {
+        iir_blur_blocked(input, alpha, output_blocked);
+        output_blocked.device_sync();
+    });
+    printf("Block-parallel time: %gms\n", best_blocked * 1e3);
+
+    // Filter the image a strip of rows at a time, with enough lookahead for
+    // the filter back up the columns to settle.
+    const int strip = 64;
+    const int lookahead = (int)std::ceil(std::log(1e-4) / std::log(1.0 - alpha));
+    Halide::Runtime::Buffer<float, 3> output_stream(input.width(), input.height(), input.channels());
+    Halide::Runtime::Buffer<float, 2> state(input.width(), input.channels());
+    Halide::Runtime::Buffer<float, 2> next_state(input.width(), input.channels());
+    double best_stream = benchmark([&]() {
+        state.copy_from(input.sliced(1, 0));
+        for (int y = 0; y < input.height(); y += strip) {
+            const int rows = std::min(strip, input.height() - y);
+            const int input_rows = std::min(rows + lookahead, input.height() - y);
+            auto out_strip = output_stream.cropped(1, y, rows);
+            iir_blur_stream(input.cropped(1, y, input_rows), state, alpha, out_strip, next_state);
+            std::swap(state, next_state);
+        }
+        output_stream.device_sync();
+    });
+    printf("Streaming time (%d row strips): %gms\n", strip, best_stream * 1e3);
+
+    iir_blur(input, alpha, output);
+    output.device_sync();
+    output.copy_to_host();
+    output_blocked.copy_to_host();
+    output_stream.copy_to_host();
+    if (max_difference(output, output_blocked) > 1e-3f) {
+        printf("The block-parallel filter differs from iir_blur by %g\n", max_difference(output, output_blocked));
+        return 1;
+    }
+    if (max_difference(output, output_stream) > 1e-3f) {
+        printf("The streaming filter differs from iir_blur by %g\n", max_difference(output, output_stream));
+        return 1;
+    }
+
     convert_and_save_image(output, argv[2]);
 
     printf("Success!\n");
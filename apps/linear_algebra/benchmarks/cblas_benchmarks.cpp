@@ -7,7 +7,8 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB
+//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB,
+//        gemm_batched, gemm_strided_batched, gemm_strided_batched_shared_A
 //
 
 #include "cblas.h"
@@ -27,6 +28,7 @@ struct BenchmarksBase {
     typedef T Scalar;
     typedef std::vector<T> Vector;
     typedef std::vector<T> Matrix;
+    typedef std::vector<T> Batch;
 
     std::random_device rand_dev;
     std::default_random_engine rand_eng{rand_dev()};
@@ -54,6 +56,14 @@ struct BenchmarksBase {
         return buff;
     }
 
+    Batch random_batch(int N, int count) {
+        Batch buff(N * N * count);
+        for (int i = 0; i < N * N * count; ++i) {
+            buff[i] = random_scalar();
+        }
+        return buff;
+    }
+
     BenchmarksBase(std::string n)
         : name(n) {
     }
@@ -83,6 +93,12 @@ struct BenchmarksBase {
             this->bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             this->bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            this->bench_gemm_batched(size);
+        } else if (benchmark == "gemm_strided_batched") {
+            this->bench_gemm_strided_batched(size);
+        } else if (benchmark == "gemm_strided_batched_shared_A") {
+            this->bench_gemm_strided_batched_shared_A(size);
         }
     }
 
@@ -98,6 +114,9 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
+    virtual void bench_gemm_strided_batched(int N) = 0;
+    virtual void bench_gemm_strided_batched_shared_A(int N) = 0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -126,6 +145,14 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transB, "s", cblas_sgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "s", cblas_sgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    // CBLAS has no batched gemm, so the batched benchmarks call gemm
+    // once per matrix in the batch.
+    L3BatchedBenchmark(gemm_batched, "s", count, for (int b = 0; b < count; b++) cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alphas[b], &(A[b * N * N]), N, &(B[b * N * N]), N, betas[b], &(C[b * N * N]), N));
+
+    L3BatchedBenchmark(gemm_strided_batched, "s", count, for (int b = 0; b < count; b++) cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[b * N * N]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N));
+
+    L3BatchedBenchmark(gemm_strided_batched_shared_A, "s", 1, for (int b = 0; b < count; b++) cblas_sgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[0]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N));
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -154,6 +181,12 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transB, "d", cblas_dgemm(CblasColMajor, CblasNoTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
 
     L3Benchmark(gemm_transAB, "d", cblas_dgemm(CblasColMajor, CblasTrans, CblasTrans, N, N, N, alpha, &(A[0]), N, &(B[0]), N, beta, &(C[0]), N));
+
+    L3BatchedBenchmark(gemm_batched, "d", count, for (int b = 0; b < count; b++) cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alphas[b], &(A[b * N * N]), N, &(B[b * N * N]), N, betas[b], &(C[b * N * N]), N));
+
+    L3BatchedBenchmark(gemm_strided_batched, "d", count, for (int b = 0; b < count; b++) cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[b * N * N]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N));
+
+    L3BatchedBenchmark(gemm_strided_batched_shared_A, "d", 1, for (int b = 0; b < count; b++) cblas_dgemm(CblasColMajor, CblasNoTrans, CblasNoTrans, N, N, N, alpha, &(A[0]), N, &(B[b * N * N]), N, beta, &(C[b * N * N]), N));
 };
 
 int main(int argc, char *argv[]) {
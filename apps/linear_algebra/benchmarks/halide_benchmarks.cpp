@@ -7,7 +7,8 @@
 // Accepted values for subroutine are:
 //    L1: scal, copy, axpy, dot, nrm2
 //    L2: gemv_notrans, gemv_trans
-//    L3: gemm_notrans, gemm_trans_A, gemm_trans_B, gemm_trans_AB
+//    L3: gemm_notrans, gemm_transA, gemm_transB, gemm_transAB,
+//        gemm_batched, gemm_strided_batched, gemm_strided_batched_shared_A
 //
 
 #include "HalideBuffer.h"
@@ -24,6 +25,7 @@ struct BenchmarksBase {
     typedef T Scalar;
     typedef Halide::Runtime::Buffer<T, 1> Vector;
     typedef Halide::Runtime::Buffer<T, 2> Matrix;
+    typedef Halide::Runtime::Buffer<T, 3> Batch;
 
     std::random_device rand_dev;
     std::default_random_engine rand_eng{rand_dev()};
@@ -53,6 +55,15 @@ struct BenchmarksBase {
         return buff;
     }
 
+    Batch random_batch(int N, int count) {
+        Batch buff(N, N, count);
+        Scalar *A = (Scalar *)buff.data();
+        for (int i = 0; i < N * N * count; ++i) {
+            A[i] = random_scalar();
+        }
+        return buff;
+    }
+
     BenchmarksBase(std::string n)
         : name(n) {
     }
@@ -82,6 +93,12 @@ struct BenchmarksBase {
             bench_gemm_transB(size);
         } else if (benchmark == "gemm_transAB") {
             bench_gemm_transAB(size);
+        } else if (benchmark == "gemm_batched") {
+            bench_gemm_batched(size);
+        } else if (benchmark == "gemm_strided_batched") {
+            bench_gemm_strided_batched(size);
+        } else if (benchmark == "gemm_strided_batched_shared_A") {
+            bench_gemm_strided_batched_shared_A(size);
         }
     }
 
@@ -97,6 +114,9 @@ struct BenchmarksBase {
     virtual void bench_gemm_transA(int N) = 0;
     virtual void bench_gemm_transB(int N) = 0;
     virtual void bench_gemm_transAB(int N) = 0;
+    virtual void bench_gemm_batched(int N) = 0;
+    virtual void bench_gemm_strided_batched(int N) = 0;
+    virtual void bench_gemm_strided_batched_shared_A(int N) = 0;
 };
 
 struct BenchmarksFloat : public BenchmarksBase<float> {
@@ -126,6 +146,12 @@ struct BenchmarksFloat : public BenchmarksBase<float> {
     L3Benchmark(gemm_transB, "s", halide_sgemm(false, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 
     L3Benchmark(gemm_transAB, "s", halide_sgemm(true, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_batched, "s", count, halide_sgemm_batched(alphas.raw_buffer(), A.raw_buffer(), B.raw_buffer(), betas.raw_buffer(), C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_strided_batched, "s", count, halide_sgemm_strided_batched(false, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_strided_batched_shared_A, "s", 1, halide_sgemm_strided_batched(true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 };
 
 struct BenchmarksDouble : public BenchmarksBase<double> {
@@ -155,6 +181,12 @@ struct BenchmarksDouble : public BenchmarksBase<double> {
     L3Benchmark(gemm_transB, "d", halide_dgemm(false, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 
     L3Benchmark(gemm_transAB, "d", halide_dgemm(true, true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_batched, "d", count, halide_dgemm_batched(alphas.raw_buffer(), A.raw_buffer(), B.raw_buffer(), betas.raw_buffer(), C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_strided_batched, "d", count, halide_dgemm_strided_batched(false, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
+
+    L3BatchedBenchmark(gemm_strided_batched_shared_A, "d", 1, halide_dgemm_strided_batched(true, alpha, A.raw_buffer(), B.raw_buffer(), beta, C.raw_buffer()));
 };
 
 int main(int argc, char *argv[]) {
@@ -1,4 +1,5 @@
 #include "halide_benchmark.h"
+#include <algorithm>
 
 #ifdef ENABLE_FTZ_DAZ
 #if (defined(__i386__) || defined(__x86_64__)) && defined(__SSE__)
@@ -121,3 +122,36 @@ inline void set_math_flags() {
             << std::setw(20) << L3GFLOPS(N)             \
             << "\n";                                    \
     }
+
+// The batched benchmarks multiply enough N x N matrices per call to do
+// roughly the same amount of work as a single 128 x 128 x 128 gemm.
+inline int batch_count(int N) {
+    return std::max(1, (1 << 21) / (N * N));
+}
+
+#define L3BatchedGFLOPS(N, count) count *L3GFLOPS(N)
+#define L3BatchedBenchmark(benchmark, type, a_count, code)   \
+    virtual void bench_##benchmark(int N) override {         \
+        const int count = batch_count(N);                    \
+        Scalar alpha = random_scalar();                      \
+        Scalar beta = random_scalar();                       \
+        Vector alphas(random_vector(count));                 \
+        Vector betas(random_vector(count));                  \
+        (void)alpha;                                         \
+        (void)beta;                                          \
+        (void)alphas;                                        \
+        (void)betas;                                         \
+        Batch A(random_batch(N, a_count));                   \
+        Batch B(random_batch(N, count));                     \
+        Batch C(random_batch(N, count));                     \
+                                                             \
+        time_it(code)                                        \
+                                                             \
+                std::cout                                    \
+            << std::setw(8) << name                          \
+            << std::setw(15) << type << #benchmark           \
+            << std::setw(8) << std::to_string(N)             \
+            << std::setw(20) << std::to_string(elapsed)      \
+            << std::setw(20) << L3BatchedGFLOPS(N, count)    \
+            << "\n";                                         \
+    }
@@ -1,4 +1,5 @@
 #include "Halide.h"
+#include <type_traits>
 #include <vector>
 
 using namespace Halide;
@@ -172,7 +173,188 @@ public:
     }
 };
 
+// Generator class for batches of small, independent GEMMs sharing
+// dimensions. The batch is the outermost (third) dimension of A, B
+// and C, so any batch stride can be expressed by the buffers
+// themselves. Work is parallelized across the batch rather than within
+// each matrix, as the matrices are expected to be too small to have
+// enough work per task otherwise. The panels of A (and of B when it is
+// transposed) are packed once per batch entry, or once per call when
+// that operand is shared by every entry of the batch.
+template<class T, bool per_matrix_scalars>
+class GEMMBatchedGenerator : public Generator<GEMMBatchedGenerator<T, per_matrix_scalars>> {
+public:
+    typedef Generator<GEMMBatchedGenerator<T, per_matrix_scalars>> Base;
+    using Base::get_target;
+    using Base::natural_vector_size;
+    using Base::target;
+    template<typename T2>
+    using Input = typename Base::template Input<T2>;
+    template<typename T2>
+    using Output = typename Base::template Output<T2>;
+
+    // gemm_batched takes one alpha and beta per matrix in the batch,
+    // gemm_strided_batched a single alpha and beta for all of them.
+    using ScalarInput = typename std::conditional<per_matrix_scalars, Input<Buffer<T, 1>>, Input<T>>::type;
+
+    GeneratorParam<bool> transpose_A_{"transpose_A", false};
+    GeneratorParam<bool> transpose_B_{"transpose_B", false};
+    // If true, A has a batch extent of one and multiplies every B in
+    // the batch.
+    GeneratorParam<bool> shared_A_{"shared_A", false};
+
+    // Standard ordering of parameters in GEMM functions.
+    ScalarInput a_{"a_"};
+    Input<Buffer<T, 3>> A_{"A_"};
+    Input<Buffer<T, 3>> B_{"B_"};
+    ScalarInput b_{"b_"};
+    Input<Buffer<T, 3>> C_{"C_"};
+
+    Output<Buffer<T, 3>> result_{"result"};
+
+    Expr scalar(ScalarInput &in, const Expr &batch) {
+        if constexpr (per_matrix_scalars) {
+            return in(batch);
+        } else {
+            return in;
+        }
+    }
+
+    void generate() {
+        // Matrices are interpreted as column-major by default, as in
+        // GEMMGenerator.
+        const bool transpose_A = transpose_A_;
+        const bool transpose_B = transpose_B_;
+        const bool shared_A = shared_A_;
+        const Expr num_rows = C_.dim(0).extent();
+        const Expr num_cols = C_.dim(1).extent();
+        const Expr sum_size = transpose_A ? A_.dim(0).extent() : A_.dim(1).extent();
+        const Expr batch_size = C_.dim(2).extent();
+
+        const int vec = std::max(4, natural_vector_size(a_.type()));
+        const int s = vec * 2;
+
+        Var i("i"), j("j"), b("b"), ii("ii"), ji("ji"), io("io"), jo("jo");
+
+        // Swizzle A for better memory order in the inner loop, padding
+        // the rows out to a multiple of the vector width.
+        Func A("A"), B("B"), As("As"), Atmp("Atmp");
+        Atmp(i, j, b) = BoundaryConditions::constant_exterior(A_, cast<T>(0),
+                                                              {{A_.dim(0).min(), A_.dim(0).extent()},
+                                                               {A_.dim(1).min(), A_.dim(1).extent()}})(i, j, b);
+        if (shared_A) {
+            if (transpose_A) {
+                As(i, j, io) = Atmp(j, io * s + i, 0);
+            } else {
+                As(i, j, io) = Atmp(io * s + i, j, 0);
+            }
+            A(i, j, b) = As(i % s, j, i / s);
+        } else {
+            if (transpose_A) {
+                As(i, j, io, b) = Atmp(j, io * s + i, b);
+            } else {
+                As(i, j, io, b) = Atmp(io * s + i, j, b);
+            }
+            A(i, j, b) = As(i % s, j, i / s, b);
+        }
+
+        if (transpose_B) {
+            B(i, j, b) = B_(j, i, b);
+        } else {
+            B(i, j, b) = B_(i, j, b);
+        }
+
+        Var k("k");
+        Func prod;
+        prod(k, i, j, b) = A(i, k, b) * B(k, j, b);
+
+        Func AB("AB");
+        RDom rv(0, sum_size);
+        AB(i, j, b) += prod(rv, i, j, b);
+
+        result_(i, j, b) = scalar(a_, b) * AB(i, j, b) + scalar(b_, b) * C_(i, j, b);
+
+        // Each matrix is a single task.
+        result_
+            .tile(i, j, ii, ji, s, 4, TailStrategy::GuardWithIf)
+            .parallel(b);
+
+        result_.bound(i, 0, num_rows).bound(j, 0, num_cols);
+
+        if (shared_A) {
+            // Pack A once for every matrix in the batch.
+            As.compute_root()
+                .split(j, jo, ji, s)
+                .reorder(i, ji, io, jo)
+                .unroll(i)
+                .vectorize(ji)
+                .parallel(jo);
+            Atmp.compute_at(As, io)
+                .vectorize(i)
+                .unroll(j);
+        } else {
+            As.compute_at(result_, b)
+                .split(j, jo, ji, s)
+                .reorder(i, ji, io, jo, b)
+                .unroll(i)
+                .vectorize(ji);
+            Atmp.compute_at(As, io)
+                .vectorize(i)
+                .unroll(j);
+        }
+
+        if (transpose_B) {
+            // Pack the transposed B once per batch entry.
+            B.compute_at(result_, b)
+                .tile(i, j, ii, ji, 8, 8)
+                .vectorize(ii)
+                .unroll(ji);
+        }
+
+        AB.compute_at(result_, i)
+            .bound_extent(j, 4)
+            .unroll(j)
+            .bound_extent(i, s)
+            .vectorize(i)
+            .update()
+            .reorder(i, j, rv, b)
+            .unroll(j)
+            .unroll(rv, 2)
+            .vectorize(i);
+
+        A_.dim(0).set_min(0).dim(1).set_min(0);
+        if (shared_A) {
+            A_.dim(2).set_bounds(0, 1);
+        } else {
+            A_.dim(2).set_bounds(0, batch_size);
+        }
+        if (transpose_A) {
+            A_.dim(1).set_extent(num_rows);
+        } else {
+            A_.dim(0).set_extent(num_rows);
+        }
+        if (transpose_B) {
+            B_.dim(0).set_bounds(0, num_cols).dim(1).set_bounds(0, sum_size);
+        } else {
+            B_.dim(0).set_bounds(0, sum_size).dim(1).set_bounds(0, num_cols);
+        }
+        B_.dim(2).set_bounds(0, batch_size);
+        C_.dim(0).set_bounds(0, num_rows);
+        C_.dim(1).set_bounds(0, num_cols);
+        C_.dim(2).set_min(0);
+        result_.dim(0).set_bounds(0, num_rows).dim(1).set_bounds(0, num_cols).dim(2).set_bounds(0, batch_size);
+        if constexpr (per_matrix_scalars) {
+            a_.dim(0).set_bounds(0, batch_size);
+            b_.dim(0).set_bounds(0, batch_size);
+        }
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<float>, sgemm)
 HALIDE_REGISTER_GENERATOR(GEMMGenerator<double>, dgemm)
+HALIDE_REGISTER_GENERATOR((GEMMBatchedGenerator<float, true>), sgemm_batched)
+HALIDE_REGISTER_GENERATOR((GEMMBatchedGenerator<double, true>), dgemm_batched)
+HALIDE_REGISTER_GENERATOR((GEMMBatchedGenerator<float, false>), sgemm_strided_batched)
+HALIDE_REGISTER_GENERATOR((GEMMBatchedGenerator<double, false>), dgemm_strided_batched)
@@ -8,7 +8,10 @@
 #include "halide_daxpy_impl.h"
 #include "halide_dcopy_impl.h"
 #include "halide_ddot.h"
+#include "halide_dgemm_batched_impl.h"
 #include "halide_dgemm_notrans.h"
+#include "halide_dgemm_strided_batched_impl.h"
+#include "halide_dgemm_strided_batched_shared_A.h"
 #include "halide_dgemm_transA.h"
 #include "halide_dgemm_transAB.h"
 #include "halide_dgemm_transB.h"
@@ -20,7 +23,10 @@
 #include "halide_saxpy_impl.h"
 #include "halide_scopy_impl.h"
 #include "halide_sdot.h"
+#include "halide_sgemm_batched_impl.h"
 #include "halide_sgemm_notrans.h"
+#include "halide_sgemm_strided_batched_impl.h"
+#include "halide_sgemm_strided_batched_shared_A.h"
 #include "halide_sgemm_transA.h"
 #include "halide_sgemm_transAB.h"
 #include "halide_sgemm_transB.h"
@@ -103,6 +109,35 @@ inline int halide_dgemm(bool transA, bool transB, double a, halide_buffer_t *A,
     return -1;
 }
 
+// Batched gemm. A, B and C are 3D buffers whose last dimension indexes
+// the batch; a and b hold one alpha and beta per matrix.
+inline int halide_sgemm_batched(halide_buffer_t *a, halide_buffer_t *A, halide_buffer_t *B, halide_buffer_t *b, halide_buffer_t *C) {
+    return halide_sgemm_batched_impl(a, A, B, b, C, C);
+}
+
+inline int halide_dgemm_batched(halide_buffer_t *a, halide_buffer_t *A, halide_buffer_t *B, halide_buffer_t *b, halide_buffer_t *C) {
+    return halide_dgemm_batched_impl(a, A, B, b, C, C);
+}
+
+// Strided batched gemm, with one alpha and beta for the whole batch. If
+// shared_A is true, A has a batch extent of one and is used for every
+// matrix in the batch.
+inline int halide_sgemm_strided_batched(bool shared_A, float a, halide_buffer_t *A, halide_buffer_t *B, float b, halide_buffer_t *C) {
+    if (shared_A) {
+        return halide_sgemm_strided_batched_shared_A(a, A, B, b, C, C);
+    } else {
+        return halide_sgemm_strided_batched_impl(a, A, B, b, C, C);
+    }
+}
+
+inline int halide_dgemm_strided_batched(bool shared_A, double a, halide_buffer_t *A, halide_buffer_t *B, double b, halide_buffer_t *C) {
+    if (shared_A) {
+        return halide_dgemm_strided_batched_shared_A(a, A, B, b, C, C);
+    } else {
+        return halide_dgemm_strided_batched_impl(a, A, B, b, C, C);
+    }
+}
+
 enum HBLAS_ORDER { HblasRowMajor = 101,
                    HblasColMajor = 102 };
 enum HBLAS_TRANSPOSE { HblasNoTrans = 111,
@@ -242,6 +242,274 @@ private:
     }
 };
 
+// A fixed-point version of LocalLaplacian, for photo pipelines that can
+// trade a little precision for speed and memory. The pyramids are int16 with
+// fixed_bits fractional bits, and the remapping function is an int16 lookup
+// table. The color is reintroduced in floating point, as in LocalLaplacian.
+class LocalLaplacianFast : public Halide::Generator<LocalLaplacianFast> {
+public:
+    GeneratorParam<int> pyramid_levels{"pyramid_levels", 8, 1, maxJ};
+    // Compute the finest pyramid levels in strips of the output, instead of
+    // over the whole image at root, so that memory use is proportional to the
+    // width of the image rather than its area. The coarse levels still need
+    // the whole image, so they are computed at root from a second copy of the
+    // fine levels, which is in turn computed in strips of the coarse levels.
+    GeneratorParam<bool> streaming{"streaming", false};
+
+    Input<Buffer<uint16_t, 3>> input{"input"};
+    Input<int> levels{"levels"};
+    Input<float> alpha{"alpha"};
+    Input<float> beta{"beta"};
+    Output<Buffer<uint16_t, 3>> output{"output"};
+
+    void generate() {
+        /* THE ALGORITHM */
+        const int J = pyramid_levels;
+        // The number of levels computed in strips of the output.
+        const int S = streaming ? std::min(3, J) : 0;
+        const int one = 1 << fixed_bits;
+
+        // Make the remapping function as a lookup table.
+        Func remap;
+        Expr fx = cast<float>(x) / 256.0f;
+        remap(x) = cast<int16_t>(clamp(round(alpha * fx * exp(-fx * fx / 2.0f) * one), -32768, 32767));
+
+        // Set a boundary condition
+        Func clamped = Halide::BoundaryConditions::repeat_edge(input);
+
+        // Convert to floating point, for reintroducing the color.
+        Func floating;
+        floating(x, y, c) = clamped(x, y, c) / 65535.0f;
+
+        // Get the luminance channel, in fixed point. The weights add up to
+        // 1 << 16.
+        auto make_gray = [&]() {
+            Func gray;
+            Expr sum = (cast<uint32_t>(clamped(x, y, 0)) * 19595 +
+                        cast<uint32_t>(clamped(x, y, 1)) * 38470 +
+                        cast<uint32_t>(clamped(x, y, 2)) * 7471);
+            gray(x, y) = cast<int16_t>(((sum >> (32 - fixed_bits - 1)) + 1) >> 1);
+            return gray;
+        };
+
+        // Make the bottom level of the processed Gaussian pyramid.
+        Expr beta_fixed = cast<int>(round(beta * 256.0f));
+        auto make_processed = [&](Func gray) {
+            Func processed;
+            Expr level = (k * one + (levels - 1) / 2) / (levels - 1);
+            Expr g = cast<int>(gray(x, y));
+            // Do a lookup into a lut with 256 entires per intensity level
+            Expr idx = clamp((g * (levels - 1)) >> (fixed_bits - 8), 0, (levels - 1) * 256);
+            Expr value = level + ((beta_fixed * (g - level) + 128) >> 8) + cast<int>(remap(idx - 256 * k));
+            processed(x, y, k) = cast<int16_t>(clamp(value, -32768, 32767));
+            return processed;
+        };
+
+        Func gray = make_gray();
+
+        // Make the processed Gaussian pyramid, and the Gaussian pyramid of
+        // the input. When streaming, level S and above are computed from a
+        // copy of the levels below S.
+        Func gPyramid[maxJ];
+        Func inGPyramid[maxJ];
+        std::vector<Func> coarse_gPyramid, coarse_inGPyramid;
+        Func coarse_gray, coarse_in_gray;
+        gPyramid[0] = make_processed(gray);
+        inGPyramid[0](x, y) = gray(x, y);
+        for (int j = 1; j < J; j++) {
+            if (j == S) {
+                coarse_gray = make_gray();
+                coarse_in_gray = make_gray();
+                coarse_gPyramid.push_back(make_processed(coarse_gray));
+                coarse_inGPyramid.push_back(coarse_in_gray);
+                for (int i = 1; i < S; i++) {
+                    coarse_gPyramid.push_back(downsample(coarse_gPyramid.back()));
+                    coarse_inGPyramid.push_back(downsample(coarse_inGPyramid.back()));
+                }
+                gPyramid[j](x, y, k) = downsample(coarse_gPyramid.back())(x, y, k);
+                inGPyramid[j](x, y) = downsample(coarse_inGPyramid.back())(x, y);
+            } else {
+                gPyramid[j](x, y, k) = downsample(gPyramid[j - 1])(x, y, k);
+                inGPyramid[j](x, y) = downsample(inGPyramid[j - 1])(x, y);
+            }
+        }
+
+        // Get its laplacian pyramid
+        Func lPyramid[maxJ];
+        lPyramid[J - 1](x, y, k) = gPyramid[J - 1](x, y, k);
+        for (int j = J - 2; j >= 0; j--) {
+            lPyramid[j](x, y, k) = gPyramid[j](x, y, k) - upsample(gPyramid[j + 1])(x, y, k);
+        }
+
+        // Make the laplacian pyramid of the output
+        Func outLPyramid[maxJ];
+        for (int j = 0; j < J; j++) {
+            // Split input pyramid value into integer and fractional parts
+            Expr level = cast<int>(inGPyramid[j](x, y)) * (levels - 1);
+            Expr li = clamp(level >> fixed_bits, 0, levels - 2);
+            Expr lf = level - (li << fixed_bits);
+            // Linearly interpolate between the nearest processed pyramid levels
+            Expr lo = cast<int>(lPyramid[j](x, y, li));
+            Expr hi = cast<int>(lPyramid[j](x, y, li + 1));
+            outLPyramid[j](x, y) = cast<int16_t>(lo + (((hi - lo) * lf + one / 2) >> fixed_bits));
+        }
+
+        // Make the Gaussian pyramid of the output
+        Func outGPyramid[maxJ];
+        outGPyramid[J - 1](x, y) = outLPyramid[J - 1](x, y);
+        for (int j = J - 2; j >= 0; j--) {
+            outGPyramid[j](x, y) = upsample(outGPyramid[j + 1])(x, y) + outLPyramid[j](x, y);
+        }
+
+        // Reintroduce color
+        Func color;
+        float eps = 0.01f;
+        Expr gray_float = 0.299f * floating(x, y, 0) + 0.587f * floating(x, y, 1) + 0.114f * floating(x, y, 2);
+        color(x, y, c) = cast<float>(outGPyramid[0](x, y)) * (1.0f / one) * (floating(x, y, c) + eps) / (gray_float + eps);
+
+        // Convert back to 16-bit
+        output(x, y, c) = cast<uint16_t>(clamp(color(x, y, c), 0.0f, 1.0f) * 65535.0f);
+
+        /* ESTIMATES */
+        input.set_estimates({{0, 8192}, {0, 6144}, {0, 3}});
+        levels.set_estimate(8);
+        alpha.set_estimate(1);
+        beta.set_estimate(1);
+        output.set_estimates({{0, 8192}, {0, 6144}, {0, 3}});
+
+        /* THE SCHEDULE */
+        if (using_autoscheduler()) {
+            // Nothing.
+        } else if (get_target().has_gpu_feature()) {
+            // GPU schedule.
+            user_assert(!streaming) << "local_laplacian_fast does not support streaming on GPUs\n";
+            remap.compute_root();
+            Var xi, yi;
+            output.compute_root().gpu_tile(x, y, xi, yi, 16, 8);
+            for (int j = 0; j < J; j++) {
+                int blockw = 16, blockh = 8;
+                if (j > 3) {
+                    blockw = 2;
+                    blockh = 2;
+                }
+                if (j > 0) {
+                    inGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+                    gPyramid[j].compute_root().reorder(k, x, y).gpu_tile(x, y, xi, yi, blockw, blockh);
+                }
+                outGPyramid[j].compute_root().gpu_tile(x, y, xi, yi, blockw, blockh);
+            }
+        } else {
+            // CPU schedule. This is the schedule of LocalLaplacian, with
+            // twice as many lanes for the 16-bit pyramids.
+            const int vec = get_target().natural_vector_size<int16_t>();
+
+            remap.compute_root();
+            Var yo;
+            output.reorder(c, x, y).split(y, yo, y, streaming ? 128 : 64).parallel(yo).vectorize(x, vec);
+            if (S > 0) {
+                gray.store_at(output, yo).compute_at(output, y).vectorize(x, vec);
+            } else {
+                gray.compute_root().parallel(y, 32).vectorize(x, vec);
+            }
+            for (int j = 1; j < std::min(5, J); j++) {
+                if (j < S) {
+                    // Fused into the strips of the output, along with the
+                    // output pyramid.
+                    inGPyramid[j]
+                        .store_at(output, yo)
+                        .compute_at(output, y)
+                        .vectorize(x, vec);
+                    gPyramid[j]
+                        .store_at(output, yo)
+                        .compute_at(output, y)
+                        .reorder_storage(x, k, y)
+                        .reorder(k, y)
+                        .vectorize(x, vec);
+                } else if (j == S) {
+                    // The coarse levels' copy of the fine levels is fused
+                    // into the strips of this level.
+                    inGPyramid[j]
+                        .compute_root()
+                        .split(y, yo, y, 8)
+                        .parallel(yo)
+                        .vectorize(x, vec);
+                    gPyramid[j]
+                        .compute_root()
+                        .reorder_storage(x, k, y)
+                        .reorder(k, y)
+                        .split(y, yo, y, 8)
+                        .parallel(yo)
+                        .vectorize(x, vec);
+                    coarse_in_gray.store_at(inGPyramid[j], yo).compute_at(inGPyramid[j], y).vectorize(x, vec);
+                    coarse_gray.store_at(gPyramid[j], yo).compute_at(gPyramid[j], y).vectorize(x, vec);
+                    for (int i = 1; i < S; i++) {
+                        coarse_inGPyramid[i]
+                            .store_at(inGPyramid[j], yo)
+                            .compute_at(inGPyramid[j], y)
+                            .vectorize(x, vec);
+                        coarse_gPyramid[i]
+                            .store_at(gPyramid[j], yo)
+                            .compute_at(gPyramid[j], y)
+                            .reorder_storage(x, k, y)
+                            .reorder(k, y)
+                            .vectorize(x, vec);
+                    }
+                } else {
+                    inGPyramid[j]
+                        .compute_root()
+                        .parallel(y, 32)
+                        .vectorize(x, vec);
+                    gPyramid[j]
+                        .compute_root()
+                        .reorder_storage(x, k, y)
+                        .reorder(k, y)
+                        .parallel(y, 8)
+                        .vectorize(x, vec);
+                }
+                outGPyramid[j]
+                    .store_at(output, yo)
+                    .compute_at(output, y)
+                    .fold_storage(y, 4)
+                    .vectorize(x, vec);
+            }
+            outGPyramid[0].compute_at(output, y).vectorize(x, vec);
+            for (int j = 5; j < J; j++) {
+                inGPyramid[j].compute_root();
+                gPyramid[j].compute_root().parallel(k);
+                outGPyramid[j].compute_root();
+            }
+        }
+    }
+
+private:
+    Var x, y, c, k;
+
+    // The number of fractional bits in the pyramids. The processed pyramid
+    // can go a little outside [0, 1], so leave some headroom.
+    static constexpr int fixed_bits = 13;
+
+    // Downsample with a 1 3 3 1 filter, rounding to nearest
+    Func downsample(Func f) {
+        using Halide::_;
+        Func downx, downy;
+        downx(x, y, _) = cast<int16_t>((cast<int>(f(2 * x - 1, y, _)) + 3 * (cast<int>(f(2 * x, y, _)) + cast<int>(f(2 * x + 1, y, _))) + cast<int>(f(2 * x + 2, y, _)) + 4) >> 3);
+        downy(x, y, _) = cast<int16_t>((cast<int>(downx(x, 2 * y - 1, _)) + 3 * (cast<int>(downx(x, 2 * y, _)) + cast<int>(downx(x, 2 * y + 1, _))) + cast<int>(downx(x, 2 * y + 2, _)) + 4) >> 3);
+        return downy;
+    }
+
+    // Upsample using bilinear interpolation, with weights of 1/4 and 3/4
+    Func upsample(Func f) {
+        using Halide::_;
+        Func upx, upy;
+        Expr wx = (x % 2) * 2 + 1;
+        Expr wy = (y % 2) * 2 + 1;
+        upx(x, y, _) = cast<int16_t>((cast<int>(f((x + 1) / 2, y, _)) * (4 - wx) + cast<int>(f((x - 1) / 2, y, _)) * wx + 2) >> 2);
+        upy(x, y, _) = cast<int16_t>((cast<int>(upx(x, (y + 1) / 2, _)) * (4 - wy) + cast<int>(upx(x, (y - 1) / 2, _)) * wy + 2) >> 2);
+        return upy;
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(LocalLaplacian, local_laplacian)
+HALIDE_REGISTER_GENERATOR(LocalLaplacianFast, local_laplacian_fast)
@@ -1,9 +1,12 @@
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 
 #include "local_laplacian.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "local_laplacian_auto_schedule.h"
+#include "local_laplacian_fast.h"
+#include "local_laplacian_stream.h"
 #endif
 
 #include "HalideBuffer.h"
@@ -46,6 +49,30 @@ int main(int argc, char **argv) {
         output.device_sync();
     });
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
+
+    // Fixed-point versions
+    Buffer<uint16_t, 3> output_fast(input.width(), input.height(), 3);
+    double best_fast = benchmark(timing, 1, [&]() {
+        local_laplacian_fast(input, levels, alpha / (levels - 1), beta, output_fast);
+        output_fast.device_sync();
+    });
+    printf("Fixed-point time: %gms\n", best_fast * 1e3);
+
+    double best_stream = benchmark(timing, 1, [&]() {
+        local_laplacian_stream(input, levels, alpha / (levels - 1), beta, output_fast);
+        output_fast.device_sync();
+    });
+    printf("Fixed-point streaming time: %gms\n", best_stream * 1e3);
+
+    local_laplacian(input, levels, alpha / (levels - 1), beta, output);
+    output.device_sync();
+    output.copy_to_host();
+    output_fast.copy_to_host();
+    double total_error = 0;
+    output.for_each_element([&](int x, int y, int c) {
+        total_error += std::abs(output(x, y, c) - output_fast(x, y, c));
+    });
+    printf("Fixed-point mean absolute difference: %g\n", total_error / output.number_of_elements());
 #endif
 
     convert_and_save_image(output, argv[6]);
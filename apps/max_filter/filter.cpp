@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -7,6 +8,9 @@
 
 #include "max_filter.h"
 #include "max_filter_auto_schedule.h"
+#include "max_filter_rectangle.h"
+#include "max_filter_van_herk.h"
+#include "min_filter_rectangle.h"
 
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
@@ -34,6 +38,52 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", best_auto * 1e3);
 
+    // The van Herk/Gil-Werman filters. The circle is an octagon, so it
+    // only approximates the output of max_filter.
+    Halide::Runtime::Buffer<float, 3> output_van_herk(input.width(), input.height(), 3);
+    double best_van_herk = benchmark([&]() {
+        max_filter_van_herk(input, output_van_herk);
+        output_van_herk.device_sync();
+    });
+    printf("van Herk octagon time: %gms\n", best_van_herk * 1e3);
+
+    // Check the rectangular max and min filters against a brute force
+    // filter, at a sparse set of pixels.
+    const int radius = 26;
+    for (bool is_min : {false, true}) {
+        Halide::Runtime::Buffer<float, 3> output_rect(input.width(), input.height(), 3);
+        double best_rect = benchmark([&]() {
+            if (is_min) {
+                min_filter_rectangle(input, output_rect);
+            } else {
+                max_filter_rectangle(input, output_rect);
+            }
+            output_rect.device_sync();
+        });
+        printf("van Herk %s rectangle time: %gms\n", is_min ? "min" : "max", best_rect * 1e3);
+
+        output_rect.copy_to_host();
+        for (int c = 0; c < 3; c++) {
+            for (int y = 0; y < input.height(); y += 37) {
+                for (int x = 0; x < input.width(); x += 41) {
+                    float correct = input(x, y, c);
+                    for (int dy = -radius; dy <= radius; dy++) {
+                        for (int dx = -radius; dx <= radius; dx++) {
+                            int xx = std::min(std::max(x + dx, 0), input.width() - 1);
+                            int yy = std::min(std::max(y + dy, 0), input.height() - 1);
+                            correct = is_min ? std::min(correct, input(xx, yy, c)) : std::max(correct, input(xx, yy, c));
+                        }
+                    }
+                    if (output_rect(x, y, c) != correct) {
+                        printf("%s_filter_rectangle(%d, %d, %d) = %f instead of %f\n",
+                               is_min ? "min" : "max", x, y, c, output_rect(x, y, c), correct);
+                        return 1;
+                    }
+                }
+            }
+        }
+    }
+
     convert_and_save_image(output, argv[2]);
 
     printf("Success!\n");
@@ -1,4 +1,5 @@
 #include "Halide.h"
+#include "morphology.h"
 
 namespace {
 
@@ -116,6 +117,68 @@ public:
     }
 };
 
+enum class WindowShape {
+    Rectangle,
+    Circle,
+};
+
+// A max or min filter over a square or a (nearly) circular window of the
+// given radius, in constant time per pixel for any radius.
+class MaxVanHerk : public Halide::Generator<MaxVanHerk> {
+public:
+    GeneratorParam<int> radius_{"radius", 26};
+    GeneratorParam<WindowShape> shape_{"shape", WindowShape::Circle,
+                                       {{"rectangle", WindowShape::Rectangle},
+                                        {"circle", WindowShape::Circle}}};
+    // Take the min instead of the max.
+    GeneratorParam<bool> min_{"min", false};
+    Input<Buffer<float, 3>> input_{"input"};
+    Output<Buffer<float, 3>> output_{"output"};
+
+    void generate() {
+        Var x("x"), y("y"), c("c");
+
+        Func input = repeat_edge(input_,
+                                 {{input_.dim(0).min(), input_.dim(0).extent()},
+                                  {input_.dim(1).min(), input_.dim(1).extent()}});
+
+        const int radius = radius_;
+        const MorphologyOp op = min_ ? MorphologyOp::Min : MorphologyOp::Max;
+        Func filtered;
+        if (shape_ == WindowShape::Rectangle) {
+            filtered = rectangle_filter(input, 2 * radius + 1, 2 * radius + 1, op,
+                                        get_target(), using_autoscheduler());
+        } else {
+            filtered = circle_filter(input, radius, op, get_target(), using_autoscheduler());
+        }
+        output_(x, y, c) = filtered(x, y, c);
+
+        // Estimates (for autoscheduler; ignored otherwise)
+        {
+            input_.dim(0).set_estimate(0, 1536);
+            input_.dim(1).set_estimate(0, 2560);
+            input_.dim(2).set_estimate(0, 3);
+            output_.dim(0).set_estimate(0, 1536);
+            output_.dim(1).set_estimate(0, 2560);
+            output_.dim(2).set_estimate(0, 3);
+        }
+
+        // Schedule. The passes of the filter schedule themselves, so this
+        // only copies the last one into the output.
+        if (!using_autoscheduler()) {
+            filtered.compute_at(output_, Var::outermost());
+            if (get_target().has_gpu_feature()) {
+                Var xi, yi;
+                output_.gpu_tile(x, y, xi, yi, 32, 8);
+            } else {
+                output_.parallel(y, 8)
+                    .vectorize(x, natural_vector_size<float>());
+            }
+        }
+    }
+};
+
 }  // namespace
 
 HALIDE_REGISTER_GENERATOR(Max, max_filter)
+HALIDE_REGISTER_GENERATOR(MaxVanHerk, max_filter_van_herk)
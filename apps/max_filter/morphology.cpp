@@ -0,0 +1,148 @@
+#include "morphology.h"
+
+#include <cmath>
+
+using namespace Halide;
+
+namespace {
+
+Var x("x"), y("y"), c("c");
+
+Expr reduce(MorphologyOp op, Expr a, Expr b) {
+    return op == MorphologyOp::Max ? max(a, b) : min(a, b);
+}
+
+// Swap x and y.
+Func transpose(Func f, const Target &target, bool skip_schedule) {
+    Func t("transpose");
+    t(x, y, c) = f(y, x, c);
+
+    if (!skip_schedule) {
+        Var xo, yo, xi, yi;
+        if (target.has_gpu_feature()) {
+            t.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+        } else {
+            // Transpose square tiles of one vector per row.
+            const int vec = target.natural_vector_size(f.type());
+            t.compute_root()
+                .tile(x, y, xo, yo, xi, yi, vec, vec)
+                .vectorize(xi)
+                .unroll(yi)
+                .parallel(yo);
+        }
+    }
+    return t;
+}
+
+// Filter f along lines that step one row at a time. The lines are
+// indexed by u, the column at which they cross y = 0, and the pixels of a
+// line by v = y. The running maxima are computed in blocks of length
+// pixels of each line, with vi the index within block vb.
+Func steep_line_filter(Func f, int dx, int length, MorphologyOp op,
+                       const Target &target, bool skip_schedule) {
+    Var u("u"), vi("vi"), vb("vb");
+    Expr v = vb * length + vi;
+
+    Func prefix("prefix"), suffix("suffix");
+    prefix(u, vi, vb, c) = f(u + dx * v, v, c);
+    suffix(u, vi, vb, c) = f(u + dx * v, v, c);
+
+    // Run forwards through each block for the prefix, and backwards for
+    // the suffix.
+    RDom r(1, length - 1);
+    prefix(u, r, vb, c) = reduce(op, prefix(u, r - 1, vb, c), prefix(u, r, vb, c));
+    Expr flip_r = length - 1 - r;
+    suffix(u, flip_r, vb, c) = reduce(op, suffix(u, flip_r + 1, vb, c), suffix(u, flip_r, vb, c));
+
+    // The window starting at s ends at e, in the next block unless s is at
+    // the start of a block, in which case both samples are the whole block.
+    Func result("line_filter");
+    Expr s = y - (length - 1) / 2;
+    Expr e = s + length - 1;
+    Expr line = x - dx * y;
+    result(x, y, c) = reduce(op,
+                             suffix(line, s % length, s / length, c),
+                             prefix(line, e % length, e / length, c));
+
+    if (!skip_schedule) {
+        Var xo, yo, xi, yi;
+        if (target.has_gpu_feature()) {
+            Var ui, vbi;
+            result.compute_root().gpu_tile(x, y, xi, yi, 32, 8);
+            for (Func p : {prefix, suffix}) {
+                p.compute_root()
+                    .reorder(vi, u, vb, c)
+                    .gpu_tile(u, vb, ui, vbi, 32, 4);
+                p.update()
+                    .reorder(r, u, vb, c)
+                    .gpu_tile(u, vb, ui, vbi, 32, 4);
+            }
+        } else {
+            // Work down strips of columns, a block of rows at a time. Each
+            // block of rows needs only one new block of the running maxima
+            // of vertical lines, which are kept in a sliding window.
+            const int vec = target.natural_vector_size(f.type());
+            result.compute_root()
+                .split(x, xo, xi, vec * 8)
+                .split(y, yo, yi, length, TailStrategy::GuardWithIf)
+                .reorder(xi, yi, yo, xo, c)
+                .vectorize(xi, vec)
+                .parallel(xo);
+            for (Func p : {prefix, suffix}) {
+                p.store_at(result, xo)
+                    .compute_at(result, yo)
+                    .vectorize(u, vec);
+                p.update()
+                    .reorder(u, r, vb, c)
+                    .vectorize(u, vec);
+            }
+        }
+    }
+    return result;
+}
+
+}  // namespace
+
+Func line_filter(Func f, const MorphologyLine &line, MorphologyOp op,
+                 const Target &target, bool skip_schedule) {
+    user_assert(line.length >= 1) << "Lines must have at least one pixel\n";
+    user_assert(line.dy == 1 || (line.dy == 0 && line.dx == 1))
+        << "Lines must be horizontal, or step one row at a time\n";
+
+    if (line.length == 1) {
+        return f;
+    } else if (line.dy == 0) {
+        // Rows are filtered as the columns of the transpose, so that
+        // the running maxima are vectorized along rows.
+        Func f_T = transpose(f, target, skip_schedule);
+        Func filtered_T = steep_line_filter(f_T, 0, line.length, op, target, skip_schedule);
+        return transpose(filtered_T, target, skip_schedule);
+    } else {
+        return steep_line_filter(f, line.dx, line.length, op, target, skip_schedule);
+    }
+}
+
+Func polygon_filter(Func f, const std::vector<MorphologyLine> &lines, MorphologyOp op,
+                    const Target &target, bool skip_schedule) {
+    for (const MorphologyLine &line : lines) {
+        f = line_filter(f, line, op, target, skip_schedule);
+    }
+    return f;
+}
+
+Func rectangle_filter(Func f, int width, int height, MorphologyOp op,
+                      const Target &target, bool skip_schedule) {
+    return polygon_filter(f, {{0, 1, height}, {1, 0, width}}, op, target, skip_schedule);
+}
+
+Func circle_filter(Func f, int radius, MorphologyOp op,
+                   const Target &target, bool skip_schedule) {
+    // A regular octagon with an inscribed circle of the given radius is the
+    // sum of a horizontal and a vertical line of 2 * (radius - d) + 1
+    // pixels, and two diagonal lines of d steps, where
+    // d = 2 * radius / (2 + sqrt(2)).
+    const int d = (int)std::lround(2 * radius / (2 + std::sqrt(2.0)));
+    const int side = 2 * (radius - d) + 1;
+    return polygon_filter(f, {{0, 1, side}, {1, 0, side}, {1, 1, d + 1}, {-1, 1, d + 1}},
+                          op, target, skip_schedule);
+}
@@ -0,0 +1,55 @@
+#ifndef MORPHOLOGY_H
+#define MORPHOLOGY_H
+
+#include <vector>
+
+#include "Halide.h"
+
+// Max and min filters (dilation and erosion) using the van Herk/Gil-Werman
+// algorithm. A window of n pixels along a line is filtered by splitting the
+// line into blocks of n pixels, and taking running maxima forwards and
+// backwards within each block. Every window then covers the end of one block
+// and the start of the next, so its max is the max of one sample of each.
+// This costs three comparisons per pixel, for any window size.
+//
+// All of these filter Funcs of three dimensions (x, y, c), which must be
+// defined everywhere the windows reach (e.g. with a boundary condition).
+// The filters are vectorized along rows.
+
+enum class MorphologyOp {
+    Max,
+    Min,
+};
+
+// A line of pixels through each pixel (x, y): the pixels
+// (x + i * dx, y + i * dy) for i in [-(length - 1) / 2, length / 2]. The
+// line must be horizontal (dx = 1, dy = 0), or step one row at a time
+// (dy = 1, any dx).
+struct MorphologyLine {
+    int dx, dy;
+    int length;
+};
+
+// Take the max or min of f over the given line through each pixel.
+Halide::Func line_filter(Halide::Func f, const MorphologyLine &line, MorphologyOp op,
+                         const Halide::Target &target, bool skip_schedule = false);
+
+// Take the max or min of f over the Minkowski sum of the given lines, by
+// filtering with each line in turn. Sums of lines make convex polygons that
+// are symmetric about their center.
+Halide::Func polygon_filter(Halide::Func f, const std::vector<MorphologyLine> &lines, MorphologyOp op,
+                            const Halide::Target &target, bool skip_schedule = false);
+
+// Take the max or min of f over a width x height rectangle centered on each
+// pixel.
+Halide::Func rectangle_filter(Halide::Func f, int width, int height, MorphologyOp op,
+                              const Halide::Target &target, bool skip_schedule = false);
+
+// Take the max or min of f over a regular octagon approximating a circle of
+// the given radius, centered on each pixel to within half a pixel. A disk is
+// not a sum of lines, so this is as close to a circle as constant time per
+// pixel gets.
+Halide::Func circle_filter(Halide::Func f, int radius, MorphologyOp op,
+                           const Halide::Target &target, bool skip_schedule = false);
+
+#endif
@@ -1,8 +1,11 @@
 #include <chrono>
+#include <cmath>
 #include <cstdio>
 
 #include "nl_means.h"
 #include "nl_means_auto_schedule.h"
+#include "nl_means_integral.h"
+#include "nl_means_integral_int.h"
 
 #include "HalideBuffer.h"
 #include "halide_benchmark.h"
@@ -46,6 +49,39 @@ int main(int argc, char **argv) {
     });
     printf("Auto-scheduled time: %gms\n", min_t_auto * 1e3);
 
+    // Versions that find the patch differences with integral images
+    Buffer<float, 3> output_integral(input.width(), input.height(), 3);
+    double min_t_integral = benchmark(timing_iterations, 1, [&]() {
+        nl_means_integral(input, patch_size, search_area, sigma, output_integral);
+        output_integral.device_sync();
+    });
+    printf("Integral image time: %gms\n", min_t_integral * 1e3);
+
+    Buffer<float, 3> output_integral_int(input.width(), input.height(), 3);
+    double min_t_integral_int = benchmark(timing_iterations, 1, [&]() {
+        nl_means_integral_int(input, patch_size, search_area, sigma, output_integral_int);
+        output_integral_int.device_sync();
+    });
+    printf("Integral image, integer distances time: %gms\n", min_t_integral_int * 1e3);
+
+    nl_means(input, patch_size, search_area, sigma, output);
+    output.copy_to_host();
+    output_integral.copy_to_host();
+    output_integral_int.copy_to_host();
+    double error_integral = 0, error_integral_int = 0;
+    output.for_each_element([&](int x, int y, int c) {
+        error_integral += std::abs(output(x, y, c) - output_integral(x, y, c));
+        error_integral_int += std::abs(output(x, y, c) - output_integral_int(x, y, c));
+    });
+    error_integral /= output.number_of_elements();
+    error_integral_int /= output.number_of_elements();
+    printf("Integral image mean absolute difference: %g\n", error_integral);
+    printf("Integral image, integer distances mean absolute difference: %g\n", error_integral_int);
+    if (error_integral > 1e-3) {
+        printf("The integral image version does not match\n");
+        return 1;
+    }
+
     convert_and_save_image(output, argv[6]);
 
     printf("Success!\n");
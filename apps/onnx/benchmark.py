@@ -0,0 +1,142 @@
+#!/usr/bin/env python3
+"""Benchmark an ONNX model compiled with Halide against onnxruntime.
+
+The whole model is compiled into a single Halide pipeline, scheduled with
+the requested autoscheduler. If onnxruntime is installed, the model is also
+run with it on the same random inputs, to compare the outputs and the
+runtimes.
+
+Example:
+  PYTHONPATH=bin/host python3 benchmark.py model.onnx \\
+      --autoscheduler Adams2019 \\
+      --plugin $HALIDE_DISTRIB_PATH/lib/libautoschedule_adams2019.so \\
+      --dim batch=1
+"""
+
+import argparse
+import time
+
+import numpy as np
+import onnx
+
+from model import Model
+
+
+def parse_params(values):
+    result = {}
+    for v in values:
+        k, _, val = v.partition("=")
+        result[k] = val
+    return result
+
+
+def input_shapes(onnx_model, dim_sizes):
+    initializers = set(t.name for t in onnx_model.graph.initializer)
+    shapes = {}
+    for i in onnx_model.graph.input:
+        if i.name in initializers:
+            continue
+        shape = []
+        for d in i.type.tensor_type.shape.dim:
+            if d.HasField("dim_value"):
+                shape.append(d.dim_value)
+            elif d.dim_param in dim_sizes:
+                shape.append(dim_sizes[d.dim_param])
+            else:
+                raise ValueError(
+                    "Size of dimension %s of input %s is unknown; use --dim %s=<size>"
+                    % (d.dim_param, i.name, d.dim_param)
+                )
+        shapes[i.name] = (i.type.tensor_type.elem_type, shape)
+    return shapes
+
+
+def random_input(elem_type, shape):
+    dtype = onnx.mapping.TENSOR_TYPE_TO_NP_TYPE[elem_type]
+    if np.issubdtype(dtype, np.floating):
+        return np.random.rand(*shape).astype(dtype)
+    if dtype == np.bool_:
+        return np.random.randint(0, 2, size=shape).astype(dtype)
+    return np.random.randint(0, 100, size=shape).astype(dtype)
+
+
+def time_it(fn, iterations):
+    fn()  # warm up
+    start = time.perf_counter()
+    for _ in range(iterations):
+        fn()
+    return (time.perf_counter() - start) / iterations
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter
+    )
+    parser.add_argument("model", help="path of the .onnx model")
+    parser.add_argument("--autoscheduler", default="Mullapudi2016")
+    parser.add_argument(
+        "--autoscheduler-param",
+        action="append",
+        default=[],
+        metavar="KEY=VALUE",
+        help="parameter of the autoscheduler, may be repeated",
+    )
+    parser.add_argument("--plugin", default="", help="library to load the autoscheduler from")
+    parser.add_argument(
+        "--dim",
+        action="append",
+        default=[],
+        metavar="NAME=SIZE",
+        help="size of a symbolic input dimension, may be repeated",
+    )
+    parser.add_argument("--iterations", type=int, default=10)
+    parser.add_argument("--device", default="")
+    args = parser.parse_args()
+
+    onnx_model = onnx.load(args.model)
+    dim_sizes = {k: int(v) for k, v in parse_params(args.dim).items()}
+    shapes = input_shapes(onnx_model, dim_sizes)
+    inputs = {name: random_input(t, s) for name, (t, s) in shapes.items()}
+
+    model = Model()
+    model.BuildFromOnnxModel(onnx_model, dim_sizes)
+    start = time.perf_counter()
+    model.OptimizeSchedule(
+        args.autoscheduler, parse_params(args.autoscheduler_param), args.plugin, args.device
+    )
+    schedule_time = time.perf_counter() - start
+    start = time.perf_counter()
+    model.CompileJit(args.device)
+    compile_time = time.perf_counter() - start
+
+    input_list = [inputs[name] for name in shapes]
+    halide_outputs = model.run(input_list, args.device)
+    halide_time = time_it(lambda: model.run(input_list, args.device), args.iterations)
+
+    print("Autoscheduling with %s: %.2f s" % (args.autoscheduler, schedule_time))
+    print("JIT compilation: %.2f s" % compile_time)
+    print("Halide: %.3f ms" % (halide_time * 1e3))
+
+    try:
+        import onnxruntime
+    except ImportError:
+        print("onnxruntime is not installed, skipping the comparison.")
+        return 0
+
+    session = onnxruntime.InferenceSession(args.model)
+    ort_outputs = session.run(None, inputs)
+    ort_time = time_it(lambda: session.run(None, inputs), args.iterations)
+    print("onnxruntime: %.3f ms" % (ort_time * 1e3))
+    print("Speedup over onnxruntime: %.2fx" % (ort_time / halide_time))
+
+    for output, halide_output, ort_output in zip(
+        onnx_model.graph.output, halide_outputs, ort_outputs
+    ):
+        diff = np.max(np.abs(np.asarray(halide_output, dtype=np.float64) -
+                             np.asarray(ort_output, dtype=np.float64)))
+        print("Max abs difference in %s: %g" % (output.name, diff))
+    return 0
+
+
+if __name__ == "__main__":
+    exit(main())
@@ -2,14 +2,86 @@
 
 
 from onnx.backend.base import Backend as BackendBase
+from onnx.backend.base import BackendRep
+import collections
 import onnx
 import model as halide_model
+import numpy as np
 import signal
 import base64
 import hashlib
 import datetime
 
 
+# Compiled models, keyed by the hash of the model, the shapes of the inputs,
+# the device and the autoscheduler options. Compiling a large model with an
+# autoscheduler takes much longer than running it, so this lets repeated
+# calls to prepare() or run_model() with the same model reuse the compiled
+# pipeline.
+_compiled_models = collections.OrderedDict()
+_max_compiled_models = 16
+
+
+def _compile(model, model_hash, input_shapes, device, options):
+    key = (model_hash, input_shapes, device,
+           tuple(sorted((k, str(v)) for k, v in options.items())))
+    if key in _compiled_models:
+        _compiled_models.move_to_end(key)
+        return _compiled_models[key]
+
+    # Tell the autoscheduler the actual sizes of the symbolic dimensions.
+    expected_dim_sizes = {}
+    initializers = set(t.name for t in model.graph.initializer)
+    inputs = [i for i in model.graph.input if i.name not in initializers]
+    for value_info, shape in zip(inputs, input_shapes):
+        dims = value_info.type.tensor_type.shape.dim
+        for dim, size in zip(dims, shape):
+            if dim.dim_param:
+                expected_dim_sizes[dim.dim_param] = size
+
+    compiled = halide_model.Model()
+    compiled.BuildFromOnnxModel(model, expected_dim_sizes)
+    autoscheduler = options.get('autoscheduler')
+    if autoscheduler is None and len(model.graph.node) > 10:
+        # Optimize the schedule of nontrivial models to make sure they
+        # complete in a reasonable amount of time
+        autoscheduler = 'Mullapudi2016'
+    if autoscheduler:
+        compiled.OptimizeSchedule(autoscheduler,
+                                  options.get('autoscheduler_params'),
+                                  options.get('autoscheduler_plugin', ''),
+                                  device)
+    compiled.CompileJit(device)
+
+    _compiled_models[key] = compiled
+    while len(_compiled_models) > _max_compiled_models:
+        _compiled_models.popitem(last=False)
+    return compiled
+
+
+class HalideBackendRep(BackendRep):
+    """A model prepared to run with Halide.
+
+    The whole model is compiled into one Halide pipeline the first time it
+    is run with a given set of input shapes.
+    """
+
+    def __init__(self, model, device, options):
+        self.model = model
+        self.model_hash = hashlib.sha256(model.SerializeToString()).hexdigest()
+        self.device = device
+        self.options = options
+
+    def compile(self, input_shapes):
+        return _compile(self.model, self.model_hash, input_shapes,
+                        self.device, self.options)
+
+    def run(self, inputs, **kwargs):
+        inputs = [np.asarray(i) for i in inputs]
+        input_shapes = tuple(tuple(i.shape) for i in inputs)
+        return self.compile(input_shapes).run(inputs, self.device)
+
+
 class HalideBackend(BackendBase):
     @classmethod
     def is_compatible(cls,
@@ -31,22 +103,43 @@ class HalideBackend(BackendBase):
                 ):
         """Prepare an ONNX model to run using the Halide backend.
 
-        Builds and returns an internal representation of the model (which
-        includes the actual Halide pipeline).
+        The model is converted and compiled as a single Halide pipeline when
+        it is first run with a given set of input shapes. Compiled pipelines
+        are cached, so preparing the same model again is cheap.
 
         :param model: The ONNX model to be converted.
         :param device: The device to execute this model on (Ignored for now).
+        :param autoscheduler: The autoscheduler used to schedule the whole
+                              pipeline, e.g. 'Mullapudi2016' or 'Adams2019'.
+                              By default, only models with more than 10
+                              nodes are autoscheduled (with Mullapudi2016).
+        :param autoscheduler_params: A dict of parameters for the
+                                     autoscheduler.
+        :param autoscheduler_plugin: The library to load the autoscheduler
+                                     from, if it isn't linked in.
         :returns: An internal object that can be used to run the model with
                   Halide.
         """
         onnx.checker.check_model(model)
 
-        prepared = halide_model.Model()
-        prepared.BuildFromOnnxModel(model)
-        # Optimize the schedule of nontrivial models to make sure they
-        # complete in a reasonable amount of time
-        if len(model.graph.node) > 10:
-            prepared.OptimizeSchedule()
+        options = {k: kwargs[k] for k in
+                   ('autoscheduler', 'autoscheduler_params', 'autoscheduler_plugin')
+                   if k in kwargs}
+        prepared = HalideBackendRep(model, device, options)
+        # Compile with the shapes declared by the model up front, if they
+        # are all known.
+        input_shapes = []
+        initializers = set(t.name for t in model.graph.initializer)
+        for i in model.graph.input:
+            if i.name in initializers:
+                continue
+            dims = i.type.tensor_type.shape.dim
+            if not all(d.HasField('dim_value') for d in dims):
+                input_shapes = None
+                break
+            input_shapes.append(tuple(d.dim_value for d in dims))
+        if input_shapes is not None:
+            prepared.compile(tuple(input_shapes))
         return prepared
 
     @classmethod
@@ -64,7 +157,7 @@ class HalideBackend(BackendBase):
         :returns: A list of numpy arrays (one for each model output).
         """
         prepared = cls.prepare(model, device, **kwargs)
-        return prepared.run(inputs, device)
+        return prepared.run(inputs)
 
     @classmethod
     def run_node(cls,
@@ -68,5 +68,26 @@ globals().update(backend_test
                  .test_cases)
 
 
+class CompiledModelCacheTest(unittest.TestCase):
+    def test_prepare_reuses_compiled_model(self):
+        from onnx import helper
+        from onnx import TensorProto
+        import numpy as np
+
+        X = helper.make_tensor_value_info('X', TensorProto.FLOAT, ['n', 4])
+        Y = helper.make_tensor_value_info('Y', TensorProto.FLOAT, ['n', 4])
+        node_def = helper.make_node('Abs', ['X'], ['Y'])
+        graph_def = helper.make_graph([node_def], "cache-test", [X], [Y])
+        onnx_model = helper.make_model(graph_def, producer_name='onnx-example')
+
+        first = halide_backend.prepare(onnx_model, autoscheduler='Mullapudi2016')
+        second = halide_backend.prepare(onnx_model, autoscheduler='Mullapudi2016')
+        self.assertIs(first.compile(((2, 4),)), second.compile(((2, 4),)))
+        self.assertIsNot(first.compile(((2, 4),)), first.compile(((3, 4),)))
+
+        x = np.random.rand(3, 4).astype(np.float32) - 0.5
+        np.testing.assert_allclose(np.abs(x), second.run([x])[0])
+
+
 if __name__ == '__main__':
     unittest.main()
@@ -62,11 +62,37 @@ HalideModel convert_onnx_model(
     return result;
 }
 
-std::string auto_schedule(const HalideModel &pipeline) {
-    // Generate a schedule for the pipeline.
+Halide::Target get_target(const std::string &device) {
     Halide::Target tgt = Halide::get_host_target();
-    auto schedule = pipeline.rep->auto_schedule(tgt);
-    return schedule.schedule_source;
+    // Don't create buffers larger than 2GB since we use 32bit signed indices to
+    // index the data stored in them.
+    tgt.set_feature(Halide::Target::LargeBuffers, false);
+    if (device == "CUDA") {
+        tgt.set_feature(Halide::Target::CUDA, true);
+    }
+    return tgt;
+}
+
+// Schedule the whole pipeline with the given autoscheduler, loading it from
+// plugin first if one is specified (Mullapudi2016 is linked in by default).
+// The schedule is applied to the pipeline, and its source is returned.
+std::string auto_schedule(
+    const HalideModel &pipeline,
+    const std::string &autoscheduler,
+    const std::map<std::string, std::string> &params,
+    const std::string &plugin,
+    const std::string &device) {
+    if (!plugin.empty()) {
+        Halide::load_plugin(plugin);
+    }
+    Halide::AutoschedulerParams autoscheduler_params(autoscheduler, params);
+    auto results = pipeline.rep->apply_autoscheduler(get_target(device), autoscheduler_params);
+    return results.schedule_source;
+}
+
+// Compile the pipeline ahead of the first call to run() or benchmark().
+void compile_jit(const HalideModel &pipeline, const std::string &device) {
+    pipeline.rep->compile_jit(get_target(device));
 }
 
 template<typename T>
@@ -343,13 +369,7 @@ std::vector<py::array> run(
         outputs[i].transpose(dims);
     }
     Halide::Realization real(outputs);
-    Halide::Target tgt = Halide::get_host_target();
-    // Don't create buffers larger than 2GB since we use 32bit signed indices to
-    // index the data stored in them.
-    tgt.set_feature(Halide::Target::LargeBuffers, false);
-    if (device == "CUDA") {
-        tgt.set_feature(Halide::Target::CUDA, true);
-    }
+    Halide::Target tgt = get_target(device);
 
     pipeline.rep->realize(real, tgt);
 
@@ -458,13 +478,7 @@ double benchmark(
     }
 
     Halide::Realization real(outputs);
-    Halide::Target tgt = Halide::get_host_target();
-    // Don't create buffers larger than 2GB since we use 32bit signed indices to
-    // index the data stored in them.
-    tgt.set_feature(Halide::Target::LargeBuffers, false);
-    if (device == "CUDA") {
-        tgt.set_feature(Halide::Target::CUDA, true);
-    }
+    Halide::Target tgt = get_target(device);
     pipeline.rep->realize(real, tgt);
 
     // Now benchmark by computing the value of the outputs num_iter times
@@ -555,7 +569,16 @@ PYBIND11_MODULE(model_cpp, m) {
     m.def(
         "AutoSchedule",
         &auto_schedule,
-        "A function to automatic schedule HalideModel.");
+        "A function to automatic schedule HalideModel.",
+        py::arg("pipeline"),
+        py::arg("autoscheduler") = "Mullapudi2016",
+        py::arg("params") = std::map<std::string, std::string>(),
+        py::arg("plugin") = "",
+        py::arg("device") = "");
+    m.def(
+        "CompileJit",
+        &compile_jit,
+        "A function to JIT compile HalideModel ahead of running it.");
     m.def("Run", &run, "A function to JIT compile and run HalideModel.");
     m.def("Benchmark", &benchmark, "A function to benchmark the model");
     m.def("Compile", &compile, "Compile the pipeline");
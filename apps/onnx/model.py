@@ -24,10 +24,25 @@ class Model():
             self.pipeline = model_cpp.ConvertOnnxModel(model_str,
                 expected_dim_sizes, layout)
 
-    def OptimizeSchedule(self):
+    def OptimizeSchedule(self, autoscheduler='Mullapudi2016', params=None,
+                         plugin='', device=''):
+        """Schedule the whole model with an autoscheduler.
+
+        The autoscheduler uses the expected input sizes given to
+        BuildFromOnnxModel for the dimensions that aren't fixed by the model.
+        Autoschedulers other than Mullapudi2016 (e.g. Adams2019) must be
+        loaded from a plugin, e.g. plugin='libautoschedule_adams2019.so'.
+        Returns the source of the schedule.
+        """
+        if not self.pipeline:
+            raise Exception("model not initialized, call BuildFromOnnxModel first")
+        return model_cpp.AutoSchedule(self.pipeline, autoscheduler,
+                                      params or {}, plugin, device)
+
+    def CompileJit(self, device=''):
         if not self.pipeline:
             raise Exception("model not initialized, call BuildFromOnnxModel first")
-        return model_cpp.AutoSchedule(self.pipeline)
+        model_cpp.CompileJit(self.pipeline, device)
 
     def run(self, inputs, device=''):
         if not self.pipeline:
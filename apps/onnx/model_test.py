@@ -45,6 +45,23 @@ class ModelTest(unittest.TestCase):
         expected = np.abs(input)
         np.testing.assert_allclose(expected, output)
 
+    def test_symbolic_dims(self):
+        X = helper.make_tensor_value_info('IN', TensorProto.FLOAT, ['batch', 3])
+        Y = helper.make_tensor_value_info('OUT', TensorProto.FLOAT, ['batch', 3])
+        node_def = helper.make_node('Relu', ['IN'], ['OUT'])
+        graph_def = helper.make_graph([node_def], "symbolic-model", [X], [Y])
+        onnx_model = helper.make_model(graph_def,
+                                       producer_name='onnx-example')
+
+        model = Model()
+        model.BuildFromOnnxModel(onnx_model, {'batch': 5})
+        model.OptimizeSchedule('Mullapudi2016')
+        model.CompileJit()
+
+        input = np.random.rand(5, 3).astype(np.float32) - 0.5
+        outputs = model.run([input])
+        np.testing.assert_allclose(np.maximum(input, 0), outputs[0])
+
     def test_scalars(self):
         # Create 2 inputs
         X = helper.make_tensor_value_info('A', TensorProto.INT32, [])
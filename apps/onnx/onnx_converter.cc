@@ -4722,7 +4722,18 @@ Model convert_model(
             throw std::domain_error("Invalid dimensions for output " + output.name());
         }
         for (int i = 0; i < args.size(); ++i) {
-            const int64_t *dim_value = Halide::Internal::as_const_int(dims[i]);
+            // Dimensions that depend on symbolic input dimensions can be
+            // estimated from the expected sizes of these dimensions.
+            Halide::Expr dim_expr = dims[i];
+            for (const auto &symbolic_dim : symbolic_dims) {
+                auto expected = expected_dim_sizes.find(symbolic_dim.first);
+                if (expected != expected_dim_sizes.end()) {
+                    dim_expr = Halide::Internal::substitute(
+                        symbolic_dim.second.extent(), expected->second, dim_expr);
+                }
+            }
+            dim_expr = Halide::Internal::simplify(dim_expr);
+            const int64_t *dim_value = Halide::Internal::as_const_int(dim_expr);
             if (dim_value) {
                 int dim = static_cast<int>(*dim_value);
                 f.set_estimate(args[i], 0, dim);
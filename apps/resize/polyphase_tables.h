@@ -0,0 +1,131 @@
+#ifndef POLYPHASE_TABLES_H
+#define POLYPHASE_TABLES_H
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "HalideBuffer.h"
+
+// The tables of filter weights used by the resize_polyphase pipelines, for
+// one dimension of a resize. Output pixel x = n * phases + p reads the taps
+// starting at input pixel n * step + offsets(p), with weights(tap, p).
+struct PolyphaseTable {
+    Halide::Runtime::Buffer<int16_t, 2> weights;
+    Halide::Runtime::Buffer<int32_t, 1> offsets;
+    int step;
+};
+
+// The weights have this many fractional bits. This must match
+// ResizePolyphase::weight_bits in resize_generator.cpp.
+constexpr int polyphase_weight_bits = 14;
+
+inline double polyphase_kernel(const std::string &filter, double x) {
+    const double xx = std::abs(x);
+    if (filter == "box") {
+        return xx <= 0.5 ? 1.0 : 0.0;
+    } else if (filter == "linear") {
+        return xx < 1.0 ? 1.0 - xx : 0.0;
+    } else if (filter == "cubic") {
+        const double a = -0.5;
+        const double xx2 = xx * xx;
+        const double xx3 = xx2 * xx;
+        if (xx < 1.0) {
+            return (a + 2.0) * xx3 - (a + 3.0) * xx2 + 1.0;
+        } else if (xx < 2.0) {
+            return a * xx3 - 5.0 * a * xx2 + 8.0 * a * xx - 4.0 * a;
+        }
+        return 0.0;
+    } else {
+        // lanczos
+        if (xx == 0.0) {
+            return 1.0;
+        } else if (xx > 3.0) {
+            return 0.0;
+        }
+        const double pi_x = 3.14159265358979323846 * x;
+        return (std::sin(pi_x) / pi_x) * (std::sin(pi_x / 3.0) / (pi_x / 3.0));
+    }
+}
+
+inline int polyphase_kernel_taps(const std::string &filter) {
+    if (filter == "box") {
+        return 1;
+    } else if (filter == "linear") {
+        return 2;
+    } else if (filter == "cubic") {
+        return 4;
+    } else {
+        return 6;
+    }
+}
+
+// Compute the tables for resizing src pixels to dst pixels, with the same
+// sampling and low-pass filtering as the resize pipeline.
+inline PolyphaseTable make_polyphase_table(int src, int dst, const std::string &filter) {
+    const int g = std::gcd(src, dst);
+    const int phases = dst / g;
+    const int step = src / g;
+
+    const double inverse_scale = (double)src / dst;
+    // Widen the kernel when shrinking, to low-pass filter the input.
+    const double kernel_scaling = std::min(1.0, (double)dst / src);
+    const double kernel_radius = 0.5 * polyphase_kernel_taps(filter) / kernel_scaling;
+    const int taps = (int)std::ceil(polyphase_kernel_taps(filter) / kernel_scaling);
+
+    PolyphaseTable result;
+    result.weights = Halide::Runtime::Buffer<int16_t, 2>(taps, phases);
+    result.offsets = Halide::Runtime::Buffer<int32_t, 1>(phases);
+    result.step = step;
+
+    const int one = 1 << polyphase_weight_bits;
+    std::vector<double> w(taps);
+    for (int p = 0; p < phases; p++) {
+        const double source = (p + 0.5) * inverse_scale - 0.5;
+        const int begin = (int)std::ceil(source - kernel_radius);
+        result.offsets(p) = begin;
+
+        double sum = 0.0;
+        for (int k = 0; k < taps; k++) {
+            w[k] = polyphase_kernel(filter, (begin + k - source) * kernel_scaling);
+            sum += w[k];
+        }
+
+        // Quantize the normalized weights, and put the rounding error on
+        // the biggest tap so they add up to exactly one.
+        int fixed_sum = 0;
+        int biggest = 0;
+        for (int k = 0; k < taps; k++) {
+            result.weights(k, p) = (int16_t)std::lround(w[k] / sum * one);
+            fixed_sum += result.weights(k, p);
+            if (std::abs(w[k]) > std::abs(w[biggest])) {
+                biggest = k;
+            }
+        }
+        result.weights(biggest, p) += one - fixed_sum;
+    }
+    return result;
+}
+
+// Get the tables for resizing src pixels to dst pixels, computing them only
+// the first time they are asked for. The result shares the cached buffers,
+// which are never freed.
+inline PolyphaseTable get_polyphase_table(int src, int dst, const std::string &filter) {
+    static std::mutex mutex;
+    static std::map<std::tuple<int, int, std::string>, PolyphaseTable> cache;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto key = std::make_tuple(src, dst, filter);
+    auto i = cache.find(key);
+    if (i == cache.end()) {
+        i = cache.emplace(key, make_polyphase_table(src, dst, filter)).first;
+    }
+    return i->second;
+}
+
+#endif  // POLYPHASE_TABLES_H
@@ -1,6 +1,8 @@
 #include "Halide.h"
 
 using namespace Halide;
+using namespace Halide::ConciseCasts;
+using Halide::Internal::rounding_shift_right;
 
 enum InterpolationType {
     Box,
@@ -231,4 +233,122 @@ public:
     }
 };
 
+// A resize of 8-bit images by a rational factor, using tables of filter
+// weights computed ahead of time (see polyphase_tables.h). The weights for
+// the output pixels repeat with a period of a few pixels (the phases), so
+// the tables are small. Computing them ahead of time lets them be cached for
+// resizes that are repeated many times, and the weights are 16-bit fixed
+// point, so the resize can be done entirely in integer arithmetic.
+class ResizePolyphase : public Halide::Generator<ResizePolyphase> {
+public:
+    // Resize in y before x. This is cheaper when the image is getting
+    // smaller in y, because the resize in x has fewer rows to do.
+    GeneratorParam<bool> vertical_first{"vertical_first", true};
+
+    Input<Buffer<uint8_t, 3>> input{"input"};
+
+    // The weights of each tap, for each phase, in fixed point with
+    // weight_bits fractional bits, indexed by tap and phase.
+    Input<Buffer<int16_t, 2>> weights_x{"weights_x"};
+    // The first input pixel of each phase, relative to the start of the
+    // period.
+    Input<Buffer<int32_t, 1>> offsets_x{"offsets_x"};
+    // The number of input pixels in each period.
+    Input<int> step_x{"step_x"};
+
+    Input<Buffer<int16_t, 2>> weights_y{"weights_y"};
+    Input<Buffer<int32_t, 1>> offsets_y{"offsets_y"};
+    Input<int> step_y{"step_y"};
+
+    Output<Buffer<uint8_t, 3>> output{"output"};
+
+    Var x, y, c;
+    Func resized_x, resized_y;
+
+    // The number of fractional bits of the weights, and of the
+    // intermediate result between the two passes.
+    static constexpr int weight_bits = 14;
+    static constexpr int intermediate_bits = 6;
+
+    void generate() {
+        Func clamped = BoundaryConditions::repeat_edge(input);
+
+        Expr phases_x = weights_x.dim(1).extent();
+        Expr phases_y = weights_y.dim(1).extent();
+        Expr phase_x = x % phases_x;
+        Expr phase_y = y % phases_y;
+        Expr beginx = (x / phases_x) * step_x + offsets_x(phase_x);
+        Expr beginy = (y / phases_y) * step_y + offsets_y(phase_y);
+
+        RDom rx(0, weights_x.dim(0).extent(), "rx");
+        RDom ry(0, weights_y.dim(0).extent(), "ry");
+
+        // The first pass keeps intermediate_bits of fraction in 16 bits, the
+        // second accumulates the 16-bit products in 32 bits.
+        const int first_shift = weight_bits - intermediate_bits;
+        const int second_shift = weight_bits + intermediate_bits;
+        if (vertical_first) {
+            resized_y(x, y, c) = i16(rounding_shift_right(
+                sum(i32(weights_y(ry, phase_y)) * i32(clamped(x, beginy + ry, c)), "resized_y_sum"), first_shift));
+            resized_x(x, y, c) = sum(i32(weights_x(rx, phase_x)) * i32(resized_y(beginx + rx, y, c)), "resized_x_sum");
+            output(x, y, c) = u8_sat(rounding_shift_right(resized_x(x, y, c), second_shift));
+        } else {
+            resized_x(x, y, c) = i16(rounding_shift_right(
+                sum(i32(weights_x(rx, phase_x)) * i32(clamped(beginx + rx, y, c)), "resized_x_sum"), first_shift));
+            resized_y(x, y, c) = sum(i32(weights_y(ry, phase_y)) * i32(resized_x(x, beginy + ry, c)), "resized_y_sum");
+            output(x, y, c) = u8_sat(rounding_shift_right(resized_y(x, y, c), second_shift));
+        }
+    }
+
+    void schedule() {
+        const int vec = natural_vector_size<int16_t>();
+
+        weights_x.dim(0).set_min(0);
+        weights_x.dim(1).set_min(0);
+        offsets_x.dim(0).set_min(0);
+        weights_y.dim(0).set_min(0);
+        weights_y.dim(1).set_min(0);
+        offsets_y.dim(0).set_min(0);
+        offsets_x.dim(0).set_extent(weights_x.dim(1).extent());
+        offsets_y.dim(0).set_extent(weights_y.dim(1).extent());
+
+        Var xi, yi;
+        if (vertical_first) {
+            output
+                .tile(x, y, xi, yi, vec, 8)
+                .parallel(y)
+                .vectorize(xi);
+            resized_y
+                .compute_at(output, y)
+                .vectorize(x, vec);
+            resized_x
+                .compute_at(output, xi)
+                .unroll(c);
+        } else {
+            output
+                .tile(x, y, xi, yi, vec, 32)
+                .parallel(y)
+                .vectorize(xi);
+            resized_x
+                .compute_at(output, x)
+                .store_in(MemoryType::Stack)
+                .vectorize(x);
+            resized_y
+                .compute_at(output, xi)
+                .unroll(c);
+        }
+
+        // When there is only one phase, e.g. when shrinking by an integer
+        // factor, the weights are the same for every pixel, and the pixels
+        // each tap reads are a strided slice of the input instead of a
+        // gather.
+        Expr one_phase_x = weights_x.dim(1).extent() == 1;
+        Expr one_phase_y = weights_y.dim(1).extent() == 1;
+        output.specialize(one_phase_x && one_phase_y);
+        output.specialize(one_phase_x);
+        output.specialize(one_phase_y);
+    }
+};
+
 HALIDE_REGISTER_GENERATOR(Resize, resize);
+HALIDE_REGISTER_GENERATOR(ResizePolyphase, resize_polyphase);
@@ -8,6 +8,10 @@ struct Tensor {
     Halide::Func f;
     std::vector<int> shape;
     std::string name;
+    // For layers with a reduction, the Func with the reduction and its
+    // domain, for scheduling. For float convolutions this is f itself.
+    Halide::Func reduction;
+    Halide::RDom rdom;
 };
 
 struct WeightShape {
@@ -28,7 +32,13 @@ int find_index(int value, std::vector<int> vec) {
 
 class Resnet50Generator : public Halide::Generator<Resnet50Generator> {
 public:
-    Input<Buffer<float, 3>> input{"input"};
+    // Run the convolutions after the first one in int8, with the weights
+    // quantized per output channel and the activations quantized per image.
+    // The first convolution and the fully connected layer stay in float.
+    GeneratorParam<bool> quantize{"quantize", false};
+
+    // A batch of images, with the channels innermost (NHWC).
+    Input<Buffer<float, 4>> input{"input"};
     /** parameter values for scaling layers **/
     Input<Buffer<float, 1>> conv1_gamma{"conv1_gamma"};
     Input<Buffer<float, 1>[4]> br1_gamma { "br1_gamma" };
@@ -63,7 +73,7 @@ public:
 
     Input<Buffer<float, 2>> fc1000_weights{"fc1000_weights"};
     Input<Buffer<float, 1>> fc1000_bias{"fc1000_bias"};
-    Output<Buffer<float, 1>> final_output{"final_output"};
+    Output<Buffer<float, 2>> final_output{"final_output"};
 
     /** list out shapes of each layers weights **/
     // weight shapes: out channels, kernel_w, kernel_h, pad, stride. In channels infered by input tensor shape
@@ -112,7 +122,9 @@ public:
                                      res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws, res4x_br2c_ws,
                                      res5x_br2c_ws, res5x_br2c_ws, res5x_br2c_ws};
 
-    Var c, i, j;
+    Var c, i, j, k, n;
+    // The blocks of output channels that convolutions are computed in.
+    Var co{"co"}, ci{"ci"};
 
     void generate() {
 
@@ -120,22 +132,18 @@ public:
 
         /** Declare arrays of other functions and build the requested block **/
         Tensor br1_conv[4];
-        Tensor br1_norm[4];
-        Tensor br1_scale[4];
+        Tensor br1_bn[4];
 
         Tensor br2a_conv[16];
-        Tensor br2a_norm[16];
-        Tensor br2a_scaled[16];
+        Tensor br2a_bn[16];
         Tensor br2a_relu[16];
 
         Tensor br2b_conv[16];
-        Tensor br2b_norm[16];
-        Tensor br2b_scaled[16];
+        Tensor br2b_bn[16];
         Tensor br2b_relu[16];
 
         Tensor br2c_conv[16];
-        Tensor br2c_norm[16];
-        Tensor br2c_scaled[16];
+        Tensor br2c_bn[16];
 
         Tensor resunit_sum[16];
         Tensor resunit_relu[16];
@@ -151,7 +159,7 @@ public:
         Tensor resunit_sum_input;
 
         // used only for block_id == 0
-        Tensor conv1, norm1, scaled1, relu1, pool1;
+        Tensor conv1, bn1, relu1, pool1;
 
         std::vector<int> branch1_indices{0, 3, 7, 13};
 
@@ -163,9 +171,8 @@ public:
                 input_t.shape = input_shape;
 
                 conv1 = conv2D(input_t, conv1_ws, conv1_weights, "conv1");
-                norm1 = norm_layer(conv1, conv1_mu, conv1_sig, "norm1");
-                scaled1 = scale_layer(norm1, conv1_gamma, conv1_beta, "scale1");
-                relu1 = relu_layer(scaled1, "relu1");
+                bn1 = bn_layer(conv1, conv1_mu, conv1_sig, conv1_gamma, conv1_beta, "bn1");
+                relu1 = relu_layer(bn1, "relu1");
                 pool1 = max_pool_layer(relu1, pool1_ws, "pool1");
 
                 br2a_input = pool1;
@@ -176,10 +183,9 @@ public:
             // build branch1 if this section has branch1
             int br1_i = find_index(block_id, branch1_indices);
             if (br1_i >= 0) {
-                br1_conv[br1_i] = conv2D(br2a_input, br1_ws[br1_i], br1_conv_weights[br1_i], "br1_conv");
-                br1_norm[br1_i] = norm_layer(br1_conv[br1_i], br1_mu[br1_i], br1_sig[br1_i], "br1_norm");
-                br1_scale[br1_i] = scale_layer(br1_norm[br1_i], br1_gamma[br1_i], br1_beta[br1_i], "br1_scale");
-                resunit_sum_input = br1_scale[br1_i];
+                br1_conv[br1_i] = conv2D(br2a_input, br1_ws[br1_i], br1_conv_weights[br1_i], "br1_conv", quantize);
+                br1_bn[br1_i] = bn_layer(br1_conv[br1_i], br1_mu[br1_i], br1_sig[br1_i], br1_gamma[br1_i], br1_beta[br1_i], "br1_bn");
+                resunit_sum_input = br1_bn[br1_i];
             } else {
                 resunit_sum_input = resunit_relu[block_id - 1];
             }
@@ -187,26 +193,23 @@ public:
             // branch2a
             auto weights = br2a_conv_weights[block_id];
 
-            br2a_conv[block_id] = conv2D(br2a_input, br2a_ws[block_id], weights, "block" + std::to_string(block_id) + "_2a_conv");
-            br2a_norm[block_id] = norm_layer(br2a_conv[block_id], br2a_mu[block_id], br2a_sig[block_id], "block" + std::to_string(block_id) + "_2a_norm");
-            br2a_scaled[block_id] = scale_layer(br2a_norm[block_id], br2a_gamma[block_id], br2a_beta[block_id], "block" + std::to_string(block_id) + "_2a_scale");
-            br2a_relu[block_id] = relu_layer(br2a_scaled[block_id], "2a_relu");
+            br2a_conv[block_id] = conv2D(br2a_input, br2a_ws[block_id], weights, "block" + std::to_string(block_id) + "_2a_conv", quantize);
+            br2a_bn[block_id] = bn_layer(br2a_conv[block_id], br2a_mu[block_id], br2a_sig[block_id], br2a_gamma[block_id], br2a_beta[block_id], "block" + std::to_string(block_id) + "_2a_bn");
+            br2a_relu[block_id] = relu_layer(br2a_bn[block_id], "2a_relu");
 
             // branch 2b
             weights = br2b_conv_weights[block_id];
-            br2b_conv[block_id] = conv2D(br2a_relu[block_id], br2b_ws[block_id], weights, "block" + std::to_string(block_id) + "_2b_conv");
-            br2b_norm[block_id] = norm_layer(br2b_conv[block_id], br2b_mu[block_id], br2b_sig[block_id], "block" + std::to_string(block_id) + "_2b_norm");
-            br2b_scaled[block_id] = scale_layer(br2b_norm[block_id], br2b_gamma[block_id], br2b_beta[block_id], "block" + std::to_string(block_id) + "_2b_scale");
-            br2b_relu[block_id] = relu_layer(br2b_scaled[block_id], "2b_relu");
+            br2b_conv[block_id] = conv2D(br2a_relu[block_id], br2b_ws[block_id], weights, "block" + std::to_string(block_id) + "_2b_conv", quantize);
+            br2b_bn[block_id] = bn_layer(br2b_conv[block_id], br2b_mu[block_id], br2b_sig[block_id], br2b_gamma[block_id], br2b_beta[block_id], "block" + std::to_string(block_id) + "_2b_bn");
+            br2b_relu[block_id] = relu_layer(br2b_bn[block_id], "2b_relu");
 
             // branch 2c
             weights = br2c_conv_weights[block_id];
-            br2c_conv[block_id] = conv2D(br2b_relu[block_id], br2c_ws[block_id], weights, "block" + std::to_string(block_id) + "_2c_conv");
-            br2c_norm[block_id] = norm_layer(br2c_conv[block_id], br2c_mu[block_id], br2c_sig[block_id], "block" + std::to_string(block_id) + "_2c_norm");
-            br2c_scaled[block_id] = scale_layer(br2c_norm[block_id], br2c_gamma[block_id], br2c_beta[block_id], "block" + std::to_string(block_id) + "_2c_scale");
+            br2c_conv[block_id] = conv2D(br2b_relu[block_id], br2c_ws[block_id], weights, "block" + std::to_string(block_id) + "_2c_conv", quantize);
+            br2c_bn[block_id] = bn_layer(br2c_conv[block_id], br2c_mu[block_id], br2c_sig[block_id], br2c_gamma[block_id], br2c_beta[block_id], "block" + std::to_string(block_id) + "_2c_bn");
 
             // create residual unit
-            resunit_sum[block_id] = sum_layer(resunit_sum_input, br2c_scaled[block_id], "block" + std::to_string(block_id) + "_res_sum");
+            resunit_sum[block_id] = sum_layer(resunit_sum_input, br2c_bn[block_id], "block" + std::to_string(block_id) + "_res_sum");
             resunit_relu[block_id] = relu_layer(resunit_sum[block_id], "block" + std::to_string(block_id) + "_res_relu");
 
             // create final 3 layers
@@ -217,19 +220,32 @@ public:
             }
         }
 
-        // TODO: Actually schedule this.
-        conv1.f.compute_root();
-        scaled1.f.compute_root();
-        relu1.f.compute_root();
-        pool1.f.compute_root();
-        for (int i = 0; i < 16; i++) {
-            br2a_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
-            br2b_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
-            resunit_relu[i].f.compute_root().vectorize(c, 8).parallel(j);
+        input.set_estimates({{0, 3}, {0, 224}, {0, 224}, {0, 8}});
+        final_output.set_estimates({{0, 1000}, {0, 8}});
+
+        // Schedule
+        const int vec = natural_vector_size<float>();
+
+        // Each convolution is computed in blocks of vec output channels, at
+        // the tensor that consumes it, so the batch norm, the residual sum,
+        // and the ReLU are applied while the results are still in registers.
+        // Images in the batch, and rows within each image, are independent.
+        schedule_conv(relu1, conv1);
+        pool1.f.compute_root().vectorize(c, vec).parallel(j).parallel(n);
+        for (int block_id = 0; block_id < 16; block_id++) {
+            schedule_conv(br2a_relu[block_id], br2a_conv[block_id]);
+            schedule_conv(br2b_relu[block_id], br2b_conv[block_id]);
+            schedule_conv(resunit_relu[block_id], br2c_conv[block_id]);
+            int br1_i = find_index(block_id, branch1_indices);
+            if (br1_i >= 0) {
+                br1_conv[br1_i].reduction.compute_at(resunit_relu[block_id].f, co).vectorize(c, vec);
+                schedule_conv_update(br1_conv[br1_i]);
+            }
         }
-        pool5.f.compute_root();
-        fc1000.f.compute_root();
-        softmax.f.compute_root();
+        pool5.f.compute_root().vectorize(c, vec).parallel(n);
+        pool5.f.update().reorder(c, pool5.rdom.x, pool5.rdom.y).vectorize(c, vec).parallel(n);
+        fc1000.f.compute_root().vectorize(c, vec).parallel(n);
+        fc1000.f.update().reorder(c, fc1000.rdom.x).vectorize(c, vec).parallel(n);
     }
 
 private:
@@ -239,7 +255,7 @@ private:
         bounds[1].extent = width;
         bounds[2].min = 0;
         bounds[2].extent = height;
-        return Halide::BoundaryConditions::constant_exterior(f, 0.0f, bounds);
+        return Halide::BoundaryConditions::constant_exterior(f, cast(f.type(), 0), bounds);
     }
 
     std::vector<int> compute_shape(const Tensor &in, const WeightShape &params) {
@@ -250,7 +266,10 @@ private:
         return {c, w, h};
     }
 
-    Tensor conv2D(const Tensor &input, const WeightShape &weight_shape, const Func &weights, const std::string &name) {
+    Tensor conv2D(const Tensor &input, const WeightShape &weight_shape, const Func &weights, const std::string &name, bool quantized = false) {
+        if (quantized) {
+            return conv2D_int8(input, weight_shape, weights, name);
+        }
         int p = weight_shape.pad;
         Func padded;
         // pad input
@@ -261,12 +280,69 @@ private:
         }
         RDom r(0, input.shape[0], 0, weight_shape.w, 0, weight_shape.h);
         Func conv;
-        conv(c, i, j) += weights(c, r.y, r.z, r.x) * padded(r.x, weight_shape.stride * i + r.y - p, weight_shape.stride * j + r.z - p);
+        conv(c, i, j, n) += weights(c, r.y, r.z, r.x) * padded(r.x, weight_shape.stride * i + r.y - p, weight_shape.stride * j + r.z - p, n);
 
         Tensor output;
         output.f = conv;
         output.name = name;
         output.shape = compute_shape(input, weight_shape);
+        output.reduction = conv;
+        output.rdom = r;
+        return output;
+    }
+
+    // An int8 version of conv2D, for an input that is never negative. The
+    // weights are quantized with a scale per output channel, and the input
+    // to uint8 with a scale per image, so the result for an image doesn't
+    // depend on the rest of the batch. The products are accumulated in
+    // int32, and the result is converted back to float.
+    Tensor conv2D_int8(const Tensor &input, const WeightShape &weight_shape, const Func &weights, const std::string &name) {
+        const int vec = natural_vector_size<float>();
+
+        RDom rw(0, weight_shape.w, 0, weight_shape.h, 0, input.shape[0]);
+        Func weight_scale(name + "_weight_scale");
+        weight_scale(c) = max(maximum(abs(weights(c, rw.x, rw.y, rw.z))), 1e-8f) / 127.0f;
+        Func q_weights(name + "_q_weights");
+        q_weights(c, i, j, k) = cast<int8_t>(round(weights(c, i, j, k) / weight_scale(c)));
+
+        RDom ri(0, input.shape[1]);
+        Func row_max(name + "_row_max");
+        row_max(c, j, n) = maximum(input.f(c, ri, j, n));
+        RDom ra(0, input.shape[0], 0, input.shape[2]);
+        Func input_scale(name + "_input_scale");
+        input_scale(n) = max(maximum(row_max(ra.x, ra.y, n)), 1e-8f) / 255.0f;
+        Func q_input(name + "_q_input");
+        q_input(c, i, j, n) = cast<uint8_t>(min(round(input.f(c, i, j, n) / input_scale(n)), 255.0f));
+
+        int p = weight_shape.pad;
+        Func padded;
+        if (p) {
+            padded = pad(q_input, input.shape[1], input.shape[2]);
+        } else {
+            padded = q_input;
+        }
+        // The products fit in int16, which lets them use widening multiplies.
+        RDom r(0, input.shape[0], 0, weight_shape.w, 0, weight_shape.h);
+        Func acc(name + "_acc");
+        acc(c, i, j, n) += cast<int32_t>(cast<int16_t>(q_weights(c, r.y, r.z, r.x)) *
+                                         cast<int16_t>(padded(r.x, weight_shape.stride * i + r.y - p, weight_shape.stride * j + r.z - p, n)));
+        Func conv(name);
+        conv(c, i, j, n) = cast<float>(acc(c, i, j, n)) * (weight_scale(c) * input_scale(n));
+
+        // The quantization doesn't depend on how the convolution is
+        // scheduled, so schedule it here.
+        weight_scale.compute_root().vectorize(c, vec);
+        q_weights.compute_root().vectorize(c, vec).parallel(k);
+        row_max.compute_root().vectorize(c, vec).parallel(j).parallel(n);
+        input_scale.compute_root();
+        q_input.compute_root().vectorize(c, vec * 2).parallel(j).parallel(n);
+
+        Tensor output;
+        output.f = conv;
+        output.name = name;
+        output.shape = compute_shape(input, weight_shape);
+        output.reduction = acc;
+        output.rdom = r;
         return output;
     }
 
@@ -274,20 +350,22 @@ private:
     Tensor fc_layer(const Tensor &input, const WeightShape &weight_shape, const Func &weights, const Func &bias, const std::string &name) {
         RDom r(0, input.shape[0]);
         Func fc;
-        fc(c) = bias(c);
-        fc(c) += weights(c, r.x) * input.f(r.x, 0, 0);
+        fc(c, n) = bias(c);
+        fc(c, n) += weights(c, r.x) * input.f(r.x, 0, 0, n);
 
         Tensor output;
         output.f = fc;
         output.name = name;
         output.shape = compute_shape(input, weight_shape);
+        output.reduction = fc;
+        output.rdom = r;
 
         return output;
     }
 
     Tensor relu_layer(const Tensor &input, const std::string &name) {
         Func relu;
-        relu(c, i, j) = max(0.0f, input.f(c, i, j));
+        relu(c, i, j, n) = max(0.0f, input.f(c, i, j, n));
         Tensor output;
         output.f = relu;
         output.shape = input.shape;
@@ -305,7 +383,7 @@ private:
         }
         RDom r(0, weight_shape.w, 0, weight_shape.h);
         Func pool;
-        pool(c, i, j) = maximum(padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p));
+        pool(c, i, j, n) = maximum(padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p, n));
         Tensor output;
         output.f = pool;
         output.name = name;
@@ -325,21 +403,30 @@ private:
         RDom r(0, weight_shape.w, 0, weight_shape.h);
         float scale = weight_shape.w * weight_shape.h;
         Func pool;
-        float n = 1.0f / scale;
-        pool(c, i, j) += n * padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p);
+        float weight = 1.0f / scale;
+        pool(c, i, j, n) += weight * padded(c, weight_shape.stride * i + r.x - p, weight_shape.stride * j + r.y - p, n);
 
         Tensor output;
         output.f = pool;
         output.name = name;
         output.shape = compute_shape(input, weight_shape);
+        output.reduction = pool;
+        output.rdom = r;
 
         return output;
     }
 
-    Tensor norm_layer(const Tensor &input, const Func &mu, const Func &sigma, const std::string &name) {
+    // Batch normalization followed by a per channel scale and offset, folded
+    // into a single multiply-add per element.
+    Tensor bn_layer(const Tensor &input, const Func &mu, const Func &sigma, const Func &gamma, const Func &beta, const std::string &name) {
+        Func scale(name + "_scale"), offset(name + "_offset");
+        scale(c) = gamma(c) / sqrt(sigma(c) + 1e-5f);
+        offset(c) = beta(c) - mu(c) * scale(c);
+        scale.compute_root();
+        offset.compute_root();
+
         Func normed;
-        Expr e = input.f(c, i, j);
-        normed(c, i, j) = (input.f(c, i, j) - mu(c)) / (sqrt(sigma(c) + 1e-5f));
+        normed(c, i, j, n) = input.f(c, i, j, n) * scale(c) + offset(c);
         Tensor output;
         output.f = normed;
         output.shape = input.shape;
@@ -347,20 +434,10 @@ private:
         return output;
     }
 
-    Tensor scale_layer(const Tensor &input, const Func &gamma, const Func &beta, const std::string &name) {
-        Func scaled;
-        scaled(c, i, j) = input.f(c, i, j) * gamma(c) + beta(c);
-        Tensor output;
-        output.f = scaled;
-        output.shape = input.shape;
-        output.name = name;
-        return output;
-    }
-
     Tensor sum_layer(const Tensor &t1, const Tensor &t2, const std::string &name) {
         assert(t1.shape == t2.shape);
         Func summed;
-        summed(c, i, j) = t1.f(c, i, j) + t2.f(c, i, j);
+        summed(c, i, j, n) = t1.f(c, i, j, n) + t2.f(c, i, j, n);
         Tensor output;
         output.f = summed;
         output.shape = t1.shape;
@@ -372,11 +449,41 @@ private:
         assert(input.shape[0] == classes);
         RDom r(0, classes);
         Func exp_vals;
-        exp_vals(c) = exp(input.f(c));
+        exp_vals(c, n) = exp(input.f(c, n));
+        Func total;
+        total(n) = sum(exp_vals(r.x, n));
+        exp_vals.compute_root().vectorize(c, natural_vector_size<float>());
+        total.compute_root();
         Func output("output");
-        output(c) = exp_vals(c) / sum(exp_vals(r.x));
+        output(c, n) = exp_vals(c, n) / total(n);
         return output;
     }
+
+    // Compute a convolution in blocks of vec output channels, at each block
+    // of the tensor out that consumes it.
+    void schedule_conv(Tensor out, Tensor conv) {
+        const int vec = natural_vector_size<float>();
+        out.f.compute_root()
+            .split(c, co, ci, vec)
+            .reorder(ci, i, co, j, n)
+            .vectorize(ci)
+            .parallel(j)
+            .parallel(n);
+        conv.reduction.compute_at(out.f, co).vectorize(c, vec);
+        schedule_conv_update(conv);
+    }
+
+    // Accumulate a few pixels of a block of output channels in registers
+    // over the whole reduction.
+    void schedule_conv_update(Tensor conv) {
+        const int vec = natural_vector_size<float>();
+        Var io, ii;
+        conv.reduction.update()
+            .split(i, io, ii, 4)
+            .reorder(c, ii, conv.rdom.x, conv.rdom.y, conv.rdom.z, io)
+            .vectorize(c, vec)
+            .unroll(ii);
+    }
 };
 }  // namespace
 
@@ -1,6 +1,7 @@
 #include "halide_benchmark.h"
 
 #include "resnet50.h"
+#include "resnet50_int8.h"
 
 #include "HalideBuffer.h"
 #include "halide_image_io.h"
@@ -53,7 +54,7 @@ std::vector<int> load_shape(const std::string &shapefile) {
     return dims;
 }
 
-void write_buffer_to_file(const Buffer<float, 1> &buf, const std::string &filename) {
+void write_buffer_to_file(const Buffer<float, 2> &buf, const std::string &filename) {
     std::ofstream o(filename, std::ios_base::trunc | std::ios_base::binary);
     o.write((const char *)(buf.data()), buf.size_in_bytes());
     o.close();
@@ -105,8 +106,9 @@ int main(int argc, char **argv) {
     int seed = atoi(argv[3]);
     std::string output_file = argv[4];
 
-    Buffer<float, 3> input(3, 224, 224);
-    Buffer<float, 1> output(1000);
+    const int batch_sizes[] = {1, 8, 32};
+    const int max_batch_size = 32;
+    Buffer<float, 4> input(3, 224, 224, max_batch_size);
 
     Buffer<float, 4> conv1_weights;
     Buffer<float, 1> conv1_mu;
@@ -241,58 +243,83 @@ int main(int argc, char **argv) {
     Buffer<float, 2> fc1000_weights = load_fc_weight(weight_shapefile, weight_datafile);
     Buffer<float> fc1000_bias = load_fc_bias(bias_shapefile, bias_datafile);
 
+    // The first image is the one validate_resnet50_output.py checks.
     std::mt19937 e2(seed);
-    input.for_each_value([&e2](float &v) {
-        v = e2() / (float)e2.max();
-    });
+    for (int b = 0; b < max_batch_size; b++) {
+        input.sliced(3, b).for_each_value([&e2](float &v) {
+            v = e2() / (float)e2.max();
+        });
+    }
+
+    auto run = [&](decltype(&resnet50) resnet, Buffer<float, 4> &in, Buffer<float, 2> &out) {
+        resnet(in,
+               conv1_gamma,
+               unroll_array_of_4_buffers(br1_gamma),
+               unroll_array_of_16_buffers(br2a_gamma),
+               unroll_array_of_16_buffers(br2b_gamma),
+               unroll_array_of_16_buffers(br2c_gamma),
+               conv1_beta,
+               unroll_array_of_4_buffers(br1_beta),
+               unroll_array_of_16_buffers(br2a_beta),
+               unroll_array_of_16_buffers(br2b_beta),
+               unroll_array_of_16_buffers(br2c_beta),
+               conv1_mu,
+               unroll_array_of_4_buffers(br1_mu),
+               unroll_array_of_16_buffers(br2a_mu),
+               unroll_array_of_16_buffers(br2b_mu),
+               unroll_array_of_16_buffers(br2c_mu),
+               conv1_sig,
+               unroll_array_of_4_buffers(br1_sig),
+               unroll_array_of_16_buffers(br2a_sig),
+               unroll_array_of_16_buffers(br2b_sig),
+               unroll_array_of_16_buffers(br2c_sig),
+               conv1_weights,
+               unroll_array_of_4_buffers(br1_conv_weights),
+               unroll_array_of_16_buffers(br2a_conv_weights),
+               unroll_array_of_16_buffers(br2b_conv_weights),
+               unroll_array_of_16_buffers(br2c_conv_weights),
+               fc1000_weights,
+               fc1000_bias,
+               out);
+    };
+
     printf("Running Resnet50 for %d iterations....\n", iterations);
-    double best = benchmark(iterations, 1, [&]() {
-        resnet50(input,
-                 conv1_gamma,
-                 unroll_array_of_4_buffers(br1_gamma),
-                 unroll_array_of_16_buffers(br2a_gamma),
-                 unroll_array_of_16_buffers(br2b_gamma),
-                 unroll_array_of_16_buffers(br2c_gamma),
-                 conv1_beta,
-                 unroll_array_of_4_buffers(br1_beta),
-                 unroll_array_of_16_buffers(br2a_beta),
-                 unroll_array_of_16_buffers(br2b_beta),
-                 unroll_array_of_16_buffers(br2c_beta),
-                 conv1_mu,
-                 unroll_array_of_4_buffers(br1_mu),
-                 unroll_array_of_16_buffers(br2a_mu),
-                 unroll_array_of_16_buffers(br2b_mu),
-                 unroll_array_of_16_buffers(br2c_mu),
-                 conv1_sig,
-                 unroll_array_of_4_buffers(br1_sig),
-                 unroll_array_of_16_buffers(br2a_sig),
-                 unroll_array_of_16_buffers(br2b_sig),
-                 unroll_array_of_16_buffers(br2c_sig),
-                 conv1_weights,
-                 unroll_array_of_4_buffers(br1_conv_weights),
-                 unroll_array_of_16_buffers(br2a_conv_weights),
-                 unroll_array_of_16_buffers(br2b_conv_weights),
-                 unroll_array_of_16_buffers(br2c_conv_weights),
-                 fc1000_weights,
-                 fc1000_bias,
-                 output);
-    });
-    printf("*************************** Please note ******************************\n"
-           "This code hasn't been scheduled properly yet so this runtime \n"
-           "isn't representative of anything and should not be used as a basis\n"
-           "for any comparisons.\n");
-    printf("Execution time : %gms \n", best * 1e3);
-    printf("**********************************************************************\n");
+    Buffer<float, 2> output(1000, 1);
+    Buffer<float, 2> output_int8(1000, 1);
+    for (int batch_size : batch_sizes) {
+        Buffer<float, 4> batch = input.cropped(3, 0, batch_size);
+        Buffer<float, 2> batch_output(1000, batch_size);
+        double best = benchmark(iterations, 1, [&]() {
+            run(resnet50, batch, batch_output);
+        });
+        double best_int8 = benchmark(iterations, 1, [&]() {
+            run(resnet50_int8, batch, batch_output);
+        });
+        printf("Batch %2d: float %gms (%g images/s), int8 %gms (%g images/s)\n",
+               batch_size, best * 1e3, batch_size / best, best_int8 * 1e3, batch_size / best_int8);
+    }
+
+    Buffer<float, 4> first = input.cropped(3, 0, 1);
+    run(resnet50, first, output);
+    run(resnet50_int8, first, output_int8);
+
+    int max_class_int8 = 0;
+    for (int i = 0; i < 1000; ++i) {
+        if (output_int8(i, 0) > output_int8(max_class_int8, 0)) {
+            max_class_int8 = i;
+        }
+    }
 
     float max_class_val = -FLT_MIN;
     int max_class = 0;
     for (int i = 0; i < 1000; ++i) {
-        if (output(i) > max_class_val) {
-            max_class_val = output(i);
+        if (output(i, 0) > max_class_val) {
+            max_class_val = output(i, 0);
             max_class = i;
         }
     }
     printf("Class for random data of seed %d is %d\n", seed, max_class);
+    printf("Class for random data of seed %d with int8 is %d\n", seed, max_class_int8);
 
     printf("Writing output layer to %s\n", output_file.c_str());
     write_buffer_to_file(output, output_file);
@@ -2,6 +2,7 @@
 #include <cstdio>
 
 #include "stencil_chain.h"
+#include "stencil_chain_narrow.h"
 #ifndef NO_AUTO_SCHEDULE
 #include "stencil_chain_auto_schedule.h"
 #endif
@@ -39,6 +40,25 @@ int main(int argc, char **argv) {
     });
     printf("Manually-tuned time: %gms\n", best_manual * 1e3);
 
+    // Narrow tiles with shorter groups of stencils
+    Buffer<uint16_t, 2> output_narrow(input.width(), input.height());
+    double best_narrow = benchmark(timing, 1, [&]() {
+        stencil_chain_narrow(input, output_narrow);
+        output_narrow.device_sync();
+    });
+    printf("Narrow tiles time: %gms\n", best_narrow * 1e3);
+
+    output.copy_to_host();
+    output_narrow.copy_to_host();
+    bool narrow_matches = true;
+    output.for_each_element([&](int x, int y) {
+        narrow_matches &= output(x, y) == output_narrow(x, y);
+    });
+    if (!narrow_matches) {
+        printf("Narrow tiles give a different result\n");
+        return 1;
+    }
+
 #ifndef NO_AUTO_SCHEDULE
     // Auto-scheduled version
     double best_auto = benchmark(timing, 1, [&]() {
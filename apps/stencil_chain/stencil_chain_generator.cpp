@@ -5,6 +5,13 @@ namespace {
 class StencilChain : public Halide::Generator<StencilChain> {
 public:
     GeneratorParam<int> stencils{"stencils", 32, 1, 100};
+    // The CPU schedule computes this many stencils per tile between
+    // stages computed at root.
+    GeneratorParam<int> group_size{"group_size", 11, 1, 100};
+    // The size of the tiles of the CPU schedule. Zero means a quarter of
+    // the estimated output size, which makes 16 tiles.
+    GeneratorParam<int> tile_width{"tile_width", 0, 0, 4096};
+    GeneratorParam<int> tile_height{"tile_height", 0, 0, 4096};
 
     Input<Buffer<uint16_t, 2>> input{"input"};
     Output<Buffer<uint16_t, 2>> output{"output"};
@@ -112,29 +119,40 @@ public:
             // floating-point ones. My CPU seems to hover at 3.5GHz on
             // this workload.
 
+            // Within a tile, each stage is computed a row at a time just
+            // ahead of the next one, and keeps only the rows that are still
+            // needed (sliding window). In y and across stages, the tiles
+            // are parallelograms, so nothing is recomputed in y except at
+            // the top of each tile. In x, the tiles overlap, and each stage
+            // of a group recomputes 4 more columns than the next one, so
+            // the redundant work is about 2 * (group_size - 1) / tile_width
+            // of the total. Narrower tiles keep the stored rows small, at
+            // the cost of more overlap, so they need shorter groups.
+
             const int vec = natural_vector_size<uint16_t>();
+            const int group = group_size;
 
-            // How many stencils in between each compute-root
-            const int group_size = 11;
             Var yi, yo, xo, xi, t;
 
             const int last_stage_idx = (int)stages.size() - 1;
-            for (int j = last_stage_idx; j > 0; j -= group_size) {
+            for (int j = last_stage_idx; j > 0; j -= group) {
                 Func out = (j == last_stage_idx) ? output : stages[j];
 
                 const int stages_to_output = last_stage_idx - j;
                 const int expansion = 4 * stages_to_output;
                 const int w = 1536 + expansion;
                 const int h = 2560 + expansion;
+                // By default, break into 16 tiles for our 16 threads
+                const int tw = tile_width > 0 ? (int)tile_width : w / 4;
+                const int th = tile_height > 0 ? (int)tile_height : h / 4;
 
                 out.compute_root()
-                    // Break into 16 tiles for our 16 threads
-                    .tile(x, y, xo, yo, xi, yi, w / 4, h / 4)
+                    .tile(x, y, xo, yo, xi, yi, tw, th)
                     .fuse(xo, yo, t)
                     .parallel(t)
                     .vectorize(xi, vec);
 
-                for (int i = std::max(0, j - group_size + 1); i < j; i++) {
+                for (int i = std::max(0, j - group + 1); i < j; i++) {
                     Func s = stages[i];
                     s.store_at(out, t)
                         .compute_at(out, yi)
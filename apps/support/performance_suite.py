@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Run the apps' tests as a performance regression suite.
+
+Every test selected by label is run with HL_BENCHMARK_JSON set, which makes
+each call to Halide::Tools::benchmark() (see tools/halide_benchmark.h) append
+a line of JSON with the median per-iteration time and a bootstrap confidence
+interval for it. The medians are compared against a stored baseline for this
+machine. A benchmark regresses if even the low end of its confidence interval
+is more than --threshold slower than the baseline median.
+
+Use --update-baseline to (re)record the baseline from the current run.
+"""
+
+import argparse
+import json
+import os
+import platform
+import re
+import subprocess
+import sys
+import tempfile
+
+
+def list_tests(ctest, build_dir, labels):
+    regex = "^(" + "|".join(re.escape(l) for l in labels) + ")$"
+    out = subprocess.check_output(
+        [ctest, "--show-only=json-v1", "-L", regex], cwd=build_dir
+    )
+    return json.loads(out).get("tests", [])
+
+
+def run_test(test, build_dir):
+    """Run one test and return (passed, {benchmark name: record})."""
+    props = {p["name"]: p["value"] for p in test.get("properties", [])}
+    cwd = props.get("WORKING_DIRECTORY", build_dir)
+    env = dict(os.environ)
+    for kv in props.get("ENVIRONMENT", []):
+        k, _, v = kv.partition("=")
+        env[k] = v
+
+    fd, records_path = tempfile.mkstemp(suffix=".jsonl")
+    os.close(fd)
+    env["HL_BENCHMARK_JSON"] = records_path
+    try:
+        result = subprocess.run(
+            test["command"],
+            cwd=cwd,
+            env=env,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+        )
+        records = {}
+        with open(records_path) as f:
+            for line in f:
+                if line.strip():
+                    r = json.loads(line)
+                    records[test["name"] + "/" + r["name"]] = r
+    finally:
+        os.remove(records_path)
+
+    if result.returncode != 0:
+        sys.stdout.write(result.stdout.decode(errors="replace"))
+    return result.returncode == 0, records
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--ctest", default="ctest")
+    parser.add_argument("--build-dir", default=".")
+    parser.add_argument("--labels", nargs="+", required=True)
+    parser.add_argument(
+        "--baseline",
+        required=True,
+        help="JSON file holding the baseline for this machine",
+    )
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=0.1,
+        help="allowed slowdown relative to the baseline, as a fraction",
+    )
+    parser.add_argument("--results", help="also write this run's results here")
+    parser.add_argument("--update-baseline", action="store_true")
+    args = parser.parse_args()
+
+    tests = list_tests(args.ctest, args.build_dir, args.labels)
+    if not tests:
+        print("No tests match labels: " + " ".join(args.labels))
+        return 1
+
+    failed_tests = []
+    results = {}
+    for test in tests:
+        print("Running " + test["name"] + "...", flush=True)
+        passed, records = run_test(test, args.build_dir)
+        if not passed:
+            failed_tests.append(test["name"])
+        results.update(records)
+
+    run = {"machine": platform.node(), "benchmarks": results}
+    if args.results:
+        with open(args.results, "w") as f:
+            json.dump(run, f, indent=2, sort_keys=True)
+
+    if args.update_baseline:
+        os.makedirs(os.path.dirname(os.path.abspath(args.baseline)), exist_ok=True)
+        with open(args.baseline, "w") as f:
+            json.dump(run, f, indent=2, sort_keys=True)
+        print("Wrote baseline with %d benchmarks to %s" % (len(results), args.baseline))
+        return 1 if failed_tests else 0
+
+    baseline = {}
+    if os.path.exists(args.baseline):
+        with open(args.baseline) as f:
+            baseline = json.load(f).get("benchmarks", {})
+    else:
+        print("No baseline at %s; run with --update-baseline to record one." % args.baseline)
+
+    regressions = []
+    print("%-60s %12s %12s %8s" % ("benchmark", "baseline ms", "median ms", "change"))
+    for name in sorted(results):
+        r = results[name]
+        b = baseline.get(name)
+        if b is None:
+            print("%-60s %12s %12.4f %8s" % (name, "-", r["median"] * 1e3, "new"))
+            continue
+        change = r["median"] / b["median"] - 1
+        status = ""
+        if r["median_ci_low"] > b["median"] * (1 + args.threshold):
+            status = "  REGRESSION"
+            regressions.append(name)
+        print(
+            "%-60s %12.4f %12.4f %+7.1f%%%s"
+            % (name, b["median"] * 1e3, r["median"] * 1e3, change * 100, status)
+        )
+    for name in sorted(set(baseline) - set(results)):
+        print("%-60s %12.4f %12s %8s" % (name, baseline[name]["median"] * 1e3, "-", "missing"))
+
+    for name in failed_tests:
+        print("Test failed: " + name)
+    for name in regressions:
+        print("Performance regression: " + name)
+    return 1 if (failed_tests or regressions) else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
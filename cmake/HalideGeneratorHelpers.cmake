@@ -195,7 +195,8 @@ function(add_halide_library TARGET)
         REGISTRATION
         SCHEDULE
         STMT
-        STMT_HTML)
+        STMT_HTML
+        THIN_LTO_BITCODE)
 
     # "hash table" of extra outputs to extensions
     set(ASSEMBLY_extension ".s")
@@ -210,12 +211,13 @@ function(add_halide_library TARGET)
     set(SCHEDULE_extension ".schedule.h")
     set(STMT_extension ".stmt")
     set(STMT_HTML_extension ".stmt.html")
+    set(THIN_LTO_BITCODE_extension ".thinlto.bc")
 
     ##
     # Parse the arguments and set defaults for missing values.
     ##
 
-    set(options C_BACKEND GRADIENT_DESCENT)
+    set(options C_BACKEND GRADIENT_DESCENT INCREMENTAL)
     set(oneValueArgs FROM GENERATOR FUNCTION_NAME NAMESPACE USE_RUNTIME AUTOSCHEDULER HEADER ${extra_output_names})
     set(multiValueArgs TARGETS FEATURES PARAMS PLUGINS)
     cmake_parse_arguments(ARG "${options}" "${oneValueArgs}" "${multiValueArgs}" ${ARGN})
@@ -265,6 +267,7 @@ function(add_halide_library TARGET)
     endif ()
 
     set(gradient_descent "$<BOOL:${ARG_GRADIENT_DESCENT}>")
+    set(incremental "$<BOOL:${ARG_INCREMENTAL}>")
 
     if (NOT ARG_GENERATOR)
         set(ARG_GENERATOR "${TARGET}")
@@ -418,10 +421,20 @@ function(add_halide_library TARGET)
         set(generator_plugins -p ${generator_plugins_list})
     endif ()
 
+    # Incremental builds leave the outputs untouched when their fingerprint
+    # matches, so build tools that check whether outputs changed (such as
+    # Ninja) skip rebuilding whatever depends on them.
+    set(generator_byproducts "")
+    if (ARG_INCREMENTAL)
+        set(generator_byproducts BYPRODUCTS "${TARGET}.fingerprint")
+    endif ()
+
     add_custom_command(OUTPUT ${generator_output_files}
+                       ${generator_byproducts}
                        COMMAND ${GENERATOR_CMD}
                        -n "${TARGET}"
                        -d "${gradient_descent}"
+                       -i "${incremental}"
                        -g "${ARG_GENERATOR}"
                        -f "${ARG_FUNCTION_NAME}"
                        -e "$<JOIN:${generator_outputs},$<COMMA>>"
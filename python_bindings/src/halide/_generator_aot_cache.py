@@ -0,0 +1,277 @@
+"""An on-disk cache of ahead-of-time compiled Python Generators.
+
+The first time a Generator is requested with a given set of GeneratorParams
+and a given Target, it is compiled to an object file (with the Halide runtime
+included), which is linked into a shared library in the cache directory. Later
+requests, in this process or any other, just load the shared library with
+ctypes, so there is no compile cost. Arguments are passed to the pipeline
+without copying: each buffer is described by a halide_buffer_t that points
+directly at the memory of the NumPy array (or hl.Buffer) it came from.
+"""
+
+from __future__ import annotations
+from .halide_ import *
+import ctypes
+import hashlib
+import inspect
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+from typing import Optional
+
+# Bump this whenever the layout of the cache entries changes.
+_CACHE_FORMAT_VERSION = 1
+
+# cache key -> _CachedCallable, so that each library is only loaded once per process.
+_loaded: dict = {}
+
+
+class _halide_type_t(ctypes.Structure):
+    _fields_ = [("code", ctypes.c_uint8), ("bits", ctypes.c_uint8), ("lanes", ctypes.c_uint16)]
+
+
+class _halide_dimension_t(ctypes.Structure):
+    _fields_ = [
+        ("min", ctypes.c_int32),
+        ("extent", ctypes.c_int32),
+        ("stride", ctypes.c_int32),
+        ("flags", ctypes.c_uint32),
+    ]
+
+
+class _halide_buffer_t(ctypes.Structure):
+    _fields_ = [
+        ("device", ctypes.c_uint64),
+        ("device_interface", ctypes.c_void_p),
+        ("host", ctypes.c_void_p),
+        ("flags", ctypes.c_uint64),
+        ("type", _halide_type_t),
+        ("dimensions", ctypes.c_int32),
+        ("dim", ctypes.POINTER(_halide_dimension_t)),
+        ("padding", ctypes.c_void_p),
+    ]
+
+
+# (halide_type_code_t, bits) -> (numpy dtype name, ctypes scalar type)
+_TYPES = {
+    (0, 8): ("int8", ctypes.c_int8),
+    (0, 16): ("int16", ctypes.c_int16),
+    (0, 32): ("int32", ctypes.c_int32),
+    (0, 64): ("int64", ctypes.c_int64),
+    (1, 1): ("bool", ctypes.c_bool),
+    (1, 8): ("uint8", ctypes.c_uint8),
+    (1, 16): ("uint16", ctypes.c_uint16),
+    (1, 32): ("uint32", ctypes.c_uint32),
+    (1, 64): ("uint64", ctypes.c_uint64),
+    (2, 16): ("float16", None),
+    (2, 32): ("float32", ctypes.c_float),
+    (2, 64): ("float64", ctypes.c_double),
+    (3, 64): (None, ctypes.c_void_p),
+}
+
+
+def _describe_argument(name: str, is_buffer: bool, t: Type, dimensions: int) -> dict:
+    return {
+        "name": name,
+        "buffer": is_buffer,
+        "code": int(t.code()),
+        "bits": t.bits(),
+        "dimensions": dimensions,
+    }
+
+
+def _default_cache_dir() -> str:
+    d = os.environ.get("HL_PYTHON_AOT_CACHE_DIR", "")
+    if not d:
+        d = os.path.join(os.environ.get("XDG_CACHE_HOME", os.path.expanduser("~/.cache")), "halide")
+    return d
+
+
+def _c_compiler() -> Optional[str]:
+    cc = os.environ.get("CC", "")
+    return cc if cc else shutil.which("cc")
+
+
+def _can_cache(target: Target) -> bool:
+    # The library is loaded into this process, so it must be built for the host,
+    # and there must be something to link it with.
+    host = get_host_target()
+    return (sys.platform != "win32" and
+            target.os == host.os and
+            target.arch == host.arch and
+            target.bits == host.bits and
+            not target.has_feature(TargetFeature.UserContext) and
+            _c_compiler() is not None)
+
+
+def _cache_key(cls, generator_params: dict, target: Target) -> Optional[str]:
+    try:
+        source = inspect.getsource(cls)
+    except (OSError, TypeError):
+        # Generators defined interactively have no source to hash.
+        return None
+    # Any change to libHalide can change the generated code.
+    halide_ = sys.modules[Target.__module__].__file__
+    st = os.stat(halide_)
+    h = hashlib.sha256()
+    for part in [str(_CACHE_FORMAT_VERSION), cls._halide_registered_name, source,
+                 repr(sorted((str(k), str(v)) for k, v in generator_params.items())), target.to_string(),
+                 "%s:%d:%d" % (halide_, st.st_size, st.st_mtime_ns)]:
+        h.update(part.encode("utf-8"))
+        h.update(b"\0")
+    return h.hexdigest()[:32]
+
+
+def _to_buffer(value, arg: dict, is_output: bool):
+    import numpy as np
+
+    a = np.asarray(value)
+    dtype, _ = _TYPES[(arg["code"], arg["bits"])]
+    if a.dtype != np.dtype(dtype):
+        raise HalideError("Argument %s has type %s, but the Generator expects %s." % (arg["name"], a.dtype, dtype))
+    if a.ndim != arg["dimensions"]:
+        raise HalideError("Argument %s has %d dimensions, but the Generator expects %d." %
+                          (arg["name"], a.ndim, arg["dimensions"]))
+    if is_output and not a.flags.writeable:
+        raise HalideError("Output %s is not writable." % arg["name"])
+
+    # NumPy lists the axes in the opposite order to Halide (like hl.Buffer's
+    # reverse_axes), and measures strides in bytes rather than elements.
+    dims = (_halide_dimension_t * max(a.ndim, 1))()
+    for i in range(a.ndim):
+        axis = a.ndim - 1 - i
+        if a.strides[axis] % a.itemsize:
+            raise HalideError("Argument %s has a stride that is not a multiple of its element size." % arg["name"])
+        dims[i] = _halide_dimension_t(0, a.shape[axis], a.strides[axis] // a.itemsize, 0)
+
+    b = _halide_buffer_t()
+    b.host = a.ctypes.data
+    b.type = _halide_type_t(arg["code"], arg["bits"], 1)
+    b.dimensions = a.ndim
+    b.dim = dims
+    # Keep the array and the dims alive for as long as the halide_buffer_t.
+    return b, (a, dims)
+
+
+def _to_scalar(value, arg: dict):
+    _, ctype = _TYPES[(arg["code"], arg["bits"])]
+    if ctype is None:
+        raise HalideError("Scalar argument %s has a type that cannot be passed from Python." % arg["name"])
+    return ctype(value)
+
+
+class _CachedCallable:
+    """Calls the pipeline in a shared library written by compile_to_cached_callable()."""
+
+    def __init__(self, path: str, fn_name: str, arguments: list[dict]):
+        self._library = ctypes.CDLL(path)
+        self._fn = getattr(self._library, fn_name + "_argv")
+        self._fn.argtypes = [ctypes.POINTER(ctypes.c_void_p)]
+        self._fn.restype = ctypes.c_int
+        self._fn_name = fn_name
+        self._arguments = arguments
+        self._num_inputs = sum(1 for a in arguments if not a.get("output", False))
+
+    def __call__(self, *args, **kwargs):
+        if len(args) > len(self._arguments):
+            raise HalideError("Expected at most %d positional arguments, but saw %d." %
+                              (len(self._arguments), len(args)))
+        values = list(args) + [None] * (len(self._arguments) - len(args))
+        names = [a["name"] for a in self._arguments]
+        for k, v in kwargs.items():
+            if k not in names:
+                raise HalideError("Unknown argument '%s' specified via keyword." % k)
+            i = names.index(k)
+            if i < len(args):
+                raise HalideError("Argument %s specified multiple times." % k)
+            values[i] = v
+
+        argv = (ctypes.c_void_p * len(self._arguments))()
+        keep_alive = []
+        for i, (arg, value) in enumerate(zip(self._arguments, values)):
+            if value is None:
+                raise HalideError("Argument %s was not specified by either positional or keyword argument." %
+                                  arg["name"])
+            if arg["buffer"]:
+                b, owner = _to_buffer(value, arg, i >= self._num_inputs)
+                keep_alive.append(owner)
+            else:
+                b = _to_scalar(value, arg)
+            keep_alive.append(b)
+            argv[i] = ctypes.cast(ctypes.pointer(b), ctypes.c_void_p)
+
+        result = self._fn(argv)
+        if result != 0:
+            raise HalideError("Halide pipeline %s failed with error code %d." % (self._fn_name, result))
+
+
+def _compile(generator, fn_name: str, target: Target, directory: str, key: str):
+    pipeline = generator._build_pipeline()
+    inputs = [a for a in generator._get_arginfos() if a.dir == ArgInfoDirection.Input]
+    outputs = [a for a in generator._get_arginfos() if a.dir == ArgInfoDirection.Output]
+
+    arguments = []
+    descriptions = []
+    for a in inputs:
+        argument = generator._get_input_parameter(a.name)._to_argument()
+        arguments.append(argument)
+        descriptions.append(
+            _describe_argument(a.name, a.kind == ArgInfoKind.Buffer, argument.type, argument.dimensions))
+    for a in outputs:
+        f = generator._get_output_func(a.name)
+        if len(f.types()) != 1:
+            return None
+        d = _describe_argument(a.name, True, f.types()[0], f.dimensions())
+        d["output"] = True
+        descriptions.append(d)
+
+    os.makedirs(directory, exist_ok=True)
+    with tempfile.TemporaryDirectory(dir=directory) as tmp:
+        obj = os.path.join(tmp, fn_name + ".o")
+        pipeline.compile_to({OutputFileType.object: obj}, arguments, fn_name, target)
+        so = os.path.join(tmp, key + ".so")
+        subprocess.run([_c_compiler(), "-shared", "-o", so, obj, "-lpthread", "-ldl", "-lm"],
+                       check=True, stdout=subprocess.DEVNULL)
+        meta = os.path.join(tmp, key + ".json")
+        with open(meta, "w") as f:
+            json.dump({"fn_name": fn_name, "arguments": descriptions}, f)
+        # Other processes may be filling the same entry at the same time;
+        # renaming makes each file appear all at once. The library goes
+        # first, since the metadata is what marks an entry as complete.
+        os.replace(so, os.path.join(directory, key + ".so"))
+        os.replace(meta, os.path.join(directory, key + ".json"))
+    return True
+
+
+def compile_to_cached_callable(cls, generator_params: dict, target: Optional[Target], cache_dir: Optional[str]):
+    if target is None:
+        target = get_target_from_environment()
+    target = target.without_feature(TargetFeature.JIT)
+
+    def make_generator():
+        with GeneratorContext(target):
+            return cls(generator_params)
+
+    key = _cache_key(cls, generator_params, target) if _can_cache(target) else None
+    if key is None:
+        return make_generator().compile_to_callable()
+
+    directory = cache_dir if cache_dir else _default_cache_dir()
+    if key in _loaded:
+        return _loaded[key]
+
+    meta = os.path.join(directory, key + ".json")
+    if not os.path.exists(meta):
+        fn_name = cls._halide_registered_name + "_" + key[:8]
+        if not _compile(make_generator(), fn_name, target, directory, key):
+            # Tuple-valued Outputs need more than one buffer each; leave those to the JIT.
+            return make_generator().compile_to_callable()
+
+    with open(meta) as f:
+        info = json.load(f)
+    c = _CachedCallable(os.path.join(directory, key + ".so"), info["fn_name"], info["arguments"])
+    _loaded[key] = c
+    return c
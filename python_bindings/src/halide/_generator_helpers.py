@@ -453,6 +453,20 @@ class Generator(ABC):
         ]
         return pipeline.compile_to_callable(arguments, self._target)
 
+    @classmethod
+    def compile_to_cached_callable(cls, generator_params: dict = {}, target: Optional[Target] = None,
+                                   cache_dir: Optional[str] = None):
+        """Like compile_to_callable(), but the pipeline is compiled ahead of time to a
+        shared library, which is kept in cache_dir (by default $HL_PYTHON_AOT_CACHE_DIR,
+        or ~/.cache/halide) and reused by any later call with the same Generator source,
+        GeneratorParams, and Target. The result takes NumPy arrays (or anything else
+        np.asarray() accepts without copying, such as hl.Buffer) for buffer arguments.
+        Generators that can't be cached, such as those for a Target other than the
+        host, fall back to compile_to_callable()."""
+        from ._generator_aot_cache import compile_to_cached_callable
+        _check(isinstance(generator_params, dict), "generator_params must be a dict")
+        return compile_to_cached_callable(cls, generator_params, target, cache_dir)
+
     # Make it hard for the user to overwrite any members that are GeneratorParams, Inputs, or Outputs
     def __setattr__(self, name, value):
         r = getattr(self, "_requirements", None)
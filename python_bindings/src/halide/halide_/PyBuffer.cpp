@@ -1,5 +1,6 @@
 #include "PyBuffer.h"
 
+#include <memory>
 #include <utility>
 
 #include "PyFunc.h"
@@ -269,17 +270,216 @@ py::object buffer_setitem_operator(Buffer<> &buf, const std::vector<int> &pos, c
     return py::object();
 }
 
+// The subset of the DLPack ABI (https://github.com/dmlc/dlpack) needed to
+// exchange tensors with other frameworks. The layout of these structs is
+// fixed by the DLPack spec, so we declare them here rather than depending
+// on dlpack.h.
+enum DLDeviceType : int32_t {
+    kDLCPU = 1,
+    kDLCUDA = 2,
+    kDLCUDAHost = 3,
+    kDLCUDAManaged = 13,
+};
+
+enum DLDataTypeCode : uint8_t {
+    kDLInt = 0,
+    kDLUInt = 1,
+    kDLFloat = 2,
+    kDLBfloat = 4,
+    kDLBool = 6,
+};
+
+struct DLDevice {
+    int32_t device_type;
+    int32_t device_id;
+};
+
+struct DLDataType {
+    uint8_t code;
+    uint8_t bits;
+    uint16_t lanes;
+};
+
+struct DLTensor {
+    void *data;
+    DLDevice device;
+    int32_t ndim;
+    DLDataType dtype;
+    int64_t *shape;
+    int64_t *strides;
+    uint64_t byte_offset;
+};
+
+struct DLManagedTensor {
+    DLTensor dl_tensor;
+    void *manager_ctx;
+    void (*deleter)(DLManagedTensor *self);
+};
+
+const char *const dltensor_capsule_name = "dltensor";
+const char *const used_dltensor_capsule_name = "used_dltensor";
+
+Type dldatatype_to_type(const DLDataType &dtype) {
+    if (dtype.lanes != 1) {
+        throw py::value_error("DLPack tensors with vector element types are not supported.");
+    }
+    switch (dtype.code) {
+    case kDLInt:
+        return Int(dtype.bits);
+    case kDLUInt:
+        return UInt(dtype.bits);
+    case kDLFloat:
+        return Float(dtype.bits);
+    case kDLBfloat:
+        return BFloat(dtype.bits);
+    case kDLBool:
+        return Bool();
+    default:
+        throw py::value_error("Unsupported DLPack data type.");
+    }
+}
+
+DLDataType type_to_dldatatype(const Type &type) {
+    DLDataType dtype;
+    if (type.is_bool()) {
+        dtype.code = kDLBool;
+    } else if (type.is_int()) {
+        dtype.code = kDLInt;
+    } else if (type.is_uint()) {
+        dtype.code = kDLUInt;
+    } else if (type.is_bfloat()) {
+        dtype.code = kDLBfloat;
+    } else if (type.is_float()) {
+        dtype.code = kDLFloat;
+    } else {
+        throw py::value_error("Unsupported Buffer<> type.");
+    }
+    dtype.bits = (uint8_t)type.bits();
+    dtype.lanes = 1;
+    return dtype;
+}
+
+const halide_device_interface_t *cuda_device_interface() {
+    return get_device_interface_for_device_api(DeviceAPI::CUDA,
+                                               get_jit_target_from_environment().with_feature(Target::CUDA),
+                                               "Buffer::from_dlpack");
+}
+
+// Build a Runtime::Buffer describing a DLPack tensor. Host-accessible
+// tensors get a host pointer; CUDA tensors are left with a null host
+// pointer and wrapped as a native device allocation by the caller.
+Halide::Runtime::Buffer<> dltensor_to_halidebuffer(const DLTensor &t, bool reverse_axes) {
+    const Type type = dldatatype_to_type(t.dtype);
+    halide_dimension_t *dims = (halide_dimension_t *)alloca(t.ndim * sizeof(halide_dimension_t));
+    _halide_user_assert(dims);
+    int64_t compact_stride = 1;
+    for (int i = t.ndim - 1; i >= 0; i--) {
+        // A null strides array means the tensor is compact and row-major.
+        const int64_t stride = t.strides ? t.strides[i] : compact_stride;
+        compact_stride *= t.shape[i];
+        if (t.shape[i] > INT_MAX || stride > INT_MAX || stride < INT_MIN) {
+            throw py::value_error("Out of range dimensions in buffer conversion.");
+        }
+        const int dst_axis = reverse_axes ? (t.ndim - i - 1) : i;
+        dims[dst_axis] = {0, (int32_t)t.shape[i], (int32_t)stride};
+    }
+
+    void *data = (uint8_t *)t.data + t.byte_offset;
+    switch (t.device.device_type) {
+    case kDLCPU:
+    case kDLCUDAHost:
+    case kDLCUDAManaged:
+        return Halide::Runtime::Buffer<>(type, data, t.ndim, dims);
+    case kDLCUDA:
+        return Halide::Runtime::Buffer<>(type, nullptr, t.ndim, dims);
+    default:
+        throw py::value_error("Unsupported DLPack device type; only CPU and CUDA tensors can be imported.");
+    }
+}
+
+// The manager_ctx of a DLManagedTensor we export. It holds a reference
+// to the Buffer<> so the memory outlives the consumer's use of it.
+struct ExportedDLTensor {
+    Buffer<> buffer;
+    std::vector<int64_t> shape, strides;
+    DLManagedTensor tensor;
+};
+
+void delete_exported_dltensor(DLManagedTensor *self) {
+    delete (ExportedDLTensor *)self->manager_ctx;
+}
+
+py::capsule buffer_to_dlpack(Buffer<> &b, bool reverse_axes) {
+    DLDevice device;
+    void *data;
+    if (b.has_device_allocation() && b.raw_buffer()->device_interface == cuda_device_interface()) {
+        // Halide's CUDA runtime uses the CUdeviceptr as the device handle.
+        b.device_sync(nullptr);
+        device = {kDLCUDA, 0};
+        data = (void *)(uintptr_t)b.raw_buffer()->device;
+    } else {
+        if (b.device_dirty()) {
+            b.copy_to_host(nullptr);
+        }
+        if (b.data() == nullptr) {
+            throw py::value_error("Cannot export a Buffer<> with null host ptr via DLPack.");
+        }
+        device = {kDLCPU, 0};
+        data = b.data();
+    }
+
+    auto *ctx = new ExportedDLTensor;
+    ctx->buffer = b;
+    const int d = b.dimensions();
+    ctx->shape.resize(d);
+    ctx->strides.resize(d);
+    for (int i = 0; i < d; i++) {
+        const int dst_axis = reverse_axes ? (d - i - 1) : i;
+        ctx->shape[dst_axis] = b.raw_buffer()->dim[i].extent;
+        ctx->strides[dst_axis] = b.raw_buffer()->dim[i].stride;
+    }
+    DLTensor &t = ctx->tensor.dl_tensor;
+    t.data = data;
+    t.device = device;
+    t.ndim = d;
+    t.dtype = type_to_dldatatype(b.type());
+    t.shape = ctx->shape.data();
+    t.strides = ctx->strides.data();
+    t.byte_offset = 0;
+    ctx->tensor.manager_ctx = ctx;
+    ctx->tensor.deleter = delete_exported_dltensor;
+
+    return py::capsule(&ctx->tensor, dltensor_capsule_name, +[](PyObject *o) {
+        // Only delete the tensor if no consumer took ownership of it.
+        if (PyCapsule_IsValid(o, dltensor_capsule_name)) {
+            auto *t = (DLManagedTensor *)PyCapsule_GetPointer(o, dltensor_capsule_name);
+            t->deleter(t);
+        }
+    });
+}
+
 // Use an alias class so that if we are created via a py::buffer, we can
 // keep the py::buffer_info class alive for the life of the Buffer<>,
 // ensuring the data isn't collected out from under us.
 class PyBuffer : public Buffer<> {
     py::buffer_info info;
+    std::shared_ptr<DLManagedTensor> dlpack;
 
     PyBuffer(py::buffer_info &&info, const std::string &name, bool reverse_axes)
         : Buffer<>(pybufferinfo_to_halidebuffer(info, reverse_axes), name),
           info(std::move(info)) {
     }
 
+    PyBuffer(DLManagedTensor *tensor, const std::string &name, bool reverse_axes)
+        : Buffer<>(dltensor_to_halidebuffer(tensor->dl_tensor, reverse_axes), name),
+          info(),
+          dlpack(tensor, [](DLManagedTensor *t) {
+              if (t->deleter) {
+                  t->deleter(t);
+              }
+          }) {
+    }
+
 public:
     PyBuffer()
         : Buffer<>(), info() {
@@ -307,6 +507,35 @@ public:
         this->set_host_dirty();
     }
 
+    // Take ownership of the tensor in a DLPack capsule, without copying it.
+    static PyBuffer *from_dlpack(const py::object &obj, const std::string &name, bool reverse_axes) {
+        py::object capsule = obj;
+        if (py::hasattr(obj, "__dlpack__")) {
+            capsule = obj.attr("__dlpack__")();
+        }
+        if (!PyCapsule_IsValid(capsule.ptr(), dltensor_capsule_name)) {
+            throw py::value_error("Expected an object supporting __dlpack__, or an unconsumed DLPack capsule.");
+        }
+        auto *tensor = (DLManagedTensor *)PyCapsule_GetPointer(capsule.ptr(), dltensor_capsule_name);
+        const bool on_cuda = tensor->dl_tensor.device.device_type == kDLCUDA;
+        auto *b = new PyBuffer(tensor, name, reverse_axes);
+        // Per the DLPack protocol, renaming the capsule marks it as consumed,
+        // so its destructor won't also free the tensor.
+        PyCapsule_SetName(capsule.ptr(), used_dltensor_capsule_name);
+        if (on_cuda) {
+            const uint64_t handle = (uint64_t)(uintptr_t)((uint8_t *)tensor->dl_tensor.data + tensor->dl_tensor.byte_offset);
+            const int result = b->get()->device_wrap_native(cuda_device_interface(), handle);
+            if (result != 0) {
+                delete b;
+                throw py::value_error("Could not wrap the CUDA memory of a DLPack tensor.");
+            }
+            b->set_device_dirty();
+        } else {
+            b->set_host_dirty();
+        }
+        return b;
+    }
+
     ~PyBuffer() override = default;
 };
 
@@ -378,6 +607,29 @@ void define_buffer(py::module &m) {
                 },
                 py::arg("type"), py::arg("sizes"), py::arg("name") = "")
 
+            // Zero-copy interchange with other frameworks (e.g. PyTorch, CuPy, NumPy)
+            // via DLPack. CPU and CUDA tensors are supported; CUDA tensors are wrapped
+            // as native device allocations, with a null host pointer.
+            .def_static(
+                "from_dlpack", [](const py::object &obj, const std::string &name, bool reverse_axes) -> py::object {
+                    return py::cast(static_cast<Buffer<> *>(PyBuffer::from_dlpack(obj, name, reverse_axes)), py::return_value_policy::take_ownership);
+                },
+                py::arg("obj"), py::arg("name") = "", py::arg("reverse_axes") = true)
+            .def(
+                "__dlpack__", [](Buffer<> &b, const py::object &stream, bool reverse_axes) -> py::capsule {
+                    // We always synchronize before handing out the tensor, so the
+                    // consumer's stream doesn't need to wait on anything.
+                    (void)stream;
+                    return buffer_to_dlpack(b, reverse_axes);
+                },
+                py::arg("stream") = py::none(), py::arg("reverse_axes") = true)
+            .def("__dlpack_device__", [](Buffer<> &b) -> py::tuple {
+                if (b.has_device_allocation() && b.raw_buffer()->device_interface == cuda_device_interface()) {
+                    return py::make_tuple((int)kDLCUDA, 0);
+                }
+                return py::make_tuple((int)kDLCPU, 0);
+            })
+
             .def_static("make_scalar", (Buffer<>(*)(Type, const std::string &))Buffer<>::make_scalar, py::arg("type"), py::arg("name") = "")
             .def_static("make_interleaved", (Buffer<>(*)(Type, int, int, int, const std::string &))Buffer<>::make_interleaved, py::arg("type"), py::arg("width"), py::arg("height"), py::arg("channels"), py::arg("name") = "")
             .def_static(
@@ -2,6 +2,12 @@
 
 #include "PyBuffer.h"
 
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #define TYPED_ALLOCA(TYPE, COUNT) ((TYPE *)alloca(sizeof(TYPE) * (COUNT)))
 
 namespace Halide {
@@ -50,22 +56,19 @@ T cast_to(const py::handle &h) {
 }  // namespace
 
 class PyCallable {
-public:
-    static void call_impl(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+    // Fill in argv (and the storage it points into) for one call, from
+    // Python positional and keyword arguments. The JITUserContext goes
+    // in slot 0. The cci array only depends on the Callable's argument
+    // list, not on the values passed.
+    static void marshal_args(const Callable &c, const py::tuple &args, const py::dict &kwargs,
+                             JITUserContext *context,
+                             const void **argv,
+                             halide_scalar_value_t *scalar_storage,
+                             HalideBuffer *buffers,
+                             Callable::QuickCallCheckInfo *cci) {
         const size_t argc = c.arguments().size();
-        _halide_user_assert(argc > 0);
         const Argument *c_args = c.arguments().data();
 
-        // We want to keep call overhead as low as possible here,
-        // so use alloca (rather than e.g. std::vector) for short-term
-        // small allocations.
-        const void **argv = TYPED_ALLOCA(const void *, argc);
-        halide_scalar_value_t *scalar_storage = TYPED_ALLOCA(halide_scalar_value_t, argc);
-        HBufArray buffers(argc, TYPED_ALLOCA(HalideBuffer, argc));
-        Callable::QuickCallCheckInfo *cci = TYPED_ALLOCA(Callable::QuickCallCheckInfo, argc);
-
-        _halide_user_assert(argv && scalar_storage && buffers.buffers && cci) << "alloca failure";
-
         // Clear argv to all zero so we can use it to validate that all fields are
         // set properly when using kwargs -- a well-formed call will never have any
         // of the fields left null, nor any set twice. (The other alloca stuff can
@@ -76,8 +79,7 @@ public:
             << "Expected at most " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
 
         // args
-        JITUserContext empty_jit_user_context;
-        scalar_storage[0].u.u64 = (uintptr_t)&empty_jit_user_context;
+        scalar_storage[0].u.u64 = (uintptr_t)context;
         argv[0] = &scalar_storage[0];
         cci[0] = Callable::make_ucon_qcci();
 
@@ -93,10 +95,10 @@ public:
                 } else {
                     const bool writable = c_arg.is_output();
                     const bool reverse_axes = true;
-                    buffers.buffers[slot] =
+                    buffers[slot] =
                         pybuffer_to_halidebuffer<void, AnyDims, MaxFastDimensions>(
                             cast_to<py::buffer>(value), writable, reverse_axes);
-                    argv[slot] = buffers.buffers[slot].raw_buffer();
+                    argv[slot] = buffers[slot].raw_buffer();
                 }
                 cci[slot] = Callable::make_buffer_qcci();
             } else {
@@ -185,7 +187,118 @@ public:
                 << "Expected exactly " << (argc - 1) << " positional arguments, but saw " << args.size() << ".";
         }
 
-        int result = c.call_argv_checked(argc, argv, cci);
+    }
+
+public:
+    static void call_impl(Callable &c, const py::args &args, const py::kwargs &kwargs) {
+        const size_t argc = c.arguments().size();
+        _halide_user_assert(argc > 0);
+
+        // We want to keep call overhead as low as possible here,
+        // so use alloca (rather than e.g. std::vector) for short-term
+        // small allocations.
+        const void **argv = TYPED_ALLOCA(const void *, argc);
+        halide_scalar_value_t *scalar_storage = TYPED_ALLOCA(halide_scalar_value_t, argc);
+        HBufArray buffers(argc, TYPED_ALLOCA(HalideBuffer, argc));
+        Callable::QuickCallCheckInfo *cci = TYPED_ALLOCA(Callable::QuickCallCheckInfo, argc);
+
+        _halide_user_assert(argv && scalar_storage && buffers.buffers && cci) << "alloca failure";
+
+        JITUserContext empty_jit_user_context;
+        marshal_args(c, args, kwargs, &empty_jit_user_context, argv, scalar_storage, buffers.buffers, cci);
+
+        int result;
+        {
+            // Don't hold the GIL while the pipeline runs, so other Python
+            // threads can make progress. The print handler in PyError.cpp
+            // reacquires it, and errors are thrown as C++ exceptions, which
+            // reacquire it as they unwind through this scope.
+            py::gil_scoped_release release;
+            result = c.call_argv_checked(argc, argv, cci);
+        }
+        _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
+    }
+
+    // Call the Callable once per item of a sequence. Each item is either a
+    // tuple/list of positional arguments or a dict of keyword arguments.
+    // All the arguments are marshalled up front, and the argument kinds are
+    // checked once for the whole batch, after which the calls run without
+    // the GIL, optionally spread across threads.
+    static void call_batch_impl(Callable &c, const py::sequence &items, bool parallel) {
+        const size_t argc = c.arguments().size();
+        _halide_user_assert(argc > 0);
+        const size_t count = items.size();
+        if (count == 0) {
+            return;
+        }
+
+        std::vector<JITUserContext> contexts(count);
+        std::vector<const void *> argv(count * argc);
+        std::vector<halide_scalar_value_t> scalar_storage(count * argc);
+        std::vector<HalideBuffer> buffers(count * argc);
+        std::vector<Callable::QuickCallCheckInfo> cci(argc);
+
+        for (size_t i = 0; i < count; i++) {
+            const py::object item = items[i];
+            const size_t offset = i * argc;
+            if (py::isinstance<py::dict>(item)) {
+                marshal_args(c, py::tuple(), py::reinterpret_borrow<py::dict>(item), &contexts[i],
+                             &argv[offset], &scalar_storage[offset], &buffers[offset], cci.data());
+            } else {
+                marshal_args(c, py::tuple(item), py::dict(), &contexts[i],
+                             &argv[offset], &scalar_storage[offset], &buffers[offset], cci.data());
+            }
+        }
+
+        const auto failure_fn = c.check_qcci(argc, cci.data());
+        if (failure_fn) {
+            const int result = failure_fn(&contexts[0]);
+            _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
+            return;
+        }
+
+        std::atomic<int> first_error{0};
+        std::exception_ptr first_exception;
+        std::mutex exception_mutex;
+        std::atomic<size_t> next_item{0};
+        const auto run_items = [&]() {
+            try {
+                size_t i;
+                while (first_error == 0 && (i = next_item++) < count) {
+                    const int result = c.call_argv_fast(argc, &argv[i * argc]);
+                    if (result != 0) {
+                        int expected = 0;
+                        first_error.compare_exchange_strong(expected, result);
+                    }
+                }
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(exception_mutex);
+                if (!first_exception) {
+                    first_exception = std::current_exception();
+                }
+                // Stop the other workers from picking up more items.
+                next_item = count;
+            }
+        };
+
+        {
+            // See call_impl() for why it's safe to drop the GIL here.
+            py::gil_scoped_release release;
+            const size_t num_threads = parallel ? std::min<size_t>(count, std::max(1u, std::thread::hardware_concurrency())) : 1;
+            std::vector<std::thread> threads;
+            for (size_t t = 1; t < num_threads; t++) {
+                threads.emplace_back(run_items);
+            }
+            run_items();
+            for (auto &t : threads) {
+                t.join();
+            }
+        }
+
+        if (first_exception) {
+            std::rethrow_exception(first_exception);
+        }
+        const int result = first_error;
         _halide_user_assert(result == 0) << "Halide Runtime Error: " << result;
     }
 
@@ -199,7 +312,8 @@ void define_callable(py::module &m) {
 
     auto callable_class =
         py::class_<Callable>(m, "Callable")
-            .def("__call__", PyCallable::call_impl);
+            .def("__call__", PyCallable::call_impl)
+            .def("call_batch", PyCallable::call_batch_impl, py::arg("items"), py::arg("parallel") = false);
 }
 
 }  // namespace PythonBindings
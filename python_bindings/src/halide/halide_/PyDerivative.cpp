@@ -31,6 +31,19 @@ void define_derivative(py::module &m) {
           (Derivative(*)(const Func &, const Buffer<float> &)) & propagate_adjoints);
     m.def("propagate_adjoints",
           (Derivative(*)(const Func &)) & propagate_adjoints);
+
+    py::class_<Checkpointing>(m, "Checkpointing")
+        .def(py::init<>())
+        .def(py::init([](const std::vector<Func> &checkpoints) {
+                 return Checkpointing{checkpoints};
+             }),
+             py::arg("checkpoints"))
+        .def_readwrite("checkpoints", &Checkpointing::checkpoints);
+
+    m.def("propagate_adjoints",
+          (Derivative(*)(const Func &, const Func &, const Region &, const Checkpointing &)) & propagate_adjoints);
+    m.def("propagate_adjoints",
+          (Derivative(*)(const Func &, const Checkpointing &)) & propagate_adjoints);
 }
 
 }  // namespace PythonBindings
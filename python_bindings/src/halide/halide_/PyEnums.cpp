@@ -4,6 +4,11 @@ namespace Halide {
 namespace PythonBindings {
 
 void define_enums(py::module &m) {
+    py::enum_<ApproximationPrecision>(m, "ApproximationPrecision")
+        .value("Fast", ApproximationPrecision::Fast)
+        .value("Balanced", ApproximationPrecision::Balanced)
+        .value("Precise", ApproximationPrecision::Precise);
+
     py::enum_<Argument::Kind>(m, "ArgumentKind")
         .value("InputScalar", Argument::Kind::InputScalar)
         .value("InputBuffer", Argument::Kind::InputBuffer)
@@ -26,7 +31,8 @@ void define_enums(py::module &m) {
         .value("OpenCL", DeviceAPI::OpenCL)
         .value("OpenGLCompute", DeviceAPI::OpenGLCompute)
         .value("Metal", DeviceAPI::Metal)
-        .value("Hexagon", DeviceAPI::Hexagon);
+        .value("Hexagon", DeviceAPI::Hexagon)
+        .value("Vulkan", DeviceAPI::Vulkan);
 
     py::enum_<LinkageType>(m, "LinkageType")
         .value("External", LinkageType::External)
@@ -60,6 +66,10 @@ void define_enums(py::module &m) {
         .value("GuardWithIf", PrefetchBoundStrategy::GuardWithIf)
         .value("NonFaulting", PrefetchBoundStrategy::NonFaulting);
 
+    py::enum_<PrivatizeStrategy>(m, "PrivatizeStrategy")
+        .value("Parallel", PrivatizeStrategy::Parallel)
+        .value("Vectorized", PrivatizeStrategy::Vectorized);
+
     py::enum_<StmtOutputFormat>(m, "StmtOutputFormat")
         .value("Text", StmtOutputFormat::Text)
         .value("HTML", StmtOutputFormat::HTML);
@@ -184,6 +194,35 @@ void define_enums(py::module &m) {
         .value("SanitizerCoverage", Target::Feature::SanitizerCoverage)
         .value("ProfileByTimer", Target::Feature::ProfileByTimer)
         .value("SPIRV", Target::Feature::SPIRV)
+        .value("CUDAAsyncCopies", Target::Feature::CUDAAsyncCopies)
+        .value("AVX512_VNNI", Target::Feature::AVX512_VNNI)
+        .value("AVXVNNI", Target::Feature::AVXVNNI)
+        .value("WasmRelaxedSimd", Target::Feature::WasmRelaxedSimd)
+        .value("HexagonAutoVTCM", Target::Feature::HexagonAutoVTCM)
+        .value("ProfileInstrumented", Target::Feature::ProfileInstrumented)
+        .value("Vulkan", Target::Feature::Vulkan)
+        .value("PlanHeapStorage", Target::Feature::PlanHeapStorage)
+        .value("BumpAllocator", Target::Feature::BumpAllocator)
+        .value("CacheParallelAllocations", Target::Feature::CacheParallelAllocations)
+        .value("MultiversionLoops", Target::Feature::MultiversionLoops)
+        .value("VectorMathFast", Target::Feature::VectorMathFast)
+        .value("VectorMathBalanced", Target::Feature::VectorMathBalanced)
+        .value("VectorMathPrecise", Target::Feature::VectorMathPrecise)
+        .value("AVX512_FP16", Target::Feature::AVX512_FP16)
+        .value("ARMBf16", Target::Feature::ARMBf16)
+        .value("CUDATensorCores", Target::Feature::CUDATensorCores)
+        .value("CLSubgroups", Target::Feature::CLSubgroups)
+        .value("MetalSIMDGroups", Target::Feature::MetalSIMDGroups)
+        .value("UncheckedEntryPoint", Target::Feature::UncheckedEntryPoint)
+        .value("PartitionCostModel", Target::Feature::PartitionCostModel)
+        .value("ParallelLoopRanges", Target::Feature::ParallelLoopRanges)
+        .value("CUDAFatbin", Target::Feature::CUDAFatbin)
+        .value("CLSPIRV", Target::Feature::CLSPIRV)
+        .value("CheckNoAlias", Target::Feature::CheckNoAlias)
+        .value("StageLUTs", Target::Feature::StageLUTs)
+        .value("ARMI8mm", Target::Feature::ARMI8mm)
+        .value("HVX_v68", Target::Feature::HVX_v68)
+        .value("FuseOutputs", Target::Feature::FuseOutputs)
         .value("FeatureEnd", Target::Feature::FeatureEnd);
 
     py::enum_<halide_type_code_t>(m, "TypeCode")
@@ -209,6 +248,7 @@ void define_enums(py::module &m) {
         .value("static_library", OutputFileType::static_library)
         .value("stmt", OutputFileType::stmt)
         .value("stmt_html", OutputFileType::stmt_html)
+        .value("thin_lto_bitcode", OutputFileType::thin_lto_bitcode)
         .value("compiler_log", OutputFileType::compiler_log);
 }
 
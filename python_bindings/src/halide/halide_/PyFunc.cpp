@@ -205,12 +205,15 @@ void define_func(py::module &m) {
             .def("store_at", (Func & (Func::*)(LoopLevel)) & Func::store_at, py::arg("loop_level"))
 
             .def("async_", &Func::async)
+            .def("ring_buffer", &Func::ring_buffer, py::arg("buffers"))
             .def("memoize", &Func::memoize)
             .def("compute_inline", &Func::compute_inline)
             .def("compute_root", &Func::compute_root)
+            .def("distribute", &Func::distribute, py::arg("var"))
             .def("store_root", &Func::store_root)
 
             .def("store_in", &Func::store_in, py::arg("memory_type"))
+            .def("store_as", &Func::store_as, py::arg("storage_type"))
 
             .def("compile_to", &Func::compile_to, py::arg("outputs"), py::arg("arguments"), py::arg("fn_name"), py::arg("target") = get_target_from_environment())
 
@@ -333,6 +336,7 @@ void define_func(py::module &m) {
             .def("bound_extent", &Func::bound_extent, py::arg("var"), py::arg("extent"))
 
             .def("align_storage", &Func::align_storage, py::arg("dim"), py::arg("alignment"))
+            .def("pad_storage", &Func::pad_storage, py::arg("dim"), py::arg("alignment") = Expr())
 
             .def("fold_storage", &Func::fold_storage, py::arg("dim"), py::arg("extent"), py::arg("fold_forward") = true)
 
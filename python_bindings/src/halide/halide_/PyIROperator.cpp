@@ -109,9 +109,14 @@ void define_operators(py::module &m) {
     m.def("log", &log);
     m.def("pow", &pow);
     m.def("erf", &erf);
-    m.def("fast_log", &fast_log);
-    m.def("fast_exp", &fast_exp);
-    m.def("fast_pow", &fast_pow);
+    m.def("fast_sin", &fast_sin, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_cos", &fast_cos, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_log", &fast_log, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_exp", &fast_exp, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_pow", &fast_pow, py::arg("x"), py::arg("y"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_tanh", &fast_tanh, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_erf", &fast_erf, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
+    m.def("fast_sigmoid", &fast_sigmoid, py::arg("x"), py::arg("precision") = ApproximationPrecision::Balanced);
     m.def("fast_inverse", &fast_inverse);
     m.def("fast_inverse_sqrt", &fast_inverse_sqrt);
     m.def("floor", &floor);
@@ -152,6 +157,9 @@ void define_operators(py::module &m) {
     m.def("random_uint", (Expr(*)(Expr)) & random_uint, py::arg("seed"));
     m.def("random_int", (Expr(*)(Expr)) & random_int, py::arg("seed"));
     m.def("undef", (Expr(*)(Type)) & undef);
+    m.def("gpu_preferred_block_size", &gpu_preferred_block_size,
+          py::arg("device_api"), py::arg("registers_per_thread") = 32,
+          py::arg("shared_memory_per_block") = 0);
     m.def(
         "memoize_tag", [](const Expr &result, const py::args &cache_key_values) -> Expr {
             return Internal::memoize_tag_helper(result, args_to_vector<Expr>(cache_key_values));
@@ -161,6 +169,7 @@ void define_operators(py::module &m) {
     m.def("likely_if_innermost", &likely_if_innermost);
     m.def("saturating_cast", (Expr(*)(Type, Expr)) & saturating_cast);
     m.def("strict_float", &strict_float);
+    m.def("tuned_prefetch_distance", &tuned_prefetch_distance, py::arg("initial"));
     m.def("logical_not", [](const Expr &expr) -> Expr {
         return !expr;
     });
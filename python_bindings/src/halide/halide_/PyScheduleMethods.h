@@ -26,6 +26,8 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
              py::arg("var"))
         .def("unroll", (T & (T::*)(const VarOrRVar &, const Expr &, TailStrategy)) & T::unroll,
              py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
+        .def("unroll_and_jam", &T::unroll_and_jam,
+             py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
 
         .def("split", (T & (T::*)(const VarOrRVar &, const VarOrRVar &, const VarOrRVar &, const Expr &, TailStrategy)) & T::split,
              py::arg("old"), py::arg("outer"), py::arg("inner"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
@@ -51,6 +53,7 @@ HALIDE_NEVER_INLINE void add_schedule_methods(PythonClass &class_instance) {
 
         .def("parallel", (T & (T::*)(const VarOrRVar &)) & T::parallel, py::arg("var"))
         .def("parallel", (T & (T::*)(const VarOrRVar &, const Expr &, TailStrategy)) & T::parallel, py::arg("var"), py::arg("task_size"), py::arg("tail") = TailStrategy::Auto)
+        .def("multi_gpu", &T::multi_gpu, py::arg("var"))
 
         .def("vectorize", (T & (T::*)(const VarOrRVar &)) & T::vectorize, py::arg("var"))
         .def("vectorize", (T & (T::*)(const VarOrRVar &, const Expr &, TailStrategy)) & T::vectorize, py::arg("var"), py::arg("factor"), py::arg("tail") = TailStrategy::Auto)
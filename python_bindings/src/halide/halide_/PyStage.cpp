@@ -17,7 +17,13 @@ void define_stage(py::module &m) {
             .def("rfactor", (Func(Stage::*)(std::vector<std::pair<RVar, Var>>)) & Stage::rfactor,
                  py::arg("preserved"))
             .def("rfactor", (Func(Stage::*)(const RVar &, const Var &)) & Stage::rfactor,
-                 py::arg("r"), py::arg("v"));
+                 py::arg("r"), py::arg("v"))
+
+            .def("privatize", &Stage::privatize,
+                 py::arg("r"), py::arg("u"), py::arg("copies"),
+                 py::arg("strategy") = PrivatizeStrategy::Parallel)
+            .def("parallel_scan", &Stage::parallel_scan,
+                 py::arg("r"), py::arg("b"), py::arg("blocks"));
 
     py::implicitly_convertible<Func, Stage>();
 
@@ -382,6 +382,43 @@ def test_oob():
         assert "index 6 is out of bounds for axis 1 with min=0, extent=6" in str(e)
 
 
+def test_dlpack():
+    # DLPack interchange with NumPy needs NumPy 1.22 or later.
+    if not hasattr(np, "from_dlpack"):
+        return
+
+    a0 = np.arange(12, dtype=np.int16).reshape((3, 4))
+    b0 = hl.Buffer.from_dlpack(a0)
+    assert b0.type() == hl.Int(16)
+    assert b0.dim(0).extent() == 4
+    assert b0.dim(1).extent() == 3
+    assert b0.dim(1).stride() == 4
+    assert b0[1, 2] == 9
+
+    # The data is shared, not copied.
+    a0[2, 1] = 42
+    assert b0[1, 2] == 42
+
+    # Strided views keep their strides.
+    b1 = hl.Buffer.from_dlpack(a0[:, ::2])
+    assert b1.dim(0).extent() == 2
+    assert b1.dim(0).stride() == 2
+    assert b1[1, 2] == a0[2, 2]
+
+    buf = hl.Buffer(hl.Float(32), [5, 7])
+    buf.fill(0)
+    buf[3, 4] = 1.5
+    assert buf.__dlpack_device__() == (1, 0)
+    a1 = np.from_dlpack(buf)
+    assert a1.shape == (7, 5)
+    assert a1[4, 3] == 1.5
+
+    # The exported tensor keeps the buffer alive.
+    del buf
+    gc.collect()
+    assert a1[4, 3] == 1.5
+
+
 if __name__ == "__main__":
     test_make_interleaved()
     test_interleaved_ndarray()
@@ -401,3 +438,4 @@ if __name__ == "__main__":
     test_buffer_to_str()
     test_scalar_buffers()
     test_oob()
+    test_dlpack()
@@ -171,6 +171,50 @@ def test_simple(callable_factory):
         assert False, "Did not see expected exception!"
 
 
+def test_call_batch():
+    p_offset = hl.Param(hl.UInt(8), "p_offset")
+    p_img = hl.ImageParam(hl.UInt(8), 2, "p_img")
+
+    x = hl.Var("x")
+    y = hl.Var("y")
+    f = hl.Func("f")
+    f[x, y] = p_img[x, y] + p_offset
+
+    c = f.compile_to_callable([p_img, p_offset])
+
+    count = 16
+    inputs = []
+    outputs = []
+    for i in range(count):
+        b = hl.Buffer(hl.UInt(8), [8, 4])
+        b.fill(i)
+        inputs.append(b)
+        outputs.append(hl.Buffer(hl.UInt(8), [8, 4]))
+
+    # Positional and keyword items can be mixed in one batch.
+    items = [(inputs[i], i, outputs[i]) for i in range(count // 2)]
+    items += [{"p_img": inputs[i], "p_offset": 1, "f": outputs[i]} for i in range(count // 2, count)]
+
+    for parallel in [False, True]:
+        for o in outputs:
+            o.fill(0)
+        c.call_batch(items, parallel=parallel)
+        for i in range(count):
+            expected = 2 * i if i < count // 2 else i + 1
+            assert outputs[i].all_equal(expected)
+
+    # An empty batch is a no-op.
+    c.call_batch([])
+
+    # Errors in any item are reported.
+    try:
+        c.call_batch([(inputs[0], 0, outputs[0]), (inputs[0], 0)])
+    except hl.HalideError as e:
+        assert "was not specified" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+
 if __name__ == "__main__":
     # test_callable()
 
@@ -184,3 +228,4 @@ if __name__ == "__main__":
 
     test_simple(via_simplecpp_pystub)
     test_simple(via_simplepy)
+    test_call_batch()
@@ -0,0 +1,67 @@
+import halide as hl
+import numpy as np
+import os
+import tempfile
+
+from simplepy_generator import SimplePy
+
+
+def test_generator_aot_cache(cache_dir):
+    target = hl.get_target_from_environment()
+
+    b_in = np.arange(12, dtype=np.uint8).reshape(3, 4)
+    b_out = np.zeros((3, 4), dtype=np.float32)
+
+    simple = SimplePy.compile_to_cached_callable(target=target, cache_dir=cache_dir)
+    entries = set(os.listdir(cache_dir))
+    if not entries:
+        print("[SKIP] Generators can't be compiled ahead of time for %s here." % target)
+        return
+
+    # The output is written directly into the NumPy array.
+    simple(b_in, 3.5, b_out)
+    assert np.array_equal(b_out, b_in + np.float32(3.5))
+
+    simple(float_arg=1.0, simple_output=b_out, buffer_input=b_in)
+    assert np.array_equal(b_out, b_in + np.float32(1.0))
+
+    # Non-contiguous views are passed without copying too.
+    b_out_t = np.zeros((4, 3), dtype=np.float32).T
+    simple(b_in, 0.0, b_out_t)
+    assert np.array_equal(b_out_t, b_in.astype(np.float32))
+
+    # hl.Buffers work as well.
+    hb_in = hl.Buffer(b_in)
+    hb_out = hl.Buffer(hl.Float(32), [4, 3])
+    simple(hb_in, 2.0, hb_out)
+    assert hb_out[1, 2] == b_in[2, 1] + 2.0
+
+    # Asking again must not compile anything new.
+    again = SimplePy.compile_to_cached_callable(target=target, cache_dir=cache_dir)
+    assert again is simple
+    assert set(os.listdir(cache_dir)) == entries
+
+    # A different GeneratorParam makes a different entry.
+    simple_42 = SimplePy.compile_to_cached_callable(generator_params={"offset": 42}, target=target,
+                                                    cache_dir=cache_dir)
+    simple_42(b_in, 0.0, b_out)
+    assert np.array_equal(b_out, b_in + np.float32(42))
+
+    try:
+        simple(b_in.astype(np.int16), 3.5, b_out)
+    except hl.HalideError as e:
+        assert "expects uint8" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+    try:
+        simple(b_in, 3.5)
+    except hl.HalideError as e:
+        assert "was not specified" in str(e)
+    else:
+        assert False, "Did not see expected exception!"
+
+
+if __name__ == "__main__":
+    with tempfile.TemporaryDirectory() as cache_dir:
+        test_generator_aot_cache(cache_dir)
@@ -154,6 +154,7 @@ Stmt add_image_checks_inner(Stmt s,
 
     bool no_asserts = t.has_feature(Target::NoAsserts);
     bool no_bounds_query = t.has_feature(Target::NoBoundsQuery);
+    bool check_no_alias = t.has_feature(Target::CheckNoAlias);
 
     // First hunt for all the referenced buffers
     FindBuffers finder;
@@ -198,6 +199,16 @@ Stmt add_image_checks_inner(Stmt s,
     vector<Stmt> asserts_device_not_dirty;
     vector<Stmt> buffer_rewrites;
     vector<Stmt> msan_checks;
+    vector<Stmt> asserts_no_alias;
+
+    // The range of host memory spanned by each buffer used on host,
+    // for the check that the outputs alias none of the other buffers.
+    struct Footprint {
+        string name;
+        bool is_output;
+        Expr begin, end, nonempty;
+    };
+    vector<Footprint> footprints;
 
     // Inject the code that conditionally returns if we're in inference mode
     Expr maybe_return_condition = const_false();
@@ -652,6 +663,43 @@ Stmt add_image_checks_inner(Stmt s,
                                     {name, alignment_required}, Call::Extern);
             asserts_host_alignment.push_back(AssertStmt::make(align_condition, error));
         }
+
+        if (check_no_alias && used_on_host && param.defined()) {
+            Expr lo = make_zero(Int(64)), hi = make_zero(Int(64));
+            Expr nonempty = const_true();
+            for (int j = 0; j < dimensions; j++) {
+                string dim = std::to_string(j);
+                Expr extent = Variable::make(Int(32), name + ".extent." + dim, image, param, rdom);
+                Expr stride = Variable::make(Int(32), name + ".stride." + dim, image, param, rdom);
+                Expr span = cast<int64_t>(extent - 1) * cast<int64_t>(stride);
+                lo += min(span, make_zero(Int(64)));
+                hi += max(span, make_zero(Int(64)));
+                nonempty = nonempty && extent > 0;
+            }
+            Expr base = reinterpret<int64_t>(host_ptr);
+            int bytes = type.bytes();
+            footprints.push_back({name, is_output_buffer,
+                                  base + lo * bytes, base + (hi + 1) * bytes, nonempty});
+        }
+    }
+
+    // Check that the host memory of each output overlaps neither
+    // that of the inputs nor that of the other outputs.
+    for (size_t i = 0; i < footprints.size(); i++) {
+        const Footprint &a = footprints[i];
+        if (!a.is_output) {
+            continue;
+        }
+        for (size_t j = 0; j < footprints.size(); j++) {
+            const Footprint &b = footprints[j];
+            if (i == j || (b.is_output && j < i)) {
+                continue;
+            }
+            Expr overlap = a.nonempty && b.nonempty && a.begin < b.end && b.begin < a.end;
+            Expr error = Call::make(Int(32), "halide_error_buffers_overlap",
+                                    {a.name, b.name}, Call::Extern);
+            asserts_no_alias.push_back(AssertStmt::make(!overlap, error));
+        }
     }
 
     auto prepend_stmts = [&](vector<Stmt> *stmts) {
@@ -671,6 +719,7 @@ Stmt add_image_checks_inner(Stmt s,
 
     if (!no_asserts) {
         // Inject the code that checks the host pointers.
+        prepend_stmts(&asserts_no_alias);
         prepend_stmts(&asserts_host_non_null);
         prepend_stmts(&asserts_host_alignment);
         prepend_stmts(&asserts_device_not_dirty);
@@ -770,5 +819,42 @@ Stmt add_image_checks(const Stmt &s,
     return injector.mutate(s);
 }
 
+Stmt strip_argument_checks(const Stmt &s) {
+    class StripArgumentChecks : public IRMutator {
+        using IRMutator::visit;
+
+        Stmt visit(const AssertStmt *op) override {
+            const Call *error = op->message.as<Call>();
+            if (error && (starts_with(error->name, "halide_error_param_") ||
+                          error->name == "halide_error_access_out_of_bounds" ||
+                          error->name == "halide_error_bad_dimensions" ||
+                          error->name == "halide_error_bad_type" ||
+                          error->name == "halide_error_buffer_allocation_too_large" ||
+                          error->name == "halide_error_buffer_argument_is_null" ||
+                          error->name == "halide_error_buffer_extents_negative" ||
+                          error->name == "halide_error_buffer_extents_too_large" ||
+                          error->name == "halide_error_buffers_overlap" ||
+                          error->name == "halide_error_constraint_violated" ||
+                          error->name == "halide_error_constraints_make_required_region_smaller" ||
+                          error->name == "halide_error_device_dirty_with_no_device_support" ||
+                          error->name == "halide_error_host_is_null" ||
+                          error->name == "halide_error_unaligned_host_ptr")) {
+                return Evaluate::make(0);
+            } else {
+                return IRMutator::visit(op);
+            }
+        }
+
+        Expr visit(const Call *op) override {
+            if (op->name == Call::buffer_is_bounds_query) {
+                return const_false();
+            } else {
+                return IRMutator::visit(op);
+            }
+        }
+    } stripper;
+    return simplify(stripper.mutate(s));
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -33,6 +33,14 @@ Stmt add_image_checks(const Stmt &s,
                       const FuncValueBounds &fb,
                       bool will_inject_host_copies);
 
+/** Remove the checks of the arguments of a pipeline added by
+ * add_image_checks, add_parameter_checks and unpack_buffers, and its
+ * handling of bounds queries. The result is only correct when called
+ * with arguments that would have passed those checks and that aren't
+ * bounds queries, e.g. ones that have already been validated by
+ * calling the checked pipeline with buffers of the same shapes. */
+Stmt strip_argument_checks(const Stmt &s);
+
 }  // namespace Internal
 }  // namespace Halide
 
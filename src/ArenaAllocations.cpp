@@ -0,0 +1,106 @@
+#include "ArenaAllocations.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+namespace {
+
+using std::string;
+
+class InjectArenaAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    // The arena of the innermost enclosing scope.
+    string arena;
+    bool arena_used = false;
+
+    // Wrap s in the acquisition of a fresh arena, if anything in it
+    // ends up using one.
+    Stmt make_scope(const Stmt &s) {
+        ScopedValue<string> old_arena(arena, unique_name("arena"));
+        ScopedValue<bool> old_arena_used(arena_used, false);
+        Stmt body = mutate(s);
+        if (!arena_used) {
+            return body;
+        }
+        Expr begin = Call::make(type_of<void *>(), "halide_arena_begin", {}, Call::Extern);
+        return Allocate::make(arena, UInt(8), MemoryType::Heap, {1}, const_true(),
+                              body, begin, "halide_arena_end");
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Device code manages its own memory.
+            return op;
+        }
+        if (op->for_type != ForType::Parallel &&
+            op->for_type != ForType::MultiGPU) {
+            return IRMutator::visit(op);
+        }
+        // Iterations may run concurrently on different threads.
+        Stmt body = make_scope(op->body);
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const Fork *op) override {
+        Stmt first = make_scope(op->first);
+        Stmt rest = make_scope(op->rest);
+        if (first.same_as(op->first) && rest.same_as(op->rest)) {
+            return op;
+        }
+        return Fork::make(first, rest);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            op->extents.empty() ||
+            (op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Auto)) {
+            return IRMutator::visit(op);
+        }
+        int64_t constant_size = op->constant_allocation_size();
+        if (op->memory_type == MemoryType::Auto &&
+            constant_size > 0 &&
+            can_allocation_fit_on_stack(constant_size * op->type.bytes())) {
+            // This will go on the stack.
+            return IRMutator::visit(op);
+        }
+
+        Stmt body = mutate(op->body);
+
+        // Codegen may read up to allocation_padding bytes past the end
+        // of heap allocations, so the arena must provide them too.
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        size = select(op->condition, max(size, 0) + 3 * op->type.bytes(), 0);
+        Expr new_expr = Call::make(type_of<void *>(), "halide_arena_malloc",
+                                   {Variable::make(type_of<void *>(), arena), cast<uint64_t>(size)},
+                                   Call::Extern);
+        arena_used = true;
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, body, new_expr, "halide_arena_free");
+    }
+
+public:
+    Stmt inject(const Stmt &s) {
+        return make_scope(s);
+    }
+};
+
+}  // namespace
+
+Stmt inject_arena_allocations(const Stmt &s) {
+    return InjectArenaAllocations().inject(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
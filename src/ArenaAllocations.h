@@ -0,0 +1,24 @@
+#ifndef HALIDE_ARENA_ALLOCATIONS_H
+#define HALIDE_ARENA_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that serves heap allocations from runtime
+ * bump-allocation arenas.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Acquire a runtime arena (see halide_arena_begin) on entry to the
+ * pipeline and to each parallel loop body and fork, and rewrite the
+ * heap allocations directly within each of those scopes to be served
+ * from its arena. Each arena is only ever used by the thread running
+ * the scope that acquired it. */
+Stmt inject_arena_allocations(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -254,32 +254,37 @@ void populate_ops_table_single_uint32_select(const vector<Type> &types, vector<A
     table.emplace_back(select(x0 < -y0, y0, tmax_0), zero_0, true);          // Saturating add
 }
 
-const map<TableKey, void (*)(const vector<Type> &types, vector<AssociativePattern> &)> val_type_to_populate_luts_fn = {
-    {TableKey(ValType::All, RootExpr::Add, 1), &populate_ops_table_single_general_add},
-    {TableKey(ValType::All, RootExpr::Mul, 1), &populate_ops_table_single_general_mul},
-    {TableKey(ValType::All, RootExpr::Max, 1), &populate_ops_table_single_general_max},
-    {TableKey(ValType::All, RootExpr::Min, 1), &populate_ops_table_single_general_min},
-    {TableKey(ValType::All, RootExpr::Sub, 1), &populate_ops_table_single_general_sub},
-    {TableKey(ValType::All, RootExpr::Select, 1), &populate_ops_table_single_general_select},
-    {TableKey(ValType::All, RootExpr::Add, 2), &populate_ops_table_double_general_add},
-    {TableKey(ValType::All, RootExpr::Mul, 2), &populate_ops_table_double_general_mul},
-    {TableKey(ValType::All, RootExpr::Max, 2), &populate_ops_table_double_general_max},
-    {TableKey(ValType::All, RootExpr::Min, 2), &populate_ops_table_double_general_min},
-    {TableKey(ValType::All, RootExpr::Sub, 2), &populate_ops_table_double_general_sub},
-    {TableKey(ValType::All, RootExpr::Select, 2), &populate_ops_table_double_general_select},
-
-    {TableKey(ValType::UInt1, RootExpr::And, 1), &populate_ops_table_single_uint1_and},
-    {TableKey(ValType::UInt1, RootExpr::Or, 1), &populate_ops_table_single_uint1_or},
-
-    {TableKey(ValType::UInt8, RootExpr::Cast, 1), &populate_ops_table_single_uint8_cast},
-    {TableKey(ValType::UInt8, RootExpr::Select, 1), &populate_ops_table_single_uint8_select},
-
-    {TableKey(ValType::UInt16, RootExpr::Cast, 1), &populate_ops_table_single_uint16_cast},
-    {TableKey(ValType::UInt16, RootExpr::Select, 1), &populate_ops_table_single_uint16_select},
-
-    {TableKey(ValType::UInt32, RootExpr::Cast, 1), &populate_ops_table_single_uint32_cast},
-    {TableKey(ValType::UInt32, RootExpr::Select, 1), &populate_ops_table_single_uint32_select},
-};
+typedef void (*PopulateLutsFn)(const vector<Type> &types, vector<AssociativePattern> &);
+
+const map<TableKey, PopulateLutsFn> &val_type_to_populate_luts_fn() {
+    static const map<TableKey, PopulateLutsFn> m = {
+        {TableKey(ValType::All, RootExpr::Add, 1), &populate_ops_table_single_general_add},
+        {TableKey(ValType::All, RootExpr::Mul, 1), &populate_ops_table_single_general_mul},
+        {TableKey(ValType::All, RootExpr::Max, 1), &populate_ops_table_single_general_max},
+        {TableKey(ValType::All, RootExpr::Min, 1), &populate_ops_table_single_general_min},
+        {TableKey(ValType::All, RootExpr::Sub, 1), &populate_ops_table_single_general_sub},
+        {TableKey(ValType::All, RootExpr::Select, 1), &populate_ops_table_single_general_select},
+        {TableKey(ValType::All, RootExpr::Add, 2), &populate_ops_table_double_general_add},
+        {TableKey(ValType::All, RootExpr::Mul, 2), &populate_ops_table_double_general_mul},
+        {TableKey(ValType::All, RootExpr::Max, 2), &populate_ops_table_double_general_max},
+        {TableKey(ValType::All, RootExpr::Min, 2), &populate_ops_table_double_general_min},
+        {TableKey(ValType::All, RootExpr::Sub, 2), &populate_ops_table_double_general_sub},
+        {TableKey(ValType::All, RootExpr::Select, 2), &populate_ops_table_double_general_select},
+
+        {TableKey(ValType::UInt1, RootExpr::And, 1), &populate_ops_table_single_uint1_and},
+        {TableKey(ValType::UInt1, RootExpr::Or, 1), &populate_ops_table_single_uint1_or},
+
+        {TableKey(ValType::UInt8, RootExpr::Cast, 1), &populate_ops_table_single_uint8_cast},
+        {TableKey(ValType::UInt8, RootExpr::Select, 1), &populate_ops_table_single_uint8_select},
+
+        {TableKey(ValType::UInt16, RootExpr::Cast, 1), &populate_ops_table_single_uint16_cast},
+        {TableKey(ValType::UInt16, RootExpr::Select, 1), &populate_ops_table_single_uint16_select},
+
+        {TableKey(ValType::UInt32, RootExpr::Cast, 1), &populate_ops_table_single_uint32_cast},
+        {TableKey(ValType::UInt32, RootExpr::Select, 1), &populate_ops_table_single_uint32_select},
+    };
+    return m;
+}
 
 const vector<AssociativePattern> &get_ops_table_helper(const vector<Type> &types, RootExpr root, size_t dim) {
     TableKey gen_key(ValType::All, root, dim);
@@ -290,14 +295,14 @@ const vector<AssociativePattern> &get_ops_table_helper(const vector<Type> &types
         vector<AssociativePattern> &table = pattern_tables[key];
 
         // Populate the general associative op LUT
-        const auto &gen_iter = val_type_to_populate_luts_fn.find(gen_key);
-        if (gen_iter != val_type_to_populate_luts_fn.end()) {
+        const auto &gen_iter = val_type_to_populate_luts_fn().find(gen_key);
+        if (gen_iter != val_type_to_populate_luts_fn().end()) {
             gen_iter->second(types, table);
         }
 
         // Populate the type-specific associative op LUT
-        const auto &iter = val_type_to_populate_luts_fn.find(key);
-        if (iter != val_type_to_populate_luts_fn.end()) {
+        const auto &iter = val_type_to_populate_luts_fn().find(key);
+        if (iter != val_type_to_populate_luts_fn().end()) {
             iter->second(types, table);
         }
 
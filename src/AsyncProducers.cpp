@@ -4,6 +4,7 @@
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "Simplify.h"
 
 namespace Halide {
 namespace Internal {
@@ -376,6 +377,150 @@ public:
     }
 };
 
+// Give ring-buffered Funcs an extra outermost dimension with one
+// entry per buffer in the ring, and index it with the iteration count
+// of the loops between the Func's store and compute levels, modulo the
+// number of buffers. If the Func is async, a semaphore counts the
+// free buffers: the producer acquires one before producing, and the
+// consumer releases it once it is done with it. The name of the
+// semaphore marks it as a storage-folding semaphore, so that the
+// producer side of the fork keeps the acquire and the consumer side
+// keeps the release.
+class InjectRingBuffering : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+
+    struct RingBuffer {
+        Expr extent;
+        // The index into the loop stack of the first loop inside the
+        // ring buffer's realization.
+        size_t first_loop;
+        // The buffer in the ring used by the current iteration.
+        Expr index;
+    };
+    map<string, RingBuffer> ring_buffers;
+
+    vector<const For *> loops;
+
+    Expr semaphore(const string &func) const {
+        return Variable::make(type_of<halide_semaphore_t *>(), func + ".folding_semaphore.ring_buffer");
+    }
+
+    Stmt visit(const Realize *op) override {
+        auto it = env.find(op->name);
+        if (it == env.end() || !it->second.schedule().ring_buffer().defined()) {
+            return IRMutator::visit(op);
+        }
+        const Function &f = it->second;
+        for (const StorageDim &dim : f.schedule().storage_dims()) {
+            user_assert(!dim.fold_factor.defined())
+                << "Func " << f.name() << " can't both fold its storage and use a ring buffer\n";
+        }
+
+        Expr extent = f.schedule().ring_buffer();
+        ring_buffers[op->name] = {extent, loops.size(), Expr()};
+        Stmt body = mutate(op->body);
+        ring_buffers.erase(op->name);
+
+        Region bounds = op->bounds;
+        bounds.emplace_back(0, extent);
+        Stmt stmt = Realize::make(op->name, op->types, op->memory_type,
+                                  bounds, op->condition, body);
+        if (f.schedule().async()) {
+            // Every buffer in the ring starts out free.
+            Expr sema_space = Call::make(type_of<halide_semaphore_t *>(), "halide_make_semaphore",
+                                         {extent}, Call::Extern);
+            stmt = LetStmt::make(op->name + ".folding_semaphore.ring_buffer", sema_space, stmt);
+        }
+        return stmt;
+    }
+
+    Stmt visit(const For *op) override {
+        loops.push_back(op);
+        Stmt stmt = IRMutator::visit(op);
+        loops.pop_back();
+        return stmt;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        auto it = ring_buffers.find(op->name);
+        if (it == ring_buffers.end()) {
+            return IRMutator::visit(op);
+        }
+        RingBuffer &ring = it->second;
+
+        // Count the iterations of the enclosing loops, reducing modulo
+        // the ring size as we go so that the count can't overflow.
+        Expr index = 0;
+        for (size_t i = ring.first_loop; i < loops.size(); i++) {
+            const For *loop = loops[i];
+            user_assert(loop->for_type == ForType::Serial || loop->for_type == ForType::Unrolled)
+                << "Func " << op->name << " uses a ring buffer, so the loop " << loop->name
+                << " between its store and compute levels must be serial\n";
+            Expr iteration = Variable::make(Int(32), loop->name) - loop->min;
+            index = (index * loop->extent + iteration) % ring.extent;
+        }
+        index = simplify(index);
+
+        Expr old_index = ring.index;
+        ring.index = index;
+        Stmt body = mutate(op->body);
+        ring.index = old_index;
+
+        bool async = env.find(op->name)->second.schedule().async();
+        if (op->is_producer) {
+            Stmt stmt = ProducerConsumer::make_produce(op->name, body);
+            if (async) {
+                stmt = Acquire::make(semaphore(op->name), 1, stmt);
+            }
+            return stmt;
+        } else {
+            if (async) {
+                Expr release = Call::make(Int(32), "halide_semaphore_release", {semaphore(op->name), 1}, Call::Extern);
+                body = Block::make(body, Evaluate::make(release));
+            }
+            return ProducerConsumer::make_consume(op->name, body);
+        }
+    }
+
+    Stmt visit(const Provide *op) override {
+        auto it = ring_buffers.find(op->name);
+        if (it == ring_buffers.end() || !it->second.index.defined()) {
+            return IRMutator::visit(op);
+        }
+        Expr index = it->second.index;
+        Stmt stmt = IRMutator::visit(op);
+        op = stmt.as<Provide>();
+        internal_assert(op);
+        vector<Expr> args = op->args;
+        args.push_back(index);
+        return Provide::make(op->name, op->values, args, op->predicate);
+    }
+
+    Expr visit(const Call *op) override {
+        auto it = ring_buffers.find(op->name);
+        if (op->call_type != Call::Halide || it == ring_buffers.end()) {
+            return IRMutator::visit(op);
+        }
+        internal_assert(it->second.index.defined())
+            << "Use of ring-buffered " << op->name << " outside of its produce and consume nodes\n";
+        Expr index = it->second.index;
+        Expr expr = IRMutator::visit(op);
+        op = expr.as<Call>();
+        internal_assert(op);
+        vector<Expr> args = op->args;
+        args.push_back(index);
+        return Call::make(op->type, op->name, args, op->call_type,
+                          op->func, op->value_index, op->image, op->param);
+    }
+
+public:
+    InjectRingBuffering(const map<string, Function> &e)
+        : env(e) {
+    }
+};
+
 // Lowers semaphore initialization from a call to
 // "halide_make_semaphore" to an alloca followed by a call into the
 // runtime to initialize. If something crashes before releasing a
@@ -706,6 +851,7 @@ class TightenForkNodes : public IRMutator {
 }  // namespace
 
 Stmt fork_async_producers(Stmt s, const map<string, Function> &env) {
+    s = InjectRingBuffering(env).mutate(s);
     s = TightenProducerConsumerNodes(env).mutate(s);
     s = ForkAsyncProducers(env).mutate(s);
     s = ExpandAcquireNodes().mutate(s);
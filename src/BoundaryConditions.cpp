@@ -208,6 +208,25 @@ Func mirror_interior(const Func &source,
     return bounded;
 }
 
+Func padded_tile(const Func &bounded, const LoopLevel &tile, int vector_width) {
+    user_assert(bounded.defined())
+        << "padded_tile called with undefined Func " << bounded.name() << ".\n";
+    user_assert(vector_width >= 1)
+        << "padded_tile called with vector width " << vector_width
+        << " for Func " << bounded.name() << ", which must be at least one.\n";
+
+    // Funcs are handles, so wrapping a copy wraps bounded itself.
+    Func padded = Func(bounded).in();
+    padded.compute_at(tile);
+    if (vector_width > 1) {
+        // The boundary condition is defined everywhere, so it's safe to
+        // copy past the end of the region the consumers need.
+        padded.vectorize(padded.args()[0], vector_width, TailStrategy::RoundUp);
+    }
+
+    return padded;
+}
+
 }  // namespace BoundaryConditions
 
 }  // namespace Halide
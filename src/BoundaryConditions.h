@@ -266,6 +266,24 @@ HALIDE_NO_USER_CODE_INLINE Func mirror_interior(const T &func_like) {
 
 // @}
 
+/** Materialize a boundary condition once per tile of its consumers,
+ *  rather than evaluating it on every load. This returns a wrapper of
+ *  the Func produced by one of the functions above (see Func::in), which
+ *  replaces all uses of it, computed at the given loop level. Each tile
+ *  then starts by copying the region of \p bounded it needs, border
+ *  included, into a padded scratch buffer, and all of the consumers'
+ *  loads from it are unconditional. Only the copy has clamps or selects
+ *  left in it, and loop partitioning splits those off reliably, as the
+ *  copy is a single loop nest with nothing else in it. Tiles computed in
+ *  parallel make their copies in parallel.
+ *
+ *  If \p vector_width is greater than one, the copy is vectorized by it
+ *  across the innermost dimension, rounding the scratch buffer up to a
+ *  whole number of vectors. The result can be scheduled further like any
+ *  other Func.
+ */
+Func padded_tile(const Func &bounded, const LoopLevel &tile, int vector_width = 1);
+
 }  // namespace BoundaryConditions
 
 }  // namespace Halide
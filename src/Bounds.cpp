@@ -2917,10 +2917,8 @@ private:
     }
 };
 
-}  // namespace
-
-map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
-                               const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+map<string, Box> compute_boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
+                                       const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
     if (!fn.empty() && s.defined()) {
         // Filter things down to the relevant sub-Stmts, so we don't spend a
         // long time reasoning about lets and ifs that don't surround an
@@ -3101,6 +3099,118 @@ map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool
     return calls.boxes;
 }
 
+thread_local BoxesTouchedCache::Contents *active_boxes_touched_cache = nullptr;
+
+}  // namespace
+
+struct BoxesTouchedCache::Contents {
+    struct Entry {
+        // References to the queried nodes, so that their addresses
+        // can't be reused while the cache is alive.
+        Expr e;
+        Stmt s;
+        bool consider_calls, consider_provides;
+        string fn;
+        size_t func_bounds_index;
+        // Everything visible in the scope, innermost first.
+        vector<pair<string, Interval>> scope;
+        map<string, Box> result;
+    };
+
+    map<pair<const IRNode *, const IRNode *>, vector<Entry>> entries;
+
+    // The distinct FuncValueBounds queried with so far.
+    vector<FuncValueBounds> func_bounds;
+
+    Contents *previous = nullptr;
+
+    size_t hits = 0, misses = 0;
+
+    static bool same_interval(const Interval &a, const Interval &b) {
+        return a.min.same_as(b.min) && a.max.same_as(b.max);
+    }
+
+    size_t func_bounds_index(const FuncValueBounds &fb) {
+        for (size_t i = 0; i < func_bounds.size(); i++) {
+            const FuncValueBounds &other = func_bounds[i];
+            if (other.size() == fb.size() &&
+                std::equal(fb.begin(), fb.end(), other.begin(),
+                           [](const auto &a, const auto &b) {
+                               return a.first == b.first && same_interval(a.second, b.second);
+                           })) {
+                return i;
+            }
+        }
+        func_bounds.push_back(fb);
+        return func_bounds.size() - 1;
+    }
+
+    static bool scope_matches(const Scope<Interval> &scope, const vector<pair<string, Interval>> &snapshot) {
+        size_t i = 0;
+        for (const Scope<Interval> *s = &scope; s; s = s->get_containing_scope()) {
+            for (auto iter = s->cbegin(); iter != s->cend(); ++iter, ++i) {
+                if (i >= snapshot.size() ||
+                    iter.name() != snapshot[i].first ||
+                    !same_interval(iter.value(), snapshot[i].second)) {
+                    return false;
+                }
+            }
+        }
+        return i == snapshot.size();
+    }
+
+    static vector<pair<string, Interval>> snapshot_scope(const Scope<Interval> &scope) {
+        vector<pair<string, Interval>> snapshot;
+        for (const Scope<Interval> *s = &scope; s; s = s->get_containing_scope()) {
+            for (auto iter = s->cbegin(); iter != s->cend(); ++iter) {
+                snapshot.emplace_back(iter.name(), iter.value());
+            }
+        }
+        return snapshot;
+    }
+
+    map<string, Box> boxes_touched(const Expr &e, const Stmt &s, bool consider_calls, bool consider_provides,
+                                   const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+        size_t fb_index = func_bounds_index(fb);
+        vector<Entry> &candidates = entries[{e.get(), s.get()}];
+        for (const Entry &entry : candidates) {
+            if (entry.consider_calls == consider_calls &&
+                entry.consider_provides == consider_provides &&
+                entry.fn == fn &&
+                entry.func_bounds_index == fb_index &&
+                scope_matches(scope, entry.scope)) {
+                hits++;
+                return entry.result;
+            }
+        }
+        misses++;
+        map<string, Box> result = compute_boxes_touched(e, s, consider_calls, consider_provides, fn, scope, fb);
+        candidates.push_back({e, s, consider_calls, consider_provides, fn, fb_index, snapshot_scope(scope), result});
+        return result;
+    }
+};
+
+BoxesTouchedCache::BoxesTouchedCache()
+    : contents(std::make_unique<Contents>()) {
+    contents->previous = active_boxes_touched_cache;
+    active_boxes_touched_cache = contents.get();
+}
+
+BoxesTouchedCache::~BoxesTouchedCache() {
+    // These are scoped objects, so they are destroyed in the reverse
+    // order of their creation, even when lowering throws.
+    debug(2) << "boxes_touched cache: " << contents->hits << " hits, " << contents->misses << " misses\n";
+    active_boxes_touched_cache = contents->previous;
+}
+
+map<string, Box> boxes_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
+                               const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
+    if (active_boxes_touched_cache) {
+        return active_boxes_touched_cache->boxes_touched(e, s, consider_calls, consider_provides, fn, scope, fb);
+    }
+    return compute_boxes_touched(e, std::move(s), consider_calls, consider_provides, fn, scope, fb);
+}
+
 Box box_touched(const Expr &e, Stmt s, bool consider_calls, bool consider_provides,
                 const string &fn, const Scope<Interval> &scope, const FuncValueBounds &fb) {
     map<string, Box> boxes = boxes_touched(e, std::move(s), consider_calls, consider_provides, fn, scope, fb);
@@ -3416,6 +3526,26 @@ void boxes_touched_test() {
                            << "Should have been: " << correct.max << "\n";
         }
     }
+
+    {
+        BoxesTouchedCache cache;
+        Box first = box_provided(stmt, "f", scope);
+        Box second = box_provided(stmt, "f", scope);
+        internal_assert(first.size() == result.size() && second.size() == result.size());
+        for (size_t i = 0; i < result.size(); ++i) {
+            internal_assert(equal(simplify(first[i].min), expected[i].min) &&
+                            equal(simplify(first[i].max), expected[i].max));
+            internal_assert(second[i].min.same_as(first[i].min) && second[i].max.same_as(first[i].max))
+                << "Querying the same Stmt again didn't reuse the cached box\n";
+        }
+
+        // A different scope must not see the cached result.
+        scope.push("y", Interval(Expr(0), Expr(20)));
+        Box wider = box_provided(stmt, "f", scope);
+        scope.pop("y");
+        internal_assert(equal(simplify(wider[1].max), Expr(20)))
+            << "Cached box was reused for a different scope\n";
+    }
 }
 
 }  // anonymous namespace
@@ -6,6 +6,8 @@
  * and the regions of a function read or written by a statement.
  */
 
+#include <memory>
+
 #include "Interval.h"
 #include "Scope.h"
 
@@ -166,6 +168,28 @@ Box box_touched(Stmt s, const std::string &fn,
                 const FuncValueBounds &func_bounds = empty_func_value_bounds());
 // @}
 
+/** While an object of this type is alive, the boxes_required,
+ * boxes_provided and boxes_touched functions above (and their
+ * single-function variants) called on the same thread remember their
+ * results, and reuse them when called again on the same IR nodes with
+ * the same arguments, scope, and function value bounds. IR nodes are
+ * immutable, so a pass that mutates a subtree produces new nodes,
+ * which are computed afresh. Lowering keeps one of these alive for its
+ * whole duration, as many passes query the same Stmts. */
+class BoxesTouchedCache {
+public:
+    BoxesTouchedCache();
+    ~BoxesTouchedCache();
+
+    BoxesTouchedCache(const BoxesTouchedCache &) = delete;
+    BoxesTouchedCache &operator=(const BoxesTouchedCache &) = delete;
+
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+};
+
 /** Compute the maximum and minimum possible value for each function
  * in an environment. */
 FuncValueBounds compute_function_value_bounds(const std::vector<std::string> &order,
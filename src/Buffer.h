@@ -470,6 +470,7 @@ public:
     HALIDE_BUFFER_FORWARD(device_malloc)
     HALIDE_BUFFER_FORWARD(device_wrap_native)
     HALIDE_BUFFER_FORWARD(device_detach_native)
+    HALIDE_BUFFER_FORWARD(adopt_host_memory)
     HALIDE_BUFFER_FORWARD(allocate)
     HALIDE_BUFFER_FORWARD(deallocate)
     HALIDE_BUFFER_FORWARD(device_deallocate)
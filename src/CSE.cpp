@@ -1,6 +1,8 @@
 #include <map>
+#include <unordered_map>
 
 #include "CSE.h"
+#include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -68,6 +70,101 @@ bool should_extract(const Expr &e, bool lift_all) {
     return true;
 }
 
+// Hash and compare Exprs by identity.
+struct ExprNodeHash {
+    size_t operator()(const Expr &e) const {
+        return std::hash<const void *>()(e.get());
+    }
+};
+
+struct ExprNodeEqual {
+    bool operator()(const Expr &a, const Expr &b) const {
+        return a.same_as(b);
+    }
+};
+
+// Hash an Expr by its node type, type and fields, and the identities
+// of its children. Within a global value numbering equal children are
+// the same node, so Exprs with equal hashes are usually equal, and
+// checking that they are only needs to compare their top nodes.
+class ShallowHash : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void mix(uint64_t v) {
+        h = (h ^ v) * 0x100000001b3ULL;
+    }
+
+    void mix(const string &str) {
+        mix(std::hash<string>()(str));
+    }
+
+    void include(const Expr &e) override {
+        mix((uint64_t)(uintptr_t)e.get());
+    }
+
+    void visit(const IntImm *op) override {
+        mix((uint64_t)op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        uint64_t bits;
+        memcpy(&bits, &op->value, sizeof(bits));
+        mix(bits);
+    }
+
+    void visit(const StringImm *op) override {
+        mix(op->value);
+    }
+
+    void visit(const Variable *op) override {
+        mix(op->name);
+    }
+
+    void visit(const Let *op) override {
+        mix(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        mix(op->name);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        mix(op->name);
+        mix((uint64_t)op->call_type);
+        mix((uint64_t)op->value_index);
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const Shuffle *op) override {
+        for (int i : op->indices) {
+            mix((uint64_t)i);
+        }
+        IRGraphVisitor::visit(op);
+    }
+
+    void visit(const VectorReduce *op) override {
+        mix((uint64_t)op->op);
+        IRGraphVisitor::visit(op);
+    }
+
+public:
+    uint64_t h = 0xcbf29ce484222325ULL;
+
+    uint64_t hash(const Expr &e) {
+        h = 0xcbf29ce484222325ULL;
+        mix((uint64_t)e->node_type);
+        mix((uint64_t)e.type().code() | ((uint64_t)e.type().bits() << 8) | ((uint64_t)e.type().lanes() << 16));
+        e.accept(this);
+        return h;
+    }
+};
+
 // A global-value-numbering of expressions. Returns canonical form of
 // the Expr and writes out a global value numbering as a side-effect.
 class GVN : public IRMutator {
@@ -75,23 +172,23 @@ public:
     struct Entry {
         Expr expr;
         int use_count = 0;
-        // All consumer Exprs for which this is the last child Expr.
-        map<ExprWithCompareCache, int> uses;
         Entry(const Expr &e)
             : expr(e) {
         }
     };
     vector<std::unique_ptr<Entry>> entries;
 
-    map<Expr, int, ExprCompare> shallow_numbering, output_numbering;
-    map<ExprWithCompareCache, int> leaves;
+    std::unordered_map<Expr, int, ExprNodeHash, ExprNodeEqual> shallow_numbering, output_numbering;
+
+    // The entries, by the ShallowHash of their Exprs.
+    std::unordered_multimap<uint64_t, int> numbering;
 
     int number = -1;
 
-    IRCompareCache cache;
+    ShallowHash hasher;
 
     GVN()
-        : number(0), cache(8) {
+        : number(0) {
     }
 
     Stmt mutate(const Stmt &s) override {
@@ -99,10 +196,6 @@ public:
         return Stmt();
     }
 
-    ExprWithCompareCache with_cache(const Expr &e) {
-        return ExprWithCompareCache(e, &cache);
-    }
-
     Expr mutate(const Expr &e) override {
         // Early out if we've already seen this exact Expr.
         {
@@ -114,26 +207,25 @@ public:
         }
 
         // We haven't seen this exact Expr before. Rebuild it using
-        // things already in the numbering.
-        number = -1;
+        // things already in the numbering, and then see if there's
+        // an equal Expr in the numbering.
         Expr new_e = IRMutator::mutate(e);
 
-        // 'number' is now set to the numbering for the last child of
-        // this Expr (or -1 if there are no children). Next we see if
-        // that child has an identical parent to this one.
-
-        auto &use_map = number == -1 ? leaves : entries[number]->uses;
-        auto p = use_map.emplace(with_cache(new_e), (int)entries.size());
-        auto iter = p.first;
-        bool novel = p.second;
-        if (novel) {
+        uint64_t h = hasher.hash(new_e);
+        number = -1;
+        auto range = numbering.equal_range(h);
+        for (auto it = range.first; it != range.second; it++) {
+            if (equal(entries[it->second]->expr, new_e)) {
+                number = it->second;
+                break;
+            }
+        }
+        if (number == -1) {
             // This is a never-before-seen Expr
             number = (int)entries.size();
-            iter->second = number;
+            numbering.emplace(h, number);
             entries.emplace_back(new Entry(new_e));
         } else {
-            // This child already has a syntactically-equal parent
-            number = iter->second;
             new_e = entries[number]->expr;
         }
 
@@ -170,14 +262,13 @@ public:
 
         // Find this thing's number.
         auto iter = gvn.output_numbering.find(e);
-        if (iter != gvn.output_numbering.end()) {
-            gvn.entries[iter->second]->use_count++;
-        } else {
-            internal_error << "Expr not in shallow numbering: " << e << "\n";
-        }
+        internal_assert(iter != gvn.output_numbering.end())
+            << "Expr not in shallow numbering: " << e << "\n";
 
         // Visit the children if we haven't been here before.
-        IRGraphVisitor::include(e);
+        if (gvn.entries[iter->second]->use_count++ == 0) {
+            e.accept(this);
+        }
     }
 };
 
@@ -267,6 +358,139 @@ public:
     }
 };
 
+// Collect the names of the variables an Expr refers to.
+class CollectVars : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Variable *op) override {
+        names.push_back(op->name);
+    }
+
+public:
+    vector<string> names;
+};
+
+// Replace Exprs equal to the value of an enclosing Let or LetStmt with
+// a reference to it.
+class ReuseLetValues : public IRMutator {
+    using IRMutator::visit;
+
+    map<Expr, string, IRDeepCompare> available;
+
+    // The number of available values that refer to each name, either
+    // in the value or as the name it is bound to. A new binding of a
+    // name that isn't in here can't change the meaning of any of them.
+    map<string, int> names_used;
+
+    void count_names(const Expr &value, const string &name, int delta) {
+        CollectVars vars;
+        value.accept(&vars);
+        vars.names.push_back(name);
+        for (const string &n : vars.names) {
+            int &count = names_used[n];
+            count += delta;
+            if (count == 0) {
+                names_used.erase(n);
+            }
+        }
+    }
+
+    void make_available(const Expr &value, const string &name) {
+        available.emplace(value, name);
+        count_names(value, name, 1);
+    }
+
+    void make_unavailable(const Expr &value) {
+        auto it = available.find(value);
+        count_names(it->first, it->second, -1);
+        available.erase(it);
+    }
+
+    // Hide the available values that a new binding of the given name
+    // would change the meaning of, and return them so that they can be
+    // restored when the binding goes out of scope.
+    vector<pair<Expr, string>> hide(const string &name) {
+        vector<pair<Expr, string>> hidden;
+        if (!names_used.count(name)) {
+            return hidden;
+        }
+        for (const auto &it : available) {
+            if (it.second == name || expr_uses_var(it.first, name)) {
+                hidden.emplace_back(it.first, it.second);
+            }
+        }
+        for (const auto &it : hidden) {
+            make_unavailable(it.first);
+        }
+        return hidden;
+    }
+
+    void restore(const vector<pair<Expr, string>> &hidden) {
+        for (const auto &it : hidden) {
+            make_available(it.first, it.second);
+        }
+    }
+
+    template<typename LetOrLetStmt, typename Body>
+    Body visit_let(const LetOrLetStmt *op) {
+        Expr value = mutate(op->value);
+        auto hidden = hide(op->name);
+        bool added = (should_extract(value, false) && is_pure(value) && !available.count(value));
+        if (added) {
+            make_available(value, op->name);
+        }
+        Body body = mutate(op->body);
+        if (added) {
+            make_unavailable(value);
+        }
+        restore(hidden);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetOrLetStmt::make(op->name, value, body);
+    }
+
+    Expr visit(const Let *op) override {
+        return visit_let<Let, Expr>(op);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        return visit_let<LetStmt, Stmt>(op);
+    }
+
+    Stmt visit(const For *op) override {
+        Expr min = mutate(op->min);
+        Expr extent = mutate(op->extent);
+        auto hidden = hide(op->name);
+        Stmt body = mutate(op->body);
+        restore(hidden);
+        if (min.same_as(op->min) && extent.same_as(op->extent) && body.same_as(op->body)) {
+            return op;
+        }
+        return For::make(op->name, min, extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        auto hidden = hide(op->name);
+        Stmt s = IRMutator::visit(op);
+        restore(hidden);
+        return s;
+    }
+
+public:
+    using IRMutator::mutate;
+
+    Expr mutate(const Expr &e) override {
+        if (!available.empty() && should_extract(e, false)) {
+            auto it = available.find(e);
+            if (it != available.end()) {
+                return Variable::make(e.type(), it->second);
+            }
+        }
+        return IRMutator::mutate(e);
+    }
+};
+
 }  // namespace
 
 Expr common_subexpression_elimination(const Expr &e_in, bool lift_all) {
@@ -331,6 +555,10 @@ Stmt common_subexpression_elimination(const Stmt &s, bool lift_all) {
     return CSEEveryExprInStmt(lift_all).mutate(s);
 }
 
+Stmt global_value_numbering(const Stmt &s) {
+    return ReuseLetValues().mutate(s);
+}
+
 // Testing code.
 
 namespace {
@@ -505,6 +733,23 @@ void cse_test() {
         check(e, correct);
     }
 
+    {
+        // Values of enclosing lets are reused, but not across a new
+        // binding of a name they depend on.
+        Expr a = Variable::make(Int(32), "a");
+        Stmt inner = Evaluate::make(x * y + 1);
+        Stmt in = LetStmt::make("a", x * y, Block::make(inner, For::make("x", 0, 10, ForType::Serial, DeviceAPI::None, inner)));
+        Stmt correct = LetStmt::make("a", x * y, Block::make(Evaluate::make(a + 1), For::make("x", 0, 10, ForType::Serial, DeviceAPI::None, inner)));
+        Stmt result = global_value_numbering(in);
+        internal_assert(equal(result, correct))
+            << "Incorrect GVN:\n"
+            << in
+            << "\nbecame:\n"
+            << result
+            << "\ninstead of:\n"
+            << correct << "\n";
+    }
+
     debug(0) << "common_subexpression_elimination test passed\n";
 }
 
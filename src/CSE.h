@@ -29,6 +29,14 @@ Expr common_subexpression_elimination(const Expr &, bool lift_all = false);
  * statement. Does not introduce let statements. */
 Stmt common_subexpression_elimination(const Stmt &, bool lift_all = false);
 
+/** Replace each expression in a statement that is equal to the value
+ * of an enclosing Let or LetStmt with a reference to it. Unlike
+ * common_subexpression_elimination on a Stmt, which looks at each
+ * expression in isolation, this removes redundancies across Let
+ * scopes. Only pure values are reused, and not across new bindings of
+ * the names they depend on. */
+Stmt global_value_numbering(const Stmt &);
+
 void cse_test();
 
 }  // namespace Internal
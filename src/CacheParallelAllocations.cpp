@@ -0,0 +1,103 @@
+#include "CacheParallelAllocations.h"
+#include "CodeGen_Internal.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+using std::string;
+
+class CacheParallelAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    // The slot acquired by the innermost enclosing parallel loop body,
+    // and the number of buffers allocated from it so far.
+    string slot;
+    int num_buffers = 0;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Device code manages its own memory.
+            return op;
+        }
+        if (op->for_type != ForType::Parallel &&
+            op->for_type != ForType::MultiGPU) {
+            return IRMutator::visit(op);
+        }
+
+        string cache = unique_name("parallel_cache");
+        ScopedValue<string> old_slot(slot, unique_name("cache_slot"));
+        ScopedValue<int> old_num_buffers(num_buffers, 0);
+        Stmt body = mutate(op->body);
+        if (num_buffers == 0) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+
+        Expr cache_var = Variable::make(type_of<void *>(), cache);
+        Expr slot_var = Variable::make(type_of<void *>(), slot);
+        Expr acquire = Call::make(type_of<void *>(), "halide_parallel_cache_acquire",
+                                  {cache_var}, Call::Extern);
+        Expr release = Call::make(Int(32), "halide_parallel_cache_release",
+                                  {cache_var, slot_var}, Call::Extern);
+        body = Block::make(body, Evaluate::make(release));
+        body = LetStmt::make(slot, acquire, body);
+
+        Stmt loop = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        Expr create = Call::make(type_of<void *>(), "halide_parallel_cache_create",
+                                 {num_buffers}, Call::Extern);
+        return Allocate::make(cache, Handle(), MemoryType::Stack, {}, const_true(),
+                              loop, create, "halide_parallel_cache_destroy");
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (slot.empty() ||
+            op->new_expr.defined() ||
+            !op->free_function.empty() ||
+            op->extents.empty() ||
+            (op->memory_type != MemoryType::Heap &&
+             op->memory_type != MemoryType::Auto)) {
+            return IRMutator::visit(op);
+        }
+        int64_t constant_size = op->constant_allocation_size();
+        if (op->memory_type == MemoryType::Auto &&
+            constant_size > 0 &&
+            can_allocation_fit_on_stack(constant_size * op->type.bytes())) {
+            // This will go on the stack.
+            return IRMutator::visit(op);
+        }
+
+        int index = num_buffers++;
+        Stmt body = mutate(op->body);
+
+        // Codegen may read up to allocation_padding bytes past the end
+        // of heap allocations, so the cached buffer must provide them
+        // too.
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        size = select(op->condition, max(size, 0) + 3 * op->type.bytes(), 0);
+        Expr new_expr = Call::make(type_of<void *>(), "halide_parallel_cache_get",
+                                   {Variable::make(type_of<void *>(), slot), index, cast<uint64_t>(size)},
+                                   Call::Extern);
+        // The cache owns the buffer.
+        return Allocate::make(op->name, op->type, op->memory_type, op->extents,
+                              op->condition, body, new_expr, "halide_device_host_nop_free");
+    }
+};
+
+}  // namespace
+
+Stmt cache_parallel_allocations(const Stmt &s) {
+    return CacheParallelAllocations().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,27 @@
+#ifndef HALIDE_CACHE_PARALLEL_ALLOCATIONS_H
+#define HALIDE_CACHE_PARALLEL_ALLOCATIONS_H
+
+/** \file
+ * Defines the lowering pass that reuses the heap allocations of
+ * parallel loop bodies across the iterations each worker runs.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Rewrite the heap allocations inside each parallel loop body to come
+ * from a cache created just before the loop and destroyed just after
+ * it (see halide_parallel_cache_create). Each iteration acquires one
+ * of the cache's slots on entry and releases it on exit, so each slot
+ * is used by one worker at a time, and a slot's buffers grow to the
+ * largest footprint of any iteration that used it. This replaces a
+ * malloc/free pair per allocation per iteration with roughly one per
+ * worker per loop. */
+Stmt cache_parallel_allocations(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,253 @@
+#include "ChooseStorageLayouts.h"
+
+#include <set>
+
+#include "ExprUsesVar.h"
+#include "ExternFuncArgument.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the variable that a definition's vectorized loop walks along, by
+// undoing the splits, fuses and renames that made the loop. Sets lanes
+// to the vector width if it is a known constant, and zero
+// otherwise. Returns an empty string if the definition isn't
+// vectorized, or if the vector lanes don't walk along a single
+// variable with unit stride.
+string vectorized_var(const Definition &def, int &lanes) {
+    const StageSchedule &sched = def.schedule();
+    string var;
+    lanes = 0;
+    for (const Dim &d : sched.dims()) {
+        if (d.for_type == ForType::Vectorized) {
+            var = d.var;
+            break;
+        }
+    }
+    if (var.empty()) {
+        return var;
+    }
+
+    bool first_split = true;
+    const vector<Split> &splits = sched.splits();
+    for (auto it = splits.rbegin(); it != splits.rend(); it++) {
+        if (it->is_split()) {
+            if (var == it->inner) {
+                if (first_split) {
+                    const int64_t *factor = as_const_int(it->factor);
+                    lanes = factor ? (int)*factor : 0;
+                }
+                var = it->old_var;
+            } else if (var == it->outer) {
+                return "";
+            }
+            first_split = false;
+        } else if (it->is_fuse()) {
+            if (var == it->old_var) {
+                var = it->inner;
+            }
+            first_split = false;
+        } else if (var == it->outer) {
+            // A rename, or an RVar made pure.
+            var = it->old_var;
+        }
+    }
+    return var;
+}
+
+bool has_gpu_loops(const Definition &def) {
+    for (const Dim &d : def.schedule().dims()) {
+        if (d.for_type == ForType::GPUBlock ||
+            d.for_type == ForType::GPUThread ||
+            d.for_type == ForType::GPULane) {
+            return true;
+        }
+    }
+    return false;
+}
+
+class FindCalls : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide) {
+            calls.push_back(op);
+        }
+    }
+
+public:
+    vector<const Call *> calls;
+};
+
+// The dimensions of a Func that the loops storing or loading it
+// vectorize across.
+struct DenseDims {
+    std::set<int> dims;
+    // The widest known vector width of those loops.
+    int lanes = 0;
+    // Set if some access to the Func has a pattern we don't know to
+    // be vectorized along a single dimension.
+    bool unknown = false;
+};
+
+class FindDenseDims {
+    // Note that the Func with the given args is accessed in a loop
+    // vectorized along var.
+    void access(const string &func, const vector<Expr> &args, const string &var, int lanes) {
+        if (var.empty()) {
+            return;
+        }
+        int dim = -1;
+        for (size_t i = 0; i < args.size(); i++) {
+            if (expr_uses_var(args[i], var)) {
+                if (dim != -1) {
+                    result[func].unknown = true;
+                    return;
+                }
+                dim = (int)i;
+            }
+        }
+        if (dim != -1) {
+            DenseDims &d = result[func];
+            d.dims.insert(dim);
+            d.lanes = std::max(d.lanes, lanes);
+        }
+    }
+
+public:
+    map<string, DenseDims> result;
+
+    void visit_definition(const Function &f, const Definition &def) {
+        int lanes;
+        string var = vectorized_var(def, lanes);
+        // Inlined Funcs are vectorized by the loops of their callers,
+        // which we don't follow.
+        bool opaque = has_gpu_loops(def) || f.schedule().compute_level().is_inlined();
+        if (opaque) {
+            result[f.name()].unknown = true;
+        } else {
+            access(f.name(), def.args(), var, lanes);
+        }
+
+        FindCalls finder;
+        for (const Expr &e : def.args()) {
+            e.accept(&finder);
+        }
+        for (const Expr &e : def.values()) {
+            e.accept(&finder);
+        }
+        if (def.predicate().defined()) {
+            def.predicate().accept(&finder);
+        }
+        for (const Call *call : finder.calls) {
+            if (opaque) {
+                result[call->name].unknown = true;
+            } else {
+                access(call->name, call->args, var, lanes);
+            }
+        }
+
+        for (const Specialization &s : def.specializations()) {
+            visit_definition(f, s.definition);
+        }
+    }
+
+    void visit_function(const Function &f) {
+        if (f.has_extern_definition()) {
+            // Extern stages see the buffers of their inputs.
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    result[Function(arg.func).name()].unknown = true;
+                }
+            }
+            return;
+        }
+        if (f.has_pure_definition()) {
+            visit_definition(f, f.definition());
+        }
+        for (const Definition &def : f.updates()) {
+            visit_definition(f, def);
+        }
+    }
+};
+
+bool has_default_storage(const Function &f) {
+    const vector<StorageDim> &storage = f.schedule().storage_dims();
+    if (storage.size() != f.args().size()) {
+        return false;
+    }
+    for (size_t i = 0; i < storage.size(); i++) {
+        if (storage[i].var != f.args()[i] ||
+            storage[i].alignment.defined() ||
+            storage[i].bound.defined() ||
+            storage[i].fold_factor.defined() ||
+            storage[i].pad_stride) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+void choose_storage_layouts(map<string, Function> &env, const vector<Function> &outputs) {
+    FindDenseDims finder;
+    for (const auto &it : env) {
+        finder.visit_function(it.second);
+    }
+
+    std::set<string> output_names;
+    for (const Function &f : outputs) {
+        output_names.insert(f.name());
+    }
+
+    for (auto &it : env) {
+        Function &f = it.second;
+        auto dense = finder.result.find(f.name());
+        if (dense == finder.result.end() ||
+            dense->second.unknown ||
+            dense->second.dims.size() != 1 ||
+            output_names.count(f.name()) ||
+            f.has_extern_definition() ||
+            f.dimensions() < 2 ||
+            f.schedule().compute_level().is_inlined() ||
+            !has_default_storage(f)) {
+            continue;
+        }
+        MemoryType memory_type = f.schedule().memory_type();
+        if (memory_type != MemoryType::Auto &&
+            memory_type != MemoryType::Heap &&
+            memory_type != MemoryType::Stack) {
+            continue;
+        }
+
+        int dim = *dense->second.dims.begin();
+        if (dim == 0) {
+            // Already dense.
+            continue;
+        }
+
+        vector<StorageDim> &storage = f.schedule().storage_dims();
+        StorageDim innermost = storage[dim];
+        storage.erase(storage.begin() + dim);
+        storage.insert(storage.begin(), innermost);
+        if (dense->second.lanes > 1) {
+            storage[0].alignment = dense->second.lanes;
+        }
+        debug(2) << "Storing " << f.name() << " with " << innermost.var
+                 << " innermost, as all accesses are vectorized across it\n";
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
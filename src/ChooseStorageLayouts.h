@@ -0,0 +1,35 @@
+#ifndef HALIDE_CHOOSE_STORAGE_LAYOUTS_H
+#define HALIDE_CHOOSE_STORAGE_LAYOUTS_H
+
+/** \file
+ * Defines the pass that picks the storage order of intermediate Funcs
+ * from the way they are vectorized.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** For each intermediate Func with the default storage order, find
+ * the dimension its producer and consumers vectorize across. If they
+ * all agree on a dimension that isn't the innermost one in storage,
+ * e.g. an interleaved intermediate that is read and written a plane
+ * at a time, make it innermost so that the vector loads and stores
+ * are dense instead of shuffles of strided accesses, and pad it out to
+ * a multiple of the vector width. Funcs with an explicit
+ * reorder_storage, align_storage, pad_storage, bound_storage or
+ * fold_storage are left alone, as are Funcs whose buffers are visible
+ * outside of Halide's loops, such as outputs and inputs of extern
+ * stages. */
+void choose_storage_layouts(std::map<std::string, Function> &env,
+                            const std::vector<Function> &outputs);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -77,6 +77,10 @@ protected:
     string mattrs() const override;
     bool use_soft_float_abi() const override;
     int native_vector_bits() const override;
+    std::pair<int, int> target_vscale_range() const override;
+    bool use_native_gather(const Type &t) const override;
+    bool use_native_scatter(const Type &t) const override;
+    bool use_masked_store(const Type &t) const override;
 
     // NEON can be disabled for older processors.
     bool neon_intrinsics_disabled() {
@@ -226,6 +230,8 @@ struct ArmIntrinsic {
         SplitArg0 = 1 << 6,          // This intrinsic requires splitting the argument into the low and high halves.
         NoPrefix = 1 << 7,           // Don't prefix the intrinsic with llvm.*
         RequireFp16 = 1 << 8,        // Available only if Target has ARMFp16 feature
+        RequireBf16 = 1 << 9,        // Available only if Target has ARMBf16 feature
+        RequireI8mm = 1 << 10,       // Available only if Target has ARMI8mm feature
     };
 };
 
@@ -579,6 +585,15 @@ const ArmIntrinsic intrinsic_defs[] = {
     {nullptr, "udot.v4i32.v16i8", Int(32, 4), "dot_product", {Int(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle},
     {nullptr, "udot.v4i32.v16i8", UInt(32, 4), "dot_product", {UInt(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle},
 
+    // BFDOT - bfloat16 dot products. The wrappers pass the bfloat16 vectors as int16.
+    {nullptr, "bfdot_f32x2", Float(32, 2), "dot_product", {Float(32, 2), BFloat(16, 4), BFloat(16, 4)}, ArmIntrinsic::NoMangle | ArmIntrinsic::NoPrefix | ArmIntrinsic::RequireBf16},
+    {nullptr, "bfdot_f32x4", Float(32, 4), "dot_product", {Float(32, 4), BFloat(16, 8), BFloat(16, 8)}, ArmIntrinsic::NoMangle | ArmIntrinsic::NoPrefix | ArmIntrinsic::RequireBf16},
+
+    // SMMLA, UMMLA - int8 matrix multiply-accumulate of a 2x8 by 8x2 tile.
+    {nullptr, "smmla.v4i32.v16i8", Int(32, 4), "matrix_multiply_accumulate", {Int(32, 4), Int(8, 16), Int(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    {nullptr, "ummla.v4i32.v16i8", Int(32, 4), "matrix_multiply_accumulate", {Int(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+    {nullptr, "ummla.v4i32.v16i8", UInt(32, 4), "matrix_multiply_accumulate", {UInt(32, 4), UInt(8, 16), UInt(8, 16)}, ArmIntrinsic::NoMangle | ArmIntrinsic::RequireI8mm},
+
     // ABDL - Widening absolute difference
     // The ARM backend folds both signed and unsigned widening casts of absd to a widening_absd, so we need to handle both signed and
     // unsigned input and return types.
@@ -682,6 +697,12 @@ void CodeGen_ARM::init_module() {
         if (intrin.flags & ArmIntrinsic::RequireFp16 && !target.has_feature(Target::ARMFp16)) {
             continue;
         }
+        if (intrin.flags & ArmIntrinsic::RequireBf16 && !target.has_feature(Target::ARMBf16)) {
+            continue;
+        }
+        if (intrin.flags & ArmIntrinsic::RequireI8mm && !target.has_feature(Target::ARMI8mm)) {
+            continue;
+        }
         // Get the name of the intrinsic with the appropriate prefix.
         const char *intrin_name = nullptr;
         if (target.bits == 32) {
@@ -1265,6 +1286,23 @@ void CodeGen_ARM::visit(const LE *op) {
     CodeGen_Posix::visit(op);
 }
 
+// If a 32-lane operand of a sum into a 2x2 tile is made of two 8-lane
+// rows, laid out as [a, a, b, b] if by_row, or as [a, b, a, b]
+// otherwise, return the rows concatenated, as an operand of smmla or
+// ummla wants them.
+Expr mmla_operand(const Expr &e, bool by_row) {
+    Expr s[4];
+    for (int i = 0; i < 4; i++) {
+        s[i] = simplify(Shuffle::make_slice(e, 8 * i, 1, 8));
+    }
+    if (by_row && equal(s[0], s[1]) && equal(s[2], s[3])) {
+        return simplify(Shuffle::make_concat({s[0], s[2]}));
+    } else if (!by_row && equal(s[0], s[2]) && equal(s[1], s[3])) {
+        return simplify(Shuffle::make_concat({s[0], s[1]}));
+    }
+    return Expr();
+}
+
 void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, const Expr &init) {
     if (neon_intrinsics_disabled() ||
         op->op == VectorReduce::Or ||
@@ -1281,6 +1319,8 @@ void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, const Expr &init
         const char *intrin;
         Target::Feature required_feature;
         std::vector<int> extra_operands;
+        // If defined, the type the operands must be losslessly narrowed to.
+        Type narrow_type;
     };
     // clang-format off
     static const Pattern patterns[] = {
@@ -1292,11 +1332,45 @@ void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, const Expr &init
         {VectorReduce::Add, 4, i32(wild_i8x_), "dot_product", Target::ARMDotProd, {1}},
         {VectorReduce::Add, 4, i32(wild_u8x_), "dot_product", Target::ARMDotProd, {1}},
         {VectorReduce::Add, 4, u32(wild_u8x_), "dot_product", Target::ARMDotProd, {1}},
+
+        {VectorReduce::Add, 2, wild_f32x_ * wild_f32x_, "dot_product", Target::ARMBf16, {}, BFloat(16)},
     };
     // clang-format on
 
     int factor = op->value.type().lanes() / op->type.lanes();
     vector<Expr> matches;
+
+    // A sum of products of 8-bit values over 8 lanes into 4, where one
+    // operand repeats each of two rows and the other alternates
+    // between two rows, is a 2x8 by 8x2 matrix product, e.g. a 2x2
+    // tile of a GEMM vectorized along the reduction and both output
+    // dimensions. The output lanes are the tile in row-major order.
+    if (op->op == VectorReduce::Add && factor == 8 && op->type.lanes() == 4 &&
+        target.bits == 64 && target.has_feature(Target::ARMI8mm)) {
+        const Expr mmla_patterns[] = {
+            i32(widening_mul(wild_i8x_, wild_i8x_)),
+            i32(widening_mul(wild_u8x_, wild_u8x_)),
+            u32(widening_mul(wild_u8x_, wild_u8x_)),
+        };
+        for (const Expr &p : mmla_patterns) {
+            if (!expr_match(p, op->value, matches)) {
+                continue;
+            }
+            Expr a = mmla_operand(matches[0], true);
+            Expr b = mmla_operand(matches[1], false);
+            if (!a.defined() || !b.defined()) {
+                a = mmla_operand(matches[1], true);
+                b = mmla_operand(matches[0], false);
+            }
+            if (a.defined() && b.defined()) {
+                Expr i = init.defined() ? init : make_zero(op->type);
+                value = call_overloaded_intrin(op->type, "matrix_multiply_accumulate", {i, a, b});
+                if (value) {
+                    return;
+                }
+            }
+        }
+    }
     for (const Pattern &p : patterns) {
         if (op->op != p.reduce_op || factor % p.factor != 0) {
             continue;
@@ -1315,6 +1389,14 @@ void CodeGen_ARM::codegen_vector_reduce(const VectorReduce *op, const Expr &init
             for (int i : p.extra_operands) {
                 matches.push_back(make_const(matches[0].type(), i));
             }
+            if (p.narrow_type.bits() > 0) {
+                for (Expr &m : matches) {
+                    m = lossless_cast(p.narrow_type.with_lanes(m.type().lanes()), m);
+                }
+                if (!matches[0].defined() || !matches[1].defined()) {
+                    continue;
+                }
+            }
 
             Expr i = init;
             if (!i.defined()) {
@@ -1484,6 +1566,16 @@ string CodeGen_ARM::mattrs() const {
             separator = ",";
         }
 
+        if (target.has_feature(Target::ARMBf16)) {
+            arch_flags += separator + "+bf16";
+            separator = ",";
+        }
+
+        if (target.has_feature(Target::ARMI8mm)) {
+            arch_flags += separator + "+i8mm";
+            separator = ",";
+        }
+
         if (target.os == Target::IOS || target.os == Target::OSX) {
             return arch_flags + separator + "+reserve-x18";
         } else {
@@ -1502,9 +1594,42 @@ bool CodeGen_ARM::use_soft_float_abi() const {
 }
 
 int CodeGen_ARM::native_vector_bits() const {
+    if (target_vscale_range().first != 0) {
+        return target.vector_bits;
+    }
     return 128;
 }
 
+std::pair<int, int> CodeGen_ARM::target_vscale_range() const {
+    // With the SVE register size known, Halide keeps emitting
+    // fixed-width vectors and NEON intrinsics, and LLVM lowers vectors
+    // wider than 128 bits, masked loads and stores included, to SVE
+    // instructions and predicates. vscale counts 128-bit granules.
+    if (target.bits == 64 && target.vector_bits != 0 &&
+        (target.has_feature(Target::SVE2) || target.has_feature(Target::SVE))) {
+        user_assert(target.vector_bits % 128 == 0 && target.vector_bits <= 2048)
+            << "SVE vector_bits must be a multiple of 128 no larger than 2048, not "
+            << target.vector_bits << "\n";
+        return {target.vector_bits / 128, target.vector_bits / 128};
+    }
+    return {0, 0};
+}
+
+bool CodeGen_ARM::use_native_gather(const Type &t) const {
+    // SVE gathers and scatters 32- and 64-bit elements. NEON has
+    // neither, so only use them once LLVM is lowering to SVE.
+    return target_vscale_range().first != 0 && (t.bits() == 32 || t.bits() == 64);
+}
+
+bool CodeGen_ARM::use_native_scatter(const Type &t) const {
+    return use_native_gather(t);
+}
+
+bool CodeGen_ARM::use_masked_store(const Type &t) const {
+    // Every SVE store takes a predicate.
+    return target_vscale_range().first != 0;
+}
+
 bool CodeGen_ARM::supports_call_as_float16(const Call *op) const {
     bool is_fp16_native = float16_native_funcs.find(op->name) != float16_native_funcs.end();
     bool is_fp16_transcendental = float16_transcendental_remapping.find(op->name) != float16_transcendental_remapping.end();
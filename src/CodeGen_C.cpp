@@ -33,6 +33,7 @@ extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenCL_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeOpenGLCompute_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeQurt_h[];
 extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeD3D12Compute_h[];
+extern "C" unsigned char halide_internal_runtime_header_HalideRuntimeVulkan_h[];
 
 namespace {
 
@@ -480,6 +481,9 @@ CodeGen_C::~CodeGen_C() {
             if (target.has_feature(Target::D3D12Compute)) {
                 stream << halide_internal_runtime_header_HalideRuntimeD3D12Compute_h << "\n";
             }
+            if (target.has_feature(Target::Vulkan)) {
+                stream << halide_internal_runtime_header_HalideRuntimeVulkan_h << "\n";
+            }
         }
         stream << "#endif\n";
     }
@@ -2693,7 +2697,7 @@ void CodeGen_C::visit(const Call *op) {
     } else if (op->is_intrinsic(Call::undef)) {
         user_error << "undef not eliminated before code generation. Please report this as a Halide bug.\n";
     } else if (op->is_intrinsic(Call::prefetch)) {
-        user_assert((op->args.size() == 4) && is_const_one(op->args[2]))
+        user_assert((op->args.size() == 4 || op->args.size() == 5) && is_const_one(op->args[2]))
             << "Only prefetch of 1 cache line is supported in C backend.\n";
 
         const Expr &base_address = op->args[0];
@@ -2703,10 +2707,12 @@ void CodeGen_C::visit(const Call *op) {
 
         const Variable *base = base_address.as<Variable>();
         internal_assert(base && base->type.is_handle());
-        // TODO: provide some way to customize the rw and locality?
+        // A trailing arg marks a prefetch of memory that is about to be written.
+        // TODO: provide some way to customize the locality?
+        const int rw = op->args.size() == 5 ? 1 : 0;
         rhs << "__builtin_prefetch("
             << "((" << print_type(op->type) << " *)" << print_name(base->name)
-            << " + " << print_expr(base_offset) << "), /*rw*/0, /*locality*/0)";
+            << " + " << print_expr(base_offset) << "), /*rw*/" << rw << ", /*locality*/0)";
     } else if (op->is_intrinsic(Call::size_of_halide_buffer_t)) {
         rhs << "(sizeof(halide_buffer_t))";
     } else if (op->is_intrinsic(Call::strict_float)) {
@@ -2961,9 +2967,80 @@ Expr CodeGen_C::scalarize_vector_reduce(const VectorReduce *op) {
     return Shuffle::make_concat(lanes);
 }
 
+Expr CodeGen_C::vector_reduce_by_halving(const VectorReduce *op) {
+    Expr (*binop)(Expr, Expr) = nullptr;
+    switch (op->op) {
+    case VectorReduce::Add:
+        binop = Add::make;
+        break;
+    case VectorReduce::Mul:
+        binop = Mul::make;
+        break;
+    case VectorReduce::Min:
+        binop = Min::make;
+        break;
+    case VectorReduce::Max:
+        binop = Max::make;
+        break;
+    default:
+        // And/Or work on boolean vectors, and SaturatingAdd isn't
+        // associative, so those are left to the scalarized path.
+        return Expr();
+    }
+
+    const int lanes = op->value.type().lanes();
+    const int outer_lanes = op->type.lanes();
+    const int inner_lanes = lanes / outer_lanes;
+    if (inner_lanes < 2 || (inner_lanes & (inner_lanes - 1)) != 0) {
+        return Expr();
+    }
+
+    // Fold each group of inner lanes in half repeatedly, using
+    // full-width shuffles and vector ops, so that the first lane of
+    // each group ends up holding that group's reduction. This keeps
+    // everything in native vector registers until the very end.
+    std::vector<std::pair<string, Expr>> lets;
+    Expr v = op->value;
+    for (int step = inner_lanes / 2; step >= 1; step /= 2) {
+        string name = unique_name('r');
+        lets.emplace_back(name, v);
+        v = Variable::make(op->value.type(), name);
+        std::vector<int> indices(lanes);
+        for (int i = 0; i < lanes; i++) {
+            indices[i] = (i % inner_lanes) + step < inner_lanes ? i + step : i;
+        }
+        v = binop(v, Shuffle::make({v}, indices));
+    }
+    for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+        v = Let::make(it->first, it->second, v);
+    }
+    return v;
+}
+
 void CodeGen_C::visit(const VectorReduce *op) {
     stream << get_indent() << "// Vector reduce: " << op->op << "\n";
 
+    Expr halved = vector_reduce_by_halving(op);
+    if (halved.defined()) {
+        const int inner_lanes = op->value.type().lanes() / op->type.lanes();
+        string v = print_expr(halved);
+        if (op->type.is_scalar()) {
+            print_assignment(op->type, v + "[0]");
+        } else {
+            // Gather the first lane of each group. The shuffle helpers
+            // can't change the lane count, so do this one lane at a time.
+            string r = unique_name('_');
+            stream << get_indent() << print_type(op->type, AppendSpace) << r << ";\n";
+            for (int lane = 0; lane < op->type.lanes(); lane++) {
+                ostringstream rhs;
+                rhs << print_type(op->type) << "_ops::replace(" << r << ", " << lane << ", "
+                    << v << "[" << lane * inner_lanes << "])";
+                r = print_assignment(op->type, rhs.str());
+            }
+        }
+        return;
+    }
+
     Expr scalarized = scalarize_vector_reduce(op);
     if (scalarized.type().is_scalar()) {
         print_assignment(op->type, print_expr(scalarized));
@@ -2983,6 +3060,15 @@ void CodeGen_C::visit(const LetStmt *op) {
         stream << get_indent() << "auto "
                << name << " = " << id_value << ";\n";
         stream << get_indent() << "halide_maybe_unused(" << name << ");\n";
+    } else if (op->name == "__user_context") {
+        // The user_context is passed implicitly as _ucon, so rebind
+        // that in a nested scope (e.g. in multi-GPU loops).
+        open_scope();
+        stream << get_indent() << "void * const _ucon = " << id_value << ";\n";
+        stream << get_indent() << "halide_maybe_unused(_ucon);\n";
+        body.accept(this);
+        close_scope("");
+        return;
     } else {
         Expr new_var = Variable::make(op->value.type(), id_value);
         body = substitute(op->name, new_var, body);
@@ -3269,7 +3355,10 @@ void CodeGen_C::visit(const Prefetch *op) {
 }
 
 void CodeGen_C::visit(const IfThenElse *op) {
-    string cond_id = print_expr(op->condition);
+    // A branch profile may have tagged the condition as likely.
+    const Call *c = op->condition.as<Call>();
+    bool tagged = c && c->is_intrinsic(Call::likely);
+    string cond_id = print_expr(tagged ? c->args[0] : op->condition);
 
     stream << get_indent() << "if (" << cond_id << ")\n";
     open_scope();
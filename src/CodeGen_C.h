@@ -97,6 +97,11 @@ protected:
     void create_assertion(const Expr &cond, const Expr &message);
 
     Expr scalarize_vector_reduce(const VectorReduce *op);
+
+    /** Lower a VectorReduce whose reduction factor is a power of two
+     * to a tree of full-width shuffles and vector ops. Returns an
+     * undefined Expr if the reduction can't be done this way. */
+    Expr vector_reduce_by_halving(const VectorReduce *op);
     enum AppendSpaceIfNeeded {
         DoNotAppendSpace,
         AppendSpace,
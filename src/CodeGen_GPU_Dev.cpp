@@ -209,5 +209,18 @@ void CodeGen_GPU_C::visit(const Call *op) {
     }
 }
 
+void CodeGen_GPU_C::visit(const VectorReduce *op) {
+    // The GPU shuffle syntax can't express the halving tree the C
+    // backend uses, so keep reductions scalarized here.
+    stream << get_indent() << "// Vector reduce: " << op->op << "\n";
+
+    Expr scalarized = scalarize_vector_reduce(op);
+    if (scalarized.type().is_scalar()) {
+        print_assignment(op->type, print_expr(scalarized));
+    } else {
+        print_assignment(op->type, print_scalarized_expr(scalarized));
+    }
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -58,14 +58,39 @@ protected:
         return (isa_version >= 65);
     }
 
+    int is_hvx_v68_or_later() const {
+        return (isa_version >= 68);
+    }
+
+    /** Is a type a vector of floats that HVX can compute with, in
+     * qfloat format? */
+    bool is_qfloat_type(const Type &t) const {
+        return is_hvx_v68_or_later() && t.is_vector() && t.is_float() &&
+               !t.is_bfloat() && (t.bits() == 16 || t.bits() == 32);
+    }
+
+    /** Generate an add, subtract, or multiply of vectors of floats,
+     * leaving the result unnormalized in qfloat format. Operands that
+     * are themselves adds, subtracts, or multiplies are also left in
+     * qfloat format, so a chain of them is normalized only once. The
+     * qfloat values are represented as vectors of unsigned integers
+     * of the same width. */
+    llvm::Value *codegen_qfloat(const Expr &e);
+
+    /** Normalize a qfloat vector back to IEEE floats of type t. */
+    llvm::Value *normalize_qfloat(Type t, llvm::Value *q);
+
     using CodeGen_Posix::visit;
 
     /** Nodes for which we want to emit specific hexagon intrinsics */
     ///@{
+    void visit(const Add *) override;
+    void visit(const Sub *) override;
     void visit(const Max *) override;
     void visit(const Min *) override;
     void visit(const Call *) override;
     void visit(const Mul *) override;
+    void visit(const Cast *) override;
     void visit(const Select *) override;
     void visit(const Allocate *) override;
     ///@}
@@ -134,7 +159,9 @@ private:
 
 CodeGen_Hexagon::CodeGen_Hexagon(const Target &t)
     : CodeGen_Posix(t) {
-    if (target.has_feature(Halide::Target::HVX_v66)) {
+    if (target.has_feature(Halide::Target::HVX_v68)) {
+        isa_version = 68;
+    } else if (target.has_feature(Halide::Target::HVX_v66)) {
         isa_version = 66;
     } else if (target.has_feature(Halide::Target::HVX_v65)) {
         isa_version = 65;
@@ -490,6 +517,19 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
     debug(2) << "Hexagon: Lowering after unpredicating loads/stores:\n"
              << body << "\n\n";
 
+    if (target.has_feature(Target::HexagonAutoVTCM)) {
+        if (!is_hvx_v65_or_later()) {
+            user_error << "hexagon_auto_vtcm requires HVX_v65 or later.\n";
+        }
+        debug(1) << "Hexagon: Staging allocations in VTCM...\n";
+        // v65 and v66 have 256KB of VTCM. Leave half of it for explicit
+        // store_in(MemoryType::VTCM) allocations and other clients.
+        const int64_t vtcm_budget = 128 * 1024;
+        body = stage_allocations_in_vtcm(body, vtcm_budget);
+        debug(2) << "Hexagon: Lowering after staging allocations in VTCM:\n"
+                 << body << "\n\n";
+    }
+
     if (is_hvx_v65_or_later()) {
         // Generate vscatter-vgathers before optimize_hexagon_shuffles.
         debug(1) << "Hexagon: Looking for vscatter-vgather...\n";
@@ -514,8 +554,8 @@ void CodeGen_Hexagon::compile_func(const LoweredFunc &f,
              << body << "\n\n";
 
     debug(1) << "Hexagon: Carrying values across loop iterations...\n";
-    // Use at most 16 vector registers for carrying values.
-    body = loop_carry(body, 16);
+    // Use at most half of the vector registers for carrying values.
+    body = loop_carry(body, target);
     body = simplify(body);
     debug(2) << "Hexagon: Lowering after forwarding stores:\n"
              << body << "\n\n";
@@ -544,6 +584,7 @@ struct HvxIntrinsic {
         BroadcastScalarsToWords = 1 << 0,  // Some intrinsics need scalar arguments
                                            // broadcasted up to 32 bits.
         v65OrLater = 1 << 1,
+        v68OrLater = 1 << 2,
     };
     llvm::Intrinsic::ID id;
     halide_type_t ret_type;
@@ -563,6 +604,8 @@ halide_type_t i32 = halide_type_t(halide_type_int, 32);
 halide_type_t u8 = halide_type_t(halide_type_uint, 8);
 halide_type_t u16 = halide_type_t(halide_type_uint, 16);
 halide_type_t u32 = halide_type_t(halide_type_uint, 32);
+halide_type_t f16 = halide_type_t(halide_type_float, 16);
+halide_type_t f32 = halide_type_t(halide_type_float, 32);
 
 // Define vectors that are 1x and 2x the Hexagon HVX width --
 // Note that we use placeholders here (which we fix up when processing
@@ -577,6 +620,8 @@ halide_type_t i32v1 = i32.with_lanes(kOneX / 32);
 halide_type_t u8v1 = u8.with_lanes(kOneX / 8);
 halide_type_t u16v1 = u16.with_lanes(kOneX / 16);
 halide_type_t u32v1 = u32.with_lanes(kOneX / 32);
+halide_type_t f16v1 = f16.with_lanes(kOneX / 16);
+halide_type_t f32v1 = f32.with_lanes(kOneX / 32);
 
 halide_type_t i8v2 = i8v1.with_lanes(i8v1.lanes * 2);
 halide_type_t i16v2 = i16v1.with_lanes(i16v1.lanes * 2);
@@ -584,6 +629,7 @@ halide_type_t i32v2 = i32v1.with_lanes(i32v1.lanes * 2);
 halide_type_t u8v2 = u8v1.with_lanes(u8v1.lanes * 2);
 halide_type_t u16v2 = u16v1.with_lanes(u16v1.lanes * 2);
 halide_type_t u32v2 = u32v1.with_lanes(u32v1.lanes * 2);
+halide_type_t f32v2 = f32v1.with_lanes(f32v1.lanes * 2);
 
 // clang-format off
 #define INTRINSIC_128B(id) llvm::Intrinsic::hexagon_V6_##id##_128B
@@ -844,6 +890,39 @@ const HvxIntrinsic intrinsic_wrappers[] = {
     // Bit counting
     {INTRINSIC_128B(vnormamth), u16v1, "cls.vh", {u16v1}},
     {INTRINSIC_128B(vnormamtw), u32v1, "cls.vw", {u32v1}},
+
+    // Floating point, v68 or later. The add, sub, and mpy results are
+    // in qfloat format, represented as unsigned integers, and conv
+    // normalizes them back to IEEE floats.
+    {INTRINSIC_128B(vadd_sf), u32v1, "add_qf.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf32_mix), u32v1, "add_qf.vqf32.vsf", {u32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf32), u32v1, "add_qf.vqf32.vqf32", {u32v1, u32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_sf), u32v1, "sub_qf.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf32_mix), u32v1, "sub_qf.vqf32.vsf", {u32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf32), u32v1, "sub_qf.vqf32.vqf32", {u32v1, u32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmpy_qf32_sf), u32v1, "mpy_qf.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vconv_sf_qf32), f32v1, "conv.vqf32", {u32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_hf), u16v1, "add_qf.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf16_mix), u16v1, "add_qf.vqf16.vhf", {u16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vadd_qf16), u16v1, "add_qf.vqf16.vqf16", {u16v1, u16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_hf), u16v1, "sub_qf.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf16_mix), u16v1, "sub_qf.vqf16.vhf", {u16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vsub_qf16), u16v1, "sub_qf.vqf16.vqf16", {u16v1, u16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmpy_qf16_hf), u16v1, "mpy_qf.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vconv_hf_qf16), f16v1, "conv.vqf16", {u16v1}, HvxIntrinsic::v68OrLater},
+
+    {INTRINSIC_128B(vmax_sf), f32v1, "max.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmin_sf), f32v1, "min.vsf.vsf", {f32v1, f32v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmax_hf), f16v1, "max.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vmin_hf), f16v1, "min.vhf.vhf", {f16v1, f16v1}, HvxIntrinsic::v68OrLater},
+
+    // Conversions. The conversion from half to single precision
+    // deinterleaves the result, and the conversion back takes a
+    // deinterleaved argument, like sxt and trunc.
+    {INTRINSIC_128B(vcvt_hf_h), f16v1, "cvt_hf.vh", {i16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vcvt_hf_uh), f16v1, "cvt_hf.vuh", {u16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vcvt_sf_hf), f32v2, "cvt_sf.vhf", {f16v1}, HvxIntrinsic::v68OrLater},
+    {INTRINSIC_128B(vcvt_hf_sf), f16v1, "cvt_hf.vsf", {f32v2}, HvxIntrinsic::v68OrLater},
 };
 // clang-format on
 
@@ -893,10 +972,14 @@ llvm::Function *CodeGen_Hexagon::define_hvx_intrinsic(llvm::Function *intrin,
     llvm::FunctionType *intrin_ty = intrin->getFunctionType();
     bool broadcast_scalar_word = flags & HvxIntrinsic::BroadcastScalarsToWords;
     bool v65OrLater = flags & HvxIntrinsic::v65OrLater;
+    bool v68OrLater = flags & HvxIntrinsic::v68OrLater;
 
     if (v65OrLater && !is_hvx_v65_or_later()) {
         return nullptr;
     }
+    if (v68OrLater && !is_hvx_v68_or_later()) {
+        return nullptr;
+    }
 
     // Get the types of the arguments we want to pass.
     vector<llvm::Type *> llvm_arg_types;
@@ -1793,7 +1876,9 @@ Value *CodeGen_Hexagon::call_intrin(llvm::Type *result_type, const string &name,
 }
 
 string CodeGen_Hexagon::mcpu_target() const {
-    if (target.has_feature(Halide::Target::HVX_v66)) {
+    if (target.has_feature(Halide::Target::HVX_v68)) {
+        return "hexagonv68";
+    } else if (target.has_feature(Halide::Target::HVX_v66)) {
         return "hexagonv66";
     } else if (target.has_feature(Halide::Target::HVX_v65)) {
         return "hexagonv65";
@@ -1813,6 +1898,9 @@ string CodeGen_Hexagon::mattrs() const {
     if (target.has_feature(Target::HVX)) {
         attrs << ",+hvxv" << isa_version;
     }
+    if (is_hvx_v68_or_later()) {
+        attrs << ",+hvx-qfloat,+hvx-ieee-fp";
+    }
     return attrs.str();
 }
 
@@ -1833,8 +1921,107 @@ Expr maybe_scalar(Expr x) {
     }
 }
 
+namespace {
+
+bool is_qfloat_op(const Expr &e) {
+    return e.as<Add>() || e.as<Sub>() || e.as<Mul>();
+}
+
+}  // namespace
+
+Value *CodeGen_Hexagon::codegen_qfloat(const Expr &e) {
+    internal_assert(is_qfloat_type(e.type()) && is_qfloat_op(e));
+    llvm::Type *q_ty = llvm_type_of(e.type().with_code(Type::UInt));
+    string q_suffix = e.type().bits() == 16 ? ".vqf16" : ".vqf32";
+    string suffix = type_suffix(e.type());
+
+    if (const Mul *mul = e.as<Mul>()) {
+        return call_intrin(q_ty, "halide.hexagon.mpy_qf" + suffix + suffix,
+                           {codegen(mul->a), codegen(mul->b)});
+    }
+
+    const Add *add = e.as<Add>();
+    const Sub *sub = e.as<Sub>();
+    Expr a = add ? add->a : sub->a;
+    Expr b = add ? add->b : sub->b;
+    string name = add ? "halide.hexagon.add_qf" : "halide.hexagon.sub_qf";
+    if (add && !is_qfloat_op(a) && is_qfloat_op(b)) {
+        std::swap(a, b);
+    }
+    if (!is_qfloat_op(a)) {
+        // There is no sub of a qfloat from an IEEE float, so the rhs of
+        // such a sub is normalized first.
+        return call_intrin(q_ty, name + suffix + suffix, {codegen(a), codegen(b)});
+    }
+    Value *qa = codegen_qfloat(a);
+    if (is_qfloat_op(b)) {
+        return call_intrin(q_ty, name + q_suffix + q_suffix, {qa, codegen_qfloat(b)});
+    } else {
+        return call_intrin(q_ty, name + q_suffix + suffix, {qa, codegen(b)});
+    }
+}
+
+Value *CodeGen_Hexagon::normalize_qfloat(Type t, Value *q) {
+    string q_suffix = t.bits() == 16 ? ".vqf16" : ".vqf32";
+    return call_intrin(llvm_type_of(t), "halide.hexagon.conv" + q_suffix, {q});
+}
+
+void CodeGen_Hexagon::visit(const Add *op) {
+    if (is_qfloat_type(op->type)) {
+        value = normalize_qfloat(op->type, codegen_qfloat(op));
+    } else {
+        CodeGen_Posix::visit(op);
+    }
+}
+
+void CodeGen_Hexagon::visit(const Sub *op) {
+    if (is_qfloat_type(op->type)) {
+        value = normalize_qfloat(op->type, codegen_qfloat(op));
+    } else {
+        CodeGen_Posix::visit(op);
+    }
+}
+
+void CodeGen_Hexagon::visit(const Cast *op) {
+    Type t = op->type;
+    Type v = op->value.type();
+    // The conversions between halfs and floats (de)interleave pairs of
+    // native vectors, so they need whole vectors of halfs.
+    bool whole_vectors = t.lanes() % (native_vector_bits() / 16) == 0;
+    if (is_qfloat_type(t)) {
+        if (t.bits() == 16 && (v.is_int() || v.is_uint()) && v.bits() == 16) {
+            value = call_intrin(t, "halide.hexagon.cvt_hf" + type_suffix(v), {op->value});
+            return;
+        } else if ((v.is_int() || v.is_uint()) && v.bits() == 8) {
+            // 8 bit integers are exact as halfs, so we can go through
+            // 16 bit integers and halfs.
+            Expr e = Cast::make(v.with_bits(16), op->value);
+            e = Cast::make(Float(16, t.lanes()), e);
+            value = codegen(Cast::make(t, e));
+            return;
+        } else if (t.bits() == 32 && v.is_float() && !v.is_bfloat() && v.bits() == 16 && whole_vectors) {
+            // The widening conversion deinterleaves the result.
+            llvm::Type *wide_ty = llvm_type_of(UInt(32, t.lanes()));
+            value = call_intrin(llvm_type_of(t), "halide.hexagon.cvt_sf.vhf", {codegen(op->value)});
+            value = call_intrin(wide_ty, "halide.hexagon.interleave.vw", {value});
+            value = builder->CreateBitCast(value, llvm_type_of(t));
+            return;
+        } else if (t.bits() == 16 && v.is_float() && !v.is_bfloat() && v.bits() == 32 && whole_vectors) {
+            // The narrowing conversion reinterleaves the result.
+            llvm::Type *wide_ty = llvm_type_of(UInt(32, t.lanes()));
+            value = call_intrin(wide_ty, "halide.hexagon.deinterleave.vw", {codegen(op->value)});
+            value = builder->CreateBitCast(value, llvm_type_of(v));
+            value = call_intrin(llvm_type_of(t), "halide.hexagon.cvt_hf.vsf", {value});
+            return;
+        }
+    }
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_Hexagon::visit(const Mul *op) {
-    if (op->type.is_vector()) {
+    if (is_qfloat_type(op->type)) {
+        value = normalize_qfloat(op->type, codegen_qfloat(op));
+    } else if (op->type.is_vector() && !op->type.is_float()) {
         value =
             call_intrin(op->type, "halide.hexagon.mul" + type_suffix(op->a, op->b),
                         {op->a, op->b}, true /*maybe*/);
@@ -1943,7 +2130,9 @@ void CodeGen_Hexagon::visit(const Call *op) {
     }
 
     if (op->is_intrinsic(Call::prefetch)) {
-        internal_assert((op->args.size() == 4) || (op->args.size() == 6))
+        // l2fetch has no write variant, so a trailing is_write arg is ignored.
+        const size_t dim_args = op->args.size() & ~(size_t)1;
+        internal_assert((dim_args == 4) || (dim_args == 6))
             << "Hexagon only supports 1D or 2D prefetch\n";
 
         const int elem_size = op->type.bytes();
@@ -1954,7 +2143,7 @@ void CodeGen_Hexagon::visit(const Call *op) {
 
         Expr width_bytes = extent0 * stride0 * elem_size;
         Expr height, stride_bytes;
-        if (op->args.size() == 6) {
+        if (dim_args == 6) {
             const Expr &extent1 = op->args[4];
             const Expr &stride1 = op->args[5];
             height = extent1;
@@ -28,11 +28,15 @@ llvm::Type *get_vector_element_type(llvm::Type *t) {
 // functions that takes a user_context pointer as its first parameter.
 bool function_takes_user_context(const std::string &name) {
     static const char *user_context_runtime_funcs[] = {
+        "halide_arena_begin",
+        "halide_arena_malloc",
         "halide_buffer_copy",
         "halide_copy_to_host",
         "halide_copy_to_device",
+        "halide_cuda_preferred_block_size",
         "halide_current_time_ns",
         "halide_debug_to_file",
+        "halide_debug_to_file_flush",
         "halide_device_free",
         "halide_device_host_nop_free",
         "halide_device_free_as_destructor",
@@ -41,6 +45,9 @@ bool function_takes_user_context(const std::string &name) {
         "halide_device_malloc",
         "halide_device_and_host_malloc",
         "halide_device_sync",
+        "halide_distributed_exchange",
+        "halide_distributed_num_ranks",
+        "halide_distributed_rank",
         "halide_do_par_for",
         "halide_do_loop_task",
         "halide_do_task",
@@ -48,6 +55,7 @@ bool function_takes_user_context(const std::string &name) {
         "halide_error",
         "halide_free",
         "halide_malloc",
+        "halide_opencl_preferred_block_size",
         "halide_print",
         "halide_profiler_memory_allocate",
         "halide_profiler_memory_free",
@@ -59,14 +67,23 @@ bool function_takes_user_context(const std::string &name) {
         "halide_start_clock",
         "halide_trace",
         "halide_trace_helper",
+        "halide_tuned_prefetch_distance",
+        "halide_tuned_prefetch_distance_report",
         "halide_memoization_cache_lookup",
         "halide_memoization_cache_store",
         "halide_memoization_cache_release",
+        "halide_memoization_cache_device_free",
+        "halide_memoization_cache_device_free_as_destructor",
+        "halide_parallel_cache_acquire",
+        "halide_parallel_cache_create",
+        "halide_parallel_cache_get",
+        "halide_parallel_cache_release",
         "halide_cuda_run",
         "halide_opencl_run",
         "halide_openglcompute_run",
         "halide_metal_run",
         "halide_d3d12compute_run",
+        "halide_vulkan_run",
         "halide_msan_annotate_buffer_is_initialized_as_destructor",
         "halide_msan_annotate_buffer_is_initialized",
         "halide_msan_annotate_memory_is_initialized",
@@ -91,7 +108,9 @@ bool function_takes_user_context(const std::string &name) {
         "halide_openglcompute_initialize_kernels",
         "halide_metal_initialize_kernels",
         "halide_d3d12compute_initialize_kernels",
+        "halide_vulkan_initialize_kernels",
         "halide_get_gpu_device",
+        "halide_gpu_device_user_context",
         "_halide_buffer_crop",
         "_halide_buffer_retire_crop_after_extern_stage",
         "_halide_buffer_retire_crops_after_extern_stage",
@@ -678,6 +697,16 @@ void set_function_attributes_from_halide_target_options(llvm::Function &fn) {
     get_md_string(module.getModuleFlag("halide_mattrs"), mattrs);
     get_md_string(module.getModuleFlag("halide_vscale_range"), vscale_range);
 
+    // Functions compiled for more CPU features than the rest of the
+    // module (see Target::MultiversionLoops) carry their own cpu and
+    // features, which override the module's.
+    if (fn.hasFnAttribute("halide_mcpu_target")) {
+        mcpu_target = fn.getFnAttribute("halide_mcpu_target").getValueAsString().str();
+    }
+    if (fn.hasFnAttribute("halide_mattrs")) {
+        mattrs = fn.getFnAttribute("halide_mattrs").getValueAsString().str();
+    }
+
     fn.addFnAttr("target-cpu", mcpu_target);
     fn.addFnAttr("tune-cpu", mcpu_tune);
     fn.addFnAttr("target-features", mattrs);
@@ -456,9 +456,9 @@ void CodeGen_LLVM::init_codegen(const std::string &name, bool any_strict_float)
     module->addModuleFlag(llvm::Module::Warning, "halide_use_pic", use_pic() ? 1 : 0);
     module->addModuleFlag(llvm::Module::Warning, "halide_use_large_code_model", llvm_large_code_model ? 1 : 0);
     module->addModuleFlag(llvm::Module::Warning, "halide_per_instruction_fast_math_flags", any_strict_float);
-    if (effective_vscale != 0) {
+    if (auto [min_vscale, max_vscale] = target_vscale_range(); min_vscale != 0) {
         module->addModuleFlag(llvm::Module::Warning, "halide_vscale_range",
-                              MDString::get(*context, std::to_string(effective_vscale) + ", " + std::to_string(effective_vscale)));
+                              MDString::get(*context, std::to_string(min_vscale) + ", " + std::to_string(max_vscale)));
     }
 
     // Ensure some types we need are defined
@@ -2153,6 +2153,8 @@ void CodeGen_LLVM::visit(const Load *op) {
                 vec = builder->CreateInsertElement(vec, val, ConstantInt::get(i32_t, i));
             }
             value = vec;
+        } else if (use_native_gather(op->type)) {
+            value = codegen_gather(op);
         } else {
             // General gathers
             Value *index = codegen(op->index);
@@ -2355,6 +2357,12 @@ void CodeGen_LLVM::codegen_predicated_store(const Store *op) {
             }
             add_tbaa_metadata(store, op->name, slice_index);
         }
+    } else if (op->value.type().is_vector() && !emit_atomic_stores &&
+               use_native_scatter(op->value.type())) {
+        debug(4) << "Predicated scatter\n\t" << Stmt(op) << "\n";
+        Value *vpred = codegen(op->predicate);
+        Value *val = codegen(op->value);
+        codegen_scatter(op, val, vpred);
     } else {  // It's not dense vector store, we need to scalarize it
         debug(4) << "Scalarize predicated vector store\n";
         Type value_type = op->value.type().element_of();
@@ -2493,6 +2501,41 @@ Value *CodeGen_LLVM::codegen_dense_vector_load(const Load *load, Value *vpred, b
                                load->alignment, vpred, slice_to_native, nullptr);
 }
 
+Value *CodeGen_LLVM::codegen_gather(const Load *op, Value *vpred) {
+    Value *index = codegen(op->index);
+    llvm::Align align(op->type.bytes());
+    int lanes = op->type.lanes();
+    int native_lanes = std::max(1, native_vector_bits() / op->type.bits());
+    vector<Value *> slices;
+    for (int i = 0; i < lanes; i += native_lanes) {
+        int slice_lanes = std::min(native_lanes, lanes - i);
+        Value *slice_index = slice_vector(index, i, slice_lanes);
+        Value *ptrs = codegen_buffer_pointer(op->name, op->type.element_of(), slice_index);
+        Value *slice_mask = vpred ? slice_vector(vpred, i, slice_lanes) : nullptr;
+        llvm::Type *slice_type = get_vector_type(llvm_type_of(op->type.element_of()), slice_lanes);
+        Instruction *gather = builder->CreateMaskedGather(slice_type, ptrs, align, slice_mask);
+        add_tbaa_metadata(gather, op->name, op->index);
+        slices.push_back(gather);
+    }
+    return concat_vectors(slices);
+}
+
+void CodeGen_LLVM::codegen_scatter(const Store *op, Value *val, Value *vpred) {
+    Halide::Type value_type = op->value.type();
+    Value *index = codegen(op->index);
+    llvm::Align align(value_type.bytes());
+    int lanes = value_type.lanes();
+    int native_lanes = std::max(1, native_vector_bits() / value_type.bits());
+    for (int i = 0; i < lanes; i += native_lanes) {
+        int slice_lanes = std::min(native_lanes, lanes - i);
+        Value *slice_index = slice_vector(index, i, slice_lanes);
+        Value *ptrs = codegen_buffer_pointer(op->name, value_type.element_of(), slice_index);
+        Value *slice_mask = vpred ? slice_vector(vpred, i, slice_lanes) : nullptr;
+        Instruction *scatter = builder->CreateMaskedScatter(slice_vector(val, i, slice_lanes), ptrs, align, slice_mask);
+        add_tbaa_metadata(scatter, op->name, op->index);
+    }
+}
+
 void CodeGen_LLVM::codegen_predicated_load(const Load *op) {
     const Ramp *ramp = op->index.as<Ramp>();
     const IntImm *stride = ramp ? ramp->stride.as<IntImm>() : nullptr;
@@ -2528,6 +2571,9 @@ void CodeGen_LLVM::codegen_predicated_load(const Load *op) {
 
         Value *flipped = codegen_dense_vector_load(flipped_load.as<Load>(), vpred);
         value = shuffle_vectors(flipped, indices);
+    } else if (use_native_gather(op->type)) {
+        debug(4) << "Predicated gather\n\t" << Expr(op) << "\n";
+        value = codegen_gather(op, codegen(op->predicate));
     } else {  // It's not dense vector load, we need to scalarize it
         Expr load_expr = Load::make(op->type, op->name, op->index, op->image,
                                     op->param, const_true(op->type.lanes()), op->alignment);
@@ -3178,7 +3224,9 @@ void CodeGen_LLVM::visit(const Call *op) {
         // value (so that the final function will be selected if all others
         // fail); failure to do so will cause unpredictable results.
         //
-        // There is currently no way to clear the cached function pointer.
+        // The cached function pointer lives in a halide_multitarget_dispatch_t,
+        // which is registered with the runtime the first time it is set, so
+        // that halide_reset_multitarget_dispatch() can clear it.
         //
         // It is assumed/required that all of the conditions are "pure"; each
         // must evaluate to the same value (within a given runtime environment)
@@ -3236,17 +3284,22 @@ void CodeGen_LLVM::visit(const Call *op) {
             sub_fns.push_back({sub_fn, sub_fn_ptr, cond});
         }
 
-        // Create a null-initialized global to track this object.
+        // Create a null-initialized halide_multitarget_dispatch_t to track this object.
         auto *const base_fn = sub_fns.back().fn;
         const string global_name = unique_name(base_fn->getName().str() + "_indirect_fn_ptr");
+        llvm::StructType *dispatch_t = llvm::StructType::get(*context, {i8_t->getPointerTo(), i8_t->getPointerTo()});
         GlobalVariable *global = new GlobalVariable(
             *module,
-            base_fn->getType(),
+            dispatch_t,
             /*isConstant*/ false,
             GlobalValue::PrivateLinkage,
-            ConstantPointerNull::get(base_fn->getType()),
+            ConstantAggregateZero::get(dispatch_t),
             global_name);
-        LoadInst *loaded_value = builder->CreateLoad(base_fn->getType(), global);
+        Value *selected_ptr = builder->CreatePointerCast(builder->CreateConstInBoundsGEP2_32(dispatch_t, global, 0, 0),
+                                                         base_fn->getType()->getPointerTo());
+        LoadInst *loaded_value = builder->CreateLoad(base_fn->getType(), selected_ptr);
+        // Pairs with the release store in halide_reset_multitarget_dispatch().
+        loaded_value->setAtomic(AtomicOrdering::Monotonic);
 
         BasicBlock *global_inited_bb = BasicBlock::Create(*context, "global_inited_bb", function);
         BasicBlock *global_not_inited_bb = BasicBlock::Create(*context, "global_not_inited_bb", function);
@@ -3257,10 +3310,8 @@ void CodeGen_LLVM::visit(const Call *op) {
         // Note that we deliberately do not attempt to make this threadsafe via (e.g.) mutexes;
         // the requirements of the conditions above mean that multiple writes *should* only
         // be able to re-write the same value, which is harmless for our purposes, and
-        // avoiding such code simplifies and speeds the resulting code.
-        //
-        // (Note that if we ever need to add a way to clear the cached function pointer,
-        // we may need to reconsider this, to avoid amusingly horrible race conditions.)
+        // avoiding such code simplifies and speeds the resulting code. A concurrent
+        // halide_reset_multitarget_dispatch() at worst makes a call use the old choice.
         builder->CreateCondBr(builder->CreateIsNotNull(loaded_value),
                               global_inited_bb, global_not_inited_bb, very_likely_branch);
 
@@ -3276,7 +3327,16 @@ void CodeGen_LLVM::visit(const Call *op) {
                 selected_value = builder->CreateSelect(c, sub_fn.fn_ptr, selected_value);
             }
         }
-        builder->CreateStore(selected_value, global);
+        builder->CreateStore(selected_value, selected_ptr)->setAtomic(AtomicOrdering::Monotonic);
+        llvm::Function *register_dispatch = module->getFunction("halide_register_multitarget_dispatch");
+        if (!register_dispatch) {
+            // The runtime isn't in this module, so it will be linked in later.
+            FunctionType *register_t = FunctionType::get(void_t, {i8_t->getPointerTo()}, false);
+            register_dispatch = llvm::Function::Create(register_t, llvm::Function::ExternalLinkage,
+                                                       "halide_register_multitarget_dispatch", module.get());
+        }
+        builder->CreateCall(register_dispatch,
+                            {builder->CreatePointerCast(global, register_dispatch->getFunctionType()->getParamType(0))});
         builder->CreateBr(call_fn_bb);
 
         // Just an incoming edge for the Phi node
@@ -3296,15 +3356,16 @@ void CodeGen_LLVM::visit(const Call *op) {
         llvm::CallInst *call = builder->CreateCall(base_fn->getFunctionType(), phi, call_args);
         value = call;
     } else if (op->is_intrinsic(Call::prefetch)) {
-        user_assert((op->args.size() == 4) && is_const_one(op->args[2]))
+        user_assert((op->args.size() == 4 || op->args.size() == 5) && is_const_one(op->args[2]))
             << "Only prefetch of 1 cache line is supported.\n";
 
         const Expr &base_address = op->args[0];
         const Expr &base_offset = op->args[1];
         // const Expr &extent0 = op->args[2];  // unused
         // const Expr &stride0 = op->args[3];  // unused
+        const bool is_write = op->args.size() == 5;
 
-        llvm::Function *prefetch_fn = module->getFunction("_halide_prefetch");
+        llvm::Function *prefetch_fn = module->getFunction(is_write ? "_halide_prefetch_write" : "_halide_prefetch");
         internal_assert(prefetch_fn);
 
         vector<llvm::Value *> args;
@@ -3782,6 +3843,37 @@ void CodeGen_LLVM::visit(const Store *op) {
         return;
     }
 
+    // A store of select(c, v, f[i]) to f[i] only changes the lanes where
+    // c is true, so it can be a store of v masked by c, which saves
+    // loading f[i] back. Vectorization has already assumed that the
+    // lanes don't store to the same place.
+    if (value_type.is_vector() && !emit_atomic_stores) {
+        const Ramp *ramp = op->index.as<Ramp>();
+        bool worth_it = (ramp && is_const_one(ramp->stride)) ?
+                            use_masked_store(value_type) :
+                            (!ramp && use_native_scatter(value_type));
+        const Select *sel = op->value.as<Select>();
+        if (worth_it && sel) {
+            auto is_old_value = [&](const Expr &e) {
+                const Load *load = e.as<Load>();
+                return load && load->name == op->name &&
+                       is_const_one(load->predicate) &&
+                       equal(load->index, op->index);
+            };
+            Expr cond = sel->condition;
+            if (cond.type().is_scalar()) {
+                cond = Broadcast::make(cond, value_type.lanes());
+            }
+            if (is_old_value(sel->false_value)) {
+                codegen(Store::make(op->name, sel->true_value, op->index, op->param, cond, op->alignment));
+                return;
+            } else if (is_old_value(sel->true_value)) {
+                codegen(Store::make(op->name, sel->false_value, op->index, op->param, !cond, op->alignment));
+                return;
+            }
+        }
+    }
+
     auto annotate_store = [&](StoreInst *store, const Expr &index) {
         add_tbaa_metadata(store, op->name, index);
         if (emit_atomic_stores) {
@@ -3896,6 +3988,8 @@ void CodeGen_LLVM::visit(const Store *op) {
                     ptr = CreateInBoundsGEP(builder, load_type, ptr, stride);
                 }
             }
+        } else if (!emit_atomic_stores && use_native_scatter(value_type)) {
+            codegen_scatter(op, val);
         } else {
             // Scatter
             Value *index = codegen(op->index);
@@ -4049,7 +4143,14 @@ void CodeGen_LLVM::visit(const IfThenElse *op) {
         for (const auto &p : blocks) {
             BasicBlock *then_bb = BasicBlock::Create(*context, "then_bb", function);
             BasicBlock *next_bb = BasicBlock::Create(*context, "next_bb", function);
-            builder->CreateCondBr(codegen(p.first), then_bb, next_bb);
+            // Conditions can only still be tagged as likely here if a
+            // branch profile said so.
+            const Call *c = p.first.as<Call>();
+            if (c && c->is_intrinsic(Call::likely)) {
+                builder->CreateCondBr(codegen(c->args[0]), then_bb, next_bb, very_likely_branch);
+            } else {
+                builder->CreateCondBr(codegen(p.first), then_bb, next_bb);
+            }
             builder->SetInsertPoint(then_bb);
             codegen(p.second);
             builder->CreateBr(after_bb);
@@ -4936,6 +5037,18 @@ bool CodeGen_LLVM::supports_atomic_add(const Type &t) const {
     return t.is_int_or_uint();
 }
 
+bool CodeGen_LLVM::use_native_gather(const Type &t) const {
+    return false;
+}
+
+bool CodeGen_LLVM::use_native_scatter(const Type &t) const {
+    return false;
+}
+
+bool CodeGen_LLVM::use_masked_store(const Type &t) const {
+    return false;
+}
+
 bool CodeGen_LLVM::use_pic() const {
     return true;
 }
@@ -151,6 +151,16 @@ protected:
         return 0;
     }
 
+    /** The minimum and maximum vscale to promise LLVM via the
+     * vscale_range function attribute, or {0, 0} for none. Defaults to
+     * exactly target_vscale(). Architectures may widen the maximum when
+     * Halide's vectors only fill the first target_vscale() granules of a
+     * register, or set it on its own when Halide emits fixed-width vectors
+     * that LLVM maps onto scalable registers of known size. */
+    virtual std::pair<int, int> target_vscale_range() const {
+        return {target_vscale(), target_vscale()};
+    }
+
     /** Return the type in which arithmetic should be done for the
      * given storage type. */
     virtual Type upgrade_type_for_arithmetic(const Type &) const;
@@ -521,6 +531,20 @@ protected:
 
     virtual bool supports_atomic_add(const Type &t) const;
 
+    /** Should vector loads of the given type with an index that is not a
+     * ramp use the target's gather instructions, instead of one scalar
+     * load per lane? This is a cost check: targets should only return
+     * true where a gather beats scalarizing. The default is false. */
+    virtual bool use_native_gather(const Type &t) const;
+
+    /** As above, for vector stores and scatter instructions. */
+    virtual bool use_native_scatter(const Type &t) const;
+
+    /** Should a dense vector store of select(c, v, f[i]) to f[i] be
+     * emitted as a store of v masked by c? Only worth it on targets
+     * with cheap masked stores. The default is false. */
+    virtual bool use_masked_store(const Type &t) const;
+
     /** Compile a horizontal reduction that starts with an explicit
      * initial value. There are lots of complex ways to peephole
      * optimize this pattern, especially with the proliferation of
@@ -679,6 +703,14 @@ private:
     virtual void codegen_predicated_load(const Load *op);
     virtual void codegen_predicated_store(const Store *op);
 
+    /** Emit a vector load or store with an arbitrary vector index as
+     * llvm.masked.gather or llvm.masked.scatter, sliced to the native
+     * vector width. The predicate is optional. */
+    // @{
+    llvm::Value *codegen_gather(const Load *op, llvm::Value *vpred = nullptr);
+    void codegen_scatter(const Store *op, llvm::Value *val, llvm::Value *vpred = nullptr);
+    // @}
+
     void codegen_atomic_rmw(const Store *op);
 
     void init_codegen(const std::string &name, bool any_strict_float = false);
@@ -2,11 +2,15 @@
 #include <sstream>
 #include <utility>
 
+#include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
 #include "CodeGen_Internal.h"
 #include "CodeGen_Metal_Dev.h"
 #include "Debug.h"
+#include "ExprUsesVar.h"
 #include "IROperator.h"
+#include "Simplify.h"
+#include "Substitute.h"
 
 namespace Halide {
 namespace Internal {
@@ -436,6 +440,76 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Store *op) {
     user_assert(is_const_one(op->predicate)) << "Predicated store is not supported inside Metal kernel.\n";
     user_assert(op->value.type().lanes() <= 4) << "Vectorization by widths greater than 4 is not supported by Metal -- type is " << op->value.type() << ".\n";
 
+    if (emit_atomic_stores) {
+        Type t = op->value.type();
+        user_assert(t.is_scalar() && t.bits() == 32)
+            << "Metal only supports scalar 32-bit atomics.\n";
+
+        // Metal atomics operate on atomic_int and atomic_uint, so
+        // address the element through a pointer to one of those.
+        Expr equiv_load = Load::make(t, op->name, op->index, Buffer<>(), op->param, op->predicate, op->alignment);
+        bool type_cast_needed = !(allocations.contains(op->name) &&
+                                  allocations.get(op->name).type == t);
+        string id_index = print_expr(op->index);
+        ostringstream element;
+        if (type_cast_needed) {
+            element << "((" << get_memory_space(op->name) << " "
+                    << print_storage_type(t) << " *)"
+                    << print_name(op->name) << ")";
+        } else {
+            element << print_name(op->name);
+        }
+        element << "[" << id_index << "]";
+
+        // Refer to the value being updated by name, so that we can
+        // detect atomic adds, and so that the compare-and-swap loop
+        // computes the new value from the value the exchange compares
+        // against rather than from a separate load.
+        string old_val = unique_name('_');
+        Expr value = substitute(equiv_load, Variable::make(t, old_val), op->value);
+        Expr delta = simplify(common_subexpression_elimination(value - Variable::make(t, old_val)));
+        if (t.is_int_or_uint() && !expr_uses_var(delta, old_val)) {
+            // atomic_fetch_add_explicit((device atomic_int *)&x[i], delta, memory_order_relaxed);
+            string id_delta = print_expr(delta);
+            stream << get_indent() << "atomic_fetch_add_explicit(("
+                   << get_memory_space(op->name) << " atomic_" << print_type(t) << " *)&"
+                   << element.str() << ", " << id_delta << ", memory_order_relaxed);\n";
+        } else {
+            // Compare-and-swap loop, on the bits of the element.
+            // {
+            //   uint old_bits = as_type<uint>(x[i]);
+            //   uint new_bits;
+            //   do {
+            //     float old_val = as_type<float>(old_bits);
+            //     new_bits = as_type<uint>(...);
+            //   } while (!atomic_compare_exchange_weak_explicit((device atomic_uint *)&x[i], &old_bits, new_bits,
+            //                                                   memory_order_relaxed, memory_order_relaxed));
+            // }
+            string old_bits = unique_name('_');
+            string new_bits = unique_name('_');
+            stream << get_indent() << "{\n";
+            indent += 2;
+            stream << get_indent() << "uint " << old_bits << " = as_type<uint>(" << element.str() << ");\n";
+            stream << get_indent() << "uint " << new_bits << ";\n";
+            stream << get_indent() << "do {\n";
+            indent += 2;
+            stream << get_indent() << print_type(t) << " " << print_name(old_val)
+                   << " = as_type<" << print_type(t) << ">(" << old_bits << ");\n";
+            cache.clear();
+            string id_value = print_expr(value);
+            stream << get_indent() << new_bits << " = as_type<uint>(" << id_value << ");\n";
+            indent -= 2;
+            stream << get_indent()
+                   << "} while (!atomic_compare_exchange_weak_explicit(("
+                   << get_memory_space(op->name) << " atomic_uint *)&" << element.str() << ", &"
+                   << old_bits << ", " << new_bits << ", memory_order_relaxed, memory_order_relaxed));\n";
+            indent -= 2;
+            stream << get_indent() << "}\n";
+        }
+        cache.clear();
+        return;
+    }
+
     string id_value = print_expr(op->value);
     Type t = op->value.type();
 
@@ -553,9 +627,14 @@ void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Cast *op) {
 }
 
 void CodeGen_Metal_Dev::CodeGen_Metal_C::visit(const Atomic *op) {
-    // It might be possible to support atomic but this is not trivial.
-    // Metal requires atomic data types to be wrapped in an atomic integer data type.
-    user_assert(false) << "Atomic updates are not supported inside Metal kernels";
+    // Most GPUs require all the threads in a SIMD-group to perform the
+    // same operations, which means our mutex will lead to deadlock.
+    user_assert(op->mutex_name.empty())
+        << "The atomic update requires a mutex lock, which is not supported in Metal.\n";
+
+    // Issue atomic stores.
+    ScopedValue<bool> old_emit_atomic_stores(emit_atomic_stores, true);
+    CodeGen_GPU_C::visit(op);
 }
 
 void CodeGen_Metal_Dev::add_kernel(Stmt s,
@@ -14,6 +14,7 @@
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "Simplify.h"
+#include "Util.h"
 
 namespace Halide {
 namespace Internal {
@@ -43,6 +44,10 @@ public:
 
     std::vector<char> compile_to_src() override;
 
+    /** Compile the OpenCL C source to SPIR-V with clang and llvm-spirv,
+     * for the cl_spirv target feature. */
+    std::vector<char> compile_to_spirv(const std::vector<char> &src);
+
     std::string get_current_kernel_name() override;
 
     void dump() override;
@@ -275,6 +280,36 @@ std::string image_type_suffix(const Type &type) {
     }
     return "";
 }
+
+// If an image coordinate is clamped to [0, extent - 1], return the
+// coordinate before clamping, so that the clamping can be left to a
+// sampler.
+Expr strip_clamp_to_edge(const Expr &coord, const Expr &extent) {
+    auto scalar = [](const Expr &e) {
+        const Broadcast *b = e.as<Broadcast>();
+        return b ? b->value : e;
+    };
+    Expr e, lo, hi;
+    if (const Max *max = coord.as<Max>()) {
+        if (const Min *min = max->a.as<Min>()) {
+            e = min->a;
+            hi = min->b;
+            lo = max->b;
+        }
+    } else if (const Min *min = coord.as<Min>()) {
+        if (const Max *max = min->a.as<Max>()) {
+            e = max->a;
+            lo = max->b;
+            hi = min->b;
+        }
+    }
+    if (e.defined() &&
+        is_const_zero(lo) &&
+        can_prove(scalar(hi) == scalar(extent) - 1)) {
+        return e;
+    }
+    return Expr();
+}
 }  // namespace
 
 void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Call *op) {
@@ -368,15 +403,28 @@ void CodeGen_OpenCL_Dev::CodeGen_OpenCL_C::visit(const Call *op) {
         internal_assert(arg_type.lanes() <= 16);
         internal_assert(arg_type.lanes() == op->type.lanes());
 
+        // Coordinates clamped to the image are read with a sampler
+        // that clamps them instead. The other coordinates are in
+        // bounds, so the sampler doesn't change them.
         std::array<string, 3> coord;
+        bool clamp_to_edge = false;
         for (int i = 0; i < dims; i++) {
-            coord[i] = print_expr(op->args[i * 2 + 2]);
+            Expr c = op->args[i * 2 + 2];
+            Expr unclamped = strip_clamp_to_edge(c, op->args[i * 2 + 3]);
+            if (unclamped.defined()) {
+                c = unclamped;
+                clamp_to_edge = true;
+            }
+            coord[i] = print_expr(c);
         }
         vector<string> results(arg_type.lanes());
         // For vectorized reads, codegen as a sequence of read_image calls
         for (int i = 0; i < arg_type.lanes(); i++) {
             ostringstream rhs;
             rhs << "read_image" << image_type_suffix(op->type) << "(" << print_name(string_imm->value) << ", ";
+            if (clamp_to_edge) {
+                rhs << "halide_clamp_to_edge, ";
+            }
             string idx = arg_type.is_vector() ? string(".s") + vector_elements[i] : "";
             switch (dims) {
             case 1:
@@ -1154,6 +1202,12 @@ void CodeGen_OpenCL_Dev::init_module() {
     // variables in OpenCL C. See https://github.com/halide/Halide/issues/4918.
     src_stream << "#define halide_maybe_unused(x)\n";
 
+    // A sampler for image reads whose coordinates are clamped to the
+    // image, which the texture hardware can do for free.
+    src_stream << "#ifdef __IMAGE_SUPPORT__\n"
+               << "__constant sampler_t halide_clamp_to_edge = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;\n"
+               << "#endif\n";
+
     if (target.has_feature(Target::CLDoubles)) {
         src_stream << "#pragma OPENCL EXTENSION cl_khr_fp64 : enable\n"
                    << "inline bool is_nan_f64(double x) {return isnan(x); }\n"
@@ -1219,6 +1273,10 @@ void CodeGen_OpenCL_Dev::init_module() {
         src_stream << "#pragma OPENCL EXTENSION cl_khr_int64_extended_atomics : enable\n";
     }
 
+    if (target.has_feature(Target::CLSubgroups)) {
+        src_stream << "#pragma OPENCL EXTENSION cl_khr_subgroups : enable\n";
+    }
+
     src_stream << "\n";
 
     // Add at least one kernel to avoid errors on some implementations for functions
@@ -1233,10 +1291,38 @@ vector<char> CodeGen_OpenCL_Dev::compile_to_src() {
     debug(1) << "OpenCL kernel:\n"
              << str << "\n";
     vector<char> buffer(str.begin(), str.end());
+    if (clc.get_target().has_feature(Target::CLSPIRV)) {
+        return compile_to_spirv(buffer);
+    }
     buffer.push_back(0);
     return buffer;
 }
 
+vector<char> CodeGen_OpenCL_Dev::compile_to_spirv(const vector<char> &src) {
+    TemporaryFile src_file("halide_opencl", ".cl");
+    TemporaryFile bitcode_file("halide_opencl", ".bc");
+    TemporaryFile spirv_file("halide_opencl", ".spv");
+    write_entire_file(src_file.pathname(), src);
+
+    // The device limits on constant arguments aren't known until
+    // runtime, so pass all of them in global memory instead.
+    string cmd = "clang -cl-std=CL1.2 -target spir64 -Xclang -finclude-default-header -O3 -emit-llvm"
+                 " -D MAX_CONSTANT_BUFFER_SIZE=0 -D MAX_CONSTANT_ARGS=0 -c " +
+                 src_file.pathname() + " -o " + bitcode_file.pathname();
+    debug(1) << "Compiling OpenCL C to SPIR-V: " << cmd << "\n";
+    user_assert(system(cmd.c_str()) == 0)
+        << "Failed to compile OpenCL C to LLVM bitcode with: " << cmd << "\n"
+        << "The cl_spirv target feature needs clang and llvm-spirv in the path.\n";
+
+    cmd = "llvm-spirv " + bitcode_file.pathname() + " -o " + spirv_file.pathname();
+    debug(1) << "Compiling OpenCL C to SPIR-V: " << cmd << "\n";
+    user_assert(system(cmd.c_str()) == 0)
+        << "Failed to translate LLVM bitcode to SPIR-V with: " << cmd << "\n"
+        << "The cl_spirv target feature needs clang and llvm-spirv in the path.\n";
+
+    return read_entire_file(spirv_file.pathname());
+}
+
 string CodeGen_OpenCL_Dev::get_current_kernel_name() {
     return cur_kernel_name;
 }
@@ -17,6 +17,7 @@
 #include "Solve.h"
 #include "Target.h"
 
+#include <algorithm>
 #include <fstream>
 
 // This is declared in NVPTX.h, which is not exported. Ugly, but seems better than
@@ -90,6 +91,10 @@ protected:
     void codegen_vector_reduce(const VectorReduce *op, const Expr &init) override;
     // @}
 
+    /** Generate the warp matrix multiply intrinsics for the tensor core
+     * operations made by extract_tensor_core_operations. */
+    void codegen_wmma(const Call *op);
+
     std::string march() const;
     std::string mcpu_target() const override;
     std::string mcpu_tune() const override;
@@ -109,6 +114,11 @@ protected:
      * ptx intrinsic functions to call to get them. */
     std::string simt_intrinsic(const std::string &name);
 
+    /** Compile PTX source to SASS with ptxas for the target's SM
+     * architecture, and any newer ones listed in HL_CUDA_FATBIN_ARCHS,
+     * and package the results and the PTX in a fatbin. */
+    std::vector<char> compile_to_fatbin(const std::vector<char> &ptx);
+
     bool supports_atomic_add(const Type &t) const override;
 };
 
@@ -274,6 +284,11 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
         return;
     }
 
+    if (op->call_type == Call::Intrinsic && starts_with(op->name, "wmma_")) {
+        codegen_wmma(op);
+        return;
+    }
+
     // TODO: It would be better if CodeGen_LLVM could handle overloaded intrin calls by default.
     value = call_overloaded_intrin(op->type, op->name, op->args);
     if (!value) {
@@ -281,6 +296,155 @@ void CodeGen_PTX_Dev::visit(const Call *op) {
     }
 }
 
+void CodeGen_PTX_Dev::codegen_wmma(const Call *op) {
+    // Call a warp matrix intrinsic, and unpack the struct of values it
+    // returns.
+    auto call_intrinsic = [&](const string &name, llvm::Type *result_type, const vector<Value *> &args) {
+        vector<llvm::Type *> arg_types;
+        for (Value *arg : args) {
+            arg_types.push_back(arg->getType());
+        }
+        FunctionType *fn_type = FunctionType::get(result_type, arg_types, false);
+        Value *result = builder->CreateCall(module->getOrInsertFunction(name, fn_type), args);
+        vector<Value *> elements;
+        if (auto *struct_type = dyn_cast<StructType>(result_type)) {
+            for (unsigned i = 0; i < struct_type->getNumElements(); i++) {
+                elements.push_back(builder->CreateExtractValue(result, {i}));
+            }
+        }
+        return elements;
+    };
+
+    // The registers each thread holds of a tile of A or B. Float32
+    // operands are tf32.
+    auto fragment_type = [&](const Type &t, int &count) -> llvm::Type * {
+        if (t == Float(16)) {
+            count = 8;
+            return get_vector_type(f16_t, 2);
+        } else if (t == BFloat(16) || t == Float(32)) {
+            count = 4;
+            return i32_t;
+        } else if (t.bits() == 8) {
+            count = 2;
+            return i32_t;
+        }
+        internal_error << "Unexpected tensor core operand type " << t << "\n";
+        return nullptr;
+    };
+
+    auto type_name = [&](const Type &t, bool accumulator) -> string {
+        if (t == Float(16)) {
+            return "f16";
+        } else if (t == BFloat(16)) {
+            return "bf16";
+        } else if (t == Float(32)) {
+            return accumulator ? "f32" : "tf32";
+        } else if (t == Int(8)) {
+            return "s8";
+        } else if (t == UInt(8)) {
+            return "u8";
+        } else if (t == Int(32)) {
+            return "s32";
+        }
+        internal_error << "Unexpected tensor core type " << t << "\n";
+        return "";
+    };
+
+    // A matrix in memory is a buffer, the index of its first element,
+    // the distance between its rows or columns, and whether it is
+    // column major. Get the address of its first element, and the
+    // suffixes of the intrinsic names for its layout and address space.
+    struct Matrix {
+        Value *address, *stride;
+        string layout, address_space;
+    };
+    auto matrix = [&](const vector<Expr> &args, size_t first, const Type &t) {
+        const Variable *buffer = args[first].as<Variable>();
+        internal_assert(buffer) << "Tensor core operation on a matrix that is not a buffer\n";
+        Value *ptr = codegen_buffer_pointer(buffer->name, t, args[first + 1]);
+        unsigned address_space = ptr->getType()->getPointerAddressSpace();
+        ptr = builder->CreatePointerCast(ptr, i8_t->getPointerTo(address_space));
+        const int64_t *col_major = as_const_int(args[first + 3]);
+        internal_assert(col_major);
+        return Matrix{ptr, codegen(args[first + 2]),
+                      *col_major ? "col" : "row",
+                      ".p" + std::to_string(address_space) + "i8"};
+    };
+
+    // The accumulator lives in an allocation of 8 elements per thread.
+    llvm::Type *accumulator_type = llvm_type_of(op->type);
+    auto accumulator_address = [&](const Expr &fragment) {
+        Value *ptr = codegen(fragment);
+        return builder->CreatePointerCast(ptr, accumulator_type->getPointerTo());
+    };
+    auto load_accumulator = [&](Value *ptr) {
+        vector<Value *> elements;
+        for (unsigned i = 0; i < 8; i++) {
+            elements.push_back(builder->CreateLoad(accumulator_type, builder->CreateConstInBoundsGEP1_32(accumulator_type, ptr, i)));
+        }
+        return elements;
+    };
+    auto store_accumulator = [&](Value *ptr, const vector<Value *> &elements) {
+        for (unsigned i = 0; i < elements.size(); i++) {
+            builder->CreateStore(elements[i], builder->CreateConstInBoundsGEP1_32(accumulator_type, ptr, i));
+        }
+    };
+    llvm::Type *accumulator_struct = StructType::get(*context, vector<llvm::Type *>(8, accumulator_type));
+    string accumulator_name = type_name(op->type, true);
+
+    if (op->name == "wmma_mma") {
+        // wmma_mma(fragment, wmma_load_a(...), wmma_load_b(...))
+        vector<Value *> args;
+        string layouts, shape;
+        Type t;
+        for (int i = 1; i <= 2; i++) {
+            const Call *load = op->args[i].as<Call>();
+            internal_assert(load && (load->name == "wmma_load_a" || load->name == "wmma_load_b"));
+            t = load->type.element_of();
+            shape = "m16n16k" + std::to_string(load->type.lanes() / 16);
+            int count = 0;
+            llvm::Type *element_type = fragment_type(t, count);
+            Matrix m = matrix(load->args, 0, t);
+            string name = "llvm.nvvm.wmma." + shape + ".load." + (i == 1 ? "a." : "b.") +
+                          m.layout + ".stride." + type_name(t, false) + m.address_space;
+            vector<Value *> fragment = call_intrinsic(name, StructType::get(*context, vector<llvm::Type *>(count, element_type)),
+                                                      {m.address, m.stride});
+            args.insert(args.end(), fragment.begin(), fragment.end());
+            layouts += "." + m.layout;
+        }
+        Value *acc = accumulator_address(op->args[0]);
+        vector<Value *> c = load_accumulator(acc);
+        args.insert(args.end(), c.begin(), c.end());
+        string types = t == Float(16) ? "f32.f32" : type_name(t, false);
+        store_accumulator(acc, call_intrinsic("llvm.nvvm.wmma." + shape + ".mma" + layouts + "." + types,
+                                              accumulator_struct, args));
+    } else if (op->name == "wmma_load_c") {
+        // wmma_load_c(fragment, buffer, index, stride, col_major, depth)
+        Matrix m = matrix(op->args, 1, op->type);
+        const int64_t *depth = as_const_int(op->args[5]);
+        internal_assert(depth);
+        string name = "llvm.nvvm.wmma.m16n16k" + std::to_string(*depth) + ".load.c." +
+                      m.layout + ".stride." + accumulator_name + m.address_space;
+        store_accumulator(accumulator_address(op->args[0]),
+                          call_intrinsic(name, accumulator_struct, {m.address, m.stride}));
+    } else if (op->name == "wmma_store_d") {
+        // wmma_store_d(buffer, index, stride, col_major, fragment, depth)
+        Matrix m = matrix(op->args, 0, op->type);
+        const int64_t *depth = as_const_int(op->args[5]);
+        internal_assert(depth);
+        string name = "llvm.nvvm.wmma.m16n16k" + std::to_string(*depth) + ".store.d." +
+                      m.layout + ".stride." + accumulator_name + m.address_space;
+        vector<Value *> args = {m.address};
+        vector<Value *> d = load_accumulator(accumulator_address(op->args[4]));
+        args.insert(args.end(), d.begin(), d.end());
+        args.push_back(m.stride);
+        call_intrinsic(name, void_t, args);
+    } else {
+        internal_error << "Unknown tensor core operation " << op->name << "\n";
+    }
+    value = ConstantInt::get(i32_t, 0);
+}
+
 string CodeGen_PTX_Dev::simt_intrinsic(const string &name) {
     if (ends_with(name, ".__thread_id_x")) {
         return "llvm.nvvm.read.ptx.sreg.tid.x";
@@ -579,6 +743,10 @@ string CodeGen_PTX_Dev::mattrs() const {
         return "+ptx71";
     } else if (target.has_feature(Target::CUDACapability80)) {
         return "+ptx70";
+    } else if (target.has_feature(Target::CUDACapability75) &&
+               target.has_feature(Target::CUDATensorCores)) {
+        // Integer warp matrix multiplies need ptx isa 6.3.
+        return "+ptx63";
     } else if (target.has_feature(Target::CUDACapability70) ||
                target.has_feature(Target::CUDACapability75)) {
         return "+ptx60";
@@ -784,11 +952,64 @@ vector<char> CodeGen_PTX_Dev::compile_to_src() {
         */
     }
 
+    if (target.has_feature(Target::CUDAFatbin)) {
+        return compile_to_fatbin(buffer);
+    }
+
     // Null-terminate the ptx source
     buffer.push_back(0);
     return buffer;
 }
 
+vector<char> CodeGen_PTX_Dev::compile_to_fatbin(const vector<char> &ptx) {
+    const string ptx_arch = mcpu_target();
+    const int ptx_sm = std::atoi(ptx_arch.c_str() + 3);
+
+    // ptxas can only compile PTX for the architecture it targets or
+    // newer ones.
+    vector<string> archs = {ptx_arch};
+    for (const string &arch : split_string(get_env_variable("HL_CUDA_FATBIN_ARCHS"), ",")) {
+        if (arch.empty() || std::find(archs.begin(), archs.end(), arch) != archs.end()) {
+            continue;
+        }
+        user_assert(starts_with(arch, "sm_") && std::atoi(arch.c_str() + 3) >= ptx_sm)
+            << "HL_CUDA_FATBIN_ARCHS contains \"" << arch
+            << "\", which is not an SM architecture at least as new as " << ptx_arch
+            << ", the one the PTX is generated for.\n";
+        archs.push_back(arch);
+    }
+
+    const string name = get_current_kernel_name();
+    TemporaryFile ptx_file(name, ".ptx");
+    TemporaryFile fatbin_file(name, ".fatbin");
+    write_entire_file(ptx_file.pathname(), ptx);
+
+    vector<std::unique_ptr<TemporaryFile>> cubin_files;
+    string fatbin_cmd = "fatbinary --64 --create " + fatbin_file.pathname();
+    for (const string &arch : archs) {
+        cubin_files.push_back(std::make_unique<TemporaryFile>(name + "_" + arch, ".cubin"));
+        const string &cubin = cubin_files.back()->pathname();
+        // Cap the registers the same way the runtime does by default
+        // when it JIT-compiles PTX.
+        string cmd = "ptxas --gpu-name " + arch + " --maxrregcount 64 " + ptx_file.pathname() + " -o " + cubin;
+        debug(1) << "Compiling PTX to SASS: " << cmd << "\n";
+        user_assert(system(cmd.c_str()) == 0)
+            << "Failed to compile PTX to SASS for " << arch << " with: " << cmd << "\n"
+            << "The cuda_fatbin target feature needs ptxas and fatbinary from the CUDA SDK in the path.\n";
+        fatbin_cmd += " --image=profile=" + arch + ",file=" + cubin;
+    }
+    // Keep the PTX too, so that the driver can still JIT-compile the
+    // kernels for GPUs none of the SASS is for.
+    fatbin_cmd += " --image=profile=compute_" + std::to_string(ptx_sm) + ",file=" + ptx_file.pathname();
+
+    debug(1) << "Packaging fatbin: " << fatbin_cmd << "\n";
+    user_assert(system(fatbin_cmd.c_str()) == 0)
+        << "Failed to create a fatbin with: " << fatbin_cmd << "\n"
+        << "The cuda_fatbin target feature needs ptxas and fatbinary from the CUDA SDK in the path.\n";
+
+    return read_entire_file(fatbin_file.pathname());
+}
+
 int CodeGen_PTX_Dev::native_vector_bits() const {
     // PTX doesn't really do vectorization. The widest type is a double.
     return 64;
@@ -119,6 +119,7 @@ protected:
     int native_vector_bits() const override;
     int maximum_vector_bits() const override;
     int target_vscale() const override;
+    std::pair<int, int> target_vscale_range() const override;
 };
 
 CodeGen_RISCV::CodeGen_RISCV(const Target &t)
@@ -189,6 +190,20 @@ int CodeGen_RISCV::target_vscale() const {
     return 0;
 }
 
+std::pair<int, int> CodeGen_RISCV::target_vscale_range() const {
+    // vector_bits is the smallest VLEN the code must run on. Every vector
+    // op is a VP intrinsic whose explicit vector length is Halide's lane
+    // count, and fixed vectors go in and out of the low lanes of scalable
+    // ones, so lanes past vector_bits in a wider register are never read
+    // or stored. LLVM may still pick vsetvli settings for the actual VLEN,
+    // up to the architectural maximum of 65536 bits.
+    int vscale = target_vscale();
+    if (vscale == 0) {
+        return {0, 0};
+    }
+    return {vscale, 65536 / 64};
+}
+
 const RISCVIntrinsic intrinsic_defs[] = {
     {"vaadd", Type::Int, "halving_add", {Type::Int, Type::Int}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundDown},
     {"vaaddu", Type::UInt, "halving_add", {Type::UInt, Type::UInt}, RISCVIntrinsic::AddVLArg | RISCVIntrinsic::RoundDown},
@@ -0,0 +1,1334 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "CodeGen_GPU_Dev.h"
+#include "CodeGen_Internal.h"
+#include "CodeGen_Vulkan_Dev.h"
+#include "Debug.h"
+#include "Deinterleave.h"
+#include "FindIntrinsics.h"
+#include "Float16.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Lerp.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "SpirvIR.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+#ifdef WITH_SPIRV
+
+namespace {
+
+// The instructions of the GLSL.std.450 extended instruction set that we
+// use (from the GLSL.std.450 specification).
+enum GLSLstd450 {
+    GLSLstd450RoundEven = 2,
+    GLSLstd450Trunc = 3,
+    GLSLstd450FAbs = 4,
+    GLSLstd450SAbs = 5,
+    GLSLstd450Floor = 8,
+    GLSLstd450Ceil = 9,
+    GLSLstd450Sin = 13,
+    GLSLstd450Cos = 14,
+    GLSLstd450Tan = 15,
+    GLSLstd450Asin = 16,
+    GLSLstd450Acos = 17,
+    GLSLstd450Atan = 18,
+    GLSLstd450Sinh = 19,
+    GLSLstd450Cosh = 20,
+    GLSLstd450Tanh = 21,
+    GLSLstd450Asinh = 22,
+    GLSLstd450Acosh = 23,
+    GLSLstd450Atanh = 24,
+    GLSLstd450Atan2 = 25,
+    GLSLstd450Pow = 26,
+    GLSLstd450Exp = 27,
+    GLSLstd450Log = 28,
+    GLSLstd450Sqrt = 31,
+    GLSLstd450InverseSqrt = 32,
+    GLSLstd450FMin = 37,
+    GLSLstd450UMin = 38,
+    GLSLstd450SMin = 39,
+    GLSLstd450FMax = 40,
+    GLSLstd450UMax = 41,
+    GLSLstd450SMax = 42,
+};
+
+// Not present in the SPIR-V 1.0 headers
+const SpvCapability SpvCapabilityStorageBuffer8BitAccess = (SpvCapability)4448;
+
+// The Vulkan runtime binds the scalar arguments of a kernel as a uniform
+// buffer at binding 0 (each widened to 32 bits), and the buffer arguments
+// as storage buffers at the following bindings, in argument order.
+const uint32_t scalar_args_binding = 0;
+const uint32_t first_buffer_binding = 1;
+
+class CodeGen_Vulkan_Dev : public CodeGen_GPU_Dev {
+public:
+    CodeGen_Vulkan_Dev(const Target &target);
+
+    // CodeGen_GPU_Dev interface
+    void add_kernel(Stmt stmt,
+                    const std::string &name,
+                    const std::vector<DeviceArgument> &args) override;
+
+    void init_module() override;
+
+    std::vector<char> compile_to_src() override;
+
+    std::string get_current_kernel_name() override;
+
+    void dump() override;
+
+    std::string print_gpu_name(const std::string &name) override;
+
+    std::string api_unique_name() override {
+        return "vulkan";
+    }
+
+    bool kernel_run_takes_types() const override {
+        return true;
+    }
+
+protected:
+    class SPIRV_Emitter : public IRVisitor {
+    public:
+        SPIRV_Emitter(const Target &t);
+
+        void add_kernel(const Stmt &s,
+                        const std::string &name,
+                        const std::vector<DeviceArgument> &args);
+
+        void encode(SpvBinary &binary) const;
+
+    protected:
+        using IRVisitor::visit;
+
+        void visit(const IntImm *) override;
+        void visit(const UIntImm *) override;
+        void visit(const FloatImm *) override;
+        void visit(const StringImm *) override;
+        void visit(const Cast *) override;
+        void visit(const Reinterpret *) override;
+        void visit(const Variable *) override;
+        void visit(const Add *) override;
+        void visit(const Sub *) override;
+        void visit(const Mul *) override;
+        void visit(const Div *) override;
+        void visit(const Mod *) override;
+        void visit(const Min *) override;
+        void visit(const Max *) override;
+        void visit(const EQ *) override;
+        void visit(const NE *) override;
+        void visit(const LT *) override;
+        void visit(const LE *) override;
+        void visit(const GT *) override;
+        void visit(const GE *) override;
+        void visit(const And *) override;
+        void visit(const Or *) override;
+        void visit(const Not *) override;
+        void visit(const Select *) override;
+        void visit(const Load *) override;
+        void visit(const Ramp *) override;
+        void visit(const Broadcast *) override;
+        void visit(const Call *) override;
+        void visit(const Let *) override;
+        void visit(const Shuffle *) override;
+        void visit(const VectorReduce *) override;
+        void visit(const LetStmt *) override;
+        void visit(const AssertStmt *) override;
+        void visit(const For *) override;
+        void visit(const Store *) override;
+        void visit(const Allocate *) override;
+        void visit(const Free *) override;
+        void visit(const IfThenElse *) override;
+        void visit(const Evaluate *) override;
+        void visit(const Prefetch *) override;
+        void visit(const Atomic *) override;
+
+        // How a buffer or allocation is accessed: through an access chain
+        // into the variable base_id, which either points to an array of
+        // the storage type, or to a struct wrapping a runtime array of it
+        // (for the storage buffers of the kernel arguments).
+        struct StorageAccess {
+            SpvId base_id = SpvInvalidId;
+            SpvStorageClass storage_class = SpvStorageClassMax;
+            Type storage_type;
+            bool is_buffer_struct = false;
+        };
+
+        SpvId emit(const Expr &e);
+        SpvId map_type(const Type &t);
+        Type storage_type_of(const Type &t) const;
+        SpvId int_constant(int32_t value);
+        SpvId uint_constant(uint32_t value);
+        SpvId scalar_constant(const Type &t, int64_t value);
+
+        SpvId emit_unary(SpvOp op_code, const Type &t, SpvId src_id);
+        SpvId emit_binary(SpvOp op_code, const Type &t, SpvId a_id, SpvId b_id);
+        SpvId emit_binary(SpvOp op_code, const Type &t, const Expr &a, const Expr &b);
+        SpvId emit_extended(GLSLstd450 inst, const Type &t, const std::vector<SpvId> &args);
+        SpvId emit_extract(const Type &t, SpvId vector_id, uint32_t lane);
+        SpvId emit_construct(const Type &t, const std::vector<SpvId> &components);
+        SpvId emit_convert(SpvId src_id, const Type &src_type, const Type &dst_type);
+        void emit_comparison(const Expr &a, const Expr &b,
+                             SpvOp signed_op, SpvOp unsigned_op, SpvOp float_op, SpvOp bool_op);
+
+        // Emit e with the given operands bound to lets, so that expressions
+        // built from them for lowering refer to each of them only once.
+        void emit_lowered(const std::vector<Expr> &operands,
+                          const std::function<Expr(const std::vector<Expr> &)> &lower);
+
+        std::vector<SpvId> emit_lane_indices(const Expr &index);
+        SpvId access_element(const StorageAccess &access, SpvId index_id);
+        SpvId load_element(const StorageAccess &access, SpvId index_id, const Type &value_type);
+        void store_element(const StorageAccess &access, SpvId index_id, SpvId value_id, const Type &value_type);
+
+        void begin_block(SpvId label_id);
+        void declare_scalar_args(const std::vector<DeviceArgument> &args);
+        void declare_buffer_args(const std::vector<DeviceArgument> &args);
+        SpvId declare_buffer_struct(const Type &storage_type);
+
+        SpvBuilder builder;
+        Target target;
+
+        // The id of the value of the last expression emitted.
+        SpvId id = SpvInvalidId;
+
+        Scope<SpvId> symbol_table;
+        Scope<StorageAccess> storage_access;
+
+        SpvId glsl_id = SpvInvalidId;
+        SpvId workgroup_id_var = SpvInvalidId;
+        SpvId local_invocation_id_var = SpvInvalidId;
+
+        // The struct types used for the storage buffers, by element type,
+        // and the types already decorated (which must be decorated once).
+        std::map<SpvId, SpvId> buffer_struct_types;
+        std::set<SpvId> decorated_types;
+
+        uint32_t workgroup_size[3] = {1, 1, 1};
+    };
+
+    std::unique_ptr<SPIRV_Emitter> emitter;
+    std::string current_kernel_name;
+    Target target;
+};
+
+// --
+
+CodeGen_Vulkan_Dev::SPIRV_Emitter::SPIRV_Emitter(const Target &t)
+    : target(t) {
+    builder.require_capability(SpvCapabilityShader);
+    builder.require_extension("SPV_KHR_storage_buffer_storage_class");
+    builder.set_addressing_model(SpvAddressingModelLogical);
+    builder.set_memory_model(SpvMemoryModelGLSL450);
+    glsl_id = builder.import_instruction_set("GLSL.std.450");
+
+    // The builtin ids of the workgroup and invocation, shared by all
+    // the kernels in the module.
+    SpvId uvec3_ptr_type_id = builder.map_pointer_type(UInt(32, 3), SpvStorageClassInput);
+    workgroup_id_var = builder.add_global_variable(uvec3_ptr_type_id, SpvStorageClassInput);
+    builder.add_annotation(workgroup_id_var, SpvDecorationBuiltIn, {SpvBuiltInWorkgroupId});
+    local_invocation_id_var = builder.add_global_variable(uvec3_ptr_type_id, SpvStorageClassInput);
+    builder.add_annotation(local_invocation_id_var, SpvDecorationBuiltIn, {SpvBuiltInLocalInvocationId});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::encode(SpvBinary &binary) const {
+    builder.encode(binary);
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit(const Expr &e) {
+    e.accept(this);
+    return id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::map_type(const Type &t) {
+    user_assert(t.bits() < 64)
+        << "The Vulkan backend does not support 64-bit types: " << t << "\n";
+    user_assert(t.lanes() <= 4)
+        << "The Vulkan backend supports vectors of at most 4 lanes, but encountered " << t << "\n";
+    if (t.is_float() && t.bits() == 16) {
+        user_assert(!t.is_bfloat()) << "The Vulkan backend does not support bfloat16\n";
+        builder.require_capability(SpvCapabilityFloat16);
+    } else if (t.is_int_or_uint() && t.bits() == 8) {
+        builder.require_capability(SpvCapabilityInt8);
+    } else if (t.is_int_or_uint() && t.bits() == 16) {
+        builder.require_capability(SpvCapabilityInt16);
+    }
+    return builder.map_type(t);
+}
+
+Type CodeGen_Vulkan_Dev::SPIRV_Emitter::storage_type_of(const Type &t) const {
+    // Booleans have no defined size, so they are stored as bytes.
+    return t.is_bool() ? UInt(8, t.lanes()) : t;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::int_constant(int32_t value) {
+    return builder.map_constant(Int(32), &value);
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::uint_constant(uint32_t value) {
+    return builder.map_constant(UInt(32), &value);
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::scalar_constant(const Type &t, int64_t value) {
+    internal_assert(t.is_scalar());
+    map_type(t);
+    if (t.is_bool()) {
+        return builder.map_bool_constant(value != 0);
+    } else if (t.is_float()) {
+        if (t.bits() == 16) {
+            uint16_t bits = float16_t((double)value).to_bits();
+            return builder.map_constant(t, &bits);
+        }
+        float f = (float)value;
+        return builder.map_constant(t, &f);
+    } else if (t.bits() == 8) {
+        int8_t v = (int8_t)value;
+        return builder.map_constant(t, &v);
+    } else if (t.bits() == 16) {
+        int16_t v = (int16_t)value;
+        return builder.map_constant(t, &v);
+    } else {
+        int32_t v = (int32_t)value;
+        return builder.map_constant(t, &v);
+    }
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_unary(SpvOp op_code, const Type &t, SpvId src_id) {
+    SpvId result_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::unary_op(op_code, map_type(t), result_id, src_id));
+    return result_id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_binary(SpvOp op_code, const Type &t, SpvId a_id, SpvId b_id) {
+    SpvId result_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::binary_op(op_code, map_type(t), result_id, a_id, b_id));
+    return result_id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_binary(SpvOp op_code, const Type &t, const Expr &a, const Expr &b) {
+    SpvId a_id = emit(a);
+    SpvId b_id = emit(b);
+    return emit_binary(op_code, t, a_id, b_id);
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_extended(GLSLstd450 inst, const Type &t, const std::vector<SpvId> &args) {
+    SpvId result_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::extended(glsl_id, inst, map_type(t), result_id, args));
+    return result_id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_extract(const Type &t, SpvId vector_id, uint32_t lane) {
+    SpvId result_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::composite_extract(map_type(t), result_id, vector_id, {lane}));
+    return result_id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_construct(const Type &t, const std::vector<SpvId> &components) {
+    if (t.is_scalar()) {
+        internal_assert(components.size() == 1);
+        return components[0];
+    }
+    SpvId result_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::composite_construct(map_type(t), result_id, components));
+    return result_id;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_convert(SpvId src_id, const Type &src, const Type &dst) {
+    if (src == dst) {
+        return src_id;
+    }
+    const int lanes = dst.lanes();
+    if (dst.is_bool()) {
+        if (src.is_float()) {
+            return emit_binary(SpvOpFUnordNotEqual, dst, src_id, emit(make_zero(src)));
+        }
+        return emit_binary(SpvOpINotEqual, dst, src_id, emit(make_zero(src)));
+    }
+    if (src.is_bool()) {
+        SpvId result_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::select(map_type(dst), result_id, src_id, emit(make_one(dst)), emit(make_zero(dst))));
+        return result_id;
+    }
+    if (src.is_float() && dst.is_float()) {
+        return emit_unary(SpvOpFConvert, dst, src_id);
+    } else if (src.is_float()) {
+        return emit_unary(dst.is_int() ? SpvOpConvertFToS : SpvOpConvertFToU, dst, src_id);
+    } else if (dst.is_float()) {
+        return emit_unary(src.is_int() ? SpvOpConvertSToF : SpvOpConvertUToF, dst, src_id);
+    }
+
+    // Integer to integer. Widen or narrow with the signedness of the
+    // source, then reinterpret as the signedness of the destination.
+    SpvId result_id = src_id;
+    Type t = src;
+    if (src.bits() != dst.bits()) {
+        t = src.with_bits(dst.bits());
+        result_id = emit_unary(src.is_int() ? SpvOpSConvert : SpvOpUConvert, t, result_id);
+    }
+    if (t != dst) {
+        internal_assert(t.lanes() == lanes);
+        SpvId cast_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::bitcast(map_type(dst), cast_id, result_id));
+        result_id = cast_id;
+    }
+    return result_id;
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_comparison(const Expr &a, const Expr &b,
+                                                        SpvOp signed_op, SpvOp unsigned_op,
+                                                        SpvOp float_op, SpvOp bool_op) {
+    const Type &t = a.type();
+    SpvOp op_code = signed_op;
+    if (t.is_bool()) {
+        internal_assert(bool_op != SpvOpNop) << "Vulkan: unsupported comparison of booleans\n";
+        op_code = bool_op;
+    } else if (t.is_float()) {
+        op_code = float_op;
+    } else if (t.is_uint()) {
+        op_code = unsigned_op;
+    }
+    id = emit_binary(op_code, Bool(t.lanes()), a, b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_lowered(const std::vector<Expr> &operands,
+                                                     const std::function<Expr(const std::vector<Expr> &)> &lower) {
+    std::vector<Expr> vars;
+    std::vector<std::string> names;
+    for (const Expr &e : operands) {
+        names.push_back(unique_name('t'));
+        vars.push_back(Variable::make(e.type(), names.back()));
+    }
+    Expr e = lower(vars);
+    for (size_t i = operands.size(); i > 0; i--) {
+        e = Let::make(names[i - 1], operands[i - 1], e);
+    }
+    e.accept(this);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::begin_block(SpvId label_id) {
+    SpvFunction func = builder.current_function();
+    SpvBlock block = SpvBlock::make(func, label_id);
+    func.add_block(block);
+    builder.leave_block();
+    builder.enter_block(block);
+}
+
+// -- Expressions
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const IntImm *op) {
+    id = scalar_constant(op->type, op->value);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const UIntImm *op) {
+    id = scalar_constant(op->type, (int64_t)op->value);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const FloatImm *op) {
+    map_type(op->type);
+    if (op->type.bits() == 16) {
+        uint16_t bits = float16_t(op->value).to_bits();
+        id = builder.map_constant(op->type, &bits);
+    } else {
+        float value = (float)op->value;
+        id = builder.map_constant(op->type, &value);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const StringImm *op) {
+    user_error << "The Vulkan backend does not support strings: \"" << op->value << "\"\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Cast *op) {
+    SpvId value_id = emit(op->value);
+    id = emit_convert(value_id, op->value.type(), op->type);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Reinterpret *op) {
+    SpvId value_id = emit(op->value);
+    if (op->type == op->value.type()) {
+        id = value_id;
+    } else {
+        id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::bitcast(map_type(op->type), id, value_id));
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Variable *op) {
+    internal_assert(symbol_table.contains(op->name))
+        << "Vulkan: variable " << op->name << " is not in scope\n";
+    id = symbol_table.get(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Add *op) {
+    id = emit_binary(op->type.is_float() ? SpvOpFAdd : SpvOpIAdd, op->type, op->a, op->b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Sub *op) {
+    id = emit_binary(op->type.is_float() ? SpvOpFSub : SpvOpISub, op->type, op->a, op->b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Mul *op) {
+    id = emit_binary(op->type.is_float() ? SpvOpFMul : SpvOpIMul, op->type, op->a, op->b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Div *op) {
+    if (op->type.is_float()) {
+        id = emit_binary(SpvOpFDiv, op->type, op->a, op->b);
+    } else if (op->type.is_uint()) {
+        id = emit_binary(SpvOpUDiv, op->type, op->a, op->b);
+    } else {
+        // SPIR-V division rounds towards zero
+        emit_lowered({op->a, op->b}, [](const std::vector<Expr> &v) {
+            return lower_euclidean_div(v[0], v[1]);
+        });
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Mod *op) {
+    if (op->type.is_float()) {
+        // OpFMod takes the sign of the divisor, like Halide's mod
+        id = emit_binary(SpvOpFMod, op->type, op->a, op->b);
+    } else if (op->type.is_uint()) {
+        id = emit_binary(SpvOpUMod, op->type, op->a, op->b);
+    } else {
+        emit_lowered({op->a, op->b}, [](const std::vector<Expr> &v) {
+            return lower_euclidean_mod(v[0], v[1]);
+        });
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Min *op) {
+    GLSLstd450 inst = op->type.is_float() ? GLSLstd450FMin : op->type.is_uint() ? GLSLstd450UMin : GLSLstd450SMin;
+    SpvId a_id = emit(op->a);
+    SpvId b_id = emit(op->b);
+    id = emit_extended(inst, op->type, {a_id, b_id});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Max *op) {
+    GLSLstd450 inst = op->type.is_float() ? GLSLstd450FMax : op->type.is_uint() ? GLSLstd450UMax : GLSLstd450SMax;
+    SpvId a_id = emit(op->a);
+    SpvId b_id = emit(op->b);
+    id = emit_extended(inst, op->type, {a_id, b_id});
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const EQ *op) {
+    emit_comparison(op->a, op->b, SpvOpIEqual, SpvOpIEqual, SpvOpFOrdEqual, SpvOpLogicalEqual);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const NE *op) {
+    // NaN != NaN is true
+    emit_comparison(op->a, op->b, SpvOpINotEqual, SpvOpINotEqual, SpvOpFUnordNotEqual, SpvOpLogicalNotEqual);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LT *op) {
+    emit_comparison(op->a, op->b, SpvOpSLessThan, SpvOpULessThan, SpvOpFOrdLessThan, SpvOpNop);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LE *op) {
+    emit_comparison(op->a, op->b, SpvOpSLessThanEqual, SpvOpULessThanEqual, SpvOpFOrdLessThanEqual, SpvOpNop);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const GT *op) {
+    emit_comparison(op->a, op->b, SpvOpSGreaterThan, SpvOpUGreaterThan, SpvOpFOrdGreaterThan, SpvOpNop);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const GE *op) {
+    emit_comparison(op->a, op->b, SpvOpSGreaterThanEqual, SpvOpUGreaterThanEqual, SpvOpFOrdGreaterThanEqual, SpvOpNop);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const And *op) {
+    id = emit_binary(SpvOpLogicalAnd, op->type, op->a, op->b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Or *op) {
+    id = emit_binary(SpvOpLogicalOr, op->type, op->a, op->b);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Not *op) {
+    SpvId a_id = emit(op->a);
+    id = emit_unary(SpvOpLogicalNot, op->type, a_id);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Select *op) {
+    Expr condition = op->condition;
+    if (condition.type().is_scalar() && op->type.is_vector()) {
+        // SPIR-V 1.0 requires a condition with a lane per lane of the result
+        condition = Broadcast::make(condition, op->type.lanes());
+    }
+    SpvId condition_id = emit(condition);
+    SpvId true_id = emit(op->true_value);
+    SpvId false_id = emit(op->false_value);
+    id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::select(map_type(op->type), id, condition_id, true_id, false_id));
+}
+
+std::vector<SpvId> CodeGen_Vulkan_Dev::SPIRV_Emitter::emit_lane_indices(const Expr &index) {
+    std::vector<SpvId> indices;
+    const Ramp *ramp = index.as<Ramp>();
+    if (ramp && ramp->base.type().is_scalar()) {
+        // Compute the index of each lane directly, rather than
+        // constructing a vector just to take it apart again.
+        SpvId base_id = emit(ramp->base);
+        SpvId stride_id = emit(ramp->stride);
+        indices.push_back(base_id);
+        for (int i = 1; i < ramp->lanes; i++) {
+            SpvId offset_id = emit_binary(SpvOpIMul, Int(32), stride_id, int_constant(i));
+            indices.push_back(emit_binary(SpvOpIAdd, Int(32), base_id, offset_id));
+        }
+    } else {
+        SpvId index_id = emit(index);
+        for (int i = 0; i < index.type().lanes(); i++) {
+            indices.push_back(emit_extract(Int(32), index_id, i));
+        }
+    }
+    return indices;
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::access_element(const StorageAccess &access, SpvId index_id) {
+    SpvId ptr_type_id = builder.map_pointer_type(map_type(access.storage_type), access.storage_class);
+    if (access.is_buffer_struct) {
+        return builder.declare_access_chain(ptr_type_id, access.base_id, int_constant(0), {index_id});
+    } else {
+        return builder.declare_access_chain(ptr_type_id, access.base_id, index_id, {});
+    }
+}
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::load_element(const StorageAccess &access, SpvId index_id, const Type &value_type) {
+    SpvId ptr_id = access_element(access, index_id);
+    SpvId value_id = builder.reserve_id(SpvResultId);
+    builder.append(SpvFactory::load(map_type(access.storage_type), value_id, ptr_id));
+    if (value_type.is_bool()) {
+        return emit_convert(value_id, access.storage_type, value_type);
+    } else if (value_type != access.storage_type) {
+        user_assert(value_type.bits() == access.storage_type.bits())
+            << "The Vulkan backend cannot load " << value_type
+            << " from a buffer of " << access.storage_type << "\n";
+        SpvId cast_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::bitcast(map_type(value_type), cast_id, value_id));
+        return cast_id;
+    }
+    return value_id;
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::store_element(const StorageAccess &access, SpvId index_id, SpvId value_id, const Type &value_type) {
+    if (value_type.is_bool()) {
+        value_id = emit_convert(value_id, value_type, access.storage_type);
+    } else if (value_type != access.storage_type) {
+        user_assert(value_type.bits() == access.storage_type.bits())
+            << "The Vulkan backend cannot store " << value_type
+            << " to a buffer of " << access.storage_type << "\n";
+        SpvId cast_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::bitcast(map_type(access.storage_type), cast_id, value_id));
+        value_id = cast_id;
+    }
+    SpvId ptr_id = access_element(access, index_id);
+    builder.append(SpvFactory::store(ptr_id, value_id));
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Load *op) {
+    user_assert(is_const_one(op->predicate))
+        << "The Vulkan backend does not support predicated loads\n";
+    internal_assert(storage_access.contains(op->name))
+        << "Vulkan: load from unknown buffer " << op->name << "\n";
+    const StorageAccess &access = storage_access.get(op->name);
+    if (op->type.is_scalar()) {
+        SpvId index_id = emit(op->index);
+        id = load_element(access, index_id, op->type);
+    } else {
+        std::vector<SpvId> indices = emit_lane_indices(op->index);
+        std::vector<SpvId> lanes;
+        for (SpvId index_id : indices) {
+            lanes.push_back(load_element(access, index_id, op->type.element_of()));
+        }
+        id = emit_construct(op->type, lanes);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Ramp *op) {
+    user_assert(op->base.type().is_scalar())
+        << "The Vulkan backend does not support nested vectors\n";
+    SpvId base_id = emit(op->base);
+    SpvId stride_id = emit(op->stride);
+    const Type scalar_type = op->type.element_of();
+    const SpvOp add_op = scalar_type.is_float() ? SpvOpFAdd : SpvOpIAdd;
+    const SpvOp mul_op = scalar_type.is_float() ? SpvOpFMul : SpvOpIMul;
+    std::vector<SpvId> lanes = {base_id};
+    for (int i = 1; i < op->lanes; i++) {
+        SpvId offset_id = emit_binary(mul_op, scalar_type, stride_id, scalar_constant(scalar_type, i));
+        lanes.push_back(emit_binary(add_op, scalar_type, base_id, offset_id));
+    }
+    id = emit_construct(op->type, lanes);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Broadcast *op) {
+    SpvId value_id = emit(op->value);
+    std::vector<SpvId> lanes;
+    for (int i = 0; i < op->lanes; i++) {
+        if (op->value.type().is_scalar()) {
+            lanes.push_back(value_id);
+        } else {
+            for (int j = 0; j < op->value.type().lanes(); j++) {
+                lanes.push_back(emit_extract(op->type.element_of(), value_id, j));
+            }
+        }
+    }
+    id = emit_construct(op->type, lanes);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Shuffle *op) {
+    std::vector<SpvId> vector_ids;
+    for (const Expr &e : op->vectors) {
+        vector_ids.push_back(emit(e));
+    }
+    const Type scalar_type = op->type.element_of();
+    std::vector<SpvId> lanes;
+    for (int index : op->indices) {
+        size_t i = 0;
+        while (index >= op->vectors[i].type().lanes()) {
+            index -= op->vectors[i].type().lanes();
+            i++;
+        }
+        if (op->vectors[i].type().is_scalar()) {
+            lanes.push_back(vector_ids[i]);
+        } else {
+            lanes.push_back(emit_extract(scalar_type, vector_ids[i], index));
+        }
+    }
+    id = emit_construct(op->type, lanes);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const VectorReduce *op) {
+    // Reduce each group of lanes with scalar ops
+    const VectorReduce::Operator reduce_op = op->op;
+    const int output_lanes = op->type.lanes();
+    const int factor = op->value.type().lanes() / output_lanes;
+    emit_lowered({op->value}, [=](const std::vector<Expr> &v) {
+        std::vector<Expr> lanes;
+        for (int i = 0; i < output_lanes; i++) {
+            Expr result = Shuffle::make_extract_element(v[0], i * factor);
+            for (int j = 1; j < factor; j++) {
+                Expr x = Shuffle::make_extract_element(v[0], i * factor + j);
+                switch (reduce_op) {
+                case VectorReduce::Add:
+                    result = result + x;
+                    break;
+                case VectorReduce::SaturatingAdd:
+                    result = saturating_add(result, x);
+                    break;
+                case VectorReduce::Mul:
+                    result = result * x;
+                    break;
+                case VectorReduce::Min:
+                    result = min(result, x);
+                    break;
+                case VectorReduce::Max:
+                    result = max(result, x);
+                    break;
+                case VectorReduce::And:
+                    result = result && x;
+                    break;
+                case VectorReduce::Or:
+                    result = result || x;
+                    break;
+                }
+            }
+            lanes.push_back(result);
+        }
+        return lanes.size() == 1 ? lanes[0] : Shuffle::make_concat(lanes);
+    });
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Let *op) {
+    SpvId value_id = emit(op->value);
+    symbol_table.push(op->name, value_id);
+    op->body.accept(this);
+    symbol_table.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Call *op) {
+    if (op->is_intrinsic(Call::gpu_thread_barrier)) {
+        internal_assert(op->args.size() == 1) << "gpu_thread_barrier() intrinsic must specify memory fence type.\n";
+        const auto *fence_type_ptr = as_const_int(op->args[0]);
+        internal_assert(fence_type_ptr) << "gpu_thread_barrier() parameter is not a constant integer.\n";
+        const int fence_type = (int)*fence_type_ptr;
+
+        uint32_t memory_scope = SpvScopeWorkgroup;
+        uint32_t semantics = SpvMemorySemanticsAcquireReleaseMask | SpvMemorySemanticsWorkgroupMemoryMask;
+        if (fence_type & CodeGen_GPU_Dev::MemoryFenceType::Device) {
+            memory_scope = SpvScopeDevice;
+            semantics |= SpvMemorySemanticsUniformMemoryMask;
+        }
+        builder.append(SpvFactory::control_barrier(uint_constant(SpvScopeWorkgroup),
+                                                   uint_constant(memory_scope),
+                                                   uint_constant(semantics)));
+        id = int_constant(0);
+    } else if (op->is_intrinsic(Call::if_then_else)) {
+        if (op->args[0].type().is_vector()) {
+            Expr false_value = op->args.size() == 3 ? op->args[2] : make_zero(op->type);
+            Select::make(op->args[0], op->args[1], false_value).accept(this);
+            return;
+        }
+        // Only evaluate the branch that is taken
+        SpvId condition_id = emit(op->args[0]);
+        SpvId then_label_id = builder.reserve_id(SpvBlockId);
+        SpvId else_label_id = builder.reserve_id(SpvBlockId);
+        SpvId merge_label_id = builder.reserve_id(SpvBlockId);
+        builder.append(SpvFactory::selection_merge(merge_label_id));
+        builder.append(SpvFactory::conditional_branch(condition_id, then_label_id, else_label_id));
+
+        begin_block(then_label_id);
+        SpvId then_id = emit(op->args[1]);
+        SpvId then_end_label_id = builder.current_block().id();
+        builder.append(SpvFactory::branch(merge_label_id));
+
+        begin_block(else_label_id);
+        SpvId else_id = op->args.size() == 3 ? emit(op->args[2]) : emit(make_zero(op->type));
+        SpvId else_end_label_id = builder.current_block().id();
+        builder.append(SpvFactory::branch(merge_label_id));
+
+        begin_block(merge_label_id);
+        id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::phi(map_type(op->type), id, {{then_id, then_end_label_id}, {else_id, else_end_label_id}}));
+    } else if (op->is_intrinsic(Call::bitwise_and) ||
+               op->is_intrinsic(Call::bitwise_or) ||
+               op->is_intrinsic(Call::bitwise_xor)) {
+        SpvOp op_code;
+        if (op->type.is_bool()) {
+            op_code = op->is_intrinsic(Call::bitwise_and) ? SpvOpLogicalAnd :
+                      op->is_intrinsic(Call::bitwise_or)  ? SpvOpLogicalOr :
+                                                            SpvOpLogicalNotEqual;
+        } else {
+            op_code = op->is_intrinsic(Call::bitwise_and) ? SpvOpBitwiseAnd :
+                      op->is_intrinsic(Call::bitwise_or)  ? SpvOpBitwiseOr :
+                                                            SpvOpBitwiseXor;
+        }
+        id = emit_binary(op_code, op->type, op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::bitwise_not)) {
+        SpvId a_id = emit(op->args[0]);
+        id = emit_unary(op->type.is_bool() ? SpvOpLogicalNot : SpvOpNot, op->type, a_id);
+    } else if (op->is_intrinsic(Call::shift_left) || op->is_intrinsic(Call::shift_right)) {
+        const bool left = op->is_intrinsic(Call::shift_left);
+        if (op->args[1].type().is_int()) {
+            // The shift amount may be negative
+            emit_lowered({op->args[0], op->args[1]}, [=](const std::vector<Expr> &v) {
+                return left ? lower_signed_shift_left(v[0], v[1]) : lower_signed_shift_right(v[0], v[1]);
+            });
+        } else {
+            SpvOp op_code = left ? SpvOpShiftLeftLogical : op->type.is_int() ? SpvOpShiftRightArithmetic :
+                                                                                 SpvOpShiftRightLogical;
+            id = emit_binary(op_code, op->type, op->args[0], op->args[1]);
+        }
+    } else if (op->is_intrinsic(Call::abs)) {
+        const Type &arg_type = op->args[0].type();
+        SpvId a_id = emit(op->args[0]);
+        if (arg_type.is_float()) {
+            id = emit_extended(GLSLstd450FAbs, op->type, {a_id});
+        } else if (arg_type.is_int()) {
+            // The result of abs of a signed integer is unsigned
+            SpvId abs_id = emit_extended(GLSLstd450SAbs, arg_type, {a_id});
+            id = emit_convert(abs_id, arg_type, op->type);
+        } else {
+            id = a_id;
+        }
+    } else if (op->is_intrinsic(Call::absd)) {
+        emit_lowered({op->args[0], op->args[1]}, [=](const std::vector<Expr> &v) {
+            if (op->type.is_float()) {
+                return abs(v[0] - v[1]);
+            }
+            Expr ua = reinterpret(op->type, v[0]);
+            Expr ub = reinterpret(op->type, v[1]);
+            return select(v[0] < v[1], ub - ua, ua - ub);
+        });
+    } else if (op->is_intrinsic(Call::div_round_to_zero)) {
+        id = emit_binary(op->type.is_int() ? SpvOpSDiv : SpvOpUDiv, op->type, op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::mod_round_to_zero)) {
+        id = emit_binary(op->type.is_int() ? SpvOpSRem : SpvOpUMod, op->type, op->args[0], op->args[1]);
+    } else if (op->is_intrinsic(Call::lerp)) {
+        emit_lowered({op->args[0], op->args[1], op->args[2]}, [=](const std::vector<Expr> &v) {
+            return lower_lerp(op->type, v[0], v[1], v[2], target);
+        });
+    } else if (op->is_intrinsic(Call::mux)) {
+        lower_mux(op).accept(this);
+    } else if (op->is_intrinsic(Call::round)) {
+        SpvId a_id = emit(op->args[0]);
+        id = emit_extended(GLSLstd450RoundEven, op->type, {a_id});
+    } else if (op->is_intrinsic(Call::popcount)) {
+        user_assert(op->args[0].type().bits() == 32)
+            << "The Vulkan backend only supports popcount of 32-bit integers\n";
+        SpvId a_id = emit(op->args[0]);
+        id = emit_unary(SpvOpBitCount, op->args[0].type(), a_id);
+        id = emit_convert(id, op->args[0].type(), op->type);
+    } else if (op->is_intrinsic(Call::likely) ||
+               op->is_intrinsic(Call::likely_if_innermost) ||
+               op->is_intrinsic(Call::promise_clamped) ||
+               op->is_intrinsic(Call::unsafe_promise_clamped) ||
+               op->is_intrinsic(Call::strict_float)) {
+        op->args[0].accept(this);
+    } else if (op->is_intrinsic(Call::return_second)) {
+        op->args[0].accept(this);
+        op->args[1].accept(this);
+    } else if (op->is_intrinsic(Call::prefetch)) {
+        id = int_constant(0);
+    } else if (op->is_intrinsic()) {
+        Expr lowered = lower_intrinsic(op);
+        user_assert(lowered.defined())
+            << "The Vulkan backend does not support the intrinsic " << op->name << "\n";
+        lowered.accept(this);
+    } else if (op->type.is_float() && op->call_type == Call::PureExtern) {
+        // The math library
+        std::string name = op->name;
+        if (ends_with(name, "_f32") || ends_with(name, "_f16")) {
+            name = name.substr(0, name.size() - 4);
+        }
+        static const std::map<std::string, GLSLstd450> glsl_math = {
+            {"abs", GLSLstd450FAbs},
+            {"floor", GLSLstd450Floor},
+            {"ceil", GLSLstd450Ceil},
+            {"round", GLSLstd450RoundEven},
+            {"trunc", GLSLstd450Trunc},
+            {"sqrt", GLSLstd450Sqrt},
+            {"fast_inverse_sqrt", GLSLstd450InverseSqrt},
+            {"sin", GLSLstd450Sin},
+            {"cos", GLSLstd450Cos},
+            {"tan", GLSLstd450Tan},
+            {"asin", GLSLstd450Asin},
+            {"acos", GLSLstd450Acos},
+            {"atan", GLSLstd450Atan},
+            {"atan2", GLSLstd450Atan2},
+            {"sinh", GLSLstd450Sinh},
+            {"cosh", GLSLstd450Cosh},
+            {"tanh", GLSLstd450Tanh},
+            {"asinh", GLSLstd450Asinh},
+            {"acosh", GLSLstd450Acosh},
+            {"atanh", GLSLstd450Atanh},
+            {"exp", GLSLstd450Exp},
+            {"log", GLSLstd450Log},
+            {"pow", GLSLstd450Pow},
+        };
+        auto it = glsl_math.find(name);
+        if (it != glsl_math.end()) {
+            std::vector<SpvId> args;
+            for (const Expr &e : op->args) {
+                args.push_back(emit(e));
+            }
+            id = emit_extended(it->second, op->type, args);
+        } else if (name == "fast_inverse") {
+            id = emit_binary(SpvOpFDiv, op->type, make_one(op->type), op->args[0]);
+        } else if (name == "nan" || name == "inf" || name == "neg_inf") {
+            const float value = name == "nan" ? NAN : name == "inf" ? INFINITY : -INFINITY;
+            Expr(FloatImm::make(op->type, value)).accept(this);
+        } else {
+            user_error << "The Vulkan backend does not support the function " << op->name << "\n";
+        }
+    } else if (op->type.is_bool() && op->call_type == Call::PureExtern &&
+               (starts_with(op->name, "is_nan_") ||
+                starts_with(op->name, "is_inf_") ||
+                starts_with(op->name, "is_finite_"))) {
+        SpvId a_id = emit(op->args[0]);
+        if (starts_with(op->name, "is_nan_")) {
+            id = emit_unary(SpvOpIsNan, op->type, a_id);
+        } else if (starts_with(op->name, "is_inf_")) {
+            id = emit_unary(SpvOpIsInf, op->type, a_id);
+        } else {
+            SpvId nan_id = emit_unary(SpvOpIsNan, op->type, a_id);
+            SpvId inf_id = emit_unary(SpvOpIsInf, op->type, a_id);
+            SpvId either_id = emit_binary(SpvOpLogicalOr, op->type, nan_id, inf_id);
+            id = emit_unary(SpvOpLogicalNot, op->type, either_id);
+        }
+    } else {
+        user_error << "The Vulkan backend does not support calls to " << op->name << "\n";
+    }
+}
+
+// -- Statements
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const LetStmt *op) {
+    SpvId value_id = emit(op->value);
+    symbol_table.push(op->name, value_id);
+    op->body.accept(this);
+    symbol_table.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const AssertStmt *op) {
+    // Asserts are checked on the host
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Evaluate *op) {
+    if (!is_const(op->value)) {
+        op->value.accept(this);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Prefetch *op) {
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Atomic *op) {
+    user_error << "The Vulkan backend does not support atomics\n";
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const For *op) {
+    user_assert(op->for_type != ForType::GPULane)
+        << "The Vulkan backend does not support the gpu_lanes() scheduling directive.\n";
+
+    if (CodeGen_GPU_Dev::is_gpu_var(op->name)) {
+        internal_assert((op->for_type == ForType::GPUBlock) ||
+                        (op->for_type == ForType::GPUThread))
+            << "kernel loop must be either gpu block or gpu thread\n";
+        internal_assert(is_const_zero(op->min));
+
+        const bool is_block = CodeGen_GPU_Dev::is_gpu_block_var(op->name);
+        const char dim = op->name.back();
+        user_assert(dim >= 'x' && dim <= 'z')
+            << "The Vulkan backend supports at most three gpu block and thread dimensions\n";
+        const uint32_t index = dim - 'x';
+
+        if (!is_block) {
+            // The workgroup size is fixed by the shader
+            const IntImm *extent = op->extent.as<IntImm>();
+            user_assert(extent)
+                << "The Vulkan backend requires gpu thread loops with constant extents, but the extent of "
+                << op->name << " is " << op->extent << "\n";
+            workgroup_size[index] = extent->value;
+        }
+
+        SpvId var_id = is_block ? workgroup_id_var : local_invocation_id_var;
+        SpvId uvec3_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::load(map_type(UInt(32, 3)), uvec3_id, var_id));
+        SpvId coordinate_id = emit_extract(UInt(32), uvec3_id, index);
+        SpvId value_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::bitcast(map_type(Int(32)), value_id, coordinate_id));
+
+        symbol_table.push(op->name, value_id);
+        op->body.accept(this);
+        symbol_table.pop(op->name);
+    } else {
+        user_assert(op->for_type != ForType::Parallel)
+            << "Cannot use parallel loops inside Vulkan kernel\n";
+        internal_assert(op->min.type() == Int(32));
+
+        // for (i = min; i < min + extent; i++) { body }, with i in a
+        // function variable
+        SpvId min_id = emit(op->min);
+        SpvId extent_id = emit(op->extent);
+        SpvId max_id = emit_binary(SpvOpIAdd, Int(32), min_id, extent_id);
+        SpvId counter_ptr_type_id = builder.map_pointer_type(map_type(Int(32)), SpvStorageClassFunction);
+        SpvId counter_var_id = builder.add_variable(counter_ptr_type_id, SpvStorageClassFunction);
+        builder.append(SpvFactory::store(counter_var_id, min_id));
+
+        SpvId header_label_id = builder.reserve_id(SpvBlockId);
+        SpvId body_label_id = builder.reserve_id(SpvBlockId);
+        SpvId continue_label_id = builder.reserve_id(SpvBlockId);
+        SpvId merge_label_id = builder.reserve_id(SpvBlockId);
+        builder.append(SpvFactory::branch(header_label_id));
+
+        begin_block(header_label_id);
+        SpvId counter_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::load(map_type(Int(32)), counter_id, counter_var_id));
+        SpvId test_id = emit_binary(SpvOpSLessThan, Bool(), counter_id, max_id);
+        builder.append(SpvFactory::loop_merge(merge_label_id, continue_label_id));
+        builder.append(SpvFactory::conditional_branch(test_id, body_label_id, merge_label_id));
+
+        begin_block(body_label_id);
+        symbol_table.push(op->name, counter_id);
+        op->body.accept(this);
+        symbol_table.pop(op->name);
+        builder.append(SpvFactory::branch(continue_label_id));
+
+        begin_block(continue_label_id);
+        SpvId next_id = emit_binary(SpvOpIAdd, Int(32), counter_id, int_constant(1));
+        builder.append(SpvFactory::store(counter_var_id, next_id));
+        builder.append(SpvFactory::branch(header_label_id));
+
+        begin_block(merge_label_id);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Store *op) {
+    user_assert(is_const_one(op->predicate))
+        << "The Vulkan backend does not support predicated stores\n";
+    internal_assert(storage_access.contains(op->name))
+        << "Vulkan: store to unknown buffer " << op->name << "\n";
+    const StorageAccess &access = storage_access.get(op->name);
+    const Type value_type = op->value.type();
+    SpvId value_id = emit(op->value);
+    if (value_type.is_scalar()) {
+        SpvId index_id = emit(op->index);
+        store_element(access, index_id, value_id, value_type);
+    } else {
+        std::vector<SpvId> indices = emit_lane_indices(op->index);
+        for (size_t i = 0; i < indices.size(); i++) {
+            SpvId lane_id = emit_extract(value_type.element_of(), value_id, i);
+            store_element(access, indices[i], lane_id, value_type.element_of());
+        }
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Allocate *op) {
+    user_assert(!op->new_expr.defined())
+        << "The Vulkan backend does not support custom allocators\n";
+    int32_t size = op->constant_allocation_size();
+    user_assert(size > 0)
+        << "The Vulkan backend requires allocations inside kernels to have a constant size, but "
+        << op->name << " does not\n";
+
+    StorageAccess access;
+    access.storage_type = storage_type_of(op->type.element_of());
+    // map_type treats an array of one element as a scalar
+    const uint32_t array_size = std::max(size * op->type.lanes(), 2);
+    SpvId array_type_id = builder.map_type(access.storage_type, array_size);
+    map_type(access.storage_type);
+    if (op->memory_type == MemoryType::GPUShared) {
+        access.storage_class = SpvStorageClassWorkgroup;
+        SpvId ptr_type_id = builder.map_pointer_type(array_type_id, access.storage_class);
+        access.base_id = builder.add_global_variable(ptr_type_id, access.storage_class);
+    } else {
+        access.storage_class = SpvStorageClassFunction;
+        SpvId ptr_type_id = builder.map_pointer_type(array_type_id, access.storage_class);
+        access.base_id = builder.add_variable(ptr_type_id, access.storage_class);
+    }
+
+    storage_access.push(op->name, access);
+    op->body.accept(this);
+    storage_access.pop(op->name);
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const Free *op) {
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::visit(const IfThenElse *op) {
+    SpvId condition_id = emit(op->condition);
+    SpvId then_label_id = builder.reserve_id(SpvBlockId);
+    SpvId merge_label_id = builder.reserve_id(SpvBlockId);
+    SpvId else_label_id = op->else_case.defined() ? builder.reserve_id(SpvBlockId) : merge_label_id;
+    builder.append(SpvFactory::selection_merge(merge_label_id));
+    builder.append(SpvFactory::conditional_branch(condition_id, then_label_id, else_label_id));
+
+    begin_block(then_label_id);
+    op->then_case.accept(this);
+    builder.append(SpvFactory::branch(merge_label_id));
+
+    if (op->else_case.defined()) {
+        begin_block(else_label_id);
+        op->else_case.accept(this);
+        builder.append(SpvFactory::branch(merge_label_id));
+    }
+
+    begin_block(merge_label_id);
+}
+
+// -- Kernels
+
+SpvId CodeGen_Vulkan_Dev::SPIRV_Emitter::declare_buffer_struct(const Type &storage_type) {
+    SpvId element_type_id = map_type(storage_type);
+    auto it = buffer_struct_types.find(element_type_id);
+    if (it != buffer_struct_types.end()) {
+        return it->second;
+    }
+
+    // struct { T data[]; }
+    SpvId array_type_id = builder.declare_runtime_array(element_type_id);
+    builder.add_annotation(array_type_id, SpvDecorationArrayStride, {(uint32_t)storage_type.bytes()});
+    SpvId struct_type_id = builder.declare_struct({array_type_id});
+    builder.add_struct_annotation(struct_type_id, 0, SpvDecorationOffset, {0});
+    builder.add_annotation(struct_type_id, SpvDecorationBlock);
+    buffer_struct_types[element_type_id] = struct_type_id;
+    return struct_type_id;
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::declare_scalar_args(const std::vector<DeviceArgument> &args) {
+    // Each scalar argument occupies one 32-bit member of a uniform buffer,
+    // sign extended if it is signed and zero extended otherwise.
+    std::vector<Type> member_types;
+    std::vector<const DeviceArgument *> scalar_args;
+    for (const DeviceArgument &arg : args) {
+        if (!arg.is_buffer) {
+            user_assert(arg.type.bits() <= 32)
+                << "The Vulkan backend does not support 64-bit arguments: " << arg.name << "\n";
+            Type member_type = UInt(32);
+            if (arg.type.is_int()) {
+                member_type = Int(32);
+            } else if (arg.type.is_float() && arg.type.bits() == 32) {
+                member_type = Float(32);
+            }
+            member_types.push_back(member_type);
+            scalar_args.push_back(&arg);
+        }
+    }
+    if (scalar_args.empty()) {
+        return;
+    }
+
+    std::vector<SpvId> member_type_ids;
+    for (const Type &t : member_types) {
+        member_type_ids.push_back(map_type(t));
+    }
+    SpvId struct_type_id = builder.map_struct(member_type_ids);
+    if (!decorated_types.count(struct_type_id)) {
+        for (uint32_t i = 0; i < member_type_ids.size(); i++) {
+            builder.add_struct_annotation(struct_type_id, i, SpvDecorationOffset, {i * 4});
+        }
+        builder.add_annotation(struct_type_id, SpvDecorationBlock);
+        decorated_types.insert(struct_type_id);
+    }
+    SpvId ptr_type_id = builder.map_pointer_type(struct_type_id, SpvStorageClassUniform);
+    SpvId var_id = builder.add_global_variable(ptr_type_id, SpvStorageClassUniform);
+    builder.add_annotation(var_id, SpvDecorationDescriptorSet, {0});
+    builder.add_annotation(var_id, SpvDecorationBinding, {scalar_args_binding});
+
+    for (size_t i = 0; i < scalar_args.size(); i++) {
+        const Type &member_type = member_types[i];
+        const Type &arg_type = scalar_args[i]->type;
+        SpvId member_ptr_type_id = builder.map_pointer_type(member_type_ids[i], SpvStorageClassUniform);
+        SpvId member_ptr_id = builder.declare_access_chain(member_ptr_type_id, var_id, int_constant(i), {});
+        SpvId value_id = builder.reserve_id(SpvResultId);
+        builder.append(SpvFactory::load(member_type_ids[i], value_id, member_ptr_id));
+        if (arg_type.is_float() && arg_type.bits() == 16) {
+            value_id = emit_convert(value_id, member_type, UInt(16));
+            SpvId cast_id = builder.reserve_id(SpvResultId);
+            builder.append(SpvFactory::bitcast(map_type(arg_type), cast_id, value_id));
+            value_id = cast_id;
+        } else {
+            value_id = emit_convert(value_id, member_type, arg_type);
+        }
+        symbol_table.push(scalar_args[i]->name, value_id);
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::declare_buffer_args(const std::vector<DeviceArgument> &args) {
+    uint32_t binding = first_buffer_binding;
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            StorageAccess access;
+            access.storage_type = storage_type_of(arg.type);
+            access.storage_class = SpvStorageClassStorageBuffer;
+            access.is_buffer_struct = true;
+            if (access.storage_type.bits() == 8) {
+                builder.require_capability(SpvCapabilityStorageBuffer8BitAccess);
+                builder.require_extension("SPV_KHR_8bit_storage");
+            } else if (access.storage_type.bits() == 16) {
+                builder.require_capability(SpvCapabilityStorageBuffer16BitAccess);
+                builder.require_extension("SPV_KHR_16bit_storage");
+            }
+            SpvId struct_type_id = declare_buffer_struct(access.storage_type);
+            SpvId ptr_type_id = builder.map_pointer_type(struct_type_id, SpvStorageClassStorageBuffer);
+            access.base_id = builder.add_global_variable(ptr_type_id, SpvStorageClassStorageBuffer);
+            builder.add_annotation(access.base_id, SpvDecorationDescriptorSet, {0});
+            builder.add_annotation(access.base_id, SpvDecorationBinding, {binding++});
+            storage_access.push(arg.name, access);
+        }
+    }
+}
+
+void CodeGen_Vulkan_Dev::SPIRV_Emitter::add_kernel(const Stmt &s,
+                                                   const std::string &name,
+                                                   const std::vector<DeviceArgument> &args) {
+    debug(2) << "Adding Vulkan kernel " << name << "\n";
+
+    workgroup_size[0] = workgroup_size[1] = workgroup_size[2] = 1;
+
+    // void name() { ... }
+    SpvId void_type_id = builder.map_type(Handle());
+    SpvFunction kernel_func = builder.add_function(void_type_id);
+    builder.enter_function(kernel_func);
+
+    declare_scalar_args(args);
+    declare_buffer_args(args);
+
+    s.accept(this);
+    builder.append(SpvFactory::return_stmt());
+    builder.leave_function();
+
+    for (const DeviceArgument &arg : args) {
+        if (arg.is_buffer) {
+            storage_access.pop(arg.name);
+        } else {
+            symbol_table.pop(arg.name);
+        }
+    }
+
+    builder.add_entry_point(name, kernel_func.id(), SpvExecutionModelGLCompute,
+                            {workgroup_id_var, local_invocation_id_var});
+    builder.add_execution_mode_local_size(kernel_func.id(), workgroup_size[0], workgroup_size[1], workgroup_size[2]);
+}
+
+// --
+
+CodeGen_Vulkan_Dev::CodeGen_Vulkan_Dev(const Target &t)
+    : emitter(std::make_unique<SPIRV_Emitter>(t)), target(t) {
+}
+
+void CodeGen_Vulkan_Dev::add_kernel(Stmt stmt,
+                                    const std::string &name,
+                                    const std::vector<DeviceArgument> &args) {
+    debug(2) << "CodeGen_Vulkan_Dev::compile " << name << "\n";
+
+    current_kernel_name = name;
+    Stmt s = stmt;
+    s = CodeGen_GPU_Dev::scalarize_predicated_loads_stores(s);
+    emitter->add_kernel(s, name, args);
+}
+
+void CodeGen_Vulkan_Dev::init_module() {
+    // The builder accumulates a single SPIR-V module for all the kernels
+    emitter = std::make_unique<SPIRV_Emitter>(target);
+    current_kernel_name = "";
+}
+
+std::vector<char> CodeGen_Vulkan_Dev::compile_to_src() {
+    SpvBinary binary;
+    emitter->encode(binary);
+    debug(1) << "SPIR-V module: " << binary.size() << " words\n";
+    std::vector<char> buffer(binary.size() * sizeof(uint32_t));
+    memcpy(buffer.data(), binary.data(), buffer.size());
+    return buffer;
+}
+
+std::string CodeGen_Vulkan_Dev::get_current_kernel_name() {
+    return current_kernel_name;
+}
+
+void CodeGen_Vulkan_Dev::dump() {
+    SpvBinary binary;
+    emitter->encode(binary);
+    std::ostringstream os;
+    os << std::hex;
+    for (size_t i = 0; i < binary.size(); i++) {
+        os << (i % 8 == 0 ? "\n" : " ") << std::setw(8) << std::setfill('0') << binary[i];
+    }
+    std::cerr << "SPIR-V module (" << binary.size() << " words):" << os.str() << "\n";
+}
+
+std::string CodeGen_Vulkan_Dev::print_gpu_name(const std::string &name) {
+    return name;
+}
+
+}  // namespace
+
+std::unique_ptr<CodeGen_GPU_Dev> new_CodeGen_Vulkan_Dev(const Target &target) {
+    return std::make_unique<CodeGen_Vulkan_Dev>(target);
+}
+
+#else  // WITH_SPIRV
+
+std::unique_ptr<CodeGen_GPU_Dev> new_CodeGen_Vulkan_Dev(const Target &target) {
+    user_error << "Vulkan not enabled for this build of Halide.\n";
+    return nullptr;
+}
+
+#endif  // WITH_SPIRV
+
+}  // namespace Internal
+}  // namespace Halide
@@ -1,11 +1,13 @@
 #include <functional>
 #include <sstream>
 
+#include "Bounds.h"
 #include "CodeGen_Posix.h"
 #include "ConciseCasts.h"
 #include "IRMatch.h"
 #include "IROperator.h"
 #include "LLVM_Headers.h"
+#include "Simplify.h"
 
 namespace Halide {
 namespace Internal {
@@ -36,6 +38,8 @@ protected:
     int native_vector_bits() const override;
     bool use_pic() const override;
 
+    void visit(const Add *) override;
+    void visit(const Sub *) override;
     void visit(const Cast *) override;
     void visit(const Call *) override;
     void codegen_vector_reduce(const VectorReduce *, const Expr &) override;
@@ -109,6 +113,18 @@ const WasmIntrinsic intrinsic_defs[] = {
     {"extend_i32x4_to_i64x4", Int(64, 4), "widen_integer", {Int(32, 4)}, Target::WasmSimd128},
     {"extend_u32x4_to_u64x4", UInt(64, 4), "widen_integer", {UInt(32, 4)}, Target::WasmSimd128},
 
+#if LLVM_VERSION >= 160
+    // Relaxed SIMD. (Older LLVMs spell these differently, and their fma takes its
+    // operands in the order of an earlier draft of the proposal, so don't bother.)
+    {"llvm.wasm.relaxed.madd.v4f32", Float(32, 4), "relaxed_madd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.madd.v2f64", Float(64, 2), "relaxed_madd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v4f32", Float(32, 4), "relaxed_nmadd", {Float(32, 4), Float(32, 4), Float(32, 4)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.nmadd.v2f64", Float(64, 2), "relaxed_nmadd", {Float(64, 2), Float(64, 2), Float(64, 2)}, Target::WasmRelaxedSimd},
+    // The second operand must be in [0, 127]; see codegen_vector_reduce.
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.signed", Int(16, 8), "relaxed_dot_product", {Int(8, 16), Int(8, 16)}, Target::WasmRelaxedSimd},
+    {"llvm.wasm.relaxed.dot.i8x16.i7x16.add.signed", Int(32, 4), "relaxed_dot_product_add", {Int(8, 16), Int(8, 16), Int(32, 4)}, Target::WasmRelaxedSimd},
+#endif
+
     {"llvm.nearbyint.v4f32", Float(32, 4), "nearbyint", {Float(32, 4)}, Target::WasmSimd128},
     {"llvm.nearbyint.v2f64", Float(64, 2), "nearbyint", {Float(64, 2)}, Target::WasmSimd128},
     {"llvm.nearbyint.f32", Float(32), "nearbyint", {Float(32)}},
@@ -140,6 +156,44 @@ void CodeGen_WebAssembly::init_module() {
     }
 }
 
+void CodeGen_WebAssembly::visit(const Add *op) {
+    // Relaxed madd may or may not round the product, so only use it
+    // where contraction is allowed anyway.
+    if (target.has_feature(Target::WasmRelaxedSimd) &&
+        op->type.is_float() && op->type.is_vector() &&
+        builder->getFastMathFlags().allowContract()) {
+        const Mul *mul = op->a.as<Mul>();
+        Expr addend = op->b;
+        if (!mul) {
+            mul = op->b.as<Mul>();
+            addend = op->a;
+        }
+        if (mul) {
+            value = call_overloaded_intrin(op->type, "relaxed_madd", {mul->a, mul->b, addend});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
+void CodeGen_WebAssembly::visit(const Sub *op) {
+    if (target.has_feature(Target::WasmRelaxedSimd) &&
+        op->type.is_float() && op->type.is_vector() &&
+        builder->getFastMathFlags().allowContract()) {
+        if (const Mul *mul = op->b.as<Mul>()) {
+            value = call_overloaded_intrin(op->type, "relaxed_nmadd", {mul->a, mul->b, op->a});
+            if (value) {
+                return;
+            }
+        }
+    }
+
+    CodeGen_Posix::visit(op);
+}
+
 void CodeGen_WebAssembly::visit(const Cast *op) {
     struct Pattern {
         std::string intrin;  ///< Name of the intrinsic
@@ -228,6 +282,12 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
         Expr pattern;
         const char *intrin;
         Target::Feature required_feature;
+        enum {
+            None = 0,
+            SevenBitOperand = 1 << 0,  // The second operand must be non-negative, i.e. a signed 7-bit value.
+            Accumulate = 1 << 1,       // The intrinsic takes the initial value as its last argument.
+        };
+        int flags = None;
     };
     // clang-format off
     static const Pattern patterns[] = {
@@ -240,6 +300,10 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
         {VectorReduce::Add, 2, i32(wild_u16x_), "pairwise_widening_add", Target::WasmSimd128},
 
         {VectorReduce::Add, 2, i32(widening_mul(wild_i16x_, wild_i16x_)), "dot_product", Target::WasmSimd128},
+
+        {VectorReduce::Add, 2, widening_mul(wild_i8x_, wild_i8x_), "relaxed_dot_product", Target::WasmRelaxedSimd, Pattern::SevenBitOperand},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_i8x_)), "relaxed_dot_product_add", Target::WasmRelaxedSimd,
+         Pattern::SevenBitOperand | Pattern::Accumulate},
     };
     // clang-format on
 
@@ -278,9 +342,26 @@ void CodeGen_WebAssembly::codegen_vector_reduce(const VectorReduce *op, const Ex
                     std::swap(matches[0], matches[1]);
                 }
             }
+            if (p.flags & Pattern::SevenBitOperand) {
+                // The relaxed dot products give implementation-defined
+                // results if the second operand has its sign bit set.
+                auto non_negative = [](const Expr &e) {
+                    Interval bounds = bounds_of_expr_in_scope(e, Scope<Interval>::empty_scope());
+                    return bounds.has_lower_bound() && can_prove(bounds.min >= 0);
+                };
+                if (!non_negative(matches[1])) {
+                    if (!non_negative(matches[0])) {
+                        continue;
+                    }
+                    std::swap(matches[0], matches[1]);
+                }
+            }
+            if (p.flags & Pattern::Accumulate) {
+                matches.push_back(init.defined() ? init : make_zero(op->type));
+            }
             value = call_overloaded_intrin(op->type, p.intrin, matches);
             if (value) {
-                if (init.defined()) {
+                if (init.defined() && !(p.flags & Pattern::Accumulate)) {
                     internal_assert(binop != nullptr) << "unsupported op";
                     ValuePtr x = value;
                     ValuePtr y = codegen(init);
@@ -321,6 +402,13 @@ string CodeGen_WebAssembly::mattrs() const {
         sep = ",";
     }
 
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        user_assert(target.has_feature(Target::WasmSimd128))
+            << "wasm_relaxed_simd requires wasm_simd128.";
+        s << sep << "+relaxed-simd";
+        sep = ",";
+    }
+
     if (target.has_feature(Target::WasmThreads)) {
         // "WasmThreads" doesn't directly affect LLVM codegen,
         // but it does end up requiring atomics, so be sure to enable them.
@@ -1,3 +1,4 @@
+#include "Bounds.h"
 #include "CodeGen_Internal.h"
 #include "CodeGen_Posix.h"
 #include "ConciseCasts.h"
@@ -26,10 +27,16 @@ namespace {
 // existing flags, so that instruction patterns can just check for the
 // oldest feature flag that supports an instruction.
 Target complete_x86_target(Target t) {
+    if (t.has_feature(Target::AVX512_FP16)) {
+        t.set_feature(Target::AVX512_SapphireRapids);
+    }
     if (t.has_feature(Target::AVX512_SapphireRapids)) {
         t.set_feature(Target::AVX512_Cannonlake);
+        t.set_feature(Target::AVX512_VNNI);
+        t.set_feature(Target::AVXVNNI);
     }
-    if (t.has_feature(Target::AVX512_Cannonlake)) {
+    if (t.has_feature(Target::AVX512_Cannonlake) ||
+        t.has_feature(Target::AVX512_VNNI)) {
         t.set_feature(Target::AVX512_Skylake);
     }
     if (t.has_feature(Target::AVX512_Cannonlake) ||
@@ -37,7 +44,8 @@ Target complete_x86_target(Target t) {
         t.has_feature(Target::AVX512_KNL)) {
         t.set_feature(Target::AVX512);
     }
-    if (t.has_feature(Target::AVX512)) {
+    if (t.has_feature(Target::AVX512) ||
+        t.has_feature(Target::AVXVNNI)) {
         t.set_feature(Target::AVX2);
     }
     if (t.has_feature(Target::AVX2)) {
@@ -62,14 +70,31 @@ protected:
     string mattrs() const override;
     bool use_soft_float_abi() const override;
     int native_vector_bits() const override;
+    bool use_native_gather(const Type &t) const override;
+    bool use_native_scatter(const Type &t) const override;
+    bool use_masked_store(const Type &t) const override;
 
     int vector_lanes_for_slice(const Type &t) const;
 
     llvm::Type *llvm_type_of(const Type &t) const override;
 
+    Type upgrade_type_for_arithmetic(const Type &t) const override;
+    Type upgrade_type_for_argument_passing(const Type &t) const override;
+    Type upgrade_type_for_storage(const Type &t) const override;
+
+    /** AVX512-FP16 has native float16 arithmetic. bfloat16 is still
+     * emulated, apart from the dot products. */
+    bool is_float16_and_has_feature(const Type &t) const {
+        return t.code() == Type::Float && t.bits() == 16 && target.has_feature(Target::AVX512_FP16);
+    }
+
     using CodeGen_Posix::visit;
 
     void init_module() override;
+    void compile_func(const LoweredFunc &func, const string &simple_name, const string &extern_name) override;
+
+    /** Declare the intrinsics of the features in the current target. */
+    void declare_intrinsics();
 
     /** Nodes for which we want to emit specific sse/avx intrinsics */
     // @{
@@ -237,21 +262,29 @@ const x86Intrinsic intrinsic_defs[] = {
     {"dpbf16psx8", Float(32, 8), "dot_product", {Float(32, 8), BFloat(16, 16), BFloat(16, 16)}, Target::AVX512_SapphireRapids},
     {"dpbf16psx4", Float(32, 4), "dot_product", {Float(32, 4), BFloat(16, 8), BFloat(16, 8)}, Target::AVX512_SapphireRapids},
 
-    {"dpbusdx16", Int(32, 16), "dot_product", {Int(32, 16), UInt(8, 64), Int(8, 64)}, Target::AVX512_SapphireRapids},
-    {"dpbusdx8", Int(32, 8), "dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVX512_SapphireRapids},
-    {"dpbusdx4", Int(32, 4), "dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVX512_SapphireRapids},
-
-    {"dpwssdx16", Int(32, 16), "dot_product", {Int(32, 16), Int(16, 32), Int(16, 32)}, Target::AVX512_SapphireRapids},
-    {"dpwssdx8", Int(32, 8), "dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVX512_SapphireRapids},
-    {"dpwssdx4", Int(32, 4), "dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVX512_SapphireRapids},
-
-    {"dpbusdsx16", Int(32, 16), "saturating_dot_product", {Int(32, 16), UInt(8, 64), Int(8, 64)}, Target::AVX512_SapphireRapids},
-    {"dpbusdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVX512_SapphireRapids},
-    {"dpbusdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVX512_SapphireRapids},
-
-    {"dpwssdsx16", Int(32, 16), "saturating_dot_product", {Int(32, 16), Int(16, 32), Int(16, 32)}, Target::AVX512_SapphireRapids},
-    {"dpwssdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVX512_SapphireRapids},
-    {"dpwssdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVX512_SapphireRapids},
+    {"dpbusdx16", Int(32, 16), "dot_product", {Int(32, 16), UInt(8, 64), Int(8, 64)}, Target::AVX512_VNNI},
+    {"dpbusdx8", Int(32, 8), "dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVX512_VNNI},
+    {"dpbusdx8", Int(32, 8), "dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVXVNNI},
+    {"dpbusdx4", Int(32, 4), "dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVX512_VNNI},
+    {"dpbusdx4", Int(32, 4), "dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVXVNNI},
+
+    {"dpwssdx16", Int(32, 16), "dot_product", {Int(32, 16), Int(16, 32), Int(16, 32)}, Target::AVX512_VNNI},
+    {"dpwssdx8", Int(32, 8), "dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVX512_VNNI},
+    {"dpwssdx8", Int(32, 8), "dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVXVNNI},
+    {"dpwssdx4", Int(32, 4), "dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVX512_VNNI},
+    {"dpwssdx4", Int(32, 4), "dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVXVNNI},
+
+    {"dpbusdsx16", Int(32, 16), "saturating_dot_product", {Int(32, 16), UInt(8, 64), Int(8, 64)}, Target::AVX512_VNNI},
+    {"dpbusdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVX512_VNNI},
+    {"dpbusdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), UInt(8, 32), Int(8, 32)}, Target::AVXVNNI},
+    {"dpbusdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVX512_VNNI},
+    {"dpbusdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), UInt(8, 16), Int(8, 16)}, Target::AVXVNNI},
+
+    {"dpwssdsx16", Int(32, 16), "saturating_dot_product", {Int(32, 16), Int(16, 32), Int(16, 32)}, Target::AVX512_VNNI},
+    {"dpwssdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVX512_VNNI},
+    {"dpwssdsx8", Int(32, 8), "saturating_dot_product", {Int(32, 8), Int(16, 16), Int(16, 16)}, Target::AVXVNNI},
+    {"dpwssdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVX512_VNNI},
+    {"dpwssdsx4", Int(32, 4), "saturating_dot_product", {Int(32, 4), Int(16, 8), Int(16, 8)}, Target::AVXVNNI},
 
     {"tileloadd64_i8", Int(8, 1024), "tile_load", {Int(16), Int(16), Handle(), Int(64), Int(64)}, Target::AVX512_SapphireRapids, x86Intrinsic::AccessesMemory},
     {"tileloadd64_i8", UInt(8, 1024), "tile_load", {Int(16), Int(16), Handle(), Int(64), Int(64)}, Target::AVX512_SapphireRapids, x86Intrinsic::AccessesMemory},
@@ -270,7 +303,10 @@ const x86Intrinsic intrinsic_defs[] = {
 
 void CodeGen_X86::init_module() {
     CodeGen_Posix::init_module();
+    declare_intrinsics();
+}
 
+void CodeGen_X86::declare_intrinsics() {
     for (const x86Intrinsic &i : intrinsic_defs) {
         if (i.feature != Target::FeatureEnd && !target.has_feature(i.feature)) {
             continue;
@@ -294,6 +330,54 @@ void CodeGen_X86::init_module() {
     }
 }
 
+void CodeGen_X86::compile_func(const LoweredFunc &f, const string &simple_name,
+                               const string &extern_name) {
+    if (f.extra_features.empty()) {
+        CodeGen_Posix::compile_func(f, simple_name, extern_name);
+        return;
+    }
+
+    // A multiversioned loop. Compile it for the richer target, with the
+    // intrinsics that target has, and give it its own cpu and features
+    // so that LLVM selects instructions for them. It must not be
+    // inlined into callers compiled for the base target.
+    Target base_target = target;
+    std::map<string, std::vector<Intrinsic>> base_intrinsics;
+    base_intrinsics.swap(intrinsics);
+    target.set_features(f.extra_features);
+    declare_intrinsics();
+
+    CodeGen_Posix::compile_func(f, simple_name, extern_name);
+
+    llvm::Function *fn = module->getFunction(extern_name);
+    internal_assert(fn) << "Could not find function " << extern_name << " in module\n";
+    fn->addFnAttr("halide_mcpu_target", mcpu_target());
+    fn->addFnAttr("halide_mattrs", mattrs());
+    fn->addFnAttr(llvm::Attribute::NoInline);
+    set_function_attributes_from_halide_target_options(*fn);
+
+    target = base_target;
+    intrinsics.swap(base_intrinsics);
+}
+
+// Cast an expression to an integer type of the same width and the other
+// signedness, if its bounds show that doing so doesn't change its value.
+// E.g. an 8-bit dot product of two uint8 vectors can use vpdpbusd if one
+// of them is known to be less than 128.
+Expr cast_if_in_range(Type t, const Expr &e) {
+    Expr result = lossless_cast(t, e);
+    if (result.defined()) {
+        return result;
+    }
+    Interval bounds = bounds_of_expr_in_scope(e, Scope<Interval>::empty_scope());
+    if (bounds.is_bounded() &&
+        can_prove(cast<int>(bounds.min) >= cast<int>(t.min()) &&
+                  cast<int>(bounds.max) <= cast<int>(t.max()))) {
+        return cast(t, e);
+    }
+    return Expr();
+}
+
 // i32(i16_a)*i32(i16_b) +/- i32(i16_c)*i32(i16_d) can be done by
 // interleaving a, c, and b, d, and then using dot_product.
 bool should_use_dot_product(const Expr &a, const Expr &b, vector<Expr> &result) {
@@ -669,6 +753,10 @@ void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op, const Expr &init
             CombineInit = 1 << 0,
             SwapOperands = 1 << 1,
             SingleArg = 1 << 2,
+            // Only cast the first (or second) operand to narrow_type,
+            // using its bounds if a lossless cast isn't enough.
+            NarrowFirstOnly = 1 << 3,
+            NarrowSecondOnly = 1 << 4,
         };
     };
     // clang-format off
@@ -680,6 +768,12 @@ void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op, const Expr &init
         {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_u8x_)), "dot_product", {}, Pattern::CombineInit | Pattern::SwapOperands},
         {VectorReduce::SaturatingAdd, 4, i32(widening_mul(wild_u8x_, wild_i8x_)), "saturating_dot_product", {}, Pattern::CombineInit},
         {VectorReduce::SaturatingAdd, 4, i32(widening_mul(wild_i8x_, wild_u8x_)), "saturating_dot_product", {}, Pattern::CombineInit | Pattern::SwapOperands},
+        // A uint8 x uint8 or int8 x int8 dot product can use the same
+        // instructions when one side fits in the other signedness.
+        {VectorReduce::Add, 4, i32(widening_mul(wild_u8x_, wild_u8x_)), "dot_product", Int(8), Pattern::CombineInit | Pattern::NarrowSecondOnly},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_u8x_, wild_u8x_)), "dot_product", Int(8), Pattern::CombineInit | Pattern::NarrowSecondOnly | Pattern::SwapOperands},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_i8x_)), "dot_product", UInt(8), Pattern::CombineInit | Pattern::NarrowFirstOnly},
+        {VectorReduce::Add, 4, i32(widening_mul(wild_i8x_, wild_i8x_)), "dot_product", UInt(8), Pattern::CombineInit | Pattern::NarrowFirstOnly | Pattern::SwapOperands},
 
         // 2-way dot products
         {VectorReduce::Add, 2, i32(widening_mul(wild_i8x_, wild_i8x_)), "dot_product", Int(16)},
@@ -748,7 +842,11 @@ void CodeGen_X86::codegen_vector_reduce(const VectorReduce *op, const Expr &init
                 if (p.flags & Pattern::SwapOperands) {
                     std::swap(a, b);
                 }
-                if (p.narrow_type.bits() > 0) {
+                if (p.flags & Pattern::NarrowFirstOnly) {
+                    a = cast_if_in_range(p.narrow_type.with_lanes(a.type().lanes()), a);
+                } else if (p.flags & Pattern::NarrowSecondOnly) {
+                    b = cast_if_in_range(p.narrow_type.with_lanes(b.type().lanes()), b);
+                } else if (p.narrow_type.bits() > 0) {
                     a = lossless_cast(p.narrow_type.with_lanes(a.type().lanes()), a);
                     b = lossless_cast(p.narrow_type.with_lanes(b.type().lanes()), b);
                 }
@@ -846,6 +944,8 @@ string CodeGen_X86::mcpu_target() const {
         return "sapphirerapids";
     } else if (target.has_feature(Target::AVX512_Cannonlake)) {
         return "cannonlake";
+    } else if (target.has_feature(Target::AVX512_VNNI)) {
+        return "cascadelake";
     } else if (target.has_feature(Target::AVX512_Skylake)) {
         return "skylake-avx512";
     } else if (target.has_feature(Target::AVX512_KNL)) {
@@ -931,9 +1031,19 @@ string CodeGen_X86::mattrs() const {
         if (target.has_feature(Target::AVX512_Cannonlake)) {
             features += ",+avx512ifma,+avx512vbmi";
         }
+        if (target.has_feature(Target::AVX512_VNNI)) {
+            features += ",+avx512vnni";
+        }
         if (target.has_feature(Target::AVX512_SapphireRapids)) {
             features += ",+avx512bf16,+avx512vnni,+amx-int8,+amx-bf16";
         }
+        if (target.has_feature(Target::AVX512_FP16)) {
+            features += ",+avx512fp16";
+        }
+    }
+    if (target.has_feature(Target::AVXVNNI)) {
+        features += separator + "+avxvnni";
+        separator = ",";
     }
     return features;
 }
@@ -942,6 +1052,38 @@ bool CodeGen_X86::use_soft_float_abi() const {
     return false;
 }
 
+bool CodeGen_X86::use_native_gather(const Type &t) const {
+    // AVX2 gathers 32- and 64-bit elements. Before Zen 3, AMD's gathers
+    // are microcoded and slower than the scalar loads they replace.
+    if (!target.has_feature(Target::AVX2) || (t.bits() != 32 && t.bits() != 64)) {
+        return false;
+    }
+    switch (target.processor_tune) {
+    case Target::Processor::BdVer1:
+    case Target::Processor::BdVer2:
+    case Target::Processor::BdVer3:
+    case Target::Processor::BdVer4:
+    case Target::Processor::BtVer2:
+    case Target::Processor::ZnVer1:
+    case Target::Processor::ZnVer2:
+        return false;
+    default:
+        return true;
+    }
+}
+
+bool CodeGen_X86::use_native_scatter(const Type &t) const {
+    // Scatters are AVX-512 only.
+    return target.has_feature(Target::AVX512) && (t.bits() == 32 || t.bits() == 64);
+}
+
+bool CodeGen_X86::use_masked_store(const Type &t) const {
+    // AVX-512 stores take a mask register at no extra cost. The AVX and
+    // AVX2 vmaskmov stores are slow, so blend and store there instead.
+    return target.has_feature(Target::AVX512_Skylake) ||
+           (target.has_feature(Target::AVX512) && t.bits() >= 32);
+}
+
 int CodeGen_X86::native_vector_bits() const {
     if (target.has_feature(Target::AVX512) ||
         target.has_feature(Target::AVX512_Skylake) ||
@@ -971,7 +1113,7 @@ int CodeGen_X86::vector_lanes_for_slice(const Type &t) const {
 }
 
 llvm::Type *CodeGen_X86::llvm_type_of(const Type &t) const {
-    if (t.is_float() && t.bits() < 32) {
+    if (t.is_float() && t.bits() < 32 && !is_float16_and_has_feature(t)) {
         // LLVM as of August 2019 has all sorts of issues in the x86
         // backend for half types. It injects expensive calls to
         // convert between float and half for seemingly no reason
@@ -985,6 +1127,27 @@ llvm::Type *CodeGen_X86::llvm_type_of(const Type &t) const {
     }
 }
 
+Type CodeGen_X86::upgrade_type_for_arithmetic(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_arithmetic(t);
+}
+
+Type CodeGen_X86::upgrade_type_for_argument_passing(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_argument_passing(t);
+}
+
+Type CodeGen_X86::upgrade_type_for_storage(const Type &t) const {
+    if (is_float16_and_has_feature(t)) {
+        return t;
+    }
+    return CodeGen_Posix::upgrade_type_for_storage(t);
+}
+
 }  // namespace
 
 std::unique_ptr<CodeGen_Posix> new_CodeGen_X86(const Target &target) {
@@ -17,7 +17,10 @@ namespace {
 // TODO: for now we are just going to ignore potential issues with
 // static-initialization-order-fiasco, as CompilerLogger isn't currently used
 // from any static-initialization execution scope.
-std::unique_ptr<CompilerLogger> active_compiler_logger;
+//
+// Each thread has its own logger, as compile_multitarget() may compile
+// several sub-targets at once.
+thread_local std::unique_ptr<CompilerLogger> active_compiler_logger;
 
 class ObfuscateNames : public IRMutator {
     using IRMutator::visit;
@@ -116,6 +119,15 @@ void JSONCompilerLogger::record_compilation_time(Phase phase, double duration) {
     compilation_time[phase] += duration;
 }
 
+void JSONCompilerLogger::record_lowering_pass(const std::string &pass_name, double duration,
+                                              int64_t nodes_before, int64_t nodes_after) {
+    lowering_passes.push_back({pass_name, duration, nodes_before, nodes_after});
+}
+
+void JSONCompilerLogger::record_loop_partition(const std::string &loop_name, const std::string &decision) {
+    loop_partitions.emplace_back(loop_name, decision);
+}
+
 void JSONCompilerLogger::obfuscate() {
     {
         std::map<std::string, std::vector<Expr>> n;
@@ -278,6 +290,38 @@ std::ostream &JSONCompilerLogger::emit_to_stream(std::ostream &o) {
         emit_key_value(o, indent, "compilation_time_llvm", compilation_time[Phase::LLVM]);
     }
 
+    if (!lowering_passes.empty()) {
+        emit_key(o, indent, "lowering_passes");
+        o << "[\n";
+        int commas_to_emit = (int)lowering_passes.size() - 1;
+        for (const auto &p : lowering_passes) {
+            o << std::string(indent + 1, ' ') << "{\n";
+            emit_key_value(o, indent + 2, "name", p.name);
+            emit_key_value(o, indent + 2, "time", p.duration);
+            emit_key_value(o, indent + 2, "nodes_before", p.nodes_before);
+            emit_key_value(o, indent + 2, "nodes_after", p.nodes_after, false);
+            o << std::string(indent + 1, ' ') << "}";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << std::string(indent, ' ') << "]";
+        emit_eol(o);
+    }
+
+    if (!loop_partitions.empty()) {
+        emit_key(o, indent, "loop_partitions");
+        o << "[\n";
+        int commas_to_emit = (int)loop_partitions.size() - 1;
+        for (const auto &p : loop_partitions) {
+            o << std::string(indent + 1, ' ') << "{\n";
+            emit_key_value(o, indent + 2, "loop", p.first);
+            emit_key_value(o, indent + 2, "decision", p.second, false);
+            o << std::string(indent + 1, ' ') << "}";
+            emit_eol(o, commas_to_emit-- > 0);
+        }
+        o << std::string(indent, ' ') << "]";
+        emit_eol(o);
+    }
+
     if (!matched_simplifier_rules.empty()) {
         emit_object_key_open(o, indent, "matched_simplifier_rules");
 
@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "Expr.h"
 #include "Target.h"
@@ -53,14 +54,29 @@ public:
      */
     virtual void record_compilation_time(Phase phase, double duration) = 0;
 
+    /** Record the time (in seconds) taken by one pass of lowering, along with
+     * the number of distinct IR nodes in the Stmt before and after it. The
+     * default implementation ignores this.
+     */
+    virtual void record_lowering_pass(const std::string &pass_name, double duration,
+                                      int64_t nodes_before, int64_t nodes_after) {
+    }
+
+    /** Record what loop partitioning decided to do with a loop, under
+     * Target::PartitionCostModel. The default implementation ignores
+     * this.
+     */
+    virtual void record_loop_partition(const std::string &loop_name, const std::string &decision) {
+    }
+
     /**
      * Emit all the gathered data to the given stream. This may be called multiple times.
      */
     virtual std::ostream &emit_to_stream(std::ostream &o) = 0;
 };
 
-/** Set the active CompilerLogger object, replacing any existing one.
- * It is legal to pass in a nullptr (which means "don't do any compiler logging").
+/** Set the active CompilerLogger object for the calling thread, replacing
+ * any existing one. It is legal to pass in a nullptr (which means "don't do any compiler logging").
  * Returns the previous CompilerLogger (if any). */
 std::unique_ptr<CompilerLogger> set_compiler_logger(std::unique_ptr<CompilerLogger> compiler_logger);
 
@@ -90,6 +106,9 @@ public:
     void record_failed_to_prove(Expr failed_to_prove, Expr original_expr) override;
     void record_object_code_size(uint64_t bytes) override;
     void record_compilation_time(Phase phase, double duration) override;
+    void record_lowering_pass(const std::string &pass_name, double duration,
+                              int64_t nodes_before, int64_t nodes_after) override;
+    void record_loop_partition(const std::string &loop_name, const std::string &decision) override;
 
     std::ostream &emit_to_stream(std::ostream &o) override;
 
@@ -116,6 +135,17 @@ protected:
     // Map of the time take for each phase of compilation.
     std::map<Phase, double> compilation_time;
 
+    // The time taken and IR sizes for each lowering pass, in the order run.
+    struct LoweringPass {
+        std::string name;
+        double duration;
+        int64_t nodes_before, nodes_after;
+    };
+    std::vector<LoweringPass> lowering_passes;
+
+    // What loop partitioning did with each loop, in order.
+    std::vector<std::pair<std::string, std::string>> loop_partitions;
+
     void obfuscate();
     void emit();
 };
@@ -1916,6 +1916,120 @@ void ReverseAccumulationVisitor::propagate_halide_function_call(
     }
 }
 
+// Redirect calls to some Funcs to other Funcs with the same arguments.
+class RedirectCalls : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &replacements;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type == Call::Halide) {
+            auto it = replacements.find(op->name);
+            if (it != replacements.end()) {
+                vector<Expr> args;
+                args.reserve(op->args.size());
+                for (const Expr &arg : op->args) {
+                    args.push_back(mutate(arg));
+                }
+                return Call::make(it->second, args, op->value_index);
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    RedirectCalls(const map<string, Function> &replacements)
+        : replacements(replacements) {
+    }
+};
+
+/** Make the adjoints call copies of the forward Funcs that are not
+ * checkpoints, which recompute them from the nearest checkpoints,
+ * instead of calling the forward Funcs themselves. */
+void apply_checkpointing(const Func &output,
+                         const Func &adjoint,
+                         const Checkpointing &checkpointing,
+                         map<FuncKey, Func> &adjoint_funcs) {
+    map<string, Function> env = find_transitive_calls(output.function());
+    vector<string> order = realization_order({output.function()}, env).first;
+
+    set<string> checkpoints;
+    for (const Func &f : checkpointing.checkpoints) {
+        user_assert(env.count(f.name()))
+            << "Checkpoint " << f.name() << " is not used to compute " << output.name() << "\n";
+        checkpoints.insert(f.name());
+    }
+
+    // Only pure Funcs are recomputed. Anything else is always read
+    // directly, as is the output, which has been computed anyway.
+    vector<string> recomputable;
+    for (const string &name : order) {
+        const Function &f = env[name];
+        if (name != output.name() &&
+            !f.has_update_definition() &&
+            !f.has_extern_definition() &&
+            !checkpoints.count(name)) {
+            recomputable.push_back(name);
+        }
+    }
+    if (checkpointing.checkpoints.empty() && !recomputable.empty()) {
+        // Checkpoint every ceil(sqrt(N))-th Func, so that each segment
+        // recomputed in the backward pass is O(sqrt(N)) Funcs long.
+        const size_t n = recomputable.size();
+        const size_t stride = (size_t)std::ceil(std::sqrt((double)n));
+        vector<string> rest;
+        for (size_t i = 0; i < n; i++) {
+            if ((i + 1) % stride == 0) {
+                checkpoints.insert(recomputable[i]);
+            } else {
+                rest.push_back(recomputable[i]);
+            }
+        }
+        recomputable.swap(rest);
+    }
+
+    // Make the copies, producers first, so that each copy calls the
+    // copies of the Funcs it depends on.
+    map<string, Function> copies;
+    RedirectCalls redirect(copies);
+    for (const string &name : recomputable) {
+        const Function &f = env[name];
+        Function copy(f.name() + "_recompute__");
+        vector<Expr> values;
+        for (const Expr &v : f.values()) {
+            values.push_back(redirect.mutate(v));
+        }
+        copy.define(f.args(), values);
+        copies[name] = copy;
+        debug(1) << "Recomputing " << name << " in the backward pass\n";
+    }
+    if (copies.empty()) {
+        return;
+    }
+
+    // Point the backward pass at the copies. Leave the forward Funcs
+    // and the given adjoint alone.
+    set<string> untouched;
+    for (const auto &it : env) {
+        untouched.insert(it.first);
+    }
+    untouched.insert(adjoint.name());
+    for (const auto &it : find_transitive_calls(adjoint.function())) {
+        untouched.insert(it.first);
+    }
+    map<string, Function> backward;
+    for (const auto &it : adjoint_funcs) {
+        for (const auto &f : find_transitive_calls(it.second.function())) {
+            if (!untouched.count(f.first) && !copies.count(f.first)) {
+                backward.insert(f);
+            }
+        }
+    }
+    for (auto &it : backward) {
+        it.second.mutate(&redirect);
+    }
+}
+
 }  // namespace
 }  // namespace Internal
 
@@ -1992,4 +2106,32 @@ Derivative propagate_adjoints(const Func &output) {
     return propagate_adjoints(output, adjoint, output_bounds);
 }
 
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const Checkpointing &checkpointing) {
+    user_assert(output.dimensions() == adjoint.dimensions())
+        << "output dimensions and adjoint dimensions must match\n";
+    user_assert((int)output_bounds.size() == adjoint.dimensions())
+        << "output_bounds and adjoint dimensions must match\n";
+
+    Internal::ReverseAccumulationVisitor visitor;
+    visitor.propagate_adjoints(output, adjoint, output_bounds);
+    map<FuncKey, Func> adjoint_funcs = visitor.get_adjoint_funcs();
+    Internal::apply_checkpointing(output, adjoint, checkpointing, adjoint_funcs);
+    return Derivative{std::move(adjoint_funcs)};
+}
+
+Derivative propagate_adjoints(const Func &output,
+                              const Checkpointing &checkpointing) {
+    Func adjoint("adjoint");
+    adjoint(output.args()) = Internal::make_one(output.value().type());
+    Region output_bounds;
+    output_bounds.reserve(output.dimensions());
+    for (int i = 0; i < output.dimensions(); i++) {
+        output_bounds.push_back({0, 0});
+    }
+    return propagate_adjoints(output, adjoint, output_bounds, checkpointing);
+}
+
 }  // namespace Halide
@@ -41,6 +41,25 @@ private:
     const std::map<FuncKey, Func> adjoints;
 };
 
+/**
+ *  Options for trading recomputation for storage in the backward pass.
+ *  Normally the adjoints call the forward Funcs they depend on, so every
+ *  one of them the backward pass needs stays alive until the backward
+ *  pass is done, and memory grows linearly with the length of the
+ *  forward chain. With checkpointing, the adjoints only call the
+ *  checkpointed forward Funcs directly. Every other pure forward Func is
+ *  replaced, in the backward pass only, by a copy (named with a
+ *  "_recompute__" suffix) that recomputes it from the nearest
+ *  checkpoints. These copies are inlined unless scheduled otherwise, so
+ *  only the checkpoints need to be stored, e.g. with compute_root().
+ */
+struct Checkpointing {
+    /** The forward Funcs to store for the backward pass. If empty, every
+     * ceil(sqrt(N))-th of the N pure forward Funcs, in realization order,
+     * is a checkpoint, so the recomputed segments are O(sqrt(N)) long. */
+    std::vector<Func> checkpoints;
+};
+
 /**
  *  Given a Func and a corresponding adjoint, (back)propagate the
  *  adjoint to all dependent Funcs, buffers, and parameters.
@@ -70,6 +89,17 @@ Derivative propagate_adjoints(const Func &output,
  */
 Derivative propagate_adjoints(const Func &output);
 
+/**
+ *  Versions of the above that recompute forward Funcs from checkpoints
+ *  in the backward pass. See Checkpointing.
+ */
+Derivative propagate_adjoints(const Func &output,
+                              const Func &adjoint,
+                              const Region &output_bounds,
+                              const Checkpointing &checkpointing);
+Derivative propagate_adjoints(const Func &output,
+                              const Checkpointing &checkpointing);
+
 }  // namespace Halide
 
 #endif
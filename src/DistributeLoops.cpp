@@ -0,0 +1,159 @@
+#include "DistributeLoops.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "InjectHostDevBufferCopies.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+// The block of [min, min + extent) that belongs to the calling rank.
+// The blocks of the ranks are in rank order, and all but the last
+// non-empty one have the same size. Returns the min and extent.
+pair<Expr, Expr> block_of_rank(const Expr &min, const Expr &extent) {
+    Expr rank = Call::make(Int(32), "halide_distributed_rank", {}, Call::PureExtern);
+    Expr num_ranks = Call::make(Int(32), "halide_distributed_num_ranks", {}, Call::PureExtern);
+    Expr block_size = (extent + num_ranks - 1) / num_ranks;
+    Expr begin = Halide::min(rank * block_size, extent);
+    Expr end = Halide::min((rank + 1) * block_size, extent);
+    return {min + begin, end - begin};
+}
+
+class DistributeLoops : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, Function> &env;
+    const FuncValueBounds &func_bounds;
+
+    // The Func whose production we are in.
+    string producing;
+
+    // The innermost enclosing loop that runs in parallel or is
+    // distributed, if any. Distributed loops and exchanges are run by
+    // every rank the same number of times, so they can't be inside one.
+    string enclosing_parallel_loop;
+
+    // The distributed Funcs and the index of their distributed dimension.
+    map<string, int> distributed_dims;
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::Distributed) {
+            if (is_parallel(op->for_type)) {
+                ScopedValue<string> in_loop(enclosing_parallel_loop, op->name);
+                return IRMutator::visit(op);
+            }
+            return IRMutator::visit(op);
+        }
+
+        user_assert(enclosing_parallel_loop.empty())
+            << "Can't distribute the loop " << op->name
+            << ", because it is inside the loop " << enclosing_parallel_loop
+            << ", which is distributed or runs in parallel.\n";
+
+        internal_assert(env.count(producing)) << "Distributed loop " << op->name << " outside of any production\n";
+        const Function &f = env.at(producing);
+        user_assert(!f.has_update_definition())
+            << "Can't distribute " << f.name() << ", because it has update definitions.\n";
+        int dim = -1;
+        for (int i = 0; i < f.dimensions(); i++) {
+            if (op->name == f.name() + ".s0." + f.args()[i]) {
+                dim = i;
+            }
+        }
+        user_assert(dim >= 0)
+            << "Can't distribute the loop " << op->name
+            << ", because only dimensions of " << f.name()
+            << " that have not been split or fused can be distributed.\n";
+        auto inserted = distributed_dims.emplace(f.name(), dim);
+        user_assert(inserted.first->second == dim)
+            << "Can't distribute the loop " << op->name
+            << ", because another dimension of " << f.name() << " is already distributed.\n";
+
+        Stmt body;
+        {
+            ScopedValue<string> in_loop(enclosing_parallel_loop, op->name);
+            body = mutate(op->body);
+        }
+        auto block = block_of_rank(op->min, op->extent);
+        return For::make(op->name, block.first, block.second, ForType::Serial, op->device_api, body);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            ScopedValue<string> p(producing, op->name);
+            return IRMutator::visit(op);
+        }
+
+        Stmt body = mutate(op->body);
+        auto it = distributed_dims.find(op->name);
+        if (it != distributed_dims.end()) {
+            Stmt exchange = make_exchange(env.at(op->name), it->second, body);
+            if (exchange.defined()) {
+                user_assert(enclosing_parallel_loop.empty())
+                    << "Can't distribute " << op->name << ", because it is used inside the loop "
+                    << enclosing_parallel_loop << ", which is distributed or runs in parallel.\n";
+                body = Block::make(exchange, body);
+            }
+        }
+        return ProducerConsumer::make_consume(op->name, body);
+    }
+
+    // Receive the rows of f along dim that the consumers in the given
+    // Stmt need, from the ranks that computed them.
+    Stmt make_exchange(const Function &f, int dim, const Stmt &consumers) {
+        Box needed = box_required(consumers, f.name(), Scope<Interval>::empty_scope(), func_bounds);
+        if (needed.empty()) {
+            return Stmt();
+        }
+
+        // The ranks divide the region computed by bounds inference the
+        // same way the distributed loop over it was divided.
+        string prefix = f.name() + ".s0." + f.args()[dim];
+        Expr min = Variable::make(Int(32), prefix + ".min");
+        Expr max = Variable::make(Int(32), prefix + ".max");
+        auto owned = block_of_rank(min, max - min + 1);
+
+        // Nothing outside that region is computed by any rank.
+        Expr needed_min = min, needed_max = max;
+        if (needed[dim].has_lower_bound()) {
+            needed_min = Halide::max(needed[dim].min, min);
+        }
+        if (needed[dim].has_upper_bound()) {
+            needed_max = Halide::min(needed[dim].max, max);
+        }
+        Expr needed_extent = Halide::max(needed_max - needed_min + 1, 0);
+
+        vector<Stmt> exchanges;
+        for (int i = 0; i < (int)f.outputs(); i++) {
+            string buffer_name = f.outputs() == 1 ? f.name() : f.name() + "." + std::to_string(i);
+            Expr buffer = Variable::make(type_of<halide_buffer_t *>(), buffer_name + ".buffer");
+            exchanges.push_back(call_extern_and_assert("halide_distributed_exchange",
+                                                       {buffer, dim, owned.first, owned.second,
+                                                        needed_min, needed_extent}));
+        }
+        return Block::make(exchanges);
+    }
+
+public:
+    DistributeLoops(const map<string, Function> &env, const FuncValueBounds &func_bounds)
+        : env(env), func_bounds(func_bounds) {
+    }
+};
+
+}  // namespace
+
+Stmt distribute_loops(const Stmt &s, const map<string, Function> &env,
+                      const FuncValueBounds &func_bounds) {
+    return DistributeLoops(env, func_bounds).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,33 @@
+#ifndef HALIDE_DISTRIBUTE_LOOPS_H
+#define HALIDE_DISTRIBUTE_LOOPS_H
+
+/** \file
+ * Defines the lowering pass that divides distributed loops between
+ * the ranks of a distributed computation.
+ */
+
+#include <map>
+#include <string>
+
+#include "Bounds.h"
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Replace each distributed loop with a serial loop over the block of
+ * its iterations that belongs to the calling rank, and make the parts
+ * of distributed Funcs that their consumers need on each rank, but
+ * were computed by other ranks, be received before the consumers run.
+ * Must be run after bounds inference and before allocation bounds
+ * inference, so that each rank only allocates the parts of
+ * distributed Funcs it computes or needs. */
+Stmt distribute_loops(const Stmt &s, const std::map<std::string, Function> &env,
+                      const FuncValueBounds &func_bounds);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -77,7 +77,8 @@ const StringImm *StringImm::make(const std::string &val) {
 bool is_unordered_parallel(ForType for_type) {
     return (for_type == ForType::Parallel ||
             for_type == ForType::GPUBlock ||
-            for_type == ForType::GPUThread);
+            for_type == ForType::GPUThread ||
+            for_type == ForType::MultiGPU);
 }
 
 /** Returns true if for_type executes for loop iterations in parallel. */
@@ -384,6 +384,12 @@ enum class MemoryType {
     /** AMX Tile register for X86. Any data that would be used in an AMX matrix
      * multiplication must first be loaded into an AMX tile register. */
     AMXTile,
+
+    /** A 16x16 accumulator tile held by the tensor cores of a CUDA
+     * warp, spread across the registers of its threads. Matrix
+     * multiplies into it are done with warp matrix multiply
+     * instructions. Needs the cuda_tensor_cores target feature. */
+    MMAFragment,
 };
 
 namespace Internal {
@@ -396,7 +402,8 @@ namespace Internal {
  * any order, and multiple iterations may occur
  * simultaneously. Vectorized and GPULane are parallel and
  * synchronous: they act as if all iterations occur at the same time
- * in lockstep. */
+ * in lockstep. MultiGPU is parallel and unordered too, and each
+ * iteration uses its own GPU device. */
 enum class ForType {
     Serial,
     Parallel,
@@ -406,6 +413,8 @@ enum class ForType {
     GPUBlock,
     GPUThread,
     GPULane,
+    Distributed,
+    MultiGPU,
 };
 
 /** Check if for_type executes for loop iterations in parallel and unordered. */
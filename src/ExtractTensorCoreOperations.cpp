@@ -0,0 +1,554 @@
+#include "ExtractTensorCoreOperations.h"
+
+#include "CodeGen_GPU_Dev.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+#include "Target.h"
+
+/** \file Support extraction of CUDA warp matrix multiply instructions. */
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+// The accumulator tiles are always 16x16.
+const int tile_size = 16;
+
+// Each thread of the warp holds 8 elements of an accumulator tile.
+const int fragment_size = 8;
+
+const int warp_size = 32;
+
+// The depth of the tiles multiplied together, which is 16 for all
+// operand types other than tf32.
+int tile_depth(const Type &t) {
+    return t == Float(32) ? 8 : 16;
+}
+
+// A vector index written as base + sum(strides[i] * lane index of dim i),
+// with the dims of the lanes innermost first.
+struct AffineIndex {
+    bool result = false;
+    Expr base;
+    vector<Expr> strides;
+};
+
+// The number of the innermost dims that together make up the given
+// number of lanes, or -1 if the lanes split a dim.
+int count_inner_dims(const vector<int> &dims, int lanes) {
+    int d = 0, product = 1;
+    while (product < lanes && d < (int)dims.size()) {
+        product *= dims[d++];
+    }
+    return product == lanes ? d : -1;
+}
+
+bool is_uniform(const AffineIndex &index) {
+    for (const Expr &s : index.strides) {
+        if (!is_const_zero(s)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AffineIndex affine_index(const Expr &e, const vector<int> &dims) {
+    AffineIndex result;
+    if (e.type().is_scalar()) {
+        result.result = true;
+        result.base = e;
+        result.strides.resize(dims.size(), make_zero(e.type()));
+        return result;
+    }
+
+    if (const Broadcast *b = e.as<Broadcast>()) {
+        // The value is repeated over the outer dims.
+        int d = count_inner_dims(dims, b->value.type().lanes());
+        if (d < 0) {
+            return result;
+        }
+        result = affine_index(b->value, vector<int>(dims.begin(), dims.begin() + d));
+        result.strides.resize(dims.size(), make_zero(e.type().element_of()));
+    } else if (const Ramp *r = e.as<Ramp>()) {
+        // The outer dims step through the ramp.
+        int d = count_inner_dims(dims, r->base.type().lanes());
+        if (d < 0) {
+            return result;
+        }
+        vector<int> inner(dims.begin(), dims.begin() + d);
+        AffineIndex base = affine_index(r->base, inner);
+        AffineIndex stride = affine_index(r->stride, inner);
+        if (!base.result || !stride.result || !is_uniform(stride)) {
+            return result;
+        }
+        result = std::move(base);
+        Expr s = stride.base;
+        for (size_t i = d; i < dims.size(); i++) {
+            result.strides.push_back(s);
+            s = s * dims[i];
+        }
+    } else if (const Add *add = e.as<Add>()) {
+        AffineIndex a = affine_index(add->a, dims);
+        AffineIndex b = affine_index(add->b, dims);
+        if (a.result && b.result) {
+            result = std::move(a);
+            result.base += b.base;
+            for (size_t i = 0; i < dims.size(); i++) {
+                result.strides[i] += b.strides[i];
+            }
+        }
+    } else if (const Sub *sub = e.as<Sub>()) {
+        AffineIndex a = affine_index(sub->a, dims);
+        AffineIndex b = affine_index(sub->b, dims);
+        if (a.result && b.result) {
+            result = std::move(a);
+            result.base -= b.base;
+            for (size_t i = 0; i < dims.size(); i++) {
+                result.strides[i] -= b.strides[i];
+            }
+        }
+    } else if (const Mul *mul = e.as<Mul>()) {
+        // One side must be the same in every lane.
+        AffineIndex a = affine_index(mul->a, dims);
+        AffineIndex b = affine_index(mul->b, dims);
+        if (!is_uniform(b)) {
+            std::swap(a, b);
+        }
+        if (a.result && b.result && is_uniform(b)) {
+            result = std::move(a);
+            result.base *= b.base;
+            for (Expr &s : result.strides) {
+                s *= b.base;
+            }
+        }
+    }
+    return result;
+}
+
+AffineIndex tile_index(const Expr &e, const vector<int> &dims) {
+    AffineIndex index = affine_index(e, dims);
+    if (index.result) {
+        index.base = simplify(index.base);
+        for (Expr &s : index.strides) {
+            s = simplify(s);
+        }
+    }
+    return index;
+}
+
+// Find which of the two dims of a 16x16 access to an accumulator tile
+// is its column, or -1 if the access isn't to the whole tile.
+int accumulator_column_dim(const Expr &index) {
+    AffineIndex i = tile_index(index, {tile_size, tile_size});
+    if (!i.result || !is_const_zero(i.base)) {
+        return -1;
+    }
+    if (is_const_one(i.strides[0]) && is_const(i.strides[1], tile_size)) {
+        return 0;
+    } else if (is_const(i.strides[0], tile_size) && is_const_one(i.strides[1])) {
+        return 1;
+    }
+    return -1;
+}
+
+// A tile of a matrix in memory, given by the index of its first element
+// and the distance between its rows, or between its columns if it is
+// column major.
+struct MatrixTile {
+    bool result = false;
+    Expr base;
+    Expr stride;
+    bool col_major = false;
+};
+
+MatrixTile matrix_tile(const AffineIndex &index, int row_dim, int col_dim) {
+    MatrixTile tile;
+    if (!index.result) {
+        return tile;
+    }
+    for (int i = 0; i < (int)index.strides.size(); i++) {
+        if (i != row_dim && i != col_dim && !is_const_zero(index.strides[i])) {
+            return tile;
+        }
+    }
+    const Expr &row_stride = index.strides[row_dim];
+    const Expr &col_stride = index.strides[col_dim];
+    if (is_const_one(col_stride)) {
+        tile = {true, index.base, row_stride, false};
+    } else if (is_const_one(row_stride)) {
+        tile = {true, index.base, col_stride, true};
+    }
+    return tile;
+}
+
+vector<Expr> tile_args(const string &buffer, const MatrixTile &tile) {
+    return {Variable::make(Handle(), buffer), tile.base, tile.stride, (int)tile.col_major};
+}
+
+// Find the load an operand of the multiply widens, if any.
+const Load *widened_load(const Expr &e) {
+    Expr v = e;
+    while (const Cast *c = v.as<Cast>()) {
+        if (!c->type.can_represent(c->value.type())) {
+            return nullptr;
+        }
+        v = c->value;
+    }
+    const Load *load = v.as<Load>();
+    if (!load || !is_const_one(load->predicate)) {
+        return nullptr;
+    }
+    return load;
+}
+
+// Look through any lets in the tiles a store uses.
+Stmt without_lets(const Store *op) {
+    return Store::make(op->name, substitute_in_all_lets(op->value),
+                       substitute_in_all_lets(op->index), op->param,
+                       op->predicate, op->alignment);
+}
+
+struct Matmul {
+    bool result = false;
+    const Load *a = nullptr;
+    const Load *b = nullptr;
+    MatrixTile a_tile, b_tile;
+};
+
+Matmul match_matmul(const Store *op, const Type &accumulator_type) {
+    // m[tile] = m[tile] + VectorReduce(Add, widen(a[MxK tile]) * widen(b[KxN tile]))
+    Matmul result;
+    int n_dim = accumulator_column_dim(op->index);
+    const Add *add = op->value.as<Add>();
+    if (n_dim < 0 || !add || !is_const_one(op->predicate)) {
+        return result;
+    }
+    const VectorReduce *reduce = add->a.as<VectorReduce>();
+    const Load *acc = add->b.as<Load>();
+    if (!reduce) {
+        reduce = add->b.as<VectorReduce>();
+        acc = add->a.as<Load>();
+    }
+    if (!reduce || reduce->op != VectorReduce::Add ||
+        !acc || acc->name != op->name || !equal(acc->index, op->index)) {
+        return result;
+    }
+    const Mul *mul = reduce->value.as<Mul>();
+    if (!mul) {
+        return result;
+    }
+    const Load *a = widened_load(mul->a);
+    const Load *b = widened_load(mul->b);
+    if (!a || !b || a->type.element_of() != b->type.element_of()) {
+        return result;
+    }
+
+    Type t = a->type.element_of();
+    Type expected_accumulator_type = (t.is_float() || t.is_bfloat()) ? Float(32) : Int(32);
+    bool supported = (t == Float(16) || t == BFloat(16) || t == Float(32) ||
+                      t == Int(8) || t == UInt(8));
+    if (!supported || accumulator_type != expected_accumulator_type) {
+        return result;
+    }
+    int k = tile_depth(t);
+    if (reduce->value.type().lanes() != k * reduce->type.lanes()) {
+        return result;
+    }
+
+    // The lanes of the multiply are the reduction, then the two dims of
+    // the accumulator.
+    const vector<int> dims = {k, tile_size, tile_size};
+    const int n = 1 + n_dim, m = 2 - n_dim;
+    AffineIndex a_index = tile_index(a->index, dims);
+    AffineIndex b_index = tile_index(b->index, dims);
+    MatrixTile a_tile = matrix_tile(a_index, m, 0);
+    MatrixTile b_tile = matrix_tile(b_index, 0, n);
+    if (!a_tile.result || !b_tile.result) {
+        // The operands may be the other way around.
+        std::swap(a, b);
+        a_tile = matrix_tile(b_index, m, 0);
+        b_tile = matrix_tile(a_index, 0, n);
+    }
+    if (!a_tile.result || !b_tile.result) {
+        return result;
+    }
+    return {true, a, b, a_tile, b_tile};
+}
+
+// Find the type of the matrices multiplied into a tile, which decides
+// the depth of the tile.
+class FindOperandType : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &tile_name;
+    const Type &accumulator_type;
+
+    void visit(const Store *op) override {
+        if (op->name == tile_name) {
+            Stmt store = without_lets(op);
+            Matmul m = match_matmul(store.as<Store>(), accumulator_type);
+            if (m.result) {
+                Type t = m.a->type.element_of();
+                user_assert(!found || t == operand_type)
+                    << "Found matrix multiplies of both " << operand_type << " and " << t
+                    << " accumulating into the tensor core tile " << tile_name << "\n";
+                found = true;
+                operand_type = t;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool found = false;
+    Type operand_type;
+
+    FindOperandType(const string &tile_name, const Type &accumulator_type)
+        : tile_name(tile_name), accumulator_type(accumulator_type) {
+    }
+};
+
+class ExtractTensorCoreOperations : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    string tile_name;
+    string fragment_name;
+    Type accumulator_type;
+    int depth = 0;
+
+    bool in_kernel = false;
+    Scope<> thread_vars;
+    Expr threads_per_block = 1;
+    int thread_dependent_conditions = 0;
+    int tile_operations = 0;
+
+    Expr fragment() const {
+        return Variable::make(Handle(), fragment_name);
+    }
+
+    Stmt convert_to_matmul(const Store *op) {
+        Matmul m = match_matmul(op, accumulator_type);
+        if (!m.result) {
+            return Stmt();
+        }
+        Type t = m.a->type.element_of();
+        int required = t == Float(16) ? 70 : (t.is_int_or_uint() ? 75 : 80);
+        user_assert(target.get_cuda_capability_lower_bound() >= required)
+            << "Tensor core matrix multiplies of " << t << " need CUDA capability "
+            << required / 10 << "." << required % 10 << " or higher, but the target is "
+            << target.to_string() << "\n";
+
+        int k = tile_depth(t);
+        Expr a = Call::make(t.with_lanes(tile_size * k), "wmma_load_a",
+                            tile_args(m.a->name, m.a_tile), Call::Intrinsic);
+        Expr b = Call::make(t.with_lanes(k * tile_size), "wmma_load_b",
+                            tile_args(m.b->name, m.b_tile), Call::Intrinsic);
+        return Evaluate::make(Call::make(accumulator_type, "wmma_mma", {fragment(), a, b}, Call::Intrinsic));
+    }
+
+    Stmt convert_to_fill(const Store *op) {
+        const Broadcast *b = op->value.as<Broadcast>();
+        if (!b || !b->value.type().is_scalar() ||
+            !is_const_one(op->predicate) ||
+            accumulator_column_dim(op->index) < 0) {
+            return Stmt();
+        }
+        // Every element of the tile is the same, so it doesn't matter
+        // which of them each thread holds.
+        return Store::make(fragment_name, Broadcast::make(b->value, fragment_size),
+                           Ramp::make(0, 1, fragment_size), Parameter(),
+                           const_true(fragment_size), ModulusRemainder());
+    }
+
+    Stmt convert_to_load(const Store *op) {
+        const Load *load = op->value.as<Load>();
+        int n_dim = accumulator_column_dim(op->index);
+        if (!load || n_dim < 0 ||
+            !is_const_one(op->predicate) ||
+            !is_const_one(load->predicate)) {
+            return Stmt();
+        }
+        MatrixTile tile = matrix_tile(tile_index(load->index, {tile_size, tile_size}), 1 - n_dim, n_dim);
+        if (!tile.result) {
+            return Stmt();
+        }
+        vector<Expr> args = {fragment()};
+        vector<Expr> matrix = tile_args(load->name, tile);
+        args.insert(args.end(), matrix.begin(), matrix.end());
+        args.emplace_back(depth);
+        return Evaluate::make(Call::make(accumulator_type, "wmma_load_c", args, Call::Intrinsic));
+    }
+
+    Stmt convert_to_store(const Store *op, const Load *load) {
+        int n_dim = accumulator_column_dim(load->index);
+        if (n_dim < 0 ||
+            !is_const_one(op->predicate) ||
+            !is_const_one(load->predicate)) {
+            return Stmt();
+        }
+        MatrixTile tile = matrix_tile(tile_index(op->index, {tile_size, tile_size}), 1 - n_dim, n_dim);
+        if (!tile.result) {
+            return Stmt();
+        }
+        vector<Expr> args = tile_args(op->name, tile);
+        args.push_back(fragment());
+        args.emplace_back(depth);
+        return Evaluate::make(Call::make(accumulator_type, "wmma_store_d", args, Call::Intrinsic));
+    }
+
+    Stmt visit(const For *op) override {
+        if (CodeGen_GPU_Dev::is_gpu_block_var(op->name)) {
+            ScopedValue<bool> old_in_kernel(in_kernel, true);
+            return IRMutator::visit(op);
+        } else if (!CodeGen_GPU_Dev::is_gpu_thread_var(op->name)) {
+            return IRMutator::visit(op);
+        }
+
+        Expr threads = simplify(threads_per_block * op->extent);
+        ScopedValue<Expr> old_threads(threads_per_block, threads);
+        ScopedBinding<> bind(thread_vars, op->name);
+        int old_tile_operations = tile_operations;
+        Stmt body = mutate(op->body);
+        Expr extent = op->extent;
+        if (tile_operations > old_tile_operations && ends_with(op->name, ".__thread_id_x")) {
+            // This is the innermost loop over threads, so it has all
+            // of them.
+            const int64_t *n = as_const_int(threads);
+            user_assert(n && (*n == 1 || *n % warp_size == 0))
+                << "Tensor core operations need a whole number of warps in each GPU block, "
+                << "but a block has " << threads << " threads\n";
+            if (*n == 1) {
+                // There are no loops over threads, so launch a single
+                // warp to do the tile operations.
+                extent = warp_size;
+            }
+        }
+        if (body.same_as(op->body) && extent.same_as(op->extent)) {
+            return op;
+        }
+        return For::make(op->name, op->min, extent, op->for_type, op->device_api, body);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        if (!expr_uses_vars(op->condition, thread_vars)) {
+            return IRMutator::visit(op);
+        }
+        ScopedValue<int> old_conditions(thread_dependent_conditions, thread_dependent_conditions + 1);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type != MemoryType::MMAFragment) {
+            return IRMutator::visit(op);
+        }
+
+        user_assert(target.has_feature(Target::CUDATensorCores))
+            << "The tensor core tile " << op->name << " needs a target with the cuda_tensor_cores feature\n";
+        user_assert(in_kernel)
+            << "The tensor core tile " << op->name << " must be computed inside a CUDA kernel\n";
+        user_assert(op->type == Float(32) || op->type == Int(32))
+            << "The tensor core tile " << op->name << " must hold 32-bit floats or 32-bit integers, "
+            << "not " << op->type << "\n";
+        user_assert(op->constant_allocation_size() == tile_size * tile_size)
+            << "The tensor core tile " << op->name << " must be a single 16x16 tile\n";
+        user_assert(tile_name.empty())
+            << "The tensor core tile " << op->name << " is inside the tensor core tile " << tile_name << "\n";
+
+        FindOperandType operands(op->name, op->type);
+        op->body.accept(&operands);
+
+        ScopedValue<string> old_tile_name(tile_name, op->name);
+        ScopedValue<string> old_fragment_name(fragment_name, op->name + ".fragment");
+        ScopedValue<Type> old_accumulator_type(accumulator_type, op->type);
+        ScopedValue<int> old_depth(depth, operands.found ? tile_depth(operands.operand_type) : tile_size);
+        Stmt body = mutate(op->body);
+        return Allocate::make(fragment_name, op->type, MemoryType::MMAFragment, {fragment_size}, const_true(), body);
+    }
+
+    Stmt visit(const Free *op) override {
+        if (op->name != tile_name) {
+            return op;
+        }
+        return Free::make(fragment_name);
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (tile_name.empty() || op->name != tile_name) {
+            return IRMutator::visit(op);
+        }
+        return ProducerConsumer::make(fragment_name, op->is_producer, mutate(op->body));
+    }
+
+    Expr visit(const Load *op) override {
+        // Tile loads are matched in the stores that use them, so a load
+        // here means the tile is used outside of a tile operation.
+        user_assert(tile_name.empty() || op->name != tile_name)
+            << "The tensor core tile " << tile_name << " is used outside of a tensor core operation\n";
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        if (tile_name.empty()) {
+            return IRMutator::visit(op);
+        }
+
+        Stmt store = without_lets(op);
+        op = store.as<Store>();
+
+        Stmt result;
+        const Load *load = op->value.as<Load>();
+        if (op->name == tile_name) {
+            result = convert_to_matmul(op);
+            if (!result.defined()) {
+                result = convert_to_fill(op);
+            }
+            if (!result.defined()) {
+                result = convert_to_load(op);
+            }
+            user_assert(result.defined())
+                << "Found a store to the tensor core tile " << tile_name
+                << " that is not a 16x16 matrix multiply, fill, or load:\n"
+                << Stmt(op);
+        } else if (load && load->name == tile_name) {
+            result = convert_to_store(op, load);
+            user_assert(result.defined())
+                << "Found a load from the tensor core tile " << tile_name
+                << " that is not a 16x16 store:\n"
+                << Stmt(op);
+        } else {
+            return IRMutator::visit(op);
+        }
+
+        user_assert(thread_dependent_conditions == 0 && !stmt_uses_vars(result, thread_vars))
+            << "Tensor core operations on " << tile_name << " must be computed outside of any "
+            << "gpu_threads loops, as every thread of a warp takes part in them\n";
+        tile_operations++;
+        return result;
+    }
+
+public:
+    ExtractTensorCoreOperations(const Target &t)
+        : target(t) {
+    }
+};
+
+}  // namespace
+
+Stmt extract_tensor_core_operations(const Stmt &s, const Target &t) {
+    return ExtractTensorCoreOperations(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,28 @@
+#ifndef HALIDE_EXTRACT_TENSOR_CORE_OPERATIONS_H
+#define HALIDE_EXTRACT_TENSOR_CORE_OPERATIONS_H
+
+/** \file
+ * Defines the lowering pass that injects calls to the warp matrix
+ * multiply intrinsics of CUDA tensor cores.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Rewrite the 16x16 tiles stored in the MMAFragment memory type, and
+ * the vectorized matrix multiplies that accumulate into them, as calls
+ * to warp matrix multiply intrinsics, to be used in the PTX
+ * backend. These are collective operations over a warp, so the tiles
+ * must be computed outside of any gpu_threads loops. Kernels that
+ * have no loops over threads are launched with one warp per block. */
+Stmt extract_tensor_core_operations(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
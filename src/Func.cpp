@@ -695,6 +695,49 @@ bool apply_split_directive(const Split &s, vector<ReductionVariable> &rvars,
     return found;
 }
 
+/** Replace the calls to 'func' in the values of a scan along dimension
+ * 'dim'. Calls at the update's own args read the input of the scan, and
+ * go to 'input'. Calls one step back along 'dim' read the result of the
+ * previous step, and go to 'func' at the update's args, which is the
+ * form prove_associativity() expects. Any other call to 'func' means
+ * this is not a scan. */
+class SplitScanCalls : public IRMutator {
+    using IRMutator::visit;
+
+    const string &func;
+    const Function &input;
+    const vector<Expr> &args;
+    const int dim;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide || op->name != func) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> new_args;
+        bool same = true, previous = true;
+        for (size_t i = 0; i < op->args.size(); i++) {
+            new_args.push_back(mutate(op->args[i]));
+            Expr prev_arg = ((int)i == dim) ? args[i] - 1 : args[i];
+            same = same && can_prove(new_args[i] == args[i]);
+            previous = previous && can_prove(new_args[i] == prev_arg);
+        }
+        if (same) {
+            return Call::make(input, new_args, op->value_index);
+        } else if (previous) {
+            return Call::make(op->type, op->name, args, Call::Halide, op->func, op->value_index);
+        }
+        is_scan = false;
+        return op;
+    }
+
+public:
+    SplitScanCalls(const string &func, const Function &input, const vector<Expr> &args, int dim)
+        : func(func), input(input), args(args), dim(dim) {
+    }
+
+    bool is_scan = true;
+};
+
 }  // anonymous namespace
 
 Func Stage::rfactor(const RVar &r, const Var &v) {
@@ -1003,6 +1046,257 @@ Func Stage::rfactor(vector<pair<RVar, Var>> preserved) {
     return intm;
 }
 
+Func Stage::privatize(const RVar &r, const Var &u, int copies, PrivatizeStrategy strategy) {
+    user_assert(!definition.is_init()) << "privatize() must be called on an update definition\n";
+    user_assert(copies > 0)
+        << "In schedule for " << name()
+        << ", can't privatize() into " << copies << " copies\n";
+
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+    const auto &iter = std::find_if(rvars.begin(), rvars.end(),
+                                    [&r](const ReductionVariable &rv) { return var_name_match(rv.var, r.name()); });
+    user_assert(iter != rvars.end())
+        << "In schedule for " << name()
+        << ", can't perform privatize() on " << r.name()
+        << " since it is not in the reduction domain\n"
+        << dump_argument_list();
+
+    // Split r into the index of the private copy and the values of r each
+    // copy reduces, then lift everything but the copy index into the
+    // intermediate with rfactor(), which proves the update associative.
+    RVar copy(r.name() + "_copy"), in_copy(r.name() + "_in_copy");
+    if (strategy == PrivatizeStrategy::Parallel) {
+        Expr chunk = (iter->extent + (copies - 1)) / copies;
+        split(r, copy, in_copy, chunk, TailStrategy::GuardWithIf);
+    } else {
+        split(r, in_copy, copy, copies, TailStrategy::GuardWithIf);
+    }
+    Func intm = rfactor(copy, u);
+
+    auto move_outermost = [](vector<Dim> &dims, const string &var) {
+        const auto &it = std::find_if(dims.begin(), dims.end(),
+                                      [&var](const Dim &d) { return var_name_match(d.var, var); });
+        internal_assert(it != dims.end());
+        Dim d = *it;
+        dims.erase(it);
+        dims.insert(dims.end() - 1, d);
+    };
+
+    if (strategy == PrivatizeStrategy::Parallel) {
+        // rfactor() already stores the new Var outermost. Make it the
+        // outermost loop too, so each task reduces its whole chunk.
+        move_outermost(intm.function().update(0).schedule().dims(), u.name());
+        intm.parallel(u);
+        intm.update(0).parallel(u);
+    } else {
+        // u replaced the innermost RVar, so it is already the innermost
+        // loop. Store it innermost too.
+        vector<Var> storage_order{u};
+        vector<VarOrRVar> loop_order{u};
+        for (const Var &v : dim_vars) {
+            storage_order.push_back(v);
+            loop_order.emplace_back(v);
+        }
+        intm.reorder_storage(storage_order);
+        intm.reorder(loop_order).vectorize(u);
+        intm.update(0).vectorize(u);
+    }
+    intm.bound(u, 0, copies).compute_at(Func(function), Var::outermost());
+
+    // Merge one copy at a time.
+    move_outermost(definition.schedule().dims(), copy.name());
+
+    return intm;
+}
+
+Func Stage::parallel_scan(const RVar &r, const Var &b, int blocks) {
+    user_assert(!definition.is_init()) << "parallel_scan() must be called on an update definition\n";
+    user_assert(blocks > 0)
+        << "In schedule for " << name()
+        << ", can't parallel_scan() in " << blocks << " blocks\n";
+    user_assert(!function.has_extern_definition())
+        << "In schedule for " << name()
+        << ", can't parallel_scan() an extern Func\n";
+
+    definition.schedule().touched() = true;
+
+    const string &func_name = function.name();
+    vector<Expr> &args = definition.args();
+    vector<Expr> &values = definition.values();
+    const vector<ReductionVariable> &rvars = definition.schedule().rvars();
+
+    user_assert(rvars.size() == 1 && var_name_match(rvars[0].var, r.name()))
+        << "In schedule for " << name()
+        << ", can't perform parallel_scan() on " << r.name()
+        << " since it is not the only variable of the reduction domain\n"
+        << dump_argument_list();
+    user_assert(definition.schedule().splits().empty() &&
+                is_const_one(simplify(definition.predicate())))
+        << "In schedule for " << name()
+        << ", parallel_scan() must be applied to an unsplit and unpredicated update\n";
+    const ReductionVariable &rv = rvars[0];
+
+    // Find the dimension being scanned. The others must be pure.
+    int dim = -1;
+    vector<Expr> other_vars;
+    for (size_t i = 0; i < args.size(); i++) {
+        const Variable *v = args[i].as<Variable>();
+        if (v && v->name == rv.var && dim < 0) {
+            dim = (int)i;
+        } else {
+            user_assert(v && v->name == dim_vars[i].name())
+                << "In schedule for " << name()
+                << ", can't perform parallel_scan(), since argument " << i
+                << " is neither " << r.name() << " nor the pure Var " << dim_vars[i].name() << "\n";
+            other_vars.push_back(args[i]);
+        }
+    }
+    user_assert(dim >= 0)
+        << "In schedule for " << name()
+        << ", can't perform parallel_scan(), since " << r.name()
+        << " is not an argument of the update\n";
+
+    // The scan's input is the value of the Func before this update. Give
+    // the stages so far a Func of their own, so that the passes below
+    // can read it while this update overwrites the Func.
+    Func input(unique_name(func_name + "_scan_input"));
+    input(dim_vars) = Tuple(function.definition().values());
+    for (size_t s = 0; s + 1 < stage_index; s++) {
+        const Definition &u = function.update(s);
+        vector<Expr> u_args, u_values;
+        for (const Expr &e : u.args()) {
+            u_args.push_back(substitute_self_reference(e, func_name, input.function(), {}));
+        }
+        for (const Expr &e : u.values()) {
+            u_values.push_back(substitute_self_reference(e, func_name, input.function(), {}));
+        }
+        input(u_args) = Tuple(u_values);
+    }
+    if (stage_index > 1) {
+        input.compute_at(Func(function), Var::outermost());
+    }
+
+    SplitScanCalls split_calls(func_name, input.function(), args, dim);
+    vector<Expr> split_values;
+    for (const Expr &e : values) {
+        split_values.push_back(split_calls.mutate(e));
+    }
+    user_assert(split_calls.is_scan)
+        << "In schedule for " << name()
+        << ", can't perform parallel_scan(), since the update reads " << func_name
+        << " somewhere other than at its own site and one step back along " << r.name() << "\n";
+
+    const auto &prover_result = prove_associativity(func_name, args, split_values);
+    user_assert(prover_result.associative())
+        << "Failed to call parallel_scan() on " << name()
+        << " since it can't prove associativity of the operator\n";
+    internal_assert(prover_result.size() == values.size());
+
+    // Apply the operator to two partial results.
+    auto combine = [&](const vector<Expr> &a, const vector<Expr> &b) {
+        map<string, Expr> replacements;
+        for (size_t i = 0; i < values.size(); i++) {
+            if (!prover_result.xs[i].var.empty()) {
+                replacements.emplace(prover_result.xs[i].var, a[i]);
+            }
+            if (!prover_result.ys[i].var.empty()) {
+                replacements.emplace(prover_result.ys[i].var, b[i]);
+            }
+        }
+        vector<Expr> result;
+        for (const Expr &op : prover_result.pattern.ops) {
+            result.push_back(substitute(replacements, op));
+        }
+        return result;
+    };
+    // The input of the step at position p along the scanned dimension.
+    auto input_at = [&](const Expr &p) {
+        vector<Expr> result;
+        for (const auto &y : prover_result.ys) {
+            result.push_back(y.expr.defined() ? substitute(rv.var, p, y.expr) : Expr());
+        }
+        return result;
+    };
+    auto call = [&](Func f, const vector<Expr> &call_args) {
+        FuncRef ref = f(call_args);
+        vector<Expr> result;
+        if (values.size() == 1) {
+            result.emplace_back(ref);
+        } else {
+            for (size_t i = 0; i < values.size(); i++) {
+                result.emplace_back(ref[i]);
+            }
+        }
+        return result;
+    };
+    auto with_vars = [&](vector<Expr> front) {
+        front.insert(front.end(), other_vars.begin(), other_vars.end());
+        return front;
+    };
+    vector<Var> other_pure_vars;
+    for (size_t i = 0; i < dim_vars.size(); i++) {
+        if ((int)i != dim) {
+            other_pure_vars.push_back(dim_vars[i]);
+        }
+    }
+
+    const Expr &min = rv.min;
+    Expr extent = rv.extent;
+    Expr block_size = (extent + (blocks - 1)) / blocks;
+    Tuple identities(prover_result.pattern.identities);
+
+    // First pass: scan each block from the identity, in parallel.
+    Var i(func_name + "_scan_i");
+    Func local(unique_name(func_name + "_scan_local"));
+    vector<Var> local_vars{i, b};
+    local_vars.insert(local_vars.end(), other_pure_vars.begin(), other_pure_vars.end());
+    local(local_vars) = identities;
+    RDom ri(0, block_size, func_name + "_scan_ri");
+    ri.where(b * block_size + ri < extent);
+    local(with_vars({ri, b})) =
+        Tuple(combine(call(local, with_vars({ri - 1, b})), input_at(min + b * block_size + ri)));
+
+    // Second pass: an exclusive scan of the block totals, serially.
+    Func offset(unique_name(func_name + "_scan_offset"));
+    vector<Var> offset_vars{b};
+    offset_vars.insert(offset_vars.end(), other_pure_vars.begin(), other_pure_vars.end());
+    offset(offset_vars) = identities;
+    if (blocks > 1) {
+        RDom rb(1, blocks - 1, func_name + "_scan_rb");
+        offset(with_vars({rb})) =
+            Tuple(combine(call(offset, with_vars({rb - 1})),
+                          call(local, with_vars({block_size - 1, rb - 1}))));
+    }
+
+    // Third pass: this update, which now combines the value before the
+    // scan, the block's offset and the local scan at each site. It no
+    // longer reads the Func, so it parallelizes.
+    Expr q = args[dim] - min;
+    Expr block = q / block_size;
+    vector<Expr> carry_args = args;
+    carry_args[dim] = min - 1;
+    values = combine(combine(call(input, carry_args), call(offset, with_vars({block}))),
+                     call(local, with_vars({q - block * block_size, block})));
+
+    vector<VarOrRVar> local_order{i};
+    vector<VarOrRVar> local_update_order{RVar(ri)};
+    for (const Var &v : other_pure_vars) {
+        local_order.emplace_back(v);
+        local_update_order.emplace_back(v);
+    }
+    local_order.emplace_back(b);
+    local_update_order.emplace_back(b);
+    local.bound(b, 0, blocks)
+        .compute_at(Func(function), Var::outermost())
+        .reorder(local_order)
+        .parallel(b);
+    local.update(0).reorder(local_update_order).parallel(b);
+    offset.bound(b, 0, blocks).compute_at(Func(function), Var::outermost());
+    parallel(r);
+
+    return local;
+}
+
 void Stage::split(const string &old, const string &outer, const string &inner, const Expr &factor, bool exact, TailStrategy tail) {
     debug(4) << "In schedule for " << name() << ", split " << old << " into "
              << outer << " and " << inner << " with factor of " << factor << "\n";
@@ -1544,6 +1838,19 @@ Stage &Stage::parallel(const VarOrRVar &var) {
     return *this;
 }
 
+Stage &Stage::distribute(const Var &var) {
+    user_assert(!function.has_update_definition())
+        << "In schedule for " << name() << ", can't distribute " << var.name()
+        << ", because " << function.name() << " has update definitions.\n";
+    set_dim_type(var, ForType::Distributed);
+    return *this;
+}
+
+Stage &Stage::multi_gpu(const VarOrRVar &var) {
+    set_dim_type(var, ForType::MultiGPU);
+    return *this;
+}
+
 Stage &Stage::vectorize(const VarOrRVar &var) {
     set_dim_type(var, ForType::Vectorized);
     return *this;
@@ -1593,6 +1900,26 @@ Stage &Stage::unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail
     return *this;
 }
 
+Stage &Stage::unroll_and_jam(const VarOrRVar &var, const Expr &factor, TailStrategy tail) {
+    VarOrRVar inner = var.is_rvar ? VarOrRVar(RVar()) : VarOrRVar(Var());
+    split(var, var, inner, factor, tail);
+
+    // Reorder the inner dimension of the split to be inside all the
+    // loops that were inside it, except vectorized ones.
+    vector<VarOrRVar> order = {inner};
+    for (const Dim &dim : definition.schedule().dims()) {
+        if (var_name_match(dim.var, inner.name())) {
+            break;
+        }
+        if (dim.for_type != ForType::Vectorized) {
+            order.emplace_back(dim.var, dim.is_rvar());
+        }
+    }
+    reorder(order);
+    unroll(inner);
+    return *this;
+}
+
 Stage &Stage::tile(const VarOrRVar &x, const VarOrRVar &y,
                    const VarOrRVar &xo, const VarOrRVar &yo,
                    const VarOrRVar &xi, const VarOrRVar &yi,
@@ -2220,12 +2547,31 @@ Func &Func::store_in(MemoryType t) {
     return *this;
 }
 
+Func &Func::store_as(Type t) {
+    user_assert(t.is_float() && t.is_scalar())
+        << "Func " << name() << " can't be stored as " << t
+        << ", as only scalar floating point storage types are supported.\n";
+    invalidate_cache();
+    func.schedule().storage_type() = t;
+    return *this;
+}
+
 Func &Func::async() {
     invalidate_cache();
     func.schedule().async() = true;
     return *this;
 }
 
+Func &Func::ring_buffer(Expr buffers) {
+    user_assert(buffers.defined() && buffers.type().is_int_or_uint())
+        << "The number of buffers in the ring for Func " << name() << " must be an integer\n";
+    user_assert(!is_const(buffers) || is_positive_const(buffers))
+        << "The number of buffers in the ring for Func " << name() << " must be positive\n";
+    invalidate_cache();
+    func.schedule().ring_buffer() = cast<int>(std::move(buffers));
+    return *this;
+}
+
 Stage Func::specialize(const Expr &c) {
     invalidate_cache();
     return Stage(func, func.definition(), 0).specialize(c);
@@ -2248,6 +2594,18 @@ Func &Func::parallel(const VarOrRVar &var) {
     return *this;
 }
 
+Func &Func::distribute(const Var &var) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).distribute(var);
+    return *this;
+}
+
+Func &Func::multi_gpu(const VarOrRVar &var) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).multi_gpu(var);
+    return *this;
+}
+
 Func &Func::vectorize(const VarOrRVar &var) {
     invalidate_cache();
     Stage(func, func.definition(), 0).vectorize(var);
@@ -2278,6 +2636,12 @@ Func &Func::unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail)
     return *this;
 }
 
+Func &Func::unroll_and_jam(const VarOrRVar &var, const Expr &factor, TailStrategy tail) {
+    invalidate_cache();
+    Stage(func, func.definition(), 0).unroll_and_jam(var, factor, tail);
+    return *this;
+}
+
 Func &Func::bound(const Var &var, Expr min, Expr extent) {
     user_assert(!min.defined() || Int(32).can_represent(min.type())) << "Can't represent min bound in int32\n";
     user_assert(extent.defined()) << "Extent bound of a Func can't be undefined\n";
@@ -2663,6 +3027,24 @@ Func &Func::align_storage(const Var &dim, const Expr &alignment) {
     return *this;
 }
 
+Func &Func::pad_storage(const Var &dim, const Expr &alignment) {
+    invalidate_cache();
+
+    vector<StorageDim> &dims = func.schedule().storage_dims();
+    for (auto &d : dims) {
+        if (var_name_match(d.var, dim.name())) {
+            d.alignment = alignment;
+            d.pad_stride = true;
+            return *this;
+        }
+    }
+    user_error << "In schedule for " << name()
+               << ", could not find var " << dim.name()
+               << " to pad the storage of.\n"
+               << dump_dim_list(func.schedule().storage_dims());
+    return *this;
+}
+
 Func &Func::bound_storage(const Var &dim, const Expr &bound) {
     invalidate_cache();
 
@@ -189,6 +189,58 @@ public:
     Func rfactor(const RVar &r, const Var &v);
     // @}
 
+    /** Parallelize or vectorize an associative update over the RVar r
+     * without atomics, by giving each thread or vector lane a private
+     * copy of the Func to reduce into, and then merging the copies into
+     * this Func. This is rfactor() with a schedule chosen for
+     * scatter-reductions such as histograms:
+     \code
+     hist(x) = 0;
+     hist(im(r.x, r.y)) += 1;
+     hist.update().privatize(r.y, u, 8);
+     \endcode
+     * splits r.y into 8 chunks and becomes:
+     \code
+     hist_intm(x, u) = 0;
+     hist_intm(im(r.x, r.y_in_copy + u * chunk), u) += 1;  // parallel over u
+     hist(x) = 0;
+     hist(x) += hist_intm(x, r.y_copy);  // loops over r.y_copy outside x
+     \endcode
+     * r must be a dimension of the reduction domain. The Var u is the
+     * index of the copy in the returned intermediate Func, which holds the
+     * private copies, and is computed at the outermost loop of this Func.
+     * Its layout is set by the strategy; see PrivatizeStrategy. The
+     * merge visits the copies one at a time, with the pure Vars of this
+     * Func inside, so it can be vectorized across them. */
+    Func privatize(const RVar &r, const Var &u, int copies,
+                   PrivatizeStrategy strategy = PrivatizeStrategy::Parallel);
+
+    /** Parallelize a scan along the RVar r, such as
+     \code
+     f(x) = in(x);
+     f(r) = f(r - 1) + f(r);
+     \endcode
+     * where each step combines the result of the step before with the
+     * value of the Func at r before this update, using an operator that
+     * can be proven associative. The scan is split into 'blocks' blocks,
+     * and becomes three passes: the blocks are scanned independently in
+     * parallel over the Var b, then the block totals are scanned
+     * serially, then this update combines the two in parallel over r:
+     \code
+     f_scan_local(i, b) = 0;
+     f_scan_local(ri, b) = f_scan_local(ri - 1, b) + f_scan_input(b * block + ri);
+     f_scan_offset(b) = 0;
+     f_scan_offset(rb) = f_scan_offset(rb - 1) + f_scan_local(block - 1, rb - 1);
+     f(r) = f_scan_input(-1) + f_scan_offset(r / block) + f_scan_local(r % block, r / block);
+     \endcode
+     * where f_scan_input is a copy of the stages of f before this one.
+     * r must be the only RVar of the update, the other arguments must be
+     * pure Vars, and the update must not be split yet. Returns
+     * f_scan_local, which, like f_scan_offset, is computed at the
+     * outermost loop of this Func, so that it can be scheduled further,
+     * e.g. with gpu_blocks(b) in place of parallel(b) on a GPU. */
+    Func parallel_scan(const RVar &r, const Var &b, int blocks);
+
     /** Schedule the iteration over this stage to be fused with another
      * stage 's' from outermost loop to a given LoopLevel. 'this' stage will
      * be computed AFTER 's' in the innermost fused dimension. There should not
@@ -344,11 +396,14 @@ public:
     Stage &fuse(const VarOrRVar &inner, const VarOrRVar &outer, const VarOrRVar &fused);
     Stage &serial(const VarOrRVar &var);
     Stage &parallel(const VarOrRVar &var);
+    Stage &distribute(const Var &var);
+    Stage &multi_gpu(const VarOrRVar &var);
     Stage &vectorize(const VarOrRVar &var);
     Stage &unroll(const VarOrRVar &var);
     Stage &parallel(const VarOrRVar &var, const Expr &task_size, TailStrategy tail = TailStrategy::Auto);
     Stage &vectorize(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
     Stage &unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
+    Stage &unroll_and_jam(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
     Stage &tile(const VarOrRVar &x, const VarOrRVar &y,
                 const VarOrRVar &xo, const VarOrRVar &yo,
                 const VarOrRVar &xi, const VarOrRVar &yi, const Expr &xfactor, const Expr &yfactor,
@@ -1106,7 +1161,14 @@ public:
      * 5, uint32_t = 6, int32_t = 7, uint64_t = 8, int64_t = 9. The
      * data follows the header, as a densely packed array of the given
      * size and the given type. If given the extension .tmp, this file
-     * format can be natively read by the program ImageStack. */
+     * format can be natively read by the program ImageStack.
+     *
+     * By default the file is written synchronously by the thread that
+     * computed the Func. See halide_debug_to_file_set_async (or the
+     * HL_DEBUG_TO_FILE_ASYNC environment variable) to have the runtime
+     * copy the buffer and write it on a background thread instead, and
+     * halide_debug_to_file_set_sampling to write only some of the times
+     * the Func is computed. */
     void debug_to_file(const std::string &filename);
 
     /** The name of this function, either given during construction,
@@ -1451,6 +1513,62 @@ public:
      * manually. */
     Func &parallel(const VarOrRVar &var, const Expr &task_size, TailStrategy tail = TailStrategy::Auto);
 
+    /** Distribute a dimension across the ranks of a distributed
+     * computation, in which several processes (e.g. the ranks of an MPI
+     * job) each call the pipeline with the same arguments. Each rank
+     * computes one contiguous block of the dimension, of an equal share
+     * of its extent. The dimension must be one of the Func's own pure
+     * Vars, and may not be split or fused, and the Func may not have
+     * update definitions. The loop over it may not be inside another
+     * distributed or parallel loop, but the block of each rank can be
+     * further scheduled by scheduling the Vars of the other dimensions.
+     *
+     * When the Func is computed at root and used by another stage, each
+     * rank only stores the part it computed and the part its consumers
+     * need. Rows computed by other ranks are received just before the
+     * consumers run, using halide_distributed_exchange (see
+     * HalideRuntime.h), which is where the communication happens. Input
+     * buffers only need to hold the region the calling rank reads, but
+     * output buffers must describe the whole output on every rank, as
+     * that is what is divided between them; each rank only writes its
+     * own block of them. Funcs computed at root that are not
+     * distributed are computed whole by every rank.
+     *
+     * The number of ranks and the rank of the caller come from
+     * halide_distributed_num_ranks and halide_distributed_rank. By
+     * default there is one rank, which computes everything. */
+    Func &distribute(const Var &var);
+
+    /** Split the work of a pipeline across several GPUs by traversing
+     * a dimension in parallel, with each iteration using a different
+     * GPU device. Iteration i (counting from the loop min) runs with
+     * the user_context returned by
+     * halide_gpu_device_user_context(user_context, i) (see
+     * HalideRuntime.h), so that everything done inside it (device
+     * allocations, copies and kernel launches) happens on the device
+     * that the GPU runtime selects for that user_context, e.g. by
+     * overriding halide_cuda_acquire_context. Iterations on different
+     * devices run concurrently, and their kernels with them.
+     *
+     * The Funcs computed inside the loop are the per-device shards of
+     * the work. GPU kernels inside the loop may only access buffers
+     * allocated inside it, so a region of an input or of a Func
+     * computed outside the loop that a shard reads (including its
+     * halo) must be staged through a host Func computed inside the
+     * loop, e.g. input.in().compute_at(f, yo). The Func whose
+     * dimension is traversed gathers the results into its own buffer
+     * on the host. Typically the dimension is split so that its extent
+     * is the number of GPUs:
+     *
+     \code
+     f.split(y, yo, yi, f.output_buffer().height() / 4).multi_gpu(yo);
+     g.compute_at(f, yo).gpu_tile(x, y, xi, yi, 16, 16);
+     \endcode
+     *
+     * By default, halide_gpu_device_user_context returns its argument,
+     * and all iterations use the same device. */
+    Func &multi_gpu(const VarOrRVar &var);
+
     /** Mark a dimension to be computed all-at-once as a single
      * vector. The dimension should have constant extent -
      * e.g. because it is the inner dimension following a split by a
@@ -1478,6 +1596,17 @@ public:
      * dimension of the split. 'factor' must be an integer. */
     Func &unroll(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
 
+    /** Split a dimension by the given factor, move the inner
+     * dimension inside all the other loops except vectorized ones, and
+     * unroll it. This jams the unrolled iterations together in the
+     * innermost loop body, so that values loaded by all of them, such
+     * as a row of one matrix in a matrix multiply, are loaded once and
+     * kept in registers. How many shared values are kept depends on
+     * the number of registers of the target. After this call, var
+     * refers to the outer dimension of the split. 'factor' must be an
+     * integer. */
+    Func &unroll_and_jam(const VarOrRVar &var, const Expr &factor, TailStrategy tail = TailStrategy::Auto);
+
     /** Statically declare that the range over which a function should
      * be evaluated is given by the second and third arguments. This
      * can let Halide perform some optimizations. E.g. if you know
@@ -2015,6 +2144,14 @@ public:
      *
      * Note that calling prefetch() with the same var for both 'at' and 'from'
      * is equivalent to calling prefetch() with that var.
+     *
+     * If the loop writes to the prefetched Func (e.g. a Func prefetching
+     * the next rows of its own output), the prefetch asks for the data
+     * in a state ready to be written to, where the target supports it.
+     *
+     * The best offset depends on the machine. It may be a Param, or a
+     * tuned_prefetch_distance(), which tries a few distances over the
+     * first runs of the 'at' loop and then keeps the fastest.
      */
     // @{
     Func &prefetch(const Func &f, const VarOrRVar &at, const VarOrRVar &from, Expr offset = 1,
@@ -2066,6 +2203,19 @@ public:
      * aligned to multiples of 16, use foo.align_storage(x, 16). */
     Func &align_storage(const Var &dim, const Expr &alignment);
 
+    /** Pad the storage extent of a dimension like align_storage, and
+     * pad it by one more multiple of the alignment whenever the stride
+     * it gives the next dimension would otherwise be a power of two of
+     * at least 1KB. Rows with power-of-two strides all map to the same
+     * few cache sets, so walking down a column of, say, a 1024 or 2048
+     * wide intermediate keeps evicting lines that are still in
+     * use. If the alignment is not given, it is a cache line or a
+     * native vector of the target, whichever is larger, which also
+     * lets loads from the start of each row be aligned. This needs no
+     * knowledge of the target, so autoschedulers can use it on any
+     * intermediate. */
+    Func &pad_storage(const Var &dim, const Expr &alignment = Expr());
+
     /** Store realizations of this function in a circular buffer of a
      * given extent. This is more efficient when the extent of the
      * circular buffer is a power of 2. If the fold factor is too
@@ -2256,6 +2406,31 @@ public:
      */
     Func &async();
 
+    /** Keep the given number of copies of this Func's storage, and
+     * rotate through them on successive iterations of the loops
+     * between its store level and its compute level, instead of
+     * overwriting a single copy on each iteration. Combined with
+     * async(), this lets the producer run up to that many iterations
+     * ahead of its consumers, which absorbs variation in how long
+     * each iteration of the producer or consumer takes instead of
+     * stalling the faster one. For example, to decode frames into a
+     * queue of four buffers while the rest of the pipeline consumes
+     * them:
+     *
+     \code
+     decoded.store_root().compute_at(output, frame).async().ring_buffer(4);
+     \endcode
+     *
+     * The producer blocks when all copies are full, and each copy is
+     * released for reuse as soon as the consumers of it are done.
+     * Every copy covers the union of the regions required across all
+     * iterations, so this is most useful when that region is the
+     * same on each iteration. Ring-buffered storage is not slid or
+     * folded, and the loops between the store level and the compute
+     * level must be serial.
+     */
+    Func &ring_buffer(Expr buffers);
+
     /** Bound the extent of a Func's storage, but not extent of its
      * compute. This can be useful for forcing a function's allocation
      * to be a fixed size, which often means it can go on the stack.
@@ -2356,6 +2531,17 @@ public:
      * improves locality by reusing recently-accessed memory instead
      * of pulling new memory into cache.
      *
+     * Sliding happens over every serial loop between the store and
+     * compute levels, so it also applies to tiled consumers. With g
+     * computed at the tile loop xo of f, storing g at root slides
+     * down the rows of tiles and across each row of tiles, so no
+     * halo is ever recomputed. g's storage is then folded down the
+     * rows, leaving a buffer as wide as f that holds a tile's height
+     * plus the halo. Storing g at the loop over rows of tiles
+     * instead slides only across each row, which recomputes the
+     * vertical halo once per row of tiles. In exchange, g's storage
+     * is a small circular buffer of whole columns of one tile.
+     *
      */
     Func &store_at(const Func &f, const Var &var);
 
@@ -2409,6 +2595,20 @@ public:
      * on MemoryType for more detail. */
     Func &store_in(MemoryType memory_type);
 
+    /** Store the values of this Func as the given narrower floating
+     * point type, e.g. Float(16) or BFloat(16), while still computing
+     * them in its own type. Values are rounded to the storage type when
+     * stored and widened again when loaded, so this halves or quarters
+     * the memory traffic of a bandwidth-bound pipeline without
+     * changing its arithmetic. The conversions vectorize where the
+     * target has instructions for them (e.g. F16C on x86). Each update
+     * definition rounds again, so precision is lost at every update.
+     *
+     * The Func must have a floating point type, and it can't be an
+     * output of the pipeline or an extern stage, or be used by an
+     * extern stage, as those see its buffer directly. */
+    Func &store_as(Type storage_type);
+
     /** Trace all loads from this Func by emitting calls to
      * halide_trace. If the Func is inlined, this has no
      * effect. */
@@ -0,0 +1,390 @@
+#include <map>
+#include <set>
+#include <utility>
+
+#include "ExprUsesVar.h"
+#include "FuseGPUKernels.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+#include "Simplify.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::pair;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A loop nest over GPU blocks and then threads, with nothing but
+// LetStmts between the loops.
+struct KernelNest {
+    // The loops and the LetStmts between them, outermost first.
+    vector<Stmt> path;
+    vector<const For *> loops;
+    // The position of each loop in the path.
+    vector<size_t> loop_positions;
+    // The body of the innermost loop over threads.
+    Stmt body;
+};
+
+bool peel_kernel(const Stmt &s, KernelNest &k) {
+    const For *kernel = s.as<For>();
+    if (!kernel || kernel->for_type != ForType::GPUBlock) {
+        return false;
+    }
+
+    Stmt body = s;
+    while (true) {
+        const For *loop = body.as<For>();
+        if (loop &&
+            loop->device_api == kernel->device_api &&
+            (loop->for_type == ForType::GPUThread ||
+             (loop->for_type == ForType::GPUBlock &&
+              (k.loops.empty() || k.loops.back()->for_type == ForType::GPUBlock)))) {
+            k.loop_positions.push_back(k.path.size());
+            k.loops.push_back(loop);
+            k.path.push_back(body);
+            body = loop->body;
+        } else if (const LetStmt *let = body.as<LetStmt>()) {
+            k.path.push_back(body);
+            body = let->body;
+        } else {
+            break;
+        }
+    }
+
+    // LetStmts after the innermost loop belong to the body.
+    while (k.path.size() > k.loop_positions.back() + 1) {
+        body = k.path.back();
+        k.path.pop_back();
+    }
+    k.body = body;
+    return true;
+}
+
+// Rebuild a loop nest around a new body.
+Stmt rebuild_kernel(const KernelNest &k, Stmt body) {
+    for (size_t i = k.path.size(); i > 0; i--) {
+        if (const For *loop = k.path[i - 1].as<For>()) {
+            body = For::make(loop->name, loop->min, loop->extent,
+                             loop->for_type, loop->device_api, body);
+        } else {
+            const LetStmt *let = k.path[i - 1].as<LetStmt>();
+            internal_assert(let);
+            body = LetStmt::make(let->name, let->value, body);
+        }
+    }
+    return body;
+}
+
+// The body of the innermost loop, wrapped in all the LetStmts between
+// the loops.
+Stmt kernel_body_with_lets(const KernelNest &k) {
+    Stmt body = k.body;
+    for (size_t i = k.path.size(); i > 0; i--) {
+        if (const LetStmt *let = k.path[i - 1].as<LetStmt>()) {
+            body = LetStmt::make(let->name, let->value, body);
+        }
+    }
+    return body;
+}
+
+// Substitute in the values of the lets that enclose a given position
+// in a kernel's loop nest, and then those that enclose the kernel.
+Expr expand_lets(Expr e, const KernelNest &k, size_t position,
+                 const vector<pair<string, Expr>> &outer_lets) {
+    for (size_t i = position; i > 0; i--) {
+        if (const LetStmt *let = k.path[i - 1].as<LetStmt>()) {
+            e = substitute(let->name, let->value, e);
+        }
+    }
+    for (auto it = outer_lets.rbegin(); it != outer_lets.rend(); it++) {
+        e = substitute(it->first, it->second, e);
+    }
+    return e;
+}
+
+string gpu_loop_suffix(const string &name) {
+    size_t dot = name.rfind('.');
+    return dot == string::npos ? name : name.substr(dot + 1);
+}
+
+// Check whether two kernels launch the same number of blocks and
+// threads in each dimension.
+bool same_geometry(const KernelNest &a, const KernelNest &b,
+                   const vector<pair<string, Expr>> &outer_lets) {
+    if (a.loops.size() != b.loops.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.loops.size(); i++) {
+        const For *la = a.loops[i], *lb = b.loops[i];
+        if (la->for_type != lb->for_type ||
+            la->device_api != lb->device_api ||
+            gpu_loop_suffix(la->name) != gpu_loop_suffix(lb->name)) {
+            return false;
+        }
+        Expr min_a = expand_lets(la->min, a, a.loop_positions[i], outer_lets);
+        Expr min_b = expand_lets(lb->min, b, b.loop_positions[i], outer_lets);
+        Expr extent_a = expand_lets(la->extent, a, a.loop_positions[i], outer_lets);
+        Expr extent_b = expand_lets(lb->extent, b, b.loop_positions[i], outer_lets);
+        if (!can_prove(min_a == min_b) || !can_prove(extent_a == extent_b)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Find the memory a kernel body loads from and stores to, and the
+// indices it uses to do so, in terms of the variables defined outside
+// of the body.
+class FindKernelAccesses : public IRVisitor {
+    vector<pair<string, Expr>> lets;
+    Scope<> private_allocations;
+
+    using IRVisitor::visit;
+
+    void record(map<string, vector<Expr>> &accesses, const string &name, Expr index) {
+        if (private_allocations.contains(name)) {
+            return;
+        }
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            index = substitute(it->first, it->second, index);
+        }
+        accesses[name].push_back(simplify(index));
+    }
+
+    void visit(const Load *op) override {
+        record(loads, op->name, op->index);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        record(stores, op->name, op->index);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        lets.emplace_back(op->name, op->value);
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        lets.emplace_back(op->name, op->value);
+        op->body.accept(this);
+        lets.pop_back();
+    }
+
+    void visit(const Allocate *op) override {
+        // Allocations within the loops over threads are private to
+        // each thread, unless they are in shared memory.
+        if (op->memory_type == MemoryType::GPUShared) {
+            unsafe = true;
+        }
+        ScopedBinding<> bind(private_allocations, op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock ||
+            op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            unsafe = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Atomic *op) override {
+        unsafe = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::gpu_thread_barrier) ||
+            op->is_intrinsic(Call::image_load) ||
+            op->is_intrinsic(Call::image_store) ||
+            ((op->call_type == Call::Extern ||
+              op->call_type == Call::ExternCPlusPlus) &&
+             !op->is_pure())) {
+            unsafe = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    map<string, vector<Expr>> loads, stores;
+    // Whether the body contains something we don't know how to reason
+    // about, such as communication between threads.
+    bool unsafe = false;
+};
+
+// Check that the second kernel can run right after the first one in
+// the same thread without a barrier between them: any memory written
+// by one of them and accessed by the other must be accessed at the
+// same index everywhere, and that index must be different on every
+// thread, so each thread only touches what it touched in the first
+// kernel.
+bool accesses_are_pointwise(const FindKernelAccesses &a, const FindKernelAccesses &b,
+                            const vector<string> &loop_vars) {
+    set<string> written;
+    for (const auto &it : a.stores) {
+        written.insert(it.first);
+    }
+    for (const auto &it : b.stores) {
+        written.insert(it.first);
+    }
+
+    for (const string &name : written) {
+        bool in_a = a.loads.count(name) || a.stores.count(name);
+        bool in_b = b.loads.count(name) || b.stores.count(name);
+        if (!in_a || !in_b) {
+            continue;
+        }
+
+        vector<Expr> indices;
+        for (const auto *accesses : {&a.loads, &a.stores, &b.loads, &b.stores}) {
+            auto it = accesses->find(name);
+            if (it != accesses->end()) {
+                indices.insert(indices.end(), it->second.begin(), it->second.end());
+            }
+        }
+        for (const Expr &index : indices) {
+            if (!equal(index, indices[0])) {
+                return false;
+            }
+        }
+        // An index that doesn't depend on every block and thread
+        // index may be shared by several threads.
+        for (const string &v : loop_vars) {
+            if (!expr_uses_var(indices[0], v)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool is_device_dirty_flag(const Stmt &s) {
+    const Evaluate *eval = s.as<Evaluate>();
+    const Call *call = eval ? eval->value.as<Call>() : nullptr;
+    return call && call->name == Call::buffer_set_device_dirty;
+}
+
+class FuseGPUKernels : public IRMutator {
+    vector<pair<string, Expr>> lets;
+
+    using IRMutator::visit;
+
+    // Merge the second kernel into the first, if they can be merged.
+    Stmt fuse(const KernelNest &a, const KernelNest &b) {
+        if (!same_geometry(a, b, lets)) {
+            return Stmt();
+        }
+
+        map<string, Expr> renaming;
+        vector<string> loop_vars;
+        for (size_t i = 0; i < a.loops.size(); i++) {
+            renaming[b.loops[i]->name] = Variable::make(Int(32), a.loops[i]->name);
+            loop_vars.push_back(a.loops[i]->name);
+        }
+        Stmt b_body = substitute(renaming, kernel_body_with_lets(b));
+
+        FindKernelAccesses a_accesses, b_accesses;
+        kernel_body_with_lets(a).accept(&a_accesses);
+        b_body.accept(&b_accesses);
+        if (a_accesses.unsafe || b_accesses.unsafe ||
+            !accesses_are_pointwise(a_accesses, b_accesses, loop_vars)) {
+            return Stmt();
+        }
+
+        debug(3) << "Fusing GPU kernel " << b.loops[0]->name
+                 << " into " << a.loops[0]->name << "\n";
+        return rebuild_kernel(a, Block::make(a.body, b_body));
+    }
+
+    Stmt visit(const Block *op) override {
+        vector<Stmt> stmts;
+        Stmt rest = op;
+        while (const Block *b = rest.as<Block>()) {
+            stmts.push_back(mutate(b->first));
+            rest = b->rest;
+        }
+        stmts.push_back(mutate(rest));
+
+        vector<Stmt> result;
+        for (size_t i = 0; i < stmts.size(); i++) {
+            Stmt s = stmts[i];
+            KernelNest a;
+            if (!peel_kernel(s, a)) {
+                result.push_back(s);
+                continue;
+            }
+
+            // Marking a buffer as dirty on the device between two
+            // kernels can just as well be done after both of them.
+            vector<Stmt> deferred;
+            size_t next = i + 1;
+            while (next < stmts.size()) {
+                size_t j = next;
+                vector<Stmt> flags;
+                while (j < stmts.size() && is_device_dirty_flag(stmts[j])) {
+                    flags.push_back(stmts[j++]);
+                }
+                KernelNest b;
+                if (j == stmts.size() || !peel_kernel(stmts[j], b)) {
+                    break;
+                }
+                Stmt fused = fuse(a, b);
+                if (!fused.defined()) {
+                    break;
+                }
+                s = fused;
+                a = KernelNest();
+                peel_kernel(s, a);
+                deferred.insert(deferred.end(), flags.begin(), flags.end());
+                next = j + 1;
+            }
+            result.push_back(s);
+            result.insert(result.end(), deferred.begin(), deferred.end());
+            i = next - 1;
+        }
+
+        return Block::make(result);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        lets.emplace_back(op->name, op->value);
+        Stmt body = mutate(op->body);
+        lets.pop_back();
+        if (body.same_as(op->body)) {
+            return op;
+        }
+        return LetStmt::make(op->name, op->value, body);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock) {
+            // Kernels don't contain other kernels.
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+};
+
+}  // namespace
+
+Stmt fuse_gpu_kernels(const Stmt &s) {
+    return FuseGPUKernels().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
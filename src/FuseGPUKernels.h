@@ -0,0 +1,29 @@
+#ifndef HALIDE_FUSE_GPU_KERNELS_H
+#define HALIDE_FUSE_GPU_KERNELS_H
+
+/** \file
+ * Defines the lowering pass that merges consecutive GPU kernels with
+ * the same launch geometry into one kernel.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Merge consecutive loop nests over GPU blocks and threads into a
+ * single kernel when they have the same number of blocks and threads
+ * in each dimension, and each thread of the second kernel only touches
+ * the memory the first kernel shares with it at the locations the
+ * same thread accessed in the first one (e.g. the update definitions
+ * of a Func that read and write it pointwise). Such kernels need no
+ * barrier between them once merged, and merging them saves a kernel
+ * launch, and lets the second kernel read what the first one wrote
+ * while it is still in cache. Must be run before
+ * fuse_gpu_thread_loops. */
+Stmt fuse_gpu_kernels(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
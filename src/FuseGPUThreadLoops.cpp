@@ -241,7 +241,7 @@ class ExtractSharedAndHeapAllocations : public IRMutator {
         string name;
         Type type;
         Expr size;
-        IntInterval liveness;    // Start and end of the barrier stage at which this allocation is used.
+        IntInterval liveness;    // First and last barrier stage at which this allocation is used.
         MemoryType memory_type;  // Should be GPUShared or Heap
         bool striped_over_threads;
         bool size_computed_on_host;
@@ -334,8 +334,24 @@ private:
         host_side_preamble = Stmt();
 
         // Find allocations inside the loop body
+        int first_stage = barrier_stage;
         Stmt body = mutate(op->body);
 
+        if (!in_threads && barrier_stage > first_stage) {
+            // A serial loop at the block level runs the stages in it
+            // repeatedly, so the allocations from outside of the loop
+            // that are used inside of it must be kept alive for all of
+            // them.
+            for (auto &it : shared) {
+                SharedAllocation *alloc = it.second;
+                if (alloc->liveness.min <= alloc->liveness.max &&
+                    alloc->liveness.max >= first_stage) {
+                    alloc->liveness.min = std::min(alloc->liveness.min, first_stage);
+                    alloc->liveness.max = barrier_stage;
+                }
+            }
+        }
+
         // Expand any new shared allocations found in the body using the loop bounds.
         Scope<Interval> scope;
         scope.push(op->name, Interval(op->min, simplify(op->min + op->extent - 1)));
@@ -464,7 +480,8 @@ private:
              op->memory_type != MemoryType::GPUShared &&
              op->memory_type != MemoryType::GPUTexture) ||
             op->memory_type == MemoryType::Register ||
-            op->memory_type == MemoryType::Stack) {
+            op->memory_type == MemoryType::Stack ||
+            op->memory_type == MemoryType::MMAFragment) {
             // These allocations go in register or local memory
             return IRMutator::visit(op);
         }
@@ -479,7 +496,8 @@ private:
         SharedAllocation alloc;
         alloc.name = op->name + "." + std::to_string(alloc_node_counter++);
         alloc.type = op->type;
-        alloc.liveness = IntInterval(barrier_stage, barrier_stage);
+        // The liveness starts at the first use; until then it is empty.
+        alloc.liveness = IntInterval(barrier_stage + 1, barrier_stage);
         alloc.size = 1;
         for (const auto &extent : op->extents) {
             alloc.size *= extent;
@@ -507,6 +525,10 @@ private:
         op = stmt.as<Allocate>();
         internal_assert(op);
 
+        if (alloc.liveness.min > alloc.liveness.max) {
+            // Never used.
+            alloc.liveness.min = alloc.liveness.max;
+        }
         allocations.push_back(alloc);
         shared.erase(op->name);
         return op->body;
@@ -521,11 +543,16 @@ private:
         return idx;
     }
 
+    void mark_live(SharedAllocation *alloc) const {
+        alloc->liveness.min = std::min(alloc->liveness.min, barrier_stage);
+        alloc->liveness.max = barrier_stage;
+    }
+
     Expr visit(const Load *op) override {
         auto it = shared.find(op->name);
         if (it != shared.end()) {
             SharedAllocation *alloc = it->second;
-            alloc->liveness.max = barrier_stage;
+            mark_live(alloc);
             Expr predicate = mutate(op->predicate);
             Expr index = mutate_index(alloc, op->index);
             return Load::make(op->type, alloc->name,
@@ -539,7 +566,7 @@ private:
         auto it = shared.find(op->name);
         if (it != shared.end()) {
             SharedAllocation *alloc = it->second;
-            alloc->liveness.max = barrier_stage;
+            mark_live(alloc);
             Expr predicate = mutate(op->predicate);
             Expr index = mutate_index(alloc, op->index);
             Expr value = mutate(op->value);
@@ -690,31 +717,35 @@ private:
 
         vector<AllocGroup> mem_allocs;
         vector<int> free_spaces;  // Contains index to free spaces in mem_allocs
-        int start_idx = 0;
 
         for (int stage = 0; stage <= barrier_stage; ++stage) {
-            for (int i = start_idx; i < (int)allocations.size(); ++i) {
-                if (allocations[i].liveness.min > stage) {
-                    break;
-                } else if (allocations[i].liveness.min == stage) {  // Allocate
-                    int free_idx = find_best_fit(mem_allocs, free_spaces, allocations[i], stage);
-                    if (free_idx != -1) {
-                        mem_allocs[free_spaces[free_idx]].insert(allocations[i]);
-                        free_spaces.erase(free_spaces.begin() + free_idx);
-                    } else {
-                        mem_allocs.emplace_back(allocations[i]);
-                    }
-                } else if (allocations[i].liveness.max == stage - 1) {  // Free
+            // First free the space of everything that died in the
+            // previous stage, so that it can be reused by the
+            // allocations made in this one.
+            for (const SharedAllocation &alloc : allocations) {
+                if (alloc.liveness.max == stage - 1) {
                     int free_idx = -1;
                     for (int j = 0; j < (int)mem_allocs.size(); ++j) {  // Find the index of the space to free
-                        if (mem_allocs[j].group.back().name == allocations[i].name) {
+                        if (mem_allocs[j].group.back().name == alloc.name) {
                             free_idx = j;
                             break;
                         }
                     }
                     internal_assert(free_idx >= 0 && free_idx < (int)mem_allocs.size());
                     free_spaces.push_back(free_idx);
-                    start_idx = i + 1;
+                }
+            }
+            for (const SharedAllocation &alloc : allocations) {
+                if (alloc.liveness.min > stage) {
+                    break;
+                } else if (alloc.liveness.min == stage) {
+                    int free_idx = find_best_fit(mem_allocs, free_spaces, alloc, stage);
+                    if (free_idx != -1) {
+                        mem_allocs[free_spaces[free_idx]].insert(alloc);
+                        free_spaces.erase(free_spaces.begin() + free_idx);
+                    } else {
+                        mem_allocs.emplace_back(alloc);
+                    }
                 }
             }
         }
@@ -753,6 +784,10 @@ private:
     vector<GlobalAllocation> global_allocations;
 
 public:
+    // The size in bytes of the shared memory allocated for each block,
+    // once rewrap_block has packed the allocations.
+    Expr shared_memory_bytes = 0;
+
     Stmt rewrap_block(Stmt s, const ExtractBlockSize &bs) {
 
         // Combine the allocations into groups that have disjoint
@@ -844,6 +879,9 @@ public:
             if (memory_type == MemoryType::Heap) {
                 global_allocations.push_back(GlobalAllocation{name, total_size, alloc_type});
             } else {
+                if (memory_type == MemoryType::GPUShared) {
+                    shared_memory_bytes = simplify(shared_memory_bytes + total_size * alloc_type.bytes());
+                }
                 s = Allocate::make(name, alloc_type, memory_type,
                                    {total_size_var}, const_true(), s);
             }
@@ -1028,7 +1066,8 @@ public:
           thread_id_var_name(unique_name('t')),
           num_threads_var_name(unique_name('t')),
           may_merge_allocs_of_different_type(device_api != DeviceAPI::OpenGLCompute &&
-                                             device_api != DeviceAPI::D3D12Compute) {
+                                             device_api != DeviceAPI::D3D12Compute &&
+                                             device_api != DeviceAPI::Vulkan) {
     }
 };  // namespace Internal
 
@@ -1279,6 +1318,7 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::MMAFragment:
             break;
         }
 
@@ -1304,6 +1344,7 @@ class InjectThreadBarriers : public IRMutator {
         case MemoryType::LockedCache:
         case MemoryType::VTCM:
         case MemoryType::AMXTile:
+        case MemoryType::MMAFragment:
             break;
         }
 
@@ -1472,6 +1513,10 @@ class FuseGPUThreadLoops : public IRMutator {
 
             loop = block_allocations.rewrap_kernel_launch(loop, block_size, op->device_api);
 
+            debug(1) << "GPU kernel " << op->name << " uses "
+                     << block_allocations.shared_memory_bytes
+                     << " bytes of shared memory per block\n";
+
             return loop;
         } else {
             return IRMutator::visit(op);
@@ -1489,7 +1534,8 @@ class ZeroGPULoopMins : public IRMutator {
         in_non_glsl_gpu = (in_non_glsl_gpu && op->device_api == DeviceAPI::None) ||
                           (op->device_api == DeviceAPI::CUDA) || (op->device_api == DeviceAPI::OpenCL) ||
                           (op->device_api == DeviceAPI::Metal) ||
-                          (op->device_api == DeviceAPI::D3D12Compute);
+                          (op->device_api == DeviceAPI::D3D12Compute) ||
+                          (op->device_api == DeviceAPI::Vulkan);
 
         Stmt stmt = IRMutator::visit(op);
         if (CodeGen_GPU_Dev::is_gpu_var(op->name) && !is_const_zero(op->min)) {
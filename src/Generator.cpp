@@ -11,6 +11,7 @@
 #include "Generator.h"
 #include "IRPrinter.h"
 #include "Module.h"
+#include "Profiling.h"
 #include "Simplify.h"
 
 #ifdef HALIDE_ALLOW_GENERATOR_BUILD_METHOD
@@ -640,11 +641,17 @@ int generate_filter_main_inner(int argc,
     static const char kUsage[] = R"INLINE_CODE(
 gengen
   [-g GENERATOR_NAME] [-f FUNCTION_NAME] [-o OUTPUT_DIR] [-r RUNTIME_NAME]
-  [-d 1|0] [-e EMIT_OPTIONS] [-n FILE_BASE_NAME] [-p PLUGIN_NAME]
-  [-s AUTOSCHEDULER_NAME] [-t TIMEOUT]
+  [-d 1|0] [-e EMIT_OPTIONS] [-j NUM_THREADS] [-n FILE_BASE_NAME]
+  [-p PLUGIN_NAME] [-s AUTOSCHEDULER_NAME] [-t TIMEOUT] [-b BRANCH_PROFILE]
+  [-i 1|0]
   target=target-string[,target-string...]
   [generator_param=value [...]]
 
+ -b  A branch profile written by running the pipeline compiled with the
+     profile_instrumented target feature, with HL_PROFILER_BRANCH_FILE set.
+     Branches that it shows are nearly always taken one way, such as the
+     choice between specializations, are laid out for that case.
+
  -d  Build a module that is suitable for using for gradient descent calculation
      in TensorFlow or PyTorch. See Generator::build_gradient_module()
      documentation.
@@ -652,9 +659,18 @@ gengen
  -e  A comma separated list of files to emit. Accepted values are:
      [assembly, bitcode, c_header, c_source, cpp_stub, featurization,
       llvm_assembly, object, python_extension, pytorch_wrapper, registration,
-      schedule, static_library, stmt, stmt_html, compiler_log].
+      schedule, static_library, stmt, stmt_html, thin_lto_bitcode, compiler_log].
      If omitted, default value is [c_header, static_library, registration].
 
+ -i  Build incrementally. Write a fingerprint of the lowered pipeline, the
+     targets, the generator params and the Halide version beside the
+     outputs, and leave the outputs untouched if it matches the one written
+     by the previous run. Defaults to 0.
+
+ -j  The maximum number of targets to lower and compile in parallel when
+     multiple targets are specified. Defaults to 1. Specify 0 to use one
+     thread per core.
+
  -p  A comma-separated list of shared libraries that will be loaded before the
      generator is run. Useful for custom auto-schedulers. The generator must
      either be linked against a shared libHalide or compiled with -rdynamic
@@ -662,8 +678,8 @@ gengen
      (Note that this does not change the default autoscheduler; use the -s flag
      to set that value.)"
 
- -r   The name of a standalone runtime to generate. Only honors EMIT_OPTIONS 'o'
-     and 'static_library'. When multiple targets are specified, it picks a
+ -r   The name of a standalone runtime to generate. Only honors EMIT_OPTIONS 'o',
+     'static_library' and 'thin_lto_bitcode'. When multiple targets are specified, it picks a
      runtime that is compatible with all of the targets, or fails if it cannot
      find one. Flags across all of the targets that do not affect runtime code
      generation, such as `no_asserts` and `no_runtime`, are ignored.
@@ -675,10 +691,13 @@ gengen
 )INLINE_CODE";
 
     std::map<std::string, std::string> flags_info = {
+        {"-b", ""},
         {"-d", "0"},
         {"-e", ""},
         {"-f", ""},
         {"-g", ""},
+        {"-i", "0"},
+        {"-j", "1"},
         {"-n", ""},
         {"-o", ""},
         {"-p", ""},
@@ -716,6 +735,10 @@ gengen
         }
     }
 
+    if (!flags_info["-b"].empty()) {
+        Internal::load_branch_profile(flags_info["-b"]);
+    }
+
     if (args.generator_params.count("auto_schedule")) {
         user_error << "auto_schedule=true is no longer supported for enabling autoscheduling; specify autoscheduler=NAME instead.\n"
                    << kUsage;
@@ -729,6 +752,15 @@ gengen
     user_assert(d_val == "1" || d_val == "0") << "-d must be 0 or 1\n"
                                               << kUsage;
 
+    const auto &i_val = flags_info["-i"];
+    user_assert(i_val == "1" || i_val == "0") << "-i must be 0 or 1\n"
+                                              << kUsage;
+
+    const auto &j_val = flags_info["-j"];
+    user_assert(!j_val.empty() && j_val.find_first_not_of("0123456789") == std::string::npos)
+        << "-j must be a non-negative integer\n"
+        << kUsage;
+
     const std::vector<std::string> generator_names = generator_factory_provider.enumerate();
 
     const auto create_generator = [&](const std::string &generator_name, const Halide::GeneratorContext &context) -> AbstractGeneratorPtr {
@@ -836,6 +868,8 @@ gengen
     args.file_base_name = flags_info["-n"];
     args.runtime_name = flags_info["-r"];
     args.build_mode = (d_val == "1") ? ExecuteGeneratorArgs::Gradient : ExecuteGeneratorArgs::Default;
+    args.max_parallelism = std::stoi(j_val);
+    args.incremental = i_val == "1";
     args.create_generator = create_generator;
     // args.generator_params is already set
 
@@ -1004,6 +1038,90 @@ int generate_filter_main(int argc, char **argv) {
     return generate_filter_main(argc, argv, GeneratorsFromRegistry());
 }
 
+namespace {
+
+std::string halide_version() {
+#ifdef HALIDE_VERSION_MAJOR
+    return std::to_string(HALIDE_VERSION_MAJOR) + "." +
+           std::to_string(HALIDE_VERSION_MINOR) + "." +
+           std::to_string(HALIDE_VERSION_PATCH);
+#else
+    // Builds that don't know their version use the build time of libHalide instead.
+    return std::string("unversioned ") + __DATE__ + " " + __TIME__;
+#endif
+}
+
+// Lower the modules that compile_multitarget() will ask for, and only
+// compile them if their fingerprint differs from the one left beside
+// the outputs by the previous run. The fingerprint is taken from the
+// lowered modules, rather than from the Funcs and their schedules, as
+// they are what the outputs are compiled from.
+void compile_incrementally(const ExecuteGeneratorArgs &args,
+                           const std::string &base_path,
+                           const std::map<OutputFileType, std::string> &output_files,
+                           const ModuleFactory &module_factory) {
+    std::ostringstream fingerprint;
+    fingerprint << "halide generator fingerprint v1\n"
+                << "halide " << halide_version() << "\n"
+                << "llvm " << LLVM_VERSION << "\n"
+                << "generator " << args.generator_name << "\n"
+                << "build mode " << (int)args.build_mode << "\n";
+    for (const auto &kv : args.generator_params) {
+        fingerprint << "param " << kv.first << "=" << kv.second << "\n";
+    }
+    for (const Target &t : args.targets) {
+        fingerprint << "target " << t << "\n";
+    }
+    for (const auto &it : output_files) {
+        fingerprint << "output " << it.second << "\n";
+    }
+
+    // Use the same names and targets as compile_multitarget().
+    std::vector<std::pair<std::string, Target>> sub_modules;
+    if (args.targets.size() == 1) {
+        sub_modules.emplace_back(args.function_name, args.targets[0]);
+    } else {
+        for (size_t i = 0; i < args.targets.size(); i++) {
+            const std::string suffix = args.suffixes.empty() ? args.targets[i].to_string() : args.suffixes[i];
+            sub_modules.emplace_back(args.function_name + "-" + suffix, args.targets[i].with_feature(Target::NoRuntime));
+        }
+    }
+    std::map<std::string, Module> modules;
+    for (const auto &it : sub_modules) {
+        Module m = module_factory(it.first, it.second);
+        fingerprint << "module " << it.first << " " << it.second << " " << module_fingerprint(m) << "\n";
+        modules.emplace(it.first, m);
+    }
+
+    const std::string fingerprint_path = base_path + ".fingerprint";
+    bool up_to_date = file_exists(fingerprint_path);
+    for (const auto &it : output_files) {
+        up_to_date = up_to_date && file_exists(it.second);
+    }
+    if (up_to_date) {
+        std::vector<char> previous = read_entire_file(fingerprint_path);
+        up_to_date = std::string(previous.begin(), previous.end()) == fingerprint.str();
+    }
+    if (up_to_date) {
+        debug(1) << "Generator " << args.generator_name << " outputs are up to date with " << fingerprint_path << "\n";
+        return;
+    }
+
+    // Don't leave the old fingerprint behind if compilation fails.
+    ensure_no_file_exists(fingerprint_path);
+    const auto lowered_module = [&](const std::string &function_name, const Target &target) -> Module {
+        auto it = modules.find(function_name);
+        internal_assert(it != modules.end()) << "No module was lowered for " << function_name << "\n";
+        return it->second;
+    };
+    compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, lowered_module, nullptr, args.max_parallelism);
+
+    const std::string s = fingerprint.str();
+    write_entire_file(fingerprint_path, s.data(), s.size());
+}
+
+}  // namespace
+
 void execute_generator(const ExecuteGeneratorArgs &args_in) {
     const auto fix_defaults = [](const ExecuteGeneratorArgs &args_in) -> ExecuteGeneratorArgs {
         ExecuteGeneratorArgs args = args_in;
@@ -1107,7 +1225,11 @@ void execute_generator(const ExecuteGeneratorArgs &args_in) {
                            gen->build_gradient_module(function_name) :
                            gen->build_module(function_name);
             };
-            compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, module_factory, args.compiler_logger_factory);
+            if (args.incremental && !args_in.compiler_logger_factory) {
+                compile_incrementally(args, base_path, output_files, module_factory);
+            } else {
+                compile_multitarget(args.function_name, output_files, args.targets, args.suffixes, module_factory, args.compiler_logger_factory, args.max_parallelism);
+            }
         }
     }
 }
@@ -1880,8 +2002,22 @@ void GeneratorInputBase::set_inputs(const std::vector<StubInput> &inputs) {
     check_matching_array_size(inputs.size());
     for (size_t i = 0; i < inputs.size(); ++i) {
         const StubInput &in = inputs.at(i);
-        user_assert(in.kind() == kind()) << "An input for " << name() << " is not of the expected kind.\n";
-        if (kind() == ArgInfoKind::Function) {
+        // A Buffer input may also be bound to a Func, as when fusing Generators
+        // with compose_generators().
+        const bool func_for_buffer = kind() == ArgInfoKind::Buffer && in.kind() == ArgInfoKind::Function;
+        user_assert(in.kind() == kind() || func_for_buffer) << "An input for " << name() << " is not of the expected kind.\n";
+        if (func_for_buffer) {
+            auto f = in.func();
+            user_assert(f.defined()) << "The input for " << name() << " is an undefined Func. Please define it.\n";
+            check_matching_types(f.types());
+            check_matching_dims(f.dimensions());
+            funcs_.push_back(f);
+            // There is no buffer behind this input, so give it a Parameter that
+            // nothing else can be mistaken for: any use of its shape in the
+            // Generator will fail to compile rather than silently using another
+            // input's.
+            parameters_.emplace_back(f.types().at(0), true, f.dimensions(), unique_name(array_name(i)));
+        } else if (kind() == ArgInfoKind::Function) {
             auto f = in.func();
             user_assert(f.defined()) << "The input for " << name() << " is an undefined Func. Please define it.\n";
             check_matching_types(f.types());
@@ -2007,6 +2143,318 @@ RegisterGenerator::RegisterGenerator(const char *registered_name, GeneratorFacto
     Internal::GeneratorRegistry::register_factory(registered_name, std::move(generator_factory));
 }
 
+namespace {
+
+// The AbstractGenerator returned by compose_generators().
+class ComposedGenerator : public AbstractGenerator {
+    const std::string name_;
+    const std::vector<std::string> stage_names_;
+    const GeneratorContext context_;
+
+    // GeneratorParams are held until the stages are created.
+    std::vector<std::pair<std::string, std::string>> params_;
+    std::vector<std::pair<std::string, LoopLevel>> loop_level_params_;
+    std::map<std::string, std::string> compute_at_;
+    std::map<std::string, LoopLevel> compute_at_levels_;
+
+    std::vector<AbstractGeneratorPtr> stages_;
+
+    struct Source {
+        size_t stage;
+        std::string output;
+    };
+    // For each stage, the Inputs bound to the Outputs of earlier stages...
+    std::vector<std::map<std::string, Source>> bound_;
+    // ...and the Inputs shared with an earlier stage.
+    std::vector<std::vector<AbstractGenerator::ArgInfo>> shared_;
+    // The stage that owns each Input of the composition.
+    std::map<std::string, size_t> input_stage_;
+    std::vector<AbstractGenerator::ArgInfo> arginfos_;
+    bool planned_ = false;
+
+    size_t stage_index(const std::string &stage_name) const {
+        for (size_t i = 0; i < stage_names_.size(); i++) {
+            if (stage_names_[i] == stage_name) {
+                return i;
+            }
+        }
+        user_error << "Generator composition " << name_ << " has no stage named " << stage_name << "\n";
+        return 0;
+    }
+
+    // Split "stage.rest" into the index of stage and rest.
+    std::pair<size_t, std::string> split_stage_param(const std::string &param) const {
+        const size_t dot = param.find('.');
+        user_assert(dot != std::string::npos && dot > 0 && dot + 1 < param.size())
+            << "GeneratorParams of Generator composition " << name_
+            << " must be of the form stage.param, but saw " << param << "\n";
+        return {stage_index(param.substr(0, dot)), param.substr(dot + 1)};
+    }
+
+    static bool is_autoscheduler_param(const std::string &param) {
+        return param == "autoscheduler" || starts_with(param, "autoscheduler.");
+    }
+
+    const std::vector<AbstractGeneratorPtr> &stages() {
+        if (!stages_.empty()) {
+            return stages_;
+        }
+        for (const auto &n : stage_names_) {
+            AbstractGeneratorPtr g = GeneratorRegistry::create(n, context_);
+            user_assert(g != nullptr)
+                << "Generator composition " << name_ << " uses the Generator " << n
+                << ", which is not registered.\n";
+            stages_.push_back(std::move(g));
+        }
+        for (const auto &kv : params_) {
+            if (is_autoscheduler_param(kv.first)) {
+                for (const auto &g : stages_) {
+                    g->set_generatorparam_value(kv.first, kv.second);
+                }
+            } else {
+                auto sp = split_stage_param(kv.first);
+                stages_[sp.first]->set_generatorparam_value(sp.second, kv.second);
+            }
+        }
+        for (const auto &kv : loop_level_params_) {
+            auto sp = split_stage_param(kv.first);
+            stages_[sp.first]->set_generatorparam_value(sp.second, kv.second);
+        }
+        return stages_;
+    }
+
+    std::string first_output_name(size_t stage) {
+        for (const auto &a : stages()[stage]->arginfos()) {
+            if (a.dir == ArgInfoDirection::Output) {
+                return a.name;
+            }
+        }
+        user_error << "Stage " << stage_names_[stage] << " of Generator composition " << name_
+                   << " has no Outputs.\n";
+        return "";
+    }
+
+    // Work out which stage Inputs are bound to what, and so which are the
+    // Inputs and Outputs of the composition.
+    void plan() {
+        if (planned_) {
+            return;
+        }
+        const auto &gens = stages();
+        bound_.resize(gens.size());
+        shared_.resize(gens.size());
+        std::map<std::string, Source> outputs;
+        std::map<std::string, AbstractGenerator::ArgInfo> inputs;
+        for (size_t i = 0; i < gens.size(); i++) {
+            const auto arg_infos = gens[i]->arginfos();
+            for (const auto &a : arg_infos) {
+                if (a.dir != ArgInfoDirection::Input) {
+                    continue;
+                }
+                auto it = outputs.find(a.name);
+                if (it != outputs.end()) {
+                    user_assert(a.kind != ArgInfoKind::Scalar)
+                        << "The scalar Input " << a.name << " of stage " << stage_names_[i]
+                        << " of Generator composition " << name_
+                        << " cannot be bound to the Output of stage " << stage_names_[it->second.stage] << ".\n";
+                    bound_[i][a.name] = it->second;
+                }
+            }
+            if (i > 0 && bound_[i].empty()) {
+                for (const auto &a : arg_infos) {
+                    if (a.dir == ArgInfoDirection::Input && a.kind != ArgInfoKind::Scalar) {
+                        bound_[i][a.name] = {i - 1, first_output_name(i - 1)};
+                        break;
+                    }
+                }
+            }
+            for (const auto &a : arg_infos) {
+                if (a.dir != ArgInfoDirection::Input || bound_[i].count(a.name)) {
+                    continue;
+                }
+                auto it = inputs.find(a.name);
+                if (it == inputs.end()) {
+                    inputs[a.name] = a;
+                    input_stage_[a.name] = i;
+                    arginfos_.push_back(a);
+                    continue;
+                }
+                const auto &first = it->second;
+                user_assert(a.kind == first.kind && a.kind != ArgInfoKind::Function &&
+                            a.types == first.types && a.dimensions == first.dimensions)
+                    << "The Input " << a.name << " of stage " << stage_names_[i]
+                    << " of Generator composition " << name_
+                    << " cannot be shared with the Input of the same name of stage "
+                    << stage_names_[input_stage_[a.name]] << ".\n";
+                shared_[i].push_back(a);
+            }
+            for (const auto &a : arg_infos) {
+                if (a.dir == ArgInfoDirection::Output) {
+                    outputs[a.name] = {i, a.name};
+                    if (i + 1 == gens.size()) {
+                        arginfos_.push_back(a);
+                    }
+                }
+            }
+        }
+        planned_ = true;
+    }
+
+    LoopLevel parse_compute_at(size_t stage, const std::string &value) {
+        if (value == "root") {
+            return LoopLevel::root();
+        } else if (value == "inlined") {
+            return LoopLevel::inlined();
+        }
+        const size_t dot = value.find('.');
+        user_assert(dot != std::string::npos)
+            << "Unable to parse compute_at." << stage_names_[stage] << ": " << value << "\n";
+        const size_t at = stage_index(value.substr(0, dot));
+        const std::string var = value.substr(dot + 1);
+        Func f = stages()[at]->output_func(first_output_name(at)).at(0);
+        for (const Var &v : f.args()) {
+            if (v.name() == var) {
+                return LoopLevel(f, v);
+            }
+        }
+        user_error << "Unable to parse compute_at." << stage_names_[stage] << ": the first Output of stage "
+                   << stage_names_[at] << " has no Var named " << var << "\n";
+        return LoopLevel::inlined();
+    }
+
+public:
+    ComposedGenerator(const std::string &name,
+                      const std::vector<std::string> &stage_names,
+                      const GeneratorContext &context)
+        : name_(name), stage_names_(stage_names), context_(context) {
+        user_assert(!stage_names.empty()) << "Generator composition " << name << " has no stages.\n";
+    }
+
+    std::string name() override {
+        return name_;
+    }
+
+    GeneratorContext context() const override {
+        return stages_.empty() ? context_ : stages_.back()->context();
+    }
+
+    std::vector<ArgInfo> arginfos() override {
+        plan();
+        return arginfos_;
+    }
+
+    void set_generatorparam_value(const std::string &name, const std::string &value) override {
+        user_assert(stages_.empty()) << "GeneratorParams of Generator composition " << name_
+                                     << " must be set before it is used.\n";
+        if (starts_with(name, "compute_at.")) {
+            compute_at_[name.substr(11)] = value;
+        } else {
+            params_.emplace_back(name, value);
+        }
+    }
+
+    void set_generatorparam_value(const std::string &name, const LoopLevel &loop_level) override {
+        user_assert(stages_.empty()) << "GeneratorParams of Generator composition " << name_
+                                     << " must be set before it is used.\n";
+        if (starts_with(name, "compute_at.")) {
+            compute_at_levels_[name.substr(11)] = loop_level;
+        } else {
+            loop_level_params_.emplace_back(name, loop_level);
+        }
+    }
+
+    Pipeline build_pipeline() override {
+        plan();
+        const auto &gens = stages();
+        for (const auto &kv : compute_at_) {
+            (void)stage_index(kv.first);
+        }
+        for (const auto &kv : compute_at_levels_) {
+            (void)stage_index(kv.first);
+        }
+        Pipeline pipeline;
+        for (size_t i = 0; i < gens.size(); i++) {
+            for (const auto &kv : bound_[i]) {
+                gens[i]->bind_input(kv.first, gens[kv.second.stage]->output_func(kv.second.output));
+            }
+            for (const auto &a : shared_[i]) {
+                const std::vector<Parameter> params = gens[input_stage_[a.name]]->input_parameter(a.name);
+                if (a.kind == ArgInfoKind::Scalar) {
+                    std::vector<Expr> exprs;
+                    for (const auto &p : params) {
+                        exprs.push_back(Variable::make(p.type(), p.name(), p));
+                    }
+                    gens[i]->bind_input(a.name, exprs);
+                } else {
+                    gens[i]->bind_input(a.name, params);
+                }
+            }
+            pipeline = gens[i]->build_pipeline();
+        }
+
+        // An autoscheduler will schedule the Funcs between the stages itself.
+        if (context().autoscheduler_params().name.empty()) {
+            std::map<size_t, std::set<std::string>> consumed;
+            for (const auto &b : bound_) {
+                for (const auto &kv : b) {
+                    consumed[kv.second.stage].insert(kv.second.output);
+                }
+            }
+            for (const auto &kv : consumed) {
+                const std::string &stage_name = stage_names_[kv.first];
+                LoopLevel level = LoopLevel::root();
+                if (compute_at_levels_.count(stage_name)) {
+                    level = compute_at_levels_.at(stage_name);
+                } else if (compute_at_.count(stage_name)) {
+                    level = parse_compute_at(kv.first, compute_at_.at(stage_name));
+                }
+                for (const auto &output : kv.second) {
+                    for (Func f : gens[kv.first]->output_func(output)) {
+                        f.compute_at(level);
+                    }
+                }
+            }
+        }
+        return pipeline;
+    }
+
+    std::vector<Parameter> input_parameter(const std::string &name) override {
+        plan();
+        auto it = input_stage_.find(name);
+        user_assert(it != input_stage_.end())
+            << "Generator composition " << name_ << " has no Input named " << name << "\n";
+        return stages()[it->second]->input_parameter(name);
+    }
+
+    std::vector<Func> output_func(const std::string &name) override {
+        return stages().back()->output_func(name);
+    }
+
+    void bind_input(const std::string &name, const std::vector<Parameter> &v) override {
+        user_error << "The Inputs of Generator composition " << name_ << " cannot be rebound.\n";
+    }
+
+    void bind_input(const std::string &name, const std::vector<Func> &v) override {
+        user_error << "The Inputs of Generator composition " << name_ << " cannot be rebound.\n";
+    }
+
+    void bind_input(const std::string &name, const std::vector<Expr> &v) override {
+        user_error << "The Inputs of Generator composition " << name_ << " cannot be rebound.\n";
+    }
+
+    bool emit_cpp_stub(const std::string &stub_file_path) override {
+        return false;
+    }
+};
+
+}  // namespace
+
+AbstractGeneratorPtr compose_generators(const std::string &name,
+                                        const std::vector<std::string> &stage_names,
+                                        const GeneratorContext &context) {
+    return std::make_unique<ComposedGenerator>(name, stage_names, context);
+}
+
 void generator_test() {
     GeneratorContext context(get_host_target().without_feature(Target::Profile));
 
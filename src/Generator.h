@@ -2283,6 +2283,7 @@ public:
     HALIDE_FORWARD_METHOD(Func, define_extern)
     HALIDE_FORWARD_METHOD_CONST(Func, defined)
     HALIDE_FORWARD_METHOD_CONST(Func, dimensions)
+    HALIDE_FORWARD_METHOD(Func, distribute)
     HALIDE_FORWARD_METHOD(Func, fold_storage)
     HALIDE_FORWARD_METHOD(Func, fuse)
     HALIDE_FORWARD_METHOD(Func, gpu)
@@ -2294,8 +2295,10 @@ public:
     HALIDE_FORWARD_METHOD(Func, hexagon)
     HALIDE_FORWARD_METHOD(Func, in)
     HALIDE_FORWARD_METHOD(Func, memoize)
+    HALIDE_FORWARD_METHOD(Func, multi_gpu)
     HALIDE_FORWARD_METHOD_CONST(Func, num_update_definitions)
     HALIDE_FORWARD_METHOD_CONST(Func, outputs)
+    HALIDE_FORWARD_METHOD(Func, pad_storage)
     HALIDE_FORWARD_METHOD(Func, parallel)
     HALIDE_FORWARD_METHOD(Func, prefetch)
     HALIDE_FORWARD_METHOD(Func, print_loop_nest)
@@ -2315,6 +2318,7 @@ public:
     HALIDE_FORWARD_METHOD_CONST(Func, type)
     HALIDE_FORWARD_METHOD_CONST(Func, types)
     HALIDE_FORWARD_METHOD(Func, unroll)
+    HALIDE_FORWARD_METHOD(Func, unroll_and_jam)
     HALIDE_FORWARD_METHOD(Func, update)
     HALIDE_FORWARD_METHOD_CONST(Func, update_args)
     HALIDE_FORWARD_METHOD_CONST(Func, update_value)
@@ -3868,6 +3872,28 @@ public:
     RegisterGenerator(const char *registered_name, GeneratorFactory generator_factory);
 };
 
+/** Create a Generator, with the given name, that fuses the pipelines of the
+ * registered Generators named by stage_names into a single pipeline. The stages
+ * are built in order, and each Input of a stage is bound to the Func of the
+ * same-named Output of an earlier stage; a stage (other than the first) with no
+ * such Input has its first Buffer or Func Input bound to the first Output of the
+ * stage before it. Every other Input becomes an Input of the composition (Inputs
+ * with the same name in several stages are shared), and the Outputs of the last
+ * stage are its Outputs. Func names must be unique across the stages.
+ *
+ * GeneratorParams are set on a stage as "stage.param", so for instance
+ * "resize.scale=2". The Outputs of earlier stages are ordinary Funcs in the fused
+ * pipeline: by default they are computed at root, but "compute_at.stage" can be
+ * set to "inlined", "root", or "other_stage.var" to compute the Outputs of stage
+ * that later stages use at the Var var of the first Output of other_stage. (These are ignored
+ * when an autoscheduler is in use, which schedules the Funcs itself.)
+ *
+ * Note that the stages are created lazily, as the registry is locked while any
+ * Generator is being created. */
+AbstractGeneratorPtr compose_generators(const std::string &name,
+                                        const std::vector<std::string> &stage_names,
+                                        const GeneratorContext &context);
+
 // -----------------------------
 
 /** ExecuteGeneratorArgs is the set of arguments to execute_generator().
@@ -3901,8 +3927,8 @@ struct ExecuteGeneratorArgs {
     // If empty, use `function_name` (ignoring any C++ namespaces).
     std::string file_base_name;
 
-    // The name of a standalone runtime to generate. Only honors EMIT_OPTIONS 'o'
-    // and 'static_library'. When multiple targets are specified, it picks a
+    // The name of a standalone runtime to generate. Only honors EMIT_OPTIONS 'o',
+    // 'static_library' and 'thin_lto_bitcode'. When multiple targets are specified, it picks a
     // runtime that is compatible with all of the targets, or fails if it cannot
     // find one. Flags across all of the targets that do not affect runtime code
     // generation, such as `no_asserts` and `no_runtime`, are ignored.
@@ -3934,6 +3960,20 @@ struct ExecuteGeneratorArgs {
 
     // Compiler Logger to use, for diagnostic work. If null, don't do any logging.
     CompilerLoggerFactory compiler_logger_factory = nullptr;
+
+    // The maximum number of targets to lower and compile at once when
+    // producing multitarget output. Zero means one per core. Values other
+    // than 1 require that the Generators produced by `create_generator`
+    // can be built concurrently.
+    int max_parallelism = 1;
+
+    // If true, write a fingerprint of the lowered pipeline, the Targets,
+    // the GeneratorParams and the Halide version beside the outputs, and
+    // leave the outputs untouched if it matches the one written by the
+    // previous run. The Generator is still built and lowered each time;
+    // only compiling and writing the outputs is skipped. Ignored when
+    // a compiler_log is requested.
+    bool incremental = false;
 };
 
 /**
@@ -4049,6 +4089,26 @@ struct halide_global_ns;
     static_assert(std::is_same<::halide_register_generator::halide_global_ns, halide_register_generator::halide_global_ns>::value,  \
                   "HALIDE_REGISTER_GENERATOR_ALIAS must be used at global scope");
 
+// HALIDE_REGISTER_GENERATOR_COMPOSITION() registers a Generator that fuses the
+// pipelines of other registered Generators into a single pipeline; see
+// compose_generators() for how the stages are joined together. The stages must be
+// linked into the same GenGen binary, and are named as string literals:
+//
+//    HALIDE_REGISTER_GENERATOR_COMPOSITION(preprocess_all, "decode", "resize", "preprocess")
+#define HALIDE_REGISTER_GENERATOR_COMPOSITION(GEN_REGISTRY_NAME, ...)                                                               \
+    namespace halide_register_generator {                                                                                           \
+    struct halide_global_ns;                                                                                                        \
+    namespace GEN_REGISTRY_NAME##_ns {                                                                                              \
+        std::unique_ptr<Halide::Internal::AbstractGenerator> factory(const Halide::GeneratorContext &context);                      \
+        std::unique_ptr<Halide::Internal::AbstractGenerator> factory(const Halide::GeneratorContext &context) {                     \
+            return Halide::Internal::compose_generators(#GEN_REGISTRY_NAME, {__VA_ARGS__}, context);                                \
+        }                                                                                                                           \
+    }                                                                                                                               \
+    static auto reg_##GEN_REGISTRY_NAME = Halide::Internal::RegisterGenerator(#GEN_REGISTRY_NAME, GEN_REGISTRY_NAME##_ns::factory); \
+    }                                                                                                                               \
+    static_assert(std::is_same<::halide_register_generator::halide_global_ns, halide_register_generator::halide_global_ns>::value,  \
+                  "HALIDE_REGISTER_GENERATOR_COMPOSITION must be used at global scope");
+
 // The HALIDE_GENERATOR_PYSTUB macro is used to produce "PyStubs" -- i.e., CPython wrappers to let a C++ Generator
 // be called from Python. It shouldn't be necessary to use by anything but the build system in most cases.
 
@@ -0,0 +1,375 @@
+#include "HashCons.h"
+
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "IR.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+uint64_t mix(uint64_t h, uint64_t v) {
+    // The 64-bit variant of boost::hash_combine
+    return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 12) + (h >> 4));
+}
+
+uint64_t mix(uint64_t h, const void *p) {
+    return mix(h, (uint64_t)(uintptr_t)p);
+}
+
+uint64_t mix(uint64_t h, const string &s) {
+    return mix(h, (uint64_t)std::hash<string>()(s));
+}
+
+// A hash of the node itself, not looking past its children, which are
+// assumed to already be canonical.
+uint64_t shallow_hash(const Expr &e) {
+    uint64_t h = (uint64_t)e->node_type;
+    h = mix(h, ((uint64_t)e.type().code() << 48) | ((uint64_t)e.type().bits() << 32) | (uint64_t)e.type().lanes());
+
+    switch (e->node_type) {
+    case IRNodeType::IntImm:
+        return mix(h, (uint64_t)e.as<IntImm>()->value);
+    case IRNodeType::UIntImm:
+        return mix(h, e.as<UIntImm>()->value);
+    case IRNodeType::FloatImm: {
+        uint64_t bits;
+        memcpy(&bits, &e.as<FloatImm>()->value, sizeof(bits));
+        return mix(h, bits);
+    }
+    case IRNodeType::StringImm:
+        return mix(h, e.as<StringImm>()->value);
+    case IRNodeType::Broadcast:
+        return mix(h, e.as<Broadcast>()->value.get());
+    case IRNodeType::Cast:
+        return mix(h, e.as<Cast>()->value.get());
+    case IRNodeType::Reinterpret:
+        return mix(h, e.as<Reinterpret>()->value.get());
+    case IRNodeType::Variable:
+        return mix(h, e.as<Variable>()->name);
+#define HASH_BINARY(T)              \
+    case IRNodeType::T: {           \
+        const T *op = e.as<T>();    \
+        h = mix(h, op->a.get());    \
+        return mix(h, op->b.get()); \
+    }
+        HASH_BINARY(Add)
+        HASH_BINARY(Sub)
+        HASH_BINARY(Mod)
+        HASH_BINARY(Mul)
+        HASH_BINARY(Div)
+        HASH_BINARY(Min)
+        HASH_BINARY(Max)
+        HASH_BINARY(EQ)
+        HASH_BINARY(NE)
+        HASH_BINARY(LT)
+        HASH_BINARY(LE)
+        HASH_BINARY(GT)
+        HASH_BINARY(GE)
+        HASH_BINARY(And)
+        HASH_BINARY(Or)
+#undef HASH_BINARY
+    case IRNodeType::Not:
+        return mix(h, e.as<Not>()->a.get());
+    case IRNodeType::Select: {
+        const Select *op = e.as<Select>();
+        h = mix(h, op->condition.get());
+        h = mix(h, op->true_value.get());
+        return mix(h, op->false_value.get());
+    }
+    case IRNodeType::Load: {
+        const Load *op = e.as<Load>();
+        h = mix(h, op->name);
+        h = mix(h, op->index.get());
+        return mix(h, op->predicate.get());
+    }
+    case IRNodeType::Ramp: {
+        const Ramp *op = e.as<Ramp>();
+        h = mix(h, op->base.get());
+        return mix(h, op->stride.get());
+    }
+    case IRNodeType::Call: {
+        const Call *op = e.as<Call>();
+        h = mix(h, op->name);
+        h = mix(h, ((uint64_t)op->call_type << 32) | (uint64_t)op->value_index);
+        for (const Expr &arg : op->args) {
+            h = mix(h, arg.get());
+        }
+        return h;
+    }
+    case IRNodeType::Let: {
+        const Let *op = e.as<Let>();
+        h = mix(h, op->name);
+        h = mix(h, op->value.get());
+        return mix(h, op->body.get());
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *op = e.as<Shuffle>();
+        for (const Expr &v : op->vectors) {
+            h = mix(h, v.get());
+        }
+        for (int i : op->indices) {
+            h = mix(h, (uint64_t)i);
+        }
+        return h;
+    }
+    case IRNodeType::VectorReduce: {
+        const VectorReduce *op = e.as<VectorReduce>();
+        h = mix(h, (uint64_t)op->op);
+        return mix(h, op->value.get());
+    }
+    default:
+        return h;
+    }
+}
+
+bool same_exprs(const vector<Expr> &a, const vector<Expr> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (!a[i].same_as(b[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Whether two nodes are interchangeable, given that their children are
+// canonical. This is stricter than equal(), which ignores the objects
+// that Variables, Loads and Calls refer to.
+bool shallow_equal(const Expr &a, const Expr &b) {
+    if (a->node_type != b->node_type || a.type() != b.type()) {
+        return false;
+    }
+
+    switch (a->node_type) {
+    case IRNodeType::IntImm:
+        return a.as<IntImm>()->value == b.as<IntImm>()->value;
+    case IRNodeType::UIntImm:
+        return a.as<UIntImm>()->value == b.as<UIntImm>()->value;
+    case IRNodeType::FloatImm:
+        // Compare bits, so that -0.0 and 0.0 stay distinct and NaNs match.
+        return memcmp(&a.as<FloatImm>()->value, &b.as<FloatImm>()->value, sizeof(double)) == 0;
+    case IRNodeType::StringImm:
+        return a.as<StringImm>()->value == b.as<StringImm>()->value;
+    case IRNodeType::Broadcast:
+        return a.as<Broadcast>()->value.same_as(b.as<Broadcast>()->value);
+    case IRNodeType::Cast:
+        return a.as<Cast>()->value.same_as(b.as<Cast>()->value);
+    case IRNodeType::Reinterpret:
+        return a.as<Reinterpret>()->value.same_as(b.as<Reinterpret>()->value);
+    case IRNodeType::Variable: {
+        const Variable *va = a.as<Variable>(), *vb = b.as<Variable>();
+        return (va->name == vb->name &&
+                va->param.same_as(vb->param) &&
+                va->image.same_as(vb->image) &&
+                va->reduction_domain.same_as(vb->reduction_domain));
+    }
+#define EQUAL_BINARY(T)                                      \
+    case IRNodeType::T: {                                    \
+        const T *oa = a.as<T>(), *ob = b.as<T>();            \
+        return oa->a.same_as(ob->a) && oa->b.same_as(ob->b); \
+    }
+        EQUAL_BINARY(Add)
+        EQUAL_BINARY(Sub)
+        EQUAL_BINARY(Mod)
+        EQUAL_BINARY(Mul)
+        EQUAL_BINARY(Div)
+        EQUAL_BINARY(Min)
+        EQUAL_BINARY(Max)
+        EQUAL_BINARY(EQ)
+        EQUAL_BINARY(NE)
+        EQUAL_BINARY(LT)
+        EQUAL_BINARY(LE)
+        EQUAL_BINARY(GT)
+        EQUAL_BINARY(GE)
+        EQUAL_BINARY(And)
+        EQUAL_BINARY(Or)
+#undef EQUAL_BINARY
+    case IRNodeType::Not:
+        return a.as<Not>()->a.same_as(b.as<Not>()->a);
+    case IRNodeType::Select: {
+        const Select *sa = a.as<Select>(), *sb = b.as<Select>();
+        return (sa->condition.same_as(sb->condition) &&
+                sa->true_value.same_as(sb->true_value) &&
+                sa->false_value.same_as(sb->false_value));
+    }
+    case IRNodeType::Load: {
+        const Load *la = a.as<Load>(), *lb = b.as<Load>();
+        return (la->name == lb->name &&
+                la->index.same_as(lb->index) &&
+                la->predicate.same_as(lb->predicate) &&
+                la->image.same_as(lb->image) &&
+                la->param.same_as(lb->param) &&
+                la->alignment == lb->alignment);
+    }
+    case IRNodeType::Ramp: {
+        const Ramp *ra = a.as<Ramp>(), *rb = b.as<Ramp>();
+        return ra->base.same_as(rb->base) && ra->stride.same_as(rb->stride);
+    }
+    case IRNodeType::Call: {
+        const Call *ca = a.as<Call>(), *cb = b.as<Call>();
+        return (ca->name == cb->name &&
+                ca->call_type == cb->call_type &&
+                ca->value_index == cb->value_index &&
+                ca->func.same_as(cb->func) &&
+                ca->image.same_as(cb->image) &&
+                ca->param.same_as(cb->param) &&
+                same_exprs(ca->args, cb->args));
+    }
+    case IRNodeType::Let: {
+        const Let *la = a.as<Let>(), *lb = b.as<Let>();
+        return la->name == lb->name && la->value.same_as(lb->value) && la->body.same_as(lb->body);
+    }
+    case IRNodeType::Shuffle: {
+        const Shuffle *sa = a.as<Shuffle>(), *sb = b.as<Shuffle>();
+        return sa->indices == sb->indices && same_exprs(sa->vectors, sb->vectors);
+    }
+    case IRNodeType::VectorReduce: {
+        const VectorReduce *va = a.as<VectorReduce>(), *vb = b.as<VectorReduce>();
+        return va->op == vb->op && va->value.same_as(vb->value);
+    }
+    default:
+        // Some node type this pass doesn't know about. Never merge it.
+        return false;
+    }
+}
+
+}  // namespace
+
+struct HashConsArena::Contents {
+    // Canonical nodes, bucketed by their shallow hash.
+    std::unordered_map<uint64_t, vector<Expr>> table;
+
+    // The canonical nodes themselves, so that an Expr that is already
+    // canonical can be recognized without walking it. The table keeps
+    // them alive, so their addresses can't be reused.
+    std::unordered_set<const IRNode *> canonical;
+
+    Expr intern(const Expr &e) {
+        vector<Expr> &bucket = table[shallow_hash(e)];
+        for (const Expr &c : bucket) {
+            if (shallow_equal(c, e)) {
+                return c;
+            }
+        }
+        bucket.push_back(e);
+        canonical.insert(e.get());
+        return e;
+    }
+};
+
+namespace {
+
+class HashConsExprs : public IRMutator {
+    HashConsArena::Contents &arena;
+
+    // The canonical version of each non-canonical node seen so far, so
+    // that shared subexpressions in the input are only visited once.
+    std::map<Expr, Expr, ExprCompare> done;
+
+public:
+    using IRMutator::mutate;
+
+    Expr mutate(const Expr &e) override {
+        if (!e.defined() || arena.canonical.count(e.get())) {
+            return e;
+        }
+        auto it = done.find(e);
+        if (it != done.end()) {
+            return it->second;
+        }
+        // Canonicalize the children first, so that the node can be
+        // compared with the ones in the table by its fields alone.
+        Expr canonical = arena.intern(IRMutator::mutate(e));
+        done.emplace(e, canonical);
+        return canonical;
+    }
+
+    HashConsExprs(HashConsArena::Contents &arena)
+        : arena(arena) {
+    }
+};
+
+}  // namespace
+
+HashConsArena::HashConsArena()
+    : contents(std::make_unique<Contents>()) {
+}
+
+HashConsArena::~HashConsArena() = default;
+
+Expr HashConsArena::hash_cons(const Expr &e) {
+    return HashConsExprs(*contents).mutate(e);
+}
+
+Stmt HashConsArena::hash_cons(const Stmt &s) {
+    return HashConsExprs(*contents).mutate(s);
+}
+
+size_t HashConsArena::size() const {
+    return contents->canonical.size();
+}
+
+Expr hash_cons(const Expr &e) {
+    return HashConsArena().hash_cons(e);
+}
+
+Stmt hash_cons(const Stmt &s) {
+    return HashConsArena().hash_cons(s);
+}
+
+void hash_cons_test() {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+
+    // Identical Exprs built separately end up as the same node.
+    Expr a = (x + 1) * (y - 3);
+    Expr b = (Variable::make(Int(32), "x") + 1) * (Variable::make(Int(32), "y") - 3);
+    internal_assert(!a.same_as(b) && equal(a, b));
+    Expr c = hash_cons(a + b);
+    const Add *add = c.as<Add>();
+    internal_assert(add && add->a.same_as(add->b))
+        << "Identical subexpressions were not merged: " << c << "\n";
+
+    // Exprs that only differ in type, value, or the objects they refer
+    // to stay distinct.
+    Parameter p(Int(32), false, 0, "x");
+    Expr x_param = Variable::make(Int(32), "x", p);
+    Expr d = hash_cons(Add::make(x, x_param));
+    add = d.as<Add>();
+    internal_assert(add && !add->a.same_as(add->b) && equal(add->a, add->b));
+    Expr e = hash_cons(Add::make(cast<int32_t>(Variable::make(Int(16), "x")),
+                                 cast<int32_t>(Variable::make(UInt(16), "x"))));
+    add = e.as<Add>();
+    internal_assert(add && !add->a.as<Cast>()->value.same_as(add->b.as<Cast>()->value));
+    Expr f = hash_cons(Add::make(make_const(Float(64), 0.0), make_const(Float(64), -0.0)));
+    add = f.as<Add>();
+    internal_assert(add && !add->a.same_as(add->b));
+
+    // An arena shares nodes across calls, and recognizes canonical
+    // nodes without rebuilding them.
+    HashConsArena arena;
+    Stmt s1 = arena.hash_cons(Evaluate::make(a));
+    Stmt s2 = arena.hash_cons(Evaluate::make(b));
+    internal_assert(s1.as<Evaluate>()->value.same_as(s2.as<Evaluate>()->value));
+    size_t size = arena.size();
+    Stmt s3 = arena.hash_cons(s1);
+    internal_assert(s3.same_as(s1) && arena.size() == size);
+
+    std::cout << "hash_cons test passed" << std::endl;
+}
+
+}  // namespace Internal
+}  // namespace Halide
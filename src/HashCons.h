@@ -0,0 +1,62 @@
+#ifndef HALIDE_INTERNAL_HASH_CONS_H
+#define HALIDE_INTERNAL_HASH_CONS_H
+
+/** \file
+ * Defines a pass that makes structurally identical Exprs share IR nodes.
+ */
+
+#include <memory>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** A table of canonical Expr nodes. Hash-consing an Expr or Stmt
+ * through an arena replaces each Expr in it with the canonical node
+ * structurally identical to it, adding new nodes to the table as
+ * needed. Exprs are then shared not only within one piece of IR but
+ * with everything else hash-consed through the same arena, so
+ * comparisons between them with equal() or graph_equal(), and the
+ * hashing done by CSE, stop at pointer equality.
+ *
+ * Two Exprs are only merged if they would also be considered the
+ * same by every other pass: besides everything equal() compares, the
+ * Parameters, Buffers, Functions and reduction domains they refer to
+ * must be the same objects.
+ *
+ * The arena keeps its canonical nodes alive, so it should not outlive
+ * the compilation it is used for. */
+class HashConsArena {
+public:
+    HashConsArena();
+    ~HashConsArena();
+
+    HashConsArena(const HashConsArena &) = delete;
+    HashConsArena &operator=(const HashConsArena &) = delete;
+
+    Expr hash_cons(const Expr &e);
+    Stmt hash_cons(const Stmt &s);
+
+    /** The number of distinct canonical nodes in the table. */
+    size_t size() const;
+
+    struct Contents;
+
+private:
+    std::unique_ptr<Contents> contents;
+};
+
+/** Hash-cons the argument through a temporary arena, so that all of
+ * its structurally identical Exprs share nodes. */
+// @{
+Expr hash_cons(const Expr &e);
+Stmt hash_cons(const Stmt &s);
+// @}
+
+void hash_cons_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
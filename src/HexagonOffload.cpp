@@ -43,6 +43,7 @@ enum {
     EF_HEXAGON_MACH_V62 = 0x62,
     EF_HEXAGON_MACH_V65 = 0x65,
     EF_HEXAGON_MACH_V66 = 0x66,
+    EF_HEXAGON_MACH_V68 = 0x68,
 };
 
 enum {
@@ -551,7 +552,9 @@ public:
     uint32_t flags;
 
     HexagonLinker(const Target &target) {
-        if (target.has_feature(Target::HVX_v66)) {
+        if (target.has_feature(Target::HVX_v68)) {
+            flags = Elf::EF_HEXAGON_MACH_V68;
+        } else if (target.has_feature(Target::HVX_v66)) {
             flags = Elf::EF_HEXAGON_MACH_V66;
         } else if (target.has_feature(Target::HVX_v65)) {
             flags = Elf::EF_HEXAGON_MACH_V65;
@@ -690,6 +693,49 @@ Stmt replace_params(const Stmt &s, const std::map<std::string, Parameter> &repla
     return ReplaceParams(replacements).mutate(s);
 }
 
+// Move the Hexagon loops in a statement to the Hexagon side of an
+// offload: after moving them, they don't need to be marked Hexagon
+// anymore.
+class StripHexagonLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *loop) override {
+        if (loop->device_api != DeviceAPI::Hexagon) {
+            return IRMutator::visit(loop);
+        }
+        if (first_loop_name.empty()) {
+            first_loop_name = loop->name;
+        }
+        if (is_const_one(loop->extent)) {
+            return LetStmt::make(loop->name, loop->min, loop->body);
+        } else {
+            return For::make(loop->name, loop->min, loop->extent, loop->for_type,
+                             DeviceAPI::None, loop->body);
+        }
+    }
+
+public:
+    std::string first_loop_name;
+};
+
+// Count the Hexagon loops in a statement, or return -1 if it does any
+// work on the host outside of them. Statements where all of the work
+// is done by Hexagon loops can be offloaded in one RPC, instead of one
+// per loop.
+int count_hexagon_loops(const Stmt &s) {
+    if (const For *loop = s.as<For>()) {
+        return loop->device_api == DeviceAPI::Hexagon ? 1 : -1;
+    } else if (const Block *block = s.as<Block>()) {
+        int first = count_hexagon_loops(block->first);
+        int rest = count_hexagon_loops(block->rest);
+        return (first < 0 || rest < 0) ? -1 : first + rest;
+    } else if (const ProducerConsumer *pc = s.as<ProducerConsumer>()) {
+        return count_hexagon_loops(pc->body);
+    } else {
+        return -1;
+    }
+}
+
 class InjectHexagonRpc : public IRMutator {
     std::map<std::string, Expr> state_bufs;
 
@@ -728,6 +774,58 @@ class InjectHexagonRpc : public IRMutator {
         if (loop->device_api != DeviceAPI::Hexagon) {
             return IRMutator::visit(loop);
         }
+        return offload(loop);
+    }
+
+    // Each RPC costs on the order of 100us, so runs of consecutive
+    // Hexagon loops (e.g. several stages scheduled on Hexagon, or the
+    // loops that unrolling or loop partitioning generate) with no host
+    // work between them are offloaded together.
+    Stmt visit(const ProducerConsumer *op) override {
+        if (count_hexagon_loops(op) > 1) {
+            return offload(op);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Block *op) override {
+        std::vector<Stmt> stmts;
+        Stmt s = op;
+        while (const Block *b = s.as<Block>()) {
+            stmts.push_back(b->first);
+            s = b->rest;
+        }
+        stmts.push_back(s);
+
+        std::vector<Stmt> result;
+        for (size_t i = 0; i < stmts.size();) {
+            size_t j = i;
+            int loops = 0;
+            while (j < stmts.size()) {
+                int count = count_hexagon_loops(stmts[j]);
+                if (count < 0) {
+                    break;
+                }
+                loops += count;
+                j++;
+            }
+            if (loops > 1) {
+                std::vector<Stmt> group(stmts.begin() + i, stmts.begin() + j);
+                result.push_back(offload(Block::make(group)));
+                i = j;
+            } else {
+                result.push_back(mutate(stmts[i]));
+                i++;
+            }
+        }
+        return Block::make(result);
+    }
+
+    // Move a statement in which all of the work is done by Hexagon
+    // loops to Hexagon, and replace it with an RPC.
+    Stmt offload(const Stmt &s) {
+        StripHexagonLoops strip;
+        Stmt body = strip.mutate(s);
 
         // Unrolling or loop partitioning might generate multiple
         // loops with the same name, so we need to make them unique.
@@ -735,17 +833,7 @@ class InjectHexagonRpc : public IRMutator {
         // significant, it tells the Hexagon code generator to expect
         // the arguments to be unpacked by the Hexagon remote-side RPC
         // call, which doesn't work with standard buffers.
-        std::string hex_name = unique_name("offload_rpc." + loop->name);
-
-        // After moving this to Hexagon, it doesn't need to be marked
-        // Hexagon anymore.
-        Stmt body;
-        if (is_const_one(loop->extent)) {
-            body = LetStmt::make(loop->name, loop->min, loop->body);
-        } else {
-            body = For::make(loop->name, loop->min, loop->extent, loop->for_type,
-                             DeviceAPI::None, loop->body);
-        }
+        std::string hex_name = unique_name("offload_rpc." + strip.first_loop_name);
 
         // Build a closure for the device code.
         // Note that we must do this *before* calling lower_parallel_tasks();
@@ -983,6 +1071,8 @@ Stmt inject_hexagon_rpc(Stmt s, const Target &host_target,
         Target::HVX_v62,
         Target::HVX_v65,
         Target::HVX_v66,
+        Target::HVX_v68,
+        Target::HexagonAutoVTCM,
     };
     for (Target::Feature i : shared_features) {
         if (host_target.has_feature(i)) {
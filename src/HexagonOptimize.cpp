@@ -14,6 +14,7 @@
 #include "Scope.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "Util.h"
 #include <unordered_map>
 #include <utility>
 
@@ -81,7 +82,14 @@ bool is_native_deinterleave(const Expr &x) {
 
 string type_suffix(Type type, bool signed_variants) {
     string prefix = type.is_vector() ? ".v" : ".";
-    if (type.is_int() || !signed_variants) {
+    if (type.is_float() && !type.is_bfloat()) {
+        switch (type.bits()) {
+        case 16:
+            return prefix + "hf";
+        case 32:
+            return prefix + "sf";
+        }
+    } else if (type.is_int() || !signed_variants) {
         switch (type.bits()) {
         case 8:
             return prefix + "b";
@@ -218,11 +226,11 @@ Expr wild_i64x = Variable::make(Type(Type::Int, 64, 0), "*");
 // Check if a pattern with flags 'flags' is supported on the target.
 bool check_pattern_target(int flags, const Target &target) {
     if ((flags & (Pattern::v65orLater)) &&
-        !target.features_any_of({Target::HVX_v65, Target::HVX_v66})) {
+        !target.features_any_of({Target::HVX_v65, Target::HVX_v66, Target::HVX_v68})) {
         return false;
     }
     if ((flags & (Pattern::v66orLater)) &&
-        !target.features_any_of({Target::HVX_v66})) {
+        !target.features_any_of({Target::HVX_v66, Target::HVX_v68})) {
         return false;
     }
     return true;
@@ -2440,8 +2448,58 @@ public:
     }
 };
 
+// Move allocations that would otherwise go on the heap (i.e. in DDR) into
+// VTCM, as long as everything placed in VTCM that is live at the same time
+// fits in the budget. Allocations that are not nested share the budget, as
+// each is returned to the VTCM pool at the end of its scope.
+class StageInVTCM : public IRMutator {
+    using IRMutator::visit;
+
+    const int64_t budget;
+    int64_t live_bytes = 0;
+    // Each of the HVX contexts running a parallel loop gets its own copy
+    // of the allocations inside it.
+    int copies = 1;
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::Parallel || copies > 1) {
+            return IRMutator::visit(op);
+        }
+        ScopedValue<int> old_copies(copies, max_hvx_contexts);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type != MemoryType::Auto || op->new_expr.defined()) {
+            return IRMutator::visit(op);
+        }
+        int64_t bytes = (int64_t)Allocate::constant_allocation_size(op->extents, op->name) * op->type.bytes();
+        if (bytes <= 0 || can_allocation_fit_on_stack(bytes) ||
+            live_bytes + bytes * copies > budget) {
+            return IRMutator::visit(op);
+        }
+        debug(2) << "Placing " << op->name << " (" << bytes << " bytes) in VTCM\n";
+        live_bytes += bytes * copies;
+        Stmt body = mutate(op->body);
+        live_bytes -= bytes * copies;
+        return Allocate::make(op->name, op->type, MemoryType::VTCM, op->extents,
+                              op->condition, body, op->new_expr, op->free_function);
+    }
+
+public:
+    static constexpr int max_hvx_contexts = 4;
+
+    StageInVTCM(int64_t budget)
+        : budget(budget) {
+    }
+};
+
 }  // namespace
 
+Stmt stage_allocations_in_vtcm(const Stmt &s, int64_t budget) {
+    return StageInVTCM(budget).mutate(s);
+}
+
 Stmt optimize_hexagon_shuffles(const Stmt &s, int lut_alignment) {
     // Replace indirect and other complicated loads with
     // dynamic_shuffle (vlut) calls.
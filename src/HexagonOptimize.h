@@ -24,6 +24,11 @@ Stmt optimize_hexagon_shuffles(const Stmt &s, int lut_alignment);
  *     2. out(idx(x)) = foo(x) -> vscatter */
 Stmt scatter_gather_generator(Stmt s);
 
+/** Place constant-sized allocations that are too large for the stack in
+ * VTCM instead of the heap, while the allocations placed there that are
+ * live at once fit in the given number of bytes. */
+Stmt stage_allocations_in_vtcm(const Stmt &s, int64_t budget);
+
 /** Hexagon deinterleaves when performing widening operations, and
  * interleaves when performing narrowing operations. This pass
  * rewrites widenings/narrowings to be explicit in the IR, and
@@ -0,0 +1,149 @@
+#include "HorizontalFusion.h"
+
+#include <set>
+
+#include "Debug.h"
+#include "FindCalls.h"
+#include "Func.h"
+#include "Function.h"
+#include "IRVisitor.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Find the Funcs and images read by a definition, looking through
+// the Funcs it inlines.
+class FindInputs : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Image) {
+            inputs.insert(op->name);
+        } else if (op->call_type == Call::Halide && op->func.defined()) {
+            inputs.insert(op->name);
+            Function f(op->func);
+            if (f.can_be_inlined() &&
+                f.schedule().compute_level().is_inlined() &&
+                visited.insert(f.name()).second) {
+                f.accept(this);
+            }
+        }
+    }
+
+    set<string> visited;
+
+public:
+    set<string> inputs;
+};
+
+bool uses_compute_with(const Function &f) {
+    if (!f.definition().schedule().fuse_level().level.is_inlined()) {
+        return true;
+    }
+    for (const Definition &def : f.updates()) {
+        if (!def.schedule().fuse_level().level.is_inlined()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool can_be_fused(const Function &f) {
+    return !f.has_extern_definition() &&
+           f.has_pure_definition() &&
+           f.updates().empty() &&
+           f.definition().specializations().empty();
+}
+
+bool dims_match(const Dim &a, const Dim &b) {
+    return (a.var == b.var &&
+            a.for_type == b.for_type &&
+            a.device_api == b.device_api &&
+            a.dim_type == b.dim_type);
+}
+
+// The number of loops, counted from the outermost, over which the pure
+// definitions of two Funcs match. Excludes the __outermost loop.
+size_t matching_loops(const Function &a, const Function &b) {
+    const vector<Dim> &da = a.definition().schedule().dims();
+    const vector<Dim> &db = b.definition().schedule().dims();
+    size_t n = 0;
+    while (n + 1 < da.size() && n + 1 < db.size() &&
+           dims_match(da[da.size() - 2 - n], db[db.size() - 2 - n])) {
+        n++;
+    }
+    return n;
+}
+
+}  // namespace
+
+void fuse_sibling_outputs(const vector<Function> &outputs,
+                          const map<string, Function> &env) {
+    if (outputs.size() < 2) {
+        return;
+    }
+    for (const auto &it : env) {
+        if (uses_compute_with(it.second)) {
+            return;
+        }
+    }
+
+    vector<set<string>> inputs, callees;
+    for (const Function &f : outputs) {
+        FindInputs finder;
+        f.accept(&finder);
+        inputs.push_back(finder.inputs);
+        set<string> c;
+        for (const auto &call : find_transitive_calls(f)) {
+            c.insert(call.first);
+        }
+        callees.push_back(c);
+    }
+
+    // The outputs that others are fused with.
+    vector<size_t> parents;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const Function &f = outputs[i];
+        if (!can_be_fused(f)) {
+            continue;
+        }
+        bool done = false;
+        for (size_t p : parents) {
+            const Function &parent = outputs[p];
+            if (callees[i].count(parent.name()) || callees[p].count(f.name())) {
+                // Fusing a producer and a consumer would need more than
+                // matching loops to be legal.
+                continue;
+            }
+            bool shares_input = false;
+            for (const string &in : inputs[i]) {
+                shares_input = shares_input || inputs[p].count(in);
+            }
+            size_t n = matching_loops(f, parent);
+            if (!shares_input || n == 0) {
+                continue;
+            }
+            const vector<Dim> &dims = parent.definition().schedule().dims();
+            const string &var = dims[dims.size() - 1 - n].var;
+            debug(1) << "Fusing output " << f.name() << " with " << parent.name()
+                     << " at loop " << var << "\n";
+            Func(f).compute_with(LoopLevel(parent, Var(var), 0));
+            done = true;
+            break;
+        }
+        if (!done) {
+            parents.push_back(i);
+        }
+    }
+}
+
+}  // namespace Internal
+}  // namespace Halide
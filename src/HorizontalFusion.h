@@ -0,0 +1,32 @@
+#ifndef HALIDE_HORIZONTAL_FUSION_H
+#define HALIDE_HORIZONTAL_FUSION_H
+
+/** \file
+ * Defines the pass that fuses the loop nests of sibling pipeline
+ * outputs, so that they read their shared inputs once.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Find pairs of pipeline outputs that read a common Func or image,
+ * have no update definitions, specializations or extern definitions,
+ * don't depend on each other, and have loop nests that match from
+ * some loop outwards. Schedule each such output to be computed with
+ * the first output it matches, as if by compute_with at the innermost
+ * matching loop. Pipelines that already use compute_with anywhere
+ * are left alone. Called when the target has the fuse_outputs
+ * feature, after the outputs have been scheduled at root. */
+void fuse_sibling_outputs(const std::vector<Function> &outputs,
+                          const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -667,6 +667,7 @@ const char *const intrinsic_op_names[] = {
     "sorted_avg",
     "strict_float",
     "stringify",
+    "tuned_prefetch_distance",
     "undef",
     "unreachable",
     "unsafe_promise_clamped",
@@ -700,8 +701,9 @@ Expr Call::make(Type type, const std::string &name, const std::vector<Expr> &arg
                 FunctionPtr func, int value_index,
                 Buffer<> image, Parameter param) {
     if (name == intrinsic_op_names[Call::prefetch] && call_type == Call::Intrinsic) {
-        internal_assert(args.size() % 2 == 0)
-            << "Number of args to a prefetch call should be even: {base, offset, extent0, stride0, extent1, stride1, ...}\n";
+        internal_assert(args.size() % 2 == 0 || (args.size() > 2 && is_const_one(args.back())))
+            << "Args to a prefetch call should be {base, offset, extent0, stride0, extent1, stride1, ...}, "
+            << "optionally followed by a 1 to mark a prefetch for writing\n";
     }
     for (size_t i = 0; i < args.size(); i++) {
         internal_assert(args[i].defined()) << "Call of " << name << " with argument " << i << " undefined.\n";
@@ -584,6 +584,7 @@ struct Call : public ExprNode<Call> {
         sorted_avg,
         strict_float,
         stringify,
+        tuned_prefetch_distance,
         undef,
         unreachable,
         unsafe_promise_clamped,
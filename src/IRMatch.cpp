@@ -1,5 +1,8 @@
+#include <algorithm>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <utility>
 
 #include "IREquality.h"
@@ -408,6 +411,41 @@ Expr with_lanes(const Expr &x, int lanes) {
 
 namespace IRMatcher {
 
+#if HALIDE_PROFILE_RULES
+namespace {
+
+class RuleProfiles {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<RuleProfile>> profiles;
+
+public:
+    RuleProfile *add(const std::string &rule) {
+        std::lock_guard<std::mutex> lock(mutex);
+        profiles.emplace_back(new RuleProfile);
+        profiles.back()->rule = rule;
+        return profiles.back().get();
+    }
+
+    ~RuleProfiles() {
+        std::sort(profiles.begin(), profiles.end(),
+                  [](const std::unique_ptr<RuleProfile> &a, const std::unique_ptr<RuleProfile> &b) {
+                      return a->attempts.load() > b->attempts.load();
+                  });
+        std::cerr << "Rewrite rule profile (attempts, matches, rule):\n";
+        for (const auto &p : profiles) {
+            std::cerr << p->attempts << " " << p->matches << " " << p->rule << "\n";
+        }
+    }
+};
+
+}  // namespace
+
+RuleProfile *register_rule_profile(const std::string &rule) {
+    static RuleProfiles profiles;
+    return profiles.add(rule);
+}
+#endif
+
 HALIDE_ALWAYS_INLINE
 bool equal_helper(const Expr &a, const Expr &b) {
     return equal(*a.get(), *b.get());
@@ -5,8 +5,10 @@
  * Defines a method to match a fragment of IR against a pattern containing wildcards
  */
 
+#include <atomic>
 #include <map>
 #include <random>
+#include <sstream>
 #include <set>
 #include <vector>
 
@@ -2750,6 +2752,238 @@ HALIDE_ALWAYS_INLINE bool evaluate_predicate(Pattern p, MatcherState &state) {
 // correctness_simplify with this on.
 #define HALIDE_FUZZ_TEST_RULES 0
 
+// Set to true to count how many times each rewrite rule is tried and
+// how many times it matches, and print the counts for every rule tried
+// when the process exits, most-tried first. Rules that only differ in
+// their constants are counted together.
+#define HALIDE_PROFILE_RULES 0
+
+#if HALIDE_PROFILE_RULES
+struct RuleProfile {
+    std::string rule;
+    std::atomic<uint64_t> attempts{0}, matches{0};
+};
+
+/** Get a counter that will be included in the report at exit. */
+RuleProfile *register_rule_profile(const std::string &rule);
+
+template<typename Before, typename After>
+HALIDE_NEVER_INLINE std::string describe_rule(const Before &before, const After &after) {
+    std::ostringstream s;
+    s << before << " -> " << after;
+    return s.str();
+}
+
+template<typename Before, typename After, typename Predicate>
+HALIDE_NEVER_INLINE std::string describe_rule(const Before &before, const After &after, const Predicate &pred) {
+    std::ostringstream s;
+    s << before << " -> " << after << " if " << pred;
+    return s.str();
+}
+#endif
+
+// Rule prefiltering. A Rewriter is typically tried against dozens of
+// rules for the same kind of node in turn, most of which fail on the
+// node type of one of the instance's children. Each pattern has a
+// compile-time mask of the node types its root could match, so the
+// Rewriter can record the node types of its instance's children once,
+// and then reject most rules with a few bit tests, without walking
+// the instance. This never rejects a rule that could match, so it
+// doesn't change which rule applies.
+
+HALIDE_ALWAYS_INLINE constexpr uint32_t node_type_bit(IRNodeType t) {
+    return 1u << (int)t;
+}
+
+constexpr uint32_t any_node_type = ~0u;
+
+constexpr uint32_t const_node_types =
+    node_type_bit(IRNodeType::IntImm) |
+    node_type_bit(IRNodeType::UIntImm) |
+    node_type_bit(IRNodeType::FloatImm) |
+    node_type_bit(IRNodeType::Broadcast);
+
+// The node types a pattern could match. Patterns not listed here
+// (e.g. wildcards) could match anything.
+template<typename T>
+struct node_types {
+    constexpr static uint32_t mask = any_node_type;
+};
+
+template<typename Op, typename A, typename B>
+struct node_types<BinOp<Op, A, B>> {
+    constexpr static uint32_t mask = node_type_bit(Op::_node_type);
+};
+
+template<typename Op, typename A, typename B>
+struct node_types<CmpOp<Op, A, B>> {
+    constexpr static uint32_t mask = node_type_bit(Op::_node_type);
+};
+
+template<typename A>
+struct node_types<NotOp<A>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Not);
+};
+
+template<typename C, typename T, typename F>
+struct node_types<SelectOp<C, T, F>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Select);
+};
+
+template<typename A, typename B>
+struct node_types<BroadcastOp<A, B>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Broadcast);
+};
+
+template<typename A, typename B, typename C>
+struct node_types<RampOp<A, B, C>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Ramp);
+};
+
+template<typename A, typename B, VectorReduce::Operator reduce_op>
+struct node_types<VectorReduceOp<A, B, reduce_op>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::VectorReduce);
+};
+
+template<typename A>
+struct node_types<NegateOp<A>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Sub);
+};
+
+template<typename A>
+struct node_types<CastOp<A>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Cast);
+};
+
+template<typename... Args>
+struct node_types<Intrin<Args...>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::Call);
+};
+
+template<int i>
+struct node_types<WildConstInt<i>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::IntImm) | node_type_bit(IRNodeType::Broadcast);
+};
+
+template<int i>
+struct node_types<WildConstUInt<i>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::UIntImm) | node_type_bit(IRNodeType::Broadcast);
+};
+
+template<int i>
+struct node_types<WildConstFloat<i>> {
+    constexpr static uint32_t mask = node_type_bit(IRNodeType::FloatImm) | node_type_bit(IRNodeType::Broadcast);
+};
+
+template<int i>
+struct node_types<WildConst<i>> {
+    constexpr static uint32_t mask = const_node_types;
+};
+
+template<>
+struct node_types<IntLiteral> {
+    constexpr static uint32_t mask = const_node_types;
+};
+
+// The node types of an instance's leaves. Only concrete expressions
+// have a known node type.
+template<typename T>
+HALIDE_ALWAYS_INLINE uint32_t instance_node_types(const T &) {
+    return any_node_type;
+}
+
+HALIDE_ALWAYS_INLINE uint32_t instance_node_types(const SpecificExpr &e) {
+    return node_type_bit(e.expr.node_type);
+}
+
+// Record the node types of the children of an instance (or of the
+// instance itself if it is a concrete expression).
+template<typename T>
+HALIDE_ALWAYS_INLINE void get_child_node_types(const T &, uint32_t *types) {
+    types[0] = types[1] = types[2] = any_node_type;
+}
+
+HALIDE_ALWAYS_INLINE void get_child_node_types(const SpecificExpr &e, uint32_t *types) {
+    types[0] = instance_node_types(e);
+    types[1] = types[2] = any_node_type;
+}
+
+template<typename Op, typename A, typename B>
+HALIDE_ALWAYS_INLINE void get_child_node_types(const BinOp<Op, A, B> &op, uint32_t *types) {
+    types[0] = instance_node_types(op.a);
+    types[1] = instance_node_types(op.b);
+    types[2] = any_node_type;
+}
+
+template<typename Op, typename A, typename B>
+HALIDE_ALWAYS_INLINE void get_child_node_types(const CmpOp<Op, A, B> &op, uint32_t *types) {
+    types[0] = instance_node_types(op.a);
+    types[1] = instance_node_types(op.b);
+    types[2] = any_node_type;
+}
+
+template<typename A>
+HALIDE_ALWAYS_INLINE void get_child_node_types(const NotOp<A> &op, uint32_t *types) {
+    types[0] = instance_node_types(op.a);
+    types[1] = types[2] = any_node_type;
+}
+
+template<typename C, typename T, typename F>
+HALIDE_ALWAYS_INLINE void get_child_node_types(const SelectOp<C, T, F> &op, uint32_t *types) {
+    types[0] = instance_node_types(op.c);
+    types[1] = instance_node_types(op.t);
+    types[2] = instance_node_types(op.f);
+}
+
+// Whether a rule's left-hand side could match an instance with the
+// given child node types. Only rules for the same kind of node as the
+// instance (or any rule for a concrete expression) are checked.
+template<typename Before, typename Instance>
+struct RulePrefilter {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return true;
+    }
+};
+
+template<typename Before>
+struct RulePrefilter<Before, SpecificExpr> {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return (node_types<Before>::mask & types[0]) != 0;
+    }
+};
+
+template<typename Op, typename A, typename B, typename A2, typename B2>
+struct RulePrefilter<BinOp<Op, A, B>, BinOp<Op, A2, B2>> {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return ((node_types<A>::mask & types[0]) != 0 &&
+                (node_types<B>::mask & types[1]) != 0);
+    }
+};
+
+template<typename Op, typename A, typename B, typename A2, typename B2>
+struct RulePrefilter<CmpOp<Op, A, B>, CmpOp<Op, A2, B2>> {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return ((node_types<A>::mask & types[0]) != 0 &&
+                (node_types<B>::mask & types[1]) != 0);
+    }
+};
+
+template<typename A, typename A2>
+struct RulePrefilter<NotOp<A>, NotOp<A2>> {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return (node_types<A>::mask & types[0]) != 0;
+    }
+};
+
+template<typename C, typename T, typename F, typename C2, typename T2, typename F2>
+struct RulePrefilter<SelectOp<C, T, F>, SelectOp<C2, T2, F2>> {
+    HALIDE_ALWAYS_INLINE static bool could_match(const uint32_t *types) {
+        return ((node_types<C>::mask & types[0]) != 0 &&
+                (node_types<T>::mask & types[1]) != 0 &&
+                (node_types<F>::mask & types[2]) != 0);
+    }
+};
+
 template<typename Instance>
 struct Rewriter {
     Instance instance;
@@ -2757,10 +2991,13 @@ struct Rewriter {
     MatcherState state;
     halide_type_t output_type, wildcard_type;
     bool validate;
+    // See RulePrefilter
+    uint32_t child_node_types[3];
 
     HALIDE_ALWAYS_INLINE
     Rewriter(Instance instance, halide_type_t ot, halide_type_t wt)
         : instance(std::move(instance)), output_type(ot), wildcard_type(wt) {
+        get_child_node_types(this->instance, child_node_types);
     }
 
     template<typename After>
@@ -2779,7 +3016,15 @@ struct Rewriter {
 #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, after, true, wildcard_type, output_type);
 #endif
-        if (before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             build_replacement(after);
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
@@ -2797,7 +3042,15 @@ struct Rewriter {
              typename = typename enable_if_pattern<Before>::type>
     HALIDE_ALWAYS_INLINE bool operator()(Before before, const Expr &after) noexcept {
         static_assert(Before::canonical, "LHS of rewrite rule should be in canonical form");
-        if (before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             result = after;
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
@@ -2818,7 +3071,15 @@ struct Rewriter {
 #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, IntLiteral(after), true, wildcard_type, output_type);
 #endif
-        if (before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             result = make_const(output_type, after);
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << "\n";
@@ -2848,8 +3109,16 @@ struct Rewriter {
 #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, after, pred, wildcard_type, output_type);
 #endif
-        if (before.template match<0>(unwrap(instance), state) &&
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after, pred));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             build_replacement(after);
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
@@ -2871,8 +3140,16 @@ struct Rewriter {
         static_assert(Predicate::foldable, "Predicates must consist only of operations that can constant-fold");
         static_assert(Before::canonical, "LHS of rewrite rule should be in canonical form");
 
-        if (before.template match<0>(unwrap(instance), state) &&
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after, pred));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             result = after;
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
@@ -2896,8 +3173,16 @@ struct Rewriter {
 #if HALIDE_FUZZ_TEST_RULES
         fuzz_test_rule(before, IntLiteral(after), pred, wildcard_type, output_type);
 #endif
-        if (before.template match<0>(unwrap(instance), state) &&
+#if HALIDE_PROFILE_RULES
+        static RuleProfile *profile = register_rule_profile(describe_rule(before, after, pred));
+        profile->attempts++;
+#endif
+        if (RulePrefilter<Before, Instance>::could_match(child_node_types) &&
+            before.template match<0>(unwrap(instance), state) &&
             evaluate_predicate(pred, state)) {
+#if HALIDE_PROFILE_RULES
+            profile->matches++;
+#endif
             result = make_const(output_type, after);
 #if HALIDE_DEBUG_MATCHED_RULES
             debug(0) << instance << " -> " << result << " via " << before << " -> " << after << " when " << pred << "\n";
@@ -1329,25 +1329,39 @@ Expr rounding_mul_shift_right(Expr a, Expr b, int q) {
 
 }  // namespace Internal
 
-Expr fast_log(const Expr &x) {
+Expr fast_log(const Expr &x, ApproximationPrecision precision) {
     user_assert(x.type() == Float(32)) << "fast_log only works for Float(32)";
 
+    if (precision == ApproximationPrecision::Precise) {
+        return Internal::halide_log(x);
+    }
+
     Expr reduced, exponent;
     range_reduce_log(x, &reduced, &exponent);
 
     Expr x1 = reduced - 1.0f;
 
-    float coeff[] = {
-        0.07640318789187280912f,
-        -0.16252961013874300811f,
-        0.20625219040645212387f,
-        -0.25110261010892864775f,
-        0.33320464908377461777f,
-        -0.49997513376789826101f,
-        1.0f,
-        0.0f};
-
-    Expr result = evaluate_polynomial(x1, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    Expr result;
+    if (precision == ApproximationPrecision::Fast) {
+        float coeff[] = {
+            -0.18177720904350280762f,
+            0.34411969780921936035f,
+            -0.50480055809020996094f,
+            0.99986505508422851562f,
+            0.0f};
+        result = evaluate_polynomial(x1, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    } else {
+        float coeff[] = {
+            0.07640318789187280912f,
+            -0.16252961013874300811f,
+            0.20625219040645212387f,
+            -0.25110261010892864775f,
+            0.33320464908377461777f,
+            -0.49997513376789826101f,
+            1.0f,
+            0.0f};
+        result = evaluate_polynomial(x1, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    }
     result = result + cast<float>(exponent) * logf(2);
     result = common_subexpression_elimination(result);
     return result;
@@ -1357,7 +1371,7 @@ namespace {
 
 // A vectorizable sine and cosine implementation. Based on syrah fast vector math
 // https://github.com/boulos/syrah/blob/master/src/include/syrah/FixedVectorMath.h#L55
-Expr fast_sin_cos(const Expr &x_full, bool is_sin) {
+Expr fast_sin_cos(const Expr &x_full, bool is_sin, ApproximationPrecision precision) {
     const float two_over_pi = 0.636619746685028076171875f;
     const float pi_over_two = 1.57079637050628662109375f;
     Expr scaled = x_full * two_over_pi;
@@ -1367,59 +1381,88 @@ Expr fast_sin_cos(const Expr &x_full, bool is_sin) {
     Expr sin_usecos = is_sin ? ((k_mod4 == 1) || (k_mod4 == 3)) : ((k_mod4 == 0) || (k_mod4 == 2));
     Expr flip_sign = is_sin ? (k_mod4 > 1) : ((k_mod4 == 1) || (k_mod4 == 2));
 
-    // Reduce the angle modulo pi/2.
+    // Reduce the angle modulo pi/2. For the precise version, do it in
+    // two parts (Cody-Waite) so that the reduction doesn't lose the
+    // low bits of large angles.
     Expr x = x_full - k_real * pi_over_two;
-
-    const float sin_c2 = -0.16666667163372039794921875f;
-    const float sin_c4 = 8.333347737789154052734375e-3;
-    const float sin_c6 = -1.9842604524455964565277099609375e-4;
-    const float sin_c8 = 2.760012648650445044040679931640625e-6;
-    const float sin_c10 = -2.50293279435709337121807038784027099609375e-8;
-
-    const float cos_c2 = -0.5f;
-    const float cos_c4 = 4.166664183139801025390625e-2;
-    const float cos_c6 = -1.388833043165504932403564453125e-3;
-    const float cos_c8 = 2.47562347794882953166961669921875e-5;
-    const float cos_c10 = -2.59630184018533327616751194000244140625e-7;
+    if (precision == ApproximationPrecision::Precise) {
+        const float pi_over_two_lo = -4.37113900018624283e-8f;
+        x -= k_real * pi_over_two_lo;
+    }
+
+    // The coefficients of x^2, x^4, ... of the polynomials for sin(x) / x
+    // and cos(x) over [0, pi/2].
+    const float fast_sin_c[] = {-0.16665680706501007080f,
+                                8.3123659715056419373e-3f,
+                                -1.8492180970497429371e-4f};
+    const float fast_cos_c[] = {-0.49993562698364257812f,
+                                4.1507069021463394165e-2f,
+                                -1.2757522054016590118e-3f};
+    const float sin_c[] = {-0.16666667163372039794921875f,
+                           8.333347737789154052734375e-3,
+                           -1.9842604524455964565277099609375e-4,
+                           2.760012648650445044040679931640625e-6,
+                           -2.50293279435709337121807038784027099609375e-8};
+    const float cos_c[] = {-0.5f,
+                           4.166664183139801025390625e-2,
+                           -1.388833043165504932403564453125e-3,
+                           2.47562347794882953166961669921875e-5,
+                           -2.59630184018533327616751194000244140625e-7};
+    const bool fast = precision == ApproximationPrecision::Fast;
+    const float *sc = fast ? fast_sin_c : sin_c;
+    const float *cc = fast ? fast_cos_c : cos_c;
+    const int n = fast ? 3 : 5;
 
     Expr outside = select(sin_usecos, 1, x);
-    Expr c2 = select(sin_usecos, cos_c2, sin_c2);
-    Expr c4 = select(sin_usecos, cos_c4, sin_c4);
-    Expr c6 = select(sin_usecos, cos_c6, sin_c6);
-    Expr c8 = select(sin_usecos, cos_c8, sin_c8);
-    Expr c10 = select(sin_usecos, cos_c10, sin_c10);
-
     Expr x2 = x * x;
-    Expr tri_func = outside * (x2 * (x2 * (x2 * (x2 * (x2 * c10 + c8) + c6) + c4) + c2) + 1);
+    Expr poly = select(sin_usecos, cc[n - 1], sc[n - 1]);
+    for (int i = n - 2; i >= 0; i--) {
+        poly = x2 * poly + select(sin_usecos, cc[i], sc[i]);
+    }
+    Expr tri_func = outside * (x2 * poly + 1);
     return select(flip_sign, -tri_func, tri_func);
 }
 
 }  // namespace
 
-Expr fast_sin(const Expr &x_full) {
-    return fast_sin_cos(x_full, true);
+Expr fast_sin(const Expr &x_full, ApproximationPrecision precision) {
+    return fast_sin_cos(x_full, true, precision);
 }
 
-Expr fast_cos(const Expr &x_full) {
-    return fast_sin_cos(x_full, false);
+Expr fast_cos(const Expr &x_full, ApproximationPrecision precision) {
+    return fast_sin_cos(x_full, false, precision);
 }
 
-Expr fast_exp(const Expr &x_full) {
+Expr fast_exp(const Expr &x_full, ApproximationPrecision precision) {
     user_assert(x_full.type() == Float(32)) << "fast_exp only works for Float(32)";
 
+    if (precision == ApproximationPrecision::Precise) {
+        return Internal::halide_exp(x_full);
+    }
+
     Expr scaled = x_full / logf(2.0);
     Expr k_real = floor(scaled);
     Expr k = cast<int>(k_real);
     Expr x = x_full - k_real * logf(2.0);
 
-    float coeff[] = {
-        0.01314350012789660196f,
-        0.03668965196652099192f,
-        0.16873890085469545053f,
-        0.49970514590562437052f,
-        1.0f,
-        1.0f};
-    Expr result = evaluate_polynomial(x, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    Expr result;
+    if (precision == ApproximationPrecision::Fast) {
+        float coeff[] = {
+            0.23429033160209655762f,
+            0.47052934765815734863f,
+            1.00387549400329589844f,
+            0.99992519617080688477f};
+        result = evaluate_polynomial(x, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    } else {
+        float coeff[] = {
+            0.01314350012789660196f,
+            0.03668965196652099192f,
+            0.16873890085469545053f,
+            0.49970514590562437052f,
+            1.0f,
+            1.0f};
+        result = evaluate_polynomial(x, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    }
 
     // Compute 2^k.
     int fpbias = 127;
@@ -1433,6 +1476,66 @@ Expr fast_exp(const Expr &x_full) {
     return result;
 }
 
+Expr fast_tanh(const Expr &x, ApproximationPrecision precision) {
+    user_assert(x.type() == Float(32)) << "fast_tanh only works for Float(32)";
+
+    // tanh(|x|) = 1 - 2 / (exp(2|x|) + 1). Past 9, tanh(x) rounds to 1.
+    Expr a = abs(x);
+    Expr e = fast_exp(2.0f * min(a, 9.0f), precision);
+    Expr result = 1.0f - 2.0f / (e + 1.0f);
+
+    if (precision != ApproximationPrecision::Fast) {
+        // That cancels badly near zero, where we use an odd polynomial
+        // instead, with minimum relative error over [0, 0.625].
+        float coeff[] = {
+            -0.0057049905881285667419f,
+            0.020639089867472648621f,
+            -0.053739715367555618286f,
+            0.13331441581249237061f,
+            -0.33333280682563781738f,
+            1.0f};
+        Expr small = a * evaluate_polynomial(a * a, coeff, sizeof(coeff) / sizeof(coeff[0]));
+        result = select(a < 0.625f, small, result);
+    }
+
+    result = select(x < 0.0f, -result, result);
+    result = common_subexpression_elimination(result);
+    return result;
+}
+
+Expr fast_erf(const Expr &x, ApproximationPrecision precision) {
+    user_assert(x.type() == Float(32)) << "fast_erf only works for Float(32)";
+
+    if (precision != ApproximationPrecision::Fast) {
+        return Internal::halide_erf(x);
+    }
+
+    // Abramowitz and Stegun 7.1.27: erf(x) = 1 - P(x)^-4 for x >= 0.
+    Expr a = abs(x);
+    float coeff[] = {
+        0.078108f,
+        0.000972f,
+        0.230389f,
+        0.278393f,
+        1.0f};
+    Expr p = evaluate_polynomial(a, coeff, sizeof(coeff) / sizeof(coeff[0]));
+    Expr p2 = p * p;
+    Expr result = 1.0f - 1.0f / (p2 * p2);
+    result = select(x < 0.0f, -result, result);
+    result = common_subexpression_elimination(result);
+    return result;
+}
+
+Expr fast_sigmoid(const Expr &x, ApproximationPrecision precision) {
+    user_assert(x.type() == Float(32)) << "fast_sigmoid only works for Float(32)";
+
+    // Clamping keeps the range reduction of exp from overflowing. exp
+    // is already inf or zero well within the clamp, which gives the
+    // right limits.
+    Expr e = fast_exp(-clamp(x, -100.0f, 100.0f), precision);
+    return 1.0f / (1.0f + e);
+}
+
 Expr print(const std::vector<Expr> &args) {
     Expr combined_string = combine_strings(args);
 
@@ -2203,14 +2306,14 @@ Expr erf(const Expr &x) {
     return Internal::halide_erf(x);
 }
 
-Expr fast_pow(Expr x, Expr y) {
+Expr fast_pow(Expr x, Expr y, ApproximationPrecision precision) {
     if (const int64_t *i = as_const_int(y)) {
         return raise_to_integer_power(std::move(x), *i);
     }
 
     x = cast<float>(std::move(x));
     y = cast<float>(std::move(y));
-    return select(x == 0.0f, 0.0f, fast_exp(fast_log(x) * std::move(y)));
+    return select(x == 0.0f, 0.0f, fast_exp(fast_log(x, precision) * std::move(y), precision));
 }
 
 Expr fast_inverse(Expr x) {
@@ -2599,6 +2702,12 @@ Expr likely_if_innermost(Expr e) {
                                 {std::move(e)}, Internal::Call::PureIntrinsic);
 }
 
+Expr tuned_prefetch_distance(int initial) {
+    user_assert(initial > 0) << "tuned_prefetch_distance needs a positive initial distance\n";
+    return Internal::Call::make(Int(32), Internal::Call::tuned_prefetch_distance,
+                                {initial}, Internal::Call::PureIntrinsic);
+}
+
 Expr strict_float(Expr e) {
     Type t = e.type();
     return Internal::Call::make(t, Internal::Call::strict_float,
@@ -2611,6 +2720,25 @@ Expr undef(Type t) {
                                 Internal::Call::Intrinsic);
 }
 
+Expr gpu_preferred_block_size(DeviceAPI device_api, int registers_per_thread,
+                              int shared_memory_per_block) {
+    std::string name;
+    if (device_api == DeviceAPI::CUDA) {
+        name = "halide_cuda_preferred_block_size";
+    } else if (device_api == DeviceAPI::OpenCL) {
+        name = "halide_opencl_preferred_block_size";
+    } else {
+        user_error << "gpu_preferred_block_size only supports DeviceAPI::CUDA and DeviceAPI::OpenCL\n";
+    }
+    user_assert(registers_per_thread >= 0 && shared_memory_per_block >= 0)
+        << "gpu_preferred_block_size needs non-negative register and shared memory usage\n";
+    // The answer only depends on the device, so the call can be
+    // hoisted and shared between uses.
+    return Internal::Call::make(Int(32), name,
+                                {registers_per_thread, shared_memory_per_block},
+                                Internal::Call::PureExtern);
+}
+
 namespace Internal {
 Expr unreachable(Type t) {
     return Internal::Call::make(t, Internal::Call::unreachable,
@@ -9,6 +9,7 @@
 
 #include <cmath>
 
+#include "DeviceAPI.h"
 #include "Expr.h"
 #include "Tuple.h"
 
@@ -985,29 +986,69 @@ Expr pow(Expr x, Expr y);
  * mantissa. Vectorizes cleanly. */
 Expr erf(const Expr &x);
 
-/** Fast vectorizable approximation to some trigonometric functions for Float(32).
- * Absolute approximation error is less than 1e-5. */
+/** How accurate one of the fast_ approximations of a transcendental
+ * function should be. Each tier is cheaper than the next. All of them
+ * are built from polynomials, comparisons and bit manipulation in
+ * Halide IR, so they vectorize cleanly on every backend. The plain
+ * math functions (sin, exp, ...) can also be made to use one of these
+ * tiers with the Target features vector_math_fast,
+ * vector_math_balanced and vector_math_precise. */
+enum class ApproximationPrecision {
+    /** The lowest degree polynomials. Absolute error around 1e-4, or
+     * relative error around 1e-4 for exp. Meant for activation
+     * functions, tone curves, and the like. */
+    Fast,
+
+    /** Accurate up to the last 5 bits of the mantissa for exp and log,
+     * and to an absolute error of 1e-5 for sin and cos. */
+    Balanced,
+
+    /** Accurate up to the last few bits of the mantissa, and does the
+     * right thing for extreme inputs, like exp and log. */
+    Precise,
+};
+
+/** Fast vectorizable approximation to some trigonometric functions for
+ * Float(32). At the Balanced precision, absolute approximation error is
+ * less than 1e-5. */
 // @{
-Expr fast_sin(const Expr &x);
-Expr fast_cos(const Expr &x);
+Expr fast_sin(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
+Expr fast_cos(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
 // @}
 
 /** Fast approximate cleanly vectorizable log for Float(32). Returns
- * nonsense for x <= 0.0f. Accurate up to the last 5 bits of the
- * mantissa. Vectorizes cleanly. */
-Expr fast_log(const Expr &x);
+ * nonsense for x <= 0.0f, except at the Precise precision. Vectorizes
+ * cleanly. */
+Expr fast_log(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
 
 /** Fast approximate cleanly vectorizable exp for Float(32). Returns
- * nonsense for inputs that would overflow or underflow. Typically
- * accurate up to the last 5 bits of the mantissa. Gets worse when
- * approaching overflow. Vectorizes cleanly. */
-Expr fast_exp(const Expr &x);
+ * nonsense for inputs that would overflow or underflow, except at the
+ * Precise precision. Gets worse when approaching overflow. Vectorizes
+ * cleanly. */
+Expr fast_exp(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
 
 /** Fast approximate cleanly vectorizable pow for Float(32). Returns
  * nonsense for x < 0.0f. Accurate up to the last 5 bits of the
- * mantissa for typical exponents. Gets worse when approaching
- * overflow. Vectorizes cleanly. */
-Expr fast_pow(Expr x, Expr y);
+ * mantissa for typical exponents at the Balanced
+ * precision. Gets worse when approaching overflow. Vectorizes
+ * cleanly. */
+Expr fast_pow(Expr x, Expr y, ApproximationPrecision precision = ApproximationPrecision::Balanced);
+
+/** Fast approximate cleanly vectorizable hyperbolic tangent for
+ * Float(32). Except at the Fast precision, small inputs use a
+ * polynomial with low relative error rather than the formula in terms
+ * of exp, which cancels badly near zero. */
+Expr fast_tanh(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
+
+/** Fast approximate cleanly vectorizable error function for
+ * Float(32). The Fast precision has absolute error less than 5e-4. The
+ * other precisions are the same as erf. */
+Expr fast_erf(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
+
+/** Fast approximate cleanly vectorizable logistic sigmoid
+ * 1 / (1 + exp(-x)) for Float(32). Goes to exactly 0 and 1 for large
+ * inputs. */
+Expr fast_sigmoid(const Expr &x, ApproximationPrecision precision = ApproximationPrecision::Balanced);
 
 /** Fast approximate inverse for Float(32). Corresponds to the rcpps
  * instruction on x86, and the vrecpe instruction on ARM. Vectorizes
@@ -1364,6 +1405,27 @@ inline Expr undef() {
     return undef(type_of<T>());
 }
 
+/** Return, at run time, the number of threads per block that lets the
+ * most threads be resident at once on the GPU a pipeline is running
+ * on, for a kernel that uses the given number of registers per thread
+ * and bytes of shared memory per block. Use it to choose between
+ * specializations with different gpu_tile sizes, so that one compiled
+ * pipeline launches suitable blocks on different devices. E.g.:
+ *
+ \code
+ Expr block_size = gpu_preferred_block_size(DeviceAPI::CUDA, 40);
+ f.gpu_tile(x, y, xo, yo, xi, yi, 8, 8);
+ f.specialize(block_size >= 256).gpu_tile(x, y, xo, yo, xi, yi, 32, 8);
+ f.specialize(block_size >= 128).gpu_tile(x, y, xo, yo, xi, yi, 16, 8);
+ \endcode
+ *
+ * Only DeviceAPI::CUDA and DeviceAPI::OpenCL are supported. OpenCL
+ * can't say how much of the device a work-group will use before a
+ * kernel is compiled, so there it is the largest power of two the
+ * device allows. The result is zero if no block size fits. */
+Expr gpu_preferred_block_size(DeviceAPI device_api, int registers_per_thread = 32,
+                              int shared_memory_per_block = 0);
+
 namespace Internal {
 
 /** Return an expression that should never be evaluated. Expressions
@@ -1432,6 +1494,15 @@ Expr likely(Expr e);
  * found in an innermost loop. */
 Expr likely_if_innermost(Expr e);
 
+/** A prefetch distance, for use in the offset of Func::prefetch,
+ * that is tuned while the pipeline runs. The loop the prefetch is
+ * placed in is timed over its first few runs with distances from half
+ * to four times the initial one, after which the fastest is used. For
+ * example: g.prefetch(f, x, x, tuned_prefetch_distance(16)). See
+ * halide_tuned_prefetch_distance in HalideRuntime.h for details. It is
+ * an error to use this anywhere but in a prefetch offset. */
+Expr tuned_prefetch_distance(int initial);
+
 /** Cast an expression to the halide type corresponding to the C++
  * type T. As part of the cast, clamp to the minimum and maximum
  * values of the result type. */
@@ -117,6 +117,9 @@ ostream &operator<<(ostream &out, const DeviceAPI &api) {
     case DeviceAPI::D3D12Compute:
         out << "<D3D12Compute>";
         break;
+    case DeviceAPI::Vulkan:
+        out << "<Vulkan>";
+        break;
     }
     return out;
 }
@@ -150,6 +153,9 @@ std::ostream &operator<<(std::ostream &out, const MemoryType &t) {
     case MemoryType::AMXTile:
         out << "AMXTile";
         break;
+    case MemoryType::MMAFragment:
+        out << "MMAFragment";
+        break;
     }
     return out;
 }
@@ -294,6 +300,12 @@ ostream &operator<<(ostream &out, const ForType &type) {
     case ForType::GPULane:
         out << "gpu_lane";
         break;
+    case ForType::Distributed:
+        out << "distributed";
+        break;
+    case ForType::MultiGPU:
+        out << "multi_gpu";
+        break;
     }
     return out;
 }
@@ -519,7 +519,7 @@ class InjectBufferCopies : public IRMutator {
                 Expr buf = Variable::make(type_of<struct halide_buffer_t *>(), buffer);
                 Stmt destructor =
                     Evaluate::make(Call::make(Handle(), Call::register_destructor,
-                                              {Expr("halide_device_free_as_destructor"), buf}, Call::Intrinsic));
+                                              {Expr(destructor_name), buf}, Call::Intrinsic));
                 Stmt body = Block::make(destructor, op->body);
                 return LetStmt::make(op->name, op->value, body);
             } else {
@@ -527,11 +527,11 @@ class InjectBufferCopies : public IRMutator {
             }
         }
 
-        string buffer;
+        string buffer, destructor_name;
 
     public:
-        InjectDeviceDestructor(string b)
-            : buffer(std::move(b)) {
+        InjectDeviceDestructor(string b, string d)
+            : buffer(std::move(b)), destructor_name(std::move(d)) {
         }
     };
 
@@ -633,9 +633,14 @@ class InjectBufferCopies : public IRMutator {
         string buffer_name = op->name + ".buffer";
         Expr buffer = Variable::make(Handle(), buffer_name);
 
+        // The host allocations of memoized Funcs come from the cache,
+        // which also keeps their device allocations, so those must be
+        // allocated separately and freed via the cache.
+        bool memoized = (op->free_function == "halide_memoization_cache_release");
+
         // Device what type of allocation to make.
 
-        if (touched_on_host && finder.devices_touched.size() == 2) {
+        if (touched_on_host && finder.devices_touched.size() == 2 && !memoized) {
             // Touched on a single device and the host. Use a combined allocation.
             DeviceAPI touching_device = DeviceAPI::None;
             for (DeviceAPI d : finder.devices_touched) {
@@ -666,21 +671,22 @@ class InjectBufferCopies : public IRMutator {
             // devices. Do separate device and host allocations.
 
             // Add a device destructor
-            body = InjectDeviceDestructor(buffer_name).mutate(body);
+            string device_free_name = memoized ? "halide_memoization_cache_device_free" : "halide_device_free";
+            body = InjectDeviceDestructor(buffer_name, device_free_name + "_as_destructor").mutate(body);
 
             // Make a device_free stmt
 
             FindLastUse last_use(op->name);
             body.accept(&last_use);
             if (last_use.last_use.defined()) {
-                Stmt device_free = call_extern_and_assert("halide_device_free", {buffer});
+                Stmt device_free = call_extern_and_assert(device_free_name, {buffer});
                 FreeAfterLastUse free_injecter(last_use.last_use, device_free);
                 body = free_injecter.mutate(body);
                 internal_assert(free_injecter.success);
             }
 
             Expr condition = op->condition;
-            bool touched_on_one_device = !touched_on_host && finder.devices_touched.size() == 1 &&
+            bool touched_on_one_device = !memoized && !touched_on_host && finder.devices_touched.size() == 1 &&
                                          (finder.devices_touched_by_extern.empty() ||
                                           (finder.devices_touched_by_extern.size() == 1 &&
                                            *(finder.devices_touched.begin()) == *(finder.devices_touched_by_extern.begin())));
@@ -0,0 +1,138 @@
+#include "InjectStorageTypes.h"
+
+#include "ExternFuncArgument.h"
+#include "Function.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+class InjectStorageTypes : public IRMutator {
+    const map<string, Type> &storage_types;
+
+    using IRMutator::visit;
+
+    Stmt visit(const Realize *op) override {
+        auto it = storage_types.find(op->name);
+        if (it == storage_types.end()) {
+            return IRMutator::visit(op);
+        }
+        Region bounds;
+        for (const Range &r : op->bounds) {
+            bounds.emplace_back(mutate(r.min), mutate(r.extent));
+        }
+        vector<Type> types(op->types.size(), it->second);
+        return Realize::make(op->name, types, op->memory_type, bounds,
+                             mutate(op->condition), mutate(op->body));
+    }
+
+    Stmt visit(const Provide *op) override {
+        auto it = storage_types.find(op->name);
+        if (it == storage_types.end()) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> values, args;
+        for (const Expr &v : op->values) {
+            values.push_back(cast(it->second, mutate(v)));
+        }
+        for (const Expr &a : op->args) {
+            args.push_back(mutate(a));
+        }
+        return Provide::make(op->name, values, args, mutate(op->predicate));
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide) {
+            return IRMutator::visit(op);
+        }
+        auto it = storage_types.find(op->name);
+        if (it == storage_types.end()) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> args;
+        for (const Expr &a : op->args) {
+            args.push_back(mutate(a));
+        }
+        Expr load = Call::make(it->second.with_lanes(op->type.lanes()), op->name, args, op->call_type,
+                               op->func, op->value_index, op->image, op->param);
+        return cast(op->type, load);
+    }
+
+    Stmt visit(const Prefetch *op) override {
+        auto it = storage_types.find(op->name);
+        if (it == storage_types.end()) {
+            return IRMutator::visit(op);
+        }
+        Region bounds;
+        for (const Range &r : op->bounds) {
+            bounds.emplace_back(mutate(r.min), mutate(r.extent));
+        }
+        vector<Type> types(op->types.size(), it->second);
+        return Prefetch::make(op->name, types, bounds, op->prefetch,
+                              mutate(op->condition), mutate(op->body));
+    }
+
+public:
+    InjectStorageTypes(const map<string, Type> &storage_types)
+        : storage_types(storage_types) {
+    }
+};
+
+}  // namespace
+
+Stmt inject_storage_types(const Stmt &s, const vector<Function> &outputs,
+                          const map<string, Function> &env) {
+    map<string, Type> storage_types;
+    for (const auto &it : env) {
+        const Function &f = it.second;
+        Type t = f.schedule().storage_type();
+        if (t == Type()) {
+            continue;
+        }
+        for (const Type &o : f.output_types()) {
+            user_assert(o.is_float() && o.bits() > t.bits())
+                << "Func " << f.name() << " can't be stored as " << t
+                << ", as its type " << o << " isn't a wider floating point type.\n";
+        }
+        user_assert(!f.has_extern_definition())
+            << "Func " << f.name() << " can't be stored as " << t
+            << ", as it is an extern stage, which writes its buffer directly.\n";
+        storage_types[f.name()] = t;
+    }
+
+    if (storage_types.empty()) {
+        return s;
+    }
+
+    for (const Function &f : outputs) {
+        user_assert(!storage_types.count(f.name()))
+            << "Func " << f.name() << " can't be stored as "
+            << storage_types[f.name()] << ", as it is an output of the pipeline.\n";
+    }
+    for (const auto &it : env) {
+        if (!it.second.has_extern_definition()) {
+            continue;
+        }
+        for (const ExternFuncArgument &arg : it.second.extern_arguments()) {
+            if (arg.is_func()) {
+                string name = Function(arg.func).name();
+                user_assert(!storage_types.count(name))
+                    << "Func " << name << " can't be stored as " << storage_types[name]
+                    << ", as it is used by the extern stage " << it.first
+                    << ", which reads its buffer directly.\n";
+            }
+        }
+    }
+
+    return InjectStorageTypes(storage_types).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,29 @@
+#ifndef HALIDE_INJECT_STORAGE_TYPES_H
+#define HALIDE_INJECT_STORAGE_TYPES_H
+
+/** \file
+ * Defines the lowering pass that stores Funcs scheduled with
+ * Func::store_as in their narrower storage type.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+class Function;
+
+/** Change the realizations of Funcs with a storage type to that type,
+ * round the values they are given to it, and widen the values loaded
+ * from them back to the type of the Func. */
+Stmt inject_storage_types(const Stmt &s, const std::vector<Function> &outputs,
+                          const std::map<std::string, Function> &env);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -20,6 +20,7 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 // defines backtrace, which gets the call stack as instruction pointers
 #include <execinfo.h>
@@ -2255,9 +2256,98 @@ private:
 
 DebugSections *debug_sections = nullptr;
 
+// Compilation units that have asked for introspection to be tested,
+// but have not been tested yet. Parsing the debug info of the whole
+// program is slow, so it is deferred until something actually asks
+// for a name or a source location. These are function-local statics
+// because the requests arrive from the static initializers of other
+// compilation units.
+struct PendingTest {
+    bool (*test)(bool (*)(const void *, const std::string &));
+    bool (*test_a)(const void *, const std::string &);
+    void (*calib)();
+};
+
+std::vector<PendingTest> &pending_tests() {
+    static std::vector<PendingTest> tests;
+    return tests;
+}
+
+// Heap objects registered while there were pending tests, to be
+// registered with the debug sections once they are loaded.
+struct PendingHeapObject {
+    size_t size;
+    const void *helper;
+};
+
+std::map<const void *, PendingHeapObject> &pending_heap_objects() {
+    static std::map<const void *, PendingHeapObject> objects;
+    return objects;
+}
+
+// Set if any compilation unit doesn't save the frame pointer, in
+// which case introspection never works.
+bool frame_pointer_missing = false;
+
+// Set while running the pending tests, which themselves call
+// get_variable_name and get_source_location.
+bool running_tests = false;
+
+void run_pending_tests() {
+    if (running_tests || pending_tests().empty()) {
+        return;
+    }
+    running_tests = true;
+
+    std::vector<PendingTest> tests;
+    tests.swap(pending_tests());
+
+    if (!debug_sections) {
+        char path[2048];
+        get_program_name(path, sizeof(path));
+        debug_sections = new DebugSections(path);
+    }
+
+    if (frame_pointer_missing) {
+        debug_sections->working = false;
+    }
+
+    for (const PendingTest &t : tests) {
+        if (!debug_sections->working) {
+            break;
+        }
+
+        debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(t.calib) << "\n";
+
+        debug_sections->calibrate_pc_offset(t.calib);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because offset calibration failed\n";
+            break;
+        }
+
+        debug_sections->working = (*t.test)(t.test_a);
+        if (!debug_sections->working) {
+            debug(5) << "Failed because test routine failed\n";
+            break;
+        }
+
+        debug(5) << "Test passed\n";
+    }
+
+    if (debug_sections->working) {
+        for (const auto &it : pending_heap_objects()) {
+            debug_sections->register_heap_object(it.first, it.second.size, it.second.helper);
+        }
+    }
+    pending_heap_objects().clear();
+
+    running_tests = false;
+}
+
 }  // namespace
 
 bool dump_stack_frame() {
+    run_pending_tests();
     if (!debug_sections || !debug_sections->working) {
         return false;
     }
@@ -2266,6 +2356,7 @@ bool dump_stack_frame() {
 }
 
 std::string get_variable_name(const void *var, const std::string &expected_type) {
+    run_pending_tests();
     if (!debug_sections ||
         !debug_sections->working) {
         return "";
@@ -2284,6 +2375,7 @@ std::string get_variable_name(const void *var, const std::string &expected_type)
 }
 
 std::string get_source_location() {
+    run_pending_tests();
     if (!debug_sections ||
         !debug_sections->working) {
         return "";
@@ -2292,15 +2384,26 @@ std::string get_source_location() {
 }
 
 void register_heap_object(const void *obj, size_t size, const void *helper) {
+    if (!helper) {
+        return;
+    }
+    if (!pending_tests().empty() && !running_tests) {
+        // Don't load the debug info just to register an object that
+        // may never be looked up.
+        if (!frame_pointer_missing) {
+            pending_heap_objects()[obj] = {size, helper};
+        }
+        return;
+    }
     if (!debug_sections ||
-        !debug_sections->working ||
-        !helper) {
+        !debug_sections->working) {
         return;
     }
     debug_sections->register_heap_object(obj, size, helper);
 }
 
 void deregister_heap_object(const void *obj, size_t size) {
+    pending_heap_objects().erase(obj);
     if (!debug_sections ||
         !debug_sections->working) {
         return;
@@ -2332,35 +2435,17 @@ void test_compilation_unit(bool (*test)(bool (*)(const void *, const std::string
         return;
     }
 
-    debug(5) << "Testing compilation unit with offset_marker at " << reinterpret_bits<void *>(calib) << "\n";
-
-    if (!debug_sections) {
-        char path[2048];
-        get_program_name(path, sizeof(path));
-        debug_sections = new DebugSections(path);
-    }
-
     if (!saves_frame_pointer(reinterpret_bits<void *>(&test_compilation_unit)) ||
         !saves_frame_pointer(reinterpret_bits<void *>(test))) {
         // Make sure libHalide and the test compilation unit both save the frame pointer
-        debug_sections->working = false;
-        debug(5) << "Failed because frame pointer not saved\n";
-    } else if (debug_sections->working) {
-        debug_sections->calibrate_pc_offset(calib);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because offset calibration failed\n";
-            return;
-        }
-
-        debug_sections->working = (*test)(test_a);
-        if (!debug_sections->working) {
-            debug(5) << "Failed because test routine failed\n";
-            return;
-        }
-
-        debug(5) << "Test passed\n";
+        debug(5) << "Introspection disabled because frame pointer not saved\n";
+        frame_pointer_missing = true;
+        pending_heap_objects().clear();
     }
 
+    // The test itself is run lazily, the first time introspection is used.
+    pending_tests().push_back({test, test_a, calib});
+
 #endif
 }
 
@@ -0,0 +1,404 @@
+#include "JITCodeCache.h"
+#include "Buffer.h"
+#include "Debug.h"
+#include "IRPrinter.h"
+#include "LLVM_Headers.h"
+#include "Module.h"
+#include "Util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#if defined(_MSC_VER) && !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+// Bump this whenever the file format or the meaning of keys changes.
+constexpr char cache_file_magic[8] = {'H', 'L', 'J', 'I', 'T', 'C', 0, 1};
+constexpr const char *cache_file_suffix = ".hlobj";
+constexpr int64_t default_max_cache_size = 256 * 1024 * 1024;
+
+std::atomic<int64_t> cache_hits{0};
+std::atomic<int64_t> cache_misses{0};
+
+struct CacheConfig {
+    std::mutex mutex;
+    bool initialized = false;
+    std::string dir;
+    int64_t max_size = default_max_cache_size;
+    JITRemoteCompiler remote_compiler;
+};
+
+// Compile a serialized module by running a command, in the same way as
+// HL_HEXAGON_CODE_SIGNER: the command is given the path of the
+// serialized module, and the path to write the code to.
+bool run_remote_compiler_command(const std::string &command,
+                                 const std::vector<uint8_t> &serialized_module,
+                                 JITCodeCacheEntry &entry) {
+    TemporaryFile input("jit_module", ".hlmod");
+    TemporaryFile output("jit_code", cache_file_suffix);
+    write_entire_file(input.pathname(), serialized_module.data(), serialized_module.size());
+
+    std::string cmd = command + " " + input.pathname() + " " + output.pathname();
+    debug(1) << "JIT remote compiler: running (" << cmd << ")\n";
+    int result = system(cmd.c_str());
+    if (result != 0) {
+        debug(1) << "JIT remote compiler: (" << cmd << ") failed with result " << result << "\n";
+        return false;
+    }
+    return read_jit_code_file(output.pathname(), entry);
+}
+
+CacheConfig &cache_config() {
+    static CacheConfig config;
+    return config;
+}
+
+// Must be called with the config mutex held.
+void init_config_already_locked(CacheConfig &config) {
+    if (config.initialized) {
+        return;
+    }
+    config.initialized = true;
+    config.dir = get_env_variable("HL_JIT_CACHE_DIR");
+    std::string size = get_env_variable("HL_JIT_CACHE_SIZE");
+    if (!size.empty()) {
+        config.max_size = std::max<int64_t>(0, std::atoll(size.c_str()));
+    }
+    std::string command = get_env_variable("HL_JIT_REMOTE_COMPILER");
+    if (!command.empty()) {
+        config.remote_compiler = [command](const std::vector<uint8_t> &serialized_module,
+                                           JITCodeCacheEntry &entry) {
+            return run_remote_compiler_command(command, serialized_module, entry);
+        };
+    }
+}
+
+std::string cache_path(const std::string &dir, const std::string &key) {
+    return dir + "/" + key + cache_file_suffix;
+}
+
+// Mark a cache file as recently used by bumping its modification
+// time, which is what eviction sorts by.
+void touch(const std::string &path) {
+    int fd;
+    if (llvm::sys::fs::openFileForReadWrite(path, fd, llvm::sys::fs::CD_OpenExisting, llvm::sys::fs::OF_None)) {
+        return;
+    }
+    (void)llvm::sys::fs::setLastAccessAndModificationTime(
+        fd, std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now()));
+    (void)llvm::sys::Process::SafelyCloseFileDescriptor(fd);
+}
+
+// Delete the least recently used entries until the directory fits in
+// max_size bytes.
+void evict(const std::string &dir, int64_t max_size) {
+    if (max_size <= 0) {
+        return;
+    }
+
+    struct CacheFile {
+        llvm::sys::TimePoint<> mod_time;
+        int64_t size;
+        std::string path;
+    };
+    std::vector<CacheFile> files;
+    int64_t total_size = 0;
+
+    std::error_code ec;
+    for (llvm::sys::fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!ends_with(it->path(), cache_file_suffix)) {
+            continue;
+        }
+        auto status = it->status();
+        if (!status) {
+            continue;
+        }
+        files.push_back({status->getLastModificationTime(), (int64_t)status->getSize(), it->path()});
+        total_size += files.back().size;
+    }
+
+    if (total_size <= max_size) {
+        return;
+    }
+
+    std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) {
+        return a.mod_time < b.mod_time;
+    });
+    for (const CacheFile &f : files) {
+        if (total_size <= max_size) {
+            break;
+        }
+        // Another process may have removed it already, which is fine.
+        (void)llvm::sys::fs::remove(f.path);
+        debug(2) << "JIT code cache: evicted " << f.path << "\n";
+        total_size -= f.size;
+    }
+}
+
+// Write an entry in the format of the files in the cache directory.
+bool write_entry(llvm::raw_fd_ostream &out, const JITCodeCacheEntry &entry) {
+    uint64_t sizes[2] = {entry.options_bitcode.size(), entry.object.size()};
+    out.write(cache_file_magic, sizeof(cache_file_magic));
+    out.write((const char *)sizes, sizeof(sizes));
+    out << entry.options_bitcode << entry.object;
+    out.close();
+    if (out.has_error()) {
+        out.clear_error();
+        return false;
+    }
+    return true;
+}
+
+std::string halide_version() {
+#ifdef HALIDE_VERSION_MAJOR
+    return std::to_string(HALIDE_VERSION_MAJOR) + "." +
+           std::to_string(HALIDE_VERSION_MINOR) + "." +
+           std::to_string(HALIDE_VERSION_PATCH);
+#else
+    return "unversioned";
+#endif
+}
+
+// Identify the build of libHalide that is running by the path, size and
+// modification time of the file it was loaded from (the executable, if
+// it is linked statically). Any rebuild changes this, and unlike a
+// timestamp compiled into the library, it doesn't make the build
+// itself unreproducible.
+const std::string &libhalide_build_id() {
+    static const std::string id = []() {
+        std::string path;
+#ifdef _WIN32
+        HMODULE module = nullptr;
+        char name[MAX_PATH];
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                                   GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               (LPCSTR)&jit_code_fingerprint, &module) &&
+            GetModuleFileNameA(module, name, MAX_PATH)) {
+            path = name;
+        }
+#else
+        Dl_info info;
+        if (dladdr((const void *)&jit_code_fingerprint, &info) && info.dli_fname) {
+            path = info.dli_fname;
+        }
+#endif
+        llvm::sys::fs::file_status status;
+        if (path.empty() || llvm::sys::fs::status(path, status)) {
+            // Without a way to tell builds apart, don't let entries
+            // written by this process be reused by any other.
+            debug(1) << "JIT code cache: can't identify the build of libHalide\n";
+            return "unidentified " + std::to_string(std::chrono::system_clock::now().time_since_epoch().count());
+        }
+        std::ostringstream s;
+        s << path << " " << status.getSize() << " "
+          << status.getLastModificationTime().time_since_epoch().count();
+        return s.str();
+    }();
+    return id;
+}
+
+}  // namespace
+
+bool read_jit_code_file(const std::string &path, JITCodeCacheEntry &entry) {
+    auto file = llvm::MemoryBuffer::getFile(path, /* IsText */ false, /* RequiresNullTerminator */ false);
+    if (!file) {
+        debug(1) << "JIT code cache: can't read " << path << "\n";
+        return false;
+    }
+
+    const char *data = (*file)->getBufferStart();
+    size_t size = (*file)->getBufferSize();
+    uint64_t sizes[2];
+    const size_t header_size = sizeof(cache_file_magic) + sizeof(sizes);
+    if (size < header_size ||
+        memcmp(data, cache_file_magic, sizeof(cache_file_magic)) != 0) {
+        debug(1) << "JIT code cache: ignoring malformed entry " << path << "\n";
+        return false;
+    }
+    memcpy(sizes, data + sizeof(cache_file_magic), sizeof(sizes));
+    if (sizes[0] > size - header_size ||
+        sizes[1] != size - header_size - sizes[0]) {
+        debug(1) << "JIT code cache: ignoring truncated entry " << path << "\n";
+        return false;
+    }
+
+    entry.options_bitcode.assign(data + header_size, sizes[0]);
+    entry.object.assign(data + header_size + sizes[0], sizes[1]);
+    return true;
+}
+
+bool write_jit_code_file(const std::string &path, const JITCodeCacheEntry &entry) {
+    std::error_code ec;
+    llvm::raw_fd_ostream out(path, ec, llvm::sys::fs::OF_None);
+    if (ec) {
+        debug(1) << "JIT code cache: can't write " << path << ": " << ec.message() << "\n";
+        return false;
+    }
+    return write_entry(out, entry);
+}
+
+void set_jit_remote_compiler(const JITRemoteCompiler &compiler) {
+    CacheConfig &config = cache_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    init_config_already_locked(config);
+    config.remote_compiler = compiler;
+}
+
+JITRemoteCompiler get_jit_remote_compiler() {
+    CacheConfig &config = cache_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    init_config_already_locked(config);
+    return config.remote_compiler;
+}
+
+void set_jit_code_cache_directory(const std::string &dir) {
+    CacheConfig &config = cache_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    init_config_already_locked(config);
+    config.dir = dir;
+}
+
+std::string get_jit_code_cache_directory() {
+    CacheConfig &config = cache_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    init_config_already_locked(config);
+    return config.dir;
+}
+
+void set_jit_code_cache_max_size(int64_t bytes) {
+    user_assert(bytes >= 0) << "The JIT code cache size limit may not be negative\n";
+    CacheConfig &config = cache_config();
+    std::lock_guard<std::mutex> lock(config.mutex);
+    init_config_already_locked(config);
+    config.max_size = bytes;
+}
+
+std::string jit_code_fingerprint(const Module &m, const std::string &function_name) {
+    std::ostringstream key;
+    // Entries written by a different build of libHalide are never
+    // reused, even if it has the same version.
+    key << "halide jit code cache v1\n"
+        << "halide " << halide_version() << "\n"
+        << "build " << libhalide_build_id() << "\n"
+        << "llvm " << LLVM_VERSION << "\n"
+        << "host cpu " << llvm::sys::getHostCPUName().str() << "\n"
+        << "llvm args " << get_env_variable("HL_LLVM_ARGS") << "\n"
+        << "function " << function_name << "\n"
+        << m;
+
+    // Printing the Module only records the names and shapes of its
+    // buffers, so hash their contents too. Codegen also assumes the
+    // alignment of their host pointers when JIT-compiling.
+    for (const Buffer<> &b : m.buffers()) {
+        const halide_buffer_t *buf = b.raw_buffer();
+        key << "buffer " << b.name() << " alignment " << (((uintptr_t)buf->host) & 4095) << "\n";
+        if (buf->host) {
+            key.write((const char *)buf->begin(), buf->end() - buf->begin());
+        }
+    }
+
+    std::string s = key.str();
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)s.data(), s.size()));
+    return llvm::toHex(hash, /* LowerCase */ true);
+}
+
+std::string jit_code_cache_key(const Module &m, const std::string &function_name) {
+    if (get_jit_code_cache_directory().empty()) {
+        return "";
+    }
+    return jit_code_fingerprint(m, function_name);
+}
+
+bool jit_code_cache_lookup(const std::string &key, JITCodeCacheEntry &entry) {
+    std::string dir = get_jit_code_cache_directory();
+    if (dir.empty() || key.empty()) {
+        return false;
+    }
+    std::string path = cache_path(dir, key);
+
+    if (!llvm::sys::fs::exists(path)) {
+        debug(2) << "JIT code cache: miss for " << key << "\n";
+        cache_misses++;
+        return false;
+    }
+    if (!read_jit_code_file(path, entry)) {
+        cache_misses++;
+        return false;
+    }
+    touch(path);
+    debug(1) << "JIT code cache: hit for " << key << "\n";
+    cache_hits++;
+    return true;
+}
+
+JITCodeCacheStats get_jit_code_cache_stats() {
+    JITCodeCacheStats stats;
+    stats.hits = cache_hits;
+    stats.misses = cache_misses;
+    return stats;
+}
+
+void jit_code_cache_store(const std::string &key, const JITCodeCacheEntry &entry) {
+    CacheConfig &config = cache_config();
+    std::string dir;
+    int64_t max_size;
+    {
+        std::lock_guard<std::mutex> lock(config.mutex);
+        init_config_already_locked(config);
+        dir = config.dir;
+        max_size = config.max_size;
+    }
+    if (dir.empty() || key.empty()) {
+        return;
+    }
+
+    if (std::error_code ec = llvm::sys::fs::create_directories(dir)) {
+        debug(1) << "JIT code cache: can't create " << dir << ": " << ec.message() << "\n";
+        return;
+    }
+
+    // Write to a temporary file and then rename it into place, so that
+    // concurrent readers in other processes never see a partial entry.
+    int fd;
+    llvm::SmallString<128> tmp_path;
+    if (std::error_code ec = llvm::sys::fs::createUniqueFile(dir + "/%%%%%%%%%%%%.tmp", fd, tmp_path)) {
+        debug(1) << "JIT code cache: can't create a file in " << dir << ": " << ec.message() << "\n";
+        return;
+    }
+    {
+        llvm::raw_fd_ostream out(fd, /* shouldClose */ true);
+        if (!write_entry(out, entry)) {
+            (void)llvm::sys::fs::remove(tmp_path);
+            debug(1) << "JIT code cache: failed to write " << tmp_path.str().str() << "\n";
+            return;
+        }
+    }
+    std::string path = cache_path(dir, key);
+    if (llvm::sys::fs::rename(tmp_path, path)) {
+        (void)llvm::sys::fs::remove(tmp_path);
+        return;
+    }
+    debug(1) << "JIT code cache: stored " << path << "\n";
+
+    evict(dir, max_size);
+}
+
+}  // namespace Internal
+}  // namespace Halide
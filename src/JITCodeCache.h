@@ -0,0 +1,114 @@
+#ifndef HALIDE_JIT_CODE_CACHE_H
+#define HALIDE_JIT_CODE_CACHE_H
+
+/** \file
+ * Defines a persistent, on-disk cache of JIT-compiled object code, so
+ * that a process which JIT-compiles the same pipeline as an earlier
+ * process can skip LLVM code generation and optimization. Lowering
+ * still runs, as the key is computed from the lowered IR, so entries
+ * are only reused if the pipeline is constructed the same way each
+ * time (in particular, with the same Func and Var names).
+ */
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Halide {
+
+class Module;
+
+namespace Internal {
+
+/** Set the directory used to store JIT-compiled object code. An empty
+ * string disables the cache. The cache is off by default, unless the
+ * HL_JIT_CACHE_DIR environment variable names a directory. The
+ * directory is created if it does not exist. */
+void set_jit_code_cache_directory(const std::string &dir);
+
+/** Get the directory used to store JIT-compiled object code, or an
+ * empty string if the cache is disabled. */
+std::string get_jit_code_cache_directory();
+
+/** Set the soft limit on the total size in bytes of the files in the
+ * cache directory. When a new entry takes the cache over this limit,
+ * the least recently used entries are deleted. Zero means no limit.
+ * Defaults to the value of the HL_JIT_CACHE_SIZE environment
+ * variable, or 256MB if that is not set. */
+void set_jit_code_cache_max_size(int64_t bytes);
+
+/** What is stored in the cache for a single compiled Module: the
+ * object code, and a bitcode module with no functions that records
+ * the target triple, data layout and Halide module flags needed to
+ * set up a JIT to load it. */
+struct JITCodeCacheEntry {
+    std::string options_bitcode;
+    std::string object;
+};
+
+/** Compute a hash of everything that affects the code produced by
+ * JIT-compiling the given function of a lowered Module: the lowered
+ * IR, the contents of any embedded buffers, the Target, the LLVM
+ * version and the host cpu. */
+std::string jit_code_fingerprint(const Module &m, const std::string &function_name);
+
+/** Compute the cache key for JIT-compiling the given function of a
+ * lowered Module. This is the jit_code_fingerprint, or an empty string
+ * if the cache is disabled. */
+std::string jit_code_cache_key(const Module &m, const std::string &function_name);
+
+/** Look up an entry in the cache. Returns false if it is absent or
+ * can't be read. A successful lookup marks the entry as recently
+ * used. */
+bool jit_code_cache_lookup(const std::string &key, JITCodeCacheEntry &entry);
+
+/** The number of lookups in the cache since the process started that
+ * found an entry, and that didn't (including those that found an entry
+ * that couldn't be read). */
+struct JITCodeCacheStats {
+    int64_t hits = 0;
+    int64_t misses = 0;
+};
+
+/** Get the counts of lookups in the cache. */
+JITCodeCacheStats get_jit_code_cache_stats();
+
+/** Add an entry to the cache, evicting old entries if that takes the
+ * cache over its size limit. Failures to write are not errors; the
+ * entry is just not cached. */
+void jit_code_cache_store(const std::string &key, const JITCodeCacheEntry &entry);
+
+/** Read or write a single entry in the format of the files in the
+ * cache directory. Returns false on failure. */
+// @{
+bool read_jit_code_file(const std::string &path, JITCodeCacheEntry &entry);
+bool write_jit_code_file(const std::string &path, const JITCodeCacheEntry &entry);
+// @}
+
+/** A function that compiles a Module serialized with serialize_module
+ * to a cache entry for the host, possibly on another machine. Returns
+ * false if it fails, in which case the module is compiled locally. */
+using JITRemoteCompiler = std::function<bool(const std::vector<uint8_t> &serialized_module,
+                                             JITCodeCacheEntry &entry)>;
+
+/** Set the function used to compile modules for the JIT when they are
+ * not in the cache, or an empty function to compile them locally. The
+ * default is to compile them locally, unless the HL_JIT_REMOTE_COMPILER
+ * environment variable is set to a command, which is run with the
+ * paths of a serialized module to read and of an entry to write. See
+ * util/HalideJITCompile.cpp for such a command. */
+void set_jit_remote_compiler(const JITRemoteCompiler &compiler);
+
+/** Get the function set by set_jit_remote_compiler. */
+JITRemoteCompiler get_jit_remote_compiler();
+
+/** Compile a Module serialized with serialize_module to a cache entry,
+ * as a remote compiler would. The module must have been compiled for
+ * the machine this runs on. */
+JITCodeCacheEntry compile_serialized_module_for_jit(const std::vector<uint8_t> &serialized_module);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
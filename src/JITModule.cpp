@@ -1,6 +1,7 @@
 #include <cstdint>
 #include <mutex>
 #include <set>
+#include <shared_mutex>
 #include <string>
 
 #ifdef _WIN32
@@ -16,11 +17,13 @@
 #include "CodeGen_Internal.h"
 #include "CodeGen_LLVM.h"
 #include "Debug.h"
+#include "JITCodeCache.h"
 #include "JITModule.h"
 #include "LLVM_Headers.h"
 #include "LLVM_Output.h"
 #include "LLVM_Runtime_Linker.h"
 #include "Pipeline.h"
+#include "Serialization.h"
 #include "WasmExecutor.h"
 
 namespace Halide {
@@ -237,21 +240,70 @@ JITModule::JITModule() {
     jit_module = new JITModuleContents();
 }
 
-JITModule::JITModule(const Module &m, const LoweredFunc &fn,
-                     const std::vector<JITModule> &dependencies) {
-    jit_module = new JITModuleContents();
-    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
-    std::vector<JITModule> deps_with_runtime = dependencies;
-    std::vector<JITModule> shared_runtime = JITSharedRuntime::get(llvm_module.get(), m.target());
-    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
-    compile_module(std::move(llvm_module), fn.name, m.target(), deps_with_runtime);
-    // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
-    llvm::reportAndResetTimings();
+namespace {
+
+// Set the function attributes and target options of a module for the
+// JIT, and make a builder for the target machine to compile it with.
+llvm::orc::JITTargetMachineBuilder jit_target_machine_builder(llvm::Module &m, const Target &target) {
+    llvm::for_each(m, set_function_attributes_from_halide_target_options);
+
+    llvm::TargetOptions options;
+    get_target_options(m, options);
+
+    llvm::orc::JITTargetMachineBuilder tm_builder(llvm::Triple(m.getTargetTriple()));
+    tm_builder.setOptions(options);
+    tm_builder.setCodeGenOptLevel(CodeGenOpt::Aggressive);
+    if (target.arch == Target::Arch::RISCV) {
+        tm_builder.setCodeModel(llvm::CodeModel::Medium);
+    }
+    return tm_builder;
 }
 
-void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
-                               const std::vector<JITModule> &dependencies,
-                               const std::vector<std::string> &requested_exports) {
+// Compile a module ourselves, instead of leaving it to the JIT, so
+// that we can keep a copy of the object code, along with a bitcode
+// module with no functions that records what is needed to load it.
+JITCodeCacheEntry compile_jit_code(llvm::Module &m, llvm::orc::JITTargetMachineBuilder &tm_builder) {
+    auto object_tm = tm_builder.createTargetMachine();
+    internal_assert(object_tm) << llvm::toString(object_tm.takeError()) << "\n";
+    llvm::orc::SimpleCompiler compiler(**object_tm);
+    auto compiled = compiler(m);
+    internal_assert(compiled) << llvm::toString(compiled.takeError()) << "\n";
+
+    JITCodeCacheEntry entry;
+    llvm::Module options_module(m.getModuleIdentifier(), m.getContext());
+    options_module.setTargetTriple(m.getTargetTriple());
+    options_module.setDataLayout(m.getDataLayout());
+    llvm::SmallVector<llvm::Module::ModuleFlagEntry, 8> flags;
+    m.getModuleFlagsMetadata(flags);
+    for (const auto &flag : flags) {
+        options_module.addModuleFlag(flag.Behavior, flag.Key->getString(), flag.Val);
+    }
+    // Keep declarations of the runtime functions the code calls,
+    // so that a cache hit can tell which shared runtimes it needs.
+    for (const auto &f : m) {
+        if (f.isDeclaration() && starts_with(f.getName().str(), "halide_")) {
+            options_module.getOrInsertFunction(f.getName(), f.getFunctionType());
+        }
+    }
+    llvm::raw_string_ostream bitcode(entry.options_bitcode);
+    llvm::WriteBitcodeToFile(options_module, bitcode);
+    bitcode.flush();
+    entry.object = (*compiled)->getBuffer().str();
+    return entry;
+}
+
+// Make the code in a module executable. If object is non-null, it is
+// already-compiled code for the module, and m just supplies the target
+// triple, data layout and module flags. Otherwise m is compiled, and if
+// cache_key is non-empty the resulting object is written to the
+// persistent code cache.
+void compile_module_contents(JITModuleContents &contents,
+                             std::unique_ptr<llvm::Module> m,
+                             std::unique_ptr<llvm::MemoryBuffer> object,
+                             const std::string &cache_key,
+                             const string &function_name, const Target &target,
+                             const std::vector<JITModule> &dependencies,
+                             const std::vector<std::string> &requested_exports) {
 
     // Ensure that LLVM is initialized
     CodeGen_LLVM::initialize_llvm();
@@ -261,22 +313,12 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     debug(2) << "Target triple: " << m->getTargetTriple() << "\n";
     string error_string;
 
-    llvm::for_each(*m, set_function_attributes_from_halide_target_options);
-
-    llvm::TargetOptions options;
-    get_target_options(*m, options);
+    // Build TargetMachine
+    llvm::orc::JITTargetMachineBuilder tm_builder = jit_target_machine_builder(*m, target);
 
     DataLayout initial_module_data_layout = m->getDataLayout();
     string module_name = m->getModuleIdentifier();
 
-    // Build TargetMachine
-    llvm::orc::JITTargetMachineBuilder tm_builder(llvm::Triple(m->getTargetTriple()));
-    tm_builder.setOptions(options);
-    tm_builder.setCodeGenOptLevel(CodeGenOpt::Aggressive);
-    if (target.arch == Target::Arch::RISCV) {
-        tm_builder.setCodeModel(llvm::CodeModel::Medium);
-    }
-
     auto tm = tm_builder.createTargetMachine();
     internal_assert(tm) << llvm::toString(tm.takeError()) << "\n";
 
@@ -330,8 +372,17 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     internal_assert(gen) << llvm::toString(gen.takeError()) << "\n";
     JIT->getMainJITDylib().addGenerator(std::move(gen.get()));
 
-    llvm::orc::ThreadSafeModule tsm(std::move(m), std::move(jit_module->context));
-    auto err = JIT->addIRModule(std::move(tsm));
+    if (!object && !cache_key.empty() && ctors.empty() && dtors.empty()) {
+        // Modules with constructors or destructors aren't cached, as
+        // those are only found by inspecting the IR.
+        JITCodeCacheEntry entry = compile_jit_code(*m, tm_builder);
+        object = llvm::MemoryBuffer::getMemBufferCopy(entry.object, module_name);
+        jit_code_cache_store(cache_key, entry);
+    }
+
+    auto err = object ?
+                   JIT->addObjectFile(std::move(object)) :
+                   JIT->addIRModule(llvm::orc::ThreadSafeModule(std::move(m), std::move(contents.context)));
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Resolve symbol dependencies
@@ -358,10 +409,10 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     debug(1) << "JIT compiling " << module_name
              << " for " << target.to_string() << "\n";
 
-    std::map<std::string, Symbol> exports;
+    std::map<std::string, JITModule::Symbol> exports;
 
-    Symbol entrypoint;
-    Symbol argv_entrypoint;
+    JITModule::Symbol entrypoint;
+    JITModule::Symbol argv_entrypoint;
     if (!function_name.empty()) {
         entrypoint = compile_and_get_function(*JIT, function_name);
         exports[function_name] = entrypoint;
@@ -377,13 +428,134 @@ void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &fu
     internal_assert(!err) << llvm::toString(std::move(err)) << "\n";
 
     // Stash the various objects that need to stay alive behind a reference-counted pointer.
-    jit_module->exports = exports;
-    jit_module->JIT = std::move(JIT);
-    jit_module->dtorRunner = std::move(dtorRunner);
-    jit_module->dependencies = dependencies;
-    jit_module->entrypoint = entrypoint;
-    jit_module->argv_entrypoint = argv_entrypoint;
-    jit_module->name = function_name;
+    contents.exports = exports;
+    contents.JIT = std::move(JIT);
+    contents.dtorRunner = std::move(dtorRunner);
+    contents.dependencies = dependencies;
+    contents.entrypoint = entrypoint;
+    contents.argv_entrypoint = argv_entrypoint;
+    contents.name = function_name;
+}
+
+// Remove the device APIs whose runtimes the module never calls into
+// from the target, so that a pipeline with no work on a device (for
+// example a CPU-only pipeline jitted for host-cuda) neither compiles
+// that device's shared runtime nor loads its driver. The runtime is
+// made when the first pipeline that does use the device is jitted.
+Target target_for_used_runtimes(const llvm::Module &m, Target t) {
+    static const std::pair<Target::Feature, const char *> device_apis[] = {
+        {Target::OpenCL, "halide_opencl_"},
+        {Target::Metal, "halide_metal_"},
+        {Target::CUDA, "halide_cuda_"},
+        {Target::OpenGLCompute, "halide_openglcompute_"},
+        {Target::HVX, "halide_hexagon_"},
+        {Target::D3D12Compute, "halide_d3d12compute_"},
+        {Target::Vulkan, "halide_vulkan_"},
+    };
+    for (const auto &api : device_apis) {
+        if (!t.has_feature(api.first)) {
+            continue;
+        }
+        bool used = false;
+        for (const auto &f : m) {
+            if (f.isDeclaration() && starts_with(f.getName().str(), api.second)) {
+                used = true;
+                break;
+            }
+        }
+        if (!used) {
+            debug(2) << "Not linking the " << api.second << "* runtime, because "
+                     << m.getModuleIdentifier() << " does not use it\n";
+            t.set_feature(api.first, false);
+        }
+    }
+    return t;
+}
+
+// Make the code in a cache entry for function fn of m executable.
+// Returns false if the entry can't be used.
+bool load_jit_code(JITModuleContents &contents, const JITCodeCacheEntry &entry,
+                   const Module &m, const LoweredFunc &fn,
+                   const std::vector<JITModule> &dependencies) {
+    llvm::MemoryBufferRef bitcode(entry.options_bitcode, "jit code cache options");
+    auto options_module = llvm::parseBitcodeFile(bitcode, *contents.context);
+    if (!options_module) {
+        debug(1) << "JIT code cache: ignoring entry with unreadable bitcode: "
+                 << llvm::toString(options_module.takeError()) << "\n";
+        return false;
+    }
+    llvm::Triple expected_triple = get_triple_for_target(m.target());
+    if ((*options_module)->getTargetTriple() != expected_triple.str()) {
+        debug(1) << "JIT code cache: ignoring entry for " << (*options_module)->getTargetTriple()
+                 << ", instead of " << expected_triple.str() << "\n";
+        return false;
+    }
+
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    std::vector<JITModule> shared_runtime =
+        JITSharedRuntime::get(options_module->get(), target_for_used_runtimes(**options_module, m.target()));
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+    auto object = llvm::MemoryBuffer::getMemBufferCopy(entry.object, fn.name);
+    compile_module_contents(contents, std::move(*options_module), std::move(object), "",
+                            fn.name, m.target(), deps_with_runtime, {});
+    return true;
+}
+
+}  // namespace
+
+JITCodeCacheEntry compile_serialized_module_for_jit(const std::vector<uint8_t> &serialized_module) {
+    Module m = deserialize_module(serialized_module);
+
+    CodeGen_LLVM::initialize_llvm();
+    llvm::LLVMContext context;
+    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, context));
+    user_assert(llvm::orc::getConstructors(*llvm_module).empty() &&
+                llvm::orc::getDestructors(*llvm_module).empty())
+        << "Module " << m.name() << " can't be compiled remotely, as it has static constructors or destructors\n";
+
+    llvm::orc::JITTargetMachineBuilder tm_builder = jit_target_machine_builder(*llvm_module, m.target());
+    return compile_jit_code(*llvm_module, tm_builder);
+}
+
+JITModule::JITModule(const Module &m, const LoweredFunc &fn,
+                     const std::vector<JITModule> &dependencies) {
+    jit_module = new JITModuleContents();
+
+    // If there's a persistent code cache, try to skip codegen entirely.
+    std::string cache_key = jit_code_cache_key(m, fn.name);
+    JITCodeCacheEntry entry;
+    if (!cache_key.empty() && jit_code_cache_lookup(cache_key, entry) &&
+        load_jit_code(*jit_module, entry, m, fn, dependencies)) {
+        return;
+    }
+
+    // Otherwise, if there's a remote compiler, try to skip codegen
+    // here. Its results are cached like our own.
+    if (JITRemoteCompiler remote_compiler = get_jit_remote_compiler()) {
+        if (remote_compiler(serialize_module(m), entry) &&
+            load_jit_code(*jit_module, entry, m, fn, dependencies)) {
+            jit_code_cache_store(cache_key, entry);
+            return;
+        }
+        debug(1) << "JIT remote compiler: failed for " << fn.name << ", compiling locally\n";
+    }
+
+    std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(m, *jit_module->context));
+    std::vector<JITModule> deps_with_runtime = dependencies;
+    std::vector<JITModule> shared_runtime =
+        JITSharedRuntime::get(llvm_module.get(), target_for_used_runtimes(*llvm_module, m.target()));
+    deps_with_runtime.insert(deps_with_runtime.end(), shared_runtime.begin(), shared_runtime.end());
+    compile_module_contents(*jit_module, std::move(llvm_module), nullptr, cache_key,
+                            fn.name, m.target(), deps_with_runtime, {});
+    // If -time-passes is in HL_LLVM_ARGS, this will print llvm passes time statstics otherwise its no-op.
+    llvm::reportAndResetTimings();
+}
+
+void JITModule::compile_module(std::unique_ptr<llvm::Module> m, const string &function_name, const Target &target,
+                               const std::vector<JITModule> &dependencies,
+                               const std::vector<std::string> &requested_exports) {
+    compile_module_contents(*jit_module, std::move(m), nullptr, "",
+                            function_name, target, dependencies, requested_exports);
 }
 
 /*static*/
@@ -489,6 +661,14 @@ void JITModule::memoization_cache_set_size(int64_t size) const {
     }
 }
 
+void JITModule::memoization_cache_set_device_size(int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_device_size");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(int64_t)>(f->second.address))(size);
+    }
+}
+
 void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_memoization_cache_evict");
@@ -497,6 +677,23 @@ void JITModule::memoization_cache_evict(uint64_t eviction_key) const {
     }
 }
 
+void JITModule::memoization_cache_stats(halide_memoization_cache_stats_t *stats) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(halide_memoization_cache_stats_t *)>(f->second.address))(stats);
+    }
+}
+
+int JITModule::memoization_cache_set_shared_region(void *region, int64_t size) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_memoization_cache_set_shared_region");
+    if (f != exports().end()) {
+        return (reinterpret_bits<int (*)(void *, void *, int64_t)>(f->second.address))(nullptr, region, size);
+    }
+    return halide_error_code_generic_error;
+}
+
 void JITModule::reuse_device_allocations(bool b) const {
     std::map<std::string, Symbol>::const_iterator f =
         exports().find("halide_reuse_device_allocations");
@@ -505,6 +702,30 @@ void JITModule::reuse_device_allocations(bool b) const {
     }
 }
 
+void JITModule::device_memory_pool_set_limit(int64_t bytes) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_device_memory_pool_set_limit");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(void *, int64_t)>(f->second.address))(nullptr, bytes);
+    }
+}
+
+void JITModule::device_memory_pool_trim() const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_device_memory_pool_trim");
+    if (f != exports().end()) {
+        (reinterpret_bits<int (*)(void *, const halide_device_interface_t *)>(f->second.address))(nullptr, nullptr);
+    }
+}
+
+void JITModule::thread_pool_stats(halide_thread_pool_stats_t *stats) const {
+    std::map<std::string, Symbol>::const_iterator f =
+        exports().find("halide_thread_pool_get_stats");
+    if (f != exports().end()) {
+        (reinterpret_bits<void (*)(void *, halide_thread_pool_stats_t *)>(f->second.address))(nullptr, stats);
+    }
+}
+
 bool JITModule::compiled() const {
     return jit_module->JIT != nullptr;
 }
@@ -515,6 +736,10 @@ JITHandlers runtime_internal_handlers;
 JITHandlers default_handlers;
 JITHandlers active_handlers;
 int64_t default_cache_size;
+int64_t default_device_cache_size;
+void *default_shared_cache_region;
+int64_t default_shared_cache_region_size;
+int64_t default_device_memory_pool_limit = -1;
 
 void merge_handlers(JITHandlers &base, const JITHandlers &addins) {
     if (addins.custom_print) {
@@ -673,15 +898,20 @@ void adjust_module_ref_count(void *arg, int32_t count) {
     }
 }
 
-std::mutex shared_runtimes_mutex;
+// Taken shared to look up the shared runtimes, and exclusively to
+// create, release or configure them, so that concurrent JIT
+// compilations only wait on each other while a runtime module is
+// being created.
+std::shared_mutex shared_runtimes_mutex;
 
 // The Halide runtime is broken up into pieces so that state can be
 // shared across JIT compilations that do not use the same target
 // options. At present, the split is into a MainShared module that
 // contains most of the runtime except for device API specific code
-// (GPU runtimes). There is one shared runtime per device API and a
-// the JITModule for a Func depends on all device API modules
-// specified in the target when it is JITted. (Instruction set variant
+// (GPU runtimes). There is one shared runtime per device API and
+// the JITModule for a Func depends on the device API modules
+// specified in the target that its code calls into, which are created
+// the first time they are needed. (Instruction set variant
 // specific code, such as math routines, is inlined into the module
 // produced by compiling a Func so it can be specialized exactly for
 // each target.)
@@ -693,27 +923,59 @@ enum RuntimeKind {
     OpenGLCompute,
     Hexagon,
     D3D12Compute,
+    Vulkan,
     OpenCLDebug,
     MetalDebug,
     CUDADebug,
     OpenGLComputeDebug,
     HexagonDebug,
     D3D12ComputeDebug,
+    VulkanDebug,
     MaxRuntimeKind
 };
 
 JITModule &shared_runtimes(RuntimeKind k) {
-    // We're already guarded by the shared_runtimes_mutex
-    static JITModule *m = nullptr;
-    if (!m) {
-        // Note that this is never freed. On windows this would invoke
-        // static destructors that use threading objects, and these
-        // don't work (crash or deadlock) after main exits.
-        m = new JITModule[MaxRuntimeKind];
-    }
+    // The entries are guarded by the shared_runtimes_mutex, but it may
+    // only be held shared here, so rely on thread-safe static
+    // initialization to make the array.
+
+    // Note that this is never freed. On windows this would invoke
+    // static destructors that use threading objects, and these
+    // don't work (crash or deadlock) after main exits.
+    static JITModule *m = new JITModule[MaxRuntimeKind];
     return m[k];
 }
 
+// The shared runtimes code for the given target calls into: the main
+// one, followed by any device API ones, each of which only depends
+// on the main one.
+std::vector<RuntimeKind> runtime_kinds_for_target(const Target &target) {
+    const bool debug = target.has_feature(Target::Debug);
+    std::vector<RuntimeKind> kinds = {MainShared};
+    if (target.has_feature(Target::OpenCL)) {
+        kinds.push_back(debug ? OpenCLDebug : OpenCL);
+    }
+    if (target.has_feature(Target::Metal)) {
+        kinds.push_back(debug ? MetalDebug : Metal);
+    }
+    if (target.has_feature(Target::CUDA)) {
+        kinds.push_back(debug ? CUDADebug : CUDA);
+    }
+    if (target.has_feature(Target::OpenGLCompute)) {
+        kinds.push_back(debug ? OpenGLComputeDebug : OpenGLCompute);
+    }
+    if (target.has_feature(Target::HVX)) {
+        kinds.push_back(debug ? HexagonDebug : Hexagon);
+    }
+    if (target.has_feature(Target::D3D12Compute)) {
+        kinds.push_back(debug ? D3D12ComputeDebug : D3D12Compute);
+    }
+    if (target.has_feature(Target::Vulkan)) {
+        kinds.push_back(debug ? VulkanDebug : Vulkan);
+    }
+    return kinds;
+}
+
 JITModule &make_module(llvm::Module *for_module, Target target,
                        RuntimeKind runtime_kind, const std::vector<JITModule> &deps,
                        bool create) {
@@ -734,6 +996,7 @@ JITModule &make_module(llvm::Module *for_module, Target target,
         one_gpu.set_feature(Target::HVX, false);
         one_gpu.set_feature(Target::OpenGLCompute, false);
         one_gpu.set_feature(Target::D3D12Compute, false);
+        one_gpu.set_feature(Target::Vulkan, false);
         string module_name;
         switch (runtime_kind) {
         case OpenCLDebug:
@@ -797,6 +1060,15 @@ JITModule &make_module(llvm::Module *for_module, Target target,
             internal_error << "JIT support for Direct3D 12 is only implemented on Windows 10 and above.\n";
 #endif
             break;
+        case VulkanDebug:
+            one_gpu.set_feature(Target::Debug);
+            one_gpu.set_feature(Target::Vulkan);
+            module_name = "debug_vulkan";
+            break;
+        case Vulkan:
+            one_gpu.set_feature(Target::Vulkan);
+            module_name += "vulkan";
+            break;
         default:
             module_name = "shared runtime";
             break;
@@ -865,6 +1137,19 @@ JITModule &make_module(llvm::Module *for_module, Target target,
                 runtime.memoization_cache_set_size(default_cache_size);
             }
 
+            if (default_device_cache_size != 0) {
+                runtime.memoization_cache_set_device_size(default_device_cache_size);
+            }
+
+            if (default_shared_cache_region != nullptr) {
+                runtime.memoization_cache_set_shared_region(default_shared_cache_region,
+                                                            default_shared_cache_region_size);
+            }
+
+            if (default_device_memory_pool_limit >= 0) {
+                runtime.device_memory_pool_set_limit(default_device_memory_pool_limit);
+            }
+
             runtime.jit_module->name = "MainShared";
         } else {
             runtime.jit_module->name = "GPU";
@@ -937,54 +1222,30 @@ JITModule &make_module(llvm::Module *for_module, Target target,
  * JITSharedRuntime::release_all is called, the global state is reset
  * and any newly compiled Funcs will get a new runtime. */
 std::vector<JITModule> JITSharedRuntime::get(llvm::Module *for_module, const Target &target, bool create) {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
-
-    std::vector<JITModule> result;
-
-    JITModule m = make_module(for_module, target, MainShared, result, create);
-    if (m.compiled()) {
-        result.push_back(m);
-    }
-
-    // Add all requested GPU modules, each only depending on the main shared runtime.
-    std::vector<JITModule> gpu_modules;
-    if (target.has_feature(Target::OpenCL)) {
-        auto kind = target.has_feature(Target::Debug) ? OpenCLDebug : OpenCL;
-        JITModule m = make_module(for_module, target, kind, result, create);
-        if (m.compiled()) {
-            result.push_back(m);
-        }
-    }
-    if (target.has_feature(Target::Metal)) {
-        auto kind = target.has_feature(Target::Debug) ? MetalDebug : Metal;
-        JITModule m = make_module(for_module, target, kind, result, create);
-        if (m.compiled()) {
-            result.push_back(m);
-        }
-    }
-    if (target.has_feature(Target::CUDA)) {
-        auto kind = target.has_feature(Target::Debug) ? CUDADebug : CUDA;
-        JITModule m = make_module(for_module, target, kind, result, create);
-        if (m.compiled()) {
-            result.push_back(m);
-        }
-    }
-    if (target.has_feature(Target::OpenGLCompute)) {
-        auto kind = target.has_feature(Target::Debug) ? OpenGLComputeDebug : OpenGLCompute;
-        JITModule m = make_module(for_module, target, kind, result, create);
-        if (m.compiled()) {
-            result.push_back(m);
+    const std::vector<RuntimeKind> kinds = runtime_kinds_for_target(target);
+
+    // Usually all the runtimes needed exist already, and many threads
+    // can look them up at once.
+    {
+        std::shared_lock<std::shared_mutex> lock(shared_runtimes_mutex);
+        std::vector<JITModule> result;
+        for (RuntimeKind kind : kinds) {
+            const JITModule &m = shared_runtimes(kind);
+            if (m.compiled()) {
+                result.push_back(m);
+            }
         }
-    }
-    if (target.has_feature(Target::HVX)) {
-        auto kind = target.has_feature(Target::Debug) ? HexagonDebug : Hexagon;
-        JITModule m = make_module(for_module, target, kind, result, create);
-        if (m.compiled()) {
-            result.push_back(m);
+        if (result.size() == kinds.size() || !create) {
+            return result;
         }
     }
-    if (target.has_feature(Target::D3D12Compute)) {
-        auto kind = target.has_feature(Target::Debug) ? D3D12ComputeDebug : D3D12Compute;
+
+    // Otherwise create the missing ones. Another thread may have
+    // created them in the meantime, which make_module checks for.
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+
+    std::vector<JITModule> result;
+    for (RuntimeKind kind : kinds) {
         JITModule m = make_module(for_module, target, kind, result, create);
         if (m.compiled()) {
             result.push_back(m);
@@ -1005,7 +1266,7 @@ void JITSharedRuntime::populate_jit_handlers(JITUserContext *jit_user_context, c
 }
 
 void JITSharedRuntime::release_all() {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
 
     for (int i = MaxRuntimeKind; i > 0; i--) {
         shared_runtimes((RuntimeKind)(i - 1)) = JITModule();
@@ -1021,7 +1282,7 @@ JITHandlers JITSharedRuntime::set_default_handlers(const JITHandlers &handlers)
 }
 
 void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
 
     if (size != default_cache_size) {
         default_cache_size = size;
@@ -1029,16 +1290,62 @@ void JITSharedRuntime::memoization_cache_set_size(int64_t size) {
     }
 }
 
+void JITSharedRuntime::memoization_cache_set_device_size(int64_t size) {
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+
+    if (size != default_device_cache_size) {
+        default_device_cache_size = size;
+        shared_runtimes(MainShared).memoization_cache_set_device_size(size);
+    }
+}
+
 void JITSharedRuntime::memoization_cache_evict(uint64_t eviction_key) {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).memoization_cache_evict(eviction_key);
 }
 
+halide_memoization_cache_stats_t JITSharedRuntime::memoization_cache_stats() {
+    halide_memoization_cache_stats_t stats = {};
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).memoization_cache_stats(&stats);
+    return stats;
+}
+
+int JITSharedRuntime::memoization_cache_set_shared_region(void *region, int64_t size) {
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+
+    default_shared_cache_region = region;
+    default_shared_cache_region_size = size;
+    if (shared_runtimes(MainShared).compiled()) {
+        return shared_runtimes(MainShared).memoization_cache_set_shared_region(region, size);
+    }
+    return halide_error_code_success;
+}
+
+halide_thread_pool_stats_t JITSharedRuntime::thread_pool_stats() {
+    halide_thread_pool_stats_t stats = {};
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).thread_pool_stats(&stats);
+    return stats;
+}
+
 void JITSharedRuntime::reuse_device_allocations(bool b) {
-    std::lock_guard<std::mutex> lock(shared_runtimes_mutex);
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
     shared_runtimes(MainShared).reuse_device_allocations(b);
 }
 
+void JITSharedRuntime::device_memory_pool_set_limit(int64_t bytes) {
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+
+    default_device_memory_pool_limit = bytes;
+    shared_runtimes(MainShared).device_memory_pool_set_limit(bytes);
+}
+
+void JITSharedRuntime::device_memory_pool_trim() {
+    std::lock_guard<std::shared_mutex> lock(shared_runtimes_mutex);
+    shared_runtimes(MainShared).device_memory_pool_trim();
+}
+
 JITCache::JITCache(Target jit_target,
                    std::vector<Argument> arguments,
                    std::map<std::string, JITExtern> jit_externs,
@@ -1088,7 +1395,9 @@ int JITCache::call_jit_code(const Target &target, const void *const *args) {
 
 void JITCache::finish_profiling(JITUserContext *context) {
     // If we're profiling, report runtimes and reset profiler stats.
-    if (jit_target.has_feature(Target::Profile) || jit_target.has_feature(Target::ProfileByTimer)) {
+    if (jit_target.has_feature(Target::Profile) ||
+        jit_target.has_feature(Target::ProfileByTimer) ||
+        jit_target.has_feature(Target::ProfileInstrumented)) {
         JITModule::Symbol report_sym = jit_module.find_symbol_by_name("halide_profiler_report");
         JITModule::Symbol reset_sym = jit_module.find_symbol_by_name("halide_profiler_reset");
         if (report_sym.address && reset_sym.address) {
@@ -241,12 +241,30 @@ struct JITModule {
     /** See JITSharedRuntime::memoization_cache_set_size */
     void memoization_cache_set_size(int64_t size) const;
 
+    /** See JITSharedRuntime::memoization_cache_set_device_size */
+    void memoization_cache_set_device_size(int64_t size) const;
+
     /** See JITSharedRuntime::memoization_cache_evict */
     void memoization_cache_evict(uint64_t eviction_key) const;
 
+    /** See JITSharedRuntime::memoization_cache_stats */
+    void memoization_cache_stats(halide_memoization_cache_stats_t *stats) const;
+
+    /** See JITSharedRuntime::memoization_cache_set_shared_region */
+    int memoization_cache_set_shared_region(void *region, int64_t size) const;
+
     /** See JITSharedRuntime::reuse_device_allocations */
     void reuse_device_allocations(bool) const;
 
+    /** See JITSharedRuntime::device_memory_pool_set_limit */
+    void device_memory_pool_set_limit(int64_t bytes) const;
+
+    /** See JITSharedRuntime::device_memory_pool_trim */
+    void device_memory_pool_trim() const;
+
+    /** See JITSharedRuntime::thread_pool_stats */
+    void thread_pool_stats(halide_thread_pool_stats_t *stats) const;
+
     /** Return true if compile_module has been called on this module. */
     bool compiled() const;
 };
@@ -264,6 +282,13 @@ public:
      */
     static void memoization_cache_set_size(int64_t size);
 
+    /** Set the maximum number of bytes of device memory used by
+     * memoization caching. If you are compiling statically, you should
+     * include HalideRuntime.h and call
+     * halide_memoization_cache_set_device_size() instead.
+     */
+    static void memoization_cache_set_device_size(int64_t size);
+
     /** Evict all cache entries that were tagged with the given
      * eviction_key in the memoize scheduling directive. If you are
      * compiling statically, you should include HalideRuntime.h and
@@ -271,6 +296,23 @@ public:
      */
     static void memoization_cache_evict(uint64_t eviction_key);
 
+    /** Get the hit, miss and eviction counters and the current size
+     * of the memoization cache. If you are compiling statically, you
+     * should include HalideRuntime.h and call
+     * halide_memoization_cache_stats() instead.
+     */
+    static halide_memoization_cache_stats_t memoization_cache_stats();
+
+    /** Use a region of memory shared with other processes as a second
+     * level of the memoization cache. If the shared runtime doesn't
+     * exist yet, the region is used once it does. Returns a
+     * halide_error_code_t. If you are compiling statically, you should include
+     * HalideRuntime.h and call
+     * halide_memoization_cache_set_shared_region() instead, which
+     * explains the requirements on the region.
+     */
+    static int memoization_cache_set_shared_region(void *region, int64_t size);
+
     /** Set whether or not Halide may hold onto and reuse device
      * allocations to avoid calling expensive device API allocation
      * functions. If you are compiling statically, you should include
@@ -278,6 +320,27 @@ public:
      * instead. */
     static void reuse_device_allocations(bool);
 
+    /** Set the most bytes of unused device memory that the pool of
+     * each GPU runtime holds on to, or a negative number for no limit. If you are
+     * compiling statically, you should include HalideRuntime.h and
+     * call halide_device_memory_pool_set_limit instead. */
+    static void device_memory_pool_set_limit(int64_t bytes);
+
+    /** Return the unused device memory held by the pools of the GPU
+     * runtimes to the device APIs. If you are compiling statically,
+     * you should include HalideRuntime.h and call
+     * halide_device_memory_pool_trim instead. */
+    static void device_memory_pool_trim();
+
+    /** Get the counters of the thread pool that JIT-compiled pipelines
+     * run on, such as how many tasks it has run, how much it has had
+     * to steal, and how long its threads have spent sleeping. Times
+     * are only measured if the HL_THREAD_POOL_TIMING environment
+     * variable was set when the thread pool was first used. If you are
+     * compiling statically, you should include HalideRuntime.h and call
+     * halide_thread_pool_get_stats() instead. */
+    static halide_thread_pool_stats_t thread_pool_stats();
+
     static void release_all();
 };
 
@@ -32,7 +32,12 @@ class CanLift : public IRVisitor {
     }
 
     void visit(const Load *op) override {
-        result = false;
+        if (written && !written->count(op->name) && is_const_one(op->predicate)) {
+            has_load = true;
+            IRVisitor::visit(op);
+        } else {
+            result = false;
+        }
     }
 
     void visit(const Variable *op) override {
@@ -42,12 +47,89 @@ class CanLift : public IRVisitor {
     }
 
     const Scope<> &varying;
+    const set<string> *written;
 
 public:
     bool result{true};
+    bool has_load{false};
 
-    CanLift(const Scope<> &v)
-        : varying(v) {
+    CanLift(const Scope<> &v, const set<string> *written)
+        : varying(v), written(written) {
+    }
+};
+
+// Find the buffers a loop may write to, or whose host pointers escape
+// into something we can't see into, and whether it does anything that
+// might change other buffers behind our back. Loads of any other
+// buffer give the same value on every iteration of the loop if their
+// index does, because distinct buffers never alias in Halide. (This is
+// what the type-based alias analysis metadata in codegen promises
+// LLVM, and what the check_no_alias target feature checks.)
+class FindWrittenBuffers : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Store *op) override {
+        written.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        written.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Variable *op) override {
+        if (op->type.is_handle()) {
+            written.insert(ends_with(op->name, ".buffer") ?
+                               op->name.substr(0, op->name.size() - 7) :
+                               op->name);
+        }
+    }
+
+    void visit(const Call *op) override {
+        if (!op->is_pure()) {
+            unsafe = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const AssertStmt *op) override {
+        // The assertion may be what keeps the loads after it in bounds.
+        unsafe = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Acquire *op) override {
+        unsafe = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Atomic *op) override {
+        unsafe = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Fork *op) override {
+        unsafe = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        if (!can_lift_loads_out_of(op)) {
+            unsafe = true;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    set<string> written;
+    bool unsafe{false};
+
+    static bool can_lift_loads_out_of(const For *op) {
+        return (op->for_type == ForType::Serial ||
+                op->for_type == ForType::Parallel) &&
+               (op->device_api == DeviceAPI::None ||
+                op->device_api == DeviceAPI::Host);
     }
 };
 
@@ -58,12 +140,25 @@ class LiftLoopInvariants : public IRMutator {
 
     Scope<> varying;
 
+    // Loads are only lifted if they run on every iteration of the loop
+    // being lifted out of, i.e. are outside of any conditionals or
+    // inner loops, so that lifting them can't make a load happen that
+    // wouldn't have otherwise.
+    int loop_depth = 0, conditional_depth = 0;
+
     bool can_lift(const Expr &e) {
-        CanLift check(varying);
+        bool loads = written && loop_depth == 1 && conditional_depth == 0;
+        CanLift check(varying, loads ? written : nullptr);
         e.accept(&check);
         return check.result;
     }
 
+    bool has_load(const Expr &e) {
+        CanLift check(varying, written);
+        e.accept(&check);
+        return check.has_load;
+    }
+
     bool should_lift(const Expr &e) {
         if (!can_lift(e)) {
             return false;
@@ -153,16 +248,44 @@ class LiftLoopInvariants : public IRMutator {
 
     Stmt visit(const For *op) override {
         ScopedBinding<> p(varying, op->name);
+        ScopedValue<int> old_depth(loop_depth, loop_depth + 1);
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Select *op) override {
+        ScopedValue<int> old_depth(conditional_depth, conditional_depth + 1);
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic({Call::if_then_else, Call::require})) {
+            ScopedValue<int> old_depth(conditional_depth, conditional_depth + 1);
+            return IRMutator::visit(op);
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        ScopedValue<int> old_depth(conditional_depth, conditional_depth + 1);
         return IRMutator::visit(op);
     }
 
+    // The buffers that loads lifted out of the loop must not read from,
+    // or null if no loads may be lifted from this loop.
+    const set<string> *written;
+
 public:
     using IRMutator::mutate;
 
+    LiftLoopInvariants(const set<string> *written)
+        : written(written) {
+    }
+
     Expr mutate(const Expr &e) override {
         if (should_lift(e)) {
             // Lift it in canonical form
             Expr lifted_expr = simplify(e);
+            lifted_loads = lifted_loads || has_load(lifted_expr);
             auto it = lifted.find(lifted_expr);
             if (it == lifted.end()) {
                 string name = unique_name('t');
@@ -177,6 +300,7 @@ public:
     }
 
     map<Expr, string, IRDeepCompare> lifted;
+    bool lifted_loads{false};
 };
 
 // The pass above can lift out the value of lets entirely, leaving
@@ -206,6 +330,7 @@ class LICM : public IRMutator {
     using IRMutator::visit;
 
     bool in_gpu_loop{false};
+    bool in_device_code{false};
 
     // Compute the cost of computing an expression inside the inner
     // loop, compared to just loading it as a parameter.
@@ -238,14 +363,26 @@ class LICM : public IRMutator {
         in_gpu_loop =
             (op->for_type == ForType::GPUBlock ||
              op->for_type == ForType::GPUThread);
+        ScopedValue<bool> old_in_device_code(in_device_code);
+        in_device_code = in_device_code || in_gpu_loop ||
+                         (op->device_api != DeviceAPI::None &&
+                          op->device_api != DeviceAPI::Host);
 
         if (old_in_gpu_loop && in_gpu_loop) {
             // Don't lift lets to in-between gpu blocks/threads
             return IRMutator::visit(op);
         } else {
 
-            // Lift invariants
-            LiftLoopInvariants lifter;
+            // Lift invariants, including loads of buffers the loop
+            // doesn't write to, unless the loop or anything in it runs
+            // on a device.
+            FindWrittenBuffers writes;
+            bool lift_loads = !in_device_code && FindWrittenBuffers::can_lift_loads_out_of(op);
+            if (lift_loads) {
+                op->body.accept(&writes);
+                lift_loads = !writes.unsafe;
+            }
+            LiftLoopInvariants lifter(lift_loads ? &writes.written : nullptr);
             Stmt new_stmt = lifter.mutate(op);
             new_stmt = SubstituteTrivialLets().mutate(new_stmt);
 
@@ -334,6 +471,15 @@ class LICM : public IRMutator {
                 lets.pop_back();
             }
 
+            // The loop may run zero times, in which case the lifted
+            // loads must not be made.
+            if (lifter.lifted_loads) {
+                Expr runs = simplify(op->extent > 0);
+                if (!is_const_one(runs)) {
+                    new_stmt = IfThenElse::make(runs, new_stmt);
+                }
+            }
+
             return new_stmt;
         }
     }
@@ -13,7 +13,9 @@ namespace Internal {
 /** Hoist loop-invariants out of inner loops. This is especially
  * important in cases where LLVM would not do it for us
  * automatically. For example, it hoists loop invariants out of cuda
- * kernels. */
+ * kernels. Loads at loop-invariant sites are hoisted too, from host
+ * loops that make them on every iteration and that don't write to
+ * the same buffer, as distinct buffers never alias. */
 Stmt hoist_loop_invariant_values(Stmt);
 
 /** Just hoist loop-invariant if statements as far up as
@@ -422,6 +422,14 @@ void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOSt
     WriteBitcodeToFile(module, out);
 }
 
+void compile_llvm_module_to_thin_lto_bitcode(llvm::Module &module, Internal::LLVMOStream &out) {
+    llvm::ProfileSummaryInfo psi(module);
+    llvm::ModuleSummaryIndex index = llvm::buildModuleSummaryIndex(module, nullptr, &psi);
+    // The module hash lets the linker's ThinLTO cache recognize modules
+    // it has already compiled.
+    WriteBitcodeToFile(module, out, /* ShouldPreserveUseListOrder */ false, &index, /* GenerateHash */ true);
+}
+
 void compile_llvm_module_to_llvm_assembly(llvm::Module &module, Internal::LLVMOStream &out) {
     module.print(out, nullptr);
 }
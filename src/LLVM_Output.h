@@ -45,6 +45,11 @@ void compile_llvm_module_to_llvm_bitcode(llvm::Module &module, Internal::LLVMOSt
 void compile_llvm_module_to_llvm_assembly(llvm::Module &module, Internal::LLVMOStream &out);
 // @}
 
+/** Compile an LLVM module to bitcode carrying a ThinLTO module summary,
+ * so that a ThinLTO link can import and inline across it and the other
+ * modules in the link, such as a shared standalone runtime. */
+void compile_llvm_module_to_thin_lto_bitcode(llvm::Module &module, Internal::LLVMOStream &out);
+
 /**
  * Concatenate the list of src_files into dst_file, using the appropriate
  * static library format for the given target (e.g., .a or .lib).
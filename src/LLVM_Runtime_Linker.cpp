@@ -81,13 +81,19 @@ DECLARE_CPP_INITMOD(allocation_cache)
 DECLARE_CPP_INITMOD(android_clock)
 DECLARE_CPP_INITMOD(android_host_cpu_count)
 DECLARE_CPP_INITMOD(android_io)
+DECLARE_CPP_INITMOD(arena_allocator)
 DECLARE_CPP_INITMOD(cache)
 DECLARE_CPP_INITMOD(can_use_target)
 DECLARE_CPP_INITMOD(cuda)
+DECLARE_CPP_INITMOD(cuda_async_copies)
+DECLARE_CPP_INITMOD(cuda_async_copies_stubs)
 DECLARE_CPP_INITMOD(destructors)
+DECLARE_CPP_INITMOD(device_memory_pool)
 DECLARE_CPP_INITMOD(device_interface)
+DECLARE_CPP_INITMOD(distributed)
 DECLARE_CPP_INITMOD(errors)
 DECLARE_CPP_INITMOD(fake_get_symbol)
+DECLARE_CPP_INITMOD(fake_numa)
 DECLARE_CPP_INITMOD(fake_thread_pool)
 DECLARE_CPP_INITMOD(float16_t)
 DECLARE_CPP_INITMOD(fopen)
@@ -97,14 +103,17 @@ DECLARE_CPP_INITMOD(fuchsia_clock)
 DECLARE_CPP_INITMOD(fuchsia_host_cpu_count)
 DECLARE_CPP_INITMOD(fuchsia_yield)
 DECLARE_CPP_INITMOD(gpu_device_selection)
+DECLARE_CPP_INITMOD(gpu_kernel_cache)
 DECLARE_CPP_INITMOD(halide_buffer_t)
 DECLARE_CPP_INITMOD(hexagon_cache_allocator)
 DECLARE_CPP_INITMOD(hexagon_dma)
 DECLARE_CPP_INITMOD(hexagon_dma_pool)
 DECLARE_CPP_INITMOD(hexagon_host)
+DECLARE_CPP_INITMOD(instrumented_profiler)
 DECLARE_CPP_INITMOD(ios_io)
 DECLARE_CPP_INITMOD(linux_clock)
 DECLARE_CPP_INITMOD(linux_host_cpu_count)
+DECLARE_CPP_INITMOD(linux_numa)
 DECLARE_CPP_INITMOD(linux_yield)
 DECLARE_CPP_INITMOD(module_aot_ref_count)
 DECLARE_CPP_INITMOD(module_jit_ref_count)
@@ -119,6 +128,7 @@ DECLARE_CPP_INITMOD(osx_get_symbol)
 DECLARE_CPP_INITMOD(osx_host_cpu_count)
 DECLARE_CPP_INITMOD(osx_opengl_context)
 DECLARE_CPP_INITMOD(osx_yield)
+DECLARE_CPP_INITMOD(parallel_allocation_cache)
 DECLARE_CPP_INITMOD(posix_allocator)
 DECLARE_CPP_INITMOD(posix_clock)
 DECLARE_CPP_INITMOD(posix_error_handler)
@@ -129,6 +139,7 @@ DECLARE_CPP_INITMOD(posix_threads)
 DECLARE_CPP_INITMOD(posix_threads_tsan)
 DECLARE_CPP_INITMOD(posix_timer_profiler)
 DECLARE_CPP_INITMOD(prefetch)
+DECLARE_CPP_INITMOD(prefetch_tuner)
 DECLARE_CPP_INITMOD(profiler)
 DECLARE_CPP_INITMOD(profiler_inlined)
 DECLARE_CPP_INITMOD(pseudostack)
@@ -143,9 +154,11 @@ DECLARE_CPP_INITMOD(timer_profiler)
 DECLARE_CPP_INITMOD(to_string)
 DECLARE_CPP_INITMOD(trace_helper)
 DECLARE_CPP_INITMOD(tracing)
+DECLARE_CPP_INITMOD(vulkan)
 DECLARE_CPP_INITMOD(windows_clock)
 DECLARE_CPP_INITMOD(windows_cuda)
 DECLARE_CPP_INITMOD(windows_get_symbol)
+DECLARE_CPP_INITMOD(windows_instrumented_profiler)
 DECLARE_CPP_INITMOD(windows_io)
 DECLARE_CPP_INITMOD(windows_opencl)
 DECLARE_CPP_INITMOD(windows_profiler)
@@ -237,6 +250,7 @@ DECLARE_LL_INITMOD(x86_avx2)
 DECLARE_LL_INITMOD(x86_avx)
 DECLARE_LL_INITMOD(x86)
 DECLARE_LL_INITMOD(x86_sse41)
+DECLARE_LL_INITMOD(x86_vnni)
 DECLARE_CPP_INITMOD(x86_cpu_features)
 #else
 DECLARE_NO_INITMOD(x86_amx)
@@ -245,6 +259,7 @@ DECLARE_NO_INITMOD(x86_avx2)
 DECLARE_NO_INITMOD(x86_avx)
 DECLARE_NO_INITMOD(x86)
 DECLARE_NO_INITMOD(x86_sse41)
+DECLARE_NO_INITMOD(x86_vnni)
 DECLARE_NO_INITMOD(x86_cpu_features)
 #endif  // WITH_X86
 
@@ -761,6 +776,7 @@ std::unique_ptr<llvm::Module> link_with_wasm_jit_runtime(llvm::LLVMContext *c, c
     vector<std::unique_ptr<llvm::Module>> modules;
     modules.push_back(std::move(extra_module));
     modules.push_back(get_initmod_fake_thread_pool(c, bits_64, debug));
+    modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
     modules.push_back(get_initmod_posix_allocator(c, bits_64, debug));
     modules.push_back(get_initmod_halide_buffer_t(c, bits_64, debug));
     modules.push_back(get_initmod_destructors(c, bits_64, debug));
@@ -834,6 +850,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -848,6 +865,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));
                 if (t.has_feature(Target::WasmThreads)) {
                     // Assume that the wasm libc will be providing pthreads
@@ -863,6 +881,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_osx_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -882,6 +901,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
                 modules.push_back(get_initmod_android_io(c, bits_64, debug));
                 modules.push_back(get_initmod_android_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_linux_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_linux_yield(c, bits_64, debug));  // TODO: verify
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -896,6 +916,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_windows_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_io(c, bits_64, debug));
                 modules.push_back(get_initmod_windows_yield(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_windows_threads_tsan(c, bits_64, debug));
                 } else {
@@ -909,6 +930,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_posix_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_ios_io(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_osx_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -917,6 +939,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 }
             } else if (t.os == Target::QuRT) {
                 modules.push_back(get_initmod_qurt_allocator(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_qurt_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_qurt_threads_tsan(c, bits_64, debug));
@@ -940,6 +963,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 modules.push_back(get_initmod_fuchsia_clock(c, bits_64, debug));
                 modules.push_back(get_initmod_posix_io(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_host_cpu_count(c, bits_64, debug));
+                modules.push_back(get_initmod_fake_numa(c, bits_64, debug));
                 modules.push_back(get_initmod_fuchsia_yield(c, bits_64, debug));
                 if (tsan) {
                     modules.push_back(get_initmod_posix_threads_tsan(c, bits_64, debug));
@@ -971,6 +995,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
         if (module_type != ModuleJITInlined && module_type != ModuleAOTNoRuntime) {
             // These modules are always used and shared
             modules.push_back(get_initmod_gpu_device_selection(c, bits_64, debug));
+            modules.push_back(get_initmod_gpu_kernel_cache(c, bits_64, debug));
             if (t.arch != Target::Hexagon) {
                 // These modules don't behave correctly on a real
                 // Hexagon device (they do work in the simulator
@@ -1010,7 +1035,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             }
 
             modules.push_back(get_initmod_allocation_cache(c, bits_64, debug));
+            modules.push_back(get_initmod_arena_allocator(c, bits_64, debug));
+            modules.push_back(get_initmod_parallel_allocation_cache(c, bits_64, debug));
+            modules.push_back(get_initmod_prefetch_tuner(c, bits_64, debug));
             modules.push_back(get_initmod_device_interface(c, bits_64, debug));
+            modules.push_back(get_initmod_distributed(c, bits_64, debug));
             modules.push_back(get_initmod_float16_t(c, bits_64, debug));
             modules.push_back(get_initmod_errors(c, bits_64, debug));
 
@@ -1018,11 +1047,19 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.arch != Target::MIPS && t.os != Target::NoOS && t.os != Target::QuRT) {
                 if (t.has_feature(Target::ProfileByTimer)) {
                     user_assert(!t.has_feature(Target::Profile)) << "Can only use one of Target::Profile and Target::ProfileByTimer.";
+                    user_assert(!t.has_feature(Target::ProfileInstrumented)) << "Can only use one of Target::ProfileByTimer and Target::ProfileInstrumented.";
                     // TODO(zvookin): This should work on all Posix like systems, but needs to be tested.
                     user_assert(t.os == Target::Linux) << "The timer based profiler currently can only be used on Linux.";
                     modules.push_back(get_initmod_profiler_inlined(c, bits_64, debug));
                     modules.push_back(get_initmod_timer_profiler(c, bits_64, debug));
                     modules.push_back(get_initmod_posix_timer_profiler(c, bits_64, debug));
+                } else if (t.has_feature(Target::ProfileInstrumented)) {
+                    user_assert(!t.has_feature(Target::Profile)) << "Can only use one of Target::Profile and Target::ProfileInstrumented.";
+                    if (t.os == Target::Windows) {
+                        modules.push_back(get_initmod_windows_instrumented_profiler(c, bits_64, debug));
+                    } else {
+                        modules.push_back(get_initmod_instrumented_profiler(c, bits_64, debug));
+                    }
                 } else {
                     if (t.os == Target::Windows) {
                         modules.push_back(get_initmod_windows_profiler(c, bits_64, debug));
@@ -1075,7 +1112,7 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             if (t.arch == Target::Hexagon) {
                 modules.push_back(get_initmod_qurt_hvx(c, bits_64, debug));
                 modules.push_back(get_initmod_hvx_128_ll(c));
-                if (t.features_any_of({Target::HVX_v65, Target::HVX_v66})) {
+                if (t.features_any_of({Target::HVX_v65, Target::HVX_v66, Target::HVX_v68})) {
                     modules.push_back(get_initmod_qurt_hvx_vtcm(c, bits_64,
                                                                 debug));
                 }
@@ -1083,18 +1120,24 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             } else {
                 modules.push_back(get_initmod_prefetch(c, bits_64, debug));
             }
-            if (t.has_feature(Target::SSE41)) {
+            // Multiversioned loops may be compiled for newer CPUs than
+            // the target, and use the wrappers for their features.
+            const bool multiversion = t.arch == Target::X86 && t.has_feature(Target::MultiversionLoops);
+            if (t.has_feature(Target::SSE41) || multiversion) {
                 modules.push_back(get_initmod_x86_sse41_ll(c));
             }
-            if (t.has_feature(Target::AVX)) {
+            if (t.has_feature(Target::AVX) || multiversion) {
                 modules.push_back(get_initmod_x86_avx_ll(c));
             }
-            if (t.has_feature(Target::AVX2)) {
+            if (t.has_feature(Target::AVX2) || multiversion) {
                 modules.push_back(get_initmod_x86_avx2_ll(c));
             }
-            if (t.has_feature(Target::AVX512)) {
+            if (t.has_feature(Target::AVX512) || multiversion) {
                 modules.push_back(get_initmod_x86_avx512_ll(c));
             }
+            if (t.features_any_of({Target::AVX512_SapphireRapids, Target::AVX512_VNNI, Target::AVXVNNI}) || multiversion) {
+                modules.push_back(get_initmod_x86_vnni_ll(c));
+            }
             if (t.has_feature(Target::AVX512_SapphireRapids)) {
                 modules.push_back(get_initmod_x86_amx_ll(c));
             }
@@ -1160,6 +1203,11 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
             } else {
                 modules.push_back(get_initmod_cuda(c, bits_64, debug));
             }
+            if (t.has_feature(Target::CUDAAsyncCopies)) {
+                modules.push_back(get_initmod_cuda_async_copies(c, bits_64, debug));
+            } else {
+                modules.push_back(get_initmod_cuda_async_copies_stubs(c, bits_64, debug));
+            }
         }
         if (t.has_feature(Target::OpenCL)) {
             if (t.os == Target::Windows) {
@@ -1206,6 +1254,17 @@ std::unique_ptr<llvm::Module> get_initial_module_for_target(Target t, llvm::LLVM
                 user_error << "Direct3D 12 can only be used on ARM or X86 architectures.\n";
             }
         }
+        if (t.has_feature(Target::Vulkan)) {
+            user_assert(bits_64) << "Vulkan target only available on 64-bit targets for now.\n";
+            modules.push_back(get_initmod_vulkan(c, bits_64, debug));
+        }
+        if (t.has_feature(Target::CUDA) ||
+            t.has_feature(Target::OpenCL) ||
+            t.has_feature(Target::Metal) ||
+            t.has_feature(Target::D3D12Compute) ||
+            t.has_feature(Target::Vulkan)) {
+            modules.push_back(get_initmod_device_memory_pool(c, bits_64, debug));
+        }
         if (t.arch != Target::Hexagon && t.has_feature(Target::HVX)) {
             modules.push_back(get_initmod_module_jit_ref_count(c, bits_64, debug));
             modules.push_back(get_initmod_hexagon_host(c, bits_64, debug));
@@ -6,6 +6,7 @@
 #include "IROperator.h"
 #include "Simplify.h"
 #include "Substitute.h"
+#include "Target.h"
 
 #include <algorithm>
 
@@ -193,6 +194,17 @@ class LoopCarryOverLoop : public IRMutator {
 
     int max_carried_values;
 
+    // The width of a vector register. Values wider than this count as
+    // several carried values. Zero if every value counts as one.
+    int register_bits;
+
+    int registers_used(Type t) const {
+        if (register_bits == 0) {
+            return 1;
+        }
+        return std::max(1, (t.bits() * t.lanes() + register_bits - 1) / register_bits);
+    }
+
     using IRMutator::visit;
 
     Stmt visit(const LetStmt *op) override {
@@ -366,15 +378,17 @@ class LoopCarryOverLoop : public IRMutator {
         vector<vector<int>> trimmed;
         size_t sz = 0;
         for (const vector<int> &c : chains) {
-            if (sz + c.size() > (size_t)max_carried_values) {
-                if (sz < (size_t)max_carried_values - 1) {
+            size_t cost = registers_used(loads[c.front()][0]->type);
+            size_t fit = (max_carried_values - sz) / cost;
+            if (c.size() > fit) {
+                if (fit > 1) {
                     // Take a partial chain
-                    trimmed.emplace_back(c.begin(), c.begin() + max_carried_values - sz);
+                    trimmed.emplace_back(c.begin(), c.begin() + fit);
                 }
                 break;
             }
             trimmed.push_back(c);
-            sz += c.size();
+            sz += c.size() * cost;
         }
         chains.swap(trimmed);
 
@@ -493,8 +507,8 @@ class LoopCarryOverLoop : public IRMutator {
     }
 
 public:
-    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values)
-        : in_consume(s), max_carried_values(max_carried_values) {
+    LoopCarryOverLoop(const string &var, const Scope<> &s, int max_carried_values, int register_bits)
+        : in_consume(s), max_carried_values(max_carried_values), register_bits(register_bits) {
         linear.push(var, 1);
     }
 
@@ -512,6 +526,7 @@ class LoopCarry : public IRMutator {
     using IRMutator::visit;
 
     int max_carried_values;
+    int register_bits;
     Scope<> in_consume;
 
     Stmt visit(const ProducerConsumer *op) override {
@@ -528,7 +543,7 @@ class LoopCarry : public IRMutator {
         if (op->for_type == ForType::Serial && !is_const_one(op->extent)) {
             Stmt stmt;
             Stmt body = mutate(op->body);
-            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values);
+            LoopCarryOverLoop carry(op->name, in_consume, max_carried_values, register_bits);
             body = carry.mutate(body);
             if (body.same_as(op->body)) {
                 stmt = op;
@@ -551,17 +566,46 @@ class LoopCarry : public IRMutator {
     }
 
 public:
-    LoopCarry(int max_carried_values)
-        : max_carried_values(max_carried_values) {
+    LoopCarry(int max_carried_values, int register_bits)
+        : max_carried_values(max_carried_values), register_bits(register_bits) {
     }
 };
 
 }  // namespace
 
 Stmt loop_carry(Stmt s, int max_carried_values) {
-    s = LoopCarry(max_carried_values).mutate(s);
+    s = LoopCarry(max_carried_values, 0).mutate(s);
     return s;
 }
 
+Stmt loop_carry(Stmt s, const Target &t) {
+    s = LoopCarry(carried_register_budget(t), t.natural_vector_size(UInt(8)) * 8).mutate(s);
+    return s;
+}
+
+int carried_register_budget(const Target &t) {
+    int registers = 16;
+    switch (t.arch) {
+    case Target::X86:
+        if (t.bits == 32) {
+            registers = 8;
+        } else if (t.has_feature(Target::AVX512)) {
+            registers = 32;
+        }
+        break;
+    case Target::ARM:
+        registers = t.bits == 64 ? 32 : 16;
+        break;
+    case Target::Hexagon:
+    case Target::POWERPC:
+    case Target::RISCV:
+        registers = 32;
+        break;
+    default:
+        break;
+    }
+    return registers / 2;
+}
+
 }  // namespace Internal
 }  // namespace Halide
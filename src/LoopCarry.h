@@ -4,6 +4,9 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Reuse loads done on previous loop iterations by stashing them in
@@ -14,6 +17,16 @@ namespace Internal {
  * for Hexagon. */
 Stmt loop_carry(Stmt, int max_carried_values = 8);
 
+/** Loop carry with a register budget estimated for the given target,
+ * counting carried values wider than a native vector as several
+ * registers. */
+Stmt loop_carry(Stmt, const Target &t);
+
+/** Estimate how many vector registers a loop can use to keep values
+ * live across iterations without forcing spills in the rest of the
+ * loop body: half of the vector registers of the target. */
+int carried_register_budget(const Target &t);
+
 }  // namespace Internal
 }  // namespace Halide
 
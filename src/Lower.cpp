@@ -1,48 +1,64 @@
 #include <algorithm>
 #include <chrono>
+#include <iomanip>
 #include <iostream>
 #include <set>
 #include <sstream>
+#include <unordered_set>
 
 #include "Lower.h"
 
 #include "AddAtomicMutex.h"
 #include "AddImageChecks.h"
 #include "AddParameterChecks.h"
+#include "ArenaAllocations.h"
 #include "AllocationBoundsInference.h"
 #include "AsyncProducers.h"
 #include "BoundSmallAllocations.h"
 #include "Bounds.h"
 #include "BoundsInference.h"
 #include "CSE.h"
+#include "CacheParallelAllocations.h"
 #include "CanonicalizeGPUVars.h"
+#include "ChooseStorageLayouts.h"
 #include "ClampUnsafeAccesses.h"
 #include "CompilerLogger.h"
 #include "Debug.h"
 #include "DebugArguments.h"
 #include "DebugToFile.h"
 #include "Deinterleave.h"
+#include "DistributeLoops.h"
 #include "EarlyFree.h"
+#include "ExtractTensorCoreOperations.h"
 #include "ExtractTileOperations.h"
 #include "FindCalls.h"
 #include "FindIntrinsics.h"
 #include "FlattenNestedRamps.h"
 #include "Func.h"
 #include "Function.h"
+#include "FuseGPUKernels.h"
 #include "FuseGPUThreadLoops.h"
 #include "FuzzFloatStores.h"
+#include "HashCons.h"
 #include "HexagonOffload.h"
+#include "HorizontalFusion.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
 #include "InferArguments.h"
 #include "InjectHostDevBufferCopies.h"
+#include "InjectStorageTypes.h"
 #include "Inline.h"
 #include "LICM.h"
 #include "LoopCarry.h"
+#include "LowerMultiGPULoops.h"
 #include "LowerParallelTasks.h"
+#include "LowerLoopInvariantDivision.h"
+#include "LowerVectorMath.h"
+#include "LowerWarpReductions.h"
 #include "LowerWarpShuffles.h"
 #include "Memoization.h"
+#include "MultiversionLoops.h"
 #include "OffloadGPULoops.h"
 #include "PartitionLoops.h"
 #include "Prefetch.h"
@@ -62,8 +78,10 @@
 #include "SkipStages.h"
 #include "SlidingWindow.h"
 #include "SplitTuples.h"
+#include "StageLookupTables.h"
 #include "StorageFlattening.h"
 #include "StorageFolding.h"
+#include "StoragePlanning.h"
 #include "StrictifyFloat.h"
 #include "Substitute.h"
 #include "Tracing.h"
@@ -85,11 +103,111 @@ using std::vector;
 
 namespace {
 
+// Replace scalar parameters and unpacked buffer fields with known
+// constant values.
+class BindParameterValues : public IRMutator {
+    using IRMutator::visit;
+
+    const std::map<string, Expr> &values;
+
+    Expr visit(const Variable *op) override {
+        auto it = values.find(op->name);
+        return it == values.end() ? op : it->second;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        auto it = values.find(op->name);
+        if (it == values.end()) {
+            return IRMutator::visit(op);
+        }
+        return LetStmt::make(op->name, it->second, mutate(op->body));
+    }
+
+public:
+    BindParameterValues(const std::map<string, Expr> &values)
+        : values(values) {
+    }
+};
+
+// Counts the distinct IR nodes in a Stmt, as a measure of its size.
+class CountIRNodes : public IRGraphVisitor {
+    std::unordered_set<const IRNode *> seen;
+
+protected:
+    using IRGraphVisitor::visit;
+
+    void include(const Expr &e) override {
+        if (seen.insert(e.get()).second) {
+            e.accept(this);
+        }
+    }
+
+    void include(const Stmt &s) override {
+        if (seen.insert(s.get()).second) {
+            s.accept(this);
+        }
+    }
+
+public:
+    int64_t count(const Stmt &s) {
+        if (s.defined()) {
+            include(s);
+        }
+        return (int64_t)seen.size();
+    }
+};
+
 class LoweringLogger {
     Stmt last_written;
 
+    // Per-pass times and IR sizes are only gathered if there's
+    // something to report them to, as counting nodes isn't free.
+    CompilerLogger *compiler_logger = get_compiler_logger();
+    bool print_pass_times = get_env_variable("HL_PROFILE_LOWERING") == "1";
+
+    std::chrono::high_resolution_clock::time_point last_time = std::chrono::high_resolution_clock::now();
+    int64_t last_node_count = 0;
+
+    struct PassTime {
+        string name;
+        double duration;
+        int64_t nodes_before, nodes_after;
+    };
+    vector<PassTime> pass_times;
+
 public:
+    // Record the time since the last pass finished as the time taken
+    // by the named pass, which produced s.
+    void record_pass(const string &name, const Stmt &s) {
+        if (!compiler_logger && !print_pass_times) {
+            return;
+        }
+        auto now = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> duration = now - last_time;
+        int64_t node_count = CountIRNodes().count(s);
+        if (compiler_logger) {
+            compiler_logger->record_lowering_pass(name, duration.count(), last_node_count, node_count);
+        }
+        if (print_pass_times) {
+            pass_times.push_back({name, duration.count(), last_node_count, node_count});
+        }
+        last_node_count = node_count;
+        // Don't charge our own overhead to the next pass.
+        last_time = std::chrono::high_resolution_clock::now();
+    }
+
     void operator()(const string &message, const Stmt &s) {
+        // Messages are of the form "Lowering after <pass name>:"
+        string name = message;
+        const string prefix = "Lowering after ";
+        if (starts_with(name, prefix)) {
+            name = name.substr(prefix.size());
+        }
+        if (ends_with(name, ":")) {
+            name.pop_back();
+        }
+        record_pass(name, s);
+
         if (!s.same_as(last_written)) {
             debug(2) << message << "\n"
                      << s << "\n";
@@ -97,6 +215,27 @@ public:
         } else {
             debug(2) << message << " (unchanged)\n\n";
         }
+        // Printing may be slow, so exclude it from pass times.
+        last_time = std::chrono::high_resolution_clock::now();
+    }
+
+    // If HL_PROFILE_LOWERING is set, print the time taken by each pass.
+    void print(const string &pipeline_name) const {
+        if (!print_pass_times) {
+            return;
+        }
+        double total = 0;
+        for (const PassTime &p : pass_times) {
+            total += p.duration;
+        }
+        std::ostringstream o;
+        o << "Lowering pass times for " << pipeline_name << " (" << total * 1000 << " ms total):\n";
+        for (const PassTime &p : pass_times) {
+            o << "  " << std::setw(10) << std::fixed << std::setprecision(3) << p.duration * 1000 << " ms  "
+              << std::setw(8) << p.nodes_before << " -> " << std::setw(8) << p.nodes_after << " nodes  "
+              << p.name << "\n";
+        }
+        debug(0) << o.str();
     }
 };
 
@@ -108,9 +247,14 @@ void lower_impl(const vector<Function> &output_funcs,
                 const vector<Stmt> &requirements,
                 bool trace_pipeline,
                 const vector<IRMutator *> &custom_passes,
+                const std::map<string, Expr> &param_values,
                 Module &result_module) {
     auto time_start = std::chrono::high_resolution_clock::now();
 
+    // Many passes ask for the bounds of the same Stmts; share the
+    // answers between them.
+    BoxesTouchedCache boxes_touched_cache;
+
     size_t initial_lowered_function_count = result_module.functions().size();
 
     // Create a deep-copy of the entire graph of Funcs.
@@ -129,6 +273,16 @@ void lower_impl(const vector<Function> &output_funcs,
         iter.second.lock_loop_levels();
     }
 
+    if (t.has_feature(Target::FuseOutputs)) {
+        debug(1) << "Fusing sibling outputs...\n";
+        fuse_sibling_outputs(outputs, env);
+    }
+
+    if (t.has_feature(Target::StageLUTs)) {
+        debug(1) << "Staging lookup tables...\n";
+        stage_lookup_tables(env, t);
+    }
+
     // Substitute in wrapper Funcs
     env = wrap_func_calls(env);
 
@@ -140,8 +294,31 @@ void lower_impl(const vector<Function> &output_funcs,
     // specializations' conditions
     simplify_specializations(env);
 
+    // Store intermediates with the dimension that all of their
+    // vectorized accesses walk along innermost.
+    debug(1) << "Choosing storage layouts...\n";
+    choose_storage_layouts(env, outputs);
+
     LoweringLogger log;
 
+    // If HL_HASH_CONS_IR is set, make structurally identical Exprs share
+    // nodes after the passes that duplicate the most IR, so that later
+    // comparisons between them stop at pointer equality.
+    std::unique_ptr<HashConsArena> hash_cons_arena;
+    if (get_env_variable("HL_HASH_CONS_IR") == "1") {
+        hash_cons_arena = std::make_unique<HashConsArena>();
+    }
+    auto hash_cons_if_enabled = [&](const Stmt &s) {
+        if (!hash_cons_arena) {
+            return s;
+        }
+        debug(1) << "Hash-consing IR...\n";
+        Stmt result = hash_cons_arena->hash_cons(s);
+        debug(1) << hash_cons_arena->size() << " distinct Exprs seen so far\n";
+        log("Lowering after hash-consing IR:", result);
+        return result;
+    };
+
     debug(1) << "Creating initial loop nests...\n";
     bool any_memoized = false;
     Stmt s = schedule_functions(outputs, fused_groups, env, t, any_memoized);
@@ -179,6 +356,11 @@ void lower_impl(const vector<Function> &output_funcs,
     debug(1) << "Performing computation bounds inference...\n";
     s = bounds_inference(s, outputs, order, fused_groups, env, func_bounds, t);
     log("Lowering after computation bounds inference:", s);
+    s = hash_cons_if_enabled(s);
+
+    debug(1) << "Distributing loops across ranks...\n";
+    s = distribute_loops(s, env, func_bounds);
+    log("Lowering after distributing loops across ranks:", s);
 
     debug(1) << "Removing extern loops...\n";
     s = remove_extern_loops(s);
@@ -206,6 +388,7 @@ void lower_impl(const vector<Function> &output_funcs,
     debug(1) << "Performing allocation bounds inference...\n";
     s = allocation_bounds_inference(s, env, func_bounds);
     log("Lowering after allocation bounds inference:", s);
+    s = hash_cons_if_enabled(s);
 
     bool will_inject_host_copies =
         (t.has_gpu_feature() ||
@@ -230,7 +413,7 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after injecting debug_to_file calls:", s);
 
     debug(1) << "Injecting prefetches...\n";
-    s = inject_prefetch(s, env);
+    s = inject_prefetch(s, env, outputs);
     log("Lowering after injecting prefetches:", s);
 
     debug(1) << "Discarding safe promises...\n";
@@ -245,6 +428,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = fork_async_producers(s, env);
     log("Lowering after forking asynchronous producers:", s);
 
+    debug(1) << "Injecting storage types...\n";
+    s = inject_storage_types(s, outputs, env);
+    log("Lowering after injecting storage types:", s);
+
     debug(1) << "Destructuring tuple-valued realizations...\n";
     s = split_tuples(s, env);
     log("Lowering after destructuring tuple-valued realizations:", s);
@@ -266,6 +453,7 @@ void lower_impl(const vector<Function> &output_funcs,
     debug(1) << "Performing storage flattening...\n";
     s = storage_flattening(s, outputs, env, t);
     log("Lowering after storage flattening:", s);
+    s = hash_cons_if_enabled(s);
 
     debug(1) << "Adding atomic mutex allocation...\n";
     s = add_atomic_mutex(s, env);
@@ -275,6 +463,12 @@ void lower_impl(const vector<Function> &output_funcs,
     s = unpack_buffers(s);
     log("Lowering after unpacking buffer arguments:", s);
 
+    if (!param_values.empty()) {
+        debug(1) << "Binding parameter values...\n";
+        s = BindParameterValues(param_values).mutate(s);
+        log("Lowering after binding parameter values:", s);
+    }
+
     if (any_memoized) {
         debug(1) << "Rewriting memoized allocations...\n";
         s = rewrite_memoized_allocations(s, env);
@@ -311,9 +505,17 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after simplifying correlated differences:", s);
 
     debug(1) << "Unrolling...\n";
-    s = unroll_loops(s);
+    s = unroll_loops(s, t);
     log("Lowering after unrolling:", s);
 
+    if (t.has_feature(Target::VectorMathFast) ||
+        t.has_feature(Target::VectorMathBalanced) ||
+        t.has_feature(Target::VectorMathPrecise)) {
+        debug(1) << "Lowering math functions to vectorizable polynomials...\n";
+        s = lower_vector_math(s, t);
+        log("Lowering after lowering math functions:", s);
+    }
+
     debug(1) << "Vectorizing...\n";
     s = vectorize_loops(s, env);
     s = simplify(s);
@@ -321,6 +523,10 @@ void lower_impl(const vector<Function> &output_funcs,
 
     if (t.has_gpu_feature() ||
         t.has_feature(Target::OpenGLCompute)) {
+        debug(1) << "Fusing consecutive GPU kernels...\n";
+        s = fuse_gpu_kernels(s);
+        log("Lowering after fusing consecutive GPU kernels:", s);
+
         debug(1) << "Injecting per-block gpu synchronization...\n";
         s = fuse_gpu_thread_loops(s);
         log("Lowering after injecting per-block gpu synchronization:", s);
@@ -332,9 +538,10 @@ void lower_impl(const vector<Function> &output_funcs,
     log("Lowering after rewriting vector interleavings:", s);
 
     debug(1) << "Partitioning loops to simplify boundary conditions...\n";
-    s = partition_loops(s);
+    s = partition_loops(s, t);
     s = simplify(s);
     log("Lowering after partitioning loops:", s);
+    s = hash_cons_if_enabled(s);
 
     debug(1) << "Trimming loops to the region over which they do something...\n";
     s = trim_no_ops(s);
@@ -349,6 +556,10 @@ void lower_impl(const vector<Function> &output_funcs,
     s = hoist_loop_invariant_if_statements(s);
     log("Lowering after hoisting loop invariant if statements:", s);
 
+    debug(1) << "Lowering division by loop invariant values...\n";
+    s = lower_loop_invariant_division(s);
+    log("Lowering after lowering division by loop invariant values:", s);
+
     debug(1) << "Injecting early frees...\n";
     s = inject_early_frees(s);
     log("Lowering after injecting early frees:", s);
@@ -367,18 +578,60 @@ void lower_impl(const vector<Function> &output_funcs,
     s = bound_small_allocations(s);
     log("Lowering after bounding small allocations:", s);
 
-    if (t.has_feature(Target::Profile) || t.has_feature(Target::ProfileByTimer)) {
+    if (have_branch_profile()) {
+        debug(1) << "Applying branch profile...\n";
+        s = apply_branch_profile(s, pipeline_name);
+        log("Lowering after applying branch profile:", s);
+    }
+
+    if (t.has_feature(Target::Profile) ||
+        t.has_feature(Target::ProfileByTimer) ||
+        t.has_feature(Target::ProfileInstrumented)) {
         debug(1) << "Injecting profiling...\n";
-        s = inject_profiling(s, pipeline_name);
+        s = inject_profiling(s, pipeline_name, t);
         log("Lowering after injecting profiling:", s);
     }
 
+    if (t.has_feature(Target::PlanHeapStorage)) {
+        debug(1) << "Planning heap storage...\n";
+        s = plan_heap_storage(s, t);
+        log("Lowering after planning heap storage:", s);
+    }
+
+    if (t.has_feature(Target::CacheParallelAllocations)) {
+        debug(1) << "Caching parallel allocations...\n";
+        s = cache_parallel_allocations(s);
+        log("Lowering after caching parallel allocations:", s);
+    }
+
+    if (t.has_feature(Target::BumpAllocator)) {
+        debug(1) << "Injecting arena allocations...\n";
+        s = inject_arena_allocations(s);
+        log("Lowering after injecting arena allocations:", s);
+    }
+
+    if (t.has_gpu_feature()) {
+        debug(1) << "Reducing atomic updates across warps...\n";
+        s = lower_warp_reductions(s, t);
+        log("Lowering after reducing atomic updates across warps:", s);
+    }
+
     if (t.has_feature(Target::CUDA)) {
         debug(1) << "Injecting warp shuffles...\n";
         s = lower_warp_shuffles(s, t);
         log("Lowering after injecting warp shuffles:", s);
     }
 
+    if (t.has_feature(Target::CUDA)) {
+        debug(1) << "Extracting tensor core operations...\n";
+        s = extract_tensor_core_operations(s, t);
+        log("Lowering after extracting tensor core operations:", s);
+    }
+
+    debug(1) << "Reusing values of enclosing lets...\n";
+    s = global_value_numbering(s);
+    log("Lowering after reusing values of enclosing lets:", s);
+
     debug(1) << "Simplifying...\n";
     s = common_subexpression_elimination(s);
 
@@ -420,6 +673,7 @@ void lower_impl(const vector<Function> &output_funcs,
         for (size_t i = 0; i < custom_passes.size(); i++) {
             debug(1) << "Running custom lowering pass " << i << "...\n";
             s = custom_passes[i]->mutate(s);
+            log.record_pass("custom pass " + std::to_string(i), s);
             debug(1) << "Lowering after custom pass " << i << ":\n"
                      << s << "\n\n";
         }
@@ -428,17 +682,19 @@ void lower_impl(const vector<Function> &output_funcs,
     if (t.arch != Target::Hexagon && t.has_feature(Target::HVX)) {
         debug(1) << "Splitting off Hexagon offload...\n";
         s = inject_hexagon_rpc(s, t, result_module);
-        debug(2) << "Lowering after splitting off Hexagon offload:\n"
-                 << s << "\n";
+        log("Lowering after splitting off Hexagon offload:", s);
     } else {
         debug(1) << "Skipping Hexagon offload...\n";
     }
 
+    debug(1) << "Lowering multi-GPU loops...\n";
+    s = lower_multi_gpu_loops(s);
+    log("Lowering after lowering multi-GPU loops:", s);
+
     if (t.has_gpu_feature()) {
         debug(1) << "Offloading GPU loops...\n";
         s = inject_gpu_offload(s, t);
-        debug(2) << "Lowering after splitting off GPU loops:\n"
-                 << s << "\n\n";
+        log("Lowering after splitting off GPU loops:", s);
     } else {
         debug(1) << "Skipping GPU offload...\n";
     }
@@ -453,6 +709,12 @@ void lower_impl(const vector<Function> &output_funcs,
     vector<InferredArgument> inferred_args = infer_arguments(s, outputs);
 
     std::vector<LoweredFunc> closure_implementations;
+    if (t.arch == Target::X86 && t.has_feature(Target::MultiversionLoops)) {
+        debug(1) << "Multiversioning inner loops...\n";
+        s = multiversion_loops(s, closure_implementations, pipeline_name, t);
+        log("Lowering after multiversioning inner loops:", s);
+    }
+
     debug(1) << "Lowering Parallel Tasks...\n";
     s = lower_parallel_tasks(s, closure_implementations, pipeline_name, t);
     // Process any LoweredFunctions added by other passes. In practice, this
@@ -468,8 +730,8 @@ void lower_impl(const vector<Function> &output_funcs,
     for (auto &lowered_func : closure_implementations) {
         result_module.append(lowered_func);
     }
-    debug(2) << "Lowering after generating parallel tasks and closures:\n"
-             << s << "\n\n";
+    log("Lowering after generating parallel tasks and closures:", s);
+    log.print(pipeline_name);
 
     vector<Argument> public_args = args;
     for (const auto &out : outputs) {
@@ -553,6 +815,14 @@ void lower_impl(const vector<Function> &output_funcs,
 
     result_module.append(main_func);
 
+    if (t.has_feature(Target::UncheckedEntryPoint) && linkage_type != LinkageType::Internal) {
+        // The same pipeline, for repeated calls with arguments already
+        // validated by a call to the main entry point.
+        result_module.append(LoweredFunc(pipeline_name + "_unchecked", public_args,
+                                         strip_argument_checks(main_func.body),
+                                         LinkageType::External));
+    }
+
     auto *logger = get_compiler_logger();
     if (logger) {
         auto time_end = std::chrono::high_resolution_clock::now();
@@ -570,10 +840,11 @@ Module lower(const vector<Function> &output_funcs,
              const LinkageType linkage_type,
              const vector<Stmt> &requirements,
              bool trace_pipeline,
-             const vector<IRMutator *> &custom_passes) {
+             const vector<IRMutator *> &custom_passes,
+             const std::map<string, Expr> &param_values) {
     Module result_module{strip_namespaces(pipeline_name), t};
     run_with_large_stack([&]() {
-        lower_impl(output_funcs, pipeline_name, t, args, linkage_type, requirements, trace_pipeline, custom_passes, result_module);
+        lower_impl(output_funcs, pipeline_name, t, args, linkage_type, requirements, trace_pipeline, custom_passes, param_values, result_module);
     });
     return result_module;
 }
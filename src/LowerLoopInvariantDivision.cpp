@@ -0,0 +1,222 @@
+#include "LowerLoopInvariantDivision.h"
+
+#include <map>
+
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+using std::string;
+using std::vector;
+
+// The values we compute outside the loop for a denominator, as
+// variables. Division of an N-bit unsigned numerator n by d uses the
+// method of Granlund and Montgomery, "Division by Invariant Integers
+// using Multiplication", figure 4.1:
+//
+//   l = ceil(log2(d))
+//   m = floor(2^N * (2^l - d) / d) + 1
+//   t = (n * m) >> N
+//   n / d = (t + ((n - t) >> min(l, 1))) >> max(l - 1, 0)
+//
+// which is exact for all n and all d >= 1. Signed division is done on
+// the magnitudes.
+struct DivisionMagic {
+    // The denominator, or for signed types its magnitude.
+    Expr denominator;
+    Expr multiplier, shift1, shift2;
+    Expr is_zero;
+    // All ones if a signed denominator is negative, and zero otherwise.
+    Expr denominator_sign;
+};
+
+class LowerLoopInvariantDivision : public IRMutator {
+    using IRMutator::visit;
+
+    // The loop we are lifting magic numbers out of, the variables
+    // defined within it, and the lets for the magic numbers made so
+    // far. Empty outside of any loop.
+    string loop_var;
+    Scope<> inner_vars;
+    std::map<Expr, DivisionMagic, IRDeepCompare> magic;
+    vector<std::pair<string, Expr>> lets;
+
+    Expr bind(const string &prefix, const Expr &value) {
+        string name = unique_name(prefix);
+        lets.emplace_back(name, value);
+        return Variable::make(value.type(), name);
+    }
+
+    // Get the scalar denominator if we should lower a division by b.
+    Expr loop_invariant_denominator(const Expr &b) {
+        Type t = b.type();
+        if (loop_var.empty() ||
+            !t.is_vector() ||
+            !(t.is_int() || t.is_uint()) ||
+            (t.bits() != 8 && t.bits() != 16 && t.bits() != 32)) {
+            return Expr();
+        }
+        const Broadcast *broadcast = b.as<Broadcast>();
+        if (!broadcast ||
+            is_const(broadcast->value) ||
+            !is_pure(broadcast->value) ||
+            expr_uses_var(broadcast->value, loop_var) ||
+            expr_uses_vars(broadcast->value, inner_vars)) {
+            return Expr();
+        }
+        return broadcast->value;
+    }
+
+    const DivisionMagic &get_magic(const Expr &d) {
+        auto it = magic.find(d);
+        if (it != magic.end()) {
+            return it->second;
+        }
+
+        Type t = d.type();
+        Type ut = t.with_code(Type::UInt);
+        Type wide = ut.widen();
+        const int bits = t.bits();
+
+        DivisionMagic m;
+        Expr var = bind("div_denominator", d);
+        m.is_zero = bind("div_by_zero", var == make_zero(t));
+        if (t.is_int()) {
+            m.denominator_sign = bind("div_denominator_sign", cast(ut, var >> make_const(UInt(bits), bits - 1)));
+            m.denominator = bind("div_abs_denominator", abs(var));
+        } else {
+            m.denominator = var;
+        }
+
+        // Use a denominator of one in place of zero. The result is
+        // replaced with zero anyway.
+        Expr safe = max(m.denominator, make_one(ut));
+        Expr log2_d = bind("div_log2_denominator", make_const(ut, bits) - count_leading_zeros(safe - make_one(ut)));
+        Expr one = make_one(wide);
+        Expr numerator = (one << bits) * ((one << cast(wide, log2_d)) - cast(wide, safe));
+        m.multiplier = bind("div_multiplier", cast(ut, numerator / cast(wide, safe) + one));
+        m.shift1 = bind("div_shift1", min(log2_d, make_one(ut)));
+        m.shift2 = bind("div_shift2", max(log2_d, make_one(ut)) - make_one(ut));
+
+        return magic.emplace(d, m).first->second;
+    }
+
+    // Unsigned division by the magic numbers, without the check for
+    // zero.
+    Expr unsigned_divide(const Expr &n, const DivisionMagic &m) {
+        const int lanes = n.type().lanes();
+        Expr t = mul_shift_right(n, Broadcast::make(m.multiplier, lanes), n.type().bits());
+        Expr sum = t + ((n - t) >> Broadcast::make(m.shift1, lanes));
+        return sum >> Broadcast::make(m.shift2, lanes);
+    }
+
+    template<typename T>
+    Expr visit_div_or_mod(const T *op, bool is_div) {
+        Expr d = loop_invariant_denominator(op->b);
+        if (!d.defined()) {
+            return IRMutator::visit(op);
+        }
+        const DivisionMagic &m = get_magic(d);
+
+        Expr a = mutate(op->a);
+        Type t = op->type;
+        Type ut = t.with_code(Type::UInt);
+        const int lanes = t.lanes();
+        Expr result;
+        string n_name = unique_name('t');
+        Expr n = Variable::make(t, n_name);
+        if (t.is_uint()) {
+            Expr q = unsigned_divide(n, m);
+            result = is_div ? q : n - q * Broadcast::make(m.denominator, lanes);
+        } else {
+            // Round towards negative infinity by flipping the bits of
+            // negative numerators, as in lower_int_uint_div. A
+            // negative denominator negates the quotient, and doesn't
+            // change the Euclidean remainder.
+            Expr sign = cast(ut, n >> make_const(UInt(t.bits()), t.bits() - 1));
+            Expr q = unsigned_divide(cast(ut, n) ^ sign, m) ^ sign;
+            if (is_div) {
+                Expr d_sign = Broadcast::make(m.denominator_sign, lanes);
+                result = cast(t, (q ^ d_sign) - d_sign);
+            } else {
+                result = cast(t, cast(ut, n) - q * Broadcast::make(m.denominator, lanes));
+            }
+        }
+        result = select(Broadcast::make(m.is_zero, lanes), make_zero(t), result);
+        return Let::make(n_name, a, result);
+    }
+
+    Expr visit(const Div *op) override {
+        return visit_div_or_mod(op, true);
+    }
+
+    Expr visit(const Mod *op) override {
+        return visit_div_or_mod(op, false);
+    }
+
+    Expr visit(const Let *op) override {
+        Expr value = mutate(op->value);
+        ScopedBinding<> bind(inner_vars, op->name);
+        Expr body = mutate(op->body);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return Let::make(op->name, value, body);
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        Expr value = mutate(op->value);
+        ScopedBinding<> bind(inner_vars, op->name);
+        Stmt body = mutate(op->body);
+        if (value.same_as(op->value) && body.same_as(op->body)) {
+            return op;
+        }
+        return LetStmt::make(op->name, value, body);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host &&
+            op->device_api != DeviceAPI::Hexagon) {
+            // GPUs have their own integer division.
+            return op;
+        }
+
+        // Each loop gets its own magic numbers, placed just outside
+        // it. Those that are also invariant over an enclosing loop are
+        // lifted further by loop invariant code motion later.
+        return LowerLoopInvariantDivision().mutate_loop(op);
+    }
+
+public:
+    // Lower the divisions in the body of a loop, and wrap the loop in
+    // the lets for the magic numbers.
+    Stmt mutate_loop(const For *op) {
+        loop_var = op->name;
+        Stmt body = mutate(op->body);
+        Stmt result = op;
+        if (!body.same_as(op->body)) {
+            result = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        }
+        for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+            result = LetStmt::make(it->first, it->second, result);
+        }
+        return result;
+    }
+};
+
+}  // namespace
+
+Stmt lower_loop_invariant_division(const Stmt &s) {
+    return LowerLoopInvariantDivision().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
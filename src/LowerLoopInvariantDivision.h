@@ -0,0 +1,26 @@
+#ifndef HALIDE_LOWER_LOOP_INVARIANT_DIVISION_H
+#define HALIDE_LOWER_LOOP_INVARIANT_DIVISION_H
+
+/** \file
+ * Defines the lowering pass that turns vector division by a loop
+ * invariant runtime value into multiplies and shifts.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace vector integer divisions and mods by a non-constant
+ * denominator that doesn't change within the enclosing loop with a
+ * multiply-keep-high-half and shifts. The multiplier and shifts for
+ * the denominator are computed once, just outside the innermost loop
+ * over which the denominator is invariant. Most targets have no
+ * vector integer division, so these would otherwise be
+ * scalarized. Division by constants is handled in codegen. */
+Stmt lower_loop_invariant_division(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,112 @@
+#include "LowerMultiGPULoops.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::string;
+
+namespace {
+
+// Finds the buffers accessed by GPU kernels that are not allocated
+// inside the statement visited. Each iteration of a multi-GPU loop
+// allocates its buffers on its own device, but a buffer allocated
+// outside the loop is shared by all of them, and a buffer can only
+// live on one device at a time.
+class FindOuterDeviceBuffers : public IRVisitor {
+    using IRVisitor::visit;
+
+    Scope<> allocated;
+    bool in_kernel = false;
+
+    void visit(const For *op) override {
+        bool is_kernel = (op->device_api != DeviceAPI::None &&
+                          op->device_api != DeviceAPI::Host);
+        ScopedValue<bool> old_in_kernel(in_kernel, in_kernel || is_kernel);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        ScopedBinding<> bind(allocated, op->name);
+        IRVisitor::visit(op);
+    }
+
+    void found(const string &name) {
+        if (in_kernel && !allocated.contains(name) && buffer.empty()) {
+            buffer = name;
+        }
+    }
+
+    void visit(const Load *op) override {
+        found(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        found(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    string buffer;
+};
+
+class LowerMultiGPULoops : public IRMutator {
+    using IRMutator::visit;
+
+    // The innermost enclosing multi-GPU loop, if any.
+    string enclosing_loop;
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::MultiGPU) {
+            return IRMutator::visit(op);
+        }
+
+        user_assert(enclosing_loop.empty())
+            << "The multi-GPU loop " << op->name
+            << " can't be inside the multi-GPU loop " << enclosing_loop << ".\n";
+        user_assert(op->device_api == DeviceAPI::None ||
+                    op->device_api == DeviceAPI::Host)
+            << "The multi-GPU loop " << op->name
+            << " must run on the host, not on " << op->device_api << ".\n";
+
+        FindOuterDeviceBuffers outer;
+        op->body.accept(&outer);
+        user_assert(outer.buffer.empty())
+            << "A GPU kernel inside the multi-GPU loop " << op->name
+            << " accesses " << outer.buffer
+            << ", which is not allocated inside the loop. Stage the part of it"
+            << " the kernel needs through a Func computed on the host inside"
+            << " the loop, e.g. with Func::in().\n";
+
+        Stmt body;
+        {
+            ScopedValue<string> old_loop(enclosing_loop, op->name);
+            body = mutate(op->body);
+        }
+
+        // The device API calls in the body pass the user_context
+        // implicitly, so rebinding it makes them use the iteration's
+        // device. So does the call to halide_gpu_device_user_context
+        // itself, which gets the outer one.
+        Expr index = Variable::make(Int(32), op->name) - op->min;
+        Expr user_context = Call::make(type_of<void *>(), "halide_gpu_device_user_context",
+                                       {index}, Call::Extern);
+        body = LetStmt::make("__user_context", user_context, body);
+        return For::make(op->name, op->min, op->extent, ForType::Parallel,
+                         op->device_api, body);
+    }
+};
+
+}  // namespace
+
+Stmt lower_multi_gpu_loops(const Stmt &s) {
+    return LowerMultiGPULoops().mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,25 @@
+#ifndef HALIDE_LOWER_MULTI_GPU_LOOPS_H
+#define HALIDE_LOWER_MULTI_GPU_LOOPS_H
+
+/** \file
+ * Defines the lowering pass that runs the iterations of multi-GPU
+ * loops on different GPU devices.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+namespace Internal {
+
+/** Replace each multi-GPU loop with a parallel loop whose body rebinds
+ * the user_context to the one returned by
+ * halide_gpu_device_user_context for the iteration, so that the device
+ * API calls made in it use that iteration's device. Must be run after
+ * the last simplification, which would remove the rebinding as
+ * unused, and before GPU offload and the lowering of parallel tasks. */
+Stmt lower_multi_gpu_loops(const Stmt &s);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
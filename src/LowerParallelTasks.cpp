@@ -229,11 +229,15 @@ struct LowerParallelTasks : public IRMutator {
             // Decide if we're going to call do_par_for or
             // do_parallel_tasks. halide_do_par_for is simpler, but
             // assumes a bunch of things. Programs that don't use async
-            // can also enter the task system via do_par_for.
+            // can also enter the task system via do_par_for. With
+            // parallel_loop_ranges, even simple loops use
+            // do_parallel_tasks, so that their body takes a range of
+            // iterations and the thread pool can hand out chunks.
             const bool use_parallel_for = (num_tasks == 1 &&
                                            min_threads == 0 &&
                                            t.semaphores.empty() &&
-                                           !has_task_parent);
+                                           !has_task_parent &&
+                                           !target.has_feature(Target::ParallelLoopRanges));
 
             Expr closure_task_parent;
 
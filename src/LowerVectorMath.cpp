@@ -0,0 +1,78 @@
+#include "LowerVectorMath.h"
+
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+class LowerVectorMath : public IRMutator {
+    using IRMutator::visit;
+
+    ApproximationPrecision precision;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Device code has its own math library.
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::PureExtern ||
+            op->type != Float(32) ||
+            op->args.size() != 1) {
+            return IRMutator::visit(op);
+        }
+
+        Expr (*approximation)(const Expr &, ApproximationPrecision) = nullptr;
+        if (op->name == "sin_f32") {
+            approximation = fast_sin;
+        } else if (op->name == "cos_f32") {
+            approximation = fast_cos;
+        } else if (op->name == "tanh_f32") {
+            approximation = fast_tanh;
+        } else if (op->name == "exp_f32") {
+            approximation = fast_exp;
+        } else if (op->name == "log_f32") {
+            approximation = fast_log;
+        } else {
+            return IRMutator::visit(op);
+        }
+
+        // The approximations use their argument several times.
+        Expr arg = mutate(op->args[0]);
+        std::string name = unique_name('t');
+        Expr var = Variable::make(arg.type(), name);
+        return Let::make(name, arg, approximation(var, precision));
+    }
+
+public:
+    LowerVectorMath(ApproximationPrecision precision)
+        : precision(precision) {
+    }
+};
+
+}  // namespace
+
+Stmt lower_vector_math(const Stmt &s, const Target &t) {
+    ApproximationPrecision precision;
+    if (t.has_feature(Target::VectorMathPrecise)) {
+        precision = ApproximationPrecision::Precise;
+    } else if (t.has_feature(Target::VectorMathBalanced)) {
+        precision = ApproximationPrecision::Balanced;
+    } else if (t.has_feature(Target::VectorMathFast)) {
+        precision = ApproximationPrecision::Fast;
+    } else {
+        return s;
+    }
+    return LowerVectorMath(precision).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,28 @@
+#ifndef HALIDE_LOWER_VECTOR_MATH_H
+#define HALIDE_LOWER_VECTOR_MATH_H
+
+/** \file
+ * Defines the lowering pass that replaces calls to libm transcendentals
+ * with Halide's vectorizable polynomial approximations.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Replace the Float(32) sin, cos, tanh, exp and log calls outside of
+ * device code with the fast_ approximation at the precision given by
+ * the target's vector_math_fast, vector_math_balanced or
+ * vector_math_precise feature. If several are set, the most precise
+ * wins. Must run before vectorization, so that the polynomials are
+ * vectorized along with the rest of the loop body. */
+Stmt lower_vector_math(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -0,0 +1,394 @@
+#include "LowerWarpReductions.h"
+
+#include "ExprUsesVar.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Scope.h"
+#include "Target.h"
+#include "Util.h"
+
+#include <utility>
+
+// An associative update that every thread of a block of a GPU kernel
+// makes atomically to the same location, e.g. a reduction over an RVar
+// scheduled with atomic().gpu_threads(), serializes all of the threads
+// on that location. Instead we combine the values within each warp (or
+// OpenCL subgroup, or Metal SIMD-group) first, and have one thread per
+// warp do the atomic update.
+//
+// This runs after the thread loops are fused, so the kernel body below
+// the innermost loop over threads is executed by all of the threads of
+// the block. The warp-level operations are only correct if every
+// thread in the warp executes them, so we only rewrite updates at
+// points in the kernel that all threads reach: anything not inside a
+// conditional or a loop that depends on the thread index. The updates
+// themselves may be guarded by such conditionals (e.g. the ones
+// FuseGPUThreadLoops adds for loops smaller than the block), in which
+// case the threads that wouldn't have done the update contribute the
+// identity of the operator instead.
+
+namespace Halide {
+namespace Internal {
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace {
+
+class LoadsFrom : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &name;
+
+    void visit(const Load *op) override {
+        result = result || op->name == name;
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool result = false;
+
+    LoadsFrom(const string &name)
+        : name(name) {
+    }
+};
+
+bool loads_from(const Expr &e, const string &name) {
+    LoadsFrom l(name);
+    e.accept(&l);
+    return l.result;
+}
+
+Expr identity(VectorReduce::Operator op, Type t) {
+    switch (op) {
+    case VectorReduce::Add:
+        return make_zero(t);
+    case VectorReduce::Mul:
+        return make_one(t);
+    case VectorReduce::Min:
+        return t.max();
+    case VectorReduce::Max:
+        return t.min();
+    default:
+        internal_error << "Not a warp reduction operator: " << op << "\n";
+        return Expr();
+    }
+}
+
+Expr combine(VectorReduce::Operator op, const Expr &a, const Expr &b) {
+    switch (op) {
+    case VectorReduce::Add:
+        return a + b;
+    case VectorReduce::Mul:
+        return a * b;
+    case VectorReduce::Min:
+        return min(a, b);
+    case VectorReduce::Max:
+        return max(a, b);
+    default:
+        internal_error << "Not a warp reduction operator: " << op << "\n";
+        return Expr();
+    }
+}
+
+class InjectWarpReductions : public IRMutator {
+    using IRMutator::visit;
+
+    const DeviceAPI device_api;
+    const int cuda_cap;
+
+    // The index of this thread within its warp. Only used on CUDA.
+    const Expr lane;
+
+    // Variables that may differ between the threads of a block.
+    Scope<> varying;
+
+    bool is_varying(const Expr &e) const {
+        return expr_uses_vars(e, varying);
+    }
+
+    bool supported(VectorReduce::Operator op, Type t) const {
+        // Atomic updates of 32-bit types are supported on all
+        // backends, and so are warp shuffles and reductions.
+        if (!t.is_scalar() || t.bits() != 32) {
+            return false;
+        }
+        // OpenCL has no sub_group_reduce_mul.
+        return device_api != DeviceAPI::OpenCL || op != VectorReduce::Mul;
+    }
+
+    // Match an update of the form store[index] = op(store[index], rest).
+    bool match_update(const Store *store, VectorReduce::Operator &op, Expr &rest) const {
+        auto is_update_load = [&](const Expr &e) {
+            const Load *load = e.as<Load>();
+            return (load && load->name == store->name &&
+                    is_const_one(load->predicate) &&
+                    equal(load->index, store->index));
+        };
+        Expr a, b;
+        if (const Add *add = store->value.as<Add>()) {
+            op = VectorReduce::Add;
+            a = add->a;
+            b = add->b;
+        } else if (const Mul *mul = store->value.as<Mul>()) {
+            op = VectorReduce::Mul;
+            a = mul->a;
+            b = mul->b;
+        } else if (const Min *mn = store->value.as<Min>()) {
+            op = VectorReduce::Min;
+            a = mn->a;
+            b = mn->b;
+        } else if (const Max *mx = store->value.as<Max>()) {
+            op = VectorReduce::Max;
+            a = mx->a;
+            b = mx->b;
+        } else {
+            return false;
+        }
+        if (is_update_load(a)) {
+            rest = b;
+        } else if (is_update_load(b)) {
+            rest = a;
+        } else {
+            return false;
+        }
+        return !loads_from(rest, store->name);
+    }
+
+    // The value a thread contributes to the reduction: the rhs of
+    // the update if the thread reaches it, and the identity
+    // otherwise.
+    Expr contribution(const Stmt &s, const Expr &rest, const Expr &id) {
+        if (const LetStmt *let = s.as<LetStmt>()) {
+            return Let::make(let->name, let->value, contribution(let->body, rest, id));
+        } else if (const IfThenElse *if_stmt = s.as<IfThenElse>()) {
+            return Call::make(id.type(), Call::if_then_else,
+                              {if_stmt->condition, contribution(if_stmt->then_case, rest, id), id},
+                              Call::PureIntrinsic);
+        } else {
+            return rest;
+        }
+    }
+
+    Expr reduce_across_warp(VectorReduce::Operator op, const Expr &value, vector<pair<string, Expr>> &lets) {
+        Type t = value.type();
+        string name = unique_name('t');
+        lets.emplace_back(name, value);
+        if (device_api == DeviceAPI::CUDA) {
+            // A butterfly, which leaves the result in every lane.
+            string sync_suffix = cuda_cap >= 70 ? ".sync" : "";
+            string intrin = "llvm.nvvm.shfl" + sync_suffix + ".bfly" + (t.is_float() ? ".f32" : ".i32");
+            for (int offset = 16; offset > 0; offset /= 2) {
+                Expr v = Variable::make(t, name);
+                vector<Expr> args = {v, offset, 31};
+                if (cuda_cap >= 70) {
+                    args.insert(args.begin(), (int)0xffffffff);
+                }
+                Expr other = Call::make(t, intrin, args, Call::Extern);
+                name = unique_name('t');
+                lets.emplace_back(name, combine(op, v, other));
+            }
+            return Variable::make(t, name);
+        }
+
+        string fn;
+        if (device_api == DeviceAPI::OpenCL) {
+            fn = op == VectorReduce::Add ? "sub_group_reduce_add" :
+                 op == VectorReduce::Min ? "sub_group_reduce_min" :
+                                           "sub_group_reduce_max";
+        } else {
+            internal_assert(device_api == DeviceAPI::Metal);
+            fn = op == VectorReduce::Add ? "simd_sum" :
+                 op == VectorReduce::Mul ? "simd_product" :
+                 op == VectorReduce::Min ? "simd_min" :
+                                           "simd_max";
+        }
+        // These are not pure, so that they don't get lifted out of
+        // the kernel when the value is uniform.
+        return Call::make(t, fn, {Variable::make(t, name)}, Call::Extern);
+    }
+
+    Expr is_warp_leader() const {
+        if (device_api == DeviceAPI::CUDA) {
+            return lane == 0;
+        } else if (device_api == DeviceAPI::OpenCL) {
+            return Call::make(UInt(32), "get_sub_group_local_id", {}, Call::Extern) == make_zero(UInt(32));
+        } else {
+            return Call::make(Bool(), "simd_is_first", {}, Call::Extern);
+        }
+    }
+
+    // Try to rewrite an atomic update, possibly under some lets and
+    // conditions, reached by every thread in the block.
+    Stmt reduce_update(const Stmt &s) {
+        Stmt leaf = s;
+        Scope<> bound_in_update;
+        while (true) {
+            if (const LetStmt *let = leaf.as<LetStmt>()) {
+                bound_in_update.push(let->name);
+                leaf = let->body;
+            } else if (leaf.as<IfThenElse>() && !leaf.as<IfThenElse>()->else_case.defined()) {
+                leaf = leaf.as<IfThenElse>()->then_case;
+            } else {
+                break;
+            }
+        }
+
+        const Atomic *atomic = leaf.as<Atomic>();
+        if (!atomic || !atomic->mutex_name.empty()) {
+            return s;
+        }
+        const Store *store = atomic->body.as<Store>();
+        VectorReduce::Operator op = VectorReduce::Add;
+        Expr rest;
+        if (!store ||
+            !is_const_one(store->predicate) ||
+            !match_update(store, op, rest) ||
+            !supported(op, store->value.type())) {
+            return s;
+        }
+
+        // All the threads must be updating the same location, and we
+        // must be able to compute it outside of the conditions.
+        if (is_varying(store->index) || expr_uses_vars(store->index, bound_in_update)) {
+            return s;
+        }
+
+        debug(3) << "Reducing atomic update of " << store->name << " across warps\n";
+
+        Type t = store->value.type();
+        vector<pair<string, Expr>> lets;
+        Expr value = contribution(s, rest, identity(op, t));
+        Expr reduced = reduce_across_warp(op, value, lets);
+        Expr old_value = Load::make(t, store->name, store->index, Buffer<>(),
+                                    store->param, store->predicate, store->alignment);
+        Stmt update = Store::make(store->name, combine(op, old_value, reduced), store->index,
+                                  store->param, store->predicate, store->alignment);
+        update = Atomic::make(atomic->producer_name, atomic->mutex_name, update);
+        Stmt result = IfThenElse::make(is_warp_leader(), update);
+        while (!lets.empty()) {
+            result = LetStmt::make(lets.back().first, lets.back().second, result);
+            lets.pop_back();
+        }
+        return result;
+    }
+
+    Stmt visit(const LetStmt *op) override {
+        ScopedBinding<> bind(is_varying(op->value), varying, op->name);
+        Stmt body = mutate(op->body);
+        if (body.same_as(op->body)) {
+            return op;
+        } else {
+            return LetStmt::make(op->name, op->value, body);
+        }
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type == ForType::Serial &&
+            !is_varying(op->min) && !is_varying(op->extent)) {
+            return IRMutator::visit(op);
+        } else {
+            return op;
+        }
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        if (!is_varying(op->condition)) {
+            return IRMutator::visit(op);
+        } else {
+            return reduce_update(op);
+        }
+    }
+
+    Stmt visit(const Atomic *op) override {
+        return reduce_update(op);
+    }
+
+public:
+    InjectWarpReductions(DeviceAPI device_api, int cuda_cap, Expr lane,
+                         const vector<pair<string, Expr>> &thread_loops)
+        : device_api(device_api), cuda_cap(cuda_cap), lane(std::move(lane)) {
+        for (const auto &l : thread_loops) {
+            varying.push(l.first);
+        }
+    }
+};
+
+class LowerWarpReductionsInKernels : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    // The names and extents of the enclosing loops over threads,
+    // outermost first.
+    vector<pair<string, Expr>> thread_loops;
+
+    bool supported(DeviceAPI device_api) const {
+        return ((device_api == DeviceAPI::CUDA) ||
+                (device_api == DeviceAPI::OpenCL && target.has_feature(Target::CLSubgroups)) ||
+                (device_api == DeviceAPI::Metal && target.has_feature(Target::MetalSIMDGroups)));
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->for_type != ForType::GPUThread) {
+            return IRMutator::visit(op);
+        }
+
+        thread_loops.emplace_back(op->name, op->extent);
+        Stmt result;
+        if (!ends_with(op->name, ".__thread_id_x")) {
+            result = IRMutator::visit(op);
+        } else if (supported(op->device_api)) {
+            // This is the innermost loop over threads.
+            Expr lane;
+            if (op->device_api == DeviceAPI::CUDA) {
+                // Warp shuffles need every lane of the warp, so the
+                // number of threads in the block must be a multiple
+                // of the warp size.
+                Expr linear_id = 0;
+                int64_t threads = 1;
+                for (const auto &l : thread_loops) {
+                    const int64_t *extent = as_const_int(l.second);
+                    if (!extent) {
+                        threads = 0;
+                        break;
+                    }
+                    linear_id = linear_id * l.second + Variable::make(Int(32), l.first);
+                    threads *= *extent;
+                }
+                if (threads > 0 && threads % 32 == 0) {
+                    lane = linear_id % 32;
+                }
+            }
+            if (op->device_api != DeviceAPI::CUDA || lane.defined()) {
+                InjectWarpReductions inject(op->device_api, target.get_cuda_capability_lower_bound(),
+                                            lane, thread_loops);
+                Stmt body = inject.mutate(op->body);
+                result = For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+            } else {
+                result = op;
+            }
+        } else {
+            result = op;
+        }
+        thread_loops.pop_back();
+        return result;
+    }
+
+public:
+    LowerWarpReductionsInKernels(const Target &target)
+        : target(target) {
+    }
+};
+
+}  // namespace
+
+Stmt lower_warp_reductions(const Stmt &s, const Target &t) {
+    return LowerWarpReductionsInKernels(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
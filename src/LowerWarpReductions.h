@@ -0,0 +1,31 @@
+#ifndef HALIDE_LOWER_WARP_REDUCTIONS_H
+#define HALIDE_LOWER_WARP_REDUCTIONS_H
+
+/** \file
+ * Defines the lowering pass that combines atomic updates across the
+ * threads of a warp or subgroup before they reach memory.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Find the atomic associative updates in GPU kernels that every
+ * thread in a warp makes to the same location, such as a reduction
+ * over an RVar scheduled with atomic().gpu_threads(), and reduce the
+ * values across the warp first, so that only one thread per warp
+ * updates memory. This uses butterfly warp shuffles on CUDA,
+ * sub_group_reduce on OpenCL with the CLSubgroups feature, and
+ * simd_sum and friends on Metal with the MetalSIMDGroups
+ * feature. Must be run after the GPU thread loops have been
+ * fused. */
+Stmt lower_warp_reductions(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -1,15 +1,19 @@
 #include "Memoization.h"
 #include "Error.h"
+#include "FindCalls.h"
 #include "Function.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "IRPrinter.h"
 #include "IRVisitor.h"
 #include "Param.h"
 #include "Scope.h"
 #include "Util.h"
 #include "Var.h"
 
+#include <iomanip>
 #include <map>
+#include <sstream>
 
 namespace Halide {
 namespace Internal {
@@ -153,11 +157,103 @@ public:
 typedef std::pair<FindParameterDependencies::DependencyKey, FindParameterDependencies::DependencyInfo> DependencyKeyInfoPair;
 typedef std::pair<const FindParameterDependencies::DependencyKey, FindParameterDependencies::DependencyInfo> ConstDependencyKeyInfoPair;
 
+// Finds the Buffers that definitions read.
+class FindBuffers : public IRGraphVisitor {
+    using IRGraphVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRGraphVisitor::visit(op);
+        if (op->image.defined()) {
+            buffers[op->image.name()] = op->image;
+        }
+    }
+
+public:
+    std::map<std::string, Buffer<>> buffers;
+};
+
+// A fingerprint of the algorithm of a Function: the definitions of it
+// and of the Functions it calls, and the contents of the Buffers they
+// read. It is part of the cache key, so that memoized results that
+// outlive the process (see halide_memoization_cache_set_shared_region)
+// are not found by a version of the pipeline that computes something
+// else. Schedules don't change what is computed, so they are left out.
+std::string algorithm_fingerprint(const Function &function) {
+    std::ostringstream text;
+    FindBuffers find_buffers;
+    for (const auto &it : find_transitive_calls(function)) {
+        const Function &f = it.second;
+        text << f.name() << "(";
+        for (const std::string &arg : f.args()) {
+            text << arg << ",";
+        }
+        text << ")";
+        if (f.has_extern_definition()) {
+            text << "extern " << f.extern_function_name() << "(";
+            for (const ExternFuncArgument &arg : f.extern_arguments()) {
+                if (arg.is_func()) {
+                    text << Function(arg.func).name();
+                } else if (arg.is_expr()) {
+                    text << arg.expr;
+                } else if (arg.is_buffer()) {
+                    text << arg.buffer.name();
+                    find_buffers.buffers[arg.buffer.name()] = arg.buffer;
+                } else if (arg.is_image_param()) {
+                    text << arg.image_param.name();
+                }
+                text << ",";
+            }
+            text << ")";
+        }
+        std::vector<Definition> definitions;
+        if (f.has_pure_definition()) {
+            definitions.push_back(f.definition());
+        }
+        definitions.insert(definitions.end(), f.updates().begin(), f.updates().end());
+        for (const Definition &def : definitions) {
+            for (const ReductionVariable &rv : def.schedule().rvars()) {
+                text << rv.var << "[" << rv.min << "," << rv.extent << "]";
+            }
+            text << "[" << def.predicate() << "]";
+            for (const Expr &arg : def.args()) {
+                text << arg << ",";
+            }
+            text << "=";
+            for (const Expr &value : def.values()) {
+                text << value << ",";
+            }
+            text << ";";
+        }
+        f.accept(&find_buffers);
+    }
+
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    auto hash_bytes = [&](const uint8_t *begin, const uint8_t *end) {
+        for (const uint8_t *p = begin; p < end; p++) {
+            h = (h ^ *p) * 0x100000001b3ULL;
+        }
+    };
+    const std::string str = text.str();
+    hash_bytes((const uint8_t *)str.data(), (const uint8_t *)str.data() + str.size());
+    for (const auto &it : find_buffers.buffers) {
+        const halide_buffer_t *buf = it.second.raw_buffer();
+        if (buf->host) {
+            hash_bytes(buf->begin(), buf->end());
+        }
+    }
+
+    std::ostringstream result;
+    result << std::hex << std::setw(16) << std::setfill('0') << h;
+    return result.str();
+}
+
 class KeyInfo {
     FindParameterDependencies dependencies;
     Expr key_size_expr;
     const std::string &top_level_name;
     const std::string &function_name;
+    const std::string fingerprint;
     int memoize_instance;
 
     size_t parameters_alignment() {
@@ -195,6 +291,7 @@ public:
     KeyInfo(const Function &function, const std::string &name, int memoize_instance)
         : top_level_name(name),
           function_name(function.origin_name()),
+          fingerprint(algorithm_fingerprint(function)),
           memoize_instance(memoize_instance) {
         dependencies.visit_function(function);
         size_t size_so_far = 0;
@@ -225,12 +322,14 @@ public:
         Expr index = Expr(0);
 
         // Store a pointer to a string identifying the filter and
-        // function. Assume this will be unique due to CSE. This can
-        // break with loading and unloading of code, though the name
-        // mechanism can also break in those conditions.
+        // function, and what the function computes. Assume this will
+        // be unique due to CSE. This can break with loading and
+        // unloading of code, though the name mechanism can also break
+        // in those conditions.
         writes.push_back(Store::make(key_name,
                                      StringImm::make(std::to_string(top_level_name.size()) + ":" + top_level_name +
-                                                     std::to_string(function_name.size()) + ":" + function_name),
+                                                     std::to_string(function_name.size()) + ":" + function_name +
+                                                     ":" + fingerprint),
                                      (index / Handle().bytes()), Parameter(), const_true(), ModulusRemainder()));
         size_t alignment = Handle().bytes();
         index += Handle().bytes();
@@ -19,6 +19,7 @@
 #include "Pipeline.h"
 #include "PythonExtensionGen.h"
 #include "StmtToHtml.h"
+#include "ThreadPool.h"
 
 namespace Halide {
 namespace Internal {
@@ -49,6 +50,7 @@ std::map<OutputFileType, const OutputInfo> get_output_info(const Target &target)
         {OutputFileType::static_library, {"static_library", is_windows_coff ? ".lib" : ".a", IsSingle}},
         {OutputFileType::stmt, {"stmt", ".stmt", IsMulti}},
         {OutputFileType::stmt_html, {"stmt_html", ".stmt.html", IsMulti}},
+        {OutputFileType::thin_lto_bitcode, {"thin_lto_bitcode", ".thinlto.bc", IsMulti}},
     };
     return ext;
 }
@@ -547,7 +549,7 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
     auto *logger = get_compiler_logger();
     if (contains(output_files, OutputFileType::object) || contains(output_files, OutputFileType::assembly) ||
         contains(output_files, OutputFileType::bitcode) || contains(output_files, OutputFileType::llvm_assembly) ||
-        contains(output_files, OutputFileType::static_library)) {
+        contains(output_files, OutputFileType::static_library) || contains(output_files, OutputFileType::thin_lto_bitcode)) {
         llvm::LLVMContext context;
         std::unique_ptr<llvm::Module> llvm_module(compile_module_to_llvm_module(*this, context));
 
@@ -593,6 +595,11 @@ void Module::compile(const std::map<OutputFileType, std::string> &output_files)
             auto out = make_raw_fd_ostream(output_files.at(OutputFileType::bitcode));
             compile_llvm_module_to_llvm_bitcode(*llvm_module, *out);
         }
+        if (contains(output_files, OutputFileType::thin_lto_bitcode)) {
+            debug(1) << "Module.compile(): thin_lto_bitcode " << output_files.at(OutputFileType::thin_lto_bitcode) << "\n";
+            auto out = make_raw_fd_ostream(output_files.at(OutputFileType::thin_lto_bitcode));
+            compile_llvm_module_to_thin_lto_bitcode(*llvm_module, *out);
+        }
         if (contains(output_files, OutputFileType::llvm_assembly)) {
             debug(1) << "Module.compile(): llvm_assembly " << output_files.at(OutputFileType::llvm_assembly) << "\n";
             auto out = make_raw_fd_ostream(output_files.at(OutputFileType::llvm_assembly));
@@ -684,13 +691,19 @@ std::map<OutputFileType, std::string> compile_standalone_runtime(const std::map<
     validate_outputs(output_files);
 
     Module empty("standalone_runtime", t.without_feature(Target::NoRuntime).without_feature(Target::JIT));
-    // For runtime, it only makes sense to output object files or static_library, so ignore
-    // everything else.
+    // For runtime, it only makes sense to output object files, static_library, or
+    // thin_lto_bitcode, so ignore everything else.
     std::map<OutputFileType, std::string> actual_outputs;
     // If the python_extension output is specified, we'll generate just the module-registration code,
     // with no functions at all. This is useful when gluing together multiple Halide functions
     // into the same Python extension.
-    for (auto key : {OutputFileType::object, OutputFileType::static_library, OutputFileType::python_extension}) {
+    //
+    // A thin_lto_bitcode runtime can be shared by any number of pipelines
+    // compiled to thin_lto_bitcode with NoRuntime. Its halide_ functions
+    // stay weak, so the linker still dedupes them and lets user code
+    // replace them; the runtime's private helpers are linkonce, so they
+    // can be imported and inlined.
+    for (auto key : {OutputFileType::object, OutputFileType::static_library, OutputFileType::python_extension, OutputFileType::thin_lto_bitcode}) {
         auto it = output_files.find(key);
         if (it != output_files.end()) {
             actual_outputs[key] = it->second;
@@ -729,7 +742,8 @@ void compile_multitarget(const std::string &fn_name,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory) {
+                         const CompilerLoggerFactory &compiler_logger_factory,
+                         int max_parallelism) {
     validate_outputs(output_files);
 
     user_assert(!fn_name.empty()) << "Function name must be specified.\n";
@@ -809,6 +823,13 @@ void compile_multitarget(const std::string &fn_name,
     std::vector<LoweredArgument> base_target_args;
     std::vector<AutoSchedulerResults> auto_scheduler_results;
 
+    // The outputs for each sub-target. The paths of temp files are all
+    // chosen up front, as their order determines the order of objects in
+    // a static library, and the sub-targets may be compiled concurrently.
+    std::vector<std::string> sub_fn_names;
+    std::vector<Target> sub_fn_targets;
+    std::vector<std::map<OutputFileType, std::string>> sub_outs;
+
     for (size_t i = 0; i < targets.size(); ++i) {
         const Target &target = targets[i];
 
@@ -844,31 +865,23 @@ void compile_multitarget(const std::string &fn_name,
         // We always produce the runtime separately, so add NoRuntime explicitly.
         Target sub_fn_target = target.with_feature(Target::NoRuntime);
 
-        {
-            ScopedCompilerLogger activate(compiler_logger_factory, sub_fn_name, sub_fn_target);
-            Module sub_module = module_factory(sub_fn_name, sub_fn_target);
-            // Re-assign every time -- should be the same across all targets anyway,
-            // but base_target is always the last one we encounter.
-            base_target_args = sub_module.get_function_by_name(sub_fn_name).args;
-
-            auto sub_out = add_suffixes(output_files, suffix);
-            if (contains(output_files, OutputFileType::static_library)) {
-                sub_out[OutputFileType::object] = temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), suffix, target);
-                sub_out.erase(OutputFileType::static_library);
-            }
-            sub_out.erase(OutputFileType::registration);
-            sub_out.erase(OutputFileType::schedule);
-            sub_out.erase(OutputFileType::c_header);
-            sub_out.erase(OutputFileType::function_info_header);
-            if (contains(sub_out, OutputFileType::compiler_log)) {
-                sub_out[OutputFileType::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(OutputFileType::compiler_log), suffix, target);
-            }
-            debug(1) << "compile_multitarget: compile_sub_target " << sub_out[OutputFileType::object] << "\n";
-            sub_module.compile(sub_out);
-            const auto *r = sub_module.get_auto_scheduler_results();
-            auto_scheduler_results.push_back(r ? *r : AutoSchedulerResults());
+        auto sub_out = add_suffixes(output_files, suffix);
+        if (contains(output_files, OutputFileType::static_library)) {
+            sub_out[OutputFileType::object] = temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), suffix, target);
+            sub_out.erase(OutputFileType::static_library);
+        }
+        sub_out.erase(OutputFileType::registration);
+        sub_out.erase(OutputFileType::schedule);
+        sub_out.erase(OutputFileType::c_header);
+        sub_out.erase(OutputFileType::function_info_header);
+        if (contains(sub_out, OutputFileType::compiler_log)) {
+            sub_out[OutputFileType::compiler_log] = temp_compiler_log_dir.add_temp_file(output_files.at(OutputFileType::compiler_log), suffix, target);
         }
 
+        sub_fn_names.push_back(sub_fn_name);
+        sub_fn_targets.push_back(sub_fn_target);
+        sub_outs.push_back(std::move(sub_out));
+
         uint64_t cur_target_features[kFeaturesWordCount] = {0};
         for (int i = 0; i < Target::FeatureEnd; ++i) {
             if (target.has_feature((Target::Feature)i)) {
@@ -899,9 +912,10 @@ void compile_multitarget(const std::string &fn_name,
 
     // If we haven't specified "no runtime", build a runtime with the base target
     // and add that to the result.
+    std::map<OutputFileType, std::string> runtime_out;
+    Target runtime_target(base_target.os, base_target.arch, base_target.bits, base_target.processor_tune);
     if (!base_target.has_feature(Target::NoRuntime)) {
         // Start with a bare Target, set only the features we know are common to all.
-        Target runtime_target(base_target.os, base_target.arch, base_target.bits, base_target.processor_tune);
         for (int i = 0; i < Target::FeatureEnd; ++i) {
             // We never want NoRuntime set here.
             if (i == Target::NoRuntime) {
@@ -917,10 +931,58 @@ void compile_multitarget(const std::string &fn_name,
                                        temp_obj_dir.add_temp_object_file(output_files.at(OutputFileType::static_library), "_runtime", runtime_target) :
                                        add_suffix(output_files.at(OutputFileType::object), "_runtime");
 
-        std::map<OutputFileType, std::string> runtime_out =
-            {{OutputFileType::object, runtime_path}};
+        runtime_out = {{OutputFileType::object, runtime_path}};
+    }
+
+    // Lower and compile each sub-target, and the runtime. These are
+    // independent of each other, so they can run concurrently.
+    auto_scheduler_results.resize(targets.size());
+    const auto compile_sub_target = [&](size_t i) {
+        ScopedCompilerLogger activate(compiler_logger_factory, sub_fn_names[i], sub_fn_targets[i]);
+        Module sub_module = module_factory(sub_fn_names[i], sub_fn_targets[i]);
+        debug(1) << "compile_multitarget: compile_sub_target " << sub_outs[i][OutputFileType::object] << "\n";
+        sub_module.compile(sub_outs[i]);
+        const auto *r = sub_module.get_auto_scheduler_results();
+        auto_scheduler_results[i] = r ? *r : AutoSchedulerResults();
+        if (i == targets.size() - 1) {
+            // The arguments should be the same across all targets anyway,
+            // so take them from the base target.
+            base_target_args = sub_module.get_function_by_name(sub_fn_names[i]).args;
+        }
+    };
+    const auto compile_runtime = [&]() {
         debug(1) << "compile_multitarget: compile_standalone_runtime " << runtime_out.at(OutputFileType::object) << "\n";
         compile_standalone_runtime(runtime_out, runtime_target);
+    };
+
+    const size_t num_jobs = targets.size() + (runtime_out.empty() ? 0 : 1);
+    size_t num_threads = max_parallelism > 0 ? (size_t)max_parallelism : Internal::ThreadPool<void>::num_processors_online();
+    num_threads = std::min(num_threads, num_jobs);
+    if (num_threads <= 1) {
+        for (size_t i = 0; i < targets.size(); ++i) {
+            compile_sub_target(i);
+        }
+        if (!runtime_out.empty()) {
+            compile_runtime();
+        }
+    } else {
+        debug(1) << "compile_multitarget: compiling " << num_jobs << " modules on " << num_threads << " threads\n";
+        std::vector<std::future<void>> futures;
+        Internal::ThreadPool<void> pool(num_threads);
+        for (size_t i = 0; i < targets.size(); ++i) {
+            futures.push_back(pool.async(compile_sub_target, i));
+        }
+        if (!runtime_out.empty()) {
+            futures.push_back(pool.async(compile_runtime));
+        }
+        // Wait for everything before rethrowing any error, as the jobs
+        // refer to locals of this function.
+        for (auto &f : futures) {
+            f.wait();
+        }
+        for (auto &f : futures) {
+            f.get();
+        }
     }
 
     if (needs_wrapper) {
@@ -1053,4 +1115,59 @@ void compile_multitarget(const std::string &fn_name,
     }
 }
 
+namespace Internal {
+
+std::string module_fingerprint(const Module &m) {
+    std::ostringstream key;
+    key << m;
+
+    // Printing the Module leaves out the parts of the function
+    // signatures that only show up in the headers and metadata.
+    for (const LoweredFunc &f : m.functions()) {
+        key << "function " << f.name
+            << " linkage " << (int)f.linkage
+            << " mangling " << (int)f.name_mangling << "\n";
+        for (const LoweredArgument &arg : f.args) {
+            const ArgumentEstimates &e = arg.argument_estimates;
+            key << "arg " << arg.name
+                << " kind " << (int)arg.kind
+                << " type " << arg.type
+                << " dims " << (int)arg.dimensions
+                << " alignment " << arg.alignment.modulus << " " << arg.alignment.remainder
+                << " estimates " << e.scalar_def << " " << e.scalar_min
+                << " " << e.scalar_max << " " << e.scalar_estimate;
+            for (const Range &r : e.buffer_estimates) {
+                key << " [" << r.min << ", " << r.extent << "]";
+            }
+            key << "\n";
+        }
+    }
+
+    for (const auto &it : m.get_metadata_name_map()) {
+        key << "metadata name " << it.first << " -> " << it.second << "\n";
+    }
+
+    // Printing the Module only records the names and shapes of its
+    // buffers, so hash their contents too.
+    for (const Buffer<> &b : m.buffers()) {
+        const halide_buffer_t *buf = b.raw_buffer();
+        key << "buffer " << b.name() << "\n";
+        if (buf->host) {
+            key.write((const char *)buf->begin(), buf->end() - buf->begin());
+        }
+    }
+
+    if (const AutoSchedulerResults *r = m.get_auto_scheduler_results()) {
+        key << "autoscheduler " << r->autoscheduler_params.to_string() << "\n"
+            << r->schedule_source << "\n";
+        key.write((const char *)r->featurization.data(), r->featurization.size());
+    }
+
+    std::string s = key.str();
+    auto hash = llvm::SHA1::hash(llvm::ArrayRef<uint8_t>((const uint8_t *)s.data(), s.size()));
+    return llvm::toHex(hash, /* LowerCase */ true);
+}
+
+}  // namespace Internal
+
 }  // namespace Halide
@@ -15,6 +15,7 @@
 #include "Expr.h"
 #include "Function.h"  // for NameMangling
 #include "ModulusRemainder.h"
+#include "Target.h"
 
 namespace Halide {
 
@@ -41,6 +42,7 @@ enum class OutputFileType {
     static_library,
     stmt,
     stmt_html,
+    thin_lto_bitcode,
 };
 
 /** Type of linkage a function in a lowered Halide module can have.
@@ -110,6 +112,11 @@ struct LoweredFunc {
      * the Target. */
     NameMangling name_mangling;
 
+    /** Target features this function may use in addition to those of
+     * the Module's target. Callers must check that they are available
+     * at runtime before calling it. Only used by the x86 backend. */
+    std::vector<Target::Feature> extra_features;
+
     LoweredFunc(const std::string &name,
                 const std::vector<LoweredArgument> &args,
                 Stmt body,
@@ -221,12 +228,29 @@ std::map<OutputFileType, std::string> compile_standalone_runtime(const std::map<
 using ModuleFactory = std::function<Module(const std::string &fn_name, const Target &target)>;
 using CompilerLoggerFactory = std::function<std::unique_ptr<Internal::CompilerLogger>(const std::string &fn_name, const Target &target)>;
 
+/** Compile a function for each of the given targets, along with a
+ * wrapper that picks the best one at runtime. The sub-targets (and the
+ * runtime) are lowered and compiled on up to max_parallelism threads
+ * at once; zero means one thread per core. When more than one thread
+ * is used, module_factory must be safe to call concurrently. */
 void compile_multitarget(const std::string &fn_name,
                          const std::map<OutputFileType, std::string> &output_files,
                          const std::vector<Target> &targets,
                          const std::vector<std::string> &suffixes,
                          const ModuleFactory &module_factory,
-                         const CompilerLoggerFactory &compiler_logger_factory = nullptr);
+                         const CompilerLoggerFactory &compiler_logger_factory = nullptr,
+                         int max_parallelism = 1);
+
+namespace Internal {
+
+/** Return a hash of everything in a lowered module that the files
+ * compiled from it depend on: its IR, the contents of its buffers, the
+ * signatures and estimates of its functions, its metadata name map, and
+ * any auto-scheduler results. The same build of Halide compiles two
+ * modules with the same fingerprint to the same outputs. */
+std::string module_fingerprint(const Module &m);
+
+}  // namespace Internal
 
 }  // namespace Halide
 
@@ -0,0 +1,264 @@
+#include "MultiversionLoops.h"
+
+#include "Argument.h"
+#include "Closure.h"
+#include "DebugArguments.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Module.h"
+#include "Target.h"
+#include "Util.h"
+
+namespace Halide {
+namespace Internal {
+
+namespace {
+
+using std::string;
+using std::vector;
+
+// The x86 feature levels we may compile loops for, from oldest to
+// newest. Each level includes the features of the ones before it.
+enum FeatureLevel {
+    Skylake,
+    CascadeLake,
+    SapphireRapids,
+    NumFeatureLevels
+};
+
+const char *feature_level_name(int level) {
+    static const char *names[NumFeatureLevels] = {
+        "avx512_skylake",
+        "avx512_vnni",
+        "avx512_sapphirerapids",
+    };
+    return names[level];
+}
+
+vector<Target::Feature> feature_level_features(int level) {
+    vector<Target::Feature> features = {Target::SSE41, Target::AVX, Target::AVX2,
+                                        Target::FMA, Target::F16C, Target::AVX512,
+                                        Target::AVX512_Skylake};
+    if (level >= CascadeLake) {
+        features.push_back(Target::AVX512_VNNI);
+    }
+    if (level >= SapphireRapids) {
+        features.push_back(Target::AVXVNNI);
+        features.push_back(Target::AVX512_SapphireRapids);
+        features.push_back(Target::AVX512_FP16);
+    }
+    return features;
+}
+
+// Find what a loop body does that newer feature levels would compile
+// differently.
+class FindVectorCode : public IRVisitor {
+    using IRVisitor::visit;
+
+    int reduce_depth = 0;
+
+    void visit_type(const Type &t) {
+        if (t.is_vector()) {
+            max_vector_bits = std::max(max_vector_bits, t.bits() * t.lanes());
+            if (t.is_bfloat() || (t.is_float() && t.bits() == 16)) {
+                uses_half_float = true;
+            }
+        }
+    }
+
+    void visit_narrow_reduction_arg(const Expr &e) {
+        if (reduce_depth > 0 && e.type().is_int_or_uint() && e.type().bits() <= 16) {
+            uses_narrow_dot_product = true;
+        }
+    }
+
+    void visit(const For *op) override {
+        has_inner_loop = true;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Load *op) override {
+        visit_type(op->type);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        visit_type(op->value.type());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Cast *op) override {
+        visit_type(op->type);
+        visit_narrow_reduction_arg(op->value);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        visit_type(op->type);
+        for (const Expr &arg : op->args) {
+            visit_narrow_reduction_arg(arg);
+        }
+        IRVisitor::visit(op);
+    }
+
+    void visit(const VectorReduce *op) override {
+        visit_type(op->value.type());
+        bool is_sum = op->op == VectorReduce::Add && op->type.is_int_or_uint();
+        reduce_depth += is_sum;
+        IRVisitor::visit(op);
+        reduce_depth -= is_sum;
+    }
+
+public:
+    bool has_inner_loop = false;
+    int max_vector_bits = 0;
+    bool uses_half_float = false;
+    bool uses_narrow_dot_product = false;
+};
+
+class MultiversionLoops : public IRMutator {
+    using IRMutator::visit;
+
+    const string &function_name;
+    const Target &target;
+    int base_vector_bits;
+
+    // Whether the loop body would compile differently for a feature
+    // level than for the target.
+    bool level_differs(int level, const FindVectorCode &code) const {
+        switch (level) {
+        case Skylake:
+            return !target.has_feature(Target::AVX512_Skylake) &&
+                   code.max_vector_bits > base_vector_bits;
+        case CascadeLake:
+            return !target.has_feature(Target::AVX512_VNNI) &&
+                   !target.has_feature(Target::AVX512_SapphireRapids) &&
+                   code.uses_narrow_dot_product;
+        case SapphireRapids:
+            return !(target.has_feature(Target::AVX512_SapphireRapids) &&
+                     target.has_feature(Target::AVX512_FP16)) &&
+                   code.uses_half_float;
+        default:
+            return false;
+        }
+    }
+
+    Expr can_use_level(int level) {
+        if (can_use_names[level].empty()) {
+            can_use_names[level] = unique_name(string("can_use_") + feature_level_name(level));
+        }
+        return Variable::make(Bool(), can_use_names[level]);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+
+        FindVectorCode code;
+        op->body.accept(&code);
+        if (code.has_inner_loop) {
+            return IRMutator::visit(op);
+        }
+        if (op->for_type != ForType::Serial || code.max_vector_bits == 0) {
+            return op;
+        }
+
+        vector<int> levels;
+        for (int level = 0; level < NumFeatureLevels; level++) {
+            if (level_differs(level, code)) {
+                levels.push_back(level);
+            }
+        }
+        if (levels.empty()) {
+            return op;
+        }
+
+        Stmt loop = op;
+        Closure closure;
+        closure.include(loop);
+        // The same name can appear as a var and a buffer. Remove the var name in this case.
+        for (const auto &b : closure.buffers) {
+            closure.vars.erase(b.first);
+        }
+        string closure_name = unique_name("multiversion_closure");
+        Expr closure_struct_allocation = closure.pack_into_struct();
+        Expr closure_struct = Cast::make(type_of<uint8_t *>(),
+                                         Variable::make(Handle(), closure_name));
+        Expr user_context = Call::make(type_of<void *>(), Call::get_user_context, {}, Call::PureIntrinsic);
+
+        // Check the newest levels first, and fall back to the original
+        // loop if the CPU has none of them.
+        Stmt result = loop;
+        for (int level : levels) {
+            string variant_name = c_print_name(unique_name(op->name + "_" + feature_level_name(level)), false);
+            string closure_arg_name = unique_name("closure_arg");
+            vector<LoweredArgument> args = {
+                LoweredArgument("__user_context", Argument::InputScalar, type_of<void *>(), 0, ArgumentEstimates()),
+                LoweredArgument(closure_arg_name, Argument::InputScalar, type_of<uint8_t *>(), 0, ArgumentEstimates())};
+            Expr closure_arg = Variable::make(closure_struct_allocation.type(), closure_arg_name);
+            LoweredFunc variant{variant_name, args, closure.unpack_from_struct(closure_arg, loop),
+                                LinkageType::Internal, NameMangling::C};
+            variant.extra_features = feature_level_features(level);
+            if (target.has_feature(Target::Debug)) {
+                debug_arguments(&variant, target);
+            }
+            variants.emplace_back(std::move(variant));
+
+            string result_name = unique_name("multiversion_result");
+            Expr call = Call::make(Int(32), variant_name, {user_context, closure_struct}, Call::Extern);
+            Expr result_var = Variable::make(Int(32), result_name);
+            Stmt call_variant = LetStmt::make(result_name, call, AssertStmt::make(result_var == 0, result_var));
+            result = IfThenElse::make(can_use_level(level), call_variant, result);
+        }
+
+        debug(2) << "Multiversioned loop " << op->name << " in " << function_name << "\n";
+        return LetStmt::make(closure_name, closure_struct_allocation, result);
+    }
+
+public:
+    MultiversionLoops(const string &function_name, const Target &t)
+        : function_name(function_name), target(t) {
+        base_vector_bits = t.has_feature(Target::AVX512) ? 512 : t.has_feature(Target::AVX) ? 256 : 128;
+    }
+
+    vector<LoweredFunc> variants;
+    string can_use_names[NumFeatureLevels];
+};
+
+}  // namespace
+
+Stmt multiversion_loops(const Stmt &s, vector<LoweredFunc> &variants,
+                        const string &name, const Target &t) {
+    MultiversionLoops mutator(name, t);
+    Stmt result = mutator.mutate(s);
+
+    // Check for each feature level used once per call to the pipeline,
+    // rather than each time a loop runs.
+    constexpr int kFeaturesWordCount = (Target::FeatureEnd + 63) / (sizeof(uint64_t) * 8);
+    for (int level = 0; level < NumFeatureLevels; level++) {
+        if (mutator.can_use_names[level].empty()) {
+            continue;
+        }
+        uint64_t level_features[kFeaturesWordCount] = {0};
+        for (Target::Feature f : feature_level_features(level)) {
+            level_features[f >> 6] |= ((uint64_t)1) << (f & 63);
+        }
+        vector<Expr> features_struct_args;
+        for (uint64_t feature : level_features) {
+            features_struct_args.emplace_back(UIntImm::make(UInt(64), feature));
+        }
+        Expr can_use = Call::make(Int(32), "halide_can_use_target_features",
+                                  {kFeaturesWordCount, Call::make(type_of<uint64_t *>(), Call::make_struct, features_struct_args, Call::Intrinsic)},
+                                  Call::Extern);
+        result = LetStmt::make(mutator.can_use_names[level], can_use != 0, result);
+    }
+
+    variants.insert(variants.end(), mutator.variants.begin(), mutator.variants.end());
+    return result;
+}
+
+}  // namespace Internal
+}  // namespace Halide
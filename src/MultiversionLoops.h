@@ -0,0 +1,36 @@
+#ifndef HALIDE_MULTIVERSION_LOOPS_H
+#define HALIDE_MULTIVERSION_LOOPS_H
+
+/** \file
+ * Defines the lowering pass that compiles vectorized inner loops for
+ * several x86 feature levels and picks one at runtime.
+ */
+
+#include <string>
+#include <vector>
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+struct LoweredFunc;
+
+/** Find the innermost loops whose vector code would compile
+ * differently for an x86 CPU newer than the target, e.g. because it
+ * has wider vectors, dot product instructions, or half-float
+ * arithmetic. Outline a copy of each such loop per newer feature level
+ * into a function compiled for that level, appended to 'variants', and
+ * replace the loop with a branch on whether the CPU we are running on
+ * has that level. The checks are made once, at the top of the
+ * pipeline. The original loop remains as the fallback. */
+Stmt multiversion_loops(const Stmt &s, std::vector<LoweredFunc> &variants,
+                        const std::string &name, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -7,6 +7,7 @@
 #include "CodeGen_OpenCL_Dev.h"
 #include "CodeGen_OpenGLCompute_Dev.h"
 #include "CodeGen_PTX_Dev.h"
+#include "CodeGen_Vulkan_Dev.h"
 #include "ExprUsesVar.h"
 #include "IRMutator.h"
 #include "IROperator.h"
@@ -208,7 +209,15 @@ class InjectGpuOffload : public IRMutator {
                 arg_types_or_sizes.emplace_back(cast(target_size_t_type, i.is_buffer ? 8 : i.type.bytes()));
             }
 
-            arg_is_buffer.emplace_back(cast<uint8_t>(i.is_buffer));
+            // Buffers the kernel only reads are marked with a 2, so
+            // that runtimes that track device memory dependencies can
+            // allow concurrent readers. Other buffers are marked with
+            // a 1, and non-buffer arguments with a 0.
+            int is_buffer = 0;
+            if (i.is_buffer) {
+                is_buffer = (i.read && !i.write) ? 2 : 1;
+            }
+            arg_is_buffer.emplace_back(cast<uint8_t>(is_buffer));
         }
 
         // nullptr-terminate the lists
@@ -268,6 +277,9 @@ public:
         if (target.has_feature(Target::D3D12Compute)) {
             cgdev[DeviceAPI::D3D12Compute] = new_CodeGen_D3D12Compute_Dev(target);
         }
+        if (target.has_feature(Target::Vulkan)) {
+            cgdev[DeviceAPI::Vulkan] = new_CodeGen_Vulkan_Dev(target);
+        }
 
         internal_assert(!cgdev.empty()) << "Requested unknown GPU target: " << target.to_string() << "\n";
     }
@@ -1,9 +1,12 @@
 #include <algorithm>
+#include <map>
 #include <numeric>
 #include <utility>
 
+#include "Bounds.h"
 #include "CSE.h"
 #include "CodeGen_GPU_Dev.h"
+#include "CompilerLogger.h"
 #include "ExprUsesVar.h"
 #include "IREquality.h"
 #include "IRMutator.h"
@@ -511,11 +514,76 @@ bool contains_warp_synchronous_logic(const Stmt &s) {
     return c.result;
 }
 
+// With Target::PartitionCostModel, loops are only partitioned if their
+// steady state dominates their prologue and epilogue, and each Func only
+// gets a limited number of extra copies of its loop bodies.
+struct PartitionBudget {
+    bool enabled = false;
+
+    // The largest number of extra loop bodies partitioning may make for
+    // each Func.
+    int max_bodies_per_func = 0;
+
+    // The extra loop bodies made so far, by Func.
+    std::map<string, int> bodies_used;
+
+    // What happened to each loop considered, in order.
+    vector<pair<string, string>> decisions;
+
+    // The steady state must run at least this many times as often as
+    // the prologue and epilogue put together.
+    static constexpr int steady_state_dominance = 4;
+
+    // Decide whether to partition a loop that would get the given
+    // number of extra bodies, with prologue and epilogue running for
+    // the given number of iterations between them.
+    bool allow(const For *op, int extra_bodies, const Expr &boundary_iterations) {
+        if (!enabled) {
+            return true;
+        }
+
+        // Loops are named after the Func they belong to.
+        const string func = op->name.substr(0, op->name.find('.'));
+
+        // An extent that isn't bounded by a constant is assumed to be
+        // large, and boundaries that aren't bounded by one are assumed to
+        // be small next to it. Only loops known to be short can be
+        // shown not to be worth it.
+        Expr extent = find_constant_bound(op->extent, Direction::Upper);
+        Expr boundary = find_constant_bound(simplify(boundary_iterations), Direction::Upper);
+        const int64_t *e = as_const_int(extent);
+        const int64_t *b = as_const_int(boundary);
+        std::ostringstream reason;
+        bool ok = true;
+        if (e) {
+            int64_t boundary_bound = b ? std::min(*b, *e) : *e;
+            if (*e - boundary_bound < steady_state_dominance * boundary_bound) {
+                reason << "skipped: steady state of at least " << *e - boundary_bound
+                       << " of " << *e << " iterations does not dominate";
+                ok = false;
+            }
+        }
+        if (ok && bodies_used[func] + extra_bodies > max_bodies_per_func) {
+            reason << "skipped: " << func << " has used " << bodies_used[func]
+                   << " of its budget of " << max_bodies_per_func << " extra loop bodies";
+            ok = false;
+        }
+        if (ok) {
+            bodies_used[func] += extra_bodies;
+            reason << "partitioned into " << extra_bodies + 1 << " loop bodies";
+        }
+        decisions.emplace_back(op->name, reason.str());
+        return ok;
+    }
+};
+
 class PartitionLoops : public IRMutator {
     using IRMutator::visit;
 
     bool in_gpu_loop = false;
 
+    PartitionBudget &budget;
+
     Stmt visit(const For *op) override {
         Stmt body = op->body;
 
@@ -660,9 +728,6 @@ class PartitionLoops : public IRMutator {
         bool make_prologue = !equal(prologue, simpler_body);
         bool make_epilogue = !equal(epilogue, simpler_body);
 
-        // Recurse on the middle section.
-        simpler_body = mutate(simpler_body);
-
         // Construct variables for the bounds of the simplified middle section
         Expr min_steady = op->min, max_steady = op->extent + op->min;
         Expr prologue_val, epilogue_val;
@@ -700,6 +765,22 @@ class PartitionLoops : public IRMutator {
             internal_assert(!expr_uses_var(epilogue_val, op->name));
         }
 
+        Expr first_steady = make_prologue ? prologue_val : op->min;
+        Expr end_steady = make_epilogue ? epilogue_val : op->min + op->extent;
+        if (can_prove(end_steady <= first_steady)) {
+            // The steady state is empty. I've made a huge
+            // mistake. Try to partition a loop further in.
+            return IRMutator::visit(op);
+        }
+
+        if (!budget.allow(op, (int)make_prologue + (int)make_epilogue,
+                          (first_steady - op->min) + (op->min + op->extent - end_steady))) {
+            return IRMutator::visit(op);
+        }
+
+        // Recurse on the middle section.
+        simpler_body = mutate(simpler_body);
+
         Stmt stmt;
         // Bust simple serial for loops up into three.
         if (op->for_type == ForType::Serial && !op->body.as<Acquire>()) {
@@ -748,21 +829,11 @@ class PartitionLoops : public IRMutator {
             // Uncomment to include code that prints the epilogue value
             // epilogue_val = print(epilogue_val, op->name, "epilogue");
             stmt = LetStmt::make(epilogue_name, epilogue_val, stmt);
-        } else {
-            epilogue_val = op->min + op->extent;
         }
         if (make_prologue) {
             // Uncomment to include code that prints the prologue value
             // prologue_val = print(prologue_val, op->name, "prologue");
             stmt = LetStmt::make(prologue_name, prologue_val, stmt);
-        } else {
-            prologue_val = op->min;
-        }
-
-        if (can_prove(epilogue_val <= prologue_val)) {
-            // The steady state is empty. I've made a huge
-            // mistake. Try to partition a loop further in.
-            return IRMutator::visit(op);
         }
 
         debug(3) << "Partition loop.\n"
@@ -771,6 +842,11 @@ class PartitionLoops : public IRMutator {
 
         return stmt;
     }
+
+public:
+    PartitionLoops(PartitionBudget &budget)
+        : budget(budget) {
+    }
 };
 
 class ExprContainsLoad : public IRVisitor {
@@ -1079,9 +1155,21 @@ bool has_likely_tag(const Expr &e) {
     return h.result;
 }
 
-Stmt partition_loops(Stmt s) {
+Stmt partition_loops(Stmt s, const Target &t) {
     s = LowerLikelyIfInnermost().mutate(s);
 
+    PartitionBudget budget;
+    if (t.has_feature(Target::PartitionCostModel)) {
+        budget.enabled = true;
+        budget.max_bodies_per_func = 8;
+        std::string budget_str = get_env_variable("HL_PARTITION_LOOPS_BUDGET");
+        if (!budget_str.empty()) {
+            budget.max_bodies_per_func = std::atoi(budget_str.c_str());
+            user_assert(budget.max_bodies_per_func >= 0)
+                << "HL_PARTITION_LOOPS_BUDGET must be a non-negative integer, but is " << budget_str << "\n";
+        }
+    }
+
     // Walk inwards to the first loop before doing any more work.
     class Mutator : public IRMutator {
         using IRMutator::visit;
@@ -1089,14 +1177,32 @@ Stmt partition_loops(Stmt s) {
             Stmt s = op;
             s = MarkClampedRampsAsLikely().mutate(s);
             s = ExpandSelects().mutate(s);
-            s = PartitionLoops().mutate(s);
+            s = PartitionLoops(budget).mutate(s);
             s = RenormalizeGPULoops().mutate(s);
             s = CollapseSelects().mutate(s);
             return s;
         }
-    } mutator;
+
+    public:
+        PartitionBudget &budget;
+        Mutator(PartitionBudget &budget)
+            : budget(budget) {
+        }
+    } mutator(budget);
     s = mutator.mutate(s);
 
+    if (budget.enabled) {
+        for (const auto &it : budget.decisions) {
+            debug(1) << "Partitioning loop " << it.first << ": " << it.second << "\n";
+            if (auto *logger = get_compiler_logger()) {
+                logger->record_loop_partition(it.first, it.second);
+            }
+        }
+        for (const auto &it : budget.bodies_used) {
+            debug(1) << "Partitioning loops made " << it.second << " extra loop bodies for " << it.first << "\n";
+        }
+    }
+
     s = remove_likelies(s);
     return s;
 }
@@ -10,6 +10,9 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Return true if an expression uses a likely tag that isn't captured
@@ -21,8 +24,13 @@ bool has_likely_tag(const Expr &e);
 
 /** Partitions loop bodies into a prologue, a steady state, and an
  * epilogue. Finds the steady state by hunting for use of clamped
- * ramps, or the 'likely' intrinsic. */
-Stmt partition_loops(Stmt s);
+ * ramps, or the 'likely' intrinsic. With Target::PartitionCostModel,
+ * loops with a constant bound on their extent are only partitioned if
+ * the steady state runs at least four times as often as the prologue
+ * and epilogue, and each Func gets at most HL_PARTITION_LOOPS_BUDGET
+ * (default 8) extra copies of its loop bodies. What was done to each
+ * loop is reported at debug level 1 and to the compiler log. */
+Stmt partition_loops(Stmt s, const Target &t);
 
 }  // namespace Internal
 }  // namespace Halide
@@ -1,5 +1,11 @@
 #include <algorithm>
 #include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <list>
+#include <mutex>
+#include <sstream>
 #include <utility>
 
 #include "Argument.h"
@@ -9,6 +15,7 @@
 #include "Func.h"
 #include "IRVisitor.h"
 #include "InferArguments.h"
+#include "JITCodeCache.h"
 #include "LLVM_Output.h"
 #include "Lower.h"
 #include "Module.h"
@@ -60,6 +67,10 @@ std::map<OutputFileType, std::string> object_file_outputs(const string &filename
     return outputs;
 }
 
+// The number of distinct lowerings of a Pipeline to keep JIT-compiled
+// code for.
+constexpr size_t max_recent_jit_caches = 16;
+
 std::string sanitize_function_name(const std::string &s) {
     string name = s;
     for (char &c : name) {
@@ -105,6 +116,242 @@ public:
     JITCallArgs &operator=(JITCallArgs &&other) = delete;
 };
 
+// Host allocations for the outputs of Pipeline::realize(sizes). When
+// the last Buffer referring to one lets go of it, it comes back here
+// rather than being freed, so that the next realization of the same
+// shape can reuse it. The pool stays alive after its Pipeline is
+// destroyed until all of its allocations have been released.
+class OutputAllocationPool {
+    // The start of each allocation. The Buffer puts its reference
+    // count in the header.
+    struct Block {
+        alignas(Runtime::AllocationHeader) uint8_t header[sizeof(Runtime::AllocationHeader)];
+        OutputAllocationPool *pool;
+        size_t size;
+    };
+
+    static constexpr size_t alignment = 128;
+
+    std::mutex mutex;
+    bool pipeline_alive = true;
+    size_t blocks_in_use = 0;
+    // The released allocations, least recently released first, and
+    // their total size.
+    vector<Block *> free_blocks;
+    size_t free_bytes = 0;
+    // The most bytes of released allocations to hold on to.
+    size_t limit = Pipeline::default_buffer_pool_limit;
+
+    // Free the least recently released allocations until the rest fit
+    // in the limit.
+    void trim_already_locked() {
+        size_t n = 0;
+        while (free_bytes > limit) {
+            free_bytes -= free_blocks[n]->size;
+            free(free_blocks[n]);
+            n++;
+        }
+        free_blocks.erase(free_blocks.begin(), free_blocks.begin() + n);
+    }
+
+    static void release(void *storage) {
+        Block *block = (Block *)storage;
+        OutputAllocationPool *pool = block->pool;
+        bool destroy_pool;
+        {
+            std::lock_guard<std::mutex> lock(pool->mutex);
+            if (pool->pipeline_alive && block->size <= pool->limit) {
+                pool->free_blocks.push_back(block);
+                pool->free_bytes += block->size;
+                pool->trim_already_locked();
+            } else {
+                free(block);
+            }
+            pool->blocks_in_use--;
+            destroy_pool = !pool->pipeline_alive && pool->blocks_in_use == 0;
+        }
+        if (destroy_pool) {
+            delete pool;
+        }
+    }
+
+public:
+    /** Give the Buffer host memory, reusing a released allocation of
+     * the same size if there is one. */
+    void allocate(Buffer<> &buf) {
+        size_t size = (buf.size_in_bytes() + alignment - 1) & ~(alignment - 1);
+        Block *block = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (size_t i = free_blocks.size(); i > 0; i--) {
+                if (free_blocks[i - 1]->size == size) {
+                    block = free_blocks[i - 1];
+                    free_blocks.erase(free_blocks.begin() + (i - 1));
+                    free_bytes -= size;
+                    break;
+                }
+            }
+            blocks_in_use++;
+        }
+        if (!block) {
+            block = (Block *)malloc(sizeof(Block) + alignment - 1 + size);
+            user_assert(block) << "Out of memory allocating " << size << " bytes for the output of realize()\n";
+            block->pool = this;
+            block->size = size;
+        }
+        uint8_t *host = (uint8_t *)(((uintptr_t)(block + 1) + alignment - 1) & ~(alignment - 1));
+        buf.adopt_host_memory(host, block, release);
+    }
+
+    /** Set the most bytes of released allocations to hold on to,
+     * freeing the oldest ones if there are more than that already. */
+    void set_limit(size_t bytes) {
+        std::lock_guard<std::mutex> lock(mutex);
+        limit = bytes;
+        trim_already_locked();
+    }
+
+    /** Free all of the released allocations. */
+    void release_unused() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Block *block : free_blocks) {
+            free(block);
+        }
+        free_blocks.clear();
+        free_bytes = 0;
+    }
+
+    /** Called by the Pipeline when it is destroyed. Frees the released
+     * allocations, and deletes the pool if none are still in use. */
+    void release_pipeline() {
+        release_unused();
+        bool destroy_pool;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pipeline_alive = false;
+            destroy_pool = blocks_in_use == 0;
+        }
+        if (destroy_pool) {
+            delete this;
+        }
+    }
+};
+
+// The bytes of the prepared JIT arguments that the result of a bounds
+// query can depend on: the values of the scalars, and the types and
+// shapes of the buffers, but not their contents.
+vector<uint8_t> bounds_query_signature(const vector<InferredArgument> &inferred_args,
+                                       const Parameter &user_context_param,
+                                       const JITCallArgs &args) {
+    vector<uint8_t> signature;
+    auto append = [&](const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        signature.insert(signature.end(), bytes, bytes + size);
+    };
+    for (size_t i = 0; i < inferred_args.size(); i++) {
+        const InferredArgument &arg = inferred_args[i];
+        if (arg.param.defined() && arg.param.same_as(user_context_param)) {
+            continue;
+        }
+        const void *ptr = args.store[i];
+        if (arg.arg.is_buffer()) {
+            const halide_buffer_t *buf = (const halide_buffer_t *)ptr;
+            uint8_t state = !buf ? 0 : buf->is_bounds_query() ? 1 : 2;
+            append(&state, sizeof(state));
+            if (buf) {
+                append(&buf->type, sizeof(buf->type));
+                append(&buf->dimensions, sizeof(buf->dimensions));
+                append(buf->dim, buf->dimensions * sizeof(halide_dimension_t));
+            }
+        } else {
+            append(ptr, arg.arg.type.bytes());
+        }
+    }
+    return signature;
+}
+
+// The most distinct combinations of argument values that adaptive
+// specialization keeps counts for at once.
+constexpr size_t max_adaptive_specialization_keys = 64;
+
+Expr scalar_constant(Type t, const void *ptr) {
+    halide_scalar_value_t v;
+    memcpy(&v, ptr, t.bytes());
+    if (t.is_bool()) {
+        return make_bool(v.u.b);
+    }
+    switch (t.bits()) {
+    case 8:
+        return t.is_int() ? make_const(t, v.u.i8) : make_const(t, v.u.u8);
+    case 16:
+        return t.is_int() ? make_const(t, v.u.i16) : make_const(t, v.u.u16);
+    case 32:
+        return t.is_int() ? make_const(t, v.u.i32) : make_const(t, v.u.u32);
+    default:
+        return t.is_int() ? make_const(t, v.u.i64) : make_const(t, v.u.u64);
+    }
+}
+
+// Append the argument values of a call that adaptive specialization
+// bakes in to key: the integer and boolean scalars, and the extents
+// and strides of the buffers. If values is non-null, also record them
+// as constants to compile in, by name. Returns false if the call is a
+// bounds query, which can't be specialized.
+bool adaptive_specialization_key(const vector<InferredArgument> &inferred_args,
+                                 const Parameter &user_context_param,
+                                 const vector<Function> &outputs,
+                                 const JITCallArgs &args,
+                                 vector<uint8_t> &key,
+                                 std::map<string, Expr> *values) {
+    auto append = [&](const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        key.insert(key.end(), bytes, bytes + size);
+    };
+    auto add_buffer = [&](const string &name, const halide_buffer_t *buf) {
+        if (!buf || buf->is_bounds_query()) {
+            return false;
+        }
+        append(&buf->type, sizeof(buf->type));
+        append(&buf->dimensions, sizeof(buf->dimensions));
+        for (int d = 0; d < buf->dimensions; d++) {
+            append(&buf->dim[d].extent, sizeof(buf->dim[d].extent));
+            append(&buf->dim[d].stride, sizeof(buf->dim[d].stride));
+            if (values) {
+                (*values)[name + ".extent." + std::to_string(d)] = buf->dim[d].extent;
+                (*values)[name + ".stride." + std::to_string(d)] = buf->dim[d].stride;
+            }
+        }
+        return true;
+    };
+
+    size_t i = 0;
+    for (; i < inferred_args.size(); i++) {
+        const InferredArgument &arg = inferred_args[i];
+        if (arg.param.defined() && arg.param.same_as(user_context_param)) {
+            continue;
+        }
+        const Type &t = arg.arg.type;
+        if (arg.arg.is_buffer()) {
+            if (!add_buffer(arg.arg.name, (const halide_buffer_t *)args.store[i])) {
+                return false;
+            }
+        } else if (t.is_int() || t.is_uint() || t.is_bool()) {
+            append(args.store[i], t.bytes());
+            if (values) {
+                (*values)[arg.arg.name] = scalar_constant(t, args.store[i]);
+            }
+        }
+    }
+    for (const Function &f : outputs) {
+        for (const Parameter &p : f.output_buffers()) {
+            if (!add_buffer(p.name(), (const halide_buffer_t *)args.store[i++])) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
 }  // namespace Internal
 
 struct PipelineContents {
@@ -116,10 +363,59 @@ struct PipelineContents {
     // Cached jit-compiled code
     JITCache jit_cache;
 
+    /** The jit-compiled code for the most recent distinct lowerings of
+     * this pipeline, least recently used first, keyed by the
+     * fingerprint of the lowered Module and the externs it was linked
+     * against. Unlike jit_cache, this survives invalidate_cache(). */
+    vector<std::pair<std::string, JITCache>> recent_jit_caches;
+
+    /** The output shapes found by the most recent bounds query in
+     * realize(sizes), and everything they depend on: the target, the
+     * requested sizes, and the scalar values and buffer shapes that
+     * were passed in. A realize(sizes) that matches all of these skips
+     * the bounds query. */
+    struct BoundsQueryCache {
+        bool valid = false;
+        Target target;
+        vector<int32_t> sizes;
+        vector<uint8_t> signature;
+        vector<vector<halide_dimension_t>> output_shapes;
+    } bounds_query_cache;
+
+    /** Recycled host allocations for the outputs of realize(sizes). */
+    OutputAllocationPool *output_pool = new OutputAllocationPool;
+
+    /** See Pipeline::set_adaptive_specialization. */
+    struct AdaptiveSpecialization {
+        int threshold = 0;
+        int max_versions = 0;
+
+        /** The number of calls seen with each combination of argument
+         * values that doesn't have a version yet. */
+        std::map<vector<uint8_t>, int> counts;
+
+        struct Version {
+            vector<uint8_t> key;
+            /** The code being compiled in the background. Destroying
+             * it waits for the compilation to finish. */
+            std::future<JITCache> pending;
+            JITCache cache;
+            bool ready = false;
+        };
+        std::list<Version> versions;
+
+        void clear() {
+            counts.clear();
+            versions.clear();
+        }
+    } adaptive_specialization;
+
     /** Clear all cached state */
     void invalidate_cache() {
         module = Module("", Target());
         jit_cache = JITCache();
+        bounds_query_cache = BoundsQueryCache();
+        adaptive_specialization.clear();
     }
 
     // The outputs
@@ -159,6 +455,7 @@ struct PipelineContents {
 
     ~PipelineContents() {
         clear_custom_lowering_passes();
+        output_pool->release_pipeline();
     }
 
     void clear_custom_lowering_passes() {
@@ -583,7 +880,142 @@ void Pipeline::compile_jit(const Target &target_arg) {
 
     Module module = compile_to_module(args, generate_function_name(), target).resolve_submodules();
     std::map<std::string, JITExtern> lowered_externs = contents->jit_externs;
+
+    // Lowering is much cheaper than LLVM codegen, and tuning loops
+    // often come back to a schedule they have tried before, so check
+    // whether this exact Module was compiled recently. Externs are
+    // bound at compile time, so their addresses are part of the key.
+    std::ostringstream key;
+    key << jit_code_fingerprint(module, generate_function_name());
+    for (const auto &iter : contents->jit_externs) {
+        Pipeline pipeline = iter.second.pipeline();
+        void *address;
+        if (pipeline.defined()) {
+            pipeline.compile_jit(target);
+            address = pipeline.contents->jit_cache.jit_module.entrypoint_symbol().address;
+        } else {
+            address = iter.second.extern_c_function().address();
+        }
+        key << "extern " << iter.first << " " << address << "\n";
+    }
+
+    auto &recent = contents->recent_jit_caches;
+    for (auto it = recent.begin(); it != recent.end(); it++) {
+        if (it->first == key.str()) {
+            debug(2) << "Reusing jit module compiled earlier for the same lowered module\n";
+            std::rotate(it, it + 1, recent.end());
+            contents->jit_cache = recent.back().second;
+            return;
+        }
+    }
+
     contents->jit_cache = compile_jit_cache(module, std::move(args), contents->outputs, contents->jit_externs, target);
+
+    if (recent.size() >= max_recent_jit_caches) {
+        recent.erase(recent.begin());
+    }
+    recent.emplace_back(key.str(), contents->jit_cache);
+}
+
+void Pipeline::set_buffer_pool_limit(int64_t bytes) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(bytes >= 0) << "set_buffer_pool_limit requires a non-negative limit\n";
+    contents->output_pool->set_limit((size_t)bytes);
+}
+
+void Pipeline::release_buffer_pool() {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    contents->output_pool->release_unused();
+}
+
+void Pipeline::set_adaptive_specialization(int threshold, int max_versions) {
+    user_assert(defined()) << "Pipeline is undefined\n";
+    user_assert(threshold >= 0 && max_versions > 0)
+        << "set_adaptive_specialization requires a non-negative threshold and a positive maximum number of versions\n";
+    auto &adaptive = contents->adaptive_specialization;
+    adaptive.clear();
+    adaptive.threshold = threshold;
+    adaptive.max_versions = max_versions;
+}
+
+JITCache *Pipeline::find_adaptive_specialization(const Target &target, const JITCallArgs &args) {
+    auto &adaptive = contents->adaptive_specialization;
+    if (adaptive.threshold == 0 || target.arch == Target::WebAssembly) {
+        return nullptr;
+    }
+
+    vector<uint8_t> key;
+    if (!adaptive_specialization_key(contents->inferred_args, contents->user_context_arg.param,
+                                     contents->outputs, args, key, nullptr)) {
+        return nullptr;
+    }
+
+    for (auto &v : adaptive.versions) {
+        if (v.key != key) {
+            continue;
+        }
+        if (!v.ready && v.pending.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            v.cache = v.pending.get();
+            v.ready = true;
+        }
+        return v.ready ? &v.cache : nullptr;
+    }
+
+    if ((int)adaptive.versions.size() >= adaptive.max_versions) {
+        return nullptr;
+    }
+    if (adaptive.counts.size() >= max_adaptive_specialization_keys && !adaptive.counts.count(key)) {
+        // The values are too diverse to tell which are common. Start over.
+        adaptive.counts.clear();
+    }
+    if (++adaptive.counts[key] < adaptive.threshold) {
+        return nullptr;
+    }
+    adaptive.counts.erase(key);
+
+    std::map<string, Expr> values;
+    vector<uint8_t> unused_key;
+    adaptive_specialization_key(contents->inferred_args, contents->user_context_arg.param,
+                                contents->outputs, args, unused_key, &values);
+    if (debug::debug_level() >= 1) {
+        debug(1) << "Building a version of " << generate_function_name() << " specialized to:\n";
+        for (const auto &it : values) {
+            debug(1) << "  " << it.first << " = " << it.second << "\n";
+        }
+    }
+
+    // Lower on this thread, because lowering reads the Funcs, and
+    // leave only the compilation to machine code to the background.
+    vector<Argument> lowering_args;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        lowering_args.push_back(arg.arg);
+    }
+    vector<IRMutator *> custom_passes;
+    for (const CustomLoweringPass &p : contents->custom_lowering_passes) {
+        custom_passes.push_back(p.pass);
+    }
+    const Target &jit_target = contents->jit_cache.jit_target;
+    Module module = lower(contents->outputs, generate_function_name(), jit_target, lowering_args,
+                          LinkageType::ExternalPlusMetadata, contents->requirements,
+                          contents->trace_pipeline, custom_passes, values)
+                        .resolve_submodules();
+
+    adaptive.versions.emplace_back();
+    auto &version = adaptive.versions.back();
+    version.key = std::move(key);
+    auto compile = [module, lowering_args, outputs = contents->outputs,
+                    externs = contents->jit_externs, jit_target]() {
+        return compile_jit_cache(module, lowering_args, outputs, externs, jit_target);
+    };
+    if (contents->jit_externs.empty()) {
+        version.pending = std::async(std::launch::async, compile);
+        return nullptr;
+    }
+    // Compiling this also compiles the extern pipelines it calls,
+    // which must not happen off this thread.
+    version.cache = compile();
+    version.ready = true;
+    return &version.cache;
 }
 
 Callable Pipeline::compile_to_callable(const std::vector<Argument> &args_in, const Target &target_arg) {
@@ -706,7 +1138,7 @@ Realization Pipeline::realize(vector<int32_t> sizes, const Target &target,
 
 Realization Pipeline::realize(JITUserContext *context,
                               vector<int32_t> sizes,
-                              const Target &target,
+                              const Target &t,
                               const ParamMap &param_map) {
     user_assert(defined()) << "Pipeline is undefined\n";
     vector<Buffer<>> bufs;
@@ -719,21 +1151,80 @@ Realization Pipeline::realize(JITUserContext *context,
         }
     }
     Realization r(std::move(bufs));
+
+    Target target = t;
+    if (target.has_unknowns()) {
+        target = get_compiled_jit_target();
+        if (target.has_unknowns()) {
+            target = get_jit_target_from_environment();
+        }
+    }
+    compile_jit(target);
+
+    JITUserContext empty_jit_user_context{};
+    if (!context) {
+        context = &empty_jit_user_context;
+    }
+
+    // The output buffers stay where they are while they are shaped by
+    // the bounds query and then allocated, so one set of arguments
+    // serves both calls.
+    RealizationArg outputs(r);
+    JITCallArgs args(contents->inferred_args.size() + outputs.size());
+    prepare_jit_call_arguments(outputs, target, param_map,
+                               &context, false, args);
+
     // Do an output bounds query if we can. Otherwise just assume the
-    // output size is good.
-    if (!target.has_feature(Target::NoBoundsQuery)) {
-        realize(context, r, target, param_map);
+    // output size is good. The answer only depends on the requested
+    // sizes and the shapes and scalar values passed in, so if those
+    // are the same as last time, reuse the last answer.
+    const bool bounds_query = !target.has_feature(Target::NoBoundsQuery);
+    if (bounds_query) {
+        auto &cache = contents->bounds_query_cache;
+        vector<uint8_t> signature =
+            bounds_query_signature(contents->inferred_args, contents->user_context_arg.param, args);
+        if (cache.valid &&
+            cache.target == target &&
+            cache.sizes == sizes &&
+            cache.signature == signature) {
+            debug(2) << "Reusing the last output bounds query\n";
+            for (size_t i = 0; i < r.size(); i++) {
+                halide_buffer_t *buf = r[i].raw_buffer();
+                std::copy(cache.output_shapes[i].begin(), cache.output_shapes[i].end(), buf->dim);
+            }
+        } else {
+            JITFuncCallContext jit_call_context(context, jit_handlers());
+            int exit_status = call_jit_code(target, args);
+            contents->jit_cache.finish_profiling(context);
+            jit_call_context.finalize(exit_status);
+
+            cache.valid = true;
+            cache.target = target;
+            cache.sizes = sizes;
+            cache.signature = std::move(signature);
+            cache.output_shapes.resize(r.size());
+            for (size_t i = 0; i < r.size(); i++) {
+                const halide_buffer_t *buf = r[i].raw_buffer();
+                cache.output_shapes[i].assign(buf->dim, buf->dim + buf->dimensions);
+            }
+        }
     }
     for (size_t i = 0; i < r.size(); i++) {
-        r[i].allocate();
+        contents->output_pool->allocate(r[i]);
     }
+
     // Do the actual computation
-    realize(context, r, target, param_map);
+    {
+        JITFuncCallContext jit_call_context(context, jit_handlers());
+        int exit_status = call_jit_code(target, args);
+        contents->jit_cache.finish_profiling(context);
+        jit_call_context.finalize(exit_status);
+    }
 
     // Crop back to the requested size if necessary
     bool needs_crop = false;
     vector<std::pair<int32_t, int32_t>> crop;
-    if (!target.has_feature(Target::NoBoundsQuery)) {
+    if (bounds_query) {
         crop.resize(sizes.size());
         for (size_t d = 0; d < sizes.size(); d++) {
             needs_crop |= ((r[0].dim(d).extent() != sizes[d]) ||
@@ -912,6 +1403,9 @@ Pipeline::make_externs_jit_module(const Target &target,
 }
 
 int Pipeline::call_jit_code(const Target &target, const JITCallArgs &args) {
+    if (JITCache *specialized = find_adaptive_specialization(target, args)) {
+        return specialized->call_jit_code(target, args.store);
+    }
     return contents->jit_cache.call_jit_code(target, args.store);
 }
 
@@ -1156,6 +1650,112 @@ void Pipeline::infer_input_bounds(JITUserContext *context,
     infer_input_bounds(context, r, target, param_map);
 }
 
+void Pipeline::realize_tiled(const std::vector<int32_t> &sizes,
+                             const std::vector<int32_t> &tile_sizes,
+                             const TiledInputFn &fill_input,
+                             const TiledOutputFn &consume_output,
+                             const Target &target,
+                             const ParamMap &param_map) {
+    realize_tiled(nullptr, sizes, tile_sizes, fill_input, consume_output, target, param_map);
+}
+
+void Pipeline::realize_tiled(JITUserContext *context,
+                             const std::vector<int32_t> &sizes,
+                             const std::vector<int32_t> &tile_sizes,
+                             const TiledInputFn &fill_input,
+                             const TiledOutputFn &consume_output,
+                             const Target &target,
+                             const ParamMap &param_map) {
+    user_assert(defined()) << "Can't realize_tiled an undefined Pipeline.\n";
+    user_assert(sizes.size() == tile_sizes.size())
+        << "realize_tiled() was given " << sizes.size() << " output sizes but "
+        << tile_sizes.size() << " tile sizes.\n";
+    for (size_t d = 0; d < sizes.size(); d++) {
+        user_assert(tile_sizes[d] > 0) << "realize_tiled() tile sizes must be positive.\n";
+        if (sizes[d] <= 0) {
+            return;
+        }
+    }
+    for (auto &out : contents->outputs) {
+        user_assert((int)sizes.size() == out.dimensions())
+            << "Func " << out.name() << " is defined with " << out.dimensions()
+            << " dimensions, but realize_tiled() is requesting tiles with " << sizes.size() << " dimensions.\n";
+    }
+    compile_jit(target);
+
+    // The ImageParams to bind to each tile's input regions.
+    vector<Parameter> inputs;
+    for (const InferredArgument &arg : contents->inferred_args) {
+        if (!arg.param.defined() || !arg.param.is_buffer()) {
+            continue;
+        }
+        Parameter p = arg.param;
+        Buffer<> *buf_out_param = nullptr;
+        if (&param_map.map(p, buf_out_param) == &p && !p.buffer().defined()) {
+            inputs.push_back(p);
+        }
+    }
+
+    const int dims = (int)sizes.size();
+    vector<int32_t> tile_min(dims, 0);
+    while (true) {
+        vector<int32_t> tile_extent(dims);
+        for (int d = 0; d < dims; d++) {
+            tile_extent[d] = std::min(tile_sizes[d], sizes[d] - tile_min[d]);
+        }
+
+        // Make unallocated output buffers covering the tile, and let
+        // bounds inference size the inputs, and the outputs if they need
+        // to be bigger than the tile.
+        vector<Buffer<>> bufs;
+        for (auto &out : contents->outputs) {
+            for (Type t : out.output_types()) {
+                Buffer<> buf(t, nullptr, tile_extent);
+                buf.set_min(tile_min);
+                bufs.push_back(std::move(buf));
+            }
+        }
+        Realization r(std::move(bufs));
+        infer_input_bounds(context, r, target, param_map);
+        for (Parameter &p : inputs) {
+            Buffer<> region = p.buffer();
+            fill_input(p.name(), region);
+        }
+        if (!target.has_feature(Target::NoBoundsQuery)) {
+            realize(context, r, target, param_map);
+        }
+        for (size_t i = 0; i < r.size(); i++) {
+            r[i].allocate();
+        }
+        realize(context, r, target, param_map);
+
+        for (size_t i = 0; i < r.size(); i++) {
+            r[i].copy_to_host();
+            for (int d = 0; d < dims; d++) {
+                r[i].crop(d, tile_min[d], tile_extent[d]);
+            }
+        }
+        consume_output(r);
+
+        // Drop this tile's buffers before making the next one's.
+        for (Parameter &p : inputs) {
+            p.set_buffer(Buffer<>());
+        }
+
+        int d = 0;
+        for (; d < dims; d++) {
+            tile_min[d] += tile_sizes[d];
+            if (tile_min[d] < sizes[d]) {
+                break;
+            }
+            tile_min[d] = 0;
+        }
+        if (d == dims) {
+            break;
+        }
+    }
+}
+
 void Pipeline::invalidate_cache() {
     if (defined()) {
         contents->invalidate_cache();
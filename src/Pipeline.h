@@ -163,6 +163,10 @@ private:
 
     int call_jit_code(const Target &target, const Internal::JITCallArgs &args);
 
+    // Record the argument values of a call for adaptive specialization,
+    // and return the specialized code to call instead, if it's ready.
+    Internal::JITCache *find_adaptive_specialization(const Target &target, const Internal::JITCallArgs &args);
+
     // Get the value of contents->jit_target, but reality-check that the contents
     // sensibly match the value. Return Target() if not jitted.
     Target get_compiled_jit_target() const;
@@ -338,9 +342,56 @@ public:
      * wish to avoid including the time taken to compile a pipeline,
      * then you can call this ahead of time. Default is to use the Target
      * returned from Halide::get_jit_target_from_environment()
+     *
+     * The pipeline keeps the machine code for the last few distinct
+     * lowerings it compiled. If a change to the schedule,
+     * specializations or Target is later undone, the pipeline is
+     * lowered again but the earlier code is reused without running
+     * LLVM.
      */
     void compile_jit(const Target &target = get_jit_target_from_environment());
 
+    /** Specialize the jit-compiled code to the argument values it is
+     * actually called with. Every realization records the values of
+     * the integer and boolean scalar Params, and the extents and
+     * strides of the buffers, that it was called with. Once one
+     * combination of them has been seen on threshold calls, a version
+     * of the pipeline with those values compiled in as constants is
+     * built on a background thread. Calls with exactly that
+     * combination use it as soon as it is ready, and all other calls
+     * keep using the generic version. At most max_versions are built
+     * until the pipeline is next recompiled. A threshold of zero (the
+     * default) turns this off. Bounds queries always use the generic
+     * version, as do pipelines jitted for WebAssembly.
+     *
+     * The Funcs in the pipeline must not be changed while a
+     * specialized version is being built. */
+    void set_adaptive_specialization(int threshold, int max_versions = 4);
+
+    /** The default limit of set_buffer_pool_limit. */
+    static constexpr int64_t default_buffer_pool_limit = 256 * 1024 * 1024;
+
+    /** Set the most bytes of host memory this Pipeline keeps for reuse
+     * between calls to realize. The host memory of the outputs of
+     * realize(sizes) comes from a pool belonging to this Pipeline: when
+     * the last Buffer referring to an output is destroyed, its memory
+     * goes back to the pool, and the next realization of the same size
+     * reuses it. When released memory takes the pool over its limit,
+     * the memory released longest ago is freed. A limit of zero turns
+     * the pooling off.
+     *
+     * Device allocations, for outputs and intermediates alike, come
+     * from the pools of the GPU runtimes instead, which are shared by
+     * all JIT-compiled pipelines. Their limit is set with
+     * JITSharedRuntime::device_memory_pool_set_limit, and they are
+     * emptied with JITSharedRuntime::device_memory_pool_trim. */
+    void set_buffer_pool_limit(int64_t bytes);
+
+    /** Free the host memory held for reuse by the pool described
+     * above. Memory still in use is unaffected, and the pool stays
+     * enabled. */
+    void release_buffer_pool();
+
     /** Eagerly jit compile the function to machine code and return a callable
      * struct that behaves like a function pointer. The calling convention
      * will exactly match that of an AOT-compiled version of this Func
@@ -451,6 +502,41 @@ public:
                             const ParamMap &param_map = ParamMap::empty_map());
     // @}
 
+    /** Callbacks for realize_tiled. The first is given the name of an
+     * unbound ImageParam and a buffer allocated with the region of it
+     * that the next tile requires, to be filled in. The second is given
+     * the finished tile, with one Buffer per tuple component per output
+     * Func, each cropped to the tile. */
+    // @{
+    using TiledInputFn = std::function<void(const std::string &name, Buffer<> &region)>;
+    using TiledOutputFn = std::function<void(const Realization &tile)>;
+    // @}
+
+    /** Realize the pipeline over an output of the given sizes one tile
+     * at a time, so that the memory used for the inputs, intermediates
+     * and output is bounded by the tile size rather than by the size of
+     * the whole output. Tiles are visited with the first dimension
+     * innermost, and those at the far edges may be smaller than
+     * tile_sizes. For each tile, the regions of the unbound ImageParams
+     * it requires are found as in infer_input_bounds and passed to
+     * fill_input, the pipeline is run, and the result is passed to
+     * consume_output. The ImageParams are left unbound afterwards. */
+    // @{
+    void realize_tiled(const std::vector<int32_t> &sizes,
+                       const std::vector<int32_t> &tile_sizes,
+                       const TiledInputFn &fill_input,
+                       const TiledOutputFn &consume_output,
+                       const Target &target = get_jit_target_from_environment(),
+                       const ParamMap &param_map = ParamMap::empty_map());
+    void realize_tiled(JITUserContext *context,
+                       const std::vector<int32_t> &sizes,
+                       const std::vector<int32_t> &tile_sizes,
+                       const TiledInputFn &fill_input,
+                       const TiledOutputFn &consume_output,
+                       const Target &target = get_jit_target_from_environment(),
+                       const ParamMap &param_map = ParamMap::empty_map());
+    // @}
+
     /** Infer the arguments to the Pipeline, sorted into a canonical order:
      * all buffers (sorted alphabetically by name), followed by all non-buffers
      * (sorted alphabetically by name).
@@ -73,17 +73,51 @@ public:
     }
 };
 
+// Replace a tuned_prefetch_distance in a prefetch offset with a variable.
+class ReplaceTunedDistance : public IRMutator {
+    using IRMutator::visit;
+
+    const string &var;
+
+    Expr visit(const Call *op) override {
+        if (op->is_intrinsic(Call::tuned_prefetch_distance)) {
+            initial = op->args[0];
+            return Variable::make(Int(32), var);
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    Expr initial;
+
+    ReplaceTunedDistance(const string &var)
+        : var(var) {
+    }
+};
+
 class InjectPrefetch : public IRMutator {
 public:
-    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers)
+    InjectPrefetch(const map<string, Function> &e, const map<string, Box> &buffers,
+                   const vector<Function> &o)
         : env(e), external_buffers(buffers) {
+        for (const Function &f : o) {
+            outputs.insert(f.name());
+        }
     }
 
 private:
     const map<string, Function> &env;
     const map<string, Box> &external_buffers;
+    set<string> outputs;
     Scope<Box> buffer_bounds;
 
+    // The tuned prefetch distances in use inside each loop.
+    struct TunedDistance {
+        string var, site;
+        Expr initial;
+    };
+    map<string, vector<TunedDistance>> tuned_distances;
+
     using IRMutator::visit;
 
     Box get_buffer_bounds(const string &name, int dims) {
@@ -93,11 +127,10 @@ private:
             return b;
         }
 
-        // It is an external buffer.
-        user_assert(env.find(name) == env.end())
-            << "Prefetch to buffer \"" << name << "\" which has not been allocated\n";
-
+        // It is an external buffer, or an output of the pipeline.
         const auto &iter = external_buffers.find(name);
+        user_assert(env.find(name) == env.end() || outputs.count(name))
+            << "Prefetch to buffer \"" << name << "\" which has not been allocated\n";
         internal_assert(iter != external_buffers.end());
         return iter->second;
     }
@@ -112,13 +145,45 @@ private:
         return IRMutator::visit(op);
     }
 
+    // Look up the distance to prefetch at before the loop runs, and
+    // report how long the loop took while the distance is being tuned.
+    Stmt tune_prefetch_distance(const TunedDistance &t, Stmt loop) {
+        Expr raw = Variable::make(Int(32), t.var + ".raw");
+        Expr start = Variable::make(Int(64), t.var + ".start");
+        Expr tuning = raw < 0;
+        Expr now = Call::make(Int(64), "halide_current_time_ns", {}, Call::Extern);
+        Expr report = Call::make(Int(32), "halide_tuned_prefetch_distance_report",
+                                 {t.site, Variable::make(Int(32), t.var), now - start}, Call::Extern);
+        Stmt s = Block::make(std::move(loop), IfThenElse::make(tuning, Evaluate::make(report)));
+        s = LetStmt::make(t.var + ".start", Call::make(Int(64), Call::if_then_else, {tuning, now, make_zero(Int(64))}, Call::PureIntrinsic), s);
+        s = LetStmt::make(t.var, select(tuning, -raw, raw), s);
+        Expr distance = Call::make(Int(32), "halide_tuned_prefetch_distance", {t.site, t.initial}, Call::Extern);
+        return LetStmt::make(t.var + ".raw", distance, s);
+    }
+
+    Stmt visit(const For *op) override {
+        Stmt stmt = IRMutator::visit(op);
+        auto it = tuned_distances.find(op->name);
+        if (it != tuned_distances.end()) {
+            for (const TunedDistance &t : it->second) {
+                stmt = tune_prefetch_distance(t, std::move(stmt));
+            }
+            tuned_distances.erase(it);
+        }
+        return stmt;
+    }
+
     Stmt visit(const Prefetch *op) override {
         Stmt body = mutate(op->body);
 
-        const PrefetchDirective &p = op->prefetch;
+        PrefetchDirective p = op->prefetch;
         Expr at = Variable::make(Int(32), p.at);
         Expr from = Variable::make(Int(32), p.from);
 
+        string tuned_var = p.at + ".prefetch_distance." + p.name;
+        ReplaceTunedDistance replace_tuned(tuned_var);
+        p.offset = replace_tuned.mutate(p.offset);
+
         // Add loop variable + prefetch offset to interval scope for box computation
         Expr fetch_at = from + p.offset;
         map<string, Box> boxes_rw = boxes_touched(LetStmt::make(p.from, fetch_at, body));
@@ -163,7 +228,10 @@ private:
                 condition = simplify(prefetch_box.used && condition);
             }
             internal_assert(!new_bounds.empty());
-            return Prefetch::make(op->name, op->types, new_bounds, op->prefetch, std::move(condition), std::move(body));
+            if (replace_tuned.initial.defined()) {
+                tuned_distances[p.at].push_back({tuned_var, p.name + "@" + p.at, replace_tuned.initial});
+            }
+            return Prefetch::make(op->name, op->types, new_bounds, p, std::move(condition), std::move(body));
         }
 
         if (!body.same_as(op->body)) {
@@ -260,6 +328,17 @@ private:
     }
 };
 
+// A prefetch intrinsic for memory that is about to be written carries a
+// trailing 1 after its {extent, stride} pairs.
+bool prefetch_is_write(const Call *prefetch) {
+    return prefetch->args.size() % 2 == 1;
+}
+
+// The number of args up to and including the last {extent, stride} pair.
+size_t prefetch_dim_args(const Call *prefetch) {
+    return prefetch->args.size() & ~(size_t)1;
+}
+
 // Reduce the prefetch dimension if bigger than 'max_dim'. It keeps the 'max_dim'
 // innermost dimensions and replaces the rests with for-loops.
 class ReducePrefetchDimension : public IRMutator {
@@ -278,8 +357,8 @@ class ReducePrefetchDimension : public IRMutator {
         // the dimensions with larger strides and keep the smaller ones in
         // the prefetch call.
 
-        const size_t max_arg_size = 2 + 2 * max_dim;  // Prefetch: {base, offset, extent0, stride0, extent1, stride1, ...}
-        if (prefetch && (prefetch->args.size() > max_arg_size)) {
+        const size_t max_arg_size = 2 + 2 * max_dim;  // Prefetch: {base, offset, extent0, stride0, extent1, stride1, ..., [is_write]}
+        if (prefetch && (prefetch_dim_args(prefetch) > max_arg_size)) {
             const Expr &base_address = prefetch->args[0];
             const Expr &base_offset = prefetch->args[1];
 
@@ -288,7 +367,7 @@ class ReducePrefetchDimension : public IRMutator {
 
             vector<string> index_names;
             Expr new_offset = base_offset;
-            for (size_t i = max_arg_size; i < prefetch->args.size(); i += 2) {
+            for (size_t i = max_arg_size; i < prefetch_dim_args(prefetch); i += 2) {
                 // const Expr &extent = prefetch->args[i + 0];  // unused
                 const Expr &stride = prefetch->args[i + 1];
                 string index_name = "prefetch_reduce_" + base->name + "." + std::to_string((i - 1) / 2);
@@ -300,6 +379,9 @@ class ReducePrefetchDimension : public IRMutator {
             for (size_t i = 2; i < max_arg_size; ++i) {
                 args.push_back(prefetch->args[i]);
             }
+            if (prefetch_is_write(prefetch)) {
+                args.push_back(1);
+            }
 
             stmt = Evaluate::make(Call::make(prefetch->type, Call::prefetch, args, Call::Intrinsic));
             for (size_t i = 0; i < index_names.size(); ++i) {
@@ -344,7 +426,7 @@ class SplitPrefetch : public IRMutator {
             vector<string> index_names;
             vector<Expr> extents;
             Expr new_offset = base_offset;
-            for (size_t i = 2; i < prefetch->args.size(); i += 2) {
+            for (size_t i = 2; i < prefetch_dim_args(prefetch); i += 2) {
                 Expr extent = prefetch->args[i];
                 Expr stride = prefetch->args[i + 1];
                 Expr stride_bytes = stride * elem_size;
@@ -372,6 +454,9 @@ class SplitPrefetch : public IRMutator {
             Expr new_extent = 1;
             Expr new_stride = simplify(max_byte_size / elem_size);
             vector<Expr> args = {base, std::move(new_offset), std::move(new_extent), std::move(new_stride)};
+            if (prefetch_is_write(prefetch)) {
+                args.push_back(1);
+            }
             stmt = Evaluate::make(Call::make(prefetch->type, Call::prefetch, args, Call::Intrinsic));
             for (size_t i = 0; i < index_names.size(); ++i) {
                 stmt = For::make(index_names[i], 0, extents[i],
@@ -439,10 +524,16 @@ Stmt inject_placeholder_prefetch(const Stmt &s, const map<string, Function> &env
     return stmt;
 }
 
-Stmt inject_prefetch(const Stmt &s, const map<string, Function> &env) {
+Stmt inject_prefetch(const Stmt &s, const map<string, Function> &env,
+                     const vector<Function> &outputs) {
     CollectExternalBufferBounds finder;
     s.accept(&finder);
-    return InjectPrefetch(env, finder.buffers).mutate(s);
+    for (const Function &f : outputs) {
+        if (f.outputs() == 1) {
+            finder.add_buffer_bounds(f.name(), Buffer<>(), f.output_buffers()[0], f.dimensions());
+        }
+    }
+    return InjectPrefetch(env, finder.buffers, outputs).mutate(s);
 }
 
 Stmt reduce_prefetch_dimension(Stmt stmt, const Target &t) {
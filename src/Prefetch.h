@@ -28,8 +28,10 @@ Stmt inject_placeholder_prefetch(const Stmt &s, const std::map<std::string, Func
                                  const std::vector<PrefetchDirective> &prefetches);
 /** Compute the actual region to be prefetched and place it to the
  * placholder prefetch. Wrap the prefetch call with condition when
- * applicable. */
-Stmt inject_prefetch(const Stmt &s, const std::map<std::string, Function> &env);
+ * applicable. Prefetches of the outputs are bounded by the output
+ * buffers. */
+Stmt inject_prefetch(const Stmt &s, const std::map<std::string, Function> &env,
+                     const std::vector<Function> &outputs);
 
 /** Reduce a multi-dimensional prefetch into a prefetch of lower dimension
  * (max dimension of the prefetch is specified by target architecture).
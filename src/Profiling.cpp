@@ -1,6 +1,9 @@
 #include <algorithm>
+#include <fstream>
 #include <limits>
 #include <map>
+#include <mutex>
+#include <sstream>
 #include <string>
 
 #include "CodeGen_Internal.h"
@@ -63,6 +66,27 @@ Stmt claim_sampling_token(const Stmt &s, const Expr &shared_token, const Expr &l
                                       release_sampling_token(shared_token, local_token)}));
 }
 
+// The branches the instrumented profiler counts, and that a branch
+// profile can guide, are the host IfThenElse nodes at the top level of
+// a produce node, i.e. outside of all of its loops. These include the
+// choice between a Func's specializations. Each is identified by the
+// Func and the text of its condition, which is stable across
+// compilations of the same pipeline. Conditions containing tabs or
+// newlines would make the profile file ambiguous, so are skipped.
+string branch_name(const string &func, const Expr &condition) {
+    std::ostringstream name;
+    name << condition;
+    if (name.str().find_first_of("\t\n") != string::npos) {
+        return string();
+    }
+    return func + "\t" + name.str();
+}
+
+Stmt count_branch(const Expr &profiler_pipeline_state, int branch, bool taken) {
+    return Evaluate::make(Call::make(Int(32), "halide_profiler_count_branch",
+                                     {profiler_pipeline_state, branch, (int)taken}, Call::Extern));
+}
+
 class InjectProfiling : public IRMutator {
 
 public:
@@ -76,8 +100,13 @@ public:
     bool in_parallel = false;
     bool in_leaf_task = false;
 
-    InjectProfiling(const string &pipeline_name)
-        : pipeline_name(pipeline_name) {
+    // If true, time each Func with calls that read the clock on entry
+    // to and exit from its produce node, rather than reporting the
+    // current Func to a sampling profiler.
+    bool instrumented;
+
+    InjectProfiling(const string &pipeline_name, bool instrumented)
+        : pipeline_name(pipeline_name), instrumented(instrumented) {
         stack.push_back(get_func_id("overhead"));
         // ID 0 is treated specially in the runtime as overhead
         internal_assert(stack.back() == 0);
@@ -91,9 +120,20 @@ public:
         profiler_shared_sampling_token = Variable::make(Handle(), "profiler_shared_sampling_token");
     }
 
+    // Mutate the whole pipeline body. In instrumented mode, time not
+    // spent inside any produce node is billed to overhead.
+    Stmt mutate_pipeline(const Stmt &s) {
+        if (instrumented) {
+            return instrument(stack.back(), halide_profiler_region_pipeline, Expr(), [&]() { return mutate(s); });
+        }
+        return mutate(s);
+    }
+
     map<int, uint64_t> func_stack_current;  // map from func id -> current stack allocation
     map<int, uint64_t> func_stack_peak;     // map from func id -> peak stack allocation
 
+    map<string, int> branch_indices;  // maps from branch name -> index in buffer.
+
 private:
     using IRMutator::visit;
 
@@ -118,6 +158,15 @@ private:
 
     bool profiling_memory = true;
 
+    // In instrumented mode, the accumulator that time spent in nested
+    // timed regions on this thread should be added to. Undefined if
+    // there is no enclosing timed region on this thread.
+    Expr parent_child_time;
+
+    // In instrumented mode, the produce node we are at the top level
+    // of, if any. Branches are only counted there.
+    string branch_func;
+
     // Strip down the tuple name, e.g. f.0 into f
     string normalize_name(const string &name) {
         vector<string> v = split_string(name, ".");
@@ -139,7 +188,7 @@ private:
     }
 
     Stmt set_current_func(int id) {
-        if (most_recently_set_func == id) {
+        if (instrumented || most_recently_set_func == id) {
             return Evaluate::make(0);
         }
         most_recently_set_func = id;
@@ -151,6 +200,39 @@ private:
         return s;
     }
 
+    // Wrap the statement produced by make_body in a region timed by the
+    // instrumented profiler. The region bills its time, less the time
+    // spent in any regions nested inside it, to the Func with the given
+    // id (or to nothing if it's negative), and adds its total time to
+    // parent's accumulator (if defined). The kind is a
+    // halide_profiler_region_kind_t.
+    template<typename F>
+    Stmt instrument(int id, int kind, const Expr &parent, F make_body) {
+        string child_time_name = unique_name("profiler_child_time");
+        string start_name = unique_name("profiler_start_time");
+        Expr child_time = Variable::make(Handle(), child_time_name);
+        Expr start = Variable::make(UInt(64), start_name);
+
+        Stmt body;
+        {
+            ScopedValue<Expr> bind(parent_child_time, child_time);
+            body = make_body();
+        }
+
+        Expr parent_arg = parent.defined() ? parent : reinterpret(Handle(), cast<uint64_t>(0));
+        Expr begin = Call::make(UInt(64), "halide_profiler_instrument_begin",
+                                {child_time}, Call::Extern);
+        Expr end = Call::make(Int(32), "halide_profiler_instrument_end",
+                              {profiler_pipeline_state, id, start, child_time,
+                               parent_arg, kind},
+                              Call::Extern);
+        Stmt s = Block::make(body, Evaluate::make(end));
+        s = LetStmt::make(start_name, begin, s);
+        s = LetStmt::make(child_time_name,
+                          Call::make(Handle(), Call::alloca, {UInt(64).bytes()}, Call::Intrinsic), s);
+        return s;
+    }
+
     Expr compute_allocation_size(const vector<Expr> &extents,
                                  const Expr &condition,
                                  const Type &type,
@@ -281,7 +363,16 @@ private:
     Stmt visit(const ProducerConsumer *op) override {
         int idx;
         Stmt body;
-        if (op->is_producer) {
+        if (instrumented) {
+            if (!op->is_producer) {
+                return IRMutator::visit(op);
+            }
+            idx = get_func_id(op->name);
+            stack.push_back(idx);
+            ScopedValue<string> bind(branch_func, normalize_name(op->name));
+            body = instrument(idx, halide_profiler_region_produce, parent_child_time, [&]() { return mutate(op->body); });
+            stack.pop_back();
+        } else if (op->is_producer) {
             idx = get_func_id(op->name);
             stack.push_back(idx);
             Stmt set_current = set_current_func(idx);
@@ -303,6 +394,10 @@ private:
             s = Fork::make(visit_parallel_task(f->first), visit_parallel_task(f->rest));
         } else if (const Acquire *a = s.as<Acquire>()) {
             s = Acquire::make(a->semaphore, a->count, visit_parallel_task(a->body));
+        } else if (instrumented) {
+            // The task may run on another thread, so it starts a fresh
+            // region billed to the enclosing Func.
+            s = instrument(stack.back(), halide_profiler_region_task, Expr(), [&]() { return mutate(s); });
         } else {
             s = activate_thread(mutate(s), profiler_state);
         }
@@ -313,17 +408,50 @@ private:
     }
 
     Stmt visit(const Acquire *op) override {
+        if (instrumented) {
+            return IRMutator::visit(op);
+        }
         Stmt s = visit_parallel_task(op);
         return suspend_thread(s, profiler_state);
     }
 
     Stmt visit(const Fork *op) override {
         ScopedValue<bool> bind(in_fork, true);
+        if (instrumented) {
+            // Time spent waiting for the tasks is accounted for by the
+            // tasks themselves, so it's excluded from the enclosing region.
+            return instrument(-1, halide_profiler_region_none, parent_child_time, [&]() { return visit_parallel_task(op); });
+        }
         Stmt s = visit_parallel_task(op);
         return suspend_thread(s, profiler_state);
     }
 
+    Stmt visit_instrumented(const For *op) {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Don't enter device loops. Time spent launching and
+            // waiting on the device is billed to the enclosing Func.
+            return instrument(stack.back(), halide_profiler_region_device, parent_child_time,
+                              [&]() { return Stmt(op); });
+        }
+        if (!op->is_unordered_parallel()) {
+            return IRMutator::visit(op);
+        }
+        // Each iteration is a fresh region billed to the enclosing
+        // Func on whichever thread runs it. The loop as a whole is
+        // excluded from the enclosing region, as for a Fork.
+        return instrument(-1, halide_profiler_region_none, parent_child_time, [&]() {
+            Stmt body = instrument(stack.back(), halide_profiler_region_task, Expr(), [&]() { return mutate(op->body); });
+            return For::make(op->name, op->min, op->extent, op->for_type, op->device_api, body);
+        });
+    }
+
     Stmt visit(const For *op) override {
+        if (instrumented) {
+            ScopedValue<string> bind(branch_func, string());
+            return visit_instrumented(op);
+        }
+
         Stmt body = op->body;
 
         // The for loop indicates a device transition or a
@@ -405,7 +533,22 @@ private:
         return stmt;
     }
 
+    Stmt visit(const LetStmt *op) override {
+        const Call *call = op->value.as<Call>();
+        if (instrumented && call && call->call_type == Call::Extern &&
+            (call->name == "halide_copy_to_host" ||
+             call->name == "halide_copy_to_device" ||
+             call->name == "halide_buffer_copy")) {
+            // Host <-> device copies are injected as a let of the call's
+            // result followed by an assert that it succeeded.
+            return instrument(stack.back(), halide_profiler_region_copy, parent_child_time,
+                              [&]() { return IRMutator::visit(op); });
+        }
+        return IRMutator::visit(op);
+    }
+
     Stmt visit(const IfThenElse *op) override {
+        string name = branch_func.empty() ? string() : branch_name(branch_func, op->condition);
         int old = most_recently_set_func;
         Expr condition = mutate(op->condition);
         Stmt then_case = mutate(op->then_case);
@@ -415,6 +558,12 @@ private:
         if (most_recently_set_func != func_computed_in_then) {
             most_recently_set_func = -1;
         }
+        if (!name.empty()) {
+            auto it = branch_indices.emplace(name, (int)branch_indices.size()).first;
+            then_case = Block::make(count_branch(profiler_pipeline_state, it->second, true), then_case);
+            Stmt count_else = count_branch(profiler_pipeline_state, it->second, false);
+            else_case = else_case.defined() ? Block::make(count_else, else_case) : count_else;
+        }
         if (condition.same_as(op->condition) &&
             then_case.same_as(op->then_case) &&
             else_case.same_as(op->else_case)) {
@@ -426,9 +575,10 @@ private:
 
 }  // namespace
 
-Stmt inject_profiling(Stmt s, const string &pipeline_name) {
-    InjectProfiling profiling(pipeline_name);
-    s = profiling.mutate(s);
+Stmt inject_profiling(Stmt s, const string &pipeline_name, const Target &t) {
+    const bool instrumented = t.has_feature(Target::ProfileInstrumented);
+    InjectProfiling profiling(pipeline_name, instrumented);
+    s = profiling.mutate_pipeline(s);
 
     int num_funcs = (int)(profiling.indices.size());
 
@@ -456,17 +606,28 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
         s = Block::make(update_stack, s);
     }
 
-    Expr profiler_state = Variable::make(Handle(), "profiler_state");
+    if (!instrumented) {
+        Expr profiler_state = Variable::make(Handle(), "profiler_state");
 
-    s = activate_thread(s, profiler_state);
+        s = activate_thread(s, profiler_state);
 
-    // Initialize the shared sampling token
-    Expr shared_sampling_token_var = Variable::make(Handle(), "profiler_shared_sampling_token");
-    Expr init_sampling_token =
-        Call::make(Int(32), "halide_profiler_init_sampling_token", {shared_sampling_token_var, 0}, Call::Extern);
-    s = Block::make({Evaluate::make(init_sampling_token), s});
-    s = LetStmt::make("profiler_shared_sampling_token",
-                      Call::make(Handle(), Call::alloca, {Int(32).bytes()}, Call::Intrinsic), s);
+        // Initialize the shared sampling token
+        Expr shared_sampling_token_var = Variable::make(Handle(), "profiler_shared_sampling_token");
+        Expr init_sampling_token =
+            Call::make(Int(32), "halide_profiler_init_sampling_token", {shared_sampling_token_var, 0}, Call::Extern);
+        s = Block::make({Evaluate::make(init_sampling_token), s});
+        s = LetStmt::make("profiler_shared_sampling_token",
+                          Call::make(Handle(), Call::alloca, {Int(32).bytes()}, Call::Intrinsic), s);
+    }
+
+    int num_branches = (int)(profiling.branch_indices.size());
+    if (num_branches > 0) {
+        Expr branch_names_buf = Variable::make(Handle(), "profiling_branch_names");
+        Expr profiler_pipeline_state = Variable::make(Handle(), "profiler_pipeline_state");
+        Stmt register_branches = Evaluate::make(Call::make(Int(32), "halide_profiler_register_branches",
+                                                           {profiler_pipeline_state, num_branches, branch_names_buf}, Call::Extern));
+        s = Block::make(register_branches, s);
+    }
 
     s = LetStmt::make("profiler_pipeline_state", get_pipeline_state, s);
     s = LetStmt::make("profiler_state", get_state, s);
@@ -495,6 +656,15 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
     s = Block::make(s, Free::make("profiling_func_names"));
     s = Allocate::make("profiling_func_names", Handle(),
                        MemoryType::Auto, {num_funcs}, const_true(), s);
+
+    if (num_branches > 0) {
+        for (const auto &p : profiling.branch_indices) {
+            s = Block::make(Store::make("profiling_branch_names", p.first, p.second, Parameter(), const_true(), ModulusRemainder()), s);
+        }
+        s = Block::make(s, Free::make("profiling_branch_names"));
+        s = Allocate::make("profiling_branch_names", Handle(),
+                           MemoryType::Auto, {num_branches}, const_true(), s);
+    }
     s = Block::make(Evaluate::make(stop_profiler), s);
 
     // We have nested definitions of the sampling token
@@ -503,5 +673,118 @@ Stmt inject_profiling(Stmt s, const string &pipeline_name) {
     return s;
 }
 
+namespace {
+
+// Times taken and not taken for each branch, by pipeline name and
+// then by branch name.
+using BranchProfile = map<string, map<string, std::pair<uint64_t, uint64_t>>>;
+
+std::mutex branch_profile_mutex;
+
+BranchProfile &branch_profile() {
+    static BranchProfile profile;
+    return profile;
+}
+
+// Below this many samples a branch is left alone.
+constexpr uint64_t min_branch_samples = 64;
+
+class ApplyBranchProfile : public IRMutator {
+    using IRMutator::visit;
+
+    const map<string, std::pair<uint64_t, uint64_t>> &counts;
+
+    // The produce node we are at the top level of, if any.
+    string func;
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (!op->is_producer) {
+            return IRMutator::visit(op);
+        }
+        ScopedValue<string> bind(func, split_string(op->name, ".")[0]);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            return op;
+        }
+        ScopedValue<string> bind(func, string());
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const IfThenElse *op) override {
+        string name = func.empty() ? string() : branch_name(func, op->condition);
+        Stmt s = IRMutator::visit(op);
+        auto it = name.empty() ? counts.end() : counts.find(name);
+        if (it == counts.end()) {
+            return s;
+        }
+        uint64_t taken = it->second.first, not_taken = it->second.second;
+        if (taken + not_taken < min_branch_samples) {
+            return s;
+        }
+
+        op = s.as<IfThenElse>();
+        internal_assert(op);
+        if (taken >= 9 * not_taken) {
+            debug(3) << "Branch profile: " << name << " is likely\n";
+            return IfThenElse::make(likely(op->condition), op->then_case, op->else_case);
+        } else if (not_taken >= 9 * taken) {
+            // Invert the branch so that the hot side is the then case,
+            // which is the side codegen lays out on the fall-through
+            // path.
+            debug(3) << "Branch profile: " << name << " is unlikely\n";
+            Stmt else_case = op->else_case.defined() ? op->else_case : Evaluate::make(0);
+            return IfThenElse::make(likely(!op->condition), else_case, op->then_case);
+        }
+        return s;
+    }
+
+public:
+    ApplyBranchProfile(const map<string, std::pair<uint64_t, uint64_t>> &counts)
+        : counts(counts) {
+    }
+};
+
+}  // namespace
+
+void load_branch_profile(const string &filename) {
+    std::ifstream f(filename);
+    user_assert(f.is_open()) << "Could not open branch profile " << filename << "\n";
+
+    std::lock_guard<std::mutex> lock(branch_profile_mutex);
+    string line;
+    while (std::getline(f, line)) {
+        vector<string> v = split_string(line, "\t");
+        if (v.size() != 5) {
+            user_warning << "Ignoring malformed line in branch profile " << filename << ": " << line << "\n";
+            continue;
+        }
+        auto &c = branch_profile()[v[0]][v[1] + "\t" + v[2]];
+        c.first += std::strtoull(v[3].c_str(), nullptr, 10);
+        c.second += std::strtoull(v[4].c_str(), nullptr, 10);
+    }
+}
+
+bool have_branch_profile() {
+    std::lock_guard<std::mutex> lock(branch_profile_mutex);
+    return !branch_profile().empty();
+}
+
+Stmt apply_branch_profile(const Stmt &s, const string &pipeline_name) {
+    map<string, std::pair<uint64_t, uint64_t>> counts;
+    {
+        std::lock_guard<std::mutex> lock(branch_profile_mutex);
+        auto it = branch_profile().find(pipeline_name);
+        if (it == branch_profile().end()) {
+            return s;
+        }
+        counts = it->second;
+    }
+    return ApplyBranchProfile(counts).mutate(s);
+}
+
 }  // namespace Internal
 }  // namespace Halide
@@ -26,6 +26,7 @@
 #include <string>
 
 #include "Expr.h"
+#include "Target.h"
 
 namespace Halide {
 namespace Internal {
@@ -36,8 +37,36 @@ namespace Internal {
  * times and counts will be logged at the end. Should be done before
  * storage flattening, but after all bounds inference.
  *
+ * If the target has the ProfileInstrumented feature, no sampling
+ * thread is used. Instead every produce node and parallel task is
+ * bracketed with calls that read the clock, so each Func is billed
+ * exactly for the time spent in it (excluding time spent in nested
+ * producers), and the number of times it is produced is counted.
+ * Device loops and host <-> device copies are timed as regions of
+ * their own, so that they show up in the trace exported when
+ * HL_PROFILER_TRACE_FILE is set. The branches at the top level of
+ * each produce node, such as the choice between specializations, are
+ * counted too, and appended to the file named by
+ * HL_PROFILER_BRANCH_FILE.
  */
-Stmt inject_profiling(Stmt, const std::string &);
+Stmt inject_profiling(Stmt, const std::string &, const Target &);
+
+/** Load a branch profile written by pipelines compiled with the
+ * ProfileInstrumented feature (see HL_PROFILER_BRANCH_FILE). Counts
+ * from repeated lines and from multiple profiles are summed.
+ * Subsequent lowering of the same pipelines uses it to mark the hot
+ * side of each branch that one side dominates. */
+void load_branch_profile(const std::string &filename);
+
+/** Whether load_branch_profile has loaded any branches. */
+bool have_branch_profile();
+
+/** Wrap the conditions of branches that went the same way at least 90%
+ * of the time in the loaded branch profile in likely(), inverting the
+ * branch if need be to put the hot side in the then case. Must be
+ * done at the same point in lowering as inject_profiling, so that the
+ * conditions match those that were counted. */
+Stmt apply_branch_profile(const Stmt &s, const std::string &pipeline_name);
 
 }  // namespace Internal
 }  // namespace Halide
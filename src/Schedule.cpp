@@ -219,9 +219,11 @@ struct FuncScheduleContents {
     std::vector<Bound> estimates;
     std::map<std::string, Internal::FunctionPtr> wrappers;
     MemoryType memory_type = MemoryType::Auto;
+    Type storage_type;
     bool memoized = false;
     bool async = false;
     Expr memoize_eviction_key;
+    Expr ring_buffer;
 
     FuncScheduleContents()
         : store_level(LoopLevel::inlined()), compute_level(LoopLevel::inlined()) {
@@ -257,6 +259,9 @@ struct FuncScheduleContents {
                 b.remainder = mutator->mutate(b.remainder);
             }
         }
+        if (ring_buffer.defined()) {
+            ring_buffer = mutator->mutate(ring_buffer);
+        }
     }
 };
 
@@ -338,9 +343,11 @@ FuncSchedule FuncSchedule::deep_copy(
     copy.contents->bounds = contents->bounds;
     copy.contents->estimates = contents->estimates;
     copy.contents->memory_type = contents->memory_type;
+    copy.contents->storage_type = contents->storage_type;
     copy.contents->memoized = contents->memoized;
     copy.contents->memoize_eviction_key = contents->memoize_eviction_key;
     copy.contents->async = contents->async;
+    copy.contents->ring_buffer = contents->ring_buffer;
 
     // Deep-copy wrapper functions.
     for (const auto &iter : contents->wrappers) {
@@ -360,6 +367,14 @@ MemoryType &FuncSchedule::memory_type() {
     return contents->memory_type;
 }
 
+Type FuncSchedule::storage_type() const {
+    return contents->storage_type;
+}
+
+Type &FuncSchedule::storage_type() {
+    return contents->storage_type;
+}
+
 bool &FuncSchedule::memoized() {
     return contents->memoized;
 }
@@ -384,6 +399,14 @@ bool FuncSchedule::async() const {
     return contents->async;
 }
 
+Expr &FuncSchedule::ring_buffer() {
+    return contents->ring_buffer;
+}
+
+Expr FuncSchedule::ring_buffer() const {
+    return contents->ring_buffer;
+}
+
 std::vector<StorageDim> &FuncSchedule::storage_dims() {
     return contents->storage_dims;
 }
@@ -477,6 +500,9 @@ void FuncSchedule::accept(IRVisitor *visitor) const {
     if (memoize_eviction_key().defined()) {
         memoize_eviction_key().accept(visitor);
     }
+    if (ring_buffer().defined()) {
+        ring_buffer().accept(visitor);
+    }
 }
 
 void FuncSchedule::mutate(IRMutator *mutator) {
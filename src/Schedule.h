@@ -122,6 +122,20 @@ enum class LoopAlignStrategy {
     Auto
 };
 
+/** Who gets a private copy of the Func in Stage::privatize. */
+enum class PrivatizeStrategy {
+    /** Each of the copies is reduced into by one parallel task, over a
+     * contiguous chunk of the RVar. The copies are stored one after the
+     * other, so tasks don't share cache lines. */
+    Parallel,
+
+    /** Each of the copies is reduced into by one vector lane, over every
+     * copies-th value of the RVar. The copies are interleaved, so the
+     * lanes of each vector access distinct, adjacent locations. This
+     * requires a commutative reduction. */
+    Vectorized,
+};
+
 /** A reference to a site in a Halide statement at the top of the
  * body of a particular for loop. Evaluating a region of a halide
  * function is done by generating a loop nest that spans its
@@ -489,6 +503,13 @@ struct StorageDim {
      * false). */
     Expr fold_factor;
     bool fold_forward;
+
+    /** If true, the bounds allocated are padded by one more multiple
+     * of "alignment" whenever the stride they give the next dimension
+     * would otherwise be a large power of two. If there is no
+     * alignment, it is a cache line or a native vector of the
+     * target, whichever is larger. Set by Func::pad_storage. */
+    bool pad_stride = false;
 };
 
 /** This represents two stages with fused loop nests from outermost to
@@ -577,6 +598,15 @@ public:
     bool &async();
     bool async() const;
 
+    /** The number of copies of this Function's storage kept in a
+     * ring, so that an async producer can run that many iterations
+     * of its compute loop ahead of its consumers. Undefined if the
+     * storage isn't ring buffered. */
+    // @{
+    Expr &ring_buffer();
+    Expr ring_buffer() const;
+    // @}
+
     /** The list and order of dimensions used to store this
      * function. The first dimension in the vector corresponds to the
      * innermost dimension for storage (i.e. which dimension is
@@ -592,6 +622,14 @@ public:
     MemoryType &memory_type();
     // @}
 
+    /** The type this Function's values are stored as, if narrower
+     * than the type they are computed in. Undefined if they are stored
+     * as computed. See \ref Func::store_as */
+    // @{
+    Type storage_type() const;
+    Type &storage_type();
+    // @}
+
     /** You may explicitly bound some of the dimensions of a function,
      * or constrain them to lie on multiples of a given factor. See
      * \ref Func::bound and \ref Func::align_bounds and \ref Func::align_extent. */
@@ -2114,7 +2114,8 @@ bool validate_schedule(Function f, const Stmt &s, const Target &target, bool is_
         set<string> parallel_vars;
         for (const Dim &d : s.dims()) {
             // We don't care about GPU parallelism here
-            if (d.for_type == ForType::Parallel) {
+            if (d.for_type == ForType::Parallel ||
+                d.for_type == ForType::MultiGPU) {
                 parallel_vars.insert(d.var);
             }
             if (!target.supports_device_api(d.device_api)) {
@@ -114,6 +114,11 @@ public:
         containing_scope = s;
     }
 
+    /** Get the parent scope, if any. */
+    const Scope<T> *get_containing_scope() const {
+        return containing_scope;
+    }
+
     /** A const ref to an empty scope. Useful for default function
      * arguments, which would otherwise require a copy constructor
      * (with llvm in c++98 mode) */
@@ -0,0 +1,1382 @@
+#include "Serialization.h"
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+
+#include "Buffer.h"
+#include "IR.h"
+#include "IREquality.h"
+#include "IROperator.h"
+#include "IRVisitor.h"
+#include "Parameter.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Bump this whenever the format changes.
+const uint32_t serialization_version = 1;
+
+const char serialization_magic[4] = {'H', 'L', 'I', 'R'};
+
+// What a serialized blob holds.
+enum class SerializedKind : uint8_t {
+    Expr,
+    Stmt,
+    Module,
+};
+
+// The tags that introduce each reference to an IR node, Parameter,
+// Buffer or handle type. A reference is either to nothing, to
+// something already written (by the index it was given), or a new
+// definition. IR nodes are written as their IRNodeType plus
+// FirstNodeTag instead of NewDefinition.
+enum ReferenceTag : uint8_t {
+    Undefined = 0,
+    BackReference = 1,
+    NewDefinition = 2,
+    FirstNodeTag = 2,
+};
+
+// Writes IR to a stream of variable-length integers, with a table of
+// the distinct strings used. Shared IR nodes, and the Parameters and
+// Buffers they refer to, are written once and referred back to after
+// that. Nodes are numbered in the order in which they are finished,
+// which is also the order in which the reader rebuilds them.
+class Serializer : public IRVisitor {
+public:
+    void write_varint(uint64_t v) {
+        while (v >= 0x80) {
+            out.push_back((uint8_t)(v | 0x80));
+            v >>= 7;
+        }
+        out.push_back((uint8_t)v);
+    }
+
+    void write_signed(int64_t v) {
+        // Zig-zag encode, so that small negative numbers stay small.
+        write_varint(((uint64_t)v << 1) ^ (uint64_t)(v >> 63));
+    }
+
+    void write_fixed64(uint64_t v) {
+        for (int i = 0; i < 8; i++) {
+            out.push_back((uint8_t)(v >> (8 * i)));
+        }
+    }
+
+    void write_bool(bool b) {
+        out.push_back(b ? 1 : 0);
+    }
+
+    void write_string(const string &s) {
+        auto it = string_ids.find(s);
+        if (it == string_ids.end()) {
+            it = string_ids.emplace(s, (uint32_t)strings.size()).first;
+            strings.push_back(s);
+        }
+        write_varint(it->second);
+    }
+
+    void write_handle_type(const halide_handle_cplusplus_type *t) {
+        if (!t) {
+            write_varint(Undefined);
+            return;
+        }
+        auto it = handle_type_ids.find(t);
+        if (it != handle_type_ids.end()) {
+            write_varint(BackReference);
+            write_varint(it->second);
+            return;
+        }
+        write_varint(NewDefinition);
+        auto write_name = [&](const halide_cplusplus_type_name &n) {
+            write_varint(n.cpp_type_type);
+            write_string(n.name);
+        };
+        write_name(t->inner_name);
+        write_varint(t->namespaces.size());
+        for (const string &n : t->namespaces) {
+            write_string(n);
+        }
+        write_varint(t->enclosing_types.size());
+        for (const auto &n : t->enclosing_types) {
+            write_name(n);
+        }
+        write_varint(t->cpp_type_modifiers.size());
+        for (uint8_t m : t->cpp_type_modifiers) {
+            write_varint(m);
+        }
+        write_varint(t->reference_type);
+        uint32_t id = (uint32_t)handle_type_ids.size();
+        handle_type_ids[t] = id;
+    }
+
+    void write_type(const Type &t) {
+        write_varint(t.code());
+        write_varint(t.bits());
+        write_varint(t.lanes());
+        if (t.is_handle()) {
+            write_handle_type(t.handle_type);
+        }
+    }
+
+    void write_types(const vector<Type> &types) {
+        write_varint(types.size());
+        for (const Type &t : types) {
+            write_type(t);
+        }
+    }
+
+    void write_node(const IRHandle &n) {
+        if (!n.defined()) {
+            write_varint(Undefined);
+            return;
+        }
+        auto it = node_ids.find(n.get());
+        if (it != node_ids.end()) {
+            write_varint(BackReference);
+            write_varint(it->second);
+            return;
+        }
+        write_varint((uint64_t)n->node_type + FirstNodeTag);
+        n.accept(this);
+        uint32_t id = (uint32_t)node_ids.size();
+        node_ids[n.get()] = id;
+    }
+
+    void write_exprs(const vector<Expr> &exprs) {
+        write_varint(exprs.size());
+        for (const Expr &e : exprs) {
+            write_node(e);
+        }
+    }
+
+    void write_region(const Region &region) {
+        write_varint(region.size());
+        for (const Range &r : region) {
+            write_node(r.min);
+            write_node(r.extent);
+        }
+    }
+
+    void write_alignment(const ModulusRemainder &a) {
+        write_signed(a.modulus);
+        write_signed(a.remainder);
+    }
+
+    void write_parameter(const Parameter &p) {
+        if (!p.defined()) {
+            write_varint(Undefined);
+            return;
+        }
+        auto it = parameter_ids.find(p);
+        if (it != parameter_ids.end()) {
+            write_varint(BackReference);
+            write_varint(it->second);
+            return;
+        }
+        write_varint(NewDefinition);
+        write_type(p.type());
+        write_bool(p.is_buffer());
+        write_varint(p.dimensions());
+        write_string(p.name());
+
+        // The constraints of a Parameter may refer to the Parameter
+        // itself, so it is numbered before they are written.
+        uint32_t id = (uint32_t)parameter_ids.size();
+        parameter_ids[p] = id;
+
+        if (p.is_buffer()) {
+            write_varint(p.host_alignment());
+            write_varint((uint64_t)p.memory_type());
+            for (int i = 0; i < p.dimensions(); i++) {
+                write_node(p.min_constraint(i));
+                write_node(p.extent_constraint(i));
+                write_node(p.stride_constraint(i));
+                write_node(p.min_constraint_estimate(i));
+                write_node(p.extent_constraint_estimate(i));
+            }
+        } else {
+            uint64_t bits = 0;
+            memcpy(&bits, p.scalar_address(), sizeof(bits));
+            write_fixed64(bits);
+            write_node(p.min_value());
+            write_node(p.max_value());
+            write_node(p.estimate());
+            write_node(p.default_value());
+        }
+    }
+
+    void write_buffer(const Buffer<> &b) {
+        if (!b.defined()) {
+            write_varint(Undefined);
+            return;
+        }
+        auto it = buffer_ids.find(b.raw_buffer());
+        if (it != buffer_ids.end()) {
+            write_varint(BackReference);
+            write_varint(it->second);
+            return;
+        }
+        write_varint(NewDefinition);
+        write_string(b.name());
+        write_type(b.type());
+        write_varint(b.dimensions());
+        vector<int> mins, sizes;
+        for (int i = 0; i < b.dimensions(); i++) {
+            write_signed(b.dim(i).min());
+            write_varint(b.dim(i).extent());
+            mins.push_back(b.dim(i).min());
+            sizes.push_back(b.dim(i).extent());
+        }
+        write_bool(b.data() != nullptr);
+        if (b.data()) {
+            // Write the contents densely, with the first dimension
+            // innermost, whatever the strides of the buffer.
+            Buffer<> dense(b.type(), sizes);
+            dense.set_min(mins);
+            dense.copy_from(b);
+            const uint8_t *begin = (const uint8_t *)dense.data();
+            out.insert(out.end(), begin, begin + dense.size_in_bytes());
+        }
+        uint32_t id = (uint32_t)buffer_ids.size();
+        buffer_ids[b.raw_buffer()] = id;
+    }
+
+    void write_argument(const LoweredArgument &arg) {
+        write_string(arg.name);
+        write_varint(arg.kind);
+        write_varint(arg.dimensions);
+        write_type(arg.type);
+        const ArgumentEstimates &e = arg.argument_estimates;
+        write_node(e.scalar_def);
+        write_node(e.scalar_min);
+        write_node(e.scalar_max);
+        write_node(e.scalar_estimate);
+        write_region(e.buffer_estimates);
+        write_alignment(arg.alignment);
+    }
+
+    void write_function(const LoweredFunc &f) {
+        write_string(f.name);
+        write_varint(f.args.size());
+        for (const LoweredArgument &arg : f.args) {
+            write_argument(arg);
+        }
+        write_node(f.body);
+        write_varint((uint64_t)f.linkage);
+        write_varint((uint64_t)f.name_mangling);
+        write_varint(f.extra_features.size());
+        for (Target::Feature feature : f.extra_features) {
+            write_varint(feature);
+        }
+    }
+
+    void write_module(const Module &m) {
+        write_string(m.name());
+        write_string(m.target().to_string());
+        write_bool(m.any_strict_float());
+        MetadataNameMap names = m.get_metadata_name_map();
+        write_varint(names.size());
+        for (const auto &it : names) {
+            write_string(it.first);
+            write_string(it.second);
+        }
+        write_varint(m.buffers().size());
+        for (const Buffer<> &b : m.buffers()) {
+            write_buffer(b);
+        }
+        write_varint(m.functions().size());
+        for (const LoweredFunc &f : m.functions()) {
+            write_function(f);
+        }
+        write_varint(m.submodules().size());
+        for (const Module &sub : m.submodules()) {
+            write_module(sub);
+        }
+    }
+
+    // Put the header and string table in front of what has been
+    // written.
+    vector<uint8_t> finish(SerializedKind kind) const {
+        vector<uint8_t> result;
+        auto put32 = [&](uint32_t v) {
+            for (int i = 0; i < 4; i++) {
+                result.push_back((uint8_t)(v >> (8 * i)));
+            }
+        };
+        result.insert(result.end(), serialization_magic, serialization_magic + 4);
+        put32(serialization_version);
+        result.push_back((uint8_t)kind);
+
+        put32((uint32_t)strings.size());
+        uint32_t offset = 0;
+        for (const string &s : strings) {
+            put32(offset);
+            put32((uint32_t)s.size());
+            offset += (uint32_t)s.size() + 1;
+        }
+        put32(offset);
+        for (const string &s : strings) {
+            result.insert(result.end(), s.begin(), s.end());
+            result.push_back(0);
+        }
+
+        result.insert(result.end(), out.begin(), out.end());
+        return result;
+    }
+
+protected:
+    using IRVisitor::visit;
+
+    void visit(const IntImm *op) override {
+        write_type(op->type);
+        write_signed(op->value);
+    }
+
+    void visit(const UIntImm *op) override {
+        write_type(op->type);
+        write_varint(op->value);
+    }
+
+    void visit(const FloatImm *op) override {
+        write_type(op->type);
+        uint64_t bits;
+        memcpy(&bits, &op->value, sizeof(bits));
+        write_fixed64(bits);
+    }
+
+    void visit(const StringImm *op) override {
+        write_string(op->value);
+    }
+
+    void visit(const Cast *op) override {
+        write_type(op->type);
+        write_node(op->value);
+    }
+
+    void visit(const Reinterpret *op) override {
+        write_type(op->type);
+        write_node(op->value);
+    }
+
+    void visit(const Variable *op) override {
+        user_assert(!op->reduction_domain.defined())
+            << "Can't serialize " << op->name << ", which refers to a reduction domain. "
+            << "Only lowered IR can be serialized.\n";
+        write_type(op->type);
+        write_string(op->name);
+        write_buffer(op->image);
+        write_parameter(op->param);
+    }
+
+    template<typename T>
+    void visit_binary_operator(const T *op) {
+        write_node(op->a);
+        write_node(op->b);
+    }
+
+    void visit(const Add *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Sub *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Mul *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Div *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Mod *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Min *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Max *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const EQ *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const NE *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const LT *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const LE *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const GT *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const GE *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const And *op) override {
+        visit_binary_operator(op);
+    }
+    void visit(const Or *op) override {
+        visit_binary_operator(op);
+    }
+
+    void visit(const Not *op) override {
+        write_node(op->a);
+    }
+
+    void visit(const Select *op) override {
+        write_node(op->condition);
+        write_node(op->true_value);
+        write_node(op->false_value);
+    }
+
+    void visit(const Load *op) override {
+        write_type(op->type);
+        write_string(op->name);
+        write_node(op->predicate);
+        write_node(op->index);
+        write_buffer(op->image);
+        write_parameter(op->param);
+        write_alignment(op->alignment);
+    }
+
+    void visit(const Ramp *op) override {
+        write_node(op->base);
+        write_node(op->stride);
+        write_varint(op->lanes);
+    }
+
+    void visit(const Broadcast *op) override {
+        write_node(op->value);
+        write_varint(op->lanes);
+    }
+
+    void visit(const Call *op) override {
+        user_assert(op->call_type != Call::Halide)
+            << "Can't serialize the call to Func " << op->name << ". "
+            << "Only lowered IR can be serialized.\n";
+        write_type(op->type);
+        write_string(op->name);
+        write_exprs(op->args);
+        write_varint(op->call_type);
+        write_varint(op->value_index);
+        write_buffer(op->image);
+        write_parameter(op->param);
+    }
+
+    void visit(const Let *op) override {
+        write_string(op->name);
+        write_node(op->value);
+        write_node(op->body);
+    }
+
+    void visit(const Shuffle *op) override {
+        write_exprs(op->vectors);
+        write_varint(op->indices.size());
+        for (int i : op->indices) {
+            write_varint(i);
+        }
+    }
+
+    void visit(const VectorReduce *op) override {
+        write_varint(op->op);
+        write_node(op->value);
+        write_varint(op->type.lanes());
+    }
+
+    void visit(const LetStmt *op) override {
+        write_string(op->name);
+        write_node(op->value);
+        write_node(op->body);
+    }
+
+    void visit(const AssertStmt *op) override {
+        write_node(op->condition);
+        write_node(op->message);
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        write_string(op->name);
+        write_bool(op->is_producer);
+        write_node(op->body);
+    }
+
+    void visit(const For *op) override {
+        write_string(op->name);
+        write_node(op->min);
+        write_node(op->extent);
+        write_varint((uint64_t)op->for_type);
+        write_varint((uint64_t)op->device_api);
+        write_node(op->body);
+    }
+
+    void visit(const Acquire *op) override {
+        write_node(op->semaphore);
+        write_node(op->count);
+        write_node(op->body);
+    }
+
+    void visit(const Store *op) override {
+        write_string(op->name);
+        write_node(op->predicate);
+        write_node(op->value);
+        write_node(op->index);
+        write_parameter(op->param);
+        write_alignment(op->alignment);
+    }
+
+    void visit(const Provide *op) override {
+        write_string(op->name);
+        write_exprs(op->values);
+        write_exprs(op->args);
+        write_node(op->predicate);
+    }
+
+    void visit(const Allocate *op) override {
+        write_string(op->name);
+        write_type(op->type);
+        write_varint((uint64_t)op->memory_type);
+        write_exprs(op->extents);
+        write_node(op->condition);
+        write_node(op->new_expr);
+        write_string(op->free_function);
+        write_node(op->body);
+    }
+
+    void visit(const Free *op) override {
+        write_string(op->name);
+    }
+
+    void visit(const Realize *op) override {
+        write_string(op->name);
+        write_types(op->types);
+        write_varint((uint64_t)op->memory_type);
+        write_region(op->bounds);
+        write_node(op->condition);
+        write_node(op->body);
+    }
+
+    void visit(const Block *op) override {
+        write_node(op->first);
+        write_node(op->rest);
+    }
+
+    void visit(const Fork *op) override {
+        write_node(op->first);
+        write_node(op->rest);
+    }
+
+    void visit(const IfThenElse *op) override {
+        write_node(op->condition);
+        write_node(op->then_case);
+        write_node(op->else_case);
+    }
+
+    void visit(const Evaluate *op) override {
+        write_node(op->value);
+    }
+
+    void visit(const Prefetch *op) override {
+        write_string(op->name);
+        write_types(op->types);
+        write_region(op->bounds);
+        const PrefetchDirective &p = op->prefetch;
+        write_string(p.name);
+        write_string(p.at);
+        write_string(p.from);
+        write_node(p.offset);
+        write_varint((uint64_t)p.strategy);
+        write_parameter(p.param);
+        write_node(op->condition);
+        write_node(op->body);
+    }
+
+    void visit(const Atomic *op) override {
+        write_string(op->producer_name);
+        write_string(op->mutex_name);
+        write_node(op->body);
+    }
+
+private:
+    vector<uint8_t> out;
+    vector<string> strings;
+    map<string, uint32_t> string_ids;
+    map<const IRNode *, uint32_t> node_ids;
+    map<Parameter, uint32_t> parameter_ids;
+    map<const halide_buffer_t *, uint32_t> buffer_ids;
+    map<const halide_handle_cplusplus_type *, uint32_t> handle_type_ids;
+};
+
+// Handle types are referred to by pointer from Types, so ones read
+// back are kept for the lifetime of the process, with one copy of
+// each distinct type.
+const halide_handle_cplusplus_type *intern_handle_type(const halide_handle_cplusplus_type &t) {
+    static std::mutex mutex;
+    static vector<std::unique_ptr<halide_handle_cplusplus_type>> types;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const auto &existing : types) {
+        if (existing->inner_name == t.inner_name &&
+            existing->namespaces == t.namespaces &&
+            existing->enclosing_types == t.enclosing_types &&
+            existing->cpp_type_modifiers == t.cpp_type_modifiers &&
+            existing->reference_type == t.reference_type) {
+            return existing.get();
+        }
+    }
+    types.emplace_back(new halide_handle_cplusplus_type(t));
+    return types.back().get();
+}
+
+class Deserializer {
+public:
+    Deserializer(const uint8_t *data, size_t size, SerializedKind kind)
+        : ptr(data), end(data + size) {
+        user_assert(size >= 9 && memcmp(data, serialization_magic, 4) == 0)
+            << "Data is not serialized Halide IR\n";
+        ptr += 4;
+        uint32_t version = read_fixed32();
+        user_assert(version == serialization_version)
+            << "Serialized Halide IR has version " << version
+            << ", but this version of Halide reads version " << serialization_version << "\n";
+        SerializedKind actual_kind = (SerializedKind)read_byte();
+        user_assert(actual_kind == kind)
+            << "Serialized Halide IR holds a different kind of object than the one asked for\n";
+
+        uint32_t string_count = read_fixed32();
+        const uint8_t *table = ptr;
+        check_available((size_t)string_count * 8 + 4);
+        ptr += (size_t)string_count * 8;
+        uint32_t blob_size = read_fixed32();
+        const uint8_t *blob = ptr;
+        check_available(blob_size);
+        ptr += blob_size;
+        strings.reserve(string_count);
+        for (uint32_t i = 0; i < string_count; i++) {
+            uint32_t offset = fixed32_at(table + 8 * i);
+            uint32_t length = fixed32_at(table + 8 * i + 4);
+            user_assert((uint64_t)offset + length < (uint64_t)blob_size + 1)
+                << "Serialized Halide IR is corrupt\n";
+            strings.emplace_back((const char *)blob + offset, length);
+        }
+    }
+
+    void check_available(size_t n) const {
+        user_assert((size_t)(end - ptr) >= n)
+            << "Serialized Halide IR is truncated\n";
+    }
+
+    uint8_t read_byte() {
+        check_available(1);
+        return *ptr++;
+    }
+
+    static uint32_t fixed32_at(const uint8_t *p) {
+        return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+    }
+
+    uint32_t read_fixed32() {
+        check_available(4);
+        uint32_t v = fixed32_at(ptr);
+        ptr += 4;
+        return v;
+    }
+
+    uint64_t read_fixed64() {
+        uint64_t lo = read_fixed32();
+        uint64_t hi = read_fixed32();
+        return lo | (hi << 32);
+    }
+
+    uint64_t read_varint() {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t b = read_byte();
+            v |= (uint64_t)(b & 0x7f) << shift;
+            if (!(b & 0x80)) {
+                return v;
+            }
+        }
+        user_error << "Serialized Halide IR is corrupt\n";
+        return 0;
+    }
+
+    int read_int() {
+        return (int)read_varint();
+    }
+
+    int64_t read_signed() {
+        uint64_t v = read_varint();
+        return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+    }
+
+    bool read_bool() {
+        return read_byte() != 0;
+    }
+
+    const string &read_string() {
+        uint64_t i = read_varint();
+        user_assert(i < strings.size()) << "Serialized Halide IR is corrupt\n";
+        return strings[i];
+    }
+
+    // Read the index of something already read.
+    size_t read_back_reference(size_t count) {
+        uint64_t i = read_varint();
+        user_assert(i < count) << "Serialized Halide IR is corrupt\n";
+        return (size_t)i;
+    }
+
+    const halide_handle_cplusplus_type *read_handle_type() {
+        uint64_t tag = read_varint();
+        if (tag == Undefined) {
+            return nullptr;
+        } else if (tag == BackReference) {
+            return handle_types[read_back_reference(handle_types.size())];
+        }
+        user_assert(tag == NewDefinition) << "Serialized Halide IR is corrupt\n";
+        auto read_name = [&]() {
+            auto cpp_type_type = (halide_cplusplus_type_name::CPPTypeType)read_varint();
+            return halide_cplusplus_type_name(cpp_type_type, read_string());
+        };
+        halide_cplusplus_type_name inner_name = read_name();
+        vector<string> namespaces(read_varint());
+        for (string &n : namespaces) {
+            n = read_string();
+        }
+        vector<halide_cplusplus_type_name> enclosing_types;
+        size_t enclosing_count = read_varint();
+        for (size_t i = 0; i < enclosing_count; i++) {
+            enclosing_types.push_back(read_name());
+        }
+        vector<uint8_t> modifiers(read_varint());
+        for (uint8_t &m : modifiers) {
+            m = (uint8_t)read_varint();
+        }
+        auto reference_type = (halide_handle_cplusplus_type::ReferenceType)read_varint();
+        const halide_handle_cplusplus_type *t =
+            intern_handle_type(halide_handle_cplusplus_type(inner_name, namespaces, enclosing_types,
+                                                            modifiers, reference_type));
+        handle_types.push_back(t);
+        return t;
+    }
+
+    Type read_type() {
+        auto code = (halide_type_code_t)read_varint();
+        int bits = read_int();
+        int lanes = read_int();
+        const halide_handle_cplusplus_type *handle_type = nullptr;
+        if (code == halide_type_handle) {
+            handle_type = read_handle_type();
+        }
+        return Type(code, bits, lanes, handle_type);
+    }
+
+    vector<Type> read_types() {
+        vector<Type> types(read_varint());
+        for (Type &t : types) {
+            t = read_type();
+        }
+        return types;
+    }
+
+    Expr read_expr() {
+        IRHandle n = read_node();
+        user_assert(!n.defined() || n->node_type <= StrongestExprNodeType)
+            << "Serialized Halide IR is corrupt\n";
+        return Expr((const BaseExprNode *)n.get());
+    }
+
+    Stmt read_stmt() {
+        IRHandle n = read_node();
+        user_assert(!n.defined() || n->node_type > StrongestExprNodeType)
+            << "Serialized Halide IR is corrupt\n";
+        return Stmt((const BaseStmtNode *)n.get());
+    }
+
+    vector<Expr> read_exprs() {
+        vector<Expr> exprs(read_varint());
+        for (Expr &e : exprs) {
+            e = read_expr();
+        }
+        return exprs;
+    }
+
+    Region read_region() {
+        Region region(read_varint());
+        for (Range &r : region) {
+            r.min = read_expr();
+            r.extent = read_expr();
+        }
+        return region;
+    }
+
+    ModulusRemainder read_alignment() {
+        int64_t modulus = read_signed();
+        int64_t remainder = read_signed();
+        return ModulusRemainder(modulus, remainder);
+    }
+
+    Parameter read_parameter() {
+        uint64_t tag = read_varint();
+        if (tag == Undefined) {
+            return Parameter();
+        } else if (tag == BackReference) {
+            return parameters[read_back_reference(parameters.size())];
+        }
+        user_assert(tag == NewDefinition) << "Serialized Halide IR is corrupt\n";
+        Type type = read_type();
+        bool is_buffer = read_bool();
+        int dimensions = read_int();
+        const string &name = read_string();
+        Parameter p(type, is_buffer, dimensions, name);
+        parameters.push_back(p);
+
+        if (is_buffer) {
+            p.set_host_alignment(read_int());
+            p.store_in((MemoryType)read_varint());
+            for (int i = 0; i < dimensions; i++) {
+                p.set_min_constraint(i, read_expr());
+                p.set_extent_constraint(i, read_expr());
+                p.set_stride_constraint(i, read_expr());
+                p.set_min_constraint_estimate(i, read_expr());
+                p.set_extent_constraint_estimate(i, read_expr());
+            }
+        } else {
+            uint64_t bits = read_fixed64();
+            memcpy(p.scalar_address(), &bits, sizeof(bits));
+            p.set_min_value(read_expr());
+            p.set_max_value(read_expr());
+            p.set_estimate(read_expr());
+            p.set_default_value(read_expr());
+        }
+        return p;
+    }
+
+    Buffer<> read_buffer() {
+        uint64_t tag = read_varint();
+        if (tag == Undefined) {
+            return Buffer<>();
+        } else if (tag == BackReference) {
+            return buffers[read_back_reference(buffers.size())];
+        }
+        user_assert(tag == NewDefinition) << "Serialized Halide IR is corrupt\n";
+        const string &name = read_string();
+        Type type = read_type();
+        int dimensions = read_int();
+        vector<int> mins, sizes;
+        for (int i = 0; i < dimensions; i++) {
+            mins.push_back((int)read_signed());
+            sizes.push_back(read_int());
+        }
+        Buffer<> b;
+        if (read_bool()) {
+            b = Buffer<>(type, sizes, name);
+            check_available(b.size_in_bytes());
+            memcpy(b.data(), ptr, b.size_in_bytes());
+            ptr += b.size_in_bytes();
+        } else {
+            vector<halide_dimension_t> shape(dimensions);
+            int stride = 1;
+            for (int i = 0; i < dimensions; i++) {
+                shape[i] = halide_dimension_t(0, sizes[i], stride);
+                stride *= sizes[i];
+            }
+            b = Buffer<>(type, nullptr, dimensions, shape.data(), name);
+        }
+        b.set_min(mins);
+        buffers.push_back(b);
+        return b;
+    }
+
+    LoweredArgument read_argument() {
+        LoweredArgument arg;
+        arg.name = read_string();
+        arg.kind = (Argument::Kind)read_varint();
+        arg.dimensions = (uint8_t)read_varint();
+        arg.type = read_type();
+        ArgumentEstimates &e = arg.argument_estimates;
+        e.scalar_def = read_expr();
+        e.scalar_min = read_expr();
+        e.scalar_max = read_expr();
+        e.scalar_estimate = read_expr();
+        e.buffer_estimates = read_region();
+        arg.alignment = read_alignment();
+        return arg;
+    }
+
+    LoweredFunc read_function() {
+        string name = read_string();
+        vector<LoweredArgument> args(read_varint());
+        for (LoweredArgument &arg : args) {
+            arg = read_argument();
+        }
+        Stmt body = read_stmt();
+        auto linkage = (LinkageType)read_varint();
+        auto name_mangling = (NameMangling)read_varint();
+        LoweredFunc f(name, args, body, linkage, name_mangling);
+        size_t feature_count = read_varint();
+        for (size_t i = 0; i < feature_count; i++) {
+            f.extra_features.push_back((Target::Feature)read_varint());
+        }
+        return f;
+    }
+
+    Module read_module() {
+        string name = read_string();
+        Target target(read_string());
+        Module m(name, target);
+        m.set_any_strict_float(read_bool());
+        size_t name_count = read_varint();
+        for (size_t i = 0; i < name_count; i++) {
+            string from = read_string();
+            m.remap_metadata_name(from, read_string());
+        }
+        size_t buffer_count = read_varint();
+        for (size_t i = 0; i < buffer_count; i++) {
+            m.append(read_buffer());
+        }
+        size_t function_count = read_varint();
+        for (size_t i = 0; i < function_count; i++) {
+            m.append(read_function());
+        }
+        size_t submodule_count = read_varint();
+        for (size_t i = 0; i < submodule_count; i++) {
+            m.append(read_module());
+        }
+        return m;
+    }
+
+    void finish() const {
+        user_assert(ptr == end) << "Serialized Halide IR has trailing data\n";
+    }
+
+private:
+    IRHandle read_node() {
+        uint64_t tag = read_varint();
+        if (tag == Undefined) {
+            return IRHandle();
+        } else if (tag == BackReference) {
+            return nodes[read_back_reference(nodes.size())];
+        }
+        user_assert(tag - FirstNodeTag <= (uint64_t)IRNodeType::Atomic)
+            << "Serialized Halide IR is corrupt\n";
+
+        IRHandle n;
+        switch ((IRNodeType)(tag - FirstNodeTag)) {
+        case IRNodeType::IntImm: {
+            Type t = read_type();
+            n = IntImm::make(t, read_signed());
+            break;
+        }
+        case IRNodeType::UIntImm: {
+            Type t = read_type();
+            n = UIntImm::make(t, read_varint());
+            break;
+        }
+        case IRNodeType::FloatImm: {
+            Type t = read_type();
+            uint64_t bits = read_fixed64();
+            double value;
+            memcpy(&value, &bits, sizeof(value));
+            n = FloatImm::make(t, value);
+            break;
+        }
+        case IRNodeType::StringImm:
+            n = StringImm::make(read_string());
+            break;
+        case IRNodeType::Broadcast: {
+            Expr value = read_expr();
+            n = Broadcast::make(value, read_int());
+            break;
+        }
+        case IRNodeType::Cast: {
+            Type t = read_type();
+            n = Cast::make(t, read_expr());
+            break;
+        }
+        case IRNodeType::Reinterpret: {
+            Type t = read_type();
+            n = Reinterpret::make(t, read_expr());
+            break;
+        }
+        case IRNodeType::Variable: {
+            Type t = read_type();
+            string name = read_string();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            n = Variable::make(t, name, image, param, ReductionDomain());
+            break;
+        }
+        case IRNodeType::Add:
+            n = read_binary_operator<Add>();
+            break;
+        case IRNodeType::Sub:
+            n = read_binary_operator<Sub>();
+            break;
+        case IRNodeType::Mod:
+            n = read_binary_operator<Mod>();
+            break;
+        case IRNodeType::Mul:
+            n = read_binary_operator<Mul>();
+            break;
+        case IRNodeType::Div:
+            n = read_binary_operator<Div>();
+            break;
+        case IRNodeType::Min:
+            n = read_binary_operator<Min>();
+            break;
+        case IRNodeType::Max:
+            n = read_binary_operator<Max>();
+            break;
+        case IRNodeType::EQ:
+            n = read_binary_operator<EQ>();
+            break;
+        case IRNodeType::NE:
+            n = read_binary_operator<NE>();
+            break;
+        case IRNodeType::LT:
+            n = read_binary_operator<LT>();
+            break;
+        case IRNodeType::LE:
+            n = read_binary_operator<LE>();
+            break;
+        case IRNodeType::GT:
+            n = read_binary_operator<GT>();
+            break;
+        case IRNodeType::GE:
+            n = read_binary_operator<GE>();
+            break;
+        case IRNodeType::And:
+            n = read_binary_operator<And>();
+            break;
+        case IRNodeType::Or:
+            n = read_binary_operator<Or>();
+            break;
+        case IRNodeType::Not:
+            n = Not::make(read_expr());
+            break;
+        case IRNodeType::Select: {
+            Expr condition = read_expr();
+            Expr true_value = read_expr();
+            Expr false_value = read_expr();
+            n = Select::make(condition, true_value, false_value);
+            break;
+        }
+        case IRNodeType::Load: {
+            Type t = read_type();
+            string name = read_string();
+            Expr predicate = read_expr();
+            Expr index = read_expr();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            ModulusRemainder alignment = read_alignment();
+            n = Load::make(t, name, index, image, param, predicate, alignment);
+            break;
+        }
+        case IRNodeType::Ramp: {
+            Expr base = read_expr();
+            Expr stride = read_expr();
+            n = Ramp::make(base, stride, read_int());
+            break;
+        }
+        case IRNodeType::Call: {
+            Type t = read_type();
+            string name = read_string();
+            vector<Expr> args = read_exprs();
+            auto call_type = (Call::CallType)read_varint();
+            int value_index = read_int();
+            Buffer<> image = read_buffer();
+            Parameter param = read_parameter();
+            n = Call::make(t, name, args, call_type, FunctionPtr(), value_index, image, param);
+            break;
+        }
+        case IRNodeType::Let: {
+            string name = read_string();
+            Expr value = read_expr();
+            Expr body = read_expr();
+            n = Let::make(name, value, body);
+            break;
+        }
+        case IRNodeType::Shuffle: {
+            vector<Expr> vectors = read_exprs();
+            vector<int> indices(read_varint());
+            for (int &i : indices) {
+                i = read_int();
+            }
+            n = Shuffle::make(vectors, indices);
+            break;
+        }
+        case IRNodeType::VectorReduce: {
+            auto op = (VectorReduce::Operator)read_varint();
+            Expr value = read_expr();
+            n = VectorReduce::make(op, value, read_int());
+            break;
+        }
+        case IRNodeType::LetStmt: {
+            string name = read_string();
+            Expr value = read_expr();
+            Stmt body = read_stmt();
+            n = LetStmt::make(name, value, body);
+            break;
+        }
+        case IRNodeType::AssertStmt: {
+            Expr condition = read_expr();
+            Expr message = read_expr();
+            n = AssertStmt::make(condition, message);
+            break;
+        }
+        case IRNodeType::ProducerConsumer: {
+            string name = read_string();
+            bool is_producer = read_bool();
+            n = ProducerConsumer::make(name, is_producer, read_stmt());
+            break;
+        }
+        case IRNodeType::For: {
+            string name = read_string();
+            Expr min = read_expr();
+            Expr extent = read_expr();
+            auto for_type = (ForType)read_varint();
+            auto device_api = (DeviceAPI)read_varint();
+            n = For::make(name, min, extent, for_type, device_api, read_stmt());
+            break;
+        }
+        case IRNodeType::Acquire: {
+            Expr semaphore = read_expr();
+            Expr count = read_expr();
+            n = Acquire::make(semaphore, count, read_stmt());
+            break;
+        }
+        case IRNodeType::Store: {
+            string name = read_string();
+            Expr predicate = read_expr();
+            Expr value = read_expr();
+            Expr index = read_expr();
+            Parameter param = read_parameter();
+            ModulusRemainder alignment = read_alignment();
+            n = Store::make(name, value, index, param, predicate, alignment);
+            break;
+        }
+        case IRNodeType::Provide: {
+            string name = read_string();
+            vector<Expr> values = read_exprs();
+            vector<Expr> args = read_exprs();
+            n = Provide::make(name, values, args, read_expr());
+            break;
+        }
+        case IRNodeType::Allocate: {
+            string name = read_string();
+            Type t = read_type();
+            auto memory_type = (MemoryType)read_varint();
+            vector<Expr> extents = read_exprs();
+            Expr condition = read_expr();
+            Expr new_expr = read_expr();
+            string free_function = read_string();
+            Stmt body = read_stmt();
+            n = Allocate::make(name, t, memory_type, extents, condition, body, new_expr, free_function);
+            break;
+        }
+        case IRNodeType::Free:
+            n = Free::make(read_string());
+            break;
+        case IRNodeType::Realize: {
+            string name = read_string();
+            vector<Type> types = read_types();
+            auto memory_type = (MemoryType)read_varint();
+            Region bounds = read_region();
+            Expr condition = read_expr();
+            n = Realize::make(name, types, memory_type, bounds, condition, read_stmt());
+            break;
+        }
+        case IRNodeType::Block: {
+            Stmt first = read_stmt();
+            Stmt rest = read_stmt();
+            n = Block::make(first, rest);
+            break;
+        }
+        case IRNodeType::Fork: {
+            Stmt first = read_stmt();
+            Stmt rest = read_stmt();
+            n = Fork::make(first, rest);
+            break;
+        }
+        case IRNodeType::IfThenElse: {
+            Expr condition = read_expr();
+            Stmt then_case = read_stmt();
+            Stmt else_case = read_stmt();
+            n = IfThenElse::make(condition, then_case, else_case);
+            break;
+        }
+        case IRNodeType::Evaluate:
+            n = Evaluate::make(read_expr());
+            break;
+        case IRNodeType::Prefetch: {
+            string name = read_string();
+            vector<Type> types = read_types();
+            Region bounds = read_region();
+            PrefetchDirective p;
+            p.name = read_string();
+            p.at = read_string();
+            p.from = read_string();
+            p.offset = read_expr();
+            p.strategy = (PrefetchBoundStrategy)read_varint();
+            p.param = read_parameter();
+            Expr condition = read_expr();
+            n = Prefetch::make(name, types, bounds, p, condition, read_stmt());
+            break;
+        }
+        case IRNodeType::Atomic: {
+            string producer_name = read_string();
+            string mutex_name = read_string();
+            n = Atomic::make(producer_name, mutex_name, read_stmt());
+            break;
+        }
+        }
+        nodes.push_back(n);
+        return n;
+    }
+
+    template<typename T>
+    Expr read_binary_operator() {
+        Expr a = read_expr();
+        Expr b = read_expr();
+        return T::make(a, b);
+    }
+
+    const uint8_t *ptr, *end;
+    vector<string> strings;
+    vector<IRHandle> nodes;
+    vector<Parameter> parameters;
+    vector<Buffer<>> buffers;
+    vector<const halide_handle_cplusplus_type *> handle_types;
+};
+
+}  // namespace
+
+vector<uint8_t> serialize_ir(const Expr &e) {
+    Serializer s;
+    s.write_node(e);
+    return s.finish(SerializedKind::Expr);
+}
+
+vector<uint8_t> serialize_ir(const Stmt &stmt) {
+    Serializer s;
+    s.write_node(stmt);
+    return s.finish(SerializedKind::Stmt);
+}
+
+Expr deserialize_expr(const uint8_t *data, size_t size) {
+    Deserializer d(data, size, SerializedKind::Expr);
+    Expr e = d.read_expr();
+    d.finish();
+    return e;
+}
+
+Stmt deserialize_stmt(const uint8_t *data, size_t size) {
+    Deserializer d(data, size, SerializedKind::Stmt);
+    Stmt s = d.read_stmt();
+    d.finish();
+    return s;
+}
+
+namespace {
+
+Stmt round_trip(const Stmt &s) {
+    vector<uint8_t> data = serialize_ir(s);
+    return deserialize_stmt(data.data(), data.size());
+}
+
+}  // namespace
+
+void serialization_test() {
+    Expr x = Variable::make(Int(32), "x");
+    Expr y = Variable::make(Int(32), "y");
+    Parameter p(Float(32), false, 0, "p");
+    p.set_estimate(make_const(Float(32), 2.5f));
+    Expr p_var = Variable::make(Float(32), "p", p);
+
+    Buffer<uint16_t> table(7, "table");
+    for (int i = 0; i < 7; i++) {
+        table(i) = (uint16_t)(i * 1000);
+    }
+
+    // Every kind of node, with shared subexpressions.
+    Expr shared = (x * 3 + y) % 7 - select(make_const(Int(64), (int64_t)-1000000000000ll) < cast<int64_t>(y), 1, 0);
+    Expr v = Ramp::make(shared, 2, 4);
+    Expr cond = x < y && (make_const(Float(64), -0.0) == make_const(Float(64), 1.5) || !(x >= y));
+    Expr e = select(cond, cast<float>(shared) / p_var, 1.0f);
+    e = Let::make("t", min(shared, max(x, y)), e + cast<float>(Variable::make(Int(32), "t")));
+    Expr load = Load::make(UInt(16), "table", Ramp::make(x, 1, 4), table, Parameter(),
+                           const_true(4), ModulusRemainder(4, 1));
+    Stmt s = Store::make("out", cast(Float(32, 4), load) + Broadcast::make(p_var, 4),
+                         v, Parameter(), const_true(4), ModulusRemainder());
+    s = Block::make(s, Evaluate::make(Call::make(Int(32), "halide_print",
+                                                 {StringImm::make("hello\nworld"), UIntImm::make(UInt(64), 0xffffffffffffffffull)},
+                                                 Call::Extern)));
+    s = Block::make(s, Evaluate::make(VectorReduce::make(VectorReduce::Add,
+                                                         Shuffle::make_interleave({v, v}), 2)));
+    s = Block::make(s, Evaluate::make(Reinterpret::make(UInt(32), e)));
+    s = For::make("x", 0, 10, ForType::Vectorized, DeviceAPI::Host, s);
+    s = Allocate::make("out", Float(32), MemoryType::Stack, {100, y}, x > 0, s);
+    s = IfThenElse::make(y != 2, s, AssertStmt::make(y == 1, StringImm::make("y")));
+    s = LetStmt::make("y", 5, s);
+    s = ProducerConsumer::make_produce("out", s);
+
+    Stmt s2 = round_trip(s);
+    internal_assert(equal(s, s2)) << "Round trip changed the IR:\n"
+                                  << s << "\n"
+                                  << s2 << "\n";
+    internal_assert(serialize_ir(s) == serialize_ir(s2));
+
+    // Shared nodes stay shared, and Parameters and Buffers are
+    // recreated once per serialization.
+    Stmt shared_body = Block::make(Evaluate::make(shared), Evaluate::make(shared));
+    Stmt shared_body2 = round_trip(shared_body);
+    const Block *block = shared_body2.as<Block>();
+    internal_assert(block && block->first.as<Evaluate>()->value.same_as(block->rest.as<Evaluate>()->value));
+
+    Stmt params = Block::make(Evaluate::make(p_var), Evaluate::make(Variable::make(Float(32), "p", p)));
+    Stmt params2 = round_trip(params);
+    block = params2.as<Block>();
+    const Variable *p1 = block->first.as<Evaluate>()->value.as<Variable>();
+    const Variable *p2 = block->rest.as<Evaluate>()->value.as<Variable>();
+    internal_assert(!p1->param.same_as(p) && p1->param.same_as(p2->param) &&
+                    p1->param.name() == "p" && equal(p1->param.estimate(), p.estimate()));
+
+    const Load *load2 = round_trip(Evaluate::make(load)).as<Evaluate>()->value.as<Load>();
+    Buffer<uint16_t> table2(load2->image);
+    internal_assert(table2.dim(0).extent() == 7 && table2(6) == 6000 && !table2.same_as(table));
+
+    std::cout << "Serialization test passed" << std::endl;
+}
+
+}  // namespace Internal
+
+std::vector<uint8_t> serialize_module(const Module &module) {
+    Internal::Serializer s;
+    s.write_module(module);
+    return s.finish(Internal::SerializedKind::Module);
+}
+
+Module deserialize_module(const uint8_t *data, size_t size) {
+    Internal::Deserializer d(data, size, Internal::SerializedKind::Module);
+    Module m = d.read_module();
+    d.finish();
+    return m;
+}
+
+Module deserialize_module(const std::vector<uint8_t> &data) {
+    return deserialize_module(data.data(), data.size());
+}
+
+}  // namespace Halide
@@ -0,0 +1,65 @@
+#ifndef HALIDE_SERIALIZATION_H
+#define HALIDE_SERIALIZATION_H
+
+/** \file
+ * Defines a compact binary serialization of lowered Halide IR, and of
+ * Modules made of it, so that lowering results can be cached, shipped
+ * to another process or machine to be compiled, and loaded again
+ * without lowering.
+ */
+
+#include <cstdint>
+#include <vector>
+
+#include "Expr.h"
+#include "Module.h"
+
+namespace Halide {
+
+/** Serialize a lowered Module: its target, functions, buffers,
+ * submodules and metadata name map. The IR nodes shared within the
+ * module are written once, as are the Parameters and Buffers it
+ * refers to, including the contents of the Buffers. AutoSchedulerResults
+ * are not included.
+ *
+ * The result starts with a version number, which deserialization
+ * checks, and then a table of the fixed-width offsets and lengths of
+ * all the strings used, which are stored nul-terminated in one block,
+ * so that a serialized Module can be read in place (e.g. from a
+ * memory-mapped file). Serialized Modules are only meant to be read by
+ * the same version of Halide that wrote them.
+ *
+ * Pipelines must be lowered (e.g. with Pipeline::compile_to_module)
+ * before they can be serialized; unlowered IR that calls Funcs or
+ * refers to reduction domains cannot be. */
+std::vector<uint8_t> serialize_module(const Module &module);
+
+/** Reconstruct a Module written by serialize_module. The Parameters
+ * referred to in it are new Parameters, with the same names, types
+ * and constraints as the original ones. It is a user error for the
+ * data to not be a serialized Module. */
+// @{
+Module deserialize_module(const uint8_t *data, size_t size);
+Module deserialize_module(const std::vector<uint8_t> &data);
+// @}
+
+namespace Internal {
+
+/** Serialize a piece of lowered IR. */
+// @{
+std::vector<uint8_t> serialize_ir(const Expr &e);
+std::vector<uint8_t> serialize_ir(const Stmt &s);
+// @}
+
+/** Reconstruct a piece of IR written by serialize_ir. */
+// @{
+Expr deserialize_expr(const uint8_t *data, size_t size);
+Stmt deserialize_stmt(const uint8_t *data, size_t size);
+// @}
+
+void serialization_test();
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
@@ -117,6 +117,7 @@ bool Simplify::const_uint(const Expr &e, uint64_t *u) {
 }
 
 void Simplify::ScopedFact::learn_false(const Expr &fact) {
+    simplify->facts_epoch++;
     Simplify::VarInfo info;
     info.old_uses = info.new_uses = 0;
     if (const Variable *v = fact.as<Variable>()) {
@@ -184,6 +185,7 @@ void Simplify::ScopedFact::learn_false(const Expr &fact) {
 }
 
 void Simplify::ScopedFact::learn_upper_bound(const Variable *v, int64_t val) {
+    simplify->facts_epoch++;
     ExprInfo b;
     b.max_defined = true;
     b.max = val;
@@ -195,6 +197,7 @@ void Simplify::ScopedFact::learn_upper_bound(const Variable *v, int64_t val) {
 }
 
 void Simplify::ScopedFact::learn_lower_bound(const Variable *v, int64_t val) {
+    simplify->facts_epoch++;
     ExprInfo b;
     b.min_defined = true;
     b.min = val;
@@ -206,6 +209,7 @@ void Simplify::ScopedFact::learn_lower_bound(const Variable *v, int64_t val) {
 }
 
 void Simplify::ScopedFact::learn_true(const Expr &fact) {
+    simplify->facts_epoch++;
     Simplify::VarInfo info;
     info.old_uses = info.new_uses = 0;
     if (const Variable *v = fact.as<Variable>()) {
@@ -339,6 +343,7 @@ Stmt Simplify::ScopedFact::substitute_facts(const Stmt &s) {
 }
 
 Simplify::ScopedFact::~ScopedFact() {
+    simplify->facts_epoch++;
     for (const auto *v : pop_list) {
         simplify->var_info.pop(v->name);
     }
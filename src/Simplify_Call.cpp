@@ -422,9 +422,13 @@ Expr Simplify::visit(const Call *op, ExprInfo *bounds) {
         // Collapse the prefetched region into lower dimension whenever is possible.
         // TODO(psuriana): Deal with negative strides and overlaps.
 
-        internal_assert(op->args.size() % 2 == 0);  // Prefetch: {base, offset, extent0, stride0, ...}
+        // Prefetch: {base, offset, extent0, stride0, ..., [is_write]}
+        const bool is_write = op->args.size() % 2 == 1;
 
         auto [args, changed] = mutate_with_changes(op->args, nullptr);
+        if (is_write) {
+            args.pop_back();
+        }
 
         // The {extent, stride} args in the prefetch call are sorted
         // based on the storage dimension in ascending order (i.e. innermost
@@ -447,6 +451,9 @@ Expr Simplify::visit(const Call *op, ExprInfo *bounds) {
                 }
             }
         }
+        if (is_write) {
+            args.push_back(1);
+        }
         internal_assert(args.size() <= op->args.size());
 
         if (changed || (args.size() != op->args.size())) {
@@ -244,8 +244,33 @@ Expr Simplify::visit(const Variable *op, ExprInfo *bounds) {
             info.new_uses++;
             // We want to remutate the replacement, because we may be
             // injecting it into a context where it is known to be a
-            // constant (e.g. due to an if).
-            return mutate(info.replacement, bounds);
+            // constant (e.g. due to an if). If nothing is known that
+            // wasn't the last time, the result will be the same, along
+            // with any uses it counted.
+            if (info.replacement_epoch == facts_epoch) {
+                if (bounds) {
+                    *bounds = info.replacement_info;
+                }
+                in_unreachable |= info.replacement_unreachable;
+                return info.simplified_replacement;
+            }
+            ExprInfo replacement_info;
+            if (bounds_and_alignment_info.contains(op->name)) {
+                replacement_info = bounds_and_alignment_info.get(op->name);
+            }
+            const bool was_unreachable = in_unreachable;
+            Expr replacement = mutate(info.replacement, &replacement_info);
+            // Simplifying the replacement doesn't add let vars, but look
+            // the entry up again to be safe.
+            auto &new_info = var_info.ref(op->name);
+            new_info.simplified_replacement = replacement;
+            new_info.replacement_info = replacement_info;
+            new_info.replacement_epoch = facts_epoch;
+            new_info.replacement_unreachable = in_unreachable && !was_unreachable;
+            if (bounds) {
+                *bounds = replacement_info;
+            }
+            return replacement;
         } else {
             // This expression was not something deemed
             // substitutable - no replacement is defined.
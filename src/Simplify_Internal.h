@@ -186,11 +186,24 @@ public:
     struct VarInfo {
         Expr replacement;
         int old_uses, new_uses;
+
+        // The replacement as last simplified, and what was learned about
+        // it. Each use of the var would otherwise simplify the replacement
+        // again. Only valid while facts_epoch equals replacement_epoch.
+        Expr simplified_replacement;
+        ExprInfo replacement_info;
+        uint64_t replacement_epoch = 0;
+        bool replacement_unreachable = false;
     };
 
     // Tracked for all let vars
     Scope<VarInfo> var_info;
 
+    // Incremented whenever var_info, bounds_and_alignment_info, or the
+    // known truths and falsehoods change, as any of these may change what
+    // an Expr simplifies to.
+    uint64_t facts_epoch = 1;
+
     // Only tracked for integer let vars
     Scope<ExprInfo> bounds_and_alignment_info;
 
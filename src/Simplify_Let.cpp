@@ -199,6 +199,7 @@ Body Simplify::simplify_let(const LetOrLetStmt *op, ExprInfo *bounds) {
         info.replacement = replacement;
 
         var_info.push(op->name, info);
+        facts_epoch++;
 
         // Before we enter the body, track the alignment info
 
@@ -245,6 +246,7 @@ Body Simplify::simplify_let(const LetOrLetStmt *op, ExprInfo *bounds) {
 
         VarInfo info = var_info.get(it->op->name);
         var_info.pop(it->op->name);
+        facts_epoch++;
 
         if (it->new_value.defined() && (info.new_uses > 0 && vars_used.count(it->new_name) > 0)) {
             // The new name/value may be used
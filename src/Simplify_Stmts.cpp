@@ -221,6 +221,8 @@ Stmt Simplify::visit(const For *op) {
         bounds_tracked = true;
         bounds_and_alignment_info.push(op->name, min_bounds);
     }
+    // The loop var's bounds and in_vector_loop may both have changed.
+    facts_epoch++;
 
     Stmt new_body;
     {
@@ -240,6 +242,7 @@ Stmt Simplify::visit(const For *op) {
     if (bounds_tracked) {
         bounds_and_alignment_info.pop(op->name);
     }
+    facts_epoch++;
 
     if (const Acquire *acquire = new_body.as<Acquire>()) {
         if (is_no_op(acquire->body)) {
@@ -1,4 +1,5 @@
 #include "SkipStages.h"
+#include "Bounds.h"
 #include "CSE.h"
 #include "Debug.h"
 #include "ExprUsesVar.h"
@@ -8,6 +9,7 @@
 #include "IRPrinter.h"
 #include "Scope.h"
 #include "Simplify.h"
+#include "Solve.h"
 #include "Substitute.h"
 
 #include <iterator>
@@ -16,6 +18,7 @@
 namespace Halide {
 namespace Internal {
 
+using std::pair;
 using std::set;
 using std::string;
 using std::vector;
@@ -39,6 +42,38 @@ bool extern_call_uses_buffer(const Call *op, const std::string &func) {
     return false;
 }
 
+// Replace calls to Funcs and images whose arguments don't vary over a
+// domain with the calls at the single point they make, so that bounds
+// inference can see that they are the same everywhere over it. Used to
+// evaluate conditions that depend on a coarse mask (e.g. a level of a
+// pyramid) over a tile.
+class CollapseInvariantCalls : public IRMutator {
+    using IRMutator::visit;
+
+    const Scope<Interval> &domain;
+
+    Expr visit(const Call *op) override {
+        if (op->call_type != Call::Halide && op->call_type != Call::Image) {
+            return IRMutator::visit(op);
+        }
+        vector<Expr> args;
+        for (const Expr &arg : op->args) {
+            Interval i = bounds_of_expr_in_scope(arg, domain);
+            if (!i.is_bounded() || !can_prove(i.min == i.max)) {
+                return IRMutator::visit(op);
+            }
+            args.push_back(simplify(i.min));
+        }
+        return Call::make(op->type, op->name, args, op->call_type,
+                          op->func, op->value_index, op->image, op->param);
+    }
+
+public:
+    CollapseInvariantCalls(const Scope<Interval> &domain)
+        : domain(domain) {
+    }
+};
+
 class PredicateFinder : public IRVisitor {
 public:
     Expr predicate;
@@ -60,24 +95,75 @@ private:
     Scope<> in_pipeline;
     Scope<> local_buffers;
 
+    // Of the things that vary, some only vary with the loops inside the
+    // realization, over bounds we know. A condition that depends only
+    // on those can be evaluated over the whole of the loops, e.g. over
+    // each tile of a consumer the realization is computed at. The rest
+    // (values computed inside the realization, and any loop bounds
+    // that depend on them) vary in ways we can't reason about.
+    bool varies_unknowably = false;
+    Scope<> varying_unknowably;
+    Scope<Interval> loop_bounds;
+    vector<pair<string, Expr>> varying_lets;
+
     void visit(const Variable *op) override {
         bool this_varies = varying.contains(op->name);
 
         varies |= this_varies;
+        varies_unknowably |= varying_unknowably.contains(op->name);
+    }
+
+    // Substitute in the lets that vary with the loops.
+    Expr expand_varying_lets(Expr e) const {
+        for (auto it = varying_lets.rbegin(); it != varying_lets.rend(); it++) {
+            e = substitute(it->first, it->second, e);
+        }
+        return e;
+    }
+
+    // A condition that is true if the given one might be true anywhere
+    // over the loops.
+    Expr might_be_true_over_loops(const Expr &condition) const {
+        Expr c = CollapseInvariantCalls(loop_bounds).mutate(expand_varying_lets(condition));
+        Expr never = and_condition_over_domain(simplify(!c), loop_bounds);
+        return simplify(!never);
     }
 
     void visit(const For *op) override {
+        bool old_varies_unknowably = varies_unknowably;
+        varies_unknowably = false;
         op->min.accept(this);
         bool min_varies = varies;
         op->extent.accept(this);
+        bool bounds_vary_unknowably = varies_unknowably;
+        varies_unknowably |= old_varies_unknowably;
         bool should_pop = false;
+        bool known_bounds = false;
         if (!is_const_one(op->extent) || min_varies) {
             should_pop = true;
             varying.push(op->name);
+            if (!bounds_vary_unknowably) {
+                Expr min = expand_varying_lets(op->min);
+                Expr max = expand_varying_lets(op->min + op->extent - 1);
+                Interval bounds(bounds_of_expr_in_scope(min, loop_bounds).min,
+                                bounds_of_expr_in_scope(max, loop_bounds).max);
+                if (bounds.is_bounded()) {
+                    loop_bounds.push(op->name, bounds);
+                    known_bounds = true;
+                }
+            }
+            if (!known_bounds) {
+                varying_unknowably.push(op->name);
+            }
         }
         op->body.accept(this);
         if (should_pop) {
             varying.pop(op->name);
+            if (known_bounds) {
+                loop_bounds.pop(op->name);
+            } else {
+                varying_unknowably.pop(op->name);
+            }
         } else if (expr_uses_var(predicate, op->name)) {
             predicate = Let::make(op->name, op->min, predicate);
         }
@@ -88,18 +174,30 @@ private:
         struct Frame {
             const T *op;
             ScopedBinding<> binding;
+            ScopedBinding<> unknowable_binding;
+            bool varies_with_loops;
         };
         vector<Frame> frames;
 
         decltype(op->body) body;
         do {
             bool old_varies = varies;
+            bool old_varies_unknowably = varies_unknowably;
             varies = false;
+            varies_unknowably = false;
             op->value.accept(this);
 
-            frames.push_back(Frame{op, ScopedBinding<>(varies, varying, op->name)});
+            bool varies_with_loops = varies && !varies_unknowably;
+            frames.push_back(Frame{op,
+                                   ScopedBinding<>(varies, varying, op->name),
+                                   ScopedBinding<>(varies_unknowably, varying_unknowably, op->name),
+                                   varies_with_loops});
+            if (varies_with_loops) {
+                varying_lets.emplace_back(op->name, op->value);
+            }
 
             varies |= old_varies;
+            varies_unknowably |= old_varies_unknowably;
             body = op->body;
             op = body.template as<T>();
         } while (op);
@@ -107,6 +205,9 @@ private:
         body.accept(this);
 
         for (auto it = frames.rbegin(); it != frames.rend(); it++) {
+            if (it->varies_with_loops) {
+                varying_lets.pop_back();
+            }
             if (expr_uses_var(predicate, it->op->name)) {
                 predicate = Let::make(it->op->name, it->op->value, predicate);
             }
@@ -199,18 +300,29 @@ private:
         Expr false_predicate = predicate;
 
         bool old_varies = varies;
+        bool old_varies_unknowably = varies_unknowably;
         predicate = const_false();
         varies = false;
+        varies_unknowably = false;
         condition.accept(this);
 
         predicate = make_or(predicate, old_predicate);
-        if (varies) {
+        if (varies && !varies_unknowably &&
+            !(is_const_zero(true_predicate) && is_const_zero(false_predicate))) {
+            // Each branch is only needed if its condition might hold
+            // somewhere over the loops.
+            Expr maybe_true = might_be_true_over_loops(condition);
+            Expr maybe_false = might_be_true_over_loops(!condition);
+            predicate = make_or(predicate, make_or(make_and(maybe_true, true_predicate),
+                                                   make_and(maybe_false, false_predicate)));
+        } else if (varies) {
             predicate = make_or(predicate, make_or(true_predicate, false_predicate));
         } else {
             predicate = make_or(predicate, make_select(condition, true_predicate, false_predicate));
         }
 
         varies = varies || old_varies;
+        varies_unknowably = varies_unknowably || old_varies_unknowably;
     }
 
     void visit(const Select *op) override {
@@ -227,6 +339,7 @@ private:
 
     void visit(const Call *op) override {
         varies |= in_pipeline.contains(op->name);
+        varies_unknowably |= in_pipeline.contains(op->name);
 
         IRVisitor::visit(op);
 
@@ -254,7 +367,9 @@ private:
         // allocation.
         ScopedBinding<>
             bind_host_ptr(varying, op->name),
-            bind_buffer(varying, op->name + ".buffer");
+            bind_buffer(varying, op->name + ".buffer"),
+            bind_host_ptr_unknowably(varying_unknowably, op->name),
+            bind_buffer_unknowably(varying_unknowably, op->name + ".buffer");
         IRVisitor::visit(op);
     }
 };
@@ -757,6 +757,12 @@ class SlidingWindow : public IRMutator {
             return IRMutator::visit(op);
         }
 
+        // Ring-buffered storage is written afresh on each iteration,
+        // so there's no previous iteration to pick values up from.
+        if (sched.ring_buffer().defined()) {
+            return IRMutator::visit(op);
+        }
+
         // We want to slide innermost first, so put it on the front of
         // the list.
         sliding.push_front(iter->second);
@@ -0,0 +1,417 @@
+#include "Sort.h"
+#include "IR.h"
+#include "IROperator.h"
+#include "Util.h"
+
+namespace Halide {
+
+namespace Sort {
+
+namespace {
+
+using Internal::Let;
+using Internal::Variable;
+using std::pair;
+using std::string;
+using std::vector;
+
+vector<Var> make_args(int dimensions) {
+    vector<Var> args;
+    for (int i = 0; i < dimensions; i++) {
+        args.emplace_back(Internal::unique_name('s'));
+    }
+    return args;
+}
+
+// The args with the site along the first dimension replaced.
+vector<Expr> at(const vector<Var> &args, const Expr &x) {
+    vector<Expr> actuals(args.begin(), args.end());
+    actuals[0] = x;
+    return actuals;
+}
+
+// The elements of the value of a Func at a site.
+vector<Expr> values(const Func &f, const vector<Expr> &args) {
+    FuncRef ref = f(args);
+    vector<Expr> result;
+    if (f.outputs() == 1) {
+        result.emplace_back(ref);
+    } else {
+        for (int i = 0; i < f.outputs(); i++) {
+            result.emplace_back(ref[i]);
+        }
+    }
+    return result;
+}
+
+void define(Func &f, const vector<Var> &args, const vector<Expr> &value) {
+    if (value.size() == 1) {
+        f(args) = value[0];
+    } else {
+        f(args) = Tuple(value);
+    }
+}
+
+vector<Expr> select(const Expr &condition, const vector<Expr> &a, const vector<Expr> &b) {
+    vector<Expr> result;
+    for (size_t i = 0; i < a.size(); i++) {
+        result.push_back(Halide::select(condition, a[i], b[i]));
+    }
+    return result;
+}
+
+int next_power_of_two(int x) {
+    int p = 1;
+    while (p < x) {
+        p *= 2;
+    }
+    return p;
+}
+
+// Fuse all the dimensions after the first into one, outermost loop,
+// and return it, or return an undefined Var if there are none.
+Var fuse_rows(Stage s, const vector<Var> &args) {
+    if (args.size() < 2) {
+        return Var();
+    }
+    Var rows = args[1];
+    for (size_t i = 2; i < args.size(); i++) {
+        Var fused(Internal::unique_name('s'));
+        s.fuse(rows, args[i], fused);
+        rows = fused;
+    }
+    return rows;
+}
+
+// The default schedule of a pass over the rows.
+void schedule_pass(Func f, const vector<Var> &args, int size, const Target &target) {
+    f.compute_root();
+    Var rows = fuse_rows(f, args);
+    Var x = args[0], xo, xi;
+    if (target.has_gpu_feature()) {
+        f.gpu_tile(x, xo, xi, std::min(size, 64), TailStrategy::GuardWithIf);
+        if (args.size() > 1) {
+            f.gpu_blocks(rows);
+        }
+    } else {
+        const int vector_size = target.natural_vector_size(f.types()[0]);
+        if (args.size() > 1) {
+            f.parallel(rows).vectorize(x, vector_size, TailStrategy::GuardWithIf);
+        } else if (size >= 8192) {
+            // A single long row is split into chunks, one per task.
+            f.split(x, xo, xi, 1024, TailStrategy::GuardWithIf)
+                .parallel(xo)
+                .vectorize(xi, vector_size, TailStrategy::GuardWithIf);
+        } else {
+            f.vectorize(x, vector_size, TailStrategy::GuardWithIf);
+        }
+    }
+}
+
+// A bitonic sort along the first dimension, without the checks.
+Func bitonic_sort(const Func &source, int size, const Target &target) {
+    vector<Var> args = make_args(source.dimensions());
+    Var x = args[0];
+
+    Func prev("bitonic_input");
+    define(prev, args, values(source, vector<Expr>(args.begin(), args.end())));
+    if (size == 1) {
+        return prev;
+    }
+
+    for (int pass_size = 1; pass_size < size; pass_size *= 2) {
+        for (int chunk_size = pass_size; chunk_size > 0; chunk_size /= 2) {
+            Expr chunk_start = (x / (2 * chunk_size)) * (2 * chunk_size);
+            Expr chunk_middle = chunk_start + chunk_size;
+            Expr partner;
+            if (chunk_size == pass_size) {
+                // The first pass of each merge compares each element of
+                // the first half with the mirror image of it in the
+                // second, which merges two sorted runs into one.
+                partner = 2 * chunk_middle - x - 1;
+            } else {
+                partner = chunk_start + (x - chunk_start + chunk_size) % (2 * chunk_size);
+            }
+            // The clamp helps out bounds inference.
+            partner = clamp(partner, chunk_start, chunk_start + 2 * chunk_size - 1);
+
+            vector<Expr> mine = values(prev, at(args, x));
+            vector<Expr> theirs = values(prev, at(args, partner));
+            // The element in the first half of the chunk gets the
+            // smaller of the two, and the one in the second half the
+            // larger. Both sides must agree on which one that is when
+            // the keys are equal.
+            Expr first_half = x < chunk_middle;
+            Expr swap = Halide::select(first_half, theirs[0] < mine[0], mine[0] < theirs[0]);
+
+            Func next("bitonic_pass");
+            define(next, args, select(swap, theirs, mine));
+            schedule_pass(next, args, size, target);
+            prev = next;
+        }
+    }
+    return prev;
+}
+
+}  // namespace
+
+Func bitonic(const Func &source, int size, const Target &target) {
+    user_assert(size > 0 && (size & (size - 1)) == 0)
+        << "Sort::bitonic was asked to sort " << size
+        << " elements of Func " << source.name() << ", which is not a power of two.\n";
+    return bitonic_sort(source, size, target);
+}
+
+Func merge(const Func &source, int size, const Target &target) {
+    user_assert(size > 0)
+        << "Sort::merge was asked to sort " << size << " elements of Func " << source.name() << "\n";
+
+    vector<Var> args = make_args(source.dimensions());
+    Var x = args[0];
+
+    Func prev("merge_input");
+    define(prev, args, values(source, vector<Expr>(args.begin(), args.end())));
+
+    for (int run = 1; run < size; run *= 2) {
+        // Each site is at rank i in the merge of a run a starting at
+        // a_start and the run b after it, either of which may be cut
+        // short, or empty, at the end of the row.
+        Expr a_start = (x / (2 * run)) * (2 * run);
+        Expr b_start = a_start + run;
+        Expr i = x - a_start;
+        Expr a_size = clamp(size - a_start, 0, run);
+        Expr b_size = clamp(size - b_start, 0, run);
+
+        vector<pair<string, Expr>> lets;
+        auto bind = [&](const Expr &e) {
+            string name = Internal::unique_name('m');
+            lets.emplace_back(name, e);
+            return Variable::make(e.type(), name);
+        };
+        auto key = [&](const Expr &idx) {
+            return values(prev, at(args, clamp(idx, 0, size - 1)))[0];
+        };
+
+        // Binary search for the number of elements of a that come
+        // before rank i: the smallest one such that the element of a
+        // there comes after the element of b before it. Elements of a
+        // come first when the keys are equal, which keeps the sort
+        // stable.
+        Expr lo = bind(max(0, i - b_size));
+        Expr hi = bind(min(i, a_size));
+        for (int range = run; range > 0; range /= 2) {
+            Expr searching = lo < hi;
+            Expr mid = bind((lo + hi) / 2);
+            Expr a_after = key(b_start + i - mid - 1) < key(a_start + mid);
+            Expr new_lo = bind(Halide::select(searching && !a_after, mid + 1, lo));
+            Expr new_hi = bind(Halide::select(searching && a_after, mid, hi));
+            lo = new_lo;
+            hi = new_hi;
+        }
+        Expr from_a = lo;
+        Expr from_b = i - from_a;
+
+        vector<Expr> a = values(prev, at(args, clamp(a_start + from_a, 0, size - 1)));
+        vector<Expr> b = values(prev, at(args, clamp(b_start + from_b, 0, size - 1)));
+        Expr take_a = from_a < a_size && (from_b >= b_size || !(b[0] < a[0]));
+        vector<Expr> value = select(take_a, a, b);
+        for (Expr &e : value) {
+            for (auto it = lets.rbegin(); it != lets.rend(); it++) {
+                e = Let::make(it->first, it->second, e);
+            }
+        }
+
+        Func next("merge_pass");
+        define(next, args, value);
+        schedule_pass(next, args, size, target);
+        prev = next;
+    }
+    return prev;
+}
+
+Func radix(const Func &source, int size, const Target &target) {
+    user_assert(size > 0)
+        << "Sort::radix was asked to sort " << size << " elements of Func " << source.name() << "\n";
+    user_assert(source.outputs() == 1)
+        << "Sort::radix can't sort Func " << source.name() << ", which returns a Tuple.\n";
+    const Type t = source.types()[0];
+    user_assert((t.is_int() || t.is_uint()) && t.bits() <= 32)
+        << "Sort::radix can only sort integers of up to 32 bits, not the "
+        << t << " values of Func " << source.name() << ".\n";
+
+    const int dimensions = source.dimensions();
+    vector<Var> args = make_args(dimensions);
+    Var x = args[0];
+    vector<Var> rows(args.begin() + 1, args.end());
+
+    Func prev("radix_input");
+    prev(args) = source(args);
+    if (size == 1) {
+        return prev;
+    }
+
+    // Each row is counted in blocks of this many elements, one block
+    // per task, so the counts fit in 16 bits.
+    const int block = std::min(size, 4096);
+    const int blocks = (size + block - 1) / block;
+    const int radix_bits = 4, digits = 1 << radix_bits;
+
+    for (int shift = 0; shift < t.bits(); shift += radix_bits) {
+        // The digit of the element at index i. Flipping the sign bit of
+        // signed integers puts the negative ones first.
+        Expr i_var = Variable::make(Int(32), Internal::unique_name('r'));
+        Expr bits = cast(UInt(32), reinterpret(UInt(t.bits()), prev(at(args, clamp(i_var, 0, size - 1)))));
+        if (t.is_int()) {
+            bits = bits ^ Internal::make_const(UInt(32), (int64_t)1 << (t.bits() - 1));
+        }
+        Expr digit_of_var = cast(Int(32), (bits >> shift) & (digits - 1));
+        auto digit = [&](const Expr &i) {
+            return Let::make(i_var.as<Variable>()->name, i, digit_of_var);
+        };
+
+        // The number of elements of each digit before each element of
+        // each block.
+        Var d, xi, b;
+        vector<Var> count_args = {d, xi, b};
+        count_args.insert(count_args.end(), rows.begin(), rows.end());
+        Func count("radix_count");
+        count(count_args) = cast(UInt(16), 0);
+        RDom r(1, block - 1);
+        vector<Expr> here = {d, r, b}, before = {d, r - 1, b};
+        here.insert(here.end(), rows.begin(), rows.end());
+        before.insert(before.end(), rows.begin(), rows.end());
+        Expr i_before = b * block + r - 1;
+        count(here) = count(before) + cast(UInt(16), i_before < size && digit(i_before) == d);
+
+        // The number of elements of each digit in each block.
+        Func total("radix_total");
+        vector<Var> total_args = {d, b};
+        total_args.insert(total_args.end(), rows.begin(), rows.end());
+        vector<Expr> last = {d, block - 1, b};
+        last.insert(last.end(), rows.begin(), rows.end());
+        Expr i_last = b * block + block - 1;
+        total(total_args) = (cast(Int(32), count(last)) +
+                             cast(Int(32), i_last < size && digit(i_last) == d));
+
+        // The number of elements before the first element of each digit
+        // in each block, in order of digit and then block.
+        Var k;
+        vector<Var> offset_args = {k};
+        offset_args.insert(offset_args.end(), rows.begin(), rows.end());
+        Func offset("radix_offset");
+        offset(offset_args) = 0;
+        RDom rk(1, digits * blocks - 1);
+        vector<Expr> offset_here = {rk}, offset_before = {rk - 1};
+        offset_here.insert(offset_here.end(), rows.begin(), rows.end());
+        offset_before.insert(offset_before.end(), rows.begin(), rows.end());
+        vector<Expr> total_before = {(rk - 1) / blocks, (rk - 1) % blocks};
+        total_before.insert(total_before.end(), rows.begin(), rows.end());
+        offset(offset_here) = offset(offset_before) + total(total_before);
+
+        // Scatter each element to its place.
+        RDom ri(0, size);
+        Expr digit_i = digit(ri);
+        vector<Expr> offset_i = {digit_i * blocks + ri / block}, count_i = {digit_i, ri % block, ri / block};
+        offset_i.insert(offset_i.end(), rows.begin(), rows.end());
+        count_i.insert(count_i.end(), rows.begin(), rows.end());
+        Expr dest = offset(offset_i) + cast(Int(32), count(count_i));
+        Func next("radix_pass");
+        next(args) = undef(t);
+        next(at(args, clamp(dest, 0, size - 1))) = prev(at(args, ri));
+
+        // Schedule the passes. The elements of each digit land in the
+        // order of their indices, so the scatter may be done in any
+        // order.
+        count.compute_root();
+        offset.compute_root();
+        next.compute_root();
+        next.update().allow_race_conditions();
+        RVar ro, rii;
+        if (target.has_gpu_feature()) {
+            count.reorder(xi, d, b).gpu_blocks(b).gpu_threads(d);
+            count.update().gpu_blocks(b).gpu_threads(d);
+            offset.gpu_single_thread();
+            offset.update().gpu_single_thread();
+            next.update().gpu_tile(ri, ro, rii, 64, TailStrategy::GuardWithIf);
+        } else {
+            count.vectorize(d, digits);
+            count.update().reorder(d, r, b).vectorize(d, digits).parallel(b);
+            Var offset_rows = fuse_rows(offset.update(0), offset_args);
+            if (!rows.empty()) {
+                offset.update().parallel(offset_rows);
+            }
+            next.update().split(ri, ro, rii, block).parallel(ro);
+        }
+        prev = next;
+    }
+    return prev;
+}
+
+Func top_k(const Func &source, int k, int size, const Target &target) {
+    user_assert(k > 0 && k <= size)
+        << "Sort::top_k was asked for the top " << k << " of " << size
+        << " elements of Func " << source.name() << "\n";
+
+    // The candidates are kept in power-of-two runs, so that they can be
+    // sorted with a bitonic sort. Each row is first split into blocks
+    // of twice that.
+    const int candidates = next_power_of_two(k);
+    const int block = std::min(std::max(2 * candidates, 64), next_power_of_two(size));
+    int blocks = (size + block - 1) / block;
+
+    vector<Var> args = make_args(source.dimensions() + 1);
+    Var j = args[0], b = args[1];
+    vector<Var> rows(args.begin() + 2, args.end());
+
+    // Gather the values and their indices into blocks, padded with the
+    // lowest value there is.
+    const Type t = source.types()[0];
+    Expr index = b * block + j;
+    vector<Expr> source_args = {clamp(index, 0, size - 1)};
+    source_args.insert(source_args.end(), rows.begin(), rows.end());
+    Expr valid = index < size;
+    Expr lowest = t.min();
+    Func blocked("top_k_blocks");
+    blocked(args) = Tuple(Halide::select(valid, values(source, source_args)[0], lowest),
+                          Halide::select(valid, index, -1));
+
+    // The largest candidates of each block, in descending order.
+    Func sorted = bitonic_sort(blocked, block, target);
+    Func best("top_k_candidates");
+    best(args) = Tuple(values(sorted, at(args, block - 1 - j)));
+
+    // Merge the candidates of pairs of blocks until there is only one.
+    while (blocks > 1) {
+        const int pairs = (blocks + 1) / 2;
+        // The candidates of one block, followed by those of the next.
+        // An odd block out at the end gets merged with padding.
+        vector<Expr> first = {clamp(j, 0, candidates - 1), 2 * b};
+        vector<Expr> second = {clamp(j - candidates, 0, candidates - 1), min(2 * b + 1, blocks - 1)};
+        first.insert(first.end(), rows.begin(), rows.end());
+        second.insert(second.end(), rows.begin(), rows.end());
+        Expr has_second = 2 * b + 1 < blocks;
+        vector<Expr> a = values(best, first), c = values(best, second);
+        c[0] = Halide::select(has_second, c[0], lowest);
+        c[1] = Halide::select(has_second, c[1], -1);
+        Func paired("top_k_pairs");
+        paired(args) = Tuple(select(j < candidates, a, c));
+
+        Func merged = bitonic_sort(paired, 2 * candidates, target);
+        Func next("top_k_candidates");
+        next(args) = Tuple(values(merged, at(args, 2 * candidates - 1 - j)));
+        best = next;
+        blocks = pairs;
+        schedule_pass(best, args, candidates, target);
+    }
+
+    vector<Var> result_args = make_args(source.dimensions());
+    vector<Expr> best_args = {result_args[0], 0};
+    best_args.insert(best_args.end(), result_args.begin() + 1, result_args.end());
+    Func result("top_k");
+    result(result_args) = Tuple(values(best, best_args));
+    return result;
+}
+
+}  // namespace Sort
+
+}  // namespace Halide
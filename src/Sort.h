@@ -0,0 +1,66 @@
+#ifndef HALIDE_SORT_H
+#define HALIDE_SORT_H
+
+/** \file
+ * Data-parallel sorting and selection of the values of Halide::Funcs.
+ */
+
+#include "Func.h"
+#include "Target.h"
+
+namespace Halide {
+
+/** namespace to hold functions that sort the values of a Func, or
+ * select the largest of them.
+ *
+ * All functions in this namespace sort along the first dimension of
+ * the source Func, over the range [0, size), and return a Func with
+ * the same dimensions that holds the sorted values in that range. Any
+ * other dimensions are independent rows, each sorted separately, e.g.
+ * a Func with two dimensions is sorted one row at a time. If the
+ * source Func returns a Tuple, its elements are sorted by the first
+ * one, which must have an ordering, and the rest are carried along
+ * with it.
+ *
+ * Sorting takes many passes over the data, so each pass is given a
+ * schedule of its own, computed at root, for the given Target: on
+ * CPUs, vectorized along the row and parallel across the rows (or
+ * across chunks of a single long row); with a GPU feature, threads
+ * along the row and blocks across the rows. The result can be used
+ * like any other Func, and can be scheduled as usual, but the passes
+ * within it can't be.
+ */
+namespace Sort {
+
+/** Sort with a bitonic sorting network. The size must be a power of
+ * two. Every pass does the same amount of work at each site, so this
+ * vectorizes well and suits GPUs, at the cost of O(n log^2 n) work. */
+Func bitonic(const Func &source, int size, const Target &target);
+
+/** Sort stably with a merge sort, in which each element of each pass
+ * finds where it comes from with a binary search along the merge path
+ * of the two runs it is merged from, so that the elements are
+ * independent of each other. Any size may be sorted. */
+Func merge(const Func &source, int size, const Target &target);
+
+/** Sort stably with a least-significant-digit radix sort, four bits at
+ * a time. The source Func must return a single integer of at most 32
+ * bits. Each pass counts the digits in blocks of the row in parallel,
+ * then scans the counts, and then scatters the elements in parallel. It
+ * does O(n) work per pass, so it is the fastest way to sort long rows
+ * of integers, at the cost of 32 bytes of scratch memory per element. */
+Func radix(const Func &source, int size, const Target &target);
+
+/** Find the k largest values in each row, with a bitonic sort of each
+ * block of the row followed by a tree of merges of the candidates from
+ * each block. The result is defined over [0, k) along its first
+ * dimension, in descending order, and returns a Tuple of each value
+ * (the first element of the source's Tuple, if it returns one) and its
+ * index in the row. With k = 1 this is a parallel argmax. */
+Func top_k(const Func &source, int k, int size, const Target &target);
+
+}  // namespace Sort
+
+}  // namespace Halide
+
+#endif
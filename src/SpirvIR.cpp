@@ -112,7 +112,7 @@ void SpvInstruction::add_data(uint32_t bytes, const void *data) {
         memcpy(&entry, ptr, copy_size);
         bytes_copied += copy_size;
         add_immediate(entry);
-        ptr++;
+        ptr += copy_size;
     }
 }
 
@@ -168,7 +168,7 @@ void SpvBlock::add_instruction(SpvInstruction inst) {
 void SpvBlock::add_variable(SpvInstruction var) {
     check_defined();
     var.set_block(*this);
-    contents->instructions.push_back(var);
+    contents->variables.push_back(var);
 }
 
 void SpvBlock::set_function(SpvFunction func) {
@@ -202,6 +202,9 @@ bool SpvBlock::is_defined() const {
 
 bool SpvBlock::is_terminated() const {
     check_defined();
+    if (contents->instructions.empty()) {
+        return false;
+    }
     switch (contents->instructions.back().op_code()) {
     case SpvOpBranch:
     case SpvOpBranchConditional:
@@ -397,7 +400,9 @@ void SpvModule::add_type(const SpvInstruction &val) {
 
 void SpvModule::add_constant(const SpvInstruction &val) {
     check_defined();
-    contents->constants.push_back(val);
+    // Types may refer to constants (eg the length of an array), so both
+    // are kept in the order they were declared.
+    contents->types.push_back(val);
 }
 
 void SpvModule::add_global(const SpvInstruction &val) {
@@ -501,9 +506,31 @@ bool SpvModule::is_capability_required(SpvCapability capability) const {
     return false;
 }
 
+void SpvModule::import_instruction_set(SpvId id, const std::string &instruction_set) {
+    check_defined();
+    if (contents->imports.find(instruction_set) == contents->imports.end()) {
+        contents->imports.insert({instruction_set, id});
+    }
+}
+
+bool SpvModule::is_imported(const std::string &instruction_set) const {
+    check_defined();
+    return contents->imports.find(instruction_set) != contents->imports.end();
+}
+
+SpvId SpvModule::lookup_import(const std::string &instruction_set) const {
+    check_defined();
+    SpvModuleContents::Imports::const_iterator it = contents->imports.find(instruction_set);
+    if (it == contents->imports.end()) {
+        return SpvInvalidId;
+    }
+    return it->second;
+}
+
 SpvModule::EntryPointNames SpvModule::entry_point_names() const {
     check_defined();
-    SpvModule::EntryPointNames entry_point_names(contents->entry_points.size());
+    SpvModule::EntryPointNames entry_point_names;
+    entry_point_names.reserve(contents->entry_points.size());
     for (const SpvModuleContents::EntryPoints::value_type &v : contents->entry_points) {
         entry_point_names.push_back(v.first);
     }
@@ -542,8 +569,8 @@ void SpvModule::encode(SpvBinary &binary) const {
     }
 
     // 3. Extended Instruction Set Imports
-    for (const std::string &import : contents->imports) {
-        SpvInstruction inst = SpvFactory::import(import);
+    for (const SpvModuleContents::Imports::value_type &import : contents->imports) {
+        SpvInstruction inst = SpvFactory::import(import.second, import.first);
         inst.encode(binary);
     }
 
@@ -572,17 +599,12 @@ void SpvModule::encode(SpvBinary &binary) const {
         inst.encode(binary);
     }
 
-    // 9a. Type Declarations
+    // 9a. Type & Constant Declarations
     for (const SpvInstruction &inst : contents->types) {
         inst.encode(binary);
     }
 
-    // 9b. Constants
-    for (const SpvInstruction &inst : contents->constants) {
-        inst.encode(binary);
-    }
-
-    // 9c. Globals
+    // 9b. Globals
     for (const SpvInstruction &inst : contents->globals) {
         inst.encode(binary);
     }
@@ -613,7 +635,7 @@ SpvId SpvBuilder::declare_id(SpvKind kind) {
 
 SpvKind SpvBuilder::kind_of(SpvId item_id) {
     KindMap::const_iterator it = kind_map.find(item_id);
-    if (it != kind_map.end()) {
+    if (it == kind_map.end()) {
         return SpvInvalidItem;
     }
     return it->second;
@@ -621,7 +643,11 @@ SpvKind SpvBuilder::kind_of(SpvId item_id) {
 
 void SpvBuilder::encode(SpvBinary &binary) const {
     // Encode the module
+    const size_t header_offset = binary.size();
     module.encode(binary);
+
+    // Patch the bound in the header, which must be larger than every id used
+    binary[header_offset + 3] = (uint32_t)kind_map.size() + 1;
 }
 
 SpvId SpvBuilder::map_type(const Type &type, uint32_t array_size) {
@@ -633,11 +659,8 @@ SpvId SpvBuilder::map_type(const Type &type, uint32_t array_size) {
 }
 
 SpvId SpvBuilder::map_pointer_type(const Type &type, SpvStorageClass storage_class) {
-    SpvId ptr_type_id = lookup_pointer_type(type, storage_class);
-    if (ptr_type_id == SpvInvalidId) {
-        ptr_type_id = declare_pointer_type(ptr_type_id, storage_class);
-    }
-    return ptr_type_id;
+    SpvId base_type_id = map_type(type);
+    return map_pointer_type(base_type_id, storage_class);
 }
 
 SpvId SpvBuilder::map_pointer_type(SpvId type_id, SpvStorageClass storage_class) {
@@ -664,6 +687,35 @@ SpvId SpvBuilder::map_constant(const Type &type, const void *data) {
     return result_id;
 }
 
+SpvId SpvBuilder::map_null_constant(const Type &type) {
+    SpvId result_id = lookup_null_constant(type);
+    if (result_id == SpvInvalidId) {
+        result_id = declare_null_constant(type);
+    }
+    return result_id;
+}
+
+SpvId SpvBuilder::map_bool_constant(bool value) {
+    return declare_bool_constant(value);
+}
+
+SpvId SpvBuilder::map_struct(const StructMemberTypes &member_types) {
+    SpvId struct_id = lookup_struct(member_types);
+    if (struct_id == SpvInvalidId) {
+        struct_id = declare_struct(member_types);
+    }
+    return struct_id;
+}
+
+SpvId SpvBuilder::import_instruction_set(const std::string &instruction_set) {
+    SpvId import_id = module.lookup_import(instruction_set);
+    if (import_id == SpvInvalidId) {
+        import_id = declare_id(SpvImportId);
+        module.import_instruction_set(import_id, instruction_set);
+    }
+    return import_id;
+}
+
 void SpvBuilder::add_entry_point(const std::string &name,
                                  SpvId func_id, SpvExecutionModel exec_model,
                                  const Variables &variables) {
@@ -698,8 +750,11 @@ SpvId SpvBuilder::add_global_variable(SpvId type_id, uint32_t storage_class, Spv
 }
 
 SpvId SpvBuilder::add_variable(SpvId type_id, uint32_t storage_class, SpvId init_id) {
+    // Function variables must be declared at the start of the entry block
+    SpvFunction func = current_function();
+    user_assert(func.is_defined()) << "SPIRV: Variables can only be added inside a function!\n";
     SpvId var_id = reserve_id(SpvVariableId);
-    current_block().add_variable(SpvFactory::variable(var_id, type_id, storage_class, init_id));
+    func.entry_block().add_variable(SpvFactory::variable(var_id, type_id, storage_class, init_id));
     return var_id;
 }
 
@@ -839,9 +894,11 @@ SpvId SpvBuilder::declare_type(const Type &type, uint32_t array_size) {
     }
 
     if (array_size > 1) {
-        SpvId array_type_id = declare_id(SpvArrayTypeId);
+        // The length of an array is the id of a 32-bit integer constant
         SpvId element_type_id = declare_type(type, 1);
-        SpvInstruction inst = SpvFactory::array_type(array_type_id, element_type_id, array_size);
+        SpvId array_size_id = declare_constant(UInt(32), &array_size);
+        SpvId array_type_id = declare_id(SpvArrayTypeId);
+        SpvInstruction inst = SpvFactory::array_type(array_type_id, element_type_id, array_size_id);
         module.add_type(inst);
         type_map[type_key] = array_type_id;
         return array_type_id;
@@ -1068,7 +1125,24 @@ SpvId SpvBuilder::declare_scalar_constant(const Type &scalar_type, const void *d
     }
 
     SpvId type_id = declare_type(scalar_type);
-    SpvInstruction inst = SpvFactory::constant(result_id, type_id, scalar_type.bytes(), data);
+    SpvInstruction inst;
+    if (scalar_type.bits() < 32) {
+        // Literals narrower than a word must be zero extended (or sign
+        // extended, for signed integers) to a full word
+        uint32_t value = 0;
+        if (scalar_type.is_int() && scalar_type.bits() == 8) {
+            value = (uint32_t)(int32_t) * (const int8_t *)data;
+        } else if (scalar_type.is_int() && scalar_type.bits() == 16) {
+            value = (uint32_t)(int32_t) * (const int16_t *)data;
+        } else if (scalar_type.bits() == 8) {
+            value = *(const uint8_t *)data;
+        } else {
+            value = *(const uint16_t *)data;
+        }
+        inst = SpvFactory::constant(result_id, type_id, sizeof(value), &value);
+    } else {
+        inst = SpvFactory::constant(result_id, type_id, scalar_type.bytes(), data);
+    }
     module.add_constant(inst);
     constant_map[constant_key] = result_id;
     return result_id;
@@ -1087,51 +1161,20 @@ SpvId SpvBuilder::declare_vector_constant(const Type &type, const void *data) {
     }
 
     Type scalar_type = type.with_lanes(1);
-    std::vector<SpvId> components(type.lanes());
-    if (scalar_type.is_float()) {
-        if (type.bits() == 64) {
-            const double *values = (const double *)data;
-            for (int c = 0; c < type.lanes(); c++) {
-                const double *entry = &(values[c]);
-                SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
-                components.push_back(scalar_id);
-            }
-        } else {
-            const float *values = (const float *)data;
-            for (int c = 0; c < type.lanes(); c++) {
-                const float *entry = &(values[c]);
-                SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
-                components.push_back(scalar_id);
-            }
-        }
-    } else if (scalar_type.is_bool()) {
-        const bool *values = (const bool *)data;
-        for (int c = 0; c < type.lanes(); c++) {
-            const bool *entry = &(values[c]);
-            SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
-            components.push_back(scalar_id);
-        }
-    } else if (scalar_type.is_int_or_uint()) {
-        if (type.bits() == 64) {
-            const uint64_t *values = (const uint64_t *)data;
-            for (int c = 0; c < type.lanes(); c++) {
-                const uint64_t *entry = &(values[c]);
-                SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
-                components.push_back(scalar_id);
-            }
-        } else {
-            const uint32_t *values = (const uint32_t *)data;
-            for (int c = 0; c < type.lanes(); c++) {
-                const uint32_t *entry = &(values[c]);
-                SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
-                components.push_back(scalar_id);
-            }
-        }
-    } else {
+    if (!(scalar_type.is_float() || scalar_type.is_bool() || scalar_type.is_int_or_uint())) {
         internal_error << "SPIRV: Unsupported type:" << type << "\n";
         return SpvInvalidId;
     }
 
+    std::vector<SpvId> components;
+    components.reserve(type.lanes());
+    const uint8_t *values = (const uint8_t *)data;
+    for (int c = 0; c < type.lanes(); c++) {
+        const uint8_t *entry = values + c * scalar_type.bytes();
+        SpvId scalar_id = declare_scalar_constant(scalar_type, (const void *)entry);
+        components.push_back(scalar_id);
+    }
+
     SpvId result_id = declare_id(SpvCompositeConstantId);
     SpvId type_id = declare_type(type);
     SpvInstruction inst = SpvFactory::composite_constant(result_id, type_id, components);
@@ -1267,6 +1310,7 @@ SpvInstruction SpvFactory::decorate(SpvId target_id, SpvDecoration decoration_ty
 SpvInstruction SpvFactory::decorate_member(SpvId struct_type_id, uint32_t member_index, SpvDecoration decoration_type, const SpvFactory::Literals &literals) {
     SpvInstruction inst = SpvInstruction::make(SpvOpMemberDecorate);
     inst.add_operand(struct_type_id);
+    inst.add_immediate(member_index);
     inst.add_immediate(decoration_type);
     for (uint32_t l : literals) {
         inst.add_immediate(l);
@@ -1334,11 +1378,11 @@ SpvInstruction SpvFactory::vector_type(SpvId vector_type_id, SpvId element_type_
     return inst;
 }
 
-SpvInstruction SpvFactory::array_type(SpvId array_type_id, SpvId element_type_id, uint32_t array_size) {
+SpvInstruction SpvFactory::array_type(SpvId array_type_id, SpvId element_type_id, SpvId array_size_id) {
     SpvInstruction inst = SpvInstruction::make(SpvOpTypeArray);
     inst.set_result_id(array_type_id);
     inst.add_operand(element_type_id);
-    inst.add_immediate(array_size);
+    inst.add_operand(array_size_id);
     return inst;
 }
 
@@ -1368,8 +1412,8 @@ SpvInstruction SpvFactory::pointer_type(SpvId pointer_type_id, SpvStorageClass s
 
 SpvInstruction SpvFactory::function_type(SpvId function_type_id, SpvId return_type_id, const SpvFactory::ParamTypes &param_type_ids) {
     SpvInstruction inst = SpvInstruction::make(SpvOpTypeFunction);
-    inst.set_type_id(return_type_id);
     inst.set_result_id(function_type_id);
+    inst.add_operand(return_type_id);
     for (SpvId type_id : param_type_ids) {
         inst.add_operand(type_id);
     }
@@ -1478,11 +1522,11 @@ SpvInstruction SpvFactory::exec_mode_local_size(SpvId function_id, uint32_t wg_s
     return inst;
 }
 
-SpvInstruction SpvFactory::control_barrier(SpvId execution_scope_id, SpvId memory_scope_id, uint32_t semantics_mask) {
+SpvInstruction SpvFactory::control_barrier(SpvId execution_scope_id, SpvId memory_scope_id, SpvId semantics_mask_id) {
     SpvInstruction inst = SpvInstruction::make(SpvOpControlBarrier);
     inst.add_operand(execution_scope_id);
     inst.add_operand(memory_scope_id);
-    inst.add_immediate(semantics_mask);
+    inst.add_operand(semantics_mask_id);
     return inst;
 }
 
@@ -1544,13 +1588,56 @@ SpvInstruction SpvFactory::composite_extract(SpvId type_id, SpvId result_id, Spv
     return inst;
 }
 
-SpvInstruction SpvFactory::vector_insert_dynamic(SpvId result_id, SpvId vector_id, SpvId value_id, uint32_t index) {
+SpvInstruction SpvFactory::vector_insert_dynamic(SpvId type_id, SpvId result_id, SpvId vector_id, SpvId value_id, SpvId index_id) {
     SpvInstruction inst = SpvInstruction::make(SpvOpVectorInsertDynamic);
-    inst.set_type_id(SpvOpTypeVector);
+    inst.set_type_id(type_id);
     inst.set_result_id(result_id);
     inst.add_operand(vector_id);
     inst.add_operand(value_id);
-    inst.add_immediate(index);
+    inst.add_operand(index_id);
+    return inst;
+}
+
+SpvInstruction SpvFactory::vector_extract_dynamic(SpvId type_id, SpvId result_id, SpvId vector_id, SpvId index_id) {
+    SpvInstruction inst = SpvInstruction::make(SpvOpVectorExtractDynamic);
+    inst.set_type_id(type_id);
+    inst.set_result_id(result_id);
+    inst.add_operand(vector_id);
+    inst.add_operand(index_id);
+    return inst;
+}
+
+SpvInstruction SpvFactory::vector_shuffle(SpvId type_id, SpvId result_id, SpvId src_a_id, SpvId src_b_id, const Indices &indices) {
+    SpvInstruction inst = SpvInstruction::make(SpvOpVectorShuffle);
+    inst.set_type_id(type_id);
+    inst.set_result_id(result_id);
+    inst.add_operand(src_a_id);
+    inst.add_operand(src_b_id);
+    for (uint32_t i : indices) {
+        inst.add_immediate(i);
+    }
+    return inst;
+}
+
+SpvInstruction SpvFactory::composite_construct(SpvId type_id, SpvId result_id, const Components &constituents) {
+    SpvInstruction inst = SpvInstruction::make(SpvOpCompositeConstruct);
+    inst.set_type_id(type_id);
+    inst.set_result_id(result_id);
+    for (SpvId id : constituents) {
+        inst.add_operand(id);
+    }
+    return inst;
+}
+
+SpvInstruction SpvFactory::extended(SpvId instruction_set_id, uint32_t instruction_number, SpvId type_id, SpvId result_id, const Operands &operands) {
+    SpvInstruction inst = SpvInstruction::make(SpvOpExtInst);
+    inst.set_type_id(type_id);
+    inst.set_result_id(result_id);
+    inst.add_operand(instruction_set_id);
+    inst.add_immediate(instruction_number);
+    for (SpvId id : operands) {
+        inst.add_operand(id);
+    }
     return inst;
 }
 
@@ -1573,7 +1660,7 @@ SpvInstruction SpvFactory::branch(SpvId target_label_id) {
 }
 
 SpvInstruction SpvFactory::conditional_branch(SpvId condition_label_id, SpvId true_label_id, SpvId false_label_id, const SpvFactory::BranchWeights &weights) {
-    SpvInstruction inst = SpvInstruction::make(SpvOpBranch);
+    SpvInstruction inst = SpvInstruction::make(SpvOpBranchConditional);
     inst.add_operand(condition_label_id);
     inst.add_operand(true_label_id);
     inst.add_operand(false_label_id);
@@ -1621,9 +1708,10 @@ SpvInstruction SpvFactory::extension(const std::string &extension) {
     return inst;
 }
 
-SpvInstruction SpvFactory::import(const std::string &import) {
+SpvInstruction SpvFactory::import(SpvId instruction_set_id, const std::string &instruction_set_name) {
     SpvInstruction inst = SpvInstruction::make(SpvOpExtInstImport);
-    inst.add_string(import);
+    inst.set_result_id(instruction_set_id);
+    inst.add_string(instruction_set_name);
     return inst;
 }
 
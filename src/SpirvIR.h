@@ -68,6 +68,7 @@ enum SpvKind {
     SpvInstructionId,
     SpvFunctionId,
     SpvBlockId,
+    SpvImportId,
     SpvLabelId,
     SpvParameterId,
     SpvModuleId,
@@ -241,6 +242,7 @@ public:
 
     void require_capability(SpvCapability val);
     void require_extension(const std::string &val);
+    void import_instruction_set(SpvId id, const std::string &instruction_set);
 
     void set_source_language(SpvSourceLanguage val);
     void set_addressing_model(SpvAddressingModel val);
@@ -255,6 +257,8 @@ public:
 
     bool is_capability_required(SpvCapability val) const;
     bool is_extension_required(const std::string &val) const;
+    bool is_imported(const std::string &instruction_set) const;
+    SpvId lookup_import(const std::string &instruction_set) const;
     bool is_defined() const;
     SpvId id() const;
     void check_defined() const;
@@ -322,6 +326,10 @@ public:
 
     SpvId map_struct(const StructMemberTypes &member_types);
 
+    /** Import an extended instruction set (eg "GLSL.std.450"), returning
+     * the id to use with OpExtInst. */
+    SpvId import_instruction_set(const std::string &instruction_set);
+
     void add_entry_point(const std::string &name,
                          SpvId func_id, SpvExecutionModel exec_model,
                          const Variables &variables = {});
@@ -425,6 +433,7 @@ struct SpvFactory {
     using Literals = std::vector<uint32_t>;
     using BranchWeights = std::vector<uint32_t>;
     using Components = std::vector<SpvId>;
+    using Operands = std::vector<SpvId>;
     using ParamTypes = std::vector<SpvId>;
     using MemberTypeIds = std::vector<SpvId>;
     using Variables = std::vector<SpvId>;
@@ -433,7 +442,7 @@ struct SpvFactory {
 
     static SpvInstruction capability(const SpvCapability &capability);
     static SpvInstruction extension(const std::string &extension);
-    static SpvInstruction import(const std::string &import);
+    static SpvInstruction import(SpvId instruction_set_id, const std::string &instruction_set_name);
     static SpvInstruction label(SpvId result_id);
     static SpvInstruction decorate(SpvId target_id, SpvDecoration decoration_type, const Literals &literals = {});
     static SpvInstruction decorate_member(SpvId struct_type_id, uint32_t member_index, SpvDecoration decoration_type, const Literals &literals = {});
@@ -442,7 +451,7 @@ struct SpvFactory {
     static SpvInstruction integer_type(SpvId int_type_id, uint32_t bits, uint32_t signedness);
     static SpvInstruction float_type(SpvId float_type_id, uint32_t bits);
     static SpvInstruction vector_type(SpvId vector_type_id, SpvId element_type_id, uint32_t vector_size);
-    static SpvInstruction array_type(SpvId array_type_id, SpvId element_type_id, uint32_t array_size);
+    static SpvInstruction array_type(SpvId array_type_id, SpvId element_type_id, SpvId array_size_id);
     static SpvInstruction struct_type(SpvId result_id, const MemberTypeIds &member_type_ids);
     static SpvInstruction runtime_array_type(SpvId result_type_id, SpvId base_type_id);
     static SpvInstruction pointer_type(SpvId pointer_type_id, SpvStorageClass storage_class, SpvId base_type_id);
@@ -459,14 +468,18 @@ struct SpvFactory {
     static SpvInstruction entry_point(SpvId exec_model, SpvId func_id, const std::string &name, const Variables &variables);
     static SpvInstruction memory_model(SpvAddressingModel addressing_model, SpvMemoryModel memory_model);
     static SpvInstruction exec_mode_local_size(SpvId function_id, uint32_t wg_size_x, uint32_t wg_size_y, uint32_t wg_size_z);
-    static SpvInstruction control_barrier(SpvId execution_scope_id, SpvId memory_scope_id, uint32_t semantics_mask);
+    static SpvInstruction control_barrier(SpvId execution_scope_id, SpvId memory_scope_id, SpvId semantics_mask_id);
     static SpvInstruction logical_not(SpvId type_id, SpvId result_id, SpvId src_id);
     static SpvInstruction multiply_extended(SpvId type_id, SpvId result_id, SpvId src_a_id, SpvId src_b_id, bool is_signed);
     static SpvInstruction select(SpvId type_id, SpvId result_id, SpvId condition_id, SpvId true_id, SpvId false_id);
     static SpvInstruction in_bounds_access_chain(SpvId type_id, SpvId result_id, SpvId base_id, SpvId element_id, const Indices &indices);
     static SpvInstruction load(SpvId type_id, SpvId result_id, SpvId ptr_id, uint32_t access_mask = 0x0);
     static SpvInstruction store(SpvId ptr_id, SpvId obj_id, uint32_t access_mask = 0x0);
-    static SpvInstruction vector_insert_dynamic(SpvId result_id, SpvId vector_id, SpvId value_id, uint32_t index);
+    static SpvInstruction vector_insert_dynamic(SpvId type_id, SpvId result_id, SpvId vector_id, SpvId value_id, SpvId index_id);
+    static SpvInstruction vector_extract_dynamic(SpvId type_id, SpvId result_id, SpvId vector_id, SpvId index_id);
+    static SpvInstruction vector_shuffle(SpvId type_id, SpvId result_id, SpvId src_a_id, SpvId src_b_id, const Indices &indices);
+    static SpvInstruction composite_construct(SpvId type_id, SpvId result_id, const Components &constituents);
+    static SpvInstruction extended(SpvId instruction_set_id, uint32_t instruction_number, SpvId type_id, SpvId result_id, const Operands &operands);
     static SpvInstruction composite_extract(SpvId type_id, SpvId result_id, SpvId composite_id, const Indices &indices);
     static SpvInstruction bitcast(SpvId type_id, SpvId result_id, SpvId src_id);
     static SpvInstruction integer_add(SpvId type_id, SpvId result_id, SpvId src_a_id, SpvId src_b_id);
@@ -529,7 +542,7 @@ struct SpvFunctionContents {
 struct SpvModuleContents {
     using Capabilities = std::set<SpvCapability>;
     using Extensions = std::set<std::string>;
-    using Imports = std::set<std::string>;
+    using Imports = std::map<std::string, SpvId>;
     using Functions = std::vector<SpvFunction>;
     using Instructions = std::vector<SpvInstruction>;
     using EntryPoints = std::unordered_map<std::string, SpvInstruction>;
@@ -547,7 +560,6 @@ struct SpvModuleContents {
     Instructions debug;
     Instructions annotations;
     Instructions types;
-    Instructions constants;
     Instructions globals;
     Functions functions;
     Instructions instructions;
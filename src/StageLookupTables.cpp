@@ -0,0 +1,204 @@
+#include "StageLookupTables.h"
+
+#include <set>
+
+#include "Func.h"
+#include "Function.h"
+#include "IROperator.h"
+#include "IRPrinter.h"
+#include "IRVisitor.h"
+#include "Target.h"
+
+namespace Halide {
+namespace Internal {
+
+using std::map;
+using std::set;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Does an Expr read a Func or an image?
+class ReadsData : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide ||
+            op->call_type == Call::Image) {
+            result = true;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    bool result = false;
+};
+
+bool reads_data(const Expr &e) {
+    ReadsData r;
+    e.accept(&r);
+    return r.result;
+}
+
+// Find the Funcs called by a definition, and whether any of the calls
+// to each are at sites that depend on the values of Funcs or images.
+class FindLookups : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        if (op->call_type == Call::Halide && op->func.defined()) {
+            bool &dependent = data_dependent[op->name];
+            for (const Expr &arg : op->args) {
+                dependent = dependent || reads_data(arg);
+            }
+            funcs.emplace(op->name, Function(op->func));
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    map<string, bool> data_dependent;
+    map<string, Function> funcs;
+};
+
+// The size in bytes of a Func with constant bounds on all of its pure
+// vars, or -1 if it doesn't have them.
+int64_t constant_size(const Function &f) {
+    int64_t size = 0;
+    for (const Type &t : f.output_types()) {
+        size += t.bytes();
+    }
+    for (const string &arg : f.args()) {
+        const int64_t *extent = nullptr;
+        for (const Bound &b : f.schedule().bounds()) {
+            if (b.var == arg) {
+                extent = as_const_int(b.extent);
+            }
+        }
+        if (!extent) {
+            return -1;
+        }
+        size *= *extent;
+    }
+    return size;
+}
+
+// The loop of a consumer's pure definition inside which to stage its
+// lookup tables, and where to put them.
+struct Site {
+    string var;
+    DeviceAPI device_api;
+    MemoryType memory_type;
+    int64_t budget;
+};
+
+bool find_site(const Function &f, const Target &t, Site &site) {
+    // The dims are innermost first, so this finds the innermost GPU
+    // block loop.
+    for (const Dim &d : f.definition().schedule().dims()) {
+        if (d.for_type == ForType::GPUBlock) {
+            site = {d.var, d.device_api, MemoryType::GPUShared, 16 * 1024};
+            return true;
+        } else if (d.device_api == DeviceAPI::Hexagon &&
+                   (t.has_feature(Target::HVX_v65) ||
+                    t.has_feature(Target::HVX_v66) ||
+                    t.has_feature(Target::HVX_v68))) {
+            site = {d.var, d.device_api, MemoryType::VTCM, 64 * 1024};
+            return true;
+        }
+    }
+    return false;
+}
+
+}  // namespace
+
+void stage_lookup_tables(map<string, Function> &env, const Target &t) {
+    // Funcs the schedule already wraps are left to the schedule.
+    set<string> wrapped;
+    for (const auto &it : env) {
+        if (!it.second.wrappers().empty()) {
+            wrapped.insert(it.first);
+        }
+    }
+
+    map<string, Function> staged;
+    for (const auto &it : env) {
+        const Function &consumer = it.second;
+        Site site;
+        if (!consumer.has_pure_definition() ||
+            consumer.has_extern_definition() ||
+            consumer.schedule().compute_level().is_inlined() ||
+            !find_site(consumer, t, site)) {
+            continue;
+        }
+
+        FindLookups pure, updates;
+        consumer.definition().accept(&pure);
+        for (const Definition &def : consumer.updates()) {
+            def.accept(&updates);
+        }
+
+        for (const auto &l : pure.funcs) {
+            const Function &lut = l.second;
+            if (!pure.data_dependent[l.first] ||
+                updates.funcs.count(l.first) ||
+                wrapped.count(l.first) ||
+                !lut.schedule().compute_level().is_root()) {
+                continue;
+            }
+            int64_t size = constant_size(lut);
+            if (size < 0 || size > site.budget) {
+                continue;
+            }
+            site.budget -= size;
+
+            debug(1) << "Staging " << size << " bytes of " << lut.name()
+                     << " in " << site.memory_type << " for "
+                     << consumer.name() << "." << site.var << "\n";
+
+            Func wrapper = Func(lut).in(Func(consumer));
+            for (const Bound &b : lut.schedule().bounds()) {
+                if (b.min.defined()) {
+                    wrapper.bound(Var(b.var), b.min, b.extent);
+                } else {
+                    wrapper.bound_extent(Var(b.var), b.extent);
+                }
+            }
+            wrapper.compute_at(Func(consumer), Var(site.var))
+                .store_in(site.memory_type);
+
+            // Copy a row of the table at a time, with the threads of
+            // the block or a vector, along the innermost dimension.
+            vector<Var> args = wrapper.args();
+            if (!args.empty()) {
+                const Var &v = args[0];
+                int64_t extent = 1;
+                for (const Bound &b : lut.schedule().bounds()) {
+                    if (b.var == v.name()) {
+                        extent = *as_const_int(b.extent);
+                    }
+                }
+                if (site.memory_type == MemoryType::GPUShared) {
+                    Var vi(v.name() + "_thread");
+                    wrapper.split(v, v, vi, (int)std::min<int64_t>(extent, 64), TailStrategy::GuardWithIf)
+                        .gpu_threads(vi, site.device_api);
+                } else {
+                    int lanes = t.natural_vector_size(lut.output_types()[0]);
+                    if (extent % lanes == 0) {
+                        wrapper.vectorize(v, lanes);
+                    }
+                }
+            }
+
+            wrapper.function().lock_loop_levels();
+            staged.emplace(wrapper.name(), wrapper.function());
+        }
+    }
+
+    env.insert(staged.begin(), staged.end());
+}
+
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,38 @@
+#ifndef HALIDE_STAGE_LOOKUP_TABLES_H
+#define HALIDE_STAGE_LOOKUP_TABLES_H
+
+/** \file
+ * Defines the pass that copies small lookup tables into fast memory
+ * close to the device loops that read them.
+ */
+
+#include <map>
+#include <string>
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+class Function;
+
+/** Find the Funcs that are computed at root, have constant bounds
+ * that make them small, and are read by a Func whose pure definition
+ * runs on a GPU or on Hexagon at sites that depend on the values of
+ * other Funcs or images, e.g. a tone curve or a gamma table. Give each
+ * such pair a wrapper, as if by lut.in(consumer), computed once per
+ * GPU block in shared memory, with the copy spread across the
+ * threads, or once per offload to Hexagon in VTCM (on HVX v65 or
+ * later), so that the data-dependent loads read fast memory. The
+ * tables staged per block are at most 16KB on GPUs, and at most 64KB
+ * on Hexagon. Funcs that already have wrappers are left alone, as are
+ * consumers that read the table in their update definitions. The
+ * wrappers are added to the environment. Called when the target has
+ * the stage_luts feature. */
+void stage_lookup_tables(std::map<std::string, Function> &env, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
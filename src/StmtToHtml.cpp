@@ -8,6 +8,7 @@
 #include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <iterator>
 #include <sstream>
 
@@ -24,10 +25,125 @@ std::string to_string(T value) {
     return os.str();
 }
 
+// Times and counts read from a trace written by pipelines compiled with
+// the profile_instrumented feature (see HL_PROFILER_TRACE_FILE).
+struct HtmlProfile {
+    struct Entry {
+        uint64_t count = 0;
+        double total_us = 0, max_us = 0;
+    };
+    // Keyed by Func name, and by pipeline name.
+    std::map<string, Entry> produces, pipelines;
+    std::map<string, uint64_t> peak_heap;
+
+    // Each event in the trace is written on a line of its own.
+    static bool find_field(const string &line, const string &key, string *value) {
+        const string quoted_key = "\"" + key + "\":";
+        size_t start = line.find(quoted_key);
+        if (start == string::npos) {
+            return false;
+        }
+        start += quoted_key.size();
+        if (start < line.size() && line[start] == '"') {
+            size_t end = line.find('"', start + 1);
+            if (end == string::npos) {
+                return false;
+            }
+            *value = line.substr(start + 1, end - start - 1);
+        } else {
+            size_t end = line.find_first_of(",}", start);
+            *value = line.substr(start, end == string::npos ? string::npos : end - start);
+        }
+        return true;
+    }
+
+    void load(const string &filename) {
+        std::ifstream file(filename);
+        user_assert(file) << "Could not open profile " << filename << " for the HTML output\n";
+        string line, name, cat, value;
+        while (std::getline(file, line)) {
+            if (!find_field(line, "name", &name)) {
+                continue;
+            }
+            if (find_field(line, "heap bytes", &value)) {
+                uint64_t bytes = std::strtoull(value.c_str(), nullptr, 10);
+                peak_heap[name] = std::max(peak_heap[name], bytes);
+            } else if (find_field(line, "cat", &cat) && find_field(line, "dur", &value)) {
+                Entry *e = cat == "produce"  ? &produces[name] :
+                           cat == "pipeline" ? &pipelines[name] :
+                                               nullptr;
+                if (e) {
+                    double us = std::strtod(value.c_str(), nullptr);
+                    e->count++;
+                    e->total_us += us;
+                    e->max_us = std::max(e->max_us, us);
+                }
+            }
+        }
+    }
+};
+
+// Static estimates of the cost of one iteration of an innermost loop.
+class LoopBodyCost : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        bytes_loaded += op->type.bytes() * op->type.lanes();
+        widest = std::max(widest, op->type.lanes());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Store *op) override {
+        bytes_stored += op->value.type().bytes() * op->value.type().lanes();
+        widest = std::max(widest, op->value.type().lanes());
+        IRVisitor::visit(op);
+    }
+
+    void visit(const For *op) override {
+        has_loops = true;
+    }
+
+    template<typename T>
+    void visit_arithmetic(const T *op) {
+        ops += op->type.lanes();
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Add *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Sub *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Mul *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Div *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Mod *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Min *op) override {
+        visit_arithmetic(op);
+    }
+    void visit(const Max *op) override {
+        visit_arithmetic(op);
+    }
+
+public:
+    int64_t bytes_loaded = 0, bytes_stored = 0, ops = 0;
+    int widest = 1;
+    bool has_loops = false;
+};
+
 class StmtToHtml : public IRVisitor {
 
     static const std::string css, js;
 
+    HtmlProfile profile;
+    bool have_profile = false;
+
     // This allows easier access to individual elements.
     int id_count;
 
@@ -89,6 +205,32 @@ private:
         return close_tag("div") + "\n";
     }
 
+    string annotation(const string &cls, const string &text) {
+        return " " + span("Comment " + cls, "// " + text);
+    }
+
+    string profile_annotation(const HtmlProfile::Entry &e, double pipeline_us) {
+        std::ostringstream s;
+        s << "time: " << e.total_us / 1000.0 << " ms";
+        if (pipeline_us > 0) {
+            s << " (" << (int)(100 * e.total_us / pipeline_us + 0.5) << "%)";
+        }
+        s << ", calls: " << e.count
+          << ", avg: " << e.total_us / std::max<uint64_t>(e.count, 1) << " us"
+          << ", max: " << e.max_us << " us";
+        return annotation("Profile", s.str());
+    }
+
+    // The total time of the pipelines in the profile, so that each
+    // Func can be shown as a share of it.
+    double pipeline_total_us() const {
+        double total = 0;
+        for (const auto &p : profile.pipelines) {
+            total += p.second.total_us;
+        }
+        return total;
+    }
+
     string open_line() {
         return "<p class=WrapLine>";
     }
@@ -388,6 +530,12 @@ private:
         stream << var(op->name);
         stream << close_expand_button() << " {";
         stream << close_span();
+        if (op->is_producer && have_profile) {
+            auto it = profile.produces.find(op->name);
+            if (it != profile.produces.end()) {
+                stream << profile_annotation(it->second, pipeline_total_us());
+            }
+        }
 
         stream << open_div(op->is_producer ? "ProduceBody Indent" : "ConsumeBody Indent", produce_id);
         print(op->body);
@@ -418,6 +566,10 @@ private:
             stream << keyword("gpu_thread");
         } else if (op->for_type == ForType::GPULane) {
             stream << keyword("gpu_lane");
+        } else if (op->for_type == ForType::Distributed) {
+            stream << keyword("distributed");
+        } else if (op->for_type == ForType::MultiGPU) {
+            stream << keyword("multi_gpu");
         } else {
             internal_error << "Unknown for type: " << ((int)op->for_type) << "\n";
         }
@@ -427,6 +579,21 @@ private:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        // Where there's no profile to go on, show what each iteration
+        // of the innermost loops moves and computes.
+        LoopBodyCost cost;
+        op->body.accept(&cost);
+        if (!cost.has_loops) {
+            std::ostringstream s;
+            const int64_t bytes = cost.bytes_loaded + cost.bytes_stored;
+            s << "per iteration: " << cost.bytes_loaded << " bytes loaded, "
+              << cost.bytes_stored << " bytes stored, " << cost.ops << " ops";
+            if (bytes > 0) {
+                s << " (" << (double)cost.ops / bytes << " ops/byte)";
+            }
+            s << ", vector width: " << cost.widest;
+            stream << annotation("Estimate", s.str());
+        }
         stream << open_div("ForBody Indent", id);
         print(op->body);
         stream << close_div();
@@ -519,6 +686,16 @@ private:
             stream << keyword("custom_delete") << "{ " << op->free_function << "(); ";
             stream << matched("}");
         }
+        const int64_t constant_size = op->constant_allocation_size();
+        if (constant_size > 0) {
+            stream << annotation("Estimate", std::to_string(constant_size * op->type.bytes() * op->type.lanes()) + " bytes");
+        }
+        if (have_profile) {
+            auto it = profile.peak_heap.find(op->name);
+            if (it != profile.peak_heap.end()) {
+                stream << annotation("Profile", "peak heap: " + std::to_string(it->second) + " bytes");
+            }
+        }
 
         stream << open_div("AllocateBody");
         print(op->body);
@@ -766,6 +943,12 @@ public:
         stream << matched(")");
         stream << close_expand_button();
         stream << " " << matched("{");
+        if (have_profile) {
+            auto it = profile.pipelines.find(op.name);
+            if (it != profile.pipelines.end()) {
+                stream << profile_annotation(it->second, 0);
+            }
+        }
         stream << open_div("FunctionBody Indent", id);
         print(op.body);
         stream << close_div();
@@ -1001,6 +1184,11 @@ public:
 
     StmtToHtml(const string &filename)
         : id_count(0), context_stack(1, 0) {
+        const string profile_file = get_env_variable("HL_STMT_HTML_PROFILE");
+        if (!profile_file.empty()) {
+            profile.load(profile_file);
+            have_profile = true;
+        }
         stream.open(filename.c_str());
         stream << "<head>";
         stream << "<style type='text/css'>" << css << "</style>\n";
@@ -1030,6 +1218,7 @@ div.WrapLine { margin-left: 30px; text-indent:-30px; } \n \
 div.Indent { padding-left: 15px; }\n \
 div.ShowHide { position:absolute; left:-12px; width:12px; height:12px; } \n \
 span.Comment { color: #998; font-style: italic; }\n \
+span.Profile { color: #c60; }\n \
 span.Keyword { color: #333; font-weight: bold; }\n \
 span.Assign { color: #d14; font-weight: bold; }\n \
 span.Symbol { color: #990073; }\n \
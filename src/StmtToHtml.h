@@ -17,6 +17,14 @@ struct Stmt;
 
 /**
  * Dump an HTML-formatted print of a Stmt to filename.
+ *
+ * Each innermost loop is annotated with static estimates of the bytes
+ * loaded and stored and the arithmetic done per iteration, and the
+ * widest vector it uses. If HL_STMT_HTML_PROFILE names a trace written
+ * by pipelines compiled with the profile_instrumented feature (see
+ * HL_PROFILER_TRACE_FILE), each produce node and pipeline is also
+ * annotated with the time spent in it and the number of times it ran,
+ * and each allocation with the peak heap usage of its Func.
  */
 void print_to_html(const std::string &filename, const Stmt &s);
 
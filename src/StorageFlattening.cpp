@@ -1,11 +1,13 @@
 #include "StorageFlattening.h"
 
 #include "Bounds.h"
+#include "ExprUsesVar.h"
 #include "Function.h"
 #include "FuseGPUThreadLoops.h"
 #include "IRMutator.h"
 #include "IROperator.h"
 #include "IRPrinter.h"
+#include "IRVisitor.h"
 #include "Parameter.h"
 #include "Scope.h"
 #include "Simplify.h"
@@ -24,6 +26,116 @@ using std::vector;
 
 namespace {
 
+// Make a coordinate into a texture relative to its min. A coordinate
+// clamped to the texture's bounds (e.g. by BoundaryConditions::repeat_edge)
+// stays a clamp of the relative coordinate to [0, extent - 1], so that
+// backends can leave the clamping to the texture hardware.
+Expr texture_coordinate(const Expr &coord, const Expr &min, const Expr &extent) {
+    if (const Max *lo = coord.as<Max>()) {
+        if (const Min *hi = lo->a.as<Min>()) {
+            if (can_prove(lo->b == min) && can_prove(hi->b == min + extent - 1)) {
+                return Max::make(Min::make(hi->a - min, extent - 1), 0);
+            }
+        }
+    }
+    return coord - min;
+}
+
+// Does a Stmt write to a given Func?
+class ProvidesTo : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &name;
+
+    void visit(const Provide *op) override {
+        IRVisitor::visit(op);
+        result = result || op->name == name;
+    }
+
+public:
+    bool result = false;
+
+    ProvidesTo(const string &name)
+        : name(name) {
+    }
+};
+
+// Do threads that are adjacent in x access a Func at different
+// coordinates in some dimension other than its innermost one in
+// storage, e.g. when reading a tile of shared memory transposed? If the
+// rows are an even number of 32-bit words apart, those threads all hit
+// the same few banks of shared memory.
+class AccessesStridedAcrossThreads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const string &name;
+    const size_t innermost;
+
+    // The variables that vary with the thread index in x, and with the
+    // lanes of vectorized loops.
+    Scope<> varying, vectorized;
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        ScopedBinding<> bind_thread(ends_with(op->name, ".__thread_id_x"), varying, op->name);
+        ScopedBinding<> bind_lane(op->for_type == ForType::Vectorized, vectorized, op->name);
+        op->body.accept(this);
+    }
+
+    template<typename LetOrLetStmt>
+    void visit_let(const LetOrLetStmt *op) {
+        op->value.accept(this);
+        ScopedBinding<> bind_thread(expr_uses_vars(op->value, varying), varying, op->name);
+        ScopedBinding<> bind_lane(expr_uses_vars(op->value, vectorized), vectorized, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const Let *op) override {
+        visit_let(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        visit_let(op);
+    }
+
+    void check(const vector<Expr> &args) {
+        if (innermost >= args.size()) {
+            return;
+        }
+        if (expr_uses_vars(args[innermost], vectorized)) {
+            vectorized_access = true;
+        }
+        if (expr_uses_vars(args[innermost], varying)) {
+            return;
+        }
+        for (size_t i = 0; i < args.size(); i++) {
+            strided_access = strided_access || expr_uses_vars(args[i], varying);
+        }
+    }
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->call_type == Call::Halide && op->name == name) {
+            check(op->args);
+        }
+    }
+
+    void visit(const Provide *op) override {
+        IRVisitor::visit(op);
+        if (op->name == name) {
+            check(op->args);
+        }
+    }
+
+public:
+    bool strided_access = false, vectorized_access = false;
+
+    AccessesStridedAcrossThreads(const string &name, size_t innermost)
+        : name(name), innermost(innermost) {
+    }
+};
+
 class FlattenDimensions : public IRMutator {
 public:
     FlattenDimensions(const map<string, pair<Function, int>> &e,
@@ -42,6 +154,7 @@ private:
     const Target &target;
     Scope<> realizations;
     bool in_gpu = false;
+    bool in_gpu_threads = false;
 
     Expr make_shape_var(string name, const string &field, size_t dim,
                         const Buffer<> &buf, const Parameter &param) {
@@ -115,6 +228,12 @@ private:
             debug(2) << "found texture " << op->name << "\n";
         }
 
+        // Allocations at the block level of a GPU kernel go in shared
+        // memory by default.
+        const bool in_shared_memory =
+            op->memory_type == MemoryType::GPUShared ||
+            (op->memory_type == MemoryType::Auto && in_gpu && !in_gpu_threads);
+
         Stmt body = mutate(op->body);
 
         // Compute the size
@@ -158,15 +277,65 @@ private:
                             extents[j] = bound;
                         }
                         Expr alignment = storage_dims[i].alignment;
+                        if (storage_dims[i].pad_stride && !alignment.defined()) {
+                            // A cache line, or a native vector if that is larger.
+                            int bytes = std::max(64, target.natural_vector_size(UInt(8)));
+                            alignment = std::max(1, bytes / op->types[0].bytes());
+                        }
                         if (alignment.defined()) {
                             allocation_extents[j] = ((extents[j] + alignment - 1) / alignment) * alignment;
                         } else {
                             allocation_extents[j] = extents[j];
                         }
+                        if (storage_dims[i].pad_stride) {
+                            // Pad out strides for the next dimension
+                            // that are powers of two of at least 1KB,
+                            // which would map the starts of successive
+                            // rows to the same cache sets. The stride
+                            // of this dimension is let-bound outside of
+                            // the allocation, and is one for the
+                            // innermost dimension.
+                            Expr next_stride = Variable::make(Int(32), op->name + ".stride." + std::to_string(j)) * allocation_extents[j];
+                            Expr is_power_of_two = (next_stride & (next_stride - 1)) == 0;
+                            Expr large = next_stride * op->types[0].bytes() >= 1024;
+                            allocation_extents[j] = select(is_power_of_two && large,
+                                                           allocation_extents[j] + alignment,
+                                                           allocation_extents[j]);
+                        }
                     }
                 }
                 internal_assert(storage_permutation.size() == i + 1);
             }
+            // Pad the rows of shared memory tiles that threads read or
+            // write across to an odd number of 32-bit words, so that
+            // the threads of a warp are spread over all of the
+            // banks. Leave Funcs with any explicit storage layout alone,
+            // as well as those with vector accesses, which need the
+            // rows to stay aligned.
+            const int bytes = op->types[0].bytes();
+            if (in_shared_memory && args.size() > 1 && bytes <= 4 &&
+                target.has_gpu_feature() && !storage_permutation.empty()) {
+                bool explicit_layout = false;
+                for (const StorageDim &d : storage_dims) {
+                    explicit_layout = explicit_layout || d.alignment.defined() || d.bound.defined() ||
+                                      d.fold_factor.defined() || d.pad_stride;
+                }
+                AccessesStridedAcrossThreads accesses(op->name, storage_permutation[0]);
+                op->body.accept(&accesses);
+                if (!explicit_layout && accesses.strided_access && !accesses.vectorized_access) {
+                    int j = storage_permutation[0];
+                    Expr even_words = (allocation_extents[j] * bytes) % 8 == 0;
+                    allocation_extents[j] = select(even_words, allocation_extents[j] + 4 / bytes, allocation_extents[j]);
+                    debug(2) << "Padding the rows of " << op->name << " to avoid shared memory bank conflicts\n";
+                }
+            }
+
+            // Ring-buffered Funcs have an extra outermost dimension
+            // that selects the buffer in the ring.
+            for (size_t j = args.size(); j < op->bounds.size(); j++) {
+                storage_permutation.push_back((int)j);
+                allocation_extents[j] = extents[j];
+            }
         }
 
         internal_assert(storage_permutation.size() == op->bounds.size());
@@ -316,7 +485,7 @@ private:
                 for (size_t i = 0; i < op->args.size(); i++) {
                     Expr min = make_shape_var(op->name, "min", i, op->image, op->param);
                     Expr extent = make_shape_var(op->name, "extent", i, op->image, op->param);
-                    args.push_back(mutate(op->args[i]) - min);
+                    args.push_back(texture_coordinate(mutate(op->args[i]), min, extent));
                     args.push_back(extent);
                 }
 
@@ -390,6 +559,14 @@ private:
             }
         }
 
+        // If the loop being prefetched for writes to the buffer, ask
+        // for the cache lines in a state ready to be written to.
+        ProvidesTo writes(op->name);
+        op->body.accept(&writes);
+        if (writes.result) {
+            args.push_back(1);
+        }
+
         // TODO: Consider generating a prefetch call for each tuple element.
         Stmt prefetch_call = Evaluate::make(Call::make(op->types[0], Call::prefetch, args, Call::Intrinsic));
         if (!is_const_one(condition)) {
@@ -401,12 +578,18 @@ private:
 
     Stmt visit(const For *op) override {
         bool old_in_gpu = in_gpu;
+        bool old_in_gpu_threads = in_gpu_threads;
         if (op->for_type == ForType::GPUBlock ||
             op->for_type == ForType::GPUThread) {
             in_gpu = true;
         }
+        if (op->for_type == ForType::GPUThread ||
+            op->for_type == ForType::GPULane) {
+            in_gpu_threads = true;
+        }
         Stmt stmt = IRMutator::visit(op);
         in_gpu = old_in_gpu;
+        in_gpu_threads = old_in_gpu_threads;
         return stmt;
     }
 };
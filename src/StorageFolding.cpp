@@ -59,9 +59,24 @@ class FoldStorageOfFunction : public IRMutator {
     int dim;
     Expr factor;
     string dynamic_footprint;
+    // If the factor is computed at runtime, coordinates are folded with
+    // this mask instead of a division. It is factor - 1 if the factor is
+    // a power of two, or all ones if the storage turned out not to need
+    // folding after all.
+    Expr mask;
 
     using IRMutator::visit;
 
+    Expr fold(const Expr &e) const {
+        if (is_const_one(factor)) {
+            return 0;
+        } else if (mask.defined()) {
+            return e & mask;
+        } else {
+            return e % factor;
+        }
+    }
+
     Expr visit(const Call *op) override {
         Expr expr = IRMutator::visit(op);
         op = expr.as<Call>();
@@ -69,7 +84,7 @@ class FoldStorageOfFunction : public IRMutator {
         if (op->name == func && op->call_type == Call::Halide) {
             vector<Expr> args = op->args;
             internal_assert(dim < (int)args.size());
-            args[dim] = is_const_one(factor) ? 0 : (args[dim] % factor);
+            args[dim] = fold(args[dim]);
             expr = Call::make(op->type, op->name, args, op->call_type,
                               op->func, op->value_index, op->image, op->param);
         } else if (op->name == Call::buffer_crop) {
@@ -99,7 +114,7 @@ class FoldStorageOfFunction : public IRMutator {
                 Expr old_extent = extents[dim];
 
                 // Rewrite the crop args
-                mins[dim] = old_min % factor;
+                mins[dim] = fold(old_min);
                 Expr new_mins = Call::make(type_of<int *>(), Call::make_struct, mins, Call::Intrinsic);
                 vector<Expr> new_args = op->args;
                 new_args[3] = new_mins;
@@ -107,6 +122,10 @@ class FoldStorageOfFunction : public IRMutator {
 
                 // Inject the assertion
                 Expr no_wraparound = mins[dim] + extents[dim] <= factor;
+                if (mask.defined()) {
+                    // Unfolded storage can't wrap around.
+                    no_wraparound = no_wraparound || mask == -1;
+                }
 
                 Expr valid_min = old_min;
                 if (!dynamic_footprint.empty()) {
@@ -143,15 +162,15 @@ class FoldStorageOfFunction : public IRMutator {
         internal_assert(op);
         if (op->name == func) {
             vector<Expr> args = op->args;
-            args[dim] = is_const_one(factor) ? 0 : (args[dim] % factor);
+            args[dim] = fold(args[dim]);
             stmt = Provide::make(op->name, op->values, args, op->predicate);
         }
         return stmt;
     }
 
 public:
-    FoldStorageOfFunction(string f, int d, Expr e, string p)
-        : func(std::move(f)), dim(d), factor(std::move(e)), dynamic_footprint(std::move(p)) {
+    FoldStorageOfFunction(string f, int d, Expr e, string p, Expr mask)
+        : func(std::move(f)), dim(d), factor(std::move(e)), dynamic_footprint(std::move(p)), mask(std::move(mask)) {
     }
 };
 
@@ -480,10 +499,44 @@ public:
     }
 };
 
+// Find the names of the variables defined in a statement.
+class FindDefinedVars : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        vars.push(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const LetStmt *op) override {
+        vars.push(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Let *op) override {
+        vars.push(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    Scope<> vars;
+};
+
+// The smallest power of two not less than e, computed at runtime.
+Expr runtime_next_power_of_two(const Expr &e) {
+    // Clamp so that the shift can't overflow. The extent is checked
+    // against the factor anyway.
+    Expr x = clamp(e, 1, 1 << 30);
+    return select(x <= 1, 1, make_const(Int(32), 1) << (32 - count_leading_zeros(x - 1)));
+}
+
 // Attempt to fold the storage of a particular function in a statement
 class AttemptStorageFoldingOfFunction : public IRMutator {
     Function func;
     bool explicit_only;
+    // The variables defined inside the realization, which can't be used
+    // by a fold factor computed at runtime.
+    const Scope<> &defined_inside;
 
     using IRMutator::visit;
 
@@ -700,6 +753,10 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
             internal_assert(can_fold_forwards || can_fold_backwards);
 
             Expr factor;
+            // The name and value of a fold factor computed at runtime,
+            // when there is no constant bound on the extent.
+            string dynamic_factor_name;
+            Expr dynamic_factor;
             if (explicit_factor.defined()) {
                 if (dynamic_footprint.empty() && !func.schedule().async()) {
                     // We were able to prove monotonicity
@@ -734,6 +791,44 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                     }
                     if (success) {
                         factor = e;
+                    } else if (!func.schedule().async() && dynamic_footprint.empty()) {
+                        // The extent may still be bounded by an
+                        // expression that doesn't vary inside the
+                        // realization, e.g. one that depends on a
+                        // Param. If so, fold by the next power of two
+                        // above that bound, computed once before the
+                        // realization, and check the extent against it
+                        // on each iteration. If that turns out to be no
+                        // smaller than the realization, the storage is
+                        // left unfolded instead (see
+                        // StorageFolding::visit(Realize)).
+                        Scope<Interval> loop_bounds;
+                        loop_bounds.push(op->name, Interval(op->min, simplify(op->min + op->extent - 1)));
+                        Interval extent_bounds = bounds_of_expr_in_scope(extent, loop_bounds);
+                        Expr bound;
+                        if (extent_bounds.has_upper_bound()) {
+                            bound = simplify(common_subexpression_elimination(extent_bounds.max));
+                        }
+                        if (bound.defined() &&
+                            is_pure(bound) &&
+                            !expr_uses_var(bound, op->name) &&
+                            !expr_uses_vars(bound, defined_inside)) {
+                            dynamic_factor_name = unique_name(func.name() + ".fold_factor." + std::to_string(dim));
+                            dynamic_factor = runtime_next_power_of_two(bound);
+                            factor = Variable::make(Int(32), dynamic_factor_name);
+                            Expr error = Call::make(Int(32), "halide_error_fold_factor_too_small",
+                                                    {func.name(), storage_dim.var, factor, op->name, extent},
+                                                    Call::Extern);
+                            body = Block::make(AssertStmt::make(extent <= factor, error), body);
+                            debug(3) << "Folding with a factor computed at runtime from the bound " << bound << "\n";
+                        } else {
+                            debug(3) << "Not folding because extent not bounded by a constant not greater than " << max_fold
+                                     << " or by an expression invariant in the realization\n"
+                                     << "extent = " << extent << "\n"
+                                     << "max extent = " << max_extent << "\n";
+                            // Try the next dimension
+                            continue;
+                        }
                     } else {
                         debug(3) << "Not folding because extent not bounded by a constant not greater than " << max_fold << "\n"
                                  << "extent = " << extent << "\n"
@@ -766,6 +861,8 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
             debug(3) << "Proceeding with factor " << factor << "\n";
 
             Fold fold = {(int)i - 1, factor};
+            fold.factor_name = dynamic_factor_name;
+            fold.factor_value = dynamic_factor;
             dims_folded.push_back(fold);
             {
                 string head;
@@ -774,7 +871,11 @@ class AttemptStorageFoldingOfFunction : public IRMutator {
                 } else {
                     head = dynamic_footprint;
                 }
-                body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, head).mutate(body);
+                Expr mask;
+                if (dynamic_factor.defined()) {
+                    mask = Variable::make(Int(32), dynamic_factor_name + ".mask");
+                }
+                body = FoldStorageOfFunction(func.name(), (int)i - 1, factor, head, mask).mutate(body);
             }
 
             // If the producer is async, it can run ahead by
@@ -920,11 +1021,17 @@ public:
         Semaphore semaphore;
         string head, tail;
         bool fold_forward;
+        // If the factor is computed at runtime, it is a Variable with
+        // this name, and factor_value is the power of two it is folded
+        // by. Both are defined outside the realization, along with the
+        // mask the coordinates are folded with.
+        string factor_name;
+        Expr factor_value;
     };
     vector<Fold> dims_folded;
 
-    AttemptStorageFoldingOfFunction(Function f, bool explicit_only)
-        : func(std::move(f)), explicit_only(explicit_only) {
+    AttemptStorageFoldingOfFunction(Function f, bool explicit_only, const Scope<> &defined_inside)
+        : func(std::move(f)), explicit_only(explicit_only), defined_inside(defined_inside) {
     }
 };
 
@@ -942,10 +1049,21 @@ class StorageFolding : public IRMutator {
         auto func_it = env.find(op->name);
         Function func = func_it != env.end() ? func_it->second : Function();
 
+        // Ring-buffered storage is indexed by the loop iteration
+        // instead. See AsyncProducers.cpp.
+        if (func_it != env.end() && func.schedule().ring_buffer().defined()) {
+            if (body.same_as(op->body)) {
+                return op;
+            }
+            return Realize::make(op->name, op->types, op->memory_type, op->bounds, op->condition, body);
+        }
+
         // Don't attempt automatic storage folding if there is
         // more than one produce node for this func.
         bool explicit_only = count_producers(body, op->name) != 1;
-        AttemptStorageFoldingOfFunction folder(func, explicit_only);
+        FindDefinedVars defined;
+        body.accept(&defined);
+        AttemptStorageFoldingOfFunction folder(func, explicit_only, defined.vars);
         if (explicit_only) {
             debug(3) << "Attempting to fold " << op->name << " explicitly\n";
         } else {
@@ -966,7 +1084,16 @@ class StorageFolding : public IRMutator {
                 Expr f = dim.factor;
                 internal_assert(d >= 0 &&
                                 d < (int)bounds.size());
-                bounds[d] = Range(0, f);
+                if (dim.factor_value.defined()) {
+                    // Only fold if the power of two is smaller than
+                    // the realization. Otherwise the factor is the
+                    // realization's extent, the mask is all ones, and
+                    // the storage is the same as it was unfolded.
+                    Expr pow2 = Variable::make(Int(32), dim.factor_name + ".pow2");
+                    bounds[d] = Range(select(pow2 < op->bounds[d].extent, 0, op->bounds[d].min), f);
+                } else {
+                    bounds[d] = Range(0, f);
+                }
             }
 
             Stmt stmt = Realize::make(op->name, op->types, op->memory_type, bounds, op->condition, body);
@@ -998,6 +1125,14 @@ class StorageFolding : public IRMutator {
                     stmt = Block::make(Store::make(fold.tail, init, 0, Parameter(), const_true(), ModulusRemainder()), stmt);
                     stmt = Allocate::make(fold.tail, Int(32), MemoryType::Stack, {}, const_true(), stmt);
                 }
+                if (fold.factor_value.defined()) {
+                    Expr extent = op->bounds[fold.dim].extent;
+                    Expr pow2 = Variable::make(Int(32), fold.factor_name + ".pow2");
+                    Expr folded = pow2 < extent;
+                    stmt = LetStmt::make(fold.factor_name + ".mask", select(folded, pow2 - 1, -1), stmt);
+                    stmt = LetStmt::make(fold.factor_name, select(folded, pow2, extent), stmt);
+                    stmt = LetStmt::make(fold.factor_name + ".pow2", fold.factor_value, stmt);
+                }
             }
 
             return stmt;
@@ -0,0 +1,322 @@
+#include <cstdlib>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "CodeGen_Internal.h"
+#include "IREquality.h"
+#include "IRMutator.h"
+#include "IROperator.h"
+#include "Simplify.h"
+#include "StoragePlanning.h"
+#include "Substitute.h"
+
+namespace Halide {
+namespace Internal {
+namespace {
+
+using std::map;
+using std::string;
+using std::vector;
+
+// Every planned allocation starts on a multiple of this many bytes,
+// which is at least as aligned as halide_malloc.
+const int arena_alignment = 128;
+
+bool is_candidate(const Allocate *op) {
+    if (op->new_expr.defined() ||
+        !op->free_function.empty() ||
+        !is_const_one(op->condition) ||
+        op->extents.empty()) {
+        return false;
+    }
+    if (op->memory_type == MemoryType::Heap) {
+        return true;
+    } else if (op->memory_type != MemoryType::Auto) {
+        return false;
+    }
+    // Small constant-sized allocations end up on the stack, which is
+    // cheaper than any arena.
+    int64_t constant_size = op->constant_allocation_size();
+    return (constant_size == 0 ||
+            !can_allocation_fit_on_stack(constant_size * op->type.bytes()));
+}
+
+class ContainsLoad : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Load *op) override {
+        result = true;
+    }
+
+public:
+    bool result = false;
+};
+
+struct Member {
+    const Allocate *op;
+    // The size in bytes, rounded up to arena_alignment.
+    Expr size;
+    // The live range, in positions along the traversal order.
+    int begin, end;
+    int slot;
+};
+
+// Collect the heap allocations at the same loop level as (and
+// including) the given Allocate node, along with the position of their
+// Free nodes. We do not cross loops, forks or acquires, because
+// allocations inside those are allocated once per iteration or task.
+class FindMembers : public IRVisitor {
+public:
+    vector<Member> members;
+
+private:
+    int position = 0;
+    // The values of LetStmts defined inside the group, with any lets
+    // they refer to already substituted in.
+    map<string, Expr> lets;
+    // Members whose Free node has not been found yet.
+    map<string, size_t> open;
+
+    using IRVisitor::visit;
+
+    // Compute the size of an allocation in terms of things defined
+    // outside the group, or return an undefined Expr if that's not
+    // possible.
+    Expr hoisted_size(const Allocate *op) {
+        Expr size = make_const(Int(64), op->type.bytes());
+        for (const Expr &e : op->extents) {
+            size *= cast<int64_t>(e);
+        }
+        size = substitute(lets, size);
+        ContainsLoad contains_load;
+        size.accept(&contains_load);
+        if (contains_load.result || !is_pure(size)) {
+            return Expr();
+        }
+        // Reserve room for the padding codegen may read past the end
+        // of a heap allocation (see CodeGen_Posix::allocation_padding)
+        // and round up to keep every allocation in the arena aligned.
+        size = max(size, 0) + 3 * op->type.bytes() + (arena_alignment - 1);
+        size = (size / arena_alignment) * arena_alignment;
+        return simplify(size);
+    }
+
+    void close(const string &name) {
+        auto it = open.find(name);
+        if (it != open.end()) {
+            members[it->second].end = position++;
+            open.erase(it);
+        }
+    }
+
+    void visit(const For *op) override {
+        op->min.accept(this);
+        op->extent.accept(this);
+        position++;
+    }
+
+    void visit(const Fork *op) override {
+        position++;
+    }
+
+    void visit(const Acquire *op) override {
+        op->semaphore.accept(this);
+        op->count.accept(this);
+        position++;
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        Expr value = substitute(lets, op->value);
+        auto old = lets.find(op->name);
+        Expr shadowed;
+        if (old != lets.end()) {
+            shadowed = old->second;
+        }
+        lets[op->name] = value;
+        op->body.accept(this);
+        if (shadowed.defined()) {
+            lets[op->name] = shadowed;
+        } else {
+            lets.erase(op->name);
+        }
+    }
+
+    void visit(const Allocate *op) override {
+        for (const Expr &e : op->extents) {
+            e.accept(this);
+        }
+        bool member = false;
+        if (is_candidate(op) && !open.count(op->name)) {
+            Expr size = hoisted_size(op);
+            if (size.defined()) {
+                open[op->name] = members.size();
+                members.push_back({op, size, position++, -1, -1});
+                member = true;
+            }
+        }
+        op->body.accept(this);
+        if (member) {
+            // Allocations with no Free node live until the end of
+            // their body.
+            close(op->name);
+        }
+    }
+
+    void visit(const Free *op) override {
+        close(op->name);
+    }
+};
+
+// Greedily assign members to slots of the arena, reusing a slot when
+// the live ranges of everything already in it have ended. When sizes
+// are known, prefer the slot that wastes the least memory. Returns the
+// size of each slot.
+vector<Expr> assign_slots(vector<Member> &members) {
+    vector<Expr> slot_size;
+    vector<int> slot_end;
+    for (Member &m : members) {
+        const int64_t *m_size = as_const_int(m.size);
+        int best = -1;
+        int64_t best_cost = 0;
+        for (size_t i = 0; i < slot_size.size(); i++) {
+            if (slot_end[i] >= m.begin) {
+                continue;
+            }
+            const int64_t *s_size = as_const_int(slot_size[i]);
+            int64_t cost;
+            if (m_size && s_size) {
+                cost = std::abs(*m_size - *s_size);
+            } else if (equal(m.size, slot_size[i])) {
+                cost = 0;
+            } else {
+                cost = std::numeric_limits<int64_t>::max();
+            }
+            if (best == -1 || cost < best_cost) {
+                best = (int)i;
+                best_cost = cost;
+            }
+        }
+        if (best == -1) {
+            best = (int)slot_size.size();
+            slot_size.push_back(m.size);
+            slot_end.push_back(m.end);
+        } else {
+            slot_size[best] = simplify(max(slot_size[best], m.size));
+            slot_end[best] = m.end;
+        }
+        m.slot = best;
+    }
+    return slot_size;
+}
+
+class PlaceInArena : public IRMutator {
+    using IRMutator::visit;
+
+    const map<const Allocate *, Expr> &new_exprs;
+
+    Stmt visit(const Allocate *op) override {
+        auto it = new_exprs.find(op);
+        if (it == new_exprs.end()) {
+            return IRMutator::visit(op);
+        }
+        // The arena owns the memory, so freeing a member does nothing.
+        return Allocate::make(op->name, op->type, op->memory_type,
+                              op->extents, op->condition, mutate(op->body),
+                              it->second, "halide_device_host_nop_free");
+    }
+
+    Stmt visit(const For *op) override {
+        return op;
+    }
+
+public:
+    PlaceInArena(const map<const Allocate *, Expr> &n)
+        : new_exprs(n) {
+    }
+};
+
+class PlanHeapStorage : public IRMutator {
+    using IRMutator::visit;
+
+    const Target &target;
+
+    Stmt visit(const For *op) override {
+        if (op->device_api != DeviceAPI::None &&
+            op->device_api != DeviceAPI::Host) {
+            // Device code manages its own memory.
+            return op;
+        }
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (!is_candidate(op)) {
+            return IRMutator::visit(op);
+        }
+
+        FindMembers finder;
+        op->accept(&finder);
+        vector<Member> &members = finder.members;
+        if (members.size() < 2 || members[0].op != op) {
+            return IRMutator::visit(op);
+        }
+
+        vector<Expr> slot_size = assign_slots(members);
+
+        const string arena_name = op->name + ".arena";
+        Type uint_ptr = UInt(target.bits);
+        Expr arena_addr = reinterpret(uint_ptr, Variable::make(type_of<void *>(), arena_name));
+
+        vector<Expr> slot_offset;
+        Expr total = make_const(Int(64), 0);
+        for (size_t i = 0; i < slot_size.size(); i++) {
+            slot_offset.push_back(Variable::make(Int(64), arena_name + ".offset." + std::to_string(i)));
+            total = Variable::make(Int(64), arena_name + ".offset." + std::to_string(i + 1));
+        }
+
+        map<const Allocate *, Expr> new_exprs;
+        for (const Member &m : members) {
+            Expr addr = arena_addr + cast(uint_ptr, slot_offset[m.slot]);
+            new_exprs[m.op] = reinterpret(type_of<void *>(), addr);
+            debug(3) << "Placing " << m.op->name << " at slot " << m.slot
+                     << " of " << arena_name << "\n";
+        }
+
+        Stmt stmt = PlaceInArena(new_exprs).mutate(Stmt(op));
+        // Now plan any loops inside the group.
+        stmt = IRMutator::visit(stmt.as<Allocate>());
+
+        // The arena is allocated in units of arena_alignment bytes to
+        // keep the extents in range of an Int(32). Anything larger
+        // than the maximum buffer size fails the usual size check in
+        // codegen.
+        Expr units = min(total / arena_alignment, Int(32).max());
+        stmt = Allocate::make(arena_name, UInt(8), MemoryType::Heap,
+                              {cast<int32_t>(units), arena_alignment},
+                              const_true(), stmt);
+
+        for (size_t i = slot_size.size() + 1; i > 0; i--) {
+            string name = arena_name + ".offset." + std::to_string(i - 1);
+            Expr value = (i == 1) ? make_const(Int(64), 0) : slot_offset[i - 2] + slot_size[i - 2];
+            stmt = LetStmt::make(name, value, stmt);
+        }
+
+        return stmt;
+    }
+
+public:
+    PlanHeapStorage(const Target &t)
+        : target(t) {
+    }
+};
+
+}  // namespace
+
+Stmt plan_heap_storage(const Stmt &s, const Target &t) {
+    return PlanHeapStorage(t).mutate(s);
+}
+
+}  // namespace Internal
+}  // namespace Halide
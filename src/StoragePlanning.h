@@ -0,0 +1,30 @@
+#ifndef HALIDE_STORAGE_PLANNING_H
+#define HALIDE_STORAGE_PLANNING_H
+
+/** \file
+ * Defines the lowering pass that packs heap allocations with disjoint
+ * lifetimes into a single shared arena.
+ */
+
+#include "Expr.h"
+
+namespace Halide {
+
+struct Target;
+
+namespace Internal {
+
+/** Find groups of heap allocations at the same loop level, compute
+ * when each is live (from its Allocate node to its Free node, so this
+ * must run after inject_early_frees), and assign each an offset into
+ * one arena allocation such that allocations that are live at the same
+ * time do not overlap. Allocations with disjoint lifetimes share
+ * memory. This replaces one halide_malloc/halide_free pair per
+ * intermediate with a single pair per group. Only allocations whose
+ * sizes can be computed at the start of the group are planned. */
+Stmt plan_heap_storage(const Stmt &s, const Target &t);
+
+}  // namespace Internal
+}  // namespace Halide
+
+#endif
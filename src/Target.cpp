@@ -265,6 +265,13 @@ Target calculate_host_target() {
         const uint32_t avx512_cannonlake = avx512_skylake | avx512ifma;  // Assume ifma => vbmi
         if ((info2[1] & avx2) == avx2) {
             initial_features.push_back(Target::AVX2);
+
+            const uint32_t avxvnni = 1U << 4;  // avxvnni result in eax, with cpuid(eax=7, ecx=1)
+            int info3[4];
+            cpuid(info3, 7, 1);
+            if ((info3[0] & avxvnni) == avxvnni) {
+                initial_features.push_back(Target::AVXVNNI);
+            }
         }
         if ((info2[1] & avx512) == avx512) {
             initial_features.push_back(Target::AVX512);
@@ -275,6 +282,11 @@ Target calculate_host_target() {
             // TODO: port to family/model -based detection.
             if ((info2[1] & avx512_skylake) == avx512_skylake) {
                 initial_features.push_back(Target::AVX512_Skylake);
+
+                const uint32_t avx512vnni = 1U << 11;  // vnni result in ecx
+                if ((info2[2] & avx512vnni) == avx512vnni) {
+                    initial_features.push_back(Target::AVX512_VNNI);
+                }
             }
             // TODO: port to family/model -based detection.
             if ((info2[1] & avx512_cannonlake) == avx512_cannonlake) {
@@ -288,6 +300,11 @@ Target calculate_host_target() {
                 if ((info2[2] & avx512vnni) == avx512vnni &&
                     (info3[0] & avx512bf16) == avx512bf16) {
                     initial_features.push_back(Target::AVX512_SapphireRapids);
+
+                    const uint32_t avx512fp16 = 1U << 23;  // fp16 result in edx
+                    if ((info2[3] & avx512fp16) == avx512fp16) {
+                        initial_features.push_back(Target::AVX512_FP16);
+                    }
                 }
             }
         }
@@ -305,6 +322,7 @@ bool is_using_hexagon(const Target &t) {
             t.has_feature(Target::HVX_v62) ||
             t.has_feature(Target::HVX_v65) ||
             t.has_feature(Target::HVX_v66) ||
+            t.has_feature(Target::HVX_v68) ||
             t.has_feature(Target::HexagonDma) ||
             t.has_feature(Target::HVX_shared_object) ||
             t.arch == Target::Hexagon);
@@ -323,6 +341,9 @@ int get_hvx_lower_bound(const Target &t) {
     if (t.has_feature(Target::HVX_v66)) {
         return 66;
     }
+    if (t.has_feature(Target::HVX_v68)) {
+        return 68;
+    }
     return 60;
 }
 
@@ -374,41 +395,48 @@ Target::Feature get_host_cuda_capability(Target t) {
     return cap;
 }
 
-const std::map<std::string, Target::OS> os_name_map = {
-    {"os_unknown", Target::OSUnknown},
-    {"linux", Target::Linux},
-    {"windows", Target::Windows},
-    {"osx", Target::OSX},
-    {"android", Target::Android},
-    {"ios", Target::IOS},
-    {"qurt", Target::QuRT},
-    {"noos", Target::NoOS},
-    {"fuchsia", Target::Fuchsia},
-    {"wasmrt", Target::WebAssemblyRuntime}};
+const std::map<std::string, Target::OS> &os_name_map() {
+    static const std::map<std::string, Target::OS> m = {
+        {"os_unknown", Target::OSUnknown},
+        {"linux", Target::Linux},
+        {"windows", Target::Windows},
+        {"osx", Target::OSX},
+        {"android", Target::Android},
+        {"ios", Target::IOS},
+        {"qurt", Target::QuRT},
+        {"noos", Target::NoOS},
+        {"fuchsia", Target::Fuchsia},
+        {"wasmrt", Target::WebAssemblyRuntime},
+    };
+    return m;
+}
 
 bool lookup_os(const std::string &tok, Target::OS &result) {
-    auto os_iter = os_name_map.find(tok);
-    if (os_iter != os_name_map.end()) {
+    auto os_iter = os_name_map().find(tok);
+    if (os_iter != os_name_map().end()) {
         result = os_iter->second;
         return true;
     }
     return false;
 }
 
-const std::map<std::string, Target::Arch> arch_name_map = {
-    {"arch_unknown", Target::ArchUnknown},
-    {"x86", Target::X86},
-    {"arm", Target::ARM},
-    {"mips", Target::MIPS},
-    {"powerpc", Target::POWERPC},
-    {"hexagon", Target::Hexagon},
-    {"wasm", Target::WebAssembly},
-    {"riscv", Target::RISCV},
-};
+const std::map<std::string, Target::Arch> &arch_name_map() {
+    static const std::map<std::string, Target::Arch> m = {
+        {"arch_unknown", Target::ArchUnknown},
+        {"x86", Target::X86},
+        {"arm", Target::ARM},
+        {"mips", Target::MIPS},
+        {"powerpc", Target::POWERPC},
+        {"hexagon", Target::Hexagon},
+        {"wasm", Target::WebAssembly},
+        {"riscv", Target::RISCV},
+    };
+    return m;
+}
 
 bool lookup_arch(const std::string &tok, Target::Arch &result) {
-    auto arch_iter = arch_name_map.find(tok);
-    if (arch_iter != arch_name_map.end()) {
+    auto arch_iter = arch_name_map().find(tok);
+    if (arch_iter != arch_name_map().end()) {
         result = arch_iter->second;
         return true;
     }
@@ -422,119 +450,154 @@ bool lookup_arch(const std::string &tok, Target::Arch &result) {
 /// and prepending "tune_" prefix)
 ///
 /// Please keep sorted.
-const std::map<std::string, Target::Processor> processor_name_map = {
-    {"tune_amdfam10", Target::Processor::AMDFam10},
-    {"tune_bdver1", Target::Processor::BdVer1},
-    {"tune_bdver2", Target::Processor::BdVer2},
-    {"tune_bdver3", Target::Processor::BdVer3},
-    {"tune_bdver4", Target::Processor::BdVer4},
-    {"tune_btver1", Target::Processor::BtVer1},
-    {"tune_btver2", Target::Processor::BtVer2},
-    {"tune_generic", Target::Processor::ProcessorGeneric},
-    {"tune_k8", Target::Processor::K8},
-    {"tune_k8_sse3", Target::Processor::K8_SSE3},
-    {"tune_znver1", Target::Processor::ZnVer1},
-    {"tune_znver2", Target::Processor::ZnVer2},
-    {"tune_znver3", Target::Processor::ZnVer3},
-};
+const std::map<std::string, Target::Processor> &processor_name_map() {
+    static const std::map<std::string, Target::Processor> m = {
+        {"tune_amdfam10", Target::Processor::AMDFam10},
+        {"tune_bdver1", Target::Processor::BdVer1},
+        {"tune_bdver2", Target::Processor::BdVer2},
+        {"tune_bdver3", Target::Processor::BdVer3},
+        {"tune_bdver4", Target::Processor::BdVer4},
+        {"tune_btver1", Target::Processor::BtVer1},
+        {"tune_btver2", Target::Processor::BtVer2},
+        {"tune_generic", Target::Processor::ProcessorGeneric},
+        {"tune_k8", Target::Processor::K8},
+        {"tune_k8_sse3", Target::Processor::K8_SSE3},
+        {"tune_znver1", Target::Processor::ZnVer1},
+        {"tune_znver2", Target::Processor::ZnVer2},
+        {"tune_znver3", Target::Processor::ZnVer3},
+    };
+    return m;
+}
 
 bool lookup_processor(const std::string &tok, Target::Processor &result) {
-    auto processor_iter = processor_name_map.find(tok);
-    if (processor_iter != processor_name_map.end()) {
+    auto processor_iter = processor_name_map().find(tok);
+    if (processor_iter != processor_name_map().end()) {
         result = processor_iter->second;
         return true;
     }
     return false;
 }
 
-const std::map<std::string, Target::Feature> feature_name_map = {
-    {"jit", Target::JIT},
-    {"debug", Target::Debug},
-    {"no_asserts", Target::NoAsserts},
-    {"no_bounds_query", Target::NoBoundsQuery},
-    {"sse41", Target::SSE41},
-    {"avx", Target::AVX},
-    {"avx2", Target::AVX2},
-    {"fma", Target::FMA},
-    {"fma4", Target::FMA4},
-    {"f16c", Target::F16C},
-    {"armv7s", Target::ARMv7s},
-    {"no_neon", Target::NoNEON},
-    {"vsx", Target::VSX},
-    {"power_arch_2_07", Target::POWER_ARCH_2_07},
-    {"cuda", Target::CUDA},
-    {"cuda_capability_30", Target::CUDACapability30},
-    {"cuda_capability_32", Target::CUDACapability32},
-    {"cuda_capability_35", Target::CUDACapability35},
-    {"cuda_capability_50", Target::CUDACapability50},
-    {"cuda_capability_61", Target::CUDACapability61},
-    {"cuda_capability_70", Target::CUDACapability70},
-    {"cuda_capability_75", Target::CUDACapability75},
-    {"cuda_capability_80", Target::CUDACapability80},
-    {"cuda_capability_86", Target::CUDACapability86},
-    {"opencl", Target::OpenCL},
-    {"cl_doubles", Target::CLDoubles},
-    {"cl_half", Target::CLHalf},
-    {"cl_atomics64", Target::CLAtomics64},
-    {"openglcompute", Target::OpenGLCompute},
-    {"egl", Target::EGL},
-    {"user_context", Target::UserContext},
-    {"profile", Target::Profile},
-    {"no_runtime", Target::NoRuntime},
-    {"metal", Target::Metal},
-    {"c_plus_plus_name_mangling", Target::CPlusPlusMangling},
-    {"large_buffers", Target::LargeBuffers},
-    {"hvx", Target::HVX_128},
-    {"hvx_128", Target::HVX_128},
-    {"hvx_v62", Target::HVX_v62},
-    {"hvx_v65", Target::HVX_v65},
-    {"hvx_v66", Target::HVX_v66},
-    {"hvx_shared_object", Target::HVX_shared_object},
-    {"fuzz_float_stores", Target::FuzzFloatStores},
-    {"soft_float_abi", Target::SoftFloatABI},
-    {"msan", Target::MSAN},
-    {"avx512", Target::AVX512},
-    {"avx512_knl", Target::AVX512_KNL},
-    {"avx512_skylake", Target::AVX512_Skylake},
-    {"avx512_cannonlake", Target::AVX512_Cannonlake},
-    {"avx512_sapphirerapids", Target::AVX512_SapphireRapids},
-    {"trace_loads", Target::TraceLoads},
-    {"trace_stores", Target::TraceStores},
-    {"trace_realizations", Target::TraceRealizations},
-    {"trace_pipeline", Target::TracePipeline},
-    {"d3d12compute", Target::D3D12Compute},
-    {"strict_float", Target::StrictFloat},
-    {"tsan", Target::TSAN},
-    {"asan", Target::ASAN},
-    {"check_unsafe_promises", Target::CheckUnsafePromises},
-    {"hexagon_dma", Target::HexagonDma},
-    {"embed_bitcode", Target::EmbedBitcode},
-    // halide_target_feature_disable_llvm_loop_opt is deprecated in Halide 15
-    // (and will be removed in Halide 16). Halide 15 now defaults to disabling
-    // LLVM loop optimization, unless halide_target_feature_enable_llvm_loop_opt is set.
-    {"disable_llvm_loop_opt", Target::DisableLLVMLoopOpt},
-    {"enable_llvm_loop_opt", Target::EnableLLVMLoopOpt},
-    {"wasm_simd128", Target::WasmSimd128},
-    {"wasm_signext", Target::WasmSignExt},
-    {"wasm_sat_float_to_int", Target::WasmSatFloatToInt},
-    {"wasm_threads", Target::WasmThreads},
-    {"wasm_bulk_memory", Target::WasmBulkMemory},
-    {"sve", Target::SVE},
-    {"sve2", Target::SVE2},
-    {"arm_dot_prod", Target::ARMDotProd},
-    {"arm_fp16", Target::ARMFp16},
-    {"llvm_large_code_model", Target::LLVMLargeCodeModel},
-    {"rvv", Target::RVV},
-    {"armv81a", Target::ARMv81a},
-    {"sanitizer_coverage", Target::SanitizerCoverage},
-    {"profile_by_timer", Target::ProfileByTimer},
-    {"spirv", Target::SPIRV},
-    // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
-};
+const std::map<std::string, Target::Feature> &feature_name_map() {
+    static const std::map<std::string, Target::Feature> m = {
+        {"jit", Target::JIT},
+        {"debug", Target::Debug},
+        {"no_asserts", Target::NoAsserts},
+        {"no_bounds_query", Target::NoBoundsQuery},
+        {"sse41", Target::SSE41},
+        {"avx", Target::AVX},
+        {"avx2", Target::AVX2},
+        {"fma", Target::FMA},
+        {"fma4", Target::FMA4},
+        {"f16c", Target::F16C},
+        {"armv7s", Target::ARMv7s},
+        {"no_neon", Target::NoNEON},
+        {"vsx", Target::VSX},
+        {"power_arch_2_07", Target::POWER_ARCH_2_07},
+        {"cuda", Target::CUDA},
+        {"cuda_capability_30", Target::CUDACapability30},
+        {"cuda_capability_32", Target::CUDACapability32},
+        {"cuda_capability_35", Target::CUDACapability35},
+        {"cuda_capability_50", Target::CUDACapability50},
+        {"cuda_capability_61", Target::CUDACapability61},
+        {"cuda_capability_70", Target::CUDACapability70},
+        {"cuda_capability_75", Target::CUDACapability75},
+        {"cuda_capability_80", Target::CUDACapability80},
+        {"cuda_capability_86", Target::CUDACapability86},
+        {"opencl", Target::OpenCL},
+        {"cl_doubles", Target::CLDoubles},
+        {"cl_half", Target::CLHalf},
+        {"cl_atomics64", Target::CLAtomics64},
+        {"openglcompute", Target::OpenGLCompute},
+        {"egl", Target::EGL},
+        {"user_context", Target::UserContext},
+        {"profile", Target::Profile},
+        {"no_runtime", Target::NoRuntime},
+        {"metal", Target::Metal},
+        {"c_plus_plus_name_mangling", Target::CPlusPlusMangling},
+        {"large_buffers", Target::LargeBuffers},
+        {"hvx", Target::HVX_128},
+        {"hvx_128", Target::HVX_128},
+        {"hvx_v62", Target::HVX_v62},
+        {"hvx_v65", Target::HVX_v65},
+        {"hvx_v66", Target::HVX_v66},
+        {"hvx_shared_object", Target::HVX_shared_object},
+        {"fuzz_float_stores", Target::FuzzFloatStores},
+        {"soft_float_abi", Target::SoftFloatABI},
+        {"msan", Target::MSAN},
+        {"avx512", Target::AVX512},
+        {"avx512_knl", Target::AVX512_KNL},
+        {"avx512_skylake", Target::AVX512_Skylake},
+        {"avx512_cannonlake", Target::AVX512_Cannonlake},
+        {"avx512_sapphirerapids", Target::AVX512_SapphireRapids},
+        {"trace_loads", Target::TraceLoads},
+        {"trace_stores", Target::TraceStores},
+        {"trace_realizations", Target::TraceRealizations},
+        {"trace_pipeline", Target::TracePipeline},
+        {"d3d12compute", Target::D3D12Compute},
+        {"strict_float", Target::StrictFloat},
+        {"tsan", Target::TSAN},
+        {"asan", Target::ASAN},
+        {"check_unsafe_promises", Target::CheckUnsafePromises},
+        {"hexagon_dma", Target::HexagonDma},
+        {"hexagon_auto_vtcm", Target::HexagonAutoVTCM},
+        {"embed_bitcode", Target::EmbedBitcode},
+        // halide_target_feature_disable_llvm_loop_opt is deprecated in Halide 15
+        // (and will be removed in Halide 16). Halide 15 now defaults to disabling
+        // LLVM loop optimization, unless halide_target_feature_enable_llvm_loop_opt is set.
+        {"disable_llvm_loop_opt", Target::DisableLLVMLoopOpt},
+        {"enable_llvm_loop_opt", Target::EnableLLVMLoopOpt},
+        {"wasm_simd128", Target::WasmSimd128},
+        {"wasm_signext", Target::WasmSignExt},
+        {"wasm_sat_float_to_int", Target::WasmSatFloatToInt},
+        {"wasm_threads", Target::WasmThreads},
+        {"wasm_bulk_memory", Target::WasmBulkMemory},
+        {"wasm_relaxed_simd", Target::WasmRelaxedSimd},
+        {"sve", Target::SVE},
+        {"sve2", Target::SVE2},
+        {"arm_dot_prod", Target::ARMDotProd},
+        {"arm_fp16", Target::ARMFp16},
+        {"llvm_large_code_model", Target::LLVMLargeCodeModel},
+        {"rvv", Target::RVV},
+        {"armv81a", Target::ARMv81a},
+        {"sanitizer_coverage", Target::SanitizerCoverage},
+        {"profile_by_timer", Target::ProfileByTimer},
+        {"profile_instrumented", Target::ProfileInstrumented},
+        {"spirv", Target::SPIRV},
+        {"cuda_async_copies", Target::CUDAAsyncCopies},
+        {"avx512_vnni", Target::AVX512_VNNI},
+        {"avxvnni", Target::AVXVNNI},
+        {"vulkan", Target::Vulkan},
+        {"plan_heap_storage", Target::PlanHeapStorage},
+        {"bump_allocator", Target::BumpAllocator},
+        {"cache_parallel_allocations", Target::CacheParallelAllocations},
+        {"multiversion_loops", Target::MultiversionLoops},
+        {"vector_math_fast", Target::VectorMathFast},
+        {"vector_math_balanced", Target::VectorMathBalanced},
+        {"vector_math_precise", Target::VectorMathPrecise},
+        {"avx512_fp16", Target::AVX512_FP16},
+        {"arm_bf16", Target::ARMBf16},
+        {"cuda_tensor_cores", Target::CUDATensorCores},
+        {"cl_subgroups", Target::CLSubgroups},
+        {"metal_simdgroups", Target::MetalSIMDGroups},
+        {"unchecked_entry_point", Target::UncheckedEntryPoint},
+        {"partition_cost_model", Target::PartitionCostModel},
+        {"parallel_loop_ranges", Target::ParallelLoopRanges},
+        {"cuda_fatbin", Target::CUDAFatbin},
+        {"cl_spirv", Target::CLSPIRV},
+        {"check_no_alias", Target::CheckNoAlias},
+        {"stage_luts", Target::StageLUTs},
+        {"arm_i8mm", Target::ARMI8mm},
+        {"hvx_v68", Target::HVX_v68},
+        {"fuse_outputs", Target::FuseOutputs},
+        // NOTE: When adding features to this map, be sure to update PyEnums.cpp as well.
+    };
+    return m;
+}
 
 bool lookup_feature(const std::string &tok, Target::Feature &result) {
-    auto feature_iter = feature_name_map.find(tok);
-    if (feature_iter != feature_name_map.end()) {
+    auto feature_iter = feature_name_map().find(tok);
+    if (feature_iter != feature_name_map().end()) {
         result = feature_iter->second;
         return true;
     }
@@ -698,19 +761,19 @@ bool merge_string(Target &t, const std::string &target) {
 void bad_target_string(const std::string &target) {
     const char *separator = "";
     std::string architectures;
-    for (const auto &arch_entry : arch_name_map) {
+    for (const auto &arch_entry : arch_name_map()) {
         architectures += separator + arch_entry.first;
         separator = ", ";
     }
     separator = "";
     std::string oses;
-    for (const auto &os_entry : os_name_map) {
+    for (const auto &os_entry : os_name_map()) {
         oses += separator + os_entry.first;
         separator = ", ";
     }
     separator = "";
     std::string processors;
-    for (const auto &processor_entry : processor_name_map) {
+    for (const auto &processor_entry : processor_name_map()) {
         processors += separator + processor_entry.first;
         separator = ", ";
     }
@@ -719,7 +782,7 @@ void bad_target_string(const std::string &target) {
     // assume the first line starts with "Features are ".
     int line_char_start = -(int)sizeof("Features are");
     std::string features;
-    for (const auto &feature_entry : feature_name_map) {
+    for (const auto &feature_entry : feature_name_map()) {
         features += separator + feature_entry.first;
         if (features.length() - line_char_start > 70) {
             separator = "\n";
@@ -773,7 +836,7 @@ bool Target::validate_target_string(const std::string &s) {
 }
 
 std::string Target::feature_to_name(Target::Feature feature) {
-    for (const auto &feature_entry : feature_name_map) {
+    for (const auto &feature_entry : feature_name_map()) {
         if (feature == feature_entry.second) {
             return feature_entry.first;
         }
@@ -792,28 +855,28 @@ Target::Feature Target::feature_from_name(const std::string &name) {
 
 std::string Target::to_string() const {
     string result;
-    for (const auto &arch_entry : arch_name_map) {
+    for (const auto &arch_entry : arch_name_map()) {
         if (arch_entry.second == arch) {
             result += arch_entry.first;
             break;
         }
     }
     result += "-" + std::to_string(bits);
-    for (const auto &os_entry : os_name_map) {
+    for (const auto &os_entry : os_name_map()) {
         if (os_entry.second == os) {
             result += "-" + os_entry.first;
             break;
         }
     }
     if (processor_tune != ProcessorGeneric) {
-        for (const auto &processor_entry : processor_name_map) {
+        for (const auto &processor_entry : processor_name_map()) {
             if (processor_entry.second == processor_tune) {
                 result += "-" + processor_entry.first;
                 break;
             }
         }
     }
-    for (const auto &feature_entry : feature_name_map) {
+    for (const auto &feature_entry : feature_name_map()) {
         if (has_feature(feature_entry.second)) {
             result += "-" + feature_entry.first;
         }
@@ -871,6 +934,9 @@ bool Target::supported() const {
 #endif
 #if !defined(WITH_D3D12)
     bad |= has_feature(Target::D3D12Compute);
+#endif
+#if !defined(WITH_VULKAN)
+    bad |= has_feature(Target::Vulkan);
 #endif
     return !bad;
 }
@@ -936,7 +1002,8 @@ bool Target::has_gpu_feature() const {
             has_feature(OpenCL) ||
             has_feature(Metal) ||
             has_feature(D3D12Compute) ||
-            has_feature(OpenGLCompute));
+            has_feature(OpenGLCompute) ||
+            has_feature(Vulkan));
 }
 
 int Target::get_cuda_capability_lower_bound() const {
@@ -979,11 +1046,13 @@ bool Target::supports_type(const Type &t) const {
             return !has_feature(Metal) &&
                    !has_feature(OpenGLCompute) &&
                    !has_feature(D3D12Compute) &&
+                   !has_feature(Vulkan) &&
                    (!has_feature(Target::OpenCL) || has_feature(Target::CLDoubles));
         } else {
             return (!has_feature(Metal) &&
                     !has_feature(OpenGLCompute) &&
-                    !has_feature(D3D12Compute));
+                    !has_feature(D3D12Compute) &&
+                    !has_feature(Vulkan));
         }
     }
     return true;
@@ -996,6 +1065,11 @@ bool Target::supports_type(const Type &t, DeviceAPI device) const {
 
     if (device == DeviceAPI::Hexagon) {
         // HVX supports doubles and long long in the scalar unit only.
+        // From v68, HVX has vectors of 16 and 32 bit floats.
+        if (t.is_float() && !t.is_bfloat() && t.bits() >= 16 && t.bits() <= 32 &&
+            has_feature(Target::HVX_v68)) {
+            return true;
+        }
         if (t.is_float() || t.bits() == 64) {
             return t.lanes() == 1;
         }
@@ -1014,6 +1088,10 @@ bool Target::supports_type(const Type &t, DeviceAPI device) const {
         return t.bits() < 64;
     } else if (device == DeviceAPI::OpenGLCompute) {
         return t.bits() < 64;
+    } else if (device == DeviceAPI::Vulkan) {
+        // 64-bit types need the shaderInt64 and shaderFloat64 device
+        // features, which many mobile GPUs lack.
+        return t.bits() < 64;
     }
 
     return true;
@@ -1058,6 +1136,9 @@ DeviceAPI Target::get_required_device_api() const {
     if (has_feature(Target::OpenGLCompute)) {
         return DeviceAPI::OpenGLCompute;
     }
+    if (has_feature(Target::Vulkan)) {
+        return DeviceAPI::Vulkan;
+    }
     return DeviceAPI::None;
 }
 
@@ -1075,6 +1156,8 @@ Target::Feature target_feature_for_device_api(DeviceAPI api) {
         return Target::HVX;
     case DeviceAPI::D3D12Compute:
         return Target::D3D12Compute;
+    case DeviceAPI::Vulkan:
+        return Target::Vulkan;
     default:
         return Target::FeatureEnd;
     }
@@ -1157,7 +1240,7 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
     // (c) must match across both targets; it is an error if one target has the feature and the other doesn't
 
     // clang-format off
-    const std::array<Feature, 18> union_features = {{
+    const std::array<Feature, 20> union_features = {{
         // These are true union features.
         CUDA,
         D3D12Compute,
@@ -1165,6 +1248,7 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
         NoNEON,
         OpenCL,
         OpenGLCompute,
+        Vulkan,
 
         // These features are actually intersection-y, but because targets only record the _highest_,
         // we have to put their union in the result and then take a lower bound.
@@ -1180,20 +1264,24 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
         HVX_v62,
         HVX_v65,
         HVX_v66,
+        HVX_v68,
     }};
     // clang-format on
 
     // clang-format off
-    const std::array<Feature, 14> intersection_features = {{
+    const std::array<Feature, 17> intersection_features = {{
         ARMv7s,
         ARMv81a,
         AVX,
         AVX2,
         AVX512,
         AVX512_Cannonlake,
+        AVX512_FP16,
         AVX512_KNL,
         AVX512_SapphireRapids,
         AVX512_Skylake,
+        AVX512_VNNI,
+        AVXVNNI,
         F16C,
         FMA,
         FMA4,
@@ -1305,6 +1393,9 @@ bool Target::get_runtime_compatible_target(const Target &other, Target &result)
     if (hvx_version < 66) {
         output.features.reset(HVX_v66);
     }
+    if (hvx_version < 68) {
+        output.features.reset(HVX_v68);
+    }
 
     result = output;
     return true;
@@ -1314,7 +1405,7 @@ namespace Internal {
 
 void target_test() {
     Target t;
-    for (const auto &feature : feature_name_map) {
+    for (const auto &feature : feature_name_map()) {
         t.set_feature(feature.second);
     }
     for (int i = 0; i < (int)(Target::FeatureEnd); i++) {
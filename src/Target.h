@@ -52,7 +52,8 @@ struct Target {
 
     /** The bit-width of a vector register for targets where this is configurable and
      * targeting a fixed size is desired. The default of 0 indicates no assumption of
-     * fixed size is allowed. */
+     * fixed size is allowed. On RISC-V, code compiled for a given vector_bits
+     * also runs correctly on hardware with wider vector registers. */
     int vector_bits = 0;
 
     /** The specific processor to be targeted, tuned for.
@@ -162,6 +163,35 @@ struct Target {
         SanitizerCoverage = halide_target_feature_sanitizer_coverage,
         ProfileByTimer = halide_target_feature_profile_by_timer,
         SPIRV = halide_target_feature_spirv,
+        CUDAAsyncCopies = halide_target_feature_cuda_async_copies,
+        AVX512_VNNI = halide_target_feature_avx512_vnni,
+        AVXVNNI = halide_target_feature_avxvnni,
+        WasmRelaxedSimd = halide_target_feature_wasm_relaxed_simd,
+        HexagonAutoVTCM = halide_target_feature_hexagon_auto_vtcm,
+        ProfileInstrumented = halide_target_feature_profile_instrumented,
+        Vulkan = halide_target_feature_vulkan,
+        PlanHeapStorage = halide_target_feature_plan_heap_storage,
+        BumpAllocator = halide_target_feature_bump_allocator,
+        CacheParallelAllocations = halide_target_feature_cache_parallel_allocations,
+        MultiversionLoops = halide_target_feature_multiversion_loops,
+        VectorMathFast = halide_target_feature_vector_math_fast,
+        VectorMathBalanced = halide_target_feature_vector_math_balanced,
+        VectorMathPrecise = halide_target_feature_vector_math_precise,
+        AVX512_FP16 = halide_target_feature_avx512_fp16,
+        ARMBf16 = halide_target_feature_arm_bf16,
+        CUDATensorCores = halide_target_feature_cuda_tensor_cores,
+        CLSubgroups = halide_target_feature_cl_subgroups,
+        MetalSIMDGroups = halide_target_feature_metal_simdgroups,
+        UncheckedEntryPoint = halide_target_feature_unchecked_entry_point,
+        PartitionCostModel = halide_target_feature_partition_cost_model,
+        ParallelLoopRanges = halide_target_feature_parallel_loop_ranges,
+        CUDAFatbin = halide_target_feature_cuda_fatbin,
+        CLSPIRV = halide_target_feature_cl_spirv,
+        CheckNoAlias = halide_target_feature_check_no_alias,
+        StageLUTs = halide_target_feature_stage_luts,
+        ARMI8mm = halide_target_feature_arm_i8mm,
+        HVX_v68 = halide_target_feature_hvx_v68,
+        FuseOutputs = halide_target_feature_fuse_outputs,
         FeatureEnd = halide_target_feature_end
     };
     Target() = default;
@@ -141,17 +141,45 @@ public:
 template<typename T>
 inline void ThreadPool<T>::Job::run_unlocked(std::unique_lock<std::mutex> &unique_lock) {
     unique_lock.unlock();
+#ifdef __cpp_exceptions
+    // Pass any exception on to whoever waits on the future, rather than
+    // letting it escape the worker thread (which would terminate).
+    try {
+        T r = func();
+        unique_lock.lock();
+        result.set_value(std::move(r));
+    } catch (...) {
+        if (!unique_lock.owns_lock()) {
+            unique_lock.lock();
+        }
+        result.set_exception(std::current_exception());
+    }
+#else
     T r = func();
     unique_lock.lock();
     result.set_value(std::move(r));
+#endif
 }
 
 template<>
 inline void ThreadPool<void>::Job::run_unlocked(std::unique_lock<std::mutex> &unique_lock) {
     unique_lock.unlock();
+#ifdef __cpp_exceptions
+    try {
+        func();
+        unique_lock.lock();
+        result.set_value();
+    } catch (...) {
+        if (!unique_lock.owns_lock()) {
+            unique_lock.lock();
+        }
+        result.set_exception(std::current_exception());
+    }
+#else
     func();
     unique_lock.lock();
     result.set_value();
+#endif
 }
 
 }  // namespace Internal
@@ -1,13 +1,21 @@
 #include "UnrollLoops.h"
 #include "Bounds.h"
 #include "CSE.h"
+#include "ExprUsesVar.h"
+#include "IREquality.h"
 #include "IRMutator.h"
 #include "IROperator.h"
+#include "LoopCarry.h"
 #include "Simplify.h"
 #include "SimplifyCorrelatedDifferences.h"
 #include "Substitute.h"
 
+#include <algorithm>
+#include <map>
+#include <set>
+
 using std::pair;
+using std::string;
 using std::vector;
 
 namespace Halide {
@@ -15,11 +23,149 @@ namespace Internal {
 
 namespace {
 
+// Find the buffers stored to or allocated within a statement.
+class FindWrittenBuffers : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Store *op) override {
+        result.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Allocate *op) override {
+        result.insert(op->name);
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::set<string> result;
+};
+
+// Find the loads in an unrolled iteration that could be done once for
+// all the iterations: loads of buffers that the loop doesn't write to,
+// at indices that don't depend on anything defined in the iteration,
+// and not in code that might not run.
+class FindSharableLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    const Scope<> &in_consume;
+    const std::set<string> &written;
+    Scope<> inner_vars;
+
+    void visit(const Load *op) override {
+        bool sharable = ((op->image.defined() ||
+                          op->param.defined() ||
+                          in_consume.contains(op->name)) &&
+                         !written.count(op->name) &&
+                         !expr_uses_vars(op->index, inner_vars) &&
+                         !expr_uses_vars(op->predicate, inner_vars));
+        if (sharable) {
+            result.insert(op);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Let *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(inner_vars, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const LetStmt *op) override {
+        op->value.accept(this);
+        ScopedBinding<> bind(inner_vars, op->name);
+        op->body.accept(this);
+    }
+
+    void visit(const For *op) override {
+        // Inner loops might not run.
+    }
+
+    void visit(const IfThenElse *op) override {
+        op->condition.accept(this);
+    }
+
+    void visit(const Call *op) override {
+        if (op->is_intrinsic(Call::if_then_else)) {
+            op->args[0].accept(this);
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+public:
+    std::set<Expr, IRDeepCompare> result;
+
+    FindSharableLoads(const Scope<> &in_consume, const std::set<string> &written)
+        : in_consume(in_consume), written(written) {
+    }
+};
+
 class UnrollLoops : public IRMutator {
     using IRMutator::visit;
 
     vector<pair<std::string, Expr>> lets;
 
+    // Productions we're in a consume node for. They don't change.
+    Scope<> in_consume;
+
+    // The most loads to share between the iterations of an unrolled
+    // loop. Each one is kept live across the unrolled loop body.
+    int max_shared_loads;
+
+    // Load values used by several unrolled iterations once, before the
+    // first iteration, so that they stay in registers when unrolled
+    // loops are jammed together.
+    Stmt share_loads(const vector<Stmt> &iters) {
+        Stmt block = Block::make(iters);
+        FindWrittenBuffers written;
+        block.accept(&written);
+
+        std::map<Expr, int, IRDeepCompare> uses;
+        for (const Stmt &iter : iters) {
+            FindSharableLoads finder(in_consume, written.result);
+            iter.accept(&finder);
+            for (const Expr &load : finder.result) {
+                uses[load]++;
+            }
+        }
+
+        // Keep the loads with the most reuse.
+        vector<pair<Expr, int>> shared;
+        for (const auto &it : uses) {
+            if (it.second > 1) {
+                shared.emplace_back(it);
+            }
+        }
+        std::stable_sort(shared.begin(), shared.end(),
+                         [](const pair<Expr, int> &a, const pair<Expr, int> &b) { return a.second > b.second; });
+        if ((int)shared.size() > max_shared_loads) {
+            shared.resize(max_shared_loads);
+        }
+
+        vector<pair<string, Expr>> shared_lets;
+        for (const auto &it : shared) {
+            const Load *load = it.first.as<Load>();
+            string name = unique_name(load->name + ".shared");
+            block = substitute(it.first, Variable::make(load->type, name), block);
+            shared_lets.emplace_back(name, it.first);
+        }
+        for (auto it = shared_lets.rbegin(); it != shared_lets.rend(); it++) {
+            block = LetStmt::make(it->first, it->second, block);
+        }
+        return block;
+    }
+
+    Stmt visit(const ProducerConsumer *op) override {
+        if (op->is_producer) {
+            return IRMutator::visit(op);
+        } else {
+            ScopedBinding<> bind(in_consume, op->name);
+            return IRMutator::visit(op);
+        }
+    }
+
     Stmt visit(const LetStmt *op) override {
         if (is_pure(op->value)) {
             lets.emplace_back(op->name, op->value);
@@ -80,6 +226,18 @@ class UnrollLoops : public IRMutator {
                 user_warning << "Warning: Unrolling a for loop of extent 1: " << for_loop->name << "\n";
             }
 
+            if (!use_guard && e->value > 1) {
+                vector<Stmt> iters(e->value);
+                for (int i = 0; i < e->value; i++) {
+                    // It's necessary to eagerly simplify each iteration
+                    // here to resolve things like muxes down to a
+                    // single item before we go and make N copies of
+                    // something of size N.
+                    iters[i] = simplify(substitute(for_loop->name, for_loop->min + i, body));
+                }
+                return share_loads(iters);
+            }
+
             Stmt iters;
             for (int i = e->value - 1; i >= 0; i--) {
                 Stmt iter = substitute(for_loop->name, for_loop->min + i, body);
@@ -107,7 +265,8 @@ class UnrollLoops : public IRMutator {
     bool permit_failed_unroll = false;
 
 public:
-    UnrollLoops() {
+    UnrollLoops(const Target &t)
+        : max_shared_loads(carried_register_budget(t)) {
         // Experimental autoschedulers may want to unroll without
         // being totally confident the loop will indeed turn out
         // to be constant-sized. If this feature continues to be
@@ -123,8 +282,8 @@ public:
 
 }  // namespace
 
-Stmt unroll_loops(const Stmt &s) {
-    return UnrollLoops().mutate(s);
+Stmt unroll_loops(const Stmt &s, const Target &t) {
+    return UnrollLoops(t).mutate(s);
 }
 
 }  // namespace Internal
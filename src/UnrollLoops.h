@@ -8,12 +8,17 @@
 #include "Expr.h"
 
 namespace Halide {
+
+struct Target;
+
 namespace Internal {
 
 /** Take a statement with for loops marked for unrolling, and convert
  * each into several copies of the innermost statement. I.e. unroll
- * the loop. */
-Stmt unroll_loops(const Stmt &);
+ * the loop. Loads that several unrolled iterations do identically are
+ * done once before them, up to a number of registers that depends on
+ * the target. */
+Stmt unroll_loops(const Stmt &, const Target &);
 
 }  // namespace Internal
 }  // namespace Halide
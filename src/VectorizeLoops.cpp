@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <limits>
 #include <utility>
 
 #include "CSE.h"
@@ -369,6 +370,24 @@ class SerializeLoops : public IRMutator {
     }
 };
 
+// The value that leaves the result of a VectorReduce unchanged.
+Expr vector_reduce_identity(VectorReduce::Operator op, Type t) {
+    switch (op) {
+    case VectorReduce::Add:
+    case VectorReduce::SaturatingAdd:
+    case VectorReduce::Or:
+        return make_zero(t);
+    case VectorReduce::Mul:
+    case VectorReduce::And:
+        return make_one(t);
+    case VectorReduce::Min:
+        return t.is_float() ? make_const(t, std::numeric_limits<double>::infinity()) : t.max();
+    case VectorReduce::Max:
+        return t.is_float() ? make_const(t, -std::numeric_limits<double>::infinity()) : t.min();
+    }
+    return Expr();
+}
+
 // Wrap a vectorized predicate around a Load/Store node.
 class PredicateLoadStore : public IRMutator {
     string var;
@@ -376,6 +395,8 @@ class PredicateLoadStore : public IRMutator {
     int lanes;
     bool valid;
     bool vectorized;
+    // Whether a VectorReduce has been predicated since the last Store.
+    bool reduced = false;
 
     using IRMutator::visit;
 
@@ -436,7 +457,17 @@ class PredicateLoadStore : public IRMutator {
             value = mutate(Broadcast::make(op->value, lanes));
             index = mutate(Broadcast::make(op->index, lanes));
         } else {
-            return IRMutator::visit(op);
+            reduced = false;
+            Stmt stmt = IRMutator::visit(op);
+            if (valid && reduced) {
+                // A store of a horizontal reduction, e.g. an atomic
+                // update of a scalar. The lanes that are off were
+                // replaced by the identity of the reduction, so the
+                // store only needs to be skipped when they all are.
+                vectorized = true;
+                stmt = IfThenElse::make(VectorReduce::make(VectorReduce::Or, vector_predicate, 1), stmt);
+            }
+            return stmt;
         }
 
         predicate = merge_predicate(predicate, vector_predicate);
@@ -454,9 +485,22 @@ class PredicateLoadStore : public IRMutator {
     }
 
     Expr visit(const VectorReduce *op) override {
-        // We can't predicate vector reductions.
-        valid = valid && is_const_one(vector_predicate);
-        return op;
+        if (op->value.type().lanes() != lanes) {
+            // We can't predicate vector reductions whose input lanes
+            // don't correspond to the lanes of the predicate.
+            valid = valid && is_const_one(vector_predicate);
+            return op;
+        }
+        // Predicate the loads in the value, and reduce the identity in
+        // the lanes that are off.
+        Expr value = mutate(op->value);
+        Expr identity = vector_reduce_identity(op->op, value.type());
+        if (!valid || !identity.defined()) {
+            valid = false;
+            return op;
+        }
+        reduced = true;
+        return VectorReduce::make(op->op, select(vector_predicate, value, identity), op->type.lanes());
     }
 
 public:
@@ -922,7 +966,14 @@ class VectorSubs : public IRMutator {
                 if (!vectorize_predicate) {
                     debug(4) << "...Scalarizing vector predicate: \n"
                              << Stmt(op) << "\n";
-                    return scalarize(op);
+                    // Skip the scalar loop entirely when no lanes need
+                    // the then case, which is cheap to check and common
+                    // for sparse conditions.
+                    Stmt scalarized = scalarize(op);
+                    if (!else_case.defined()) {
+                        scalarized = IfThenElse::make(VectorReduce::make(VectorReduce::Or, cond, 1), scalarized);
+                    }
+                    return scalarized;
                 } else {
                     Stmt stmt = predicated_stmt;
                     debug(4) << "...Predicated IfThenElse: \n"
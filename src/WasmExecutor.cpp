@@ -3,6 +3,7 @@
 #include <cmath>
 #include <csignal>
 #include <cstdlib>
+#include <list>
 #include <mutex>
 #include <sstream>
 #include <unordered_map>
@@ -1280,6 +1281,9 @@ wabt::Features calc_features(const Target &target) {
     if (target.has_feature(Target::WasmSatFloatToInt)) {
         f.enable_sat_float_to_int();
     }
+    if (target.has_feature(Target::WasmRelaxedSimd)) {
+        f.enable_relaxed_simd();
+    }
     return f;
 }
 #endif  // WITH_WABT
@@ -2139,6 +2143,42 @@ void add_extern_callbacks(const Local<Context> &context,
     }
 }
 
+// Compiling wasm with TurboFan is slow, and every WasmModuleContents
+// gets its own Isolate, so keep the compiled code for recently seen wire
+// bytes around. A CompiledWasmModule can be instantiated in any Isolate.
+constexpr size_t max_cached_v8_modules = 32;
+
+std::mutex v8_module_cache_mutex;
+std::list<std::pair<std::vector<char>, CompiledWasmModule>> v8_module_cache;
+
+MaybeLocal<WasmModuleObject> compile_v8_module(Isolate *isolate, const std::vector<char> &wire_bytes) {
+    {
+        std::lock_guard<std::mutex> lock(v8_module_cache_mutex);
+        for (auto it = v8_module_cache.begin(); it != v8_module_cache.end(); it++) {
+            if (it->first == wire_bytes) {
+                // Move it to the front, so the least recently used is at the back.
+                v8_module_cache.splice(v8_module_cache.begin(), v8_module_cache, it);
+                wdebug(1) << "Reusing compiled wasm module\n";
+                return WasmModuleObject::FromCompiledModule(isolate, it->second);
+            }
+        }
+    }
+
+    MaybeLocal<WasmModuleObject> maybe_compiled = WasmModuleObject::Compile(
+        isolate,
+        /* wire_bytes */ {(const uint8_t *)wire_bytes.data(), wire_bytes.size()});
+
+    Local<WasmModuleObject> compiled;
+    if (maybe_compiled.ToLocal(&compiled)) {
+        std::lock_guard<std::mutex> lock(v8_module_cache_mutex);
+        v8_module_cache.emplace_front(wire_bytes, compiled->GetCompiledModule());
+        if (v8_module_cache.size() > max_cached_v8_modules) {
+            v8_module_cache.pop_back();
+        }
+    }
+    return maybe_compiled;
+}
+
 #endif  // WITH_V8
 
 }  // namespace
@@ -2417,6 +2457,11 @@ WasmModuleContents::WasmModuleContents(
             // "--no-liftoff",
             // "--wasm-interpret-all",
             // "--trace-wasm-memory",
+
+            // Compile straight to optimized code, rather than starting in
+            // Liftoff and tiering up in the background partway through
+            // whatever is being timed.
+            "--no-liftoff",
         };
         for (const auto &f : flags) {
             V8::SetFlagsFromString(f.c_str(), f.size());
@@ -2451,9 +2496,7 @@ WasmModuleContents::WasmModuleContents(
 
     std::vector<char> final_wasm = compile_to_wasm(halide_module, fn_name);
 
-    MaybeLocal<WasmModuleObject> maybe_compiled = WasmModuleObject::Compile(
-        isolate,
-        /* wire_bytes */ {(const uint8_t *)final_wasm.data(), final_wasm.size()});
+    MaybeLocal<WasmModuleObject> maybe_compiled = compile_v8_module(isolate, final_wasm);
 
     Local<WasmModuleObject> compiled;
     if (!maybe_compiled.ToLocal(&compiled)) {
@@ -2705,6 +2748,15 @@ bool WasmModule::can_jit_target(const Target &target) {
     return false;
 }
 
+/*static*/
+bool WasmModule::uses_interpreter() {
+#if WITH_V8
+    return false;
+#else
+    return true;
+#endif
+}
+
 /*static*/
 WasmModule WasmModule::compile(
     const Module &module,
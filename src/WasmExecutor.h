@@ -7,7 +7,7 @@
  * Bindings for parameters, extern calls, etc. are established and the
  * Wasm code is executed. Allows calls to realize to work
  * exactly as if native code had been run, but via a JavaScript/Wasm VM.
- * Currently, only the WABT interpreter is supported.
+ * Either the WABT interpreter or V8 may be used.
  */
 
 #include "Argument.h"
@@ -35,6 +35,11 @@ struct WasmModule {
     /** If the given target can be executed via the wasm executor, return true. */
     static bool can_jit_target(const Target &target);
 
+    /** Return true if wasm code is run by an interpreter (WABT) rather
+     * than compiled to native code (V8), in which case timing it tells
+     * you little about how it would perform in a browser. */
+    static bool uses_interpreter();
+
     /** Compile generated wasm code with a set of externs. */
     static WasmModule compile(
         const Module &module,
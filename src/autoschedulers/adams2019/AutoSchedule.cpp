@@ -24,6 +24,10 @@
   If set, is used for the debug log level for auto-schedule generation (overriding the
   value of HL_DEBUG_CODEGEN, if any).
 
+  HL_HARDWARE_PROFILE
+  The hardware profile to take the default parallelism from when the hardware_profile
+  param is not given: "none", "host", or the path of a saved profile. See HardwareProfile.h.
+
   HL_PERMIT_FAILED_UNROLL
   Set to 1 to tell Halide not to freak out if we try to unroll a loop that doesn't have a constant extent. Should generally not be necessary, but sometimes the autoscheduler's model for what will and will not turn into a constant during lowering is inaccurate, because Halide isn't perfect at constant-folding.
 
@@ -45,6 +49,7 @@
 #include <algorithm>
 #include <chrono>
 #include <fstream>
+#include <future>
 #include <iostream>
 #include <queue>
 #include <random>
@@ -62,6 +67,7 @@
 #include "Featurization.h"
 #include "FunctionDAG.h"
 #include "Halide.h"
+#include "HardwareProfile.h"
 #include "LoopNest.h"
 #include "NetworkSize.h"
 #include "ParamParser.h"
@@ -212,6 +218,113 @@ public:
     }
 };
 
+// A stand-in for the cost model while a state is being expanded on a
+// worker thread. It records the features enqueued on it, so that they
+// can be passed on to the real cost model afterwards, in a
+// deterministic order.
+class DeferredCostModel : public CostModel {
+    std::vector<std::pair<StageMapOfScheduleFeatures, double *>> queue;
+
+public:
+    void set_pipeline_features(const FunctionDAG &dag,
+                               const Adams2019Params &params) override {
+        internal_error << "DeferredCostModel has no pipeline features\n";
+    }
+
+    void enqueue(const FunctionDAG &dag,
+                 const StageMapOfScheduleFeatures &schedule_feats,
+                 double *cost_ptr) override {
+        queue.emplace_back(schedule_feats, cost_ptr);
+    }
+
+    void evaluate_costs() override {
+        internal_error << "DeferredCostModel can't evaluate costs\n";
+    }
+
+    void reset() override {
+        queue.clear();
+    }
+
+    // Enqueue everything recorded so far on another cost model.
+    void flush(const FunctionDAG &dag, CostModel *cost_model) {
+        for (const auto &q : queue) {
+            cost_model->enqueue(dag, q.first, q.second);
+        }
+        queue.clear();
+    }
+};
+
+// All the children of a state, in the order they are generated, with
+// nothing memoized, so that the order only depends on the state, the
+// pipeline and the parameters. Used to record and follow the path to
+// a cached schedule.
+vector<IntrusivePtr<State>> all_children(const State &state,
+                                         const FunctionDAG &dag,
+                                         const Adams2019Params &params) {
+    CachingOptions options;
+    Cache cache(options, dag.nodes.size());
+    DeferredCostModel costs;
+    vector<IntrusivePtr<State>> children;
+    std::function<void(IntrusivePtr<State> &&)> accept_child =
+        [&](IntrusivePtr<State> &&s) {
+            children.emplace_back(std::move(s));
+        };
+    state.generate_children(dag, params, &costs, accept_child, &cache);
+    return children;
+}
+
+// Find the path from the initial state to the given complete state,
+// or return an empty path if it can't be found.
+ScheduleCache::Path record_path(const State &state,
+                                const FunctionDAG &dag,
+                                const Adams2019Params &params) {
+    vector<const State *> chain;
+    for (const State *s = &state; s->parent.defined(); s = s->parent.get()) {
+        chain.push_back(s);
+    }
+    std::reverse(chain.begin(), chain.end());
+
+    ScheduleCache::Path path;
+    for (const State *s : chain) {
+        auto children = all_children(*s->parent, dag, params);
+        const auto key = loop_nest_key(*s->root);
+        int index = -1;
+        for (size_t i = 0; i < children.size(); i++) {
+            if (children[i]->root.defined() && loop_nest_key(*children[i]->root) == key) {
+                index = (int)i;
+                break;
+            }
+        }
+        if (index < 0) {
+            aslog(1) << "Could not find decision " << path.size() << " of the schedule among the children of its parent\n";
+            return {};
+        }
+        path.emplace_back(index, (int)children.size());
+    }
+    return path;
+}
+
+// Follow a path from the initial state, or return nullptr if the
+// children at some decision aren't the ones the path was recorded
+// with.
+IntrusivePtr<State> follow_path(const ScheduleCache::Path &path,
+                                const FunctionDAG &dag,
+                                const Adams2019Params &params) {
+    IntrusivePtr<State> state{new State};
+    state->root = new LoopNest;
+    for (const auto &step : path) {
+        auto children = all_children(*state, dag, params);
+        if ((int)children.size() != step.second || step.first < 0 || step.first >= step.second) {
+            return nullptr;
+        }
+        state = children[step.first];
+    }
+    if (state->num_decisions_made != 2 * (int)dag.nodes.size()) {
+        return nullptr;
+    }
+    return state;
+}
+
 // Configure a cost model to process a specific pipeline.
 void configure_pipeline_features(const FunctionDAG &dag,
                                  const Adams2019Params &params,
@@ -220,7 +333,19 @@ void configure_pipeline_features(const FunctionDAG &dag,
     cost_model->set_pipeline_features(dag, params);
 }
 
-// A single pass of coarse-to-fine beam search.
+// A wall-clock limit on the search.
+struct Deadline {
+    Timer timer;
+    // Zero means there is no limit.
+    double seconds = 0;
+
+    bool passed() const {
+        return seconds > 0 && timer.elapsed().count() >= seconds;
+    }
+};
+
+// A single pass of coarse-to-fine beam search. Returns nullptr if the
+// deadline passes before the pass is done.
 IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           const vector<Function> &outputs,
                                           const Adams2019Params &params,
@@ -230,7 +355,9 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                           int num_passes,
                                           ProgressBar &tick,
                                           std::unordered_set<uint64_t> &permitted_hashes,
-                                          Cache *cache) {
+                                          Cache *cache,
+                                          ThreadPool<void> *pool,
+                                          const Deadline *deadline) {
 
     if (cost_model) {
         configure_pipeline_features(dag, params, cost_model);
@@ -269,6 +396,10 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
 
     // This loop is beam search over the sequence of decisions to make.
     for (int i = 0;; i++) {
+        if (deadline && deadline->passed()) {
+            return nullptr;
+        }
+
         std::unordered_map<uint64_t, int> hashes;
         q.swap(pending);
 
@@ -288,7 +419,9 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                                              num_passes,
                                              tick,
                                              permitted_hashes,
-                                             cache);
+                                             cache,
+                                             pool,
+                                             deadline);
             } else {
                 internal_error << "Ran out of legal states with beam size " << params.beam_size << "\n";
             }
@@ -299,6 +432,7 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
         }
 
         expanded = 0;
+        vector<IntrusivePtr<State>> to_expand;
         while (expanded < params.beam_size && !pending.empty()) {
 
             IntrusivePtr<State> state{pending.pop()};
@@ -376,10 +510,59 @@ IntrusivePtr<State> optimal_schedule_pass(FunctionDAG &dag,
                 return best;
             }
 
-            state->generate_children(dag, params, cost_model, enqueue_new_children, cache);
+            if (pool) {
+                // Expanded below, on the thread pool.
+                to_expand.emplace_back(std::move(state));
+            } else {
+                state->generate_children(dag, params, cost_model, enqueue_new_children, cache);
+            }
             expanded++;
         }
 
+        if (!to_expand.empty()) {
+            // Expand the chosen states concurrently, collecting the
+            // children of each and the features they enqueue on the cost
+            // model. Then pass those on in the order a serial search
+            // would have produced them, so that the result doesn't
+            // depend on the number of threads.
+            struct Expansion {
+                vector<IntrusivePtr<State>> children;
+                DeferredCostModel costs;
+            };
+            vector<Expansion> expansions(to_expand.size());
+            vector<std::future<void>> futures;
+            cache->defer_memoization = true;
+            for (size_t j = 0; j < to_expand.size(); j++) {
+                futures.emplace_back(pool->async([&, j]() {
+                    Expansion &e = expansions[j];
+                    std::function<void(IntrusivePtr<State> &&)> accept_child =
+                        [&e](IntrusivePtr<State> &&s) {
+                            e.children.emplace_back(std::move(s));
+                        };
+                    to_expand[j]->generate_children(dag, params, cost_model ? &e.costs : nullptr, accept_child, cache);
+                }));
+            }
+            for (auto &f : futures) {
+                f.wait();
+            }
+            for (auto &f : futures) {
+                f.get();
+            }
+            cache->defer_memoization = false;
+            cache->commit_deferred_blocks(to_expand);
+
+            for (size_t j = 0; j < expansions.size(); j++) {
+                expanded = (int)j;
+                if (cost_model) {
+                    expansions[j].costs.flush(dag, cost_model);
+                }
+                for (auto &child : expansions[j].children) {
+                    enqueue_new_children(std::move(child));
+                }
+            }
+            expanded = (int)to_expand.size();
+        }
+
         // Drop the other states unconsidered.
         pending.clear();
 
@@ -431,58 +614,107 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
 
     IntrusivePtr<State> best;
 
-    std::unordered_set<uint64_t> permitted_hashes;
-
     // Set up cache with options and size.
     Cache cache(options, dag.nodes.size());
 
-    // If the beam size is one, it's pointless doing multiple passes.
-    int num_passes = (params.beam_size == 1) ? 1 : 5;
+    // A fast search is a greedy one.
+    Adams2019Params search_params = params;
+    if (params.fast_mode) {
+        search_params.beam_size = 1;
+    }
+
+    user_assert(params.time_limit >= 0) << "Adams2019.time_limit may not be negative\n";
+    Deadline deadline;
+    deadline.seconds = params.time_limit;
 
 #ifdef HALIDE_AUTOSCHEDULER_ALLOW_CYOS
     string cyos_str = get_env_variable("HL_CYOS");
-    if (cyos_str == "1") {
-        // If the user is manually navigating the search space, don't
-        // ask them to do more than one pass.
-        num_passes = 1;
-    }
 #endif
-
     string num_passes_str = get_env_variable("HL_NUM_PASSES");
-    if (!num_passes_str.empty()) {
-        // The user has requested a non-standard number of passes.
-        num_passes = std::atoi(num_passes_str.c_str());
+
+    user_assert(params.search_threads >= 0) << "Adams2019.search_threads may not be negative\n";
+    std::unique_ptr<ThreadPool<void>> pool;
+    if (params.search_threads != 1) {
+        size_t num_threads = params.search_threads ? params.search_threads : ThreadPool<void>::num_processors_online();
+        pool = std::make_unique<ThreadPool<void>>(num_threads);
     }
 
-    for (int i = 0; i < num_passes; i++) {
-        ProgressBar tick;
+    // Run the coarse-to-fine passes for one beam size, keeping the
+    // best complete schedule. Returns false if the deadline passed.
+    auto search = [&](const Adams2019Params &p, const Deadline *d) {
+        // If the beam size is one, it's pointless doing multiple passes.
+        int num_passes = (p.beam_size == 1) ? 1 : 5;
+
+#ifdef HALIDE_AUTOSCHEDULER_ALLOW_CYOS
+        if (cyos_str == "1") {
+            // If the user is manually navigating the search space, don't
+            // ask them to do more than one pass.
+            num_passes = 1;
+        }
+#endif
+
+        if (!num_passes_str.empty()) {
+            // The user has requested a non-standard number of passes.
+            num_passes = std::atoi(num_passes_str.c_str());
+        }
+
+        std::unordered_set<uint64_t> permitted_hashes;
+        for (int i = 0; i < num_passes; i++) {
+            ProgressBar tick;
 
-        Timer timer;
+            Timer timer;
 
-        auto pass = optimal_schedule_pass(dag, outputs, params, cost_model,
-                                          rng, i, num_passes, tick, permitted_hashes, &cache);
+            auto pass = optimal_schedule_pass(dag, outputs, p, cost_model,
+                                              rng, i, num_passes, tick, permitted_hashes, &cache, pool.get(), d);
 
-        std::chrono::duration<double> total_time = timer.elapsed();
-        auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
+            std::chrono::duration<double> total_time = timer.elapsed();
+            auto milli = std::chrono::duration_cast<std::chrono::milliseconds>(total_time).count();
 
-        tick.clear();
+            tick.clear();
 
-        switch (aslog::aslog_level()) {
-        case 0:
-            // Silence
-            break;
-        case 1:
-            aslog(1) << "Pass " << i << " of " << num_passes << ", cost: " << pass->cost << ", time (ms): " << milli << "\n";
-            break;
-        default:
-            aslog(2) << "Pass " << i << " result: ";
-            pass->dump(aslog(2).get_ostream());
+            if (!pass.defined()) {
+                aslog(1) << "Ran out of time in pass " << i << " of " << num_passes
+                         << " with beam size " << p.beam_size << "\n";
+                return false;
+            }
+
+            switch (aslog::aslog_level()) {
+            case 0:
+                // Silence
+                break;
+            case 1:
+                aslog(1) << "Pass " << i << " of " << num_passes << ", cost: " << pass->cost << ", time (ms): " << milli << "\n";
+                break;
+            default:
+                aslog(2) << "Pass " << i << " result: ";
+                pass->dump(aslog(2).get_ostream());
+            }
+
+            if (!best.defined() || pass->cost < best->cost) {
+                // Track which pass produced the lowest-cost state. It's
+                // not necessarily the final one.
+                best = pass;
+            }
         }
+        return true;
+    };
 
-        if (i == 0 || pass->cost < best->cost) {
-            // Track which pass produced the lowest-cost state. It's
-            // not necessarily the final one.
-            best = pass;
+    if (deadline.seconds == 0 || search_params.beam_size == 1) {
+        // A greedy search is as fast as the search gets, so it always
+        // runs to completion.
+        search(search_params, nullptr);
+    } else {
+        // Anytime search: find a greedy schedule first, and then
+        // search again with wider and wider beams until the time runs
+        // out, or the beam reaches its full size.
+        Adams2019Params p = search_params;
+        p.beam_size = 1;
+        search(p, nullptr);
+        while (p.beam_size < search_params.beam_size && !deadline.passed()) {
+            p.beam_size = std::min(p.beam_size * 4, search_params.beam_size);
+            if (!search(p, &deadline)) {
+                break;
+            }
         }
     }
 
@@ -497,7 +729,7 @@ IntrusivePtr<State> optimal_schedule(FunctionDAG &dag,
 }
 
 // Keep track of how many times we evaluated a state.
-int State::cost_calculations = 0;
+std::atomic<int> State::cost_calculations{0};
 
 // The main entrypoint to generate a schedule for a pipeline.
 void generate_schedule(const std::vector<Function> &outputs,
@@ -514,6 +746,12 @@ void generate_schedule(const std::vector<Function> &outputs,
     aslog(1) << "Adams2019.disable_memoized_features:" << params.disable_memoized_features << "\n";
     aslog(1) << "Adams2019.disable_memoized_blocks:" << params.disable_memoized_blocks << "\n";
     aslog(1) << "Adams2019.memory_limit:" << params.memory_limit << "\n";
+    aslog(1) << "Adams2019.search_threads:" << params.search_threads << "\n";
+    aslog(1) << "Adams2019.pad_storage:" << params.pad_storage << "\n";
+    aslog(1) << "Adams2019.feature_cache_dir:" << params.feature_cache_dir << "\n";
+    aslog(1) << "Adams2019.time_limit:" << params.time_limit << "\n";
+    aslog(1) << "Adams2019.fast_mode:" << params.fast_mode << "\n";
+    aslog(1) << "Adams2019.schedule_cache_dir:" << params.schedule_cache_dir << "\n";
 
     // Start a timer
     HALIDE_TIC;
@@ -537,7 +775,8 @@ void generate_schedule(const std::vector<Function> &outputs,
     // Construct a cost model to use to evaluate states. Currently we
     // just have the one, but it's an abstract interface, so others
     // can be slotted in for experimentation.
-    std::unique_ptr<CostModel> cost_model = make_default_cost_model(weights_in_path, weights_out_path, randomize_weights);
+    std::unique_ptr<CostModel> cost_model = make_default_cost_model(weights_in_path, weights_out_path, randomize_weights,
+                                                                     target.has_gpu_feature());
     internal_assert(cost_model != nullptr);
 
     IntrusivePtr<State> optimal;
@@ -545,13 +784,46 @@ void generate_schedule(const std::vector<Function> &outputs,
     // Options generated from environment variables, decide whether or not to cache features and/or tilings.
     CachingOptions cache_options = CachingOptions::MakeOptionsFromParams(params);
 
-    // Run beam search
-    optimal = optimal_schedule(dag, outputs, params, cost_model.get(), rng, cache_options);
+    std::unique_ptr<PersistentFeatureCache> persistent_features;
+    if (!params.feature_cache_dir.empty()) {
+        persistent_features = std::make_unique<PersistentFeatureCache>(params.feature_cache_dir, dag, target, params);
+        cache_options.persistent_features = persistent_features.get();
+    }
+
+    std::unique_ptr<ScheduleCache> schedule_cache;
+    if (!params.schedule_cache_dir.empty()) {
+        schedule_cache = std::make_unique<ScheduleCache>(params.schedule_cache_dir, dag, target, params);
+        ScheduleCache::Path path;
+        if (schedule_cache->lookup(&path)) {
+            optimal = follow_path(path, dag, params);
+            if (!optimal.defined()) {
+                aslog(1) << "The cached schedule doesn't fit this pipeline; searching instead\n";
+            }
+        }
+    }
+
+    if (!optimal.defined()) {
+        // Run beam search
+        optimal = optimal_schedule(dag, outputs, params, cost_model.get(), rng, cache_options);
+
+        if (schedule_cache) {
+            ScheduleCache::Path path = record_path(*optimal, dag, params);
+            if (!path.empty()) {
+                schedule_cache->insert(path);
+            }
+        }
+    }
 
     HALIDE_TOC;
 
     aslog(1) << "Cost evaluated this many times: " << State::cost_calculations << "\n";
 
+    if (persistent_features) {
+        aslog(1) << "Feature cache hits: " << persistent_features->hits << "\n";
+        aslog(1) << "Feature cache misses: " << persistent_features->misses << "\n";
+        persistent_features->save();
+    }
+
     // Dump the schedule found
     aslog(1) << "** Optimal schedule:\n";
 
@@ -588,6 +860,14 @@ struct Adams2019 {
         Adams2019Params params;
         {
             ParamParser parser(params_in.extra);
+            // The parallelism defaults to the core count of the
+            // hardware profile, if there is one.
+            std::string hardware_profile;
+            parser.parse("hardware_profile", &hardware_profile);
+            HardwareProfile profile;
+            if (HardwareProfile::find(hardware_profile, target, &profile)) {
+                params.parallelism = profile.num_cores;
+            }
             parser.parse("parallelism", &params.parallelism);
             parser.parse("beam_size", &params.beam_size);
             parser.parse("random_dropout", &params.random_dropout);
@@ -597,6 +877,12 @@ struct Adams2019 {
             parser.parse("disable_memoized_features", &params.disable_memoized_features);
             parser.parse("disable_memoized_blocks", &params.disable_memoized_blocks);
             parser.parse("memory_limit", &params.memory_limit);
+            parser.parse("search_threads", &params.search_threads);
+            parser.parse("pad_storage", &params.pad_storage);
+            parser.parse("feature_cache_dir", &params.feature_cache_dir);
+            parser.parse("schedule_cache_dir", &params.schedule_cache_dir);
+            parser.parse("time_limit", &params.time_limit);
+            parser.parse("fast_mode", &params.fast_mode);
             parser.finish();
         }
         Autoscheduler::generate_schedule(outputs, target, params, results);
@@ -2,6 +2,13 @@
 #include "LoopNest.h"
 #include "State.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
 namespace Halide {
 namespace Internal {
 namespace Autoscheduler {
@@ -71,7 +78,7 @@ bool Cache::add_memoized_blocks(const State *state,
     return true;
 }
 
-void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
+void Cache::memoize_blocks(const State *state, const FunctionDAG::Node *node, LoopNest *new_root) {
     if (!options.cache_blocks) {
         return;
     }
@@ -89,18 +96,410 @@ void Cache::memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root) {
 
     internal_assert(loop_nest_found) << "memoize_blocks did not find loop nest!\n";
 
-    auto &blocks = memoized_compute_root_blocks.get_or_create(node)[vector_dim];
-
+    std::vector<IntrusivePtr<const LoopNest>> new_blocks;
     for (auto &child : new_root->children) {
         if (child->node == node) {
             // Need const reference for copy.
             const LoopNest *child_ptr = child.get();
             LoopNest *new_block = new LoopNest;
             new_block->copy_from_including_features(*child_ptr);
-            blocks.emplace_back(new_block);
-            cache_misses++;
+            new_blocks.emplace_back(new_block);
+        }
+    }
+
+    if (defer_memoization) {
+        std::lock_guard<std::mutex> lock(deferred_mutex);
+        deferred_blocks[state].push_back({node, vector_dim, std::move(new_blocks)});
+        return;
+    }
+
+    auto &blocks = memoized_compute_root_blocks.get_or_create(node)[vector_dim];
+    for (auto &b : new_blocks) {
+        blocks.emplace_back(std::move(b));
+        cache_misses++;
+    }
+}
+
+void Cache::commit_deferred_blocks(const std::vector<IntrusivePtr<State>> &states) {
+    for (const auto &state : states) {
+        auto it = deferred_blocks.find(state.get());
+        if (it == deferred_blocks.end()) {
+            continue;
+        }
+
+        // Expanded serially, this state would have used the blocks
+        // memoized by an earlier state instead of making its own.
+        std::vector<bool> already_memoized;
+        for (const auto &d : it->second) {
+            already_memoized.push_back(memoized_compute_root_blocks.contains(d.node) &&
+                                       memoized_compute_root_blocks.get(d.node).count(d.vector_dim) > 0);
+        }
+
+        for (size_t i = 0; i < it->second.size(); i++) {
+            if (already_memoized[i]) {
+                continue;
+            }
+            auto &d = it->second[i];
+            auto &blocks = memoized_compute_root_blocks.get_or_create(d.node)[d.vector_dim];
+            for (auto &b : d.blocks) {
+                blocks.emplace_back(std::move(b));
+                cache_misses++;
+            }
+        }
+    }
+    deferred_blocks.clear();
+}
+
+namespace {
+
+// Bump the last byte whenever the file format or the featurization changes.
+constexpr char feature_cache_magic[8] = {'H', 'L', 'A', 'S', 'F', 'C', 0, 1};
+
+// Bump the last byte whenever the file format or the search space changes.
+constexpr char schedule_cache_magic[8] = {'H', 'L', 'A', 'S', 'S', 'C', 0, 1};
+
+// Once a cache file reaches this size, no more entries are added to it.
+constexpr int64_t max_feature_cache_file_size = (int64_t)1 << 30;
+
+uint64_t fnv1a(const char *data, size_t size) {
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < size; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Two independent 64-bit hashes, so that collisions are vanishingly
+// unlikely even with millions of entries.
+PersistentFeatureCache::Key hash_string(const std::string &s) {
+    return {fnv1a(s.data(), s.size()), (uint64_t)std::hash<std::string>()(s)};
+}
+
+template<typename T>
+void append_pod(std::string &s, T value) {
+    s.append((const char *)&value, sizeof(value));
+}
+
+template<typename T>
+bool read_pod(const std::string &s, size_t &pos, T *value) {
+    if (s.size() - pos < sizeof(T)) {
+        return false;
+    }
+    memcpy(value, s.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// Record everything about a loop nest that its featurization depends on.
+void append_structure(std::string &s, const LoopNest &n) {
+    append_pod<int32_t>(s, n.node ? n.node->id : -1);
+    append_pod<int32_t>(s, n.stage ? n.stage->index : -1);
+    append_pod<uint32_t>(s, (uint32_t)n.size.size());
+    for (int64_t e : n.size) {
+        append_pod<int64_t>(s, e);
+    }
+    append_pod<uint8_t>(s, n.innermost);
+    append_pod<uint8_t>(s, n.tileable);
+    append_pod<uint8_t>(s, n.parallel);
+    append_pod<int32_t>(s, n.vector_dim);
+    append_pod<int32_t>(s, n.vectorized_loop_index);
+
+    // Neither of these are iterated in a deterministic order.
+    std::vector<int> store_at;
+    for (const auto *f : n.store_at) {
+        store_at.push_back(f->id);
+    }
+    std::sort(store_at.begin(), store_at.end());
+    append_pod<uint32_t>(s, (uint32_t)store_at.size());
+    for (int id : store_at) {
+        append_pod<int32_t>(s, id);
+    }
+
+    std::vector<std::pair<int, int64_t>> inlined;
+    for (auto it = n.inlined.begin(); it != n.inlined.end(); it++) {
+        inlined.emplace_back(it.key()->id, it.value());
+    }
+    std::sort(inlined.begin(), inlined.end());
+    append_pod<uint32_t>(s, (uint32_t)inlined.size());
+    for (const auto &i : inlined) {
+        append_pod<int32_t>(s, i.first);
+        append_pod<int64_t>(s, i.second);
+    }
+
+    append_pod<uint32_t>(s, (uint32_t)n.children.size());
+    for (const auto &c : n.children) {
+        append_structure(s, *c);
+    }
+}
+
+}  // namespace
+
+std::pair<uint64_t, uint64_t> loop_nest_key(const LoopNest &root) {
+    std::string s;
+    append_structure(s, root);
+    return hash_string(s);
+}
+
+PersistentFeatureCache::PersistentFeatureCache(const std::string &dir, const FunctionDAG &dag,
+                                               const Target &target, const Adams2019Params &params) {
+    // The file is named by a hash of everything other than the loop
+    // nest that the featurization depends on.
+    std::ostringstream fingerprint;
+    fingerprint << std::setprecision(17)
+                << "features v" << ScheduleFeatures::version()
+                << " x" << ScheduleFeatures::num_features() << "\n"
+                << "target " << target.to_string() << "\n"
+                << "parallelism " << params.parallelism << "\n";
+    dag.dump(fingerprint);
+    for (const auto &n : dag.nodes) {
+        fingerprint << n.func.name() << " " << n.bytes_per_point << " " << n.vector_size << "\n";
+        for (const auto &e : n.estimated_region_required) {
+            fingerprint << " " << e.min() << " " << e.max() << " " << e.constant_extent() << "\n";
+        }
+        for (const auto &st : n.stages) {
+            fingerprint << " " << st.vector_size;
+        }
+        fingerprint << "\n";
+    }
+    Key h = hash_string(fingerprint.str());
+    std::ostringstream name;
+    name << dir << "/" << std::hex << std::setfill('0') << std::setw(16) << h.first << std::setw(16) << h.second << ".features";
+    path = name.str();
+
+    stages_by_id.resize(dag.nodes[0].stages[0].max_id, nullptr);
+    for (const auto &n : dag.nodes) {
+        for (const auto &st : n.stages) {
+            stages_by_id[st.id] = &st;
+        }
+    }
+
+    load();
+}
+
+PersistentFeatureCache::Key PersistentFeatureCache::key(const LoopNest &root) const {
+    return loop_nest_key(root);
+}
+
+bool PersistentFeatureCache::lookup(const Key &key, StageMap<ScheduleFeatures> *features) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(key);
+    if (it == entries.end()) {
+        misses++;
+        return false;
+    }
+    for (const auto &f : it->second) {
+        features->get_or_create(stages_by_id[f.first]) = f.second;
+    }
+    hits++;
+    return true;
+}
+
+void PersistentFeatureCache::insert(const Key &key, const StageMap<ScheduleFeatures> &features) {
+    Entry entry;
+    for (auto it = features.begin(); it != features.end(); it++) {
+        entry.emplace_back(it.key()->id, it.value());
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (entries.emplace(key, std::move(entry)).second) {
+        new_entries.push_back(key);
+    }
+}
+
+// The file is a header followed by a sequence of records, each of
+// which is the key, the number of stages, the id and features of each
+// stage, and then a checksum over all of that. Loading stops at the
+// first malformed record, so a file truncated or garbled by a crash
+// or by concurrent writers only loses the entries from that point on.
+void PersistentFeatureCache::load() {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        aslog(1) << "Feature cache " << path << " does not exist yet\n";
+        return;
+    }
+    std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    size_t pos = sizeof(feature_cache_magic);
+    if (data.size() < pos || memcmp(data.data(), feature_cache_magic, pos) != 0) {
+        aslog(1) << "Ignoring feature cache " << path << " with a bad header\n";
+        return;
+    }
+
+    while (pos < data.size()) {
+        const size_t start = pos;
+        Key key;
+        uint32_t num_stages = 0;
+        if (!read_pod(data, pos, &key.first) ||
+            !read_pod(data, pos, &key.second) ||
+            !read_pod(data, pos, &num_stages) ||
+            num_stages > stages_by_id.size()) {
+            break;
+        }
+        Entry entry(num_stages);
+        bool ok = true;
+        for (auto &e : entry) {
+            uint32_t id = 0;
+            ok = read_pod(data, pos, &id) &&
+                 id < stages_by_id.size() && stages_by_id[id] &&
+                 read_pod(data, pos, &e.second);
+            if (!ok) {
+                break;
+            }
+            e.first = (int)id;
+        }
+        uint64_t checksum = 0;
+        if (!ok ||
+            !read_pod(data, pos, &checksum) ||
+            checksum != fnv1a(data.data() + start, pos - start - sizeof(checksum))) {
+            break;
+        }
+        entries.emplace(key, std::move(entry));
+    }
+    if (pos < data.size()) {
+        aslog(1) << "Ignoring malformed entries at the end of feature cache " << path << "\n";
+    }
+    aslog(1) << "Loaded " << entries.size() << " entries from feature cache " << path << "\n";
+}
+
+void PersistentFeatureCache::save() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (new_entries.empty()) {
+        return;
+    }
+
+    int64_t existing_size = 0;
+    {
+        std::ifstream f(path, std::ios::binary | std::ios::ate);
+        if (f) {
+            existing_size = (int64_t)f.tellg();
         }
     }
+    if (existing_size >= max_feature_cache_file_size) {
+        aslog(1) << "Feature cache " << path << " is full; not adding " << new_entries.size() << " entries\n";
+        return;
+    }
+
+    std::string data;
+    if (existing_size == 0) {
+        data.append(feature_cache_magic, sizeof(feature_cache_magic));
+    }
+    for (const Key &key : new_entries) {
+        const size_t start = data.size();
+        const Entry &entry = entries.at(key);
+        append_pod<uint64_t>(data, key.first);
+        append_pod<uint64_t>(data, key.second);
+        append_pod<uint32_t>(data, (uint32_t)entry.size());
+        for (const auto &e : entry) {
+            append_pod<uint32_t>(data, (uint32_t)e.first);
+            append_pod<ScheduleFeatures>(data, e.second);
+        }
+        append_pod<uint64_t>(data, fnv1a(data.data() + start, data.size() - start));
+    }
+
+    // Append everything with a single write, so that processes
+    // sharing the file are unlikely to interleave their records.
+    std::ofstream f(path, std::ios::binary | std::ios::app);
+    f.write(data.data(), data.size());
+    f.close();
+    if (f.fail()) {
+        aslog(1) << "Failed to write feature cache " << path << "\n";
+        return;
+    }
+    aslog(1) << "Added " << new_entries.size() << " entries to feature cache " << path << "\n";
+    new_entries.clear();
+}
+
+ScheduleCache::ScheduleCache(const std::string &dir, const FunctionDAG &dag,
+                             const Target &target, const Adams2019Params &params) {
+    // The file is named by a hash of everything the search depends
+    // on. The dump of the DAG covers its structure, types and access
+    // patterns. The estimates are rounded, so that pipelines that only
+    // differ slightly in size share a schedule.
+    std::ostringstream fingerprint;
+    fingerprint << "schedule\n"
+                << "target " << target.to_string() << "\n"
+                << "parallelism " << params.parallelism << "\n"
+                << "beam_size " << params.beam_size << "\n"
+                << "random_dropout " << params.random_dropout << " " << params.random_dropout_seed << "\n"
+                << "weights_path " << params.weights_path << "\n"
+                << "disable_subtiling " << params.disable_subtiling << "\n"
+                << "memory_limit " << params.memory_limit << "\n"
+                << "pad_storage " << params.pad_storage << "\n"
+                << "fast_mode " << params.fast_mode << "\n";
+    dag.dump(fingerprint);
+    for (const auto &n : dag.nodes) {
+        fingerprint << n.func.name();
+        for (const auto &e : n.estimated_region_required) {
+            int log2_extent = 0;
+            while (((int64_t)1 << (log2_extent + 1)) <= e.extent()) {
+                log2_extent++;
+            }
+            fingerprint << " " << log2_extent;
+        }
+        fingerprint << "\n";
+    }
+    auto h = hash_string(fingerprint.str());
+    std::ostringstream name;
+    name << dir << "/" << std::hex << std::setfill('0') << std::setw(16) << h.first << std::setw(16) << h.second << ".schedule";
+    path = name.str();
+}
+
+// The file is a header, the number of decisions, the index and number
+// of children of each, and a checksum over all of that.
+bool ScheduleCache::lookup(Path *result) const {
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        aslog(1) << "Schedule cache " << path << " does not exist yet\n";
+        return false;
+    }
+    std::string data((std::istreambuf_iterator<char>(f)), std::istreambuf_iterator<char>());
+
+    size_t pos = sizeof(schedule_cache_magic);
+    uint32_t num_decisions = 0;
+    if (data.size() < pos || memcmp(data.data(), schedule_cache_magic, pos) != 0 ||
+        !read_pod(data, pos, &num_decisions)) {
+        aslog(1) << "Ignoring schedule cache " << path << " with a bad header\n";
+        return false;
+    }
+    Path p(num_decisions);
+    for (auto &step : p) {
+        if (!read_pod(data, pos, &step.first) || !read_pod(data, pos, &step.second)) {
+            aslog(1) << "Ignoring truncated schedule cache " << path << "\n";
+            return false;
+        }
+    }
+    uint64_t checksum = 0;
+    const size_t end = pos;
+    if (!read_pod(data, pos, &checksum) || checksum != fnv1a(data.data(), end)) {
+        aslog(1) << "Ignoring schedule cache " << path << " with a bad checksum\n";
+        return false;
+    }
+    *result = std::move(p);
+    aslog(1) << "Loaded a schedule from schedule cache " << path << "\n";
+    return true;
+}
+
+void ScheduleCache::insert(const Path &p) const {
+    std::string data(schedule_cache_magic, sizeof(schedule_cache_magic));
+    append_pod<uint32_t>(data, (uint32_t)p.size());
+    for (const auto &step : p) {
+        append_pod<int32_t>(data, step.first);
+        append_pod<int32_t>(data, step.second);
+    }
+    append_pod<uint64_t>(data, fnv1a(data.data(), data.size()));
+
+    // Write to a temporary file and rename it into place, so that
+    // other processes never see a partly written file.
+    const std::string tmp = path + ".tmp";
+    std::ofstream f(tmp, std::ios::binary | std::ios::trunc);
+    f.write(data.data(), data.size());
+    f.close();
+    if (f.fail() || std::rename(tmp.c_str(), path.c_str()) != 0) {
+        aslog(1) << "Failed to write schedule cache " << path << "\n";
+        std::remove(tmp.c_str());
+        return;
+    }
+    aslog(1) << "Saved the schedule to schedule cache " << path << "\n";
 }
 
 }  // namespace Autoscheduler
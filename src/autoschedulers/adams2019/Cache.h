@@ -8,6 +8,13 @@
 #include "Halide.h"
 #include "LoopNest.h"
 #include "PerfectHashMap.h"
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace Halide {
 namespace Internal {
@@ -64,9 +71,34 @@ namespace Autoscheduler {
     Cache::add_memoized_blocks below (and in Cache.cpp).
     Additionally, if a tiling has not been cached, and it is not pruned, then the tiling will be
     cached using Cache::memoize_blocks (see below and in Cache.cpp).
+
+  - PersistentFeatureCache
+    An optional on-disk cache of the featurizations of whole States, which persists across
+    runs of the autoscheduler (e.g. in an autotuning loop). There is one file per pipeline,
+    named by a hash of the FunctionDAG, the target, and the parallelism, and each entry is
+    keyed by a hash of the complete structure of a State's loop nest. When an entry is found,
+    State::compute_featurization skips featurizing the State altogether. The LoopNest feature
+    caches above can't be reused across runs, as they are keyed by the identity of LoopNest
+    objects and the producers stored at root, rather than by anything that can be stored.
+
+  - ScheduleCache
+    An optional on-disk cache of the schedules found for whole pipelines. There is one file
+    per pipeline, named by a hash of the FunctionDAG, the target, the search parameters, and
+    the estimates rounded to powers of two. The file holds the path to the schedule, as the
+    index of the child taken at each decision. On a hit, the path is followed from the
+    initial State without the cost model, and the search is skipped. If the path doesn't fit
+    (the estimates differ enough to change the choices at some decision), the search runs as
+    usual and the file is replaced.
+
+  - Cache::commit_deferred_blocks
+    When the states of a beam are expanded on several threads, the blocks memoized by each
+    state are held back until the whole beam has been expanded, and then added to the cache
+    in the order the states would have been expanded serially. This keeps the cache unchanged
+    while other threads are reading it, and keeps the search deterministic.
 */
 
 struct State;
+class PersistentFeatureCache;
 
 /*
 Object stores caching options for autoscheduling.
@@ -77,6 +109,10 @@ struct CachingOptions {
     bool cache_blocks = false;
     bool cache_features = false;
 
+    // If not null, featurizations of States are looked up in and
+    // added to this.
+    PersistentFeatureCache *persistent_features = nullptr;
+
     static CachingOptions MakeOptionsFromParams(const Adams2019Params &params) {
         CachingOptions options;
         options.cache_blocks = params.disable_memoized_blocks == 0;
@@ -95,8 +131,20 @@ struct Cache {
     CachingOptions options;
     BlockCache memoized_compute_root_blocks;
 
-    mutable size_t cache_hits = 0;
-    mutable size_t cache_misses = 0;
+    mutable std::atomic<size_t> cache_hits{0};
+    mutable std::atomic<size_t> cache_misses{0};
+
+    // If set, memoize_blocks records new blocks in deferred_blocks
+    // instead of adding them to memoized_compute_root_blocks.
+    bool defer_memoization = false;
+
+    struct DeferredBlocks {
+        const FunctionDAG::Node *node;
+        int vector_dim;
+        std::vector<IntrusivePtr<const LoopNest>> blocks;
+    };
+    std::mutex deferred_mutex;
+    std::map<const State *, std::vector<DeferredBlocks>> deferred_blocks;
 
     Cache() = delete;
     Cache(const CachingOptions &_options, size_t nodes_size)
@@ -120,7 +168,83 @@ struct Cache {
                              CostModel *cost_model) const;
 
     // Generate tilings for a specific vector dimension and memoize them.
-    void memoize_blocks(const FunctionDAG::Node *node, LoopNest *new_root);
+    void memoize_blocks(const State *state, const FunctionDAG::Node *node, LoopNest *new_root);
+
+    // Add the blocks deferred by each of the given states to the
+    // cache, in order, skipping any that a serial search would have
+    // found already memoized.
+    void commit_deferred_blocks(const std::vector<IntrusivePtr<State>> &states);
+};
+
+// A hash of the full structure of a loop nest, which is the same from
+// run to run.
+std::pair<uint64_t, uint64_t> loop_nest_key(const LoopNest &root);
+
+// The featurizations of States, loaded from and saved to a file in a
+// directory, so that they can be shared between runs on the same
+// pipeline. Safe to use from several threads at once.
+class PersistentFeatureCache {
+public:
+    // A hash of the full structure of a loop nest.
+    using Key = std::pair<uint64_t, uint64_t>;
+
+    PersistentFeatureCache(const std::string &dir, const FunctionDAG &dag,
+                           const Target &target, const Adams2019Params &params);
+
+    Key key(const LoopNest &root) const;
+
+    // Fill in the features of the loop nest with the given key and
+    // return true, or return false if it isn't in the cache.
+    bool lookup(const Key &key, StageMap<ScheduleFeatures> *features);
+
+    // Add the features of the loop nest with the given key.
+    void insert(const Key &key, const StageMap<ScheduleFeatures> &features);
+
+    // Append the entries added since the file was loaded to it,
+    // unless it has already reached the size limit.
+    void save();
+
+    std::atomic<size_t> hits{0};
+    std::atomic<size_t> misses{0};
+
+private:
+    struct KeyHash {
+        size_t operator()(const Key &k) const {
+            return (size_t)(k.first ^ k.second);
+        }
+    };
+    using Entry = std::vector<std::pair<int, ScheduleFeatures>>;
+
+    std::string path;
+    std::vector<const FunctionDAG::Node::Stage *> stages_by_id;
+
+    std::mutex mutex;
+    std::unordered_map<Key, Entry, KeyHash> entries;
+    std::vector<Key> new_entries;
+
+    void load();
+};
+
+// The schedule found for a pipeline, saved to a file in a directory,
+// so that later runs on the same pipeline can skip the search.
+class ScheduleCache {
+public:
+    // For each decision, the index of the child taken, and the number
+    // of children there were to choose from.
+    using Path = std::vector<std::pair<int32_t, int32_t>>;
+
+    ScheduleCache(const std::string &dir, const FunctionDAG &dag,
+                  const Target &target, const Adams2019Params &params);
+
+    // Fill in the path to the cached schedule and return true, or
+    // return false if there isn't one.
+    bool lookup(Path *path) const;
+
+    // Save the path to a schedule, replacing any cached before.
+    void insert(const Path &path) const;
+
+private:
+    std::string path;
 };
 
 }  // namespace Autoscheduler
@@ -17,7 +17,9 @@ namespace Autoscheduler {
 typedef PerfectHashMap<FunctionDAG::Node::Stage, ScheduleFeatures> StageMapOfScheduleFeatures;
 
 struct Adams2019Params {
-    /** Maximum level of parallelism available. */
+    /** Maximum level of parallelism available. Unless given explicitly,
+     * this is the core count of the hardware profile, if there is one
+     * (see HardwareProfile.h). */
     int parallelism = 16;
 
     /** Beam size to use in the beam search. Defaults to 32. Use 1 to get a greedy search instead.
@@ -53,6 +55,41 @@ struct Adams2019Params {
     /** If >= 0, only consider schedules that allocate at most this much memory (measured in bytes).
      * Formerly HL_AUTOSCHEDULE_MEMORY_LIMIT */
     int64_t memory_limit = -1;
+
+    /** Number of threads to use to expand the states of the beam and
+     * compute their features. The schedule found doesn't depend on
+     * it. Zero means one thread per core. */
+    int search_threads = 1;
+
+    /** If set to nonzero value: the innermost storage dimension of each
+     * intermediate gets pad_storage, which aligns rows to cache lines
+     * and avoids power-of-two row strides. */
+    int pad_storage = 0;
+
+    /** If set, the featurizations of the states visited are kept in a
+     * file in this directory (which must exist), and reused by later
+     * runs on the same pipeline and target. */
+    std::string feature_cache_dir;
+
+    /** If set, the schedule found for a pipeline is kept in a file in
+     * this directory (which must exist), and later runs on a pipeline
+     * with the same structure, target and parameters, and estimates
+     * that round to the same powers of two, reuse it instead of
+     * searching. */
+    std::string schedule_cache_dir;
+
+    /** If greater than zero, a limit in seconds on the time spent
+     * searching. The search first finds a greedy schedule, and then
+     * searches again with beams four times wider each time, up to
+     * beam_size, keeping the best schedule found, until the time runs
+     * out. The greedy search always runs to completion. */
+    double time_limit = 0;
+
+    /** If set to nonzero value: do a greedy search (as if beam_size
+     * were 1) that also tries only the best way to parallelize each
+     * Func, for when scheduling time matters most, e.g. when JIT
+     * compiling. */
+    int fast_mode = 0;
 };
 
 }  // namespace Autoscheduler
@@ -314,6 +314,11 @@ void DefaultCostModel::load_weights() {
             std::cerr << "The built-in baseline weights should never fail to load\n";
             internal_assert(0);
         }
+        if (gpu && !randomize_weights) {
+            std::cout << "WARNING: the built-in weights were trained on CPU schedules. "
+                      << "Train GPU weights with autotune_loop.sh and pass them in "
+                      << "with autoscheduler.weights_path.\n";
+        }
     } else if (ends_with(weights_in_path, ".weights")) {
         aslog(1) << "Loading weights from " << weights_in_path << " ...\n";
         if (!weights.load_from_file(weights_in_path)) {
@@ -340,12 +345,16 @@ void DefaultCostModel::load_weights() {
                   << "; the weights may be invalid. Using anyway.\n";
     }
 
-    if (!need_randomize && weights.schedule_features_version != ScheduleFeatures::version()) {
+    const uint32_t schedule_features_version =
+        gpu ? ScheduleFeatures::gpu_version() : ScheduleFeatures::version();
+    if (!need_randomize &&
+        !weights_in_path.empty() &&
+        weights.schedule_features_version != schedule_features_version) {
         // Emit to cout (rather than cerr) because the latter is hidden during the autotune loop,
         // and we want this to be seen.
         std::cout << "WARNING: loaded weights have schedule_features_version = "
                   << weights.schedule_features_version
-                  << " but current schedule_features_version is " << ScheduleFeatures::version()
+                  << " but current schedule_features_version is " << schedule_features_version
                   << "; the weights may be invalid. Using anyway.\n";
     }
 
@@ -357,7 +366,7 @@ void DefaultCostModel::load_weights() {
 
     // Update so that any version of this we save will have the current version
     weights.pipeline_features_version = PipelineFeatures::version();
-    weights.schedule_features_version = ScheduleFeatures::version();
+    weights.schedule_features_version = schedule_features_version;
 }
 
 void DefaultCostModel::save_weights() {
@@ -381,8 +390,9 @@ void DefaultCostModel::reset() {
 
 std::unique_ptr<DefaultCostModel> make_default_cost_model(const std::string &weights_in_path,
                                                           const std::string &weights_out_path,
-                                                          bool randomize_weights) {
-    return std::unique_ptr<DefaultCostModel>(new DefaultCostModel(weights_in_path, weights_out_path, randomize_weights));
+                                                          bool randomize_weights,
+                                                          bool gpu) {
+    return std::unique_ptr<DefaultCostModel>(new DefaultCostModel(weights_in_path, weights_out_path, randomize_weights, gpu));
 }
 
 }  // namespace Halide
@@ -22,6 +22,8 @@ private:
 
     const std::string weights_in_path, weights_out_path;
     const bool randomize_weights;
+    // Whether the weights are for schedules featurized for a GPU.
+    const bool gpu;
 
     Runtime::Buffer<float>
         head1_filter_update, head1_bias_update,
@@ -32,10 +34,12 @@ private:
 public:
     DefaultCostModel(const std::string &weights_in_path,
                      const std::string &weights_out_path,
-                     bool randomize_weights)
+                     bool randomize_weights,
+                     bool gpu = false)
         : weights_in_path(weights_in_path),
           weights_out_path(weights_out_path),
-          randomize_weights(randomize_weights) {
+          randomize_weights(randomize_weights),
+          gpu(gpu) {
 
         load_weights();
     }
@@ -69,7 +73,8 @@ public:
 
 std::unique_ptr<DefaultCostModel> make_default_cost_model(const std::string &weights_in_dir = "",
                                                           const std::string &weights_out_dir = "",
-                                                          bool randomize_weights = false);
+                                                          bool randomize_weights = false,
+                                                          bool gpu = false);
 }  // namespace Halide
 
 #endif  // DEFAULT_COST_MODEL_H
@@ -156,7 +156,15 @@ struct PipelineFeatures {
     }
 };
 
-// The schedule-dependent portion of the featurization of a stage
+// The schedule-dependent portion of the featurization of a stage.
+//
+// When scheduling for a GPU the same features are used with a GPU
+// interpretation: the parallel tasks are the GPU blocks, the vector
+// lanes are the threads of a warp, the working set at task level is the
+// shared memory used by a block, and the unique bytes and lines read per
+// task are the global memory traffic into a block. Weights trained on
+// GPU samples are stamped with gpu_version() instead of version(), so
+// that they are not mistaken for CPU weights.
 struct ScheduleFeatures {
     static constexpr size_t num_features() {
         return sizeof(ScheduleFeatures) / sizeof(double);
@@ -166,6 +174,10 @@ struct ScheduleFeatures {
         return 3;
     }
 
+    static constexpr uint32_t gpu_version() {
+        return version() | 0x100;
+    }
+
     double &operator[](int idx) {
         return ((double *)(this))[idx];
     }
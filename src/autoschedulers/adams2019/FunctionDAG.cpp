@@ -379,6 +379,7 @@ void BoundContents::Layout::allocate_some_more() const {
 }
 
 BoundContents *BoundContents::Layout::make() const {
+    std::lock_guard<std::mutex> lock(mutex);
     if (pool.empty()) {
         allocate_some_more();
     }
@@ -391,6 +392,7 @@ BoundContents *BoundContents::Layout::make() const {
 void BoundContents::Layout::release(const BoundContents *b) const {
     internal_assert(b->layout == this) << "Releasing BoundContents onto the wrong pool!";
     b->~BoundContents();
+    std::lock_guard<std::mutex> lock(mutex);
     pool.push_back(const_cast<BoundContents *>(b));
     num_live--;
 }
@@ -574,6 +576,7 @@ bool depends_on_estimate(const Expr &expr) {
 
 FunctionDAG::FunctionDAG(const vector<Function> &outputs, const Target &target) {
     map<string, Function> env = build_environment(outputs);
+    gpu = target.has_gpu_feature();
 
     // A mutator to apply parameter estimates to the expressions
     // we encounter while constructing the graph.
@@ -857,7 +860,13 @@ FunctionDAG::FunctionDAG(const vector<Function> &outputs, const Target &target)
                 node.bytes_per_point = bytes_per_point;
             }
 
-            stage.vector_size = target.natural_vector_size(checker.narrowest_type);
+            if (target.has_gpu_feature()) {
+                // The lanes of a "vector" on a GPU are the threads of
+                // a warp.
+                stage.vector_size = gpu_warp_size;
+            } else {
+                stage.vector_size = target.natural_vector_size(checker.narrowest_type);
+            }
 
             if (s == 0) {
                 node.vector_size = stage.vector_size;
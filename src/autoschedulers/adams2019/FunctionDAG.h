@@ -8,6 +8,7 @@
 #include <algorithm>
 #include <cstdint>
 #include <map>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -29,6 +30,13 @@ using std::vector;
 
 struct Adams2019Params;
 
+// The number of threads in a GPU warp, which is the vector size used
+// when scheduling for a GPU.
+const int gpu_warp_size = 32;
+
+// The shared memory available to one GPU block, in bytes.
+const int64_t gpu_shared_memory_limit = 48 * 1024;
+
 // First we have various utility classes.
 
 // An optional rational type used when analyzing memory dependencies.
@@ -319,9 +327,11 @@ struct BoundContents {
     // We're frequently going to need to make these concrete bounds
     // arrays.  It makes things more efficient if we figure out the
     // memory layout of those data structures once ahead of time, and
-    // make each individual instance just use that. Note that this is
-    // not thread-safe.
+    // make each individual instance just use that. The pool is guarded
+    // by a mutex, as states may be expanded on several threads at once.
     class Layout {
+        mutable std::mutex mutex;
+
         // A memory pool of free BoundContent objects with this layout
         mutable std::vector<BoundContents *> pool;
 
@@ -563,6 +573,11 @@ struct FunctionDAG {
     vector<Node> nodes;
     vector<Edge> edges;
 
+    // Are we scheduling for a GPU? If so, the parallel tasks of a
+    // compute_root stage become GPU blocks and its SIMD lanes become
+    // the GPU threads of a warp (see LoopNest::apply).
+    bool gpu = false;
+
     // Create the function DAG, and do all the dependency and cost
     // analysis. This is done once up-front before the tree search.
     FunctionDAG(const vector<Function> &outputs, const Target &target);
@@ -113,7 +113,6 @@ void LoopNest::copy_from(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -121,6 +120,8 @@ void LoopNest::copy_from(const LoopNest &n) {
     parallel = n.parallel;
     vector_dim = n.vector_dim;
     vectorized_loop_index = n.vectorized_loop_index;
+    std::lock_guard<std::mutex> lock(n.cache_mutex);
+    bounds = n.bounds;
 };
 
 // Hash the loop structure and sizes up to a fixed depth. This is
@@ -309,22 +310,35 @@ void LoopNest::compute_features(const FunctionDAG &dag,
     }
 
     if (is_root()) {
+        // Features computed for a child are only added to its cache
+        // once they are complete (see below), as other threads may be
+        // reading the cache of the same child.
+        std::vector<std::unique_ptr<StageMap<ScheduleFeatures>>> new_cache_entries(children.size());
+
         // TODO: This block of code is repeated below. Refactor
-        for (const auto &c : children) {
+        for (size_t i = 0; i < children.size(); i++) {
+            const auto &c = children[i];
 
             const uint64_t hash_of_producers = sites.get(c->stage).hash_of_producers_stored_at_root;
 
             if (use_cached_features) {
                 // Checks if the features cache has seen this state before, and use the cached features if so.
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    const auto &entry = c->features_cache.at(hash_of_producers);
-
-                    for (auto it = entry.begin(); it != entry.end(); it++) {
-                        const auto *stage_ptr = it.key();
-                        const auto &feat = it.value();
-
-                        features->insert(stage_ptr, feat);
+                bool found = false;
+                {
+                    std::lock_guard<std::mutex> lock(c->cache_mutex);
+                    auto cached = c->features_cache.find(hash_of_producers);
+                    if (cached != c->features_cache.end()) {
+                        const auto &entry = cached->second;
+                        for (auto it = entry.begin(); it != entry.end(); it++) {
+                            const auto *stage_ptr = it.key();
+                            const auto &feat = it.value();
+
+                            features->insert(stage_ptr, feat);
+                        }
+                        found = true;
                     }
+                }
+                if (found) {
 
                     // 'working_set_here' is required below for computing the
                     // root-level features so we compute the value that it
@@ -341,8 +355,9 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 
             if (use_cached_features) {
                 // Cache these features for future reference.
-                c->features_cache[hash_of_producers].make_large(dag.nodes[0].stages[0].max_id);
-                c->memoize_features(c->features_cache[hash_of_producers], features);
+                new_cache_entries[i] = std::make_unique<StageMap<ScheduleFeatures>>();
+                new_cache_entries[i]->make_large(dag.nodes[0].stages[0].max_id);
+                c->memoize_features(*new_cache_entries[i], features);
             }
         }
 
@@ -416,7 +431,8 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         }
 
         if (use_cached_features) {
-            for (const auto &c : children) {
+            for (size_t i = 0; i < children.size(); i++) {
+                const auto &c = children[i];
                 uint64_t hash_of_producers = sites.get(c->stage).hash_of_producers_stored_at_root;
 
                 // When computing feat.points_computed_minimum above, the order
@@ -425,8 +441,14 @@ void LoopNest::compute_features(const FunctionDAG &dag,
                 // may not have been computed when it is accessed as a memoized
                 // feature. We memoize 'points_computed_minimum' here to ensure
                 // its value is always available
-                if (c->features_cache.count(hash_of_producers) > 0) {
-                    c->memoize_points_computed_minimum(c->features_cache[hash_of_producers], features);
+                std::lock_guard<std::mutex> lock(c->cache_mutex);
+                if (new_cache_entries[i]) {
+                    // Does nothing if another thread got there first.
+                    c->features_cache.emplace(hash_of_producers, std::move(*new_cache_entries[i]));
+                }
+                auto cached = c->features_cache.find(hash_of_producers);
+                if (cached != c->features_cache.end()) {
+                    c->memoize_points_computed_minimum(cached->second, features);
                 }
             }
             recompute_inlined_features(sites, features);
@@ -1000,6 +1022,7 @@ void LoopNest::compute_features(const FunctionDAG &dag,
         if (use_cached_features) {
             const auto &block = sites.get(stage).task;
             uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
+            std::lock_guard<std::mutex> lock(block->cache_mutex);
             auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get_or_create(&(f->stages[0]));
             auto &intermediate = intermediate_map.get_or_create(stage);
 
@@ -1014,12 +1037,15 @@ void LoopNest::compute_features(const FunctionDAG &dag,
 // Get the region required of a Func at this site, from which we
 // know what region would be computed if it were scheduled here,
 // and what its loop nest would be.
-const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
-    if (bounds.contains(f)) {
-        const Bound &b = bounds.get(f);
-        // Expensive validation for debugging
-        // b->validate();
-        return b;
+Bound LoopNest::get_bounds(const FunctionDAG::Node *f) const {
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        if (bounds.contains(f)) {
+            const Bound &b = bounds.get(f);
+            // Expensive validation for debugging
+            // b->validate();
+            return b;
+        }
     }
     auto *bound = f->make_bound();
 
@@ -1070,7 +1096,7 @@ const Bound &LoopNest::get_bounds(const FunctionDAG::Node *f) const {
         f->loop_nest_for_region(i, &(bound->region_computed(0)), &(bound->loops(i, 0)));
     }
 
-    const Bound &b = set_bounds(f, bound);
+    Bound b = set_bounds(f, bound);
     // Validation is expensive, turn if off by default.
     // b->validate();
     return b;
@@ -1365,7 +1391,10 @@ IntrusivePtr<const LoopNest> LoopNest::parallelize_in_tiles(const Adams2019Param
     inner->innermost = innermost;
     inner->children = children;
     inner->inlined = inlined;
-    inner->bounds = bounds;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        inner->bounds = bounds;
+    }
     inner->store_at = store_at;
 
     auto *b = inner->get_bounds(node)->make_copy();
@@ -1539,7 +1568,10 @@ vector<IntrusivePtr<const LoopNest>> LoopNest::compute_in_tiles(const FunctionDA
             inner->innermost = innermost;
             inner->children = children;
             inner->inlined = inlined;
-            inner->bounds = bounds;
+            {
+                std::lock_guard<std::mutex> lock(cache_mutex);
+                inner->bounds = bounds;
+            }
             inner->store_at = store_at;
 
             {
@@ -1663,11 +1695,12 @@ void LoopNest::apply(LoopLevel here,
                      double num_cores,
                      int depth,
                      const LoopNest *parent,
-                     const LoopNest *compute_site) const {
+                     const LoopNest *compute_site,
+                     bool in_gpu_blocks) const {
     if (is_root()) {
         for (const auto &c : children) {
             Func(c->node->func).compute_root();
-            c->apply(LoopLevel::root(), state_map, num_cores, 1, this, c.get());
+            c->apply(LoopLevel::root(), state_map, num_cores, 1, this, c.get(), false);
             if (c->stage->index == 0) {
                 auto &state = state_map.get(c->stage);
                 state->schedule_source << "\n    .compute_root()";
@@ -1728,7 +1761,18 @@ void LoopNest::apply(LoopLevel here,
                 const auto &p = parent_bounds->region_computed(i);
                 bytes *= p.extent();
             }
-            if (bytes < 64000 && depth > 2) {
+            if (in_gpu_blocks) {
+                // Everything computed inside the blocks is computed
+                // outside the thread loops, so it's shared by the
+                // block. Use shared memory if it fits.
+                if (bytes <= gpu_shared_memory_limit) {
+                    Func(node->func).store_in(MemoryType::GPUShared);
+                    state.schedule_source << "\n    .store_in(MemoryType::GPUShared)";
+                } else {
+                    Func(node->func).store_in(MemoryType::Heap);
+                    state.schedule_source << "\n    .store_in(MemoryType::Heap)";
+                }
+            } else if (bytes < 64000 && depth > 2) {
                 // If it's probably a small allocation, and it's
                 // made more than once, use stack-scoped
                 // storage. Otherwise let the compiler pick heap
@@ -1767,9 +1811,15 @@ void LoopNest::apply(LoopLevel here,
                     auto &v = state.vars[i];
                     internal_assert(v.innermost_pure_dim && v.exists) << v.var.name() << "\n";
                     // Is the result of a split
-                    state.schedule_source
-                        << "\n    .vectorize(" << v.var.name() << ")";
-                    s.vectorize(v.var);
+                    if (in_gpu_blocks) {
+                        state.schedule_source
+                            << "\n    .gpu_threads(" << v.var.name() << ")";
+                        s.gpu_threads(v.var);
+                    } else {
+                        state.schedule_source
+                            << "\n    .vectorize(" << v.var.name() << ")";
+                        s.vectorize(v.var);
+                    }
                 }
             } else {
                 // Grab the innermost loop for this node
@@ -1855,8 +1905,9 @@ void LoopNest::apply(LoopLevel here,
                     new_inner.push_back(v);
                 }
 
-                if (child->innermost) {
-                    // Maybe do some unrolling
+                if (child->innermost && !in_gpu_blocks) {
+                    // Maybe do some unrolling. Not on a GPU, where the
+                    // inner loop is the thread loop.
 
                     int64_t product_of_pure_loops = 1;
                     bool all_pure_loops_constant_size = true;
@@ -1923,7 +1974,8 @@ void LoopNest::apply(LoopLevel here,
             if (c->node != node) {
                 Func(c->node->func).compute_at(here);
             }
-            c->apply(here, state_map, num_cores, depth + 1, this, compute_site);
+            c->apply(here, state_map, num_cores, depth + 1, this, compute_site,
+                     in_gpu_blocks || (parallel && node->dag->gpu));
             if (c->node != node && c->stage->index == 0) {
                 auto &state = *(state_map.get(c->stage));
                 state.schedule_source << "\n    .compute" << loop_level;
@@ -1950,7 +2002,6 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     children = n.children;
     inlined = n.inlined;
     store_at = n.store_at;
-    bounds = n.bounds;
     node = n.node;
     stage = n.stage;
     innermost = n.innermost;
@@ -1958,6 +2009,8 @@ void LoopNest::copy_from_including_features(const LoopNest &n) {
     parallel = n.parallel;
     vector_dim = n.vector_dim;
     vectorized_loop_index = n.vectorized_loop_index;
+    std::lock_guard<std::mutex> lock(n.cache_mutex);
+    bounds = n.bounds;
     features_cache = n.features_cache;
     feature_intermediates_cache = n.feature_intermediates_cache;
 }
@@ -2033,9 +2086,13 @@ void LoopNest::recompute_inlined_features(const StageMap<Sites> &sites, StageMap
         internal_assert(sites.contains(block->stage));
         uint64_t hash_of_producers = sites.get(block->stage).hash_of_producers_stored_at_root;
 
-        internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
-        auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
-        auto &intermediate = intermediate_map.get(stage);
+        FeatureIntermediates intermediate;
+        {
+            std::lock_guard<std::mutex> lock(block->cache_mutex);
+            internal_assert(block->feature_intermediates_cache.count(hash_of_producers) > 0);
+            auto &intermediate_map = block->feature_intermediates_cache[hash_of_producers].get(&(f->stages[0]));
+            intermediate = intermediate_map.get(stage);
+        }
 
         auto &inlined_feat = features->get(&(f->stages[0]));
         inlined_feat.inlined_calls += intermediate.inlined_calls;
@@ -9,6 +9,7 @@
 #include "FunctionDAG.h"
 #include "PerfectHashMap.h"
 #include <map>
+#include <mutex>
 #include <set>
 #include <utility>
 #include <vector>
@@ -53,6 +54,11 @@ struct LoopNest {
     // little boxes to the left of the loop nest tree figures.
     mutable NodeMap<Bound> bounds;
 
+    // Loop nests are shared between states, which may be expanded on
+    // different threads, so this guards the lazily-filled members:
+    // bounds and the two feature caches below.
+    mutable std::mutex cache_mutex;
+
     // The Func this loop nest belongs to
     const FunctionDAG::Node *node = nullptr;
 
@@ -145,14 +151,16 @@ struct LoopNest {
     }
 
     // Set the region required of a Func at this site.
-    const Bound &set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+    Bound set_bounds(const FunctionDAG::Node *f, BoundContents *b) const {
+        std::lock_guard<std::mutex> lock(cache_mutex);
         return bounds.emplace(f, b);
     }
 
     // Get the region required of a Func at this site, from which we
     // know what region would be computed if it were scheduled here,
-    // and what its loop nest would be.
-    const Bound &get_bounds(const FunctionDAG::Node *f) const;
+    // and what its loop nest would be. Returned by value, as another
+    // thread may add to the bounds map while the caller holds it.
+    Bound get_bounds(const FunctionDAG::Node *f) const;
 
     // Recursively print a loop nest representation to stderr
     void dump(std::ostream &os, string prefix, const LoopNest *parent) const;
@@ -252,13 +260,17 @@ struct LoopNest {
         std::ostringstream schedule_source;
     };
 
-    // Apply the schedule represented by this loop nest to a Halide pipeline.
+    // Apply the schedule represented by this loop nest to a Halide
+    // pipeline. 'in_gpu_blocks' is set if this loop runs inside the GPU
+    // block loops of some compute_root stage, in which case its SIMD
+    // loop becomes the GPU thread loop.
     void apply(LoopLevel here,
                StageMap<std::unique_ptr<StageScheduleState>> &state_map,
                double num_cores,
                int depth,
                const LoopNest *parent,
-               const LoopNest *compute_site) const;
+               const LoopNest *compute_site,
+               bool in_gpu_blocks) const;
 
     // The below are two feature caches.
     // hash of producers -> StageMap
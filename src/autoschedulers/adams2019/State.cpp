@@ -20,6 +20,16 @@ void State::compute_featurization(const FunctionDAG &dag, const Adams2019Params
     sites.make_large(dag.nodes[0].stages[0].max_id);
     features->make_large(dag.nodes[0].stages[0].max_id);
     internal_assert(root.defined());
+
+    PersistentFeatureCache *persistent_features = cache_options.persistent_features;
+    PersistentFeatureCache::Key persistent_key;
+    if (persistent_features) {
+        persistent_key = persistent_features->key(*root);
+        if (persistent_features->lookup(persistent_key, features)) {
+            return;
+        }
+    }
+
     root->get_sites(sites);
 
     // For the input nodes and unscheduled outputs, the compute
@@ -91,6 +101,10 @@ void State::compute_featurization(const FunctionDAG &dag, const Adams2019Params
                 << n.func.name() << "\n";
         }
     }
+
+    if (persistent_features) {
+        persistent_features->insert(persistent_key, *features);
+    }
 }
 
 void State::save_featurization(const FunctionDAG &dag, const Adams2019Params &params,
@@ -448,10 +462,11 @@ void State::generate_children(const FunctionDAG &dag,
                     }
                 }
 
-                // Filter out the less useful options
+                // Filter out the less useful options. A GPU can have
+                // many more blocks in flight than a CPU has tasks.
                 bool ok =
                     ((o.entire || min_total >= params.parallelism) &&
-                     (max_total <= params.parallelism * 16));
+                     (dag.gpu || max_total <= params.parallelism * 16));
 
                 if (!ok) {
                     continue;
@@ -473,9 +488,10 @@ void State::generate_children(const FunctionDAG &dag,
             }
 
             for (const auto &o : options) {
-                if (num_children >= 1 && (o.idle_core_wastage > 1.2 || params.disable_subtiling)) {
+                if (num_children >= 1 && (o.idle_core_wastage > 1.2 || params.disable_subtiling || params.fast_mode)) {
                     // We have considered several options, and the
-                    // remaining ones leave lots of cores idle.
+                    // remaining ones leave lots of cores idle. A fast
+                    // search only considers the best one.
                     break;
                 }
 
@@ -514,7 +530,7 @@ void State::generate_children(const FunctionDAG &dag,
                     num_children++;
                     accept_child(std::move(child));
                     // Will early return if block caching is not enabled.
-                    cache->memoize_blocks(node, new_root);
+                    cache->memoize_blocks(this, node, new_root);
                 }
             }
         }
@@ -540,7 +556,7 @@ void State::dump(std::ostream &os) const {
 // user to copy-paste to freeze this schedule as permanent artifact.
 void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params) {
     StageMap<std::unique_ptr<LoopNest::StageScheduleState>> state_map;
-    root->apply(LoopLevel::root(), state_map, params.parallelism, 0, nullptr, nullptr);
+    root->apply(LoopLevel::root(), state_map, params.parallelism, 0, nullptr, nullptr, false);
 
     std::ostringstream src;
 
@@ -631,7 +647,26 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
         // Halide doesn't let you fuse an RVar with a Var, even if
         // they are both pure.
         bool can_fuse = !(any_parallel_vars && any_parallel_rvars);
-        if (can_fuse) {
+        if (dag.gpu && !parallel_vars.empty()) {
+            // The parallel loops become the GPU block loops. There can
+            // be at most three of them, so fuse where we can.
+            if (can_fuse) {
+                for (size_t i = 1; i < parallel_vars.size(); i++) {
+                    p.second->schedule_source << "\n    .fuse(" << parallel_vars[i].name()
+                                              << ", " << parallel_vars[i - 1].name()
+                                              << ", " << parallel_vars[i].name() << ")";
+                    stage.fuse(parallel_vars[i], parallel_vars[i - 1], parallel_vars[i]);
+                }
+                parallel_vars.erase(parallel_vars.begin(), parallel_vars.end() - 1);
+            } else if (parallel_vars.size() > 3) {
+                // The outer ones stay serial loops on the host.
+                parallel_vars.erase(parallel_vars.begin(), parallel_vars.end() - 3);
+            }
+            for (const auto &v : parallel_vars) {
+                p.second->schedule_source << "\n    .gpu_blocks(" << v.name() << ")";
+                stage.gpu_blocks(v);
+            }
+        } else if (can_fuse) {
             for (size_t i = 1; i < parallel_vars.size(); i++) {
                 // Outermost, and next outermost. Preserve the inner
                 // name to not invalidate any compute_ats.
@@ -670,6 +705,15 @@ void State::apply_schedule(const FunctionDAG &dag, const Adams2019Params &params
             Func(p.first->node->func).reorder_storage(storage_vars);
         }
 
+        // Pad the rows of intermediates to cache lines, and away from
+        // power-of-two strides.
+        if (params.pad_storage && !dag.gpu && p.first->index == 0 &&
+            !p.first->node->is_output && p.first->node->dimensions > 1) {
+            Var innermost = Func(p.first->node->func).args()[std::max(p.second->vector_dim, 0)];
+            p.second->schedule_source << "\n    .pad_storage(" << innermost.name() << ")";
+            Func(p.first->node->func).pad_storage(innermost);
+        }
+
         // Dump the schedule source string
         src << p.first->name
             << p.second->schedule_source.str()
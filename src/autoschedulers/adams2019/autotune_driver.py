@@ -0,0 +1,333 @@
+#!/usr/bin/env python3
+
+# A parallel version of autotune_loop.sh. Random samples of a pipeline's
+# schedule space are compiled in parallel on the local machine, and
+# benchmarked on a pool of workers. A worker is a set of CPUs on the
+# local machine or on a remote machine reachable with ssh, and runs one
+# benchmark at a time, pinned to its CPUs with taskset, so benchmarks
+# never share cores with each other. The cost model is retrained in the
+# background on all the samples seen so far while sampling continues,
+# and each batch is compiled with the latest weights.
+#
+# The samples directory has the same layout as the one written by
+# autotune_loop.sh, so the two can be used interchangeably, and
+# restarted runs continue from where they left off.
+#
+# Example, benchmarking on eight cores of the local machine and eight
+# cores of each of two remote machines:
+#
+#   autotune_driver.py ./bin/demo.generator demo host-cuda baseline.weights \
+#       ./bin /path/to/distrib ./samples \
+#       --worker local:0-7 --worker user@bench1:0-7 --worker user@bench2:0-7
+
+import argparse
+import os
+import platform
+import queue
+import re
+import shlex
+import shutil
+import subprocess
+import sys
+import threading
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+GPU_TARGET_RE = re.compile(r'(cuda|opencl|metal|d3d12compute|vulkan)')
+
+
+def log(*args):
+    print(*args, flush=True)
+
+
+def parse_cpus(spec):
+    """Parse a CPU list in taskset's format (e.g. "0-3,8,10-11")."""
+    cpus = []
+    for part in spec.split(','):
+        if '-' in part:
+            lo, hi = part.split('-')
+            cpus.extend(range(int(lo), int(hi) + 1))
+        elif part:
+            cpus.append(int(part))
+    return cpus
+
+
+class Worker:
+    """A set of CPUs to benchmark on, locally or on a remote host."""
+
+    def __init__(self, spec, scratch_dir):
+        host, _, cpus = spec.rpartition(':')
+        if not host:
+            host, cpus = cpus, ''
+        self.host = None if host == 'local' else host
+        self.cpus = cpus
+        self.num_threads = len(parse_cpus(cpus)) if cpus else os.cpu_count()
+        # Each worker gets its own directory on the remote host, so that
+        # workers sharing a host don't clobber each other's binaries.
+        self.scratch_dir = '%s/%s' % (scratch_dir, re.sub(r'[^A-Za-z0-9]', '_', spec))
+
+    def __str__(self):
+        return '%s:%s' % (self.host or 'local', self.cpus or 'all')
+
+    def command(self, bench, args):
+        cmd = ['env', 'HL_NUM_THREADS=%d' % self.num_threads]
+        if self.cpus and platform.system() != 'Darwin':
+            cmd += ['taskset', '-c', self.cpus]
+        cmd += [bench] + args
+        if self.host:
+            cmd = ['ssh', '-o', 'BatchMode=yes', self.host, ' '.join(shlex.quote(c) for c in cmd)]
+        return cmd
+
+    def run(self, bench, args, timeout):
+        """Run a benchmark binary on this worker, and return its output."""
+        if self.host:
+            remote = '%s/bench' % self.scratch_dir
+            subprocess.run(['ssh', '-o', 'BatchMode=yes', self.host,
+                            'mkdir -p %s' % shlex.quote(self.scratch_dir)],
+                           check=True, timeout=timeout)
+            subprocess.run(['scp', '-q', '-o', 'BatchMode=yes', bench, '%s:%s' % (self.host, remote)],
+                           check=True, timeout=timeout)
+            bench = remote
+        result = subprocess.run(self.command(bench, args), stdout=subprocess.PIPE,
+                                stderr=subprocess.STDOUT, timeout=timeout, check=True)
+        return result.stdout.decode('utf-8', 'replace')
+
+
+class Sample:
+    def __init__(self, batch_id, extra_args_idx, sample_id, batch_dir, pipeline):
+        self.dir = os.path.join(batch_dir, str(sample_id))
+        self.schedule_id = '%04d%04d' % (batch_id, sample_id)
+        self.pipeline_id = extra_args_idx
+        self.fname = '%s_batch_%04d_sample_%04d' % (pipeline, batch_id, sample_id)
+
+
+class Driver:
+    def __init__(self, args):
+        self.args = args
+        self.gpu = bool(GPU_TARGET_RE.search(args.target))
+        self.plugin_ext = 'dylib' if platform.system() == 'Darwin' else 'so'
+        self.feature_cache = os.path.join(args.samples, 'feature_cache')
+        self.weights = os.path.join(args.samples, 'updated.weights')
+        self.weights_lock = threading.Lock()
+        self.bench_queue = queue.Queue()
+        self.workers = [Worker(w, args.remote_dir) for w in args.worker] or [Worker('local', args.remote_dir)]
+        # The number of samples benchmarked since the last retraining,
+        # and whether sampling has finished.
+        self.new_samples = 0
+        self.done = False
+        self.cond = threading.Condition()
+
+    def setup(self):
+        os.makedirs(self.feature_cache, exist_ok=True)
+        if os.path.exists(self.weights):
+            log('Using existing weights', self.weights)
+        else:
+            # Only copy over the weights if we don't have any already,
+            # so that restarted jobs can continue from where they left off
+            shutil.copy(self.args.start_weights, self.weights)
+            log('Copying starting weights from', self.args.start_weights, 'to', self.weights)
+
+    def first_batch(self):
+        # Don't clobber existing samples
+        ids = [int(m.group(1)) for m in
+               (re.match(r'batch_(\d+)_', d) for d in os.listdir(self.args.samples)) if m]
+        return max(ids, default=0) + 1
+
+    def compile_sample(self, sample, weights, extra_generator_args):
+        """Build a single featurization of the pipeline with a random
+        schedule, and a benchmarking binary for it."""
+        a = self.args
+        os.makedirs(sample.dir, exist_ok=True)
+        for ext in ('featurization', 'sample'):
+            path = os.path.join(sample.dir, '%s.%s' % (sample.fname, ext))
+            if os.path.exists(path):
+                os.remove(path)
+        if sample.dir.endswith(os.sep + '0'):
+            # Sample 0 in each batch is best effort beam search, with no randomness
+            beam, dropout = 32, 100
+        else:
+            # The other samples are random probes biased by the cost model
+            beam, dropout = 1, 1
+        cmd = [a.generator, '-g', a.pipeline, '-f', sample.fname, '-o', sample.dir,
+               '-e', 'stmt,assembly,static_library,c_header,registration,schedule,featurization',
+               'target=' + a.target] + extra_generator_args + [
+            '-p', os.path.join(a.autosched_bin, 'libautoschedule_adams2019.' + self.plugin_ext),
+            'autoscheduler=Adams2019',
+            'autoscheduler.parallelism=%d' % a.parallelism,
+            'autoscheduler.beam_size=%d' % beam,
+            'autoscheduler.random_dropout=%d' % dropout,
+            'autoscheduler.random_dropout_seed=' + sample.schedule_id,
+            'autoscheduler.weights_path=' + weights,
+            'autoscheduler.feature_cache_dir=' + self.feature_cache]
+        try:
+            with open(os.path.join(sample.dir, 'compile_log.txt'), 'w') as f:
+                subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=f,
+                               timeout=a.compilation_timeout, check=True)
+            # We don't need image I/O for this purpose,
+            # so leave out libpng and libjpeg
+            objs = [os.path.join(sample.dir, f) for f in os.listdir(sample.dir)
+                    if f.endswith('.registration.cpp') or f.endswith('.a')]
+            subprocess.run(['c++', '-std=c++17',
+                            '-I', os.path.join(a.halide_distrib_path, 'include'),
+                            os.path.join(a.halide_distrib_path, 'tools', 'RunGenMain.cpp')] + objs +
+                           ['-o', os.path.join(sample.dir, 'bench'),
+                            '-DHALIDE_NO_PNG', '-DHALIDE_NO_JPEG', '-ldl', '-lpthread'],
+                           timeout=a.compilation_timeout, check=True)
+        except (subprocess.CalledProcessError, subprocess.TimeoutExpired):
+            log('Compilation failed or timed out for', sample.dir)
+            return
+        self.bench_queue.put(sample)
+
+    def benchmark_loop(self, worker):
+        """Benchmark samples from the queue on one worker, one at a time."""
+        a = self.args
+        while True:
+            sample = self.bench_queue.get()
+            if sample is None:
+                return
+            try:
+                out = worker.run(os.path.join(sample.dir, 'bench'),
+                                 ['--estimate_all', '--benchmarks=all'], a.benchmarking_timeout)
+                with open(os.path.join(sample.dir, 'bench.txt'), 'w') as f:
+                    f.write(out)
+                # Add the runtime, pipeline id, and schedule id to the feature file
+                runtime = out.splitlines()[0].split(' ')[7]
+                subprocess.run([os.path.join(a.autosched_bin, 'featurization_to_sample'),
+                                os.path.join(sample.dir, sample.fname + '.featurization'),
+                                runtime, str(sample.pipeline_id), sample.schedule_id,
+                                os.path.join(sample.dir, sample.fname + '.sample')],
+                               check=True)
+                log('Benchmarked', sample.fname, 'on', worker, ':', runtime)
+            except (subprocess.CalledProcessError, subprocess.TimeoutExpired, IndexError, OSError):
+                log('Benchmarking failed or timed out for', sample.dir, 'on', worker)
+                continue
+            with self.cond:
+                self.new_samples += 1
+                self.cond.notify_all()
+
+    def retrain(self, epochs):
+        a = self.args
+        samples = []
+        for root, _, files in os.walk(a.samples):
+            samples.extend(os.path.join(root, f) for f in files if f.endswith('.sample'))
+        if not samples:
+            return
+        log('Retraining model on', len(samples), 'samples...')
+        # Write to a temporary file, so that compilations starting in
+        # the meantime never see partially-written weights.
+        tmp = self.weights[:-len('.weights')] + '.tmp.weights'
+        cmd = [os.path.join(a.autosched_bin, 'retrain_cost_model'),
+               '--epochs=%d' % epochs,
+               '--rates=' + a.rates,
+               '--num_cores=%d' % a.parallelism,
+               '--initial_weights=' + self.weights,
+               '--weights_out=' + tmp,
+               '--best_benchmark=' + os.path.join(a.samples, 'best.%s.benchmark.txt' % a.pipeline),
+               '--best_schedule=' + os.path.join(a.samples, 'best.%s.schedule.h' % a.pipeline)]
+        if self.gpu:
+            cmd.append('--gpu')
+        result = subprocess.run(cmd, input='\n'.join(samples).encode(), stdout=subprocess.PIPE,
+                                stderr=subprocess.STDOUT)
+        with open(os.path.join(a.samples, 'retrain_log.txt'), 'ab') as f:
+            f.write(result.stdout)
+        if result.returncode != 0:
+            log('Retraining failed, see', os.path.join(a.samples, 'retrain_log.txt'))
+            return
+        with self.weights_lock:
+            os.replace(tmp, self.weights)
+
+    def retrain_loop(self):
+        """Retrain whenever enough new samples have been benchmarked."""
+        while True:
+            with self.cond:
+                while not self.done and self.new_samples < self.args.retrain_interval:
+                    self.cond.wait()
+                if self.done and self.new_samples == 0:
+                    return
+                epochs = self.new_samples
+                self.new_samples = 0
+            self.retrain(epochs)
+
+    def run(self):
+        a = self.args
+        self.setup()
+        log('Training target is:', a.target)
+        log('Benchmarking on', len(self.workers), 'workers:', ', '.join(str(w) for w in self.workers))
+
+        benchmarkers = [threading.Thread(target=self.benchmark_loop, args=(w,)) for w in self.workers]
+        retrainer = threading.Thread(target=self.retrain_loop)
+        for t in benchmarkers + [retrainer]:
+            t.start()
+
+        arg_sets = [s.split(';') if s else [] for s in (a.generator_args_sets or [''])]
+        first = self.first_batch()
+        with ThreadPoolExecutor(max_workers=a.compile_jobs) as compiler:
+            for batch_id in range(first, first + a.num_batches):
+                start = time.time()
+                futures = []
+                for extra_args_idx, extra_args in enumerate(arg_sets):
+                    batch_dir = os.path.join(a.samples, 'batch_%d_%d' % (batch_id, extra_args_idx))
+                    os.makedirs(batch_dir, exist_ok=True)
+                    # Copy the weights being used into the batch folder so that we can repro failures
+                    used = os.path.join(batch_dir, 'used.weights')
+                    with self.weights_lock:
+                        shutil.copy(self.weights, used)
+                    with open(os.path.join(batch_dir, 'extra_generator_args.txt'), 'w') as f:
+                        f.write(' '.join(extra_args) + '\n')
+                    for sample_id in range(a.batch_size):
+                        sample = Sample(batch_id, extra_args_idx, sample_id, batch_dir, a.pipeline)
+                        futures.append(compiler.submit(self.compile_sample, sample, used, extra_args))
+                # Compile the next batch while this one is being
+                # benchmarked, but don't get more than a batch ahead.
+                for f in futures:
+                    f.result()
+                log('Batch', batch_id, 'compiled in %.1f seconds' % (time.time() - start))
+
+        # Finish the benchmarks, then do a final retraining on anything new.
+        for _ in self.workers:
+            self.bench_queue.put(None)
+        for t in benchmarkers:
+            t.join()
+        with self.cond:
+            self.done = True
+            self.cond.notify_all()
+        retrainer.join()
+
+
+def main():
+    default_parallelism = int(os.environ.get('AUTOSCHED_PARALLELISM', '32'))
+    p = argparse.ArgumentParser(description='Autotune the adams2019 cost model on a pipeline.')
+    p.add_argument('generator', help='path to the generator binary')
+    p.add_argument('pipeline', help='the name of the generator to autotune')
+    p.add_argument('target', help='the Halide target to autotune for')
+    p.add_argument('start_weights', help='the weights to start from')
+    p.add_argument('autosched_bin', help='the directory containing the autoscheduler and its tools')
+    p.add_argument('halide_distrib_path', help='the Halide distribution to build benchmarks with')
+    p.add_argument('samples', help='the directory to write samples and weights to')
+    p.add_argument('generator_args_sets', nargs='*',
+                   help='sets of generator args, each a ;-delimited list')
+    p.add_argument('--worker', action='append', default=[],
+                   help='[user@]host:cpus or local:cpus to benchmark on, with cpus in taskset '
+                        'format. May be repeated; CPU sets on one host should be disjoint. '
+                        'Defaults to all of the local machine.')
+    p.add_argument('--remote_dir', default='/tmp/halide_autotune',
+                   help='the scratch directory for benchmarks on remote workers')
+    p.add_argument('--num_batches', type=int, default=1)
+    p.add_argument('--batch_size', type=int, default=32)
+    p.add_argument('--compile_jobs', type=int, default=os.cpu_count(),
+                   help='the number of samples to compile at once')
+    p.add_argument('--parallelism', type=int, default=default_parallelism,
+                   help='the parallelism to schedule and retrain for')
+    p.add_argument('--retrain_interval', type=int, default=8,
+                   help='retrain after this many new samples have been benchmarked')
+    p.add_argument('--rates', default='0.0001')
+    p.add_argument('--compilation_timeout', type=int, default=600)
+    p.add_argument('--benchmarking_timeout', type=int, default=60)
+    args = p.parse_args()
+
+    os.makedirs(args.samples, exist_ok=True)
+    Driver(args).run()
+
+
+if __name__ == '__main__':
+    sys.exit(main())
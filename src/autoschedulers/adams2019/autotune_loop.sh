@@ -3,6 +3,9 @@
 # Build the generator to autotune. This script will be autotuning the
 # autoscheduler's cost model training pipeline, which is large enough
 # to be interesting.
+#
+# See autotune_driver.py for a version that compiles and benchmarks in
+# parallel, optionally on remote machines, and retrains as it goes.
 if [ $# -lt 6 -o $# -gt 8 ]; then
   echo "Usage: $0 /path/to/some.generator generatorname halide_target weights_file autoschedule_bin_dir halide_distrib_path samples_out_path [generator_args_sets]"
   exit
@@ -45,6 +48,19 @@ HL_TARGET=`${AUTOSCHED_BIN}/get_host_target avx512 avx512_knl avx512_skylake avx
 fi
 echo Training target is: ${HL_TARGET}
 
+# The number of cores (or, for a GPU, the number of blocks to keep in
+# flight) to schedule for.
+PARALLELISM=${AUTOSCHED_PARALLELISM:-32}
+
+# GPU targets are featurized differently, so they need their own
+# weights, e.g. a gpu.weights file trained from randomized weights
+# instead of a copy of baseline.weights.
+RETRAIN_GPU_FLAG=
+if [[ ${HL_TARGET} =~ (cuda|opencl|metal|d3d12compute|vulkan) ]]; then
+    echo Training GPU weights
+    RETRAIN_GPU_FLAG=--gpu
+fi
+
 if [ -z ${GENERATOR} ]; then
 GENERATOR=./bin/demo.generator
 fi
@@ -55,6 +71,11 @@ fi
 
 mkdir -p ${SAMPLES}
 
+# Featurizations of the states visited are shared between all the
+# compilations of the pipeline.
+FEATURE_CACHE=${SAMPLES}/feature_cache
+mkdir -p ${FEATURE_CACHE}
+
 WEIGHTS=${SAMPLES}/updated.weights
 if [[ -f ${WEIGHTS} ]]; then
     echo Using existing weights "${WEIGHTS}"
@@ -109,11 +130,12 @@ make_featurization() {
         ${EXTRA_GENERATOR_ARGS} \
         -p ${AUTOSCHED_BIN}/libautoschedule_adams2019.${PLUGIN_EXT} \
         autoscheduler=Adams2019 \
-        autoscheduler.parallelism=32 \
+        autoscheduler.parallelism=${PARALLELISM} \
         autoscheduler.beam_size=${beam} \
         autoscheduler.random_dropout=${dropout} \
         autoscheduler.random_dropout_seed=${SEED} \
         autoscheduler.weights_path=${WEIGHTS} \
+        autoscheduler.feature_cache_dir=${FEATURE_CACHE} \
             2> ${D}/compile_log.txt || echo "Compilation failed or timed out for ${D}"
 
 
@@ -134,7 +156,7 @@ make_featurization() {
 benchmark_sample() {
     sleep 1 # Give CPU clocks a chance to spin back up if we're thermally throttling
     D=${1}
-    HL_NUM_THREADS=32 \
+    HL_NUM_THREADS=${PARALLELISM} \
         ${TIMEOUT_CMD} -k ${BENCHMARKING_TIMEOUT} ${BENCHMARKING_TIMEOUT} \
         ${D}/bench \
         --estimate_all \
@@ -216,7 +238,8 @@ for ((BATCH_ID=$((FIRST+1));BATCH_ID<$((FIRST+1+NUM_BATCHES));BATCH_ID++)); do
             ${AUTOSCHED_BIN}/retrain_cost_model \
                 --epochs=${BATCH_SIZE} \
                 --rates="0.0001" \
-                --num_cores=32 \
+                --num_cores=${PARALLELISM} \
+                ${RETRAIN_GPU_FLAG} \
                 --initial_weights=${WEIGHTS} \
                 --weights_out=${WEIGHTS} \
                 --best_benchmark=${SAMPLES}/best.${PIPELINE}.benchmark.txt \
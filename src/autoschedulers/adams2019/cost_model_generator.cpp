@@ -2,6 +2,7 @@
 // templated such that it can be compiled in either forward or
 // backwards mode, for inference or training respectively.
 
+#include <algorithm>
 #include <utility>
 
 #include "Halide.h"
@@ -125,6 +126,7 @@ public:
     using Output = GeneratorOutput<T>;
     using Generator<CostModel<training>>::using_autoscheduler;
     using Generator<CostModel<training>>::get_pipeline;
+    using Generator<CostModel<training>>::get_target;
 
     // Number of pipeline stages
     Input<int> num_stages{"num_stages", 1};
@@ -489,29 +491,43 @@ public:
         } else {
             // We just write down a good schedule for
             // inference. Scheduling a couple of convs is easy.
+
+            // Use the full width of the target's vectors (e.g. 16
+            // floats with AVX-512), but no fewer than 8, so that
+            // narrower targets such as NEON still get two vectors of
+            // work per instruction sequence to hide latency.
+            const int vec = std::max(8, get_target().natural_vector_size(Float(32)));
+
+            // Each parallel task handles one vector's worth of the
+            // batch, which is what the schedule features are
+            // vectorized across.
             Var no;
-            prediction_output.specialize(batch_size < 8).split(n, no, n, 1);
-            prediction_output.compute_root().split(n, no, n, 8).parallel(no);
+            prediction_output.specialize(batch_size < vec).split(n, no, n, 1);
+            prediction_output.compute_root().split(n, no, n, vec).parallel(no);
             prediction_output.bound(n, 0, batch_size);
 
-            // schedule for the forwards path
-            const int vec = 8;
-
             // A helper function for scheduling conv layers
-            auto schedule_conv = [&](Func conv, Func relu, const RVar &r_channels) {
+            auto schedule_conv = [&](Func conv, Func relu, const RVar &r_channels, int channels) {
+                // Vectorize across the output channels with the widest
+                // vectors that divide them evenly, so that no lanes
+                // are wasted on the padding RoundUp would add.
+                int width = vec;
+                while (width > 8 && channels % width != 0) {
+                    width /= 2;
+                }
                 Var ci, wi;
                 if (!training) {
                     relu
                         .compute_at(prediction_output, n)
                         .store_at(prediction_output, no)
-                        .tile(c, w, ci, wi, vec, 4, TailStrategy::RoundUp)
+                        .tile(c, w, ci, wi, width, 4, TailStrategy::RoundUp)
                         .vectorize(ci);
                     conv.compute_at(relu, c);
                 } else {
                     // In training mode, we need the conv activations pre-relu too
                     conv.in()
                         .compute_root()
-                        .tile(c, w, ci, wi, vec, 1, TailStrategy::RoundUp)
+                        .tile(c, w, ci, wi, width, 1, TailStrategy::RoundUp)
                         .vectorize(ci)
                         .unroll(wi)
                         .parallel(n, 8);
@@ -520,7 +536,7 @@ public:
                         .compute_root()
                         .reorder_storage(c, w, n)
                         .reorder(c, w, n)
-                        .vectorize(c, vec)
+                        .vectorize(c, width)
                         .parallel(n, 8);
                 }
                 conv
@@ -546,12 +562,12 @@ public:
             } else {
                 normalized_schedule_features
                     .compute_root()
-                    .vectorize(n, 8);
+                    .vectorize(n, vec);
             }
 
             // conv+relu layers
-            schedule_conv(head2_conv, head2_relu, r_head2.x);
-            schedule_conv(conv1_stage2, relu1, r1_stage2.x);
+            schedule_conv(head2_conv, head2_relu, r_head2.x, head2_channels);
+            schedule_conv(conv1_stage2, relu1, r1_stage2.x, conv1_channels);
         }
     }
 };
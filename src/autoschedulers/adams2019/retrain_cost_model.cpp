@@ -31,6 +31,7 @@ struct Flags {
     string weights_out_path;
     int num_cores = 32;
     bool randomize_weights = false;
+    bool gpu = false;
     string best_benchmark_path;
     string best_schedule_path;
 
@@ -45,6 +46,7 @@ struct Flags {
         a.add<string>("initial_weights", '\0', kNoDesc, kOptional, "");
         a.add<string>("weights_out");
         a.add<bool>("randomize_weights", '\0', kNoDesc, kOptional, false);
+        a.add<bool>("gpu", '\0', kNoDesc, kOptional, false);
         a.add<int>("num_cores");
         a.add<string>("best_benchmark");
         a.add<string>("best_schedule");
@@ -56,6 +58,7 @@ struct Flags {
         initial_weights_path = a.get<string>("initial_weights");
         weights_out_path = a.get<string>("weights_out");
         randomize_weights = a.exist("randomize_weights") && a.get<bool>("randomize_weights");
+        gpu = a.exist("gpu") && a.get<bool>("gpu");
         best_benchmark_path = a.get<string>("best_benchmark");
         best_schedule_path = a.get<string>("best_schedule");
 
@@ -375,7 +378,7 @@ int main(int argc, char **argv) {
     // Iterate through the pipelines
     vector<std::unique_ptr<DefaultCostModel>> tpp;
     for (int i = 0; i < kModels; i++) {
-        tpp.emplace_back(make_default_cost_model(flags.initial_weights_path, flags.weights_out_path, flags.randomize_weights));
+        tpp.emplace_back(make_default_cost_model(flags.initial_weights_path, flags.weights_out_path, flags.randomize_weights, flags.gpu));
     }
 
     std::cout.setf(std::ios::fixed, std::ios::floatfield);
@@ -0,0 +1,425 @@
+#include "HardwareProfile.h"
+#include "ASLog.h"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#ifdef __APPLE__
+#include <sys/sysctl.h>
+#endif
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Run f(i) on n threads at once, and return how long it took.
+template<typename F>
+double time_on_threads(int n, F f) {
+    std::vector<std::thread> threads;
+    auto start = Clock::now();
+    for (int i = 0; i < n; i++) {
+        threads.emplace_back(f, i);
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    return seconds_since(start);
+}
+
+// Parse a size as written in /sys, e.g. "48K" or "32M".
+int64_t parse_size(const std::string &s) {
+    std::istringstream iss(s);
+    int64_t size = 0;
+    char suffix = 0;
+    iss >> size >> suffix;
+    if (suffix == 'K') {
+        size *= 1024;
+    } else if (suffix == 'M') {
+        size *= 1024 * 1024;
+    }
+    return size;
+}
+
+// Count the CPUs in a list as written in /sys, e.g. "0-15,32-47".
+int count_cpus(const std::string &s) {
+    int count = 0;
+    std::istringstream iss(s);
+    std::string part;
+    while (std::getline(iss, part, ',')) {
+        size_t dash = part.find('-');
+        if (dash == std::string::npos) {
+            count++;
+        } else {
+            count += std::stoi(part.substr(dash + 1)) - std::stoi(part.substr(0, dash)) + 1;
+        }
+    }
+    return count;
+}
+
+std::string read_line(const std::string &path) {
+    std::ifstream f(path);
+    std::string line;
+    std::getline(f, line);
+    return line;
+}
+
+// Ask the operating system for the cache sizes. Leaves the sizes it
+// doesn't know as zero.
+void query_cache_sizes(HardwareProfile *p) {
+#if defined(__linux__)
+    const std::string dir = "/sys/devices/system/cpu/cpu0/cache/";
+    int last_level = 0;
+    for (int i = 0;; i++) {
+        std::string index = dir + "index" + std::to_string(i) + "/";
+        std::string level_str = read_line(index + "level");
+        if (level_str.empty()) {
+            break;
+        }
+        if (read_line(index + "type") == "Instruction") {
+            continue;
+        }
+        int level = std::atoi(level_str.c_str());
+        int64_t size = parse_size(read_line(index + "size"));
+        if (level == 1) {
+            p->l1_cache_size = size;
+        } else if (level == 2) {
+            p->l2_cache_size = size;
+        }
+        if (level >= last_level && size > 0) {
+            // Count every instance of the last level cache on the
+            // machine, e.g. one per socket.
+            int sharing = std::max(1, count_cpus(read_line(index + "shared_cpu_list")));
+            int instances = std::max(1, p->num_cores / sharing);
+            p->last_level_cache_size = size * instances;
+            last_level = level;
+        }
+    }
+#elif defined(__APPLE__)
+    auto query = [](const char *name) -> int64_t {
+        int64_t value = 0;
+        size_t len = sizeof(value);
+        if (sysctlbyname(name, &value, &len, nullptr, 0) != 0) {
+            return 0;
+        }
+        return value;
+    };
+    p->l1_cache_size = query("hw.l1dcachesize");
+    p->l2_cache_size = query("hw.l2cachesize");
+    // Apple silicon has no L3; its L2 is the last level.
+    p->last_level_cache_size = std::max(query("hw.l3cachesize"), p->l2_cache_size);
+#endif
+}
+
+// The average latency in seconds of a dependent load within a working
+// set of the given size.
+double load_latency(int64_t bytes) {
+    // Chase pointers through the cache lines in a random cyclic order,
+    // so that the prefetchers can't help.
+    const size_t line = 64 / sizeof(size_t);
+    size_t n = std::max<size_t>(bytes / 64, 2);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin() + 1, order.end(), std::mt19937(12345));
+    std::vector<size_t> next(n * line);
+    for (size_t i = 0; i < n; i++) {
+        next[order[i] * line] = order[(i + 1) % n] * line;
+    }
+    size_t steps = std::max<size_t>(1 << 22, 4 * n);
+    size_t cur = 0;
+    for (size_t i = 0; i < n; i++) {
+        cur = next[cur];
+    }
+    auto start = Clock::now();
+    for (size_t i = 0; i < steps; i++) {
+        cur = next[cur];
+    }
+    double t = seconds_since(start);
+    volatile size_t sink = cur;
+    (void)sink;
+    return t / steps;
+}
+
+// Find the cache sizes the operating system didn't report from the
+// jumps in load latency as the working set grows.
+void sweep_cache_sizes(HardwareProfile *p) {
+    std::vector<int64_t> sizes;
+    std::vector<double> latency;
+    for (int64_t s = 4 * 1024; s <= 128 * 1024 * 1024; s *= 2) {
+        sizes.push_back(s);
+        latency.push_back(load_latency(s));
+    }
+    const double fastest = latency.front(), slowest = latency.back();
+    int64_t l1 = sizes.front(), l2 = sizes.front(), llc = sizes.front();
+    for (size_t i = 0; i < sizes.size(); i++) {
+        if (latency[i] < 1.5 * fastest) {
+            l1 = sizes[i];
+        }
+        if (latency[i] < 4 * fastest) {
+            l2 = sizes[i];
+        }
+        if (latency[i] < 0.4 * slowest) {
+            llc = sizes[i];
+        }
+    }
+    if (p->l1_cache_size == 0) {
+        p->l1_cache_size = l1;
+    }
+    if (p->l2_cache_size == 0) {
+        p->l2_cache_size = std::min(std::max(l2, l1), llc);
+    }
+    if (p->last_level_cache_size == 0) {
+        p->last_level_cache_size = llc;
+    }
+}
+
+double measure_memory_bandwidth(const HardwareProfile &p) {
+    // Use a working set well beyond the last level cache.
+    const int64_t bytes = std::clamp<int64_t>(4 * p.last_level_cache_size,
+                                              64 * 1024 * 1024, 1024 * 1024 * 1024);
+    const size_t n = bytes / sizeof(uint64_t);
+    std::vector<uint64_t> data(n, 1);
+    std::vector<uint64_t> sums(p.num_cores);
+    const size_t slice = n / p.num_cores;
+    auto sum_slice = [&](int t) {
+        const uint64_t *d = data.data() + t * slice;
+        uint64_t s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+        for (size_t i = 0; i + 3 < slice; i += 4) {
+            s0 += d[i];
+            s1 += d[i + 1];
+            s2 += d[i + 2];
+            s3 += d[i + 3];
+        }
+        sums[t] = s0 + s1 + s2 + s3;
+    };
+    double best = std::numeric_limits<double>::max();
+    for (int pass = 0; pass < 3; pass++) {
+        best = std::min(best, time_on_threads(p.num_cores, sum_slice));
+    }
+    volatile uint64_t sink = std::accumulate(sums.begin(), sums.end(), (uint64_t)0);
+    (void)sink;
+    return (double)(slice * p.num_cores * sizeof(uint64_t)) / best;
+}
+
+double measure_compute_throughput(const HardwareProfile &p) {
+    // Independent multiply-add chains, which the compiler is free to
+    // vectorize, as it would a Halide pipeline.
+    constexpr int chains = 16;
+    constexpr int iterations = 1 << 22;
+    std::vector<float> results(p.num_cores);
+    auto work = [&](int t) {
+        float a[chains];
+        for (int j = 0; j < chains; j++) {
+            a[j] = (float)(j + t);
+        }
+        for (int i = 0; i < iterations; i++) {
+            for (int j = 0; j < chains; j++) {
+                a[j] = a[j] * 0.9999f + 0.0001f;
+            }
+        }
+        results[t] = std::accumulate(a, a + chains, 0.0f);
+    };
+    double best = std::numeric_limits<double>::max();
+    for (int pass = 0; pass < 3; pass++) {
+        best = std::min(best, time_on_threads(p.num_cores, work));
+    }
+    volatile float sink = std::accumulate(results.begin(), results.end(), 0.0f);
+    (void)sink;
+    return 2.0 * chains * iterations * p.num_cores / best;
+}
+
+bool parse(std::istream &in, HardwareProfile *p) {
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+        std::istringstream iss(line);
+        std::string key;
+        iss >> key;
+        if (key == "num_cores") {
+            iss >> p->num_cores;
+        } else if (key == "l1_cache_size") {
+            iss >> p->l1_cache_size;
+        } else if (key == "l2_cache_size") {
+            iss >> p->l2_cache_size;
+        } else if (key == "last_level_cache_size") {
+            iss >> p->last_level_cache_size;
+        } else if (key == "memory_bandwidth") {
+            iss >> p->memory_bandwidth;
+        } else if (key == "compute_throughput") {
+            iss >> p->compute_throughput;
+        }
+        // Unknown keys are ignored, so that profiles saved by newer
+        // versions can still be read.
+        if (iss.fail()) {
+            return false;
+        }
+    }
+    return p->num_cores > 0;
+}
+
+std::string host_name() {
+    std::string name;
+#ifdef _WIN32
+    name = get_env_variable("COMPUTERNAME");
+#else
+    char buf[256] = {0};
+    if (gethostname(buf, sizeof(buf) - 1) == 0) {
+        name = buf;
+    }
+#endif
+    for (char &c : name) {
+        if (!std::isalnum((unsigned char)c) && c != '-' && c != '.') {
+            c = '_';
+        }
+    }
+    return name.empty() ? "unknown" : name;
+}
+
+std::string cache_dir() {
+    std::string dir = get_env_variable("HL_HARDWARE_PROFILE_CACHE_DIR");
+    if (!dir.empty()) {
+        return dir;
+    }
+    dir = get_env_variable("XDG_CACHE_HOME");
+    if (dir.empty()) {
+        dir = get_env_variable("HOME");
+        if (dir.empty()) {
+            return "";
+        }
+        dir += "/.cache";
+    }
+    return dir + "/halide";
+}
+
+}  // namespace
+
+double HardwareProfile::balance() const {
+    if (memory_bandwidth <= 0 || compute_throughput <= 0) {
+        return 0;
+    }
+    return compute_throughput / (memory_bandwidth / 4);
+}
+
+HardwareProfile HardwareProfile::probe() {
+    HardwareProfile p;
+    p.num_cores = std::max(1u, std::thread::hardware_concurrency());
+    query_cache_sizes(&p);
+    if (p.l1_cache_size == 0 || p.l2_cache_size == 0 || p.last_level_cache_size == 0) {
+        sweep_cache_sizes(&p);
+    }
+    p.memory_bandwidth = measure_memory_bandwidth(p);
+    p.compute_throughput = measure_compute_throughput(p);
+    return p;
+}
+
+HardwareProfile HardwareProfile::host() {
+    static std::mutex lock;
+    static bool known = false;
+    static HardwareProfile profile;
+
+    std::lock_guard<std::mutex> guard(lock);
+    if (known) {
+        return profile;
+    }
+
+    std::string dir = cache_dir();
+    std::string path = dir.empty() ? "" : dir + "/hardware_profile." + host_name() + ".txt";
+    if (!path.empty()) {
+        std::ifstream f(path);
+        HardwareProfile cached;
+        if (f && parse(f, &cached)) {
+            aslog(1) << "Using the hardware profile in " << path << "\n";
+            profile = cached;
+            known = true;
+            return profile;
+        }
+    }
+
+    aslog(1) << "Probing the host hardware...\n";
+    profile = probe();
+    known = true;
+    aslog(1) << profile;
+    if (!path.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        // Write to a temporary file first, so that processes probing
+        // at the same time never read a partial profile.
+        std::string tmp = path + ".tmp" + std::to_string(Clock::now().time_since_epoch().count());
+        if (profile.save(tmp)) {
+            std::filesystem::rename(tmp, path, ec);
+        }
+        std::filesystem::remove(tmp, ec);
+    }
+    return profile;
+}
+
+HardwareProfile HardwareProfile::load(const std::string &path) {
+    std::ifstream f(path);
+    user_assert(f) << "Unable to open hardware profile " << path << "\n";
+    HardwareProfile p;
+    user_assert(parse(f, &p)) << "Unable to parse hardware profile " << path << "\n";
+    return p;
+}
+
+bool HardwareProfile::save(const std::string &path) const {
+    std::ofstream f(path);
+    f << *this;
+    f.close();
+    return !f.fail();
+}
+
+bool HardwareProfile::find(const std::string &spec, const Target &target, HardwareProfile *profile) {
+    std::string s = spec.empty() ? get_env_variable("HL_HARDWARE_PROFILE") : spec;
+    if (s == "none") {
+        return false;
+    }
+    if (s.empty()) {
+        const Target host_target = get_host_target();
+        if (target.has_gpu_feature() ||
+            target.arch != host_target.arch ||
+            target.bits != host_target.bits ||
+            target.os != host_target.os) {
+            return false;
+        }
+        s = "host";
+    }
+    *profile = (s == "host") ? host() : load(s);
+    return true;
+}
+
+std::ostream &operator<<(std::ostream &stream, const HardwareProfile &p) {
+    stream << "# Halide hardware profile\n"
+           << "num_cores " << p.num_cores << "\n"
+           << "l1_cache_size " << p.l1_cache_size << "\n"
+           << "l2_cache_size " << p.l2_cache_size << "\n"
+           << "last_level_cache_size " << p.last_level_cache_size << "\n"
+           << "memory_bandwidth " << p.memory_bandwidth << "\n"
+           << "compute_throughput " << p.compute_throughput << "\n";
+    return stream;
+}
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
@@ -0,0 +1,80 @@
+#ifndef HARDWARE_PROFILE_H
+#define HARDWARE_PROFILE_H
+
+#include "Halide.h"
+
+#include <cstdint>
+#include <string>
+
+namespace Halide {
+namespace Internal {
+namespace Autoscheduler {
+
+// A description of the machine a pipeline will run on, used to pick
+// the machine parameters of the autoschedulers. It is either measured
+// on the host (see probe()) or read from a file saved on the machine
+// the pipeline will eventually run on.
+struct HardwareProfile {
+    // The number of hardware threads.
+    int num_cores = 0;
+
+    // Cache sizes in bytes. The L1 and L2 sizes are per core. The last
+    // level cache size is the total over the machine, e.g. over all its
+    // sockets.
+    int64_t l1_cache_size = 0;
+    int64_t l2_cache_size = 0;
+    int64_t last_level_cache_size = 0;
+
+    // Main memory read bandwidth using all cores, in bytes per second.
+    double memory_bandwidth = 0;
+
+    // Single-precision arithmetic throughput using all cores, in
+    // operations per second.
+    double compute_throughput = 0;
+
+    // How many arithmetic operations can be done in the time it takes
+    // to load one four-byte value from memory.
+    double balance() const;
+
+    // Measure the host with microbenchmarks. Cache sizes are taken from
+    // the operating system where it reports them, and found with a
+    // pointer-chasing latency sweep otherwise. Takes a few hundred
+    // milliseconds.
+    static HardwareProfile probe();
+
+    // Return the profile of the host, reading it from the per-host
+    // cache (in $HL_HARDWARE_PROFILE_CACHE_DIR, or ~/.cache/halide by
+    // default) if it has been measured before, and probing and caching
+    // it otherwise.
+    static HardwareProfile host();
+
+    // Read and write the text format of a saved profile. load() fails
+    // with a user_error if the file can't be parsed.
+    static HardwareProfile load(const std::string &path);
+    bool save(const std::string &path) const;
+
+    // Find the profile an autoscheduler should use for the given
+    // target. 'spec' is the value of the autoscheduler's
+    // hardware_profile parameter, or empty if it was not given, in
+    // which case $HL_HARDWARE_PROFILE is used instead. It may be:
+    //
+    // - "none", for no profile.
+    // - "host", for the profile of the host.
+    // - The path of a saved profile. To cross-compile, run the
+    //   autoscheduler once on the machine the pipeline will run on,
+    //   copy its cached profile, and pass the copy to the generator as
+    //   autoscheduler.hardware_profile=<path>.
+    //
+    // If neither is set, the host's profile is used when compiling for
+    // the host's CPU, and there is no profile otherwise. Returns false
+    // if there is no profile.
+    static bool find(const std::string &spec, const Target &target, HardwareProfile *profile);
+};
+
+std::ostream &operator<<(std::ostream &stream, const HardwareProfile &profile);
+
+}  // namespace Autoscheduler
+}  // namespace Internal
+}  // namespace Halide
+
+#endif  // HARDWARE_PROFILE_H
@@ -12,6 +12,11 @@ namespace {
 struct GradientAutoschedulerParams {
     /** Maximum level of parallelism available. */
     int parallelism = 16;
+
+    /** The number of bytes the compute_root Funcs of the pipeline may
+     * use in total, or -1 for no limit. When the Funcs would use more,
+     * some are recomputed where they are used instead of stored. */
+    int64_t memory_budget = -1;
 };
 
 std::map<std::string, Box> inference_bounds(const std::vector<Function> &functions,
@@ -819,6 +824,94 @@ void apply_schedule(const GradientAutoschedulerParams &params,
     schedule_source << ";\n";
 }
 
+// The number of bytes needed to store a Func over the given bounds.
+int64_t footprint(const Function &func, const std::vector<int> &bounds) {
+    int64_t bytes = 0;
+    for (const Type &t : func.output_types()) {
+        bytes += t.bytes();
+    }
+    for (int b : bounds) {
+        bytes *= b;
+    }
+    return bytes;
+}
+
+// Choose which Funcs to recompute at each use - rather than store at
+// root - so that the storage of the rest fits in the memory budget.
+// This is the checkpointing tradeoff of reverse-mode differentiation:
+// the backward pass of a long chain keeps every forward and adjoint
+// intermediate alive, and recomputing the cheap ones from the stored
+// ones frees their storage. Only pure Funcs can be recomputed. The
+// outputs of the pipeline (e.g. the gradients with respect to several
+// parameters) share one budget.
+std::set<std::string> choose_recomputed_funcs(const std::vector<Function> &outputs,
+                                              const std::vector<std::string> &order,
+                                              const std::map<std::string, Function> &env,
+                                              const std::map<std::string, Box> &func_bounds,
+                                              int64_t memory_budget) {
+    std::set<std::string> output_set;
+    for (const auto &output : outputs) {
+        output_set.insert(output.name());
+    }
+
+    // The Funcs that call each one.
+    std::map<std::string, std::vector<std::string>> consumers;
+    for (const auto &name : order) {
+        for (const auto &it : find_direct_calls(env.at(name))) {
+            consumers[it.first].push_back(name);
+        }
+    }
+
+    struct Candidate {
+        std::string name;
+        int64_t bytes;
+        size_t num_consumers;
+    };
+    std::vector<Candidate> candidates;
+    int64_t total = 0;
+    for (const auto &name : order) {
+        const Function &f = env.at(name);
+        int64_t bytes = footprint(f, get_int_bounds(func_bounds.at(name)));
+        total += bytes;
+        if (output_set.count(name) ||
+            f.has_update_definition() ||
+            f.has_extern_definition() ||
+            f.dimensions() == 0) {
+            continue;
+        }
+        bool called_by_extern = false;
+        for (const auto &c : consumers[name]) {
+            called_by_extern |= env.at(c).has_extern_definition();
+        }
+        if (!called_by_extern) {
+            candidates.push_back({name, bytes, consumers[name].size()});
+        }
+    }
+
+    // Recompute the Funcs that free the most memory per consumer first,
+    // since each consumer recomputes them.
+    std::sort(candidates.begin(), candidates.end(),
+              [](const Candidate &a, const Candidate &b) {
+                  return a.bytes * b.num_consumers > b.bytes * a.num_consumers;
+              });
+    std::set<std::string> recomputed;
+    for (const auto &c : candidates) {
+        if (total <= memory_budget) {
+            break;
+        }
+        recomputed.insert(c.name);
+        total -= c.bytes;
+        debug(1) << "[gradient_autoscheduler] Recomputing " << c.name
+                 << " to save " << c.bytes << " bytes\n";
+    }
+    if (total > memory_budget) {
+        user_warning << "The Funcs that must be stored need " << total
+                     << " bytes, which is over the memory budget of "
+                     << memory_budget << " bytes.\n";
+    }
+    return recomputed;
+}
+
 }  // namespace
 
 void generate_schedule(const std::vector<Function> &outputs,
@@ -908,11 +1001,21 @@ void generate_schedule(const std::vector<Function> &outputs,
         output_set.insert(output.name());
     }
 
+    std::set<std::string> recomputed;
+    if (params.memory_budget >= 0) {
+        recomputed = choose_recomputed_funcs(outputs, order, env, func_bounds, params.memory_budget);
+    }
+
     std::ostringstream schedule_source;
     // Traverse from the consumers to the producers
     for (auto it = order.rbegin(); it != order.rend(); it++) {
         Func func(env[*it]);
         debug(1) << "[gradient_autoscheduler] Processing function:" << *it << "\n";
+        if (recomputed.count(*it)) {
+            // Inlined Funcs are recomputed at each use.
+            schedule_source << func.name() << ".compute_inline();\n";
+            continue;
+        }
         // Get the bounds in integer constant by substitute all the parameters' estimates.
         Box bounds = func_bounds[*it];
         std::vector<int> int_bounds = get_int_bounds(bounds);
@@ -941,6 +1044,7 @@ struct Li2018 {
         {
             ParamParser parser(params_in.extra);
             parser.parse("parallelism", &params.parallelism);
+            parser.parse("memory_budget", &params.memory_budget);
             parser.finish();
         }
         generate_schedule(outputs, target, params, results);
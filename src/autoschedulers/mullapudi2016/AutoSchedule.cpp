@@ -1,12 +1,14 @@
 #include "HalidePlugin.h"
 
 #include <algorithm>
+#include <functional>
 #include <map>
 #include <regex>
 #include <set>
 #include <utility>
 
 #include "Halide.h"
+#include "HardwareProfile.h"
 #include "ParamParser.h"
 
 namespace Halide {
@@ -23,6 +25,9 @@ using std::vector;
 namespace {
 
 struct ArchParams {
+    // Unless they are given explicitly, the first three are taken from
+    // the hardware profile, if there is one (see HardwareProfile.h).
+
     /** Maximum level of parallelism avalaible. */
     int parallelism = 16;
 
@@ -32,6 +37,30 @@ struct ArchParams {
     /** Indicates how much more expensive is the cost of a load compared to
      * the cost of an arithmetic operation at last level cache. */
     float balance = 40;
+
+    /** Whether to generate a GPU schedule. Set from the target; group
+     * tiles become GPU blocks and the elements of a tile GPU threads. */
+    bool target_is_gpu = false;
+
+    /** The shared memory available to one GPU block (in bytes). Group
+     * intermediates that fit are stored in shared memory. */
+    uint64_t shared_memory_limit = 48 * 1024;
+
+    /** The shared memory available to all resident blocks on one GPU
+     * multiprocessor (in bytes). */
+    uint64_t shared_memory_sm_limit = 96 * 1024;
+
+    /** The maximum number of blocks resident on one GPU multiprocessor. */
+    int active_block_limit = 32;
+
+    /** The maximum number of warps resident on one GPU multiprocessor. */
+    int active_warp_limit = 64;
+
+    /** The number of threads in a warp. */
+    int warp_size = 32;
+
+    /** The maximum number of threads in a GPU block. */
+    int max_threads_per_block = 1024;
 };
 
 // Substitute parameter estimates into the exprs describing the box bounds.
@@ -1137,6 +1166,10 @@ struct Partitioner {
     // that function stage.
     vector<map<string, Expr>> generate_tile_configs(const FStage &stg);
 
+    // Same as \ref Partitioner::generate_tile_configs, but generates tiles
+    // that map onto GPU blocks with one thread per element.
+    vector<map<string, Expr>> generate_gpu_tile_configs(const FStage &stg);
+
     // Find the best tiling configuration for a group 'g' among a set of tile
     // configurations. This returns a pair of configuration with the highest
     // estimated benefit and the estimated benefit.
@@ -1201,6 +1234,45 @@ struct Partitioner {
                                      const set<string> &inlines,
                                      AutoSchedule &sched);
 
+    // Same as \ref Partitioner::generate_cpu_schedule, but maps each group onto
+    // a GPU: tiles of the group output become GPU blocks and the elements of
+    // a tile GPU threads, and the group members are computed per block in
+    // shared memory when they fit.
+    void generate_gpu_schedule(const Target &t, AutoSchedule &sched);
+
+    // Same as \ref Partitioner::generate_gpu_schedule, but this generates and
+    // applies schedules for a group of function stages.
+    void generate_group_gpu_schedule(const Group &g, const Target &t,
+                                     const map<FStage, DimBounds> &group_loop_bounds,
+                                     const map<string, Box> &group_storage_bounds,
+                                     const set<string> &inlines,
+                                     AutoSchedule &sched);
+
+    // Tile the pure dimensions of stage 'f_handle' by 'tile_sizes', and map
+    // the tiles onto GPU blocks and the elements of a tile onto GPU threads.
+    // Return the block dimensions, innermost first, and set 'thread_extents'
+    // to the extents of the thread dimensions.
+    vector<VarOrRVar> gpu_tile_stage(
+        const Group &g, Stage f_handle, int stage_num, Definition def, bool is_group_output,
+        const map<string, Expr> &tile_sizes, set<string> &rvars, map<string, Expr> &estimates,
+        vector<Expr> &thread_extents, AutoSchedule &sched);
+
+    // Map the innermost pure dimensions of a stage computed within a GPU
+    // block onto at most 'thread_extents' GPU threads.
+    void gpu_thread_stage(
+        const Group &g, Stage f_handle, int stage_num, Definition def,
+        const vector<Expr> &thread_extents, set<string> &rvars,
+        map<string, Expr> &estimates, AutoSchedule &sched);
+
+    // Return the tile sizes used on a GPU for a stage that isn't tiled by
+    // the grouping.
+    map<string, Expr> default_gpu_tile_sizes(const Definition &def);
+
+    // Reorder the dimensions of a stage to 'ordering', innermost first, and
+    // append the reorder to 'sched'.
+    void reorder_stage(Stage f_handle, int stage_num, const vector<Dim> &dims,
+                       const vector<VarOrRVar> &ordering, AutoSchedule &sched);
+
     // Split the dimension of stage 'f_handle' along 'v' into inner and outer
     // dimensions. Modify 'estimates' according to the split and append the split
     // schedule to 'sched'.
@@ -1502,7 +1574,65 @@ inline bool operator==(const map<string, Expr> &m1, const map<string, Expr> &m2)
     return true;
 }
 
+vector<map<string, Expr>> Partitioner::generate_gpu_tile_configs(const FStage &stg) {
+    const vector<Dim> &dims = get_stage_dims(stg.func, stg.stage_num);
+
+    // A tile is computed by one GPU block with one thread per element, so
+    // only the innermost three pure dimensions can be tiled by more than
+    // one. The rest are tiled by one, which makes them block (or serial)
+    // loops.
+    vector<string> tile_vars, other_vars;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        if (!dims[d].is_rvar()) {
+            if (tile_vars.size() < 3) {
+                tile_vars.push_back(dims[d].var);
+            } else {
+                other_vars.push_back(dims[d].var);
+            }
+        }
+    }
+
+    vector<map<string, Expr>> tile_configs;
+    if (tile_vars.empty()) {
+        return tile_configs;
+    }
+
+    // The innermost dimension spans at least a warp so that the loads
+    // and stores of a warp are coalesced.
+    const int warp = arch_params.warp_size;
+    vector<vector<int>> size_variants = {{warp, 2 * warp, 4 * warp, 8 * warp},
+                                         {1, 4, 8, 16, 32},
+                                         {1, 4}};
+    vector<int> sizes(tile_vars.size(), 0);
+    std::function<void(size_t, int)> enumerate = [&](size_t i, int threads) {
+        if (i == tile_vars.size()) {
+            map<string, Expr> tiling;
+            for (size_t j = 0; j < tile_vars.size(); j++) {
+                tiling.emplace(tile_vars[j], sizes[j]);
+            }
+            for (const auto &v : other_vars) {
+                tiling.emplace(v, 1);
+            }
+            tile_configs.push_back(tiling);
+            return;
+        }
+        for (int size : size_variants[i]) {
+            if (threads * size <= arch_params.max_threads_per_block) {
+                sizes[i] = size;
+                enumerate(i + 1, threads * size);
+            }
+        }
+    };
+    enumerate(0, 1);
+
+    return tile_configs;
+}
+
 vector<map<string, Expr>> Partitioner::generate_tile_configs(const FStage &stg) {
+    if (arch_params.target_is_gpu) {
+        return generate_gpu_tile_configs(stg);
+    }
+
     // TODO: This is a wart due to the cost model not taking vectorization
     // and pre-fetching into account. Ensuring the innermost dimension has
     // at least size of 64 gives enough values for vectorization and can help
@@ -1612,6 +1742,11 @@ Partitioner::find_best_tile_config(const Group &g) {
     // Generate tiling configurations
     vector<map<string, Expr>> configs = generate_tile_configs(g.output);
 
+    // A GPU stage that isn't tiled can't be mapped onto blocks and threads
+    // as analyzed, so compare against the first tiling that can be analyzed
+    // instead.
+    bool replace_no_tile = arch_params.target_is_gpu;
+
     Group best_group = g;
     for (const auto &config : configs) {
         Group new_group = g;
@@ -1619,6 +1754,14 @@ Partitioner::find_best_tile_config(const Group &g) {
 
         GroupAnalysis new_analysis = analyze_group(new_group, show_analysis);
 
+        if (replace_no_tile && new_analysis.cost.defined()) {
+            replace_no_tile = false;
+            best_config = config;
+            best_analysis = new_analysis;
+            best_group = new_group;
+            continue;
+        }
+
         bool no_redundant_work = false;
         Expr benefit = estimate_benefit(best_analysis, new_analysis,
                                         no_redundant_work, true);
@@ -1971,6 +2114,59 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
 
     // Linear dropoff
     float load_slope = arch_params.balance / arch_params.last_level_cache_size;
+
+    // On a GPU, a tile is computed by one block running one thread per
+    // element of the tile, and the intermediates of the group are stored
+    // in shared memory if they fit.
+    Expr tile_threads = make_one(Int(64));
+    Expr shared_footprint = make_zero(Int(64));
+    Expr coalescing_factor = make_one(Int(64));
+    if (arch_params.target_is_gpu && !g.output.func.has_extern_definition()) {
+        const vector<Dim> &dims = get_stage_dims(g.output.func, g.output.stage_num);
+        Expr inner_extent;
+        for (int d = 0; d < (int)dims.size() - 1; d++) {
+            if (dims[d].is_rvar()) {
+                continue;
+            }
+            const auto &iter = tile_bounds.find(dims[d].var);
+            if (iter == tile_bounds.end()) {
+                continue;
+            }
+            Expr extent = get_extent(iter->second);
+            if (!extent.defined()) {
+                return GroupAnalysis();
+            }
+            tile_threads *= extent;
+            if (!inner_extent.defined()) {
+                inner_extent = extent;
+            }
+        }
+        // Consecutive threads of a warp access consecutive elements of the
+        // innermost storage dimension of the output (see reorder_dims), so
+        // global loads are coalesced to the degree that dimension of the
+        // tile spans a warp.
+        if (!out_tile_extent.empty() && out_tile_extent[0].is_bounded()) {
+            inner_extent = get_extent(out_tile_extent[0]);
+        }
+        if (inner_extent.defined()) {
+            Expr warp = make_const(Int(64), arch_params.warp_size);
+            coalescing_factor = simplify(warp / clamp(cast<int64_t>(inner_extent), make_one(Int(64)), warp));
+        }
+        tile_threads = simplify(min(tile_threads, arch_params.max_threads_per_block));
+
+        for (const auto &reg : alloc_regions) {
+            if ((group_members.find(reg.first) != group_members.end()) &&
+                (reg.first != g.output.func.name()) &&
+                (g.inlined.find(reg.first) == g.inlined.end())) {
+                shared_footprint += costs.region_size(reg.first, reg.second);
+            }
+        }
+        shared_footprint = simplify(shared_footprint);
+    }
+    bool in_shared_memory =
+        arch_params.target_is_gpu &&
+        can_prove(shared_footprint <= make_const(Int(64), arch_params.shared_memory_limit));
+
     for (const auto &f_load : group_load_costs) {
         internal_assert(g.inlined.find(f_load.first) == g.inlined.end())
             << "Intermediates of inlined pure function \"" << f_load.first
@@ -2025,9 +2221,42 @@ Partitioner::GroupAnalysis Partitioner::analyze_group(const Group &g, bool show_
         }
 
         Expr cost_factor = cast<int64_t>(min(1 + footprint * load_slope, arch_params.balance));
+        if (arch_params.target_is_gpu) {
+            if (!is_output && is_group_member) {
+                // Intermediates that don't fit in shared memory spill to
+                // global memory.
+                cost_factor = in_shared_memory ? make_one(Int(64)) : cast<int64_t>(arch_params.balance);
+            } else {
+                cost_factor *= coalescing_factor;
+            }
+        }
         per_tile_cost.memory += cost_factor * f_load.second;
     }
 
+    if (arch_params.target_is_gpu) {
+        // The number of blocks resident on a multiprocessor at once is
+        // limited by their warps and their shared memory. With fewer warps
+        // resident there is less to switch to while waiting on memory, so
+        // scale the memory cost by the inverse of the occupancy.
+        Expr warp = make_const(Int(64), arch_params.warp_size);
+        Expr warp_limit = make_const(Int(64), arch_params.active_warp_limit);
+        Expr warps = (tile_threads + warp - 1) / warp;
+        Expr blocks = min(arch_params.active_block_limit, warp_limit / warps);
+        if (in_shared_memory) {
+            blocks = min(blocks, make_const(Int(64), arch_params.shared_memory_sm_limit) /
+                                     max(shared_footprint, 1));
+        }
+        Expr active_warps = clamp(blocks * warps, make_one(Int(64)), warp_limit);
+        per_tile_cost.memory = simplify(per_tile_cost.memory * warp_limit / active_warps);
+
+        if (show_analysis) {
+            debug(0) << "Threads per tile:" << tile_threads << "\n";
+            debug(0) << "Shared memory per tile:" << shared_footprint
+                     << (in_shared_memory ? "" : " (spills to global memory)") << "\n";
+            debug(0) << "Active warps:" << simplify(active_warps) << "\n";
+        }
+    }
+
     if (show_analysis) {
         debug(0) << "\nDetailed loads:\n";
         for (const auto &f_load : group_load_costs) {
@@ -2898,6 +3127,367 @@ void Partitioner::generate_cpu_schedule(const Target &t, AutoSchedule &sched) {
     }
 }
 
+void Partitioner::reorder_stage(Stage f_handle, int stage_num, const vector<Dim> &dims,
+                                const vector<VarOrRVar> &ordering, AutoSchedule &sched) {
+    if (ordering.size() < 2 || dims == ordering) {
+        return;
+    }
+    set<string> var_list;
+    string var_order = ordering[0].name();
+    for (size_t o = 1; o < ordering.size(); o++) {
+        var_order += ", " + ordering[o].name();
+        var_list.insert(ordering[o].name());
+    }
+    f_handle.reorder(ordering);
+    sched.push_schedule(f_handle.name(), stage_num, "reorder(" + var_order + ")", var_list);
+}
+
+map<string, Expr> Partitioner::default_gpu_tile_sizes(const Definition &def) {
+    // A warp wide and a few warps tall.
+    map<string, Expr> tile_sizes;
+    const vector<Dim> &dims = def.schedule().dims();
+    int num_pure = 0;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        if (dims[d].is_rvar()) {
+            continue;
+        }
+        int size = 1;
+        if (num_pure == 0) {
+            size = arch_params.warp_size;
+        } else if (num_pure == 1) {
+            size = std::max(1, arch_params.max_threads_per_block / (4 * arch_params.warp_size));
+        }
+        tile_sizes.emplace(get_base_name(dims[d].var), size);
+        num_pure++;
+    }
+    return tile_sizes;
+}
+
+vector<VarOrRVar> Partitioner::gpu_tile_stage(
+    const Group &g, Stage f_handle, int stage_num, Definition def, bool is_group_output,
+    const map<string, Expr> &tile_sizes, set<string> &rvars, map<string, Expr> &estimates,
+    vector<Expr> &thread_extents, AutoSchedule &sched) {
+    vector<Dim> &dims = def.schedule().dims();
+
+    vector<string> dim_vars(dims.size() - 1);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        dim_vars[d] = get_base_name(dims[d].var);
+    }
+
+    // Only pure dimensions are tiled, since iterations of a tile run in
+    // parallel. The untiled RVars run serially within each thread.
+    vector<VarOrRVar> serial_dims, thread_dims, outer_dims;
+    for (const auto &var : dim_vars) {
+        bool is_rvar = (rvars.find(var) != rvars.end());
+        VarOrRVar v(var, is_rvar);
+
+        const auto &iter = tile_sizes.find(var);
+        const auto &est = estimates.find(var);
+        bool has_estimate = (est != estimates.end()) && est->second.defined();
+        if (!is_rvar && (iter != tile_sizes.end()) && has_estimate &&
+            can_prove(est->second > iter->second)) {
+            const Expr &tile_size = iter->second;
+            if (can_prove(tile_size == 1)) {
+                outer_dims.push_back(v);
+            } else {
+                pair<VarOrRVar, VarOrRVar> tile_vars =
+                    split_dim(g, f_handle, stage_num, def, is_group_output, v,
+                              tile_size, "_i", "_o", estimates, sched);
+                if (thread_dims.size() < 3) {
+                    thread_dims.push_back(tile_vars.first);
+                } else {
+                    serial_dims.push_back(tile_vars.first);
+                }
+                outer_dims.push_back(tile_vars.second);
+            }
+        } else if (!is_rvar && has_estimate && thread_dims.size() < 3) {
+            thread_dims.push_back(v);
+        } else {
+            serial_dims.push_back(v);
+        }
+    }
+
+    // Thread loops must be inside a block loop.
+    if (outer_dims.empty() && !thread_dims.empty()) {
+        outer_dims.push_back(thread_dims.back());
+        thread_dims.pop_back();
+    }
+
+    vector<VarOrRVar> block_dims;
+    vector<VarOrRVar> ordering = serial_dims;
+    for (const auto &v : thread_dims) {
+        ordering.push_back(v);
+    }
+    for (const auto &v : outer_dims) {
+        if (block_dims.size() < 3) {
+            block_dims.push_back(v);
+        }
+        ordering.push_back(v);
+    }
+    reorder_stage(f_handle, stage_num, dims, ordering, sched);
+
+    thread_extents.clear();
+    for (const auto &v : thread_dims) {
+        f_handle.gpu_threads(v);
+        sched.push_schedule(f_handle.name(), stage_num, "gpu_threads(" + v.name() + ")", {v.name()});
+        thread_extents.push_back(get_element(estimates, v.name()));
+    }
+    for (const auto &v : block_dims) {
+        f_handle.gpu_blocks(v);
+        sched.push_schedule(f_handle.name(), stage_num, "gpu_blocks(" + v.name() + ")", {v.name()});
+    }
+
+    return block_dims;
+}
+
+void Partitioner::gpu_thread_stage(
+    const Group &g, Stage f_handle, int stage_num, Definition def,
+    const vector<Expr> &thread_extents, set<string> &rvars,
+    map<string, Expr> &estimates, AutoSchedule &sched) {
+    vector<Dim> &dims = def.schedule().dims();
+
+    vector<string> dim_vars(dims.size() - 1);
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        dim_vars[d] = get_base_name(dims[d].var);
+    }
+
+    // Use the same threads as the block computing the group output, so
+    // that the block needs no more threads than the output does. Larger
+    // dimensions are split and the remainder runs serially in each thread.
+    vector<VarOrRVar> serial_inner, thread_dims, serial_outer;
+    for (const auto &var : dim_vars) {
+        bool is_rvar = (rvars.find(var) != rvars.end());
+        VarOrRVar v(var, is_rvar);
+
+        const auto &est = estimates.find(var);
+        bool has_estimate = (est != estimates.end()) && est->second.defined();
+        if (is_rvar) {
+            serial_inner.push_back(v);
+        } else if (!has_estimate || thread_dims.size() >= thread_extents.size()) {
+            serial_outer.push_back(v);
+        } else {
+            const Expr &extent = thread_extents[thread_dims.size()];
+            if (can_prove(est->second > extent)) {
+                pair<VarOrRVar, VarOrRVar> split_vars =
+                    split_dim(g, f_handle, stage_num, def, false, v, extent,
+                              "_i", "_o", estimates, sched);
+                thread_dims.push_back(split_vars.first);
+                serial_outer.push_back(split_vars.second);
+            } else {
+                thread_dims.push_back(v);
+            }
+        }
+    }
+
+    vector<VarOrRVar> ordering = serial_inner;
+    for (const auto &v : thread_dims) {
+        ordering.push_back(v);
+    }
+    for (const auto &v : serial_outer) {
+        ordering.push_back(v);
+    }
+    reorder_stage(f_handle, stage_num, dims, ordering, sched);
+
+    for (const auto &v : thread_dims) {
+        f_handle.gpu_threads(v);
+        sched.push_schedule(f_handle.name(), stage_num, "gpu_threads(" + v.name() + ")", {v.name()});
+    }
+}
+
+void Partitioner::generate_group_gpu_schedule(
+    const Group &g, const Target &t,
+    const map<FStage, DimBounds> &group_loop_bounds,
+    const map<string, Box> &group_storage_bounds,
+    const set<string> &inlines,
+    AutoSchedule &sched) {
+    string out_f_name = g.output.func.name();
+    Function g_out = g.output.func;
+
+    debug(3) << "\n================\n"
+             << "Scheduling group:\n"
+             << "================\n"
+             << g;
+
+    if (g.output.func.has_extern_definition()) {
+        internal_assert(g.members.size() == 1);
+        Func(g_out).compute_root();
+        sched.push_schedule(g_out.name(), g.output.stage_num, "compute_root()", {});
+        return;
+    }
+
+    // Get the estimates for stage bounds
+    DimBounds stg_bounds = get_bounds(g.output);
+    map<string, Expr> stg_estimates = bounds_to_estimates(stg_bounds);
+
+    Stage f_handle = Stage(Func(g_out));
+
+    // Get a function handle for scheduling the stage
+    if (g.output.stage_num > 0) {
+        int stage_num = g.output.stage_num;
+        f_handle = Func(g_out).update(stage_num - 1);
+    } else {
+        Func(g_out).compute_root();
+        sched.push_schedule(f_handle.name(), g.output.stage_num, "compute_root()", {});
+    }
+
+    // Get the definition corresponding to the stage
+    Definition def = get_stage_definition(g_out, g.output.stage_num);
+    vector<Dim> &dims = def.schedule().dims();
+
+    // Keep track of the rvars
+    set<string> rvars;
+    for (int d = 0; d < (int)dims.size() - 1; d++) {
+        if (dims[d].is_rvar()) {
+            rvars.insert(get_base_name(dims[d].var));
+        }
+    }
+
+    // Reorder the dimensions so that the smallest stride is innermost,
+    // which puts consecutive threads of a warp on consecutive addresses.
+    if (dims.size() > 2) {
+        map<string, Expr> strides =
+            analyze_spatial_locality(g.output, group_storage_bounds, inlines);
+        if (!strides.empty()) {
+            reorder_dims(f_handle, g.output.stage_num, def, strides, sched);
+        }
+    }
+
+    // The members of an untiled group are computed at root, as in the CPU
+    // schedule, but the output still needs blocks and threads.
+    bool degenerate = g.tile_sizes.empty();
+    map<string, Expr> tile_sizes = degenerate ? default_gpu_tile_sizes(def) : g.tile_sizes;
+
+    vector<Expr> thread_extents;
+    vector<VarOrRVar> block_dims =
+        gpu_tile_stage(g, f_handle, g.output.stage_num, def, true, tile_sizes,
+                       rvars, stg_estimates, thread_extents, sched);
+
+    Expr blocks = 1;
+    for (const auto &v : block_dims) {
+        blocks = simplify(blocks * get_element(stg_estimates, v.name()));
+    }
+    if (can_prove(blocks < arch_params.parallelism)) {
+        user_warning << "Insufficient parallelism for " << f_handle.name() << "\n";
+    }
+
+    // Group members are computed per block, at the innermost block loop.
+    VarOrRVar tile_inner_var(Var::outermost());
+    if (!block_dims.empty()) {
+        tile_inner_var = block_dims[0];
+    }
+
+    // Intermediates are stored in shared memory, in order, until it runs
+    // out. The rest are stored in global memory.
+    Expr shared_used = make_zero(Int(64));
+
+    for (const FStage &mem : g.members) {
+        // Skip member stages that have been inlined or stage that is the
+        // output stage of the group
+        if ((g.inlined.find(mem.func.name()) != g.inlined.end()) ||
+            (mem.func.name() == g_out.name())) {
+            continue;
+        }
+
+        // Get the definition corresponding to the stage
+        Definition mem_def = get_stage_definition(mem.func, mem.stage_num);
+
+        // Get the estimates for the dimensions of the member stage
+        map<string, Expr> mem_estimates =
+            bounds_to_estimates(get_element(group_loop_bounds, mem));
+
+        set<string> mem_rvars;
+        vector<Dim> &mem_dims = mem_def.schedule().dims();
+        for (int d = 0; d < (int)mem_dims.size() - 1; d++) {
+            if (mem_dims[d].is_rvar()) {
+                mem_rvars.insert(get_base_name(mem_dims[d].var));
+            }
+        }
+
+        // Get a function handle for scheduling the stage
+        Stage mem_handle = Stage(Func(mem.func));
+
+        bool at_root = degenerate || block_dims.empty();
+        if (mem.stage_num > 0) {
+            mem_handle = Func(mem.func).update(mem.stage_num - 1);
+        } else if (!at_root) {
+            if (tile_inner_var.is_rvar) {
+                Func(mem.func).compute_at(Func(g_out), tile_inner_var.rvar);
+            } else {
+                Func(mem.func).compute_at(Func(g_out), tile_inner_var.var);
+            }
+            string sanitized_g_out = get_sanitized_name(g_out.name());
+            sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                "compute_at(" + sanitized_g_out + ", " + tile_inner_var.name() + ")",
+                                {sanitized_g_out, tile_inner_var.name()});
+
+            Expr footprint;
+            const auto &iter = group_storage_bounds.find(mem.func.name());
+            if (iter != group_storage_bounds.end()) {
+                footprint = costs.region_size(mem.func.name(), iter->second);
+            }
+            if (footprint.defined() &&
+                can_prove(shared_used + footprint <= make_const(Int(64), arch_params.shared_memory_limit))) {
+                shared_used = simplify(shared_used + footprint);
+                Func(mem.func).store_in(MemoryType::GPUShared);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "store_in(MemoryType::GPUShared)", {});
+            } else {
+                Func(mem.func).store_in(MemoryType::Heap);
+                sched.push_schedule(mem_handle.name(), mem.stage_num,
+                                    "store_in(MemoryType::Heap)", {});
+            }
+        } else {
+            user_warning << "Degenerate tiling. No dimensions are tiled"
+                         << "\n";
+            user_warning << "Computing \"" << mem.func.name() << "\" at root"
+                         << "\n";
+            Func(mem.func).compute_root();
+            sched.push_schedule(mem_handle.name(), mem.stage_num, "compute_root()", {});
+        }
+
+        // Reorder the dimensions for better spatial locality. If we only have
+        // one dimension (excluding __outermost), there is nothing to reorder.
+        if (mem_dims.size() > 2) {
+            map<string, Expr> mem_strides =
+                analyze_spatial_locality(mem, group_storage_bounds, inlines);
+            if (!mem_strides.empty()) {
+                reorder_dims(mem_handle, mem.stage_num, mem_def, mem_strides, sched);
+            }
+        }
+
+        if (at_root) {
+            vector<Expr> mem_thread_extents;
+            gpu_tile_stage(g, mem_handle, mem.stage_num, mem_def, false,
+                           default_gpu_tile_sizes(mem_def), mem_rvars, mem_estimates,
+                           mem_thread_extents, sched);
+        } else {
+            gpu_thread_stage(g, mem_handle, mem.stage_num, mem_def, thread_extents,
+                             mem_rvars, mem_estimates, sched);
+        }
+    }
+}
+
+void Partitioner::generate_gpu_schedule(const Target &t, AutoSchedule &sched) {
+    // Grab the group bounds early as they rely on the dimensions of the group
+    // outputs which will be altered by modifying schedules.
+    map<FStage, map<FStage, DimBounds>> loop_bounds = group_loop_bounds();
+    map<FStage, map<string, Box>> storage_bounds = group_storage_bounds();
+
+    set<string> inlines;
+    // Mark all functions that are inlined.
+    for (const pair<const FStage, Group> &g : groups) {
+        for (const string &inline_func : g.second.inlined) {
+            inlines.insert(inline_func);
+        }
+    }
+
+    // Realize schedule for each group in the pipeline.
+    for (const auto &g : groups) {
+        generate_group_gpu_schedule(g.second, t, get_element(loop_bounds, g.first),
+                                    get_element(storage_bounds, g.first), inlines, sched);
+    }
+}
+
 Expr Partitioner::find_max_access_stride(const Scope<> &vars,
                                          const string &func_acc,
                                          const vector<Expr> &acc_exprs,
@@ -3367,8 +3957,13 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
 
     debug(2) << "Initializing AutoSchedule...\n";
     AutoSchedule sched(env, top_order);
-    debug(2) << "Generating CPU schedule...\n";
-    part.generate_cpu_schedule(target, sched);
+    if (arch_params.target_is_gpu) {
+        debug(2) << "Generating GPU schedule...\n";
+        part.generate_gpu_schedule(target, sched);
+    } else {
+        debug(2) << "Generating CPU schedule...\n";
+        part.generate_cpu_schedule(target, sched);
+    }
 
     std::ostringstream oss;
     oss << sched;
@@ -3379,7 +3974,6 @@ string generate_schedules(const vector<Function> &outputs, const Target &target,
              << sched_string << "\n\n";
 
     // TODO: Unify both inlining and grouping for fast mem
-    // TODO: GPU scheduling
     // TODO: Hierarchical tiling
 
     return sched_string;
@@ -3399,11 +3993,40 @@ struct Mullapudi2016 {
         }
 
         ArchParams arch_params;
+        if (target.has_gpu_feature()) {
+            arch_params.target_is_gpu = true;
+            // Enough blocks to fill a few dozen multiprocessors, and an
+            // L2-sized last level cache.
+            arch_params.parallelism = 128;
+            arch_params.last_level_cache_size = 4 * 1024 * 1024;
+        }
         {
             ParamParser parser(params_in.extra);
+            // Machine parameters that aren't given explicitly come from
+            // the hardware profile, if there is one.
+            std::string hardware_profile;
+            parser.parse("hardware_profile", &hardware_profile);
+            HardwareProfile profile;
+            if (HardwareProfile::find(hardware_profile, target, &profile)) {
+                arch_params.parallelism = profile.num_cores;
+                if (profile.last_level_cache_size > 0) {
+                    arch_params.last_level_cache_size = profile.last_level_cache_size;
+                }
+                if (profile.balance() > 0) {
+                    arch_params.balance = (float)profile.balance();
+                }
+            }
             parser.parse("parallelism", &arch_params.parallelism);
             parser.parse("last_level_cache_size", &arch_params.last_level_cache_size);
             parser.parse("balance", &arch_params.balance);
+            uint64_t shared_memory_limit_kb = arch_params.shared_memory_limit / 1024;
+            uint64_t shared_memory_sm_limit_kb = arch_params.shared_memory_sm_limit / 1024;
+            parser.parse("shared_memory_limit_kb", &shared_memory_limit_kb);
+            parser.parse("shared_memory_sm_limit_kb", &shared_memory_sm_limit_kb);
+            parser.parse("active_block_limit", &arch_params.active_block_limit);
+            parser.parse("active_warp_limit", &arch_params.active_warp_limit);
+            arch_params.shared_memory_limit = shared_memory_limit_kb * 1024;
+            arch_params.shared_memory_sm_limit = shared_memory_sm_limit_kb * 1024;
             parser.finish();
         }
         results.schedule_source = generate_schedules(pipeline_outputs, target, arch_params);
@@ -79,6 +79,14 @@ bool any_zero(const Container &c) {
     }
     return false;
 }
+
+/** The function that Buffer::copy_from and Buffer::fill use to run
+ * the pieces of large copies and fills in parallel, or nullptr to do
+ * them on the calling thread. See Buffer::set_parallel_for. */
+inline halide_do_par_for_t &buffer_parallel_for() {
+    static halide_do_par_for_t fn = nullptr;
+    return fn;
+}
 }  // namespace Internal
 
 /** A struct acting as a header for allocations owned by the Buffer
@@ -824,6 +832,22 @@ public:
         buf.host = (uint8_t *)((uintptr_t)(unaligned_ptr + alignment - 1) & ~(alignment - 1));
     }
 
+    /** Make this Buffer own host memory that it didn't allocate,
+     * such as a memory-mapped file, in place of any it already
+     * has. Copies of the Buffer share it as if it had been allocated,
+     * and when the last of them lets go of it, deallocate_fn is called
+     * on storage, which must have room at the start for an
+     * Internal::AllocationHeader to keep the reference count in. The
+     * rest of storage is free for the caller to use. Retains the shape
+     * of the buffer. */
+    void adopt_host_memory(void *host, void *storage, void (*deallocate_fn)(void *)) {
+        // Drop any existing allocation
+        deallocate();
+
+        alloc = new (storage) AllocationHeader(deallocate_fn);
+        buf.host = (uint8_t *)host;
+    }
+
     /** Drop reference to any owned host or device memory, possibly
      * freeing it, if this buffer held the last reference to
      * it. Retains the shape of the buffer. Does nothing if this
@@ -1269,6 +1293,30 @@ public:
             src.crop(i, min_coord, max_coord - min_coord + 1);
         }
 
+        // If the innermost dimension (after merging dense dimensions)
+        // is dense in both buffers, copy it a row at a time with
+        // memcpy.
+        if (d > 0) {
+            Buffer<>::for_each_value_task_dim<2> *t =
+                (Buffer<>::for_each_value_task_dim<2> *)HALIDE_ALLOCA((d + 1) * sizeof(for_each_value_task_dim<2>));
+            const halide_buffer_t *buffers[] = {dst.raw_buffer(), src.raw_buffer()};
+            if (Buffer<>::for_each_value_prep(t, buffers)) {
+                const std::ptrdiff_t bytes = type().bytes();
+                const size_t row_bytes = t[0].extent * bytes;
+                for (int i = 1; i < d; i++) {
+                    t[i].stride[0] *= bytes;
+                    t[i].stride[1] *= bytes;
+                }
+                t[0].extent = 1;
+                // Each row is visited as a single byte.
+                auto copy_row = [=](uint8_t &dst, const uint8_t &src) { memcpy(&dst, &src, row_bytes); };
+                Buffer<>::parallel_for_each_value_helper(copy_row, d - 1, false, t, row_bytes,
+                                                         (uint8_t *)dst.data(), (const uint8_t *)src.data());
+                set_host_dirty();
+                return;
+            }
+        }
+
         // If T is void, we need to do runtime dispatch to an
         // appropriately-typed lambda. We're copying, so we only care
         // about the element size. (If not, this should optimize away
@@ -1277,22 +1325,22 @@ public:
             using MemType = uint8_t;
             auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            typed_dst.parallel_for_each_value_impl([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 2) : (sizeof(not_void_T) == 2)) {
             using MemType = uint16_t;
             auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            typed_dst.parallel_for_each_value_impl([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 4) : (sizeof(not_void_T) == 4)) {
             using MemType = uint32_t;
             auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            typed_dst.parallel_for_each_value_impl([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else if (T_is_void ? (type().bytes() == 8) : (sizeof(not_void_T) == 8)) {
             using MemType = uint64_t;
             auto &typed_dst = (Buffer<MemType, Dims, InClassDimStorage> &)dst;
             auto &typed_src = (Buffer<const MemType, D2, S2> &)src;
-            typed_dst.for_each_value([&](MemType &dst, MemType src) { dst = src; }, typed_src);
+            typed_dst.parallel_for_each_value_impl([&](MemType &dst, MemType src) { dst = src; }, typed_src);
         } else {
             assert(false && "type().bytes() must be 1, 2, 4, or 8");
         }
@@ -2018,10 +2066,20 @@ public:
 
     Buffer<T, Dims, InClassDimStorage> &fill(not_void_T val) {
         set_host_dirty();
-        for_each_value([=](T &v) { v = val; });
+        parallel_for_each_value_impl([=](T &v) { v = val; });
         return *this;
     }
 
+    /** Set the function that copy_from and fill use to split large
+     * copies and fills into pieces to run in parallel. It has the
+     * signature of halide_do_par_for, which can be passed here by
+     * code that links against a Halide runtime. The default, nullptr,
+     * runs everything on the calling thread. This is shared by all
+     * Buffer types. */
+    static void set_parallel_for(halide_do_par_for_t fn) {
+        Internal::buffer_parallel_for() = fn;
+    }
+
 private:
     /** Helper functions for for_each_value. */
     // @{
@@ -2044,6 +2102,17 @@ private:
     static void advance_ptrs(const std::ptrdiff_t *) {
     }
 
+    // Advance the pointers by n steps of the strides.
+    template<typename Ptr, typename... Ptrs>
+    HALIDE_ALWAYS_INLINE static void advance_ptrs_by(std::ptrdiff_t n, const std::ptrdiff_t *stride, Ptr &ptr, Ptrs &...ptrs) {
+        ptr += n * *stride;
+        advance_ptrs_by(n, stride + 1, ptrs...);
+    }
+
+    HALIDE_ALWAYS_INLINE
+    static void advance_ptrs_by(std::ptrdiff_t, const std::ptrdiff_t *) {
+    }
+
     template<typename Fn, typename Ptr, typename... Ptrs>
     HALIDE_NEVER_INLINE static void for_each_value_helper(Fn &&f, int d, bool innermost_strides_are_one,
                                                           const for_each_value_task_dim<sizeof...(Ptrs) + 1> *t, Ptr ptr, Ptrs... ptrs) {
@@ -2133,6 +2202,81 @@ private:
         return innermost_strides_are_one;
     }
 
+    // Copies and fills are split into pieces of about this many bytes
+    // when there is a parallel_for to run them.
+    static constexpr size_t parallel_task_bytes = 256 * 1024;
+
+    template<typename Fn, typename Ptr, typename... Ptrs>
+    HALIDE_NEVER_INLINE static void for_each_value_slice(Fn &f, int d, bool innermost_strides_are_one,
+                                                         const for_each_value_task_dim<sizeof...(Ptrs) + 1> *t,
+                                                         std::ptrdiff_t start, std::ptrdiff_t count,
+                                                         Ptr ptr, Ptrs... ptrs) {
+        constexpr int N = sizeof...(Ptrs) + 1;
+        for_each_value_task_dim<N> *slice =
+            (for_each_value_task_dim<N> *)HALIDE_ALLOCA((d + 1) * sizeof(for_each_value_task_dim<N>));
+        for (int i = 0; i <= d; i++) {
+            slice[i] = t[i];
+        }
+        slice[d].extent = count;
+        advance_ptrs_by(start, t[d].stride, ptr, ptrs...);
+        for_each_value_helper(f, d, innermost_strides_are_one, slice, ptr, ptrs...);
+    }
+
+    // Like for_each_value_helper, but splits the outermost dimension
+    // with more than one value in it across the parallel_for, if
+    // there is one and the traversal touches enough memory.
+    template<typename Fn, typename Ptr, typename... Ptrs>
+    static void parallel_for_each_value_helper(Fn &f, int d, bool innermost_strides_are_one,
+                                               const for_each_value_task_dim<sizeof...(Ptrs) + 1> *t,
+                                               size_t value_bytes, Ptr ptr, Ptrs... ptrs) {
+        while (d > 0 && t[d].extent == 1) {
+            d--;
+        }
+        size_t bytes = value_bytes;
+        for (int i = 0; i <= d; i++) {
+            bytes *= t[i].extent;
+        }
+        const halide_do_par_for_t par_for = Internal::buffer_parallel_for();
+        const std::ptrdiff_t extent = t[d].extent;
+        std::ptrdiff_t tasks = std::min<std::ptrdiff_t>(extent, bytes / parallel_task_bytes);
+        if (!par_for || tasks < 2) {
+            for_each_value_helper(f, d, innermost_strides_are_one, t, ptr, ptrs...);
+            return;
+        }
+        tasks = std::min<std::ptrdiff_t>(tasks, std::numeric_limits<int>::max());
+        const std::ptrdiff_t per_task = (extent + tasks - 1) / tasks;
+        tasks = (extent + per_task - 1) / per_task;
+
+        auto body = [&](int i) {
+            const std::ptrdiff_t start = i * per_task;
+            for_each_value_slice(f, d, innermost_strides_are_one, t,
+                                 start, std::min(per_task, extent - start), ptr, ptrs...);
+        };
+        using Body = decltype(body);
+        auto task = [](void *, int i, uint8_t *closure) -> int {
+            (*(Body *)closure)(i);
+            return 0;
+        };
+        par_for(nullptr, task, 0, (int)tasks, (uint8_t *)&body);
+    }
+
+    template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
+    void parallel_for_each_value_impl(Fn &&f, Args &&...other_buffers) const {
+        if (dimensions() > 0) {
+            Buffer<>::for_each_value_task_dim<N> *t =
+                (Buffer<>::for_each_value_task_dim<N> *)HALIDE_ALLOCA((dimensions() + 1) * sizeof(for_each_value_task_dim<N>));
+            const halide_buffer_t *buffers[] = {&buf, (&other_buffers.buf)...};
+            bool innermost_strides_are_one = Buffer<>::for_each_value_prep(t, buffers);
+
+            Buffer<>::parallel_for_each_value_helper(f, dimensions() - 1,
+                                                     innermost_strides_are_one,
+                                                     t, type().bytes(),
+                                                     data(), (other_buffers.data())...);
+        } else {
+            f(*data(), (*other_buffers.data())...);
+        }
+    }
+
     template<typename Fn, typename... Args, int N = sizeof...(Args) + 1>
     void for_each_value_impl(Fn &&f, Args &&...other_buffers) const {
         if (dimensions() > 0) {
@@ -3,12 +3,15 @@
 
 /** \file
  * Override Halide's CUDA hooks so that the Halide code called from PyTorch uses
- * the correct GPU device and stream. This header should be included once in
- * the PyTorch/C++ binding source file (see apps/HelloPyTorch/setup.py for an
- * example).
+ * the correct GPU device and stream, and allocates device memory for its
+ * intermediates from PyTorch's caching allocator. This header should be
+ * included once in the PyTorch/C++ binding source file (see
+ * apps/HelloPyTorch/setup.py for an example).
  */
 
 #include "HalideRuntimeCuda.h"
+#include "c10/cuda/CUDACachingAllocator.h"
+#include "c10/cuda/CUDAStream.h"
 #include "cuda.h"
 #include "cuda_runtime.h"
 
@@ -59,6 +62,40 @@ int halide_get_gpu_device(void *user_context) {
     }
 }
 
+// Allocate device memory for intermediates on PyTorch's current
+// stream from its caching allocator. The allocator only reuses a block
+// once the work queued on that stream before its release has run, so,
+// unlike cuMemFree, freeing doesn't have to wait for the device.
+int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
+    if (buf->device) {
+        return 0;
+    }
+    cudaStream_t stream;
+    if (user_context != nullptr) {
+        Halide::PyTorch::UserContext *user_ctx = (Halide::PyTorch::UserContext *)user_context;
+        stream = *user_ctx->stream;
+    } else {
+        stream = c10::cuda::getCurrentCUDAStream();
+    }
+    void *p = c10::cuda::CUDACachingAllocator::raw_alloc_with_stream(buf->size_in_bytes(), stream);
+    if (p == nullptr) {
+        return halide_error_code_device_malloc_failed;
+    }
+    buf->device = (uint64_t)p;
+    buf->device_interface = halide_cuda_device_interface();
+    return 0;
+}
+
+int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    c10::cuda::CUDACachingAllocator::raw_delete((void *)buf->device);
+    buf->device = 0;
+    buf->device_interface = nullptr;
+    return 0;
+}
+
 }  // extern "C"
 
 #endif /* end of include guard: HL_PYTORCH_CUDA_HELPERS_H */
@@ -353,6 +353,238 @@ extern void halide_join_thread(struct halide_thread *);
  */
 extern int halide_set_num_threads(int n);
 
+/** Enable or disable work stealing in Halide's thread pool. Returns
+ * the old setting. When enabled, the iterations of each parallel loop
+ * that has no semaphores and no minimum thread requirement are split
+ * into one contiguous range per thread. Threads claim iterations
+ * from their own range without taking the thread pool lock, and
+ * steal half of another thread's range when theirs runs out. The
+ * default is taken from the HL_THREAD_POOL_WORK_STEALING environment
+ * variable, and is off if it is unset.
+ *
+ * (As with halide_set_num_threads(), this only affects the default
+ * implementations of halide_do_par_for() and
+ * halide_do_parallel_tasks().)
+ */
+extern bool halide_set_thread_pool_work_stealing(bool enable);
+
+/** Enable or disable guided scheduling in Halide's thread pool.
+ * Returns the old setting. When enabled, threads claim the iterations
+ * of each parallel loop that has no semaphores and no minimum thread
+ * requirement in chunks, with an atomic add rather than the thread
+ * pool lock. Each chunk is a fraction of the iterations that remain,
+ * so the chunks shrink as the loop runs. Loops entered through
+ * halide_do_parallel_tasks() get each chunk as one range through
+ * halide_do_loop_task(); compile with the parallel_loop_ranges
+ * target feature to make simple parallel loops do this too. This
+ * takes precedence over work stealing, but NUMA-aware mode takes
+ * precedence over it. The default is taken from the
+ * HL_THREAD_POOL_GUIDED environment variable, and is off if it is
+ * unset.
+ *
+ * (As with halide_set_num_threads(), this only affects the default
+ * implementations of halide_do_par_for() and
+ * halide_do_parallel_tasks().)
+ */
+extern bool halide_set_thread_pool_guided_scheduling(bool enable);
+
+/** Set how long, in microseconds, the worker threads of Halide's
+ * thread pool busy-wait for more work after finishing a job before
+ * going to sleep. Returns the old setting. A nonzero period saves the
+ * latency of waking the workers between back-to-back parallel loops,
+ * at the cost of cpu time spent waiting between them. Workers never
+ * busy-wait while the thread pools have more threads than there are
+ * cpus. The default is taken from the HL_THREAD_POOL_HOT_PERIOD_US
+ * environment variable, and is zero if it is unset.
+ *
+ * (As with halide_set_num_threads(), this only affects the default
+ * implementations of halide_do_par_for() and
+ * halide_do_parallel_tasks().)
+ */
+extern int halide_set_thread_pool_hot_period(int microseconds);
+
+/** Counters describing the work done by a thread pool, as reported by
+ * halide_thread_pool_get_stats. The counts accumulate from the time
+ * the pool is first used (or the last call to
+ * halide_shutdown_thread_pool). Times are in nanoseconds, summed over
+ * all the threads of the pool, and are only measured when
+ * halide_set_thread_pool_timing() is on. */
+struct halide_thread_pool_stats_t {
+    /** Jobs (parallel loops and parallel tasks) pushed onto the shared
+     * job stack. */
+    uint64_t jobs_enqueued;
+    /** Calls into the body of a job. Each may be one iteration or a
+     * range of them. */
+    uint64_t tasks_executed;
+    /** Single iterations claimed from the shared job stack under the
+     * thread pool lock. */
+    uint64_t queue_pops;
+    /** Ranges of iterations stolen from other threads in
+     * work-stealing mode. */
+    uint64_t steals;
+    /** Chunks of iterations claimed in guided mode. */
+    uint64_t guided_chunks;
+    /** Chunks of nested loops run by the calling thread because every
+     * thread of the pool was busy. */
+    uint64_t inline_chunks;
+    /** Times a job was passed over because not enough threads were
+     * free to satisfy its minimum thread count. */
+    uint64_t min_threads_waits;
+    /** Times a job was passed over because its semaphores could not be
+     * acquired. */
+    uint64_t semaphore_acquire_failures;
+    /** The greatest number of jobs on the shared job stack at once. */
+    uint64_t max_queue_depth;
+    /** Times a thread went to sleep waiting for work. */
+    uint64_t sleeps;
+    /** Time spent spinning while waiting for work, sleeping, and
+     * working on jobs. */
+    uint64_t spin_ns, sleep_ns, run_ns;
+    /** Time from a job first failing to acquire its semaphores until
+     * it acquires them. */
+    uint64_t semaphore_wait_ns;
+    /** The number of threads in the pool, including the calling
+     * thread. */
+    uint64_t num_threads;
+};
+
+/** Fill in the counters of the thread pool chosen for the given
+ * user_context by halide_get_thread_pool. Safe to call while the
+ * pool is in use, though counters updated without the thread pool
+ * lock may be read slightly out of step with each other. */
+extern void halide_thread_pool_get_stats(void *user_context, struct halide_thread_pool_stats_t *stats);
+
+/** Enable or disable measuring the times in
+ * halide_thread_pool_stats_t. Returns the old setting. Measuring
+ * costs a clock read each time a thread joins a job, spins, or
+ * sleeps. The default is taken from the HL_THREAD_POOL_TIMING
+ * environment variable, and is off if it is unset. */
+extern bool halide_set_thread_pool_timing(bool enable);
+
+/** Opaque type for a thread pool made by halide_create_thread_pool. */
+struct halide_thread_pool_t;
+
+/** Create a thread pool that is separate from the default one, with
+ * its own worker threads, work queue, and lock. This lets pipelines
+ * of different urgency run side by side without the work of one
+ * waiting behind the other. The worker threads are spawned when the
+ * pool is first used. num_threads is as for halide_set_num_threads. A
+ * nonzero priority is applied to each worker thread as a nice value
+ * when it is spawned (currently only on Linux; elsewhere it is
+ * ignored). The name may be used to find the pool later with
+ * halide_find_thread_pool. Returns nullptr on failure.
+ *
+ * Which pool the parallel work for a call runs on is chosen by
+ * halide_get_thread_pool. As with halide_set_num_threads(), this only
+ * affects the default implementations of halide_do_par_for() and
+ * halide_do_parallel_tasks().
+ */
+extern struct halide_thread_pool_t *halide_create_thread_pool(const char *name, int num_threads, int priority);
+
+/** Shut down the worker threads of a pool made by
+ * halide_create_thread_pool and free it. Nothing may still be
+ * running on it. */
+extern void halide_destroy_thread_pool(struct halide_thread_pool_t *pool);
+
+/** Find the most recently created thread pool with the given name, or
+ * nullptr if there is none. */
+extern struct halide_thread_pool_t *halide_find_thread_pool(const char *name);
+
+/** Set the number of threads used by a thread pool and return the
+ * old number, as for halide_set_num_threads. A null pool means the
+ * default pool. */
+extern int halide_set_thread_pool_num_threads(struct halide_thread_pool_t *pool, int n);
+
+/** Choose the thread pool that runs the parallel work for the given
+ * user_context. A return value of nullptr means the default pool,
+ * which is all that the default implementation returns. Nested
+ * parallel loops are given the same user_context, so they stay on the
+ * pool that was chosen for the outermost one. To map user contexts to
+ * pools in AOT code, use halide_set_custom_get_thread_pool, or (on
+ * platforms that support weak linking), simply define this
+ * function. */
+// @{
+extern struct halide_thread_pool_t *halide_get_thread_pool(void *user_context);
+extern struct halide_thread_pool_t *halide_default_get_thread_pool(void *user_context);
+typedef struct halide_thread_pool_t *(*halide_get_thread_pool_t)(void *user_context);
+extern halide_get_thread_pool_t halide_set_custom_get_thread_pool(halide_get_thread_pool_t f);
+// @}
+
+/** Opaque type for a call made by halide_call_async. */
+struct halide_async_call_t;
+
+/** The function run by halide_call_async, typically a wrapper that
+ * calls a pipeline with arguments packed into arg. Returns the result
+ * of the call. */
+typedef int (*halide_async_fn_t)(void *user_context, void *arg);
+
+/** Called with the result of the call once it has finished. */
+typedef void (*halide_async_callback_t)(void *user_context, void *arg, int result);
+
+/** Queue a call to fn(user_context, arg) into Halide's thread pool,
+ * and return without waiting for it. This lets an event-driven
+ * caller have several pipeline calls in flight without dedicating a
+ * thread to each. The call runs on a worker thread of the thread pool
+ * chosen by halide_get_thread_pool, and its parallel loops are shared
+ * with the rest of the pool as usual. Calls are started in the order
+ * in which they were made, after the work of pipelines that are
+ * already running. If done is not null, it is called on the thread
+ * that ran the call as soon as it finishes.
+ *
+ * Returns a handle to the call, or nullptr if it could not be
+ * queued. The handle must be passed to exactly one of
+ * halide_async_call_wait and halide_async_call_detach, which free
+ * it. The thread pool must not be shut down while calls are in
+ * flight.
+ *
+ * (This is only supported by the default implementations of
+ * halide_do_par_for() and halide_do_parallel_tasks(), which it shares
+ * a thread pool with.)
+ */
+// @{
+extern struct halide_async_call_t *halide_call_async(void *user_context, halide_async_fn_t fn, void *arg,
+                                                     halide_async_callback_t done);
+/** Wait for a call made by halide_call_async to finish, helping the
+ * thread pool with other work meanwhile, and return its result. The
+ * handle is freed. */
+extern int halide_async_call_wait(struct halide_async_call_t *call);
+/** Whether a call made by halide_call_async has finished, including
+ * its callback. */
+extern bool halide_async_call_finished(struct halide_async_call_t *call);
+/** Give up the handle to a call made by halide_call_async. It is
+ * freed as soon as the call finishes, and the result is only
+ * reported to the callback. */
+extern void halide_async_call_detach(struct halide_async_call_t *call);
+// @}
+
+/** Enable or disable NUMA-aware mode. Returns the old setting. In
+ * this mode the thread pool pins its worker threads to cpus, grouped
+ * by NUMA node, and splits the iterations of simple parallel loops
+ * into contiguous blocks in that same order, so that each node works
+ * on a contiguous block of each loop. halide_default_malloc also
+ * satisfies large allocations with fresh pages from the OS, so that
+ * they are placed on the node of the thread that first writes to
+ * them. The default is taken from the HL_NUMA_AWARE environment
+ * variable, and is off if it is unset. This is currently only
+ * supported on Linux; elsewhere it has no effect.
+ *
+ * Worker threads are pinned when they are spawned, so this should be
+ * called before the thread pool is first used, or after a call to
+ * halide_shutdown_thread_pool().
+ */
+extern bool halide_set_numa_aware(bool enable);
+
+/** Set the size at and above which halide_default_malloc maps memory
+ * directly from the OS, backed by huge pages where possible, instead
+ * of calling malloc. A few of the regions most recently freed this way
+ * are kept mapped, and reused by later allocations of a similar size,
+ * so that pipelines called repeatedly don't map and unmap their large
+ * intermediates on each call. Zero turns this off. The default is
+ * 16MB. Returns the old value. This is currently only supported on
+ * Linux; elsewhere it has no effect.
+ */
+extern size_t halide_set_large_allocation_threshold(size_t bytes);
+
 /** Halide calls these functions to allocate and free memory. To
  * replace in AOT code, use the halide_set_custom_malloc and
  * halide_set_custom_free, or (on platforms that support weak
@@ -381,6 +613,40 @@ extern halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc);
 extern halide_free_t halide_set_custom_free(halide_free_t user_free);
 //@}
 
+/** Pipelines compiled with the bump_allocator target feature acquire
+ * an arena with halide_arena_begin on entry to the pipeline and to
+ * every parallel task, serve that scope's heap allocations from it with
+ * halide_arena_malloc, release them with halide_arena_free, and hand
+ * the arena back with halide_arena_end on exit. An arena is only used
+ * by one thread at a time. The default implementation bump-allocates
+ * out of chunks obtained from halide_malloc, pops allocations once
+ * they and everything above them are freed, and keeps released arenas
+ * (and their chunks) for reuse by later scopes. Allocations it cannot
+ * serve from the arena, including all allocations against a null
+ * arena, are passed through to halide_malloc. Released arenas are
+ * shared by all pipelines, so their memory may later be freed with a
+ * different user_context than it was allocated with.
+ *
+ * To replace the arena, pass a table of functions to
+ * halide_set_custom_arena; the previous table is returned. Passing
+ * null restores the default. halide_arena_release_unused frees the
+ * memory held by arenas that are not currently in use.
+ */
+//@{
+typedef struct halide_arena_interface_t {
+    void *(*begin)(void *user_context);
+    void *(*malloc)(void *user_context, void *arena, uint64_t size);
+    void (*free)(void *user_context, void *ptr);
+    void (*end)(void *user_context, void *arena);
+} halide_arena_interface_t;
+extern const struct halide_arena_interface_t *halide_set_custom_arena(const struct halide_arena_interface_t *arena);
+extern void *halide_arena_begin(void *user_context);
+extern void *halide_arena_malloc(void *user_context, void *arena, uint64_t size);
+extern void halide_arena_free(void *user_context, void *ptr);
+extern void halide_arena_end(void *user_context, void *arena);
+extern void halide_arena_release_unused(void *user_context);
+//@}
+
 /** Halide calls these functions to interact with the underlying
  * system runtime functions. To replace in AOT code on platforms that
  * support weak linking, define these functions yourself, or use
@@ -415,6 +681,26 @@ extern int32_t halide_debug_to_file(void *user_context, const char *filename,
                                     int32_t type_code,
                                     struct halide_buffer_t *buf);
 
+/** Make halide_debug_to_file return as soon as it has copied the buffer,
+ * and write the copies to their files on a background thread instead.
+ * At most max_queued_bytes of copies wait to be written; beyond that,
+ * halide_debug_to_file waits for the writer to catch up. Zero (the
+ * default) writes synchronously. If this is never called, Halide checks
+ * for an environment variable called HL_DEBUG_TO_FILE_ASYNC, giving the
+ * limit in megabytes. */
+extern void halide_debug_to_file_set_async(int64_t max_queued_bytes);
+
+/** Write only every period-th buffer sent to the named file (the
+ * first, then the period+1-th, and so on), and skip the rest. This sets
+ * the sampling rate of a Func, as its filename is unique to it. Returns
+ * zero, or halide_error_code_out_of_memory. */
+extern int halide_debug_to_file_set_sampling(const char *filename, int period);
+
+/** Wait for all of the asynchronous writes queued so far to finish.
+ * Returns zero, or the error code of the first write that failed since
+ * the last call. */
+extern int halide_debug_to_file_flush(void *user_context);
+
 /** Types in the halide type system. They can be ints, unsigned ints,
  * or floats (of various bit-widths), or a handle (which is always 64-bits).
  * Note that the int/uint/float values do not imply a specific bit width
@@ -614,6 +900,11 @@ struct halide_trace_event_t {
  * Note that all trace_tag events (if any) will occur just after the begin_pipeline
  * event, but before any begin_realization events. All trace_tags for a given Func
  * will be emitted in the order added.
+ *
+ * If HL_TRACE_SAMPLE is set to N, the default implementation only
+ * traces one in every N realizations of each Func. It returns a
+ * negative ID for realizations it skips, and silently drops (returning
+ * the same negative ID for) any event whose parent ID is negative.
  */
 // @}
 extern int32_t halide_trace(void *user_context, const struct halide_trace_event_t *event);
@@ -804,6 +1095,28 @@ extern int halide_buffer_copy(void *user_context, struct halide_buffer_t *src,
                               const struct halide_device_interface_t *dst_device_interface,
                               struct halide_buffer_t *dst);
 
+/** Mark a buffer as dirty on the host or on the device, but only
+ * within the given region, so that the next halide_copy_to_device or
+ * halide_copy_to_host only copies that part of it. The region is an
+ * array of one halide_dimension_t per dimension of the buffer, of
+ * which only the mins and extents are used. Calling these again before
+ * the copy adds to the region, merging boxes that together form a box.
+ * A buffer that was already dirty with no region recorded is taken to
+ * be dirty only within the new region, so the region must cover
+ * everything written since the last copy.
+ *
+ * Setting a dirty flag in any other way, including by running a
+ * pipeline that writes to the buffer, makes the whole buffer dirty
+ * again. Only a few regions of a few buffers are remembered at once,
+ * and the whole buffer is copied if they have been forgotten, or if
+ * the device interface does not support cropping. */
+// @{
+extern int halide_buffer_set_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                               const struct halide_dimension_t *region);
+extern int halide_buffer_set_device_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                                 const struct halide_dimension_t *region);
+// @}
+
 /** Give the destination buffer a device allocation which is an alias
  * for the same coordinate range in the source buffer. Modifies the
  * device, device_interface, and the device_dirty flag only. Only
@@ -884,6 +1197,18 @@ extern void halide_set_gpu_device(int n);
  * HL_GPU_DEVICE. */
 extern int halide_get_gpu_device(void *user_context);
 
+/** Halide calls this at the start of each iteration of a loop
+ * scheduled with Func::multi_gpu, to get the user_context to use for
+ * that iteration, which is the given iteration number of the loop on
+ * behalf of the pipeline called with the given user_context. Everything
+ * done inside the iteration, including device allocations, copies
+ * and kernel launches, is passed the returned user_context. Implement
+ * this yourself, together with e.g. halide_cuda_acquire_context or
+ * halide_get_gpu_device, to give the iterations different GPU
+ * devices. The default implementation returns user_context, so all the
+ * iterations use the same device. */
+extern void *halide_gpu_device_user_context(void *user_context, int index);
+
 /** Set the soft maximum amount of memory, in bytes, that the LRU
  *  cache will use to memoize Func results.  This is not a strict
  *  maximum in that concurrency and simultaneous use of memoized
@@ -892,6 +1217,42 @@ extern int halide_get_gpu_device(void *user_context);
  */
 extern void halide_memoization_cache_set_size(int64_t size);
 
+/** Set the soft maximum amount of device memory, in bytes, that the
+ * cache will hold onto. Results of memoized Funcs computed on a GPU
+ * are kept in the cache on the device, so that a hit doesn't need to
+ * copy them back, and are charged to this budget as well as to the
+ * host one. Entries are evicted from both in the same least recently
+ * used order, and by halide_memoization_cache_evict. Device results
+ * can only be used by pipelines on the same device (context) as the
+ * one that computed them. Pass zero for the default of 1MB.
+ */
+extern void halide_memoization_cache_set_device_size(int64_t size);
+
+/** Use a region of memory shared with other processes as a second
+ * level of the memoization cache, so that the processes share their
+ * memoized results. The region is typically a file mapped with
+ * MAP_SHARED by each process, e.g. one in /dev/shm, or on disk for
+ * results to survive restarts. A new region must be all zeros (as a
+ * newly created file is); the first process to use it sets it up, and
+ * later ones must pass the same size.
+ *
+ * Results missing from this process's cache are looked up in the
+ * region, and results stored in the cache are added to it, except
+ * those with an eviction key or whose data is on a device. Entries in
+ * the region are keyed by the names of the pipeline and Func, a
+ * fingerprint of the Func's algorithm, and the values it depends on,
+ * so they are only found by pipelines that compute the same thing.
+ * Lookups and additions do not lock, and entries are never evicted
+ * from the region: once it is full, no more are added. Delete the
+ * file to empty it.
+ *
+ * Pass a null region to stop using one. Returns an error code if the
+ * region is too small, or was set up with a different size or by an
+ * incompatible version of Halide. Must be called at a time when no
+ * other threads are accessing the cache.
+ */
+extern int halide_memoization_cache_set_shared_region(void *user_context, void *region, int64_t size);
+
 /** Given a cache key for a memoized result, currently constructed
  *  from the Func name and top-level Func name plus the arguments of
  *  the computation, determine if the result is in the cache and
@@ -958,11 +1319,101 @@ extern void halide_memoization_cache_evict(void *user_context, uint64_t eviction
  */
 extern void halide_memoization_cache_release(void *user_context, void *host);
 
+/** Called by pipelines in place of halide_device_free for the buffers
+ * of memoized Funcs. Frees the device allocation unless it is held by
+ * the cache entry the buffer came from, in which case the buffer is
+ * just detached from it. The second form is used as a destructor. */
+// @{
+extern int halide_memoization_cache_device_free(void *user_context, struct halide_buffer_t *buf);
+extern void halide_memoization_cache_device_free_as_destructor(void *user_context, void *obj);
+// @}
+
 /** Free all memory and resources associated with the memoization cache.
  * Must be called at a time when no other threads are accessing the cache.
  */
 extern void halide_memoization_cache_cleanup();
 
+/** Counters describing the state of the memoization cache, as
+ * reported by halide_memoization_cache_stats. Hits, misses and
+ * evictions accumulate from program start (or the last call to
+ * halide_memoization_cache_cleanup). Sizes are in bytes. Misses
+ * include lookups that were then found in the shared region (see
+ * halide_memoization_cache_set_shared_region), which are also counted
+ * in shared_hits. The device sizes cover results kept on a device
+ * (see halide_memoization_cache_set_device_size). */
+struct halide_memoization_cache_stats_t {
+    uint64_t hits, misses, evictions, entries;
+    int64_t current_size, max_size;
+    uint64_t shared_hits;
+    int64_t current_device_size, max_device_size;
+};
+
+/** Fill in the given struct with the current memoization cache
+ * statistics. Safe to call concurrently with other cache operations,
+ * though the counters of different shards of the cache are not read
+ * atomically with respect to each other.
+ */
+extern void halide_memoization_cache_stats(struct halide_memoization_cache_stats_t *stats);
+
+/** Get the distance to prefetch ahead by at a prefetch site scheduled
+ * with tuned_prefetch_distance(). The first time a site is seen, a few
+ * candidate distances around the initial one are handed out in turn; a
+ * negative return value means the caller should use the negated value
+ * as the distance and report the time its loop took to
+ * halide_tuned_prefetch_distance_report. Once every candidate has been
+ * timed, the fastest one is returned from then on. Sites are shared by
+ * all pipelines in the process and are identified by name. */
+extern int halide_tuned_prefetch_distance(void *user_context, const char *site, int initial);
+
+/** Report how long a loop took with the given prefetch distance. */
+extern int halide_tuned_prefetch_distance_report(void *user_context, const char *site,
+                                                 int distance, int64_t elapsed_ns);
+
+/** Forget all tuned prefetch distances, so that they are tuned again
+ * the next time they are used. Must be called at a time when no other
+ * threads are running Halide pipelines. */
+extern void halide_tuned_prefetch_distance_reset();
+
+/** The runtime functions used by pipelines with distributed loops
+ * (see Func::distribute). A distributed computation is run by several
+ * processes, called ranks, which each call the pipeline with the same
+ * arguments. Each rank computes one block of the iterations of each
+ * distributed loop, and ranks exchange the parts of distributed Funcs
+ * they have computed that other ranks need.
+ *
+ * halide_distributed_rank returns the index of the calling rank, from
+ * zero to halide_distributed_num_ranks() - 1.
+ *
+ * halide_distributed_exchange is called by every rank, in the same
+ * order, after a distributed Func is computed and before it is used.
+ * The buffer holds the part of the Func the rank has. Along dimension
+ * dim, the rank has computed the rows from owned_min to owned_min +
+ * owned_extent - 1 of the buffer, and needs the rows from needed_min
+ * to needed_min + needed_extent - 1, which it must receive from the
+ * ranks that own them. The blocks the ranks own do not overlap, and
+ * the rows needed are always owned by some rank. Rows are whole slices
+ * of the buffer in the other dimensions. Returns zero on success.
+ *
+ * The default implementations run everything on a single rank, for
+ * which there is nothing to exchange. Use
+ * halide_set_custom_distributed_runtime to run on several, e.g. with
+ * MPI. */
+// @{
+typedef int (*halide_distributed_rank_t)(void *user_context);
+typedef int (*halide_distributed_num_ranks_t)(void *user_context);
+typedef int (*halide_distributed_exchange_t)(void *user_context, struct halide_buffer_t *buf, int dim,
+                                             int owned_min, int owned_extent,
+                                             int needed_min, int needed_extent);
+extern int halide_distributed_rank(void *user_context);
+extern int halide_distributed_num_ranks(void *user_context);
+extern int halide_distributed_exchange(void *user_context, struct halide_buffer_t *buf, int dim,
+                                       int owned_min, int owned_extent,
+                                       int needed_min, int needed_extent);
+extern void halide_set_custom_distributed_runtime(halide_distributed_rank_t rank,
+                                                  halide_distributed_num_ranks_t num_ranks,
+                                                  halide_distributed_exchange_t exchange);
+// @}
+
 /** Verify that a given range of memory has been initialized; only used when Target::MSAN is enabled.
  *
  * The default implementation simply calls the LLVM-provided __msan_check_mem_is_initialized() function.
@@ -1193,6 +1644,11 @@ enum halide_error_code_t {
     /** An explicit storage bound provided is too small to store
      * all the values produced by the function. */
     halide_error_code_storage_bound_too_small = -45,
+
+    /** A pipeline compiled with the check_no_alias target feature was
+     * passed an output buffer whose host memory overlaps that of
+     * another of its buffers. */
+    halide_error_code_buffers_overlap = -46,
 };
 
 /** Halide calls the functions below on various error conditions. The
@@ -1267,6 +1723,7 @@ extern int halide_error_device_dirty_with_no_device_support(void *user_context,
 extern int halide_error_storage_bound_too_small(void *user_context, const char *func_name, const char *var_name,
                                                 int provided_size, int required_size);
 extern int halide_error_device_crop_failed(void *user_context);
+extern int halide_error_buffers_overlap(void *user_context, const char *buffer_name, const char *other_buffer_name);
 // @}
 
 /** Optional features a compilation Target can have.
@@ -1366,6 +1823,35 @@ typedef enum halide_target_feature_t {
     halide_target_feature_sanitizer_coverage,     ///< Enable hooks for SanitizerCoverage support.
     halide_target_feature_profile_by_timer,       ///< Alternative to halide_target_feature_profile using timer interrupt for systems without threads or applicartions that need to avoid them.
     halide_target_feature_spirv,                  ///< Enable SPIR-V code generation support.
+    halide_target_feature_cuda_async_copies,      ///< Stage CUDA host<->device copies through pinned memory, and make copies to the device asynchronous.
+    halide_target_feature_avx512_vnni,            ///< Enable the AVX512-VNNI integer dot products (e.g. Cascade Lake and Ice Lake). Implies avx512_skylake.
+    halide_target_feature_avxvnni,                ///< Enable the AVX-VNNI (VEX encoded, 256 and 128 bit) integer dot products (e.g. Alder Lake). Implies avx2.
+    halide_target_feature_wasm_relaxed_simd,      ///< Enable +relaxed-simd instructions for WebAssembly codegen. Requires wasm_simd128.
+    halide_target_feature_hexagon_auto_vtcm,      ///< Place large intermediate allocations in Hexagon VTCM rather than DDR where they fit. Requires hvx_v65.
+    halide_target_feature_profile_instrumented,   ///< Alternative to halide_target_feature_profile that times every Func exactly with inline instrumentation instead of a sampling thread.
+    halide_target_feature_vulkan,                 ///< Enable Vulkan runtime support. Kernels are compiled to SPIR-V.
+    halide_target_feature_plan_heap_storage,      ///< Pack heap allocations with disjoint lifetimes into a shared arena with one halide_malloc per group.
+    halide_target_feature_bump_allocator,         ///< Serve heap allocations from per-task arenas with halide_arena_malloc instead of calling halide_malloc for each one.
+    halide_target_feature_cache_parallel_allocations, ///< Reuse the heap allocations of parallel loop bodies across the iterations each worker runs.
+    halide_target_feature_multiversion_loops,     ///< Also compile vectorized inner loops for newer x86 CPUs, and pick a version at runtime.
+    halide_target_feature_vector_math_fast,       ///< Compute float sin, cos, tanh, exp and log with the Fast vectorizable polynomials instead of libm.
+    halide_target_feature_vector_math_balanced,   ///< Compute float sin, cos, tanh, exp and log with the Balanced vectorizable polynomials instead of libm.
+    halide_target_feature_vector_math_precise,    ///< Compute float sin, cos, tanh, exp and log with the Precise vectorizable polynomials instead of libm.
+    halide_target_feature_avx512_fp16,            ///< Use AVX512-FP16 instructions for float16 arithmetic instead of emulating it with float32. Implies avx512_sapphirerapids.
+    halide_target_feature_arm_bf16,               ///< Enable ARMv8.6 bfloat16 dot product instructions (bfdot).
+    halide_target_feature_cuda_tensor_cores,      ///< Use warp matrix multiply instructions for matrix multiplies into MMAFragment tiles. Needs cuda_capability_70 or higher.
+    halide_target_feature_cl_subgroups,           ///< Enable the cl_khr_subgroups extension, used to reduce across the subgroups of OpenCL kernels.
+    halide_target_feature_metal_simdgroups,       ///< Use SIMD-group reductions in Metal kernels. Needs Metal 2.1 and a GPU that supports them.
+    halide_target_feature_unchecked_entry_point,  ///< Also generate <name>_unchecked, which skips the argument checks and bounds query of <name>.
+    halide_target_feature_partition_cost_model,   ///< Only partition loops whose steady state dominates their prologue and epilogue, within a per-Func budget of loop bodies.
+    halide_target_feature_parallel_loop_ranges,   ///< Enter the thread pool through halide_do_parallel_tasks for every parallel loop, so that the body of each can be given a range of iterations at once.
+    halide_target_feature_cuda_fatbin,            ///< Compile CUDA kernels to SASS at Halide compile time with ptxas, and embed a fatbin with the PTX as a fallback.
+    halide_target_feature_cl_spirv,               ///< Compile OpenCL kernels to SPIR-V at Halide compile time, and load them with clCreateProgramWithIL. Needs OpenCL 2.1 at runtime.
+    halide_target_feature_check_no_alias,         ///< Check that the host memory of each output buffer overlaps none of the pipeline's other buffers.
+    halide_target_feature_stage_luts,             ///< Copy small lookup tables read at data-dependent sites into GPU shared memory or VTCM once per block or offload.
+    halide_target_feature_arm_i8mm,               ///< Enable ARMv8.6 int8 matrix multiply instructions (smmla, ummla).
+    halide_target_feature_hvx_v68,                ///< Enable Hexagon v68 architecture, and HVX floating point vectors using qfloat.
+    halide_target_feature_fuse_outputs,           ///< Compute pipeline outputs that read a common input and have matching loop nests with each other, as if by compute_with.
     halide_target_feature_end                     ///< A sentinel. Every target is considered to have this feature, and setting this feature does nothing.
 } halide_target_feature_t;
 
@@ -1408,6 +1894,30 @@ extern halide_can_use_target_features_t halide_set_custom_can_use_target_feature
  */
 extern int halide_default_can_use_target_features(int count, const uint64_t *features);
 
+/** The selection a multitarget wrapper (see compile_multitarget) keeps
+ * of the sub-pipeline it calls. The wrapper chooses a sub-pipeline with
+ * halide_can_use_target_features on its first call, stores it in
+ * selected, and registers itself with
+ * halide_register_multitarget_dispatch; every later call goes straight
+ * to the stored sub-pipeline. */
+typedef struct halide_multitarget_dispatch_t {
+    void *selected;
+    struct halide_multitarget_dispatch_t *next;
+} halide_multitarget_dispatch_t;
+
+/** Add a multitarget wrapper's selection to the set cleared by
+ * halide_reset_multitarget_dispatch. Called by generated code; adding
+ * the same one twice has no effect. */
+extern void halide_register_multitarget_dispatch(struct halide_multitarget_dispatch_t *dispatch);
+
+/** Forget the sub-pipelines chosen by every multitarget wrapper, so
+ * that each one chooses again with halide_can_use_target_features on
+ * its next call. halide_set_custom_can_use_target_features calls this,
+ * so tests can force a particular sub-pipeline by installing a custom
+ * halide_can_use_target_features. Must not be called while a
+ * multitarget pipeline is choosing its sub-pipeline on another thread. */
+extern void halide_reset_multitarget_dispatch(void);
+
 typedef struct halide_dimension_t {
 #if (__cplusplus >= 201103L || _MSVC_LANG >= 201103L)
     int32_t min = 0, extent = 0, stride = 0;
@@ -1443,7 +1953,11 @@ typedef struct halide_dimension_t {
 #endif
 
 typedef enum { halide_buffer_flag_host_dirty = 1,
-               halide_buffer_flag_device_dirty = 2 } halide_buffer_flags;
+               halide_buffer_flag_device_dirty = 2,
+               /** The dirty flag only covers the regions recorded with
+                * halide_buffer_set_host_dirty_region or
+                * halide_buffer_set_device_dirty_region. */
+               halide_buffer_flag_dirty_region = 4 } halide_buffer_flags;
 
 /**
  * The raw representation of an image passed around by generated
@@ -1503,10 +2017,12 @@ typedef struct halide_buffer_t {
 
     HALIDE_ALWAYS_INLINE void set_host_dirty(bool v = true) {
         set_flag(halide_buffer_flag_host_dirty, v);
+        set_flag(halide_buffer_flag_dirty_region, false);
     }
 
     HALIDE_ALWAYS_INLINE void set_device_dirty(bool v = true) {
         set_flag(halide_buffer_flag_device_dirty, v);
+        set_flag(halide_buffer_flag_dirty_region, false);
     }
     // @}
 
@@ -1758,6 +2274,15 @@ struct halide_profiler_func_stats {
     /** The average number of thread pool worker threads active while computing this Func. */
     uint64_t active_threads_numerator, active_threads_denominator;
 
+    /** The number of times this Func's produce node was entered. Only
+     * counted by the instrumented profiler. */
+    uint64_t num_produces;
+
+    /** The memory allocation of this Func at the moment the heap usage
+     * of its pipeline peaked. Only tracked when the environment
+     * variable HL_PROFILER_MEMORY_TIMELINE is set. */
+    uint64_t memory_at_peak;
+
     /** The name of this Func. A global constant string. */
     const char *name;
 
@@ -1780,6 +2305,11 @@ struct halide_profiler_pipeline_stats {
     /** The total memory allocation of funcs in this pipeline. */
     uint64_t memory_total;
 
+    /** The time (from halide_current_time_ns) at which the heap usage
+     * of this pipeline peaked. Only tracked when the environment
+     * variable HL_PROFILER_MEMORY_TIMELINE is set. */
+    uint64_t memory_peak_time;
+
     /** The average number of thread pool worker threads doing useful
      * work while computing this pipeline. */
     uint64_t active_threads_numerator, active_threads_denominator;
@@ -1808,6 +2338,18 @@ struct halide_profiler_pipeline_stats {
 
     /** The total number of memory allocation of funcs in this pipeline. */
     int num_allocs;
+
+    /** The names of the branches counted by the instrumented
+     * profiler, each of the form "func\tcondition". Global constant
+     * strings. */
+    const char **branch_names;
+
+    /** For each branch, the number of times it was taken, followed by
+     * the number of times it was not. */
+    uint64_t *branch_counts;
+
+    /** The number of branches counted in this pipeline. */
+    int num_branches;
 };
 
 /** The global state of the profiler. */
@@ -1869,6 +2411,62 @@ extern struct halide_profiler_pipeline_stats *halide_profiler_get_pipeline_state
  * accurate time interval if desired. */
 extern int halide_profiler_sample(struct halide_profiler_state *s, uint64_t *prev_t);
 
+/** The kinds of region timed by the instrumented profiler. Regions of
+ * kind halide_profiler_region_none only pass their time on to the
+ * enclosing region. The others also appear in the exported trace. */
+enum halide_profiler_region_kind_t {
+    halide_profiler_region_none = 0,
+    halide_profiler_region_produce = 1,   ///< The produce node of a Func
+    halide_profiler_region_task = 2,      ///< A parallel loop iteration or forked task
+    halide_profiler_region_device = 3,    ///< A loop launched on a device, e.g. a GPU kernel
+    halide_profiler_region_copy = 4,      ///< A host <-> device buffer copy
+    halide_profiler_region_pipeline = 5,  ///< The whole pipeline
+};
+
+/** Called by pipelines compiled with the -profile_instrumented target
+ * flag on entry to a timed region. Zeroes the region's child-time
+ * accumulator and returns the current time in nanoseconds. */
+extern uint64_t halide_profiler_instrument_begin(uint64_t *child_time);
+
+/** Called by pipelines compiled with the -profile_instrumented target
+ * flag on exit from a timed region that began at time start. Bills the
+ * elapsed time, less any time recorded in child_time by nested regions,
+ * to func_id (unless it is negative), and adds the elapsed time to
+ * parent_child_time if it is non-null. kind is a
+ * halide_profiler_region_kind_t. Produce regions are also counted as
+ * one invocation of the Func.
+ *
+ * If the environment variable HL_PROFILER_TRACE_FILE names a file
+ * when the first pipeline starts, every region (and every heap
+ * allocation or free) is also recorded with its thread and start
+ * time, and written to that file in Chrome Trace Event JSON format
+ * whenever the profiler report is printed. The file can be loaded
+ * into Perfetto or chrome://tracing. */
+extern int halide_profiler_instrument_end(void *pipeline_state,
+                                          int func_id,
+                                          uint64_t start,
+                                          const uint64_t *child_time,
+                                          uint64_t *parent_child_time,
+                                          int kind);
+
+/** Called by pipelines compiled with the -profile_instrumented target
+ * flag at the start of every run, to name the branches at the top
+ * level of produce nodes that the pipeline counts. Each name is a
+ * global constant string of the form "func\tcondition".
+ *
+ * If the environment variable HL_PROFILER_BRANCH_FILE names a file,
+ * the branch counts of every pipeline are appended to it whenever the
+ * profiler report is printed, one branch per line as tab separated
+ * pipeline, func, condition, times taken and times not taken. The
+ * file can be passed to a generator with -b to guide code layout. */
+extern int halide_profiler_register_branches(void *pipeline_state,
+                                             int num_branches,
+                                             const uint64_t *branch_names);
+
+/** Called by pipelines compiled with the -profile_instrumented target
+ * flag on entry to either side of a counted branch. */
+extern int halide_profiler_count_branch(void *pipeline_state, int branch, int taken);
+
 /** Reset profiler state cheaply. May leave threads running or some
  * memory allocated but all accumluated statistics are reset.
  * WARNING: Do NOT call this method while any halide pipeline is
@@ -1885,7 +2483,15 @@ extern void halide_profiler_reset();
 void halide_profiler_shutdown();
 
 /** Print out timing statistics for everything run since the last
- * reset. Also happens at process exit. */
+ * reset. Also happens at process exit.
+ *
+ * If the environment variable HL_PROFILER_MEMORY_TIMELINE is set, the
+ * profiler also notes which Funcs hold heap memory at the moment each
+ * pipeline's heap usage peaks, and the report lists them along with
+ * the schedule change most likely to lower the peak. Heap allocations
+ * and frees then take a lock. With the profile_instrumented feature
+ * and HL_PROFILER_TRACE_FILE, the trace also gets a counter of each
+ * pipeline's heap usage, and an instant event at its peak. */
 extern void halide_profiler_report(void *user_context);
 
 /** For timer based profiling, this routine starts the timer chain running.
@@ -1933,11 +2539,14 @@ extern double halide_float16_bits_to_double(uint16_t);
  * quite slow, so it can be beneficial to set this to true. The
  * default value for now is false.
  *
- * Note that if enabled, the eviction policy is very simplistic. The
- * 32 most-recently used allocations are preserved, regardless of
- * their size. Additionally, if a call to cuMalloc results in an
- * out-of-memory error, the entire cache is flushed and the allocation
- * is retried. See https://github.com/halide/Halide/issues/4093
+ * If enabled, the GPU backends allocate from a pool of device memory
+ * (see halide_device_memory_pool_get_stats). Sizes are rounded up to
+ * size classes with only their top four bits set, and small
+ * allocations are packed into larger blocks where the device API
+ * allows it. Unused memory is kept until it is trimmed, or until the
+ * device API runs out of memory, in which case all of it is released
+ * and the allocation is retried. See
+ * https://github.com/halide/Halide/issues/4093
  *
  * If set to false, releases all unused device allocations back to the
  * underlying device APIs. For finer-grained control, see specific
@@ -1962,6 +2571,77 @@ struct halide_device_allocation_pool {
  * global lifetime, and its next field will be clobbered. */
 extern void halide_register_device_allocation_pool(struct halide_device_allocation_pool *);
 
+/** Statistics of the pool that a GPU backend allocates device memory
+ * from when halide_can_reuse_device_allocations returns true. */
+struct halide_device_memory_pool_stats_t {
+    /** Bytes reserved by live device allocations, rounded up to their size classes. */
+    uint64_t bytes_in_use;
+    /** Bytes of device memory held by the pool, whether in use or not. */
+    uint64_t bytes_allocated;
+    /** The high-water marks of the two fields above. */
+    uint64_t peak_bytes_in_use;
+    uint64_t peak_bytes_allocated;
+    /** The number of device allocations made from the pool. */
+    uint64_t num_allocations;
+    /** The number of those that needed more memory from the device API. */
+    uint64_t num_device_api_allocations;
+};
+
+/** Get the statistics of the device memory pool used by the given
+ * device interface. Returns halide_error_code_device_interface_no_device
+ * if it has no pool. */
+extern int halide_device_memory_pool_get_stats(void *user_context,
+                                               const struct halide_device_interface_t *device_interface,
+                                               struct halide_device_memory_pool_stats_t *stats);
+
+/** Return the unused memory held by the device memory pool of the given
+ * device interface, or of all device interfaces if it is null, to the
+ * underlying device API. Unlike halide_reuse_device_allocations(false),
+ * this leaves the pools enabled. */
+extern int halide_device_memory_pool_trim(void *user_context,
+                                          const struct halide_device_interface_t *device_interface);
+
+/** Set the most bytes of unused device memory that each device memory
+ * pool holds on to. When memory released to a pool takes it over the
+ * limit, the unused blocks of its device context are returned to the
+ * device API. A negative limit (the default) means no limit. Setting a limit also
+ * trims the pools as by halide_device_memory_pool_trim. */
+extern int halide_device_memory_pool_set_limit(void *user_context, int64_t bytes);
+
+/** Get the limit on the unused memory of each device memory pool.
+ * Override and switch based on the user_context for finer-grained
+ * control. By default just returns the value most recently set by the
+ * method above. */
+extern int64_t halide_device_memory_pool_get_limit(void *user_context);
+
+struct halide_device_memory_pool {
+    const struct halide_device_interface_t *device_interface;
+    int (*get_stats)(void *user_context, struct halide_device_memory_pool *pool,
+                     struct halide_device_memory_pool_stats_t *stats);
+    int (*trim)(void *user_context, struct halide_device_memory_pool *pool);
+    struct halide_device_memory_pool *next;
+};
+
+/** Register a device memory pool, to be found by the functions above
+ * and trimmed by halide_reuse_device_allocations(false). The object
+ * passed should have global lifetime, and its next field will be
+ * clobbered. */
+extern void halide_register_device_memory_pool(struct halide_device_memory_pool *);
+
+/** Set the directory in which the GPU runtimes keep the device binaries
+ * they compile kernels to, so that later processes running the same
+ * pipelines on the same device and driver can load them instead of
+ * compiling them again. The directory must already exist, and may be
+ * shared by concurrent processes. Passing null disables the cache. Until
+ * this is called, the directory is taken from the environment variable
+ * HL_GPU_KERNEL_CACHE_DIR, and if that is unset the cache is disabled.
+ * Currently used by the CUDA and OpenCL runtimes. */
+extern int halide_set_gpu_kernel_cache_dir(void *user_context, const char *dir);
+
+/** Get the directory set by halide_set_gpu_kernel_cache_dir, or null if
+ * the GPU kernel cache is disabled. */
+extern const char *halide_get_gpu_kernel_cache_dir(void *user_context);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -65,6 +65,14 @@ extern uintptr_t halide_cuda_get_device_ptr(void *user_context, struct halide_bu
  * driver. See halide_reuse_device_allocations. */
 extern int halide_cuda_release_unused_device_allocations(void *user_context);
 
+/** Return the number of threads per block that lets the most threads
+ * be resident at once on the current device, for a kernel using the
+ * given number of registers per thread and bytes of shared memory per
+ * block, or zero if no block size fits. Generated code calls this via
+ * Halide::gpu_preferred_block_size. */
+extern int halide_cuda_preferred_block_size(void *user_context, int registers_per_thread,
+                                            int shared_memory_per_block);
+
 // These typedefs treat both a CUcontext and a CUstream as a void *,
 // to avoid dependencies on cuda headers.
 typedef int (*halide_cuda_acquire_context_t)(void *,   // user_context
@@ -82,6 +90,53 @@ extern halide_cuda_release_context_t halide_set_cuda_release_context(halide_cuda
 extern halide_cuda_get_stream_t halide_set_cuda_get_stream(halide_cuda_get_stream_t handler);
 // @}
 
+/** A halide_cuda_get_stream_t handler that gives each distinct
+ * user_context its own non-blocking stream, drawn from a pool owned by
+ * the runtime. Install it with halide_set_cuda_get_stream (or as the
+ * custom_cuda_get_stream JIT handler) to let concurrent pipeline
+ * invocations with different user contexts overlap their copies and
+ * kernels on one GPU. All the copies, kernel launches and device syncs
+ * made with a user_context stay on its stream. While the pool is in
+ * use, the runtime records an event after each use of a device
+ * allocation, and makes a conflicting use on another stream wait for
+ * it, so buffers may be passed between user contexts as usual. (This
+ * is not done for device pointers wrapped with
+ * halide_cuda_wrap_device_ptr.) If the pool is exhausted, or the
+ * driver lacks stream support, the context's null stream is used
+ * instead. */
+extern int halide_cuda_stream_pool_get_stream(void *user_context, void *ctx, void **stream);
+
+/** Return the stream assigned to a user_context by
+ * halide_cuda_stream_pool_get_stream to the pool, so that it can be
+ * given to another user_context. Work already enqueued on it is not
+ * waited for. Call this when a user_context will not be used with
+ * Halide again. */
+extern int halide_cuda_stream_pool_release(void *user_context);
+
+/** Begin recording the kernel launches made with a user_context into
+ * a CUDA graph, identified by the given key, until the matching call
+ * to halide_cuda_graph_end. Bracket calls to a pipeline with these to
+ * cut the cost of launching its kernels when it is run many times
+ * with the same buffer shapes: the first session with a key launches
+ * kernels as usual while recording them, and makes them into a graph
+ * when it ends. Later sessions with the key defer their launches for
+ * as long as they exactly match the recorded ones, including device
+ * pointers and shapes, and launch the graph in their place when they
+ * end. Anything that differs, and any copy, sync or cuMemFree on the
+ * stream, ends the match: the deferred launches are made as usual,
+ * and the session records a new graph instead (if there were no copies
+ * or syncs between its launches). The session covers everything
+ * launched on the stream of the user_context, so concurrent pipeline
+ * invocations should use different streams, e.g. with
+ * halide_cuda_stream_pool_get_stream. Sessions on one stream can't
+ * nest. halide_cuda_graph_end must be called even if the pipeline
+ * fails. If the driver doesn't support CUDA graphs, both calls do
+ * nothing. */
+// @{
+extern int halide_cuda_graph_begin(void *user_context, uint64_t key);
+extern int halide_cuda_graph_end(void *user_context);
+// @}
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
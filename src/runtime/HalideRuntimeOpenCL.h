@@ -79,6 +79,22 @@ extern void halide_opencl_set_build_options(const char *n);
  * halide_opencl_set_build_options. */
 extern const char *halide_opencl_get_build_options(void *user_context);
 
+/** Set whether the command queue Halide creates for OpenCL should allow
+ * out-of-order execution, so that kernels and copies that don't depend
+ * on each other can overlap on the device. Halide still orders uses of
+ * the same buffer with events. Must be called before the first use of
+ * OpenCL to have any effect. If never called, Halide uses the
+ * environment variable HL_OCL_OUT_OF_ORDER_QUEUE. Devices that don't
+ * support out-of-order queues get an in-order one. */
+extern void halide_opencl_set_out_of_order_queue(bool enable);
+
+/** Halide calls this to get whether to create an out-of-order OpenCL
+ * command queue. Implement this yourself to decide per user_context. The
+ * default implementation returns the value set by
+ * halide_opencl_set_out_of_order_queue, or true if the environment
+ * variable HL_OCL_OUT_OF_ORDER_QUEUE is set to 1. */
+extern bool halide_opencl_get_out_of_order_queue(void *user_context);
+
 /** Set the underlying cl_mem for a halide_buffer_t. This memory should be
  * allocated using clCreateBuffer or similar and must have an extent
  * large enough to cover that specified by the halide_buffer_t extent
@@ -112,6 +128,15 @@ extern uintptr_t halide_opencl_get_cl_mem(void *user_context, struct halide_buff
 /** Returns the offset associated with the OpenCL memory allocation via device_crop or device_slice. */
 extern uint64_t halide_opencl_get_crop_offset(void *user_context, halide_buffer_t *buf);
 
+/** Return the largest power-of-two work-group size the current device
+ * supports, or zero if it has less local memory than
+ * shared_memory_per_block. OpenCL has no way to ask how much of the
+ * device a work-group of a given size can use without a compiled
+ * kernel, so registers_per_thread is ignored. Generated code calls
+ * this via Halide::gpu_preferred_block_size. */
+extern int halide_opencl_preferred_block_size(void *user_context, int registers_per_thread,
+                                              int shared_memory_per_block);
+
 #ifdef __cplusplus
 }  // End extern "C"
 #endif
@@ -0,0 +1,120 @@
+#ifndef HALIDE_HALIDERUNTIMEVULKAN_H
+#define HALIDE_HALIDERUNTIMEVULKAN_H
+
+// Don't include HalideRuntime.h if the contents of it were already pasted into a generated header above this one
+#ifndef HALIDE_HALIDERUNTIME_H
+
+#include "HalideRuntime.h"
+
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \file
+ *  Routines specific to the Halide Vulkan runtime.
+ */
+
+#define HALIDE_RUNTIME_VULKAN
+
+extern const struct halide_device_interface_t *halide_vulkan_device_interface();
+
+/** These are forward declared here to allow clients to override the
+ *  Halide Vulkan runtime. Do not call them. */
+// @{
+
+/** Create a shader module from the SPIR-V binary src, and the compute
+ * pipelines for its entry points as they are first run. */
+extern int halide_vulkan_initialize_kernels(void *user_context, void **state_ptr,
+                                            const char *src, int size);
+
+/** Run the named entry point of the shader module. The workgroup size
+ * is fixed by the shader, so threadsX, threadsY and threadsZ must match
+ * it. Scalar arguments are passed in a uniform buffer, widened to 32
+ * bits, followed by a storage buffer for each buffer argument. */
+extern int halide_vulkan_run(void *user_context,
+                             void *state_ptr,
+                             const char *entry_name,
+                             int blocksX, int blocksY, int blocksZ,
+                             int threadsX, int threadsY, int threadsZ,
+                             int shared_mem_bytes,
+                             struct halide_type_t arg_types[],
+                             void *args[],
+                             int8_t arg_is_buffer[]);
+
+extern void halide_vulkan_finalize_kernels(void *user_context, void *state_ptr);
+// @}
+
+struct halide_vulkan_instance;
+struct halide_vulkan_physical_device;
+struct halide_vulkan_device;
+struct halide_vulkan_queue;
+
+/** This prototype is exported as applications will typically need to
+ * replace it to get Halide filters to execute on the same device and
+ * queue used for other purposes. The halide_vulkan_instance is a
+ * VkInstance, halide_vulkan_physical_device is a VkPhysicalDevice,
+ * halide_vulkan_device is a VkDevice, and halide_vulkan_queue is a VkQueue
+ * of the queue family queue_family_index, which must support compute.
+ * The device must have been created with the VK_KHR_storage_buffer_storage_class
+ * extension (or Vulkan 1.1), and any of the 8- and 16-bit storage and
+ * arithmetic features the pipelines use. No reference counting is done by
+ * Halide on these objects. They must remain valid until all of the
+ * following are true:
+ * - A balancing halide_vulkan_release_context has occurred for each
+ *     halide_vulkan_acquire_context which returned the device/queue
+ * - All Halide filters using the context information have completed
+ * - All halide_buffer_t objects on the device have had
+ *     halide_device_free called.
+ * - halide_device_release has been called on the interface returned from
+ *     halide_vulkan_device_interface(). (This releases the pipelines and
+ *     the command and descriptor pools Halide created on the device.)
+ */
+extern int halide_vulkan_acquire_context(void *user_context,
+                                         struct halide_vulkan_instance **instance,
+                                         struct halide_vulkan_physical_device **physical_device,
+                                         struct halide_vulkan_device **device,
+                                         struct halide_vulkan_queue **queue,
+                                         uint32_t *queue_family_index,
+                                         bool create);
+
+/** This call balances each successful halide_vulkan_acquire_context call.
+ * If halide_vulkan_acquire_context is replaced, this routine must be replaced
+ * as well.
+ */
+extern int halide_vulkan_release_context(void *user_context);
+
+/** Set the underlying VkBuffer for a halide_buffer_t. This memory should be
+ * allocated using vkCreateBuffer with the storage buffer and transfer usages,
+ * bound to device memory, and must be large enough to cover the
+ * halide_buffer_t, as Halide does not take ownership of it. The device field
+ * of the halide_buffer_t must be NULL when this routine is called. This call
+ * can fail due to running out of memory. When this call succeeds, the
+ * buffer's VkBuffer must remain valid until halide_vulkan_detach_vk_buffer
+ * is called.
+ */
+extern int halide_vulkan_wrap_vk_buffer(void *user_context, struct halide_buffer_t *buf, uint64_t vk_buffer);
+
+/** Disconnect a halide_buffer_t from the VkBuffer it was previously
+ * wrapped around. Should only be called for a halide_buffer_t that
+ * halide_vulkan_wrap_vk_buffer was previously called on. Frees any
+ * storage associated with the binding of the halide_buffer_t and the
+ * VkBuffer, but does not destroy the VkBuffer. The device field of the
+ * halide_buffer_t will be NULL on return.
+ */
+extern int halide_vulkan_detach_vk_buffer(void *user_context, struct halide_buffer_t *buf);
+
+/** Return the underlying VkBuffer for a halide_buffer_t. This buffer must be
+ * valid on a Vulkan device, or not have any associated device memory. If
+ * there is no device memory (device field is NULL), this returns 0. Buffers
+ * sub-allocated from Halide's device memory pool, and crops, start at an
+ * offset into the VkBuffer.
+ */
+extern uintptr_t halide_vulkan_get_vk_buffer(void *user_context, struct halide_buffer_t *buf);
+
+#ifdef __cplusplus
+}  // End extern "C"
+#endif
+
+#endif  // HALIDE_HALIDERUNTIMEVULKAN_H
@@ -149,4 +149,22 @@ define weak_odr <8 x half> @fast_inverse_sqrt_f16x8(<8 x half> %x) nounwind alwa
        %correction = tail call <8 x half> @llvm.aarch64.neon.frsqrts.v8f16(<8 x half> %approx2, <8 x half> %x)
        %result = fmul <8 x half> %approx, %correction
        ret <8 x half> %result
-}
\ No newline at end of file
+}
+; bfloat16 dot products. Halide passes bfloat16 vectors as int16.
+
+declare <2 x float> @llvm.aarch64.neon.bfdot.v2f32.v4bf16(<2 x float>, <4 x bfloat>, <4 x bfloat>) nounwind readnone
+declare <4 x float> @llvm.aarch64.neon.bfdot.v4f32.v8bf16(<4 x float>, <8 x bfloat>, <8 x bfloat>) nounwind readnone
+
+define weak_odr <2 x float> @bfdot_f32x2(<2 x float> %init, <4 x i16> %a, <4 x i16> %b) nounwind alwaysinline {
+       %1 = bitcast <4 x i16> %a to <4 x bfloat>
+       %2 = bitcast <4 x i16> %b to <4 x bfloat>
+       %3 = tail call <2 x float> @llvm.aarch64.neon.bfdot.v2f32.v4bf16(<2 x float> %init, <4 x bfloat> %1, <4 x bfloat> %2)
+       ret <2 x float> %3
+}
+
+define weak_odr <4 x float> @bfdot_f32x4(<4 x float> %init, <8 x i16> %a, <8 x i16> %b) nounwind alwaysinline {
+       %1 = bitcast <8 x i16> %a to <8 x bfloat>
+       %2 = bitcast <8 x i16> %b to <8 x bfloat>
+       %3 = tail call <4 x float> @llvm.aarch64.neon.bfdot.v4f32.v8bf16(<4 x float> %init, <8 x bfloat> %1, <8 x bfloat> %2)
+       ret <4 x float> %3
+}
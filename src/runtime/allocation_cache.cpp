@@ -7,9 +7,11 @@ namespace Runtime {
 namespace Internal {
 
 WEAK bool halide_reuse_device_allocations_flag = true;
+WEAK int64_t halide_device_memory_pool_limit_bytes = -1;
 
 WEAK halide_mutex allocation_pools_lock;
 WEAK halide_device_allocation_pool *device_allocation_pools = nullptr;
+WEAK halide_device_memory_pool *device_memory_pools = nullptr;
 
 }  // namespace Internal
 }  // namespace Runtime
@@ -29,6 +31,12 @@ WEAK int halide_reuse_device_allocations(void *user_context, bool flag) {
                 err = ret;
             }
         }
+        for (halide_device_memory_pool *p = device_memory_pools; p != nullptr; p = p->next) {
+            int ret = p->trim(user_context, p);
+            if (ret) {
+                err = ret;
+            }
+        }
     }
     return err;
 }
@@ -42,9 +50,59 @@ WEAK bool halide_can_reuse_device_allocations(void *user_context) {
     return halide_reuse_device_allocations_flag;
 }
 
+WEAK int halide_device_memory_pool_set_limit(void *user_context, int64_t bytes) {
+    halide_device_memory_pool_limit_bytes = bytes;
+    // Bring the pools under the new limit now, rather than on their
+    // next release.
+    return bytes >= 0 ? halide_device_memory_pool_trim(user_context, nullptr) : halide_error_code_success;
+}
+
+WEAK int64_t halide_device_memory_pool_get_limit(void *user_context) {
+    return halide_device_memory_pool_limit_bytes;
+}
+
 WEAK void halide_register_device_allocation_pool(struct halide_device_allocation_pool *pool) {
     ScopedMutexLock lock(&allocation_pools_lock);
     pool->next = device_allocation_pools;
     device_allocation_pools = pool;
 }
+
+WEAK void halide_register_device_memory_pool(struct halide_device_memory_pool *pool) {
+    ScopedMutexLock lock(&allocation_pools_lock);
+    pool->next = device_memory_pools;
+    device_memory_pools = pool;
+}
+
+WEAK int halide_device_memory_pool_get_stats(void *user_context,
+                                             const struct halide_device_interface_t *device_interface,
+                                             struct halide_device_memory_pool_stats_t *stats) {
+    halide_device_memory_pool *pool = nullptr;
+    {
+        ScopedMutexLock lock(&allocation_pools_lock);
+        for (pool = device_memory_pools; pool != nullptr; pool = pool->next) {
+            if (pool->device_interface == device_interface) {
+                break;
+            }
+        }
+    }
+    if (pool == nullptr) {
+        return halide_error_code_device_interface_no_device;
+    }
+    return pool->get_stats(user_context, pool, stats);
+}
+
+WEAK int halide_device_memory_pool_trim(void *user_context,
+                                        const struct halide_device_interface_t *device_interface) {
+    int err = 0;
+    ScopedMutexLock lock(&allocation_pools_lock);
+    for (halide_device_memory_pool *p = device_memory_pools; p != nullptr; p = p->next) {
+        if (device_interface == nullptr || p->device_interface == device_interface) {
+            int ret = p->trim(user_context, p);
+            if (ret) {
+                err = ret;
+            }
+        }
+    }
+    return err;
+}
 }
@@ -0,0 +1,263 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+// A bump allocator for the heap allocations of pipelines compiled with
+// the bump_allocator target feature. An arena is acquired on entry to
+// the pipeline and to every parallel task, so it is only ever used by
+// one thread at a time and needs no locking. Allocations come off the
+// top of the arena, and are popped again when they and everything
+// above them have been freed. Released arenas go back to a free list
+// with their memory, so steady-state invocations rarely call
+// halide_malloc at all.
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Arena {
+
+// The smallest chunk we'll ask halide_malloc for.
+constexpr size_t min_chunk_size = 64 * 1024;
+
+// Allocations larger than this go straight to halide_malloc, so that
+// one huge intermediate doesn't stay pinned in a cached arena.
+constexpr size_t max_arena_allocation = 16 * 1024 * 1024;
+
+struct Chunk {
+    Chunk *prev, *next;
+    // The number of bytes of storage following the chunk header, and
+    // the number in use.
+    size_t capacity, used;
+};
+
+struct ArenaState;
+
+// Precedes every allocation. Allocations that did not come from an
+// arena have a null arena.
+struct Header {
+    ArenaState *arena;
+    Chunk *chunk;
+    // The allocation below this one in the arena.
+    Header *below;
+    size_t freed;
+};
+
+struct ArenaState {
+    ArenaState *next_free;
+    Chunk *first, *current;
+    Header *top;
+    // The capacity to give the first chunk, learned from the previous
+    // time this arena overflowed its chunks.
+    size_t preferred_capacity;
+};
+
+WEAK halide_mutex free_arenas_lock;
+WEAK ArenaState *free_arenas = nullptr;
+
+ALWAYS_INLINE size_t align_up(size_t x, size_t alignment) {
+    return (x + alignment - 1) & ~(alignment - 1);
+}
+
+ALWAYS_INLINE size_t header_size() {
+    return align_up(sizeof(Header), halide_malloc_alignment());
+}
+
+ALWAYS_INLINE uint8_t *chunk_data(Chunk *c) {
+    return (uint8_t *)c + align_up(sizeof(Chunk), halide_malloc_alignment());
+}
+
+WEAK void free_chunks(void *user_context, Chunk *c) {
+    while (c) {
+        Chunk *next = c->next;
+        halide_free(user_context, c);
+        c = next;
+    }
+}
+
+WEAK Chunk *new_chunk(void *user_context, size_t capacity) {
+    Chunk *c = (Chunk *)halide_malloc(user_context, align_up(sizeof(Chunk), halide_malloc_alignment()) + capacity);
+    if (c) {
+        c->prev = c->next = nullptr;
+        c->capacity = capacity;
+        c->used = 0;
+    }
+    return c;
+}
+
+WEAK void *fallback_malloc(void *user_context, size_t size) {
+    Header *h = (Header *)halide_malloc(user_context, header_size() + size);
+    if (!h) {
+        return nullptr;
+    }
+    h->arena = nullptr;
+    h->chunk = nullptr;
+    h->below = nullptr;
+    h->freed = 0;
+    return (uint8_t *)h + header_size();
+}
+
+WEAK void *default_begin(void *user_context) {
+    {
+        ScopedMutexLock lock(&free_arenas_lock);
+        if (free_arenas) {
+            ArenaState *a = free_arenas;
+            free_arenas = a->next_free;
+            a->next_free = nullptr;
+            return a;
+        }
+    }
+    ArenaState *a = (ArenaState *)halide_malloc(user_context, sizeof(ArenaState));
+    if (a) {
+        a->next_free = nullptr;
+        a->first = a->current = nullptr;
+        a->top = nullptr;
+        a->preferred_capacity = min_chunk_size;
+    }
+    return a;
+}
+
+WEAK void *default_malloc(void *user_context, void *arena, uint64_t size) {
+    ArenaState *a = (ArenaState *)arena;
+    const size_t alignment = halide_malloc_alignment();
+    if (!a || size > max_arena_allocation) {
+        return fallback_malloc(user_context, (size_t)size);
+    }
+    const size_t need = header_size() + align_up((size_t)size, alignment);
+
+    Chunk *c = a->current;
+    if (!c || c->capacity - c->used < need) {
+        // Move on to the next chunk, which is empty because everything
+        // above the current chunk has been popped.
+        Chunk *next = c ? c->next : a->first;
+        if (!next || next->capacity < need) {
+            size_t capacity = c ? c->capacity * 2 : a->preferred_capacity;
+            capacity = align_up(capacity < need ? need : capacity, alignment);
+            Chunk *fresh = new_chunk(user_context, capacity);
+            if (!fresh) {
+                return fallback_malloc(user_context, (size_t)size);
+            }
+            // Spare chunks too small for this allocation are discarded.
+            free_chunks(user_context, next);
+            fresh->prev = c;
+            if (c) {
+                c->next = fresh;
+            } else {
+                a->first = fresh;
+            }
+            next = fresh;
+        }
+        next->used = 0;
+        c = next;
+        a->current = c;
+    }
+
+    Header *h = (Header *)(chunk_data(c) + c->used);
+    c->used += need;
+    h->arena = a;
+    h->chunk = c;
+    h->below = a->top;
+    h->freed = 0;
+    a->top = h;
+    return (uint8_t *)h + header_size();
+}
+
+WEAK void default_free(void *user_context, void *ptr) {
+    Header *h = (Header *)((uint8_t *)ptr - header_size());
+    ArenaState *a = h->arena;
+    if (!a) {
+        halide_free(user_context, h);
+        return;
+    }
+    h->freed = 1;
+    // Pop everything on top of the arena that has been freed.
+    while (a->top && a->top->freed) {
+        Header *top = a->top;
+        top->chunk->used = (uint8_t *)top - chunk_data(top->chunk);
+        if (top->chunk->used == 0 && top->chunk->prev) {
+            a->current = top->chunk->prev;
+        }
+        a->top = top->below;
+    }
+}
+
+WEAK void default_end(void *user_context, void *arena) {
+    ArenaState *a = (ArenaState *)arena;
+    if (!a) {
+        return;
+    }
+    if (a->first && a->first->next) {
+        // This arena needed more than one chunk. Replace them with a
+        // single chunk big enough for all of them next time.
+        size_t total = 0;
+        for (Chunk *c = a->first; c; c = c->next) {
+            total += c->capacity;
+        }
+        free_chunks(user_context, a->first);
+        a->first = nullptr;
+        a->preferred_capacity = total;
+    } else if (a->first) {
+        a->first->used = 0;
+    }
+    a->current = a->first;
+    a->top = nullptr;
+
+    ScopedMutexLock lock(&free_arenas_lock);
+    a->next_free = free_arenas;
+    free_arenas = a;
+}
+
+WEAK halide_arena_interface_t default_arena_interface = {
+    default_begin,
+    default_malloc,
+    default_free,
+    default_end,
+};
+
+WEAK const halide_arena_interface_t *custom_arena = &default_arena_interface;
+
+}  // namespace Arena
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal::Arena;
+
+extern "C" {
+
+WEAK const halide_arena_interface_t *halide_set_custom_arena(const halide_arena_interface_t *arena) {
+    const halide_arena_interface_t *result = custom_arena;
+    custom_arena = arena ? arena : &default_arena_interface;
+    return result;
+}
+
+WEAK void *halide_arena_begin(void *user_context) {
+    return custom_arena->begin(user_context);
+}
+
+WEAK void *halide_arena_malloc(void *user_context, void *arena, uint64_t size) {
+    return custom_arena->malloc(user_context, arena, size);
+}
+
+WEAK void halide_arena_free(void *user_context, void *ptr) {
+    custom_arena->free(user_context, ptr);
+}
+
+WEAK void halide_arena_end(void *user_context, void *arena) {
+    custom_arena->end(user_context, arena);
+}
+
+WEAK void halide_arena_release_unused(void *user_context) {
+    ArenaState *arenas;
+    {
+        ScopedMutexLock lock(&free_arenas_lock);
+        arenas = free_arenas;
+        free_arenas = nullptr;
+    }
+    while (arenas) {
+        ArenaState *next = arenas->next_free;
+        free_chunks(user_context, arenas->first);
+        halide_free(user_context, arenas);
+        arenas = next;
+    }
+}
+}
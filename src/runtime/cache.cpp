@@ -84,6 +84,9 @@ struct CacheEntry {
     halide_buffer_t *buf;
     uint64_t eviction_key;
     bool has_eviction_key;
+    // The size of the device allocations the entry owns, which are
+    // charged to the device budget.
+    int64_t device_bytes;
 
     bool init(const uint8_t *cache_key, size_t cache_key_size,
               uint32_t key_hash,
@@ -163,9 +166,14 @@ WEAK bool CacheEntry::init(const uint8_t *cache_key, size_t cache_key_size,
         computed_bounds[i] = computed_bounds_buf->dim[i];
     }
 
-    // Copy over the tuple buffers and the shapes of the allocated regions
+    // Copy over the tuple buffers and the shapes of the allocated
+    // regions. Any device allocations now belong to the entry too.
+    device_bytes = 0;
     for (uint32_t i = 0; i < tuple_count; i++) {
         buf[i] = *tuple_buffers[i];
+        if (buf[i].device != 0) {
+            device_bytes += tuple_buffers[i]->size_in_bytes();
+        }
         buf[i].dim = computed_bounds + (i + 1) * dimensions;
         for (int j = 0; j < dimensions; j++) {
             buf[i].dim[j] = tuple_buffers[i]->dim[j];
@@ -188,56 +196,210 @@ WEAK void CacheEntry::destroy() {
     halide_free(nullptr, metadata_storage);
 }
 
-WEAK uint32_t djb_hash(const uint8_t *key, size_t key_size) {
-    uint32_t h = 5381;
-    for (size_t i = 0; i < key_size; i++) {
-        h = (h << 5) + h + key[i];
+// A fast hash over the whole key, consuming eight bytes at a time,
+// with a final avalanche so that both the low bits (used to pick a
+// bucket) and the high bits (used to pick a shard) are well mixed.
+WEAK uint32_t hash_key(const uint8_t *key, size_t key_size) {
+    const uint64_t m = 0xc6a4a7935bd1e995ULL;
+    uint64_t h = 0x8445d61a4e774912ULL ^ (key_size * m);
+    size_t i = 0;
+    for (; i + 8 <= key_size; i += 8) {
+        uint64_t w;
+        memcpy(&w, key + i, sizeof(w));
+        w *= m;
+        w ^= w >> 47;
+        h = (h ^ (w * m)) * m;
+    }
+    if (i < key_size) {
+        uint64_t w = 0;
+        memcpy(&w, key + i, key_size - i);
+        h = (h ^ w) * m;
     }
-    return h;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
 }
 
-WEAK halide_mutex memoization_lock = {{0}};
-
-const size_t kHashTableSize = 256;
+// The cache is split into shards, each with its own lock, hash
+// table and LRU list, so that concurrent lookups of different keys
+// rarely contend. The size limit is shared by all shards.
+struct CacheShard {
+    halide_mutex lock;
+
+    // Resizable hash table. num_buckets is zero or a power of two.
+    CacheEntry **buckets;
+    uint32_t num_buckets;
+    uint32_t num_entries;
+
+    CacheEntry *most_recently_used;
+    CacheEntry *least_recently_used;
+
+    // Statistics, reported by halide_memoization_cache_stats.
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t shared_hits;
+};
 
-WEAK CacheEntry *cache_entries[kHashTableSize];
+const int kShardBits = 4;
+const int kNumShards = 1 << kShardBits;
+const uint32_t kMinBuckets = 16;
 
-WEAK CacheEntry *most_recently_used = nullptr;
-WEAK CacheEntry *least_recently_used = nullptr;
+WEAK CacheShard cache_shards[kNumShards];
 
 const uint64_t kDefaultCacheSize = 1 << 20;
 WEAK int64_t max_cache_size = kDefaultCacheSize;
+// The total size of all shards. Modified atomically, as it is shared.
 WEAK int64_t current_cache_size = 0;
 
+// Device allocations held by entries have a budget of their own, as
+// device memory is usually scarcer than host memory.
+const uint64_t kDefaultDeviceCacheSize = 1 << 20;
+WEAK int64_t max_device_cache_size = kDefaultDeviceCacheSize;
+WEAK int64_t current_device_cache_size = 0;
+
+ALWAYS_INLINE CacheShard &shard_for_hash(uint32_t h) {
+    return cache_shards[h >> (32 - kShardBits)];
+}
+
+ALWAYS_INLINE CacheEntry **bucket_for_hash(CacheShard &shard, uint32_t h) {
+    return &shard.buckets[h & (shard.num_buckets - 1)];
+}
+
+ALWAYS_INLINE int64_t add_to_cache_size(int64_t bytes) {
+    return __atomic_add_fetch(&current_cache_size, bytes, __ATOMIC_RELAXED);
+}
+
+ALWAYS_INLINE int64_t add_to_device_cache_size(int64_t bytes) {
+    return __atomic_add_fetch(&current_device_cache_size, bytes, __ATOMIC_RELAXED);
+}
+
+ALWAYS_INLINE bool host_cache_over_size() {
+    return __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED) >
+           __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+}
+
+ALWAYS_INLINE bool device_cache_over_size() {
+    return __atomic_load_n(&current_device_cache_size, __ATOMIC_RELAXED) >
+           __atomic_load_n(&max_device_cache_size, __ATOMIC_RELAXED);
+}
+
+ALWAYS_INLINE bool cache_over_size() {
+    return host_cache_over_size() || device_cache_over_size();
+}
+
+// Double the number of buckets in a shard. Must be called with the
+// shard locked. If the allocation fails the shard keeps its current
+// buckets, which just makes the chains longer.
+WEAK void grow_buckets(CacheShard &shard) {
+    uint32_t new_num_buckets = shard.num_buckets ? shard.num_buckets * 2 : kMinBuckets;
+    CacheEntry **new_buckets = (CacheEntry **)halide_malloc(nullptr, sizeof(CacheEntry *) * new_num_buckets);
+    if (!new_buckets) {
+        return;
+    }
+    memset(new_buckets, 0, sizeof(CacheEntry *) * new_num_buckets);
+    for (uint32_t i = 0; i < shard.num_buckets; i++) {
+        CacheEntry *entry = shard.buckets[i];
+        while (entry != nullptr) {
+            CacheEntry *next = entry->next;
+            CacheEntry **bucket = &new_buckets[entry->hash & (new_num_buckets - 1)];
+            entry->next = *bucket;
+            *bucket = entry;
+            entry = next;
+        }
+    }
+    if (shard.buckets) {
+        halide_free(nullptr, shard.buckets);
+    }
+    shard.buckets = new_buckets;
+    shard.num_buckets = new_num_buckets;
+}
+
+WEAK void remove_from_lru(CacheShard &shard, CacheEntry *entry) {
+    if (entry->more_recent != nullptr) {
+        entry->more_recent->less_recent = entry->less_recent;
+    } else {
+        halide_abort_if_false(nullptr, shard.most_recently_used == entry);
+        shard.most_recently_used = entry->less_recent;
+    }
+    if (entry->less_recent != nullptr) {
+        entry->less_recent->more_recent = entry->more_recent;
+    } else {
+        halide_abort_if_false(nullptr, shard.least_recently_used == entry);
+        shard.least_recently_used = entry->more_recent;
+    }
+    entry->more_recent = nullptr;
+    entry->less_recent = nullptr;
+}
+
+WEAK void push_most_recent(CacheShard &shard, CacheEntry *entry) {
+    entry->more_recent = nullptr;
+    entry->less_recent = shard.most_recently_used;
+    if (shard.most_recently_used != nullptr) {
+        shard.most_recently_used->more_recent = entry;
+    }
+    shard.most_recently_used = entry;
+    if (shard.least_recently_used == nullptr) {
+        shard.least_recently_used = entry;
+    }
+}
+
+// Remove an entry from its shard and free it. Must be called with the
+// shard locked.
+WEAK void destroy_entry(void *user_context, CacheShard &shard, CacheEntry *entry) {
+    CacheEntry **prev = bucket_for_hash(shard, entry->hash);
+    while (*prev != entry) {
+        halide_abort_if_false(user_context, *prev != nullptr);
+        prev = &(*prev)->next;
+    }
+    *prev = entry->next;
+    remove_from_lru(shard, entry);
+    shard.num_entries--;
+
+    int64_t entry_size = 0;
+    for (uint32_t i = 0; i < entry->tuple_count; i++) {
+        entry_size += entry->buf[i].size_in_bytes();
+    }
+    add_to_cache_size(-entry_size);
+    add_to_device_cache_size(-entry->device_bytes);
+
+    entry->destroy();
+    halide_free(user_context, entry);
+}
+
 #if CACHE_DEBUGGING
-WEAK void validate_cache() {
-    print(nullptr) << "validating cache, "
-                   << "current size " << current_cache_size
-                   << " of maximum " << max_cache_size << "\n";
-    int entries_in_hash_table = 0;
-    for (size_t i = 0; i < kHashTableSize; i++) {
-        CacheEntry *entry = cache_entries[i];
+WEAK void validate_shard(CacheShard &shard) {
+    uint32_t entries_in_hash_table = 0;
+    for (uint32_t i = 0; i < shard.num_buckets; i++) {
+        CacheEntry *entry = shard.buckets[i];
         while (entry != nullptr) {
             entries_in_hash_table++;
-            if (entry->more_recent == nullptr && entry != most_recently_used) {
+            if (entry->more_recent == nullptr && entry != shard.most_recently_used) {
                 halide_print(nullptr, "cache invalid case 1\n");
                 __builtin_trap();
             }
-            if (entry->less_recent == nullptr && entry != least_recently_used) {
+            if (entry->less_recent == nullptr && entry != shard.least_recently_used) {
                 halide_print(nullptr, "cache invalid case 2\n");
                 __builtin_trap();
             }
+            if ((entry->hash & (shard.num_buckets - 1)) != i) {
+                halide_print(nullptr, "cache entry in wrong bucket\n");
+                __builtin_trap();
+            }
             entry = entry->next;
         }
     }
-    int entries_from_mru = 0;
-    CacheEntry *mru_chain = most_recently_used;
+    uint32_t entries_from_mru = 0;
+    CacheEntry *mru_chain = shard.most_recently_used;
     while (mru_chain != nullptr) {
         entries_from_mru++;
         mru_chain = mru_chain->less_recent;
     }
-    int entries_from_lru = 0;
-    CacheEntry *lru_chain = least_recently_used;
+    uint32_t entries_from_lru = 0;
+    CacheEntry *lru_chain = shard.least_recently_used;
     while (lru_chain != nullptr) {
         entries_from_lru++;
         lru_chain = lru_chain->more_recent;
@@ -245,7 +407,8 @@ WEAK void validate_cache() {
     print(nullptr) << "hash entries " << entries_in_hash_table
                    << ", mru entries " << entries_from_mru
                    << ", lru entries " << entries_from_lru << "\n";
-    if (entries_in_hash_table != entries_from_mru) {
+    if (entries_in_hash_table != entries_from_mru ||
+        entries_in_hash_table != shard.num_entries) {
         halide_print(nullptr, "cache invalid case 3\n");
         __builtin_trap();
     }
@@ -253,69 +416,420 @@ WEAK void validate_cache() {
         halide_print(nullptr, "cache invalid case 4\n");
         __builtin_trap();
     }
-    if (current_cache_size < 0) {
+    if (current_cache_size < 0 || current_device_cache_size < 0) {
         halide_print(nullptr, "cache size is negative\n");
         __builtin_trap();
     }
 }
 #endif
 
-WEAK void prune_cache() {
+// Evict unused entries from one shard, least recently used first,
+// until the cache as a whole fits. If only the device budget is
+// exceeded, only entries holding device allocations are evicted. Must
+// be called with the shard locked.
+WEAK void prune_shard(CacheShard &shard) {
 #if CACHE_DEBUGGING
-    validate_cache();
+    validate_shard(shard);
 #endif
-    CacheEntry *prune_candidate = least_recently_used;
-    while (current_cache_size > max_cache_size &&
-           prune_candidate != nullptr) {
+    CacheEntry *prune_candidate = shard.least_recently_used;
+    while (cache_over_size() && prune_candidate != nullptr) {
         CacheEntry *more_recent = prune_candidate->more_recent;
+        if (prune_candidate->in_use_count == 0 &&
+            (prune_candidate->device_bytes > 0 || host_cache_over_size())) {
+            destroy_entry(nullptr, shard, prune_candidate);
+            shard.evictions++;
+        }
+        prune_candidate = more_recent;
+    }
+#if CACHE_DEBUGGING
+    validate_shard(shard);
+#endif
+}
 
-        if (prune_candidate->in_use_count == 0) {
-            uint32_t h = prune_candidate->hash;
-            uint32_t index = h % kHashTableSize;
-
-            // Remove from hash table
-            CacheEntry *prev_hash_entry = cache_entries[index];
-            if (prev_hash_entry == prune_candidate) {
-                cache_entries[index] = prune_candidate->next;
-            } else {
-                while (prev_hash_entry != nullptr && prev_hash_entry->next != prune_candidate) {
-                    prev_hash_entry = prev_hash_entry->next;
-                }
-                halide_abort_if_false(nullptr, prev_hash_entry != nullptr);
-                prev_hash_entry->next = prune_candidate->next;
+// Prune shards one at a time until the cache fits. Must be called
+// with no shard locked.
+WEAK void prune_cache() {
+    for (int i = 0; i < kNumShards && cache_over_size(); i++) {
+        ScopedMutexLock lock(&cache_shards[i].lock);
+        prune_shard(cache_shards[i]);
+    }
+}
+
+WEAK CacheEntry *find_entry(CacheShard &shard, uint32_t h,
+                            const uint8_t *cache_key, int32_t size,
+                            const halide_buffer_t *computed_bounds,
+                            int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    if (shard.num_buckets == 0) {
+        return nullptr;
+    }
+    CacheEntry *entry = *bucket_for_hash(shard, h);
+    while (entry != nullptr) {
+        if (entry->hash == h && entry->key_size == (size_t)size &&
+            keys_equal(entry->key, cache_key, size) &&
+            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
+            entry->tuple_count == (uint32_t)tuple_count) {
+
+            // Check all the tuple buffers have the same bounds (they should).
+            bool all_bounds_equal = true;
+            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
+                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+            }
+            if (all_bounds_equal) {
+                return entry;
+            }
+        }
+        entry = entry->next;
+    }
+    return nullptr;
+}
+
+// An optional second level of the cache, in a region of memory shared
+// by several processes (e.g. a mapped file), so that they share their
+// results, and results outlive the processes if the file does. The
+// region starts with a header, followed by a table of slots, followed
+// by the records, which are allocated from the rest of the region by
+// bumping an offset. Everything in it is referred to by offset, as
+// each process maps it at a different address. Records are written
+// before they are published in a slot, and are never changed or freed
+// afterwards, so looking them up needs no locks. Entries are never
+// evicted; once the region is full, nothing more is added to it.
+struct SharedCacheHeader {
+    uint64_t magic;
+    uint64_t size;
+    uint64_t num_slots;  // A power of two
+    uint64_t records_end;
+    uint32_t state;
+    uint32_t reserved;
+};
+
+struct SharedCacheSlot {
+    uint64_t hash;    // 0 if empty
+    uint64_t record;  // The offset of the record, 0 until published
+};
+
+// Followed by the key, the computed bounds, and then for each tuple
+// element a SharedCacheTuple, its allocated shape and its data, each
+// padded to a multiple of eight bytes.
+struct SharedCacheRecord {
+    uint64_t key_size;
+    int32_t dimensions;
+    int32_t tuple_count;
+};
+
+struct SharedCacheTuple {
+    halide_type_t type;
+    uint32_t reserved;
+    uint64_t data_size;
+};
+
+const uint64_t kSharedCacheMagic = 0x314f4d454d4c4821ULL;  // "!HLMEMO1"
+const uint32_t kSharedCacheUninitialized = 0;
+const uint32_t kSharedCacheInitializing = 1;
+const uint32_t kSharedCacheReady = 2;
+const int kSharedCacheMaxProbes = 64;
+
+WEAK uint8_t *shared_region = nullptr;
+
+ALWAYS_INLINE uint64_t align_to_8(uint64_t x) {
+    return (x + 7) & ~(uint64_t)7;
+}
+
+ALWAYS_INLINE SharedCacheHeader *shared_header() {
+    return (SharedCacheHeader *)shared_region;
+}
+
+ALWAYS_INLINE SharedCacheSlot *shared_slots() {
+    return (SharedCacheSlot *)(shared_region + align_to_8(sizeof(SharedCacheHeader)));
+}
+
+// Cache keys start with a pointer to a string naming the pipeline and
+// the Func, which includes a fingerprint of the Func's algorithm,
+// followed by a counter that distinguishes JIT compilations, and then
+// the values the Func depends on. The pointer and the counter mean
+// nothing to other processes, so the key used in the shared region is
+// the string followed by the values.
+struct SharedKey {
+    const char *name;
+    size_t name_size;
+    const uint8_t *values;
+    size_t values_size;
+
+    SharedKey(const uint8_t *cache_key, int32_t size) {
+        memcpy(&name, cache_key, sizeof(name));
+        name_size = strlen(name);
+        const size_t prefix = 8 + 4;
+        values = cache_key + prefix;
+        values_size = size > (int32_t)prefix ? size - prefix : 0;
+    }
+
+    size_t size() const {
+        return name_size + values_size;
+    }
+
+    uint64_t hash() const {
+        // FNV-1a, made nonzero, as zero marks an empty slot.
+        uint64_t h = 0xcbf29ce484222325ULL;
+        for (size_t i = 0; i < name_size; i++) {
+            h = (h ^ (uint8_t)name[i]) * 0x100000001b3ULL;
+        }
+        for (size_t i = 0; i < values_size; i++) {
+            h = (h ^ values[i]) * 0x100000001b3ULL;
+        }
+        return h | 1;
+    }
+
+    bool matches(const uint8_t *stored, size_t stored_size) const {
+        return stored_size == size() &&
+               memcmp(stored, name, name_size) == 0 &&
+               memcmp(stored + name_size, values, values_size) == 0;
+    }
+
+    void copy_to(uint8_t *dst) const {
+        memcpy(dst, name, name_size);
+        memcpy(dst + name_size, values, values_size);
+    }
+};
+
+ALWAYS_INLINE uint64_t shape_bytes(int32_t dimensions) {
+    return align_to_8(sizeof(halide_dimension_t) * dimensions);
+}
+
+WEAK uint64_t shared_record_bytes(const SharedKey &key, const halide_buffer_t *computed_bounds,
+                                  int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    uint64_t bytes = sizeof(SharedCacheRecord) + align_to_8(key.size()) +
+                     shape_bytes(computed_bounds->dimensions);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        bytes += sizeof(SharedCacheTuple) + shape_bytes(computed_bounds->dimensions) +
+                 align_to_8(tuple_buffers[i]->size_in_bytes());
+    }
+    return bytes;
+}
+
+// Find a published record with the given key and shapes that fits the
+// given buffers, or return null.
+WEAK const SharedCacheRecord *find_shared_record(const SharedKey &key, uint64_t h,
+                                                 const halide_buffer_t *computed_bounds,
+                                                 int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedCacheSlot *slots = shared_slots();
+    uint64_t mask = shared_header()->num_slots - 1;
+    for (int probe = 0; probe < kSharedCacheMaxProbes; probe++) {
+        SharedCacheSlot &slot = slots[(h + probe) & mask];
+        uint64_t slot_hash = __atomic_load_n(&slot.hash, __ATOMIC_ACQUIRE);
+        if (slot_hash == 0) {
+            return nullptr;
+        }
+        uint64_t offset = __atomic_load_n(&slot.record, __ATOMIC_ACQUIRE);
+        if (slot_hash != h || offset == 0) {
+            continue;
+        }
+        const SharedCacheRecord *record = (const SharedCacheRecord *)(shared_region + offset);
+        const uint8_t *p = (const uint8_t *)(record + 1);
+        if (record->dimensions != computed_bounds->dimensions ||
+            record->tuple_count != tuple_count ||
+            !key.matches(p, record->key_size)) {
+            continue;
+        }
+        p += align_to_8(record->key_size);
+        bool match = buffer_has_shape(computed_bounds, (const halide_dimension_t *)p);
+        p += shape_bytes(record->dimensions);
+        for (int32_t i = 0; match && i < tuple_count; i++) {
+            const SharedCacheTuple *tuple = (const SharedCacheTuple *)p;
+            p += sizeof(SharedCacheTuple);
+            match = (tuple->type == tuple_buffers[i]->type &&
+                     tuple->data_size == tuple_buffers[i]->size_in_bytes() &&
+                     buffer_has_shape(tuple_buffers[i], (const halide_dimension_t *)p));
+            p += shape_bytes(record->dimensions) + align_to_8(tuple->data_size);
+        }
+        if (match) {
+            return record;
+        }
+    }
+    return nullptr;
+}
+
+// Copy the data of a record found by find_shared_record into the
+// host allocations of the buffers.
+WEAK void copy_from_shared_record(const SharedCacheRecord *record,
+                                  int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    const uint8_t *p = (const uint8_t *)(record + 1);
+    p += align_to_8(record->key_size) + shape_bytes(record->dimensions);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        const SharedCacheTuple *tuple = (const SharedCacheTuple *)p;
+        p += sizeof(SharedCacheTuple) + shape_bytes(record->dimensions);
+        memcpy(tuple_buffers[i]->host, p, tuple->data_size);
+        p += align_to_8(tuple->data_size);
+    }
+}
+
+// Add a record for the given buffers to the shared region, unless it
+// already has one, or is full.
+WEAK void publish_shared_record(const SharedKey &key, uint64_t h,
+                                const halide_buffer_t *computed_bounds,
+                                int32_t tuple_count, halide_buffer_t **tuple_buffers) {
+    SharedCacheHeader *header = shared_header();
+    SharedCacheSlot *slots = shared_slots();
+    uint64_t mask = header->num_slots - 1;
+    SharedCacheSlot *claimed = nullptr;
+    for (int probe = 0; !claimed && probe < kSharedCacheMaxProbes; probe++) {
+        SharedCacheSlot &slot = slots[(h + probe) & mask];
+        uint64_t slot_hash = __atomic_load_n(&slot.hash, __ATOMIC_ACQUIRE);
+        if (slot_hash == 0) {
+            if (__atomic_compare_exchange_n(&slot.hash, &slot_hash, h, false,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+                claimed = &slot;
+                break;
             }
+            // Another writer claimed it first; slot_hash now holds
+            // the hash it claimed it with.
+        }
+        if (slot_hash == h &&
+            find_shared_record(key, h, computed_bounds, tuple_count, tuple_buffers)) {
+            return;
+        }
+    }
+    if (!claimed) {
+        return;
+    }
+
+    // If the region is full, the slot stays claimed with no record,
+    // which lookups skip over.
+    uint64_t bytes = shared_record_bytes(key, computed_bounds, tuple_count, tuple_buffers);
+    uint64_t offset = __atomic_fetch_add(&header->records_end, bytes, __ATOMIC_RELAXED);
+    if (offset + bytes > header->size) {
+        return;
+    }
+
+    SharedCacheRecord *record = (SharedCacheRecord *)(shared_region + offset);
+    record->key_size = key.size();
+    record->dimensions = computed_bounds->dimensions;
+    record->tuple_count = tuple_count;
+    uint8_t *p = (uint8_t *)(record + 1);
+    key.copy_to(p);
+    p += align_to_8(key.size());
+    halide_dimension_t *shape = (halide_dimension_t *)p;
+    for (int32_t j = 0; j < computed_bounds->dimensions; j++) {
+        shape[j] = computed_bounds->dim[j];
+    }
+    p += shape_bytes(computed_bounds->dimensions);
+    for (int32_t i = 0; i < tuple_count; i++) {
+        const halide_buffer_t *buf = tuple_buffers[i];
+        SharedCacheTuple *tuple = (SharedCacheTuple *)p;
+        tuple->type = buf->type;
+        tuple->reserved = 0;
+        tuple->data_size = buf->size_in_bytes();
+        p += sizeof(SharedCacheTuple);
+        shape = (halide_dimension_t *)p;
+        for (int32_t j = 0; j < buf->dimensions; j++) {
+            shape[j] = buf->dim[j];
+        }
+        p += shape_bytes(computed_bounds->dimensions);
+        memcpy(p, buf->host, tuple->data_size);
+        p += align_to_8(tuple->data_size);
+    }
+
+    __atomic_store_n(&claimed->record, offset, __ATOMIC_RELEASE);
+}
+
+// Store an entry in this process's cache.
+WEAK int store_in_process(void *user_context, const uint8_t *cache_key, int32_t size,
+                          halide_buffer_t *computed_bounds,
+                          int32_t tuple_count, halide_buffer_t **tuple_buffers,
+                          bool has_eviction_key, uint64_t eviction_key) {
+    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
+    CacheShard &shard = shard_for_hash(h);
+
+#if CACHE_DEBUGGING
+    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
+
+    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
+
+    {
+        for (int32_t i = 0; i < tuple_count; i++) {
+            halide_buffer_t *buf = tuple_buffers[i];
+            debug_print_buffer(user_context, "Allocation bounds", *buf);
+        }
+    }
+#endif
 
-            // Remove from less recent chain.
-            if (least_recently_used == prune_candidate) {
-                least_recently_used = more_recent;
+    {
+        ScopedMutexLock lock(&shard.lock);
+
+        CacheEntry *entry = find_entry(shard, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers);
+        if (entry != nullptr) {
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_abort_if_false(user_context, entry->buf[i].host != tuple_buffers[i]->host);
             }
-            if (more_recent != nullptr) {
-                more_recent->less_recent = prune_candidate->less_recent;
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
             }
+            return 0;
+        }
 
-            // Remove from more recent chain.
-            if (most_recently_used == prune_candidate) {
-                most_recently_used = prune_candidate->less_recent;
+        int64_t added_size = 0, added_device_size = 0;
+        for (int32_t i = 0; i < tuple_count; i++) {
+            added_size += tuple_buffers[i]->size_in_bytes();
+            if (tuple_buffers[i]->device != 0) {
+                added_device_size += tuple_buffers[i]->size_in_bytes();
             }
-            if (prune_candidate->less_recent != nullptr) {
-                prune_candidate->less_recent = more_recent;
+        }
+        add_to_cache_size(added_size);
+        add_to_device_cache_size(added_device_size);
+        // Make room in this shard first, before the new entry is
+        // inserted so that it can't evict itself.
+        prune_shard(shard);
+
+        if (shard.num_entries >= shard.num_buckets) {
+            grow_buckets(shard);
+        }
+
+        CacheEntry *new_entry = nullptr;
+        if (shard.num_buckets != 0) {
+            new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
+        }
+        bool inited = false;
+        if (new_entry) {
+            inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
+                                     has_eviction_key, eviction_key);
+        }
+        if (!inited) {
+            add_to_cache_size(-added_size);
+            add_to_device_cache_size(-added_device_size);
+
+            // This entry is still in use by the caller. Mark it as having no cache entry
+            // so halide_memoization_cache_release can free the buffer.
+            for (int32_t i = 0; i < tuple_count; i++) {
+                get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
             }
 
-            // Decrease cache used amount.
-            for (uint32_t i = 0; i < prune_candidate->tuple_count; i++) {
-                current_cache_size -= prune_candidate->buf[i].size_in_bytes();
+            if (new_entry) {
+                halide_free(user_context, new_entry);
             }
+            return 0;
+        }
+
+        CacheEntry **bucket = bucket_for_hash(shard, h);
+        new_entry->next = *bucket;
+        *bucket = new_entry;
+        push_most_recent(shard, new_entry);
+        shard.num_entries++;
 
-            // Deallocate the entry.
-            prune_candidate->destroy();
-            halide_free(nullptr, prune_candidate);
+        new_entry->in_use_count = tuple_count;
+
+        for (int32_t i = 0; i < tuple_count; i++) {
+            get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
         }
 
-        prune_candidate = more_recent;
-    }
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+
+    // If this shard had nothing left to evict, make room in the others.
+    prune_cache();
+
+    return 0;
 }
 
 }  // namespace Internal
@@ -329,18 +843,66 @@ WEAK void halide_memoization_cache_set_size(int64_t size) {
         size = kDefaultCacheSize;
     }
 
-    ScopedMutexLock lock(&memoization_lock);
+    __atomic_store_n(&max_cache_size, size, __ATOMIC_RELAXED);
+    prune_cache();
+}
+
+WEAK void halide_memoization_cache_set_device_size(int64_t size) {
+    if (size == 0) {
+        size = kDefaultDeviceCacheSize;
+    }
 
-    max_cache_size = size;
+    __atomic_store_n(&max_device_cache_size, size, __ATOMIC_RELAXED);
     prune_cache();
 }
 
+WEAK int halide_memoization_cache_set_shared_region(void *user_context, void *region, int64_t size) {
+    if (region == nullptr) {
+        shared_region = nullptr;
+        return halide_error_code_success;
+    }
+
+    SharedCacheHeader *header = (SharedCacheHeader *)region;
+    uint32_t state = kSharedCacheUninitialized;
+    if (__atomic_compare_exchange_n(&header->state, &state, kSharedCacheInitializing, false,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        // This is a new region, which must be all zeros. Use about one
+        // slot per 4k of records.
+        uint64_t num_slots = 64;
+        while (num_slots * 2 * 4096 <= (uint64_t)size) {
+            num_slots *= 2;
+        }
+        uint64_t records_begin = align_to_8(sizeof(SharedCacheHeader)) + num_slots * sizeof(SharedCacheSlot);
+        if ((uint64_t)size < records_begin) {
+            __atomic_store_n(&header->state, kSharedCacheUninitialized, __ATOMIC_RELEASE);
+            error(user_context) << "Memoization cache shared region of " << size << " bytes is too small\n";
+            return halide_error_code_generic_error;
+        }
+        header->magic = kSharedCacheMagic;
+        header->size = size;
+        header->num_slots = num_slots;
+        header->records_end = records_begin;
+        __atomic_store_n(&header->state, kSharedCacheReady, __ATOMIC_RELEASE);
+    } else {
+        // Another process or thread is setting it up, or has done so.
+        while (state == kSharedCacheInitializing) {
+            halide_thread_yield();
+            state = __atomic_load_n(&header->state, __ATOMIC_ACQUIRE);
+        }
+        if (header->magic != kSharedCacheMagic || header->size != (uint64_t)size) {
+            error(user_context) << "Memoization cache shared region is not in the expected format\n";
+            return halide_error_code_generic_error;
+        }
+    }
+
+    shared_region = (uint8_t *)region;
+    return halide_error_code_success;
+}
+
 WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cache_key, int32_t size,
                                          halide_buffer_t *computed_bounds, int32_t tuple_count, halide_buffer_t **tuple_buffers) {
-    uint32_t h = djb_hash(cache_key, size);
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
+    uint32_t h = hash_key(cache_key, size);
+    CacheShard &shard = shard_for_hash(h);
 
 #if CACHE_DEBUGGING
     debug_print_key(user_context, "halide_memoization_cache_lookup", cache_key, size);
@@ -355,52 +917,31 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
     }
 #endif
 
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
+    {
+        ScopedMutexLock lock(&shard.lock);
 
-            // Check all the tuple buffers have the same bounds (they should).
-            bool all_bounds_equal = true;
-            for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
+        CacheEntry *entry = find_entry(shard, h, cache_key, size, computed_bounds, tuple_count, tuple_buffers);
+        if (entry != nullptr) {
+            if (entry != shard.most_recently_used) {
+                remove_from_lru(shard, entry);
+                push_most_recent(shard, entry);
             }
 
-            if (all_bounds_equal) {
-                if (entry != most_recently_used) {
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        halide_abort_if_false(user_context, least_recently_used == entry);
-                        least_recently_used = entry->more_recent;
-                    }
-                    halide_abort_if_false(user_context, entry->more_recent != nullptr);
-                    entry->more_recent->less_recent = entry->less_recent;
-
-                    entry->more_recent = nullptr;
-                    entry->less_recent = most_recently_used;
-                    if (most_recently_used != nullptr) {
-                        most_recently_used->more_recent = entry;
-                    }
-                    most_recently_used = entry;
-                }
-
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    *buf = entry->buf[i];
-                }
+            for (int32_t i = 0; i < tuple_count; i++) {
+                halide_buffer_t *buf = tuple_buffers[i];
+                *buf = entry->buf[i];
+            }
 
-                entry->in_use_count += tuple_count;
+            entry->in_use_count += tuple_count;
+            shard.hits++;
 
-                return 0;
-            }
+            return 0;
         }
-        entry = entry->next;
+
+        shard.misses++;
     }
 
+    // Allocating the storage for a miss doesn't need the lock.
     for (int32_t i = 0; i < tuple_count; i++) {
         halide_buffer_t *buf = tuple_buffers[i];
 
@@ -418,9 +959,23 @@ WEAK int halide_memoization_cache_lookup(void *user_context, const uint8_t *cach
         header->entry = nullptr;
     }
 
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
+    if (shared_region != nullptr) {
+        SharedKey shared_key(cache_key, size);
+        const SharedCacheRecord *record =
+            find_shared_record(shared_key, shared_key.hash(), computed_bounds, tuple_count, tuple_buffers);
+        if (record != nullptr) {
+            copy_from_shared_record(record, tuple_count, tuple_buffers);
+            {
+                ScopedMutexLock lock(&shard.lock);
+                shard.shared_hits++;
+            }
+            // Keep it in this process's cache too, as if it had just
+            // been computed.
+            store_in_process(user_context, cache_key, size, computed_bounds,
+                             tuple_count, tuple_buffers, false, 0);
+            return 0;
+        }
+    }
 
     return 1;
 }
@@ -431,110 +986,23 @@ WEAK int halide_memoization_cache_store(void *user_context, const uint8_t *cache
                                         bool has_eviction_key, uint64_t eviction_key) {
     debug(user_context) << "halide_memoization_cache_store has_eviction_key: " << has_eviction_key << " eviction_key " << eviction_key << " .\n";
 
-    uint32_t h = get_pointer_to_header(tuple_buffers[0]->host)->hash;
-
-    uint32_t index = h % kHashTableSize;
-
-    ScopedMutexLock lock(&memoization_lock);
-
-#if CACHE_DEBUGGING
-    debug_print_key(user_context, "halide_memoization_cache_store", cache_key, size);
-
-    debug_print_buffer(user_context, "computed_bounds", *computed_bounds);
-
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            debug_print_buffer(user_context, "Allocation bounds", *buf);
-        }
-    }
-#endif
-
-    CacheEntry *entry = cache_entries[index];
-    while (entry != nullptr) {
-        if (entry->hash == h && entry->key_size == (size_t)size &&
-            keys_equal(entry->key, cache_key, size) &&
-            buffer_has_shape(computed_bounds, entry->computed_bounds) &&
-            entry->tuple_count == (uint32_t)tuple_count) {
+    int result = store_in_process(user_context, cache_key, size, computed_bounds,
+                                  tuple_count, tuple_buffers, has_eviction_key, eviction_key);
 
-            bool all_bounds_equal = true;
-            bool no_host_pointers_equal = true;
-            {
-                for (int32_t i = 0; all_bounds_equal && i < tuple_count; i++) {
-                    halide_buffer_t *buf = tuple_buffers[i];
-                    all_bounds_equal = buffer_has_shape(tuple_buffers[i], entry->buf[i].dim);
-                    if (entry->buf[i].host == buf->host) {
-                        no_host_pointers_equal = false;
-                    }
-                }
-            }
-            if (all_bounds_equal) {
-                halide_abort_if_false(user_context, no_host_pointers_equal);
-                // This entry is still in use by the caller. Mark it as having no cache entry
-                // so halide_memoization_cache_release can free the buffer.
-                for (int32_t i = 0; i < tuple_count; i++) {
-                    get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
-                }
-                return 0;
-            }
-        }
-        entry = entry->next;
+    // Entries with an eviction key aren't shared, as they couldn't be
+    // evicted from the shared region.
+    bool publish = (shared_region != nullptr && !has_eviction_key);
+    for (int32_t i = 0; publish && i < tuple_count; i++) {
+        publish = !tuple_buffers[i]->device_dirty();
     }
-
-    uint64_t added_size = 0;
-    {
-        for (int32_t i = 0; i < tuple_count; i++) {
-            halide_buffer_t *buf = tuple_buffers[i];
-            added_size += buf->size_in_bytes();
-        }
-    }
-    current_cache_size += added_size;
-    prune_cache();
-
-    CacheEntry *new_entry = (CacheEntry *)halide_malloc(nullptr, sizeof(CacheEntry));
-    bool inited = false;
-    if (new_entry) {
-        inited = new_entry->init(cache_key, size, h, computed_bounds, tuple_count, tuple_buffers,
-                                 has_eviction_key, eviction_key);
+    if (publish) {
+        SharedKey shared_key(cache_key, size);
+        publish_shared_record(shared_key, shared_key.hash(), computed_bounds, tuple_count, tuple_buffers);
     }
-    if (!inited) {
-        current_cache_size -= added_size;
 
-        // This entry is still in use by the caller. Mark it as having no cache entry
-        // so halide_memoization_cache_release can free the buffer.
-        for (int32_t i = 0; i < tuple_count; i++) {
-            get_pointer_to_header(tuple_buffers[i]->host)->entry = nullptr;
-        }
-
-        if (new_entry) {
-            halide_free(user_context, new_entry);
-        }
-        return 0;
-    }
-
-    new_entry->next = cache_entries[index];
-    new_entry->less_recent = most_recently_used;
-    if (most_recently_used != nullptr) {
-        most_recently_used->more_recent = new_entry;
-    }
-    most_recently_used = new_entry;
-    if (least_recently_used == nullptr) {
-        least_recently_used = new_entry;
-    }
-    cache_entries[index] = new_entry;
-
-    new_entry->in_use_count = tuple_count;
-
-    for (int32_t i = 0; i < tuple_count; i++) {
-        get_pointer_to_header(tuple_buffers[i]->host)->entry = new_entry;
-    }
-
-#if CACHE_DEBUGGING
-    validate_cache();
-#endif
     debug(user_context) << "Exiting halide_memoization_cache_store\n";
 
-    return 0;
+    return result;
 }
 
 WEAK void halide_memoization_cache_release(void *user_context, void *host) {
@@ -545,68 +1013,124 @@ WEAK void halide_memoization_cache_release(void *user_context, void *host) {
     if (entry == nullptr) {
         halide_free(user_context, header);
     } else {
-        ScopedMutexLock lock(&memoization_lock);
+        CacheShard &shard = shard_for_hash(header->hash);
+        ScopedMutexLock lock(&shard.lock);
 
         halide_abort_if_false(user_context, entry->in_use_count > 0);
         entry->in_use_count--;
 #if CACHE_DEBUGGING
-        validate_cache();
+        validate_shard(shard);
 #endif
     }
 
     debug(user_context) << "Exited halide_memoization_cache_release.\n";
 }
 
-WEAK void halide_memoization_cache_cleanup() {
-    debug(nullptr) << "halide_memoization_cache_cleanup\n";
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        entry_ref = nullptr;
-        while (entry != nullptr) {
-            CacheEntry *next = entry->next;
-            entry->destroy();
-            halide_free(nullptr, entry);
-            entry = next;
+WEAK int halide_memoization_cache_device_free(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return halide_error_code_success;
+    }
+
+    // If the cache entry the buffer came from (or went into) holds this
+    // device allocation, it is the entry's to free when it is evicted.
+    bool owned_by_cache = false;
+    if (buf->host != nullptr) {
+        CacheBlockHeader *header = get_pointer_to_header(buf->host);
+        CacheEntry *entry = header->entry;
+        if (entry != nullptr) {
+            CacheShard &shard = shard_for_hash(header->hash);
+            ScopedMutexLock lock(&shard.lock);
+            for (uint32_t i = 0; i < entry->tuple_count; i++) {
+                if (entry->buf[i].device == buf->device) {
+                    owned_by_cache = true;
+                }
+            }
         }
     }
-    current_cache_size = 0;
-    most_recently_used = nullptr;
-    least_recently_used = nullptr;
+
+    if (!owned_by_cache) {
+        return halide_device_free(user_context, buf);
+    }
+
+    buf->device = 0;
+    buf->device_interface = nullptr;
+    buf->set_device_dirty(false);
+    return halide_error_code_success;
 }
 
-WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
-    ScopedMutexLock lock(&memoization_lock);
+WEAK void halide_memoization_cache_device_free_as_destructor(void *user_context, void *obj) {
+    struct halide_buffer_t *buf = (struct halide_buffer_t *)obj;
+    halide_memoization_cache_device_free(user_context, buf);
+}
 
-    for (auto &entry_ref : cache_entries) {
-        CacheEntry *entry = entry_ref;
-        if (entry != nullptr) {
-            CacheEntry **prev = &entry_ref;
+WEAK void halide_memoization_cache_cleanup() {
+    debug(nullptr) << "halide_memoization_cache_cleanup\n";
+    for (auto &shard : cache_shards) {
+        for (uint32_t i = 0; i < shard.num_buckets; i++) {
+            CacheEntry *entry = shard.buckets[i];
             while (entry != nullptr) {
                 CacheEntry *next = entry->next;
-                if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
-                    *prev = next;
-                    if (entry->more_recent != nullptr) {
-                        entry->more_recent->less_recent = entry->less_recent;
-                    } else {
-                        most_recently_used = entry->less_recent;
-                    }
-                    if (entry->less_recent != nullptr) {
-                        entry->less_recent->more_recent = entry->more_recent;
-                    } else {
-                        least_recently_used = entry->more_recent;
-                    }
-                    entry->destroy();
-                    halide_free(user_context, entry);
-                } else {
-                    prev = &entry->next;
-                }
+                entry->destroy();
+                halide_free(nullptr, entry);
                 entry = next;
             }
         }
+        if (shard.buckets) {
+            halide_free(nullptr, shard.buckets);
+        }
+        shard.buckets = nullptr;
+        shard.num_buckets = 0;
+        shard.num_entries = 0;
+        shard.most_recently_used = nullptr;
+        shard.least_recently_used = nullptr;
+        shard.hits = 0;
+        shard.misses = 0;
+        shard.evictions = 0;
+        shard.shared_hits = 0;
     }
+    current_cache_size = 0;
+    current_device_cache_size = 0;
+}
+
+WEAK void halide_memoization_cache_evict(void *user_context, uint64_t eviction_key) {
+    for (auto &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+
+        // Walk the LRU list rather than the buckets, as it is
+        // unaffected by removing entries from the buckets.
+        CacheEntry *entry = shard.least_recently_used;
+        while (entry != nullptr) {
+            CacheEntry *more_recent = entry->more_recent;
+            if (entry->has_eviction_key && entry->eviction_key == eviction_key) {
+                destroy_entry(user_context, shard, entry);
+                shard.evictions++;
+            }
+            entry = more_recent;
+        }
 #if CACHE_DEBUGGING
-    validate_cache();
+        validate_shard(shard);
 #endif
+    }
+}
+
+WEAK void halide_memoization_cache_stats(halide_memoization_cache_stats_t *stats) {
+    stats->hits = 0;
+    stats->misses = 0;
+    stats->evictions = 0;
+    stats->entries = 0;
+    stats->shared_hits = 0;
+    for (auto &shard : cache_shards) {
+        ScopedMutexLock lock(&shard.lock);
+        stats->hits += shard.hits;
+        stats->misses += shard.misses;
+        stats->evictions += shard.evictions;
+        stats->entries += shard.num_entries;
+        stats->shared_hits += shard.shared_hits;
+    }
+    stats->current_size = __atomic_load_n(&current_cache_size, __ATOMIC_RELAXED);
+    stats->max_size = __atomic_load_n(&max_cache_size, __ATOMIC_RELAXED);
+    stats->current_device_size = __atomic_load_n(&current_device_cache_size, __ATOMIC_RELAXED);
+    stats->max_device_size = __atomic_load_n(&max_device_cache_size, __ATOMIC_RELAXED);
 }
 
 namespace {
@@ -12,6 +12,9 @@ WEAK uint64_t halide_cpu_features_storage[sizeof(CpuFeatures) / sizeof(uint64_t)
 WEAK bool halide_cpu_features_initialized = false;
 WEAK halide_mutex halide_cpu_features_initialized_lock;
 
+WEAK halide_multitarget_dispatch_t *multitarget_dispatch_list = nullptr;
+WEAK halide_mutex multitarget_dispatch_lock;
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -21,9 +24,29 @@ extern "C" {
 WEAK halide_can_use_target_features_t halide_set_custom_can_use_target_features(halide_can_use_target_features_t fn) {
     halide_can_use_target_features_t result = custom_can_use_target_features;
     custom_can_use_target_features = fn;
+    // Any sub-pipelines already chosen were chosen by the old function.
+    halide_reset_multitarget_dispatch();
     return result;
 }
 
+WEAK void halide_register_multitarget_dispatch(halide_multitarget_dispatch_t *dispatch) {
+    ScopedMutexLock lock(&multitarget_dispatch_lock);
+    for (halide_multitarget_dispatch_t *d = multitarget_dispatch_list; d; d = d->next) {
+        if (d == dispatch) {
+            return;
+        }
+    }
+    dispatch->next = multitarget_dispatch_list;
+    multitarget_dispatch_list = dispatch;
+}
+
+WEAK void halide_reset_multitarget_dispatch() {
+    ScopedMutexLock lock(&multitarget_dispatch_lock);
+    for (halide_multitarget_dispatch_t *d = multitarget_dispatch_list; d; d = d->next) {
+        __atomic_store_n(&d->selected, nullptr, __ATOMIC_RELEASE);
+    }
+}
+
 WEAK int halide_can_use_target_features(int count, const uint64_t *features) {
     return (*custom_can_use_target_features)(count, features);
 }
@@ -35,14 +58,17 @@ WEAK int halide_default_can_use_target_features(int count, const uint64_t *featu
     // on some systems (MSVC) because our runtime is a special beast. We'll
     // work around this by using a sentinel for the initialization flag and
     // some horribleness with memcpy (which we can do since CpuFeatures is still POD).
-    {
+    //
+    // This is called on every entry to a pipeline that multiversions
+    // its loops, so only take the lock until the features are known.
+    if (!__atomic_load_n(&halide_cpu_features_initialized, __ATOMIC_ACQUIRE)) {
         ScopedMutexLock lock(&halide_cpu_features_initialized_lock);
 
         static_assert(sizeof(halide_cpu_features_storage) == sizeof(CpuFeatures), "CpuFeatures Mismatch");
         if (!halide_cpu_features_initialized) {
             CpuFeatures tmp = halide_get_cpu_features();
             memcpy(&halide_cpu_features_storage, &tmp, sizeof(tmp));
-            halide_cpu_features_initialized = true;
+            __atomic_store_n(&halide_cpu_features_initialized, true, __ATOMIC_RELEASE);
         }
     }
 
@@ -13,6 +13,11 @@
 #define CL_12_FN(ret, fn, args) CL_FN(ret, fn, args)
 #endif
 
+// Functions only OpenCL 2.1 and later have are optional too.
+#ifndef CL_21_FN
+#define CL_21_FN(ret, fn, args) CL_12_FN(ret, fn, args)
+#endif
+
 /* Platform API */
 CL_FN(cl_int,
       clGetPlatformIDs, (cl_uint          /* num_entries */,
@@ -166,6 +171,19 @@ CL_FN(cl_program,
                                   const char **     /* strings */,
                                   const size_t *    /* lengths */,
                                   cl_int *          /* errcode_ret */));
+CL_FN(cl_program,
+      clCreateProgramWithBinary, (cl_context             /* context */,
+                                  cl_uint                /* num_devices */,
+                                  const cl_device_id *   /* device_list */,
+                                  const size_t *         /* lengths */,
+                                  const unsigned char ** /* binaries */,
+                                  cl_int *               /* binary_status */,
+                                  cl_int *               /* errcode_ret */));
+CL_21_FN(cl_program,
+      clCreateProgramWithIL, (cl_context        /* context */,
+                              const void *      /* il */,
+                              size_t            /* length */,
+                              cl_int *          /* errcode_ret */));
 CL_FN(cl_int,
       clRetainProgram, (cl_program /* program */));
 
@@ -188,6 +206,13 @@ CL_FN(cl_int,
                               void *                /* param_value */,
                               size_t *              /* param_value_size_ret */));
 
+CL_FN(cl_int,
+      clGetProgramInfo, (cl_program         /* program */,
+                         cl_program_info    /* param_name */,
+                         size_t             /* param_value_size */,
+                         void *             /* param_value */,
+                         size_t *           /* param_value_size_ret */));
+
 /* Kernel Object APIs */
 CL_FN(cl_kernel,
       clCreateKernel, (cl_program      /* program */,
@@ -206,6 +231,17 @@ CL_FN(cl_int,
                        size_t       /* arg_size */,
                        const void * /* arg_value */));
 
+/* Event Object APIs */
+CL_FN(cl_int,
+      clWaitForEvents, (cl_uint             /* num_events */,
+                        const cl_event *    /* event_list */));
+
+CL_FN(cl_int,
+      clRetainEvent, (cl_event /* event */));
+
+CL_FN(cl_int,
+      clReleaseEvent, (cl_event /* event */));
+
 /* Flush and Finish APIs */
 CL_FN(cl_int,
       clFlush, (cl_command_queue /* command_queue */));
@@ -353,5 +389,6 @@ CL_FN(cl_int,
 
 #undef CL_FN
 #undef CL_12_FN
+#undef CL_21_FN
 
 // clang-format on
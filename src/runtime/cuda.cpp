@@ -1,7 +1,9 @@
 #include "HalideRuntimeCuda.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "gpu_context_common.h"
+#include "gpu_kernel_cache.h"
 #include "mini_cuda.h"
 #include "printer.h"
 #include "scoped_mutex_lock.h"
@@ -107,15 +109,799 @@ CUcontext WEAK context = nullptr;
 // This lock protexts the above context variable.
 WEAK halide_mutex context_lock;
 
-// A free list, used when allocations are being cached.
-WEAK struct FreeListItem {
-    CUdeviceptr ptr;
+ALWAYS_INLINE uint64_t quantize_allocation_size(uint64_t sz) {
+    int z = __builtin_clzll(sz);
+    if (z < 60) {
+        sz--;
+        sz = sz >> (60 - z);
+        sz++;
+        sz = sz << (60 - z);
+    }
+    return sz;
+}
+
+WEAK uint64_t allocate_pool_block(void *user_context, void *device_context, size_t size);
+WEAK void free_pool_block(void *user_context, void *device_context, uint64_t block);
+
+// Recycles cuMemAlloc'd device memory while allocation caching is on.
+// Requests of up to 1MB are carved out of shared 16MB blocks rather
+// than getting a cuMemAlloc of their own.
+WEAK DeviceMemoryPool memory_pool = {{}, allocate_pool_block, free_pool_block, 16 << 20, 1 << 20, 256, true};
+
+// The streams handed out by halide_cuda_stream_pool_get_stream. Each
+// assigned entry belongs to one user_context until it calls
+// halide_cuda_stream_pool_release.
+WEAK struct PooledStream {
     CUcontext ctx;
     CUstream stream;
+    void *user_context;
+    bool assigned;
+} stream_pool[32];
+WEAK int stream_pool_size = 0;
+WEAK halide_mutex stream_pool_lock;
+
+// Whether copies go through the pinned staging buffers below; defined
+// by cuda_async_copies.cpp or cuda_async_copies_stubs.cpp, according to
+// the cuda_async_copies target feature.
+bool async_copies_enabled();
+
+// Pinned host memory that copies to and from pageable host memory are
+// staged through when async copies are enabled. A buffer may be reused
+// once its event, recorded after the last copy into or out of it, has
+// fired.
+WEAK struct StagingBuffer {
+    CUcontext ctx;
+    void *host;
     size_t size;
-    FreeListItem *next;
-} *free_list = nullptr;
-WEAK halide_mutex free_list_lock;
+    CUevent done;
+    StagingBuffer *next;
+} *staging_buffers = nullptr;
+WEAK int num_staging_buffers = 0;
+WEAK halide_mutex staging_buffers_lock;
+
+// The stream that asynchronous copies to the device go on, per context,
+// so that they can overlap kernels on the stream of the pipeline. Also
+// guarded by stream_pool_lock.
+WEAK struct CopyStream {
+    CUcontext ctx;
+    CUstream stream;
+} copy_streams[8];
+WEAK int num_copy_streams = 0;
+
+// Once the stream pool has handed out a stream, work enqueued with
+// different user contexts may run concurrently, so we track the last
+// streams to write and read each device allocation, along with an
+// event recorded on each stream after that use. The allocations
+// themselves are always tracked, so that ones made before the pool was
+// first used are covered too.
+WEAK volatile bool tracking_allocations = false;
+
+struct StreamUse {
+    CUstream stream;
+    CUevent event;
+};
+
+WEAK struct TrackedAllocation {
+    CUcontext ctx;
+    CUdeviceptr ptr;
+    size_t size;
+    bool has_writer;
+    StreamUse writer;
+    // Uses by readers on other streams are collapsed into one of these
+    // if there are too many for them all to be tracked.
+    int num_readers;
+    StreamUse readers[4];
+    TrackedAllocation *next;
+} *tracked_allocations = nullptr;
+WEAK halide_mutex tracked_allocations_lock;
+
+// A device allocation used by a copy or kernel, and whether it is written.
+struct BufferAccess {
+    CUdeviceptr ptr;
+    bool write;
+};
+
+WEAK TrackedAllocation *find_tracked_allocation_already_locked(CUcontext ctx, CUdeviceptr ptr) {
+    for (TrackedAllocation *t = tracked_allocations; t; t = t->next) {
+        if (t->ctx == ctx && ptr >= t->ptr && ptr < t->ptr + t->size) {
+            return t;
+        }
+    }
+    return nullptr;
+}
+
+WEAK void destroy_tracked_allocation(TrackedAllocation *t) {
+    // Events are only destroyed once any work they wait for completes,
+    // so this is safe even if they are still pending.
+    if (t->writer.event) {
+        cuEventDestroy(t->writer.event);
+    }
+    for (auto &r : t->readers) {
+        if (r.event) {
+            cuEventDestroy(r.event);
+        }
+    }
+    free(t);
+}
+
+WEAK void track_allocation(CUcontext ctx, CUdeviceptr ptr, size_t size) {
+    TrackedAllocation *t = (TrackedAllocation *)malloc(sizeof(TrackedAllocation));
+    if (!t) {
+        return;
+    }
+    memset(t, 0, sizeof(TrackedAllocation));
+    t->ctx = ctx;
+    t->ptr = ptr;
+    t->size = size;
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    t->next = tracked_allocations;
+    tracked_allocations = t;
+}
+
+WEAK void untrack_allocation(CUcontext ctx, CUdeviceptr ptr) {
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    for (TrackedAllocation **prev = &tracked_allocations; *prev; prev = &(*prev)->next) {
+        TrackedAllocation *t = *prev;
+        if (t->ctx == ctx && t->ptr == ptr) {
+            *prev = t->next;
+            destroy_tracked_allocation(t);
+            return;
+        }
+    }
+}
+
+WEAK void untrack_all_allocations(CUcontext ctx) {
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    TrackedAllocation **prev = &tracked_allocations;
+    while (*prev) {
+        TrackedAllocation *t = *prev;
+        if (t->ctx == ctx) {
+            *prev = t->next;
+            destroy_tracked_allocation(t);
+        } else {
+            prev = &t->next;
+        }
+    }
+}
+
+// Make 'stream' wait for any earlier uses of the given allocations on
+// other streams that conflict with the accesses about to be made.
+WEAK int wait_for_conflicting_uses(void *user_context, CUcontext ctx, CUstream stream,
+                                   const BufferAccess *accesses, int num_accesses) {
+    if (!tracking_allocations) {
+        return 0;
+    }
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    for (int i = 0; i < num_accesses; i++) {
+        TrackedAllocation *t = find_tracked_allocation_already_locked(ctx, accesses[i].ptr);
+        if (!t) {
+            continue;
+        }
+        if (t->has_writer && t->writer.stream != stream) {
+            CUresult err = cuStreamWaitEvent(stream, t->writer.event, 0);
+            if (err != CUDA_SUCCESS) {
+                error(user_context) << "CUDA: cuStreamWaitEvent failed: " << get_error_name(err);
+                return err;
+            }
+        }
+        if (accesses[i].write) {
+            for (int j = 0; j < t->num_readers; j++) {
+                if (t->readers[j].stream != stream) {
+                    CUresult err = cuStreamWaitEvent(stream, t->readers[j].event, 0);
+                    if (err != CUDA_SUCCESS) {
+                        error(user_context) << "CUDA: cuStreamWaitEvent failed: " << get_error_name(err);
+                        return err;
+                    }
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+WEAK int record_use(void *user_context, StreamUse &use, CUstream stream) {
+    CUresult err;
+    if (!use.event) {
+        err = cuEventCreate(&use.event, CU_EVENT_DISABLE_TIMING);
+        if (err != CUDA_SUCCESS) {
+            use.event = nullptr;
+            error(user_context) << "CUDA: cuEventCreate failed: " << get_error_name(err);
+            return err;
+        }
+    }
+    use.stream = stream;
+    err = cuEventRecord(use.event, stream);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuEventRecord failed: " << get_error_name(err);
+        return err;
+    }
+    return 0;
+}
+
+// Record that the given allocations were accessed by the work just
+// enqueued on 'stream'.
+WEAK int record_uses(void *user_context, CUcontext ctx, CUstream stream,
+                     const BufferAccess *accesses, int num_accesses) {
+    if (!tracking_allocations) {
+        return 0;
+    }
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    for (int i = 0; i < num_accesses; i++) {
+        TrackedAllocation *t = find_tracked_allocation_already_locked(ctx, accesses[i].ptr);
+        if (!t) {
+            continue;
+        }
+        int err;
+        if (accesses[i].write) {
+            // This write waited for all the earlier uses, so it's the
+            // only one a later use need wait for.
+            err = record_use(user_context, t->writer, stream);
+            t->has_writer = (err == 0);
+            t->num_readers = 0;
+        } else {
+            const int max_readers = sizeof(t->readers) / sizeof(t->readers[0]);
+            int j = 0;
+            while (j < t->num_readers && t->readers[j].stream != stream) {
+                j++;
+            }
+            if (j == max_readers) {
+                // Make this stream wait for the oldest reader, so that
+                // waiting for this stream covers both of them.
+                j = 0;
+                err = cuStreamWaitEvent(stream, t->readers[0].event, 0);
+                if (err != CUDA_SUCCESS) {
+                    error(user_context) << "CUDA: cuStreamWaitEvent failed: " << get_error_name((CUresult)err);
+                    return err;
+                }
+            } else if (j == t->num_readers) {
+                t->num_readers++;
+            }
+            err = record_use(user_context, t->readers[j], stream);
+        }
+        if (err != 0) {
+            return err;
+        }
+    }
+    return 0;
+}
+
+// Start tracking the uses of device allocations by different streams,
+// if we aren't already. Nothing enqueued before now was tracked, so
+// wait for all of it.
+WEAK int enable_use_tracking(void *user_context) {
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    if (!tracking_allocations) {
+        CUresult err = cuCtxSynchronize();
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuCtxSynchronize failed: " << get_error_name(err);
+            return err;
+        }
+        tracking_allocations = true;
+    }
+    return 0;
+}
+
+WEAK bool is_tracked_allocation(CUcontext ctx, CUdeviceptr ptr) {
+    ScopedMutexLock lock(&tracked_allocations_lock);
+    return find_tracked_allocation_already_locked(ctx, ptr) != nullptr;
+}
+
+// Destroy the pooled streams belonging to a context that is going away.
+WEAK void release_stream_pool(CUcontext ctx) {
+    ScopedMutexLock lock(&stream_pool_lock);
+    int kept = 0;
+    for (int i = 0; i < stream_pool_size; i++) {
+        if (stream_pool[i].ctx == ctx) {
+            cuStreamDestroy(stream_pool[i].stream);
+        } else {
+            stream_pool[kept++] = stream_pool[i];
+        }
+    }
+    stream_pool_size = kept;
+
+    kept = 0;
+    for (int i = 0; i < num_copy_streams; i++) {
+        if (copy_streams[i].ctx == ctx) {
+            cuStreamDestroy(copy_streams[i].stream);
+        } else {
+            copy_streams[kept++] = copy_streams[i];
+        }
+    }
+    num_copy_streams = kept;
+}
+
+WEAK int get_copy_stream(void *user_context, CUcontext ctx, CUstream *stream) {
+    ScopedMutexLock lock(&stream_pool_lock);
+    for (int i = 0; i < num_copy_streams; i++) {
+        if (copy_streams[i].ctx == ctx) {
+            *stream = copy_streams[i].stream;
+            return 0;
+        }
+    }
+    const int max_copy_streams = sizeof(copy_streams) / sizeof(copy_streams[0]);
+    if (num_copy_streams == max_copy_streams) {
+        error(user_context) << "CUDA: too many contexts for async copies\n";
+        return halide_error_code_generic_error;
+    }
+    CUresult err = cuStreamCreate(stream, CU_STREAM_NON_BLOCKING);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuStreamCreate failed: " << get_error_name(err);
+        return err;
+    }
+    copy_streams[num_copy_streams++] = {ctx, *stream};
+    return 0;
+}
+
+WEAK void destroy_staging_buffer(StagingBuffer *b) {
+    cuEventSynchronize(b->done);
+    cuEventDestroy(b->done);
+    cuMemFreeHost(b->host);
+    free(b);
+}
+
+// Get an idle staging buffer of at least the given size, allocating one
+// if there are none.
+WEAK int acquire_staging_buffer(void *user_context, CUcontext ctx, size_t size, StagingBuffer **result) {
+    {
+        ScopedMutexLock lock(&staging_buffers_lock);
+        for (StagingBuffer **prev = &staging_buffers; *prev; prev = &(*prev)->next) {
+            StagingBuffer *b = *prev;
+            if (b->ctx == ctx && b->size >= size && cuEventQuery(b->done) == CUDA_SUCCESS) {
+                *prev = b->next;
+                num_staging_buffers--;
+                *result = b;
+                return 0;
+            }
+        }
+    }
+
+    StagingBuffer *b = (StagingBuffer *)malloc(sizeof(StagingBuffer));
+    if (!b) {
+        error(user_context) << "CUDA: Out of memory allocating a staging buffer\n";
+        return halide_error_code_out_of_memory;
+    }
+    b->ctx = ctx;
+    b->size = quantize_allocation_size(size);
+    b->next = nullptr;
+    CUresult err = cuMemHostAlloc(&b->host, b->size, 0);
+    if (err != CUDA_SUCCESS) {
+        free(b);
+        error(user_context) << "CUDA: cuMemHostAlloc failed: " << get_error_name(err);
+        return err;
+    }
+    err = cuEventCreate(&b->done, CU_EVENT_DISABLE_TIMING);
+    if (err != CUDA_SUCCESS) {
+        cuMemFreeHost(b->host);
+        free(b);
+        error(user_context) << "CUDA: cuEventCreate failed: " << get_error_name(err);
+        return err;
+    }
+    debug(user_context) << "CUDA: allocated a " << (uint64_t)b->size << " byte staging buffer\n";
+    *result = b;
+    return 0;
+}
+
+// Return a staging buffer to the pool once the work just enqueued on
+// 'stream' is done with it.
+WEAK int release_staging_buffer(void *user_context, StagingBuffer *b, CUstream stream) {
+    CUresult err = cuEventRecord(b->done, stream);
+    if (err != CUDA_SUCCESS) {
+        // We don't know when it is safe to reuse, so wait for everything.
+        cuCtxSynchronize();
+        destroy_staging_buffer(b);
+        error(user_context) << "CUDA: cuEventRecord failed: " << get_error_name(err);
+        return err;
+    }
+    StagingBuffer *to_free = nullptr;
+    {
+        ScopedMutexLock lock(&staging_buffers_lock);
+        b->next = staging_buffers;
+        staging_buffers = b;
+        // Don't hang on to too much pinned memory. The oldest buffer is
+        // the one least likely to be in use.
+        const int max_idle_staging_buffers = 8;
+        if (++num_staging_buffers > max_idle_staging_buffers) {
+            StagingBuffer **prev = &staging_buffers;
+            while ((*prev)->next) {
+                prev = &(*prev)->next;
+            }
+            to_free = *prev;
+            *prev = nullptr;
+            num_staging_buffers--;
+        }
+    }
+    if (to_free) {
+        destroy_staging_buffer(to_free);
+    }
+    return 0;
+}
+
+// Free the staging buffers belonging to a context that is going away.
+WEAK void release_staging_buffers(CUcontext ctx) {
+    ScopedMutexLock lock(&staging_buffers_lock);
+    StagingBuffer **prev = &staging_buffers;
+    while (*prev) {
+        StagingBuffer *b = *prev;
+        if (b->ctx == ctx) {
+            *prev = b->next;
+            num_staging_buffers--;
+            destroy_staging_buffer(b);
+        } else {
+            prev = &b->next;
+        }
+    }
+}
+
+// CUDA graphs: the kernel launches made on a stream between
+// halide_cuda_graph_begin and halide_cuda_graph_end are recorded, and
+// made into a graph when the session ends. A later session with the
+// same key on the same stream defers its launches for as long as they
+// match the recorded ones exactly (device pointers, shapes and all),
+// and replays the graph in place of them when it ends. Anything else
+// ends the match, at which point the deferred launches are made
+// directly, and the session records a new graph instead.
+struct GraphLaunch {
+    CUfunction f;
+    // The grid and block dimensions, and the shared memory size.
+    unsigned int dims[7];
+    size_t num_args;
+    size_t *arg_sizes;
+    // Pointers to copies of the argument values, null terminated.
+    void **params;
+    int num_accesses;
+    BufferAccess *accesses;
+};
+
+struct GraphLaunchList {
+    GraphLaunch **launches;
+    int size;
+    int capacity;
+};
+
+WEAK struct CachedGraph {
+    CUcontext ctx;
+    CUstream stream;
+    uint64_t key;
+    GraphLaunchList launches;
+    CUgraph graph;
+    CUgraphExec exec;
+    CachedGraph *next;
+} *cached_graphs = nullptr;
+
+WEAK struct GraphSession {
+    CUcontext ctx;
+    CUstream stream;
+    uint64_t key;
+    // The graph whose launches are being matched, or null if the
+    // session is recording.
+    CachedGraph *replaying;
+    int num_matched;
+    // Cleared by copies and syncs, which a graph of kernel launches
+    // can't stand in for.
+    bool graphable;
+    GraphLaunchList recorded;
+    GraphSession *next;
+} *graph_sessions = nullptr;
+
+// Guards the two lists above.
+WEAK halide_mutex graphs_lock;
+// Lets halide_cuda_run skip looking for a session when there are none.
+WEAK volatile int num_graph_sessions = 0;
+
+WEAK bool graphs_supported() {
+    return cuStreamSynchronize && cuGraphCreate && cuGraphAddKernelNode &&
+           cuGraphInstantiateWithFlags && cuGraphLaunch && cuGraphExecDestroy && cuGraphDestroy;
+}
+
+WEAK GraphLaunch *make_graph_launch(CUfunction f, const unsigned int dims[7],
+                                    size_t num_args, const size_t arg_sizes[], void *const args[],
+                                    const BufferAccess *accesses, int num_accesses) {
+    // Everything goes in one allocation, with each argument value
+    // padded to 8 bytes.
+    size_t arg_bytes = 0;
+    for (size_t i = 0; i < num_args; i++) {
+        arg_bytes += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    size_t size = sizeof(GraphLaunch) +
+                  num_args * sizeof(size_t) +
+                  (num_args + 1) * sizeof(void *) +
+                  num_accesses * sizeof(BufferAccess) +
+                  arg_bytes;
+    GraphLaunch *l = (GraphLaunch *)malloc(size);
+    if (!l) {
+        return nullptr;
+    }
+    l->f = f;
+    memcpy(l->dims, dims, sizeof(l->dims));
+    l->num_args = num_args;
+    l->arg_sizes = (size_t *)(l + 1);
+    l->params = (void **)(l->arg_sizes + num_args);
+    l->num_accesses = num_accesses;
+    l->accesses = (BufferAccess *)(l->params + num_args + 1);
+    uint8_t *arg_data = (uint8_t *)(l->accesses + num_accesses);
+    for (size_t i = 0; i < num_args; i++) {
+        l->arg_sizes[i] = arg_sizes[i];
+        l->params[i] = arg_data;
+        memcpy(arg_data, args[i], arg_sizes[i]);
+        arg_data += (arg_sizes[i] + 7) & ~(size_t)7;
+    }
+    l->params[num_args] = nullptr;
+    memcpy(l->accesses, accesses, num_accesses * sizeof(BufferAccess));
+    return l;
+}
+
+WEAK GraphLaunch *copy_graph_launch(const GraphLaunch *l) {
+    return make_graph_launch(l->f, l->dims, l->num_args, l->arg_sizes, l->params, l->accesses, l->num_accesses);
+}
+
+WEAK bool graph_launch_matches(const GraphLaunch *l, CUfunction f, const unsigned int dims[7],
+                               size_t num_args, const size_t arg_sizes[], void *const args[]) {
+    if (l->f != f || memcmp(l->dims, dims, sizeof(l->dims)) != 0 || l->num_args != num_args) {
+        return false;
+    }
+    for (size_t i = 0; i < num_args; i++) {
+        if (l->arg_sizes[i] != arg_sizes[i] || memcmp(l->params[i], args[i], arg_sizes[i]) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+WEAK bool append_graph_launch(GraphLaunchList &list, GraphLaunch *l) {
+    if (list.size == list.capacity) {
+        int new_capacity = list.capacity ? list.capacity * 2 : 16;
+        GraphLaunch **new_launches = (GraphLaunch **)malloc(new_capacity * sizeof(GraphLaunch *));
+        if (!new_launches) {
+            return false;
+        }
+        if (list.size) {
+            memcpy(new_launches, list.launches, list.size * sizeof(GraphLaunch *));
+        }
+        free(list.launches);
+        list.launches = new_launches;
+        list.capacity = new_capacity;
+    }
+    list.launches[list.size++] = l;
+    return true;
+}
+
+WEAK void clear_graph_launches(GraphLaunchList &list) {
+    for (int i = 0; i < list.size; i++) {
+        free(list.launches[i]);
+    }
+    free(list.launches);
+    list = GraphLaunchList{nullptr, 0, 0};
+}
+
+WEAK void destroy_cached_graph(CachedGraph *g) {
+    if (g->exec) {
+        cuGraphExecDestroy(g->exec);
+    }
+    if (g->graph) {
+        cuGraphDestroy(g->graph);
+    }
+    clear_graph_launches(g->launches);
+    free(g);
+}
+
+WEAK GraphSession *find_graph_session_already_locked(CUcontext ctx, CUstream stream) {
+    for (GraphSession *s = graph_sessions; s; s = s->next) {
+        if (s->ctx == ctx && s->stream == stream) {
+            return s;
+        }
+    }
+    return nullptr;
+}
+
+WEAK int launch_recorded_kernel(void *user_context, CUcontext ctx, CUstream stream, const GraphLaunch *l) {
+    int result = wait_for_conflicting_uses(user_context, ctx, stream, l->accesses, l->num_accesses);
+    if (result != 0) {
+        return result;
+    }
+    CUresult err = cuLaunchKernel(l->f,
+                                  l->dims[0], l->dims[1], l->dims[2],
+                                  l->dims[3], l->dims[4], l->dims[5],
+                                  l->dims[6],
+                                  stream,
+                                  l->params,
+                                  nullptr);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuLaunchKernel failed: "
+                            << get_error_name(err);
+        return err;
+    }
+    return record_uses(user_context, ctx, stream, l->accesses, l->num_accesses);
+}
+
+// Stop matching the launches of a graph, making the ones deferred so
+// far, and recording them as the start of a new graph.
+WEAK int stop_replaying_already_locked(void *user_context, GraphSession *s) {
+    CachedGraph *g = s->replaying;
+    if (!g) {
+        return 0;
+    }
+    debug(user_context) << "CUDA: graph session " << s->key << " diverged after "
+                        << s->num_matched << " of " << g->launches.size << " launches\n";
+    s->replaying = nullptr;
+    for (int i = 0; i < s->num_matched; i++) {
+        const GraphLaunch *l = g->launches.launches[i];
+        int result = launch_recorded_kernel(user_context, s->ctx, s->stream, l);
+        if (result != 0) {
+            return result;
+        }
+        GraphLaunch *copy = copy_graph_launch(l);
+        if (!copy || !append_graph_launch(s->recorded, copy)) {
+            free(copy);
+            s->graphable = false;
+        }
+    }
+    return 0;
+}
+
+// Called by operations other than kernel launches on a stream, which
+// must not overtake deferred launches. Copies and syncs between
+// launches can't be part of a graph, so they stop the session from
+// making one, but those before the first launch (e.g. uploading the
+// inputs) are no obstacle.
+WEAK int interrupt_graph_session(void *user_context, CUcontext ctx, CUstream stream, bool graphable) {
+    if (!num_graph_sessions) {
+        return 0;
+    }
+    ScopedMutexLock lock(&graphs_lock);
+    GraphSession *s = find_graph_session_already_locked(ctx, stream);
+    if (!s || (s->num_matched == 0 && s->recorded.size == 0)) {
+        return 0;
+    }
+    s->graphable = s->graphable && graphable;
+    return stop_replaying_already_locked(user_context, s);
+}
+
+// Launch a kernel as part of the graph session on the stream, if there
+// is one, setting *handled if so.
+WEAK int graph_session_launch(void *user_context, CUcontext ctx, CUstream stream,
+                              CUfunction f, const unsigned int dims[7],
+                              size_t num_args, const size_t arg_sizes[], void *const args[],
+                              const BufferAccess *accesses, int num_accesses, bool *handled) {
+    *handled = false;
+    ScopedMutexLock lock(&graphs_lock);
+    GraphSession *s = find_graph_session_already_locked(ctx, stream);
+    if (!s) {
+        return 0;
+    }
+    *handled = true;
+
+    CachedGraph *g = s->replaying;
+    if (g && s->num_matched < g->launches.size &&
+        graph_launch_matches(g->launches.launches[s->num_matched], f, dims, num_args, arg_sizes, args)) {
+        s->num_matched++;
+        return 0;
+    }
+    int result = stop_replaying_already_locked(user_context, s);
+    if (result != 0) {
+        return result;
+    }
+
+    GraphLaunch *l = make_graph_launch(f, dims, num_args, arg_sizes, args, accesses, num_accesses);
+    if (!l) {
+        error(user_context) << "CUDA: Out of memory recording a kernel launch\n";
+        return halide_error_code_out_of_memory;
+    }
+    result = launch_recorded_kernel(user_context, ctx, stream, l);
+    if (result != 0 || !append_graph_launch(s->recorded, l)) {
+        free(l);
+        s->graphable = false;
+    }
+    return result;
+}
+
+// Make a graph that runs the given launches one after another.
+WEAK CUresult instantiate_graph(void *user_context, CachedGraph *g) {
+    CUresult err = cuGraphCreate(&g->graph, 0);
+    if (err != CUDA_SUCCESS) {
+        g->graph = nullptr;
+        return err;
+    }
+    CUgraphNode prev = nullptr;
+    for (int i = 0; i < g->launches.size; i++) {
+        const GraphLaunch *l = g->launches.launches[i];
+        CUDA_KERNEL_NODE_PARAMS params;
+        params.func = l->f;
+        params.gridDimX = l->dims[0];
+        params.gridDimY = l->dims[1];
+        params.gridDimZ = l->dims[2];
+        params.blockDimX = l->dims[3];
+        params.blockDimY = l->dims[4];
+        params.blockDimZ = l->dims[5];
+        params.sharedMemBytes = l->dims[6];
+        params.kernelParams = l->params;
+        params.extra = nullptr;
+        CUgraphNode node;
+        err = cuGraphAddKernelNode(&node, g->graph, prev ? &prev : nullptr, prev ? 1 : 0, &params);
+        if (err != CUDA_SUCCESS) {
+            return err;
+        }
+        prev = node;
+    }
+    err = cuGraphInstantiateWithFlags(&g->exec, g->graph, 0);
+    if (err != CUDA_SUCCESS) {
+        g->exec = nullptr;
+    }
+    return err;
+}
+
+// Replay a graph in place of the launches it was made from.
+WEAK int launch_cached_graph(void *user_context, CachedGraph *g) {
+    int result = 0;
+    for (int i = 0; i < g->launches.size && result == 0; i++) {
+        const GraphLaunch *l = g->launches.launches[i];
+        result = wait_for_conflicting_uses(user_context, g->ctx, g->stream, l->accesses, l->num_accesses);
+    }
+    if (result != 0) {
+        return result;
+    }
+    debug(user_context) << "CUDA: cuGraphLaunch " << (void *)g->exec << " (" << g->launches.size << " launches)\n";
+    CUresult err = cuGraphLaunch(g->exec, g->stream);
+    if (err != CUDA_SUCCESS) {
+        error(user_context) << "CUDA: cuGraphLaunch failed: "
+                            << get_error_name(err);
+        return err;
+    }
+    for (int i = 0; i < g->launches.size && result == 0; i++) {
+        const GraphLaunch *l = g->launches.launches[i];
+        result = record_uses(user_context, g->ctx, g->stream, l->accesses, l->num_accesses);
+    }
+    return result;
+}
+
+// Destroy the graphs and sessions belonging to a context that is going away.
+WEAK void release_graphs(CUcontext ctx) {
+    ScopedMutexLock lock(&graphs_lock);
+    CachedGraph **prev = &cached_graphs;
+    while (*prev) {
+        CachedGraph *g = *prev;
+        if (g->ctx == ctx) {
+            *prev = g->next;
+            destroy_cached_graph(g);
+        } else {
+            prev = &g->next;
+        }
+    }
+    GraphSession **prev_session = &graph_sessions;
+    while (*prev_session) {
+        GraphSession *s = *prev_session;
+        if (s->ctx == ctx) {
+            *prev_session = s->next;
+            clear_graph_launches(s->recorded);
+            free(s);
+            num_graph_sessions--;
+        } else {
+            prev_session = &s->next;
+        }
+    }
+}
+
+WEAK uint64_t allocate_pool_block(void *user_context, void *device_context, size_t size) {
+    // The context is already current.
+    CUdeviceptr p = 0;
+    debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
+    CUresult err = cuMemAlloc(&p, size);
+    if (err != CUDA_SUCCESS) {
+        debug(user_context) << get_error_name(err) << "\n";
+        return 0;
+    }
+    debug(user_context) << (void *)p << "\n";
+    return p;
+}
+
+WEAK void free_pool_block(void *user_context, void *device_context, uint64_t block) {
+    // The pool may be trimmed with no context current.
+    debug(user_context) << "    cuMemFree " << (void *)block << "\n";
+    if (cuCtxPushCurrent((CUcontext)device_context) == CUDA_SUCCESS) {
+        cuMemFree((CUdeviceptr)block);
+        CUcontext old_ctx;
+        cuCtxPopCurrent(&old_ctx);
+    }
+}
 
 }  // namespace Cuda
 }  // namespace Internal
@@ -243,6 +1029,69 @@ WEAK halide_cuda_get_stream_t halide_set_cuda_get_stream(halide_cuda_get_stream_
     CUDA::get_stream = handler;
     return result;
 }
+
+WEAK int halide_cuda_stream_pool_get_stream(void *user_context, void *ctx, void **stream) {
+    *stream = nullptr;
+    if (!cuStreamCreate || !cuStreamWaitEvent || !cuEventCreate || !cuEventRecord) {
+        // No stream support, so everything uses the null stream.
+        return 0;
+    }
+
+    ScopedMutexLock lock(&stream_pool_lock);
+    PooledStream *unassigned = nullptr;
+    for (int i = 0; i < stream_pool_size; i++) {
+        PooledStream &p = stream_pool[i];
+        if (p.ctx != (CUcontext)ctx) {
+            continue;
+        }
+        if (p.assigned && p.user_context == user_context) {
+            *stream = p.stream;
+            return 0;
+        }
+        if (!p.assigned && !unassigned) {
+            unassigned = &p;
+        }
+    }
+
+    if (!unassigned) {
+        const int max_streams = sizeof(stream_pool) / sizeof(stream_pool[0]);
+        if (stream_pool_size == max_streams) {
+            debug(user_context) << "CUDA: stream pool exhausted, using the null stream for user_context " << user_context << "\n";
+            return 0;
+        }
+        CUstream s = nullptr;
+        CUresult err = cuStreamCreate(&s, CU_STREAM_NON_BLOCKING);
+        if (err != CUDA_SUCCESS) {
+            error(user_context) << "CUDA: cuStreamCreate failed: " << get_error_name(err);
+            return err;
+        }
+        debug(user_context) << "CUDA: created pooled stream " << s << "\n";
+        int result = enable_use_tracking(user_context);
+        if (result != 0) {
+            cuStreamDestroy(s);
+            return result;
+        }
+        unassigned = &stream_pool[stream_pool_size++];
+        unassigned->ctx = (CUcontext)ctx;
+        unassigned->stream = s;
+    }
+    unassigned->assigned = true;
+    unassigned->user_context = user_context;
+    *stream = unassigned->stream;
+    return 0;
+}
+
+WEAK int halide_cuda_stream_pool_release(void *user_context) {
+    ScopedMutexLock lock(&stream_pool_lock);
+    for (int i = 0; i < stream_pool_size; i++) {
+        PooledStream &p = stream_pool[i];
+        if (p.assigned && p.user_context == user_context) {
+            p.assigned = false;
+            p.user_context = nullptr;
+        }
+    }
+    return 0;
+}
 }
 
 namespace Halide {
@@ -525,6 +1374,48 @@ WEAK bool validate_device_pointer(void *user_context, halide_buffer_t *buf, size
 #endif
 }
 
+// Describe the device, driver and JIT options that the cubin compiled
+// from a kernel depends on, for the GPU kernel cache. Returns false if
+// the driver is too old to give us a cubin we could keep.
+WEAK bool get_kernel_cache_device_id(void *user_context, unsigned int max_regs_per_thread, char *dst, char *end) {
+    if (!cuDriverGetVersion || !cuLinkCreate || !cuLinkAddData || !cuLinkComplete || !cuLinkDestroy) {
+        return false;
+    }
+    CUdevice dev;
+    char name[256];
+    int major = 0, minor = 0, driver_version = 0;
+    if (cuCtxGetDevice(&dev) != CUDA_SUCCESS ||
+        cuDeviceGetName(name, sizeof(name), dev) != CUDA_SUCCESS ||
+        cuDeviceGetAttribute(&major, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MAJOR, dev) != CUDA_SUCCESS ||
+        cuDeviceGetAttribute(&minor, CU_DEVICE_ATTRIBUTE_COMPUTE_CAPABILITY_MINOR, dev) != CUDA_SUCCESS ||
+        cuDriverGetVersion(&driver_version) != CUDA_SUCCESS) {
+        return false;
+    }
+    name[sizeof(name) - 1] = 0;
+    dst = halide_string_to_string(dst, end, name);
+    dst = halide_string_to_string(dst, end, " sm_");
+    dst = halide_int64_to_string(dst, end, major, 1);
+    dst = halide_int64_to_string(dst, end, minor, 1);
+    dst = halide_string_to_string(dst, end, " driver ");
+    dst = halide_int64_to_string(dst, end, driver_version, 1);
+    dst = halide_string_to_string(dst, end, " maxrregcount ");
+    halide_int64_to_string(dst, end, max_regs_per_thread, 1);
+    return true;
+}
+
+// Whether the kernels were compiled ahead of time (with the
+// cuda_fatbin target feature) rather than embedded as PTX source.
+WEAK bool is_precompiled_module(const char *src, int size) {
+    if (size < 4) {
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)src;
+    // A fatbin starts with the magic number 0xba55ed50, and a cubin is an ELF file.
+    const bool is_fatbin = bytes[0] == 0x50 && bytes[1] == 0xed && bytes[2] == 0x55 && bytes[3] == 0xba;
+    const bool is_cubin = bytes[0] == 0x7f && bytes[1] == 'E' && bytes[2] == 'L' && bytes[3] == 'F';
+    return is_fatbin || is_cubin;
+}
+
 WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size) {
     debug(user_context) << "CUDA: compile_kernel cuModuleLoadData " << (void *)ptx_src << ", " << size << " -> ";
 
@@ -540,7 +1431,50 @@ WEAK CUmodule compile_kernel(void *user_context, const char *ptx_src, int size)
     }
     void *optionValues[] = {(void *)(uintptr_t)max_regs_per_thread};
     CUmodule loaded_module;
-    CUresult err = cuModuleLoadDataEx(&loaded_module, ptx_src, 1, options, optionValues);
+    CUresult err;
+
+    char device_id[512];
+    if (is_precompiled_module(ptx_src, size)) {
+        // The driver picks the SASS for this device out of the fatbin,
+        // and only JIT-compiles the PTX in it if there is none. There
+        // is no point keeping the result in the kernel cache.
+        err = cuModuleLoadDataEx(&loaded_module, ptx_src, 1, options, optionValues);
+    } else if (halide_get_gpu_kernel_cache_dir(user_context) &&
+        get_kernel_cache_device_id(user_context, max_regs_per_thread, device_id, device_id + sizeof(device_id))) {
+        size_t cubin_size = 0;
+        void *cubin = gpu_kernel_cache_load(user_context, "cuda", device_id, ptx_src, size, &cubin_size);
+        if (cubin) {
+            err = cuModuleLoadData(&loaded_module, cubin);
+            free(cubin);
+            if (err == CUDA_SUCCESS) {
+                debug(user_context) << (void *)(loaded_module) << " (cached)\n";
+                return loaded_module;
+            }
+        }
+
+        // Compile the PTX with the linker API rather than
+        // cuModuleLoadDataEx, so that we get a cubin to keep.
+        CUlinkState link_state;
+        err = cuLinkCreate(1, options, optionValues, &link_state);
+        if (err == CUDA_SUCCESS) {
+            void *cubin = nullptr;
+            size_t cubin_size = 0;
+            err = cuLinkAddData(link_state, CU_JIT_INPUT_PTX, (void *)ptx_src, size, "halide", 0, nullptr, nullptr);
+            if (err == CUDA_SUCCESS) {
+                err = cuLinkComplete(link_state, &cubin, &cubin_size);
+            }
+            if (err == CUDA_SUCCESS) {
+                err = cuModuleLoadData(&loaded_module, cubin);
+            }
+            if (err == CUDA_SUCCESS) {
+                gpu_kernel_cache_save(user_context, "cuda", device_id, ptx_src, size, cubin, cubin_size);
+            }
+            // The cubin belongs to the link state.
+            cuLinkDestroy(link_state);
+        }
+    } else {
+        err = cuModuleLoadDataEx(&loaded_module, ptx_src, 1, options, optionValues);
+    }
 
     if (err != CUDA_SUCCESS) {
         error(user_context) << "CUDA: cuModuleLoadData failed: "
@@ -596,42 +1530,15 @@ WEAK void halide_cuda_finalize_kernels(void *user_context, void *state_ptr) {
 }
 
 WEAK int halide_cuda_release_unused_device_allocations(void *user_context) {
-    FreeListItem *to_free;
-    {
-        ScopedMutexLock lock(&free_list_lock);
-        to_free = free_list;
-        free_list = nullptr;
-    }
-    while (to_free) {
-        debug(user_context) << "    cuMemFree " << (void *)(to_free->ptr) << "\n";
-        cuMemFree(to_free->ptr);
-        FreeListItem *next = to_free->next;
-        free(to_free);
-        to_free = next;
-    }
-    return 0;
+    return device_memory_pool_trim(user_context, &memory_pool, nullptr);
 }
 
 namespace Halide {
 namespace Runtime {
 namespace Internal {
 
-WEAK halide_device_allocation_pool cuda_allocation_pool;
-
 WEAK __attribute__((constructor)) void register_cuda_allocation_pool() {
-    cuda_allocation_pool.release_unused = &halide_cuda_release_unused_device_allocations;
-    halide_register_device_allocation_pool(&cuda_allocation_pool);
-}
-
-ALWAYS_INLINE uint64_t quantize_allocation_size(uint64_t sz) {
-    int z = __builtin_clzll(sz);
-    if (z < 60) {
-        sz--;
-        sz = sz >> (60 - z);
-        sz++;
-        sz = sz << (60 - z);
-    }
-    return sz;
+    device_memory_pool_register(&memory_pool, &cuda_device_interface);
 }
 
 }  // namespace Internal
@@ -664,33 +1571,40 @@ WEAK int halide_cuda_device_free(void *user_context, halide_buffer_t *buf) {
     halide_abort_if_false(user_context, validate_device_pointer(user_context, buf));
 
     CUresult err = CUDA_SUCCESS;
-    if (halide_can_reuse_device_allocations(user_context)) {
-        debug(user_context) << "    caching allocation for later use: " << (void *)(dev_ptr) << "\n";
-
-        FreeListItem *item = (FreeListItem *)malloc(sizeof(FreeListItem));
-        item->ctx = ctx.context;
-        item->size = quantize_allocation_size(buf->size_in_bytes());
-        item->ptr = dev_ptr;
-
-        if (cuStreamSynchronize) {
-            // We don't want to use a buffer freed one stream on
-            // another, as there are no synchronization guarantees and
-            // everything is async.
-            int result = halide_cuda_get_stream(user_context, ctx.context, &item->stream);
+    void *pool_stream = nullptr;
+    if (device_memory_pool_find(user_context, &memory_pool, ctx.context, dev_ptr, 0, &pool_stream)) {
+        debug(user_context) << "    returning allocation to the pool: " << (void *)(dev_ptr) << "\n";
+
+        // The memory will next be used on the stream it was allocated
+        // for, as there are no synchronization guarantees between
+        // streams and everything is async, so that stream had better be
+        // done with its uses on any others.
+        if (tracking_allocations) {
+            BufferAccess access = {dev_ptr, true};
+            (void)wait_for_conflicting_uses(user_context, ctx.context, (CUstream)pool_stream, &access, 1);
+        } else if (cuStreamSynchronize) {
+            CUstream stream = nullptr;
+            int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
             if (result != 0) {
                 error(user_context) << "CUDA: In halide_cuda_device_free, halide_cuda_get_stream returned " << result << "\n";
             }
-        } else {
-            item->stream = nullptr;
-        }
-
-        {
-            ScopedMutexLock lock(&free_list_lock);
-            item->next = free_list;
-            free_list = item;
+            if (stream != (CUstream)pool_stream) {
+                cuStreamSynchronize(stream);
+            }
         }
+        untrack_allocation(ctx.context, dev_ptr);
+        device_memory_pool_reclaim(user_context, &memory_pool, ctx.context, dev_ptr, 0);
     } else {
+        // Unlike memory returned to the pool, this can't be left for
+        // deferred kernel launches to use.
+        if (num_graph_sessions) {
+            CUstream stream = nullptr;
+            if (halide_cuda_get_stream(user_context, ctx.context, &stream) == 0) {
+                (void)interrupt_graph_session(user_context, ctx.context, stream, true);
+            }
+        }
         debug(user_context) << "    cuMemFree " << (void *)(dev_ptr) << "\n";
+        untrack_allocation(ctx.context, dev_ptr);
         err = cuMemFree(dev_ptr);
         // If cuMemFree fails, it isn't likely to succeed later, so just drop
         // the reference.
@@ -737,8 +1651,13 @@ WEAK int halide_cuda_device_release(void *user_context) {
         }
         halide_abort_if_false(user_context, err == CUDA_SUCCESS || err == CUDA_ERROR_DEINITIALIZED);
 
-        // Dump the contents of the free list, ignoring errors.
-        halide_cuda_release_unused_device_allocations(user_context);
+        // Return the unused memory in the pool, ignoring errors.
+        device_memory_pool_trim(user_context, &memory_pool, ctx);
+
+        release_graphs(ctx);
+        release_stream_pool(ctx);
+        release_staging_buffers(ctx);
+        untrack_all_allocations(ctx);
 
         compilation_cache.delete_context(user_context, ctx, cuModuleUnload);
 
@@ -751,6 +1670,7 @@ WEAK int halide_cuda_device_release(void *user_context) {
             ScopedMutexLock spinlock(&context_lock);
 
             if (ctx == context) {
+                device_memory_pool_forget(user_context, &memory_pool, ctx);
                 debug(user_context) << "    cuCtxDestroy " << context << "\n";
                 err = cuProfilerStop();
                 err = cuCtxDestroy(context);
@@ -776,9 +1696,6 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
     }
 
     size_t size = buf->size_in_bytes();
-    if (halide_can_reuse_device_allocations(user_context)) {
-        size = quantize_allocation_size(size);
-    }
     halide_abort_if_false(user_context, size != 0);
     if (buf->device) {
         // This buffer already has a device allocation
@@ -798,8 +1715,9 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
 #endif
 
     CUdeviceptr p = 0;
-    FreeListItem *to_free = nullptr;
     if (halide_can_reuse_device_allocations(user_context)) {
+        // Memory freed after use on one stream can only safely be reused
+        // on that stream, so the pool keeps each stream's memory apart.
         CUstream stream = nullptr;
         if (cuStreamSynchronize != nullptr) {
             int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
@@ -807,62 +1725,16 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
                 error(user_context) << "CUDA: In halide_cuda_device_malloc, halide_cuda_get_stream returned " << result << "\n";
             }
         }
-
-        ScopedMutexLock lock(&free_list_lock);
-        // Best-fit allocation. There are three tunable constants
-        // here. A bucket is claimed if the size requested is at least
-        // 7/8 of the size of the bucket. We keep at most 32 unused
-        // allocations. We round up each allocation size to its top 4
-        // most significant bits (see quantize_allocation_size).
-        FreeListItem *best = nullptr, *item = free_list;
-        FreeListItem **best_prev = nullptr, **prev_ptr = &free_list;
-        int depth = 0;
-        while (item) {
-            if ((size <= item->size) &&                              // Fits
-                (size >= (item->size / 8) * 7) &&                    // Not too much slop
-                (ctx.context == item->ctx) &&                        // Same cuda context
-                (stream == item->stream) &&                          // Can only safely re-use on the same stream on which it was freed
-                ((best == nullptr) || (best->size > item->size))) {  // Better than previous best fit
-                best = item;
-                best_prev = prev_ptr;
-                prev_ptr = &item->next;
-                item = item->next;
-            } else if (depth > 32) {
-                // Allocations after here have not been used for a
-                // long time. Just detach the rest of the free list
-                // and defer the actual cuMemFree calls until after we
-                // release the free_list_lock.
-                to_free = item;
-                *prev_ptr = nullptr;
-                item = nullptr;
-                break;
-            } else {
-                prev_ptr = &item->next;
-                item = item->next;
-            }
-            depth++;
-        }
-
-        if (best) {
-            p = best->ptr;
-            *best_prev = best->next;
-            free(best);
+        uint64_t block = 0, offset = 0;
+        int result = device_memory_pool_reserve(user_context, &memory_pool, ctx.context, stream, size, &block, &offset);
+        if (result != 0) {
+            error(user_context) << "CUDA: Failed to allocate " << (uint64_t)size << " bytes from the device memory pool\n";
+            return result;
         }
-    }
-
-    while (to_free) {
-        FreeListItem *next = to_free->next;
-        cuMemFree(to_free->ptr);
-        free(to_free);
-        to_free = next;
-    }
-
-    if (!p) {
+        p = (CUdeviceptr)(block + offset);
+        debug(user_context) << "    allocated " << (void *)p << " from the pool\n";
+    } else {
         debug(user_context) << "    cuMemAlloc " << (uint64_t)size << " -> ";
-
-        // Quantize all allocation sizes to the top 4 bits, to make
-        // reuse likelier. Wastes on average 4% memory per allocation.
-
         CUresult err = cuMemAlloc(&p, size);
         if (err == CUDA_ERROR_OUT_OF_MEMORY) {
             halide_cuda_release_unused_device_allocations(user_context);
@@ -878,6 +1750,7 @@ WEAK int halide_cuda_device_malloc(void *user_context, halide_buffer_t *buf) {
         }
     }
     halide_abort_if_false(user_context, p);
+    track_allocation(ctx.context, p, size);
     buf->device = p;
     buf->device_interface = &cuda_device_interface;
     buf->device_interface->impl->use_module();
@@ -951,6 +1824,103 @@ WEAK int cuda_do_multidimensional_copy(void *user_context, const device_copy &c,
     }
     return 0;
 }
+
+// Copy between the host and the device via a pinned staging buffer. A
+// copy to the device goes on its own stream and is not waited for here;
+// the tracked uses make the next use of the destination wait for it
+// instead, so it overlaps whatever is already enqueued on 'stream'. A
+// copy to the host must be complete before we return, but is still
+// faster from pinned memory. Sets *staged if the copy was done.
+WEAK int cuda_do_staged_copy(void *user_context, CUcontext ctx, const device_copy &c,
+                             const halide_buffer_t *src, const halide_buffer_t *dst, bool from_host,
+                             CUstream stream, const BufferAccess *accesses, int num_accesses, bool *staged) {
+    const halide_buffer_t *host_buf = from_host ? src : dst;
+    const uint8_t *host_begin = host_buf->begin();
+    const size_t host_size = host_buf->size_in_bytes();
+    if (host_size == 0) {
+        return 0;
+    }
+
+    int err = 0;
+    CUstream copy_stream = stream;
+    if (from_host) {
+        err = enable_use_tracking(user_context);
+        if (err == 0) {
+            err = get_copy_stream(user_context, ctx, &copy_stream);
+        }
+        if (err != 0) {
+            return err;
+        }
+    }
+
+    StagingBuffer *b = nullptr;
+    err = acquire_staging_buffer(user_context, ctx, host_size, &b);
+    if (err != 0) {
+        return err;
+    }
+    *staged = true;
+
+    // The staging buffer mirrors the whole footprint of the host buffer,
+    // so the strides of the copy are unchanged.
+    uint8_t *staged_host = (uint8_t *)b->host + (host_buf->host - host_begin);
+    device_copy staged_c = c;
+    if (from_host) {
+        memcpy(b->host, host_begin, host_size);
+        staged_c.src = (uint64_t)staged_host;
+    } else {
+        staged_c.dst = (uint64_t)staged_host;
+    }
+
+    err = wait_for_conflicting_uses(user_context, ctx, copy_stream, accesses, num_accesses);
+    if (err == 0) {
+        err = cuda_do_multidimensional_copy(user_context, staged_c, staged_c.src + staged_c.src_begin, staged_c.dst,
+                                            dst->dimensions, from_host, !from_host, copy_stream);
+    }
+    if (err == 0) {
+        err = record_uses(user_context, ctx, copy_stream, accesses, num_accesses);
+    }
+    if (err == 0 && from_host && !is_tracked_allocation(ctx, (CUdeviceptr)dst->device)) {
+        // Nothing will know to wait for the copy (e.g. the allocation was
+        // wrapped with halide_cuda_wrap_device_ptr), so make 'stream' wait
+        // for it now. This still doesn't block the host.
+        CUevent copied = nullptr;
+        err = cuEventCreate(&copied, CU_EVENT_DISABLE_TIMING);
+        if (err == 0) {
+            err = cuEventRecord(copied, copy_stream);
+            if (err == 0) {
+                err = cuStreamWaitEvent(stream, copied, 0);
+            }
+            cuEventDestroy(copied);
+        }
+        if (err != 0) {
+            error(user_context) << "CUDA: failed to wait for an async copy: " << get_error_name((CUresult)err);
+        }
+    }
+    if (err == 0 && !from_host) {
+        err = cuEventRecord(b->done, copy_stream);
+        if (err == 0) {
+            err = cuEventSynchronize(b->done);
+        }
+        if (err != 0) {
+            error(user_context) << "CUDA: failed to wait for a copy to the host: " << get_error_name((CUresult)err);
+        } else {
+            // Copy back only the parts of the host buffer that the copy
+            // covers; any gaps in it are to be left alone.
+            device_copy back = c;
+            back.src = (uint64_t)staged_host;
+            back.src_begin = 0;
+            for (int i = 0; i < MAX_COPY_DIMS; i++) {
+                back.src_stride_bytes[i] = c.dst_stride_bytes[i];
+            }
+            copy_memory(back, user_context);
+        }
+    }
+    int release_err = release_staging_buffer(user_context, b, copy_stream);
+    if (err == 0) {
+        err = release_err;
+    }
+    return err;
+}
 }  // namespace
 
 WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src,
@@ -1006,7 +1976,34 @@ WEAK int halide_cuda_buffer_copy(void *user_context, struct halide_buffer_t *src
             }
         }
 
-        err = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, stream);
+        BufferAccess accesses[2];
+        int num_accesses = 0;
+        if (!from_host) {
+            accesses[num_accesses++] = {(CUdeviceptr)src->device, false};
+        }
+        if (!to_host) {
+            accesses[num_accesses++] = {(CUdeviceptr)dst->device, true};
+        }
+        err = interrupt_graph_session(user_context, ctx.context, stream, false);
+        if (err != 0) {
+            return err;
+        }
+
+        bool staged = false;
+        if (from_host != to_host && async_copies_enabled() &&
+            cuStreamCreate && cuStreamWaitEvent && cuEventCreate && cuEventRecord &&
+            cuEventQuery && cuEventSynchronize && cuMemHostAlloc && cuMemFreeHost) {
+            err = cuda_do_staged_copy(user_context, ctx.context, c, src, dst, from_host, stream, accesses, num_accesses, &staged);
+        }
+        if (!staged && err == 0) {
+            err = wait_for_conflicting_uses(user_context, ctx.context, stream, accesses, num_accesses);
+            if (err == 0) {
+                err = cuda_do_multidimensional_copy(user_context, c, c.src + c.src_begin, c.dst, dst->dimensions, from_host, to_host, stream);
+            }
+            if (err == 0) {
+                err = record_uses(user_context, ctx.context, stream, accesses, num_accesses);
+            }
+        }
 
 #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -1090,6 +2087,10 @@ WEAK int halide_cuda_device_sync(void *user_context, struct halide_buffer_t *) {
         if (result != 0) {
             error(user_context) << "CUDA: In halide_cuda_device_sync, halide_cuda_get_stream returned " << result << "\n";
         }
+        result = interrupt_graph_session(user_context, ctx.context, stream, false);
+        if (result != 0) {
+            return result;
+        }
         err = cuStreamSynchronize(stream);
     } else {
         err = cuCtxSynchronize();
@@ -1164,11 +2165,15 @@ WEAK int halide_cuda_run(void *user_context,
     // has to be translated.
     void **translated_args = (void **)malloc((num_args + 1) * sizeof(void *));
     uint64_t *dev_handles = (uint64_t *)malloc(num_args * sizeof(uint64_t));
+    BufferAccess *accesses = (BufferAccess *)malloc(num_args * sizeof(BufferAccess));
+    int num_accesses = 0;
     for (size_t i = 0; i <= num_args; i++) {  // Get nullptr at end.
         if (arg_is_buffer[i]) {
             halide_abort_if_false(user_context, arg_sizes[i] == sizeof(uint64_t));
             dev_handles[i] = ((halide_buffer_t *)args[i])->device;
             translated_args[i] = &(dev_handles[i]);
+            // 2 marks a buffer the kernel only reads.
+            accesses[num_accesses++] = {(CUdeviceptr)dev_handles[i], arg_is_buffer[i] != 2};
             debug(user_context) << "    halide_cuda_run translated arg" << (int)i
                                 << " [" << (*((void **)translated_args[i])) << " ...]\n";
         } else {
@@ -1183,12 +2188,37 @@ WEAK int halide_cuda_run(void *user_context,
         int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
         if (result != 0) {
             error(user_context) << "CUDA: In halide_cuda_run, halide_cuda_get_stream returned " << result << "\n";
+            free(accesses);
+            free(dev_handles);
+            free(translated_args);
+            return result;
+        }
+    }
+
+    if (num_graph_sessions) {
+        const unsigned int dims[7] = {(unsigned int)blocksX, (unsigned int)blocksY, (unsigned int)blocksZ,
+                                      (unsigned int)threadsX, (unsigned int)threadsY, (unsigned int)threadsZ,
+                                      (unsigned int)shared_mem_bytes};
+        bool handled = false;
+        int result = graph_session_launch(user_context, ctx.context, stream, f, dims,
+                                          num_args, arg_sizes, translated_args,
+                                          accesses, num_accesses, &handled);
+        if (handled || result != 0) {
+            free(accesses);
             free(dev_handles);
             free(translated_args);
             return result;
         }
     }
 
+    int result = wait_for_conflicting_uses(user_context, ctx.context, stream, accesses, num_accesses);
+    if (result != 0) {
+        free(accesses);
+        free(dev_handles);
+        free(translated_args);
+        return result;
+    }
+
     err = cuLaunchKernel(f,
                          blocksX, blocksY, blocksZ,
                          threadsX, threadsY, threadsZ,
@@ -1199,11 +2229,18 @@ WEAK int halide_cuda_run(void *user_context,
     free(dev_handles);
     free(translated_args);
     if (err != CUDA_SUCCESS) {
+        free(accesses);
         error(user_context) << "CUDA: cuLaunchKernel failed: "
                             << get_error_name(err);
         return err;
     }
 
+    result = record_uses(user_context, ctx.context, stream, accesses, num_accesses);
+    free(accesses);
+    if (result != 0) {
+        return result;
+    }
+
 #ifdef DEBUG_RUNTIME
     err = cuCtxSynchronize();
     if (err != CUDA_SUCCESS) {
@@ -1217,6 +2254,140 @@ WEAK int halide_cuda_run(void *user_context,
     return 0;
 }
 
+WEAK int halide_cuda_graph_begin(void *user_context, uint64_t key) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_begin (user_context: " << user_context
+        << ", key: " << key << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    if (!graphs_supported()) {
+        // Everything just runs as usual.
+        debug(user_context) << "    CUDA graphs are not supported by the driver\n";
+        return 0;
+    }
+
+    CUstream stream = nullptr;
+    int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: In halide_cuda_graph_begin, halide_cuda_get_stream returned " << result << "\n";
+        return result;
+    }
+
+    ScopedMutexLock lock(&graphs_lock);
+    if (find_graph_session_already_locked(ctx.context, stream)) {
+        error(user_context) << "CUDA: halide_cuda_graph_begin called again before halide_cuda_graph_end on the same stream\n";
+        return halide_error_code_generic_error;
+    }
+
+    CachedGraph *g = cached_graphs;
+    while (g && !(g->ctx == ctx.context && g->stream == stream && g->key == key)) {
+        g = g->next;
+    }
+
+    GraphSession *s = (GraphSession *)malloc(sizeof(GraphSession));
+    if (!s) {
+        error(user_context) << "CUDA: Out of memory in halide_cuda_graph_begin\n";
+        return halide_error_code_out_of_memory;
+    }
+    memset(s, 0, sizeof(GraphSession));
+    s->ctx = ctx.context;
+    s->stream = stream;
+    s->key = key;
+    s->replaying = g;
+    s->graphable = true;
+    s->next = graph_sessions;
+    graph_sessions = s;
+    num_graph_sessions++;
+    return 0;
+}
+
+WEAK int halide_cuda_graph_end(void *user_context) {
+    debug(user_context)
+        << "CUDA: halide_cuda_graph_end (user_context: " << user_context << ")\n";
+
+    Context ctx(user_context);
+    if (ctx.error != CUDA_SUCCESS) {
+        return ctx.error;
+    }
+
+    if (!graphs_supported()) {
+        return 0;
+    }
+
+    CUstream stream = nullptr;
+    int result = halide_cuda_get_stream(user_context, ctx.context, &stream);
+    if (result != 0) {
+        error(user_context) << "CUDA: In halide_cuda_graph_end, halide_cuda_get_stream returned " << result << "\n";
+        return result;
+    }
+
+    ScopedMutexLock lock(&graphs_lock);
+    GraphSession **prev = &graph_sessions;
+    while (*prev && !((*prev)->ctx == ctx.context && (*prev)->stream == stream)) {
+        prev = &(*prev)->next;
+    }
+    GraphSession *s = *prev;
+    if (!s) {
+        error(user_context) << "CUDA: halide_cuda_graph_end called without halide_cuda_graph_begin\n";
+        return halide_error_code_generic_error;
+    }
+    *prev = s->next;
+    num_graph_sessions--;
+
+    if (s->replaying && s->num_matched == s->replaying->launches.size) {
+        result = launch_cached_graph(user_context, s->replaying);
+        clear_graph_launches(s->recorded);
+        free(s);
+        return result;
+    }
+
+    // The session didn't make all the launches of the graph it was
+    // replaying, so it stands for the ones it did make.
+    result = stop_replaying_already_locked(user_context, s);
+    CachedGraph *g = nullptr;
+    if (result == 0 && s->graphable && s->recorded.size > 0) {
+        g = (CachedGraph *)malloc(sizeof(CachedGraph));
+    }
+    if (!g) {
+        // Leave any older graph for the key in place.
+        clear_graph_launches(s->recorded);
+        free(s);
+        return result;
+    }
+    memset(g, 0, sizeof(CachedGraph));
+    g->ctx = s->ctx;
+    g->stream = s->stream;
+    g->key = s->key;
+    g->launches = s->recorded;
+    free(s);
+
+    CUresult err = instantiate_graph(user_context, g);
+    debug(user_context) << "    made a graph of " << g->launches.size << " launches: "
+                        << get_error_name(err) << "\n";
+    if (err != CUDA_SUCCESS) {
+        // Not an error; later sessions will just try again.
+        destroy_cached_graph(g);
+        return 0;
+    }
+
+    // Replace any older graph for the same key.
+    for (CachedGraph **p = &cached_graphs; *p; p = &(*p)->next) {
+        if ((*p)->ctx == g->ctx && (*p)->stream == g->stream && (*p)->key == g->key) {
+            CachedGraph *old = *p;
+            *p = old->next;
+            destroy_cached_graph(old);
+            break;
+        }
+    }
+    g->next = cached_graphs;
+    cached_graphs = g;
+    return 0;
+}
+
 WEAK int halide_cuda_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
     return halide_default_device_and_host_malloc(user_context, buf, &cuda_device_interface);
 }
@@ -1315,6 +2486,90 @@ WEAK int halide_cuda_compute_capability(void *user_context, int *major, int *min
     return 0;
 }
 
+WEAK int halide_cuda_preferred_block_size(void *user_context, int registers_per_thread,
+                                          int shared_memory_per_block) {
+    Context ctx(user_context);
+    if (ctx.error != 0) {
+        return 0;
+    }
+
+    CUdevice dev;
+    CUresult err = cuCtxGetDevice(&dev);
+    if (err != CUDA_SUCCESS) {
+        error(user_context)
+            << "CUDA: cuCtxGetDevice failed ("
+            << Halide::Runtime::Internal::Cuda::get_error_name(err)
+            << ")";
+        return 0;
+    }
+
+    int warp_size = 0, max_threads_per_block = 0, max_threads_per_sm = 0;
+    int max_registers_per_block = 0, max_registers_per_sm = 0;
+    int max_shared_per_block = 0, max_shared_per_sm = 0;
+    struct {
+        int *dst;
+        CUdevice_attribute attr;
+    } attrs[] = {
+        {&warp_size, CU_DEVICE_ATTRIBUTE_WARP_SIZE},
+        {&max_threads_per_block, CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_BLOCK},
+        {&max_threads_per_sm, CU_DEVICE_ATTRIBUTE_MAX_THREADS_PER_MULTIPROCESSOR},
+        {&max_registers_per_block, CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_BLOCK},
+        {&max_registers_per_sm, CU_DEVICE_ATTRIBUTE_MAX_REGISTERS_PER_MULTIPROCESSOR},
+        {&max_shared_per_block, CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_BLOCK},
+        {&max_shared_per_sm, CU_DEVICE_ATTRIBUTE_MAX_SHARED_MEMORY_PER_MULTIPROCESSOR},
+        {nullptr, CU_DEVICE_ATTRIBUTE_MAX}};
+    for (int i = 0; attrs[i].dst; i++) {
+        err = cuDeviceGetAttribute(attrs[i].dst, attrs[i].attr, dev);
+        if (err != CUDA_SUCCESS) {
+            error(user_context)
+                << "CUDA: cuDeviceGetAttribute failed ("
+                << Halide::Runtime::Internal::Cuda::get_error_name(err)
+                << ") for attribute " << (int)attrs[i].attr;
+            return 0;
+        }
+    }
+    // Older drivers don't know this one. Sixteen is the smallest
+    // limit of any device with compute capability 3.0 or above.
+    int max_blocks_per_sm = 0;
+    if (cuDeviceGetAttribute(&max_blocks_per_sm, CU_DEVICE_ATTRIBUTE_MAX_BLOCKS_PER_MULTIPROCESSOR, dev) != CUDA_SUCCESS ||
+        max_blocks_per_sm <= 0) {
+        max_blocks_per_sm = 16;
+    }
+
+    // Registers are allocated to warps in units of 256.
+    int registers_per_warp = registers_per_thread * warp_size;
+    registers_per_warp = ((registers_per_warp + 255) / 256) * 256;
+
+    // Find the block size that keeps the most threads resident on
+    // each multiprocessor, favoring larger blocks, as
+    // cuOccupancyMaxPotentialBlockSize does for a compiled kernel.
+    int best_block_size = 0, best_resident_threads = 0;
+    for (int block_size = max_threads_per_block; block_size >= warp_size; block_size -= warp_size) {
+        int warps = (block_size + warp_size - 1) / warp_size;
+        if (warps * registers_per_warp > max_registers_per_block ||
+            shared_memory_per_block > max_shared_per_block) {
+            continue;
+        }
+        int blocks = max_threads_per_sm / (warps * warp_size);
+        if (registers_per_warp > 0) {
+            blocks = min(blocks, max_registers_per_sm / (warps * registers_per_warp));
+        }
+        if (shared_memory_per_block > 0) {
+            blocks = min(blocks, max_shared_per_sm / shared_memory_per_block);
+        }
+        blocks = min(blocks, max_blocks_per_sm);
+        if (blocks * block_size > best_resident_threads) {
+            best_resident_threads = blocks * block_size;
+            best_block_size = block_size;
+        }
+    }
+
+    debug(user_context) << "CUDA: preferred block size for " << registers_per_thread
+                        << " registers per thread and " << shared_memory_per_block
+                        << " bytes of shared memory per block: " << best_block_size << "\n";
+    return best_block_size;
+}
+
 namespace {
 WEAK __attribute__((destructor)) void halide_cuda_cleanup() {
     compilation_cache.release_all(nullptr, cuModuleUnload);
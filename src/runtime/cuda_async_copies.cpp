@@ -0,0 +1,16 @@
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Cuda {
+
+// Selected by the cuda_async_copies target feature. See cuda.cpp.
+WEAK bool async_copies_enabled() {
+    return true;
+}
+
+}  // namespace Cuda
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
@@ -0,0 +1,16 @@
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Cuda {
+
+// Used in place of cuda_async_copies.cpp when the cuda_async_copies target feature is off. See cuda.cpp.
+WEAK bool async_copies_enabled() {
+    return false;
+}
+
+}  // namespace Cuda
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
@@ -51,6 +51,27 @@ CUDA_FN_4000(CUresult, cuCtxPopCurrent, cuCtxPopCurrent_v2, (CUcontext * pctx));
 CUDA_FN(CUresult, cuPointerGetAttribute, (void *result, int query, CUdeviceptr ptr));
 
 CUDA_FN_OPTIONAL(CUresult, cuStreamSynchronize, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamCreate, (CUstream * phStream, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuStreamDestroy, (CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuStreamWaitEvent, (CUstream hStream, CUevent hEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuEventCreate, (CUevent * phEvent, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuEventDestroy, (CUevent hEvent));
+CUDA_FN_OPTIONAL(CUresult, cuEventRecord, (CUevent hEvent, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuEventQuery, (CUevent hEvent));
+CUDA_FN_OPTIONAL(CUresult, cuEventSynchronize, (CUevent hEvent));
+CUDA_FN_OPTIONAL(CUresult, cuMemHostAlloc, (void **pp, size_t bytesize, unsigned int Flags));
+CUDA_FN_OPTIONAL(CUresult, cuMemFreeHost, (void *p));
+CUDA_FN_OPTIONAL(CUresult, cuDriverGetVersion, (int *driverVersion));
+CUDA_FN_OPTIONAL(CUresult, cuLinkCreate, (unsigned int numOptions, CUjit_option *options, void **optionValues, CUlinkState *stateOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkAddData, (CUlinkState state, CUjitInputType type, void *data, size_t size, const char *name, unsigned int numOptions, CUjit_option *options, void **optionValues));
+CUDA_FN_OPTIONAL(CUresult, cuLinkComplete, (CUlinkState state, void **cubinOut, size_t *sizeOut));
+CUDA_FN_OPTIONAL(CUresult, cuLinkDestroy, (CUlinkState state));
+CUDA_FN_OPTIONAL(CUresult, cuGraphCreate, (CUgraph * phGraph, unsigned int flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphAddKernelNode, (CUgraphNode * phGraphNode, CUgraph hGraph, const CUgraphNode *dependencies, size_t numDependencies, const CUDA_KERNEL_NODE_PARAMS *nodeParams));
+CUDA_FN_OPTIONAL(CUresult, cuGraphInstantiateWithFlags, (CUgraphExec * phGraphExec, CUgraph hGraph, unsigned long long flags));
+CUDA_FN_OPTIONAL(CUresult, cuGraphLaunch, (CUgraphExec hGraphExec, CUstream hStream));
+CUDA_FN_OPTIONAL(CUresult, cuGraphExecDestroy, (CUgraphExec hGraphExec));
+CUDA_FN_OPTIONAL(CUresult, cuGraphDestroy, (CUgraph hGraph));
 
 #undef CUDA_FN
 #undef CUDA_FN_OPTIONAL
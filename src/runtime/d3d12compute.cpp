@@ -45,6 +45,7 @@
 #include "HalideRuntimeD3D12Compute.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "gpu_context_common.h"
 #include "printer.h"
 #include "scoped_spin_lock.h"
@@ -609,13 +610,16 @@ static const uint32_t ResourceBindingLimits[NumSlots] = {
     16,  // UAV
     14,  // CBV
     25,  // SRV (the actual tier-1 limit is 128, but will allow only 25 for now)
-    // TODO(marcos): we may consider increasing it to the limit once we have a
-    // pool of d3d12_binder objects that are recycled whenever kernels are run
-    // (at the moment, a new binder is created/destroyed with every kernel run)
+    // TODO(marcos): we may consider increasing it to the limit, now that the
+    // d3d12_binder objects are recycled along with the frames they belong to
 };
 
+// Number of kernel dispatches that can be recorded into a single frame; each
+// one gets its own descriptor table (and argument buffer) within the frame.
+static const uint32_t MaxDispatchesPerFrame = 16;
+
 struct d3d12_binder {
-    ID3D12DescriptorHeap *descriptorHeap;
+    ID3D12DescriptorHeap *descriptorHeap;  // MaxDispatchesPerFrame tables
     D3D12_CPU_DESCRIPTOR_HANDLE baseCPU;
     D3D12_GPU_DESCRIPTOR_HANDLE baseGPU;
     D3D12_CPU_DESCRIPTOR_HANDLE CPU[NumSlots];
@@ -679,21 +683,29 @@ WEAK d3d12_command_allocator *cmd_allocator_main = nullptr;
 // objects can be reclaimed and reused for subsequent kernel dispatches.
 // As there's not enough information about full Pipelines and Stages in the runtime
 // back-end to possibly group these API objects together in a more coarse "frame",
-// each kernel dispatch must be seen as a "frame" on its own for lifetime tracking.
+// each kernel dispatch could be seen as a "frame" on its own for lifetime tracking.
+// Instead, consecutive dispatches (and device-to-device copies) are recorded into
+// the same "pending" frame, which is only submitted to the queue once the host
+// needs to see the results of its work (or once it is full), so that there is a
+// single ExecuteCommandLists() call and fence signal for a whole sequence of
+// kernels rather than one per dispatch.
 struct d3d12_frame {
     d3d12_compute_command_list *cmd_list;
     d3d12_binder *desc_binder;
-    d3d12_buffer args_buffer;
+    d3d12_buffer args_buffer[MaxDispatchesPerFrame];
+    uint32_t dispatches;
     uint64_t fence_signal;
 };
 
 static const int MaxFrames = 8;
 WEAK d3d12_frame frame_pool[MaxFrames] = {};
 static uint64_t frame_selector = 0;
+WEAK d3d12_frame *pending_frame = nullptr;
 
 static void wait_until_completed(d3d12_compute_command_list *cmdList);
 static d3d12_command_list *new_compute_command_list(d3d12_device *device, d3d12_command_allocator *allocator);
 static d3d12_binder *new_descriptor_binder(d3d12_device *device);
+static void select_descriptor_table(d3d12_binder *binder, uint32_t table);
 static void commit_command_list(d3d12_compute_command_list *cmdList);
 
 static d3d12_frame *acquire_frame(d3d12_device *device) {
@@ -721,30 +733,60 @@ static d3d12_frame *acquire_frame(d3d12_device *device) {
         }
     } else {
         (*frame.cmd_list)->Reset((*cmd_allocator_main), nullptr);
-
-        d3d12_binder *binder = frame.desc_binder;
-        UINT descriptorSize = binder->descriptorSize;
-        D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = binder->baseCPU;
-        binder->CPU[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
-        binder->CPU[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-        binder->CPU[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
-        D3D12_GPU_DESCRIPTOR_HANDLE baseGPU = binder->baseGPU;
-        binder->GPU[UAV].ptr = (baseGPU.ptr += descriptorSize * 0);
-        binder->GPU[CBV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-        binder->GPU[SRV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
     }
+    frame.dispatches = 0;
 
     ++frame_selector;
 
     return &frame;
 }
 
-static void enqueue_frame(d3d12_frame *frame) {
+static void submit_frame(d3d12_frame *frame) {
     TRACELOG;
     commit_command_list(frame->cmd_list);
     frame->fence_signal = frame->cmd_list->signal;
 }
 
+static void flush_pending_frame() {
+    TRACELOG;
+    if (pending_frame != nullptr) {
+        d3d12_frame *frame = pending_frame;
+        pending_frame = nullptr;
+        submit_frame(frame);
+    }
+}
+
+// The frame for more work to be recorded into, along with whatever was
+// recorded since the last submission; 'dispatch' asks for a frame that
+// still has a descriptor table to spare.
+static d3d12_frame *acquire_pending_frame(d3d12_device *device, bool dispatch) {
+    TRACELOG;
+    if ((pending_frame != nullptr) && dispatch && (pending_frame->dispatches == MaxDispatchesPerFrame)) {
+        TRACEPRINT("pending frame is full: submitting it...\n");
+        flush_pending_frame();
+    }
+    if (pending_frame == nullptr) {
+        pending_frame = acquire_frame(device);
+    }
+    return pending_frame;
+}
+
+// The fence signal the pending frame will be given on submission: every
+// submission goes out after the pending frame, so it is always the next one.
+static uint64_t pending_frame_signal() {
+    return __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST) + 1;
+}
+
+static void enqueue_frame(d3d12_frame *frame) {
+    TRACELOG;
+    if (frame != pending_frame) {
+        flush_pending_frame();
+    } else {
+        pending_frame = nullptr;
+    }
+    submit_frame(frame);
+}
+
 template<typename d3d12_T>
 static void release_d3d12_object(d3d12_T *obj) {
     TRACELOG;
@@ -861,10 +903,13 @@ void release_d3d12_object<d3d12_frame>(d3d12_frame *frame) {
     TRACELOG;
     release_object(frame->cmd_list);
     release_object(frame->desc_binder);
-    release_object(&frame->args_buffer);
+    for (auto &args_buffer : frame->args_buffer) {
+        release_object(&args_buffer);
+        args_buffer = zero_struct<d3d12_buffer>();
+    }
     frame->cmd_list = nullptr;
     frame->desc_binder = nullptr;
-    frame->args_buffer = zero_struct<d3d12_buffer>();
+    frame->dispatches = 0;
     frame->fence_signal = 0;
 }
 
@@ -1730,6 +1775,24 @@ static void end_recording(d3d12_compute_command_list *cmdList) {
     (*cmdList)->Close();
 }
 
+// Point the binder at the descriptor table to be bound for the next dispatch.
+static void select_descriptor_table(d3d12_binder *binder, uint32_t table) {
+    TRACELOG;
+    halide_abort_if_false(user_context, (table < MaxDispatchesPerFrame));
+    UINT descriptorSize = binder->descriptorSize;
+    UINT tableSize = descriptorSize * (ResourceBindingLimits[UAV] + ResourceBindingLimits[CBV] + ResourceBindingLimits[SRV]);
+    D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = binder->baseCPU;
+    baseCPU.ptr += tableSize * table;
+    binder->CPU[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
+    binder->CPU[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
+    binder->CPU[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+    D3D12_GPU_DESCRIPTOR_HANDLE baseGPU = binder->baseGPU;
+    baseGPU.ptr += tableSize * table;
+    binder->GPU[UAV].ptr = (baseGPU.ptr += descriptorSize * 0);
+    binder->GPU[CBV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
+    binder->GPU[SRV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+}
+
 static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
     TRACELOG;
     ID3D12DescriptorHeap *descriptorHeap = nullptr;
@@ -1740,6 +1803,7 @@ static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
         dhd.NumDescriptors += ResourceBindingLimits[UAV];
         dhd.NumDescriptors += ResourceBindingLimits[CBV];
         dhd.NumDescriptors += ResourceBindingLimits[SRV];
+        dhd.NumDescriptors *= MaxDispatchesPerFrame;
         dhd.Flags = D3D12_DESCRIPTOR_HEAP_FLAG_SHADER_VISIBLE;
         dhd.NodeMask = 0;
     }
@@ -1755,58 +1819,54 @@ static d3d12_binder *new_descriptor_binder(d3d12_device *device) {
     binder->descriptorHeap = descriptorHeap;
     binder->descriptorSize = descriptorSize;
 
-    D3D12_CPU_DESCRIPTOR_HANDLE baseCPU = binder->baseCPU = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
-    TRACEPRINT("descriptor heap base for CPU: " << baseCPU.ptr << " (" << (void *)baseCPU.ptr << ")\n");
-    binder->CPU[UAV].ptr = (baseCPU.ptr += descriptorSize * 0);
-    binder->CPU[CBV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-    binder->CPU[SRV].ptr = (baseCPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
-
-    D3D12_GPU_DESCRIPTOR_HANDLE baseGPU = binder->baseGPU = descriptorHeap->GetGPUDescriptorHandleForHeapStart();
-    TRACEPRINT("descriptor heap base for GPU: " << baseGPU.ptr << " (" << (void *)baseGPU.ptr << ")\n");
-    binder->GPU[UAV].ptr = (baseGPU.ptr += descriptorSize * 0);
-    binder->GPU[CBV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[UAV]);
-    binder->GPU[SRV].ptr = (baseGPU.ptr += descriptorSize * ResourceBindingLimits[CBV]);
+    binder->baseCPU = descriptorHeap->GetCPUDescriptorHandleForHeapStart();
+    TRACEPRINT("descriptor heap base for CPU: " << binder->baseCPU.ptr << " (" << (void *)binder->baseCPU.ptr << ")\n");
+    binder->baseGPU = descriptorHeap->GetGPUDescriptorHandleForHeapStart();
+    TRACEPRINT("descriptor heap base for GPU: " << binder->baseGPU.ptr << " (" << (void *)binder->baseGPU.ptr << ")\n");
 
     // initialize everything with null descriptors...
-    for (uint32_t i = 0; i < ResourceBindingLimits[UAV]; ++i) {
-        D3D12_UNORDERED_ACCESS_VIEW_DESC NullDescUAV = {};
-        {
-            NullDescUAV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
-            NullDescUAV.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
-            NullDescUAV.Buffer.FirstElement = 0;
-            NullDescUAV.Buffer.NumElements = 0;
-            NullDescUAV.Buffer.StructureByteStride = 0;
-            NullDescUAV.Buffer.CounterOffsetInBytes = 0;
-            NullDescUAV.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+    for (uint32_t table = 0; table < MaxDispatchesPerFrame; ++table) {
+        select_descriptor_table(binder, table);
+        for (uint32_t i = 0; i < ResourceBindingLimits[UAV]; ++i) {
+            D3D12_UNORDERED_ACCESS_VIEW_DESC NullDescUAV = {};
+            {
+                NullDescUAV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
+                NullDescUAV.ViewDimension = D3D12_UAV_DIMENSION_BUFFER;
+                NullDescUAV.Buffer.FirstElement = 0;
+                NullDescUAV.Buffer.NumElements = 0;
+                NullDescUAV.Buffer.StructureByteStride = 0;
+                NullDescUAV.Buffer.CounterOffsetInBytes = 0;
+                NullDescUAV.Buffer.Flags = D3D12_BUFFER_UAV_FLAG_NONE;
+            }
+            D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[UAV];
+            hCPU.ptr += i * descriptorSize;
+            (*device)->CreateUnorderedAccessView(nullptr, nullptr, &NullDescUAV, hCPU);
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[UAV];
-        hCPU.ptr += i * descriptorSize;
-        (*device)->CreateUnorderedAccessView(nullptr, nullptr, &NullDescUAV, hCPU);
-    }
-    for (uint32_t i = 0; i < ResourceBindingLimits[CBV]; ++i) {
-        D3D12_CONSTANT_BUFFER_VIEW_DESC NullDescCBV = {};
-        {
-            NullDescCBV.BufferLocation = 0;
-            NullDescCBV.SizeInBytes = 0;
+        for (uint32_t i = 0; i < ResourceBindingLimits[CBV]; ++i) {
+            D3D12_CONSTANT_BUFFER_VIEW_DESC NullDescCBV = {};
+            {
+                NullDescCBV.BufferLocation = 0;
+                NullDescCBV.SizeInBytes = 0;
+            }
+            D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[CBV];
+            hCPU.ptr += i * descriptorSize;
+            (*device)->CreateConstantBufferView(&NullDescCBV, hCPU);
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[CBV];
-        hCPU.ptr += i * descriptorSize;
-        (*device)->CreateConstantBufferView(&NullDescCBV, hCPU);
-    }
-    for (uint32_t i = 0; i < ResourceBindingLimits[SRV]; ++i) {
-        D3D12_SHADER_RESOURCE_VIEW_DESC NullDescSRV = {};
-        {
-            NullDescSRV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
-            NullDescSRV.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
-            NullDescSRV.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
-            NullDescSRV.Buffer.FirstElement = 0;
-            NullDescSRV.Buffer.NumElements = 0;
-            NullDescSRV.Buffer.StructureByteStride = 0;
-            NullDescSRV.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+        for (uint32_t i = 0; i < ResourceBindingLimits[SRV]; ++i) {
+            D3D12_SHADER_RESOURCE_VIEW_DESC NullDescSRV = {};
+            {
+                NullDescSRV.Format = DXGI_FORMAT_R8G8B8A8_UNORM;  // don't care, but can't be unknown...
+                NullDescSRV.ViewDimension = D3D12_SRV_DIMENSION_BUFFER;
+                NullDescSRV.Shader4ComponentMapping = D3D12_DEFAULT_SHADER_4_COMPONENT_MAPPING;
+                NullDescSRV.Buffer.FirstElement = 0;
+                NullDescSRV.Buffer.NumElements = 0;
+                NullDescSRV.Buffer.StructureByteStride = 0;
+                NullDescSRV.Buffer.Flags = D3D12_BUFFER_SRV_FLAG_NONE;
+            }
+            D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[SRV];
+            hCPU.ptr += i * descriptorSize;
+            (*device)->CreateShaderResourceView(nullptr, &NullDescSRV, hCPU);
         }
-        D3D12_CPU_DESCRIPTOR_HANDLE hCPU = binder->CPU[SRV];
-        hCPU.ptr += i * descriptorSize;
-        (*device)->CreateShaderResourceView(nullptr, &NullDescSRV, hCPU);
     }
 
     return binder;
@@ -2090,6 +2150,11 @@ static bool block_until_signaled(uint64_t signal) {
 static void wait_until_signaled(uint64_t signal) {
     TRACELOG;
 
+    if (signal > __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST)) {
+        // the work to wait for is still in the pending frame
+        flush_pending_frame();
+    }
+
     uint64_t current_signal = queue_fence->GetCompletedValue();
     if (current_signal >= signal) {
         TRACEPRINT("Already synced up!\n");
@@ -2121,6 +2186,7 @@ static void wait_until_completed(d3d12_frame *frame) {
 
 static void wait_until_idle() {
     TRACELOG;
+    flush_pending_frame();
     uint64_t signal = __atomic_load_n(&queue_last_signal, __ATOMIC_SEQ_CST);
     wait_until_signaled(signal);
 }
@@ -2266,11 +2332,15 @@ static void d3d12compute_device_sync_internal(d3d12_device *device, d3d12_buffer
         // also require a dedicated copy command queue to submit it... for now just
         // use the main compute queue and issue copies via compute command lists.
         // static const D3D12_COMMAND_LIST_TYPE Type = D3D12_COMMAND_LIST_TYPE_COPY;
-        d3d12_frame *frame = acquire_frame(device);
+        // the transfer goes out along with any pending work, in one submission
+        d3d12_frame *frame = acquire_pending_frame(device, false);
         d3d12_compute_command_list *blitCmdList = frame->cmd_list;
         synchronize_host_and_device_buffer_contents(blitCmdList, dev_buffer);
         enqueue_frame(frame);
         wait_until_completed(frame);
+    } else {
+        // wait for (and, if still pending, submit) the last work using the buffer
+        wait_until_signaled(dev_buffer->signal);
     }
 
     if (dev_buffer->xfer != nullptr) {
@@ -2342,12 +2412,12 @@ static int d3d12compute_buffer_copy(d3d12_device *device,
     // ReadWrite, ReadOnly and WriteOnly are shader usage hints, not copy hints
     // (there's no need to worry about them during device-to-device transfers)
 
-    d3d12_frame *frame = acquire_frame(device);
+    // no host access is involved, so the copy is left in the pending frame
+    d3d12_frame *frame = acquire_pending_frame(device, false);
     d3d12_compute_command_list *blitCmdList = frame->cmd_list;
     buffer_copy_command(blitCmdList, src, dst, src_byte_offset, dst_byte_offset, num_bytes);
-    enqueue_frame(frame);
-    src->signal = frame->fence_signal;
-    dst->signal = frame->fence_signal;
+    src->signal = pending_frame_signal();
+    dst->signal = pending_frame_signal();
 
     return 0;
 }
@@ -2588,67 +2658,31 @@ using namespace Halide::Runtime::Internal::D3D12Compute;
 
 // NOTE(marcos): purposedly disabling cache on 'master' for now
 WEAK bool enable_allocation_cache = false;
-static const int MaxBuffersInCache = 32;
-WEAK d3d12_buffer *buffer_pool[MaxBuffersInCache] = {};
-WEAK halide_mutex buffer_pool_lock;
 
-static d3d12_buffer *d3d12_allocation_cache_get_buffer(void *user_context, size_t size_in_bytes) {
+static uint64_t d3d12_allocate_pool_block(void *user_context, void *device_context, size_t size) {
     TRACELOG;
-
-    if (!halide_can_reuse_device_allocations(user_context) || !enable_allocation_cache) {
-        TRACEPRINT("(allocation cache is disabled...)\n");
-        return nullptr;
-    }
-
-    ScopedMutexLock lock(&buffer_pool_lock);
-
-    d3d12_buffer *d3d12_buf = nullptr;
-    size_t best_fit_size = ~0;
-    size_t best_fit_index = 0;
-    for (size_t i = 0; i < MaxBuffersInCache; ++i) {
-        if (buffer_pool[i] == nullptr) {
-            continue;
-        }
-        d3d12_buffer *dbuffer = buffer_pool[i];
-        if (dbuffer->capacityInBytes < size_in_bytes) {
-            continue;
-        }
-        if (dbuffer->capacityInBytes > best_fit_size) {
-            continue;
-        }
-        best_fit_size = dbuffer->capacityInBytes;
-        best_fit_index = i;
-        d3d12_buf = dbuffer;
-    }
-    if (d3d12_buf != nullptr) {
-        TRACEPRINT("serving request from allocation cache: " << size_in_bytes << " bytes from capacity of " << best_fit_size << "\n");
-        buffer_pool[best_fit_index] = nullptr;
+    d3d12_buffer *dbuffer = new_buffer((d3d12_device *)device_context, size);
+    if (dbuffer->resource == nullptr) {
+        release_d3d12_object(dbuffer);
+        return 0;
     }
-
-    return d3d12_buf;
+    return (uint64_t)dbuffer;
 }
 
-static bool d3d12_allocation_cache_put_buffer(void *user_context, d3d12_buffer *dbuffer) {
+static void d3d12_free_pool_block(void *user_context, void *device_context, uint64_t block) {
     TRACELOG;
+    d3d12_buffer *dbuffer = (d3d12_buffer *)block;
+    wait_until_signaled(dbuffer->signal);
+    release_d3d12_object(dbuffer);
+}
 
-    if (!halide_can_reuse_device_allocations(user_context) || !enable_allocation_cache) {
-        TRACEPRINT("(allocation cache is disabled...)\n");
-        return false;
-    }
-
-    ScopedMutexLock lock(&buffer_pool_lock);
-
-    for (auto &buffer : buffer_pool) {
-        if (buffer != nullptr) {
-            continue;
-        }
-        TRACEPRINT("caching allocation for later use...\n");
-        buffer = dbuffer;
-        return true;
-    }
+// Recycles d3d12_buffers while allocation caching is on. Each one carries
+// the views of a single halide_buffer_t, so every request gets one of
+// its own, which is handed to later requests of the same size class.
+WEAK DeviceMemoryPool d3d12_memory_pool = {{}, d3d12_allocate_pool_block, d3d12_free_pool_block, 0, 0, 256, false};
 
-    TRACEPRINT("cache is full: discarding buffer...\n");
-    return false;
+WEAK __attribute__((constructor)) void register_d3d12_allocation_pool() {
+    device_memory_pool_register(&d3d12_memory_pool, &d3d12compute_device_interface);
 }
 
 extern "C" {
@@ -2671,14 +2705,20 @@ WEAK int halide_d3d12compute_device_malloc(void *user_context, halide_buffer_t *
         halide_abort_if_false(user_context, buf->dim[i].stride >= 0);
     }
 
-    d3d12_buffer *d3d12_buf = d3d12_allocation_cache_get_buffer(user_context, size);
-
     D3D12ContextHolder d3d12_context(user_context, true);
     if (d3d12_context.error != 0) {
         return d3d12_context.error;
     }
 
-    if (d3d12_buf == nullptr) {
+    d3d12_buffer *d3d12_buf = nullptr;
+    if (halide_can_reuse_device_allocations(user_context) && enable_allocation_cache) {
+        uint64_t block = 0, offset = 0;
+        if (device_memory_pool_reserve(user_context, &d3d12_memory_pool, d3d12_context.device, d3d12_context.queue,
+                                       size, &block, &offset) == 0) {
+            d3d12_buf = (d3d12_buffer *)block;
+        }
+    } else {
+        TRACEPRINT("(allocation cache is disabled...)\n");
         d3d12_buf = new_buffer(d3d12_context.device, size);
     }
     if (d3d12_buf == nullptr) {
@@ -2706,7 +2746,9 @@ WEAK int halide_d3d12compute_device_free(void *user_context, halide_buffer_t *bu
     d3d12_buffer *dbuffer = peel_buffer(buf);
     TRACEPRINT("d3d12_buffer: " << dbuffer << "\n");
 
-    const bool cached = d3d12_allocation_cache_put_buffer(user_context, dbuffer);
+    D3D12ContextHolder d3d12_context(user_context, false);
+    const bool cached = (d3d12_context.error == 0) &&
+                        device_memory_pool_reclaim(user_context, &d3d12_memory_pool, d3d12_context.device, (uint64_t)dbuffer, 0);
 
     unwrap_buffer(buf);
 
@@ -2799,14 +2841,16 @@ WEAK int halide_d3d12compute_device_release(void *user_context) {
             release_object(&frame);
         }
 
-        for (auto &buffer : buffer_pool) {
-            release_object(buffer);
-        }
+        device_memory_pool_trim(user_context, &d3d12_memory_pool, device);
 
         compilation_cache.delete_context(user_context, device, release_object<d3d12_library>);
 
         // Release the device itself, if we created it.
         if (acquired_device == device) {
+            // Any buffers still allocated from the pool are released
+            // directly when freed.
+            device_memory_pool_forget(user_context, &d3d12_memory_pool, device);
+
             release_object(&upload);
             release_object(&readback);
             d3d12_buffer empty = {};
@@ -2974,10 +3018,12 @@ WEAK int halide_d3d12compute_run(void *user_context,
     bool found = compilation_cache.lookup(device, state_ptr, library);
     halide_abort_if_false(user_context, found && library != nullptr);
 
-    d3d12_frame *frame = acquire_frame(device);
+    d3d12_frame *frame = acquire_pending_frame(device, true);
+    uint32_t dispatch = frame->dispatches++;
     d3d12_compute_command_list *cmdList = frame->cmd_list;
     d3d12_binder *binder = frame->desc_binder;
-    d3d12_buffer &uniform_buffer = frame->args_buffer;
+    select_descriptor_table(binder, dispatch);
+    d3d12_buffer &uniform_buffer = frame->args_buffer[dispatch];
 
     // kernel code setup:
     d3d12_function *function = nullptr;
@@ -3154,10 +3200,9 @@ WEAK int halide_d3d12compute_run(void *user_context,
     end_profiling(cmdList, profiler);
 #endif
 
-    enqueue_frame(frame);
-
-    // broadcast fence signal checkpoint to the buffers being used
-    uint64_t checkpoint = frame->fence_signal;
+    // the frame is submitted once the host needs the results (or it fills up),
+    // so the buffers being used are tagged with the checkpoint it will signal
+    uint64_t checkpoint = pending_frame_signal();
     uniform_buffer.signal = checkpoint;
     for (size_t i = 0; i < num_buffer_args; i++) {
         d3d12_buffer *buffer = buffer_args[i];
@@ -3170,6 +3215,7 @@ WEAK int halide_d3d12compute_run(void *user_context,
 #endif
 
 #if HALIDE_D3D12_PROFILING
+    wait_until_signaled(checkpoint);
     uint64_t eps = (uint64_t)get_elapsed_time(profiler, ini, end);
     StackBasicPrinter<64>() << "kernel execution time: " << eps << "us.\n";
     // TODO: keep some live performance stats in the d3d12_function object
@@ -63,10 +63,69 @@ WEAK void copy_memory_helper(const device_copy &copy, int d, int64_t src_off, in
     }
 }
 
+// Host copies larger than this are split into pieces of about this
+// many bytes to do in parallel on the thread pool.
+#define PARALLEL_COPY_TASK_BYTES (256 * 1024)
+
+struct copy_memory_task_closure {
+    const device_copy *copy;
+    // The dimension split across tasks, or -1 to split the
+    // contiguous chunk.
+    int d;
+    uint64_t extent, per_task;
+};
+
+WEAK int copy_memory_task(void *user_context, int task, uint8_t *closure) {
+    const copy_memory_task_closure *c = (const copy_memory_task_closure *)closure;
+    const device_copy &copy = *c->copy;
+    uint64_t begin = task * c->per_task;
+    uint64_t end = begin + c->per_task;
+    if (end > c->extent) {
+        end = c->extent;
+    }
+    if (c->d == -1) {
+        const void *from = (void *)(copy.src + copy.src_begin + begin);
+        void *to = (void *)(copy.dst + begin);
+        memcpy(to, from, end - begin);
+    } else {
+        for (uint64_t i = begin; i < end; i++) {
+            copy_memory_helper(copy, c->d - 1,
+                               copy.src_begin + i * copy.src_stride_bytes[c->d],
+                               i * copy.dst_stride_bytes[c->d]);
+        }
+    }
+    return 0;
+}
+
 WEAK void copy_memory(const device_copy &copy, void *user_context) {
     // If this is a zero copy buffer, these pointers will be the same.
     if (copy.src != copy.dst) {
-        copy_memory_helper(copy, MAX_COPY_DIMS - 1, copy.src_begin, 0);
+        uint64_t bytes = copy.chunk_size;
+        int d = -1;
+        for (int i = 0; i < MAX_COPY_DIMS; i++) {
+            bytes *= copy.extent[i];
+            if (copy.extent[i] > 1) {
+                d = i;
+            }
+        }
+        // Split the outermost dimension of a large copy (or the
+        // chunk itself, if it is one contiguous copy) into tasks.
+        uint64_t extent = d == -1 ? copy.chunk_size : copy.extent[d];
+        uint64_t tasks = bytes / PARALLEL_COPY_TASK_BYTES;
+        if (tasks > extent) {
+            tasks = extent;
+        }
+        if (tasks > 1 && tasks < 0x7fffffff) {
+            copy_memory_task_closure closure;
+            closure.copy = &copy;
+            closure.d = d;
+            closure.extent = extent;
+            closure.per_task = (extent + tasks - 1) / tasks;
+            tasks = (extent + closure.per_task - 1) / closure.per_task;
+            halide_do_par_for(user_context, copy_memory_task, 0, (int)tasks, (uint8_t *)&closure);
+        } else {
+            copy_memory_helper(copy, MAX_COPY_DIMS - 1, copy.src_begin, 0);
+        }
     } else {
         debug(user_context) << "copy_memory: no copy needed as pointers are the same.\n";
     }
@@ -27,6 +27,254 @@ struct device_handle_wrapper {
 // need to be able to do a copy internaly as well.
 WEAK halide_mutex device_copy_mutex;
 
+// Sub-regions of buffers that are dirty on the host or the device,
+// recorded by halide_buffer_set_host_dirty_region and
+// halide_buffer_set_device_dirty_region. They are only meaningful while
+// the buffer has halide_buffer_flag_dirty_region set, which setting
+// either dirty flag the ordinary way clears. Entries may be evicted at
+// any time, which just means the whole buffer gets copied.
+constexpr int max_dirty_region_buffers = 16;
+constexpr int max_dirty_boxes = 4;
+constexpr int max_dirty_region_dims = 8;
+
+struct DirtyRegions {
+    const halide_buffer_t *buf;
+    const uint8_t *host;
+    int num_boxes;
+    halide_dimension_t boxes[max_dirty_boxes][max_dirty_region_dims];
+};
+
+// Guarded by the device_copy_mutex.
+WEAK DirtyRegions dirty_regions[max_dirty_region_buffers];
+WEAK int next_dirty_regions_victim = 0;
+
+WEAK DirtyRegions *find_dirty_regions(const halide_buffer_t *buf) {
+    for (DirtyRegions &r : dirty_regions) {
+        if (r.buf == buf) {
+            if (r.host == buf->host && buf->get_flag(halide_buffer_flag_dirty_region)) {
+                return &r;
+            }
+            // Stale.
+            r.buf = nullptr;
+            return nullptr;
+        }
+    }
+    return nullptr;
+}
+
+WEAK void forget_dirty_regions(const halide_buffer_t *buf) {
+    for (DirtyRegions &r : dirty_regions) {
+        if (r.buf == buf) {
+            r.buf = nullptr;
+        }
+    }
+}
+
+WEAK DirtyRegions *new_dirty_regions(const halide_buffer_t *buf) {
+    DirtyRegions *slot = nullptr;
+    for (DirtyRegions &r : dirty_regions) {
+        if (r.buf == nullptr) {
+            slot = &r;
+            break;
+        }
+    }
+    if (!slot) {
+        slot = &dirty_regions[next_dirty_regions_victim];
+        next_dirty_regions_victim = (next_dirty_regions_victim + 1) % max_dirty_region_buffers;
+    }
+    slot->buf = buf;
+    slot->host = buf->host;
+    slot->num_boxes = 0;
+    return slot;
+}
+
+// Whether box a contains box b.
+WEAK bool box_contains(const halide_dimension_t *a, const halide_dimension_t *b, int dims) {
+    for (int i = 0; i < dims; i++) {
+        if (b[i].min < a[i].min || b[i].min + b[i].extent > a[i].min + a[i].extent) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// If the union of boxes a and b is a box (they match in all dimensions
+// but one, and touch or overlap in that one), replace a with it.
+WEAK bool merge_adjacent_boxes(halide_dimension_t *a, const halide_dimension_t *b, int dims) {
+    int differing = -1;
+    for (int i = 0; i < dims; i++) {
+        if (a[i].min != b[i].min || a[i].extent != b[i].extent) {
+            if (differing >= 0) {
+                return false;
+            }
+            differing = i;
+        }
+    }
+    if (differing < 0) {
+        return true;
+    }
+    halide_dimension_t &d = a[differing];
+    const halide_dimension_t &e = b[differing];
+    if (e.min > d.min + d.extent || d.min > e.min + e.extent) {
+        return false;
+    }
+    const int32_t min = d.min < e.min ? d.min : e.min;
+    const int32_t max = (d.min + d.extent) > (e.min + e.extent) ? (d.min + d.extent) : (e.min + e.extent);
+    d.min = min;
+    d.extent = max - min;
+    return true;
+}
+
+WEAK void remove_dirty_box(DirtyRegions *r, int i) {
+    for (int j = i; j < r->num_boxes - 1; j++) {
+        memcpy(r->boxes[j], r->boxes[j + 1], sizeof(r->boxes[j]));
+    }
+    r->num_boxes--;
+}
+
+WEAK void add_dirty_box(DirtyRegions *r, const halide_dimension_t *box, int dims) {
+    halide_dimension_t merged[max_dirty_region_dims];
+    memcpy(merged, box, dims * sizeof(halide_dimension_t));
+
+    // Absorb every recorded box the new one contains, is contained by,
+    // or can be merged with, until there are no more.
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 0; i < r->num_boxes; i++) {
+            halide_dimension_t *b = r->boxes[i];
+            if (box_contains(merged, b, dims)) {
+                remove_dirty_box(r, i);
+            } else if (box_contains(b, merged, dims) || merge_adjacent_boxes(b, merged, dims)) {
+                memcpy(merged, b, dims * sizeof(halide_dimension_t));
+                remove_dirty_box(r, i);
+            } else {
+                continue;
+            }
+            changed = true;
+            break;
+        }
+    }
+
+    if (r->num_boxes == max_dirty_boxes) {
+        // Out of room, so fall back to the bounding box of them all.
+        for (int b = 0; b < r->num_boxes; b++) {
+            for (int i = 0; i < dims; i++) {
+                const halide_dimension_t &d = r->boxes[b][i];
+                const int32_t min = d.min < merged[i].min ? d.min : merged[i].min;
+                const int32_t max = (d.min + d.extent) > (merged[i].min + merged[i].extent) ? (d.min + d.extent) : (merged[i].min + merged[i].extent);
+                merged[i].min = min;
+                merged[i].extent = max - min;
+            }
+        }
+        r->num_boxes = 0;
+    }
+    memcpy(r->boxes[r->num_boxes++], merged, dims * sizeof(halide_dimension_t));
+}
+
+// Copy just the recorded dirty regions of a buffer, by copying a crop
+// of it for each one. Returns false if the regions aren't known or the
+// device interface can't crop, in which case nothing was copied and
+// the whole buffer should be copied instead; otherwise sets *result.
+WEAK bool copy_dirty_regions(void *user_context, halide_buffer_t *buf,
+                             const halide_device_interface_t *interface,
+                             bool to_host, int *result) {
+    if (!buf->get_flag(halide_buffer_flag_dirty_region)) {
+        return false;
+    }
+    DirtyRegions *r = find_dirty_regions(buf);
+    if (!r) {
+        return false;
+    }
+
+    for (int b = 0; b < r->num_boxes; b++) {
+        halide_dimension_t dims[max_dirty_region_dims];
+        halide_buffer_t crop = *buf;
+        crop.dim = dims;
+        crop.device = 0;
+        crop.device_interface = nullptr;
+        int64_t offset = 0;
+        for (int i = 0; i < buf->dimensions; i++) {
+            dims[i] = buf->dim[i];
+            dims[i].min = r->boxes[b][i].min;
+            dims[i].extent = r->boxes[b][i].extent;
+            offset += (int64_t)(dims[i].min - buf->dim[i].min) * buf->dim[i].stride;
+        }
+        crop.host = buf->host + offset * buf->type.bytes();
+
+        interface->impl->use_module();
+        int err = interface->impl->device_crop(user_context, buf, &crop);
+        if (err != 0) {
+            interface->impl->release_module();
+            if (b == 0) {
+                return false;
+            }
+            *result = err;
+            return true;
+        }
+        err = to_host ? interface->impl->copy_to_host(user_context, &crop) : interface->impl->copy_to_device(user_context, &crop);
+        interface->impl->device_release_crop(user_context, &crop);
+        interface->impl->release_module();
+        if (err != 0) {
+            *result = err;
+            return true;
+        }
+    }
+    *result = 0;
+    return true;
+}
+
+// The shared implementation of halide_buffer_set_host_dirty_region and
+// halide_buffer_set_device_dirty_region.
+WEAK int set_dirty_region(void *user_context, halide_buffer_t *buf,
+                          halide_buffer_flags flag, const halide_dimension_t *region) {
+    const halide_buffer_flags other = (flag == halide_buffer_flag_host_dirty) ? halide_buffer_flag_device_dirty : halide_buffer_flag_host_dirty;
+    if (buf->get_flag(other)) {
+        return halide_error_host_and_device_dirty(user_context);
+    }
+
+    // Clamp the region to the buffer.
+    halide_dimension_t box[max_dirty_region_dims];
+    const int dims = buf->dimensions;
+    bool empty = false;
+    for (int i = 0; i < dims && i < max_dirty_region_dims; i++) {
+        const int32_t min = region[i].min > buf->dim[i].min ? region[i].min : buf->dim[i].min;
+        const int32_t buf_max = buf->dim[i].min + buf->dim[i].extent;
+        const int32_t region_max = region[i].min + region[i].extent;
+        const int32_t max = region_max < buf_max ? region_max : buf_max;
+        box[i].min = min;
+        box[i].extent = max - min;
+        box[i].stride = 0;
+        box[i].flags = 0;
+        empty = empty || max <= min;
+    }
+
+    ScopedMutexLock lock(&device_copy_mutex);
+
+    if (dims > max_dirty_region_dims) {
+        // Too many dimensions to track, so the whole buffer is dirty.
+        buf->set_flag(flag, true);
+        buf->set_flag(halide_buffer_flag_dirty_region, false);
+        return 0;
+    }
+    if (empty && !buf->get_flag(flag)) {
+        return 0;
+    }
+
+    // If the buffer was dirty without any recorded regions, the new
+    // region replaces the whole buffer.
+    DirtyRegions *r = buf->get_flag(flag) ? find_dirty_regions(buf) : nullptr;
+    if (!r) {
+        r = new_dirty_regions(buf);
+    }
+    if (!empty) {
+        add_dirty_box(r, box, dims);
+    }
+    buf->set_flag(flag, true);
+    buf->set_flag(halide_buffer_flag_dirty_region, true);
+    return 0;
+}
+
 WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t *buf) {
     if (!buf->device_dirty()) {
         return 0;  // my, that was easy
@@ -42,7 +290,11 @@ WEAK int copy_to_host_already_locked(void *user_context, struct halide_buffer_t
         debug(user_context) << "copy_to_host_already_locked " << buf << " interface is nullptr\n";
         return halide_error_code_no_device_interface;
     }
-    int result = interface->impl->copy_to_host(user_context, buf);
+    int result = 0;
+    if (!copy_dirty_regions(user_context, buf, interface, true, &result)) {
+        result = interface->impl->copy_to_host(user_context, buf);
+    }
+    forget_dirty_regions(buf);
     if (result != 0) {
         debug(user_context) << "copy_to_host_already_locked " << buf << " device copy_to_host returned an error\n";
         return halide_error_code_copy_to_host_failed;
@@ -162,7 +414,10 @@ WEAK int copy_to_device_already_locked(void *user_context,
             return halide_error_code_copy_to_device_failed;
         } else {
             debug(user_context) << "halide_copy_to_device " << buf << " calling copy_to_device()\n";
-            result = device_interface->impl->copy_to_device(user_context, buf);
+            if (!copy_dirty_regions(user_context, buf, device_interface, false, &result)) {
+                result = device_interface->impl->copy_to_device(user_context, buf);
+            }
+            forget_dirty_regions(buf);
             if (result == 0) {
                 buf->set_host_dirty(false);
             } else {
@@ -246,6 +501,10 @@ WEAK int halide_device_free(void *user_context, struct halide_buffer_t *buf) {
     if (device_interface != nullptr) {
         // Ensure interface is not freed prematurely.
         // TODO: Exception safety...
+        {
+            ScopedMutexLock lock(&device_copy_mutex);
+            forget_dirty_regions(buf);
+        }
         device_interface->impl->use_module();
         result = device_interface->impl->device_free(user_context, buf);
         device_interface->impl->release_module();
@@ -725,4 +984,22 @@ WEAK int halide_device_release_crop(void *user_context,
     return 0;
 }
 
+WEAK int halide_buffer_set_host_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                             const struct halide_dimension_t *region) {
+    int result = debug_log_and_validate_buf(user_context, buf, "halide_buffer_set_host_dirty_region");
+    if (result != 0) {
+        return result;
+    }
+    return set_dirty_region(user_context, buf, halide_buffer_flag_host_dirty, region);
+}
+
+WEAK int halide_buffer_set_device_dirty_region(void *user_context, struct halide_buffer_t *buf,
+                                               const struct halide_dimension_t *region) {
+    int result = debug_log_and_validate_buf(user_context, buf, "halide_buffer_set_device_dirty_region");
+    if (result != 0) {
+        return result;
+    }
+    return set_dirty_region(user_context, buf, halide_buffer_flag_device_dirty, region);
+}
+
 }  // extern "C" linkage
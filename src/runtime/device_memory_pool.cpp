@@ -0,0 +1,413 @@
+#include "HalideRuntime.h"
+#include "device_memory_pool.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+#include "internal/block_allocator.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// The blocks (of one size class) handed out whole by a pool, used for
+// requests too large to sub-allocate.
+struct DedicatedBin {
+    size_t size;
+    BlockAllocator *allocator;
+    DedicatedBin *next;
+};
+
+// Memory currently reserved from a pool.
+struct Reservation {
+    uint64_t block;
+    uint64_t offset;
+    size_t size;
+    BlockAllocator *allocator;
+    MemoryRegion *region;
+    Reservation *next;
+};
+
+// The blocks of a pool for one device context and queue.
+struct DeviceMemoryPartition {
+    void *device_context;
+    void *queue;
+    BlockAllocator *shared;
+    DedicatedBin *bins;
+    Reservation *reservations;
+    DeviceMemoryPartition *next;
+};
+
+// Guards the state of every pool. The BlockAllocator callbacks below
+// only get a user_context, so the pool and partition they are working
+// on are passed to them through the globals after it.
+WEAK halide_mutex device_memory_pool_lock;
+WEAK DeviceMemoryPool *current_pool = nullptr;
+WEAK DeviceMemoryPartition *current_partition = nullptr;
+// Whether blocks being destroyed belong to a device context that is
+// already gone, in which case they mustn't be freed.
+WEAK bool forgetting_blocks = false;
+
+namespace {
+
+ALWAYS_INLINE void update_peak(uint64_t value, uint64_t *peak) {
+    if (value > *peak) {
+        *peak = value;
+    }
+}
+
+// Round a request up to its size class: a multiple of the pool's
+// alignment, with only its top 4 significant bits set. This wastes 4%
+// of the memory on average, but makes it much likelier that memory
+// released by one buffer can be reused by the next.
+ALWAYS_INLINE size_t size_class(const DeviceMemoryPool *pool, size_t size) {
+    uint64_t sz = aligned_offset(size, pool->alignment);
+    int z = __builtin_clzll(sz);
+    if (z < 60) {
+        sz--;
+        sz = sz >> (60 - z);
+        sz++;
+        sz = sz << (60 - z);
+    }
+    return (size_t)sz;
+}
+
+void allocate_pool_block(void *user_context, MemoryBlock *block) {
+    DeviceMemoryPool *pool = current_pool;
+    uint64_t handle = pool->allocate_block(user_context, current_partition->device_context, block->size);
+    block->handle = (void *)(uintptr_t)handle;
+    if (handle) {
+        pool->stats.bytes_allocated += block->size;
+        pool->stats.num_device_api_allocations++;
+        update_peak(pool->stats.bytes_allocated, &pool->stats.peak_bytes_allocated);
+    }
+}
+
+void free_pool_block(void *user_context, MemoryBlock *block) {
+    if (block->handle == nullptr) {
+        return;
+    }
+    DeviceMemoryPool *pool = current_pool;
+    if (!forgetting_blocks) {
+        pool->free_block(user_context, current_partition->device_context, (uint64_t)(uintptr_t)block->handle);
+    }
+    pool->stats.bytes_allocated -= block->size;
+    block->handle = nullptr;
+}
+
+// Regions are just offsets into their block, so need no allocation of
+// their own.
+void allocate_pool_region(void *user_context, MemoryRegion *region) {
+}
+
+void free_pool_region(void *user_context, MemoryRegion *region) {
+}
+
+BlockAllocator *create_allocator(void *user_context, size_t block_size) {
+    BlockAllocator::Config config;
+    config.minimum_block_size = block_size;
+    config.maximum_block_size = block_size;
+    BlockAllocator::MemoryAllocators allocators;
+    allocators.system = {native_system_malloc, native_system_free};
+    allocators.block = {allocate_pool_block, free_pool_block};
+    allocators.region = {allocate_pool_region, free_pool_region};
+    return BlockAllocator::create(user_context, config, allocators);
+}
+
+DeviceMemoryPartition *find_partition(DeviceMemoryPool *pool, void *device_context, void *queue) {
+    for (DeviceMemoryPartition *p = pool->partitions; p != nullptr; p = p->next) {
+        if (p->device_context == device_context && p->queue == queue) {
+            return p;
+        }
+    }
+    DeviceMemoryPartition *p = (DeviceMemoryPartition *)malloc(sizeof(DeviceMemoryPartition));
+    if (p == nullptr) {
+        return nullptr;
+    }
+    memset(p, 0, sizeof(DeviceMemoryPartition));
+    p->device_context = device_context;
+    p->queue = queue;
+    p->next = pool->partitions;
+    pool->partitions = p;
+    return p;
+}
+
+// Find the allocator for the given size class, creating it if need be.
+BlockAllocator *find_allocator(void *user_context, DeviceMemoryPool *pool,
+                               DeviceMemoryPartition *partition, size_t size, bool *dedicated) {
+    *dedicated = !(pool->block_size && size <= pool->max_sub_allocation_size);
+    if (!*dedicated) {
+        if (partition->shared == nullptr) {
+            partition->shared = create_allocator(user_context, pool->block_size);
+        }
+        return partition->shared;
+    }
+    for (DedicatedBin *bin = partition->bins; bin != nullptr; bin = bin->next) {
+        if (bin->size == size) {
+            return bin->allocator;
+        }
+    }
+    DedicatedBin *bin = (DedicatedBin *)malloc(sizeof(DedicatedBin));
+    if (bin == nullptr) {
+        return nullptr;
+    }
+    bin->size = size;
+    bin->allocator = create_allocator(user_context, 0);
+    if (bin->allocator == nullptr) {
+        free(bin);
+        return nullptr;
+    }
+    bin->next = partition->bins;
+    partition->bins = bin;
+    return bin->allocator;
+}
+
+// Reserve memory from an allocator, returning null on failure,
+// including if the device API failed to allocate a block for it.
+MemoryRegion *reserve_region(void *user_context, DeviceMemoryPool *pool,
+                             BlockAllocator *allocator, size_t size, bool dedicated) {
+    MemoryRequest request;
+    request.size = size;
+    request.alignment = pool->alignment;
+    request.dedicated = dedicated;
+    request.properties.visibility = MemoryVisibility::DefaultVisibility;
+    request.properties.caching = MemoryCaching::DefaultCaching;
+    request.properties.usage = MemoryUsage::DefaultUsage;
+    MemoryRegion *region = allocator->reserve(user_context, request);
+    if (region != nullptr && ((BlockRegion *)region)->block_ptr->memory.handle == nullptr) {
+        allocator->reclaim(user_context, region);
+        allocator->collect(user_context);
+        region = nullptr;
+    }
+    return region;
+}
+
+void destroy_allocator(void *user_context, BlockAllocator *allocator) {
+    BlockAllocator::destroy(user_context, allocator);
+}
+
+// Free the unused blocks of a partition, returning true if it has none
+// left at all.
+bool trim_partition(void *user_context, DeviceMemoryPartition *partition) {
+    current_partition = partition;
+    if (partition->shared) {
+        partition->shared->collect(user_context);
+        if (partition->shared->block_count() == 0) {
+            destroy_allocator(user_context, partition->shared);
+            partition->shared = nullptr;
+        }
+    }
+    DedicatedBin **prev = &partition->bins;
+    while (*prev) {
+        DedicatedBin *bin = *prev;
+        bin->allocator->collect(user_context);
+        if (bin->allocator->block_count() == 0) {
+            destroy_allocator(user_context, bin->allocator);
+            *prev = bin->next;
+            free(bin);
+        } else {
+            prev = &bin->next;
+        }
+    }
+    return partition->shared == nullptr && partition->bins == nullptr;
+}
+
+// Free the unused blocks of the pool for the given device context, or
+// for all of them if it is null.
+void trim_already_locked(void *user_context, DeviceMemoryPool *pool, void *device_context) {
+    current_pool = pool;
+    DeviceMemoryPartition **prev = &pool->partitions;
+    while (*prev) {
+        DeviceMemoryPartition *p = *prev;
+        if ((device_context == nullptr || p->device_context == device_context) &&
+            trim_partition(user_context, p)) {
+            *prev = p->next;
+            free(p);
+        } else {
+            prev = &p->next;
+        }
+    }
+}
+
+bool matches(const DeviceMemoryPool *pool, const Reservation *r, uint64_t block, uint64_t offset) {
+    if (pool->offsets_are_addresses) {
+        return r->block + r->offset == block + offset;
+    } else {
+        return r->block == block && r->offset == offset;
+    }
+}
+
+// Find the given reservation, and the partition it belongs to.
+Reservation **find_reservation(DeviceMemoryPool *pool, void *device_context,
+                               uint64_t block, uint64_t offset, DeviceMemoryPartition **partition) {
+    for (DeviceMemoryPartition *p = pool->partitions; p != nullptr; p = p->next) {
+        if (p->device_context != device_context) {
+            continue;
+        }
+        for (Reservation **prev = &p->reservations; *prev; prev = &(*prev)->next) {
+            if (matches(pool, *prev, block, offset)) {
+                *partition = p;
+                return prev;
+            }
+        }
+    }
+    return nullptr;
+}
+
+int get_pool_stats(void *user_context, halide_device_memory_pool *registration,
+                   halide_device_memory_pool_stats_t *stats) {
+    DeviceMemoryPool *pool = (DeviceMemoryPool *)registration;
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    *stats = pool->stats;
+    return halide_error_code_success;
+}
+
+int trim_pool(void *user_context, halide_device_memory_pool *registration) {
+    return device_memory_pool_trim(user_context, (DeviceMemoryPool *)registration, nullptr);
+}
+
+}  // namespace
+
+WEAK void device_memory_pool_register(DeviceMemoryPool *pool, const halide_device_interface_t *device_interface) {
+    pool->registration.device_interface = device_interface;
+    pool->registration.get_stats = get_pool_stats;
+    pool->registration.trim = trim_pool;
+    halide_register_device_memory_pool(&pool->registration);
+}
+
+WEAK int device_memory_pool_reserve(void *user_context, DeviceMemoryPool *pool,
+                                    void *device_context, void *queue, size_t size,
+                                    uint64_t *block, uint64_t *offset) {
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    current_pool = pool;
+
+    const size_t actual_size = size_class(pool, size);
+    DeviceMemoryPartition *partition = find_partition(pool, device_context, queue);
+    Reservation *r = (Reservation *)malloc(sizeof(Reservation));
+    if (partition == nullptr || r == nullptr) {
+        free(r);
+        return halide_error_code_out_of_memory;
+    }
+    current_partition = partition;
+
+    bool dedicated = false;
+    BlockAllocator *allocator = find_allocator(user_context, pool, partition, actual_size, &dedicated);
+    MemoryRegion *region = nullptr;
+    if (allocator != nullptr) {
+        region = reserve_region(user_context, pool, allocator, actual_size, dedicated);
+        if (region == nullptr) {
+            // The device may be out of memory, so give back every block
+            // we aren't using, and try once more.
+            trim_already_locked(user_context, pool, nullptr);
+            current_pool = pool;
+            partition = find_partition(pool, device_context, queue);
+            current_partition = partition;
+            allocator = partition ? find_allocator(user_context, pool, partition, actual_size, &dedicated) : nullptr;
+            if (allocator != nullptr) {
+                region = reserve_region(user_context, pool, allocator, actual_size, dedicated);
+            }
+        }
+    }
+    if (region == nullptr) {
+        free(r);
+        return halide_error_code_device_malloc_failed;
+    }
+
+    r->block = (uint64_t)(uintptr_t)((BlockRegion *)region)->block_ptr->memory.handle;
+    r->offset = region->offset;
+    r->size = region->size;
+    r->allocator = allocator;
+    r->region = region;
+    r->next = partition->reservations;
+    partition->reservations = r;
+
+    pool->stats.bytes_in_use += r->size;
+    pool->stats.num_allocations++;
+    update_peak(pool->stats.bytes_in_use, &pool->stats.peak_bytes_in_use);
+
+    *block = r->block;
+    *offset = r->offset;
+    return halide_error_code_success;
+}
+
+WEAK bool device_memory_pool_find(void *user_context, DeviceMemoryPool *pool,
+                                  void *device_context, uint64_t block, uint64_t offset, void **queue) {
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    DeviceMemoryPartition *partition = nullptr;
+    if (find_reservation(pool, device_context, block, offset, &partition) == nullptr) {
+        return false;
+    }
+    *queue = partition->queue;
+    return true;
+}
+
+WEAK bool device_memory_pool_reclaim(void *user_context, DeviceMemoryPool *pool,
+                                     void *device_context, uint64_t block, uint64_t offset) {
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    DeviceMemoryPartition *partition = nullptr;
+    Reservation **prev = find_reservation(pool, device_context, block, offset, &partition);
+    if (prev == nullptr) {
+        return false;
+    }
+    Reservation *r = *prev;
+    *prev = r->next;
+
+    current_pool = pool;
+    current_partition = partition;
+    r->allocator->reclaim(user_context, r->region);
+    pool->stats.bytes_in_use -= r->size;
+    free(r);
+
+    // If reuse has been turned off since this was reserved, or the pool
+    // is holding more unused memory than it is allowed, don't sit on
+    // the memory.
+    const int64_t limit = halide_device_memory_pool_get_limit(user_context);
+    if (!halide_can_reuse_device_allocations(user_context) ||
+        (limit >= 0 && pool->stats.bytes_allocated - pool->stats.bytes_in_use > (uint64_t)limit)) {
+        trim_already_locked(user_context, pool, device_context);
+    }
+    return true;
+}
+
+WEAK int device_memory_pool_trim(void *user_context, DeviceMemoryPool *pool, void *device_context) {
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    trim_already_locked(user_context, pool, device_context);
+    return halide_error_code_success;
+}
+
+WEAK void device_memory_pool_forget(void *user_context, DeviceMemoryPool *pool, void *device_context) {
+    ScopedMutexLock lock(&device_memory_pool_lock);
+    current_pool = pool;
+    forgetting_blocks = true;
+    DeviceMemoryPartition **prev = &pool->partitions;
+    while (*prev) {
+        DeviceMemoryPartition *p = *prev;
+        if (p->device_context != device_context) {
+            prev = &p->next;
+            continue;
+        }
+        current_partition = p;
+        while (p->reservations) {
+            Reservation *r = p->reservations;
+            p->reservations = r->next;
+            pool->stats.bytes_in_use -= r->size;
+            free(r);
+        }
+        if (p->shared) {
+            destroy_allocator(user_context, p->shared);
+        }
+        while (p->bins) {
+            DedicatedBin *bin = p->bins;
+            p->bins = bin->next;
+            destroy_allocator(user_context, bin->allocator);
+            free(bin);
+        }
+        *prev = p->next;
+        free(p);
+    }
+    forgetting_blocks = false;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
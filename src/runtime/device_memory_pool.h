@@ -0,0 +1,91 @@
+#ifndef HALIDE_RUNTIME_DEVICE_MEMORY_POOL_H
+#define HALIDE_RUNTIME_DEVICE_MEMORY_POOL_H
+
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct DeviceMemoryPartition;
+
+// A pool of device memory for a GPU backend to allocate buffers from,
+// implemented in device_memory_pool.cpp on top of the BlockAllocator in
+// internal/block_allocator.h. Each backend defines one, with the fields
+// up to 'alignment' filled in, and calls device_memory_pool_register on
+// it at startup. A backend that destroys a device context must call
+// device_memory_pool_forget on it, so that a new context that happens to
+// get the same handle doesn't inherit its blocks.
+//
+// Requests are rounded up to a size class, so that the memory released
+// by one buffer can be reused by the next buffer of a similar size.
+// Requests of up to max_sub_allocation_size bytes are sub-allocated from
+// shared blocks of block_size bytes; larger ones get a block of their
+// own, which is kept for reuse by later requests of the same size class.
+// Each device context and queue (e.g. CUDA stream) has its own blocks,
+// since memory released after use on one queue can only be reused on
+// that queue without further synchronization. Unused blocks are returned
+// to the device API by device_memory_pool_trim, which is also called by
+// halide_reuse_device_allocations(false) and
+// halide_device_memory_pool_trim.
+struct DeviceMemoryPool {
+    // This must be the first member.
+    halide_device_memory_pool registration;
+
+    // Allocate a block of device memory of the given size, returning a
+    // handle to it (e.g. a CUdeviceptr or cl_mem), or 0 on failure.
+    uint64_t (*allocate_block)(void *user_context, void *device_context, size_t size);
+    void (*free_block)(void *user_context, void *device_context, uint64_t block);
+
+    // Zero disables sub-allocation, for device APIs in which offsets into
+    // a block are costly to use.
+    size_t block_size;
+    size_t max_sub_allocation_size;
+    // The alignment of sub-allocations within a block; a power of two.
+    size_t alignment;
+    // Whether block handles are device addresses (as for CUDA), so that
+    // memory reserved from the pool can be identified by block + offset
+    // alone, rather than by the pair.
+    bool offsets_are_addresses;
+
+    // Everything below is managed by device_memory_pool.cpp, and guarded
+    // by a lock shared by all pools.
+    DeviceMemoryPartition *partitions;
+    halide_device_memory_pool_stats_t stats;
+};
+
+// Register a pool, so that the halide_device_memory_pool_* functions can
+// find it by device interface.
+WEAK void device_memory_pool_register(DeviceMemoryPool *pool, const halide_device_interface_t *device_interface);
+
+// Reserve at least 'size' bytes of memory, which starts 'offset' bytes
+// into the device allocation '*block', for use on the given queue.
+WEAK int device_memory_pool_reserve(void *user_context, DeviceMemoryPool *pool,
+                                    void *device_context, void *queue, size_t size,
+                                    uint64_t *block, uint64_t *offset);
+
+// Find the queue the given memory was reserved for, returning false if
+// it wasn't reserved from the pool.
+WEAK bool device_memory_pool_find(void *user_context, DeviceMemoryPool *pool,
+                                  void *device_context, uint64_t block, uint64_t offset, void **queue);
+
+// Return memory reserved from the pool, returning false if it wasn't
+// reserved from the pool. The memory can be reused by work enqueued
+// after any already enqueued on its queue.
+WEAK bool device_memory_pool_reclaim(void *user_context, DeviceMemoryPool *pool,
+                                     void *device_context, uint64_t block, uint64_t offset);
+
+// Free the blocks with nothing reserved from them, for the given device
+// context, or for all of them if it is null.
+WEAK int device_memory_pool_trim(void *user_context, DeviceMemoryPool *pool, void *device_context);
+
+// Forget all the blocks for a device context that has been destroyed
+// (and so the memory with it), including any memory still reserved from
+// them, without freeing them.
+WEAK void device_memory_pool_forget(void *user_context, DeviceMemoryPool *pool, void *device_context);
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+#endif  // HALIDE_RUNTIME_DEVICE_MEMORY_POOL_H
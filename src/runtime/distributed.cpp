@@ -0,0 +1,59 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+WEAK int default_distributed_rank(void *user_context) {
+    return 0;
+}
+
+WEAK int default_distributed_num_ranks(void *user_context) {
+    return 1;
+}
+
+WEAK int default_distributed_exchange(void *user_context, halide_buffer_t *buf, int dim,
+                                      int owned_min, int owned_extent,
+                                      int needed_min, int needed_extent) {
+    // A single rank owns every row there is, so it has any it needs.
+    return halide_error_code_success;
+}
+
+WEAK halide_distributed_rank_t custom_distributed_rank = default_distributed_rank;
+WEAK halide_distributed_num_ranks_t custom_distributed_num_ranks = default_distributed_num_ranks;
+WEAK halide_distributed_exchange_t custom_distributed_exchange = default_distributed_exchange;
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void halide_set_custom_distributed_runtime(halide_distributed_rank_t rank,
+                                                halide_distributed_num_ranks_t num_ranks,
+                                                halide_distributed_exchange_t exchange) {
+    custom_distributed_rank = rank;
+    custom_distributed_num_ranks = num_ranks;
+    custom_distributed_exchange = exchange;
+}
+
+WEAK int halide_distributed_rank(void *user_context) {
+    return custom_distributed_rank(user_context);
+}
+
+WEAK int halide_distributed_num_ranks(void *user_context) {
+    return custom_distributed_num_ranks(user_context);
+}
+
+WEAK int halide_distributed_exchange(void *user_context, halide_buffer_t *buf, int dim,
+                                     int owned_min, int owned_extent,
+                                     int needed_min, int needed_extent) {
+    return custom_distributed_exchange(user_context, buf, dim,
+                                       owned_min, owned_extent,
+                                       needed_min, needed_extent);
+}
+
+}  // extern "C"
@@ -291,4 +291,14 @@ WEAK int halide_error_device_crop_failed(void *user_context) {
     return halide_error_code_device_crop_failed;
 }
 
+WEAK int halide_error_buffers_overlap(void *user_context, const char *buffer_name,
+                                      const char *other_buffer_name) {
+    error(user_context)
+        << "The host memory of " << buffer_name
+        << " overlaps that of " << other_buffer_name
+        << ", but the pipeline was compiled with check_no_alias, which"
+        << " asserts that its outputs alias none of its other buffers.";
+    return halide_error_code_buffers_overlap;
+}
+
 }  // extern "C"
@@ -0,0 +1,41 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+
+// NUMA-aware mode and huge page allocations are only supported on
+// Linux. Elsewhere NUMA-aware mode can be requested but does nothing,
+// and large allocations come from malloc.
+
+extern "C" {
+
+WEAK bool halide_numa_aware() {
+    return false;
+}
+
+WEAK bool halide_set_numa_aware(bool enable) {
+    return false;
+}
+
+WEAK int halide_host_numa_cpus(int *cpu_nodes, int max_cpus) {
+    return 0;
+}
+
+WEAK int halide_pin_current_thread_to_cpu(int cpu) {
+    return -1;
+}
+
+WEAK int halide_set_current_thread_priority(int priority) {
+    return -1;
+}
+
+WEAK void *halide_numa_local_alloc(void *user_context, size_t size) {
+    return nullptr;
+}
+
+WEAK void *halide_large_alloc(void *user_context, size_t size, size_t *mapped_size) {
+    return nullptr;
+}
+
+WEAK void halide_large_free(void *user_context, void *ptr, size_t size) {
+}
+
+}  // extern "C"
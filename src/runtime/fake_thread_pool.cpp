@@ -121,6 +121,88 @@ WEAK int halide_set_num_threads(int n) {
     return 1;
 }
 
+WEAK bool halide_set_thread_pool_work_stealing(bool enable) {
+    return false;
+}
+
+WEAK bool halide_set_thread_pool_guided_scheduling(bool enable) {
+    return false;
+}
+
+WEAK int halide_set_thread_pool_hot_period(int microseconds) {
+    return 0;
+}
+
+WEAK bool halide_set_thread_pool_timing(bool enable) {
+    return false;
+}
+
+WEAK void halide_thread_pool_get_stats(void *user_context, struct halide_thread_pool_stats_t *stats) {
+    *stats = halide_thread_pool_stats_t();
+    stats->num_threads = 1;
+}
+
+// There is only the one thread, so no other pools can be created.
+WEAK struct halide_thread_pool_t *halide_create_thread_pool(const char *name, int num_threads, int priority) {
+    return nullptr;
+}
+
+WEAK void halide_destroy_thread_pool(struct halide_thread_pool_t *pool) {
+}
+
+WEAK struct halide_thread_pool_t *halide_find_thread_pool(const char *name) {
+    return nullptr;
+}
+
+WEAK int halide_set_thread_pool_num_threads(struct halide_thread_pool_t *pool, int n) {
+    return halide_set_num_threads(n);
+}
+
+WEAK struct halide_thread_pool_t *halide_default_get_thread_pool(void *user_context) {
+    return nullptr;
+}
+
+WEAK halide_get_thread_pool_t halide_set_custom_get_thread_pool(halide_get_thread_pool_t f) {
+    return halide_default_get_thread_pool;
+}
+
+WEAK struct halide_thread_pool_t *halide_get_thread_pool(void *user_context) {
+    return nullptr;
+}
+
+// Without threads, asynchronous calls run to completion before
+// halide_call_async returns.
+struct halide_async_call_t {
+    int result;
+};
+
+WEAK struct halide_async_call_t *halide_call_async(void *user_context, halide_async_fn_t fn, void *arg,
+                                                   halide_async_callback_t done) {
+    halide_async_call_t *call = (halide_async_call_t *)halide_malloc(user_context, sizeof(halide_async_call_t));
+    if (!call) {
+        return nullptr;
+    }
+    call->result = fn(user_context, arg);
+    if (done) {
+        done(user_context, arg, call->result);
+    }
+    return call;
+}
+
+WEAK int halide_async_call_wait(struct halide_async_call_t *call) {
+    int result = call->result;
+    halide_free(nullptr, call);
+    return result;
+}
+
+WEAK bool halide_async_call_finished(struct halide_async_call_t *call) {
+    return true;
+}
+
+WEAK void halide_async_call_detach(struct halide_async_call_t *call) {
+    halide_free(nullptr, call);
+}
+
 WEAK halide_do_task_t halide_set_custom_do_task(halide_do_task_t f) {
     halide_do_task_t result = custom_do_task;
     custom_do_task = f;
@@ -36,4 +36,8 @@ WEAK int halide_get_gpu_device(void *user_context) {
     }
     return halide_gpu_device;
 }
+
+WEAK void *halide_gpu_device_user_context(void *user_context, int index) {
+    return user_context;
+}
 }
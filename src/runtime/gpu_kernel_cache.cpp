@@ -0,0 +1,46 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+WEAK ScopedSpinLock::AtomicFlag gpu_kernel_cache_dir_lock = 0;
+WEAK char gpu_kernel_cache_dir[1024];
+WEAK bool gpu_kernel_cache_dir_initialized = false;
+
+WEAK void set_gpu_kernel_cache_dir_internal(const char *dir) {
+    if (dir) {
+        size_t buffer_size = sizeof(gpu_kernel_cache_dir) / sizeof(gpu_kernel_cache_dir[0]);
+        strncpy(gpu_kernel_cache_dir, dir, buffer_size);
+        gpu_kernel_cache_dir[buffer_size - 1] = 0;
+    } else {
+        gpu_kernel_cache_dir[0] = 0;
+    }
+    gpu_kernel_cache_dir_initialized = true;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_set_gpu_kernel_cache_dir(void *user_context, const char *dir) {
+    ScopedSpinLock lock(&gpu_kernel_cache_dir_lock);
+    set_gpu_kernel_cache_dir_internal(dir);
+    return 0;
+}
+
+WEAK const char *halide_get_gpu_kernel_cache_dir(void *user_context) {
+    ScopedSpinLock lock(&gpu_kernel_cache_dir_lock);
+    if (!gpu_kernel_cache_dir_initialized) {
+        set_gpu_kernel_cache_dir_internal(getenv("HL_GPU_KERNEL_CACHE_DIR"));
+    }
+    return gpu_kernel_cache_dir[0] ? gpu_kernel_cache_dir : nullptr;
+}
+
+}  // extern "C"
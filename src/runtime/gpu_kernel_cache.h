@@ -0,0 +1,156 @@
+#ifndef HALIDE_RUNTIME_GPU_KERNEL_CACHE_H
+#define HALIDE_RUNTIME_GPU_KERNEL_CACHE_H
+
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Helpers for the GPU backends to keep compiled device binaries in the
+// directory set by halide_set_gpu_kernel_cache_dir, so that processes
+// other than the first to run a pipeline on a given device don't pay to
+// compile its kernels again. Cache entries are keyed by a hash of the
+// kernel source together with a string identifying the device, driver
+// and compile options, and carry enough of the key to reject collisions
+// and stale or truncated files. Any failure to read or write the cache
+// just makes the backend compile from source as it would without it.
+
+struct GPUKernelCacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint64_t source_hash;
+    uint64_t source_size;
+    uint64_t binary_size;
+};
+
+static constexpr uint32_t gpu_kernel_cache_magic = 0x4b4c4148;  // "HALK"
+static constexpr uint32_t gpu_kernel_cache_version = 1;
+
+// 64-bit FNV-1a
+WEAK uint64_t gpu_kernel_cache_hash(uint64_t h, const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < size; i++) {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+WEAK uint64_t gpu_kernel_cache_key(const char *device_id, const char *src, size_t src_size, uint64_t *source_hash) {
+    *source_hash = gpu_kernel_cache_hash(0xcbf29ce484222325ULL, src, src_size);
+    return gpu_kernel_cache_hash(*source_hash, device_id, strlen(device_id));
+}
+
+// Get the name of the cache file for the given key, returning false if
+// the cache is disabled.
+WEAK bool gpu_kernel_cache_file_name(void *user_context, const char *api, uint64_t key, char *dst, char *end) {
+    const char *dir = halide_get_gpu_kernel_cache_dir(user_context);
+    if (dir == nullptr || *dir == 0) {
+        return false;
+    }
+    dst = halide_string_to_string(dst, end, dir);
+    dst = halide_string_to_string(dst, end, "/halide_");
+    dst = halide_string_to_string(dst, end, api);
+    dst = halide_string_to_string(dst, end, "_");
+    dst = halide_uint64_to_string(dst, end, key, 1);
+    dst = halide_string_to_string(dst, end, ".bin");
+    // The name is useless if it was truncated.
+    return dst < end - 1;
+}
+
+// Look up the binary compiled from the given source for the given
+// device, returning it in a buffer allocated with malloc, or null if
+// there is none in the cache.
+WEAK void *gpu_kernel_cache_load(void *user_context, const char *api, const char *device_id,
+                                 const char *src, size_t src_size, size_t *binary_size) {
+    uint64_t source_hash;
+    uint64_t key = gpu_kernel_cache_key(device_id, src, src_size, &source_hash);
+    char file_name[1024];
+    if (!gpu_kernel_cache_file_name(user_context, api, key, file_name, file_name + sizeof(file_name))) {
+        return nullptr;
+    }
+
+    void *f = halide_fopen(file_name, "rb");
+    if (f == nullptr) {
+        debug(user_context) << "    gpu kernel cache miss: " << file_name << "\n";
+        return nullptr;
+    }
+
+    void *binary = nullptr;
+    GPUKernelCacheHeader header;
+    if (fread(&header, sizeof(header), 1, f) == 1 &&
+        header.magic == gpu_kernel_cache_magic &&
+        header.version == gpu_kernel_cache_version &&
+        header.key == key &&
+        header.source_hash == source_hash &&
+        header.source_size == src_size &&
+        header.binary_size > 0) {
+        binary = malloc(header.binary_size);
+        if (binary && fread(binary, header.binary_size, 1, f) != 1) {
+            free(binary);
+            binary = nullptr;
+        }
+    }
+    fclose(f);
+
+    if (binary) {
+        debug(user_context) << "    gpu kernel cache hit: " << file_name << "\n";
+        *binary_size = header.binary_size;
+    } else {
+        debug(user_context) << "    gpu kernel cache ignoring invalid file: " << file_name << "\n";
+    }
+    return binary;
+}
+
+// Store the binary compiled from the given source for the given device.
+// The file is written under a temporary name and then renamed into place,
+// so that processes sharing the cache never see a partial entry.
+WEAK void gpu_kernel_cache_save(void *user_context, const char *api, const char *device_id,
+                                const char *src, size_t src_size,
+                                const void *binary, size_t binary_size) {
+    GPUKernelCacheHeader header;
+    header.magic = gpu_kernel_cache_magic;
+    header.version = gpu_kernel_cache_version;
+    header.key = gpu_kernel_cache_key(device_id, src, src_size, &header.source_hash);
+    header.source_size = src_size;
+    header.binary_size = binary_size;
+
+    char file_name[1024];
+    char *end = file_name + sizeof(file_name);
+    if (!gpu_kernel_cache_file_name(user_context, api, header.key, file_name, end)) {
+        return;
+    }
+
+    // Make the temporary name unique across threads and processes.
+    char tmp_name[sizeof(file_name) + 64];
+    char *tmp_end = tmp_name + sizeof(tmp_name);
+    char *dst = halide_string_to_string(tmp_name, tmp_end, file_name);
+    dst = halide_string_to_string(dst, tmp_end, ".tmp");
+    dst = halide_uint64_to_string(dst, tmp_end, (uint64_t)(uintptr_t)&header, 1);
+    dst = halide_string_to_string(dst, tmp_end, "_");
+    halide_uint64_to_string(dst, tmp_end, (uint64_t)halide_current_time_ns(user_context), 1);
+
+    void *f = halide_fopen(tmp_name, "wb");
+    if (f == nullptr) {
+        debug(user_context) << "    gpu kernel cache could not create: " << tmp_name << "\n";
+        return;
+    }
+    bool ok = (fwrite(&header, sizeof(header), 1, f) == 1 &&
+               fwrite(binary, binary_size, 1, f) == 1);
+    ok = (fclose(f) == 0) && ok;
+    if (ok && rename(tmp_name, file_name) == 0) {
+        debug(user_context) << "    gpu kernel cache stored: " << file_name << "\n";
+    } else {
+        debug(user_context) << "    gpu kernel cache could not write: " << file_name << "\n";
+        remove(tmp_name);
+    }
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+#endif  // HALIDE_RUNTIME_GPU_KERNEL_CACHE_H
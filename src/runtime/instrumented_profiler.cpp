@@ -0,0 +1,3 @@
+#define TIMER_PROFILING 0
+#define INSTRUMENTED_PROFILING 1
+#include "profiler_common.cpp"
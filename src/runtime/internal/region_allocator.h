@@ -205,7 +205,7 @@ BlockRegion *RegionAllocator::find_block_region(void *user_context, const Memory
         }
 
         // will the adjusted size fit within the remaining unallocated space?
-        if ((actual_size + block->reserved) < block->memory.size) {
+        if ((actual_size + block->reserved) <= block->memory.size) {
             result = block_region;  // best-fit!
             break;
         }
@@ -377,7 +377,6 @@ void RegionAllocator::free_block_region(void *user_context, BlockRegion *block_r
         MemoryRegion *memory_region = &(block_region->memory);
         allocators.region.deallocate(user_context, memory_region);
         block->reserved -= block_region->memory.size;
-        block_region->memory.size = 0;
     }
     block_region->status = AllocationStatus::Available;
 }
@@ -0,0 +1,244 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+extern "C" {
+
+extern int sched_setaffinity(int pid, size_t cpusetsize, const void *mask);
+extern int setpriority(int which, unsigned int who, int prio);
+extern void *mmap(void *addr, size_t length, int prot, int flags, int fd, long offset);
+extern int munmap(void *addr, size_t length);
+extern int madvise(void *addr, size_t length, int advice);
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Zero means not yet decided, one means off, two means on.
+WEAK int numa_aware_mode = 0;
+
+constexpr int PROT_READ = 0x1;
+constexpr int PROT_WRITE = 0x2;
+constexpr int MAP_PRIVATE = 0x2;
+constexpr int PRIO_PROCESS = 0;
+constexpr int MADV_HUGEPAGE = 14;
+#ifdef __mips__
+constexpr int MAP_ANONYMOUS = 0x800;
+constexpr int MAP_HUGETLB = 0x80000;
+#else
+constexpr int MAP_ANONYMOUS = 0x20;
+constexpr int MAP_HUGETLB = 0x40000;
+#endif
+
+constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+// Large regions freed recently, kept mapped so that a pipeline that
+// is called repeatedly doesn't map and unmap its big intermediates on
+// every call. The oldest are unmapped first.
+struct LargeRegion {
+    void *ptr;
+    size_t size;
+};
+constexpr int max_cached_large_regions = 4;
+constexpr size_t max_cached_large_bytes = (size_t)1024 * 1024 * 1024;
+WEAK LargeRegion cached_large_regions[max_cached_large_regions];
+WEAK int num_cached_large_regions = 0;
+WEAK size_t cached_large_bytes = 0;
+WEAK halide_mutex large_region_lock = {{0}};
+
+// Enough for 1024 cpus, which matches glibc's cpu_set_t.
+constexpr int max_affinity_cpus = 1024;
+
+// The largest node number we go looking for in sysfs.
+constexpr int max_numa_nodes = 64;
+
+// Parse a sysfs cpu list such as "0-15,32-47", marking each of the
+// cpus it contains as belonging to the given node.
+WEAK void parse_cpu_list(const char *list, int node, int *cpu_nodes, int max_cpus) {
+    const char *p = list;
+    while (*p >= '0' && *p <= '9') {
+        int first = 0;
+        while (*p >= '0' && *p <= '9') {
+            first = first * 10 + (*p++ - '0');
+        }
+        int last = first;
+        if (*p == '-') {
+            p++;
+            last = 0;
+            while (*p >= '0' && *p <= '9') {
+                last = last * 10 + (*p++ - '0');
+            }
+        }
+        for (int cpu = first; cpu <= last && cpu < max_cpus; cpu++) {
+            cpu_nodes[cpu] = node;
+        }
+        if (*p == ',') {
+            p++;
+        }
+    }
+}
+
+// Map a region of a multiple of the huge page size, backed by huge
+// pages if possible.
+WEAK void *map_huge_pages(size_t size) {
+    // Explicit huge pages only exist if some have been reserved, but
+    // they are cheap to ask for.
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (ptr != (void *)-1) {
+        return ptr;
+    }
+
+    // Otherwise ask for transparent huge pages. These need the region
+    // to be aligned to a huge page boundary, so map more than needed
+    // and trim the ends.
+    const size_t padded = size + huge_page_size;
+    char *base = (char *)mmap(nullptr, padded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == (void *)-1) {
+        return nullptr;
+    }
+    char *aligned = (char *)(((uintptr_t)base + huge_page_size - 1) & ~(uintptr_t)(huge_page_size - 1));
+    if (aligned > base) {
+        munmap(base, aligned - base);
+    }
+    const size_t tail = (base + padded) - (aligned + size);
+    if (tail) {
+        munmap(aligned + size, tail);
+    }
+    // This fails harmlessly if transparent huge pages are disabled.
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK bool halide_numa_aware() {
+    if (!numa_aware_mode) {
+        const char *str = getenv("HL_NUMA_AWARE");
+        numa_aware_mode = (str && atoi(str) != 0) ? 2 : 1;
+    }
+    return numa_aware_mode == 2;
+}
+
+WEAK bool halide_set_numa_aware(bool enable) {
+    bool old = halide_numa_aware();
+    numa_aware_mode = enable ? 2 : 1;
+    return old;
+}
+
+WEAK int halide_host_numa_cpus(int *cpu_nodes, int max_cpus) {
+    for (int i = 0; i < max_cpus; i++) {
+        cpu_nodes[i] = -1;
+    }
+    int num_nodes = 0;
+    for (int node = 0; node < max_numa_nodes; node++) {
+        char path[64];
+        char *end = path + sizeof(path);
+        char *dst = halide_string_to_string(path, end, "/sys/devices/system/node/node");
+        dst = halide_int64_to_string(dst, end, node, 1);
+        halide_string_to_string(dst, end, "/cpulist");
+        void *f = halide_fopen(path, "r");
+        if (!f) {
+            // Node numbers may have holes (e.g. with memory-only
+            // nodes), so keep looking rather than stopping here.
+            continue;
+        }
+        char list[1024];
+        size_t bytes = fread(list, 1, sizeof(list) - 1, f);
+        fclose(f);
+        list[bytes] = 0;
+        parse_cpu_list(list, node, cpu_nodes, max_cpus);
+        num_nodes = node + 1;
+    }
+    return num_nodes;
+}
+
+WEAK int halide_pin_current_thread_to_cpu(int cpu) {
+    if (cpu < 0 || cpu >= max_affinity_cpus) {
+        return -1;
+    }
+    uint64_t mask[max_affinity_cpus / 64] = {0};
+    mask[cpu / 64] = (uint64_t)1 << (cpu % 64);
+    // A pid of zero means the calling thread.
+    return sched_setaffinity(0, sizeof(mask), mask);
+}
+
+WEAK int halide_set_current_thread_priority(int priority) {
+    // On Linux the nice value belongs to the thread, so a who of zero
+    // means the calling thread rather than the whole process.
+    return setpriority(PRIO_PROCESS, 0, priority);
+}
+
+WEAK void *halide_numa_local_alloc(void *user_context, size_t size) {
+    // Fresh anonymous pages aren't backed by physical memory until
+    // they are first written, at which point the kernel places them
+    // on the node of the writing thread.
+    void *ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == (void *)-1) {
+        return nullptr;
+    }
+    return ptr;
+}
+
+WEAK void *halide_large_alloc(void *user_context, size_t size, size_t *mapped_size) {
+    size = (size + huge_page_size - 1) & ~(huge_page_size - 1);
+    {
+        ScopedMutexLock lock(&large_region_lock);
+        // Reuse the smallest cached region that is big enough, as long
+        // as it isn't far bigger.
+        int best = -1;
+        for (int i = 0; i < num_cached_large_regions; i++) {
+            const LargeRegion &r = cached_large_regions[i];
+            if (r.size >= size && r.size / 2 <= size &&
+                (best < 0 || r.size < cached_large_regions[best].size)) {
+                best = i;
+            }
+        }
+        if (best >= 0) {
+            LargeRegion r = cached_large_regions[best];
+            for (int i = best; i < num_cached_large_regions - 1; i++) {
+                cached_large_regions[i] = cached_large_regions[i + 1];
+            }
+            num_cached_large_regions--;
+            cached_large_bytes -= r.size;
+            *mapped_size = r.size;
+            return r.ptr;
+        }
+    }
+
+    void *ptr = map_huge_pages(size);
+    if (!ptr) {
+        return nullptr;
+    }
+    *mapped_size = size;
+    return ptr;
+}
+
+WEAK void halide_large_free(void *user_context, void *ptr, size_t size) {
+    // In NUMA-aware mode, recycled pages would already be placed on
+    // whichever node touched them first, so they are never kept.
+    if (!halide_numa_aware() && size <= max_cached_large_bytes) {
+        ScopedMutexLock lock(&large_region_lock);
+        while (num_cached_large_regions == max_cached_large_regions ||
+               cached_large_bytes + size > max_cached_large_bytes) {
+            const LargeRegion &oldest = cached_large_regions[0];
+            munmap(oldest.ptr, oldest.size);
+            cached_large_bytes -= oldest.size;
+            for (int i = 0; i < num_cached_large_regions - 1; i++) {
+                cached_large_regions[i] = cached_large_regions[i + 1];
+            }
+            num_cached_large_regions--;
+        }
+        cached_large_regions[num_cached_large_regions++] = {ptr, size};
+        cached_large_bytes += size;
+        return;
+    }
+    munmap(ptr, size);
+}
+
+}  // extern "C"
@@ -1,6 +1,7 @@
 #include "HalideRuntimeMetal.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "gpu_context_common.h"
 #include "printer.h"
 #include "scoped_spin_lock.h"
@@ -296,6 +297,23 @@ WEAK Halide::Internal::GPUCompilationCache<mtl_device *, mtl_library *> compilat
 WEAK bool metal_api_supports_set_bytes;
 WEAK mtl_device *metal_api_checked_device;
 
+WEAK uint64_t allocate_pool_block(void *user_context, void *device_context, size_t size) {
+    return (uint64_t)new_buffer((mtl_device *)device_context, size);
+}
+
+WEAK void free_pool_block(void *user_context, void *device_context, uint64_t block) {
+    release_ns_object((mtl_buffer *)block);
+}
+
+// Recycles MTLBuffers while allocation caching is on. Requests of up to
+// 1MB are carved out of shared 16MB buffers, and bound at their offset
+// into them.
+WEAK DeviceMemoryPool memory_pool = {{}, allocate_pool_block, free_pool_block, 16 << 20, 1 << 20, 256, false};
+
+WEAK __attribute__((constructor)) void register_metal_allocation_pool() {
+    device_memory_pool_register(&memory_pool, &metal_device_interface);
+}
+
 namespace {
 int do_device_to_device_copy(void *user_context, mtl_blit_command_encoder *encoder,
                              const device_copy &c, uint64_t src_offset, uint64_t dst_offset, int d) {
@@ -440,6 +458,84 @@ WEAK command_buffer_completed_handler_block_literal command_buffer_completed_han
     0, command_buffer_completed_handler_invoke,
     &command_buffer_completed_handler_descriptor};
 
+// Kernel launches and device to device copies are encoded into one
+// command buffer, which is only committed when the host needs to see
+// the results of the work in it, rather than paying for a command
+// buffer per kernel. Consecutive kernels share one compute encoder. Both
+// are retained, as they outlive the autorelease pool of the call that
+// created them. So that the device isn't left idle behind a long
+// pipeline, the command buffer is also committed once it holds
+// max_pending_dispatches kernels.
+WEAK mtl_command_queue *pending_queue;
+WEAK mtl_command_buffer *pending_command_buffer;
+WEAK mtl_compute_command_encoder *pending_compute_encoder;
+WEAK int pending_dispatches = 0;
+WEAK int max_pending_dispatches = 64;
+
+WEAK void end_pending_compute_encoder() {
+    if (pending_compute_encoder != nullptr) {
+        end_encoding(pending_compute_encoder);
+        release_ns_object(pending_compute_encoder);
+        pending_compute_encoder = nullptr;
+    }
+}
+
+WEAK void commit_pending_commands(bool wait) {
+    if (pending_command_buffer == nullptr) {
+        return;
+    }
+    end_pending_compute_encoder();
+    add_command_buffer_completed_handler(pending_command_buffer, &command_buffer_completed_handler_block);
+    commit_command_buffer(pending_command_buffer);
+    if (wait) {
+        wait_until_completed(pending_command_buffer);
+    }
+    release_ns_object(pending_command_buffer);
+    pending_command_buffer = nullptr;
+    pending_queue = nullptr;
+    pending_dispatches = 0;
+}
+
+WEAK mtl_command_buffer *pending_commands(mtl_command_queue *queue) {
+    if (pending_command_buffer != nullptr && pending_queue != queue) {
+        // Work for some other queue (e.g. from an overridden
+        // halide_metal_acquire_context) goes out first.
+        commit_pending_commands(false);
+    }
+    if (pending_command_buffer == nullptr) {
+        const char *buffer_label = "halide_metal_pending_commands";
+        pending_command_buffer = new_command_buffer(queue, buffer_label, strlen(buffer_label));
+        if (pending_command_buffer == nullptr) {
+            return nullptr;
+        }
+        retain_ns_object(pending_command_buffer);
+        pending_queue = queue;
+    }
+    return pending_command_buffer;
+}
+
+WEAK mtl_compute_command_encoder *pending_compute_commands(mtl_command_queue *queue) {
+    mtl_command_buffer *command_buffer = pending_commands(queue);
+    if (command_buffer != nullptr && pending_compute_encoder == nullptr) {
+        pending_compute_encoder = new_compute_command_encoder(command_buffer);
+        if (pending_compute_encoder != nullptr) {
+            retain_ns_object(pending_compute_encoder);
+        }
+    }
+    return pending_compute_encoder;
+}
+
+// A blit encoder in the pending command buffer, after any kernels
+// encoded so far. The caller ends it.
+WEAK mtl_blit_command_encoder *pending_blit_commands(mtl_command_queue *queue) {
+    mtl_command_buffer *command_buffer = pending_commands(queue);
+    if (command_buffer == nullptr) {
+        return nullptr;
+    }
+    end_pending_compute_encoder();
+    return new_blit_command_encoder(command_buffer);
+}
+
 }  // namespace Metal
 }  // namespace Internal
 }  // namespace Runtime
@@ -489,15 +585,29 @@ WEAK int halide_metal_device_malloc(void *user_context, halide_buffer_t *buf) {
         return halide_error_code_out_of_memory;
     }
 
-    mtl_buffer *metal_buf = new_buffer(metal_context.device, size);
-    if (metal_buf == nullptr) {
-        free(handle);
-        error(user_context) << "Metal: Failed to allocate buffer of size " << (int64_t)size << ".\n";
-        return -1;
+    mtl_buffer *metal_buf = nullptr;
+    uint64_t offset = 0;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        uint64_t block = 0;
+        int result = device_memory_pool_reserve(user_context, &memory_pool, metal_context.device, metal_context.queue,
+                                                size, &block, &offset);
+        if (result != 0) {
+            free(handle);
+            error(user_context) << "Metal: Failed to allocate buffer of size " << (int64_t)size << " from the device memory pool.\n";
+            return result;
+        }
+        metal_buf = (mtl_buffer *)block;
+    } else {
+        metal_buf = new_buffer(metal_context.device, size);
+        if (metal_buf == nullptr) {
+            free(handle);
+            error(user_context) << "Metal: Failed to allocate buffer of size " << (int64_t)size << ".\n";
+            return -1;
+        }
     }
 
     handle->buf = metal_buf;
-    handle->offset = 0;
+    handle->offset = offset;
 
     buf->device = (uint64_t)handle;
     buf->device_interface = &metal_device_interface;
@@ -523,12 +633,19 @@ WEAK int halide_metal_device_free(void *user_context, halide_buffer_t *buf) {
 #endif
 
     device_handle *handle = (device_handle *)buf->device;
-    if (((device_handle *)buf->device)->offset != 0) {
-        error(user_context) << "halide_metal_device_free: halide_metal_device_free called on buffer obtained from halide_device_crop.\n";
-        return -1;
+    MetalContextHolder metal_context(user_context, false);
+    if (metal_context.error != 0) {
+        return metal_context.error;
+    }
+    // Memory from the pool may be at an offset into its buffer, but any
+    // other buffer with an offset must be a crop.
+    if (!device_memory_pool_reclaim(user_context, &memory_pool, metal_context.device, (uint64_t)handle->buf, handle->offset)) {
+        if (handle->offset != 0) {
+            error(user_context) << "halide_metal_device_free: halide_metal_device_free called on buffer obtained from halide_device_crop.\n";
+            return -1;
+        }
+        release_ns_object(handle->buf);
     }
-
-    release_ns_object(handle->buf);
     free(handle);
     buf->device = 0;
     buf->device_interface->impl->release_module();
@@ -579,18 +696,21 @@ WEAK void halide_metal_finalize_kernels(void *user_context, void *state_ptr) {
 namespace {
 
 WEAK void halide_metal_device_sync_internal(mtl_command_queue *queue, struct halide_buffer_t *buffer) {
-    const char *buffer_label = "halide_metal_device_sync_internal";
-    mtl_command_buffer *sync_command_buffer = new_command_buffer(queue, buffer_label, strlen(buffer_label));
+    // Commit everything encoded so far, and wait for it. If nothing is
+    // pending, this waits for an empty command buffer, which completes
+    // after all the work committed to the queue before it.
+    if (pending_commands(queue) == nullptr) {
+        return;
+    }
     if (buffer != nullptr) {
         mtl_buffer *metal_buffer = ((device_handle *)buffer->device)->buf;
         if (is_buffer_managed(metal_buffer)) {
-            mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(sync_command_buffer);
+            mtl_blit_command_encoder *blit_encoder = pending_blit_commands(queue);
             synchronize_resource(blit_encoder, metal_buffer);
             end_encoding(blit_encoder);
         }
     }
-    commit_command_buffer(sync_command_buffer);
-    wait_until_completed(sync_command_buffer);
+    commit_pending_commands(true);
 }
 
 }  // namespace
@@ -632,8 +752,14 @@ WEAK int halide_metal_device_release(void *user_context) {
         debug(user_context) << "Calling delete context on device " << acquired_device << "\n";
         compilation_cache.delete_context(user_context, acquired_device, release_ns_object);
 
+        device_memory_pool_trim(user_context, &memory_pool, acquired_device);
+
         // Release the device itself, if we created it.
         if (acquired_device == device) {
+            // Any buffers still allocated from the pool are released
+            // directly when freed.
+            device_memory_pool_forget(user_context, &memory_pool, device);
+
             debug(user_context) << "Metal - Releasing: new_command_queue " << queue << "\n";
             release_ns_object(queue);
             queue = nullptr;
@@ -672,13 +798,25 @@ WEAK int halide_metal_copy_to_device(void *user_context, halide_buffer_t *buffer
                         << " metal_buffer = " << metal_buffer
                         << " host = " << buffer->host << "\n";
 
-    copy_memory(c, user_context);
+    // Memory from the pool may have last been used by a buffer that was
+    // freed while work using it was still in flight.
+    void *pool_queue = nullptr;
+    if (device_memory_pool_find(user_context, &memory_pool, metal_context.device, (uint64_t)metal_buffer,
+                                ((device_handle *)buffer->device)->offset, &pool_queue)) {
+        halide_metal_device_sync_internal(metal_context.queue, nullptr);
+    }
+
+    // Buffers from halide_metal_device_and_host_malloc use the contents of
+    // the MTLBuffer as their host allocation, so there's nothing to copy.
+    if (buffer->host != (uint8_t *)c.dst) {
+        copy_memory(c, user_context);
+    }
 
     if (is_buffer_managed(metal_buffer)) {
         size_t total_size = buffer->size_in_bytes();
         halide_debug_assert(user_context, total_size != 0);
         NSRange total_extent;
-        total_extent.location = 0;
+        total_extent.location = ((device_handle *)buffer->device)->offset;
         total_extent.length = total_size;
         did_modify_range(metal_buffer, total_extent);
     }
@@ -718,7 +856,9 @@ WEAK int halide_metal_copy_to_host(void *user_context, halide_buffer_t *buffer)
     device_copy c = make_device_to_host_copy(buffer);
     c.src = (uint64_t)buffer_contents(((device_handle *)c.src)->buf) + ((device_handle *)c.src)->offset;
 
-    copy_memory(c, user_context);
+    if (buffer->host != (uint8_t *)c.src) {
+        copy_memory(c, user_context);
+    }
 
 #ifdef DEBUG_RUNTIME
     uint64_t t_after = halide_current_time_ns(user_context);
@@ -746,13 +886,12 @@ WEAK int halide_metal_run(void *user_context,
         return metal_context.error;
     }
 
-    mtl_command_buffer *command_buffer = new_command_buffer(metal_context.queue, entry_name, strlen(entry_name));
-    if (command_buffer == nullptr) {
+    if (pending_commands(metal_context.queue) == nullptr) {
         error(user_context) << "Metal: Could not allocate command buffer.\n";
         return -1;
     }
 
-    mtl_compute_command_encoder *encoder = new_compute_command_encoder(command_buffer);
+    mtl_compute_command_encoder *encoder = pending_compute_commands(metal_context.queue);
     if (encoder == nullptr) {
         error(user_context) << "Metal: Could not allocate compute command encoder.\n";
         return -1;
@@ -781,7 +920,6 @@ WEAK int halide_metal_run(void *user_context,
     int64_t max_total_threads_per_threadgroup = get_max_total_threads_per_threadgroup(pipeline_state);
     if (max_total_threads_per_threadgroup < threadsX * threadsY * threadsZ) {
         error(user_context) << "Metal: threadsX(" << threadsX << ") * threadsY(" << threadsY << ") * threadsZ(" << threadsZ << ") (" << (threadsX * threadsY * threadsZ) << ") must be <= " << max_total_threads_per_threadgroup << ". (device threadgroup size limit)\n";
-        end_encoding(encoder);
         release_ns_object(pipeline_state);
         return -1;
     }
@@ -875,11 +1013,12 @@ WEAK int halide_metal_run(void *user_context,
     dispatch_threadgroups(encoder,
                           blocksX, blocksY, blocksZ,
                           threadsX, threadsY, threadsZ);
-    end_encoding(encoder);
 
-    add_command_buffer_completed_handler(command_buffer, &command_buffer_completed_handler_block);
-
-    commit_command_buffer(command_buffer);
+    // The command buffer is committed by the next sync, or by any other
+    // call that needs the results of this kernel.
+    if (++pending_dispatches >= max_pending_dispatches) {
+        commit_pending_commands(false);
+    }
 
     // We deliberately don't release the function here; this was causing
     // crashes on Mojave (issues #3395 and #3408).
@@ -900,7 +1039,7 @@ WEAK int halide_metal_device_and_host_malloc(void *user_context, struct halide_b
     int result = halide_metal_device_malloc(user_context, buffer);
     if (result == 0) {
         mtl_buffer *metal_buffer = ((device_handle *)(buffer->device))->buf;
-        buffer->host = (uint8_t *)buffer_contents(metal_buffer);
+        buffer->host = (uint8_t *)buffer_contents(metal_buffer) + ((device_handle *)(buffer->device))->offset;
         debug(user_context) << "halide_metal_device_and_host_malloc"
                             << " device = " << (void *)buffer->device
                             << " metal_buffer = " << metal_buffer
@@ -970,13 +1109,14 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
         // Device only case
         if (!from_host && !to_host) {
             debug(user_context) << "halide_metal_buffer_copy device to device case.\n";
-            const char *buffer_label = "halide_metal_buffer_copy";
-            mtl_command_buffer *blit_command_buffer = new_command_buffer(metal_context.queue, buffer_label, strlen(buffer_label));
-            mtl_blit_command_encoder *blit_encoder = new_blit_command_encoder(blit_command_buffer);
+            mtl_blit_command_encoder *blit_encoder = pending_blit_commands(metal_context.queue);
+            if (blit_encoder == nullptr) {
+                error(user_context) << "Metal: Could not allocate blit command encoder.\n";
+                return -1;
+            }
             do_device_to_device_copy(user_context, blit_encoder, c, ((device_handle *)c.src)->offset,
                                      ((device_handle *)c.dst)->offset, dst->dimensions);
             end_encoding(blit_encoder);
-            commit_command_buffer(blit_command_buffer);
         } else {
             if (!from_host) {
                 // Need to make sure all reads and writes to/from source
@@ -1004,7 +1144,7 @@ WEAK int halide_metal_buffer_copy(void *user_context, struct halide_buffer_t *sr
                     size_t total_size = dst->size_in_bytes();
                     halide_debug_assert(user_context, total_size != 0);
                     NSRange total_extent;
-                    total_extent.location = 0;
+                    total_extent.location = ((device_handle *)dst->device)->offset;
                     total_extent.length = total_size;
                     did_modify_range(dst_buffer, total_extent);
                 }
@@ -1131,6 +1271,14 @@ WEAK uintptr_t halide_metal_get_buffer(void *user_context, struct halide_buffer_
         return 0;
     }
     halide_debug_assert(user_context, buf->device_interface == &metal_device_interface);
+    {
+        // Work the caller encodes on the queue with this buffer must
+        // come after the work Halide has encoded with it.
+        MetalContextHolder metal_context(user_context, false);
+        if (metal_context.error == 0) {
+            commit_pending_commands(false);
+        }
+    }
     return (uintptr_t)(((device_handle *)buf->device)->buf);
 }
 
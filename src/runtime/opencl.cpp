@@ -1,7 +1,9 @@
 #include "HalideRuntimeOpenCL.h"
 #include "device_buffer_utils.h"
 #include "device_interface.h"
+#include "device_memory_pool.h"
 #include "gpu_context_common.h"
+#include "gpu_kernel_cache.h"
 #include "printer.h"
 #include "scoped_spin_lock.h"
 
@@ -99,6 +101,331 @@ WEAK char build_options[1024];
 WEAK ScopedSpinLock::AtomicFlag build_options_lock = 0;
 WEAK bool build_options_initialized = false;
 
+WEAK bool out_of_order_queue = false;
+WEAK ScopedSpinLock::AtomicFlag out_of_order_queue_lock = 0;
+WEAK bool out_of_order_queue_initialized = false;
+
+// On an out-of-order command queue, commands are ordered only by the
+// events they wait for, so we keep the event of the last command to
+// write each cl_mem, and of the commands to read it since. Kernel
+// launches wait for the events of the conflicting uses of their
+// arguments, and copies, which the host must see complete anyway, wait
+// for them and then block on the copy itself, so that queue-wide
+// clFinish calls are only needed at device syncs. Crops of a cl_mem
+// share its entry.
+WEAK struct MemUses {
+    cl_mem mem;
+    cl_event writer;
+    // A reader that doesn't fit waits for the oldest one on the host.
+    int num_readers;
+    cl_event readers[8];
+    MemUses *next;
+} *mem_uses = nullptr;
+WEAK halide_mutex mem_uses_lock;
+
+WEAK bool is_out_of_order(cl_command_queue q) {
+    cl_command_queue_properties properties = 0;
+    return (clGetCommandQueueInfo(q, CL_QUEUE_PROPERTIES, sizeof(properties), &properties, nullptr) == CL_SUCCESS &&
+            (properties & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE));
+}
+
+WEAK MemUses *find_mem_uses_already_locked(cl_mem mem, bool create) {
+    for (MemUses *u = mem_uses; u; u = u->next) {
+        if (u->mem == mem) {
+            return u;
+        }
+    }
+    if (!create) {
+        return nullptr;
+    }
+    MemUses *u = (MemUses *)malloc(sizeof(MemUses));
+    if (u) {
+        memset(u, 0, sizeof(MemUses));
+        u->mem = mem;
+        u->next = mem_uses;
+        mem_uses = u;
+    }
+    return u;
+}
+
+WEAK void clear_mem_uses(MemUses *u) {
+    if (u->writer) {
+        clReleaseEvent(u->writer);
+        u->writer = nullptr;
+    }
+    for (int i = 0; i < u->num_readers; i++) {
+        clReleaseEvent(u->readers[i]);
+    }
+    u->num_readers = 0;
+}
+
+// Stop tracking a cl_mem that is being released.
+WEAK void forget_mem_uses(cl_mem mem) {
+    ScopedMutexLock lock(&mem_uses_lock);
+    for (MemUses **prev = &mem_uses; *prev; prev = &(*prev)->next) {
+        MemUses *u = *prev;
+        if (u->mem == mem) {
+            *prev = u->next;
+            clear_mem_uses(u);
+            free(u);
+            return;
+        }
+    }
+}
+
+WEAK void forget_all_mem_uses() {
+    ScopedMutexLock lock(&mem_uses_lock);
+    while (mem_uses) {
+        MemUses *u = mem_uses;
+        mem_uses = u->next;
+        clear_mem_uses(u);
+        free(u);
+    }
+}
+
+// A cl_mem about to be used by a command, and whether it is written.
+struct MemAccess {
+    cl_mem mem;
+    bool write;
+};
+
+// The events a command making the given accesses needs to wait for,
+// which remain owned by the tracking entries. The caller holds
+// mem_uses_lock, and provides room for the worst case.
+WEAK int get_wait_list_already_locked(const MemAccess *accesses, int num_accesses, cl_event *wait_list) {
+    int n = 0;
+    for (int i = 0; i < num_accesses; i++) {
+        MemUses *u = find_mem_uses_already_locked(accesses[i].mem, false);
+        if (!u) {
+            continue;
+        }
+        if (u->writer) {
+            wait_list[n++] = u->writer;
+        }
+        if (accesses[i].write) {
+            for (int j = 0; j < u->num_readers; j++) {
+                wait_list[n++] = u->readers[j];
+            }
+        }
+    }
+    return n;
+}
+
+WEAK int max_wait_list_size(int num_accesses) {
+    return num_accesses * (1 + (int)(sizeof(MemUses::readers) / sizeof(MemUses::readers[0])));
+}
+
+// Record that a command with the given event made the given accesses.
+WEAK void record_mem_uses_already_locked(const MemAccess *accesses, int num_accesses, cl_event event) {
+    for (int i = 0; i < num_accesses; i++) {
+        MemUses *u = find_mem_uses_already_locked(accesses[i].mem, true);
+        if (!u) {
+            // Out of memory, so make later commands wait for this one
+            // the hard way.
+            clWaitForEvents(1, &event);
+            continue;
+        }
+        clRetainEvent(event);
+        if (accesses[i].write) {
+            // This command waited for all the earlier uses.
+            clear_mem_uses(u);
+            u->writer = event;
+        } else {
+            const int max_readers = sizeof(u->readers) / sizeof(u->readers[0]);
+            if (u->num_readers == max_readers) {
+                clWaitForEvents(1, &u->readers[0]);
+                clReleaseEvent(u->readers[0]);
+                memmove(&u->readers[0], &u->readers[1], (max_readers - 1) * sizeof(cl_event));
+                u->num_readers--;
+            }
+            u->readers[u->num_readers++] = event;
+        }
+    }
+}
+
+// Wait on the host for the earlier uses that conflict with the given
+// accesses, which the caller then makes with blocking commands.
+WEAK cl_int wait_for_mem_uses(const MemAccess *accesses, int num_accesses) {
+    ScopedMutexLock lock(&mem_uses_lock);
+    cl_event wait_list[2 * (1 + sizeof(MemUses::readers) / sizeof(MemUses::readers[0]))];
+    halide_abort_if_false(nullptr, num_accesses <= 2);
+    int n = get_wait_list_already_locked(accesses, num_accesses, wait_list);
+    cl_int err = n ? clWaitForEvents(n, wait_list) : CL_SUCCESS;
+    if (err == CL_SUCCESS) {
+        // Everything waited for is finished, so needn't be waited for
+        // again.
+        for (int i = 0; i < num_accesses; i++) {
+            MemUses *u = find_mem_uses_already_locked(accesses[i].mem, false);
+            if (!u) {
+                continue;
+            }
+            if (accesses[i].write) {
+                clear_mem_uses(u);
+            } else if (u->writer) {
+                clReleaseEvent(u->writer);
+                u->writer = nullptr;
+            }
+        }
+    }
+    return err;
+}
+
+WEAK uint64_t allocate_pool_block(void *user_context, void *device_context, size_t size) {
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
+    cl_mem dev_ptr = clCreateBuffer((cl_context)device_context, CL_MEM_READ_WRITE, size, nullptr, &err);
+    if (err != CL_SUCCESS || dev_ptr == nullptr) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        return 0;
+    }
+    debug(user_context) << (void *)dev_ptr << "\n";
+    return (uint64_t)dev_ptr;
+}
+
+WEAK void free_pool_block(void *user_context, void *device_context, uint64_t block) {
+    debug(user_context) << "    clReleaseMemObject " << (void *)block << "\n";
+    forget_mem_uses((cl_mem)block);
+    clReleaseMemObject((cl_mem)block);
+}
+
+// On devices that share physical memory with the host,
+// halide_opencl_device_and_host_malloc allocates with
+// CL_MEM_ALLOC_HOST_PTR and uses the mapped buffer as the host
+// allocation, so that copies between the two are just map and unmap
+// commands, which don't move any data. The buffer is mapped while the
+// host owns it, and is unmapped before any command uses it on the
+// device. Crops of a cl_mem share its entry.
+WEAK struct HostMapping {
+    cl_mem mem;
+    uint8_t *host;
+    size_t size;
+    bool mapped;
+    HostMapping *next;
+} *host_mappings = nullptr;
+WEAK halide_mutex host_mappings_lock;
+
+WEAK HostMapping *find_host_mapping_already_locked(cl_mem mem) {
+    for (HostMapping *m = host_mappings; m; m = m->next) {
+        if (m->mem == mem) {
+            return m;
+        }
+    }
+    return nullptr;
+}
+
+WEAK bool has_host_unified_memory(cl_context ctx) {
+    cl_device_id dev;
+    cl_bool unified = CL_FALSE;
+    return (clGetContextInfo(ctx, CL_CONTEXT_DEVICES, sizeof(dev), &dev, nullptr) == CL_SUCCESS &&
+            clGetDeviceInfo(dev, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(unified), &unified, nullptr) == CL_SUCCESS &&
+            unified);
+}
+
+// Hand a zero-copy cl_mem to the host, once the commands using it on the
+// device are done.
+WEAK cl_int map_host_mapping_already_locked(void *user_context, cl_command_queue q, HostMapping *m) {
+    if (m->mapped) {
+        return CL_SUCCESS;
+    }
+    cl_int err = CL_SUCCESS;
+    if (is_out_of_order(q)) {
+        MemAccess access = {m->mem, true};
+        err = wait_for_mem_uses(&access, 1);
+        if (err != CL_SUCCESS) {
+            return err;
+        }
+    }
+    debug(user_context) << "    clEnqueueMapBuffer " << (void *)m->mem << "\n";
+    void *host = clEnqueueMapBuffer(q, m->mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, m->size,
+                                    0, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS) {
+        return err;
+    }
+    if (host != m->host) {
+        // The host allocation can't move, so we can't use this mapping.
+        clEnqueueUnmapMemObject(q, m->mem, host, 0, nullptr, nullptr);
+        return CL_MAP_FAILURE;
+    }
+    m->mapped = true;
+    return CL_SUCCESS;
+}
+
+// Hand a zero-copy cl_mem to the device. On an out-of-order queue we
+// wait for the unmap, so that it is ordered before the next use.
+WEAK cl_int unmap_host_mapping_already_locked(void *user_context, cl_command_queue q, HostMapping *m) {
+    if (!m->mapped) {
+        return CL_SUCCESS;
+    }
+    const bool out_of_order = is_out_of_order(q);
+    cl_event event = nullptr;
+    debug(user_context) << "    clEnqueueUnmapMemObject " << (void *)m->mem << "\n";
+    cl_int err = clEnqueueUnmapMemObject(q, m->mem, m->host, 0, nullptr, out_of_order ? &event : nullptr);
+    if (err == CL_SUCCESS && out_of_order) {
+        err = clWaitForEvents(1, &event);
+        clReleaseEvent(event);
+    }
+    if (err == CL_SUCCESS) {
+        m->mapped = false;
+    }
+    return err;
+}
+
+// Unmap a cl_mem, if it is zero-copy, before a command uses it on the
+// device.
+WEAK cl_int unmap_for_device_use(void *user_context, cl_command_queue q, cl_mem mem) {
+    if (__atomic_load_n(&host_mappings, __ATOMIC_ACQUIRE) == nullptr) {
+        return CL_SUCCESS;
+    }
+    ScopedMutexLock lock(&host_mappings_lock);
+    HostMapping *m = find_host_mapping_already_locked(mem);
+    return m ? unmap_host_mapping_already_locked(user_context, q, m) : CL_SUCCESS;
+}
+
+// Copy a buffer at the given offset into a cl_mem to or from its own
+// host allocation, returning false if it isn't zero-copy.
+WEAK bool sync_host_mapping(void *user_context, cl_command_queue q, cl_mem mem, uint64_t offset,
+                            const uint8_t *host, bool to_host, cl_int *err) {
+    if (__atomic_load_n(&host_mappings, __ATOMIC_ACQUIRE) == nullptr) {
+        return false;
+    }
+    ScopedMutexLock lock(&host_mappings_lock);
+    HostMapping *m = find_host_mapping_already_locked(mem);
+    if (m == nullptr || host != m->host + offset) {
+        return false;
+    }
+    if (to_host) {
+        *err = map_host_mapping_already_locked(user_context, q, m);
+    } else {
+        *err = unmap_host_mapping_already_locked(user_context, q, m);
+    }
+    return true;
+}
+
+// Stop tracking a zero-copy cl_mem that is being released.
+WEAK void forget_host_mapping(void *user_context, cl_command_queue q, cl_mem mem) {
+    ScopedMutexLock lock(&host_mappings_lock);
+    for (HostMapping **prev = &host_mappings; *prev; prev = &(*prev)->next) {
+        HostMapping *m = *prev;
+        if (m->mem == mem) {
+            unmap_host_mapping_already_locked(user_context, q, m);
+            __atomic_store_n(prev, m->next, __ATOMIC_RELEASE);
+            free(m);
+            return;
+        }
+    }
+}
+
+// Recycles cl_mem objects while allocation caching is on. A kernel
+// argument at a nonzero offset into a cl_mem would need a sub-buffer
+// made for every launch, so nothing is carved out of shared blocks
+// here: each request gets a cl_mem of its own, which is handed to later
+// requests of the same size class on the same command queue.
+WEAK DeviceMemoryPool memory_pool = {{}, allocate_pool_block, free_pool_block, 0, 0, 256, false};
+
+WEAK __attribute__((constructor)) void register_opencl_allocation_pool() {
+    device_memory_pool_register(&memory_pool, &opencl_device_interface);
+}
+
 }  // namespace OpenCL
 }  // namespace Internal
 }  // namespace Runtime
@@ -166,6 +493,19 @@ const char *halide_opencl_get_build_options_internal(void *user_context) {
     }
     return build_options;
 }
+
+void halide_opencl_set_out_of_order_queue_internal(bool enable) {
+    out_of_order_queue = enable;
+    out_of_order_queue_initialized = true;
+}
+
+bool halide_opencl_get_out_of_order_queue_internal(void *user_context) {
+    if (!out_of_order_queue_initialized) {
+        const char *value = getenv("HL_OCL_OUT_OF_ORDER_QUEUE");
+        halide_opencl_set_out_of_order_queue_internal(value && value[0] == '1');
+    }
+    return out_of_order_queue;
+}
 }  // namespace
 
 extern "C" {
@@ -200,6 +540,16 @@ WEAK const char *halide_opencl_get_build_options(void *user_context) {
     return halide_opencl_get_build_options_internal(user_context);
 }
 
+WEAK void halide_opencl_set_out_of_order_queue(bool enable) {
+    ScopedSpinLock lock(&out_of_order_queue_lock);
+    halide_opencl_set_out_of_order_queue_internal(enable);
+}
+
+WEAK bool halide_opencl_get_out_of_order_queue(void *user_context) {
+    ScopedSpinLock lock(&out_of_order_queue_lock);
+    return halide_opencl_get_out_of_order_queue_internal(user_context);
+}
+
 // The default implementation of halide_acquire_cl_context uses the global
 // pointers above, and serializes access with a spin lock.
 // Overriding implementations of acquire/release must implement the following
@@ -543,8 +893,19 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
         debug(user_context) << *ctx << "\n";
     }
 
+    cl_command_queue_properties queue_properties = 0;
+    if (halide_opencl_get_out_of_order_queue(user_context)) {
+        cl_command_queue_properties supported = 0;
+        err = clGetDeviceInfo(dev, CL_DEVICE_QUEUE_PROPERTIES, sizeof(supported), &supported, nullptr);
+        if (err == CL_SUCCESS && (supported & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE)) {
+            queue_properties = CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE;
+        } else {
+            debug(user_context) << "    device doesn't support out-of-order queues\n";
+        }
+    }
+
     debug(user_context) << "    clCreateCommandQueue ";
-    *q = clCreateCommandQueue(*ctx, dev, 0, &err);
+    *q = clCreateCommandQueue(*ctx, dev, queue_properties, &err);
     if (err != CL_SUCCESS) {
         debug(user_context) << get_opencl_error_name(err);
         error(user_context) << "CL: clCreateCommandQueue failed: "
@@ -557,6 +918,89 @@ WEAK int create_opencl_context(void *user_context, cl_context *ctx, cl_command_q
     return err;
 }
 
+// Describe the device, driver and build options that the binary
+// compiled from a kernel depends on, for the GPU kernel cache.
+WEAK bool get_kernel_cache_device_id(void *user_context, cl_device_id dev, const char *options, char *dst, char *end) {
+    char name[256], device_version[256], driver_version[256];
+    if (clGetDeviceInfo(dev, CL_DEVICE_NAME, sizeof(name), name, nullptr) != CL_SUCCESS ||
+        clGetDeviceInfo(dev, CL_DEVICE_VERSION, sizeof(device_version), device_version, nullptr) != CL_SUCCESS ||
+        clGetDeviceInfo(dev, CL_DRIVER_VERSION, sizeof(driver_version), driver_version, nullptr) != CL_SUCCESS) {
+        return false;
+    }
+    dst = halide_string_to_string(dst, end, name);
+    dst = halide_string_to_string(dst, end, " / ");
+    dst = halide_string_to_string(dst, end, device_version);
+    dst = halide_string_to_string(dst, end, " / ");
+    dst = halide_string_to_string(dst, end, driver_version);
+    dst = halide_string_to_string(dst, end, " / ");
+    dst = halide_string_to_string(dst, end, options);
+    // A truncated description could match a different configuration.
+    return dst < end - 1;
+}
+
+// Load a program binary from the GPU kernel cache, if there is a usable one.
+WEAK cl_program load_cached_program(void *user_context, cl_context ctx, cl_device_id dev,
+                                    const char *device_id, const char *options,
+                                    const char *src, int size) {
+    size_t binary_size = 0;
+    void *binary = gpu_kernel_cache_load(user_context, "opencl", device_id, src, size, &binary_size);
+    if (!binary) {
+        return nullptr;
+    }
+
+    const unsigned char *binaries[] = {(const unsigned char *)binary};
+    cl_int binary_status = CL_SUCCESS;
+    cl_int err = CL_SUCCESS;
+    debug(user_context) << "    clCreateProgramWithBinary -> ";
+    cl_program program = clCreateProgramWithBinary(ctx, 1, &dev, &binary_size, binaries, &binary_status, &err);
+    free(binary);
+    if (err == CL_SUCCESS && binary_status == CL_SUCCESS) {
+        debug(user_context) << (void *)program << "\n";
+        err = clBuildProgram(program, 1, &dev, options, nullptr, nullptr);
+    } else {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+    }
+    if (err != CL_SUCCESS || binary_status != CL_SUCCESS) {
+        // Stale binaries are expected after driver updates; just
+        // compile the source instead.
+        if (program) {
+            clReleaseProgram(program);
+        }
+        return nullptr;
+    }
+    return program;
+}
+
+// Store the binary of a program built from source in the GPU kernel cache.
+WEAK void save_cached_program(void *user_context, cl_program program, const char *device_id,
+                              const char *src, int size) {
+    size_t binary_size = 0;
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(binary_size), &binary_size, nullptr) != CL_SUCCESS ||
+        binary_size == 0) {
+        return;
+    }
+    unsigned char *binary = (unsigned char *)malloc(binary_size);
+    if (!binary) {
+        return;
+    }
+    unsigned char *binaries[] = {binary};
+    if (clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(binaries), binaries, nullptr) == CL_SUCCESS) {
+        gpu_kernel_cache_save(user_context, "opencl", device_id, src, size, binary, binary_size);
+    }
+    free(binary);
+}
+
+// Whether the kernels were compiled to SPIR-V ahead of time (with the
+// cl_spirv target feature) rather than embedded as OpenCL C source.
+WEAK bool is_spirv_module(const char *src, int size) {
+    if (size < 4) {
+        return false;
+    }
+    const uint8_t *bytes = (const uint8_t *)src;
+    // The SPIR-V magic number is 0x07230203.
+    return bytes[0] == 0x03 && bytes[1] == 0x02 && bytes[2] == 0x23 && bytes[3] == 0x07;
+}
+
 WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *src, int size) {
     cl_int err = 0;
     cl_device_id dev;
@@ -595,16 +1039,45 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
     const char *extra_options = halide_opencl_get_build_options(user_context);
     options << " " << extra_options;
 
-    const char *sources[] = {src};
-    debug(user_context) << "    clCreateProgramWithSource -> ";
-    cl_program program = clCreateProgramWithSource(ctx, 1, &sources[0], nullptr, &err);
-    if (err != CL_SUCCESS) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateProgramWithSource failed: "
-                            << get_opencl_error_name(err);
-        return nullptr;
+    char device_id[1024];
+    const bool use_kernel_cache =
+        halide_get_gpu_kernel_cache_dir(user_context) &&
+        get_kernel_cache_device_id(user_context, dev, options.str(), device_id, device_id + sizeof(device_id));
+    if (use_kernel_cache) {
+        cl_program program = load_cached_program(user_context, ctx, dev, device_id, options.str(), src, size);
+        if (program) {
+            return program;
+        }
+    }
+
+    cl_program program = nullptr;
+    if (is_spirv_module(src, size)) {
+        if (!clCreateProgramWithIL) {
+            error(user_context) << "CL: The kernels were compiled to SPIR-V, which needs clCreateProgramWithIL from OpenCL 2.1 or later.";
+            return nullptr;
+        }
+        debug(user_context) << "    clCreateProgramWithIL -> ";
+        program = clCreateProgramWithIL(ctx, src, size, &err);
+        if (err != CL_SUCCESS) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateProgramWithIL failed: "
+                                << get_opencl_error_name(err);
+            return nullptr;
+        } else {
+            debug(user_context) << (void *)program << "\n";
+        }
     } else {
-        debug(user_context) << (void *)program << "\n";
+        const char *sources[] = {src};
+        debug(user_context) << "    clCreateProgramWithSource -> ";
+        program = clCreateProgramWithSource(ctx, 1, &sources[0], nullptr, &err);
+        if (err != CL_SUCCESS) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateProgramWithSource failed: "
+                                << get_opencl_error_name(err);
+            return nullptr;
+        } else {
+            debug(user_context) << (void *)program << "\n";
+        }
     }
 
     debug(user_context) << "    clBuildProgram " << (void *)program
@@ -642,6 +1115,10 @@ WEAK cl_program compile_kernel(void *user_context, cl_context ctx, const char *s
         return nullptr;
     }
 
+    if (use_kernel_cache) {
+        save_cached_program(user_context, program, device_id, src, size);
+    }
+
     return program;
 }
 
@@ -677,8 +1154,15 @@ WEAK int halide_opencl_device_free(void *user_context, halide_buffer_t *buf) {
 #endif
 
     halide_abort_if_false(user_context, validate_device_pointer(user_context, buf));
-    debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
-    cl_int result = clReleaseMemObject((cl_mem)dev_ptr);
+    cl_int result = CL_SUCCESS;
+    if (device_memory_pool_reclaim(user_context, &memory_pool, ctx.context, (uint64_t)dev_ptr, 0)) {
+        debug(user_context) << "    returned " << (void *)dev_ptr << " to the pool\n";
+    } else {
+        debug(user_context) << "    clReleaseMemObject " << (void *)dev_ptr << "\n";
+        forget_host_mapping(user_context, ctx.cmd_queue, (cl_mem)dev_ptr);
+        forget_mem_uses((cl_mem)dev_ptr);
+        result = clReleaseMemObject((cl_mem)dev_ptr);
+    }
     // If clReleaseMemObject fails, it is unlikely to succeed in a later call, so
     // we just end our reference to it regardless.
     free((device_handle *)buf->device);
@@ -748,6 +1232,48 @@ WEAK int halide_opencl_compute_capability(void *user_context, int *major, int *m
     return 0;
 }
 
+WEAK int halide_opencl_preferred_block_size(void *user_context, int registers_per_thread,
+                                            int shared_memory_per_block) {
+    ClContext ctx(user_context);
+    if (ctx.error_code != 0) {
+        return 0;
+    }
+
+    cl_device_id dev;
+    cl_int err = clGetContextInfo(ctx.context, CL_CONTEXT_DEVICES, sizeof(dev), &dev, nullptr);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clGetContextInfo failed: "
+                            << get_opencl_error_name(err);
+        return 0;
+    }
+
+    size_t max_work_group_size = 0;
+    cl_ulong local_mem_size = 0;
+    err = clGetDeviceInfo(dev, CL_DEVICE_MAX_WORK_GROUP_SIZE, sizeof(max_work_group_size), &max_work_group_size, nullptr);
+    if (err == CL_SUCCESS) {
+        err = clGetDeviceInfo(dev, CL_DEVICE_LOCAL_MEM_SIZE, sizeof(local_mem_size), &local_mem_size, nullptr);
+    }
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clGetDeviceInfo failed: "
+                            << get_opencl_error_name(err);
+        return 0;
+    }
+
+    // OpenCL doesn't say how many work-groups can be resident at once
+    // without a compiled kernel, nor how registers are shared between
+    // them, so just use the largest power of two the device allows.
+    if ((cl_ulong)shared_memory_per_block > local_mem_size) {
+        return 0;
+    }
+    int block_size = 1;
+    while ((size_t)block_size * 2 <= max_work_group_size) {
+        block_size *= 2;
+    }
+
+    debug(user_context) << "CL: preferred block size: " << block_size << "\n";
+    return block_size;
+}
+
 WEAK int halide_opencl_initialize_kernels(void *user_context, void **state_ptr, const char *src, int size) {
     debug(user_context)
         << "CL: halide_opencl_initialize_kernels (user_context: " << user_context
@@ -835,10 +1361,19 @@ WEAK int halide_opencl_device_release(void *user_context) {
         err = clFinish(q);
         halide_abort_if_false(user_context, err == CL_SUCCESS);
 
+        // All the tracked events have completed, so they order nothing.
+        forget_all_mem_uses();
+
         compilation_cache.delete_context(user_context, ctx, clReleaseProgram);
 
+        device_memory_pool_trim(user_context, &memory_pool, ctx);
+
         // Release the context itself, if we created it.
         if (ctx == context) {
+            // Any buffers still allocated from the pool keep the context
+            // alive, and are released directly when freed.
+            device_memory_pool_forget(user_context, &memory_pool, ctx);
+
             debug(user_context) << "    clReleaseCommandQueue " << command_queue << "\n";
             err = clReleaseCommandQueue(command_queue);
             halide_abort_if_false(user_context, err == CL_SUCCESS);
@@ -888,17 +1423,32 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t *buf) {
         return CL_OUT_OF_HOST_MEMORY;
     }
 
-    cl_int err;
-    debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
-    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, nullptr, &err);
-    if (err != CL_SUCCESS || dev_ptr == nullptr) {
-        debug(user_context) << get_opencl_error_name(err) << "\n";
-        error(user_context) << "CL: clCreateBuffer failed: "
-                            << get_opencl_error_name(err);
-        free(dev_handle);
-        return err;
+    cl_mem dev_ptr = nullptr;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        uint64_t block = 0, offset = 0;
+        int result = device_memory_pool_reserve(user_context, &memory_pool, ctx.context, ctx.cmd_queue,
+                                                size, &block, &offset);
+        if (result != 0) {
+            error(user_context) << "CL: Failed to allocate " << (uint64_t)size << " bytes from the device memory pool\n";
+            free(dev_handle);
+            return result;
+        }
+        halide_abort_if_false(user_context, offset == 0);
+        dev_ptr = (cl_mem)block;
+        debug(user_context) << "    allocated " << (void *)dev_ptr << " from the pool, device_handle: " << dev_handle << "\n";
     } else {
-        debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+        cl_int err;
+        debug(user_context) << "    clCreateBuffer -> " << (int)size << " ";
+        dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE, size, nullptr, &err);
+        if (err != CL_SUCCESS || dev_ptr == nullptr) {
+            debug(user_context) << get_opencl_error_name(err) << "\n";
+            error(user_context) << "CL: clCreateBuffer failed: "
+                                << get_opencl_error_name(err);
+            free(dev_handle);
+            return err;
+        } else {
+            debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+        }
     }
 
     dev_handle->mem = dev_ptr;
@@ -922,10 +1472,75 @@ WEAK int halide_opencl_device_malloc(void *user_context, halide_buffer_t *buf) {
 }
 
 namespace {
+// Allocate a buffer that the host and device share, for a device with
+// unified memory. These don't come from the pool, which can't keep
+// track of their mappings.
+WEAK int opencl_zero_copy_malloc(void *user_context, ClContext &ctx, halide_buffer_t *buf) {
+    size_t size = buf->size_in_bytes();
+    halide_abort_if_false(user_context, size != 0);
+
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    HostMapping *m = (HostMapping *)malloc(sizeof(HostMapping));
+    if (dev_handle == nullptr || m == nullptr) {
+        free(dev_handle);
+        free(m);
+        return CL_OUT_OF_HOST_MEMORY;
+    }
+
+    cl_int err;
+    debug(user_context) << "    clCreateBuffer(CL_MEM_ALLOC_HOST_PTR) -> " << (int)size << " ";
+    cl_mem dev_ptr = clCreateBuffer(ctx.context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, nullptr, &err);
+    if (err != CL_SUCCESS || dev_ptr == nullptr) {
+        debug(user_context) << get_opencl_error_name(err) << "\n";
+        error(user_context) << "CL: clCreateBuffer failed: "
+                            << get_opencl_error_name(err);
+        free(dev_handle);
+        free(m);
+        return err;
+    }
+    debug(user_context) << (void *)dev_ptr << " device_handle: " << dev_handle << "\n";
+
+    // The buffer starts out mapped, as it is only written on the host
+    // before first use.
+    void *host = clEnqueueMapBuffer(ctx.cmd_queue, dev_ptr, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, size,
+                                    0, nullptr, nullptr, &err);
+    if (err != CL_SUCCESS) {
+        error(user_context) << "CL: clEnqueueMapBuffer failed: "
+                            << get_opencl_error_name(err);
+        clReleaseMemObject(dev_ptr);
+        free(dev_handle);
+        free(m);
+        return err;
+    }
+
+    m->mem = dev_ptr;
+    m->host = (uint8_t *)host;
+    m->size = size;
+    m->mapped = true;
+    {
+        ScopedMutexLock lock(&host_mappings_lock);
+        m->next = host_mappings;
+        __atomic_store_n(&host_mappings, m, __ATOMIC_RELEASE);
+    }
+
+    dev_handle->mem = dev_ptr;
+    dev_handle->offset = 0;
+    buf->device = (uint64_t)dev_handle;
+    buf->device_interface = &opencl_device_interface;
+    buf->device_interface->impl->use_module();
+    buf->host = (uint8_t *)host;
+
+    debug(user_context)
+        << "    Allocated zero-copy buffer " << (void *)buf->device
+        << " host: " << buf->host << " for buffer " << buf << "\n";
+    return CL_SUCCESS;
+}
+
 WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
                                          const device_copy &c,
                                          int64_t src_idx, int64_t dst_idx,
-                                         int d, bool from_host, bool to_host) {
+                                         int d, bool from_host, bool to_host,
+                                         bool blocking) {
     if (d > MAX_COPY_DIMS) {
         error(user_context) << "Buffer has too many dimensions to copy to/from GPU\n";
         return -1;
@@ -939,16 +1554,21 @@ WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
                             << ", " << c.chunk_size << " bytes\n";
         if (!from_host && to_host) {
             err = clEnqueueReadBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem,
-                                      CL_FALSE, src_idx + ((device_handle *)c.src)->offset, c.chunk_size, (void *)(c.dst + dst_idx),
+                                      blocking, src_idx + ((device_handle *)c.src)->offset, c.chunk_size, (void *)(c.dst + dst_idx),
                                       0, nullptr, nullptr);
         } else if (from_host && !to_host) {
             err = clEnqueueWriteBuffer(ctx.cmd_queue, ((device_handle *)c.dst)->mem,
-                                       CL_FALSE, dst_idx + ((device_handle *)c.dst)->offset, c.chunk_size, (void *)(c.src + src_idx),
+                                       blocking, dst_idx + ((device_handle *)c.dst)->offset, c.chunk_size, (void *)(c.src + src_idx),
                                        0, nullptr, nullptr);
         } else if (!from_host && !to_host) {
+            cl_event event = nullptr;
             err = clEnqueueCopyBuffer(ctx.cmd_queue, ((device_handle *)c.src)->mem, ((device_handle *)c.dst)->mem,
                                       src_idx + ((device_handle *)c.src)->offset, dst_idx + ((device_handle *)c.dst)->offset,
-                                      c.chunk_size, 0, nullptr, nullptr);
+                                      c.chunk_size, 0, nullptr, blocking ? &event : nullptr);
+            if (err == CL_SUCCESS && blocking) {
+                err = clWaitForEvents(1, &event);
+                clReleaseEvent(event);
+            }
         } else if ((c.dst + dst_idx) != (c.src + src_idx)) {
             // Could reach here if a user called directly into the
             // opencl API for a device->host copy on a source buffer
@@ -965,7 +1585,7 @@ WEAK int opencl_do_multidimensional_copy(void *user_context, ClContext &ctx,
         for (int i = 0; i < (int)c.extent[d - 1]; i++) {
             int err = opencl_do_multidimensional_copy(user_context, ctx, c,
                                                       src_idx + src_off, dst_idx + dst_off,
-                                                      d - 1, from_host, to_host);
+                                                      d - 1, from_host, to_host, blocking);
             dst_off += c.dst_stride_bytes[d - 1];
             src_off += c.src_stride_bytes[d - 1];
             if (err) {
@@ -1022,12 +1642,57 @@ WEAK int halide_opencl_buffer_copy(void *user_context, struct halide_buffer_t *s
         }
 #endif
 
-        err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host);
+        // A zero-copy buffer and its own host allocation are the same
+        // memory, so a copy between them just hands it over.
+        if (src == dst && src->device && src->device_interface == &opencl_device_interface &&
+            sync_host_mapping(user_context, ctx.cmd_queue, ((device_handle *)src->device)->mem,
+                              ((device_handle *)src->device)->offset, src->host, to_host, &err)) {
+            if (err != CL_SUCCESS) {
+                error(user_context) << "CL: " << (to_host ? "clEnqueueMapBuffer" : "clEnqueueUnmapMemObject")
+                                    << " failed: " << get_opencl_error_name(err);
+            }
+            return err;
+        }
+        if (!from_host) {
+            err = unmap_for_device_use(user_context, ctx.cmd_queue, ((device_handle *)c.src)->mem);
+        }
+        if (err == CL_SUCCESS && !to_host) {
+            err = unmap_for_device_use(user_context, ctx.cmd_queue, ((device_handle *)c.dst)->mem);
+        }
+        if (err != CL_SUCCESS) {
+            error(user_context) << "CL: clEnqueueUnmapMemObject failed: "
+                                << get_opencl_error_name(err);
+            return err;
+        }
 
-        // The reads/writes above are all non-blocking, so empty the command
-        // queue before we proceed so that other host code won't write
-        // to the buffer while the above writes are still running.
-        clFinish(ctx.cmd_queue);
+        // On an out-of-order queue, wait for the conflicting uses of the
+        // buffers, and then for each part of the copy. Otherwise the
+        // reads/writes are all non-blocking, so empty the command queue
+        // before we proceed so that other host code won't write to the
+        // buffer while the writes are still running.
+        const bool out_of_order = is_out_of_order(ctx.cmd_queue);
+        if (out_of_order) {
+            MemAccess accesses[2];
+            int num_accesses = 0;
+            if (!from_host) {
+                accesses[num_accesses++] = {((device_handle *)c.src)->mem, false};
+            }
+            if (!to_host) {
+                accesses[num_accesses++] = {((device_handle *)c.dst)->mem, true};
+            }
+            err = wait_for_mem_uses(accesses, num_accesses);
+            if (err != CL_SUCCESS) {
+                error(user_context) << "CL: clWaitForEvents failed: "
+                                    << get_opencl_error_name(err);
+                return err;
+            }
+        }
+
+        err = opencl_do_multidimensional_copy(user_context, ctx, c, c.src_begin, 0, dst->dimensions, from_host, to_host, out_of_order);
+
+        if (!out_of_order) {
+            clFinish(ctx.cmd_queue);
+        }
 
 #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
@@ -1119,6 +1784,20 @@ WEAK int halide_opencl_run(void *user_context,
         memset(sub_buffers, 0, sizeof(cl_mem) * sub_buffers_needed);
     }
 
+    // On an out-of-order queue, the launch waits for the earlier uses
+    // of the buffers it accesses.
+    const bool out_of_order = is_out_of_order(ctx.cmd_queue);
+    const int num_args = i;
+    MemAccess *accesses = nullptr;
+    int num_accesses = 0;
+    if (out_of_order) {
+        accesses = (MemAccess *)malloc(sizeof(MemAccess) * (num_args + 1));
+        if (accesses == nullptr) {
+            free(sub_buffers);
+            return halide_error_code_out_of_memory;
+        }
+    }
+
     i = 0;
     while (arg_sizes[i] != 0) {
         debug(user_context) << "    clSetKernelArg " << i
@@ -1132,8 +1811,13 @@ WEAK int halide_opencl_run(void *user_context,
             halide_abort_if_false(user_context, arg_sizes[i] == sizeof(uint64_t));
             cl_mem mem = ((device_handle *)((halide_buffer_t *)this_arg)->device)->mem;
             uint64_t offset = ((device_handle *)((halide_buffer_t *)this_arg)->device)->offset;
+            if (accesses) {
+                // 2 marks a buffer the kernel only reads.
+                accesses[num_accesses++] = {mem, arg_is_buffer[i] != 2};
+            }
+            err = unmap_for_device_use(user_context, ctx.cmd_queue, mem);
 
-            if (offset != 0) {
+            if (err == CL_SUCCESS && offset != 0) {
                 cl_buffer_region region = {(size_t)offset, ((halide_buffer_t *)this_arg)->size_in_bytes()};
                 // The sub-buffer encompasses the linear range of addresses that
                 // span the crop.
@@ -1155,6 +1839,7 @@ WEAK int halide_opencl_run(void *user_context,
                 clReleaseMemObject(sub_buffers[sub_buf_index]);
             }
             free(sub_buffers);
+            free(accesses);
             return err;
         }
         i++;
@@ -1167,6 +1852,11 @@ WEAK int halide_opencl_run(void *user_context,
     if (err != CL_SUCCESS) {
         error(user_context) << "CL: clSetKernelArg failed "
                             << get_opencl_error_name(err);
+        for (int sub_buf_index = 0; sub_buf_index < sub_buffers_saved; sub_buf_index++) {
+            clReleaseMemObject(sub_buffers[sub_buf_index]);
+        }
+        free(sub_buffers);
+        free(accesses);
         return err;
     }
 
@@ -1175,11 +1865,33 @@ WEAK int halide_opencl_run(void *user_context,
         << "    clEnqueueNDRangeKernel "
         << blocksX << "x" << blocksY << "x" << blocksZ << ", "
         << threadsX << "x" << threadsY << "x" << threadsZ << " -> ";
-    err = clEnqueueNDRangeKernel(ctx.cmd_queue, f,
-                                 // NDRange
-                                 3, nullptr, global_dim, local_dim,
-                                 // Events
-                                 0, nullptr, nullptr);
+    if (out_of_order) {
+        ScopedMutexLock lock(&mem_uses_lock);
+        cl_event *wait_list = (cl_event *)malloc(sizeof(cl_event) * (max_wait_list_size(num_accesses) + 1));
+        if (wait_list == nullptr) {
+            err = CL_OUT_OF_HOST_MEMORY;
+        } else {
+            int wait_list_size = get_wait_list_already_locked(accesses, num_accesses, wait_list);
+            cl_event event = nullptr;
+            err = clEnqueueNDRangeKernel(ctx.cmd_queue, f,
+                                         // NDRange
+                                         3, nullptr, global_dim, local_dim,
+                                         // Events
+                                         wait_list_size, wait_list_size ? wait_list : nullptr, &event);
+            if (err == CL_SUCCESS) {
+                record_mem_uses_already_locked(accesses, num_accesses, event);
+                clReleaseEvent(event);
+            }
+            free(wait_list);
+        }
+        free(accesses);
+    } else {
+        err = clEnqueueNDRangeKernel(ctx.cmd_queue, f,
+                                     // NDRange
+                                     3, nullptr, global_dim, local_dim,
+                                     // Events
+                                     0, nullptr, nullptr);
+    }
     debug(user_context) << get_opencl_error_name(err) << "\n";
 
     // Now that the kernel is enqueued, OpenCL is holding its own
@@ -1212,11 +1924,33 @@ WEAK int halide_opencl_run(void *user_context,
 }
 
 WEAK int halide_opencl_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        ClContext ctx(user_context);
+        if (ctx.error_code != CL_SUCCESS) {
+            return ctx.error_code;
+        }
+        if (has_host_unified_memory(ctx.context)) {
+            return opencl_zero_copy_malloc(user_context, ctx, buf);
+        }
+    }
     return halide_default_device_and_host_malloc(user_context, buf, &opencl_device_interface);
 }
 
 WEAK int halide_opencl_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
-    return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    bool zero_copy = false;
+    if (buf->device) {
+        ScopedMutexLock lock(&host_mappings_lock);
+        zero_copy = find_host_mapping_already_locked(((device_handle *)buf->device)->mem) != nullptr;
+    }
+    if (!zero_copy) {
+        return halide_default_device_and_host_free(user_context, buf, &opencl_device_interface);
+    }
+    // The host allocation goes with the cl_mem.
+    int result = halide_opencl_device_free(user_context, buf);
+    buf->host = nullptr;
+    buf->set_host_dirty(false);
+    buf->set_device_dirty(false);
+    return result;
 }
 
 WEAK int halide_opencl_wrap_cl_mem(void *user_context, struct halide_buffer_t *buf, uint64_t mem) {
@@ -1740,6 +2474,19 @@ WEAK int halide_opencl_image_buffer_copy(void *user_context, struct halide_buffe
             error(user_context) << "image buffer copies must be for whole buffer";
             return halide_error_code_device_buffer_copy_failed;
         }
+
+        // As for buffers, copies on an out-of-order queue wait for the
+        // conflicting uses of the image, and then block.
+        const bool out_of_order = is_out_of_order(ctx.cmd_queue);
+        if (out_of_order && from_host != to_host) {
+            MemAccess access = {from_host ? ((device_handle *)c.dst)->mem : ((device_handle *)c.src)->mem, from_host};
+            err = wait_for_mem_uses(&access, 1);
+            if (err != CL_SUCCESS) {
+                error(user_context) << "CL: clWaitForEvents failed: "
+                                    << get_opencl_error_name(err);
+                return err;
+            }
+        }
         if (!from_host && to_host) {
             int dim = dst->dimensions;
             size_t offset[] = {0, 0, 0};
@@ -1757,7 +2504,7 @@ WEAK int halide_opencl_image_buffer_copy(void *user_context, struct halide_buffe
                 return halide_error_code_device_buffer_copy_failed;
             }
             err = clEnqueueReadImage(ctx.cmd_queue, ((device_handle *)c.src)->mem,
-                                     CL_FALSE, offset, region,
+                                     out_of_order, offset, region,
                                      /* row_pitch */ 0, /* slice_pitch */ 0,
                                      dst->host, 0, nullptr, nullptr);
         } else if (from_host && !to_host) {
@@ -1777,7 +2524,7 @@ WEAK int halide_opencl_image_buffer_copy(void *user_context, struct halide_buffe
                 return halide_error_code_device_buffer_copy_failed;
             }
             err = clEnqueueWriteImage(ctx.cmd_queue, ((device_handle *)c.dst)->mem,
-                                      CL_FALSE, offset, region, /* row_pitch */ 0, /* slice_pitch */ 0, src->host,
+                                      out_of_order, offset, region, /* row_pitch */ 0, /* slice_pitch */ 0, src->host,
                                       0, nullptr, nullptr);
         } else if (!from_host && !to_host) {
             error(user_context) << "image to image copies not implemented";
@@ -1791,10 +2538,12 @@ WEAK int halide_opencl_image_buffer_copy(void *user_context, struct halide_buffe
             return err;
         }
 
-        // The reads/writes above are all non-blocking, so empty the command
-        // queue before we proceed so that other host code won't write
-        // to the buffer while the above writes are still running.
-        clFinish(ctx.cmd_queue);
+        // The reads/writes above are non-blocking on an in-order queue, so
+        // empty the command queue before we proceed so that other host code
+        // won't write to the buffer while the above writes are still running.
+        if (!out_of_order) {
+            clFinish(ctx.cmd_queue);
+        }
 
 #ifdef DEBUG_RUNTIME
         uint64_t t_after = halide_current_time_ns(user_context);
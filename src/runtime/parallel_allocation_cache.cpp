@@ -0,0 +1,115 @@
+#include "HalideRuntime.h"
+#include "runtime_internal.h"
+#include "scoped_mutex_lock.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+struct ParallelCacheBuffer {
+    void *ptr;
+    size_t size;
+};
+
+struct ParallelCacheSlot {
+    ParallelCacheSlot *next_free;
+    ParallelCacheSlot *next;
+    // Followed by the cache's num_buffers buffers.
+};
+
+struct ParallelCache {
+    halide_mutex lock;
+    int num_buffers;
+    ParallelCacheSlot *free_slots;
+    ParallelCacheSlot *slots;
+};
+
+ALWAYS_INLINE ParallelCacheBuffer *slot_buffers(ParallelCacheSlot *slot) {
+    return (ParallelCacheBuffer *)(slot + 1);
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK void *halide_parallel_cache_create(void *user_context, int num_buffers) {
+    ParallelCache *cache = (ParallelCache *)halide_malloc(user_context, sizeof(ParallelCache));
+    if (cache) {
+        memset(cache, 0, sizeof(ParallelCache));
+        cache->num_buffers = num_buffers;
+    }
+    return cache;
+}
+
+WEAK void halide_parallel_cache_destroy(void *user_context, void *c) {
+    ParallelCache *cache = (ParallelCache *)c;
+    ParallelCacheSlot *slot = cache->slots;
+    while (slot) {
+        ParallelCacheSlot *next = slot->next;
+        ParallelCacheBuffer *buffers = slot_buffers(slot);
+        for (int i = 0; i < cache->num_buffers; i++) {
+            if (buffers[i].ptr) {
+                halide_free(user_context, buffers[i].ptr);
+            }
+        }
+        halide_free(user_context, slot);
+        slot = next;
+    }
+    halide_free(user_context, cache);
+}
+
+WEAK void *halide_parallel_cache_acquire(void *user_context, void *c) {
+    ParallelCache *cache = (ParallelCache *)c;
+    {
+        ScopedMutexLock lock(&cache->lock);
+        ParallelCacheSlot *slot = cache->free_slots;
+        if (slot) {
+            cache->free_slots = slot->next_free;
+            return slot;
+        }
+    }
+    // No idle slot, so there are more iterations running at once than
+    // there are slots. Make a new one.
+    size_t bytes = sizeof(ParallelCacheSlot) + cache->num_buffers * sizeof(ParallelCacheBuffer);
+    ParallelCacheSlot *slot = (ParallelCacheSlot *)halide_malloc(user_context, bytes);
+    if (!slot) {
+        return nullptr;
+    }
+    memset(slot, 0, bytes);
+    ScopedMutexLock lock(&cache->lock);
+    slot->next = cache->slots;
+    cache->slots = slot;
+    return slot;
+}
+
+WEAK int halide_parallel_cache_release(void *user_context, void *c, void *s) {
+    ParallelCache *cache = (ParallelCache *)c;
+    ParallelCacheSlot *slot = (ParallelCacheSlot *)s;
+    if (slot) {
+        ScopedMutexLock lock(&cache->lock);
+        slot->next_free = cache->free_slots;
+        cache->free_slots = slot;
+    }
+    return 0;
+}
+
+WEAK void *halide_parallel_cache_get(void *user_context, void *s, int index, uint64_t size) {
+    ParallelCacheSlot *slot = (ParallelCacheSlot *)s;
+    if (!slot) {
+        return nullptr;
+    }
+    ParallelCacheBuffer *buffer = slot_buffers(slot) + index;
+    if (__builtin_expect(size > buffer->size, 0)) {
+        if (buffer->ptr) {
+            halide_free(user_context, buffer->ptr);
+        }
+        buffer->ptr = halide_malloc(user_context, (size_t)size);
+        buffer->size = buffer->ptr ? (size_t)size : 0;
+    }
+    return buffer->ptr;
+}
+}
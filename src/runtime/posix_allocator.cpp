@@ -8,22 +8,67 @@ extern "C" {
 extern void *malloc(size_t);
 extern void free(void *);
 
+}
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// In NUMA-aware mode, allocations at least this large get fresh pages
+// from the OS instead of memory recycled by malloc, which may already
+// have been touched (and so placed) by a thread on some other node.
+constexpr size_t numa_local_alloc_threshold = 1024 * 1024;
+
+// Allocations at least this large are mapped directly, backed by huge
+// pages where possible, to save on TLB misses and page faults. Zero
+// means never.
+WEAK size_t large_alloc_threshold = 16 * 1024 * 1024;
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
 WEAK void *halide_default_malloc(void *user_context, size_t x) {
-    // Allocate enough space for aligning the pointer we return.
+    // Allocate enough space for aligning the pointer we return, and
+    // for the two words we store before it.
     const size_t alignment = halide_malloc_alignment();
-    void *orig = malloc(x + alignment);
+    const size_t padded = x + alignment + 2 * sizeof(void *);
+    void *orig = nullptr;
+    size_t mapped_size = 0;
+    if (x >= numa_local_alloc_threshold && halide_numa_aware()) {
+        orig = halide_numa_local_alloc(user_context, padded);
+        mapped_size = orig ? padded : 0;
+    } else if (large_alloc_threshold && x >= large_alloc_threshold) {
+        orig = halide_large_alloc(user_context, padded, &mapped_size);
+        if (orig == nullptr) {
+            mapped_size = 0;
+        }
+    }
+    if (orig == nullptr) {
+        orig = malloc(padded);
+    }
     if (orig == nullptr) {
         // Will result in a failed assertion and a call to halide_error
         return nullptr;
     }
-    // We want to store the original pointer prior to the pointer we return.
-    void *ptr = (void *)(((size_t)orig + alignment + sizeof(void *) - 1) & ~(alignment - 1));
+    // We want to store the original pointer prior to the pointer we
+    // return, and before that the size of the mapping if it didn't
+    // come from malloc.
+    void *ptr = (void *)(((size_t)orig + alignment + 2 * sizeof(void *) - 1) & ~(alignment - 1));
     ((void **)ptr)[-1] = orig;
+    ((size_t *)ptr)[-2] = mapped_size;
     return ptr;
 }
 
 WEAK void halide_default_free(void *user_context, void *ptr) {
-    free(((void **)ptr)[-1]);
+    size_t mapped_size = ((size_t *)ptr)[-2];
+    if (mapped_size) {
+        halide_large_free(user_context, ((void **)ptr)[-1], mapped_size);
+    } else {
+        free(((void **)ptr)[-1]);
+    }
 }
 }
 
@@ -40,6 +85,12 @@ WEAK halide_free_t custom_free = halide_default_free;
 
 extern "C" {
 
+WEAK size_t halide_set_large_allocation_threshold(size_t bytes) {
+    size_t result = large_alloc_threshold;
+    large_alloc_threshold = bytes;
+    return result;
+}
+
 WEAK halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc) {
     halide_malloc_t result = custom_malloc;
     custom_malloc = user_malloc;
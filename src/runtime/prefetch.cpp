@@ -11,4 +11,11 @@ WEAK_INLINE int _halide_prefetch(const void *ptr) {
     __builtin_prefetch(ptr, rw, locality);
     return 0;
 }
+
+WEAK_INLINE int _halide_prefetch_write(const void *ptr) {
+    constexpr int rw = 1;        // 1 = write, 0 = read
+    constexpr int locality = 0;  // 0 = no temporal locality, 3 = high temporal locality
+    __builtin_prefetch(ptr, rw, locality);
+    return 0;
+}
 }
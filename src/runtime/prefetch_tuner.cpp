@@ -0,0 +1,139 @@
+#include "HalideRuntime.h"
+#include "printer.h"
+#include "runtime_internal.h"
+#include "scoped_spin_lock.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+
+// Each prefetch site is timed with a few candidate distances, for
+// trials_per_candidate executions of its loop each, and then keeps the
+// distance with the lowest total time.
+constexpr int num_candidates = 4;
+constexpr int trials_per_candidate = 4;
+constexpr int max_prefetch_sites = 64;
+
+struct PrefetchSite {
+    // Sites are identified by a hash of their name, as the names
+    // belong to the code of a pipeline that may be unloaded.
+    uint64_t hash;
+    int candidates[num_candidates];
+    int64_t elapsed[num_candidates];
+    int candidate, trials;
+    // Written by the tuner under the lock, read without it.
+    int distance;
+    bool tuned;
+};
+
+WEAK PrefetchSite prefetch_sites[max_prefetch_sites];
+WEAK int num_prefetch_sites = 0;
+WEAK ScopedSpinLock::AtomicFlag prefetch_sites_lock = 0;
+
+WEAK uint64_t prefetch_site_hash(const char *site) {
+    // FNV-1a
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (const char *c = site; *c; c++) {
+        h = (h ^ (uint8_t)*c) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// Sites are only ever appended, and an entry is filled in before the
+// count that makes it visible is published, so lookups need no lock.
+WEAK PrefetchSite *find_prefetch_site(uint64_t hash) {
+    int n = __atomic_load_n(&num_prefetch_sites, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < n; i++) {
+        if (prefetch_sites[i].hash == hash) {
+            return &prefetch_sites[i];
+        }
+    }
+    return nullptr;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+WEAK int halide_tuned_prefetch_distance(void *user_context, const char *site, int initial) {
+    uint64_t hash = prefetch_site_hash(site);
+    PrefetchSite *s = find_prefetch_site(hash);
+    if (s && __atomic_load_n(&s->tuned, __ATOMIC_ACQUIRE)) {
+        return s->distance;
+    }
+    if (initial <= 0) {
+        return initial;
+    }
+
+    ScopedSpinLock lock(&prefetch_sites_lock);
+    if (!s) {
+        s = find_prefetch_site(hash);
+    }
+    if (!s) {
+        if (num_prefetch_sites == max_prefetch_sites) {
+            // Out of room. Don't tune this site.
+            return initial;
+        }
+        s = &prefetch_sites[num_prefetch_sites];
+        s->hash = hash;
+        s->candidates[0] = initial;
+        s->candidates[1] = initial > 1 ? initial / 2 : 1;
+        s->candidates[2] = initial * 2;
+        s->candidates[3] = initial * 4;
+        for (int i = 0; i < num_candidates; i++) {
+            s->elapsed[i] = 0;
+        }
+        s->candidate = 0;
+        s->trials = 0;
+        s->distance = initial;
+        s->tuned = false;
+        __atomic_store_n(&num_prefetch_sites, num_prefetch_sites + 1, __ATOMIC_RELEASE);
+    }
+    if (s->tuned) {
+        return s->distance;
+    }
+    // The caller times its loop with halide_current_time_ns.
+    halide_start_clock(user_context);
+    // A negative distance asks the caller to report how long its loop took.
+    return -s->candidates[s->candidate];
+}
+
+WEAK int halide_tuned_prefetch_distance_report(void *user_context, const char *site,
+                                               int distance, int64_t elapsed_ns) {
+    uint64_t hash = prefetch_site_hash(site);
+    ScopedSpinLock lock(&prefetch_sites_lock);
+    PrefetchSite *s = find_prefetch_site(hash);
+    // Reports for a candidate other than the current one come from loops
+    // that started before another thread moved the tuning along.
+    if (!s || s->tuned || s->candidates[s->candidate] != distance) {
+        return halide_error_code_success;
+    }
+    s->elapsed[s->candidate] += elapsed_ns;
+    if (++s->trials < trials_per_candidate) {
+        return halide_error_code_success;
+    }
+    s->trials = 0;
+    if (++s->candidate < num_candidates) {
+        return halide_error_code_success;
+    }
+    int best = 0;
+    for (int i = 1; i < num_candidates; i++) {
+        if (s->elapsed[i] < s->elapsed[best]) {
+            best = i;
+        }
+    }
+    s->distance = s->candidates[best];
+    __atomic_store_n(&s->tuned, true, __ATOMIC_RELEASE);
+    debug(user_context) << "Prefetch distance for " << site << " tuned to " << s->distance << "\n";
+    return halide_error_code_success;
+}
+
+WEAK void halide_tuned_prefetch_distance_reset() {
+    ScopedSpinLock lock(&prefetch_sites_lock);
+    __atomic_store_n(&num_prefetch_sites, 0, __ATOMIC_RELEASE);
+}
+}
@@ -2,6 +2,10 @@
 #include "printer.h"
 #include "scoped_mutex_lock.h"
 
+#ifndef INSTRUMENTED_PROFILING
+#define INSTRUMENTED_PROFILING 0
+#endif
+
 // Note: The profiler thread may out-live any valid user_context, or
 // be used across many different user_contexts, so nothing it calls
 // can depend on the user context.
@@ -18,6 +22,19 @@ extern "C" void halide_start_timer_chain();
 extern "C" void halide_disable_timer_interrupt();
 extern "C" void halide_enable_timer_interrupt();
 #endif
+
+#if INSTRUMENTED_PROFILING
+#ifdef WINDOWS
+#ifdef BITS_64
+#define WIN32API
+#else
+#define WIN32API __stdcall
+#endif
+extern WIN32API unsigned long GetCurrentThreadId();
+#else
+extern uintptr_t pthread_self();
+#endif
+#endif
 }
 
 namespace Halide {
@@ -43,6 +60,31 @@ public:
     }
 };
 
+// When set, from HL_PROFILER_MEMORY_TIMELINE, heap allocations and
+// frees update the counters under profiler_memory_timeline_lock, and
+// each new peak of a pipeline's heap usage copies the current
+// allocation of each of its Funcs into memory_at_peak.
+WEAK bool profiler_memory_timeline = false;
+WEAK bool profiler_memory_timeline_initialized = false;
+WEAK halide_mutex profiler_memory_timeline_lock = {{0}};
+
+// Called with the profiler lock held.
+WEAK void init_memory_timeline() {
+    if (!profiler_memory_timeline_initialized) {
+        profiler_memory_timeline_initialized = true;
+        profiler_memory_timeline = getenv("HL_PROFILER_MEMORY_TIMELINE") != nullptr;
+    }
+}
+
+// Called with profiler_memory_timeline_lock held, when a pipeline's
+// heap usage has just reached a new peak.
+WEAK void snapshot_memory_peak(halide_profiler_pipeline_stats *p) {
+    p->memory_peak_time = halide_current_time_ns(nullptr);
+    for (int i = 0; i < p->num_funcs; i++) {
+        p->funcs[i].memory_at_peak = p->funcs[i].memory_current;
+    }
+}
+
 WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipeline_name, int num_funcs, const uint64_t *func_names) {
     halide_profiler_state *s = halide_profiler_get_state();
 
@@ -71,9 +113,13 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
     p->memory_current = 0;
     p->memory_peak = 0;
     p->memory_total = 0;
+    p->memory_peak_time = 0;
     p->num_allocs = 0;
     p->active_threads_numerator = 0;
     p->active_threads_denominator = 0;
+    p->branch_names = nullptr;
+    p->branch_counts = nullptr;
+    p->num_branches = 0;
     p->funcs = (halide_profiler_func_stats *)malloc(num_funcs * sizeof(halide_profiler_func_stats));
     if (!p->funcs) {
         free(p);
@@ -89,12 +135,229 @@ WEAK halide_profiler_pipeline_stats *find_or_create_pipeline(const char *pipelin
         p->funcs[i].stack_peak = 0;
         p->funcs[i].active_threads_numerator = 0;
         p->funcs[i].active_threads_denominator = 0;
+        p->funcs[i].num_produces = 0;
+        p->funcs[i].memory_at_peak = 0;
     }
     s->first_free_id += num_funcs;
     s->pipelines = p;
     return p;
 }
 
+#if INSTRUMENTED_PROFILING
+// One entry in the exported trace: a timed region, or a change in a
+// Func's heap usage.
+struct ProfilerTraceEvent {
+    uint64_t time, duration_or_bytes;
+    uint64_t thread;
+    const char *name;
+    int kind;  // A halide_profiler_region_kind_t, or one of the heap counters below
+};
+
+const static int profiler_trace_heap_counter = -1;
+const static int profiler_trace_pipeline_heap_counter = -2;
+
+WEAK ProfilerTraceEvent *profiler_trace_events = nullptr;
+WEAK uint32_t profiler_trace_capacity = 0;
+WEAK uint32_t profiler_trace_count = 0;
+WEAK void *profiler_trace_file = nullptr;
+WEAK bool profiler_trace_initialized = false;
+
+ALWAYS_INLINE uint64_t profiler_current_thread_id() {
+#ifdef WINDOWS
+    return GetCurrentThreadId();
+#else
+    return pthread_self();
+#endif
+}
+
+// Called with the profiler lock held. Opens the trace file if
+// HL_PROFILER_TRACE_FILE is set.
+WEAK void init_profiler_trace(void *user_context) {
+    if (profiler_trace_initialized) {
+        return;
+    }
+    profiler_trace_initialized = true;
+    const char *path = getenv("HL_PROFILER_TRACE_FILE");
+    if (!path) {
+        return;
+    }
+    const char *events = getenv("HL_PROFILER_TRACE_EVENTS");
+    uint32_t capacity = events ? atoi(events) : 0;
+    if (capacity == 0) {
+        capacity = 1 << 18;
+    }
+    profiler_trace_file = halide_fopen(path, "wb");
+    profiler_trace_events = (ProfilerTraceEvent *)malloc(capacity * sizeof(ProfilerTraceEvent));
+    if (!profiler_trace_file || !profiler_trace_events) {
+        error(user_context) << "Could not open profiler trace file " << path << "\n";
+        if (profiler_trace_file) {
+            fclose(profiler_trace_file);
+            profiler_trace_file = nullptr;
+        }
+        free(profiler_trace_events);
+        profiler_trace_events = nullptr;
+        return;
+    }
+    profiler_trace_capacity = capacity;
+    // The closing bracket is optional in the Chrome trace format, which
+    // lets events be appended at every report.
+    const char *header = "[\n";
+    write(fileno(profiler_trace_file), header, strlen(header));
+}
+
+ALWAYS_INLINE void record_trace_event(uint64_t time, uint64_t duration_or_bytes, const char *name, int kind) {
+    uint32_t idx = __sync_fetch_and_add(&profiler_trace_count, 1);
+    if (idx < profiler_trace_capacity) {
+        ProfilerTraceEvent &e = profiler_trace_events[idx];
+        e.time = time;
+        e.duration_or_bytes = duration_or_bytes;
+        e.thread = profiler_current_thread_id();
+        e.name = name;
+        e.kind = kind;
+    }
+}
+
+// Called with the profiler lock held, and no pipelines running.
+WEAK void write_profiler_trace(void *user_context) {
+    if (!profiler_trace_file) {
+        return;
+    }
+    const char *categories[] = {"", "produce", "task", "device", "copy", "pipeline"};
+    uint32_t count = profiler_trace_count;
+    uint32_t recorded = count < profiler_trace_capacity ? count : profiler_trace_capacity;
+    int fd = fileno(profiler_trace_file);
+    StringStreamPrinter<4096> sstr(user_context);
+    for (uint32_t i = 0; i < recorded; i++) {
+        const ProfilerTraceEvent &e = profiler_trace_events[i];
+        // Times are in microseconds.
+        sstr << "{\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << e.thread
+             << ",\"ts\":" << e.time / 1000.0;
+        if (e.kind == profiler_trace_heap_counter) {
+            sstr << ",\"ph\":\"C\",\"args\":{\"heap bytes\":" << e.duration_or_bytes << "}},\n";
+        } else if (e.kind == profiler_trace_pipeline_heap_counter) {
+            sstr << ",\"ph\":\"C\",\"args\":{\"pipeline heap bytes\":" << e.duration_or_bytes << "}},\n";
+        } else {
+            sstr << ",\"ph\":\"X\",\"cat\":\"" << categories[e.kind]
+                 << "\",\"dur\":" << e.duration_or_bytes / 1000.0 << "},\n";
+        }
+        if (sstr.size() > 3584 || i + 1 == recorded) {
+            write(fd, sstr.str(), sstr.size());
+            sstr.clear();
+        }
+    }
+    if (count > recorded) {
+        sstr << "Profiler trace dropped " << (uint64_t)(count - recorded)
+             << " events. Set HL_PROFILER_TRACE_EVENTS to record more between reports.\n";
+        halide_print(user_context, sstr.str());
+    }
+    profiler_trace_count = 0;
+}
+
+// Called with the profiler lock held, and no pipelines running. Marks
+// the peak heap usage of each pipeline with an instant event that
+// lists the Funcs holding heap memory at the time.
+WEAK void write_memory_peaks_to_trace(void *user_context, halide_profiler_state *s) {
+    if (!profiler_trace_file || !profiler_memory_timeline) {
+        return;
+    }
+    int fd = fileno(profiler_trace_file);
+    StringStreamPrinter<4096> sstr(user_context);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        if (!p->memory_peak) {
+            continue;
+        }
+        sstr.clear();
+        sstr << "{\"name\":\"peak heap\",\"ph\":\"i\",\"s\":\"p\",\"pid\":1,\"tid\":0,\"ts\":"
+             << p->memory_peak_time / 1000.0 << ",\"args\":{\"pipeline\":\"" << p->name
+             << "\",\"bytes\":" << p->memory_peak;
+        for (int i = 0; i < p->num_funcs; i++) {
+            const halide_profiler_func_stats *fs = p->funcs + i;
+            if (fs->memory_at_peak) {
+                sstr << ",\"" << fs->name << "\":" << fs->memory_at_peak;
+            }
+            if (sstr.size() > 3584) {
+                write(fd, sstr.str(), sstr.size());
+                sstr.clear();
+            }
+        }
+        sstr << "}},\n";
+        write(fd, sstr.str(), sstr.size());
+    }
+}
+
+WEAK void write_branch_profile(void *user_context, halide_profiler_state *s) {
+    const char *path = getenv("HL_PROFILER_BRANCH_FILE");
+    if (!path) {
+        return;
+    }
+    // Reports are usually followed by a reset, e.g. after every JIT
+    // realization, so append, and leave it to the reader to sum
+    // the counts.
+    void *f = halide_fopen(path, "ab");
+    if (!f) {
+        error(user_context) << "Could not open branch profile file " << path << "\n";
+        return;
+    }
+    int fd = fileno(f);
+    StringStreamPrinter<64> sstr(user_context);
+    for (halide_profiler_pipeline_stats *p = s->pipelines; p;
+         p = (halide_profiler_pipeline_stats *)(p->next)) {
+        for (int i = 0; i < p->num_branches; i++) {
+            if (!p->branch_counts[2 * i] && !p->branch_counts[2 * i + 1]) {
+                continue;
+            }
+            // Conditions can be longer than any fixed size printer, so
+            // only the counts go through one.
+            sstr.clear();
+            sstr << "\t" << p->branch_counts[2 * i] << "\t" << p->branch_counts[2 * i + 1] << "\n";
+            write(fd, p->name, strlen(p->name));
+            write(fd, "\t", 1);
+            write(fd, p->branch_names[i], strlen(p->branch_names[i]));
+            write(fd, sstr.str(), sstr.size());
+        }
+    }
+    fclose(f);
+}
+#endif
+
+// Print the Funcs holding heap memory at the peak heap usage of a
+// pipeline, and a suggestion for the one holding the most.
+WEAK void print_memory_peak(void *user_context, halide_profiler_pipeline_stats *p) {
+    StringStreamPrinter<1024> sstr(user_context);
+    halide_print(user_context, " live at peak heap usage:\n");
+    int largest = -1;
+    for (int i = 0; i < p->num_funcs; i++) {
+        const halide_profiler_func_stats *fs = p->funcs + i;
+        if (!fs->memory_at_peak) {
+            continue;
+        }
+        if (largest < 0 || fs->memory_at_peak > p->funcs[largest].memory_at_peak) {
+            largest = i;
+        }
+        sstr.clear();
+        sstr << "  " << fs->name << ": " << fs->memory_at_peak << " bytes ("
+             << (int)((100 * fs->memory_at_peak) / p->memory_peak) << "%)\n";
+        halide_print(user_context, sstr.str());
+    }
+    if (largest < 0) {
+        return;
+    }
+    // A Func allocated at most once per run is most likely computed
+    // or stored at root, and so holds all of itself until its last
+    // consumer is done with it.
+    const halide_profiler_func_stats *fs = p->funcs + largest;
+    sstr.clear();
+    if (fs->num_allocs <= p->runs) {
+        sstr << " to lower the peak, try compute_at or store_at of " << fs->name
+             << " inside a loop over its consumer, so that only a slice of it is live at once\n";
+    } else {
+        sstr << " to lower the peak, try moving the store_at of " << fs->name
+             << " to an inner loop of its consumer, so that each allocation of it is smaller\n";
+    }
+    halide_print(user_context, sstr.str());
+}
+
 WEAK void bill_func(halide_profiler_state *s, int func_id, uint64_t time, int active_threads) {
     halide_profiler_pipeline_stats *p_prev = nullptr;
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
@@ -217,11 +480,21 @@ WEAK int halide_profiler_pipeline_start(void *user_context,
 
     LockProfiler lock(s);
 
+    init_memory_timeline();
+#if INSTRUMENTED_PROFILING
+    init_profiler_trace(user_context);
+#endif
+
     if (!s->sampling_thread) {
 #if TIMER_PROFILING
         halide_start_clock(user_context);
         halide_start_timer_chain();
         s->sampling_thread = (halide_thread *)1;
+#elif INSTRUMENTED_PROFILING
+        // Funcs time themselves, so there is nothing to spawn. The
+        // non-null marker just tells shutdown there is a report to print.
+        halide_start_clock(user_context);
+        s->sampling_thread = (halide_thread *)1;
 #else
         halide_start_clock(user_context);
         s->sampling_thread = halide_spawn_thread(sampling_profiler_thread, nullptr);
@@ -282,6 +555,12 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     // current desctructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
+    const bool timeline = profiler_memory_timeline;
+    if (timeline) {
+        halide_mutex_lock(&profiler_memory_timeline_lock);
+    }
+    const uint64_t p_mem_peak = p_stats->memory_peak;
+
     // Update per-pipeline memory stats
     __sync_add_and_fetch(&p_stats->num_allocs, 1);
     __sync_add_and_fetch(&p_stats->memory_total, incr);
@@ -293,6 +572,23 @@ WEAK void halide_profiler_memory_allocate(void *user_context,
     __sync_add_and_fetch(&f_stats->memory_total, incr);
     uint64_t f_mem_current = __sync_add_and_fetch(&f_stats->memory_current, incr);
     sync_compare_max_and_swap(&f_stats->memory_peak, f_mem_current);
+
+    if (timeline) {
+        if (p_mem_current > p_mem_peak) {
+            snapshot_memory_peak(p_stats);
+        }
+        halide_mutex_unlock(&profiler_memory_timeline_lock);
+    }
+
+#if INSTRUMENTED_PROFILING
+    if (profiler_trace_events) {
+        uint64_t now = halide_current_time_ns(nullptr);
+        record_trace_event(now, f_mem_current, f_stats->name, profiler_trace_heap_counter);
+        if (timeline) {
+            record_trace_event(now, p_mem_current, p_stats->name, profiler_trace_pipeline_heap_counter);
+        }
+    }
+#endif
 }
 
 WEAK void halide_profiler_memory_free(void *user_context,
@@ -318,16 +614,134 @@ WEAK void halide_profiler_memory_free(void *user_context,
     // current destructor (called on profiler shutdown) does not free the structs
     // unless user specifically calls halide_profiler_reset().
 
+    const bool timeline = profiler_memory_timeline;
+    if (timeline) {
+        halide_mutex_lock(&profiler_memory_timeline_lock);
+    }
+
     // Update per-pipeline memory stats
-    __sync_sub_and_fetch(&p_stats->memory_current, decr);
+    uint64_t p_mem_current = __sync_sub_and_fetch(&p_stats->memory_current, decr);
 
     // Update per-func memory stats
-    __sync_sub_and_fetch(&f_stats->memory_current, decr);
+    uint64_t f_mem_current = __sync_sub_and_fetch(&f_stats->memory_current, decr);
+
+    if (timeline) {
+        halide_mutex_unlock(&profiler_memory_timeline_lock);
+    }
+
+#if INSTRUMENTED_PROFILING
+    if (profiler_trace_events) {
+        uint64_t now = halide_current_time_ns(nullptr);
+        record_trace_event(now, f_mem_current, f_stats->name, profiler_trace_heap_counter);
+        if (timeline) {
+            record_trace_event(now, p_mem_current, p_stats->name, profiler_trace_pipeline_heap_counter);
+        }
+    }
+#endif
+    (void)f_mem_current;
+    (void)p_mem_current;
+}
+
+#if INSTRUMENTED_PROFILING
+WEAK uint64_t halide_profiler_instrument_begin(uint64_t *child_time) {
+    *child_time = 0;
+    return halide_current_time_ns(nullptr);
+}
+
+WEAK int halide_profiler_instrument_end(void *pipeline_state,
+                                        int func_id,
+                                        uint64_t start,
+                                        const uint64_t *child_time,
+                                        uint64_t *parent_child_time,
+                                        int kind) {
+    uint64_t elapsed = halide_current_time_ns(nullptr) - start;
+
+    // Enclosing scopes on this thread only get billed for time not
+    // spent in here. The parent accumulator is private to the thread
+    // running the parent scope, so it needs no atomics.
+    if (parent_child_time) {
+        *parent_child_time += elapsed;
+    }
+
+    if (func_id < 0) {
+        return 0;
+    }
+
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *)pipeline_state;
+    halide_abort_if_false(nullptr, p_stats != nullptr);
+    halide_abort_if_false(nullptr, func_id < p_stats->num_funcs);
+
+    halide_profiler_func_stats *f_stats = &p_stats->funcs[func_id];
+    uint64_t self = elapsed > *child_time ? elapsed - *child_time : 0;
+
+    // As with the memory counters above, these are updated without
+    // grabbing the state's lock.
+    __sync_add_and_fetch(&f_stats->time, self);
+    __sync_add_and_fetch(&p_stats->time, self);
+    if (kind == halide_profiler_region_produce) {
+        __sync_add_and_fetch(&f_stats->num_produces, 1);
+    }
+
+    if (profiler_trace_events && kind != halide_profiler_region_none) {
+        const char *name = kind == halide_profiler_region_pipeline ? p_stats->name : f_stats->name;
+        record_trace_event(start, elapsed, name, kind);
+    }
+    return 0;
+}
+
+WEAK int halide_profiler_register_branches(void *pipeline_state,
+                                           int num_branches,
+                                           const uint64_t *branch_names) {
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *)pipeline_state;
+    halide_abort_if_false(nullptr, p_stats != nullptr);
+    if (p_stats->branch_counts) {
+        return 0;
+    }
+
+    halide_profiler_state *s = halide_profiler_get_state();
+    LockProfiler lock(s);
+    if (p_stats->branch_counts) {
+        // Another thread running the same pipeline got here first.
+        return 0;
+    }
+    // The names array itself belongs to the pipeline's run, so take a
+    // copy of the pointers.
+    const char **names = (const char **)malloc(num_branches * sizeof(const char *));
+    uint64_t *counts = (uint64_t *)malloc(2 * num_branches * sizeof(uint64_t));
+    if (!names || !counts) {
+        free(names);
+        free(counts);
+        return halide_error_out_of_memory(nullptr);
+    }
+    for (int i = 0; i < num_branches; i++) {
+        names[i] = (const char *)(branch_names[i]);
+        counts[2 * i] = counts[2 * i + 1] = 0;
+    }
+    p_stats->branch_names = names;
+    p_stats->num_branches = num_branches;
+    __atomic_store_n(&p_stats->branch_counts, counts, __ATOMIC_RELEASE);
+    return 0;
+}
+
+WEAK int halide_profiler_count_branch(void *pipeline_state, int branch, int taken) {
+    halide_profiler_pipeline_stats *p_stats = (halide_profiler_pipeline_stats *)pipeline_state;
+    uint64_t *counts = __atomic_load_n(&p_stats->branch_counts, __ATOMIC_ACQUIRE);
+    if (counts) {
+        __sync_add_and_fetch(&counts[2 * branch + (taken ? 0 : 1)], 1);
+    }
+    return 0;
 }
+#endif
 
 WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_state *s) {
     StringStreamPrinter<1024> sstr(user_context);
 
+#if INSTRUMENTED_PROFILING
+    write_profiler_trace(user_context);
+    write_memory_peaks_to_trace(user_context, s);
+    write_branch_profile(user_context, s);
+#endif
+
     for (halide_profiler_pipeline_stats *p = s->pipelines; p;
          p = (halide_profiler_pipeline_stats *)(p->next)) {
         float t = p->time / 1000000.0f;
@@ -338,8 +752,12 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
         bool serial = p->active_threads_numerator == p->active_threads_denominator;
         float threads = p->active_threads_numerator / (p->active_threads_denominator + 1e-10);
         sstr << p->name << "\n"
+#if INSTRUMENTED_PROFILING
+             << " total thread time: " << t << " ms"
+#else
              << " total time: " << t << " ms"
              << "  samples: " << p->samples
+#endif
              << "  runs: " << p->runs
              << "  time/run: " << t / p->runs << " ms\n";
         if (!serial) {
@@ -349,6 +767,10 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
              << "  peak heap usage: " << p->memory_peak << " bytes\n";
         halide_print(user_context, sstr.str());
 
+        if (profiler_memory_timeline && p->memory_peak) {
+            print_memory_peak(user_context, p);
+        }
+
         bool print_f_states = p->time || p->memory_total;
         if (!print_f_states) {
             for (int i = 0; i < p->num_funcs; i++) {
@@ -408,6 +830,14 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                     }
                 }
 
+                if (fs->num_produces) {
+                    sstr << "produces: " << fs->num_produces / p->runs;
+                    cursor += 20;
+                    while (sstr.size() < cursor) {
+                        sstr << " ";
+                    }
+                }
+
                 if (fs->memory_peak) {
                     cursor += 15;
                     sstr << " peak: " << fs->memory_peak;
@@ -433,6 +863,26 @@ WEAK void halide_profiler_report_unlocked(void *user_context, halide_profiler_st
                 halide_print(user_context, sstr.str());
             }
         }
+
+        for (int i = 0; i < p->num_branches; i++) {
+            uint64_t taken = p->branch_counts[2 * i];
+            uint64_t total = taken + p->branch_counts[2 * i + 1];
+            if (!total) {
+                continue;
+            }
+            sstr.clear();
+            sstr << "  branch in ";
+            for (const char *c = p->branch_names[i]; *c && sstr.size() < 900; c++) {
+                if (*c == '\t') {
+                    sstr << ": if (";
+                } else {
+                    char str[2] = {*c, 0};
+                    sstr << str;
+                }
+            }
+            sstr << "): taken " << (int)((100 * taken) / total) << "% of " << total << " times\n";
+            halide_print(user_context, sstr.str());
+        }
     }
 }
 
@@ -447,6 +897,8 @@ WEAK void halide_profiler_reset_unlocked(halide_profiler_state *s) {
         halide_profiler_pipeline_stats *p = s->pipelines;
         s->pipelines = (halide_profiler_pipeline_stats *)(p->next);
         free(p->funcs);
+        free(p->branch_names);
+        free(p->branch_counts);
         free(p);
     }
     s->first_free_id = 0;
@@ -473,7 +925,9 @@ halide_profiler_shutdown() {
     }
 
     s->current_func = halide_profiler_please_stop;
-#if TIMER_PROFILING
+#if INSTRUMENTED_PROFILING
+    s->sampling_thread = nullptr;
+#elif TIMER_PROFILING
     // Wait for timer interrupt to fire and notice things are shutdown.
     // volatile should be the right tool to use to wait for storage to be
     // modified in a signal handler.
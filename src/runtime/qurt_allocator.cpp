@@ -100,6 +100,11 @@ WEAK halide_free_t custom_free = halide_default_free;
 
 extern "C" {
 
+WEAK size_t halide_set_large_allocation_threshold(size_t bytes) {
+    // Large allocations always come from the heap on Hexagon.
+    return 0;
+}
+
 WEAK halide_malloc_t halide_set_custom_malloc(halide_malloc_t user_malloc) {
     // See TODO below.
     halide_print(nullptr, "custom allocators not supported on Hexagon.\n");
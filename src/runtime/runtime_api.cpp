@@ -9,6 +9,7 @@
 #include "HalideRuntimeOpenCL.h"
 #include "HalideRuntimeOpenGLCompute.h"
 #include "HalideRuntimeQurt.h"
+#include "HalideRuntimeVulkan.h"
 #include "cpu_features.h"
 
 // This runtime module will contain extern declarations of the Halide
@@ -21,24 +22,45 @@
 extern "C" void halide_unused_force_include_types();
 
 extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
+    (void *)&halide_arena_begin,
+    (void *)&halide_arena_end,
+    (void *)&halide_arena_free,
+    (void *)&halide_arena_malloc,
+    (void *)&halide_arena_release_unused,
+    (void *)&halide_async_call_detach,
+    (void *)&halide_async_call_finished,
+    (void *)&halide_async_call_wait,
     (void *)&halide_buffer_copy,
+    (void *)&halide_buffer_set_device_dirty_region,
+    (void *)&halide_buffer_set_host_dirty_region,
     (void *)&halide_buffer_to_string,
+    (void *)&halide_call_async,
     (void *)&halide_can_use_target_features,
     (void *)&halide_cond_broadcast,
     (void *)&halide_cond_signal,
     (void *)&halide_cond_wait,
     (void *)&halide_copy_to_device,
     (void *)&halide_copy_to_host,
+    (void *)&halide_create_thread_pool,
     (void *)&halide_cuda_detach_device_ptr,
     (void *)&halide_cuda_device_interface,
     (void *)&halide_cuda_get_device_ptr,
+    (void *)&halide_cuda_graph_begin,
+    (void *)&halide_cuda_graph_end,
     (void *)&halide_cuda_initialize_kernels,
     (void *)&halide_cuda_finalize_kernels,
     (void *)&halide_cuda_run,
+    (void *)&halide_cuda_stream_pool_get_stream,
+    (void *)&halide_cuda_stream_pool_release,
     (void *)&halide_cuda_wrap_device_ptr,
     (void *)&halide_current_time_ns,
     (void *)&halide_debug_to_file,
+    (void *)&halide_debug_to_file_flush,
+    (void *)&halide_debug_to_file_set_async,
+    (void *)&halide_debug_to_file_set_sampling,
     (void *)&halide_default_can_use_target_features,
+    (void *)&halide_default_get_thread_pool,
+    (void *)&halide_destroy_thread_pool,
     (void *)&halide_device_and_host_free,
     (void *)&halide_device_and_host_free_as_destructor,
     (void *)&halide_device_and_host_malloc,
@@ -46,9 +68,16 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_device_free_as_destructor,
     (void *)&halide_device_host_nop_free,
     (void *)&halide_device_malloc,
+    (void *)&halide_device_memory_pool_get_limit,
+    (void *)&halide_device_memory_pool_get_stats,
+    (void *)&halide_device_memory_pool_set_limit,
+    (void *)&halide_device_memory_pool_trim,
     (void *)&halide_device_release,
     (void *)&halide_device_sync,
     (void *)&halide_disable_timer_interrupt,
+    (void *)&halide_distributed_exchange,
+    (void *)&halide_distributed_num_ranks,
+    (void *)&halide_distributed_rank,
     (void *)&halide_do_par_for,
     (void *)&halide_do_parallel_tasks,
     (void *)&halide_do_task,
@@ -66,6 +95,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_error_buffer_argument_is_null,
     (void *)&halide_error_buffer_extents_negative,
     (void *)&halide_error_buffer_extents_too_large,
+    (void *)&halide_error_buffers_overlap,
     (void *)&halide_error_constraint_violated,
     (void *)&halide_error_constraints_make_required_region_smaller,
     (void *)&halide_error_debug_to_file_failed,
@@ -86,14 +116,18 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_error_unaligned_host_ptr,
     (void *)&halide_error_storage_bound_too_small,
     (void *)&halide_error_device_crop_failed,
+    (void *)&halide_find_thread_pool,
     (void *)&halide_float16_bits_to_double,
     (void *)&halide_float16_bits_to_float,
     (void *)&halide_free,
     (void *)&halide_get_cpu_features,
     (void *)&halide_get_gpu_device,
+    (void *)&halide_get_gpu_kernel_cache_dir,
     (void *)&halide_get_library_symbol,
     (void *)&halide_get_symbol,
+    (void *)&halide_get_thread_pool,
     (void *)&halide_get_trace_file,
+    (void *)&halide_gpu_device_user_context,
     (void *)&halide_hexagon_detach_device_handle,
     (void *)&halide_hexagon_device_interface,
     (void *)&halide_hexagon_device_release,
@@ -115,10 +149,15 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_load_library,
     (void *)&halide_malloc,
     (void *)&halide_memoization_cache_cleanup,
+    (void *)&halide_memoization_cache_device_free,
+    (void *)&halide_memoization_cache_device_free_as_destructor,
     (void *)&halide_memoization_cache_evict,
     (void *)&halide_memoization_cache_lookup,
     (void *)&halide_memoization_cache_release,
+    (void *)&halide_memoization_cache_set_device_size,
+    (void *)&halide_memoization_cache_set_shared_region,
     (void *)&halide_memoization_cache_set_size,
+    (void *)&halide_memoization_cache_stats,
     (void *)&halide_memoization_cache_store,
     (void *)&halide_metal_acquire_context,
     (void *)&halide_metal_detach_buffer,
@@ -146,6 +185,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_get_cl_mem,
     (void *)&halide_opencl_get_build_options,
     (void *)&halide_opencl_get_device_type,
+    (void *)&halide_opencl_get_out_of_order_queue,
     (void *)&halide_opencl_get_platform_name,
     (void *)&halide_opencl_get_crop_offset,
     (void *)&halide_opencl_image_device_interface,
@@ -155,6 +195,7 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_opencl_run,
     (void *)&halide_opencl_set_build_options,
     (void *)&halide_opencl_set_device_type,
+    (void *)&halide_opencl_set_out_of_order_queue,
     (void *)&halide_opencl_set_platform_name,
     (void *)&halide_opencl_wrap_cl_mem,
     (void *)&halide_opengl_create_context,
@@ -176,24 +217,37 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_qurt_hvx_lock,
     (void *)&halide_qurt_hvx_unlock,
     (void *)&halide_qurt_hvx_unlock_as_destructor,
+    (void *)&halide_register_multitarget_dispatch,
     (void *)&halide_release_jit_module,
+    (void *)&halide_reset_multitarget_dispatch,
     (void *)&halide_semaphore_init,
     (void *)&halide_semaphore_release,
     (void *)&halide_semaphore_try_acquire,
+    (void *)&halide_set_custom_arena,
     (void *)&halide_set_custom_can_use_target_features,
+    (void *)&halide_set_custom_distributed_runtime,
     (void *)&halide_set_custom_do_par_for,
     (void *)&halide_set_custom_do_loop_task,
     (void *)&halide_set_custom_do_task,
     (void *)&halide_set_custom_free,
     (void *)&halide_set_custom_get_library_symbol,
     (void *)&halide_set_custom_get_symbol,
+    (void *)&halide_set_custom_get_thread_pool,
     (void *)&halide_set_custom_load_library,
     (void *)&halide_set_custom_malloc,
     (void *)&halide_set_custom_print,
     (void *)&halide_set_custom_trace,
     (void *)&halide_set_error_handler,
     (void *)&halide_set_gpu_device,
+    (void *)&halide_set_gpu_kernel_cache_dir,
+    (void *)&halide_set_large_allocation_threshold,
+    (void *)&halide_set_numa_aware,
     (void *)&halide_set_num_threads,
+    (void *)&halide_set_thread_pool_guided_scheduling,
+    (void *)&halide_set_thread_pool_hot_period,
+    (void *)&halide_set_thread_pool_num_threads,
+    (void *)&halide_set_thread_pool_timing,
+    (void *)&halide_set_thread_pool_work_stealing,
     (void *)&halide_set_trace_file,
     (void *)&halide_shutdown_thread_pool,
     (void *)&halide_shutdown_trace,
@@ -202,10 +256,23 @@ extern "C" __attribute__((used)) void *halide_runtime_api_functions[] = {
     (void *)&halide_start_clock,
     (void *)&halide_start_timer_chain,
     (void *)&halide_string_to_string,
+    (void *)&halide_thread_pool_get_stats,
     (void *)&halide_trace,
     (void *)&halide_trace_helper,
+    (void *)&halide_tuned_prefetch_distance,
+    (void *)&halide_tuned_prefetch_distance_report,
+    (void *)&halide_tuned_prefetch_distance_reset,
     (void *)&halide_uint64_to_string,
     (void *)&halide_use_jit_module,
+    (void *)&halide_vulkan_acquire_context,
+    (void *)&halide_vulkan_detach_vk_buffer,
+    (void *)&halide_vulkan_device_interface,
+    (void *)&halide_vulkan_get_vk_buffer,
+    (void *)&halide_vulkan_initialize_kernels,
+    (void *)&halide_vulkan_finalize_kernels,
+    (void *)&halide_vulkan_release_context,
+    (void *)&halide_vulkan_run,
+    (void *)&halide_vulkan_wrap_vk_buffer,
     (void *)&halide_d3d12compute_acquire_context,
     (void *)&halide_d3d12compute_device_interface,
     (void *)&halide_d3d12compute_initialize_kernels,
@@ -114,9 +114,11 @@ WEAK_INLINE void *halide_fopen(const char *filename, const char *type);
 int fileno(void *);
 int fclose(void *);
 int close(int);
+size_t fread(void *, size_t, size_t, void *);
 size_t fwrite(const void *, size_t, size_t, void *);
 ssize_t write(int fd, const void *buf, size_t bytes);
 int remove(const char *pathname);
+int rename(const char *oldpath, const char *newpath);
 int ioctl(int fd, unsigned long request, ...);
 char *strncpy(char *dst, const char *src, size_t n);
 void abort();
@@ -192,6 +194,19 @@ struct halide_pseudostack_slot_t {
     size_t cumulative_size;
 };
 
+// Per-worker buffers for the heap allocations in a parallel loop body,
+// used by pipelines compiled with the cache_parallel_allocations
+// feature. A cache is created before the loop and destroyed after it.
+// Each iteration acquires a slot, which no other iteration uses until
+// it is released, and gets its buffers from it. A slot's buffers grow
+// to the largest size requested of them and are reused by later
+// iterations.
+WEAK void *halide_parallel_cache_create(void *user_context, int num_buffers);
+WEAK void halide_parallel_cache_destroy(void *user_context, void *cache);
+WEAK void *halide_parallel_cache_acquire(void *user_context, void *cache);
+WEAK int halide_parallel_cache_release(void *user_context, void *cache, void *slot);
+WEAK void *halide_parallel_cache_get(void *user_context, void *slot, int index, uint64_t size);
+
 WEAK void halide_use_jit_module();
 WEAK void halide_release_jit_module();
 
@@ -199,6 +214,26 @@ WEAK_INLINE int halide_malloc_alignment();
 
 void halide_thread_yield();
 
+// Support for NUMA-aware mode. On platforms without NUMA support these
+// report no nodes and fail to pin or allocate.
+WEAK bool halide_numa_aware();
+// Fill in the node of each cpu (or -1 if unknown) and return the
+// number of nodes, or zero if the topology is unknown.
+WEAK int halide_host_numa_cpus(int *cpu_nodes, int max_cpus);
+// Returns zero on success.
+WEAK int halide_pin_current_thread_to_cpu(int cpu);
+// Apply a nice value to the calling thread. Returns zero on success.
+WEAK int halide_set_current_thread_priority(int priority);
+// Allocate fresh pages that will be placed on the node of the thread
+// that first touches them. Returns nullptr on failure. Must be freed
+// with halide_large_free using the same size.
+WEAK void *halide_numa_local_alloc(void *user_context, size_t size);
+// Map a large region, backed by huge pages where possible, and
+// possibly recycled from one recently freed. Sets *mapped_size to the
+// size to pass to halide_large_free. Returns nullptr on failure.
+WEAK void *halide_large_alloc(void *user_context, size_t size, size_t *mapped_size);
+WEAK void halide_large_free(void *user_context, void *ptr, size_t size);
+
 }  // extern "C"
 
 namespace {
@@ -227,20 +227,56 @@ ALWAYS_INLINE void atomic_thread_fence_acquire() {
 
 }  // namespace
 
+// How many times a thread spins before parking is learned from how
+// many times recent acquisitions of a mutex spun, in the same way as
+// glibc's adaptive mutexes: spin for up to twice the recent average
+// plus a little, and move the average an eighth of the way towards
+// each new sample. The initial average gives the customary 40
+// spins. The average is shared by all mutexes, and updated without
+// synchronization, because a lost update only makes it a little
+// stale.
+WEAK int spin_average = 15;
+constexpr int max_spin_limit = 100;
+
+// Nonzero when there are more threads than cores, as counted by the
+// thread pool. Spinning then only takes time away from the thread
+// that holds the lock, so threads park straight away.
+WEAK int spin_oversubscribed = 0;
+
 class spin_control {
-    // Everyone says this should be 40. Have not measured it.
-    int spin_count = 40;
+    int spin_limit;
+    int spin_count;
 
 public:
+    ALWAYS_INLINE spin_control() {
+        reset();
+    }
+
     ALWAYS_INLINE bool should_spin() {
-        if (spin_count > 0) {
-            spin_count--;
+        if (spin_count < spin_limit) {
+            spin_count++;
         }
-        return spin_count > 0;
+        return spin_count < spin_limit;
     }
 
     ALWAYS_INLINE void reset() {
-        spin_count = 40;
+        int average, oversubscribed;
+        atomic_load_relaxed(&spin_average, &average);
+        atomic_load_relaxed(&spin_oversubscribed, &oversubscribed);
+        spin_limit = oversubscribed ? 0 : min(max_spin_limit, average * 2 + 10);
+        spin_count = 0;
+    }
+
+    // Record how many times this thread spun, once it has either
+    // acquired the lock or given up and parked.
+    ALWAYS_INLINE void record() {
+        if (spin_limit == 0) {
+            return;
+        }
+        int average;
+        atomic_load_relaxed(&spin_average, &average);
+        average += (spin_count - average) / 8;
+        atomic_store_release(&spin_average, &average);
     }
 };
 
@@ -761,7 +797,6 @@ class fast_mutex {
     uintptr_t state = 0;
 
     ALWAYS_INLINE void lock_full() {
-        // Everyone says this should be 40. Have not measured it.
         spin_control spinner;
         uintptr_t expected;
         atomic_load_relaxed(&state, &expected);
@@ -770,6 +805,7 @@ class fast_mutex {
             if (!(expected & lock_bit)) {
                 uintptr_t desired = expected | lock_bit;
                 if (atomic_cas_weak_acquire_relaxed(&state, &expected, &desired)) {
+                    spinner.record();
                     return;
                 }
                 continue;
@@ -793,6 +829,7 @@ class fast_mutex {
             }
 
             // TODO: consider handling fairness, timeout
+            spinner.record();
             mutex_parking_control control(&state);
             uintptr_t result = control.park((uintptr_t)this);
             if (result == (uintptr_t)this) {
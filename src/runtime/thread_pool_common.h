@@ -50,6 +50,46 @@ struct work {
     // which condition variable is the owner sleeping on. nullptr if it isn't sleeping.
     bool owner_is_sleeping;
 
+    // In work-stealing mode, the iterations of a stealable job are
+    // split into one contiguous range per participating thread. Each
+    // range is packed as (begin << 32 | end), relative to task.min, so
+    // that it can be claimed from the front by the thread that owns it
+    // and stolen from the back by other threads with a single
+    // compare-and-swap. nullptr if this job uses the shared job stack
+    // for every iteration.
+    uint64_t *ranges;
+    int num_ranges;
+    // The next range not yet owned by any thread. Protected by the work queue mutex.
+    int next_range;
+    // In NUMA-aware mode, range i belongs to worker thread i, and the
+    // last range belongs to the owner of the job, so that each socket
+    // gets a contiguous block of the iterations, and the same block
+    // each time a given loop runs.
+    bool ranges_by_thread_index;
+
+    // In guided mode, the iterations of a stealable job are instead
+    // claimed from the front in chunks with an atomic fetch-add on
+    // guided_next, relative to task.min. Each chunk is a fraction of
+    // the iterations that remain, so chunks start large and shrink
+    // geometrically, which keeps the number of claims small while
+    // still balancing iterations of uneven cost at the end.
+    // guided_extent is the total number of iterations, and
+    // guided_threads the number of threads that may share them.
+    bool guided;
+    int guided_next;
+    int guided_extent;
+    int guided_threads;
+
+    // The call that this job runs, if it was made by
+    // halide_call_async. Such a job has no owner waiting for it, so
+    // the last worker to leave it finishes the call.
+    struct async_call *async;
+
+    // When the job last failed to acquire its semaphores, if it is
+    // still waiting for them and times are measured. Protected by the
+    // work queue mutex.
+    int64_t blocked_since;
+
     ALWAYS_INLINE bool make_runnable() {
         for (; next_semaphore < task.num_semaphores; next_semaphore++) {
             if (!halide_default_semaphore_try_acquire(task.semaphores[next_semaphore].semaphore,
@@ -69,8 +109,95 @@ struct work {
     ALWAYS_INLINE bool running() const {
         return task.extent || active_workers;
     }
+
+    // Whether the iterations of this job are independent enough to be
+    // handed out through per-thread ranges instead of the job stack.
+    ALWAYS_INLINE bool stealable() const {
+        return !task.serial && task.num_semaphores == 0 && task.min_threads == 0;
+    }
 };
 
+// A pipeline call queued by halide_call_async.
+struct async_call {
+    work job;
+    halide_async_fn_t fn;
+    void *arg;
+    halide_async_callback_t done;
+    int result;
+    // Set by halide_async_call_detach, after which the call is freed
+    // as soon as it finishes.
+    bool detached;
+};
+
+ALWAYS_INLINE uint64_t pack_range(uint32_t begin, uint32_t end) {
+    return ((uint64_t)begin << 32) | end;
+}
+
+ALWAYS_INLINE uint32_t range_begin(uint64_t r) {
+    return (uint32_t)(r >> 32);
+}
+
+ALWAYS_INLINE uint32_t range_end(uint64_t r) {
+    return (uint32_t)r;
+}
+
+// Claim the first iteration of a range. Only the thread that owns the
+// range claims from the front.
+ALWAYS_INLINE bool pop_range_front(uint64_t *range, int *idx) {
+    uint64_t expected;
+    Synchronization::atomic_load_acquire(range, &expected);
+    while (range_begin(expected) < range_end(expected)) {
+        uint64_t desired = pack_range(range_begin(expected) + 1, range_end(expected));
+        if (Synchronization::atomic_cas_weak_relacq_relaxed(range, &expected, &desired)) {
+            *idx = (int)range_begin(expected);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Steal the back half of a range. Returns the stolen iterations in
+// [*begin, *end).
+ALWAYS_INLINE bool steal_range_back(uint64_t *range, uint32_t *begin, uint32_t *end) {
+    uint64_t expected;
+    Synchronization::atomic_load_acquire(range, &expected);
+    while (range_begin(expected) < range_end(expected)) {
+        uint32_t size = range_end(expected) - range_begin(expected);
+        uint32_t new_end = range_end(expected) - (size + 1) / 2;
+        uint64_t desired = pack_range(range_begin(expected), new_end);
+        if (Synchronization::atomic_cas_weak_relacq_relaxed(range, &expected, &desired)) {
+            *begin = new_end;
+            *end = range_end(expected);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Claim the next chunk of iterations of a job in guided mode, in
+// [*begin, *end).
+ALWAYS_INLINE bool claim_guided_chunk(work *job, int *begin, int *end) {
+    int next;
+    Synchronization::atomic_load_relaxed(&job->guided_next, &next);
+    int remaining = job->guided_extent - next;
+    if (remaining <= 0) {
+        return false;
+    }
+    // Other threads may claim iterations between the load and the
+    // add, which only makes this chunk a little larger than intended.
+    int chunk = remaining / (2 * job->guided_threads);
+    if (chunk < 1) {
+        chunk = 1;
+    }
+    int b = Synchronization::atomic_fetch_add_acquire_release(&job->guided_next, chunk);
+    if (b >= job->guided_extent) {
+        return false;
+    }
+    *begin = b;
+    *end = b + chunk < job->guided_extent ? b + chunk : job->guided_extent;
+    return true;
+}
+
 ALWAYS_INLINE int clamp_num_threads(int threads) {
     if (threads > MAX_THREADS) {
         return MAX_THREADS;
@@ -92,14 +219,79 @@ WEAK int default_desired_num_threads() {
                halide_host_cpu_count();
 }
 
-// The work queue and thread pool is weak, so one big work queue is shared by all halide functions
+WEAK bool default_work_stealing() {
+    char *stealing_str = getenv("HL_THREAD_POOL_WORK_STEALING");
+    return stealing_str && atoi(stealing_str) != 0;
+}
+
+WEAK int default_hot_period_us() {
+    char *hot_str = getenv("HL_THREAD_POOL_HOT_PERIOD_US");
+    return hot_str ? max(atoi(hot_str), 0) : 0;
+}
+
+WEAK bool default_timing() {
+    char *timing_str = getenv("HL_THREAD_POOL_TIMING");
+    return timing_str && atoi(timing_str) != 0;
+}
+
+WEAK bool default_guided_scheduling() {
+    char *guided_str = getenv("HL_THREAD_POOL_GUIDED");
+    return guided_str && atoi(guided_str) != 0;
+}
+
+struct work_queue_t;
+
+// What a worker thread is told when it is spawned.
+struct worker_thread_arg {
+    work_queue_t *queue;
+    // The index of the thread in queue->threads.
+    int thread_index;
+};
+
+// The default work queue and thread pool is weak, so one big work
+// queue is shared by all halide functions. More can be created with
+// halide_create_thread_pool; each has its own workers and lock.
 struct work_queue_t {
     // all fields are protected by this mutex.
     halide_mutex mutex;
 
+    // The name given to halide_create_thread_pool, and the next
+    // pool created by it. Protected by thread_pools_lock rather than
+    // the mutex.
+    char name[64];
+    work_queue_t *next_pool;
+
+    // The nice value given to the worker threads when they are
+    // spawned, or zero to leave it alone.
+    int priority;
+
     // The desired number threads doing work (HL_NUM_THREADS).
     int desired_threads_working;
 
+    // Whether stealable jobs hand out their iterations through
+    // per-thread ranges (HL_THREAD_POOL_WORK_STEALING). Zero means
+    // not yet decided, one means off, two means on.
+    int work_stealing;
+
+    // Whether stealable jobs hand out their iterations in shrinking
+    // chunks claimed without the lock (HL_THREAD_POOL_GUIDED). Takes
+    // precedence over work stealing, but not over NUMA-aware mode.
+    // Zero means not yet decided, one means off, two means on.
+    int guided_scheduling;
+
+    // How long in microseconds worker threads busy-wait for more work
+    // after finishing a job, before going to sleep
+    // (HL_THREAD_POOL_HOT_PERIOD_US), plus one. This saves the wakeup
+    // latency between back-to-back parallel loops, at the cost of
+    // burning cpu time between them. Zero means not yet decided.
+    int hot_period_us;
+
+    // Whether the times in stats are measured
+    // (HL_THREAD_POOL_TIMING). This costs a clock read each time a
+    // thread joins a job, spins or sleeps. Zero means not yet
+    // decided, one means off, two means on.
+    int timing;
+
     // All fields after this must be zero in the initial state. See assert_zeroed
     // Field serves both to mark the offset in struct and as layout padding.
     int zero_marker;
@@ -129,6 +321,14 @@ struct work_queue_t {
 
     // Keep track of threads so they can be joined at shutdown
     halide_thread *threads[MAX_THREADS];
+    worker_thread_arg thread_args[MAX_THREADS];
+
+    // In NUMA-aware mode, the cpu each worker thread is pinned to,
+    // ordered so that consecutive workers are on the same node
+    // wherever possible. num_worker_cpus is zero if the topology is
+    // unknown, in which case workers are not pinned.
+    int worker_cpus[MAX_THREADS];
+    int num_worker_cpus;
 
     // Global flags indicating the threadpool should shut down, and
     // whether the thread pool has been initialized.
@@ -140,13 +340,23 @@ struct work_queue_t {
     // to prevent deadlock due to oversubscription of threads.
     int threads_reserved;
 
+    // The number of threads currently running iterations of some
+    // job. Only changed while locked, but read without the lock by the
+    // fork-join fast path for nested parallel loops.
+    int threads_busy;
+
+    // Counters reported by halide_thread_pool_get_stats. Updated with
+    // atomic adds, usually once per job a thread joins rather than
+    // once per iteration.
+    halide_thread_pool_stats_t stats;
+
     ALWAYS_INLINE bool running() const {
         return !shutdown;
     }
 
     // Used to check initial state is correct.
     ALWAYS_INLINE void assert_zeroed() const {
-        // Assert that all fields except the mutex and desired threads count are zeroed.
+        // Assert that all fields except the mutex, name, priority, desired threads count and scheduling modes are zeroed.
         const char *bytes = ((const char *)&this->zero_marker);
         const char *limit = ((const char *)this) + sizeof(work_queue_t);
         while (bytes < limit && *bytes == 0) {
@@ -158,14 +368,56 @@ struct work_queue_t {
     // Return the work queue to initial state. Must be called while locked
     // and queue will remain locked.
     ALWAYS_INLINE void reset() {
-        // Ensure all fields except the mutex and desired hreads count are zeroed.
+        // Ensure all fields except the mutex, name, priority, desired threads count and scheduling modes are zeroed.
         char *bytes = ((char *)&this->zero_marker);
         char *limit = ((char *)this) + sizeof(work_queue_t);
         memset(bytes, 0, limit - bytes);
     }
 };
 
-WEAK work_queue_t work_queue = {};
+WEAK work_queue_t default_work_queue = {};
+
+// The number of worker threads in all pools.
+WEAK int total_worker_threads = 0;
+
+// Tell the mutexes whether there are more threads than cores, after
+// delta worker threads have been spawned or joined.
+WEAK void update_oversubscription(int delta) {
+    int threads = Synchronization::atomic_fetch_add_acquire_release(&total_worker_threads, delta) + delta;
+    // The + 1 is for the thread that calls into the thread pool.
+    int oversubscribed = threads + 1 > halide_host_cpu_count();
+    Synchronization::atomic_store_release(&Synchronization::spin_oversubscribed, &oversubscribed);
+}
+
+// The pools made by halide_create_thread_pool, most recent first.
+WEAK work_queue_t *thread_pools = nullptr;
+WEAK halide_mutex thread_pools_lock = {};
+
+WEAK halide_get_thread_pool_t custom_get_thread_pool = halide_default_get_thread_pool;
+
+// The work queue that parallel work for the given user_context goes on.
+ALWAYS_INLINE work_queue_t &work_queue_for(void *user_context) {
+    work_queue_t *q = (work_queue_t *)halide_get_thread_pool(user_context);
+    return q ? *q : default_work_queue;
+}
+
+ALWAYS_INLINE void count_stat(uint64_t *counter, uint64_t n) {
+    if (n) {
+        Synchronization::atomic_fetch_add_acquire_release(counter, n);
+    }
+}
+
+// The current time if the work queue is measuring times, or zero.
+ALWAYS_INLINE int64_t stats_time(work_queue_t &work_queue) {
+    return work_queue.timing == 2 ? halide_current_time_ns(nullptr) : 0;
+}
+
+// Add the time since start to a counter, if it was measured.
+ALWAYS_INLINE void count_time_since(work_queue_t &work_queue, uint64_t *counter, int64_t start) {
+    if (start) {
+        count_stat(counter, halide_current_time_ns(nullptr) - start);
+    }
+}
 
 #if EXTENDED_DEBUG
 
@@ -181,7 +433,7 @@ WEAK void print_job(work *job, const char *indent, const char *prefix = nullptr)
     }
 }
 
-WEAK void dump_job_state() {
+WEAK void dump_job_state(work_queue_t &work_queue) {
     log_message("Dumping job state, jobs in queue:");
     work *job = work_queue.jobs;
     while (job != nullptr) {
@@ -195,16 +447,224 @@ WEAK void dump_job_state() {
 
 // clang-format off
 #define print_job(job, indent, prefix)  do { /*nothing*/ } while (0)
-#define dump_job_state()                do { /*nothing*/ } while (0)
+#define dump_job_state(work_queue)      do { /*nothing*/ } while (0)
 // clang-format on
 
 #endif
 
 WEAK void worker_thread(void *);
 
-WEAK void worker_thread_already_locked(work *owned_job) {
+// Remove a job from the job stack, if it is still on it. Must be called while locked.
+WEAK void unlink_job_already_locked(work_queue_t &work_queue, work *job) {
+    work **prev_ptr = &work_queue.jobs;
+    while (*prev_ptr && *prev_ptr != job) {
+        prev_ptr = &(*prev_ptr)->next_job;
+    }
+    if (*prev_ptr) {
+        *prev_ptr = job->next_job;
+    }
+}
+
+// Split the iterations of a stealable job into num_ranges contiguous
+// ranges. Must be called while locked, before any worker has joined
+// the job.
+WEAK void init_job_ranges_already_locked(work_queue_t &work_queue, work *job, uint64_t *ranges, int num_ranges) {
+    job->ranges_by_thread_index = work_queue.num_worker_cpus > 0;
+    uint32_t extent = (uint32_t)job->task.extent;
+    for (int i = 0; i < num_ranges; i++) {
+        uint32_t begin = (uint32_t)(((uint64_t)extent * i) / num_ranges);
+        uint32_t end = (uint32_t)(((uint64_t)extent * (i + 1)) / num_ranges);
+        ranges[i] = pack_range(begin, end);
+    }
+    job->ranges = ranges;
+    job->num_ranges = num_ranges;
+    job->next_range = 0;
+}
+
+ALWAYS_INLINE int run_job_iteration(work *job, int idx) {
+    if (job->task_fn) {
+        return halide_do_task(job->user_context, job->task_fn,
+                              job->task.min + idx, job->task.closure);
+    } else {
+        return halide_do_loop_task(job->user_context, job->task.fn,
+                                   job->task.min + idx, 1,
+                                   job->task.closure, job);
+    }
+}
+
+// Set up a stealable job to be claimed in guided chunks. Must be
+// called while locked, before any worker has joined the job.
+WEAK void init_job_guided_already_locked(work_queue_t &work_queue, work *job) {
+    job->guided = true;
+    job->guided_next = 0;
+    job->guided_extent = job->task.extent;
+    job->guided_threads = work_queue.threads_created + 1;
+}
+
+// Work on a job in guided mode until every iteration is claimed or an
+// iteration fails. Called without the lock held.
+WEAK int run_guided_job(work_queue_t &work_queue, work *job) {
+    int result = 0;
+    int begin, end;
+    uint64_t chunks = 0, tasks = 0;
+    while (result == 0 && claim_guided_chunk(job, &begin, &end)) {
+        chunks++;
+        tasks += job->task_fn ? end - begin : 1;
+        if (job->task_fn) {
+            for (int i = begin; i < end && result == 0; i++) {
+                result = halide_do_task(job->user_context, job->task_fn,
+                                        job->task.min + i, job->task.closure);
+            }
+        } else {
+            result = halide_do_loop_task(job->user_context, job->task.fn,
+                                         job->task.min + begin, end - begin,
+                                         job->task.closure, job);
+        }
+    }
+    if (result != 0) {
+        // Claim everything that is left, so that other threads stop
+        // picking up iterations of this job.
+        Synchronization::atomic_store_release(&job->guided_next, &job->guided_extent);
+    }
+    count_stat(&work_queue.stats.guided_chunks, chunks);
+    count_stat(&work_queue.stats.tasks_executed, tasks);
+    return result;
+}
+
+// Work on a job with per-thread ranges until every range is empty or
+// an iteration fails. Called without the lock held. my_range is the
+// index of the range owned by this thread, or -1 if all ranges were
+// already owned when this thread joined, in which case stolen
+// iterations are run directly.
+WEAK int run_stealing_job(work_queue_t &work_queue, work *job, int my_range) {
+    int result = 0;
+    int victim = my_range < 0 ? 0 : my_range;
+    uint64_t steals = 0, tasks = 0;
+    while (result == 0) {
+        int idx;
+        if (my_range >= 0 && pop_range_front(job->ranges + my_range, &idx)) {
+            result = run_job_iteration(job, idx);
+            tasks++;
+            continue;
+        }
+
+        // Our range is empty. Look for a victim, starting with the
+        // range after the last one we stole from.
+        uint32_t begin = 0, end = 0;
+        bool stole = false;
+        for (int i = 0; i < job->num_ranges && !stole; i++) {
+            victim = (victim + 1) % job->num_ranges;
+            if (victim != my_range) {
+                stole = steal_range_back(job->ranges + victim, &begin, &end);
+            }
+        }
+        if (!stole) {
+            // Every range is empty. Iterations stolen by other
+            // threads but not yet published are run by those threads.
+            break;
+        }
+
+        log_message("Stole iterations [" << begin << ", " << end << ") of job " << job->task.name << " from range " << victim);
+        steals++;
+
+        if (my_range >= 0) {
+            // Run the first stolen iteration, and publish the rest
+            // in our own range so that others can steal them back.
+            if (begin + 1 < end) {
+                uint64_t r = pack_range(begin + 1, end);
+                Synchronization::atomic_store_release(job->ranges + my_range, &r);
+            }
+            result = run_job_iteration(job, (int)begin);
+            tasks++;
+        } else {
+            for (uint32_t i = begin; i < end && result == 0; i++) {
+                result = run_job_iteration(job, (int)i);
+                tasks++;
+            }
+        }
+    }
+    count_stat(&work_queue.stats.steals, steals);
+    count_stat(&work_queue.stats.tasks_executed, tasks);
+
+    if (result != 0) {
+        // Drain all the ranges so that other threads stop picking up
+        // iterations of this job.
+        uint64_t empty = 0;
+        for (int i = 0; i < job->num_ranges; i++) {
+            Synchronization::atomic_store_release(job->ranges + i, &empty);
+        }
+    }
+    return result;
+}
+
+// Fork-join fast path for nested parallel loops. While every thread
+// of the pool is already running iterations of some job, nobody is
+// free to pick up the iterations of a new one, so rather than
+// enqueueing it under the lock, the calling thread runs it itself, in
+// one chunk per thread of the pool. Between chunks it checks again,
+// and if a thread has become idle, what is left goes through the work
+// queue as usual. *min and *extent are advanced past the iterations
+// run. Returns true if there is nothing left to enqueue, because every
+// iteration has been run or one of them failed, in which case its
+// result is in *result.
+WEAK bool run_while_saturated(work_queue_t &work_queue, void *user_context,
+                              halide_task_t task_fn, halide_loop_task_t loop_fn,
+                              int *min, int *extent, uint8_t *closure,
+                              void *task_parent, int *result) {
+    int chunk = 0;
+    while (*extent > 0) {
+        int busy, threads;
+        Synchronization::atomic_load_relaxed(&work_queue.threads_busy, &busy);
+        Synchronization::atomic_load_relaxed(&work_queue.threads_created, &threads);
+        // The + 1 is because threads_created does not include the
+        // thread that owns the outermost job.
+        if (busy < threads + 1) {
+            return false;
+        }
+        if (chunk == 0) {
+            chunk = max(*extent / (threads + 1), 1);
+        }
+        int n = ::min(chunk, *extent);
+        if (task_fn) {
+            for (int i = *min; i < *min + n && *result == 0; i++) {
+                *result = halide_do_task(user_context, task_fn, i, closure);
+            }
+        } else {
+            *result = halide_do_loop_task(user_context, loop_fn, *min, n, closure, task_parent);
+        }
+        count_stat(&work_queue.stats.inline_chunks, 1);
+        count_stat(&work_queue.stats.tasks_executed, task_fn ? n : 1);
+        *min += n;
+        *extent -= n;
+        if (*result != 0) {
+            return true;
+        }
+    }
+    return true;
+}
+
+// Whether a worker that finished a job should still busy-wait for the
+// next one.
+ALWAYS_INLINE bool still_hot(int64_t *hot_until) {
+    if (*hot_until == 0) {
+        return false;
+    }
+    if (halide_current_time_ns(nullptr) < *hot_until) {
+        return true;
+    }
+    *hot_until = 0;
+    return false;
+}
+
+// thread_index is the index of the calling thread in
+// work_queue.threads, or -1 if it is not known (e.g. because this is
+// the owner of a job rather than a worker looking for work).
+WEAK void worker_thread_already_locked(work_queue_t &work_queue, work *owned_job, int thread_index) {
     int spin_count = 0;
-    const int max_spin_count = 40;
+    int oversubscribed = 0;
+    int max_spin_count = 40;
+    // When this worker's hot period ends, or zero if it is not hot.
+    int64_t hot_until = 0;
 
     while (owned_job ? owned_job->running() : !work_queue.shutdown) {
         work *job = work_queue.jobs;
@@ -231,7 +691,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             }
         }
 
-        dump_job_state();
+        dump_job_state(work_queue);
 
         // Find a job to run, prefering things near the top of the stack.
         while (job) {
@@ -259,6 +719,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
             if (!enough_threads) {
                 log_message("Not enough threads for job " << job->task.name << " available: " << threads_available << " min_threads: " << job->task.min_threads);
+                count_stat(&work_queue.stats.min_threads_waits, 1);
             }
             bool can_use_this_thread_stack = !owned_job || (job->siblings == owned_job->siblings) || job->task.min_threads == 0;
             if (!can_use_this_thread_stack) {
@@ -271,9 +732,17 @@ WEAK void worker_thread_already_locked(work *owned_job) {
 
             if (enough_threads && can_use_this_thread_stack && can_add_worker) {
                 if (job->make_runnable()) {
+                    if (job->blocked_since) {
+                        count_time_since(work_queue, &work_queue.stats.semaphore_wait_ns, job->blocked_since);
+                        job->blocked_since = 0;
+                    }
                     break;
                 } else {
                     log_message("Cannot acquire semaphores for " << job->task.name);
+                    count_stat(&work_queue.stats.semaphore_acquire_failures, 1);
+                    if (!job->blocked_since) {
+                        job->blocked_since = stats_time(work_queue);
+                    }
                 }
             }
             prev_ptr = &(job->next_job);
@@ -281,34 +750,47 @@ WEAK void worker_thread_already_locked(work *owned_job) {
         }
 
         if (!job) {
-            // There is no runnable job. Go to sleep.
+            // There is no runnable job. Go to sleep. Don't spin first
+            // if there are more threads than cores.
+            Synchronization::atomic_load_relaxed(&Synchronization::spin_oversubscribed, &oversubscribed);
+            max_spin_count = oversubscribed ? 0 : 40;
             if (owned_job) {
+                int64_t start = stats_time(work_queue);
                 if (spin_count++ < max_spin_count) {
                     // Give the workers a chance to finish up before sleeping
                     halide_mutex_unlock(&work_queue.mutex);
                     halide_thread_yield();
                     halide_mutex_lock(&work_queue.mutex);
+                    count_time_since(work_queue, &work_queue.stats.spin_ns, start);
                 } else {
                     work_queue.owners_sleeping++;
                     owned_job->owner_is_sleeping = true;
                     halide_cond_wait(&work_queue.wake_owners, &work_queue.mutex);
                     owned_job->owner_is_sleeping = false;
                     work_queue.owners_sleeping--;
+                    count_stat(&work_queue.stats.sleeps, 1);
+                    count_time_since(work_queue, &work_queue.stats.sleep_ns, start);
                 }
             } else {
                 work_queue.workers_sleeping++;
+                int64_t start = stats_time(work_queue);
                 if (work_queue.a_team_size > work_queue.target_a_team_size) {
                     // Transition to B team
                     work_queue.a_team_size--;
                     halide_cond_wait(&work_queue.wake_b_team, &work_queue.mutex);
                     work_queue.a_team_size++;
-                } else if (spin_count++ < max_spin_count) {
+                    count_stat(&work_queue.stats.sleeps, 1);
+                    count_time_since(work_queue, &work_queue.stats.sleep_ns, start);
+                } else if (spin_count++ < max_spin_count || still_hot(&hot_until)) {
                     // Spin waiting for new work
                     halide_mutex_unlock(&work_queue.mutex);
                     halide_thread_yield();
                     halide_mutex_lock(&work_queue.mutex);
+                    count_time_since(work_queue, &work_queue.stats.spin_ns, start);
                 } else {
                     halide_cond_wait(&work_queue.wake_a_team, &work_queue.mutex);
+                    count_stat(&work_queue.stats.sleeps, 1);
+                    count_time_since(work_queue, &work_queue.stats.sleep_ns, start);
                 }
                 work_queue.workers_sleeping--;
             }
@@ -323,6 +805,8 @@ WEAK void worker_thread_already_locked(work *owned_job) {
         // are aware that this job is still in progress even
         // though there are no outstanding tasks for it.
         job->active_workers++;
+        Synchronization::atomic_fetch_add_acquire_release(&work_queue.threads_busy, 1);
+        const int64_t run_start = stats_time(work_queue);
 
         if (job->parent_job == nullptr) {
             work_queue.threads_reserved += job->task.min_threads;
@@ -356,6 +840,7 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 result = halide_do_loop_task(job->user_context, job->task.fn,
                                              job->task.min + total_iters, iters,
                                              job->task.closure, job);
+                count_stat(&work_queue.stats.tasks_executed, 1);
                 total_iters += iters;
                 iters = 0;
             }
@@ -371,6 +856,42 @@ WEAK void worker_thread_already_locked(work *owned_job) {
                 job->next_job = work_queue.jobs;
                 work_queue.jobs = job;
             }
+        } else if (job->guided) {
+            // Claim chunks of iterations without holding the lock.
+            halide_mutex_unlock(&work_queue.mutex);
+            result = run_guided_job(work_queue, job);
+            halide_mutex_lock(&work_queue.mutex);
+
+            // Every iteration is now claimed, so no new worker
+            // should join this job. Workers still running their last
+            // chunk keep it alive through active_workers.
+            if (job->task.extent != 0) {
+                unlink_job_already_locked(work_queue, job);
+                job->task.extent = 0;
+            }
+        } else if (job->ranges) {
+            // Take ownership of one of the ranges, if there are any
+            // left, and run it without holding the lock, stealing
+            // from other ranges when it runs out.
+            int my_range = -1;
+            if (!job->ranges_by_thread_index) {
+                my_range = job->next_range < job->num_ranges ? job->next_range++ : -1;
+            } else if (job == owned_job) {
+                my_range = job->num_ranges - 1;
+            } else if (thread_index >= 0 && thread_index < job->num_ranges - 1) {
+                my_range = thread_index;
+            }
+            halide_mutex_unlock(&work_queue.mutex);
+            result = run_stealing_job(work_queue, job, my_range);
+            halide_mutex_lock(&work_queue.mutex);
+
+            // All ranges are now empty, so no new worker should join
+            // this job. Workers still running stolen iterations keep
+            // it alive through active_workers.
+            if (job->task.extent != 0) {
+                unlink_job_already_locked(work_queue, job);
+                job->task.extent = 0;
+            }
         } else {
             // Claim a task from it.
             work myjob = *job;
@@ -382,6 +903,8 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             if (job->task.extent == 0) {
                 *prev_ptr = job->next_job;
             }
+            count_stat(&work_queue.stats.queue_pops, 1);
+            count_stat(&work_queue.stats.tasks_executed, 1);
 
             // Release the lock and do the task.
             halide_mutex_unlock(&work_queue.mutex);
@@ -424,26 +947,92 @@ WEAK void worker_thread_already_locked(work *owned_job) {
             log_message("Returned " << job->task.min_threads << " to " << job->parent_job->task.name << " for " << job->task.name << " giving " << job->parent_job->threads_reserved << " of " << job->parent_job->task.min_threads);
         }
 
+        // If this was the last iteration of a call made by
+        // halide_call_async, tell the caller, while still active on
+        // the job so that nobody waiting for it frees it.
+        if (job->async && job->task.extent == 0 && job->active_workers == 1) {
+            if (job->async->done) {
+                halide_mutex_unlock(&work_queue.mutex);
+                job->async->done(job->user_context, job->async->arg, job->async->result);
+                halide_mutex_lock(&work_queue.mutex);
+            }
+            wake_owners = true;
+        }
+
         // We are no longer active on this job
         job->active_workers--;
+        Synchronization::atomic_fetch_add_acquire_release(&work_queue.threads_busy, -1);
+        count_time_since(work_queue, &work_queue.stats.run_ns, run_start);
 
         log_message("Done working on job " << job->task.name);
 
+        // Busy-wait for the next job for a while, unless that would
+        // take time away from other threads.
+        Synchronization::atomic_load_relaxed(&Synchronization::spin_oversubscribed, &oversubscribed);
+        if (!owned_job && work_queue.hot_period_us > 1 && !oversubscribed) {
+            hot_until = halide_current_time_ns(nullptr) + (int64_t)(work_queue.hot_period_us - 1) * 1000;
+        }
+
         if (wake_owners ||
             (job->active_workers == 0 && (job->task.extent == 0 || job->exit_status != 0) && job->owner_is_sleeping)) {
             // The job is done or some owned job failed via sibling linkage. Wake up the owner.
             halide_cond_broadcast(&work_queue.wake_owners);
         }
+
+        if (job->async && job->async->detached && !job->running()) {
+            free(job->async);
+        }
     }
 }
 
 WEAK void worker_thread(void *arg) {
+    // The argument is the worker_thread_arg of this thread.
+    work_queue_t &work_queue = *((worker_thread_arg *)arg)->queue;
+    int thread_index = ((worker_thread_arg *)arg)->thread_index;
     halide_mutex_lock(&work_queue.mutex);
-    worker_thread_already_locked((work *)arg);
+    if (work_queue.num_worker_cpus > 0) {
+        int cpu = work_queue.worker_cpus[thread_index % work_queue.num_worker_cpus];
+        if (halide_pin_current_thread_to_cpu(cpu) != 0) {
+            log_message("Failed to pin worker " << thread_index << " to cpu " << cpu);
+        }
+    }
+    if (work_queue.priority != 0 && halide_set_current_thread_priority(work_queue.priority) != 0) {
+        log_message("Failed to set the priority of worker " << thread_index << " to " << work_queue.priority);
+    }
+    worker_thread_already_locked(work_queue, nullptr, thread_index);
     halide_mutex_unlock(&work_queue.mutex);
 }
 
-WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_parent) {
+// Work out which cpus to pin worker threads to in NUMA-aware mode,
+// grouping the cpus of each node together. Must be called while
+// locked, before any threads are spawned.
+WEAK void init_worker_cpus_already_locked(work_queue_t &work_queue) {
+    work_queue.num_worker_cpus = 0;
+    if (!halide_numa_aware()) {
+        return;
+    }
+    int cpu_nodes[MAX_THREADS];
+    int num_nodes = halide_host_numa_cpus(cpu_nodes, MAX_THREADS);
+    for (int node = 0; node < num_nodes; node++) {
+        for (int cpu = 0; cpu < MAX_THREADS; cpu++) {
+            if (cpu_nodes[cpu] == node) {
+                work_queue.worker_cpus[work_queue.num_worker_cpus++] = cpu;
+            }
+        }
+    }
+    log_message("NUMA-aware mode found " << num_nodes << " nodes with " << work_queue.num_worker_cpus << " cpus");
+}
+
+WEAK void spawn_worker_already_locked(work_queue_t &work_queue) {
+    work_queue.a_team_size++;
+    int thread_index = work_queue.threads_created++;
+    work_queue.thread_args[thread_index].queue = &work_queue;
+    work_queue.thread_args[thread_index].thread_index = thread_index;
+    work_queue.threads[thread_index] =
+        halide_spawn_thread(worker_thread, work_queue.thread_args + thread_index);
+}
+
+WEAK void enqueue_work_already_locked(work_queue_t &work_queue, int num_jobs, work *jobs, work *task_parent) {
     if (!work_queue.initialized) {
         work_queue.assert_zeroed();
 
@@ -454,6 +1043,19 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
             work_queue.desired_threads_working = default_desired_num_threads();
         }
         work_queue.desired_threads_working = clamp_num_threads(work_queue.desired_threads_working);
+        if (!work_queue.work_stealing) {
+            work_queue.work_stealing = default_work_stealing() ? 2 : 1;
+        }
+        if (!work_queue.guided_scheduling) {
+            work_queue.guided_scheduling = default_guided_scheduling() ? 2 : 1;
+        }
+        if (!work_queue.hot_period_us) {
+            work_queue.hot_period_us = default_hot_period_us() + 1;
+        }
+        if (!work_queue.timing) {
+            work_queue.timing = default_timing() ? 2 : 1;
+        }
+        init_worker_cpus_already_locked(work_queue);
         work_queue.initialized = true;
     }
 
@@ -507,14 +1109,16 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         }
 
         // Spawn more threads if necessary.
+        const int threads_before = work_queue.threads_created;
         while (work_queue.threads_created < MAX_THREADS &&
                ((work_queue.threads_created < work_queue.desired_threads_working - 1) ||
                 (work_queue.threads_created + 1) - work_queue.threads_reserved < min_threads)) {
             // We might need to make some new threads, if work_queue.desired_threads_working has
             // increased, or if there aren't enough threads to complete this new task.
-            work_queue.a_team_size++;
-            work_queue.threads[work_queue.threads_created++] =
-                halide_spawn_thread(worker_thread, nullptr);
+            spawn_worker_already_locked(work_queue);
+        }
+        if (work_queue.threads_created != threads_before) {
+            update_oversubscription(work_queue.threads_created - threads_before);
         }
         log_message("enqueue_work_already_locked top level job " << jobs[0].task.name << " with min_threads " << min_threads << " work_queue.threads_created " << work_queue.threads_created << " work_queue.threads_reserved " << work_queue.threads_reserved);
         if (job_has_acquires || job_may_block) {
@@ -540,6 +1144,14 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
         jobs[i].threads_reserved = 0;
         work_queue.jobs = jobs + i;
     }
+    count_stat(&work_queue.stats.jobs_enqueued, num_jobs);
+    uint64_t depth = 0;
+    for (work *job = work_queue.jobs; job; job = job->next_job) {
+        depth++;
+    }
+    if (depth > work_queue.stats.max_queue_depth) {
+        work_queue.stats.max_queue_depth = depth;
+    }
 
     bool nested_parallelism =
         work_queue.owners_sleeping ||
@@ -571,6 +1183,40 @@ WEAK void enqueue_work_already_locked(int num_jobs, work *jobs, work *task_paren
     }
 }
 
+// Wake everyone up and tell them the party's over and it's time to
+// go home, then return the work queue to its initial state.
+WEAK void shutdown_work_queue(work_queue_t &work_queue) {
+    if (!work_queue.initialized) {
+        return;
+    }
+    halide_mutex_lock(&work_queue.mutex);
+
+    work_queue.shutdown = true;
+    halide_cond_broadcast(&work_queue.wake_owners);
+    halide_cond_broadcast(&work_queue.wake_a_team);
+    halide_cond_broadcast(&work_queue.wake_b_team);
+    halide_mutex_unlock(&work_queue.mutex);
+
+    // Wait until they leave
+    for (int i = 0; i < work_queue.threads_created; i++) {
+        halide_join_thread(work_queue.threads[i]);
+    }
+    if (work_queue.threads_created) {
+        update_oversubscription(-work_queue.threads_created);
+    }
+
+    // Tidy up
+    work_queue.reset();
+}
+
+// A semaphore may be acquired by a job on any work queue.
+WEAK void wake_work_queue_for_semaphore(work_queue_t &work_queue) {
+    halide_mutex_lock(&work_queue.mutex);
+    halide_cond_broadcast(&work_queue.wake_a_team);
+    halide_cond_broadcast(&work_queue.wake_owners);
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
 WEAK halide_do_task_t custom_do_task = halide_default_do_task;
 WEAK halide_do_loop_task_t custom_do_loop_task = halide_default_do_loop_task;
 WEAK halide_do_par_for_t custom_do_par_for = halide_default_do_par_for;
@@ -610,6 +1256,12 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
         return 0;
     }
 
+    work_queue_t &work_queue = work_queue_for(user_context);
+    int fast_result = 0;
+    if (run_while_saturated(work_queue, user_context, f, nullptr, &min, &size, closure, nullptr, &fast_result)) {
+        return fast_result;
+    }
+
     work job;
     job.task.fn = nullptr;
     job.task.min = min;
@@ -629,9 +1281,26 @@ WEAK int halide_default_do_par_for(void *user_context, halide_task_t f,
     job.siblings = &job;  // guarantees no other job points to the same siblings.
     job.sibling_count = 0;
     job.parent_job = nullptr;
+    job.ranges = nullptr;
+    job.guided = false;
+    job.async = nullptr;
+    job.blocked_since = 0;
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(1, &job, nullptr);
-    worker_thread_already_locked(&job);
+    enqueue_work_already_locked(work_queue, 1, &job, nullptr);
+    if (work_queue.guided_scheduling == 2 && work_queue.num_worker_cpus == 0) {
+        // No worker can have seen the job yet, because we still hold the lock.
+        if (size > 1) {
+            init_job_guided_already_locked(work_queue, &job);
+        }
+    } else if (work_queue.work_stealing == 2 || work_queue.num_worker_cpus > 0) {
+        // No worker can have seen the job yet, because we still hold the lock.
+        int num_ranges = size < work_queue.threads_created + 1 ? size : work_queue.threads_created + 1;
+        if (num_ranges > 1) {
+            uint64_t *ranges = (uint64_t *)__builtin_alloca(sizeof(uint64_t) * num_ranges);
+            init_job_ranges_already_locked(work_queue, &job, ranges, num_ranges);
+        }
+    }
+    worker_thread_already_locked(work_queue, &job, -1);
     halide_mutex_unlock(&work_queue.mutex);
     return job.exit_status;
 }
@@ -655,19 +1324,73 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
         jobs[i].next_semaphore = 0;
         jobs[i].owner_is_sleeping = false;
         jobs[i].parent_job = (work *)task_parent;
+        jobs[i].ranges = nullptr;
+        jobs[i].guided = false;
+        jobs[i].async = nullptr;
+        jobs[i].blocked_since = 0;
     }
 
     if (num_tasks == 0) {
         return 0;
     }
 
+    work_queue_t &work_queue = work_queue_for(user_context);
+
+    // Jobs without semaphores or blocking can skip the work queue while
+    // the pool has no idle threads.
+    bool all_stealable = true;
+    for (int i = 0; i < num_tasks; i++) {
+        all_stealable = all_stealable && jobs[i].stealable();
+    }
+    if (all_stealable) {
+        int remaining = 0;
+        for (int i = 0; i < num_tasks; i++) {
+            // The job stands in for the task parent of any parallel
+            // loops nested inside it.
+            jobs[i].threads_reserved = 0;
+            jobs[i].siblings = jobs + i;
+            jobs[i].sibling_count = 0;
+            int fast_result = 0;
+            if (run_while_saturated(work_queue, user_context, nullptr, jobs[i].task.fn,
+                                    &jobs[i].task.min, &jobs[i].task.extent,
+                                    jobs[i].task.closure, jobs + i, &fast_result)) {
+                if (fast_result != 0) {
+                    return fast_result;
+                }
+            } else {
+                jobs[remaining++] = jobs[i];
+            }
+        }
+        num_tasks = remaining;
+        if (num_tasks == 0) {
+            return 0;
+        }
+    }
+
     halide_mutex_lock(&work_queue.mutex);
-    enqueue_work_already_locked(num_tasks, jobs, (work *)task_parent);
+    enqueue_work_already_locked(work_queue, num_tasks, jobs, (work *)task_parent);
+    if (work_queue.guided_scheduling == 2 && work_queue.num_worker_cpus == 0) {
+        // No worker can have seen the jobs yet, because we still hold the lock.
+        for (int i = 0; i < num_tasks; i++) {
+            if (jobs[i].stealable() && jobs[i].task.extent > 1) {
+                init_job_guided_already_locked(work_queue, jobs + i);
+            }
+        }
+    } else if (work_queue.work_stealing == 2 || work_queue.num_worker_cpus > 0) {
+        // No worker can have seen the jobs yet, because we still hold the lock.
+        for (int i = 0; i < num_tasks; i++) {
+            int num_ranges = min(jobs[i].task.extent, work_queue.threads_created + 1);
+            if (jobs[i].stealable() && num_ranges > 1) {
+                uint64_t *ranges = (uint64_t *)__builtin_alloca(sizeof(uint64_t) * num_ranges);
+                init_job_ranges_already_locked(work_queue, jobs + i, ranges, num_ranges);
+            }
+        }
+    }
     int exit_status = 0;
     for (int i = 0; i < num_tasks; i++) {
         // It doesn't matter what order we join the tasks in, because
         // we'll happily assist with siblings too.
-        worker_thread_already_locked(jobs + i);
+        worker_thread_already_locked(work_queue, jobs + i, -1);
         if (jobs[i].exit_status != 0) {
             exit_status = jobs[i].exit_status;
         }
@@ -676,10 +1399,9 @@ WEAK int halide_default_do_parallel_tasks(void *user_context, int num_tasks,
     return exit_status;
 }
 
-WEAK int halide_set_num_threads(int n) {
-    if (n < 0) {
-        halide_error(nullptr, "halide_set_num_threads: must be >= 0.");
-    }
+namespace {
+
+WEAK int set_work_queue_num_threads(work_queue_t &work_queue, int n) {
     // Don't make this an atomic swap - we don't want to be changing
     // the desired number of threads while another thread is in the
     // middle of a sequence of non-atomic operations.
@@ -693,28 +1415,261 @@ WEAK int halide_set_num_threads(int n) {
     return old;
 }
 
+}  // namespace
+
+WEAK int halide_set_num_threads(int n) {
+    if (n < 0) {
+        halide_error(nullptr, "halide_set_num_threads: must be >= 0.");
+    }
+    return set_work_queue_num_threads(default_work_queue, n);
+}
+
+WEAK bool halide_set_thread_pool_work_stealing(bool enable) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.work_stealing) {
+        work_queue.work_stealing = default_work_stealing() ? 2 : 1;
+    }
+    bool old = work_queue.work_stealing == 2;
+    work_queue.work_stealing = enable ? 2 : 1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK bool halide_set_thread_pool_guided_scheduling(bool enable) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.guided_scheduling) {
+        work_queue.guided_scheduling = default_guided_scheduling() ? 2 : 1;
+    }
+    bool old = work_queue.guided_scheduling == 2;
+    work_queue.guided_scheduling = enable ? 2 : 1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK int halide_set_thread_pool_hot_period(int microseconds) {
+    if (microseconds < 0) {
+        halide_error(nullptr, "halide_set_thread_pool_hot_period: must be >= 0.");
+        microseconds = 0;
+    }
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.hot_period_us) {
+        work_queue.hot_period_us = default_hot_period_us() + 1;
+    }
+    int old = work_queue.hot_period_us - 1;
+    work_queue.hot_period_us = microseconds + 1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK bool halide_set_thread_pool_timing(bool enable) {
+    work_queue_t &work_queue = default_work_queue;
+    halide_mutex_lock(&work_queue.mutex);
+    if (!work_queue.timing) {
+        work_queue.timing = default_timing() ? 2 : 1;
+    }
+    bool old = work_queue.timing == 2;
+    work_queue.timing = enable ? 2 : 1;
+    halide_mutex_unlock(&work_queue.mutex);
+    return old;
+}
+
+WEAK void halide_thread_pool_get_stats(void *user_context, halide_thread_pool_stats_t *stats) {
+    work_queue_t &work_queue = work_queue_for(user_context);
+    halide_mutex_lock(&work_queue.mutex);
+    // Some counters are updated without the lock.
+    uint64_t *src = (uint64_t *)&work_queue.stats;
+    uint64_t *dst = (uint64_t *)stats;
+    for (size_t i = 0; i < sizeof(halide_thread_pool_stats_t) / sizeof(uint64_t); i++) {
+        Synchronization::atomic_load_relaxed(src + i, dst + i);
+    }
+    stats->num_threads = work_queue.threads_created + 1;
+    halide_mutex_unlock(&work_queue.mutex);
+}
+
 WEAK void halide_shutdown_thread_pool() {
-    if (work_queue.initialized) {
-        // Wake everyone up and tell them the party's over and it's time
-        // to go home
-        halide_mutex_lock(&work_queue.mutex);
-
-        work_queue.shutdown = true;
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_b_team);
-        halide_mutex_unlock(&work_queue.mutex);
+    shutdown_work_queue(default_work_queue);
+}
+
+WEAK halide_thread_pool_t *halide_create_thread_pool(const char *name, int num_threads, int priority) {
+    if (num_threads < 0) {
+        halide_error(nullptr, "halide_create_thread_pool: num_threads must be >= 0.");
+        return nullptr;
+    }
+    work_queue_t *q = (work_queue_t *)malloc(sizeof(work_queue_t));
+    if (!q) {
+        return nullptr;
+    }
+    memset(q, 0, sizeof(work_queue_t));
+    if (name) {
+        strncpy(q->name, name, sizeof(q->name) - 1);
+    }
+    q->priority = priority;
+    q->desired_threads_working = num_threads;
+
+    halide_mutex_lock(&thread_pools_lock);
+    q->next_pool = thread_pools;
+    thread_pools = q;
+    halide_mutex_unlock(&thread_pools_lock);
+    return (halide_thread_pool_t *)q;
+}
+
+WEAK void halide_destroy_thread_pool(halide_thread_pool_t *pool) {
+    work_queue_t *q = (work_queue_t *)pool;
+    if (!q) {
+        return;
+    }
+    halide_mutex_lock(&thread_pools_lock);
+    work_queue_t **prev_ptr = &thread_pools;
+    while (*prev_ptr && *prev_ptr != q) {
+        prev_ptr = &(*prev_ptr)->next_pool;
+    }
+    if (*prev_ptr) {
+        *prev_ptr = q->next_pool;
+    }
+    halide_mutex_unlock(&thread_pools_lock);
+
+    shutdown_work_queue(*q);
+    free(q);
+}
+
+WEAK halide_thread_pool_t *halide_find_thread_pool(const char *name) {
+    halide_mutex_lock(&thread_pools_lock);
+    work_queue_t *q = thread_pools;
+    while (q && strcmp(q->name, name) != 0) {
+        q = q->next_pool;
+    }
+    halide_mutex_unlock(&thread_pools_lock);
+    return (halide_thread_pool_t *)q;
+}
+
+WEAK int halide_set_thread_pool_num_threads(halide_thread_pool_t *pool, int n) {
+    if (n < 0) {
+        halide_error(nullptr, "halide_set_thread_pool_num_threads: must be >= 0.");
+    }
+    return set_work_queue_num_threads(pool ? *(work_queue_t *)pool : default_work_queue, n);
+}
+
+WEAK halide_thread_pool_t *halide_default_get_thread_pool(void *user_context) {
+    return nullptr;
+}
+
+WEAK halide_get_thread_pool_t halide_set_custom_get_thread_pool(halide_get_thread_pool_t f) {
+    halide_get_thread_pool_t result = custom_get_thread_pool;
+    custom_get_thread_pool = f;
+    return result;
+}
 
-        // Wait until they leave
-        for (int i = 0; i < work_queue.threads_created; i++) {
-            halide_join_thread(work_queue.threads[i]);
+WEAK int run_async_call(void *user_context, int idx, uint8_t *closure) {
+    async_call *call = (async_call *)closure;
+    call->result = call->fn(user_context, call->arg);
+    // The result goes to the caller, rather than failing the job.
+    return 0;
+}
+
+WEAK halide_async_call_t *halide_call_async(void *user_context, halide_async_fn_t fn, void *arg,
+                                            halide_async_callback_t done) {
+    async_call *call = (async_call *)malloc(sizeof(async_call));
+    if (!call) {
+        return nullptr;
+    }
+    call->fn = fn;
+    call->arg = arg;
+    call->done = done;
+    call->result = 0;
+    call->detached = false;
+
+    work &job = call->job;
+    job.task.fn = nullptr;
+    job.task.min = 0;
+    job.task.extent = 1;
+    job.task.serial = false;
+    job.task.semaphores = nullptr;
+    job.task.num_semaphores = 0;
+    job.task.closure = (uint8_t *)call;
+    // Reserve the thread that runs the call, and keep it off the stacks
+    // of threads that own other jobs, so that running the call never
+    // holds up a pipeline that is waiting for its own loops to finish.
+    job.task.min_threads = 1;
+    job.task.name = "halide_call_async";
+    job.task_fn = run_async_call;
+    job.user_context = user_context;
+    job.exit_status = 0;
+    job.active_workers = 0;
+    job.next_semaphore = 0;
+    job.owner_is_sleeping = false;
+    job.parent_job = nullptr;
+    job.ranges = nullptr;
+    job.guided = false;
+    job.async = call;
+    job.blocked_since = 0;
+
+    work_queue_t &work_queue = work_queue_for(user_context);
+    halide_mutex_lock(&work_queue.mutex);
+    enqueue_work_already_locked(work_queue, 1, &job, nullptr);
+    // There has to be a worker to run the call, even with one thread.
+    if (work_queue.threads_created == 0) {
+        spawn_worker_already_locked(work_queue);
+        update_oversubscription(1);
+    }
+    // Move the call to the bottom of the job stack, so that pipelines
+    // that are already running finish first, and calls start in the
+    // order they were made.
+    if (job.next_job) {
+        work_queue.jobs = job.next_job;
+        work **last = &work_queue.jobs;
+        while (*last) {
+            last = &(*last)->next_job;
         }
+        *last = &job;
+        job.next_job = nullptr;
+    }
+    halide_cond_broadcast(&work_queue.wake_a_team);
+    halide_cond_broadcast(&work_queue.wake_b_team);
+    halide_mutex_unlock(&work_queue.mutex);
+    return (halide_async_call_t *)call;
+}
 
-        // Tidy up
-        work_queue.reset();
+WEAK int halide_async_call_wait(halide_async_call_t *c) {
+    async_call *call = (async_call *)c;
+    work_queue_t &work_queue = work_queue_for(call->job.user_context);
+    halide_mutex_lock(&work_queue.mutex);
+    // Help out until the call is finished. This may run the call
+    // itself, if no worker has picked it up yet.
+    worker_thread_already_locked(work_queue, &call->job, -1);
+    halide_mutex_unlock(&work_queue.mutex);
+    int result = call->result;
+    free(call);
+    return result;
+}
+
+WEAK bool halide_async_call_finished(halide_async_call_t *c) {
+    async_call *call = (async_call *)c;
+    work_queue_t &work_queue = work_queue_for(call->job.user_context);
+    halide_mutex_lock(&work_queue.mutex);
+    bool finished = !call->job.running();
+    halide_mutex_unlock(&work_queue.mutex);
+    return finished;
+}
+
+WEAK void halide_async_call_detach(halide_async_call_t *c) {
+    async_call *call = (async_call *)c;
+    work_queue_t &work_queue = work_queue_for(call->job.user_context);
+    halide_mutex_lock(&work_queue.mutex);
+    bool finished = !call->job.running();
+    call->detached = true;
+    halide_mutex_unlock(&work_queue.mutex);
+    if (finished) {
+        free(call);
     }
 }
 
+WEAK halide_thread_pool_t *halide_get_thread_pool(void *user_context) {
+    return (*custom_get_thread_pool)(user_context);
+}
+
 struct halide_semaphore_impl_t {
     int value;
 };
@@ -730,11 +1685,13 @@ WEAK int halide_default_semaphore_release(halide_semaphore_t *s, int n) {
     int old_val = Halide::Runtime::Internal::Synchronization::atomic_fetch_add_acquire_release(&sem->value, n);
     // TODO(abadams|zvookin): Is this correct if an acquire can be for say count of 2 and the releases are 1 each?
     if (old_val == 0 && n != 0) {  // Don't wake if nothing released.
-        // We may have just made a job runnable
-        halide_mutex_lock(&work_queue.mutex);
-        halide_cond_broadcast(&work_queue.wake_a_team);
-        halide_cond_broadcast(&work_queue.wake_owners);
-        halide_mutex_unlock(&work_queue.mutex);
+        // We may have just made a job runnable, on any work queue.
+        wake_work_queue_for_semaphore(default_work_queue);
+        halide_mutex_lock(&thread_pools_lock);
+        for (work_queue_t *q = thread_pools; q; q = q->next_pool) {
+            wake_work_queue_for_semaphore(*q);
+        }
+        halide_mutex_unlock(&thread_pools_lock);
     }
     return old_val + n;
 }
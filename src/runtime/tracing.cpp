@@ -75,6 +75,15 @@ public:
 
 const static int buffer_size = 1024 * 1024;
 
+// The most trace buffers HL_TRACE_BUFFERS may ask for.
+const static int max_trace_buffers = 64;
+
+// The number of counters used to sample realizations. Funcs are
+// hashed onto them by the address of their name.
+const static int trace_sample_slots = 64;
+
+WEAK ScopedSpinLock::AtomicFlag halide_trace_write_lock = 0;
+
 class TraceBuffer {
     SharedExclusiveSpinLock lock;
     uint32_t cursor = 0, overage = 0;
@@ -107,7 +116,11 @@ public:
         bool success = true;
         if (cursor) {
             cursor -= overage;
-            success = (cursor == (uint32_t)write(fd, buf, cursor));
+            {
+                // Other trace buffers may be flushing to the same fd.
+                ScopedSpinLock write_lock(&halide_trace_write_lock);
+                success = (cursor == (uint32_t)write(fd, buf, cursor));
+            }
             cursor = 0;
             overage = 0;
         }
@@ -145,12 +158,78 @@ public:
     TraceBuffer() = default;
 };
 
-WEAK TraceBuffer *halide_trace_buffer = nullptr;
+WEAK TraceBuffer *halide_trace_buffers = nullptr;
+WEAK int halide_trace_buffer_count = 0;
+WEAK int halide_trace_sample_rate = 0;  // 0 indicates uninitialized
+WEAK uint32_t halide_trace_sample_counters[trace_sample_slots] = {0};
 WEAK int halide_trace_file = -1;  // -1 indicates uninitialized
 WEAK ScopedSpinLock::AtomicFlag halide_trace_file_lock = 0;
 WEAK bool halide_trace_file_initialized = false;
 WEAK void *halide_trace_file_internally_opened = nullptr;
 
+WEAK int trace_env_int(const char *name, int default_value, int max_value) {
+    const char *value = getenv(name);
+    int n = value ? atoi(value) : default_value;
+    return n < 1 ? 1 : (n > max_value ? max_value : n);
+}
+
+// Allocate the trace buffers if we haven't already. By default there
+// is one, shared by all threads, so packets land in the file in the
+// order their ids were assigned. HL_TRACE_BUFFERS=N spreads threads
+// over N buffers so they don't contend for (or stall on flushes of)
+// the same one. Each buffer is written out as a batch when it fills,
+// so packets are then only in order per thread, and consumers must
+// reorder them by id.
+WEAK TraceBuffer *get_trace_buffers() {
+    TraceBuffer *buffers = halide_trace_buffers;
+    if (buffers) {
+        return buffers;
+    }
+    ScopedSpinLock lock(&halide_trace_file_lock);
+    if (!halide_trace_buffers) {
+        int count = trace_env_int("HL_TRACE_BUFFERS", 1, max_trace_buffers);
+        buffers = (TraceBuffer *)malloc(count * sizeof(TraceBuffer));
+        if (buffers) {
+            for (int i = 0; i < count; i++) {
+                buffers[i].init();
+            }
+            halide_trace_buffer_count = count;
+            __sync_synchronize();
+            halide_trace_buffers = buffers;
+        }
+    }
+    return halide_trace_buffers;
+}
+
+ALWAYS_INLINE TraceBuffer *trace_buffer_for_this_thread(TraceBuffer *buffers) {
+    if (halide_trace_buffer_count == 1) {
+        return buffers;
+    }
+    // There's no thread-local storage in the runtime, but every
+    // thread runs on its own stack, so a hash of the address of a
+    // local spreads concurrent writers across the buffers.
+    int local;
+    uint32_t h = (uint32_t)((uintptr_t)&local >> 16) * 0x9e3779b1u;
+    return buffers + (h >> 16) % halide_trace_buffer_count;
+}
+
+// Returns true if this realization should be traced. With
+// HL_TRACE_SAMPLE=N, only one in every N realizations of each Func
+// is.
+ALWAYS_INLINE bool sample_realization(const halide_trace_event_t *e) {
+    int rate = halide_trace_sample_rate;
+    if (rate == 0) {
+        // Benign race: every thread computes the same value.
+        rate = trace_env_int("HL_TRACE_SAMPLE", 1, 0x7fffffff);
+        halide_trace_sample_rate = rate;
+    }
+    if (rate == 1) {
+        return true;
+    }
+    uint32_t slot = (uint32_t)((uintptr_t)e->func >> 3) % trace_sample_slots;
+    return (__sync_fetch_and_add(&halide_trace_sample_counters[slot], 1) % rate) == 0;
+}
+
 }  // namespace Internal
 }  // namespace Runtime
 }  // namespace Halide
@@ -160,11 +239,26 @@ extern "C" {
 WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t *e) {
     static int32_t ids = 1;
 
+    // Events belonging to a realization that was sampled out are
+    // dropped. They return the same negative id so that their own
+    // children are dropped too.
+    if (e->parent_id < 0) {
+        return e->parent_id;
+    }
+
     int32_t my_id = __sync_fetch_and_add(&ids, 1);
 
+    if (e->event == halide_trace_begin_realization && !sample_realization(e)) {
+        return -my_id;
+    }
+
     // If we're dumping to a file, use a binary format
     int fd = halide_get_trace_file(user_context);
     if (fd > 0) {
+        TraceBuffer *buffers = get_trace_buffers();
+        halide_abort_if_false(user_context, buffers && "Could not allocate trace buffers");
+        TraceBuffer *trace_buffer = trace_buffer_for_this_thread(buffers);
+
         // Compute the total packet size
         uint32_t value_bytes = (uint32_t)(e->type.lanes * e->type.bytes());
         uint32_t header_bytes = (uint32_t)sizeof(halide_trace_packet_t);
@@ -175,7 +269,7 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         uint32_t total_size = (total_size_without_padding + 3) & ~3;
 
         // Claim some space to write to in the trace buffer
-        halide_trace_packet_t *packet = halide_trace_buffer->acquire_packet(user_context, fd, total_size);
+        halide_trace_packet_t *packet = trace_buffer->acquire_packet(user_context, fd, total_size);
 
         if (total_size > 4096) {
             print(nullptr) << total_size << "\n";
@@ -199,12 +293,14 @@ WEAK int32_t halide_default_trace(void *user_context, const halide_trace_event_t
         memcpy((void *)packet->trace_tag(), e->trace_tag ? e->trace_tag : "", trace_tag_bytes);
 
         // Release it
-        halide_trace_buffer->release_packet(packet);
+        trace_buffer->release_packet(packet);
 
-        // We should also flush the trace buffer if we hit an event
+        // We should also flush the trace buffers if we hit an event
         // that might be the end of the trace.
         if (e->event == halide_trace_end_pipeline) {
-            halide_trace_buffer->flush(user_context, fd);
+            for (int i = 0; i < halide_trace_buffer_count; i++) {
+                buffers[i].flush(user_context, fd);
+            }
         }
 
     } else {
@@ -351,10 +447,6 @@ WEAK int halide_get_trace_file(void *user_context) {
             halide_abort_if_false(user_context, file && "Failed to open trace file\n");
             halide_set_trace_file(fileno(file));
             halide_trace_file_internally_opened = file;
-            if (!halide_trace_buffer) {
-                halide_trace_buffer = (TraceBuffer *)malloc(sizeof(TraceBuffer));
-                halide_trace_buffer->init();
-            }
         } else {
             halide_set_trace_file(0);
         }
@@ -372,8 +464,10 @@ WEAK int halide_shutdown_trace() {
         halide_trace_file = 0;
         halide_trace_file_initialized = false;
         halide_trace_file_internally_opened = nullptr;
-        if (halide_trace_buffer) {
-            free(halide_trace_buffer);
+        if (halide_trace_buffers) {
+            free(halide_trace_buffers);
+            halide_trace_buffers = nullptr;
+            halide_trace_buffer_count = 0;
         }
         return ret;
     } else {
@@ -0,0 +1,1858 @@
+#include "HalideRuntimeVulkan.h"
+#include "device_buffer_utils.h"
+#include "device_interface.h"
+#include "device_memory_pool.h"
+#include "gpu_context_common.h"
+#include "gpu_kernel_cache.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
+#include "scoped_spin_lock.h"
+
+#include "mini_vulkan.h"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Vulkan {
+
+// Define the function pointers for the Vulkan API.
+// clang-format off
+#define VK_FN(ret, fn, args) WEAK ret(VKAPI_PTR *fn) args;  // NOLINT(bugprone-macro-parentheses)
+#include "vulkan_functions.h"
+#undef VK_FN
+// clang-format on
+
+// The default implementation of halide_vulkan_get_symbol attempts to load
+// the Vulkan loader shared library/DLL, and then get the symbol from it.
+WEAK void *lib_vulkan = nullptr;
+
+extern "C" WEAK void *halide_vulkan_get_symbol(void *user_context, const char *name) {
+    // Only try to load the library if the library isn't already
+    // loaded, or we can't load the symbol from the process already.
+    void *symbol = halide_get_library_symbol(lib_vulkan, name);
+    if (symbol) {
+        return symbol;
+    }
+
+    const char *lib_names[] = {
+#ifdef WINDOWS
+        "vulkan-1.dll",
+#else
+        "libvulkan.so.1",
+        "libvulkan.1.dylib",
+#endif
+    };
+    for (auto &lib_name : lib_names) {
+        lib_vulkan = halide_load_library(lib_name);
+        if (lib_vulkan) {
+            debug(user_context) << "    Loaded Vulkan loader library: " << lib_name << "\n";
+            break;
+        }
+    }
+
+    return halide_get_library_symbol(lib_vulkan, name);
+}
+
+template<typename T>
+ALWAYS_INLINE T get_vk_symbol(void *user_context, const char *name, bool req) {
+    T s = (T)halide_vulkan_get_symbol(user_context, name);
+    if (!s && req) {
+        error(user_context) << "Vulkan API not found: " << name << "\n";
+    }
+    return s;
+}
+
+// Load the Vulkan loader, and get the function pointers for the Vulkan API from it.
+WEAK void load_libvulkan(void *user_context) {
+    debug(user_context) << "    load_libvulkan (user_context: " << user_context << ")\n";
+    halide_abort_if_false(user_context, vkCreateInstance == nullptr);
+
+// clang-format off
+#define VK_FN(ret, fn, args)    fn = get_vk_symbol<ret(VKAPI_PTR *) args>(user_context, #fn, true);   // NOLINT(bugprone-macro-parentheses)
+#define VK_11_FN(ret, fn, args) fn = get_vk_symbol<ret(VKAPI_PTR *) args>(user_context, #fn, false);  // NOLINT(bugprone-macro-parentheses)
+#include "vulkan_functions.h"
+#undef VK_11_FN
+#undef VK_FN
+    // clang-format on
+}
+
+extern WEAK halide_device_interface_t vulkan_device_interface;
+
+WEAK const char *get_vulkan_error_name(VkResult err);
+WEAK int create_vulkan_context(void *user_context);
+
+// A Vulkan instance/device/queue/synchronization lock defined in
+// this module with weak linkage
+WEAK VkInstance instance = nullptr;
+WEAK VkPhysicalDevice physical_device = nullptr;
+WEAK VkDevice device = nullptr;
+WEAK VkQueue queue = nullptr;
+WEAK uint32_t queue_family_index = 0;
+volatile ScopedSpinLock::AtomicFlag WEAK thread_lock = 0;
+
+// A buffer and the memory bound to it. Device memory is only ever
+// accessed through buffers in Vulkan, so the pool hands out these as its
+// blocks, and buffers allocated from it are a block and an offset.
+struct VulkanBlock {
+    VkDeviceMemory memory;
+    VkBuffer buffer;
+    VkDeviceSize size;
+    // The host address of the memory, if it is host visible.
+    void *mapped;
+    // False for buffers wrapped with halide_vulkan_wrap_vk_buffer.
+    bool owned;
+};
+
+// The objects Halide creates on the device returned by
+// halide_vulkan_acquire_context, which may belong to the application.
+// All work is submitted through a single command buffer, and waited
+// for with its fence before the next use, so everything is complete by
+// the time a Halide runtime call returns.
+struct DeviceState {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    VkDeviceSize storage_buffer_offset_alignment;
+    uint32_t api_version;
+    VkCommandPool command_pool;
+    VkCommandBuffer command_buffer;
+    VkFence fence;
+    // Host visible memory that copies to and from the host go through.
+    VulkanBlock *staging;
+    // Identifies the device and driver in the GPU kernel cache.
+    char device_id[512];
+};
+WEAK DeviceState device_state;
+
+// Each shader module is compiled into a pipeline per entry point as it
+// is first run. The descriptor sets binding each pipeline's arguments
+// are cached, keyed by the buffers and offsets bound, so that kernels
+// run repeatedly on the same buffers don't write new descriptors.
+const int descriptor_set_cache_size = 8;
+
+struct VulkanPipeline {
+    VulkanPipeline *next;
+    char *entry_name;
+    int num_scalars;
+    int num_buffers;
+    VkDescriptorSetLayout set_layout;
+    VkPipelineLayout layout;
+    VkPipeline pipeline;
+    VkDescriptorPool descriptor_pool;
+    // Host visible uniform buffer holding the scalar arguments.
+    VulkanBlock *scalar_args;
+    VkDescriptorSet sets[descriptor_set_cache_size];
+    bool set_valid[descriptor_set_cache_size];
+    int next_victim;
+    // The buffer bindings of each cached set, num_buffers per set,
+    // followed by space for the bindings of the current run.
+    VkDescriptorBufferInfo *bindings;
+};
+
+struct VulkanModule {
+    VulkanModule *next;
+    VkDevice device;
+    VkShaderModule shader;
+    VkPipelineCache pipeline_cache;
+    VulkanPipeline *pipelines;
+    // A copy of the SPIR-V, kept when the GPU kernel cache is in use to
+    // save the pipeline cache for it as pipelines are created.
+    char *src;
+    int size;
+};
+
+// All the modules, to forget the descriptor sets for freed buffers.
+// This lock also guards their pipelines' descriptor set caches, which
+// are purged when the device memory pool frees a block, possibly from
+// outside the context lock.
+WEAK VulkanModule *modules = nullptr;
+WEAK halide_mutex modules_lock;
+
+struct device_handle {
+    // Important: order these to avoid any padding between fields;
+    // some Win32 compiler optimizer configurations can inconsistently
+    // insert padding otherwise.
+    uint64_t offset;
+    VulkanBlock *block;
+};
+
+WEAK Halide::Internal::GPUCompilationCache<VkDevice, VulkanModule *> compilation_cache;
+
+// Find a memory type allowed by type_bits with the required
+// properties, preferring one that also has the preferred ones.
+WEAK int find_memory_type(uint32_t type_bits, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+    const VkPhysicalDeviceMemoryProperties &props = device_state.memory_properties;
+    for (int pass = 0; pass < 2; pass++) {
+        VkMemoryPropertyFlags wanted = pass == 0 ? (required | preferred) : required;
+        for (uint32_t i = 0; i < props.memoryTypeCount; i++) {
+            if ((type_bits & (1u << i)) &&
+                (props.memoryTypes[i].propertyFlags & wanted) == wanted) {
+                return (int)i;
+            }
+        }
+    }
+    return -1;
+}
+
+WEAK void destroy_block(VkDevice dev, VulkanBlock *block) {
+    if (block == nullptr) {
+        return;
+    }
+    if (block->owned) {
+        if (block->buffer) {
+            vkDestroyBuffer(dev, block->buffer, nullptr);
+        }
+        if (block->memory) {
+            // Freeing memory unmaps it.
+            vkFreeMemory(dev, block->memory, nullptr);
+        }
+    }
+    free(block);
+}
+
+WEAK VulkanBlock *create_block(void *user_context, VkDevice dev, VkDeviceSize size, VkBufferUsageFlags usage,
+                               VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred) {
+    VulkanBlock *block = (VulkanBlock *)malloc(sizeof(VulkanBlock));
+    if (block == nullptr) {
+        return nullptr;
+    }
+    memset(block, 0, sizeof(VulkanBlock));
+    block->size = size;
+    block->owned = true;
+
+    VkBufferCreateInfo buffer_info = {
+        VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        nullptr,
+        0,
+        size,
+        usage,
+        VK_SHARING_MODE_EXCLUSIVE,
+        0,
+        nullptr};
+    VkResult err = vkCreateBuffer(dev, &buffer_info, nullptr, &block->buffer);
+    if (err != VK_SUCCESS) {
+        debug(user_context) << "    vkCreateBuffer failed: " << get_vulkan_error_name(err) << "\n";
+        destroy_block(dev, block);
+        return nullptr;
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(dev, block->buffer, &requirements);
+    int memory_type = find_memory_type(requirements.memoryTypeBits, required, preferred);
+    if (memory_type < 0) {
+        debug(user_context) << "    no suitable Vulkan memory type\n";
+        destroy_block(dev, block);
+        return nullptr;
+    }
+
+    VkMemoryAllocateInfo alloc_info = {
+        VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        nullptr,
+        requirements.size,
+        (uint32_t)memory_type};
+    err = vkAllocateMemory(dev, &alloc_info, nullptr, &block->memory);
+    if (err == VK_SUCCESS) {
+        err = vkBindBufferMemory(dev, block->buffer, block->memory, 0);
+    }
+    if (err == VK_SUCCESS && (required & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        err = vkMapMemory(dev, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+    }
+    if (err != VK_SUCCESS) {
+        debug(user_context) << "    Vulkan memory allocation failed: " << get_vulkan_error_name(err) << "\n";
+        destroy_block(dev, block);
+        return nullptr;
+    }
+    return block;
+}
+
+// Forget the cached descriptor sets that bind a buffer being destroyed,
+// so that a new buffer that happens to get the same handle can't match
+// them.
+WEAK void forget_descriptor_sets(VkBuffer buffer) {
+    ScopedMutexLock lock(&modules_lock);
+    for (VulkanModule *m = modules; m; m = m->next) {
+        for (VulkanPipeline *p = m->pipelines; p; p = p->next) {
+            for (int i = 0; i < descriptor_set_cache_size; i++) {
+                const VkDescriptorBufferInfo *b = p->bindings + i * p->num_buffers;
+                for (int j = 0; p->set_valid[i] && j < p->num_buffers; j++) {
+                    if (b[j].buffer == buffer) {
+                        p->set_valid[i] = false;
+                    }
+                }
+            }
+        }
+    }
+}
+
+WEAK uint64_t allocate_pool_block(void *user_context, void *device_context, size_t size) {
+    debug(user_context) << "    allocate Vulkan block -> " << (uint64_t)size << " ";
+    VulkanBlock *block = create_block(user_context, (VkDevice)device_context, size,
+                                      VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                          VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                      0, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    debug(user_context) << (void *)block << "\n";
+    return (uint64_t)block;
+}
+
+WEAK void free_pool_block(void *user_context, void *device_context, uint64_t block) {
+    debug(user_context) << "    free Vulkan block " << (void *)block << "\n";
+    forget_descriptor_sets(((VulkanBlock *)block)->buffer);
+    destroy_block((VkDevice)device_context, (VulkanBlock *)block);
+}
+
+// Recycles VulkanBlocks, each a VkBuffer and its memory, while
+// allocation caching is on. Descriptor sets can bind a buffer at any
+// multiple of minStorageBufferOffsetAlignment, which is at most 256
+// bytes, so small requests are carved out of shared blocks.
+WEAK DeviceMemoryPool memory_pool = {{}, allocate_pool_block, free_pool_block, 32 * 1024 * 1024, 4 * 1024 * 1024, 256, false};
+
+WEAK __attribute__((constructor)) void register_vulkan_allocation_pool() {
+    device_memory_pool_register(&memory_pool, &vulkan_device_interface);
+}
+
+// Create the command buffer and get the properties Halide needs for a
+// device, which may have been created by the application.
+WEAK int init_device_state(void *user_context, VkPhysicalDevice phys, VkDevice dev, uint32_t family) {
+    if (device_state.device == dev) {
+        return 0;
+    }
+    if (device_state.device != nullptr) {
+        error(user_context) << "Vulkan: halide_vulkan_acquire_context returned a new device. "
+                            << "Call halide_device_release before changing devices.\n";
+        return halide_error_code_device_interface_no_device;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(phys, &props);
+    vkGetPhysicalDeviceMemoryProperties(phys, &device_state.memory_properties);
+    device_state.storage_buffer_offset_alignment = props.limits.minStorageBufferOffsetAlignment;
+    if (device_state.storage_buffer_offset_alignment == 0) {
+        device_state.storage_buffer_offset_alignment = 1;
+    }
+    device_state.api_version = props.apiVersion;
+
+    // The pipeline cache data has a header identifying the device and
+    // driver, but describing it in the cache key avoids even loading
+    // data for another device.
+    char *dst = device_state.device_id;
+    char *end = dst + sizeof(device_state.device_id);
+    dst = halide_string_to_string(dst, end, props.deviceName);
+    dst = halide_string_to_string(dst, end, " / ");
+    dst = halide_uint64_to_string(dst, end, props.vendorID, 1);
+    dst = halide_string_to_string(dst, end, ":");
+    dst = halide_uint64_to_string(dst, end, props.deviceID, 1);
+    dst = halide_string_to_string(dst, end, " / ");
+    dst = halide_uint64_to_string(dst, end, props.driverVersion, 1);
+    dst = halide_string_to_string(dst, end, " / ");
+    for (int i = 0; i < VK_UUID_SIZE; i++) {
+        dst = halide_uint64_to_string(dst, end, props.pipelineCacheUUID[i], 3);
+    }
+
+    VkCommandPoolCreateInfo pool_info = {
+        VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
+        nullptr,
+        VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT,
+        family};
+    VkResult err = vkCreateCommandPool(dev, &pool_info, nullptr, &device_state.command_pool);
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateCommandPool failed: " << get_vulkan_error_name(err);
+        return err;
+    }
+
+    VkCommandBufferAllocateInfo command_buffer_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
+        nullptr,
+        device_state.command_pool,
+        VK_COMMAND_BUFFER_LEVEL_PRIMARY,
+        1};
+    err = vkAllocateCommandBuffers(dev, &command_buffer_info, &device_state.command_buffer);
+    if (err == VK_SUCCESS) {
+        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+        err = vkCreateFence(dev, &fence_info, nullptr, &device_state.fence);
+    }
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: failed to create the command buffer: " << get_vulkan_error_name(err);
+        vkDestroyCommandPool(dev, device_state.command_pool, nullptr);
+        device_state.command_pool = 0;
+        return err;
+    }
+
+    device_state.device = dev;
+    return 0;
+}
+
+WEAK void release_device_state() {
+    VkDevice dev = device_state.device;
+    if (dev == nullptr) {
+        return;
+    }
+    destroy_block(dev, device_state.staging);
+    vkDestroyFence(dev, device_state.fence, nullptr);
+    // Destroying the pool frees the command buffer.
+    vkDestroyCommandPool(dev, device_state.command_pool, nullptr);
+    memset(&device_state, 0, sizeof(device_state));
+}
+
+}  // namespace Vulkan
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+using namespace Halide::Runtime::Internal::Vulkan;
+
+extern "C" {
+
+// The default implementation of halide_vulkan_acquire_context uses the global
+// pointers above, and serializes access with a spin lock.
+// Overriding implementations of acquire/release must implement the following
+// behavior:
+// - halide_vulkan_acquire_context should always store a valid instance,
+//   physical device, device and queue, or return an error code.
+// - A call to halide_vulkan_acquire_context is followed by a matching call to
+//   halide_vulkan_release_context. halide_vulkan_acquire_context should block
+//   while a previous call (if any) has not yet been released via
+//   halide_vulkan_release_context.
+WEAK int halide_vulkan_acquire_context(void *user_context,
+                                       halide_vulkan_instance **instance_ptr,
+                                       halide_vulkan_physical_device **physical_device_ptr,
+                                       halide_vulkan_device **device_ptr,
+                                       halide_vulkan_queue **queue_ptr,
+                                       uint32_t *queue_family_index_ptr,
+                                       bool create) {
+    halide_abort_if_false(user_context, instance_ptr != nullptr);
+    halide_abort_if_false(user_context, physical_device_ptr != nullptr);
+    halide_abort_if_false(user_context, device_ptr != nullptr);
+    halide_abort_if_false(user_context, queue_ptr != nullptr);
+    halide_abort_if_false(user_context, queue_family_index_ptr != nullptr);
+
+    halide_abort_if_false(user_context, &thread_lock != nullptr);
+    while (__atomic_test_and_set(&thread_lock, __ATOMIC_ACQUIRE)) {
+    }
+
+    // If the device has not been initialized, initialize it now.
+    if (!device && create) {
+        int error = create_vulkan_context(user_context);
+        if (error != VK_SUCCESS) {
+            __atomic_clear(&thread_lock, __ATOMIC_RELEASE);
+            return error;
+        }
+    }
+
+    *instance_ptr = (halide_vulkan_instance *)instance;
+    *physical_device_ptr = (halide_vulkan_physical_device *)physical_device;
+    *device_ptr = (halide_vulkan_device *)device;
+    *queue_ptr = (halide_vulkan_queue *)queue;
+    *queue_family_index_ptr = queue_family_index;
+    return 0;
+}
+
+WEAK int halide_vulkan_release_context(void *user_context) {
+    __atomic_clear(&thread_lock, __ATOMIC_RELEASE);
+    return 0;
+}
+
+}  // extern "C"
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Vulkan {
+
+// Helper object to acquire and release the Vulkan context.
+class VulkanContext {
+    void *user_context;
+
+public:
+    VkInstance instance;
+    VkPhysicalDevice physical_device;
+    VkDevice device;
+    VkQueue queue;
+    uint32_t queue_family_index;
+    int error_code;
+
+    // Constructor sets 'error_code' if any occurs.
+    ALWAYS_INLINE VulkanContext(void *user_context)
+        : user_context(user_context),
+          instance(nullptr),
+          physical_device(nullptr),
+          device(nullptr),
+          queue(nullptr),
+          queue_family_index(0),
+          error_code(VK_SUCCESS) {
+        if (vkCreateInstance == nullptr) {
+            load_libvulkan(user_context);
+        }
+
+#ifdef DEBUG_RUNTIME
+        halide_start_clock(user_context);
+#endif
+
+        error_code = halide_vulkan_acquire_context(user_context,
+                                                   (halide_vulkan_instance **)&instance,
+                                                   (halide_vulkan_physical_device **)&physical_device,
+                                                   (halide_vulkan_device **)&device,
+                                                   (halide_vulkan_queue **)&queue,
+                                                   &queue_family_index,
+                                                   true);
+        if (error_code != VK_SUCCESS) {
+            return;
+        }
+        // don't abort: that would prevent host_supports_device_api() from being able work properly.
+        if (!physical_device || !device || !queue) {
+            error(user_context) << "Vulkan: null device or queue";
+            error_code = -1;
+            return;
+        }
+        error_code = init_device_state(user_context, physical_device, device, queue_family_index);
+    }
+
+    ALWAYS_INLINE ~VulkanContext() {
+        halide_vulkan_release_context(user_context);
+    }
+};
+
+// Start recording commands into the device's command buffer, after
+// making the writes of earlier commands visible to them.
+WEAK VkResult begin_commands() {
+    VkCommandBuffer cb = device_state.command_buffer;
+    VkResult err = vkResetCommandBuffer(cb, 0);
+    if (err != VK_SUCCESS) {
+        return err;
+    }
+    VkCommandBufferBeginInfo begin_info = {
+        VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
+        nullptr,
+        VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT,
+        nullptr};
+    err = vkBeginCommandBuffer(cb, &begin_info);
+    if (err != VK_SUCCESS) {
+        return err;
+    }
+    VkMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        nullptr,
+        VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT};
+    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    return VK_SUCCESS;
+}
+
+// Submit the commands recorded since begin_commands, and wait for them
+// to complete, with their writes visible to the host.
+WEAK VkResult submit_commands_and_wait(VkDevice dev, VkQueue q) {
+    VkCommandBuffer cb = device_state.command_buffer;
+    VkMemoryBarrier barrier = {
+        VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        nullptr,
+        VK_ACCESS_MEMORY_WRITE_BIT,
+        VK_ACCESS_HOST_READ_BIT};
+    vkCmdPipelineBarrier(cb, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    VkResult err = vkEndCommandBuffer(cb);
+    if (err != VK_SUCCESS) {
+        return err;
+    }
+    err = vkResetFences(dev, 1, &device_state.fence);
+    if (err != VK_SUCCESS) {
+        return err;
+    }
+    VkSubmitInfo submit_info = {
+        VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        nullptr,
+        0, nullptr, nullptr,
+        1, &cb,
+        0, nullptr};
+    err = vkQueueSubmit(q, 1, &submit_info, device_state.fence);
+    if (err != VK_SUCCESS) {
+        return err;
+    }
+    return vkWaitForFences(dev, 1, &device_state.fence, VK_TRUE, ~0ULL);
+}
+
+// Make sure the staging buffer holds at least size bytes.
+WEAK VulkanBlock *get_staging_buffer(void *user_context, VkDevice dev, VkDeviceSize size) {
+    VulkanBlock *staging = device_state.staging;
+    if (staging && staging->size >= size) {
+        return staging;
+    }
+    if (staging) {
+        size = size > 2 * staging->size ? size : 2 * staging->size;
+        destroy_block(dev, staging);
+        device_state.staging = nullptr;
+    }
+    debug(user_context) << "    allocating Vulkan staging buffer of " << (uint64_t)size << " bytes\n";
+    // Host cached memory makes reading back from the device much faster.
+    device_state.staging = create_block(user_context, dev, size,
+                                        VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                        VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    return device_state.staging;
+}
+
+// Call f(src_offset, dst_offset) for each contiguous chunk of a copy,
+// in order.
+template<typename F>
+void for_each_copy_chunk(const device_copy &c, int d, uint64_t src_off, uint64_t dst_off, F &f) {
+    // Skip size-1 dimensions
+    while (d >= 0 && c.extent[d] == 1) {
+        d--;
+    }
+
+    if (d == -1) {
+        f(src_off, dst_off);
+    } else {
+        for (uint64_t i = 0; i < c.extent[d]; i++) {
+            for_each_copy_chunk(c, d - 1, src_off, dst_off, f);
+            src_off += c.src_stride_bytes[d];
+            dst_off += c.dst_stride_bytes[d];
+        }
+    }
+}
+
+// Batches the regions of a copy between two buffers into as few
+// vkCmdCopyBuffer commands as possible.
+struct CopyRegions {
+    VkCommandBuffer cb;
+    VkBuffer src, dst;
+    uint32_t count;
+    VkBufferCopy regions[64];
+
+    ALWAYS_INLINE void add(uint64_t src_offset, uint64_t dst_offset, uint64_t size) {
+        regions[count++] = {src_offset, dst_offset, size};
+        if (count == sizeof(regions) / sizeof(regions[0])) {
+            flush();
+        }
+    }
+
+    ALWAYS_INLINE void flush() {
+        if (count) {
+            vkCmdCopyBuffer(cb, src, dst, count, regions);
+            count = 0;
+        }
+    }
+};
+
+WEAK int vulkan_do_multidimensional_copy(void *user_context, VulkanContext &ctx, const device_copy &c,
+                                         bool from_host, bool to_host) {
+    if (from_host && to_host) {
+        copy_memory(c, user_context);
+        return 0;
+    }
+
+    uint64_t total_size = c.chunk_size;
+    for (int d = 0; d < MAX_COPY_DIMS; d++) {
+        total_size *= c.extent[d];
+    }
+    if (total_size == 0) {
+        return 0;
+    }
+
+    VulkanBlock *staging = nullptr;
+    if (from_host || to_host) {
+        staging = get_staging_buffer(user_context, ctx.device, total_size);
+        if (staging == nullptr) {
+            error(user_context) << "Vulkan: failed to allocate a staging buffer of " << total_size << " bytes\n";
+            return halide_error_code_out_of_memory;
+        }
+    }
+
+    VkResult err = begin_commands();
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: failed to begin commands: " << get_vulkan_error_name(err);
+        return err;
+    }
+
+    // The chunks are packed in order into the staging buffer.
+    const device_handle *src_handle = from_host ? nullptr : (const device_handle *)c.src;
+    const device_handle *dst_handle = to_host ? nullptr : (const device_handle *)c.dst;
+    CopyRegions regions;
+    regions.cb = device_state.command_buffer;
+    regions.src = src_handle ? src_handle->block->buffer : staging->buffer;
+    regions.dst = dst_handle ? dst_handle->block->buffer : staging->buffer;
+    regions.count = 0;
+    uint64_t packed = 0;
+    auto record = [&](uint64_t src_off, uint64_t dst_off) {
+        uint64_t src_offset = src_handle ? src_handle->offset + src_off : packed;
+        uint64_t dst_offset = dst_handle ? dst_handle->offset + dst_off : packed;
+        if (from_host) {
+            memcpy((uint8_t *)staging->mapped + packed, (const uint8_t *)c.src + src_off, c.chunk_size);
+        }
+        regions.add(src_offset, dst_offset, c.chunk_size);
+        packed += c.chunk_size;
+    };
+    for_each_copy_chunk(c, MAX_COPY_DIMS - 1, c.src_begin, 0, record);
+    regions.flush();
+
+    err = submit_commands_and_wait(ctx.device, ctx.queue);
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: copy failed: " << get_vulkan_error_name(err);
+        return err;
+    }
+
+    if (to_host) {
+        packed = 0;
+        auto unpack = [&](uint64_t src_off, uint64_t dst_off) {
+            memcpy((uint8_t *)c.dst + dst_off, (const uint8_t *)staging->mapped + packed, c.chunk_size);
+            packed += c.chunk_size;
+        };
+        for_each_copy_chunk(c, MAX_COPY_DIMS - 1, c.src_begin, 0, unpack);
+    }
+    return 0;
+}
+
+// Widen a scalar argument to its 32-bit slot in the uniform buffer.
+WEAK uint32_t pack_scalar_arg(halide_type_t t, const void *arg) {
+    if (t.code == halide_type_int) {
+        switch (t.bits) {
+        case 8:
+            return (uint32_t)(int32_t) * (const int8_t *)arg;
+        case 16:
+            return (uint32_t)(int32_t) * (const int16_t *)arg;
+        default:
+            return *(const uint32_t *)arg;
+        }
+    }
+    switch (t.bits) {
+    case 1:
+        return *(const uint8_t *)arg ? 1 : 0;
+    case 8:
+        return *(const uint8_t *)arg;
+    case 16:
+        // Unsigned ints, and the bits of float16s.
+        return *(const uint16_t *)arg;
+    default:
+        return *(const uint32_t *)arg;
+    }
+}
+
+WEAK void destroy_pipeline(VkDevice dev, VulkanPipeline *p) {
+    if (p->pipeline) {
+        vkDestroyPipeline(dev, p->pipeline, nullptr);
+    }
+    if (p->layout) {
+        vkDestroyPipelineLayout(dev, p->layout, nullptr);
+    }
+    if (p->set_layout) {
+        vkDestroyDescriptorSetLayout(dev, p->set_layout, nullptr);
+    }
+    if (p->descriptor_pool) {
+        // Destroying the pool frees its sets.
+        vkDestroyDescriptorPool(dev, p->descriptor_pool, nullptr);
+    }
+    destroy_block(dev, p->scalar_args);
+    free(p->bindings);
+    free(p->entry_name);
+    free(p);
+}
+
+// Store the pipeline cache of a module in the GPU kernel cache.
+WEAK void save_pipeline_cache(void *user_context, VulkanModule *module) {
+    size_t data_size = 0;
+    if (vkGetPipelineCacheData(module->device, module->pipeline_cache, &data_size, nullptr) != VK_SUCCESS ||
+        data_size == 0) {
+        return;
+    }
+    void *data = malloc(data_size);
+    if (!data) {
+        return;
+    }
+    if (vkGetPipelineCacheData(module->device, module->pipeline_cache, &data_size, data) == VK_SUCCESS) {
+        gpu_kernel_cache_save(user_context, "vulkan", device_state.device_id, module->src, module->size, data, data_size);
+    }
+    free(data);
+}
+
+// Create the pipeline for an entry point of a module, with scalar
+// arguments in a uniform buffer at binding 0, and buffer arguments in
+// storage buffers at the following bindings.
+WEAK VulkanPipeline *create_pipeline(void *user_context, VulkanModule *module, const char *entry_name,
+                                     int num_scalars, int num_buffers) {
+    VkDevice dev = module->device;
+    VulkanPipeline *p = (VulkanPipeline *)malloc(sizeof(VulkanPipeline));
+    if (p == nullptr) {
+        return nullptr;
+    }
+    memset(p, 0, sizeof(VulkanPipeline));
+    p->num_scalars = num_scalars;
+    p->num_buffers = num_buffers;
+
+    size_t name_size = strlen(entry_name) + 1;
+    p->entry_name = (char *)malloc(name_size);
+    p->bindings = (VkDescriptorBufferInfo *)malloc((descriptor_set_cache_size + 1) * num_buffers * sizeof(VkDescriptorBufferInfo) + 1);
+    VkDescriptorSetLayoutBinding *layout_bindings =
+        (VkDescriptorSetLayoutBinding *)malloc((num_buffers + 1) * sizeof(VkDescriptorSetLayoutBinding));
+    if (p->entry_name == nullptr || p->bindings == nullptr || layout_bindings == nullptr) {
+        free(layout_bindings);
+        destroy_pipeline(dev, p);
+        return nullptr;
+    }
+    memcpy(p->entry_name, entry_name, name_size);
+
+    uint32_t num_bindings = 0;
+    if (num_scalars) {
+        layout_bindings[num_bindings++] = {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    }
+    for (int i = 0; i < num_buffers; i++) {
+        layout_bindings[num_bindings++] = {(uint32_t)(1 + i), VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    }
+
+    VkDescriptorSetLayoutCreateInfo set_layout_info = {
+        VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        nullptr,
+        0,
+        num_bindings,
+        layout_bindings};
+    VkResult err = vkCreateDescriptorSetLayout(dev, &set_layout_info, nullptr, &p->set_layout);
+    free(layout_bindings);
+
+    if (err == VK_SUCCESS) {
+        VkPipelineLayoutCreateInfo layout_info = {
+            VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+            nullptr,
+            0,
+            1, &p->set_layout,
+            0, nullptr};
+        err = vkCreatePipelineLayout(dev, &layout_info, nullptr, &p->layout);
+    }
+
+    if (err == VK_SUCCESS) {
+        debug(user_context) << "    vkCreateComputePipelines " << entry_name << " -> ";
+        VkComputePipelineCreateInfo pipeline_info = {
+            VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+            nullptr,
+            0,
+            {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+             nullptr,
+             0,
+             VK_SHADER_STAGE_COMPUTE_BIT,
+             module->shader,
+             entry_name,
+             nullptr},
+            p->layout,
+            0,
+            -1};
+        err = vkCreateComputePipelines(dev, module->pipeline_cache, 1, &pipeline_info, nullptr, &p->pipeline);
+        debug(user_context) << get_vulkan_error_name(err) << "\n";
+    }
+
+    if (err == VK_SUCCESS && num_bindings > 0) {
+        VkDescriptorPoolSize pool_sizes[2];
+        uint32_t num_pool_sizes = 0;
+        if (num_scalars) {
+            pool_sizes[num_pool_sizes++] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, descriptor_set_cache_size};
+        }
+        if (num_buffers) {
+            pool_sizes[num_pool_sizes++] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, (uint32_t)(descriptor_set_cache_size * num_buffers)};
+        }
+        VkDescriptorPoolCreateInfo pool_info = {
+            VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+            nullptr,
+            0,
+            descriptor_set_cache_size,
+            num_pool_sizes,
+            pool_sizes};
+        err = vkCreateDescriptorPool(dev, &pool_info, nullptr, &p->descriptor_pool);
+        if (err == VK_SUCCESS) {
+            VkDescriptorSetLayout set_layouts[descriptor_set_cache_size];
+            for (int i = 0; i < descriptor_set_cache_size; i++) {
+                set_layouts[i] = p->set_layout;
+            }
+            VkDescriptorSetAllocateInfo alloc_info = {
+                VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+                nullptr,
+                p->descriptor_pool,
+                descriptor_set_cache_size,
+                set_layouts};
+            err = vkAllocateDescriptorSets(dev, &alloc_info, p->sets);
+        }
+    }
+
+    if (err == VK_SUCCESS && num_scalars) {
+        // The scalar arguments never move, so they are bound once.
+        p->scalar_args = create_block(user_context, dev, num_scalars * sizeof(uint32_t),
+                                      VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (p->scalar_args == nullptr) {
+            err = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        } else {
+            VkDescriptorBufferInfo scalar_info = {p->scalar_args->buffer, 0, VK_WHOLE_SIZE};
+            for (int i = 0; i < descriptor_set_cache_size; i++) {
+                VkWriteDescriptorSet write = {
+                    VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    nullptr,
+                    p->sets[i],
+                    0, 0, 1,
+                    VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                    nullptr, &scalar_info, nullptr};
+                vkUpdateDescriptorSets(dev, 1, &write, 0, nullptr);
+            }
+        }
+    }
+
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: failed to create the pipeline for " << entry_name
+                            << ": " << get_vulkan_error_name(err);
+        destroy_pipeline(dev, p);
+        return nullptr;
+    }
+
+    if (module->src) {
+        save_pipeline_cache(user_context, module);
+    }
+    return p;
+}
+
+// Get the descriptor set binding the given buffers, which are in the
+// current bindings of the pipeline, writing a new one if none of the
+// cached sets match.
+WEAK VkDescriptorSet get_descriptor_set(VkDevice dev, VulkanPipeline *p) {
+    const size_t bindings_size = p->num_buffers * sizeof(VkDescriptorBufferInfo);
+    VkDescriptorBufferInfo *current = p->bindings + descriptor_set_cache_size * p->num_buffers;
+
+    ScopedMutexLock lock(&modules_lock);
+    for (int i = 0; i < descriptor_set_cache_size; i++) {
+        if (p->set_valid[i] && memcmp(p->bindings + i * p->num_buffers, current, bindings_size) == 0) {
+            return p->sets[i];
+        }
+    }
+
+    int i = p->next_victim;
+    p->next_victim = (i + 1) % descriptor_set_cache_size;
+    for (int j = 0; j < p->num_buffers; j++) {
+        VkWriteDescriptorSet write = {
+            VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            nullptr,
+            p->sets[i],
+            (uint32_t)(1 + j), 0, 1,
+            VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            nullptr, current + j, nullptr};
+        vkUpdateDescriptorSets(dev, 1, &write, 0, nullptr);
+    }
+    memcpy(p->bindings + i * p->num_buffers, current, bindings_size);
+    p->set_valid[i] = true;
+    return p->sets[i];
+}
+
+WEAK VulkanModule *compile_kernel(void *user_context, VkDevice dev, const char *src, int size) {
+    if (size <= 0 || (size % 4) != 0) {
+        error(user_context) << "Vulkan: invalid SPIR-V module of " << size << " bytes\n";
+        return nullptr;
+    }
+
+    VulkanModule *module = (VulkanModule *)malloc(sizeof(VulkanModule));
+    if (module == nullptr) {
+        return nullptr;
+    }
+    memset(module, 0, sizeof(VulkanModule));
+    module->device = dev;
+    module->size = size;
+
+    // vkCreateShaderModule needs the words aligned.
+    module->src = (char *)malloc(size);
+    if (module->src == nullptr) {
+        free(module);
+        return nullptr;
+    }
+    memcpy(module->src, src, size);
+
+    VkShaderModuleCreateInfo shader_info = {
+        VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        nullptr,
+        0,
+        (size_t)size,
+        (const uint32_t *)module->src};
+    debug(user_context) << "    vkCreateShaderModule -> ";
+    VkResult err = vkCreateShaderModule(dev, &shader_info, nullptr, &module->shader);
+    debug(user_context) << get_vulkan_error_name(err) << "\n";
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateShaderModule failed: " << get_vulkan_error_name(err);
+        free(module->src);
+        free(module);
+        return nullptr;
+    }
+
+    // Start from the pipelines compiled by an earlier run, if the GPU
+    // kernel cache has them.
+    const bool use_kernel_cache = halide_get_gpu_kernel_cache_dir(user_context) != nullptr;
+    size_t data_size = 0;
+    void *data = use_kernel_cache ? gpu_kernel_cache_load(user_context, "vulkan", device_state.device_id, src, size, &data_size) : nullptr;
+    VkPipelineCacheCreateInfo cache_info = {
+        VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+        nullptr,
+        0,
+        data_size,
+        data};
+    err = vkCreatePipelineCache(dev, &cache_info, nullptr, &module->pipeline_cache);
+    if (err != VK_SUCCESS && data) {
+        // Stale data is expected after driver updates; just start empty.
+        cache_info.initialDataSize = 0;
+        cache_info.pInitialData = nullptr;
+        err = vkCreatePipelineCache(dev, &cache_info, nullptr, &module->pipeline_cache);
+    }
+    free(data);
+    if (err != VK_SUCCESS) {
+        module->pipeline_cache = 0;
+    }
+
+    if (!use_kernel_cache) {
+        free(module->src);
+        module->src = nullptr;
+    }
+
+    ScopedMutexLock lock(&modules_lock);
+    module->next = modules;
+    modules = module;
+    return module;
+}
+
+WEAK void free_module(VulkanModule *module) {
+    {
+        ScopedMutexLock lock(&modules_lock);
+        for (VulkanModule **prev = &modules; *prev; prev = &(*prev)->next) {
+            if (*prev == module) {
+                *prev = module->next;
+                break;
+            }
+        }
+    }
+    VkDevice dev = module->device;
+    while (module->pipelines) {
+        VulkanPipeline *p = module->pipelines;
+        module->pipelines = p->next;
+        destroy_pipeline(dev, p);
+    }
+    if (module->pipeline_cache) {
+        vkDestroyPipelineCache(dev, module->pipeline_cache, nullptr);
+    }
+    vkDestroyShaderModule(dev, module->shader, nullptr);
+    free(module->src);
+    free(module);
+}
+
+}  // namespace Vulkan
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK int halide_vulkan_device_free(void *user_context, halide_buffer_t *buf) {
+    // halide_vulkan_device_free, at present, can be exposed to clients and they
+    // should be allowed to call halide_vulkan_device_free on any halide_buffer_t
+    // including ones that have never been used with a GPU.
+    if (buf->device == 0) {
+        return 0;
+    }
+
+    device_handle *dev_handle = (device_handle *)buf->device;
+    VulkanBlock *block = dev_handle->block;
+
+    debug(user_context)
+        << "Vulkan: halide_vulkan_device_free (user_context: " << user_context
+        << ", buf: " << buf << ") block: " << block << "\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    if (device_memory_pool_reclaim(user_context, &memory_pool, ctx.device, (uint64_t)block, dev_handle->offset)) {
+        debug(user_context) << "    returned " << block << " to the pool\n";
+    } else {
+        debug(user_context) << "    vkDestroyBuffer " << block << "\n";
+        forget_descriptor_sets(block->buffer);
+        destroy_block(ctx.device, block);
+    }
+    free(dev_handle);
+    buf->device = 0;
+    buf->device_interface->impl->release_module();
+    buf->device_interface = nullptr;
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+
+    return 0;
+}
+
+WEAK int halide_vulkan_compute_capability(void *user_context, int *major, int *minor) {
+    if (!lib_vulkan) {
+        // If Vulkan can't be found, we want to return 0, 0 and it's not
+        // considered an error. So we should be very careful about
+        // looking for Vulkan without tripping any errors in the rest
+        // of this runtime.
+        void *sym = halide_vulkan_get_symbol(user_context, "vkCreateInstance");
+        if (!sym) {
+            *major = *minor = 0;
+            return 0;
+        }
+    }
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+    *major = VK_VERSION_MAJOR(device_state.api_version);
+    *minor = VK_VERSION_MINOR(device_state.api_version);
+    return 0;
+}
+
+WEAK int halide_vulkan_initialize_kernels(void *user_context, void **state_ptr, const char *src, int size) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_initialize_kernels (user_context: " << user_context
+        << ", state_ptr: " << state_ptr
+        << ", program: " << (void *)src
+        << ", size: " << size << "\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    VulkanModule *module;
+    if (!compilation_cache.kernel_state_setup(user_context, state_ptr, ctx.device, module,
+                                              compile_kernel, user_context, ctx.device, src, size)) {
+        return halide_error_code_generic_error;
+    }
+    halide_abort_if_false(user_context, module != nullptr);
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+    return 0;
+}
+
+WEAK void halide_vulkan_finalize_kernels(void *user_context, void *state_ptr) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_finalize_kernels (user_context: " << user_context
+        << ", state_ptr: " << state_ptr << "\n";
+    VulkanContext ctx(user_context);
+    if (ctx.error_code == VK_SUCCESS) {
+        compilation_cache.release_hold(user_context, ctx.device, state_ptr);
+    }
+}
+
+// Used to generate correct timings when tracing
+WEAK int halide_vulkan_device_sync(void *user_context, halide_buffer_t *) {
+    debug(user_context) << "Vulkan: halide_vulkan_device_sync (user_context: " << user_context << ")\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    // Halide's own commands are complete already, but the queue may be
+    // shared with the application.
+    VkResult err = vkQueueWaitIdle(ctx.queue);
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkQueueWaitIdle failed: "
+                            << get_vulkan_error_name(err);
+        return err;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+
+    return VK_SUCCESS;
+}
+
+WEAK int halide_vulkan_device_release(void *user_context) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_device_release (user_context: " << user_context << ")\n";
+
+    // The VulkanContext object does not allow the context storage to be modified,
+    // so we use halide_vulkan_acquire_context directly.
+    VkInstance inst;
+    VkPhysicalDevice phys;
+    VkDevice dev;
+    VkQueue q;
+    uint32_t family;
+    int err = halide_vulkan_acquire_context(user_context,
+                                            (halide_vulkan_instance **)&inst,
+                                            (halide_vulkan_physical_device **)&phys,
+                                            (halide_vulkan_device **)&dev,
+                                            (halide_vulkan_queue **)&q,
+                                            &family,
+                                            false);
+    if (err != 0) {
+        return err;
+    }
+
+    if (dev) {
+        err = vkQueueWaitIdle(q);
+        halide_abort_if_false(user_context, err == VK_SUCCESS);
+
+        compilation_cache.delete_context(user_context, dev, free_module);
+
+        device_memory_pool_trim(user_context, &memory_pool, dev);
+
+        if (device_state.device == dev) {
+            release_device_state();
+        }
+
+        // Release the device itself, if we created it.
+        if (dev == device) {
+            // Any buffers still allocated from the pool are freed with
+            // the device.
+            device_memory_pool_forget(user_context, &memory_pool, dev);
+
+            debug(user_context) << "    vkDestroyDevice " << (void *)device << "\n";
+            vkDestroyDevice(device, nullptr);
+            device = nullptr;
+            queue = nullptr;
+            physical_device = nullptr;
+
+            debug(user_context) << "    vkDestroyInstance " << (void *)instance << "\n";
+            vkDestroyInstance(instance, nullptr);
+            instance = nullptr;
+        }
+    }
+
+    halide_vulkan_release_context(user_context);
+
+    return 0;
+}
+
+WEAK int halide_vulkan_device_malloc(void *user_context, halide_buffer_t *buf) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_device_malloc (user_context: " << user_context
+        << ", buf: " << buf << ")\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+
+    size_t size = buf->size_in_bytes();
+    halide_abort_if_false(user_context, size != 0);
+    if (buf->device) {
+        halide_abort_if_false(user_context, ((device_handle *)buf->device)->block->size >= size);
+        return 0;
+    }
+
+    for (int i = 0; i < buf->dimensions; i++) {
+        halide_abort_if_false(user_context, buf->dim[i].stride >= 0);
+    }
+
+    debug(user_context) << "    allocating " << *buf << "\n";
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    if (dev_handle == nullptr) {
+        return halide_error_code_out_of_memory;
+    }
+
+    VulkanBlock *block = nullptr;
+    uint64_t offset = 0;
+    if (halide_can_reuse_device_allocations(user_context)) {
+        uint64_t pool_block = 0;
+        int result = device_memory_pool_reserve(user_context, &memory_pool, ctx.device, ctx.queue,
+                                                size, &pool_block, &offset);
+        if (result != 0) {
+            error(user_context) << "Vulkan: Failed to allocate " << (uint64_t)size << " bytes from the device memory pool\n";
+            free(dev_handle);
+            return result;
+        }
+        block = (VulkanBlock *)pool_block;
+        debug(user_context) << "    allocated " << block << " + " << offset << " from the pool, device_handle: " << dev_handle << "\n";
+    } else {
+        block = (VulkanBlock *)allocate_pool_block(user_context, ctx.device, size);
+        if (block == nullptr) {
+            error(user_context) << "Vulkan: Failed to allocate " << (uint64_t)size << " bytes of device memory\n";
+            free(dev_handle);
+            return halide_error_code_device_malloc_failed;
+        }
+        debug(user_context) << "    device_handle: " << dev_handle << "\n";
+    }
+
+    dev_handle->block = block;
+    dev_handle->offset = offset;
+    buf->device = (uint64_t)dev_handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+
+    debug(user_context)
+        << "    Allocated device buffer " << (void *)buf->device
+        << " for buffer " << buf << "\n";
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+
+    return VK_SUCCESS;
+}
+
+WEAK int halide_vulkan_buffer_copy(void *user_context, struct halide_buffer_t *src,
+                                   const struct halide_device_interface_t *dst_device_interface,
+                                   struct halide_buffer_t *dst) {
+    // We only handle copies to vulkan or to host
+    halide_abort_if_false(user_context, dst_device_interface == nullptr ||
+                                            dst_device_interface == &vulkan_device_interface);
+
+    if ((src->device_dirty() || src->host == nullptr) &&
+        src->device_interface != &vulkan_device_interface) {
+        halide_abort_if_false(user_context, dst_device_interface == &vulkan_device_interface);
+        // This is handled at the higher level.
+        return halide_error_code_incompatible_device_interface;
+    }
+
+    bool from_host = (src->device_interface != &vulkan_device_interface) ||
+                     (src->device == 0) ||
+                     (src->host_dirty() && src->host != nullptr);
+    bool to_host = !dst_device_interface;
+
+    halide_abort_if_false(user_context, from_host || src->device);
+    halide_abort_if_false(user_context, to_host || dst->device);
+
+    device_copy c = make_buffer_copy(src, from_host, dst, to_host);
+
+    int err = 0;
+    {
+        VulkanContext ctx(user_context);
+        if (ctx.error_code != VK_SUCCESS) {
+            return ctx.error_code;
+        }
+
+        debug(user_context)
+            << "Vulkan: halide_vulkan_buffer_copy (user_context: " << user_context
+            << ", src: " << src << ", dst: " << dst << ")\n";
+
+#ifdef DEBUG_RUNTIME
+        uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+        err = vulkan_do_multidimensional_copy(user_context, ctx, c, from_host, to_host);
+
+#ifdef DEBUG_RUNTIME
+        uint64_t t_after = halide_current_time_ns(user_context);
+        debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+    }
+
+    return err;
+}
+
+WEAK int halide_vulkan_copy_to_device(void *user_context, halide_buffer_t *buf) {
+    return halide_vulkan_buffer_copy(user_context, buf, &vulkan_device_interface, buf);
+}
+
+WEAK int halide_vulkan_copy_to_host(void *user_context, halide_buffer_t *buf) {
+    return halide_vulkan_buffer_copy(user_context, buf, nullptr, buf);
+}
+
+WEAK int halide_vulkan_run(void *user_context,
+                           void *state_ptr,
+                           const char *entry_name,
+                           int blocksX, int blocksY, int blocksZ,
+                           int threadsX, int threadsY, int threadsZ,
+                           int shared_mem_bytes,
+                           halide_type_t arg_types[],
+                           void *args[],
+                           int8_t arg_is_buffer[]) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_run (user_context: " << user_context << ", "
+        << "entry: " << entry_name << ", "
+        << "blocks: " << blocksX << "x" << blocksY << "x" << blocksZ << ", "
+        << "threads: " << threadsX << "x" << threadsY << "x" << threadsZ << ", "
+        << "shmem: " << shared_mem_bytes << "\n";
+
+    VulkanContext ctx(user_context);
+    if (ctx.error_code != VK_SUCCESS) {
+        return ctx.error_code;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_before = halide_current_time_ns(user_context);
+#endif
+
+    VulkanModule *module = nullptr;
+    bool found = compilation_cache.lookup(ctx.device, state_ptr, module);
+    halide_abort_if_false(user_context, found && module != nullptr);
+
+    int num_args = 0, num_scalars = 0, num_buffers = 0;
+    while (arg_types[num_args].bits != 0) {
+        if (arg_is_buffer[num_args]) {
+            num_buffers++;
+        } else {
+            num_scalars++;
+        }
+        num_args++;
+    }
+
+    VulkanPipeline *p = module->pipelines;
+    while (p && strcmp(p->entry_name, entry_name) != 0) {
+        p = p->next;
+    }
+    if (p == nullptr) {
+        p = create_pipeline(user_context, module, entry_name, num_scalars, num_buffers);
+        if (p == nullptr) {
+            return halide_error_code_generic_error;
+        }
+        ScopedMutexLock lock(&modules_lock);
+        p->next = module->pipelines;
+        module->pipelines = p;
+    }
+    halide_abort_if_false(user_context, p->num_scalars == num_scalars && p->num_buffers == num_buffers);
+
+    // Nothing is running, so the arguments can be written in place.
+    uint32_t *scalar_args = p->scalar_args ? (uint32_t *)p->scalar_args->mapped : nullptr;
+    VkDescriptorBufferInfo *bindings = p->bindings + descriptor_set_cache_size * num_buffers;
+    for (int i = 0, s = 0, b = 0; i < num_args; i++) {
+        if (arg_is_buffer[i]) {
+            halide_buffer_t *buf = (halide_buffer_t *)args[i];
+            halide_abort_if_false(user_context, buf->device != 0);
+            const device_handle *handle = (const device_handle *)buf->device;
+            if (handle->offset % device_state.storage_buffer_offset_alignment) {
+                error(user_context) << "Vulkan: buffer argument " << i << " of " << entry_name
+                                    << " is at offset " << handle->offset
+                                    << ", which is not a multiple of the device's minStorageBufferOffsetAlignment of "
+                                    << device_state.storage_buffer_offset_alignment << "\n";
+                return halide_error_code_device_run_failed;
+            }
+            // Bind just the buffer's own bytes, as a whole block may be
+            // larger than maxStorageBufferRange.
+            bindings[b++] = {handle->block->buffer, handle->offset, buf->size_in_bytes()};
+        } else {
+            scalar_args[s++] = pack_scalar_arg(arg_types[i], args[i]);
+        }
+    }
+
+    VkResult err = begin_commands();
+    if (err == VK_SUCCESS) {
+        VkCommandBuffer cb = device_state.command_buffer;
+        vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_COMPUTE, p->pipeline);
+        if (num_args > 0) {
+            VkDescriptorSet set = get_descriptor_set(ctx.device, p);
+            vkCmdBindDescriptorSets(cb, VK_PIPELINE_BIND_POINT_COMPUTE, p->layout, 0, 1, &set, 0, nullptr);
+        }
+        vkCmdDispatch(cb, blocksX, blocksY, blocksZ);
+        err = submit_commands_and_wait(ctx.device, ctx.queue);
+    }
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: running " << entry_name << " failed: " << get_vulkan_error_name(err);
+        return halide_error_code_device_run_failed;
+    }
+
+#ifdef DEBUG_RUNTIME
+    uint64_t t_after = halide_current_time_ns(user_context);
+    debug(user_context) << "    Time: " << (t_after - t_before) / 1.0e6 << " ms\n";
+#endif
+    return 0;
+}
+
+WEAK int halide_vulkan_device_and_host_malloc(void *user_context, struct halide_buffer_t *buf) {
+    return halide_default_device_and_host_malloc(user_context, buf, &vulkan_device_interface);
+}
+
+WEAK int halide_vulkan_device_and_host_free(void *user_context, struct halide_buffer_t *buf) {
+    return halide_default_device_and_host_free(user_context, buf, &vulkan_device_interface);
+}
+
+WEAK int halide_vulkan_wrap_vk_buffer(void *user_context, struct halide_buffer_t *buf, uint64_t vk_buffer) {
+    halide_abort_if_false(user_context, buf->device == 0);
+    if (buf->device != 0) {
+        return -2;
+    }
+    device_handle *dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    VulkanBlock *block = (VulkanBlock *)malloc(sizeof(VulkanBlock));
+    if (dev_handle == nullptr || block == nullptr) {
+        free(dev_handle);
+        free(block);
+        return halide_error_code_out_of_memory;
+    }
+    memset(block, 0, sizeof(VulkanBlock));
+    block->buffer = (VkBuffer)vk_buffer;
+    block->size = buf->size_in_bytes();
+    block->owned = false;
+    dev_handle->block = block;
+    dev_handle->offset = 0;
+    buf->device = (uint64_t)dev_handle;
+    buf->device_interface = &vulkan_device_interface;
+    buf->device_interface->impl->use_module();
+    return 0;
+}
+
+WEAK int halide_vulkan_detach_vk_buffer(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_abort_if_false(user_context, buf->device_interface == &vulkan_device_interface);
+    device_handle *dev_handle = (device_handle *)buf->device;
+    // The application may destroy the buffer as soon as it is detached.
+    forget_descriptor_sets(dev_handle->block->buffer);
+    free(dev_handle->block);
+    free(dev_handle);
+    buf->device = 0;
+    buf->device_interface->impl->release_module();
+    buf->device_interface = nullptr;
+    return 0;
+}
+
+WEAK uintptr_t halide_vulkan_get_vk_buffer(void *user_context, halide_buffer_t *buf) {
+    if (buf->device == 0) {
+        return 0;
+    }
+    halide_abort_if_false(user_context, buf->device_interface == &vulkan_device_interface);
+    return (uintptr_t)((device_handle *)buf->device)->block->buffer;
+}
+
+namespace {
+
+WEAK int vulkan_device_crop_from_offset(void *user_context,
+                                        const struct halide_buffer_t *src,
+                                        int64_t offset,
+                                        struct halide_buffer_t *dst) {
+    dst->device_interface = src->device_interface;
+
+    device_handle *new_dev_handle = (device_handle *)malloc(sizeof(device_handle));
+    if (new_dev_handle == nullptr) {
+        error(user_context) << "Vulkan: malloc failed making device handle for crop.\n";
+        return halide_error_code_out_of_memory;
+    }
+
+    new_dev_handle->block = ((device_handle *)src->device)->block;
+    new_dev_handle->offset = ((device_handle *)src->device)->offset + offset;
+    dst->device = (uint64_t)new_dev_handle;
+
+    return 0;
+}
+
+}  // namespace
+
+WEAK int halide_vulkan_device_crop(void *user_context,
+                                   const struct halide_buffer_t *src,
+                                   struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_crop_byte_offset(src, dst);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_slice(void *user_context,
+                                    const struct halide_buffer_t *src,
+                                    int slice_dim,
+                                    int slice_pos,
+                                    struct halide_buffer_t *dst) {
+    const int64_t offset = calc_device_slice_byte_offset(src, slice_dim, slice_pos);
+    return vulkan_device_crop_from_offset(user_context, src, offset, dst);
+}
+
+WEAK int halide_vulkan_device_release_crop(void *user_context,
+                                           struct halide_buffer_t *buf) {
+    debug(user_context)
+        << "Vulkan: halide_vulkan_device_release_crop(user_context: " << user_context
+        << ", buf: " << buf << ") offset: " << ((device_handle *)buf->device)->offset << "\n";
+
+    // Crops share the block of the buffer they were made from.
+    free((device_handle *)buf->device);
+    return 0;
+}
+
+WEAK const struct halide_device_interface_t *halide_vulkan_device_interface() {
+    return &vulkan_device_interface;
+}
+
+namespace {
+WEAK __attribute__((destructor)) void halide_vulkan_cleanup() {
+    compilation_cache.release_all(nullptr, free_module);
+    halide_vulkan_device_release(nullptr);
+}
+}  // namespace
+
+}  // extern "C" linkage
+
+namespace Halide {
+namespace Runtime {
+namespace Internal {
+namespace Vulkan {
+
+WEAK bool has_device_extension(const VkExtensionProperties *extensions, uint32_t count, const char *name) {
+    for (uint32_t i = 0; i < count; i++) {
+        if (strcmp(extensions[i].extensionName, name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Create an instance, and a device with a compute queue on the most
+// capable GPU, in the global pointers above.
+WEAK int create_vulkan_context(void *user_context) {
+    debug(user_context) << "    create_vulkan_context (user_context: " << user_context << ")\n";
+
+    uint32_t api_version = VK_API_VERSION_1_0;
+    uint32_t loader_version = 0;
+    if (vkEnumerateInstanceVersion &&
+        vkEnumerateInstanceVersion(&loader_version) == VK_SUCCESS &&
+        loader_version >= VK_API_VERSION_1_1) {
+        api_version = VK_API_VERSION_1_1;
+    }
+
+    VkApplicationInfo app_info = {
+        VK_STRUCTURE_TYPE_APPLICATION_INFO,
+        nullptr,
+        "Halide", 0,
+        "Halide", 0,
+        api_version};
+    VkInstanceCreateInfo instance_info = {
+        VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
+        nullptr,
+        0,
+        &app_info,
+        0, nullptr,
+        0, nullptr};
+    VkInstance inst = nullptr;
+    VkResult err = vkCreateInstance(&instance_info, nullptr, &inst);
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateInstance failed: " << get_vulkan_error_name(err);
+        return err;
+    }
+
+    // Prefer discrete GPUs, then integrated ones.
+    VkPhysicalDevice devices[16];
+    uint32_t num_devices = sizeof(devices) / sizeof(devices[0]);
+    err = vkEnumeratePhysicalDevices(inst, &num_devices, devices);
+    if (err != VK_SUCCESS && err != VK_INCOMPLETE) {
+        num_devices = 0;
+    }
+    VkPhysicalDevice phys = nullptr;
+    uint32_t family = 0;
+    int best_score = -1;
+    for (uint32_t i = 0; i < num_devices; i++) {
+        VkQueueFamilyProperties families[16];
+        uint32_t num_families = sizeof(families) / sizeof(families[0]);
+        vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &num_families, families);
+        int compute_family = -1;
+        for (uint32_t j = 0; j < num_families; j++) {
+            if ((families[j].queueFlags & VK_QUEUE_COMPUTE_BIT) && families[j].queueCount > 0) {
+                compute_family = (int)j;
+                break;
+            }
+        }
+        if (compute_family < 0) {
+            continue;
+        }
+        VkPhysicalDeviceProperties props;
+        vkGetPhysicalDeviceProperties(devices[i], &props);
+        int score = (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)   ? 3 :
+                    (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU) ? 2 :
+                    (props.deviceType == VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU)    ? 1 :
+                                                                                   0;
+        debug(user_context) << "      device " << i << ": " << props.deviceName << "\n";
+        if (score > best_score) {
+            best_score = score;
+            phys = devices[i];
+            family = (uint32_t)compute_family;
+        }
+    }
+    if (phys == nullptr) {
+        error(user_context) << "Vulkan: no device with a compute queue found\n";
+        vkDestroyInstance(inst, nullptr);
+        return halide_error_code_device_interface_no_device;
+    }
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(phys, &props);
+    debug(user_context) << "    using device: " << props.deviceName << "\n";
+
+    // Enable the extensions the generated SPIR-V may need.
+    uint32_t num_extensions = 0;
+    vkEnumerateDeviceExtensionProperties(phys, nullptr, &num_extensions, nullptr);
+    VkExtensionProperties *extensions = (VkExtensionProperties *)malloc(num_extensions * sizeof(VkExtensionProperties) + 1);
+    if (extensions == nullptr) {
+        vkDestroyInstance(inst, nullptr);
+        return halide_error_code_out_of_memory;
+    }
+    if (vkEnumerateDeviceExtensionProperties(phys, nullptr, &num_extensions, extensions) != VK_SUCCESS) {
+        num_extensions = 0;
+    }
+    const char *wanted_extensions[] = {
+        "VK_KHR_storage_buffer_storage_class",
+        "VK_KHR_8bit_storage",
+        "VK_KHR_16bit_storage",
+        "VK_KHR_shader_float16_int8",
+    };
+    const char *enabled_extensions[4];
+    uint32_t num_enabled_extensions = 0;
+    bool have_extension[4];
+    for (int i = 0; i < 4; i++) {
+        have_extension[i] = has_device_extension(extensions, num_extensions, wanted_extensions[i]);
+        if (have_extension[i]) {
+            enabled_extensions[num_enabled_extensions++] = wanted_extensions[i];
+        }
+    }
+    free(extensions);
+
+    // Enable every supported feature, except robust buffer access, which
+    // costs bounds checks that Halide's pipelines don't need.
+    VkPhysicalDevice8BitStorageFeatures storage8 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_8BIT_STORAGE_FEATURES, nullptr, 0, 0, 0};
+    VkPhysicalDevice16BitStorageFeatures storage16 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_16BIT_STORAGE_FEATURES, nullptr, 0, 0, 0, 0};
+    VkPhysicalDeviceShaderFloat16Int8Features float16_int8 = {VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_FLOAT16_INT8_FEATURES, nullptr, 0, 0};
+    VkPhysicalDeviceFeatures2 features;
+    memset(&features, 0, sizeof(features));
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    const bool use_features2 = vkGetPhysicalDeviceFeatures2 &&
+                               api_version >= VK_API_VERSION_1_1 &&
+                               props.apiVersion >= VK_API_VERSION_1_1;
+    if (use_features2) {
+        void **next = &features.pNext;
+        if (have_extension[1]) {
+            *next = &storage8;
+            next = &storage8.pNext;
+        }
+        if (have_extension[2]) {
+            *next = &storage16;
+            next = &storage16.pNext;
+        }
+        if (have_extension[3]) {
+            *next = &float16_int8;
+            next = &float16_int8.pNext;
+        }
+        vkGetPhysicalDeviceFeatures2(phys, &features);
+    } else {
+        vkGetPhysicalDeviceFeatures(phys, &features.features);
+    }
+    // robustBufferAccess is the first feature.
+    features.features.features[0] = VK_FALSE;
+
+    float queue_priority = 1.0f;
+    VkDeviceQueueCreateInfo queue_info = {
+        VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO,
+        nullptr,
+        0,
+        family,
+        1,
+        &queue_priority};
+    VkDeviceCreateInfo device_info = {
+        VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        use_features2 ? &features : nullptr,
+        0,
+        1, &queue_info,
+        0, nullptr,
+        num_enabled_extensions, enabled_extensions,
+        use_features2 ? nullptr : &features.features};
+    VkDevice dev = nullptr;
+    err = vkCreateDevice(phys, &device_info, nullptr, &dev);
+    if (err != VK_SUCCESS) {
+        error(user_context) << "Vulkan: vkCreateDevice failed: " << get_vulkan_error_name(err);
+        vkDestroyInstance(inst, nullptr);
+        return err;
+    }
+
+    VkQueue q = nullptr;
+    vkGetDeviceQueue(dev, family, 0, &q);
+
+    instance = inst;
+    physical_device = phys;
+    device = dev;
+    queue = q;
+    queue_family_index = family;
+    return VK_SUCCESS;
+}
+
+WEAK const char *get_vulkan_error_name(VkResult err) {
+    switch (err) {
+    case VK_SUCCESS:
+        return "VK_SUCCESS";
+    case VK_NOT_READY:
+        return "VK_NOT_READY";
+    case VK_TIMEOUT:
+        return "VK_TIMEOUT";
+    case VK_EVENT_SET:
+        return "VK_EVENT_SET";
+    case VK_EVENT_RESET:
+        return "VK_EVENT_RESET";
+    case VK_INCOMPLETE:
+        return "VK_INCOMPLETE";
+    case VK_ERROR_OUT_OF_HOST_MEMORY:
+        return "VK_ERROR_OUT_OF_HOST_MEMORY";
+    case VK_ERROR_OUT_OF_DEVICE_MEMORY:
+        return "VK_ERROR_OUT_OF_DEVICE_MEMORY";
+    case VK_ERROR_INITIALIZATION_FAILED:
+        return "VK_ERROR_INITIALIZATION_FAILED";
+    case VK_ERROR_DEVICE_LOST:
+        return "VK_ERROR_DEVICE_LOST";
+    case VK_ERROR_MEMORY_MAP_FAILED:
+        return "VK_ERROR_MEMORY_MAP_FAILED";
+    case VK_ERROR_LAYER_NOT_PRESENT:
+        return "VK_ERROR_LAYER_NOT_PRESENT";
+    case VK_ERROR_EXTENSION_NOT_PRESENT:
+        return "VK_ERROR_EXTENSION_NOT_PRESENT";
+    case VK_ERROR_FEATURE_NOT_PRESENT:
+        return "VK_ERROR_FEATURE_NOT_PRESENT";
+    case VK_ERROR_INCOMPATIBLE_DRIVER:
+        return "VK_ERROR_INCOMPATIBLE_DRIVER";
+    case VK_ERROR_TOO_MANY_OBJECTS:
+        return "VK_ERROR_TOO_MANY_OBJECTS";
+    case VK_ERROR_FORMAT_NOT_SUPPORTED:
+        return "VK_ERROR_FORMAT_NOT_SUPPORTED";
+    case VK_ERROR_FRAGMENTED_POOL:
+        return "VK_ERROR_FRAGMENTED_POOL";
+    case VK_ERROR_OUT_OF_POOL_MEMORY:
+        return "VK_ERROR_OUT_OF_POOL_MEMORY";
+    default:
+        return "<Unknown error>";
+    }
+}
+
+WEAK halide_device_interface_impl_t vulkan_device_interface_impl = {
+    halide_use_jit_module,
+    halide_release_jit_module,
+    halide_vulkan_device_malloc,
+    halide_vulkan_device_free,
+    halide_vulkan_device_sync,
+    halide_vulkan_device_release,
+    halide_vulkan_copy_to_host,
+    halide_vulkan_copy_to_device,
+    halide_vulkan_device_and_host_malloc,
+    halide_vulkan_device_and_host_free,
+    halide_vulkan_buffer_copy,
+    halide_vulkan_device_crop,
+    halide_vulkan_device_slice,
+    halide_vulkan_device_release_crop,
+    halide_vulkan_wrap_vk_buffer,
+    halide_vulkan_detach_vk_buffer,
+};
+
+WEAK halide_device_interface_t vulkan_device_interface = {
+    halide_device_malloc,
+    halide_device_free,
+    halide_device_sync,
+    halide_device_release,
+    halide_copy_to_host,
+    halide_copy_to_device,
+    halide_device_and_host_malloc,
+    halide_device_and_host_free,
+    halide_buffer_copy,
+    halide_device_crop,
+    halide_device_slice,
+    halide_device_release_crop,
+    halide_device_wrap_native,
+    halide_device_detach_native,
+    halide_vulkan_compute_capability,
+    &vulkan_device_interface_impl};
+
+}  // namespace Vulkan
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
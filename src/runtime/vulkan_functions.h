@@ -0,0 +1,319 @@
+// Note that this header intentionally does not use include
+// guards. The intended usage of this file is to define the meaning of
+// the VK_FN macro, and then include this file, sometimes repeatedly
+// within the same compilation unit.
+
+// clang-format off
+
+#ifndef VK_FN
+#define VK_FN(ret, fn, args)
+#endif
+
+// Functions that only exist in Vulkan 1.1 and later loaders.
+#ifndef VK_11_FN
+#define VK_11_FN(ret, fn, args) VK_FN(ret, fn, args)
+#endif
+
+/* Instance APIs */
+VK_11_FN(VkResult,
+      vkEnumerateInstanceVersion, (uint32_t * /* pApiVersion */));
+
+VK_FN(VkResult,
+      vkCreateInstance, (const VkInstanceCreateInfo *  /* pCreateInfo */,
+                         const VkAllocationCallbacks * /* pAllocator */,
+                         VkInstance *                  /* pInstance */));
+
+VK_FN(void,
+      vkDestroyInstance, (VkInstance                    /* instance */,
+                          const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkEnumeratePhysicalDevices, (VkInstance         /* instance */,
+                                   uint32_t *         /* pPhysicalDeviceCount */,
+                                   VkPhysicalDevice * /* pPhysicalDevices */));
+
+/* Physical device APIs */
+VK_FN(void,
+      vkGetPhysicalDeviceProperties, (VkPhysicalDevice             /* physicalDevice */,
+                                      VkPhysicalDeviceProperties * /* pProperties */));
+
+VK_FN(void,
+      vkGetPhysicalDeviceMemoryProperties, (VkPhysicalDevice                   /* physicalDevice */,
+                                            VkPhysicalDeviceMemoryProperties * /* pMemoryProperties */));
+
+VK_FN(void,
+      vkGetPhysicalDeviceQueueFamilyProperties, (VkPhysicalDevice          /* physicalDevice */,
+                                                 uint32_t *                /* pQueueFamilyPropertyCount */,
+                                                 VkQueueFamilyProperties * /* pQueueFamilyProperties */));
+
+VK_FN(void,
+      vkGetPhysicalDeviceFeatures, (VkPhysicalDevice           /* physicalDevice */,
+                                    VkPhysicalDeviceFeatures * /* pFeatures */));
+
+VK_11_FN(void,
+      vkGetPhysicalDeviceFeatures2, (VkPhysicalDevice            /* physicalDevice */,
+                                     VkPhysicalDeviceFeatures2 * /* pFeatures */));
+
+VK_FN(VkResult,
+      vkEnumerateDeviceExtensionProperties, (VkPhysicalDevice        /* physicalDevice */,
+                                             const char *            /* pLayerName */,
+                                             uint32_t *              /* pPropertyCount */,
+                                             VkExtensionProperties * /* pProperties */));
+
+/* Device APIs */
+VK_FN(VkResult,
+      vkCreateDevice, (VkPhysicalDevice              /* physicalDevice */,
+                       const VkDeviceCreateInfo *    /* pCreateInfo */,
+                       const VkAllocationCallbacks * /* pAllocator */,
+                       VkDevice *                    /* pDevice */));
+
+VK_FN(void,
+      vkDestroyDevice, (VkDevice                      /* device */,
+                        const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(void,
+      vkGetDeviceQueue, (VkDevice  /* device */,
+                         uint32_t  /* queueFamilyIndex */,
+                         uint32_t  /* queueIndex */,
+                         VkQueue * /* pQueue */));
+
+/* Memory APIs */
+VK_FN(VkResult,
+      vkAllocateMemory, (VkDevice                      /* device */,
+                         const VkMemoryAllocateInfo *  /* pAllocateInfo */,
+                         const VkAllocationCallbacks * /* pAllocator */,
+                         VkDeviceMemory *              /* pMemory */));
+
+VK_FN(void,
+      vkFreeMemory, (VkDevice                      /* device */,
+                     VkDeviceMemory                /* memory */,
+                     const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkMapMemory, (VkDevice         /* device */,
+                    VkDeviceMemory   /* memory */,
+                    VkDeviceSize     /* offset */,
+                    VkDeviceSize     /* size */,
+                    VkMemoryMapFlags /* flags */,
+                    void **          /* ppData */));
+
+VK_FN(void,
+      vkUnmapMemory, (VkDevice       /* device */,
+                      VkDeviceMemory /* memory */));
+
+/* Buffer APIs */
+VK_FN(VkResult,
+      vkCreateBuffer, (VkDevice                      /* device */,
+                       const VkBufferCreateInfo *    /* pCreateInfo */,
+                       const VkAllocationCallbacks * /* pAllocator */,
+                       VkBuffer *                    /* pBuffer */));
+
+VK_FN(void,
+      vkDestroyBuffer, (VkDevice                      /* device */,
+                        VkBuffer                      /* buffer */,
+                        const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(void,
+      vkGetBufferMemoryRequirements, (VkDevice               /* device */,
+                                      VkBuffer               /* buffer */,
+                                      VkMemoryRequirements * /* pMemoryRequirements */));
+
+VK_FN(VkResult,
+      vkBindBufferMemory, (VkDevice       /* device */,
+                           VkBuffer       /* buffer */,
+                           VkDeviceMemory /* memory */,
+                           VkDeviceSize   /* memoryOffset */));
+
+/* Shader and pipeline APIs */
+VK_FN(VkResult,
+      vkCreateShaderModule, (VkDevice                         /* device */,
+                             const VkShaderModuleCreateInfo * /* pCreateInfo */,
+                             const VkAllocationCallbacks *    /* pAllocator */,
+                             VkShaderModule *                 /* pShaderModule */));
+
+VK_FN(void,
+      vkDestroyShaderModule, (VkDevice                      /* device */,
+                              VkShaderModule                /* shaderModule */,
+                              const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkCreatePipelineCache, (VkDevice                          /* device */,
+                              const VkPipelineCacheCreateInfo * /* pCreateInfo */,
+                              const VkAllocationCallbacks *     /* pAllocator */,
+                              VkPipelineCache *                 /* pPipelineCache */));
+
+VK_FN(void,
+      vkDestroyPipelineCache, (VkDevice                      /* device */,
+                               VkPipelineCache               /* pipelineCache */,
+                               const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkGetPipelineCacheData, (VkDevice        /* device */,
+                               VkPipelineCache /* pipelineCache */,
+                               size_t *        /* pDataSize */,
+                               void *          /* pData */));
+
+VK_FN(VkResult,
+      vkCreateComputePipelines, (VkDevice                            /* device */,
+                                 VkPipelineCache                     /* pipelineCache */,
+                                 uint32_t                            /* createInfoCount */,
+                                 const VkComputePipelineCreateInfo * /* pCreateInfos */,
+                                 const VkAllocationCallbacks *       /* pAllocator */,
+                                 VkPipeline *                        /* pPipelines */));
+
+VK_FN(void,
+      vkDestroyPipeline, (VkDevice                      /* device */,
+                          VkPipeline                    /* pipeline */,
+                          const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkCreatePipelineLayout, (VkDevice                           /* device */,
+                               const VkPipelineLayoutCreateInfo * /* pCreateInfo */,
+                               const VkAllocationCallbacks *      /* pAllocator */,
+                               VkPipelineLayout *                 /* pPipelineLayout */));
+
+VK_FN(void,
+      vkDestroyPipelineLayout, (VkDevice                      /* device */,
+                                VkPipelineLayout              /* pipelineLayout */,
+                                const VkAllocationCallbacks * /* pAllocator */));
+
+/* Descriptor APIs */
+VK_FN(VkResult,
+      vkCreateDescriptorSetLayout, (VkDevice                                /* device */,
+                                    const VkDescriptorSetLayoutCreateInfo * /* pCreateInfo */,
+                                    const VkAllocationCallbacks *           /* pAllocator */,
+                                    VkDescriptorSetLayout *                 /* pSetLayout */));
+
+VK_FN(void,
+      vkDestroyDescriptorSetLayout, (VkDevice                      /* device */,
+                                     VkDescriptorSetLayout         /* descriptorSetLayout */,
+                                     const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkCreateDescriptorPool, (VkDevice                           /* device */,
+                               const VkDescriptorPoolCreateInfo * /* pCreateInfo */,
+                               const VkAllocationCallbacks *      /* pAllocator */,
+                               VkDescriptorPool *                 /* pDescriptorPool */));
+
+VK_FN(void,
+      vkDestroyDescriptorPool, (VkDevice                      /* device */,
+                                VkDescriptorPool              /* descriptorPool */,
+                                const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkAllocateDescriptorSets, (VkDevice                            /* device */,
+                                 const VkDescriptorSetAllocateInfo * /* pAllocateInfo */,
+                                 VkDescriptorSet *                   /* pDescriptorSets */));
+
+VK_FN(void,
+      vkUpdateDescriptorSets, (VkDevice                     /* device */,
+                               uint32_t                     /* descriptorWriteCount */,
+                               const VkWriteDescriptorSet * /* pDescriptorWrites */,
+                               uint32_t                     /* descriptorCopyCount */,
+                               const VkCopyDescriptorSet *  /* pDescriptorCopies */));
+
+/* Command buffer APIs */
+VK_FN(VkResult,
+      vkCreateCommandPool, (VkDevice                        /* device */,
+                            const VkCommandPoolCreateInfo * /* pCreateInfo */,
+                            const VkAllocationCallbacks *   /* pAllocator */,
+                            VkCommandPool *                 /* pCommandPool */));
+
+VK_FN(void,
+      vkDestroyCommandPool, (VkDevice                      /* device */,
+                             VkCommandPool                 /* commandPool */,
+                             const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkAllocateCommandBuffers, (VkDevice                            /* device */,
+                                 const VkCommandBufferAllocateInfo * /* pAllocateInfo */,
+                                 VkCommandBuffer *                   /* pCommandBuffers */));
+
+VK_FN(VkResult,
+      vkBeginCommandBuffer, (VkCommandBuffer                  /* commandBuffer */,
+                             const VkCommandBufferBeginInfo * /* pBeginInfo */));
+
+VK_FN(VkResult,
+      vkEndCommandBuffer, (VkCommandBuffer /* commandBuffer */));
+
+VK_FN(VkResult,
+      vkResetCommandBuffer, (VkCommandBuffer           /* commandBuffer */,
+                             VkCommandBufferResetFlags /* flags */));
+
+VK_FN(void,
+      vkCmdBindPipeline, (VkCommandBuffer     /* commandBuffer */,
+                          VkPipelineBindPoint /* pipelineBindPoint */,
+                          VkPipeline          /* pipeline */));
+
+VK_FN(void,
+      vkCmdBindDescriptorSets, (VkCommandBuffer         /* commandBuffer */,
+                                VkPipelineBindPoint     /* pipelineBindPoint */,
+                                VkPipelineLayout        /* layout */,
+                                uint32_t                /* firstSet */,
+                                uint32_t                /* descriptorSetCount */,
+                                const VkDescriptorSet * /* pDescriptorSets */,
+                                uint32_t                /* dynamicOffsetCount */,
+                                const uint32_t *        /* pDynamicOffsets */));
+
+VK_FN(void,
+      vkCmdDispatch, (VkCommandBuffer /* commandBuffer */,
+                      uint32_t        /* groupCountX */,
+                      uint32_t        /* groupCountY */,
+                      uint32_t        /* groupCountZ */));
+
+VK_FN(void,
+      vkCmdCopyBuffer, (VkCommandBuffer      /* commandBuffer */,
+                        VkBuffer             /* srcBuffer */,
+                        VkBuffer             /* dstBuffer */,
+                        uint32_t             /* regionCount */,
+                        const VkBufferCopy * /* pRegions */));
+
+VK_FN(void,
+      vkCmdPipelineBarrier, (VkCommandBuffer               /* commandBuffer */,
+                             VkPipelineStageFlags          /* srcStageMask */,
+                             VkPipelineStageFlags          /* dstStageMask */,
+                             VkDependencyFlags             /* dependencyFlags */,
+                             uint32_t                      /* memoryBarrierCount */,
+                             const VkMemoryBarrier *       /* pMemoryBarriers */,
+                             uint32_t                      /* bufferMemoryBarrierCount */,
+                             const VkBufferMemoryBarrier * /* pBufferMemoryBarriers */,
+                             uint32_t                      /* imageMemoryBarrierCount */,
+                             const VkImageMemoryBarrier *  /* pImageMemoryBarriers */));
+
+/* Queue and synchronization APIs */
+VK_FN(VkResult,
+      vkQueueSubmit, (VkQueue              /* queue */,
+                      uint32_t             /* submitCount */,
+                      const VkSubmitInfo * /* pSubmits */,
+                      VkFence              /* fence */));
+
+VK_FN(VkResult,
+      vkQueueWaitIdle, (VkQueue /* queue */));
+
+VK_FN(VkResult,
+      vkCreateFence, (VkDevice                      /* device */,
+                      const VkFenceCreateInfo *     /* pCreateInfo */,
+                      const VkAllocationCallbacks * /* pAllocator */,
+                      VkFence *                     /* pFence */));
+
+VK_FN(void,
+      vkDestroyFence, (VkDevice                      /* device */,
+                       VkFence                       /* fence */,
+                       const VkAllocationCallbacks * /* pAllocator */));
+
+VK_FN(VkResult,
+      vkWaitForFences, (VkDevice        /* device */,
+                        uint32_t        /* fenceCount */,
+                        const VkFence * /* pFences */,
+                        VkBool32        /* waitAll */,
+                        uint64_t        /* timeout */));
+
+VK_FN(VkResult,
+      vkResetFences, (VkDevice        /* device */,
+                      uint32_t        /* fenceCount */,
+                      const VkFence * /* pFences */));
+
+#undef VK_FN
+#undef VK_11_FN
+
+// clang-format on
@@ -14,6 +14,8 @@ WEAK CpuFeatures halide_get_cpu_features() {
     // known and available.
     features.set_known(halide_target_feature_wasm_simd128);
     features.set_available(halide_target_feature_wasm_simd128);
+    features.set_known(halide_target_feature_wasm_relaxed_simd);
+    features.set_available(halide_target_feature_wasm_relaxed_simd);
 
     return features;
 }
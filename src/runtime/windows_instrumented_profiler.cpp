@@ -0,0 +1,2 @@
+#define WINDOWS
+#include "instrumented_profiler.cpp"
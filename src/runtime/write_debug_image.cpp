@@ -1,4 +1,6 @@
 #include "HalideRuntime.h"
+#include "printer.h"
+#include "scoped_mutex_lock.h"
 
 // We support three formats, tiff, mat, and tmp.
 //
@@ -125,28 +127,10 @@ struct ScopedFile {
     }
 };
 
-}  // namespace Internal
-}  // namespace Runtime
-}  // namespace Halide
-
-WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *filename,
-                                             int32_t type_code, struct halide_buffer_t *buf) {
-
-    if (buf->is_bounds_query()) {
-        halide_error(user_context, "Bounds query buffer passed to halide_debug_to_file");
-        return -1;
-    }
-
-    if (buf->dimensions > 4) {
-        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
-        return -1;
-    }
-
-    int result = halide_copy_to_host(user_context, buf);
-    if (result != 0) {
-        return result;
-    }
-
+// Write a host buffer of at most four dimensions to a file, in the
+// format given by the filename's extension.
+WEAK int32_t write_debug_file(void *user_context, const char *filename,
+                              int32_t type_code, const halide_buffer_t *buf) {
     ScopedFile f(filename, "wb");
     if (!f.open()) {
         return -2;
@@ -380,3 +364,283 @@ WEAK extern "C" int32_t halide_debug_to_file(void *user_context, const char *fil
 
     return 0;
 }
+
+// Buffers are written asynchronously by snapshotting them into a job,
+// which a background thread takes off a queue and writes. The header of
+// a job is followed by a dense copy of the buffer's elements, and then
+// by a copy of the filename, so the job owns everything it needs.
+struct debug_file_job {
+    debug_file_job *next;
+    const char *filename;
+    int32_t type_code;
+    halide_buffer_t buf;
+    halide_dimension_t dim[4];
+    size_t bytes;
+};
+
+// The number of times each file named in
+// halide_debug_to_file_set_sampling has been sent a buffer.
+struct debug_file_sampling {
+    debug_file_sampling *next;
+    char *filename;
+    int period;
+    uint64_t count;
+};
+
+WEAK halide_mutex debug_file_lock = {{0}};
+// Signaled whenever a job is queued or finished, and on shutdown.
+WEAK halide_cond debug_file_cond = {{0}};
+WEAK debug_file_job *debug_file_queue_head = nullptr;
+WEAK debug_file_job *debug_file_queue_tail = nullptr;
+// Zero means buffers are written synchronously. Negative means the
+// environment has not been checked yet.
+WEAK int64_t debug_file_max_queued_bytes = -1;
+WEAK int64_t debug_file_queued_bytes = 0;
+WEAK bool debug_file_writing = false;
+WEAK bool debug_file_stop = false;
+WEAK halide_thread *debug_file_thread = nullptr;
+WEAK int32_t debug_file_async_error = 0;
+WEAK debug_file_sampling *debug_file_samplings = nullptr;
+
+WEAK void debug_file_writer(void *) {
+    ScopedMutexLock lock(&debug_file_lock);
+    while (true) {
+        while (!debug_file_queue_head && !debug_file_stop) {
+            halide_cond_wait(&debug_file_cond, &debug_file_lock);
+        }
+        debug_file_job *job = debug_file_queue_head;
+        if (!job) {
+            break;
+        }
+        debug_file_queue_head = job->next;
+        if (!debug_file_queue_head) {
+            debug_file_queue_tail = nullptr;
+        }
+        debug_file_writing = true;
+
+        halide_mutex_unlock(&debug_file_lock);
+        int32_t result = write_debug_file(nullptr, job->filename, job->type_code, &job->buf);
+        if (result != 0) {
+            error(nullptr) << "Failed to write " << job->filename
+                           << " asynchronously with error " << result;
+        }
+        halide_mutex_lock(&debug_file_lock);
+
+        if (result != 0 && debug_file_async_error == 0) {
+            debug_file_async_error = result;
+        }
+        debug_file_queued_bytes -= job->bytes;
+        debug_file_writing = false;
+        free(job);
+        halide_cond_broadcast(&debug_file_cond);
+    }
+}
+
+// Whether this buffer should be skipped because of the sampling period of
+// its file. Must be called with the lock held.
+WEAK bool debug_file_skip_sample(const char *filename) {
+    for (debug_file_sampling *s = debug_file_samplings; s; s = s->next) {
+        if (strcmp(s->filename, filename) == 0) {
+            return (s->count++ % s->period) != 0;
+        }
+    }
+    return false;
+}
+
+// Copy the elements of a host buffer of at most four dimensions densely
+// into a new job. Returns nullptr if out of memory.
+WEAK debug_file_job *snapshot_debug_file(const char *filename, int32_t type_code,
+                                         const halide_buffer_t *buf) {
+    const size_t bytes_per_element = buf->type.bytes();
+    size_t elts = 1;
+    for (int i = 0; i < buf->dimensions; i++) {
+        elts *= buf->dim[i].extent;
+    }
+    const size_t data_offset = (sizeof(debug_file_job) + 127) & ~(size_t)127;
+    const size_t filename_offset = data_offset + elts * bytes_per_element;
+    const size_t bytes = filename_offset + strlen(filename) + 1;
+    uint8_t *mem = (uint8_t *)malloc(bytes);
+    if (!mem) {
+        return nullptr;
+    }
+
+    debug_file_job *job = (debug_file_job *)mem;
+    job->next = nullptr;
+    job->filename = (const char *)memcpy(mem + filename_offset, filename, strlen(filename) + 1);
+    job->type_code = type_code;
+    job->bytes = bytes;
+    job->buf = *buf;
+    job->buf.device = 0;
+    job->buf.device_interface = nullptr;
+    job->buf.host = mem + data_offset;
+    job->buf.flags = 0;
+    job->buf.dim = job->dim;
+    int32_t stride = 1;
+    for (int i = 0; i < 4; i++) {
+        if (i < buf->dimensions) {
+            job->dim[i] = buf->dim[i];
+        } else {
+            job->dim[i].min = 0;
+            job->dim[i].extent = 1;
+            job->dim[i].flags = 0;
+        }
+        job->dim[i].stride = stride;
+        stride *= job->dim[i].extent;
+    }
+
+    // Copy a row of the innermost dimension at a time.
+    const halide_dimension_t *d = job->dim;
+    const size_t row_bytes = d[0].extent * bytes_per_element;
+    uint8_t *dst = job->buf.host;
+    for (int32_t i3 = d[3].min; i3 < d[3].min + d[3].extent; i3++) {
+        for (int32_t i2 = d[2].min; i2 < d[2].min + d[2].extent; i2++) {
+            for (int32_t i1 = d[1].min; i1 < d[1].min + d[1].extent; i1++) {
+                int idx[] = {d[0].min, i1, i2, i3};
+                const uint8_t *src = buf->address_of(idx);
+                if (buf->dimensions == 0 || buf->dim[0].stride == 1) {
+                    memcpy(dst, src, row_bytes);
+                    dst += row_bytes;
+                } else {
+                    const int64_t src_stride = (int64_t)buf->dim[0].stride * bytes_per_element;
+                    for (int32_t i0 = 0; i0 < d[0].extent; i0++) {
+                        memcpy(dst, src + i0 * src_stride, bytes_per_element);
+                        dst += bytes_per_element;
+                    }
+                }
+            }
+        }
+    }
+    return job;
+}
+
+}  // namespace Internal
+}  // namespace Runtime
+}  // namespace Halide
+
+extern "C" {
+
+WEAK int32_t halide_debug_to_file(void *user_context, const char *filename,
+                                  int32_t type_code, struct halide_buffer_t *buf) {
+
+    if (buf->is_bounds_query()) {
+        halide_error(user_context, "Bounds query buffer passed to halide_debug_to_file");
+        return -1;
+    }
+
+    if (buf->dimensions > 4) {
+        halide_error(user_context, "Can't debug_to_file a Func with more than four dimensions\n");
+        return -1;
+    }
+
+    int64_t max_queued_bytes;
+    {
+        ScopedMutexLock lock(&debug_file_lock);
+        if (debug_file_skip_sample(filename)) {
+            return 0;
+        }
+        if (debug_file_max_queued_bytes < 0) {
+            const char *megabytes = getenv("HL_DEBUG_TO_FILE_ASYNC");
+            debug_file_max_queued_bytes = megabytes ? (int64_t)atoi(megabytes) << 20 : 0;
+        }
+        max_queued_bytes = debug_file_max_queued_bytes;
+    }
+
+    int result = halide_copy_to_host(user_context, buf);
+    if (result != 0) {
+        return result;
+    }
+
+    if (max_queued_bytes <= 0) {
+        return write_debug_file(user_context, filename, type_code, buf);
+    }
+
+    debug_file_job *job = snapshot_debug_file(filename, type_code, buf);
+    if (!job) {
+        return halide_error_out_of_memory(user_context);
+    }
+
+    ScopedMutexLock lock(&debug_file_lock);
+    if (!debug_file_thread) {
+        debug_file_stop = false;
+        debug_file_thread = halide_spawn_thread(debug_file_writer, nullptr);
+    }
+    // Wait for the writer to catch up rather than letting the queue grow
+    // without bound. A job larger than the limit is still queued once the
+    // queue is empty.
+    while (debug_file_queue_head &&
+           debug_file_queued_bytes + (int64_t)job->bytes > debug_file_max_queued_bytes) {
+        halide_cond_wait(&debug_file_cond, &debug_file_lock);
+    }
+    if (debug_file_queue_tail) {
+        debug_file_queue_tail->next = job;
+    } else {
+        debug_file_queue_head = job;
+    }
+    debug_file_queue_tail = job;
+    debug_file_queued_bytes += job->bytes;
+    halide_cond_broadcast(&debug_file_cond);
+    return 0;
+}
+
+WEAK void halide_debug_to_file_set_async(int64_t max_queued_bytes) {
+    ScopedMutexLock lock(&debug_file_lock);
+    debug_file_max_queued_bytes = max_queued_bytes > 0 ? max_queued_bytes : 0;
+}
+
+WEAK int halide_debug_to_file_set_sampling(const char *filename, int period) {
+    ScopedMutexLock lock(&debug_file_lock);
+    for (debug_file_sampling *s = debug_file_samplings; s; s = s->next) {
+        if (strcmp(s->filename, filename) == 0) {
+            s->period = period > 1 ? period : 1;
+            s->count = 0;
+            return 0;
+        }
+    }
+    size_t len = strlen(filename) + 1;
+    debug_file_sampling *s = (debug_file_sampling *)malloc(sizeof(debug_file_sampling) + len);
+    if (!s) {
+        return halide_error_code_out_of_memory;
+    }
+    s->filename = (char *)memcpy(s + 1, filename, len);
+    s->period = period > 1 ? period : 1;
+    s->count = 0;
+    s->next = debug_file_samplings;
+    debug_file_samplings = s;
+    return 0;
+}
+
+WEAK int halide_debug_to_file_flush(void *user_context) {
+    ScopedMutexLock lock(&debug_file_lock);
+    while (debug_file_queue_head || debug_file_writing) {
+        halide_cond_wait(&debug_file_cond, &debug_file_lock);
+    }
+    int32_t result = debug_file_async_error;
+    debug_file_async_error = 0;
+    return result;
+}
+
+}  // extern "C"
+
+namespace {
+
+WEAK __attribute__((destructor)) void halide_debug_to_file_cleanup() {
+    halide_thread *thread;
+    {
+        ScopedMutexLock lock(&debug_file_lock);
+        thread = debug_file_thread;
+        debug_file_thread = nullptr;
+        debug_file_stop = true;
+        halide_cond_broadcast(&debug_file_cond);
+    }
+    // The writer drains the queue before it exits.
+    if (thread) {
+        halide_join_thread(thread);
+    }
+    while (debug_file_samplings) {
+        debug_file_sampling *s = debug_file_samplings;
+        debug_file_samplings = s->next;
+        free(s);
+    }
+}
+
+}  // namespace
@@ -1,8 +1,10 @@
 #include "Halide.h"
-#include <cstdlib>   // setenv (or Windows _putenv_s)
-#include <iostream>  // std::cerr / std::endl
-#include <map>       // std::map
-#include <string>    // std::to_string
+#include <chrono>      // std::chrono::steady_clock
+#include <cstdlib>     // setenv (or Windows _putenv_s)
+#include <filesystem>  // std::filesystem::remove_all
+#include <iostream>    // std::cerr / std::endl
+#include <map>         // std::map
+#include <string>      // std::to_string
 
 using namespace Halide;
 
@@ -55,6 +57,120 @@ bool test_caching(Pipeline &p1, Pipeline &p2, const Target &target) {
     return true;
 }
 
+bool test_parallel_search(Pipeline &p1, Pipeline &p2, const Target &target) {
+    constexpr int parallelism = 32;
+    int seed = (int)time(nullptr);
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"random_dropout_seed", std::to_string(seed)},
+            {"weights_path", weights_path},
+        });
+
+    params.extra["search_threads"] = "1";
+    auto results_serial = p1.apply_autoscheduler(target, params);
+
+    params.extra["search_threads"] = "4";
+    auto results_parallel = p2.apply_autoscheduler(target, params);
+
+    // Expanding the beam on several threads should find exactly the same schedule.
+    return results_serial.schedule_source == results_parallel.schedule_source &&
+           results_serial.featurization == results_parallel.featurization;
+}
+
+bool test_feature_cache(Pipeline &p1, Pipeline &p2, Pipeline &p3, const Target &target) {
+    constexpr int parallelism = 32;
+    int seed = (int)time(nullptr);
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", std::to_string(parallelism)},
+            {"random_dropout_seed", std::to_string(seed)},
+            {"weights_path", weights_path},
+        });
+
+    auto results_without_cache = p1.apply_autoscheduler(target, params);
+
+    // The first run with the cache fills it in, and the second reads from it.
+    std::string dir = Internal::dir_make_temp();
+    params.extra["feature_cache_dir"] = dir;
+    auto results_cold_cache = p2.apply_autoscheduler(target, params);
+    auto results_warm_cache = p3.apply_autoscheduler(target, params);
+    std::filesystem::remove_all(dir);
+
+    return results_without_cache.schedule_source == results_cold_cache.schedule_source &&
+           results_without_cache.schedule_source == results_warm_cache.schedule_source &&
+           results_without_cache.featurization == results_cold_cache.featurization &&
+           results_without_cache.featurization == results_warm_cache.featurization;
+}
+
+bool test_schedule_cache(Pipeline &p1, Pipeline &p2, Pipeline &p3, const Target &target) {
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", "32"},
+            {"weights_path", weights_path},
+        });
+
+    auto results_without_cache = p1.apply_autoscheduler(target, params);
+
+    // The first run with the cache searches and saves the schedule, and
+    // the second skips the search and reapplies it.
+    std::string dir = Internal::dir_make_temp();
+    params.extra["schedule_cache_dir"] = dir;
+    auto results_cold_cache = p2.apply_autoscheduler(target, params);
+    auto results_warm_cache = p3.apply_autoscheduler(target, params);
+    bool saved = !std::filesystem::is_empty(dir);
+    std::filesystem::remove_all(dir);
+
+    return saved &&
+           results_without_cache.schedule_source == results_cold_cache.schedule_source &&
+           results_without_cache.schedule_source == results_warm_cache.schedule_source &&
+           results_without_cache.featurization == results_warm_cache.featurization;
+}
+
+bool test_gpu_schedule(Pipeline &p, const Target &target) {
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", "80"},
+            {"weights_path", weights_path},
+        });
+
+    auto results = p.apply_autoscheduler(target, params);
+
+    // The parallel loops should have become GPU blocks, and the vector
+    // loops the threads within them.
+    return results.schedule_source.find("gpu_blocks") != std::string::npos &&
+           results.schedule_source.find("gpu_threads") != std::string::npos;
+}
+
+bool test_time_limit(Pipeline &p1, Pipeline &p2, const Target &target) {
+    AutoschedulerParams params(
+        "Adams2019",
+        {
+            {"parallelism", "32"},
+            {"weights_path", weights_path},
+            {"beam_size", "1000"},
+            {"time_limit", "0.5"},
+        });
+
+    // A huge beam would take far longer than the limit. The search
+    // should stop close to it, with a complete schedule.
+    auto start = std::chrono::steady_clock::now();
+    auto results_limited = p1.apply_autoscheduler(target, params);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (seconds > 10 || results_limited.schedule_source.empty()) {
+        return false;
+    }
+
+    params.extra.erase("time_limit");
+    params.extra["fast_mode"] = "1";
+    auto results_fast = p2.apply_autoscheduler(target, params);
+    return !results_fast.schedule_source.empty();
+}
+
 int main(int argc, char **argv) {
     if (argc != 3 || !strlen(argv[1]) || !strlen(argv[2])) {
         fprintf(stderr, "Usage: %s <autoscheduler-lib> <weights-path>\n", argv[0]);
@@ -902,6 +1018,115 @@ int main(int argc, char **argv) {
         }
     }
 
+    // A stencil chain, searched serially and in parallel
+    if (true) {
+        Pipeline p1;
+        Pipeline p2;
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            // The schedule source names the Funcs, so they need the same names each time.
+            Func f[4] = {Func("f0"), Func("f1"), Func("f2"), Func("f3")};
+            f[0](x, y) = x + y;
+            for (int i = 1; i < 4; i++) {
+                f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y) + f[i - 1](x, y + 1);
+            }
+
+            f[3].set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+            if (test_condition) {
+                p2 = Pipeline(f[3]);
+            } else {
+                p1 = Pipeline(f[3]);
+            }
+        }
+
+        if (!test_parallel_search(p1, p2, target)) {
+            std::cerr << "Parallel search check failed on stencil chain" << std::endl;
+            return 1;
+        }
+    }
+
+    // A stencil chain, with and without the feature cache
+    if (true) {
+        Pipeline p[3];
+        for (int test_condition = 0; test_condition < 3; test_condition++) {
+            // The cache is per-pipeline, so the Funcs need the same names each time.
+            Func f[4] = {Func("f0"), Func("f1"), Func("f2"), Func("f3")};
+            f[0](x, y) = x + y;
+            for (int i = 1; i < 4; i++) {
+                f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y) + f[i - 1](x, y + 1);
+            }
+
+            f[3].set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+            p[test_condition] = Pipeline(f[3]);
+        }
+
+        if (!test_feature_cache(p[0], p[1], p[2], target)) {
+            std::cerr << "Feature cache check failed on stencil chain" << std::endl;
+            return 1;
+        }
+    }
+
+    // A stencil chain, with and without the schedule cache
+    if (true) {
+        Pipeline p[3];
+        for (int test_condition = 0; test_condition < 3; test_condition++) {
+            // The cache is per-pipeline, so the Funcs need the same names each time.
+            Func f[4] = {Func("f0"), Func("f1"), Func("f2"), Func("f3")};
+            f[0](x, y) = x + y;
+            for (int i = 1; i < 4; i++) {
+                f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y) + f[i - 1](x, y + 1);
+            }
+
+            f[3].set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+            p[test_condition] = Pipeline(f[3]);
+        }
+
+        if (!test_schedule_cache(p[0], p[1], p[2], target)) {
+            std::cerr << "Schedule cache check failed on stencil chain" << std::endl;
+            return 1;
+        }
+    }
+
+    // A stencil chain, scheduled for a GPU
+    if (true) {
+        Func f[4];
+        f[0](x, y) = x + y;
+        for (int i = 1; i < 4; i++) {
+            f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y) + f[i - 1](x, y + 1);
+        }
+
+        f[3].set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+        Pipeline p(f[3]);
+        if (!test_gpu_schedule(p, target.with_feature(Target::CUDA))) {
+            std::cerr << "GPU schedule check failed on stencil chain" << std::endl;
+            return 1;
+        }
+    }
+
+    // A stencil chain, scheduled with a time limit and in fast mode
+    if (true) {
+        Pipeline p[2];
+        for (int test_condition = 0; test_condition < 2; test_condition++) {
+            Func f[8];
+            f[0](x, y) = x + y;
+            for (int i = 1; i < 8; i++) {
+                f[i](x, y) = f[i - 1](x, y) + f[i - 1](x + 1, y) + f[i - 1](x, y + 1);
+            }
+
+            f[7].set_estimate(x, 0, 1000).set_estimate(y, 0, 1000);
+
+            p[test_condition] = Pipeline(f[7]);
+        }
+
+        if (!test_time_limit(p[0], p[1], target)) {
+            std::cerr << "Time limit check failed on stencil chain" << std::endl;
+            return 1;
+        }
+    }
+
     std::cout << "adams2019 testing passed\n";
     return 0;
 }
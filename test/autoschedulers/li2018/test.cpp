@@ -154,6 +154,49 @@ int main(int argc, char **argv) {
         //           << result.schedule_source << "\n\n";
     }
 
+    {  // The gradients of a stencil with respect to two inputs, under a memory budget.
+        Buffer<float> w1(1002), w2(1002);
+        for (int i = 0; i < 1002; i++) {
+            w1(i) = i * 0.001f;
+            w2(i) = 1.f - i * 0.001f;
+        }
+        auto make_gradients = [&]() {
+            Func a("a"), b("b"), loss("loss");
+            a(x) = w1(x) * w2(x);
+            b(x) = a(x) + a(x + 1) + a(x + 2);
+            RDom r(0, 1000);
+            loss() += b(r) * b(r);
+            Derivative d = propagate_adjoints(loss);
+            Func d_w1 = d(w1), d_w2 = d(w2);
+            d_w1.set_estimate(d_w1.args()[0], 0, 1002);
+            d_w2.set_estimate(d_w2.args()[0], 0, 1002);
+            return Pipeline({d_w1, d_w2});
+        };
+
+        Pipeline unbounded = make_gradients();
+        unbounded.apply_autoscheduler(target, params);
+        Realization expected = unbounded.realize({1002});
+
+        Pipeline budgeted = make_gradients();
+        AutoschedulerParams budget_params = params;
+        budget_params.extra["memory_budget"] = "0";
+        AutoSchedulerResults result = budgeted.apply_autoscheduler(target, budget_params);
+        if (result.schedule_source.find("compute_inline") == std::string::npos) {
+            printf("Expected some Funcs to be recomputed under a memory budget\n");
+            return 1;
+        }
+        Realization actual = budgeted.realize({1002});
+        for (int k = 0; k < 2; k++) {
+            Buffer<float> e = expected[k], a = actual[k];
+            for (int i = 0; i < 1002; i++) {
+                if (std::abs(e(i) - a(i)) > 1e-3f * std::max(1.f, std::abs(e(i)))) {
+                    printf("Gradient %d mismatch at %d: %f vs %f\n", k, i, a(i), e(i));
+                    return 1;
+                }
+            }
+        }
+    }
+
     printf("Success!\n");
     return 0;
 }
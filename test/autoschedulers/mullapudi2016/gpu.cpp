@@ -0,0 +1,72 @@
+#include "Halide.h"
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <autoscheduler-lib>\n", argv[0]);
+        return 1;
+    }
+
+    load_plugin(argv[1]);
+
+    const int W = 1536, H = 1024;
+    Var x("x"), y("y");
+    Buffer<float> input = lambda(x, y, sin(x) + cos(y)).realize({W + 2, H + 2});
+
+    Func blur_x("blur_x"), blur_y("blur_y"), hist("hist"), out("out");
+    blur_x(x, y) = (input(x, y) + input(x + 1, y) + input(x + 2, y)) / 3;
+    blur_y(x, y) = (blur_x(x, y) + blur_x(x, y + 1) + blur_x(x, y + 2)) / 3;
+
+    // A stage with an update definition, to exercise RVars inside the
+    // GPU threads.
+    RDom r(0, 4);
+    hist(x, y) = 0.0f;
+    hist(x, y) += blur_y(x, y) * r;
+    out(x, y) = hist(x, y) + blur_y(x, y);
+
+    out.set_estimates({{0, W}, {0, H}});
+
+    Pipeline p(out);
+    AutoSchedulerResults results = p.apply_autoscheduler(target, {"Mullapudi2016"});
+
+    // Inspect the schedule (only for debugging))
+    // out.print_loop_nest();
+
+    if (results.schedule_source.find("gpu_blocks") == std::string::npos ||
+        results.schedule_source.find("gpu_threads") == std::string::npos) {
+        printf("Schedule is not mapped onto GPU blocks and threads:\n%s\n",
+               results.schedule_source.c_str());
+        return 1;
+    }
+
+    Buffer<float> result = p.realize({W, H}, target);
+    result.copy_to_host();
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float bx[3];
+            for (int i = 0; i < 3; i++) {
+                bx[i] = (input(x, y + i) + input(x + 1, y + i) + input(x + 2, y + i)) / 3;
+            }
+            float by = (bx[0] + bx[1] + bx[2]) / 3;
+            float correct = by * 6 + by;
+            if (std::abs(result(x, y) - correct) > 1e-4f * std::max(1.0f, std::abs(correct))) {
+                printf("result(%d, %d) = %f instead of %f\n", x, y, result(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include "Halide.h"
+
+#include <chrono>
+#include <stdio.h>
+#include <thread>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that a pipeline with adaptive specialization turned on builds
+// a version specialized to the argument values it sees most, switches
+// to it, and keeps using the generic version for everything else.
+
+int specialized_calls = 0;
+extern "C" HALIDE_EXPORT_SYMBOL int record_specialized_call(int x) {
+    specialized_calls++;
+    return x;
+}
+HalideExtern_1(int, record_specialized_call, int);
+
+// The loop over f only has a constant extent in a version specialized
+// to the size of the output. Count the calls to those versions.
+class CountSpecializedCalls : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        if (starts_with(op->name, "f.s0.x") && is_const(op->extent)) {
+            return Block::make(Evaluate::make(record_specialized_call(0)), op);
+        }
+        return IRMutator::visit(op);
+    }
+};
+
+bool check(const Buffer<int> &out, int size, int k) {
+    for (int i = 0; i < size; i++) {
+        if (out(i) != i * k) {
+            printf("out(%d) = %d instead of %d\n", i, out(i), i * k);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] Adaptive specialization is not supported under WebAssembly.\n");
+        return 0;
+    }
+
+    ImageParam in(Int(32), 1, "in");
+    Param<int> k("k");
+    Var x("x");
+    Func f("f");
+    f(x) = in(x) * k;
+    f.add_custom_lowering_pass(new CountSpecializedCalls);
+
+    const int threshold = 5;
+    Pipeline p(f);
+    p.set_adaptive_specialization(threshold, 1);
+
+    Buffer<int> input(200);
+    input.for_each_element([&](int i) { input(i) = i; });
+    in.set(input);
+
+    // Up to the threshold, only the generic version runs.
+    k.set(3);
+    for (int i = 0; i < threshold; i++) {
+        if (!check(p.realize({100}), 100, 3)) {
+            return -1;
+        }
+    }
+    if (specialized_calls != 0) {
+        printf("A specialized version ran before the threshold was reached\n");
+        return -1;
+    }
+
+    // The specialized version is built in the background, and is used
+    // once it's ready.
+    for (int i = 0; i < 10000 && specialized_calls == 0; i++) {
+        if (!check(p.realize({100}), 100, 3)) {
+            return -1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (specialized_calls == 0) {
+        printf("The specialized version was never used\n");
+        return -1;
+    }
+
+    // Any other sizes or parameter values keep using the generic
+    // version, and only one version was asked for.
+    int before = specialized_calls;
+    for (int i = 0; i < 2 * threshold; i++) {
+        k.set(4);
+        if (!check(p.realize({100}), 100, 4)) {
+            return -1;
+        }
+        k.set(3);
+        if (!check(p.realize({150}), 150, 3)) {
+            return -1;
+        }
+    }
+    if (specialized_calls != before) {
+        printf("A specialized version ran with the wrong argument values\n");
+        return -1;
+    }
+
+    if (!check(p.realize({100}), 100, 3) || specialized_calls != before + 1) {
+        printf("The specialized version was not used after other calls\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
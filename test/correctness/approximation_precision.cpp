@@ -0,0 +1,124 @@
+#include "Halide.h"
+#include <cmath>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check the vectorizable approximations of transcendental functions at
+// each precision against the C library, evaluated in double.
+
+struct Approximation {
+    const char *name;
+    Expr (*halide_fn)(const Expr &, ApproximationPrecision);
+    double (*reference_fn)(double);
+    float min, max;
+    // The error bound for each precision. Errors in functions that are
+    // marked relative are divided by the magnitude of the correct
+    // result.
+    double tolerance[3];
+    bool relative;
+};
+
+double sigmoid_ref(double x) {
+    return 1.0 / (1.0 + std::exp(-x));
+}
+
+// The number of points of [min, max] to sample.
+const int N = 4096;
+
+float input_at(const Approximation &a, int i) {
+    return a.min + (a.max - a.min) * (float)i / (N - 1);
+}
+
+double error_of(const Approximation &a, double result, double correct) {
+    double err = std::abs(result - correct);
+    if (a.relative) {
+        err /= std::max(std::abs(correct), 1e-30);
+    }
+    return err;
+}
+
+int main(int argc, char **argv) {
+    const Approximation approximations[] = {
+        {"sin", fast_sin, std::sin, -10.0f, 10.0f, {3e-5, 1e-5, 1e-6}, false},
+        {"cos", fast_cos, std::cos, -10.0f, 10.0f, {3e-5, 1e-5, 1e-6}, false},
+        {"exp", fast_exp, std::exp, -10.0f, 10.0f, {2e-4, 1e-5, 1e-6}, true},
+        {"log", fast_log, std::log, 1e-3f, 1e3f, {2e-4, 3e-5, 2e-6}, false},
+        {"tanh", fast_tanh, std::tanh, -5.0f, 5.0f, {2e-4, 2e-5, 2e-6}, true},
+        {"erf", fast_erf, std::erf, -4.0f, 4.0f, {6e-4, 3e-6, 3e-6}, false},
+        {"sigmoid", fast_sigmoid, sigmoid_ref, -20.0f, 20.0f, {2e-4, 1e-5, 1e-6}, false},
+    };
+    const ApproximationPrecision precisions[] = {
+        ApproximationPrecision::Fast,
+        ApproximationPrecision::Balanced,
+        ApproximationPrecision::Precise};
+    const char *precision_names[] = {"Fast", "Balanced", "Precise"};
+
+    Var x;
+    for (const Approximation &a : approximations) {
+        Buffer<float> input(N);
+        for (int i = 0; i < N; i++) {
+            input(i) = input_at(a, i);
+        }
+        for (int p = 0; p < 3; p++) {
+            // Fast tanh is only accurate in absolute terms.
+            bool relative = a.relative && !(a.halide_fn == fast_tanh && p == 0);
+            Approximation check = a;
+            check.relative = relative;
+
+            Func f;
+            f(x) = a.halide_fn(input(x), precisions[p]);
+            f.vectorize(x, 8);
+            Buffer<float> out = f.realize({N});
+
+            double worst = 0;
+            int worst_i = 0;
+            for (int i = 0; i < N; i++) {
+                double err = error_of(check, out(i), a.reference_fn(input(i)));
+                if (err > worst) {
+                    worst = err;
+                    worst_i = i;
+                }
+            }
+            if (worst > a.tolerance[p]) {
+                printf("%s at the %s precision: error %g at %.9g is larger than %g\n",
+                       a.name, precision_names[p], worst, input(worst_i), a.tolerance[p]);
+                return -1;
+            }
+        }
+    }
+
+    // The target features make the plain math functions use the
+    // approximations.
+    {
+        Target target = get_jit_target_from_environment();
+        const Target::Feature features[] = {
+            Target::VectorMathFast,
+            Target::VectorMathBalanced,
+            Target::VectorMathPrecise};
+        // Bounds on the sum of the errors of the five functions.
+        const double tolerance[] = {1e-3, 1e-4, 1e-5};
+        Buffer<float> input(N);
+        for (int i = 0; i < N; i++) {
+            input(i) = 0.1f + 9.9f * i / (N - 1);
+        }
+        for (int p = 0; p < 3; p++) {
+            Func f;
+            f(x) = sin(input(x)) + cos(input(x)) + tanh(input(x)) + exp(-input(x)) + log(input(x));
+            f.vectorize(x, 8);
+            Buffer<float> out = f.realize({N}, target.with_feature(features[p]));
+            for (int i = 0; i < N; i++) {
+                double v = input(i);
+                double correct = std::sin(v) + std::cos(v) + std::tanh(v) + std::exp(-v) + std::log(v);
+                if (std::abs(out(i) - correct) > tolerance[p]) {
+                    printf("Plain math with the %s feature: %f instead of %f at %f\n",
+                           precision_names[p], out(i), correct, v);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
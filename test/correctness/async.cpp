@@ -40,6 +40,34 @@ int main(int argc, char **argv) {
         });
     }
 
+    // Ring buffering a producer computed once per row, so that it can
+    // run a few rows ahead of its consumer.
+    for (bool async : {false, true}) {
+        for (int buffers : {1, 2, 4}) {
+            Func producer, consumer;
+            Var x, y;
+
+            producer(x, y) = expensive(x + 2 * y);
+            consumer(x, y) = expensive(producer(x, y) + producer(x + 1, y));
+            consumer.compute_root();
+            producer.store_root().compute_at(consumer, y).ring_buffer(buffers);
+            if (async) {
+                producer.async();
+            }
+
+            Buffer<int> out = consumer.realize({16, 16});
+
+            out.for_each_element([&](int x, int y) {
+                int correct = 2 * (x + 2 * y) + 1;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n",
+                           x, y, out(x, y), correct);
+                    exit(-1);
+                }
+            });
+        }
+    }
+
     // Sliding and folding over a single variable
     {
         Func producer, consumer;
@@ -1417,6 +1417,48 @@ void test_random_float() {
     check(__LINE__, d_input(), o(0));
 }
 
+void test_checkpointing() {
+    const int width = 16;
+    Buffer<float> input(width);
+    for (int i = 0; i < width; i++) {
+        input(i) = i / 8.f;
+    }
+    Var x("x");
+    // A long chain of pointwise stages.
+    std::vector<Func> chain;
+    Func first("chain_0");
+    first(x) = input(x);
+    chain.push_back(first);
+    for (int i = 1; i < 9; i++) {
+        Func f("chain_" + std::to_string(i));
+        f(x) = sin(chain.back()(x)) * chain.back()(x) + 1.f;
+        chain.push_back(f);
+    }
+    RDom r(0, width);
+    Func loss("loss");
+    loss() += chain.back()(r);
+
+    Derivative d = propagate_adjoints(loss);
+    Buffer<float> expected = d(input).realize({width});
+
+    // With the default checkpoints, and with an explicit one.
+    for (const auto &checkpoints : {std::vector<Func>{}, std::vector<Func>{chain[4]}}) {
+        Checkpointing checkpointing;
+        checkpointing.checkpoints = checkpoints;
+        Derivative d_chk = propagate_adjoints(loss, checkpointing);
+        Func d_input = d_chk(input);
+        bool recomputes = false;
+        for (const auto &it : find_transitive_calls(d_input.function())) {
+            recomputes |= ends_with(it.first, "_recompute__");
+        }
+        _halide_user_assert(recomputes) << "No forward Funcs are recomputed\n";
+        Buffer<float> result = d_input.realize({width});
+        for (int i = 0; i < width; i++) {
+            check(__LINE__, result(i), expected(i), 1e-5f);
+        }
+    }
+}
+
 int main(int argc, char **argv) {
     test_scalar<float>();
     test_scalar<double>();
@@ -1459,6 +1501,7 @@ int main(int argc, char **argv) {
     test_custom_adjoint_buffer();
     test_print();
     test_random_float();
+    test_checkpointing();
     printf("[autodiff] Success!\n");
     return 0;
 }
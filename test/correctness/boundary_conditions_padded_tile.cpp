@@ -0,0 +1,136 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that a boundary condition materialized once per tile gives the
+// same results as evaluating it on every load, and that it leaves the
+// consumer's loads from it unconditional.
+
+class FindClamps : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const Min *op) override {
+        found = true;
+    }
+
+    void visit(const Max *op) override {
+        found = true;
+    }
+
+    void visit(const Select *op) override {
+        found = true;
+    }
+
+public:
+    bool found = false;
+};
+
+class CheckConsumerLoads : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == padded) {
+            // Loads inside the copy are allowed to be clamped.
+            in_copy++;
+            IRVisitor::visit(op);
+            in_copy--;
+        } else if (op->is_producer && op->name == consumer) {
+            in_consumer++;
+            IRVisitor::visit(op);
+            in_consumer--;
+        } else {
+            IRVisitor::visit(op);
+        }
+    }
+
+    void visit(const Load *op) override {
+        if (in_consumer && !in_copy) {
+            if (op->name == padded) {
+                loads_from_padded++;
+                if (expr_uses_clamp(op->index)) {
+                    clamped_loads++;
+                }
+            } else {
+                other_loads++;
+            }
+        }
+        IRVisitor::visit(op);
+    }
+
+    static bool expr_uses_clamp(const Expr &e) {
+        FindClamps finder;
+        e.accept(&finder);
+        return finder.found;
+    }
+
+    int in_copy = 0, in_consumer = 0;
+
+public:
+    std::string padded, consumer;
+    int loads_from_padded = 0, clamped_loads = 0, other_loads = 0;
+};
+
+int main(int argc, char **argv) {
+    const int w = 96, h = 64;
+    Buffer<uint16_t> input(w, h);
+    input.for_each_element([&](int x, int y) { input(x, y) = (x * 17 + y * 31) % 251; });
+
+    ImageParam in(UInt(16), 2, "in");
+    Var x("x"), y("y"), xo("xo"), yo("yo"), xi("xi"), yi("yi");
+
+    std::vector<Buffer<uint16_t>> results;
+    for (bool use_padded_tile : {false, true}) {
+        Func clamped = BoundaryConditions::repeat_edge(in);
+        Func blur("blur");
+        blur(x, y) = (clamped(x - 1, y) + clamped(x + 1, y) +
+                      clamped(x, y - 1) + clamped(x, y + 1) + 2) /
+                     4;
+        // Whole tiles only, so that the consumer's loops have no tails.
+        blur.bound(x, 0, w)
+            .bound(y, 0, h)
+            .tile(x, y, xo, yo, xi, yi, 32, 16)
+            .parallel(yo)
+            .vectorize(xi, 8);
+
+        if (use_padded_tile) {
+            Func padded = BoundaryConditions::padded_tile(clamped, LoopLevel(blur, xo), 8);
+
+            CheckConsumerLoads checker;
+            checker.padded = padded.name();
+            checker.consumer = blur.name();
+            Module m = blur.compile_to_module({in}, "padded_tile", get_jit_target_from_environment());
+            for (const auto &f : m.functions()) {
+                f.body.accept(&checker);
+            }
+            if (checker.loads_from_padded == 0 || checker.other_loads != 0) {
+                printf("Expected all of the loads in %s to come from %s, but found %d loads from it and %d others\n",
+                       checker.consumer.c_str(), checker.padded.c_str(),
+                       checker.loads_from_padded, checker.other_loads);
+                return -1;
+            }
+            if (checker.clamped_loads != 0) {
+                printf("Found %d clamped loads from %s\n", checker.clamped_loads, checker.padded.c_str());
+                return -1;
+            }
+        }
+
+        in.set(input);
+        results.push_back(blur.realize({w, h}));
+    }
+
+    for (int yy = 0; yy < h; yy++) {
+        for (int xx = 0; xx < w; xx++) {
+            if (results[0](xx, yy) != results[1](xx, yy)) {
+                printf("result(%d, %d) = %d instead of %d\n",
+                       xx, yy, results[1](xx, yy), results[0](xx, yy));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the branches of a pipeline with the instrumented profiler, then
+// check that recompiling it with the resulting branch profile marks the
+// hot side of each of them.
+
+class CountLikelyBranches : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const IfThenElse *op) override {
+        const Call *c = op->condition.as<Call>();
+        if (c && c->is_intrinsic(Call::likely)) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] The instrumented profiler is not supported under WebAssembly.\n");
+        return 0;
+    }
+
+    std::string filename = Internal::get_test_tmp_dir() + "branch_profile.txt";
+    Internal::ensure_no_file_exists(filename);
+#ifdef _WIN32
+    _putenv_s("HL_PROFILER_BRANCH_FILE", filename.c_str());
+#else
+    setenv("HL_PROFILER_BRANCH_FILE", filename.c_str(), 1);
+#endif
+
+    Param<int> p("p");
+    Var x, y;
+    Func f("f"), g("g");
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    // Each row of f chooses between its specializations, so one
+    // realization gives plenty of samples.
+    f.compute_at(g, y);
+    f.specialize(p > 5).vectorize(x, 8);
+    f.specialize(p > 0).vectorize(x, 4);
+
+    p.set(1);
+    const int rows = 100;
+    g.realize({64, rows}, t.with_feature(Target::ProfileInstrumented));
+
+    // Find the counts of the two specializations.
+    std::ifstream file(filename);
+    std::string line, pipeline_name;
+    int branches = 0;
+    while (std::getline(file, line)) {
+        std::vector<std::string> v = split_string(line, "\t");
+        if (v.size() != 5 || v[1] != "f") {
+            continue;
+        }
+        unsigned long long taken = std::strtoull(v[3].c_str(), nullptr, 10);
+        unsigned long long not_taken = std::strtoull(v[4].c_str(), nullptr, 10);
+        bool five = v[2].find('5') != std::string::npos;
+        if (taken + not_taken != rows ||
+            (five ? taken : not_taken) != 0) {
+            printf("Unexpected counts in branch profile line: %s\n", line.c_str());
+            return -1;
+        }
+        pipeline_name = v[0];
+        branches++;
+    }
+    if (branches != 2) {
+        printf("Expected 2 branches of f in the branch profile, but found %d\n", branches);
+        return -1;
+    }
+
+    load_branch_profile(filename);
+    Module m = g.compile_to_module(g.infer_arguments(), pipeline_name, t);
+    CountLikelyBranches counter;
+    for (const auto &fn : m.functions()) {
+        fn.body.accept(&counter);
+    }
+    if (counter.count != 2) {
+        printf("Expected both branches of f to be marked likely, but found %d\n", counter.count);
+        return -1;
+    }
+
+    // The pipeline laid out with the profile must still give the right answers.
+    for (int pv : {-1, 1, 10}) {
+        p.set(pv);
+        Buffer<int> out = g.realize({64, rows}, t);
+        for (int yy = 0; yy < rows; yy++) {
+            for (int xx = 0; xx < 64; xx++) {
+                if (out(xx, yy) != (xx + yy) * 2) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), (xx + yy) * 2);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
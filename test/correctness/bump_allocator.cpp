@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <atomic>
+#include <stdio.h>
+
+using namespace Halide;
+
+std::atomic<int> malloc_count{0};
+std::atomic<int> free_count{0};
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    malloc_count++;
+    void *orig = malloc(x + 32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free_count++;
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    // Heap allocations inside a parallel loop, of a size that isn't
+    // known at compile time.
+    Param<int> p;
+    Func f, g, h;
+    Var x, y, xo, xi;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2 + f(x + 1, y);
+    h(x, y) = g(x, y) + g(x, y + 1);
+    h.split(x, xo, xi, p).parallel(y);
+    f.compute_at(h, xo);
+    g.compute_at(h, xo);
+    p.set(1000);
+
+    h.jit_handlers().custom_malloc = my_malloc;
+    h.jit_handlers().custom_free = my_free;
+
+    const int rows = 64;
+    Buffer<int> reference = h.realize({100000, rows});
+    const int heap_mallocs = malloc_count;
+
+    Target t = get_jit_target_from_environment().with_feature(Target::BumpAllocator);
+    Buffer<int> out(100000, rows);
+    for (int i = 0; i < 3; i++) {
+        malloc_count = 0;
+        h.realize(out, t);
+        for (int y = 0; y < out.height(); y++) {
+            for (int x = 0; x < out.width(); x++) {
+                if (out(x, y) != reference(x, y)) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), reference(x, y));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    // Arenas and their memory are reused across iterations and
+    // invocations, so once warmed up there should be far fewer calls
+    // to malloc than allocations.
+    printf("%d mallocs on the heap, %d with the bump allocator\n",
+           heap_mallocs, (int)malloc_count);
+    if (malloc_count * 4 > heap_mallocs) {
+        printf("Bump allocator did not reduce the number of mallocs\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -2,6 +2,8 @@
 #include "halide_test_dirs.h"
 
 #include <cstdio>
+#include <fstream>
+#include <iterator>
 
 using namespace Halide;
 
@@ -220,6 +222,15 @@ void test_compile_to_everything(Func j, bool do_object) {
     for (auto f : files) {
         Internal::assert_file_exists(f);
     }
+
+    // The compiler log should include the time spent in each lowering pass.
+    std::ifstream log_file(filename_prefix + ".halide_compiler_log");
+    std::string log((std::istreambuf_iterator<char>(log_file)), std::istreambuf_iterator<char>());
+    if (log.find("\"lowering_passes\"") == std::string::npos ||
+        log.find("\"creating initial loop nests\"") == std::string::npos) {
+        printf("Compiler log is missing lowering pass times:\n%s\n", log.c_str());
+        exit(1);
+    }
 }
 
 int main(int argc, char **argv) {
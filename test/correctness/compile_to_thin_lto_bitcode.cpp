@@ -0,0 +1,52 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+#include <cstring>
+
+using namespace Halide;
+
+bool is_bitcode(const std::string &filename) {
+    std::vector<char> data = Internal::read_entire_file(filename);
+    return data.size() > 4 && memcmp(data.data(), "BC\xC0\xDE", 4) == 0;
+}
+
+int main(int argc, char **argv) {
+    Func f, g;
+    Var x, y;
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+    f.compute_root().parallel(y);
+
+    const std::string prefix = Internal::get_test_tmp_dir() + "compile_to_thin_lto_bitcode";
+    const std::string plain_file = prefix + ".bc";
+    const std::string thin_file = prefix + ".thinlto.bc";
+    const std::string runtime_file = prefix + "_runtime.thinlto.bc";
+    for (const auto &file : {plain_file, thin_file, runtime_file}) {
+        Internal::ensure_no_file_exists(file);
+    }
+
+    // A pipeline that shares a runtime with others is compiled without one.
+    Target t = get_host_target().with_feature(Target::NoRuntime);
+    Module m = g.compile_to_module({}, "compile_to_thin_lto_bitcode", t);
+    m.compile({{OutputFileType::bitcode, plain_file},
+               {OutputFileType::thin_lto_bitcode, thin_file}});
+    compile_standalone_runtime({{OutputFileType::thin_lto_bitcode, runtime_file}}, t);
+
+    for (const auto &file : {plain_file, thin_file, runtime_file}) {
+        Internal::assert_file_exists(file);
+        if (!is_bitcode(file)) {
+            printf("%s is not a bitcode file\n", file.c_str());
+            return -1;
+        }
+    }
+
+    // The ThinLTO bitcode carries a module summary on top of the same module.
+    if (Internal::file_stat(thin_file).file_size <= Internal::file_stat(plain_file).file_size) {
+        printf("%s has no room for a module summary\n", thin_file.c_str());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
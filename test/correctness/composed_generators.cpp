@@ -0,0 +1,153 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that a composition of Generators builds one pipeline, in which
+// the Output of the first stage is an ordinary Func that can be computed
+// inside the loops of the second.
+
+class Brighten : public Generator<Brighten> {
+public:
+    Input<Buffer<int, 2>> input{"input"};
+    Input<int> offset{"offset"};
+    Output<Buffer<int, 2>> brightened{"brightened"};
+
+    void generate() {
+        brightened(x, y) = input(x, y) + offset;
+    }
+
+    void schedule() {
+        brightened.vectorize(x, 4);
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+class Blur : public Generator<Blur> {
+public:
+    GeneratorParam<int> radius{"radius", 1};
+
+    Input<Buffer<int, 2>> input{"input"};
+    Input<int> offset{"offset"};
+    Output<Buffer<int, 2>> blurred{"blurred"};
+
+    void generate() {
+        blurred(x, y) = input(x - radius, y) + input(x + radius, y) - offset;
+    }
+
+private:
+    Var x{"x"}, y{"y"};
+};
+
+HALIDE_REGISTER_GENERATOR(Brighten, composed_brighten)
+HALIDE_REGISTER_GENERATOR(Blur, composed_blur)
+HALIDE_REGISTER_GENERATOR_COMPOSITION(composed_brighten_blur, "composed_brighten", "composed_blur")
+
+// Find the loops that the producer of brightened is inside.
+class FindBrightenedLoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    std::vector<std::string> loops;
+
+    void visit(const For *op) override {
+        loops.push_back(op->name);
+        IRVisitor::visit(op);
+        loops.pop_back();
+    }
+
+    void visit(const ProducerConsumer *op) override {
+        if (op->is_producer && op->name == "brightened") {
+            found = true;
+            enclosing_loops = loops;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    bool found = false;
+    std::vector<std::string> enclosing_loops;
+};
+
+bool brightened_is_computed_per_row(const GeneratorParamsMap &params, bool *per_row) {
+    auto g = GeneratorRegistry::create("composed_brighten_blur", GeneratorContext(get_jit_target_from_environment()));
+    g->set_generatorparam_values(params);
+    Module m = g->build_module("composed_brighten_blur");
+    FindBrightenedLoops finder;
+    for (const auto &f : m.functions()) {
+        f.body.accept(&finder);
+    }
+    if (!finder.found) {
+        printf("There is no producer of brightened in the fused pipeline\n");
+        return false;
+    }
+    *per_row = false;
+    for (const auto &l : finder.enclosing_loops) {
+        if (starts_with(l, "blurred.s0.y")) {
+            *per_row = true;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int W = 32, H = 8, radius = 2, offset = 3;
+
+    auto g = GeneratorRegistry::create("composed_brighten_blur", GeneratorContext(get_jit_target_from_environment()));
+    g->set_generatorparam_values({{"composed_blur.radius", std::to_string(radius)},
+                                  {"compute_at.composed_brighten", "composed_blur.y"}});
+
+    // The offset is shared by both stages, and the input of the second
+    // stage is the output of the first, so only one of each is left.
+    int inputs = 0;
+    for (const auto &a : g->arginfos()) {
+        inputs += a.dir == ArgInfoDirection::Input;
+    }
+    if (inputs != 2) {
+        printf("Expected the composition to have 2 inputs, but it has %d\n", inputs);
+        return -1;
+    }
+
+    Callable c = g->compile_to_callable();
+    Buffer<int> in(W + 2 * radius, H);
+    in.set_min(-radius, 0);
+    in.for_each_element([&](int x, int y) { in(x, y) = x * 7 + y; });
+    Buffer<int> out(W, H);
+    if (c(in, offset, out) != 0) {
+        printf("Calling the fused pipeline failed\n");
+        return -1;
+    }
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            const int correct = (in(x - radius, y) + offset) + (in(x + radius, y) + offset) - offset;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    // The output of the first stage is computed at root by default, and
+    // inside the rows of the second when asked to.
+    bool per_row = false;
+    if (!brightened_is_computed_per_row({}, &per_row)) {
+        return -1;
+    }
+    if (per_row) {
+        printf("brightened was not computed at root by default\n");
+        return -1;
+    }
+    if (!brightened_is_computed_per_row({{"compute_at.composed_brighten", "composed_blur.y"}}, &per_row)) {
+        return -1;
+    }
+    if (!per_row) {
+        printf("brightened was not computed per row of blurred\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -24,8 +24,10 @@ int main(int argc, char **argv) {
         "arm-64-android",
         "arm-64-ios",
         "arm-64-linux",
+        "arm-64-linux-sve2-vector_bits_256",
         "arm-64-windows",
         "arm-64-windows-d3d12compute",
+        "riscv-64-linux-rvv-vector_bits_128",
         "x86-32-linux",
         "x86-32-osx",
         "x86-32-windows",
@@ -0,0 +1,82 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+    target.set_feature(Target::CUDAAsyncCopies);
+
+    ImageParam in(Int(32), 2);
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = in(x, y) * 2 + 1;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.gpu_tile(x, y, xi, yi, 16, 16);
+    Callable c = g.compile_to_callable({in}, target);
+
+    const int width = 256, height = 256;
+    for (int iter = 0; iter < 4; iter++) {
+        // Each upload is staged and asynchronous, so change the input
+        // right after each run to check the upload didn't read from it
+        // late.
+        Buffer<int> input(width + 1, height);
+        input.for_each_element([&](int x, int y) { input(x, y) = x + y * 3 + iter; });
+        Buffer<int> output(width, height);
+        int result = c(input, output);
+        if (result != 0) {
+            printf("Run %d failed with %d\n", iter, result);
+            return 1;
+        }
+        Buffer<int> original_input = input.copy();
+        input.fill(-1);
+
+        output.copy_to_host();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int correct = (original_input(x, y) * 2 + 1) + (original_input(x + 1, y) * 2 + 1);
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // A staged copy back to the host of a crop should leave the rest of
+    // the host allocation alone.
+    {
+        Buffer<int> input(width + 1, height);
+        input.fill(3);
+        Buffer<int> output(width, height);
+        if (c(input, output) != 0) {
+            printf("Run failed\n");
+            return 1;
+        }
+        output.copy_to_host();
+        output.fill(0);
+        output.set_host_dirty(false);
+        Buffer<int> crop(output.get()->cropped(0, 16, 32).cropped(1, 8, 8));
+        crop.set_device_dirty();
+        crop.copy_to_host();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                bool in_crop = x >= 16 && x < 48 && y >= 8 && y < 16;
+                int correct = in_crop ? 14 : 0;
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d after copying back a crop\n", x, y, output(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
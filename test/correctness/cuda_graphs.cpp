@@ -0,0 +1,134 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int (*graph_begin)(void *, uint64_t) = nullptr;
+int (*graph_end)(void *) = nullptr;
+
+bool check(Buffer<int> &input, Buffer<int> &output, int offset) {
+    output.copy_to_host();
+    for (int y = 0; y < output.height(); y++) {
+        for (int x = 0; x < output.width(); x++) {
+            int correct = (input(x, y) * 2 + offset) + (input(x + 1, y) * 2 + offset);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    ImageParam in(Int(32), 2);
+    Param<int> offset;
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = in(x, y) * 2 + offset;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.gpu_tile(x, y, xi, yi, 16, 16);
+    Callable c = g.compile_to_callable({in, offset}, target);
+
+    // Find the graph sessions in the cuda runtime module.
+    for (Internal::JITModule &m : Internal::JITSharedRuntime::get(nullptr, target, false)) {
+        auto begin_sym = m.find_symbol_by_name("halide_cuda_graph_begin");
+        auto end_sym = m.find_symbol_by_name("halide_cuda_graph_end");
+        if (begin_sym.address && end_sym.address) {
+            graph_begin = (decltype(graph_begin))begin_sym.address;
+            graph_end = (decltype(graph_end))end_sym.address;
+            break;
+        }
+    }
+    if (!graph_begin || !graph_end) {
+        printf("Failed to find the cuda graph functions in the runtime\n");
+        return 1;
+    }
+
+    const halide_device_interface_t *cuda = get_device_interface_for_device_api(DeviceAPI::CUDA, target);
+    const int width = 256, height = 256;
+    Buffer<int> input(width + 1, height), other_input(width + 1, height);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y * 3; });
+    other_input.for_each_element([&](int x, int y) { other_input(x, y) = x * 5 - y; });
+    input.copy_to_device(cuda);
+    other_input.copy_to_device(cuda);
+    Buffer<int> output(width, height);
+    output.device_malloc(cuda);
+
+    JITUserContext ctx;
+    const uint64_t key = 1;
+
+    // The first run records the launches, and later ones replay them,
+    // even with new values in the input.
+    for (int i = 0; i < 4; i++) {
+        if (i == 2) {
+            input.for_each_element([&](int x, int y) { input(x, y) = x * y; });
+            input.set_host_dirty();
+            input.copy_to_device(cuda);
+        }
+        if (graph_begin(&ctx, key) != 0 ||
+            c(&ctx, input, 1, output) != 0 ||
+            graph_end(&ctx) != 0) {
+            printf("Run %d failed\n", i);
+            return 1;
+        }
+        if (!check(input, output, 1)) {
+            return 1;
+        }
+    }
+
+    // Runs with different arguments fall back to launching the kernels
+    // as usual.
+    for (int i = 0; i < 2; i++) {
+        if (graph_begin(&ctx, key) != 0 ||
+            c(&ctx, other_input, 3, output) != 0 ||
+            graph_end(&ctx) != 0) {
+            printf("Run with other arguments failed\n");
+            return 1;
+        }
+        if (!check(other_input, output, 3)) {
+            return 1;
+        }
+    }
+
+    // And a smaller output changes the launches too.
+    Buffer<int> small_output(width / 2, height / 2);
+    small_output.device_malloc(cuda);
+    if (graph_begin(&ctx, key) != 0 ||
+        c(&ctx, input, 1, small_output) != 0 ||
+        graph_end(&ctx) != 0) {
+        printf("Run with a smaller output failed\n");
+        return 1;
+    }
+    if (!check(input, small_output, 1)) {
+        return 1;
+    }
+
+    // Sessions can't nest.
+    if (graph_begin(&ctx, key) != 0) {
+        printf("halide_cuda_graph_begin failed\n");
+        return 1;
+    }
+    JITUserContext quiet;
+    quiet.handlers.custom_error = [](JITUserContext *, const char *) {};
+    if (graph_begin(&quiet, key + 1) == 0) {
+        printf("Nested halide_cuda_graph_begin should have failed\n");
+        return 1;
+    }
+    graph_end(&ctx);
+
+    printf("Success!\n");
+    return 0;
+}
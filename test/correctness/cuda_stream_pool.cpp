@@ -0,0 +1,112 @@
+#include "Halide.h"
+
+#include <future>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int (*stream_pool_get_stream)(void *, void *, void **) = nullptr;
+int (*stream_pool_release)(void *) = nullptr;
+
+struct PooledStreamContext : public JITUserContext {
+    static int get_stream(JITUserContext *ctx, void *cuda_ctx, void **stream) {
+        return stream_pool_get_stream(ctx, cuda_ctx, stream);
+    }
+
+    PooledStreamContext() {
+        handlers.custom_cuda_get_stream = get_stream;
+    }
+
+    ~PooledStreamContext() {
+        stream_pool_release(this);
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::CUDA)) {
+        printf("[SKIP] CUDA not enabled.\n");
+        return 0;
+    }
+
+    ImageParam in(Int(32), 2);
+    Func f("f"), g("g");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = in(x, y) * 2 + 1;
+    g(x, y) = f(x, y) + f(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.gpu_tile(x, y, xi, yi, 16, 16);
+    Callable c = g.compile_to_callable({in}, target);
+
+    // Find the stream pool in the cuda runtime module.
+    for (Internal::JITModule &m : Internal::JITSharedRuntime::get(nullptr, target, false)) {
+        auto get_stream_sym = m.find_symbol_by_name("halide_cuda_stream_pool_get_stream");
+        auto release_sym = m.find_symbol_by_name("halide_cuda_stream_pool_release");
+        if (get_stream_sym.address && release_sym.address) {
+            stream_pool_get_stream = (decltype(stream_pool_get_stream))get_stream_sym.address;
+            stream_pool_release = (decltype(stream_pool_release))release_sym.address;
+            break;
+        }
+    }
+    if (!stream_pool_get_stream || !stream_pool_release) {
+        printf("Failed to find the cuda stream pool in the runtime\n");
+        return 1;
+    }
+
+    const int width = 256, height = 256;
+    Buffer<int> input(width + 1, height);
+    input.for_each_element([&](int x, int y) { input(x, y) = x + y * 3; });
+    // Upload the shared input up front, so the invocations below
+    // aren't racing to do it.
+    input.copy_to_device(get_device_interface_for_device_api(DeviceAPI::CUDA, target));
+
+    // Run several invocations at once, each with a user context of its
+    // own, and so a pooled stream of its own. They all read the same
+    // input.
+    const int num_invocations = 8;
+    std::vector<Buffer<int>> outputs;
+    for (int i = 0; i < num_invocations; i++) {
+        outputs.emplace_back(width, height);
+    }
+    for (int iter = 0; iter < 4; iter++) {
+        std::vector<std::future<void>> futures;
+        for (int i = 0; i < num_invocations; i++) {
+            futures.emplace_back(std::async(std::launch::async, [&, i]() {
+                PooledStreamContext ctx;
+                int result = c(&ctx, input, outputs[i]);
+                if (result != 0) {
+                    printf("Invocation %d failed with %d\n", i, result);
+                    exit(1);
+                }
+            }));
+        }
+        for (auto &fut : futures) {
+            fut.get();
+        }
+
+        // Copying back without a user context uses a different stream,
+        // which must wait for the kernels that wrote each output.
+        for (int i = 0; i < num_invocations; i++) {
+            outputs[i].copy_to_host();
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < width; x++) {
+                    int correct = (input(x, y) * 2 + 1) + (input(x + 1, y) * 2 + 1);
+                    if (outputs[i](x, y) != correct) {
+                        printf("outputs[%d](%d, %d) = %d instead of %d\n", i, x, y, outputs[i](x, y), correct);
+                        return 1;
+                    }
+                }
+            }
+            // Make the next iteration overwrite the device copy.
+            outputs[i].fill(0);
+            outputs[i].set_host_dirty();
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
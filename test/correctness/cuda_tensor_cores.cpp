@@ -0,0 +1,107 @@
+#include "Halide.h"
+
+#include <regex>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Matrix multiplies that accumulate into MMAFragment tiles are done with
+// warp matrix multiply instructions. Check the results against the host,
+// and that the instructions were used.
+
+template<typename T, typename Acc>
+bool test(const Target &t, const char *name, bool transpose_b) {
+    printf("Testing %s matrix multiplies%s\n", name,
+           transpose_b ? " with a column major rhs" : "");
+
+    const int M = 64, N = 48, K = 64;
+    Buffer<T> a(K, M);
+    Buffer<T> b = transpose_b ? Buffer<T>(K, N) : Buffer<T>(N, K);
+    // Small integers, so that all of the types give exact results.
+    const int bias = type_of<T>().is_uint() ? 0 : 3;
+    a.for_each_value([=](T &v) { v = (T)(float)(rand() % 7 - bias); });
+    b.for_each_value([=](T &v) { v = (T)(float)(rand() % 7 - bias); });
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    RDom r(0, K);
+    Func mm("mm"), out("out");
+    Expr rhs = transpose_b ? b(r, x) : b(x, r);
+    mm(x, y) += cast<Acc>(a(r, y)) * cast<Acc>(rhs);
+    out(x, y) = mm(x, y);
+
+    // The reduction is 8 deep for tf32, and 16 deep otherwise.
+    const int depth = type_of<T>() == Float(32) ? 8 : 16;
+    RVar ro("ro"), ri("ri");
+    out.tile(x, y, xi, yi, 16, 16)
+        .vectorize(xi)
+        .vectorize(yi)
+        .gpu_blocks(x, y);
+    mm.compute_at(out, x)
+        .store_in(MemoryType::MMAFragment)
+        .tile(x, y, xi, yi, 16, 16)
+        .vectorize(xi)
+        .vectorize(yi);
+    mm.update()
+        .tile(x, y, xi, yi, 16, 16)
+        .split(r, ro, ri, depth)
+        .reorder(ri, xi, yi, ro, x, y)
+        .atomic()
+        .vectorize(ri)
+        .vectorize(xi)
+        .vectorize(yi);
+
+    Buffer<Acc> result = out.realize({N, M}, t);
+    result.copy_to_host();
+    for (int j = 0; j < M; j++) {
+        for (int i = 0; i < N; i++) {
+            double correct = 0;
+            for (int k = 0; k < K; k++) {
+                double rhs_k = transpose_b ? (float)b(k, i) : (float)b(i, k);
+                correct += (float)a(k, j) * rhs_k;
+            }
+            if ((double)result(i, j) != correct) {
+                printf("result(%d, %d) = %f instead of %f\n", i, j, (double)result(i, j), correct);
+                return false;
+            }
+        }
+    }
+
+    // The PTX source is an embedded string in the compiled code.
+    Buffer<uint8_t> buf = out.compile_to_module(std::vector<Argument>(), "out", t).compile_to_buffer();
+    std::basic_regex<char> regex("wmma[.]mma[.]sync");
+    if (!std::regex_search((const char *)buf.begin(), (const char *)buf.end(), regex)) {
+        printf("Did not find a warp matrix multiply in the compiled code. "
+               "Rerun the test with HL_DEBUG_CODEGEN=1 to debug\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    int capability = t.get_cuda_capability_lower_bound();
+    if (capability < 70) {
+        printf("[SKIP] Cuda (with compute capability 7.0) is not enabled in target: %s\n",
+               t.to_string().c_str());
+        return 0;
+    }
+    t = t.with_feature(Target::CUDATensorCores);
+
+    if (!test<float16_t, float>(t, "float16", false) ||
+        !test<float16_t, float>(t, "float16", true)) {
+        return -1;
+    }
+    if (capability >= 75 &&
+        (!test<int8_t, int32_t>(t, "int8", false) ||
+         !test<uint8_t, int32_t>(t, "uint8", true))) {
+        return -1;
+    }
+    if (capability >= 80 &&
+        (!test<bfloat16_t, float>(t, "bfloat16", false) ||
+         !test<float, float>(t, "tf32", false))) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
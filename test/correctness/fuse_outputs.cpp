@@ -0,0 +1,71 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+// Count the loops over y.
+class CountLoops : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const For *op) override {
+        if (ends_with(op->name, ".y")) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    Buffer<int> in(64, 32);
+    in.for_each_element([&](int i, int j) { in(i, j) = i + 3 * j; });
+
+    Func f("f"), g("g"), h("h");
+    f(x, y) = in(x, y) + 1;
+    g(x, y) = in(x, y) * 2;
+    // h reads a different input, so fusing it gains nothing.
+    h(x, y) = x + y;
+
+    for (bool fuse : {false, true}) {
+        Target t = get_jit_target_from_environment();
+        if (fuse) {
+            t = t.with_feature(Target::FuseOutputs);
+        }
+
+        Pipeline p({f, g, h});
+        CountLoops counter;
+        p.add_custom_lowering_pass(&counter, []() {});
+
+        Buffer<int> out_f(64, 32), out_g(64, 32), out_h(64, 32);
+        p.realize({out_f, out_g, out_h}, t);
+
+        int expected = fuse ? 2 : 3;
+        if (counter.count != expected) {
+            printf("Expected %d loops over y with fuse = %d, but found %d\n", expected, fuse, counter.count);
+            return 1;
+        }
+
+        for (int j = 0; j < 32; j++) {
+            for (int i = 0; i < 64; i++) {
+                if (out_f(i, j) != in(i, j) + 1 ||
+                    out_g(i, j) != in(i, j) * 2 ||
+                    out_h(i, j) != i + j) {
+                    printf("Wrong result at %d, %d\n", i, j);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
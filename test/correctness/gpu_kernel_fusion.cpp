@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+class CountKernels : public IRVisitor {
+public:
+    int count = 0;
+
+protected:
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (op->for_type == ForType::GPUBlock) {
+            // Don't count the inner loops over blocks.
+            count++;
+            return;
+        }
+        IRVisitor::visit(op);
+    }
+};
+
+class CheckKernelCount : public IRMutator {
+    int correct;
+
+public:
+    CheckKernelCount(int correct)
+        : correct(correct) {
+    }
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        CountKernels c;
+        s.accept(&c);
+
+        if (c.count != correct) {
+            printf("There were %d kernels. There were supposed to be %d\n", c.count, correct);
+            exit(1);
+        }
+
+        return s;
+    }
+};
+
+// Run a Func with an update definition, with each stage tiled the same
+// way or differently, and check the number of kernels and the output.
+int test(int pure_tile, int update_tile, int expected_kernels) {
+    Func f("f");
+    Var x, y, xi, yi;
+
+    f(x, y) = x + y;
+    f(x, y) = f(x, y) * 2;
+    f(x, y) += 3;
+
+    f.gpu_tile(x, y, xi, yi, pure_tile, pure_tile, TailStrategy::GuardWithIf);
+    f.update(0).gpu_tile(x, y, xi, yi, pure_tile, pure_tile, TailStrategy::GuardWithIf);
+    f.update(1).gpu_tile(x, y, xi, yi, update_tile, update_tile, TailStrategy::GuardWithIf);
+
+    f.add_custom_lowering_pass(new CheckKernelCount(expected_kernels));
+
+    Buffer<int> out = f.realize({100, 50});
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            int correct = (x + y) * 2 + 3;
+            if (out(x, y) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    // All three stages launch the same blocks of threads, and only
+    // touch f at the site each thread computes, so they can run as one
+    // kernel.
+    if (test(8, 8, 1) != 0) {
+        return 1;
+    }
+
+    // The last stage launches a different number of threads per block.
+    if (test(8, 16, 2) != 0) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
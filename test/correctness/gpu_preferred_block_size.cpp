@@ -0,0 +1,50 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    DeviceAPI api;
+    if (t.has_feature(Target::CUDA)) {
+        api = DeviceAPI::CUDA;
+    } else if (t.has_feature(Target::OpenCL)) {
+        api = DeviceAPI::OpenCL;
+    } else {
+        printf("[SKIP] No CUDA or OpenCL target enabled.\n");
+        return 0;
+    }
+
+    Expr block_size = gpu_preferred_block_size(api, 32, 0);
+
+    // The preferred size must be a legal one.
+    Func size("size");
+    size() = block_size;
+    Buffer<int> result = size.realize();
+    if (result() <= 0 || result() > 1024) {
+        printf("Unexpected preferred block size %d\n", result());
+        return 1;
+    }
+    printf("Preferred block size: %d\n", result());
+
+    // Any specialization chosen from it computes the same thing.
+    Func f("f");
+    Var x, y, xi, yi;
+    f(x, y) = x * 3 + y;
+    f.gpu_tile(x, y, xi, yi, 8, 8);
+    f.specialize(block_size >= 256).gpu_tile(x, y, xi, yi, 32, 8);
+    f.specialize(block_size >= 128).gpu_tile(x, y, xi, yi, 16, 8);
+
+    Buffer<int> out = f.realize({123, 45});
+    for (int y = 0; y < out.height(); y++) {
+        for (int x = 0; x < out.width(); x++) {
+            if (out(x, y) != x * 3 + y) {
+                printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), x * 3 + y);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
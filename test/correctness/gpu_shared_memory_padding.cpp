@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <map>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// A tile of shared memory that is written a row at a time and read a
+// column at a time has its rows padded, so that the threads of a warp
+// don't all read from the same bank. Check that the shared allocation
+// is padded and that the transpose is still correct.
+
+class FindSharedMemorySize : public IRMutator {
+    using IRMutator::visit;
+
+    std::map<std::string, Expr> lets;
+
+    Stmt visit(const LetStmt *op) override {
+        lets[op->name] = op->value;
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Allocate *op) override {
+        if (op->memory_type == MemoryType::GPUShared && op->extents.size() == 1) {
+            Expr size = op->extents[0];
+            if (const Variable *v = size.as<Variable>()) {
+                if (lets.count(v->name)) {
+                    size = lets[v->name];
+                }
+            }
+            if (const int64_t *b = as_const_int(simplify(size * op->type.bytes()))) {
+                bytes += *b;
+            }
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int64_t bytes = 0;
+};
+
+int main(int argc, char **argv) {
+    if (!get_jit_target_from_environment().has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    const int W = 256, T = 16;
+    Buffer<float> input(W, W);
+    input.for_each_element([&](int x, int y) { input(x, y) = (float)(x * 1000 + y); });
+
+    Var x, y, xi, yi;
+    Func in_func, out;
+    in_func(x, y) = input(x, y);
+    out(x, y) = in_func(y, x);
+
+    out.gpu_tile(x, y, xi, yi, T, T);
+    in_func.compute_at(out, x).store_in(MemoryType::GPUShared).gpu_threads(x, y);
+
+    FindSharedMemorySize finder;
+    out.add_custom_lowering_pass(&finder, []() {});
+    Buffer<float> output = out.realize({W, W});
+    output.copy_to_host();
+
+    for (int y = 0; y < W; y++) {
+        for (int x = 0; x < W; x++) {
+            float correct = input(y, x);
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %f instead of %f\n", x, y, output(x, y), correct);
+                return -1;
+            }
+        }
+    }
+
+    const int64_t padded = (T + 1) * T * sizeof(float);
+    if (finder.bytes != padded) {
+        printf("Kernel uses %lld bytes of shared memory instead of %lld\n",
+               (long long)finder.bytes, (long long)padded);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -145,6 +145,35 @@ int main(int argc, char **argv) {
                 }
             }
         }
+        {
+            // 2D loads clamped to the edge of the image
+            Buffer<int> input(10, 10);
+            input.set_min(3, 4);
+            input.for_each_element([&](int x, int y) { input(x, y) = x + 100 * y; });
+            ImageParam param(Int(32), 2);
+            param.set(input);
+            param.store_in(memory_type);
+
+            Func clamped = BoundaryConditions::repeat_edge(param);
+            Func g("g");
+            Var x("x"), y("y"), xi("xi"), yi("yi");
+            g(x, y) = clamped(x, y);
+            g.gpu_tile(x, y, xi, yi, 8, 8, TailStrategy::GuardWithIf);
+
+            Buffer<int> out(20, 20);
+            g.realize(out);
+            for (int y = 0; y < 20; y++) {
+                for (int x = 0; x < 20; x++) {
+                    int cx = std::min(std::max(x, 3), 12);
+                    int cy = std::min(std::max(y, 4), 13);
+                    int correct = cx + 100 * cy;
+                    if (out(x, y) != correct) {
+                        printf("out[2D-clamp][%d](%d, %d) = %d instead of %d\n", (int)memory_type, x, y, out(x, y), correct);
+                        return -1;
+                    }
+                }
+            }
+        }
     }
 
     printf("Success!\n");
@@ -0,0 +1,103 @@
+#include "Halide.h"
+#include <algorithm>
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Atomic updates over gpu_threads are combined across each warp (or
+// subgroup, or SIMD-group) before they reach memory. Check the results
+// of sums and maxima over thread loops, including ones with a partial
+// last block, and that the warp-level operations were used.
+
+class CountWarpReductions : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Call *op) override {
+        if (starts_with(op->name, "llvm.nvvm.shfl") ||
+            starts_with(op->name, "sub_group_reduce_") ||
+            starts_with(op->name, "simd_")) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+template<typename T>
+bool test(const Target &t, const char *name, bool use_max, int size) {
+    printf("Testing %s of %d %s values\n", use_max ? "max" : "sum", size, name);
+
+    Buffer<T> input(size, 4);
+    input.for_each_value([](T &v) { v = (T)(rand() % 100 - 50); });
+
+    Var y("y");
+    RDom r(0, size);
+    Func f("f");
+    if (use_max) {
+        f(y) = input.type().min();
+        f(y) = max(f(y), input(r, y));
+    } else {
+        f(y) = cast<T>(0);
+        f(y) += input(r, y);
+    }
+
+    RVar ro("ro"), ri("ri");
+    f.update()
+        .atomic()
+        .split(r, ro, ri, 256)
+        .gpu_blocks(ro, y)
+        .gpu_threads(ri);
+
+    CountWarpReductions counter;
+    f.add_custom_lowering_pass(&counter, []() {});
+    Buffer<T> result = f.realize({4}, t);
+    result.copy_to_host();
+
+    for (int j = 0; j < 4; j++) {
+        T correct = use_max ? std::numeric_limits<T>::lowest() : (T)0;
+        for (int i = 0; i < size; i++) {
+            correct = use_max ? std::max(correct, input(i, j)) : (T)(correct + input(i, j));
+        }
+        if (result(j) != correct) {
+            printf("result(%d) = %f instead of %f\n", j, (double)result(j), (double)correct);
+            return false;
+        }
+    }
+
+    bool expect_warp_reductions =
+        t.has_feature(Target::CUDA) ||
+        (t.has_feature(Target::OpenCL) && t.has_feature(Target::CLSubgroups)) ||
+        (t.has_feature(Target::Metal) && t.has_feature(Target::MetalSIMDGroups));
+    if (expect_warp_reductions && counter.count == 0) {
+        printf("The atomic update was not reduced across warps\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+    if (t.has_feature(Target::Vulkan) || t.has_feature(Target::OpenGLCompute) ||
+        t.has_feature(Target::D3D12Compute)) {
+        printf("[SKIP] Atomic updates are not supported on target: %s\n", t.to_string().c_str());
+        return 0;
+    }
+
+    if (!test<float>(t, "float", false, 1024) ||
+        !test<int32_t>(t, "int32", false, 1000) ||
+        !test<int32_t>(t, "int32", true, 1000) ||
+        !test<uint32_t>(t, "uint32", true, 777)) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
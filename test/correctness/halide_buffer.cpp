@@ -3,9 +3,23 @@
 #include "HalideBuffer.h"
 
 #include <stdio.h>
+#include <thread>
+#include <vector>
 
 using namespace Halide::Runtime;
 
+// A stand-in for halide_do_par_for that runs each task on its own thread.
+int thread_per_task_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+    std::vector<std::thread> threads;
+    for (int i = min; i < min + size; i++) {
+        threads.emplace_back([=]() { f(user_context, i, closure); });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    return 0;
+}
+
 template<typename T1, typename T2>
 void check_equal_shape(const Buffer<T1> &a, const Buffer<T2> &b) {
     if (a.dimensions() != b.dimensions()) abort();
@@ -487,6 +501,42 @@ int main(int argc, char **argv) {
         assert(b.dim(3).stride() == b2.dim(3).stride());
     }
 
+    {
+        // Large copies and fills are split across the parallel_for.
+        Buffer<>::set_parallel_for(thread_per_task_par_for);
+
+        Buffer<int> big(1024, 1024, 3);
+        big.fill(7);
+        if (!big.all_equal(7)) {
+            abort();
+        }
+
+        Buffer<float> planar(1000, 600, 3);
+        planar.for_each_element([&](int x, int y, int c) { planar(x, y, c) = x + y * 1000 + c * 1000000; });
+        Buffer<float> larger(1010, 610, 3);
+        larger.fill(-1.0f);
+        larger.copy_from(planar);
+        larger.for_each_element([&](int x, int y, int c) {
+            float correct = (x < 1000 && y < 600) ? x + y * 1000 + c * 1000000 : -1.0f;
+            if (larger(x, y, c) != correct) {
+                abort();
+            }
+        });
+
+        // The innermost dimension is not dense in the source.
+        Buffer<float> interleaved = Buffer<float>::make_interleaved(1000, 600, 3);
+        interleaved.copy_from(planar);
+        Buffer<float> planar_again(1000, 600, 3);
+        planar_again.copy_from(interleaved);
+        planar_again.for_each_element([&](int x, int y, int c) {
+            if (planar_again(x, y, c) != planar(x, y, c)) {
+                abort();
+            }
+        });
+
+        Buffer<>::set_parallel_for(nullptr);
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -185,7 +185,7 @@ void do_test() {
     luma_buf.copy_from(color_buf);
     luma_buf.slice(2);
 
-    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "tiff"};
+    std::vector<std::string> formats = {"ppm", "pgm", "tmp", "mat", "npy", "tiff"};
 #ifndef HALIDE_NO_JPEG
     formats.push_back("jpg");
 #endif
@@ -255,10 +255,53 @@ void test_mat_header() {
     }
 }
 
+void test_mapped(const std::string &format) {
+#ifndef _WIN32
+    std::cout << "Testing mapped files for format: " << format << "\n";
+    std::string filename = Internal::get_test_tmp_dir() + "test_mapped." + format;
+
+    // Whatever is written to a created Image ends up in the file.
+    {
+        Runtime::Buffer<> created;
+        if (!Tools::create_mapped(filename, halide_type_of<float>(), {37, 19, 3}, &created)) {
+            std::cout << "Could not create " << filename << "\n";
+            abort();
+        }
+        Runtime::Buffer<float> buf = created;
+        buf.for_each_element([&](int x, int y, int c) { buf(x, y, c) = x + y * 100 + c * 10000; });
+    }
+
+    // A mapped Image matches one loaded normally, and writing to it
+    // doesn't change the file.
+    Buffer<float> loaded = Tools::load_image(filename);
+    Buffer<float> mapped;
+    if (!Tools::load_mapped(filename, &mapped)) {
+        std::cout << "Could not map " << filename << "\n";
+        abort();
+    }
+    mapped.for_each_element([&](const int *pos) {
+        float correct = pos[0] + pos[1] * 100 + pos[2] * 10000;
+        if (loaded(pos) != correct || mapped(pos) != correct) {
+            std::cout << "Mismatch in " << filename << ": " << loaded(pos) << " " << mapped(pos) << " " << correct << "\n";
+            abort();
+        }
+    });
+    mapped.fill(0.0f);
+    Buffer<float> reloaded = Tools::load_image(filename);
+    if (reloaded(1, 1, 1) != 10101.0f) {
+        std::cout << "Writing to a mapped image changed " << filename << "\n";
+        abort();
+    }
+#endif
+}
+
 int main(int argc, char **argv) {
     do_test<uint8_t>();
     do_test<uint16_t>();
     test_mat_header();
+    test_mapped("tmp");
+    test_mapped("mat");
+    test_mapped("npy");
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,103 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <fstream>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that an incremental generator build leaves its outputs alone
+// when nothing that they depend on has changed, and rebuilds them
+// when something has.
+
+class Scale : public Generator<Scale> {
+public:
+    GeneratorParam<int> factor{"factor", 2};
+
+    Input<Buffer<int, 1>> input{"input"};
+    Output<Buffer<int, 1>> output{"output"};
+
+    void generate() {
+        output(x) = input(x) * factor;
+    }
+
+    void schedule() {
+        output.vectorize(x, 4);
+    }
+
+private:
+    Var x{"x"};
+};
+
+std::string read_file(const std::string &filename) {
+    std::vector<char> v = read_entire_file(filename);
+    return std::string(v.begin(), v.end());
+}
+
+void write_file(const std::string &filename, const std::string &s) {
+    write_entire_file(filename, s.data(), s.size());
+}
+
+int main(int argc, char **argv) {
+    Target t = get_host_target();
+
+    const std::string dir = Internal::get_test_tmp_dir();
+    const std::string header = dir + "incremental_generator.h";
+    const std::string fingerprint = dir + "incremental_generator.fingerprint";
+    Internal::ensure_no_file_exists(header);
+    Internal::ensure_no_file_exists(fingerprint);
+
+    ExecuteGeneratorArgs args;
+    args.output_dir = dir;
+    args.output_types = {OutputFileType::c_header, OutputFileType::object};
+    args.targets = {t.with_feature(Target::NoRuntime)};
+    args.generator_name = "incremental_generator";
+    args.create_generator = [](const std::string &name, const GeneratorContext &context) -> AbstractGeneratorPtr {
+        return context.create<Scale>();
+    };
+    args.incremental = true;
+
+    execute_generator(args);
+    if (!file_exists(header) || !file_exists(fingerprint)) {
+        printf("The first build did not write its outputs and fingerprint\n");
+        return -1;
+    }
+    const std::string first_fingerprint = read_file(fingerprint);
+
+    // Mark the header, so we can tell whether the next build rewrites it.
+    const std::string marker = "// Left over from an earlier build\n";
+    write_file(header, marker);
+    execute_generator(args);
+    if (read_file(header) != marker) {
+        printf("An unchanged generator rewrote its outputs\n");
+        return -1;
+    }
+    if (read_file(fingerprint) != first_fingerprint) {
+        printf("An unchanged generator changed its fingerprint\n");
+        return -1;
+    }
+
+    // Changing a GeneratorParam must rebuild the outputs.
+    args.generator_params["factor"] = "3";
+    execute_generator(args);
+    if (read_file(header) == marker) {
+        printf("Changing a GeneratorParam did not rebuild the outputs\n");
+        return -1;
+    }
+    if (read_file(fingerprint) == first_fingerprint) {
+        printf("Changing a GeneratorParam did not change the fingerprint\n");
+        return -1;
+    }
+
+    // So must losing one of the outputs.
+    Internal::ensure_no_file_exists(header);
+    execute_generator(args);
+    if (!file_exists(header)) {
+        printf("A missing output was not rebuilt\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
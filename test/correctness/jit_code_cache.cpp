@@ -0,0 +1,128 @@
+#include "Halide.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int count_cache_files(const std::string &dir) {
+    int count = 0;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.path().extension() == ".hlobj") {
+            count++;
+        }
+    }
+    return count;
+}
+
+bool realize_and_check(int k) {
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x * k + y;
+
+    Buffer<int> result = f.realize({64, 64});
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            if (result(x, y) != x * k + y) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x * k + y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] The JIT code cache doesn't apply to WebAssembly.\n");
+        return 0;
+    }
+
+    std::string dir = Internal::dir_make_temp();
+    Internal::set_jit_code_cache_directory(dir);
+
+    // A cold compile misses, and stores an entry.
+    Internal::JITCodeCacheStats before = Internal::get_jit_code_cache_stats();
+    if (!realize_and_check(3)) {
+        return 1;
+    }
+    Internal::JITCodeCacheStats after = Internal::get_jit_code_cache_stats();
+    if (after.hits != before.hits || after.misses != before.misses + 1) {
+        printf("Expected the first compile to miss in the cache\n");
+        return 1;
+    }
+    if (count_cache_files(dir) != 1) {
+        printf("Expected one cache entry after the first compile\n");
+        return 1;
+    }
+
+    // Compiling the same pipeline again should load that entry rather
+    // than compiling it again.
+    before = after;
+    if (!realize_and_check(3)) {
+        return 1;
+    }
+    after = Internal::get_jit_code_cache_stats();
+    if (after.hits != before.hits + 1 || after.misses != before.misses) {
+        printf("Expected the second compile to hit in the cache\n");
+        return 1;
+    }
+    if (count_cache_files(dir) != 1) {
+        printf("Expected the second compile not to add a cache entry\n");
+        return 1;
+    }
+
+    // A corrupt entry must be ignored and replaced.
+    std::string entry_path;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        entry_path = entry.path().string();
+    }
+    int64_t entry_size = (int64_t)std::filesystem::file_size(entry_path);
+    {
+        std::ofstream corrupt(entry_path, std::ios::binary | std::ios::trunc);
+        corrupt << "not an object file";
+    }
+    before = after;
+    if (!realize_and_check(3)) {
+        return 1;
+    }
+    after = Internal::get_jit_code_cache_stats();
+    if (after.hits != before.hits || after.misses != before.misses + 1) {
+        printf("Expected the corrupt entry to be ignored\n");
+        return 1;
+    }
+    if ((int64_t)std::filesystem::file_size(entry_path) != entry_size) {
+        printf("Expected the corrupt entry to be replaced\n");
+        return 1;
+    }
+
+    // With room for only one entry, adding another evicts the first.
+    Internal::set_jit_code_cache_max_size(entry_size + entry_size / 2);
+    if (!realize_and_check(5)) {
+        return 1;
+    }
+    if (count_cache_files(dir) != 1) {
+        printf("Expected eviction to leave one cache entry\n");
+        return 1;
+    }
+
+    // Disabling the cache stops new entries being written.
+    Internal::set_jit_code_cache_directory("");
+    if (!realize_and_check(7)) {
+        return 1;
+    }
+    if (count_cache_files(dir) != 1) {
+        printf("Expected no new cache entries once the cache is disabled\n");
+        return 1;
+    }
+
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+bool check(Pipeline p, const Target &t, int k) {
+    Buffer<int> result = p.realize({64, 64}, t);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = x * k + y;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    // Going back and forth between Targets re-lowers the pipeline
+    // each time, but the second time around each one should reuse the
+    // code compiled for it the first time. Check the results stay
+    // right as the Target and the parameter change underneath it.
+    Param<int> k;
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x * k + y;
+    f.specialize(k == 3).vectorize(x, 8);
+    Pipeline p(f);
+
+    Target t = get_jit_target_from_environment();
+    Target other = t.with_feature(Target::NoAsserts);
+    for (int iter = 0; iter < 6; iter++) {
+        k.set(iter + 1);
+        if (!check(p, iter % 2 ? other : t, iter + 1)) {
+            printf("Failed on iteration %d\n", iter);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
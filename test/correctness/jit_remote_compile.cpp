@@ -0,0 +1,93 @@
+#include "Halide.h"
+
+#include <filesystem>
+#include <stdio.h>
+
+using namespace Halide;
+
+namespace {
+
+int remote_compiles = 0;
+
+// Stands in for a compile server, by compiling in this process.
+bool compile_here(const std::vector<uint8_t> &serialized_module, Internal::JITCodeCacheEntry &entry) {
+    remote_compiles++;
+    entry = Internal::compile_serialized_module_for_jit(serialized_module);
+    return true;
+}
+
+bool fail_to_compile(const std::vector<uint8_t> &serialized_module, Internal::JITCodeCacheEntry &entry) {
+    remote_compiles++;
+    return false;
+}
+
+bool realize_and_check(int k) {
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x * k + y;
+    f.vectorize(x, 8).parallel(y);
+
+    Buffer<int> result = f.realize({64, 64});
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            if (result(x, y) != x * k + y) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x * k + y);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] Remote compilation doesn't apply to WebAssembly.\n");
+        return 0;
+    }
+
+    Internal::set_jit_code_cache_directory("");
+
+    // Code compiled from the serialized module must work once loaded.
+    Internal::set_jit_remote_compiler(compile_here);
+    if (!realize_and_check(3)) {
+        return 1;
+    }
+    if (remote_compiles != 1) {
+        printf("Expected one remote compile, got %d\n", remote_compiles);
+        return 1;
+    }
+
+    // If the remote compiler fails, the pipeline is compiled locally.
+    remote_compiles = 0;
+    Internal::set_jit_remote_compiler(fail_to_compile);
+    if (!realize_and_check(5)) {
+        return 1;
+    }
+    if (remote_compiles != 1) {
+        printf("Expected one failed remote compile, got %d\n", remote_compiles);
+        return 1;
+    }
+
+    // Remotely compiled code is cached, so compiling the same pipeline
+    // again doesn't need the remote compiler.
+    std::string dir = Internal::dir_make_temp();
+    Internal::set_jit_code_cache_directory(dir);
+    remote_compiles = 0;
+    Internal::set_jit_remote_compiler(compile_here);
+    if (!realize_and_check(7) || !realize_and_check(7)) {
+        return 1;
+    }
+    if (remote_compiles != 1) {
+        printf("Expected the second compile to hit in the cache, got %d remote compiles\n", remote_compiles);
+        return 1;
+    }
+
+    Internal::set_jit_remote_compiler(nullptr);
+    Internal::set_jit_code_cache_directory("");
+    std::filesystem::remove_all(dir);
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,48 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Jitting a pipeline with no work on the device for a target with a
+// device API should not make the shared runtime for that device.
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not use the shared runtimes.\n");
+        return 0;
+    }
+    if (!t.has_gpu_feature()) {
+        t = t.with_feature(Target::OpenCL);
+    }
+    Target jit_target = t.with_feature(Target::JIT).with_feature(Target::UserContext);
+
+    JITSharedRuntime::release_all();
+
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x + y;
+    f.vectorize(x, 8);
+    Buffer<int> result = f.realize({32, 32}, t);
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            if (result(x, y) != x + y) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), x + y);
+                return 1;
+            }
+        }
+    }
+
+    // Without create, this returns just the runtimes that exist.
+    std::vector<JITModule> runtimes = JITSharedRuntime::get(nullptr, jit_target, false);
+    if (runtimes.size() != 1) {
+        printf("Expected just the main shared runtime, but found %d runtimes\n",
+               (int)runtimes.size());
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,147 @@
+#include "Halide.h"
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+// Count the loads of a buffer in the innermost loops.
+class CountInnerLoads : public IRMutator {
+    using IRMutator::visit;
+
+    int inner = 0;
+
+    Stmt visit(const For *op) override {
+        class HasLoop : public IRVisitor {
+            using IRVisitor::visit;
+            void visit(const For *op) override {
+                result = true;
+            }
+
+        public:
+            bool result = false;
+        } has_loop;
+        op->body.accept(&has_loop);
+        ScopedValue<int> old(inner, has_loop.result ? 0 : 1);
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Load *op) override {
+        if (inner && op->name == name) {
+            count++;
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string name;
+
+public:
+    int count = 0;
+
+    CountInnerLoads(const std::string &name)
+        : name(name) {
+    }
+};
+
+std::string error_msg;
+void my_error(JITUserContext *ucon, const char *msg) {
+    error_msg = msg;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Var x("x"), y("y");
+
+    {
+        // A tap of a filter, chosen at runtime, is the same on every
+        // iteration of the loops over the image, so its load should
+        // be lifted out of them.
+        ImageParam taps(Float(32), 1, "taps");
+        ImageParam in(Float(32), 2, "in");
+        Param<int> k;
+        Func f("f");
+        f(x, y) = in(x, y) * taps(k);
+
+        CountInnerLoads counter("taps");
+        f.add_custom_lowering_pass(&counter, []() {});
+
+        Buffer<float> taps_buf(8), in_buf(64, 16);
+        taps_buf.for_each_element([&](int i) { taps_buf(i) = i * 0.5f; });
+        in_buf.for_each_element([&](int i, int j) { in_buf(i, j) = (float)(i + j); });
+        taps.set(taps_buf);
+        in.set(in_buf);
+        k.set(3);
+
+        Buffer<float> out = f.realize({64, 16});
+        if (counter.count != 0) {
+            printf("The load of taps was not lifted out of the inner loop\n");
+            return 1;
+        }
+        for (int j = 0; j < 16; j++) {
+            for (int i = 0; i < 64; i++) {
+                float correct = (i + j) * 1.5f;
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %f instead of %f\n", i, j, out(i, j), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    {
+        // The first element of g is written in the loop that reads
+        // it, so its load must stay where it is.
+        Func g("g");
+        RDom r(0, 10);
+        g(x) = x + 1;
+        g(r) = g(0) * 2 + r;
+
+        CountInnerLoads counter("g");
+        g.add_custom_lowering_pass(&counter, []() {});
+
+        Buffer<int> out = g.realize({10});
+        if (counter.count == 0) {
+            printf("A load of a buffer written in the loop was lifted out of it\n");
+            return 1;
+        }
+        for (int i = 0; i < 10; i++) {
+            // g(0) doubles on the first iteration, and the rest are
+            // computed from the doubled value.
+            int correct = (i == 0) ? 2 : 4 + i;
+            if (out(i) != correct) {
+                printf("out(%d) = %d instead of %d\n", i, out(i), correct);
+                return 1;
+            }
+        }
+    }
+
+    {
+        // With check_no_alias, an output that overlaps an input is
+        // an error.
+        ImageParam in(Int(32), 1, "in");
+        Func h("h");
+        h(x) = in(x) + 1;
+        h.jit_handlers().custom_error = my_error;
+
+        Target t = get_jit_target_from_environment().with_feature(Target::CheckNoAlias);
+        Callable c = h.compile_to_callable({in}, t);
+
+        Buffer<int> buf(100), other(50);
+        buf.fill(0);
+        if (c(buf, other) != 0 || !error_msg.empty()) {
+            printf("Unexpected error: %s\n", error_msg.c_str());
+            return 1;
+        }
+        Buffer<int> overlapping(buf.get()->cropped(0, 20, 50));
+        if (c(buf, overlapping) == 0 || !strstr(error_msg.c_str(), "overlaps")) {
+            printf("Expected an error for overlapping buffers, got: %s\n", error_msg.c_str());
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include "Halide.h"
+#include <limits>
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Vector division and mod by a Param are lowered to multiplies and
+// shifts by values computed outside the loop. Check that no vector
+// divisions are left, and that the results match Halide's Euclidean
+// division for denominators of every sign, including zero.
+
+class CountVectorDivisions : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Div *op) override {
+        count += op->type.is_vector();
+        return IRMutator::visit(op);
+    }
+
+    Expr visit(const Mod *op) override {
+        count += op->type.is_vector();
+        return IRMutator::visit(op);
+    }
+
+public:
+    int count = 0;
+};
+
+template<typename T>
+T euclidean_div(T a, T b) {
+    if (b == 0) {
+        return 0;
+    }
+    int64_t q = (int64_t)a / (int64_t)b;
+    int64_t r = (int64_t)a - q * (int64_t)b;
+    if (r < 0) {
+        q += (b > 0) ? -1 : 1;
+    }
+    return (T)q;
+}
+
+template<typename T>
+T euclidean_mod(T a, T b) {
+    if (b == 0) {
+        return 0;
+    }
+    return (T)((int64_t)a - (int64_t)euclidean_div(a, b) * (int64_t)b);
+}
+
+template<typename T>
+bool test(const char *type_name) {
+    const int N = 1024;
+    Buffer<T> input(N);
+    input.for_each_value([](T &v) { v = (T)rand(); });
+    // Include the extremes.
+    input(0) = std::numeric_limits<T>::min();
+    input(1) = std::numeric_limits<T>::max();
+    input(2) = 0;
+
+    Param<T> d;
+    Var x;
+    Func f;
+    f(x) = Tuple(input(x) / d, input(x) % d);
+    f.vectorize(x, (int)(32 / sizeof(T)));
+
+    CountVectorDivisions counter;
+    f.add_custom_lowering_pass(&counter, []() {});
+    f.compile_jit();
+    if (counter.count != 0) {
+        printf("%d vector divisions of type %s were not lowered\n",
+               counter.count, type_name);
+        return false;
+    }
+
+    std::vector<T> denominators = {0, 1, 2, 3, 7, 10, 64, 100, 127,
+                                   std::numeric_limits<T>::max(),
+                                   (T)(std::numeric_limits<T>::max() - 1),
+                                   (T)(std::numeric_limits<T>::max() / 2 + 2)};
+    if (std::is_signed<T>::value) {
+        for (T v : {(T)-1, (T)-2, (T)-3, (T)-10, std::numeric_limits<T>::min(),
+                    (T)(std::numeric_limits<T>::min() + 1)}) {
+            denominators.push_back(v);
+        }
+    }
+    for (int i = 0; i < 20; i++) {
+        denominators.push_back((T)rand());
+    }
+
+    for (T denominator : denominators) {
+        d.set(denominator);
+        Realization r = f.realize({N});
+        Buffer<T> q = r[0], m = r[1];
+        for (int i = 0; i < N; i++) {
+            T correct_q = euclidean_div(input(i), denominator);
+            T correct_m = euclidean_mod(input(i), denominator);
+            if (q(i) != correct_q || m(i) != correct_m) {
+                printf("%s: %lld / %lld = %lld, %lld instead of %lld, %lld\n",
+                       type_name,
+                       (long long)input(i), (long long)denominator,
+                       (long long)q(i), (long long)m(i),
+                       (long long)correct_q, (long long)correct_m);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    if (!test<uint8_t>("uint8") ||
+        !test<int8_t>("int8") ||
+        !test<uint16_t>("uint16") ||
+        !test<int16_t>("int16") ||
+        !test<uint32_t>("uint32") ||
+        !test<int32_t>("int32")) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
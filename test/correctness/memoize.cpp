@@ -88,6 +88,8 @@ int main(int argc, char **argv) {
         f() = f_memoized();
         f_memoized.compute_root().memoize();
 
+        halide_memoization_cache_stats_t before = Internal::JITSharedRuntime::memoization_cache_stats();
+
         Buffer<uint8_t> result1 = f.realize();
         Buffer<uint8_t> result2 = f.realize();
 
@@ -95,6 +97,12 @@ int main(int argc, char **argv) {
         assert(result2(0) == 42);
 
         assert(call_count == 1);
+
+        halide_memoization_cache_stats_t after = Internal::JITSharedRuntime::memoization_cache_stats();
+        assert(after.misses == before.misses + 1);
+        assert(after.hits == before.hits + 1);
+        assert(after.entries >= 1);
+        assert(after.current_size > 0 && after.current_size <= after.max_size);
     }
 
     {
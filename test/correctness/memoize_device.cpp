@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <cstdio>
+
+using namespace Halide;
+
+// Check that the results of a memoized Func computed on a GPU stay in
+// the cache on the device, are charged to the device budget, and are
+// evicted when it shrinks.
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+
+    Param<int32_t> p;
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    Func f("f"), g("g");
+    f(x, y) = x + y * p;
+    g(x, y) = f(x, y) * 2;
+
+    f.compute_root().gpu_tile(x, y, xi, yi, 8, 8).memoize();
+    g.gpu_tile(x, y, xi, yi, 8, 8);
+
+    auto check = [&](Buffer<int32_t> out) {
+        out.copy_to_host();
+        for (int j = 0; j < out.height(); j++) {
+            for (int i = 0; i < out.width(); i++) {
+                int correct = (i + j * p.get()) * 2;
+                if (out(i, j) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                    return false;
+                }
+            }
+        }
+        return true;
+    };
+
+    p.set(3);
+    if (!check(g.realize({64, 64}, t))) {
+        return 1;
+    }
+
+    halide_memoization_cache_stats_t stats = Internal::JITSharedRuntime::memoization_cache_stats();
+    if (stats.misses != 1 || stats.current_device_size != 64 * 64 * (int64_t)sizeof(int32_t)) {
+        printf("Expected one miss and the result on the device, got %d misses and %d device bytes\n",
+               (int)stats.misses, (int)stats.current_device_size);
+        return 1;
+    }
+
+    if (!check(g.realize({64, 64}, t))) {
+        return 1;
+    }
+
+    stats = Internal::JITSharedRuntime::memoization_cache_stats();
+    if (stats.hits != 1) {
+        printf("Expected one hit, got %d\n", (int)stats.hits);
+        return 1;
+    }
+
+    // Shrinking the device budget evicts the entry.
+    Internal::JITSharedRuntime::memoization_cache_set_device_size(1);
+    stats = Internal::JITSharedRuntime::memoization_cache_stats();
+    if (stats.evictions != 1 || stats.current_device_size != 0) {
+        printf("Expected one eviction and no device bytes, got %d evictions and %d device bytes\n",
+               (int)stats.evictions, (int)stats.current_device_size);
+        return 1;
+    }
+    Internal::JITSharedRuntime::memoization_cache_set_device_size(0);
+
+    if (!check(g.realize({64, 64}, t))) {
+        return 1;
+    }
+
+    stats = Internal::JITSharedRuntime::memoization_cache_stats();
+    if (stats.misses != 2) {
+        printf("Expected two misses, got %d\n", (int)stats.misses);
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
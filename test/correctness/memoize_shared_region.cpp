@@ -0,0 +1,124 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <stdio.h>
+
+#ifdef _WIN32
+int main(int argc, char **argv) {
+    printf("[SKIP] Test requires mmap, which is not available on Windows.\n");
+    return 0;
+}
+#else
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace Halide;
+
+// Check that memoized results stored in a shared region are found
+// after the process's own cache is gone, through another mapping of
+// the same file, as another process (or this one after a restart)
+// would see it.
+
+int call_count = 0;
+
+extern "C" HALIDE_EXPORT_SYMBOL int count_calls_shared(int32_t val, halide_buffer_t *out) {
+    if (!out->is_bounds_query()) {
+        call_count++;
+        Halide::Runtime::Buffer<int32_t> buf(*out);
+        buf.for_each_element([&](int x, int y) {
+            buf(x, y) = x + y + val;
+        });
+    }
+    return 0;
+}
+
+bool realize_and_check(int val) {
+    Param<int32_t> p("p");
+    Func count_calls("count_calls");
+    count_calls.define_extern("count_calls_shared", {p}, Int(32), 2);
+
+    Func f_memoized("f_memoized"), f("f");
+    Var x("x"), y("y");
+    f_memoized(x, y) = count_calls(x, y) * 2;
+    f(x, y) = f_memoized(x, y) + 1;
+    f_memoized.compute_root().memoize();
+
+    p.set(val);
+    Buffer<int32_t> result = f.realize({32, 32});
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = (x + y + val) * 2 + 1;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(int argc, char **argv) {
+    const int64_t size = 1 << 20;
+    std::string filename = Internal::get_test_tmp_dir() + "memoize_shared_region.cache";
+    Internal::ensure_no_file_exists(filename);
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        printf("Failed to create %s\n", filename.c_str());
+        return 1;
+    }
+    void *first = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    void *second = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (first == MAP_FAILED || second == MAP_FAILED) {
+        printf("Failed to map %s\n", filename.c_str());
+        return 1;
+    }
+
+    if (Internal::JITSharedRuntime::memoization_cache_set_shared_region(first, size) != 0) {
+        printf("Failed to set the shared region\n");
+        return 1;
+    }
+
+    if (!realize_and_check(3) || !realize_and_check(3) || call_count != 1) {
+        printf("Memoization within the process failed: %d calls\n", call_count);
+        return 1;
+    }
+
+    // Throw away the runtime, and with it the process's cache, and
+    // use the other mapping of the file.
+    Internal::JITSharedRuntime::release_all();
+    if (Internal::JITSharedRuntime::memoization_cache_set_shared_region(second, size) != 0) {
+        printf("Failed to set the shared region again\n");
+        return 1;
+    }
+
+    if (!realize_and_check(3)) {
+        return 1;
+    }
+    if (call_count != 1) {
+        printf("The result in the shared region was not used\n");
+        return 1;
+    }
+    halide_memoization_cache_stats_t stats = Internal::JITSharedRuntime::memoization_cache_stats();
+    if (stats.shared_hits != 1) {
+        printf("Expected one shared hit, got %d\n", (int)stats.shared_hits);
+        return 1;
+    }
+
+    // A different parameter value is a different entry.
+    if (!realize_and_check(4) || call_count != 2) {
+        printf("A result for the wrong parameter value was used\n");
+        return 1;
+    }
+
+    Internal::JITSharedRuntime::release_all();
+    munmap(first, size);
+    munmap(second, size);
+
+    printf("Success!\n");
+    return 0;
+}
+
+#endif
@@ -0,0 +1,58 @@
+#include "Halide.h"
+
+#include <cstdlib>
+#include <stdio.h>
+#include <string>
+
+using namespace Halide;
+
+// Check that, with HL_PROFILER_MEMORY_TIMELINE set, the profiler
+// report lists the Funcs live at the peak heap usage, and suggests a
+// schedule change for the one holding the most.
+
+std::string report;
+
+void my_print(JITUserContext *, const char *msg) {
+    report += msg;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] The profiler is not supported under WebAssembly.\n");
+        return 0;
+    }
+
+#ifdef _WIN32
+    _putenv_s("HL_PROFILER_MEMORY_TIMELINE", "1");
+#else
+    setenv("HL_PROFILER_MEMORY_TIMELINE", "1", 1);
+#endif
+
+    Var x("x"), y("y");
+    Func big("big"), small("small"), g("g");
+    big(x, y) = x + y;
+    small(x, y) = x * y;
+    g(x, y) = big(x, y) + small(x % 100, y % 100);
+    big.compute_root();
+    small.compute_root();
+
+    g.jit_handlers().custom_print = my_print;
+    g.realize({1000, 1000}, t.with_feature(Target::Profile));
+
+    const std::string big_line = "  big: 4000000 bytes (99%)\n";
+    const std::string small_line = "  small: 40000 bytes (0%)\n";
+    if (report.find(" live at peak heap usage:\n") == std::string::npos ||
+        report.find(big_line) == std::string::npos ||
+        report.find(small_line) == std::string::npos) {
+        printf("The report does not list the Funcs live at peak:\n%s", report.c_str());
+        return -1;
+    }
+    if (report.find("compute_at or store_at of big inside a loop") == std::string::npos) {
+        printf("The report does not suggest scheduling big inside a loop:\n%s", report.c_str());
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Count the functions in a module compiled for more features than the
+// module's target.
+int count_variants(const Module &m) {
+    int count = 0;
+    for (const auto &f : m.functions()) {
+        if (!f.extra_features.empty()) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int main(int argc, char **argv) {
+    Target host = get_jit_target_from_environment();
+    if (host.arch != Target::X86) {
+        printf("[SKIP] Loop multiversioning is only supported on x86.\n");
+        return 0;
+    }
+
+    ImageParam input(Float(32), 2), bytes(UInt(8), 2);
+    Var x, y, xo, xi;
+    RVar rx;
+    RDom r(0, 4);
+
+    // A 512-bit float loop, and an 8-bit dot product.
+    Func f, g;
+    f(x, y) = sqrt(input(x, y)) * 2.0f + input(x, y + 1);
+    g(x, y) += cast<int>(bytes(4 * x + r, y)) * cast<int>(bytes(4 * x + r, y + 1));
+    f.vectorize(x, 16);
+    g.update().split(x, xo, xi, 8).fuse(r, xi, rx).atomic().vectorize(rx);
+
+    {
+        // An SSE4.1 target gets a Skylake version of f's inner loop,
+        // and a Cascade Lake version of g's.
+        Target t("x86-64-linux-sse41-multiversion_loops");
+        if (count_variants(f.compile_to_module({input}, "f", t)) != 1) {
+            printf("Expected one variant of f\n");
+            return -1;
+        }
+        if (count_variants(g.compile_to_module({bytes}, "g", t)) < 1) {
+            printf("Expected a variant of g\n");
+            return -1;
+        }
+
+        // A target that already has those features gets none.
+        Target newest("x86-64-linux-avx512_sapphirerapids-avx512_vnni-avx512_skylake-avx512-avx2-avx-f16c-fma-sse41-multiversion_loops");
+        if (count_variants(f.compile_to_module({input}, "f", newest)) != 0) {
+            printf("Expected no variants of f\n");
+            return -1;
+        }
+    }
+
+    // Whichever version the host picks, the results must match.
+    const int W = 256, H = 64;
+    Buffer<float> in_buf(W, H + 1);
+    Buffer<uint8_t> bytes_buf(4 * W, H + 1);
+    in_buf.for_each_element([&](int x, int y) { in_buf(x, y) = (rand() % 1000) / 10.0f; });
+    bytes_buf.for_each_element([&](int x, int y) { bytes_buf(x, y) = (uint8_t)rand(); });
+    input.set(in_buf);
+    bytes.set(bytes_buf);
+
+    Target base = host;
+    for (Target::Feature feature : {Target::AVX512, Target::AVX512_KNL, Target::AVX512_Skylake,
+                                    Target::AVX512_Cannonlake, Target::AVX512_VNNI,
+                                    Target::AVX512_SapphireRapids, Target::AVXVNNI}) {
+        base = base.without_feature(feature);
+    }
+    Buffer<float> f_out = f.realize({W, H}, base.with_feature(Target::MultiversionLoops));
+    Buffer<int> g_out = g.realize({W, H}, base.with_feature(Target::MultiversionLoops));
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            float correct_f = sqrtf(in_buf(x, y)) * 2.0f + in_buf(x, y + 1);
+            if (f_out(x, y) != correct_f) {
+                printf("f(%d, %d) = %f instead of %f\n", x, y, f_out(x, y), correct_f);
+                return -1;
+            }
+            int correct_g = 0;
+            for (int i = 0; i < 4; i++) {
+                correct_g += bytes_buf(4 * x + i, y) * bytes_buf(4 * x + i, y + 1);
+            }
+            if (g_out(x, y) != correct_g) {
+                printf("g(%d, %d) = %d instead of %d\n", x, y, g_out(x, y), correct_g);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
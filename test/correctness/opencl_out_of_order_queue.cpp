@@ -0,0 +1,69 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (!target.has_feature(Target::OpenCL)) {
+        printf("[SKIP] OpenCL not enabled.\n");
+        return 0;
+    }
+
+    // Turn on the out-of-order queue before the runtime creates one.
+    void (*set_out_of_order_queue)(bool) = nullptr;
+    for (Internal::JITModule &m : Internal::JITSharedRuntime::get(nullptr, target, false)) {
+        auto sym = m.find_symbol_by_name("halide_opencl_set_out_of_order_queue");
+        if (sym.address) {
+            set_out_of_order_queue = (decltype(set_out_of_order_queue))sym.address;
+            break;
+        }
+    }
+    if (!set_out_of_order_queue) {
+        printf("Failed to find halide_opencl_set_out_of_order_queue in the runtime\n");
+        return 1;
+    }
+    set_out_of_order_queue(true);
+
+    // f and g don't depend on each other, so their kernels may run at
+    // the same time. h must wait for both, and the input must not be
+    // overwritten while they're still reading it.
+    ImageParam in(Int(32), 2);
+    Func f("f"), g("g"), h("h");
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    f(x, y) = in(x, y) * 2 + 1;
+    g(x, y) = in(x, y) * 3 - 1;
+    h(x, y) = f(x, y) + g(x + 1, y);
+    f.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    g.compute_root().gpu_tile(x, y, xi, yi, 16, 16);
+    h.gpu_tile(x, y, xi, yi, 16, 16);
+    Callable c = h.compile_to_callable({in}, target);
+
+    const int width = 256, height = 256;
+    Buffer<int> input(width + 1, height);
+    Buffer<int> output(width, height);
+    for (int iter = 0; iter < 4; iter++) {
+        input.for_each_element([&](int x, int y) { input(x, y) = x + y * 3 + iter; });
+        input.set_host_dirty();
+        int result = c(input, output);
+        if (result != 0) {
+            printf("Iteration %d failed with %d\n", iter, result);
+            return 1;
+        }
+
+        output.copy_to_host();
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                int correct = (input(x, y) * 2 + 1) + (input(x + 1, y) * 3 - 1);
+                if (output(x, y) != correct) {
+                    printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
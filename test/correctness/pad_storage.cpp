@@ -0,0 +1,84 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Backends allocate up to 3 extra elements.
+int tolerance = 3 * sizeof(int);
+int expected_allocation = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    if (std::abs((int)x - expected_allocation) > tolerance) {
+        printf("Error! Expected allocation of %d bytes, got %zu bytes (tolerance %d)\n", expected_allocation, x, tolerance);
+        exit(-1);
+    }
+    return malloc(x);
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(ptr);
+}
+
+int run(int W, int H, Expr alignment, int expected_width) {
+    Var x, y;
+    Func f("f"), g("g");
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) + f(x, y + 1);
+    f.compute_root().pad_storage(x, alignment);
+    g.jit_handlers().custom_malloc = my_malloc;
+    g.jit_handlers().custom_free = my_free;
+
+    expected_allocation = expected_width * (H + 1) * sizeof(int);
+    Buffer<int> out = g.realize({W, H});
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 2 * (x + y) + 1;
+            if (out(x, y) != correct) {
+                printf("g(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target target = get_jit_target_from_environment();
+    if (target.arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+    if (target.has_feature(Target::Debug)) {
+        // the runtime debug adds some debug payload to each allocation,
+        // so the 'expected_allocation' is unlikely to be a match.
+        printf("[SKIP] Test incompatible with debug runtime.\n");
+        return 0;
+    }
+
+    // By default rows are padded to a cache line or a vector.
+    int alignment = std::max(64, target.natural_vector_size(UInt(8))) / (int)sizeof(int);
+    auto round_up = [](int x, int a) { return (x + a - 1) / a * a; };
+
+    // A width that isn't a power of two is only aligned.
+    if (run(1000, 16, Expr(), round_up(1000, alignment)) != 0) {
+        return -1;
+    }
+
+    // A power-of-two width gets another cache line.
+    if (run(1024, 16, Expr(), 1024 + alignment) != 0) {
+        return -1;
+    }
+
+    // Small power-of-two strides are left alone.
+    if (run(128, 16, Expr(), 128) != 0) {
+        return -1;
+    }
+
+    // An explicit alignment is used for the padding too.
+    if (run(2048, 16, 32, 2048 + 32) != 0) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
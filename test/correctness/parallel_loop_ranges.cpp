@@ -0,0 +1,74 @@
+#include "Halide.h"
+
+#include <cstdlib>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check that parallel loops compiled with parallel_loop_ranges enter
+// the thread pool through halide_do_parallel_tasks instead of
+// halide_do_par_for, and give the right answers when the thread pool
+// hands out their iterations in guided chunks.
+
+int par_for_calls = 0;
+int counting_par_for(JITUserContext *ctx, int (*f)(JITUserContext *, int, uint8_t *), int min, int extent, uint8_t *closure) {
+    par_for_calls++;
+    for (int i = min; i < min + extent; i++) {
+        if (int result = f(ctx, i, closure)) {
+            return result;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] Skipping test for WebAssembly as the wasm JIT cannot support custom parallel runtimes\n");
+        return 0;
+    }
+
+    // The thread pool reads this when it is first used.
+#ifdef _WIN32
+    _putenv_s("HL_THREAD_POOL_GUIDED", "1");
+#else
+    setenv("HL_THREAD_POOL_GUIDED", "1", 1);
+#endif
+
+    // Iterations of uneven cost, with a parallel loop nested inside
+    // another.
+    const int W = 1000, H = 64;
+    Var x("x"), y("y");
+    RDom r(0, 64);
+    Func f("f"), g("g");
+    f(x, y) = x + y;
+    g(x, y) = select(y % 8 == 0, sum(f(x, y) * r), f(x, y) * 2016);
+    f.compute_at(g, y).parallel(x, 16);
+    g.parallel(y);
+    g.jit_handlers().custom_do_par_for = counting_par_for;
+
+    for (bool ranges : {false, true}) {
+        par_for_calls = 0;
+        Buffer<int> out = g.realize({W, H}, ranges ? t.with_feature(Target::ParallelLoopRanges) : t);
+        for (int yy = 0; yy < H; yy++) {
+            for (int xx = 0; xx < W; xx++) {
+                int correct = (xx + yy) * 2016;
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return -1;
+                }
+            }
+        }
+        if (ranges && par_for_calls != 0) {
+            printf("halide_do_par_for was called %d times with parallel_loop_ranges\n", par_for_calls);
+            return -1;
+        }
+        if (!ranges && par_for_calls == 0) {
+            printf("halide_do_par_for was never called without parallel_loop_ranges\n");
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
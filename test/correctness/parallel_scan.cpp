@@ -0,0 +1,79 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    // Odd sizes, so the blocks don't divide the scans evenly.
+    const int W = 1001, H = 37;
+
+    Buffer<int> in(W, H);
+    in.for_each_value([](int &v) { v = (rand() % 200) - 100; });
+
+    Var x("x"), y("y"), b("b");
+
+    {
+        // A 1D prefix sum.
+        Func f("f");
+        RDom r(1, W - 1);
+        f(x) = in(x, 0);
+        f(r) = f(r - 1) + f(r);
+        f.update().parallel_scan(r, b, 8);
+        Buffer<int> out = f.realize({W});
+        int correct = 0;
+        for (int i = 0; i < W; i++) {
+            correct += in(i, 0);
+            if (out(i) != correct) {
+                printf("prefix sum: out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // An integral image, scanning along x then along y.
+        Func f("f");
+        RDom rx(1, W - 1), ry(1, H - 1);
+        f(x, y) = in(x, y);
+        f(rx, y) += f(rx - 1, y);
+        f(x, ry) += f(x, ry - 1);
+        f.update(0).parallel_scan(rx, b, 4);
+        f.update(1).parallel_scan(ry, b, 5);
+        Buffer<int> out = f.realize({W, H});
+        Buffer<int> correct(W, H);
+        for (int j = 0; j < H; j++) {
+            for (int i = 0; i < W; i++) {
+                correct(i, j) = in(i, j) +
+                                (i > 0 ? correct(i - 1, j) : 0) +
+                                (j > 0 ? correct(i, j - 1) : 0) -
+                                (i > 0 && j > 0 ? correct(i - 1, j - 1) : 0);
+                if (out(i, j) != correct(i, j)) {
+                    printf("integral image: out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct(i, j));
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A running maximum, which isn't a sum, with a scan that doesn't
+        // start at zero.
+        Func f("f");
+        RDom r(10, W - 10);
+        f(x) = in(x, 1);
+        f(r) = max(f(r - 1), in(r, 1));
+        f.update().parallel_scan(r, b, 16);
+        Buffer<int> out = f.realize({W});
+        int correct = 0;
+        for (int i = 0; i < W; i++) {
+            correct = (i <= 9) ? in(i, 1) : std::max(correct, in(i, 1));
+            if (out(i) != correct) {
+                printf("running max: out(%d) = %d instead of %d\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,126 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Check that the partition_cost_model target feature skips partitioning
+// short loops, stays within its budget of loop bodies, and never changes
+// the results.
+
+class CountLoops : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const For *op) override {
+        if (starts_with(op->name, prefix)) {
+            count++;
+        }
+        IRVisitor::visit(op);
+    }
+
+public:
+    std::string prefix;
+    int count = 0;
+};
+
+void set_budget(const char *budget) {
+#ifdef _WIN32
+    _putenv_s("HL_PARTITION_LOOPS_BUDGET", budget);
+#else
+    setenv("HL_PARTITION_LOOPS_BUDGET", budget, 1);
+#endif
+}
+
+int count_loops(Func f, const std::vector<Argument> &args, const Target &t) {
+    CountLoops counter;
+    counter.prefix = f.name() + ".";
+    Module m = f.compile_to_module(args, f.name(), t);
+    for (const auto &fn : m.functions()) {
+        fn.body.accept(&counter);
+    }
+    return counter.count;
+}
+
+int main(int argc, char **argv) {
+    const Target t = get_jit_target_from_environment();
+    const Target cost_model = t.with_feature(Target::PartitionCostModel);
+
+    ImageParam in(Int(32), 2, "in");
+    Buffer<int> input(40, 30);
+    input.for_each_element([&](int x, int y) { input(x, y) = x * 3 + y * 7; });
+    in.set(input);
+
+    Var x("x"), y("y");
+    Func clamped = BoundaryConditions::repeat_edge(in);
+
+    // A stencil over loops with unknown extents is partitioned in both
+    // dimensions, unless the budget runs out.
+    Func blur("blur");
+    blur(x, y) = clamped(x - 1, y) + clamped(x + 1, y) + clamped(x, y - 1) + clamped(x, y + 1);
+
+    // A loop with a short, constant extent isn't worth partitioning.
+    Func short_row("short_row");
+    short_row(x, y) = clamped(x - 2, y) + clamped(x + 2, y);
+    short_row.bound(x, 0, 8);
+
+    set_budget("");
+    const int blur_default = count_loops(blur, {in}, t);
+    const int blur_cost_model = count_loops(blur, {in}, cost_model);
+    set_budget("2");
+    const int blur_budget_2 = count_loops(blur, {in}, cost_model);
+    set_budget("0");
+    const int blur_budget_0 = count_loops(blur, {in}, cost_model);
+    set_budget("");
+
+    if (blur_cost_model != blur_default) {
+        printf("The cost model changed how a large stencil was partitioned: %d loops instead of %d\n",
+               blur_cost_model, blur_default);
+        return -1;
+    }
+    if (!(blur_budget_0 < blur_budget_2 && blur_budget_2 < blur_default)) {
+        printf("Expected fewer loops with a smaller budget, but got %d, %d and %d loops with budgets of 0, 2 and 8\n",
+               blur_budget_0, blur_budget_2, blur_default);
+        return -1;
+    }
+
+    const int short_default = count_loops(short_row, {in}, t);
+    const int short_cost_model = count_loops(short_row, {in}, cost_model);
+    if (short_cost_model >= short_default) {
+        printf("Expected the cost model to skip partitioning a short loop, but got %d loops instead of %d\n",
+               short_cost_model, short_default);
+        return -1;
+    }
+
+    // The results must not depend on how the loops were partitioned.
+    for (const char *budget : {"", "0", "2"}) {
+        set_budget(budget);
+        Buffer<int> expected = blur.realize({40, 30}, t);
+        Buffer<int> actual = blur.realize({40, 30}, cost_model);
+        for (int yy = 0; yy < 30; yy++) {
+            for (int xx = 0; xx < 40; xx++) {
+                if (actual(xx, yy) != expected(xx, yy)) {
+                    printf("blur(%d, %d) = %d instead of %d with budget \"%s\"\n",
+                           xx, yy, actual(xx, yy), expected(xx, yy), budget);
+                    return -1;
+                }
+            }
+        }
+    }
+    set_budget("");
+
+    Buffer<int> expected = short_row.realize({8, 30}, t);
+    Buffer<int> actual = short_row.realize({8, 30}, cost_model);
+    for (int yy = 0; yy < 30; yy++) {
+        for (int xx = 0; xx < 8; xx++) {
+            if (actual(xx, yy) != expected(xx, yy)) {
+                printf("short_row(%d, %d) = %d instead of %d\n",
+                       xx, yy, actual(xx, yy), expected(xx, yy));
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
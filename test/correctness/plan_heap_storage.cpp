@@ -0,0 +1,76 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int malloc_count = 0;
+size_t largest_malloc = 0;
+
+void *my_malloc(JITUserContext *user_context, size_t x) {
+    malloc_count++;
+    largest_malloc = std::max(largest_malloc, x);
+    void *orig = malloc(x + 32);
+    void *ptr = (void *)((((size_t)orig + 32) >> 5) << 5);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(JITUserContext *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    const int size = 100000;
+
+    // A chain of heap-allocated intermediates. Each one is dead once
+    // the next has been computed, so two slots in the arena suffice.
+    Func f[5];
+    Var x;
+    f[0](x) = x;
+    for (int i = 1; i < 5; i++) {
+        f[i](x) = f[i - 1](x) + f[i - 1](x + 1);
+        f[i - 1].compute_root();
+    }
+
+    f[4].jit_handlers().custom_malloc = my_malloc;
+    f[4].jit_handlers().custom_free = my_free;
+
+    Buffer<int> reference = f[4].realize({size});
+    if (malloc_count != 4) {
+        printf("Expected 4 allocations without storage planning: %d\n", malloc_count);
+        return -1;
+    }
+
+    malloc_count = 0;
+    largest_malloc = 0;
+    Target t = get_jit_target_from_environment().with_feature(Target::PlanHeapStorage);
+    Buffer<int> planned = f[4].realize({size}, t);
+
+    if (malloc_count != 1) {
+        printf("Expected a single arena allocation: %d\n", malloc_count);
+        return -1;
+    }
+
+    // Two live intermediates at a time, plus padding and alignment.
+    size_t expected = 2 * (size + 4) * sizeof(int) + 1024;
+    if (largest_malloc > expected) {
+        printf("Arena of %d bytes is larger than expected %d\n",
+               (int)largest_malloc, (int)expected);
+        return -1;
+    }
+
+    for (int i = 0; i < size; i++) {
+        if (planned(i) != reference(i)) {
+            printf("planned(%d) = %d instead of %d\n", i, planned(i), reference(i));
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -68,6 +68,48 @@ public:
     }
 };
 
+// Check that no serial loop over the lanes of a vector of the given
+// size is left, as there would be if a vectorized loop body had been
+// scalarized.
+class CheckNotScalarized : public IRMutator {
+    int lanes;
+
+    class FindScalarizedLoops : public IRVisitor {
+        using IRVisitor::visit;
+
+        void visit(const For *op) override {
+            if (op->for_type == ForType::Serial && is_const(op->extent, lanes)) {
+                found = true;
+            }
+            IRVisitor::visit(op);
+        }
+
+    public:
+        int lanes;
+        bool found = false;
+
+        FindScalarizedLoops(int lanes)
+            : lanes(lanes) {
+        }
+    };
+
+public:
+    CheckNotScalarized(int lanes)
+        : lanes(lanes) {
+    }
+    using IRMutator::mutate;
+
+    Stmt mutate(const Stmt &s) override {
+        FindScalarizedLoops f(lanes);
+        s.accept(&f);
+        if (f.found) {
+            printf("There was a serial loop of %d iterations; expected none\n", lanes);
+            exit(-1);
+        }
+        return s;
+    }
+};
+
 int predicated_tail_test(const Target &t) {
     int size = 73;
     for (auto i : {TailStrategy::Predicate, TailStrategy::PredicateLoads, TailStrategy::PredicateStores}) {
@@ -464,6 +506,45 @@ int vectorized_predicated_load_lut_test(const Target &t) {
     return 0;
 }
 
+int vectorized_predicated_reduction_test(const Target &t) {
+    Buffer<int> in(1024), weights(1024);
+    in.for_each_element([&](int x) { in(x) = (x * 7) % 13; });
+    weights.for_each_element([&](int x) { weights(x) = x % 5 + 1; });
+
+    // The condition on the RDom depends on the data, so the vectorized
+    // reduction must mask off the lanes that don't satisfy it, rather
+    // than fall back to a serial loop over the lanes.
+    RDom r(0, 1024);
+    r.where(in(r) % 3 == 0);
+
+    Func f("f");
+    f() = 0;
+    f() += weights(r);
+    f.update().atomic().vectorize(r, 16);
+    if (t.has_feature(Target::HVX)) {
+        f.update().hexagon();
+    }
+
+    // The load of the weights is predicated, and the scalar store of
+    // the sum is guarded by whether any lane is on instead.
+    f.add_custom_lowering_pass(new CheckPredicatedStoreLoad(0, 1));
+    f.add_custom_lowering_pass(new CheckNotScalarized(16));
+
+    Buffer<int> im = f.realize();
+
+    int correct = 0;
+    for (int x = 0; x < 1024; x++) {
+        if (in(x) % 3 == 0) {
+            correct += weights(x);
+        }
+    }
+    if (im() != correct) {
+        printf("f() = %d instead of %d\n", im(), correct);
+        return -1;
+    }
+    return 0;
+}
+
 }  // namespace
 
 int main(int argc, char **argv) {
@@ -529,6 +610,11 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    printf("Running vectorized predicated reduction test\n");
+    if (vectorized_predicated_reduction_test(t) != 0) {
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
\ No newline at end of file
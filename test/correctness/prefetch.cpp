@@ -15,6 +15,23 @@ Expr wild() {
     return Variable::make(halide_type_of<T>(), "*");
 }
 
+class CollectTunedDistances : public IRVisitor {
+private:
+    using IRVisitor::visit;
+
+    void visit(const Call *op) override {
+        IRVisitor::visit(op);
+        if (op->name == "halide_tuned_prefetch_distance") {
+            lookups++;
+        } else if (op->name == "halide_tuned_prefetch_distance_report") {
+            reports++;
+        }
+    }
+
+public:
+    int lookups = 0, reports = 0;
+};
+
 class CollectPrefetches : public IRVisitor {
 private:
     using IRVisitor::visit;
@@ -469,6 +486,68 @@ int test12(const Target &t) {
     return 0;
 }
 
+int test13(const Target &t) {
+    Func g("g");
+    Var x("x"), y("y");
+
+    g(x, y) = x + y;
+    g.prefetch(g, y, y, 1);
+
+    Module m = g.compile_to_module({}, "", t);
+    CollectPrefetches collect;
+    m.functions()[0].body.accept(&collect);
+
+    // The loop over y writes to g, so all of the prefetches of the
+    // next row of g should be marked as prefetches for writing.
+    if (collect.prefetches.empty()) {
+        std::cout << "Expect prefetches of the output\n";
+        return -1;
+    }
+    for (const auto &args : collect.prefetches) {
+        if (args.size() % 2 != 1 || !is_const_one(args.back())) {
+            std::cout << "Expect a prefetch for writing, got args of size " << args.size() << "\n";
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int test14(const Target &t) {
+    Func f("f"), g("g");
+    Var x("x"), y("y");
+
+    f(x, y) = x + y;
+    g(x, y) = f(x, y) * 2;
+
+    f.compute_root();
+    g.prefetch(f, y, y, tuned_prefetch_distance(2));
+
+    Module m = g.compile_to_module({}, "", t);
+    CollectTunedDistances collect_tuned;
+    m.functions()[0].body.accept(&collect_tuned);
+    if (collect_tuned.lookups != 1 || collect_tuned.reports != 1) {
+        std::cout << "Expect one lookup and one report of the tuned prefetch distance, got "
+                  << collect_tuned.lookups << " and " << collect_tuned.reports << "\n";
+        return -1;
+    }
+
+    // Run it enough times for the tuning to finish, and check the
+    // prefetch distance changing underneath doesn't change the result.
+    for (int i = 0; i < 20; i++) {
+        Buffer<int> result = g.realize({64, 64}, t);
+        for (int y = 0; y < result.height(); y++) {
+            for (int x = 0; x < result.width(); x++) {
+                int correct = (x + y) * 2;
+                if (result(x, y) != correct) {
+                    printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
 }  // anonymous namespace
 
 int main(int argc, char **argv) {
@@ -476,7 +555,7 @@ int main(int argc, char **argv) {
     std::cout << "Testing target: " << t << "\n";
 
     using Fn = int (*)(const Target &t);
-    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12};
+    std::vector<Fn> tests = {test1, test2, test3, test4, test5, test6, test7, test8, test9, test10, test11, test12, test13, test14};
 
     for (size_t i = 0; i < tests.size(); i++) {
         printf("Running prefetch test %d\n", (int)i + 1);
@@ -0,0 +1,70 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int check(const Buffer<int> &hist, const int *reference, const char *name) {
+    for (int i = 0; i < 256; i++) {
+        if (hist(i) != reference[i]) {
+            printf("%s: hist(%d) = %d instead of %d\n", name, i, hist(i), reference[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // An odd size, so the copies don't divide the RVars evenly.
+    const int W = 123, H = 77;
+
+    Buffer<uint8_t> in(W, H);
+    int reference[256] = {0};
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            in(x, y) = rand() & 0xff;
+            reference[in(x, y)]++;
+        }
+    }
+
+    Var x("x"), u("u");
+    RDom r(in);
+
+    {
+        // One copy per thread.
+        Func hist("hist");
+        hist(x) = 0;
+        hist(cast<int>(in(r.x, r.y))) += 1;
+        hist.update().privatize(r.y, u, 8);
+        hist.update().vectorize(x, 8);
+        if (check(hist.realize({256}), reference, "parallel")) {
+            return -1;
+        }
+    }
+
+    {
+        // One copy per vector lane.
+        Func hist("hist");
+        hist(x) = 0;
+        hist(cast<int>(in(r.x, r.y))) += 1;
+        hist.update().privatize(r.x, u, 8, PrivatizeStrategy::Vectorized);
+        if (check(hist.realize({256}), reference, "vectorized")) {
+            return -1;
+        }
+    }
+
+    {
+        // Both: one copy per thread, each with a copy per vector lane.
+        Func hist("hist");
+        hist(x) = 0;
+        hist(cast<int>(in(r.x, r.y))) += 1;
+        Func per_thread = hist.update().privatize(r.y, u, 4);
+        Var v("v");
+        per_thread.update().privatize(r.x, v, 8, PrivatizeStrategy::Vectorized);
+        if (check(hist.realize({256}), reference, "parallel and vectorized")) {
+            return -1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+// realize(sizes) skips the output bounds query when nothing it depends
+// on has changed, and recycles the host memory of outputs that have
+// been released, up to the limit of the Pipeline's buffer pool. Check that the results stay right as the parameters
+// and sizes change underneath it.
+
+namespace {
+
+bool check(const Buffer<int> &result, int k) {
+    for (int y = 0; y < result.height(); y++) {
+        for (int x = 0; x < result.width(); x++) {
+            int correct = x * k + y;
+            if (result(x, y) != correct) {
+                printf("result(%d, %d) = %d instead of %d\n", x, y, result(x, y), correct);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Param<int> k, n;
+    Func f("f");
+    Var x("x"), y("y");
+    f(x, y) = x * k + y;
+    // The size of the output depends on a parameter, so the bounds
+    // query must be redone when it changes.
+    f.bound(x, 0, n);
+    Pipeline p(f);
+
+    const void *last_host = nullptr;
+    for (int iter = 0; iter < 8; iter++) {
+        k.set(iter);
+        n.set(iter < 4 ? 32 : 48);
+        Buffer<int> result = p.realize({iter % 2 ? 24 : 32, 16});
+        if (result.width() != (iter % 2 ? 24 : 32) || result.height() != 16) {
+            printf("Wrong output size %d x %d on iteration %d\n",
+                   result.width(), result.height(), iter);
+            return 1;
+        }
+        if (!check(result, iter)) {
+            printf("Failed on iteration %d\n", iter);
+            return 1;
+        }
+        // Only the size of the allocation, which depends on n,
+        // matters for reuse. The previous result has been released.
+        if (iter != 0 && iter != 4 && result.data() != last_host) {
+            printf("The output allocation was not reused on iteration %d\n", iter);
+            return 1;
+        }
+        last_host = result.data();
+    }
+
+    // An output that is still alive must not be handed out again.
+    k.set(3);
+    Buffer<int> first = p.realize({48, 16});
+    k.set(5);
+    Buffer<int> second = p.realize({48, 16});
+    if (first.data() == second.data()) {
+        printf("An output allocation still in use was reused\n");
+        return 1;
+    }
+    if (!check(first, 3) || !check(second, 5)) {
+        return 1;
+    }
+
+    // With no pool, or after the pool has been emptied, the results
+    // are still right.
+    auto realize = [&]() -> Buffer<int> { return p.realize({48, 16}); };
+    p.set_buffer_pool_limit(0);
+    for (int iter = 0; iter < 2; iter++) {
+        k.set(iter + 7);
+        if (!check(realize(), iter + 7)) {
+            printf("Failed without a buffer pool on iteration %d\n", iter);
+            return 1;
+        }
+    }
+    p.set_buffer_pool_limit(Pipeline::default_buffer_pool_limit);
+    realize();
+    p.release_buffer_pool();
+    k.set(9);
+    if (!check(realize(), 9)) {
+        printf("Failed after releasing the buffer pool\n");
+        return 1;
+    }
+    // Once the pool has memory in it again, it is reused.
+    last_host = realize().data();
+    if (realize().data() != last_host) {
+        printf("The output allocation was not reused after releasing the buffer pool\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
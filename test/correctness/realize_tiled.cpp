@@ -0,0 +1,74 @@
+#include "Halide.h"
+
+#include <stdio.h>
+
+using namespace Halide;
+
+int main(int argc, char **argv) {
+    ImageParam in(Int(32), 2, "in");
+    Func blur_x("blur_x"), blur_y("blur_y");
+    Var x("x"), y("y");
+    blur_x(x, y) = in(x - 1, y) + in(x, y) + in(x + 1, y);
+    blur_y(x, y) = blur_x(x, y - 1) + blur_x(x, y) + blur_x(x, y + 1);
+    blur_x.compute_root();
+    blur_y.vectorize(x, 8);
+
+    Pipeline p(blur_y);
+
+    // Not a multiple of the tile size, so the edge tiles are smaller.
+    const int width = 200, height = 150;
+    const int tile_width = 64, tile_height = 48;
+    auto input_value = [](int x, int y) { return x * 3 + y * 5; };
+
+    Buffer<int> output(width, height);
+    int num_tiles = 0;
+    bool bad_input_region = false;
+    p.realize_tiled(
+        {width, height}, {tile_width, tile_height},
+        [&](const std::string &name, Buffer<> &region) {
+            if (name != in.name() ||
+                region.dim(0).extent() > tile_width + 2 + 8 ||
+                region.dim(1).extent() > tile_height + 4) {
+                printf("Unexpected input region for %s: %d x %d\n", name.c_str(),
+                       region.dim(0).extent(), region.dim(1).extent());
+                bad_input_region = true;
+            }
+            Buffer<int> r = region.as<int>();
+            r.for_each_element([&](int x, int y) { r(x, y) = input_value(x, y); });
+        },
+        [&](const Realization &tile) {
+            Buffer<int> t = tile[0];
+            t.for_each_element([&](int x, int y) { output(x, y) = t(x, y); });
+            num_tiles++;
+        });
+
+    if (bad_input_region) {
+        return 1;
+    }
+    if (num_tiles != 4 * 4) {
+        printf("Visited %d tiles instead of %d\n", num_tiles, 4 * 4);
+        return 1;
+    }
+    if (in.get().defined()) {
+        printf("The input was left bound after realize_tiled\n");
+        return 1;
+    }
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    correct += input_value(x + dx, y + dy);
+                }
+            }
+            if (output(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "Halide.h"
+#include "halide_test_dirs.h"
+
+#include <cstdio>
+
+using namespace Halide;
+
+// Check that a lowered Module survives a round trip through
+// serialize_module and deserialize_module unchanged, including the
+// Parameters and compiled-in Buffers it refers to.
+
+std::vector<char> compile_to_c(const Module &m, const std::string &name) {
+    std::string filename = Internal::get_test_tmp_dir() + name + ".c";
+    Internal::ensure_no_file_exists(filename);
+    m.compile({{OutputFileType::c_source, filename}});
+    Internal::assert_file_exists(filename);
+    return Internal::read_entire_file(filename);
+}
+
+int main(int argc, char **argv) {
+    ImageParam input(UInt(8), 2, "input");
+    Param<float> gain("gain", 1.5f, 0.0f, 4.0f);
+    input.dim(0).set_min(0).set_stride(1);
+    input.dim(1).set_estimate(0, 480);
+
+    Buffer<uint16_t> lut(256, "lut");
+    for (int i = 0; i < 256; i++) {
+        lut(i) = (uint16_t)(i * i);
+    }
+
+    Var x("x"), y("y"), xi("xi");
+    Func curve("curve"), blur("blur"), out("out");
+    curve(x, y) = lut(input(x, y));
+    blur(x, y) = (curve(x - 1, y) + curve(x, y) + curve(x + 1, y)) / 3;
+    out(x, y) = cast<uint8_t>(clamp(cast<float>(sqrt(cast<float>(blur(x, y)))) * gain, 0.0f, 255.0f));
+
+    curve.compute_at(out, y).vectorize(x, 8);
+    out.split(x, x, xi, 8, TailStrategy::GuardWithIf).vectorize(xi).parallel(y);
+
+    Target t = get_host_target().with_feature(Target::NoRuntime);
+    Module m = Pipeline(out).compile_to_module({input, gain}, "serialize_module", t);
+
+    std::vector<uint8_t> data = serialize_module(m);
+    Module m2 = deserialize_module(data);
+
+    if (Internal::module_fingerprint(m) != Internal::module_fingerprint(m2)) {
+        printf("The deserialized module has a different fingerprint\n");
+        return 1;
+    }
+
+    if (serialize_module(m2) != data) {
+        printf("Serializing the deserialized module gave different data\n");
+        return 1;
+    }
+
+    if (compile_to_c(m, "serialize_module") != compile_to_c(m2, "serialize_module_round_trip")) {
+        printf("The deserialized module compiles to different C source\n");
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
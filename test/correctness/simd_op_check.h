@@ -2,15 +2,21 @@
 #define SIMD_OP_CHECK_H
 
 #include "Halide.h"
+#include "halide_benchmark.h"
 #include "halide_test_dirs.h"
 #include "test_sharding.h"
 
 #include <fstream>
+#include <map>
 
 namespace Halide {
 struct TestResult {
     std::string op;
     std::string error_msg;
+    // The key of the test in benchmark files, and the time per vector
+    // of the vectorized Func, if it was benchmarked.
+    std::string benchmark_key;
+    double ns_per_vector = -1;
 };
 
 struct Task {
@@ -31,6 +37,18 @@ public:
 
     std::string filter{"*"};
     std::string output_directory{Internal::get_test_tmp_dir()};
+
+    // In benchmark mode, each expression that can be run on the host is
+    // also timed over the whole W x H image, and the time per vector
+    // is written to benchmark_file, one test per line. Timings in
+    // baseline_file, a benchmark file from an earlier run on the same
+    // CPU, are compared against, and tests that are slower by more
+    // than the tolerance are reported. Set with the environment
+    // variables HL_SIMD_OP_CHECK_BENCHMARK and
+    // HL_SIMD_OP_CHECK_BASELINE.
+    std::string benchmark_file;
+    std::string baseline_file;
+    double benchmark_tolerance = 0.1;
     std::vector<Task> tasks;
     std::mt19937 rng;
 
@@ -88,7 +106,7 @@ public:
                                   Target::FMA, Target::FMA4, Target::F16C,
                                   Target::VSX, Target::POWER_ARCH_2_07,
                                   Target::ARMv7s, Target::NoNEON,
-                                  Target::WasmSimd128}) {
+                                  Target::WasmSimd128, Target::WasmRelaxedSimd}) {
             if (target.has_feature(f) != host_target.has_feature(f)) {
                 can_run_the_code = false;
             }
@@ -171,9 +189,89 @@ public:
         return wildcard_match("*" + p + "*", str);
     }
 
+    bool benchmarking() const {
+        return !benchmark_file.empty() || !baseline_file.empty();
+    }
+
+    // Tests are identified in benchmark files by the op, the vector
+    // width, and the expression, rather than by name, so that adding
+    // tests doesn't invalidate a baseline.
+    std::string benchmark_key(const std::string &op, int vector_width, const Expr &e) const {
+        std::ostringstream key;
+        key << op << "\t" << vector_width << "\t" << e;
+        std::string str = key.str();
+        for (char &c : str) {
+            if (c == '\n') c = ' ';
+        }
+        return str;
+    }
+
+    // Each line of a benchmark file is the key of a test, a tab, and
+    // its time per vector in nanoseconds.
+    std::map<std::string, double> read_benchmark_file(const std::string &filename) const {
+        std::map<std::string, double> timings;
+        std::ifstream file(filename);
+        std::string line;
+        while (getline(file, line)) {
+            size_t tab = line.rfind('\t');
+            if (tab != std::string::npos) {
+                timings[line.substr(0, tab)] = atof(line.c_str() + tab + 1);
+            }
+        }
+        return timings;
+    }
+
+    // Write the timings of a run, and compare them to the baseline.
+    // Returns the number of tests slower than the baseline.
+    int report_benchmarks(const std::vector<TestResult> &results) const {
+        std::map<std::string, double> baseline;
+        if (!baseline_file.empty()) {
+            baseline = read_benchmark_file(baseline_file);
+            if (baseline.empty()) {
+                std::cerr << "No timings found in baseline " << baseline_file << "\n";
+            }
+        }
+        std::ofstream file;
+        if (!benchmark_file.empty()) {
+            file.open(benchmark_file);
+        }
+        int slower = 0, faster = 0, compared = 0;
+        for (const TestResult &r : results) {
+            if (r.ns_per_vector < 0) {
+                continue;
+            }
+            if (file.is_open()) {
+                file << r.benchmark_key << "\t" << r.ns_per_vector << "\n";
+            }
+            auto it = baseline.find(r.benchmark_key);
+            if (it == baseline.end() || it->second <= 0) {
+                continue;
+            }
+            compared++;
+            double ratio = r.ns_per_vector / it->second;
+            if (ratio > 1 + benchmark_tolerance || ratio < 1 - benchmark_tolerance) {
+                std::ostream &out = ratio > 1 ? std::cerr : std::cout;
+                out << (ratio > 1 ? "Slower: " : "Faster: ") << r.op
+                    << " (" << r.benchmark_key << "): " << r.ns_per_vector
+                    << " ns per vector instead of " << it->second << "\n";
+                (ratio > 1 ? slower : faster)++;
+            }
+        }
+        if (!baseline.empty()) {
+            std::cout << compared << " tests compared to the baseline: "
+                      << slower << " slower and " << faster << " faster by more than "
+                      << (int)(benchmark_tolerance * 100) << "%\n";
+        }
+        return slower;
+    }
+
     TestResult check_one(const std::string &op, const std::string &name, int vector_width, Expr e) {
         std::ostringstream error_msg;
 
+        TestResult result;
+        result.op = op;
+        result.benchmark_key = benchmark_key(op, vector_width, e);
+
         class HasInlineReduction : public Internal::IRVisitor {
             using Internal::IRVisitor::visit;
             void visit(const Internal::Call *op) override {
@@ -265,6 +363,14 @@ public:
             }
             Realization r = error.realize();
             double e = Buffer<double>(r[0])();
+
+            if (benchmarking()) {
+                // Time the vectorized Func on its own.
+                f.compile_jit(run_target);
+                Buffer<> out(f.type(), W, H);
+                double t = Tools::benchmark(10, 10, [&]() { f.realize(out, run_target); });
+                result.ns_per_vector = t * 1e9 * vector_width / ((double)W * H);
+            }
             // Use a very loose tolerance for floating point tests. The
             // kinds of bugs we're looking for are codegen bugs that
             // return the wrong value entirely, not floating point
@@ -288,7 +394,8 @@ public:
             }
         }
 
-        return {op, error_msg.str()};
+        result.error_msg = error_msg.str();
+        return result;
     }
 
     void check(std::string op, int vector_width, Expr e) {
@@ -324,6 +431,7 @@ public:
 
         Sharder sharder;
         bool success = true;
+        std::vector<TestResult> results;
         for (size_t t = 0; t < tasks.size(); t++) {
             if (!sharder.should_run(t)) continue;
             const auto &task = tasks.at(t);
@@ -333,6 +441,13 @@ public:
                 std::cerr << result.error_msg;
                 success = false;
             }
+            results.push_back(std::move(result));
+        }
+
+        if (benchmarking()) {
+            // Timings are noisy, so being slower than the baseline is
+            // reported, but isn't a failure.
+            report_benchmarks(results);
         }
 
         return success;
@@ -355,6 +470,14 @@ public:
             test.filter = getenv("HL_SIMD_OP_CHECK_FILTER");
         }
 
+        if (getenv("HL_SIMD_OP_CHECK_BENCHMARK")) {
+            test.benchmark_file = getenv("HL_SIMD_OP_CHECK_BENCHMARK");
+        }
+
+        if (getenv("HL_SIMD_OP_CHECK_BASELINE")) {
+            test.baseline_file = getenv("HL_SIMD_OP_CHECK_BASELINE");
+        }
+
         const int seed = argc > 2 ? atoi(argv[2]) : time(nullptr);
         std::cout << "simd_op_check test seed: " << seed << "\n";
         test.set_seed(seed);
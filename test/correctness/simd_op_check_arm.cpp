@@ -601,6 +601,24 @@ public:
                         }
                     }
                 }
+
+                // SMMLA/UMMLA
+                if (!arm32 && target.has_feature(Target::ARMI8mm)) {
+                    // Each group of 4 output lanes is a 2x2 tile, in
+                    // row-major order, of the product of two 2x8 rows
+                    // of a with two 8x1 columns of b.
+                    RDom r(0, 8);
+                    check("smmla", 4, sum(i32(in_i8(8 * (x / 2) + r)) * in_i8(8 * (x % 2) + r + 32)));
+                    check("ummla", 4, sum(u32(in_u8(8 * (x / 2) + r)) * in_u8(8 * (x % 2) + r + 32)));
+                }
+
+                // BFDOT
+                if (!arm32 && target.has_feature(Target::ARMBf16)) {
+                    RDom r(0, 2);
+                    for (int v : {2, 4}) {
+                        check("bfdot", v, sum(f32(in_bf16(2 * x + r)) * in_bf16(2 * x + r + 32)));
+                    }
+                }
             }
             // VPOP     X       F, D    Pop from Stack
             // VPUSH    X       F, D    Push to Stack
@@ -13,7 +13,7 @@
 // simd_op_check into two tests, simd_op_check.cpp and simd_op_check_hvx.cpp
 // so that the latter is free to do its own thing - for simd_op_check_hvx.cpp
 // to run any tests, all that is needed is that HL_TARGET have a HVX related
-// target feature, i.e. one of HVX, HVX_v62, HVX_v65 and HVX_v66.
+// target feature, i.e. one of HVX, HVX_v62, HVX_v65, HVX_v66 and HVX_v68.
 
 using namespace Halide;
 using namespace Halide::ConciseCasts;
@@ -50,7 +50,9 @@ public:
         constexpr int hvx_width = 128;
 
         int isa_version;
-        if (target.has_feature(Halide::Target::HVX_v66)) {
+        if (target.has_feature(Halide::Target::HVX_v68)) {
+            isa_version = 68;
+        } else if (target.has_feature(Halide::Target::HVX_v66)) {
             isa_version = 66;
         } else if (target.has_feature(Halide::Target::HVX_v65)) {
             isa_version = 65;
@@ -648,6 +650,27 @@ public:
         check("vnormamt(v*.w)", hvx_width / 4, max(count_leading_zeros(i32_1), count_leading_zeros(~i32_1)));
         check("vpopcount(v*.h)", hvx_width / 2, popcount(u16_1));
 
+        if (isa_version >= 68) {
+            Expr f16_1 = in_f16(x), f16_2 = in_f16(x + 16), f16_3 = in_f16(x + 32);
+
+            check("v*.qf32 = vadd(v*.sf,v*.sf)", hvx_width / 4, f32_1 + f32_2);
+            check("v*.qf32 = vsub(v*.sf,v*.sf)", hvx_width / 4, f32_1 - f32_2);
+            check("v*.qf32 = vmpy(v*.sf,v*.sf)", hvx_width / 4, f32_1 * f32_2);
+            check("v*.qf32 = vadd(v*.qf32,v*.sf)", hvx_width / 4, f32_1 * f32_2 + f32_3);
+            check("v*.qf32 = vadd(v*.qf32,v*.qf32)", hvx_width / 4, f32_1 * f32_2 + f32_3 * f32_1);
+            check("v*.sf = v*.qf32", hvx_width / 4, f32_1 * f32_2 + f32_3);
+            check("v*.qf16 = vadd(v*.hf,v*.hf)", hvx_width / 2, f16_1 + f16_2);
+            check("v*.qf16 = vmpy(v*.hf,v*.hf)", hvx_width / 2, f16_1 * f16_2);
+            check("v*.qf16 = vsub(v*.qf16,v*.hf)", hvx_width / 2, f16_1 * f16_2 - f16_3);
+            check("v*.hf = v*.qf16", hvx_width / 2, f16_1 * f16_2);
+            check("vmax(v*.sf,v*.sf)", hvx_width / 4, max(f32_1, f32_2));
+            check("vmin(v*.hf,v*.hf)", hvx_width / 2, min(f16_1, f16_2));
+            check("v*.hf = vcvt(v*.h)", hvx_width / 2, f16(i16_1));
+            check("v*.hf = vcvt(v*.uh)", hvx_width / 2, f16(u16_1));
+            check("v*.sf = vcvt(v*.hf)", hvx_width / 2, f32(f16_1));
+            check("v*.hf = vcvt(v*.sf,v*.sf)", hvx_width / 2, f16(f32_1));
+        }
+
         check("v* = vdelta(v*, v*)", hvx_width, in_u8((x / 8) * 9 + x % 8));
         check("v* = vdelta(v*, v*)", hvx_width / 2, in_u16((x / 8) * 9 + x % 8));
         check("v* = vdelta(v*, v*)", hvx_width / 4, in_u32((x / 8) * 9 + x % 8));
@@ -714,7 +737,8 @@ int main(int argc, char **argv) {
     for (const auto &f : {Target::HVX,
                           Target::HVX_v62,
                           Target::HVX_v65,
-                          Target::HVX_v66}) {
+                          Target::HVX_v66,
+                          Target::HVX_v68}) {
         if (hl_target.has_feature(f)) {
             t.set_feature(f);
         }
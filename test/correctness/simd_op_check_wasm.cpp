@@ -18,6 +18,8 @@ public:
         use_wasm_simd128 = target.has_feature(Target::WasmSimd128);
         use_wasm_sat_float_to_int = target.has_feature(Target::WasmSatFloatToInt);
         use_wasm_sign_ext = target.has_feature(Target::WasmSignExt);
+        use_wasm_relaxed_simd = target.has_feature(Target::WasmRelaxedSimd) &&
+                                Halide::Internal::get_llvm_version() >= 160;
     }
 
     void add_tests() override {
@@ -518,6 +520,27 @@ public:
                 check("i64x2.extend_high_i32x4_s", 4 * w, i64(i32_1));
                 check("i64x2.extend_low_i32x4_u", 4 * w, u64(u32_1));
                 check("i64x2.extend_high_i32x4_u", 4 * w, u64(u32_1));
+
+                if (use_wasm_relaxed_simd) {
+                    // Fused multiply-add, where it may or may not round the product
+                    check("f32x4.relaxed_madd", 4 * w, f32_1 * f32_2 + f32_3);
+                    check("f64x2.relaxed_madd", 2 * w, f64_1 * f64_2 + f64_3);
+                    check("f32x4.relaxed_nmadd", 4 * w, f32_1 - f32_2 * f32_3);
+                    check("f64x2.relaxed_nmadd", 2 * w, f64_1 - f64_2 * f64_3);
+
+                    // 8-bit dot products, where one side is known to fit in 7 bits
+                    for (int f : {2, 4, 8}) {
+                        RDom r(0, f);
+                        Expr a = in_i8(f * x + r);
+                        Expr b = i8(in_u8(f * x + r + 32) / 2);
+                        if (f < 8) {
+                            check("i16x8.relaxed_dot_i8x16_i7x16_s", 8 * w, sum(i16(a) * b));
+                        }
+                        if (f > 2) {
+                            check("i32x4.relaxed_dot_i8x16_i7x16_add_s", 4 * w, sum(i32(a) * b));
+                        }
+                    }
+                }
             }
         }
     }
@@ -526,6 +549,7 @@ private:
     bool use_wasm_simd128{false};
     bool use_wasm_sat_float_to_int{false};
     bool use_wasm_sign_ext{false};
+    bool use_wasm_relaxed_simd{false};
     const Var x{"x"}, y{"y"};
 };
 }  // namespace
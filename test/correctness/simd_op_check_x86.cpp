@@ -530,6 +530,15 @@ public:
                 check("vpsadbw", w, sum(i32(absd(in_u8(f * x + r), in_u8(f * x + r + 32)))));
                 check("vpsadbw", w, sum(i16(absd(in_u8(f * x + r), in_u8(f * x + r + 32)))));
             }
+
+            // Data-dependent loads of 32- and 64-bit values are gathers
+            // (unless tuning for a CPU with slow gathers).
+            if (target.processor_tune == Target::ProcessorGeneric) {
+                Expr lut_index = clamp(i32_1, 0, 255);
+                check("vpgatherdd", 8, in_i32(lut_index));
+                check("vgatherdps", 8, in_f32(lut_index));
+                check("vgatherdpd", 4, in_f64(lut_index));
+            }
         }
 
         if (use_avx512) {
@@ -567,36 +576,56 @@ public:
                 check("vdpbf16ps*zmm", 16, sum(f32(in_bf16(2 * x + r)) * in_bf16(2 * x + r + 32)));
                 check("vdpbf16ps*ymm", 8, sum(f32(in_bf16(2 * x + r)) * in_bf16(2 * x + r + 32)));
                 check("vdpbf16ps*xmm", 4, sum(f32(in_bf16(2 * x + r)) * in_bf16(2 * x + r + 32)));
-                check("vpdpwssd*zmm", 16, sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
-                check("vpdpwssd*ymm", 8, sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
-                check("vpdpwssd*xmm", 4, sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
-            }
-            {
-                // 8 bit, 4 element dot product
-                RDom r(0, 4);
-                check("vpdpbusd*zmm", 16, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusd*zmm", 16, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
-                check("vpdpbusd*ymm", 8, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusd*ymm", 8, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
-                check("vpdpbusd*xmm", 4, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusd*xmm", 4, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
             }
-            {
-                // 16 bit, 2 element saturaing dot product
-                RDom r(0, 2);
-                check("vpdpwssds*zmm", 16, saturating_sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
-                check("vpdpwssds*ymm", 8, saturating_sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
-                check("vpdpwssds*xmm", 4, saturating_sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
+        }
+        if (use_avx512 && target.has_feature(Target::AVX512_FP16)) {
+            Expr f16_1 = in_f16(x), f16_2 = in_f16(x + 16);
+            check("vaddph*zmm", 32, f16_1 + f16_2);
+            check("vsubph*ymm", 16, f16_1 - f16_2);
+            check("vmulph*zmm", 32, f16_1 * f16_2);
+            check("vdivph*xmm", 8, f16_1 / f16_2);
+            check("vcvtph2psx*zmm", 16, f32(f16_1));
+            check("vcvtps2phx*ymm", 16, f16(f32_1));
+        }
+        const bool use_avx512_vnni = use_avx512 && target.features_any_of({Target::AVX512_VNNI, Target::AVX512_SapphireRapids});
+        const bool use_avxvnni = use_avx2 && target.features_any_of({Target::AVXVNNI, Target::AVX512_SapphireRapids});
+        if (use_avx512_vnni || use_avxvnni) {
+            // The 512 bit forms need AVX512-VNNI. Both AVX512-VNNI
+            // and AVX-VNNI have the 256 and 128 bit forms.
+            std::vector<std::pair<const char *, int>> widths = {{"ymm", 8}, {"xmm", 4}};
+            if (use_avx512_vnni) {
+                widths.insert(widths.begin(), {"zmm", 16});
             }
-            {
-                // 8 bit, 4 element saturating dot product
-                RDom r(0, 4);
-                check("vpdpbusds*zmm", 16, saturating_sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusds*zmm", 16, saturating_sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
-                check("vpdpbusds*ymm", 8, saturating_sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusds*ymm", 8, saturating_sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
-                check("vpdpbusds*xmm", 4, saturating_sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
-                check("vpdpbusds*xmm", 4, saturating_sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
+            for (const auto &w : widths) {
+                const std::string reg = std::string("*") + w.first;
+                const int lanes = w.second;
+                {
+                    // 16 bit, 2 element dot product
+                    RDom r(0, 2);
+                    check("vpdpwssd" + reg, lanes, sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
+                }
+                {
+                    // 8 bit, 4 element dot product
+                    RDom r(0, 4);
+                    check("vpdpbusd" + reg, lanes, sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
+                    check("vpdpbusd" + reg, lanes, sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
+                    // Products of two unsigned or two signed values, one
+                    // of which is known to fit in the other signedness
+                    check("vpdpbusd" + reg, lanes, sum(i32(in_u8(4 * x + r)) * (in_u8(4 * x + r + 32) / 2)));
+                    check("vpdpbusd" + reg, lanes, sum(i32(in_u8(4 * x + r) / 2) * in_u8(4 * x + r + 32)));
+                    check("vpdpbusd" + reg, lanes, sum(i32(in_i8(4 * x + r)) * max(in_i8(4 * x + r + 32), 0)));
+                }
+                {
+                    // 16 bit, 2 element saturaing dot product
+                    RDom r(0, 2);
+                    check("vpdpwssds" + reg, lanes, saturating_sum(i32(in_i16(2 * x + r)) * in_i16(2 * x + r + 32)));
+                }
+                {
+                    // 8 bit, 4 element saturating dot product
+                    RDom r(0, 4);
+                    check("vpdpbusds" + reg, lanes, saturating_sum(i32(in_u8(4 * x + r)) * in_i8(4 * x + r + 32)));
+                    check("vpdpbusds" + reg, lanes, saturating_sum(i32(in_i8(4 * x + r)) * in_u8(4 * x + r + 32)));
+                }
             }
         }
     }
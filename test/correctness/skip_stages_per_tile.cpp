@@ -0,0 +1,85 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+int call_count = 0;
+extern "C" HALIDE_EXPORT_SYMBOL int call_counter(int x) {
+    call_count++;
+    return x;
+}
+HalideExtern_1(int, call_counter, int);
+
+int check(const char *name, int correct) {
+    if (call_count != correct) {
+        printf("%s: the producer was computed at %d sites instead of %d\n",
+               name, call_count, correct);
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Var x, y, xo, yo, xi, yi;
+
+    {
+        // Only the tiles in the left half of the output use f, and f is
+        // computed per tile, so it should be skipped on the others.
+        Func f, g;
+        f(x, y) = call_counter(x + y);
+        g(x, y) = select(x < 32, f(x, y), 0);
+
+        g.bound(x, 0, 64).bound(y, 0, 64).tile(x, y, xo, yo, xi, yi, 16, 16);
+        f.compute_at(g, xo);
+
+        call_count = 0;
+        Buffer<int> out = g.realize({64, 64});
+        if (check("left half", 32 * 64)) {
+            return 1;
+        }
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = x < 32 ? x + y : 0;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    {
+        // f is only used where a coarse mask, with one value per tile,
+        // is set.
+        Buffer<uint8_t> mask(4, 4);
+        mask.fill(0);
+        mask(1, 0) = 1;
+        mask(2, 3) = 1;
+        mask(3, 3) = 1;
+
+        Func f, g;
+        f(x, y) = call_counter(x * y);
+        g(x, y) = select(mask(x / 16, y / 16) != 0, f(x, y), 0);
+
+        g.bound(x, 0, 64).bound(y, 0, 64).tile(x, y, xo, yo, xi, yi, 16, 16, TailStrategy::RoundUp);
+        f.compute_at(g, xo);
+
+        call_count = 0;
+        Buffer<int> out = g.realize({64, 64});
+        if (check("masked tiles", 3 * 16 * 16)) {
+            return 1;
+        }
+        for (int y = 0; y < 64; y++) {
+            for (int x = 0; x < 64; x++) {
+                int correct = mask(x / 16, y / 16) ? x * y : 0;
+                if (out(x, y) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -169,6 +169,51 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        // Slide over both loops of a tiled consumer. The producer is
+        // stored at root, so the rows shared with the tile above come
+        // from the previous iteration over tile rows (a line buffer),
+        // and the columns shared with the tile to the left come from
+        // the previous iteration over tiles within the row.
+        Func f, g;
+        Var xo, yo, xi, yi;
+
+        count = 0;
+        f(x, y) = call_counter(x, y);
+        g(x, y) = f(x - 1, y) + f(x, y) + f(x, y - 1);
+        g.tile(x, y, xo, yo, xi, yi, 8, 8);
+        f.store_root().compute_at(g, xo);
+
+        Buffer<int> im = g.realize({16, 16});
+
+        if (count != 17 * 17) {
+            printf("f was called %d times instead of %d times\n", count, 17 * 17);
+            return -1;
+        }
+    }
+
+    {
+        // Storing the producer at each row of tiles instead only
+        // slides over the tiles within the row, recomputing the rows
+        // shared with the tile above, but keeps the producer's storage
+        // to a few columns of a single row of tiles.
+        Func f, g;
+        Var xo, yo, xi, yi;
+
+        count = 0;
+        f(x, y) = call_counter(x, y);
+        g(x, y) = f(x - 1, y) + f(x, y) + f(x, y - 1);
+        g.tile(x, y, xo, yo, xi, yi, 8, 8);
+        f.store_at(g, yo).compute_at(g, xo);
+
+        Buffer<int> im = g.realize({16, 16});
+
+        if (count != 2 * 9 * 17) {
+            printf("f was called %d times instead of %d times\n", count, 2 * 9 * 17);
+            return -1;
+        }
+    }
+
     {
         Func f, g;
 
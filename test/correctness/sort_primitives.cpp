@@ -0,0 +1,98 @@
+#include "Halide.h"
+#include <algorithm>
+#include <functional>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check that each row of the output is the corresponding row of the
+// input, sorted.
+int check_sorted(const char *name, const Buffer<int> &in, const Buffer<int> &out) {
+    for (int y = 0; y < in.height(); y++) {
+        std::vector<int> correct(in.width());
+        for (int x = 0; x < in.width(); x++) {
+            correct[x] = in(x, y);
+        }
+        std::sort(correct.begin(), correct.end());
+        for (int x = 0; x < in.width(); x++) {
+            if (out(x, y) != correct[x]) {
+                printf("%s: out(%d, %d) = %d instead of %d\n", name, x, y, out(x, y), correct[x]);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+Buffer<int> random_rows(int width, int height) {
+    Buffer<int> in(width, height);
+    in.for_each_value([](int &v) {
+        // Lots of duplicates, and both signs.
+        v = (rand() % 2000) - 1000;
+    });
+    return in;
+}
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    Var x, y;
+
+    {
+        Buffer<int> in = random_rows(1024, 3);
+        Func f;
+        f(x, y) = in(x, y);
+        Buffer<int> out = Sort::bitonic(f, in.width(), t).realize({in.width(), in.height()}, t);
+        if (check_sorted("bitonic", in, out)) {
+            return 1;
+        }
+    }
+
+    {
+        // Not a power of two.
+        Buffer<int> in = random_rows(1000, 3);
+        Func f;
+        f(x, y) = in(x, y);
+        Buffer<int> out = Sort::merge(f, in.width(), t).realize({in.width(), in.height()}, t);
+        if (check_sorted("merge", in, out)) {
+            return 1;
+        }
+    }
+
+    {
+        // More than one block of the row.
+        Buffer<int> in = random_rows(10000, 2);
+        Func f;
+        f(x, y) = in(x, y);
+        Buffer<int> out = Sort::radix(f, in.width(), t).realize({in.width(), in.height()}, t);
+        if (check_sorted("radix", in, out)) {
+            return 1;
+        }
+    }
+
+    {
+        const int k = 5;
+        Buffer<int> in = random_rows(1000, 3);
+        Func f;
+        f(x, y) = in(x, y);
+        Realization r = Sort::top_k(f, k, in.width(), t).realize({k, in.height()}, t);
+        Buffer<int> values = r[0], indices = r[1];
+        for (int y = 0; y < in.height(); y++) {
+            std::vector<int> correct(in.width());
+            for (int x = 0; x < in.width(); x++) {
+                correct[x] = in(x, y);
+            }
+            std::sort(correct.begin(), correct.end(), std::greater<int>());
+            for (int j = 0; j < k; j++) {
+                int idx = indices(j, y);
+                if (values(j, y) != correct[j] || idx < 0 || idx >= in.width() || in(idx, y) != values(j, y)) {
+                    printf("top_k: element %d of row %d is %d at %d instead of %d\n",
+                           j, y, values(j, y), idx, correct[j]);
+                    return 1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
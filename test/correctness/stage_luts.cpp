@@ -0,0 +1,78 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+namespace {
+
+// Find the memory types of the allocations of a Func.
+class FindAllocations : public IRMutator {
+    using IRMutator::visit;
+
+    Stmt visit(const Allocate *op) override {
+        if (starts_with(op->name, prefix)) {
+            memory_types.push_back(op->memory_type);
+        }
+        return IRMutator::visit(op);
+    }
+
+    std::string prefix;
+
+public:
+    std::vector<MemoryType> memory_types;
+
+    FindAllocations(const std::string &prefix)
+        : prefix(prefix) {
+    }
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (!t.has_gpu_feature()) {
+        printf("[SKIP] No GPU target enabled.\n");
+        return 0;
+    }
+    t = t.with_feature(Target::StageLUTs);
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+
+    // A tone curve, read at sites given by the input.
+    Func curve("curve");
+    curve(x) = cast<uint16_t>(x * x / 16);
+    curve.compute_root().bound(x, 0, 256);
+
+    Buffer<uint8_t> in(128, 64);
+    in.for_each_element([&](int i, int j) { in(i, j) = (uint8_t)(i * 7 + j * 13); });
+
+    Func f("f");
+    f(x, y) = curve(cast<int>(in(x, y))) + 1;
+    f.gpu_tile(x, y, xi, yi, 16, 16);
+
+    FindAllocations finder("curve_in_f");
+    f.add_custom_lowering_pass(&finder, []() {});
+
+    Buffer<uint16_t> out = f.realize({128, 64}, t);
+
+    if (finder.memory_types.size() != 1 ||
+        finder.memory_types[0] != MemoryType::GPUShared) {
+        printf("The curve was not staged in shared memory\n");
+        return 1;
+    }
+
+    for (int j = 0; j < out.height(); j++) {
+        for (int i = 0; i < out.width(); i++) {
+            int v = in(i, j);
+            uint16_t correct = (uint16_t)(v * v / 16 + 1);
+            if (out(i, j) != correct) {
+                printf("out(%d, %d) = %d instead of %d\n", i, j, out(i, j), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
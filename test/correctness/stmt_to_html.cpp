@@ -2,6 +2,9 @@
 #include "halide_test_dirs.h"
 
 #include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
 
 using namespace Halide;
 
@@ -44,6 +47,34 @@ int main() {
     tuple_func.compile_to_lowered_stmt(result_file_3, {}, Halide::HTML);
     Internal::assert_file_exists(result_file_3);
 
+    // Check that a profile is overlaid on the produce nodes, and that
+    // the innermost loops get static estimates.
+    std::string profile_file = Internal::get_test_tmp_dir() + "stmt_to_html_profile.json";
+    {
+        std::ofstream profile(profile_file);
+        profile << "[\n"
+                << "{\"name\":\"gradient_fast\",\"pid\":1,\"tid\":1,\"ts\":0,\"ph\":\"X\",\"cat\":\"produce\",\"dur\":250},\n"
+                << "{\"name\":\"gradient_fast\",\"pid\":1,\"tid\":1,\"ts\":300,\"ph\":\"X\",\"cat\":\"produce\",\"dur\":750},\n";
+    }
+#ifdef _WIN32
+    _putenv_s("HL_STMT_HTML_PROFILE", profile_file.c_str());
+#else
+    setenv("HL_STMT_HTML_PROFILE", profile_file.c_str(), 1);
+#endif
+    std::string result_file_4 = Internal::get_test_tmp_dir() + "stmt_to_html_dump_4.html";
+    Internal::ensure_no_file_exists(result_file_4);
+    gradient_fast.compile_to_lowered_stmt(result_file_4, {}, Halide::HTML);
+    std::ifstream html(result_file_4);
+    std::string contents((std::istreambuf_iterator<char>(html)), std::istreambuf_iterator<char>());
+    if (contents.find("time: 1 ms, calls: 2, avg: 500 us, max: 750 us") == std::string::npos) {
+        printf("The profile was not shown on the produce node of gradient_fast\n");
+        return -1;
+    }
+    if (contents.find("bytes stored") == std::string::npos) {
+        printf("There are no static estimates for the innermost loops\n");
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
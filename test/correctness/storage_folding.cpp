@@ -179,6 +179,68 @@ int main(int argc, char **argv) {
         }
     }
 
+    {
+        custom_malloc_sizes.clear();
+        Func f, g;
+        Param<int> radius;
+
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - radius) + f(x, y + radius);
+        f.store_root().compute_at(g, y);
+
+        // The footprint of f in y depends on a Param, so it has no
+        // constant bound, but it should still fold by the next power
+        // of two above 2 * radius + 1, computed at runtime.
+        radius.set(3);
+        Buffer<int> im = g.realize({100, 1000});
+
+        size_t expected_size = 100 * 8 * sizeof(int);
+        if (!check_expected_mallocs({expected_size})) {
+            return -1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 2 * (x + y);
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        custom_malloc_sizes.clear();
+        Func f, g;
+        Param<int> radius;
+
+        f(x, y) = x + y;
+        g(x, y) = f(x, y - radius) + f(x, y + radius);
+        f.store_root().compute_at(g, y);
+
+        // With a large radius the next power of two above the
+        // footprint (256) is more than the whole realization of f
+        // (16 + 2 * 100 rows), so it should not be folded at all.
+        radius.set(100);
+        Buffer<int> im = g.realize({100, 16});
+
+        size_t expected_size = 100 * 216 * sizeof(int);
+        if (!check_expected_mallocs({expected_size})) {
+            return -1;
+        }
+
+        for (int y = 0; y < im.height(); y++) {
+            for (int x = 0; x < im.width(); x++) {
+                int correct = 2 * (x + y);
+                if (im(x, y) != correct) {
+                    printf("im(%d, %d) = %d instead of %d\n", x, y, im(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
     {
         custom_malloc_sizes.clear();
         Func f, g;
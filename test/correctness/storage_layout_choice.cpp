@@ -0,0 +1,91 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// An intermediate with the default storage order is stored with the
+// dimension its producer and consumers vectorize across innermost, so
+// that its vector loads and stores are dense.
+
+class CheckStrides : public IRMutator {
+    using IRMutator::visit;
+
+    void check(const std::string &name, const Expr &index) {
+        if (name != func) {
+            return;
+        }
+        const Ramp *r = index.as<Ramp>();
+        if (r && !is_const_one(r->stride)) {
+            strided++;
+        }
+    }
+
+    Expr visit(const Load *op) override {
+        check(op->name, op->index);
+        return IRMutator::visit(op);
+    }
+
+    Stmt visit(const Store *op) override {
+        check(op->name, op->index);
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::string func;
+    int strided = 0;
+
+    CheckStrides(const std::string &func)
+        : func(func) {
+    }
+};
+
+int run(bool explicit_storage) {
+    const int W = 64, H = 16;
+    Buffer<float> input(W, H, 3);
+    input.for_each_element([&](int x, int y, int c) { input(x, y, c) = (float)(x + y * 3 + c * 7); });
+
+    Var x, y, c;
+    Func f("f"), g("g");
+    // f is packed by its definition, but only ever vectorized across x.
+    f(c, x, y) = input(x, y, c) * 2.0f;
+    g(x, y, c) = f(c, x, y) + f(c, x, clamp(y + 1, 0, H - 1));
+    f.compute_root().vectorize(x, 8);
+    g.vectorize(x, 8);
+    if (explicit_storage) {
+        f.reorder_storage(c, y, x);
+    }
+
+    CheckStrides checker("f");
+    g.add_custom_lowering_pass(&checker, []() {});
+    Buffer<float> out = g.realize({W, H, 3});
+
+    if (explicit_storage ? checker.strided == 0 : checker.strided != 0) {
+        printf("%d strided vector accesses to f with %s storage\n",
+               checker.strided, explicit_storage ? "explicit" : "default");
+        return -1;
+    }
+
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = input(x, y, c) * 2.0f + input(x, std::min(y + 1, H - 1), c) * 2.0f;
+                if (out(x, y, c) != correct) {
+                    printf("g(%d, %d, %d) = %f instead of %f\n", x, y, c, out(x, y, c), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    // An explicit storage order is kept, even when it is worse.
+    if (run(false) != 0 || run(true) != 0) {
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,70 @@
+#include "Halide.h"
+
+using namespace Halide;
+
+// Check that a Func scheduled with store_as is stored in the narrower
+// type, and that its values are rounded to it.
+
+size_t largest_malloc = 0;
+
+void *my_malloc(JITUserContext *, size_t sz) {
+    largest_malloc = std::max(largest_malloc, sz);
+    return (uint8_t *)malloc(sz);
+}
+
+void my_free(JITUserContext *, void *ptr) {
+    free(ptr);
+}
+
+template<typename T>
+int check(Type storage_type) {
+    const int size = 1 << 16;
+    Buffer<float> input(size);
+    for (int i = 0; i < size; i++) {
+        input(i) = (float)i / 7.0f;
+    }
+
+    Var x;
+    Func f, g;
+    f(x) = input(x) * 3.0f;
+    g(x) = f(x) + f(x + 1);
+
+    f.compute_root().store_as(storage_type).vectorize(x, 8);
+    g.vectorize(x, 8);
+
+    largest_malloc = 0;
+    g.jit_handlers().custom_malloc = my_malloc;
+    g.jit_handlers().custom_free = my_free;
+    Buffer<float> out = g.realize({size - 1});
+
+    // The intermediate takes two bytes per value instead of four.
+    if (largest_malloc >= size * sizeof(float)) {
+        printf("Storing as %s allocated %d bytes\n",
+               type_to_c_type(storage_type, false).c_str(), (int)largest_malloc);
+        return 1;
+    }
+
+    for (int i = 0; i < size - 1; i++) {
+        float correct = (float)T(input(i) * 3.0f) + (float)T(input(i + 1) * 3.0f);
+        if (out(i) != correct) {
+            printf("out(%d) = %f instead of %f\n", i, out(i), correct);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (get_jit_target_from_environment().arch == Target::WebAssembly) {
+        printf("[SKIP] WebAssembly JIT does not support custom allocators.\n");
+        return 0;
+    }
+
+    if (check<float16_t>(Float(16)) ||
+        check<bfloat16_t>(BFloat(16))) {
+        return 1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
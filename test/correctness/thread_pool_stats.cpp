@@ -0,0 +1,56 @@
+#include "Halide.h"
+
+#include <cstdlib>
+#include <stdio.h>
+
+using namespace Halide;
+
+// Check that the thread pool of the JIT runtime counts the work done by
+// a parallel pipeline.
+
+int main(int argc, char **argv) {
+    Target t = get_jit_target_from_environment();
+    if (t.arch == Target::WebAssembly) {
+        printf("[SKIP] The wasm JIT does not use a thread pool.\n");
+        return 0;
+    }
+
+    // The thread pool reads this when it is first used.
+#ifdef _WIN32
+    _putenv_s("HL_THREAD_POOL_TIMING", "1");
+#else
+    setenv("HL_THREAD_POOL_TIMING", "1", 1);
+#endif
+
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = x * y;
+    f.parallel(y);
+
+    const int rows = 64;
+    halide_thread_pool_stats_t before = Internal::JITSharedRuntime::thread_pool_stats();
+    Buffer<int> out = f.realize({100, rows});
+    halide_thread_pool_stats_t after = Internal::JITSharedRuntime::thread_pool_stats();
+
+    if (after.jobs_enqueued + after.inline_chunks <= before.jobs_enqueued + before.inline_chunks) {
+        printf("The parallel loop was not counted\n");
+        return -1;
+    }
+    if (after.tasks_executed <= before.tasks_executed ||
+        after.tasks_executed - before.tasks_executed > rows) {
+        printf("Expected between 1 and %d tasks, but %d were counted\n",
+               rows, (int)(after.tasks_executed - before.tasks_executed));
+        return -1;
+    }
+    if (after.num_threads < 1) {
+        printf("The thread pool reported %d threads\n", (int)after.num_threads);
+        return -1;
+    }
+    if (after.run_ns + after.spin_ns + after.sleep_ns == 0 && after.jobs_enqueued) {
+        printf("No time was measured\n");
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
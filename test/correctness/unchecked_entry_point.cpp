@@ -0,0 +1,73 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// With the UncheckedEntryPoint feature, a module also contains
+// <name>_unchecked, which runs the same pipeline without checking its
+// arguments or handling bounds queries.
+
+class CountChecks : public IRVisitor {
+    using IRVisitor::visit;
+
+    void visit(const AssertStmt *op) override {
+        asserts++;
+        IRVisitor::visit(op);
+    }
+
+    void visit(const Call *op) override {
+        bounds_queries += op->name == Call::buffer_is_bounds_query;
+        IRVisitor::visit(op);
+    }
+
+public:
+    int asserts = 0, bounds_queries = 0;
+};
+
+int main(int argc, char **argv) {
+    ImageParam input(Float(32), 2, "input");
+    Param<int> offset("offset", 0, 0, 10);
+    Var x("x"), y("y");
+    Func f("f");
+    f(x, y) = input(x + offset, y) * 2.0f;
+    input.dim(0).set_stride(1);
+    f.output_buffer().dim(0).set_stride(1);
+
+    Target t = get_host_target().with_feature(Target::UncheckedEntryPoint);
+    Module m = f.compile_to_module({input, offset}, "f", t);
+
+    const LoweredFunc *checked = nullptr, *unchecked = nullptr;
+    for (const LoweredFunc &fn : m.functions()) {
+        if (fn.name == "f") {
+            checked = &fn;
+        } else if (fn.name == "f_unchecked") {
+            unchecked = &fn;
+        }
+    }
+    if (!checked || !unchecked) {
+        printf("Did not find both entry points in the module\n");
+        return -1;
+    }
+    if (unchecked->args.size() != checked->args.size()) {
+        printf("The entry points take different arguments\n");
+        return -1;
+    }
+
+    CountChecks checked_count, unchecked_count;
+    checked->body.accept(&checked_count);
+    unchecked->body.accept(&unchecked_count);
+    if (checked_count.asserts == 0 || checked_count.bounds_queries == 0) {
+        printf("The checked entry point has %d asserts and %d bounds queries\n",
+               checked_count.asserts, checked_count.bounds_queries);
+        return -1;
+    }
+    if (unchecked_count.asserts != 0 || unchecked_count.bounds_queries != 0) {
+        printf("The unchecked entry point has %d asserts and %d bounds queries\n",
+               unchecked_count.asserts, unchecked_count.bounds_queries);
+        return -1;
+    }
+
+    printf("Success!\n");
+    return 0;
+}
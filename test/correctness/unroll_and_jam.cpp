@@ -0,0 +1,95 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+// Unroll-and-jam puts the unrolled iterations together in the innermost
+// loop body, and loads shared by the iterations are only done once.
+
+class CountLoads : public IRMutator {
+    using IRMutator::visit;
+
+    Expr visit(const Load *op) override {
+        count += op->name == name;
+        return IRMutator::visit(op);
+    }
+
+public:
+    std::string name;
+    int count = 0;
+
+    CountLoads(const std::string &name)
+        : name(name) {
+    }
+};
+
+int main(int argc, char **argv) {
+    const int W = 64, H = 32, K = 16;
+    Var x, y;
+
+    {
+        // A vertical stencil. The four jammed rows of the output read
+        // six distinct rows of the input between them.
+        Buffer<float> a(W, H + 2, "a");
+        a.for_each_element([&](int x, int y) { a(x, y) = (float)(rand() % 100); });
+
+        Func f;
+        f(x, y) = a(x, y) + 2 * a(x, y + 1) + a(x, y + 2);
+        f.vectorize(x, 8).unroll_and_jam(y, 4);
+
+        CountLoads counter("a");
+        f.add_custom_lowering_pass(&counter, []() {});
+        Buffer<float> out = f.realize({W, H});
+        if (counter.count > 6) {
+            printf("%d loads of a instead of 6\n", counter.count);
+            return -1;
+        }
+
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                float correct = a(x, y) + 2 * a(x, y + 1) + a(x, y + 2);
+                if (out(x, y) != correct) {
+                    printf("f(%d, %d) = %f instead of %f\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    {
+        // A matrix multiply, register blocked over rows of the output so
+        // that each vector of b is loaded once for four rows.
+        Buffer<int> a(K, H, "a"), b(W, K, "b");
+        a.for_each_value([](int &v) { v = rand() % 16; });
+        b.for_each_value([](int &v) { v = rand() % 16; });
+
+        Func c;
+        RDom r(0, K);
+        Var xi;
+        c(x, y) = 0;
+        c(x, y) += a(r, y) * b(x, r);
+        c.update()
+            .split(x, x, xi, 8)
+            .reorder(xi, r, x, y)
+            .vectorize(xi)
+            .unroll_and_jam(y, 4);
+
+        Buffer<int> out = c.realize({W, H});
+        for (int y = 0; y < H; y++) {
+            for (int x = 0; x < W; x++) {
+                int correct = 0;
+                for (int k = 0; k < K; k++) {
+                    correct += a(k, y) * b(x, k);
+                }
+                if (out(x, y) != correct) {
+                    printf("c(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,107 @@
+#include "Halide.h"
+#include <stdio.h>
+
+using namespace Halide;
+
+// Vector loads and stores with data-dependent indices, which become
+// native gathers, scatters and masked stores on targets that have
+// them, and are scalarized elsewhere. Either way the results must match.
+
+int main(int argc, char **argv) {
+    const int N = 1024;
+    const int lut_size = 256;
+
+    Buffer<float> input(N);
+    Buffer<int> index(N), perm(N);
+    Buffer<float> lut(lut_size);
+    for (int i = 0; i < N; i++) {
+        input(i) = (rand() % 1000) / 1000.0f;
+        index(i) = rand() % lut_size;
+        perm(i) = i;
+    }
+    for (int i = N - 1; i > 0; i--) {
+        std::swap(perm(i), perm(rand() % (i + 1)));
+    }
+    for (int i = 0; i < lut_size; i++) {
+        lut(i) = i * 0.5f;
+    }
+
+    Var x;
+    RDom r(0, N);
+    Expr lut_index = clamp(index(x), 0, lut_size - 1);
+    Expr scatter_index = clamp(perm(r), 0, N - 1);
+
+    {
+        // Gather
+        Func f;
+        f(x) = lut(lut_index) + input(x);
+        f.vectorize(x, 16);
+        Buffer<float> out = f.realize({N});
+        for (int i = 0; i < N; i++) {
+            float correct = lut(index(i)) + input(i);
+            if (out(i) != correct) {
+                printf("gather: out(%d) = %f instead of %f\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Predicated gather, from a vectorized loop with a tail.
+        Func f;
+        f(x) = lut(lut_index);
+        f.vectorize(x, 16, TailStrategy::GuardWithIf);
+        Buffer<float> out = f.realize({N - 3});
+        for (int i = 0; i < N - 3; i++) {
+            float correct = lut(index(i));
+            if (out(i) != correct) {
+                printf("predicated gather: out(%d) = %f instead of %f\n", i, out(i), correct);
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Scatter
+        Func f;
+        f(x) = 0.0f;
+        f(scatter_index) = input(r);
+        f.update().allow_race_conditions().vectorize(r, 16);
+        Buffer<float> out = f.realize({N});
+        for (int i = 0; i < N; i++) {
+            if (out(perm(i)) != input(i)) {
+                printf("scatter: out(%d) = %f instead of %f\n", perm(i), out(perm(i)), input(i));
+                return -1;
+            }
+        }
+    }
+
+    {
+        // Select-guarded dense and scattered updates, which can be
+        // masked stores.
+        Func f, g;
+        f(x) = input(x);
+        f(x) = select(input(x) > 0.5f, input(x) * 2.0f, f(x));
+        f.update().vectorize(x, 16);
+        g(x) = input(x);
+        g(scatter_index) = select(input(r) < 0.5f, g(scatter_index), 0.0f);
+        g.update().allow_race_conditions().vectorize(r, 16);
+        Buffer<float> out_f = f.realize({N});
+        Buffer<float> out_g = g.realize({N});
+        for (int i = 0; i < N; i++) {
+            float correct_f = input(i) > 0.5f ? input(i) * 2.0f : input(i);
+            if (out_f(i) != correct_f) {
+                printf("masked store: out(%d) = %f instead of %f\n", i, out_f(i), correct_f);
+                return -1;
+            }
+            float correct_g = input(i) < 0.5f ? input(perm(i)) : 0.0f;
+            if (out_g(perm(i)) != correct_g) {
+                printf("masked scatter: out(%d) = %f instead of %f\n", perm(i), out_g(perm(i)), correct_g);
+                return -1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
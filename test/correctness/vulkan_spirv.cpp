@@ -0,0 +1,189 @@
+#include "Halide.h"
+#include <algorithm>
+#include <array>
+#include <stdio.h>
+#include <string.h>
+
+using namespace Halide;
+
+namespace {
+
+// The parts of the SPIR-V spec that we check for.
+constexpr uint32_t SpvMagicNumber = 0x07230203;
+constexpr uint32_t SpvOpMemoryModel = 14;
+constexpr uint32_t SpvOpEntryPoint = 15;
+constexpr uint32_t SpvOpExecutionMode = 16;
+constexpr uint32_t SpvOpCapability = 17;
+constexpr uint32_t SpvCapabilityShader = 1;
+constexpr uint32_t SpvMemoryModelGLSL450 = 1;
+constexpr uint32_t SpvExecutionModelGLCompute = 5;
+constexpr uint32_t SpvExecutionModeLocalSize = 17;
+
+struct EntryPoint {
+    std::string name;
+    uint32_t id;
+    std::array<uint32_t, 3> local_size = {0, 0, 0};
+};
+
+// Find the SPIR-V module that the Vulkan backend embedded in the
+// host module.
+Buffer<uint8_t> find_spirv(const Module &m) {
+    for (const Buffer<void> &b : m.buffers()) {
+        if (b.name().find("vulkan_gpu_source_kernels") != std::string::npos) {
+            return Buffer<uint8_t>(b);
+        }
+    }
+    return Buffer<uint8_t>();
+}
+
+// Walk the instructions of a SPIR-V module, checking that they exactly
+// cover it, and collect its capabilities, memory model and entry points.
+bool parse_spirv(const uint32_t *words, size_t size, std::vector<uint32_t> &capabilities,
+                 uint32_t &memory_model, std::vector<EntryPoint> &entry_points) {
+    if (size < 5 || words[0] != SpvMagicNumber) {
+        printf("Not a SPIR-V module\n");
+        return false;
+    }
+    const uint32_t bound = words[3];
+    if (bound < 2 || words[4] != 0) {
+        printf("Bad SPIR-V header: bound %u, schema %u\n", bound, words[4]);
+        return false;
+    }
+
+    memory_model = 0;
+    size_t i = 5;
+    while (i < size) {
+        const uint32_t word_count = words[i] >> 16;
+        const uint32_t opcode = words[i] & 0xffff;
+        if (word_count == 0 || i + word_count > size) {
+            printf("Instruction at word %d runs past the end of the module\n", (int)i);
+            return false;
+        }
+        const uint32_t *operands = words + i + 1;
+        if (opcode == SpvOpCapability) {
+            capabilities.push_back(operands[0]);
+        } else if (opcode == SpvOpMemoryModel) {
+            memory_model = operands[1];
+        } else if (opcode == SpvOpEntryPoint) {
+            if (operands[0] != SpvExecutionModelGLCompute) {
+                printf("Entry point with execution model %u\n", operands[0]);
+                return false;
+            }
+            EntryPoint e;
+            e.id = operands[1];
+            const char *name = (const char *)(operands + 2);
+            e.name = std::string(name, strnlen(name, (word_count - 3) * sizeof(uint32_t)));
+            entry_points.push_back(e);
+        } else if (opcode == SpvOpExecutionMode && operands[1] == SpvExecutionModeLocalSize) {
+            for (EntryPoint &e : entry_points) {
+                if (e.id == operands[0]) {
+                    e.local_size = {operands[2], operands[3], operands[4]};
+                }
+            }
+        }
+        i += word_count;
+    }
+
+    for (const EntryPoint &e : entry_points) {
+        if (e.id >= bound) {
+            printf("Entry point %s has id %u, which is not below the bound %u\n", e.name.c_str(), e.id, bound);
+            return false;
+        }
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    Target t = get_host_target().with_feature(Target::Vulkan);
+    if (!t.supported()) {
+        printf("[SKIP] This build of Halide does not include the Vulkan target.\n");
+        return 0;
+    }
+
+    Var x("x"), y("y"), xi("xi"), yi("yi");
+    Param<int> p("p");
+
+    Func f("f"), g("g");
+    f(x, y) = x * y + p;
+    g(x, y) = f(x, y) + f(x + 1, y);
+
+    f.compute_root().gpu_tile(x, y, xi, yi, 8, 4);
+    g.gpu_tile(x, xi, 16);
+
+    // Compiling for Vulkan needs no device, so check the SPIR-V that
+    // would be handed to the driver.
+    Module m = g.compile_to_module({p}, "vulkan_spirv", t);
+    Buffer<uint8_t> spirv = find_spirv(m);
+    if (!spirv.defined()) {
+        printf("No SPIR-V module was embedded in the host module\n");
+        return 1;
+    }
+    if (spirv.number_of_elements() % sizeof(uint32_t) != 0) {
+        printf("SPIR-V module is %d bytes, which is not a whole number of words\n", (int)spirv.number_of_elements());
+        return 1;
+    }
+
+    std::vector<uint32_t> capabilities;
+    uint32_t memory_model;
+    std::vector<EntryPoint> entry_points;
+    if (!parse_spirv((const uint32_t *)spirv.data(), spirv.number_of_elements() / sizeof(uint32_t),
+                     capabilities, memory_model, entry_points)) {
+        return 1;
+    }
+
+    if (std::find(capabilities.begin(), capabilities.end(), SpvCapabilityShader) == capabilities.end()) {
+        printf("SPIR-V module does not declare the Shader capability\n");
+        return 1;
+    }
+    if (memory_model != SpvMemoryModelGLSL450) {
+        printf("SPIR-V module has memory model %u\n", memory_model);
+        return 1;
+    }
+
+    // One kernel per stage, each with its block of threads as its
+    // workgroup size.
+    if (entry_points.size() != 2) {
+        printf("Expected 2 entry points, got %d\n", (int)entry_points.size());
+        return 1;
+    }
+    std::vector<std::array<uint32_t, 3>> local_sizes;
+    for (const EntryPoint &e : entry_points) {
+        if (e.name.find("kernel_") != 0) {
+            printf("Unexpected entry point name %s\n", e.name.c_str());
+            return 1;
+        }
+        local_sizes.push_back(e.local_size);
+    }
+    std::sort(local_sizes.begin(), local_sizes.end());
+    const std::vector<std::array<uint32_t, 3>> expected_sizes = {{8, 4, 1}, {16, 1, 1}};
+    if (local_sizes != expected_sizes) {
+        printf("Unexpected workgroup sizes: {%u, %u, %u} and {%u, %u, %u}\n",
+               local_sizes[0][0], local_sizes[0][1], local_sizes[0][2],
+               local_sizes[1][0], local_sizes[1][1], local_sizes[1][2]);
+        return 1;
+    }
+
+    // Run it too, if there is a Vulkan device to run it on.
+    Target jit_target = get_jit_target_from_environment();
+    if (jit_target.has_feature(Target::Vulkan)) {
+        p.set(3);
+        Buffer<int> out = g.realize({64, 32}, jit_target);
+        out.copy_to_host();
+        for (int yy = 0; yy < out.height(); yy++) {
+            for (int xx = 0; xx < out.width(); xx++) {
+                int correct = (xx * yy + 3) + ((xx + 1) * yy + 3);
+                if (out(xx, yy) != correct) {
+                    printf("out(%d, %d) = %d instead of %d\n", xx, yy, out(xx, yy), correct);
+                    return 1;
+                }
+            }
+        }
+    } else {
+        printf("Not running the kernels, as HL_JIT_TARGET does not include vulkan.\n");
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -1,15 +1,61 @@
 #include "HalideBuffer.h"
 #include "HalideRuntime.h"
 
+#include <chrono>
 #include <math.h>
 #include <stdio.h>
+#include <thread>
 
 #include "argvcall.h"
+#include "halide_bounds_query_cache.h"
+#include "halide_schedule_selector.h"
+#include "halide_test_dirs.h"
 
 using namespace Halide::Runtime;
 
 const int kSize = 32;
 
+int argv_calls = 0;
+int counted_argvcall_argv(void **args) {
+    argv_calls++;
+    return argvcall_argv(args);
+}
+
+// An output of the given width that is a bounds query.
+struct QueryBuffer {
+    halide_dimension_t dim[3];
+    halide_buffer_t buf = {};
+
+    QueryBuffer(int width) {
+        dim[0] = halide_dimension_t(0, width, 1);
+        dim[1] = halide_dimension_t(0, kSize, width);
+        dim[2] = halide_dimension_t(0, 1, width * kSize);
+        buf.type = halide_type_of<int32_t>();
+        buf.dimensions = 3;
+        buf.dim = dim;
+    }
+};
+
+// Ask the cache, and the pipeline itself, for the shape of an output
+// of the given width, and check that they agree.
+void check_query(Halide::Tools::BoundsQueryCache &query, float f1, int width) {
+    QueryBuffer cached(width), expected(width);
+    float f2 = 1.0f;
+    void *cached_args[3] = {&f1, &f2, &cached.buf};
+    void *expected_args[3] = {&f1, &f2, &expected.buf};
+    int result = query(cached_args);
+    assert(result == 0);
+    result = argvcall_argv(expected_args);
+    assert(result == 0);
+    for (int d = 0; d < 3; d++) {
+        if (cached.dim[d] != expected.dim[d]) {
+            printf("Bounds query of dimension %d: [%d, %d] (expected [%d, %d])\n", d,
+                   cached.dim[d].min, cached.dim[d].extent, expected.dim[d].min, expected.dim[d].extent);
+            exit(-1);
+        }
+    }
+}
+
 void verify(const Buffer<int32_t, 3> &img, float f1, float f2) {
     for (int i = 0; i < kSize; i++) {
         for (int j = 0; j < kSize; j++) {
@@ -49,6 +95,112 @@ int main(int argc, char **argv) {
     }
     verify(output, arg0, arg1);
 
+    // Choose between two versions of the pipeline, of which the first
+    // is the slow one, and remember the choice in a file.
+    {
+        using Selector = Halide::Tools::ScheduleSelector<float, float, halide_buffer_t *>;
+        int calls[2] = {0, 0};
+        std::vector<Selector::Candidate> candidates = {
+            [&](float f1, float f2, halide_buffer_t *out) {
+                calls[0]++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                return argvcall(f1, f2, out);
+            },
+            [&](float f1, float f2, halide_buffer_t *out) {
+                calls[1]++;
+                return argvcall(f1, f2, out);
+            }};
+        Selector::Size pixels = [](float, float, halide_buffer_t *out) {
+            return (int64_t)out->dim[0].extent * out->dim[1].extent;
+        };
+        const std::string cache_file = Halide::Internal::get_test_tmp_dir() + "argvcall_schedules.txt";
+        remove(cache_file.c_str());
+
+        Selector select(candidates, pixels, cache_file, 2);
+        assert(select.winner(kSize * kSize) == -1);
+
+        // Each version is tried twice, in turn, and then the faster
+        // one is used for every call of that size.
+        for (int i = 0; i < 6; i++) {
+            result = select(1.5f, 2.5f, output);
+            assert(result == 0);
+            verify(output, 1.5f, 2.5f);
+        }
+        assert(calls[0] == 2 && calls[1] == 4);
+        assert(select.winner(kSize * kSize) == 1);
+        assert(select.winner(kSize * kSize + 1) == 1);
+        assert(select.winner(kSize * kSize * 2) == -1);
+
+        // Other sizes are in other buckets, and are tried again.
+        Buffer<int32_t, 3> half = output.cropped(1, 0, kSize / 2);
+        result = select(1.5f, 2.5f, half);
+        assert(result == 0);
+        assert(calls[0] == 3 && calls[1] == 4);
+        assert(select.winner(kSize * kSize / 2) == -1);
+
+        // A selector for the same versions skips the trials for the
+        // sizes in the file...
+        Selector reloaded(candidates, pixels, cache_file, 2);
+        assert(reloaded.winner(kSize * kSize) == 1);
+        assert(reloaded.winner(kSize * kSize / 2) == -1);
+        result = reloaded(1.2f, 3.4f, output);
+        assert(result == 0);
+        verify(output, 1.2f, 3.4f);
+        assert(calls[0] == 3 && calls[1] == 5);
+
+        // ...but one for a different set of them ignores it.
+        candidates.push_back(candidates[1]);
+        Selector other(candidates, pixels, cache_file, 2);
+        assert(other.winner(kSize * kSize) == -1);
+
+        remove(cache_file.c_str());
+    }
+
+    // Answer repeated bounds queries from a cache. A query depends on
+    // the shapes of the buffers and the values of the scalars.
+    {
+        Halide::Tools::BoundsQueryCache query(counted_argvcall_argv, argvcall_metadata());
+        check_query(query, 1.0f, kSize);
+        assert(argv_calls == 1 && query.size() == 1 && query.hits() == 0);
+        check_query(query, 1.0f, kSize);
+        assert(argv_calls == 1 && query.size() == 1 && query.hits() == 1);
+        check_query(query, 2.0f, kSize);
+        assert(argv_calls == 2 && query.size() == 2 && query.hits() == 1);
+        check_query(query, 1.0f, kSize / 2);
+        assert(argv_calls == 3 && query.size() == 3 && query.hits() == 1);
+        check_query(query, 2.0f, kSize);
+        assert(argv_calls == 3 && query.size() == 3 && query.hits() == 2);
+
+        // Calls that aren't queries don't run the pipeline at all.
+        output.fill(-1);
+        float f1 = 1.0f, f2 = 1.0f;
+        void *run_args[3] = {&f1, &f2, (halide_buffer_t *)output};
+        result = query(run_args);
+        assert(result == 0);
+        assert(argv_calls == 3 && query.size() == 3);
+        output.for_each_value([](int32_t v) { assert(v == -1); });
+
+        query.clear();
+        assert(query.size() == 0);
+        check_query(query, 1.0f, kSize);
+        assert(argv_calls == 4 && query.size() == 1);
+    }
+
+    // A full cache starts again from empty.
+    {
+        argv_calls = 0;
+        Halide::Tools::BoundsQueryCache query(counted_argvcall_argv, argvcall_metadata(), 2);
+        check_query(query, 1.0f, kSize);
+        check_query(query, 2.0f, kSize);
+        assert(argv_calls == 2 && query.size() == 2);
+        check_query(query, 3.0f, kSize);
+        assert(argv_calls == 3 && query.size() == 1);
+        check_query(query, 1.0f, kSize);
+        assert(argv_calls == 4 && query.size() == 2 && query.hits() == 0);
+        check_query(query, 3.0f, kSize);
+        assert(argv_calls == 4 && query.hits() == 1);
+    }
+
     printf("Success!\n");
     return 0;
 }
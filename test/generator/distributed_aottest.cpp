@@ -0,0 +1,143 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdio.h>
+#include <thread>
+#include <vector>
+
+#include "distributed.h"
+
+using namespace Halide::Runtime;
+
+// Simulate a distributed computation with one thread per rank, which
+// exchange rows through shared memory.
+
+namespace {
+
+constexpr int num_ranks = 4;
+
+thread_local int this_rank = 0;
+
+// Wait until every rank gets here.
+class Barrier {
+    std::mutex mutex;
+    std::condition_variable cond;
+    int waiting = 0, generation = 0;
+
+public:
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int g = generation;
+        if (++waiting == num_ranks) {
+            waiting = 0;
+            generation++;
+            cond.notify_all();
+        } else {
+            cond.wait(lock, [&] { return generation != g; });
+        }
+    }
+} barrier;
+
+struct Posted {
+    halide_buffer_t *buf;
+    int owned_min, owned_extent;
+} posted[num_ranks];
+
+std::atomic<bool> failed{false};
+
+int rank(void *user_context) {
+    return this_rank;
+}
+
+int get_num_ranks(void *user_context) {
+    return num_ranks;
+}
+
+int exchange(void *user_context, halide_buffer_t *buf, int dim,
+             int owned_min, int owned_extent, int needed_min, int needed_extent) {
+    // Each rank should only have stored its own block, and the rows
+    // it needs on either side of it.
+    if (buf->dim[dim].extent > owned_extent + 2) {
+        printf("Rank %d stores %d rows, but only owns %d\n", this_rank, buf->dim[dim].extent, owned_extent);
+        failed = true;
+    }
+
+    posted[this_rank] = {buf, owned_min, owned_extent};
+    barrier.wait();
+
+    Buffer<> dst(*buf);
+    for (int r = 0; r < num_ranks; r++) {
+        int lo = std::max(needed_min, posted[r].owned_min);
+        int hi = std::min(needed_min + needed_extent, posted[r].owned_min + posted[r].owned_extent);
+        if (r == this_rank || lo >= hi) {
+            continue;
+        }
+        Buffer<> src(*posted[r].buf);
+        dst.cropped(dim, lo, hi - lo).copy_from(src.cropped(dim, lo, hi - lo));
+    }
+
+    // Don't let any rank go on to free its buffer until the others
+    // have copied from it.
+    barrier.wait();
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    const int width = 64, height = 50;
+
+    Buffer<uint16_t, 2> input(width, height + 2);
+    input.set_min(0, -1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint16_t)(x * 7 + y * 13);
+    });
+
+    halide_set_custom_distributed_runtime(rank, get_num_ranks, exchange);
+
+    std::vector<Buffer<uint16_t, 2>> outputs;
+    for (int r = 0; r < num_ranks; r++) {
+        outputs.emplace_back(width, height);
+        outputs.back().fill(0);
+    }
+
+    std::vector<std::thread> threads;
+    for (int r = 0; r < num_ranks; r++) {
+        threads.emplace_back([&, r] {
+            this_rank = r;
+            if (distributed(input, outputs[r]) != 0) {
+                printf("Rank %d failed\n", r);
+                failed = true;
+            }
+        });
+    }
+    for (auto &t : threads) {
+        t.join();
+    }
+    if (failed) {
+        return 1;
+    }
+
+    // Each rank writes an equal block of the rows, apart from the last.
+    const int block = (height + num_ranks - 1) / num_ranks;
+    for (int y = 0; y < height; y++) {
+        const Buffer<uint16_t, 2> &out = outputs[y / block];
+        for (int x = 0; x < width; x++) {
+            uint16_t correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                correct += (uint16_t)(input(x, y + dy) * 2 + (y + dy));
+            }
+            if (out(x, y) != correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, out(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class Distributed : public Halide::Generator<Distributed> {
+public:
+    Input<Buffer<uint16_t, 2>> input{"input"};
+    Output<Buffer<uint16_t, 2>> output{"output"};
+
+    void generate() {
+        Var x, y;
+
+        // A distributed producer, which each rank needs the rows on
+        // either side of its own block of, feeding a distributed consumer.
+        rows(x, y) = input(x, y) * 2 + cast<uint16_t>(y);
+        output(x, y) = rows(x, y - 1) + rows(x, y) + rows(x, y + 1);
+
+        rows.compute_root().distribute(y).vectorize(x, natural_vector_size<uint16_t>());
+        output.distribute(y).vectorize(x, natural_vector_size<uint16_t>());
+    }
+
+private:
+    Func rows{"rows"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(Distributed, distributed)
@@ -1,15 +1,35 @@
 #include "HalideBuffer.h"
 #include "HalideRuntime.h"
 
+#include <atomic>
+#include <chrono>
 #include <math.h>
 #include <stdio.h>
+#include <thread>
 
 #include "example.h"
+#include "halide_co_execute.h"
 
 using namespace Halide::Runtime;
 
 const int kSize = 32;
 
+struct ExampleCall {
+    float runtime_factor;
+    Buffer<int32_t, 3> output;
+};
+
+int call_example(void *user_context, void *arg) {
+    ExampleCall *call = (ExampleCall *)arg;
+    return example(call->runtime_factor, call->output);
+}
+
+std::atomic<int> calls_done{0};
+void count_done(void *user_context, void *arg, int result) {
+    assert(result == 0);
+    calls_done++;
+}
+
 void verify(const Buffer<int32_t, 3> &img, float compiletime_factor, float runtime_factor, int channels) {
     img.for_each_element([=](int x, int y, int c) {
         int expected = (int32_t)(compiletime_factor * runtime_factor * c * (x > y ? x : y));
@@ -35,6 +55,73 @@ int main(int argc, char **argv) {
     example(-1.234f, output);
     verify(output, compiletime_factor, -1.234f, channels);
 
+    // Several calls can be in flight at once without blocking the
+    // caller. Wait for some of them, and only count the others.
+    const int kCalls = 8;
+    ExampleCall calls[kCalls];
+    halide_async_call_t *handles[kCalls];
+    for (int i = 0; i < kCalls; i++) {
+        calls[i].runtime_factor = (float)i;
+        calls[i].output = Buffer<int32_t, 3>(kSize, kSize, 3);
+        handles[i] = halide_call_async(nullptr, call_example, calls + i, count_done);
+        assert(handles[i]);
+    }
+    for (int i = 0; i < kCalls; i++) {
+        if (i % 2) {
+            halide_async_call_detach(handles[i]);
+        } else {
+            int result = halide_async_call_wait(handles[i]);
+            assert(result == 0);
+        }
+    }
+    while (calls_done < kCalls) {
+        std::this_thread::yield();
+    }
+    for (int i = 0; i < kCalls; i++) {
+        verify(calls[i].output, compiletime_factor, (float)i, channels);
+    }
+
+    // Split the rows between two callers of the pipeline, the way
+    // CoExecutor splits them between the CPU and the GPU. Make the
+    // "GPU" the slow one, so that its share goes down.
+    {
+        const float factor = 2.5f;
+        int gpu_min = -1, gpu_rows = 0, cpu_min = -1, cpu_rows = 0;
+        Halide::Tools::CoExecutor co_execute(
+            1,
+            [&](halide_buffer_t *out) {
+                cpu_min = out->dim[1].min;
+                cpu_rows = out->dim[1].extent;
+                return example(factor, out);
+            },
+            [&](halide_buffer_t *out) {
+                gpu_min = out->dim[1].min;
+                gpu_rows = out->dim[1].extent;
+                std::this_thread::sleep_for(std::chrono::milliseconds(gpu_rows));
+                return example(factor, out);
+            },
+            8);
+        assert(co_execute.gpu_fraction() == 0.5);
+
+        for (int i = 0; i < 4; i++) {
+            Buffer<int32_t, 3> out(kSize, kSize, 3);
+            int result = co_execute(out);
+            assert(result == 0);
+            verify(out, compiletime_factor, factor, channels);
+
+            // The GPU gets the first rows and the CPU the rest, in
+            // multiples of the alignment, and each gets some.
+            assert(gpu_min == 0 && cpu_min == gpu_rows);
+            assert(gpu_rows + cpu_rows == kSize);
+            assert(gpu_rows % 8 == 0 && gpu_rows >= 8 && cpu_rows >= 8);
+            if (i == 0) {
+                assert(gpu_rows == kSize / 2);
+            }
+        }
+        assert(co_execute.gpu_fraction() < 0.5);
+        assert(gpu_rows == 8);
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -0,0 +1,122 @@
+#include <stdio.h>
+
+// Check that the iterations of a loop scheduled with multi_gpu get the
+// user_contexts returned by halide_gpu_device_user_context, by
+// recording the user_contexts passed to halide_malloc for the shards.
+
+#ifdef _WIN32
+int main(int argc, char **argv) {
+    printf("[SKIP] Test requires weak linkage, which is not available on Windows.\n");
+    return 0;
+}
+#else
+
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <atomic>
+#include <stdlib.h>
+
+#include "multi_gpu.h"
+
+using namespace Halide::Runtime;
+
+namespace {
+
+constexpr int num_devices = 4;
+constexpr int W = 64, H = 64;
+
+// Stand-ins for the contexts of the devices, which a real program
+// would hand to the GPU runtime in halide_cuda_acquire_context.
+struct Device {
+    std::atomic<int> mallocs{0};
+} devices[num_devices];
+
+int pipeline_user_context;
+
+std::atomic<int> calls[num_devices];
+std::atomic<bool> failed{false};
+
+void *my_malloc(void *user_context, size_t size) {
+    for (Device &d : devices) {
+        if (user_context == &d) {
+            d.mallocs++;
+        }
+    }
+    void *orig = malloc(size + 128);
+    if (!orig) {
+        return nullptr;
+    }
+    void *ptr = (void *)((((size_t)orig + 128) >> 7) << 7);
+    ((void **)ptr)[-1] = orig;
+    return ptr;
+}
+
+void my_free(void *user_context, void *ptr) {
+    free(((void **)ptr)[-1]);
+}
+
+}  // namespace
+
+// Replaces the implementation in src/runtime/gpu_device_selection.cpp.
+extern "C" void *halide_gpu_device_user_context(void *user_context, int index) {
+    if (user_context != &pipeline_user_context || index < 0 || index >= num_devices) {
+        printf("halide_gpu_device_user_context(%p, %d) called with the wrong arguments\n",
+               user_context, index);
+        failed = true;
+        return user_context;
+    }
+    calls[index]++;
+    return &devices[index];
+}
+
+int main(int argc, char **argv) {
+    halide_set_custom_malloc(my_malloc);
+    halide_set_custom_free(my_free);
+
+    Buffer<uint16_t, 2> input(W, H + 2);
+    input.set_min(0, -1);
+    input.for_each_element([&](int x, int y) {
+        input(x, y) = (uint16_t)(x * 3 + y * 7);
+    });
+
+    Buffer<uint16_t, 2> output(W, H);
+    if (multi_gpu(&pipeline_user_context, input, output) != 0) {
+        printf("Pipeline failed\n");
+        return 1;
+    }
+    output.copy_to_host();
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            int correct = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                correct += input(x, y + dy) * 2 + y + dy;
+            }
+            if (output(x, y) != (uint16_t)correct) {
+                printf("output(%d, %d) = %d instead of %d\n", x, y, output(x, y), correct);
+                return 1;
+            }
+        }
+    }
+
+    if (failed) {
+        return 1;
+    }
+
+    for (int i = 0; i < num_devices; i++) {
+        if (calls[i] != 1) {
+            printf("Iteration %d got its user_context %d times\n", i, calls[i].load());
+            return 1;
+        }
+        if (devices[i].mallocs == 0) {
+            printf("Nothing was allocated with the user_context of device %d\n", i);
+            return 1;
+        }
+    }
+
+    printf("Success!\n");
+    return 0;
+}
+
+#endif
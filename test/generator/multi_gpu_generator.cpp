@@ -0,0 +1,38 @@
+#include "Halide.h"
+
+namespace {
+
+class MultiGPU : public Halide::Generator<MultiGPU> {
+public:
+    GeneratorParam<int> rows_per_device{"rows_per_device", 16};
+
+    Input<Buffer<uint16_t, 2>> input{"input"};
+    Output<Buffer<uint16_t, 2>> output{"output"};
+
+    void generate() {
+        Var x, y, yo, yi, xi, yii;
+
+        // Each device computes a shard of rows feeding its block of
+        // the output, from the rows of the input it needs, including
+        // the halo on either side.
+        Func staged = input.in();
+        shard(x, y) = staged(x, y) * 2 + cast<uint16_t>(y);
+        output(x, y) = shard(x, y - 1) + shard(x, y) + shard(x, y + 1);
+
+        output.split(y, yo, yi, rows_per_device).multi_gpu(yo);
+        staged.compute_at(output, yo);
+        shard.compute_at(output, yo);
+        if (get_target().has_gpu_feature()) {
+            shard.gpu_tile(x, y, xi, yii, 16, 8);
+        } else {
+            shard.vectorize(x, natural_vector_size<uint16_t>());
+        }
+    }
+
+private:
+    Func shard{"shard"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(MultiGPU, multi_gpu)
@@ -92,6 +92,33 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    {
+        // Installing a different halide_can_use_target_features() must make the
+        // wrapper choose again, so tests can force a particular sub-pipeline.
+        halide_set_custom_can_use_target_features(my_can_use_target_features);
+        if (HalideTest::multitarget(output) != 0) {
+            printf("Error at multitarget\n");
+            return -1;
+        }
+        if (can_use_count != 2) {
+            printf("Error: halide_can_use_target_features was not called again after an override!\n");
+            return -1;
+        }
+
+        // As must an explicit reset.
+        halide_reset_multitarget_dispatch();
+        for (int i = 0; i < 10; ++i) {
+            if (HalideTest::multitarget(output) != 0) {
+                printf("Error at multitarget\n");
+                return -1;
+            }
+        }
+        if (can_use_count != 3) {
+            printf("Error: halide_can_use_target_features was called %d times after a reset!\n", (int)can_use_count);
+            return -1;
+        }
+    }
+
     {
         // Verify that the multitarget wrapper code propagates nonzero error
         // results back to the caller properly.
@@ -0,0 +1,71 @@
+#include "HalideBuffer.h"
+#include "HalideRuntime.h"
+
+#include <stdio.h>
+
+#include "thread_pool_work_stealing.h"
+
+using namespace Halide::Runtime;
+
+int check(const Buffer<int, 3> &out) {
+    for (int z = 0; z < out.dim(2).extent(); z++) {
+        for (int y = 0; y < out.dim(1).extent(); y++) {
+            for (int x = 0; x < out.dim(0).extent(); x++) {
+                int correct = 2 * (x + y * 3 + z * 7) + 1;
+                if (out(x, y, z) != correct) {
+                    printf("out(%d, %d, %d) = %d instead of %d\n",
+                           x, y, z, out(x, y, z), correct);
+                    return -1;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    Buffer<int, 3> out(37, 53, 17);
+
+    for (bool stealing : {false, true}) {
+        halide_set_thread_pool_work_stealing(stealing);
+        for (int i = 0; i < 100; i++) {
+            // Vary the number of threads so that the ranges are split
+            // in different ways relative to the loop extents.
+            halide_set_num_threads(1 + i % 8);
+            out.fill(0);
+            int ret = thread_pool_work_stealing(out);
+            if (ret) {
+                printf("Non zero exit code: %d\n", ret);
+                return -1;
+            }
+            if (check(out)) {
+                return -1;
+            }
+        }
+    }
+
+    // NUMA-aware mode splits loops into ranges by worker thread
+    // index. It only takes effect for threads spawned after it is
+    // enabled, so restart the thread pool around it.
+    halide_set_thread_pool_work_stealing(false);
+    halide_shutdown_thread_pool();
+    halide_set_numa_aware(true);
+    for (int i = 0; i < 100; i++) {
+        out.fill(0);
+        int ret = thread_pool_work_stealing(out);
+        if (ret) {
+            printf("Non zero exit code: %d\n", ret);
+            return -1;
+        }
+        if (check(out)) {
+            return -1;
+        }
+    }
+    halide_shutdown_thread_pool();
+    halide_set_numa_aware(false);
+
+    halide_set_num_threads(0);
+
+    printf("Success!\n");
+    return 0;
+}
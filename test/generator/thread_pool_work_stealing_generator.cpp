@@ -0,0 +1,28 @@
+#include "Halide.h"
+
+namespace {
+
+class ThreadPoolWorkStealing : public Halide::Generator<ThreadPoolWorkStealing> {
+public:
+    Output<Buffer<int, 3>> output{"output"};
+
+    void generate() {
+        Var x, y, z;
+
+        // An async producer (which uses semaphores, so is never split
+        // into per-thread ranges) feeding a consumer with nested
+        // parallelism (which is).
+        producer(x, y, z) = x + y * 3 + z * 7;
+        output(x, y, z) = producer(x, y, z) + producer(x + 1, y, z);
+
+        output.parallel(z).parallel(y);
+        producer.compute_at(output, z).store_root().async().parallel(y);
+    }
+
+private:
+    Func producer{"producer"};
+};
+
+}  // namespace
+
+HALIDE_REGISTER_GENERATOR(ThreadPoolWorkStealing, thread_pool_work_stealing)
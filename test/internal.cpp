@@ -7,6 +7,7 @@
 #include "Deinterleave.h"
 #include "Func.h"
 #include "Generator.h"
+#include "HashCons.h"
 #include "IR.h"
 #include "IREquality.h"
 #include "IRMatch.h"
@@ -15,6 +16,7 @@
 #include "ModulusRemainder.h"
 #include "Monotonic.h"
 #include "Reduction.h"
+#include "Serialization.h"
 #include "Solve.h"
 #include "SpirvIR.h"
 #include "UniquifyVariableNames.h"
@@ -31,6 +33,8 @@ int main(int argc, const char **argv) {
     deinterleave_vector_test();
     modulus_remainder_test();
     cse_test();
+    hash_cons_test();
+    serialization_test();
     solve_test();
     target_test();
     cplusplus_mangle_test();
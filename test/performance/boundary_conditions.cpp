@@ -80,7 +80,7 @@ struct Test {
 
 int main(int argc, char **argv) {
     target = get_jit_target_from_environment();
-    if (target.arch == Target::WebAssembly) {
+    if (target.arch == Target::WebAssembly && Halide::Internal::WasmModule::uses_interpreter()) {
         printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
         return 0;
     }
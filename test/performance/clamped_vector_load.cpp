@@ -39,7 +39,7 @@ double test(Func f, bool test_correctness = true) {
 
 int main(int argc, char **argv) {
     Target target = get_jit_target_from_environment();
-    if (target.arch == Target::WebAssembly) {
+    if (target.arch == Target::WebAssembly && Internal::WasmModule::uses_interpreter()) {
         printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
         return 0;
     }
@@ -120,7 +120,7 @@ bool test(int w, bool div, bool round_to_zero) {
 
 int main(int argc, char **argv) {
     Target target = get_jit_target_from_environment();
-    if (target.arch == Target::WebAssembly) {
+    if (target.arch == Target::WebAssembly && Internal::WasmModule::uses_interpreter()) {
         printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
         return 0;
     }
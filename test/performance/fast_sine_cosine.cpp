@@ -10,7 +10,7 @@ using namespace Halide::Tools;
 
 int main(int argc, char **argv) {
     Target target = get_jit_target_from_environment();
-    if (target.arch == Target::WebAssembly) {
+    if (target.arch == Target::WebAssembly && Internal::WasmModule::uses_interpreter()) {
         printf("[SKIP] Performance tests are meaningless and/or misleading under WebAssembly interpreter.\n");
         return 0;
     }
@@ -49,6 +49,46 @@ int main(int argc, char **argv) {
         return -1;
     }
 
+    // The other precisions, and the other transcendentals that would
+    // otherwise be scalar libm calls.
+    const ApproximationPrecision precisions[] = {
+        ApproximationPrecision::Fast,
+        ApproximationPrecision::Balanced,
+        ApproximationPrecision::Precise};
+    const char *precision_names[] = {"Fast", "Balanced", "Precise"};
+    Expr u = -two_pi * t + (1 - t) * two_pi;
+    for (int p = 0; p < 3; p++) {
+        Func f[5];
+        f[0](x) = fast_sin(u, precisions[p]);
+        f[1](x) = fast_cos(u, precisions[p]);
+        f[2](x) = fast_tanh(u, precisions[p]);
+        f[3](x) = fast_sigmoid(u, precisions[p]);
+        f[4](x) = fast_erf(u, precisions[p]);
+        double times[5];
+        for (int i = 0; i < 5; i++) {
+            f[i].vectorize(x, 8);
+            times[i] = 1e6 * benchmark([&]() { f[i].realize({1000}); });
+        }
+        printf("%s: sin %f, cos %f, tanh %f, sigmoid %f, erf %f ns per pixel\n",
+               precision_names[p], times[0], times[1], times[2], times[3], times[4]);
+    }
+
+    Func tanh_f, tanh_ref;
+    tanh_f(x) = fast_tanh(u);
+    tanh_ref(x) = tanh(u);
+    tanh_f.vectorize(x, 8);
+    tanh_ref.vectorize(x, 8);
+    double t_fast_tanh = 1e6 * benchmark([&]() { tanh_f.realize({1000}); });
+    double t_tanh = 1e6 * benchmark([&]() { tanh_ref.realize({1000}); });
+    printf("tanh: %f ns per pixel\n"
+           "fast_tanh: %f ns per pixel\n",
+           t_tanh, t_fast_tanh);
+
+    if (t_tanh < t_fast_tanh) {
+        printf("fast_tanh is not faster than tanh\n");
+        return -1;
+    }
+
     printf("Success!\n");
     return 0;
 }
@@ -12,10 +12,10 @@ int main(int argc, char **argv) {
 
     Param<int> p;
 
-    const char *names[3] = {"heap", "pseudostack", "stack"};
+    const char *names[4] = {"heap", "pseudostack", "stack", "arena"};
 
-    double t[3];
-    for (int i = 0; i < 3; i++) {
+    double t[4];
+    for (int i = 0; i < 4; i++) {
         Var x("x");
 
         Func in;
@@ -35,7 +35,7 @@ int main(int argc, char **argv) {
         chain.back().split(x, xo, xi, p, TailStrategy::RoundUp);
         for (size_t j = 0; j < chain.size() - 1; j++) {
             chain[j].compute_at(chain.back(), xo);
-            if (i != 0) {
+            if (i == 1 || i == 2) {
                 chain[j].store_in(MemoryType::Stack);
             }
             if (i == 2) {
@@ -61,8 +61,13 @@ int main(int argc, char **argv) {
         // pseudostack, not stack to register.
         p.set(200);
 
+        // The arena version uses the heap schedule, but serves the
+        // allocations from the runtime's bump allocator.
+        Target t_i = (i == 3) ? target.with_feature(Target::BumpAllocator) : target;
+        chain.back().compile_jit(t_i);
+
         Buffer<int> out(16 * 1000 * 1000);
-        t[i] = Halide::Tools::benchmark([&] { chain.back().realize(out); });
+        t[i] = Halide::Tools::benchmark([&] { chain.back().realize(out, t_i); });
 
         printf("Time using %s: %f\n", names[i], t[i]);
     }
@@ -18,7 +18,7 @@ void my_print(JITUserContext *, const char *msg) {
     }
 }
 
-int run_test(bool use_timer_profiler) {
+int run_test(Target::Feature profiler) {
     ms = 0;
     // Make a long chain of finely-interleaved Funcs, of which one is very expensive.
     Func f[30];
@@ -51,8 +51,7 @@ int run_test(bool use_timer_profiler) {
         f[i].compute_at(out, x);
     }
 
-    Target t = get_jit_target_from_environment()
-                   .with_feature(use_timer_profiler ? Target::ProfileByTimer : Target::Profile);
+    Target t = get_jit_target_from_environment().with_feature(profiler);
     Buffer<float> im = out.realize({10, 1000}, t);
 
     // out.compile_to_assembly("/dev/stdout", {}, t.with_feature(Target::JIT));
@@ -76,17 +75,22 @@ int main(int argc, char **argv) {
     }
 
     printf("Testing thread based profiler.\n");
-    int result = run_test(false);
+    int result = run_test(Target::Profile);
     if (result == -1) {
         return -1;
     }
     if (get_jit_target_from_environment().os == Target::Linux) {
         printf("Testing timer based profiler.\n");
-        result = run_test(true);
+        result = run_test(Target::ProfileByTimer);
         if (result == -1) {
             return -1;
         }
     }
+    printf("Testing instrumented profiler.\n");
+    result = run_test(Target::ProfileInstrumented);
+    if (result == -1) {
+        return -1;
+    }
     printf("Success!\n");
     return 0;
 }
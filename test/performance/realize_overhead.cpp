@@ -45,6 +45,20 @@ int main(int argc, char **argv) {
         std::cout << "No argument Pipeline realize time " << t * 1e6 << "us.\n";
     }
 
+    {
+        Func f;
+        Var x, y;
+        f(x, y) = x + y;
+
+        Pipeline p(f);
+        p.compile_jit();
+
+        // Repeated calls reuse the output bounds query and the output
+        // allocation.
+        double t = benchmark([&]() { p.realize({64, 64}); });
+        std::cout << "Two dimensional Pipeline realize to a new 64x64 output time " << t * 1e6 << "us.\n";
+    }
+
     {
         Func f;
         f() = 42;
@@ -0,0 +1,193 @@
+#include "common.h"
+
+#include "runtime/device_memory_pool.cpp"
+
+using namespace Halide::Runtime::Internal;
+
+extern "C" {
+
+// This test is single-threaded, and only needs the parts of the runtime
+// that the pool calls into.
+void halide_mutex_lock(halide_mutex *mutex) {
+}
+
+void halide_mutex_unlock(halide_mutex *mutex) {
+}
+
+bool reuse_device_allocations = true;
+
+bool halide_can_reuse_device_allocations(void *user_context) {
+    return reuse_device_allocations;
+}
+
+halide_device_memory_pool *registered_pool = nullptr;
+
+void halide_register_device_memory_pool(struct halide_device_memory_pool *pool) {
+    registered_pool = pool;
+}
+
+}  // extern "C"
+
+namespace {
+
+size_t allocated_device_memory = 0;
+size_t device_memory_limit = 0;
+
+uint64_t allocate_device_block(void *user_context, void *device_context, size_t size) {
+    if (device_memory_limit && allocated_device_memory + size > device_memory_limit) {
+        return 0;
+    }
+    allocated_device_memory += size;
+    void *ptr = allocate_system(user_context, size + sizeof(size_t));
+    *(size_t *)ptr = size;
+    return (uint64_t)(uintptr_t)ptr;
+}
+
+void free_device_block(void *user_context, void *device_context, uint64_t block) {
+    void *ptr = (void *)(uintptr_t)block;
+    allocated_device_memory -= *(size_t *)ptr;
+    deallocate_system(user_context, ptr);
+}
+
+DeviceMemoryPool pool = {{}, allocate_device_block, free_device_block, 4096, 1024, 64, true};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    void *user_context = (void *)1;
+    void *device_context = (void *)2;
+    void *queue_a = (void *)3;
+    void *queue_b = (void *)4;
+
+    device_memory_pool_register(&pool, nullptr);
+    halide_abort_if_false(user_context, registered_pool == &pool.registration);
+
+    // small requests are sub-allocated from one shared block
+    {
+        uint64_t b1, o1, b2, o2;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 100, &b1, &o1) == 0);
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 100, &b2, &o2) == 0);
+        halide_abort_if_false(user_context, b1 == b2);
+        halide_abort_if_false(user_context, o1 != o2);
+        halide_abort_if_false(user_context, (o1 % 64) == 0 && (o2 % 64) == 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 4096);
+        halide_abort_if_false(user_context, pool.stats.num_device_api_allocations == 1);
+        // 100 bytes rounds up to 128 bytes
+        halide_abort_if_false(user_context, pool.stats.bytes_in_use == 256);
+
+        void *queue = nullptr;
+        halide_abort_if_false(user_context, device_memory_pool_find(user_context, &pool, device_context, b2 + o2, 0, &queue));
+        halide_abort_if_false(user_context, queue == queue_a);
+        halide_abort_if_false(user_context, !device_memory_pool_find(user_context, &pool, device_context, b2 + o2 + 1, 0, &queue));
+
+        // reclaimed memory is reused without another block
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b1 + o1, 0));
+        uint64_t b3, o3;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 120, &b3, &o3) == 0);
+        halide_abort_if_false(user_context, b3 + o3 == b1 + o1);
+        halide_abort_if_false(user_context, pool.stats.num_device_api_allocations == 1);
+
+        // memory for a different queue comes from a different block
+        uint64_t b4, o4;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_b, 100, &b4, &o4) == 0);
+        halide_abort_if_false(user_context, b4 != b1);
+        halide_abort_if_false(user_context, allocated_device_memory == 2 * 4096);
+
+        // blocks still in use survive a trim
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b4 + o4, 0));
+        halide_abort_if_false(user_context, device_memory_pool_trim(user_context, &pool, nullptr) == 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 4096);
+
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b2 + o2, 0));
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b3 + o3, 0));
+        halide_abort_if_false(user_context, !device_memory_pool_reclaim(user_context, &pool, device_context, b3 + o3, 0));
+        halide_abort_if_false(user_context, pool.stats.bytes_in_use == 0);
+        halide_abort_if_false(user_context, device_memory_pool_trim(user_context, &pool, nullptr) == 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 0);
+        halide_abort_if_false(user_context, pool.partitions == nullptr);
+    }
+
+    // large requests get dedicated blocks, binned by size class
+    {
+        uint64_t b1, o1, b2, o2;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 10000, &b1, &o1) == 0);
+        halide_abort_if_false(user_context, o1 == 0);
+        // 10000 bytes rounds up to 10240 bytes
+        halide_abort_if_false(user_context, allocated_device_memory == 10240);
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b1, o1));
+
+        // a request of the same size class reuses the block
+        const uint64_t old_count = pool.stats.num_device_api_allocations;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 10100, &b2, &o2) == 0);
+        halide_abort_if_false(user_context, b2 == b1 && o2 == 0);
+        halide_abort_if_false(user_context, pool.stats.num_device_api_allocations == old_count);
+
+        // but one of another size class doesn't
+        uint64_t b3, o3;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 20000, &b3, &o3) == 0);
+        halide_abort_if_false(user_context, b3 != b1);
+        halide_abort_if_false(user_context, allocated_device_memory == 10240 + 20480);
+        halide_abort_if_false(user_context, pool.stats.peak_bytes_allocated == 10240 + 20480);
+
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b2, o2));
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b3, o3));
+        halide_abort_if_false(user_context, device_memory_pool_trim(user_context, &pool, device_context) == 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 0);
+        halide_abort_if_false(user_context, pool.stats.bytes_allocated == 0);
+    }
+
+    // unused blocks are freed to make room when the device runs out
+    {
+        device_memory_limit = 16384;
+        uint64_t b1, o1, b2, o2;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 12288, &b1, &o1) == 0);
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b1, o1));
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_b, 12288, &b2, &o2) == 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 12288);
+
+        // and requests that can't be met fail cleanly
+        uint64_t b3, o3;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_b, 12288, &b3, &o3) != 0);
+        halide_abort_if_false(user_context, allocated_device_memory == 12288);
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b2, o2));
+        device_memory_limit = 0;
+    }
+
+    // with reuse off, memory goes straight back to the device
+    {
+        reuse_device_allocations = false;
+        uint64_t b1, o1;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 100, &b1, &o1) == 0);
+        halide_abort_if_false(user_context, device_memory_pool_reclaim(user_context, &pool, device_context, b1 + o1, 0));
+        halide_abort_if_false(user_context, allocated_device_memory == 0);
+        reuse_device_allocations = true;
+    }
+
+    // the stats are visible through the registered pool
+    {
+        halide_device_memory_pool_stats_t stats;
+        halide_abort_if_false(user_context, registered_pool->get_stats(user_context, registered_pool, &stats) == 0);
+        halide_abort_if_false(user_context, stats.bytes_in_use == 0);
+        halide_abort_if_false(user_context, stats.bytes_allocated == 0);
+        halide_abort_if_false(user_context, stats.peak_bytes_allocated == 10240 + 20480);
+        halide_abort_if_false(user_context, stats.num_allocations == 10);
+    }
+
+    // forgetting a device context drops its blocks without freeing them
+    {
+        uint64_t b1, o1;
+        halide_abort_if_false(user_context, device_memory_pool_reserve(user_context, &pool, device_context, queue_a, 100, &b1, &o1) == 0);
+        device_memory_pool_forget(user_context, &pool, device_context);
+        halide_abort_if_false(user_context, pool.partitions == nullptr);
+        halide_abort_if_false(user_context, pool.stats.bytes_in_use == 0);
+        halide_abort_if_false(user_context, pool.stats.bytes_allocated == 0);
+        halide_abort_if_false(user_context, !device_memory_pool_reclaim(user_context, &pool, device_context, b1 + o1, 0));
+        free_device_block(user_context, device_context, b1);
+    }
+
+    halide_abort_if_false(user_context, allocated_device_memory == 0);
+    halide_abort_if_false(user_context, allocated_system_memory == 0);
+
+    print(user_context) << "Success!\n";
+    return 0;
+}
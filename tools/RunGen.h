@@ -3,6 +3,8 @@
 #include "halide_benchmark.h"
 #include "halide_image_io.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <iomanip>
@@ -13,6 +15,7 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <thread>
 #include <utility>
 
 #include <vector>
@@ -379,6 +382,19 @@ inline Buffer<> make_with_shape(const halide_type_t &type, const Shape &shape) {
     return Buffer<>(type, nullptr, (int)shape.size(), &shape[0]);
 }
 
+// Return true if the shape is laid out densely, with dim 0 innermost and
+// each dimension outside the previous one.
+inline bool is_dense_planar(const Shape &shape) {
+    int64_t stride = 1;
+    for (const auto &d : shape) {
+        if (d.stride != stride) {
+            return false;
+        }
+        stride *= d.extent;
+    }
+    return true;
+}
+
 // Given a type and shape, create a new Buffer<> and allocate storage for it.
 // (Oddly, Buffer<> has an API to do this with vector-of-extent, but not vector-of-halide_dimension_t.)
 inline Buffer<> allocate_buffer(const halide_type_t &type, const Shape &shape) {
@@ -474,12 +490,16 @@ inline Buffer<> adjust_buffer_dims(const std::string &title, const std::string &
 }
 
 // Load a buffer from a pathname, adjusting the type and dimensions to
-// fit the metadata's requirements as needed.
+// fit the metadata's requirements as needed. If mmap_io is set, and the
+// file's format allows it, the file is mapped into memory rather than read.
 inline Buffer<> load_input_from_file(const std::string &pathname,
-                                     const halide_filter_argument_t &metadata) {
+                                     const halide_filter_argument_t &metadata,
+                                     bool mmap_io = false) {
     Buffer<> b = Buffer<>(metadata.type, 0);
     info() << "Loading input " << metadata.name << " from " << pathname << " ...";
-    if (!Halide::Tools::load<Buffer<>, IOCheckFail>(pathname, &b)) {
+    if (mmap_io && Halide::Tools::load_mapped<Buffer<>, Halide::Tools::Internal::CheckReturn>(pathname, &b)) {
+        info() << "Mapped input " << metadata.name << " from " << pathname;
+    } else if (!Halide::Tools::load<Buffer<>, IOCheckFail>(pathname, &b)) {
         fail() << "Unable to load input: " << pathname;
     }
     if (b.dimensions() != metadata.dimensions) {
@@ -705,6 +725,10 @@ struct ArgData {
     std::string raw_string;
     halide_scalar_value_t scalar_value;
     Buffer<> buffer_value;
+    // Map input and output files into memory where their format allows.
+    bool mmap_io{false};
+    // True if buffer_value is mapped onto the file it is saved to.
+    bool mapped_output{false};
 
     ArgData() = default;
 
@@ -778,7 +802,7 @@ struct ArgData {
             dynamic_type_dispatch<FillWithRandom>(metadata->type, b, seed);
             return b;
         } else {
-            return load_input_from_file(v[0], *metadata);
+            return load_input_from_file(v[0], *metadata, mmap_io);
         }
     }
 
@@ -881,6 +905,27 @@ struct ArgData {
             }
         }
 
+        if (mmap_io && !raw_string.empty() && is_dense_planar(new_shape)) {
+            // Write the output straight into the file it will be saved to.
+            std::vector<int> extents;
+            for (const auto &d : new_shape) {
+                extents.push_back(d.extent);
+            }
+            Buffer<> b;
+            if (Halide::Tools::create_mapped<Buffer<>, Halide::Tools::Internal::CheckReturn>(raw_string, metadata->type, extents, &b)) {
+                for (size_t i = 0; i < new_shape.size(); ++i) {
+                    b.raw_buffer()->dim[i].min = new_shape[i].min;
+                }
+                buffer_value = b;
+                mapped_output = true;
+                info() << "Output " << name << ": Mapped onto " << raw_string;
+                info() << "Output " << name << ": BoundsQuery result is " << constrained_shape;
+                info() << "Output " << name << ": Shape is " << get_shape(buffer_value);
+                return;
+            }
+            info() << "Output " << name << ": Could not be mapped onto " << raw_string << "; it will be saved instead.";
+        }
+
         buffer_value = allocate_buffer(metadata->type, new_shape);
 
         // allocate_buffer conservatively sets host dirty. Don't waste
@@ -1119,8 +1164,15 @@ public:
                 continue;
             }
 
-            info() << "Saving output " << arg_name << " to " << arg.raw_string << " ...";
             Buffer<> &b = arg.buffer_value;
+            if (arg.mapped_output) {
+                // The output is already in the file; it just needs to be on the host.
+                b.copy_to_host();
+                info() << "(Output " << arg_name << " was written to " << arg.raw_string << " directly.)";
+                continue;
+            }
+
+            info() << "Saving output " << arg_name << " to " << arg.raw_string << " ...";
 
             std::set<Halide::Tools::FormatInfo> savable_types;
             if (!Halide::Tools::save_query<Buffer<>, IOCheckFail>(arg.raw_string, &savable_types)) {
@@ -1293,6 +1345,7 @@ public:
         Halide::Tools::BenchmarkConfig config;
         config.min_time = benchmark_min_time;
         config.max_time = benchmark_min_time * 4;
+        config.name = md->name;
         auto result = Halide::Tools::benchmark(benchmark_inner, config);
 
         if (!parsable_output) {
@@ -1311,6 +1364,119 @@ public:
         }
     }
 
+    // Run the filter from the given number of threads at once, each
+    // with its own copies of the input and output buffers, for at
+    // least min_time seconds. Reports aggregate throughput, latency
+    // percentiles, and the fraction of each caller's time spent in
+    // halide_do_par_for (i.e. waiting on the shared thread pool). If
+    // max_tasks_per_par_for is positive, every parallel loop is split
+    // into at most that many tasks, which caps the number of pool
+    // workers any one call can occupy at once.
+    void run_for_throughput(int callers, double min_time, int max_tasks_per_par_for) {
+        if (callers < 1) {
+            fail() << "The number of throughput callers must be positive.";
+        }
+        throughput_max_tasks = max_tasks_per_par_for;
+        halide_do_par_for_t old_do_par_for = halide_set_custom_do_par_for(throughput_do_par_for);
+
+        struct Caller {
+            std::vector<Buffer<>> buffers;
+            std::vector<void *> argv;
+            std::vector<double> latencies;
+            double par_for_seconds = 0;
+            double total_seconds = 0;
+        };
+        std::vector<Caller> state(callers);
+        for (Caller &c : state) {
+            c.argv = build_filter_argv();
+            for (auto &arg_pair : args) {
+                auto &arg = arg_pair.second;
+                if (arg.metadata->kind == halide_argument_kind_input_scalar) {
+                    continue;
+                }
+                c.buffers.push_back(arg.metadata->kind == halide_argument_kind_input_buffer ?
+                                        arg.buffer_value.copy() :
+                                        Buffer<>::make_with_shape_of(arg.buffer_value));
+                c.argv[arg.index] = c.buffers.back().raw_buffer();
+            }
+        }
+
+        info() << "Measuring throughput with " << callers << " callers...";
+
+        std::atomic<int> ready{0};
+        const auto run_caller = [&](Caller *c) {
+            const auto call = [&]() {
+                // Ignore result since our halide_error() should catch everything.
+                (void)halide_argv_call(&c->argv[0]);
+                for (Buffer<> &b : c->buffers) {
+                    b.device_sync();
+                }
+            };
+            // Warm up, then wait for everyone else so that the timed
+            // calls all overlap.
+            call();
+            ready++;
+            while (ready < callers) {
+                std::this_thread::yield();
+            }
+            throughput_par_for_seconds = 0;
+            const auto start = Halide::Tools::benchmark_now();
+            do {
+                const auto t0 = Halide::Tools::benchmark_now();
+                call();
+                c->latencies.push_back(Halide::Tools::benchmark_duration_seconds(t0, Halide::Tools::benchmark_now()));
+                c->total_seconds = Halide::Tools::benchmark_duration_seconds(start, Halide::Tools::benchmark_now());
+            } while (c->total_seconds < min_time);
+            c->par_for_seconds = throughput_par_for_seconds;
+        };
+
+        std::vector<std::thread> threads;
+        for (Caller &c : state) {
+            threads.emplace_back(run_caller, &c);
+        }
+        for (std::thread &t : threads) {
+            t.join();
+        }
+        halide_set_custom_do_par_for(old_do_par_for);
+
+        std::vector<double> latencies;
+        double wall_time = 0;
+        for (const Caller &c : state) {
+            latencies.insert(latencies.end(), c.latencies.begin(), c.latencies.end());
+            wall_time = std::max(wall_time, c.total_seconds);
+        }
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&](double p) {
+            return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))];
+        };
+        const double calls_per_sec = latencies.size() / wall_time;
+        const double p50 = percentile(0.5), p99 = percentile(0.99);
+
+        if (!parsable_output) {
+            out() << "Throughput for " << md->name << " with " << callers << " concurrent callers is "
+                  << calls_per_sec << " calls/sec (" << latencies.size() << " calls in " << wall_time << " sec).\n"
+                  << "Latency p50 is " << p50 << " sec, p99 is " << p99 << " sec.\n"
+                  << "Aggregate output throughput is " << (megapixels_out() * calls_per_sec) << " mpix/sec.";
+            for (int i = 0; i < callers; i++) {
+                const Caller &c = state[i];
+                out() << "  Caller " << i << ": " << c.latencies.size() << " calls, "
+                      << std::setprecision(3) << (100.0 * c.par_for_seconds / c.total_seconds)
+                      << "% of time in halide_do_par_for";
+            }
+        } else {
+            out() << md->name << "  THROUGHPUT_CALLERS       " << callers << "\n"
+                  << md->name << "  THROUGHPUT_CALLS_PER_SEC " << calls_per_sec << "\n"
+                  << md->name << "  LATENCY_P50_MSEC         " << p50 * 1000.f << "\n"
+                  << md->name << "  LATENCY_P99_MSEC         " << p99 * 1000.f << "\n"
+                  << md->name << "  THROUGHPUT_MPIX_PER_SEC  " << (megapixels_out() * calls_per_sec) << "\n";
+            for (int i = 0; i < callers; i++) {
+                const Caller &c = state[i];
+                out() << md->name << "  CALLER_" << i << "_PAR_FOR_FRACTION  " << (c.par_for_seconds / c.total_seconds) << "\n";
+            }
+            out() << md->name << "  HALIDE_TARGET            " << md->target << "\n";
+        }
+    }
+
     struct Output {
         std::string name;
         Buffer<> actual;
@@ -1385,6 +1551,12 @@ public:
         halide_set_custom_print(quiet ? rungen_halide_print_quiet : rungen_halide_print);
     }
 
+    void set_mmap_io(bool mmap_io = true) {
+        for (auto &arg_pair : args) {
+            arg_pair.second.mmap_io = mmap_io;
+        }
+    }
+
     void set_parsable_output(bool parsable_output = true) {
         this->parsable_output = parsable_output;
     }
@@ -1394,6 +1566,44 @@ private:
         // nothing
     }
 
+    // State for the halide_do_par_for override used to measure throughput.
+    static inline std::atomic<int> throughput_max_tasks{0};
+    static inline thread_local double throughput_par_for_seconds = 0;
+
+    struct ThroughputTasks {
+        halide_task_t f;
+        uint8_t *closure;
+        int min, size, tasks;
+    };
+
+    // Runs a contiguous share of the original loop's iterations serially.
+    static int throughput_task(void *user_context, int idx, uint8_t *closure) {
+        const ThroughputTasks *t = (const ThroughputTasks *)closure;
+        int begin = t->min + (int)((int64_t)t->size * idx / t->tasks);
+        int end = t->min + (int)((int64_t)t->size * (idx + 1) / t->tasks);
+        for (int i = begin; i < end; i++) {
+            int result = t->f(user_context, i, t->closure);
+            if (result != 0) {
+                return result;
+            }
+        }
+        return 0;
+    }
+
+    static int throughput_do_par_for(void *user_context, halide_task_t f, int min, int size, uint8_t *closure) {
+        const auto start = Halide::Tools::benchmark_now();
+        int max_tasks = throughput_max_tasks;
+        int result;
+        if (max_tasks > 0 && size > max_tasks) {
+            ThroughputTasks t = {f, closure, min, size, max_tasks};
+            result = halide_default_do_par_for(user_context, throughput_task, 0, max_tasks, (uint8_t *)&t);
+        } else {
+            result = halide_default_do_par_for(user_context, f, min, size, closure);
+        }
+        throughput_par_for_seconds += Halide::Tools::benchmark_duration_seconds(start, Halide::Tools::benchmark_now());
+        return result;
+    }
+
     std::map<std::string, ShapePromise> bounds_query_input_shapes() const {
         assert(!output_shapes.empty());
         std::vector<void *> filter_argv(args.size(), nullptr);
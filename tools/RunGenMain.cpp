@@ -59,13 +59,15 @@ Arguments:
         some_input_buffer=/path/to/existing/file.png
         some_output_buffer=/path/to/create/output/file.png
 
-    We currently support JPG, PGM, PNG, PPM format. If the type or dimensions
+    We currently support JPG, PGM, PNG, PPM, TMP, MAT and NPY (NumPy) format;
+    TIFF can be written but not read. If the type or dimensions
     of the input or output file type can't support the data (e.g., your filter
     uses float32 input and output, and you load/save to PNG), we'll use the most
     robust approximation within the format and issue a warning to stdout.
 
-    (We anticipate adding other image formats in the future, in particular,
-    TIFF and TMP.)
+    NPY arrays map to buffers the same way the Python bindings do: the
+    extents of a C-ordered array are used in reverse, so its last axis is
+    dimension 0, and those of a Fortran-ordered array are used as-is.
 
     For inputs, there are also "pseudo-file" specifiers you can use; currently
     supported are
@@ -137,10 +139,26 @@ Flags:
         produce an estimate of average execution time; this currently
         runs "samples" sets of "iterations" each, and chooses the fastest
         sample set.
+        If the HL_BENCHMARK_JSON environment variable names a file, a line
+        of JSON with the median, percentiles and a bootstrap confidence
+        interval of the per-iteration time is also appended to it. (This
+        is the same format every user of halide_benchmark.h produces.)
 
     --benchmark_min_time=DURATION_SECONDS [default = 0.1]:
         Override the default minimum desired benchmarking time; ignored if
-        --benchmarks is not also specified.
+        neither --benchmarks nor --throughput_callers is specified.
+
+    --throughput_callers=K:
+        Run the filter from K threads at once, each with its own copies of
+        the input and output buffers, for at least --benchmark_min_time
+        seconds. Reports the aggregate calls per second, p50 and p99
+        latency, and the fraction of each caller's time spent in
+        halide_do_par_for (a measure of contention for the thread pool).
+
+    --throughput_max_tasks=N:
+        With --throughput_callers, split every parallel loop into at most
+        N tasks, so that no single call can occupy more than N thread pool
+        workers at once. Only loops run via halide_do_par_for are capped.
 
     --track_memory:
         Override Halide memory allocator to track high-water mark of memory
@@ -156,6 +174,14 @@ Flags:
         same syntax in use above. If you omit =VALUE, "estimate,default"
         will be used.
 
+    --mmap_io:
+        Map input and output files into memory instead of reading and
+        writing them, for formats that allow it (currently .tmp, .mat and .npy).
+        Inputs are then only read as the filter touches them, and outputs
+        of the right type and a planar layout are written straight into
+        their files rather than saved after the filter runs. Files in other
+        formats are read and saved as usual.
+
     --parsable_output:
         Final output is emitted in an easy-to-parse output (one value per line),
         rather than easy-for-humans.
@@ -396,6 +422,8 @@ int main(int argc, char **argv) {
     std::string default_input_buffers;
     std::string default_input_scalars;
     std::string benchmarks_flag_value;
+    int throughput_callers = 0;
+    int throughput_max_tasks = 0;
     bool emit_success = false;
     for (int i = 1; i < argc; ++i) {
         if (argv[i][0] == '-') {
@@ -427,6 +455,15 @@ int main(int argc, char **argv) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
                 r.set_quiet(quiet);
+            } else if (flag_name == "mmap_io") {
+                if (flag_value.empty()) {
+                    flag_value = "true";
+                }
+                bool mmap_io;
+                if (!parse_scalar(flag_value, &mmap_io)) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+                r.set_mmap_io(mmap_io);
             } else if (flag_name == "parsable_output") {
                 if (flag_value.empty()) {
                     flag_value = "true";
@@ -457,6 +494,14 @@ int main(int argc, char **argv) {
                 if (!parse_scalar(flag_value, &benchmark_min_time)) {
                     fail() << "Invalid value for flag: " << flag_name;
                 }
+            } else if (flag_name == "throughput_callers") {
+                if (!parse_scalar(flag_value, &throughput_callers) || throughput_callers < 1) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
+            } else if (flag_name == "throughput_max_tasks") {
+                if (!parse_scalar(flag_value, &throughput_max_tasks) || throughput_max_tasks < 0) {
+                    fail() << "Invalid value for flag: " << flag_name;
+                }
             } else if (flag_name == "default_input_buffers") {
                 default_input_buffers = flag_value;
                 if (default_input_buffers.empty()) {
@@ -505,9 +550,9 @@ int main(int argc, char **argv) {
     }
 
     // It's OK to omit output arguments when we are benchmarking or tracking memory.
-    bool ok_to_omit_outputs = (benchmark || track_memory);
+    bool ok_to_omit_outputs = (benchmark || throughput_callers > 0 || track_memory);
 
-    if (benchmark && track_memory) {
+    if ((benchmark || throughput_callers > 0) && track_memory) {
         warn() << "Using --track_memory with --benchmarks will produce inaccurate benchmark results.";
     }
 
@@ -546,7 +591,11 @@ int main(int argc, char **argv) {
             fail() << "The only valid value for --benchmarks is 'all'";
         }
         r.run_for_benchmark(benchmark_min_time);
-    } else {
+    }
+    if (throughput_callers > 0) {
+        r.run_for_throughput(throughput_callers, benchmark_min_time, throughput_max_tasks);
+    }
+    if (!benchmark && throughput_callers == 0) {
         r.run_for_output();
     }
 
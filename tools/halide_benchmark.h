@@ -4,13 +4,24 @@
 #include <algorithm>
 #include <cassert>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
 #include <functional>
 #include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
 
 #if defined(__EMSCRIPTEN__)
 #include <emscripten.h>
 #endif
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
 namespace Halide {
 namespace Tools {
 
@@ -64,6 +75,185 @@ inline double benchmark_duration_seconds(double start, double end) {
 
 #endif
 
+// Summary statistics over the per-iteration times of a set of samples.
+struct BenchmarkStats {
+    // Number of samples the statistics below are computed over.
+    uint64_t samples{0};
+
+    // Number of leading samples discarded as warmup, i.e. that were
+    // markedly slower than the steady-state median.
+    uint64_t warmup_samples{0};
+
+    // Number of samples rejected as outliers (outside of three times
+    // the interquartile range).
+    uint64_t outliers{0};
+
+    // Per-iteration times in seconds.
+    double min{0}, median{0}, mean{0}, stddev{0}, p90{0}, p99{0};
+
+    // 95% bootstrap confidence interval for the median.
+    double median_ci_low{0}, median_ci_high{0};
+};
+
+// Compute BenchmarkStats from a list of per-iteration sample times, in
+// the order they were taken.
+inline BenchmarkStats benchmark_summarize(const std::vector<double> &times) {
+    BenchmarkStats stats;
+    if (times.empty()) {
+        return stats;
+    }
+
+    const auto percentile = [](const std::vector<double> &sorted, double p) {
+        size_t i = (size_t)std::ceil(p * sorted.size());
+        return sorted[std::min(sorted.size(), std::max<size_t>(i, 1)) - 1];
+    };
+
+    // Warmup: the leading samples that are more than 10% slower than
+    // the median of the second half of the run. Never discard more
+    // than half of the samples.
+    std::vector<double> tail(times.begin() + times.size() / 2, times.end());
+    std::sort(tail.begin(), tail.end());
+    const double steady = percentile(tail, 0.5);
+    size_t first = 0;
+    while (first < times.size() / 2 && times[first] > steady * 1.1) {
+        first++;
+    }
+    stats.warmup_samples = first;
+
+    std::vector<double> sorted(times.begin() + first, times.end());
+    std::sort(sorted.begin(), sorted.end());
+    const double q1 = percentile(sorted, 0.25), q3 = percentile(sorted, 0.75);
+    const double lo = q1 - 3 * (q3 - q1), hi = q3 + 3 * (q3 - q1);
+    std::vector<double> kept;
+    for (double t : sorted) {
+        if (t >= lo && t <= hi) {
+            kept.push_back(t);
+        }
+    }
+    stats.outliers = sorted.size() - kept.size();
+    stats.samples = kept.size();
+
+    double sum = 0, sum_sq = 0;
+    for (double t : kept) {
+        sum += t;
+        sum_sq += t * t;
+    }
+    stats.min = kept.front();
+    stats.median = percentile(kept, 0.5);
+    stats.mean = sum / kept.size();
+    stats.stddev = std::sqrt(std::max(0.0, sum_sq / kept.size() - stats.mean * stats.mean));
+    stats.p90 = percentile(kept, 0.9);
+    stats.p99 = percentile(kept, 0.99);
+
+    // Bootstrap the median with a fixed seed, so that the same samples
+    // always give the same interval.
+    constexpr int kResamples = 1000;
+    std::mt19937 rng(0);
+    std::uniform_int_distribution<size_t> pick(0, kept.size() - 1);
+    std::vector<double> medians(kResamples), resample(kept.size());
+    for (int i = 0; i < kResamples; i++) {
+        for (double &t : resample) {
+            t = kept[pick(rng)];
+        }
+        std::sort(resample.begin(), resample.end());
+        medians[i] = percentile(resample, 0.5);
+    }
+    std::sort(medians.begin(), medians.end());
+    stats.median_ci_low = percentile(medians, 0.025);
+    stats.median_ci_high = percentile(medians, 0.975);
+    return stats;
+}
+
+// Format BenchmarkStats as a single line of JSON. Times are in seconds.
+inline std::string benchmark_stats_to_json(const std::string &name, const BenchmarkStats &stats,
+                                           uint64_t iterations_per_sample) {
+    std::ostringstream o;
+    o.precision(9);
+    o << "{\"name\": \"" << name << "\""
+      << ", \"samples\": " << stats.samples
+      << ", \"iterations_per_sample\": " << iterations_per_sample
+      << ", \"warmup_samples\": " << stats.warmup_samples
+      << ", \"outliers\": " << stats.outliers
+      << ", \"min\": " << stats.min
+      << ", \"median\": " << stats.median
+      << ", \"median_ci_low\": " << stats.median_ci_low
+      << ", \"median_ci_high\": " << stats.median_ci_high
+      << ", \"mean\": " << stats.mean
+      << ", \"stddev\": " << stats.stddev
+      << ", \"p90\": " << stats.p90
+      << ", \"p99\": " << stats.p99;
+#if defined(__linux__)
+    // Frequency scaling makes timings noisy, and can't be fixed from
+    // here; record the governor so that results can be filtered on it.
+    std::ifstream governor("/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor");
+    std::string g;
+    if (governor >> g) {
+        o << ", \"cpu_governor\": \"" << g << "\"";
+    }
+#endif
+    o << "}";
+    return o.str();
+}
+
+// If the HL_BENCHMARK_JSON environment variable names a file, append
+// the given stats to it as one line of JSON. Every benchmark() call
+// does this, so all users of this header produce the same format.
+inline void benchmark_report_json(std::string name, const std::vector<double> &times,
+                                  uint64_t iterations_per_sample) {
+    const char *path = getenv("HL_BENCHMARK_JSON");
+    if (!path || !*path || times.empty()) {
+        return;
+    }
+    static int unnamed = 0;
+    if (name.empty()) {
+        name = "benchmark_" + std::to_string(unnamed++);
+    }
+    std::ofstream f(path, std::ios::app);
+    f << benchmark_stats_to_json(name, benchmark_summarize(times), iterations_per_sample) << "\n";
+}
+
+// Pin the calling thread to one cpu for the lifetime of this object, if
+// cpu is non-negative and the platform supports it. Halide's thread
+// pool workers are not affected.
+class BenchmarkAffinityPin {
+#if defined(__linux__)
+    cpu_set_t old_mask;
+    bool pinned = false;
+#endif
+
+public:
+    explicit BenchmarkAffinityPin(int cpu) {
+#if defined(__linux__)
+        if (cpu >= 0 && sched_getaffinity(0, sizeof(old_mask), &old_mask) == 0) {
+            cpu_set_t mask;
+            CPU_ZERO(&mask);
+            CPU_SET(cpu, &mask);
+            pinned = sched_setaffinity(0, sizeof(mask), &mask) == 0;
+        }
+#endif
+    }
+
+    ~BenchmarkAffinityPin() {
+#if defined(__linux__)
+        if (pinned) {
+            sched_setaffinity(0, sizeof(old_mask), &old_mask);
+        }
+#endif
+    }
+
+    BenchmarkAffinityPin(const BenchmarkAffinityPin &) = delete;
+    BenchmarkAffinityPin &operator=(const BenchmarkAffinityPin &) = delete;
+};
+
+inline double benchmark_one_sample(uint64_t iterations, const std::function<void()> &op) {
+    auto start = benchmark_now();
+    for (uint64_t j = 0; j < iterations; j++) {
+        op();
+    }
+    auto end = benchmark_now();
+    return benchmark_duration_seconds(start, end) / iterations;
+}
+
 // Benchmark the operation 'op'. The number of iterations refers to
 // how many times the operation is run for each time measurement, the
 // result is the minimum over a number of samples runs. The result is the
@@ -83,16 +273,13 @@ inline double benchmark_duration_seconds(double start, double end) {
 
 inline double benchmark(uint64_t samples, uint64_t iterations, const std::function<void()> &op) {
     double best = std::numeric_limits<double>::infinity();
+    std::vector<double> times;
     for (uint64_t i = 0; i < samples; i++) {
-        auto start = benchmark_now();
-        for (uint64_t j = 0; j < iterations; j++) {
-            op();
-        }
-        auto end = benchmark_now();
-        double elapsed_seconds = benchmark_duration_seconds(start, end);
-        best = std::min(best, elapsed_seconds);
+        times.push_back(benchmark_one_sample(iterations, op));
+        best = std::min(best, times.back());
     }
-    return best / iterations;
+    benchmark_report_json("", times, iterations);
+    return best;
 }
 
 // Benchmark the operation 'op': run the operation until at least min_time
@@ -136,6 +323,19 @@ struct BenchmarkConfig {
     // this. Controls accuracy. The closer to zero this gets the more
     // reliable the answer, but the longer it may take to run.
     double accuracy{0.03};
+
+    // The name to report this benchmark under in HL_BENCHMARK_JSON
+    // output. If empty, benchmarks are numbered in the order they run.
+    std::string name;
+
+    // If HL_BENCHMARK_JSON is set, keep taking samples (within
+    // max_time) until there are at least this many, so that the
+    // reported statistics are meaningful.
+    uint64_t min_json_samples{20};
+
+    // If non-negative, pin the calling thread to this cpu while
+    // benchmarking (Linux only).
+    int pin_cpu{-1};
 };
 
 struct BenchmarkResult {
@@ -163,6 +363,10 @@ struct BenchmarkResult {
 
 inline BenchmarkResult benchmark(const std::function<void()> &op, const BenchmarkConfig &config = {}) {
     BenchmarkResult result{0, 0, 0};
+    BenchmarkAffinityPin pin(config.pin_cpu);
+    const char *json_path = getenv("HL_BENCHMARK_JSON");
+    const uint64_t min_samples = (json_path && *json_path) ? config.min_json_samples : 0;
+    std::vector<double> all_times;
 
     const double min_time = std::max(10 * 1e-6, config.min_time);
     const double max_time = std::max(config.min_time, config.max_time);
@@ -181,8 +385,10 @@ inline BenchmarkResult benchmark(const std::function<void()> &op, const Benchmar
         result.samples = 0;
         result.iterations = 0;
         total_time = 0;
+        all_times.clear();
         for (int i = 0; i < kMinSamples; i++) {
-            times[i] = benchmark(1, iters_per_sample, op);
+            times[i] = benchmark_one_sample(iters_per_sample, op);
+            all_times.push_back(times[i]);
             result.samples++;
             result.iterations += iters_per_sample;
             total_time += times[i] * iters_per_sample;
@@ -220,9 +426,11 @@ inline BenchmarkResult benchmark(const std::function<void()> &op, const Benchmar
     // - No matter what, don't go over max_time; this is important, in case
     // we happen to get faster results for the first samples, then happen to transition
     // to throttled-down CPU state.
-    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time) &&
+    while ((times[0] * accuracy < times[kMinSamples - 1] || total_time < min_time ||
+            result.samples < min_samples) &&
            total_time < max_time) {
-        times[kMinSamples] = benchmark(1, iters_per_sample, op);
+        times[kMinSamples] = benchmark_one_sample(iters_per_sample, op);
+        all_times.push_back(times[kMinSamples]);
         result.samples++;
         result.iterations += iters_per_sample;
         total_time += times[kMinSamples] * iters_per_sample;
@@ -231,6 +439,8 @@ inline BenchmarkResult benchmark(const std::function<void()> &op, const Benchmar
     result.wall_time = times[0];
     result.accuracy = (times[kMinSamples - 1] / times[0]) - 1.0;
 
+    benchmark_report_json(config.name, all_times, iters_per_sample);
+
     return result;
 }
 
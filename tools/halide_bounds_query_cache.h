@@ -0,0 +1,193 @@
+#ifndef HALIDE_BOUNDS_QUERY_CACHE_H
+#define HALIDE_BOUNDS_QUERY_CACHE_H
+
+/** \file
+ * Remember the results of the bounds queries of an AOT-compiled
+ * pipeline. A call to a pipeline in which some buffers have neither a
+ * host nor a device allocation is a bounds query: rather than running
+ * the pipeline, it fills in the shapes of those buffers, i.e. the
+ * regions of the inputs that are required to compute the outputs, and
+ * the regions of the outputs that will be computed. This runs all of
+ * the bounds inference at the top of the pipeline, which for callers
+ * that ask for the same shapes over and over (e.g. to allocate
+ * buffers for each frame of a video) can cost a lot compared to the
+ * pipeline itself.
+ *
+ * The results of a bounds query depend only on the shapes of the
+ * buffers, which of them are queries, and the values of the scalar
+ * arguments, so a BoundsQueryCache, built on the argv-style entry
+ * point and the metadata that a Generator emits along with the
+ * pipeline, runs the query once for each distinct set of those and
+ * answers the rest from a hash table:
+ *
+ *   Halide::Tools::BoundsQueryCache query(blur_argv, blur_metadata());
+ *   halide_buffer_t in_query = ..., out = ...;  // in_query.host == nullptr
+ *   void *args[] = {&in_query, &out};
+ *   query(args);
+ *   // in_query.dim now holds the region of the input that is required.
+ *
+ * The arguments are in the order of the metadata's arguments, as for
+ * the argv-style entry point. Calls with no bounds query buffers are
+ * not run at all, as there is nothing to fill in.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "HalideRuntime.h"
+
+namespace Halide {
+namespace Tools {
+
+class BoundsQueryCache {
+public:
+    /** The argv-style entry point of a pipeline. */
+    using ArgvCall = int (*)(void **);
+
+    /** Cache the bounds queries of the pipeline with the given entry
+     * point and metadata. At most max_entries distinct queries are
+     * kept; when there are more, the cache starts again from empty. */
+    BoundsQueryCache(ArgvCall argv_call, const halide_filter_metadata_t *metadata,
+                     size_t max_entries = 1024)
+        : argv_call(argv_call), metadata(metadata), max_entries(max_entries) {
+    }
+
+    /** Fill in the shapes of the bounds query buffers among the args,
+     * as the pipeline would. Returns zero on success, or the error
+     * code of the pipeline, in which case nothing is cached. */
+    int operator()(void **args) {
+        if (!has_query(args)) {
+            return 0;
+        }
+        std::vector<int64_t> key = signature(args);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = cache.find(key);
+            if (it != cache.end()) {
+                hit_count++;
+                apply(it->second, args);
+                return 0;
+            }
+        }
+
+        int result = argv_call(args);
+        if (result != 0) {
+            return result;
+        }
+
+        std::vector<halide_dimension_t> dims;
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            if (is_query(i, args)) {
+                const halide_buffer_t *b = (const halide_buffer_t *)args[i];
+                dims.insert(dims.end(), b->dim, b->dim + b->dimensions);
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        if (cache.size() >= max_entries) {
+            cache.clear();
+        }
+        cache.emplace(std::move(key), std::move(dims));
+        return 0;
+    }
+
+    /** The number of queries answered from the cache so far. */
+    uint64_t hits() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hit_count;
+    }
+
+    /** The number of distinct queries held. */
+    size_t size() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cache.size();
+    }
+
+    void clear() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cache.clear();
+    }
+
+private:
+    struct Hash {
+        size_t operator()(const std::vector<int64_t> &key) const {
+            // FNV-1a over the words of the key.
+            uint64_t h = 14695981039346656037ULL;
+            for (int64_t k : key) {
+                h = (h ^ (uint64_t)k) * 1099511628211ULL;
+            }
+            return (size_t)h;
+        }
+    };
+
+    bool is_buffer(int i) const {
+        return metadata->arguments[i].kind != halide_argument_kind_input_scalar;
+    }
+
+    bool is_query(int i, void **args) const {
+        if (!is_buffer(i)) {
+            return false;
+        }
+        const halide_buffer_t *b = (const halide_buffer_t *)args[i];
+        return b->host == nullptr && b->device == 0;
+    }
+
+    bool has_query(void **args) const {
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            if (is_query(i, args)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Everything a bounds query can depend on: which buffers are
+    // queries, the shapes of all of the buffers, and the values of
+    // the scalars.
+    std::vector<int64_t> signature(void **args) const {
+        std::vector<int64_t> key;
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            if (is_buffer(i)) {
+                const halide_buffer_t *b = (const halide_buffer_t *)args[i];
+                key.push_back(is_query(i, args));
+                key.push_back(b->dimensions);
+                for (int d = 0; d < b->dimensions; d++) {
+                    key.push_back(b->dim[d].min);
+                    key.push_back(b->dim[d].extent);
+                    key.push_back(b->dim[d].stride);
+                }
+            } else {
+                const halide_type_t &t = metadata->arguments[i].type;
+                int64_t value = 0;
+                std::memcpy(&value, args[i], (t.bits + 7) / 8);
+                key.push_back(value);
+            }
+        }
+        return key;
+    }
+
+    void apply(const std::vector<halide_dimension_t> &dims, void **args) const {
+        const halide_dimension_t *d = dims.data();
+        for (int i = 0; i < metadata->num_arguments; i++) {
+            if (is_query(i, args)) {
+                halide_buffer_t *b = (halide_buffer_t *)args[i];
+                std::memcpy(b->dim, d, b->dimensions * sizeof(halide_dimension_t));
+                d += b->dimensions;
+            }
+        }
+    }
+
+    ArgvCall argv_call;
+    const halide_filter_metadata_t *metadata;
+    size_t max_entries;
+    mutable std::mutex mutex;
+    std::unordered_map<std::vector<int64_t>, std::vector<halide_dimension_t>, Hash> cache;
+    uint64_t hit_count = 0;
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_BOUNDS_QUERY_CACHE_H
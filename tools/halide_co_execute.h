@@ -0,0 +1,145 @@
+#ifndef HALIDE_CO_EXECUTE_H
+#define HALIDE_CO_EXECUTE_H
+
+/** \file
+ * Run a pipeline on the CPU and a GPU at the same time, by splitting
+ * its output along one dimension between a version of it compiled for
+ * the host (typically scheduled with parallel()) and one compiled for
+ * the GPU. The share each gets is tuned from call to call, from the
+ * throughput each achieved on the previous calls. This helps most on
+ * machines with an integrated GPU, where the CPU would otherwise sit
+ * idle while the GPU works.
+ *
+ * An example, with two AOT-compiled versions of the same generator:
+ *
+ *   Halide::Tools::CoExecutor co_execute(
+ *       1,  // Split the rows between the CPU and the GPU
+ *       [&](halide_buffer_t *out) { return blur_cpu(input, out); },
+ *       [&](halide_buffer_t *out) { return blur_gpu(input, out); },
+ *       8);  // Give each an even number of tiles
+ *   for (...) {
+ *       co_execute(output);
+ *   }
+ *
+ * Each version is called on a crop of the output. The GPU's part is
+ * copied back to the host before the call returns, so the results are
+ * always on the host. Both versions read the same inputs; the GPU one
+ * copies them to the device as usual, so inputs that are already
+ * there, or that live in memory the device shares with the host, are
+ * cheapest.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <future>
+#include <utility>
+
+#include "HalideBuffer.h"
+
+namespace Halide {
+namespace Tools {
+
+class CoExecutor {
+public:
+    /** One version of the pipeline, called on a crop of the output.
+     * Returns zero on success, like a Halide pipeline. */
+    using Pipeline = std::function<int(halide_buffer_t *output)>;
+
+    /** Split the output along the given dimension, in multiples of
+     * alignment, giving the GPU the first gpu_fraction of it on the
+     * first call. */
+    CoExecutor(int dimension, Pipeline cpu, Pipeline gpu,
+               int alignment = 1, double gpu_fraction = 0.5)
+        : dimension(dimension), alignment(std::max(alignment, 1)),
+          fraction(std::min(std::max(gpu_fraction, 0.0), 1.0)),
+          cpu(std::move(cpu)), gpu(std::move(gpu)) {
+    }
+
+    /** Run both versions of the pipeline, each on its share of the
+     * output, and then update the share the GPU gets from how long
+     * each took. */
+    int operator()(halide_buffer_t *output) {
+        Runtime::Buffer<> out(*output);
+        const int min = out.dim(dimension).min();
+        const int extent = out.dim(dimension).extent();
+
+        int gpu_extent = (int)std::lround(fraction * extent / alignment) * alignment;
+        gpu_extent = std::min(std::max(gpu_extent, 0), extent);
+        if (extent >= 2 * alignment) {
+            // Keep giving each some of the work, so that its
+            // throughput keeps being measured.
+            gpu_extent = std::min(std::max(gpu_extent, alignment), extent - alignment);
+        }
+        const int cpu_extent = extent - gpu_extent;
+
+        double gpu_seconds = 0, cpu_seconds = 0;
+        std::future<int> gpu_result;
+        if (gpu_extent > 0) {
+            gpu_result = std::async(std::launch::async, [&]() {
+                auto start = std::chrono::steady_clock::now();
+                Runtime::Buffer<> crop = out.cropped(dimension, min, gpu_extent);
+                int result = gpu(crop.raw_buffer());
+                if (result == 0) {
+                    result = crop.copy_to_host();
+                }
+                gpu_seconds = seconds_since(start);
+                return result;
+            });
+        }
+
+        int cpu_result = 0;
+        if (cpu_extent > 0) {
+            auto start = std::chrono::steady_clock::now();
+            Runtime::Buffer<> crop = out.cropped(dimension, min + gpu_extent, cpu_extent);
+            cpu_result = cpu(crop.raw_buffer());
+            cpu_seconds = seconds_since(start);
+        }
+
+        if (gpu_result.valid()) {
+            int result = gpu_result.get();
+            if (cpu_result == 0) {
+                cpu_result = result;
+            }
+        }
+        if (cpu_result != 0) {
+            return cpu_result;
+        }
+
+        // Everything is on the host now. Any device allocation the
+        // output has only holds the GPU's share.
+        if (output->device) {
+            output->set_host_dirty(true);
+        }
+
+        if (gpu_extent > 0 && cpu_extent > 0 && gpu_seconds > 0 && cpu_seconds > 0) {
+            const double gpu_throughput = gpu_extent / gpu_seconds;
+            const double cpu_throughput = cpu_extent / cpu_seconds;
+            const double balanced = gpu_throughput / (gpu_throughput + cpu_throughput);
+            // Smooth out the noise in the timings.
+            fraction = 0.5 * fraction + 0.5 * balanced;
+        }
+        return 0;
+    }
+
+    /** The share of the output the GPU will get on the next call. */
+    double gpu_fraction() const {
+        return fraction;
+    }
+
+private:
+    static double seconds_since(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    int dimension;
+    int alignment;
+    double fraction;
+    Pipeline cpu, gpu;
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_CO_EXECUTE_H
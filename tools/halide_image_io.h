@@ -5,20 +5,31 @@
 #define HALIDE_IMAGE_IO_H
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cmath>
 #include <cstdarg>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <functional>
 #include <map>
 #include <set>
 #include <string>
+#include <thread>
 #include <vector>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #ifndef HALIDE_NO_PNG
 #include "png.h"
+#include "zlib.h"
 #endif
 
 #ifndef HALIDE_NO_JPEG
@@ -31,6 +42,7 @@
 #include "jpeglib.h"
 #endif
 
+#include "HalideBuffer.h"  // for AllocationHeader
 #include "HalideRuntime.h"  // for halide_type_t
 
 namespace Halide {
@@ -708,7 +720,7 @@ void read_big_endian_row(const uint8_t *src, int y, ImageType *im) {
         const int cmax = im_typed.dim(2).max();
         for (int x = xmin; x <= xmax; x++) {
             for (int c = cmin; c <= cmax; c++) {
-                im_typed(x, y, c + cmin) = read_big_endian<ElemType>(src);
+                im_typed(x, y, c) = read_big_endian<ElemType>(src);
                 src += sizeof(ElemType);
             }
         }
@@ -744,6 +756,55 @@ void write_big_endian_row(const ImageType &im, int y, uint8_t *dst) {
     }
 }
 
+// Check that an Image can be decoded into: that it has host memory,
+// and that its extents match those of the file. Images of one-channel
+// files may have two dimensions, or three with a single channel.
+template<typename ImageType, CheckFunc check>
+bool check_decode_into(const ImageType &im, int width, int height, int channels) {
+    if (!check(im.data() != nullptr, "Image has no host memory to decode into")) {
+        return false;
+    }
+    const bool dims_ok = im.dimensions() == 3 || (im.dimensions() == 2 && channels == 1);
+    if (!check(dims_ok &&
+                   im.dim(0).extent() == width &&
+                   im.dim(1).extent() == height &&
+                   im.channels() == channels,
+               "Image extents do not match the extents of the file")) {
+        return false;
+    }
+    return true;
+}
+
+// Whether a decoder can write the rows of an image straight into an
+// Image: the channels of each pixel are adjacent, and so are the
+// pixels of each row.
+template<typename ImageType>
+bool rows_are_interleaved(const ImageType &im) {
+    return im.dim(0).stride() == im.channels() &&
+           (im.dimensions() < 3 || im.dim(2).stride() == 1);
+}
+
+// The address of the first element of row y of an Image.
+template<typename ImageType>
+uint8_t *row_address(const ImageType &im, int y) {
+    int pos[3] = {im.dim(0).min(), y, im.dimensions() > 2 ? im.dim(2).min() : 0};
+    return im.raw_buffer()->address_of(pos);
+}
+
+inline bool host_is_little_endian() {
+    const uint16_t one = 1;
+    return *(const uint8_t *)&one == 1;
+}
+
+// The number of threads to use when asked for num_threads, where zero
+// means one per hardware thread.
+inline int resolve_num_threads(int num_threads) {
+    if (num_threads <= 0) {
+        num_threads = (int)std::thread::hardware_concurrency();
+    }
+    return std::max(num_threads, 1);
+}
+
 #ifndef HALIDE_NO_PNG
 
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
@@ -815,6 +876,120 @@ bool load_png(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Decode a PNG file into an existing Image of uint8 or uint16, whose
+// extents must match those of the file. The file is converted to the
+// bit depth of the Image. Images whose rows are interleaved are
+// decoded into in place; others are filled a row at a time.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_png_into(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    Internal::FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+    png_byte header[8];
+    if (!check(f.read_array(header), "File ended before end of header")) {
+        return false;
+    }
+    if (!check(!png_sig_cmp(header, 0, 8), "File is not recognized as a PNG file")) {
+        return false;
+    }
+
+    png_structp png_ptr = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (!check(png_ptr != nullptr, "png_create_read_struct failed")) {
+        return false;
+    }
+
+    png_infop info_ptr = png_create_info_struct(png_ptr);
+    if (!check(info_ptr != nullptr, "png_create_info_struct failed")) {
+        png_destroy_read_struct(&png_ptr, nullptr, nullptr);
+        return false;
+    }
+
+    if (!check(!setjmp(png_jmpbuf(png_ptr)), "Error loading PNG")) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+        return false;
+    }
+
+    png_init_io(png_ptr, f.f);
+    png_set_sig_bytes(png_ptr, 8);
+
+    png_read_info(png_ptr, info_ptr);
+
+    const int width = png_get_image_width(png_ptr, info_ptr);
+    const int height = png_get_image_height(png_ptr, info_ptr);
+    const int channels = png_get_channels(png_ptr, info_ptr);
+    const int bit_depth = png_get_bit_depth(png_ptr, info_ptr);
+    const int color_type = png_get_color_type(png_ptr, info_ptr);
+
+    const halide_type_t im_type = im->type();
+    if (!check(im_type.code == halide_type_uint && (im_type.bits == 8 || im_type.bits == 16),
+               "Can only decode PNG files into uint8 or uint16 Images") ||
+        !check(color_type != PNG_COLOR_TYPE_PALETTE, "Can't decode palette PNG files into an Image") ||
+        !Internal::check_decode_into<ImageType, check>(*im, width, height, channels)) {
+        png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+        return false;
+    }
+
+    if (bit_depth < 8) {
+        png_set_expand_gray_1_2_4_to_8(png_ptr);
+    }
+    if (bit_depth == 16 && im_type.bits == 8) {
+        png_set_strip_16(png_ptr);
+    } else if (bit_depth < 16 && im_type.bits == 16) {
+        png_set_expand_16(png_ptr);
+    }
+
+    const bool in_place = Internal::rows_are_interleaved(*im);
+    if (in_place && im_type.bits == 16 && Internal::host_is_little_endian()) {
+        png_set_swap(png_ptr);
+    }
+    const bool interlaced = png_set_interlace_handling(png_ptr) > 1;
+
+    png_read_update_info(png_ptr, info_ptr);
+
+    const size_t row_bytes = png_get_rowbytes(png_ptr, info_ptr);
+    const int ymin = im->dim(1).min();
+    if (in_place) {
+        std::vector<png_bytep> rows(height);
+        for (int y = 0; y < height; y++) {
+            rows[y] = Internal::row_address(*im, ymin + y);
+        }
+        png_read_image(png_ptr, rows.data());
+    } else {
+        auto copy_to_image = im_type.bits == 8 ?
+                                 Internal::read_big_endian_row<uint8_t, ImageType> :
+                                 Internal::read_big_endian_row<uint16_t, ImageType>;
+
+        // Interlaced files have to be decoded whole before any row is
+        // complete.
+        std::vector<uint8_t> scratch((interlaced ? height : 1) * row_bytes);
+        if (interlaced) {
+            std::vector<png_bytep> rows(height);
+            for (int y = 0; y < height; y++) {
+                rows[y] = scratch.data() + y * row_bytes;
+            }
+            png_read_image(png_ptr, rows.data());
+        }
+        for (int y = 0; y < height; y++) {
+            uint8_t *row = scratch.data();
+            if (interlaced) {
+                row += y * row_bytes;
+            } else {
+                png_read_row(png_ptr, row, nullptr);
+            }
+            copy_to_image(row, ymin + y, im);
+        }
+    }
+
+    png_read_end(png_ptr, nullptr);
+    png_destroy_read_struct(&png_ptr, &info_ptr, nullptr);
+
+    im->set_host_dirty();
+    return true;
+}
+
 inline const std::set<FormatInfo> &query_png() {
     static std::set<FormatInfo> info = {
         {halide_type_t(halide_type_uint, 8), 2},
@@ -896,6 +1071,158 @@ bool save_png(ImageType &im, const std::string &filename) {
     return true;
 }
 
+inline void write_png_u32(uint32_t v, uint8_t *dst) {
+    dst[0] = (uint8_t)(v >> 24);
+    dst[1] = (uint8_t)(v >> 16);
+    dst[2] = (uint8_t)(v >> 8);
+    dst[3] = (uint8_t)v;
+}
+
+inline bool write_png_chunk(FileOpener &f, const char *type, const uint8_t *data, size_t size) {
+    uint8_t length[4], crc[4];
+    write_png_u32((uint32_t)size, length);
+    uLong c = crc32(0L, (const Bytef *)type, 4);
+    if (size > 0) {
+        c = crc32(c, data, (uInt)size);
+    }
+    write_png_u32((uint32_t)c, crc);
+    return f.write_bytes(length, 4) &&
+           f.write_bytes(type, 4) &&
+           (size == 0 || f.write_bytes(data, size)) &&
+           f.write_bytes(crc, 4);
+}
+
+// Like save_png, but compresses horizontal strips of the image on
+// separate threads, each as its own run of deflate blocks, and writes
+// each strip as an IDAT chunk. Rows use the Sub filter. The strips
+// don't refer back to each other, so the file is a little larger than
+// one compressed as a whole, but compressing big images takes a
+// fraction of the time. num_threads is the number of strips and
+// threads, where zero means one per hardware thread; level is the
+// zlib compression level.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_png_parallel(ImageType &im, const std::string &filename, int num_threads = 0, int level = Z_DEFAULT_COMPRESSION) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    const int width = im.width();
+    const int height = im.height();
+    const int channels = im.channels();
+
+    if (!check(channels >= 1 && channels <= 4,
+               "Can't write PNG files that have other than 1, 2, 3, or 4 channels")) {
+        return false;
+    }
+
+    const halide_type_t im_type = im.type();
+    const int bit_depth = im_type.bits;
+    if (!check(im_type.code == halide_type_uint && (bit_depth == 8 || bit_depth == 16),
+               "Can only write PNG files of uint8 or uint16")) {
+        return false;
+    }
+
+    const uint8_t color_types[4] = {0, 4, 2, 6};  // gray, gray + alpha, RGB, RGBA
+
+    Internal::FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "[write_png_file] File could not be opened for writing")) {
+        return false;
+    }
+
+    auto copy_from_image = bit_depth == 8 ?
+                               write_big_endian_row<uint8_t, ImageType> :
+                               write_big_endian_row<uint16_t, ImageType>;
+
+    const size_t pixel_bytes = channels * (bit_depth / 8);
+    const size_t row_bytes = width * pixel_bytes;
+    const int strips = std::max(std::min(resolve_num_threads(num_threads), height), 1);
+    const int ymin = im.dim(1).min();
+
+    std::vector<std::vector<uint8_t>> compressed(strips);
+    std::vector<uLong> adlers(strips);
+    std::vector<size_t> raw_sizes(strips);
+    std::vector<char> ok(strips, 0);
+
+    auto compress_strip = [&](int i) {
+        const int y0 = (int)((int64_t)height * i / strips);
+        const int y1 = (int)((int64_t)height * (i + 1) / strips);
+        std::vector<uint8_t> raw((y1 - y0) * (row_bytes + 1));
+        for (int y = y0; y < y1; y++) {
+            uint8_t *row = raw.data() + (y - y0) * (row_bytes + 1);
+            row[0] = 1;  // Sub
+            copy_from_image(im, ymin + y, row + 1);
+            for (size_t j = row_bytes; j > pixel_bytes; j--) {
+                row[j] -= row[j - pixel_bytes];
+            }
+        }
+        raw_sizes[i] = raw.size();
+        adlers[i] = adler32(adler32(0L, nullptr, 0), raw.data(), (uInt)raw.size());
+
+        // A raw deflate stream. Every strip but the last ends on a byte
+        // boundary with a sync flush, so that they can be concatenated.
+        z_stream zs;
+        memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return;
+        }
+        const bool last = i == strips - 1;
+        std::vector<uint8_t> &out = compressed[i];
+        const size_t prefix = (i == 0) ? 2 : 0;
+        const size_t suffix = last ? 4 : 0;
+        out.resize(prefix + deflateBound(&zs, raw.size()) + 16 + suffix);
+        zs.next_in = raw.data();
+        zs.avail_in = (uInt)raw.size();
+        zs.next_out = out.data() + prefix;
+        zs.avail_out = (uInt)(out.size() - prefix - suffix);
+        const int result = deflate(&zs, last ? Z_FINISH : Z_SYNC_FLUSH);
+        ok[i] = (last ? result == Z_STREAM_END : result == Z_OK) && zs.avail_in == 0;
+        out.resize(prefix + zs.total_out + suffix);
+        deflateEnd(&zs);
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < strips; i++) {
+        threads.emplace_back(compress_strip, i);
+    }
+    compress_strip(0);
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (int i = 0; i < strips; i++) {
+        if (!check(ok[i], "Error compressing PNG")) {
+            return false;
+        }
+    }
+
+    // The zlib header and the checksum of the whole stream wrap the
+    // strips.
+    uLong adler = adlers[0];
+    for (int i = 1; i < strips; i++) {
+        adler = adler32_combine(adler, adlers[i], (z_off_t)raw_sizes[i]);
+    }
+    compressed[0][0] = 0x78;
+    compressed[0][1] = 0x9c;
+    write_png_u32((uint32_t)adler, compressed.back().data() + compressed.back().size() - 4);
+
+    const uint8_t signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    uint8_t ihdr[13];
+    write_png_u32(width, ihdr);
+    write_png_u32(height, ihdr + 4);
+    ihdr[8] = bit_depth;
+    ihdr[9] = color_types[channels - 1];
+    ihdr[10] = 0;  // deflate
+    ihdr[11] = 0;  // adaptive filtering
+    ihdr[12] = 0;  // not interlaced
+
+    bool written = f.write_array(signature) &&
+                   write_png_chunk(f, "IHDR", ihdr, sizeof(ihdr));
+    for (int i = 0; i < strips && written; i++) {
+        written = write_png_chunk(f, "IDAT", compressed[i].data(), compressed[i].size());
+    }
+    written = written && write_png_chunk(f, "IEND", nullptr, 0);
+    return check(written, "PNG write failed");
+}
+
 #endif  // not HALIDE_NO_PNG
 
 template<Internal::CheckFunc check>
@@ -1091,6 +1418,70 @@ bool load_jpg(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Decode a JPEG file into an existing uint8 Image, whose width and
+// height must match those of the file. The decoder converts between
+// color and grayscale to match the number of channels of the Image.
+// Images whose rows are interleaved are decoded into in place, as
+// many rows at a time as the decoder can produce; others are filled a
+// row at a time.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_jpg_into(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    if (!check(im->type() == halide_type_t(halide_type_uint, 8), "Can only decode JPEG files into uint8 Images") ||
+        !check(im->channels() == 1 || im->channels() == 3, "Can only decode JPEG files into Images with 1 or 3 channels")) {
+        return false;
+    }
+
+    Internal::FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    struct jpeg_decompress_struct cinfo;
+    struct jpeg_error_mgr jerr;
+    cinfo.err = jpeg_std_error(&jerr);
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, f.f);
+    jpeg_read_header(&cinfo, TRUE);
+    cinfo.out_color_space = (im->channels() == 3) ? JCS_RGB : JCS_GRAYSCALE;
+    jpeg_start_decompress(&cinfo);
+
+    const int width = cinfo.output_width;
+    const int height = cinfo.output_height;
+    const int channels = cinfo.output_components;
+    if (!Internal::check_decode_into<ImageType, check>(*im, width, height, channels)) {
+        jpeg_destroy_decompress(&cinfo);
+        return false;
+    }
+
+    const int ymin = im->dim(1).min();
+    if (Internal::rows_are_interleaved(*im)) {
+        std::vector<JSAMPROW> rows(height);
+        for (int y = 0; y < height; y++) {
+            rows[y] = Internal::row_address(*im, ymin + y);
+        }
+        while (cinfo.output_scanline < cinfo.output_height) {
+            const int y = cinfo.output_scanline;
+            jpeg_read_scanlines(&cinfo, rows.data() + y, height - y);
+        }
+    } else {
+        auto copy_to_image = Internal::read_big_endian_row<uint8_t, ImageType>;
+        std::vector<uint8_t> row(width * channels);
+        for (int y = 0; y < height; y++) {
+            uint8_t *src = row.data();
+            jpeg_read_scanlines(&cinfo, &src, 1);
+            copy_to_image(row.data(), ymin + y, im);
+        }
+    }
+
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    im->set_host_dirty();
+    return true;
+}
+
 inline const std::set<FormatInfo> &query_jpg() {
     static std::set<FormatInfo> info = {
         {halide_type_t(halide_type_uint, 8), 2},
@@ -1192,6 +1583,24 @@ bool buffer_is_compact_planar(ImageType &im) {
     return true;
 }
 
+template<CheckFunc check = CheckReturn>
+bool read_tmp_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
+    int32_t header[5];
+    if (!check(f.read_array(header), "Count not read .tmp header")) {
+        return false;
+    }
+
+    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
+                   header[4] >= 0 && header[4] < kNumTmpCodes,
+               "Bad header on .tmp file")) {
+        return false;
+    }
+
+    *type = tmp_code_to_halide_type()[header[4]];
+    *extents = {header[0], header[1], header[2], header[3]};
+    return true;
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool load_tmp(const std::string &filename, ImageType *im) {
@@ -1202,19 +1611,11 @@ bool load_tmp(const std::string &filename, ImageType *im) {
         return false;
     }
 
-    int32_t header[5];
-    if (!check(f.read_array(header), "Count not read .tmp header")) {
-        return false;
-    }
-
-    if (!check(header[0] > 0 && header[1] > 0 && header[2] > 0 && header[3] > 0 &&
-                   header[4] >= 0 && header[4] < kNumTmpCodes,
-               "Bad header on .tmp file")) {
+    halide_type_t im_type;
+    std::vector<int> im_dimensions;
+    if (!read_tmp_header<check>(f, &im_type, &im_dimensions)) {
         return false;
     }
-
-    const halide_type_t im_type = tmp_code_to_halide_type()[header[4]];
-    std::vector<int> im_dimensions = {header[0], header[1], header[2], header[3]};
     *im = ImageType(im_type, im_dimensions);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1267,6 +1668,25 @@ bool write_planar_payload(ImageType &im, FileOpener &f) {
     return true;
 }
 
+template<CheckFunc check = CheckReturn>
+bool make_tmp_header(halide_type_t type, const std::vector<int> &extents, int32_t (&header)[5]) {
+    if (!check(extents.size() <= 4, "Too many dimensions for .tmp file")) {
+        return false;
+    }
+    for (int i = 0; i < 4; ++i) {
+        header[i] = i < (int)extents.size() ? extents[i] : 1;
+    }
+    header[4] = -1;
+    const auto *table = tmp_code_to_halide_type();
+    for (int i = 0; i < kNumTmpCodes; i++) {
+        if (type == table[i]) {
+            header[4] = i;
+            break;
+        }
+    }
+    return check(header[4] >= 0, "Unsupported type for .tmp file");
+}
+
 // ".tmp" is a file format used by the ImageStack tool (see https://github.com/abadams/ImageStack)
 template<typename ImageType, CheckFunc check = CheckReturn>
 bool save_tmp(ImageType &im, const std::string &filename) {
@@ -1274,18 +1694,12 @@ bool save_tmp(ImageType &im, const std::string &filename) {
 
     im.copy_to_host();
 
-    int32_t header[5] = {1, 1, 1, 1, -1};
+    std::vector<int> extents;
     for (int i = 0; i < im.dimensions(); ++i) {
-        header[i] = im.dim(i).extent();
+        extents.push_back(im.dim(i).extent());
     }
-    const auto *table = tmp_code_to_halide_type();
-    for (int i = 0; i < kNumTmpCodes; i++) {
-        if (im.type() == table[i]) {
-            header[4] = i;
-            break;
-        }
-    }
-    if (!check(header[4] >= 0, "Unsupported type for .tmp file")) {
+    int32_t header[5];
+    if (!make_tmp_header<check>(im.type(), extents, header)) {
         return false;
     }
 
@@ -1339,15 +1753,8 @@ enum MatlabClassCode {
     mxUINT64_CLASS = 15
 };
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool load_mat(const std::string &filename, ImageType *im) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    FileOpener f(filename, "rb");
-    if (!check(f.f != nullptr, "File could not be opened for reading")) {
-        return false;
-    }
-
+template<CheckFunc check = CheckReturn>
+bool read_mat_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents) {
     uint8_t header[128];
     if (!check(f.read_array(header), "Could not read .mat header\n")) {
         return false;
@@ -1380,8 +1787,8 @@ bool load_mat(const std::string &filename, ImageType *im) {
         return false;
     }
     int dims = shape_header[1] / 4;
-    std::vector<int> extents(dims);
-    if (!check(f.read_vector(&extents), "Could not read .mat header\n")) {
+    extents->resize(dims);
+    if (!check(f.read_vector(extents), "Could not read .mat header\n")) {
         return false;
     }
     if (dims & 1) {
@@ -1415,40 +1822,57 @@ bool load_mat(const std::string &filename, ImageType *im) {
     if (!check(f.read_array(payload_header), "Could not read .mat header\n")) {
         return false;
     }
-    halide_type_t type;
     switch (payload_header[0]) {
     case miINT8:
-        type = halide_type_of<int8_t>();
+        *type = halide_type_of<int8_t>();
         break;
     case miINT16:
-        type = halide_type_of<int16_t>();
+        *type = halide_type_of<int16_t>();
         break;
     case miINT32:
-        type = halide_type_of<int32_t>();
+        *type = halide_type_of<int32_t>();
         break;
     case miINT64:
-        type = halide_type_of<int64_t>();
+        *type = halide_type_of<int64_t>();
         break;
     case miUINT8:
-        type = halide_type_of<uint8_t>();
+        *type = halide_type_of<uint8_t>();
         break;
     case miUINT16:
-        type = halide_type_of<uint16_t>();
+        *type = halide_type_of<uint16_t>();
         break;
     case miUINT32:
-        type = halide_type_of<uint32_t>();
+        *type = halide_type_of<uint32_t>();
         break;
     case miUINT64:
-        type = halide_type_of<uint64_t>();
+        *type = halide_type_of<uint64_t>();
         break;
     case miSINGLE:
-        type = halide_type_of<float>();
+        *type = halide_type_of<float>();
         break;
     case miDOUBLE:
-        type = halide_type_of<double>();
+        *type = halide_type_of<double>();
         break;
     }
 
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t type;
+    std::vector<int> extents;
+    if (!read_mat_header<check>(f, &type, &extents)) {
+        return false;
+    }
+
     *im = ImageType(type, extents);
 
     // This should never fail unless the default Buffer<> constructor behavior changes.
@@ -1486,16 +1910,13 @@ inline const std::set<FormatInfo> &query_mat() {
     return info;
 }
 
-template<typename ImageType, CheckFunc check = CheckReturn>
-bool save_mat(ImageType &im, const std::string &filename) {
-    static_assert(!ImageType::has_static_halide_type, "");
-
-    im.copy_to_host();
-
+template<CheckFunc check = CheckReturn>
+bool write_mat_header(FileOpener &f, const std::string &filename, halide_type_t type,
+                      const std::vector<int> &im_extents, uint32_t *padding_bytes) {
     uint32_t class_code = 0, type_code = 0;
-    switch (im.raw_buffer()->type.code) {
+    switch (type.code) {
     case halide_type_int:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 8:
             class_code = mxINT8_CLASS;
             type_code = miINT8;
@@ -1517,7 +1938,7 @@ bool save_mat(ImageType &im, const std::string &filename) {
         };
         break;
     case halide_type_uint:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 8:
             class_code = mxUINT8_CLASS;
             type_code = miUINT8;
@@ -1539,7 +1960,7 @@ bool save_mat(ImageType &im, const std::string &filename) {
         };
         break;
     case halide_type_float:
-        switch (im.raw_buffer()->type.bits) {
+        switch (type.bits) {
         case 16:
             check(false, "float16 not supported by .mat");
             break;
@@ -1562,11 +1983,6 @@ bool save_mat(ImageType &im, const std::string &filename) {
         check(false, "unreachable");
     }
 
-    FileOpener f(filename, "wb");
-    if (!check(f.f != nullptr, "File could not be opened for writing")) {
-        return false;
-    }
-
     // Pick a name for the array
     size_t idx = filename.rfind('.');
     std::string name = filename.substr(0, idx);
@@ -1601,23 +2017,26 @@ bool save_mat(ImageType &im, const std::string &filename) {
     header[126] = 'I';
     header[127] = 'M';
 
-    uint64_t payload_bytes = im.size_in_bytes();
+    uint64_t payload_bytes = type.bytes();
+    for (int e : im_extents) {
+        payload_bytes *= e;
+    }
 
     if (!check((payload_bytes >> 32) == 0, "Buffer too large to save as .mat")) {
         return false;
     }
 
-    int dims = im.dimensions();
+    int dims = (int)im_extents.size();
     if (dims < 2) {
         dims = 2;
     }
     int padded_dims = dims + (dims & 1);
 
-    uint32_t padding_bytes = 7 - ((payload_bytes - 1) & 7);
+    *padding_bytes = 7 - ((payload_bytes - 1) & 7);
 
     // Matrix header
     uint32_t matrix_header[2] = {
-        miMATRIX, 40 + padded_dims * 4 + (uint32_t)name.size() + (uint32_t)payload_bytes + padding_bytes};
+        miMATRIX, 40 + padded_dims * 4 + (uint32_t)name.size() + (uint32_t)payload_bytes + *padding_bytes};
 
     // Array flags
     uint32_t flags[4] = {
@@ -1626,12 +2045,9 @@ bool save_mat(ImageType &im, const std::string &filename) {
     // Shape
     int32_t shape[2] = {
         miINT32,
-        im.dimensions() * 4,
+        (int32_t)im_extents.size() * 4,
     };
-    std::vector<int> extents(im.dimensions());
-    for (int d = 0; d < im.dimensions(); d++) {
-        extents[d] = im.dim(d).extent();
-    }
+    std::vector<int> extents = im_extents;
     while ((int)extents.size() < dims) {
         extents.push_back(1);
     }
@@ -1657,7 +2073,26 @@ bool save_mat(ImageType &im, const std::string &filename) {
         f.write_bytes(&name[0], name.size()) &&
         f.write_array(payload_header);
 
-    if (!check(success, "Could not write .mat header")) {
+    return check(success, "Could not write .mat header");
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_mat(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+
+    std::vector<int> extents(im.dimensions());
+    for (int d = 0; d < im.dimensions(); d++) {
+        extents[d] = im.dim(d).extent();
+    }
+    uint32_t padding_bytes = 0;
+    if (!write_mat_header<check>(f, filename, im.type(), extents, &padding_bytes)) {
         return false;
     }
 
@@ -1677,6 +2112,512 @@ bool save_mat(ImageType &im, const std::string &filename) {
     return true;
 }
 
+// ".npy" is the NumPy array format documented here:
+// https://numpy.org/doc/stable/reference/generated/numpy.lib.format.html
+//
+// Halide dimension 0 is the innermost (fastest varying) one, so the
+// extents of a C-ordered array are reversed, and those of a
+// Fortran-ordered array are used as-is. This matches the default
+// behavior of the Python bindings.
+
+inline bool npy_descr_to_halide_type(const std::string &descr, halide_type_t *type, bool *byte_swapped) {
+    if (descr.size() < 3) {
+        return false;
+    }
+    const char order = descr[0];
+    const char kind = descr[1];
+    const int bytes = atoi(descr.c_str() + 2);
+    if (kind == 'b' && bytes == 1) {
+        *type = halide_type_t(halide_type_uint, 1);
+    } else if (kind == 'i' && (bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_int, bytes * 8);
+    } else if (kind == 'u' && (bytes == 1 || bytes == 2 || bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_uint, bytes * 8);
+    } else if (kind == 'f' && (bytes == 2 || bytes == 4 || bytes == 8)) {
+        *type = halide_type_t(halide_type_float, bytes * 8);
+    } else {
+        return false;
+    }
+    if (order == '<') {
+        *byte_swapped = bytes > 1 && !host_is_little_endian();
+    } else if (order == '>') {
+        *byte_swapped = bytes > 1 && host_is_little_endian();
+    } else if (order == '=' || order == '|') {
+        *byte_swapped = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+inline std::string halide_type_to_npy_descr(halide_type_t type) {
+    if (type.bits == 1) {
+        return "|b1";
+    }
+    const char kind = type.code == halide_type_int ? 'i' : type.code == halide_type_uint ? 'u' :
+                                                                                           'f';
+    const char order = type.bytes() == 1 ? '|' : host_is_little_endian() ? '<' :
+                                                                           '>';
+    return std::string(1, order) + kind + std::to_string(type.bytes());
+}
+
+// Find the value for the given key in the header's Python dict literal,
+// returning the offset of its first character, or npos.
+inline size_t npy_header_value(const std::string &header, const char *key) {
+    for (char quote : {'\'', '"'}) {
+        size_t pos = header.find(quote + std::string(key) + quote);
+        if (pos == std::string::npos) {
+            continue;
+        }
+        pos = header.find(':', pos);
+        if (pos == std::string::npos) {
+            return pos;
+        }
+        return header.find_first_not_of(" \t", pos + 1);
+    }
+    return std::string::npos;
+}
+
+template<CheckFunc check = CheckReturn>
+bool read_npy_header(FileOpener &f, halide_type_t *type, std::vector<int> *extents, bool *byte_swapped) {
+    uint8_t preamble[8];
+    if (!check(f.read_array(preamble), "Could not read .npy header")) {
+        return false;
+    }
+    if (!check(memcmp(preamble, "\x93NUMPY", 6) == 0, "Bad magic number in .npy file")) {
+        return false;
+    }
+    const int major_version = preamble[6];
+    uint32_t header_len;
+    if (major_version == 1) {
+        uint8_t len[2];
+        if (!check(f.read_array(len), "Could not read .npy header")) {
+            return false;
+        }
+        header_len = len[0] | (len[1] << 8);
+    } else if (major_version == 2 || major_version == 3) {
+        uint8_t len[4];
+        if (!check(f.read_array(len), "Could not read .npy header")) {
+            return false;
+        }
+        header_len = len[0] | (len[1] << 8) | (len[2] << 16) | ((uint32_t)len[3] << 24);
+    } else {
+        return check(false, "Unsupported .npy version");
+    }
+    std::string header(header_len, ' ');
+    if (!check(f.read_bytes(&header[0], header_len), "Could not read .npy header")) {
+        return false;
+    }
+
+    size_t pos = npy_header_value(header, "descr");
+    if (!check(pos != std::string::npos && (header[pos] == '\'' || header[pos] == '"'), "Could not find descr in .npy header")) {
+        return false;
+    }
+    size_t end = header.find(header[pos], pos + 1);
+    if (!check(end != std::string::npos, "Could not parse descr in .npy header")) {
+        return false;
+    }
+    if (!check(npy_descr_to_halide_type(header.substr(pos + 1, end - pos - 1), type, byte_swapped),
+               "Unsupported type in .npy file")) {
+        return false;
+    }
+
+    pos = npy_header_value(header, "fortran_order");
+    if (!check(pos != std::string::npos, "Could not find fortran_order in .npy header")) {
+        return false;
+    }
+    const bool fortran_order = header.compare(pos, 4, "True") == 0;
+    if (!check(fortran_order || header.compare(pos, 5, "False") == 0, "Could not parse fortran_order in .npy header")) {
+        return false;
+    }
+
+    pos = npy_header_value(header, "shape");
+    if (!check(pos != std::string::npos && header[pos] == '(', "Could not find shape in .npy header")) {
+        return false;
+    }
+    end = header.find(')', pos);
+    if (!check(end != std::string::npos, "Could not parse shape in .npy header")) {
+        return false;
+    }
+    extents->clear();
+    const char *p = header.c_str() + pos + 1;
+    const char *shape_end = header.c_str() + end;
+    while (p < shape_end) {
+        char *next;
+        long long extent = strtoll(p, &next, 10);
+        if (next == p) {
+            // Skip separators.
+            p++;
+            continue;
+        }
+        if (!check(extent >= 0 && extent <= 0x7fffffff, "Bad extent in .npy header")) {
+            return false;
+        }
+        extents->push_back((int)extent);
+        p = next;
+    }
+    if (!fortran_order) {
+        std::reverse(extents->begin(), extents->end());
+    }
+    return true;
+}
+
+template<CheckFunc check = CheckReturn>
+bool write_npy_header(FileOpener &f, halide_type_t type, const std::vector<int> &extents) {
+    // Always write C order, with the outermost Halide dimension first.
+    std::string header = "{'descr': '" + halide_type_to_npy_descr(type) + "', 'fortran_order': False, 'shape': (";
+    for (size_t i = extents.size(); i > 0; i--) {
+        header += std::to_string(extents[i - 1]);
+        if (i > 1 || extents.size() == 1) {
+            header += ",";
+        }
+        if (i > 1) {
+            header += " ";
+        }
+    }
+    header += "), }";
+
+    // The payload starts on a 64-byte boundary, and the header ends with a newline.
+    size_t preamble_len = header.size() + 11 < 65536 ? 10 : 12;
+    while ((preamble_len + header.size() + 1) % 64) {
+        header += ' ';
+    }
+    header += '\n';
+
+    uint8_t preamble[12] = {0x93, 'N', 'U', 'M', 'P', 'Y', 0, 0};
+    const uint32_t header_len = (uint32_t)header.size();
+    if (preamble_len == 10) {
+        preamble[6] = 1;
+        preamble[8] = header_len & 0xff;
+        preamble[9] = (header_len >> 8) & 0xff;
+    } else {
+        preamble[6] = 2;
+        for (int i = 0; i < 4; i++) {
+            preamble[8 + i] = (header_len >> (i * 8)) & 0xff;
+        }
+    }
+    if (!check(f.write_bytes(preamble, preamble_len), "Could not write .npy header")) {
+        return false;
+    }
+    return check(f.write_bytes(header.data(), header.size()), "Could not write .npy header");
+}
+
+template<typename ImageType>
+void swap_bytes(ImageType *im) {
+    const int bytes = im->type().bytes();
+    uint8_t *p = (uint8_t *)im->begin();
+    uint8_t *end = (uint8_t *)im->end();
+    for (; p < end; p += bytes) {
+        std::reverse(p, p + bytes);
+    }
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    FileOpener f(filename, "rb");
+    if (!check(f.f != nullptr, "File could not be opened for reading")) {
+        return false;
+    }
+
+    halide_type_t im_type;
+    std::vector<int> im_extents;
+    bool byte_swapped;
+    if (!read_npy_header<check>(f, &im_type, &im_extents, &byte_swapped)) {
+        return false;
+    }
+    *im = ImageType(im_type, im_extents);
+
+    // This should never fail unless the default Buffer<> constructor behavior changes.
+    if (!check(buffer_is_compact_planar(*im), "load_npy() requires compact planar images")) {
+        return false;
+    }
+
+    if (!check(f.read_bytes(im->begin(), im->size_in_bytes()), "Could not read .npy payload")) {
+        return false;
+    }
+    if (byte_swapped) {
+        swap_bytes(im);
+    }
+
+    im->set_host_dirty();
+    return true;
+}
+
+inline const std::set<FormatInfo> &query_npy() {
+    // NPY files can have any number of dimensions. Our support
+    // arbitrarily stops at 16 dimensions.
+    static std::set<FormatInfo> info = []() {
+        std::set<FormatInfo> s;
+        for (int i = 0; i < 16; i++) {
+            s.insert({halide_type_t(halide_type_float, 16), i});
+            s.insert({halide_type_t(halide_type_float, 32), i});
+            s.insert({halide_type_t(halide_type_float, 64), i});
+            s.insert({halide_type_t(halide_type_uint, 1), i});
+            s.insert({halide_type_t(halide_type_uint, 8), i});
+            s.insert({halide_type_t(halide_type_int, 8), i});
+            s.insert({halide_type_t(halide_type_uint, 16), i});
+            s.insert({halide_type_t(halide_type_int, 16), i});
+            s.insert({halide_type_t(halide_type_uint, 32), i});
+            s.insert({halide_type_t(halide_type_int, 32), i});
+            s.insert({halide_type_t(halide_type_uint, 64), i});
+            s.insert({halide_type_t(halide_type_int, 64), i});
+        }
+        return s;
+    }();
+    return info;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool save_npy(ImageType &im, const std::string &filename) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    im.copy_to_host();
+
+    std::vector<int> extents;
+    for (int i = 0; i < im.dimensions(); ++i) {
+        extents.push_back(im.dim(i).extent());
+    }
+
+    FileOpener f(filename, "wb");
+    if (!check(f.f != nullptr, "File could not be opened for writing")) {
+        return false;
+    }
+    if (!write_npy_header<check>(f, im.type(), extents)) {
+        return false;
+    }
+
+    if (!write_planar_payload<ImageType, check>(im, f)) {
+        return false;
+    }
+
+    return true;
+}
+
+// A file mapped into memory, which lives after the AllocationHeader in
+// the storage adopted by the Images that use it, and is unmapped once
+// the last of them is destroyed.
+struct MappedFile {
+    void *addr;
+    size_t size;
+};
+
+inline MappedFile *mapped_file_in_storage(void *storage) {
+    constexpr size_t offset = (sizeof(Halide::Runtime::AllocationHeader) + alignof(MappedFile) - 1) &
+                              ~(alignof(MappedFile) - 1);
+    return (MappedFile *)((uint8_t *)storage + offset);
+}
+
+inline void unmap_file(void *storage) {
+#ifndef _WIN32
+    MappedFile *m = mapped_file_in_storage(storage);
+    munmap(m->addr, m->size);
+#endif
+    free(storage);
+}
+
+// Make *im an Image of the given type and extents whose storage is the
+// given file, starting at payload_offset. Loads map the file
+// copy-on-write, so writes to the Image don't reach the file. Creating
+// sizes the file to file_size first, and maps it shared, so that writes
+// to the Image do.
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool map_image(const std::string &filename, bool create, uint64_t payload_offset, uint64_t file_size,
+               halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    uint64_t payload_bytes = type.bytes();
+    for (int e : extents) {
+        payload_bytes *= e;
+    }
+    if (payload_bytes == 0) {
+        // There is nothing to map.
+        *im = ImageType(type, extents);
+        return true;
+    }
+    if (!check(payload_offset % type.bytes() == 0, "Payload is not aligned for mapping")) {
+        return false;
+    }
+#ifdef _WIN32
+    return check(false, "Mapping files is not supported on this platform");
+#else
+    int fd = open(filename.c_str(), create ? O_RDWR : O_RDONLY);
+    if (!check(fd >= 0, "File could not be opened for mapping")) {
+        return false;
+    }
+    struct stat st;
+    bool ok = create ? ftruncate(fd, (off_t)file_size) == 0 :
+                       (fstat(fd, &st) == 0 && (uint64_t)st.st_size >= payload_offset + payload_bytes);
+    if (!check(ok, create ? "Could not resize file for mapping" : "File is too small for its header")) {
+        close(fd);
+        return false;
+    }
+    const size_t size = (size_t)(payload_offset + payload_bytes);
+    void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, create ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (!check(addr != MAP_FAILED, "Could not map file")) {
+        return false;
+    }
+
+    void *storage = malloc((uint8_t *)(mapped_file_in_storage(nullptr) + 1) - (uint8_t *)nullptr);
+    if (!check(storage != nullptr, "Out of memory")) {
+        munmap(addr, size);
+        return false;
+    }
+    *mapped_file_in_storage(storage) = {addr, size};
+
+    uint8_t *payload = (uint8_t *)addr + payload_offset;
+    *im = ImageType(type, payload, extents);
+    im->adopt_host_memory(payload, storage, unmap_file);
+    return true;
+#endif
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_tmp_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t type;
+    std::vector<int> extents;
+    uint64_t payload_offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!read_tmp_header<check>(f, &type, &extents)) {
+            return false;
+        }
+        payload_offset = ftell(f.f);
+    }
+    if (!map_image<ImageType, check>(filename, false, payload_offset, 0, type, extents, im)) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool create_tmp_mapped(const std::string &filename, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    int32_t header[5];
+    if (!make_tmp_header<check>(type, extents, header)) {
+        return false;
+    }
+    {
+        FileOpener f(filename, "wb");
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        if (!check(f.write_array(header), "Could not write .tmp header")) {
+            return false;
+        }
+    }
+    uint64_t file_size = sizeof(header) + (uint64_t)type.bytes() * header[0] * header[1] * header[2] * header[3];
+    return map_image<ImageType, check>(filename, true, sizeof(header), file_size, type, extents, im);
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_mat_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t type;
+    std::vector<int> extents;
+    uint64_t payload_offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        if (!read_mat_header<check>(f, &type, &extents)) {
+            return false;
+        }
+        payload_offset = ftell(f.f);
+    }
+    if (!map_image<ImageType, check>(filename, false, payload_offset, 0, type, extents, im)) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool create_mat_mapped(const std::string &filename, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    uint64_t payload_offset;
+    uint32_t padding_bytes = 0;
+    {
+        FileOpener f(filename, "wb");
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        if (!write_mat_header<check>(f, filename, type, extents, &padding_bytes)) {
+            return false;
+        }
+        payload_offset = ftell(f.f);
+    }
+    uint64_t file_size = payload_offset + padding_bytes;
+    uint64_t payload_bytes = type.bytes();
+    for (int e : extents) {
+        payload_bytes *= e;
+    }
+    file_size += payload_bytes;
+    // The padding after the payload is zeroed by resizing the file.
+    return map_image<ImageType, check>(filename, true, payload_offset, file_size, type, extents, im);
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool load_npy_mapped(const std::string &filename, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    halide_type_t type;
+    std::vector<int> extents;
+    uint64_t payload_offset;
+    {
+        FileOpener f(filename, "rb");
+        if (!check(f.f != nullptr, "File could not be opened for reading")) {
+            return false;
+        }
+        bool byte_swapped;
+        if (!read_npy_header<check>(f, &type, &extents, &byte_swapped)) {
+            return false;
+        }
+        if (!check(!byte_swapped, "Only .npy files in the host's byte order can be mapped")) {
+            return false;
+        }
+        payload_offset = ftell(f.f);
+    }
+    if (!map_image<ImageType, check>(filename, false, payload_offset, 0, type, extents, im)) {
+        return false;
+    }
+    im->set_host_dirty();
+    return true;
+}
+
+template<typename ImageType, CheckFunc check = CheckReturn>
+bool create_npy_mapped(const std::string &filename, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    uint64_t payload_offset;
+    {
+        FileOpener f(filename, "wb");
+        if (!check(f.f != nullptr, "File could not be opened for writing")) {
+            return false;
+        }
+        if (!write_npy_header<check>(f, type, extents)) {
+            return false;
+        }
+        payload_offset = ftell(f.f);
+    }
+    uint64_t file_size = type.bytes();
+    for (int e : extents) {
+        file_size *= e;
+    }
+    file_size += payload_offset;
+    return map_image<ImageType, check>(filename, true, payload_offset, file_size, type, extents, im);
+}
+
 template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
 bool load_tiff(const std::string &filename, ImageType *im) {
     static_assert(!ImageType::has_static_halide_type, "");
@@ -1995,6 +2936,7 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
         {"ppm", {load_ppm<ImageType, check>, save_ppm<ConstImageType, check>, query_ppm}},
         {"tmp", {load_tmp<ImageType, check>, save_tmp<ConstImageType, check>, query_tmp}},
         {"mat", {load_mat<ImageType, check>, save_mat<ConstImageType, check>, query_mat}},
+        {"npy", {load_npy<ImageType, check>, save_npy<ConstImageType, check>, query_npy}},
         {"tiff", {load_tiff<ImageType, check>, save_tiff<ConstImageType, check>, query_tiff}},
     };
     std::string ext = Internal::get_lowercase_extension(filename);
@@ -2012,6 +2954,37 @@ bool find_imageio(const std::string &filename, ImageIO<ImageType, check> *result
     return check(false, err.c_str());
 }
 
+template<typename ImageType, Internal::CheckFunc check>
+struct MappedImageIO {
+    std::function<bool(const std::string &, ImageType *)> load;
+    std::function<bool(const std::string &, halide_type_t, const std::vector<int> &, ImageType *)> create;
+    std::function<const std::set<FormatInfo> &()> query;
+};
+
+template<typename ImageType, Internal::CheckFunc check>
+bool find_mapped_imageio(const std::string &filename, MappedImageIO<ImageType, check> *result) {
+    static_assert(!ImageType::has_static_halide_type, "");
+
+    const std::map<std::string, MappedImageIO<ImageType, check>> m = {
+        {"tmp", {load_tmp_mapped<ImageType, check>, create_tmp_mapped<ImageType, check>, query_tmp}},
+        {"mat", {load_mat_mapped<ImageType, check>, create_mat_mapped<ImageType, check>, query_mat}},
+        {"npy", {load_npy_mapped<ImageType, check>, create_npy_mapped<ImageType, check>, query_npy}},
+    };
+    std::string ext = Internal::get_lowercase_extension(filename);
+    auto it = m.find(ext);
+    if (it != m.end()) {
+        *result = it->second;
+        return true;
+    }
+
+    std::string err = "unsupported file extension \"" + ext + "\" for mapping, supported are:";
+    for (auto &it : m) {
+        err += " " + it.first;
+    }
+    err += "\n";
+    return check(false, err.c_str());
+}
+
 template<typename ImageType>
 FormatInfo best_save_format(const ImageType &im, const std::set<FormatInfo> &info) {
     // A bit ad hoc, but will do for now:
@@ -2247,6 +3220,90 @@ bool load(const std::string &filename, ImageType *im) {
     return true;
 }
 
+// Decode an image file into an existing Image, without allocating a
+// new one, e.g. to fill a buffer that a pipeline will read, in the
+// layout and place the pipeline wants. The Image must have host
+// memory and the extents of the file. PNG files can be decoded into
+// uint8 or uint16 Images, converting the bit depth, and JPEG files
+// into uint8 Images with one or three channels, converting between
+// color and grayscale; both are decoded straight into Images whose
+// channels are interleaved. Other formats are loaded and copied, and
+// must match the type of the Image. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_into(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    DynamicImageType im_d = im->template as<void, Internal::AnyDims>();
+    const std::string ext = Internal::get_lowercase_extension(filename);
+    bool decoded = false, result = false;
+#ifndef HALIDE_NO_PNG
+    if (ext == "png") {
+        decoded = true;
+        result = Internal::load_png_into<DynamicImageType, check>(filename, &im_d);
+    }
+#endif
+#ifndef HALIDE_NO_JPEG
+    if (ext == "jpg" || ext == "jpeg") {
+        decoded = true;
+        result = Internal::load_jpg_into<DynamicImageType, check>(filename, &im_d);
+    }
+#endif
+    if (!decoded) {
+        DynamicImageType loaded;
+        if (!load<DynamicImageType, check>(filename, &loaded)) {
+            return false;
+        }
+        bool same_shape = loaded.type() == im_d.type() &&
+                          loaded.dimensions() == im_d.dimensions();
+        for (int i = 0; same_shape && i < loaded.dimensions(); i++) {
+            same_shape = loaded.dim(i).extent() == im_d.dim(i).extent();
+        }
+        if (!check(same_shape, "Image loaded did not match the type and extents of the Image")) {
+            return false;
+        }
+        std::vector<int> mins;
+        for (int i = 0; i < im_d.dimensions(); i++) {
+            mins.push_back(im_d.dim(i).min());
+        }
+        loaded.set_min(mins);
+        im_d.copy_from(loaded);
+        result = true;
+    }
+    if (result) {
+        im->set_host_dirty();
+    }
+    return result;
+}
+
+// Decode each of a list of image files into the corresponding Image
+// with load_into(), with up to num_threads files in flight at once,
+// where zero means one per hardware thread. Returns false if any of
+// the files failed to load.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_into_parallel(const std::vector<std::string> &filenames, const std::vector<ImageType *> &ims, int num_threads = 0) {
+    if (!check(filenames.size() == ims.size(), "There must be one Image per file")) {
+        return false;
+    }
+    std::atomic<size_t> next(0);
+    std::atomic<bool> ok(true);
+    auto worker = [&]() {
+        for (size_t i = next++; i < filenames.size(); i = next++) {
+            if (!load_into<ImageType, check>(filenames[i], ims[i])) {
+                ok = false;
+            }
+        }
+    };
+    const int threads_wanted = std::min<int>(Internal::resolve_num_threads(num_threads), (int)filenames.size());
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threads_wanted; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &t : threads) {
+        t.join();
+    }
+    return ok;
+}
+
 // Save the Image in the format associated with the filename's extension.
 // If the format can't represent the Image without losing data, fail.
 // Returns false upon failure.
@@ -2267,6 +3324,18 @@ bool save(ImageType &im, const std::string &filename) {
     return imageio.save(im_d, filename);
 }
 
+#ifndef HALIDE_NO_PNG
+// Save the Image as a PNG file, compressing strips of it on up to
+// num_threads threads, where zero means one per hardware thread, at
+// the given zlib compression level. The Image must be uint8 or uint16
+// with 1 to 4 channels. Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool save_png_parallel(ImageType &im, const std::string &filename, int num_threads = 0, int level = Z_DEFAULT_COMPRESSION) {
+    auto im_d = im.template as<const void, Internal::AnyDims>();
+    return Internal::save_png_parallel<decltype(im_d), check>(im_d, filename, num_threads, level);
+}
+#endif
+
 // Return a set of FormatInfo structs that contain the legal type-and-dimensions
 // that can be saved in this format. Most applications won't ever need to use
 // this call. Returns false upon failure.
@@ -2281,6 +3350,66 @@ bool save_query(const std::string &filename, std::set<FormatInfo> *info) {
     return true;
 }
 
+// Load the Image from the given file by mapping it into memory instead of
+// reading it, so that only the parts of the file that are used are read,
+// as they are used. Writes to the Image don't change the file. Only
+// uncompressed formats whose payload can be used in place can be loaded
+// this way (currently .tmp, .mat and .npy). Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool load_mapped(const std::string &filename, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    Internal::MappedImageIO<DynamicImageType, check> imageio;
+    if (!Internal::find_mapped_imageio<DynamicImageType, check>(filename, &imageio)) {
+        return false;
+    }
+    DynamicImageType im_d;
+    if (!imageio.load(filename, &im_d)) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        const halide_type_t expected_type = ImageType::static_halide_type();
+        if (!check(im_d.type() == expected_type, "Image loaded did not match the expected type")) {
+            return false;
+        }
+    }
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    return true;
+}
+
+// Create a file in the format associated with the filename's extension,
+// holding an image of the given type and extents, and make *im an Image
+// mapped onto it, so that whatever is written to the Image ends up in
+// the file without a separate save. The file is complete once the last
+// copy of the Image is destroyed. Supports the same formats as
+// load_mapped(). Returns false upon failure.
+template<typename ImageType, Internal::CheckFunc check = Internal::CheckReturn>
+bool create_mapped(const std::string &filename, halide_type_t type, const std::vector<int> &extents, ImageType *im) {
+    using DynamicImageType = typename Internal::ImageTypeWithElemType<ImageType, void>::type;
+    Internal::MappedImageIO<DynamicImageType, check> imageio;
+    if (!Internal::find_mapped_imageio<DynamicImageType, check>(filename, &imageio)) {
+        return false;
+    }
+    if (ImageType::has_static_halide_type) {
+        if (!check(type == ImageType::static_halide_type(), "Type does not match the Image type")) {
+            return false;
+        }
+    }
+    // Formats that pad out missing dimensions can hold Images with fewer.
+    bool can_hold = false;
+    for (const FormatInfo &info : imageio.query()) {
+        can_hold |= info.type == type && info.dimensions >= (int)extents.size();
+    }
+    if (!check(can_hold, "Image cannot be saved in this format")) {
+        return false;
+    }
+    DynamicImageType im_d;
+    if (!imageio.create(filename, type, extents, &im_d)) {
+        return false;
+    }
+    *im = im_d.template as<typename ImageType::ElemType, Internal::AnyDims>();
+    return true;
+}
+
 // Fancy wrapper to call load() with CheckFail, inferring the return type;
 // this allows you to simply use
 //
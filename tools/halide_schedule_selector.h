@@ -0,0 +1,221 @@
+#ifndef HALIDE_SCHEDULE_SELECTOR_H
+#define HALIDE_SCHEDULE_SELECTOR_H
+
+/** \file
+ * Choose, on each call, between several versions of a pipeline that
+ * differ only in their schedules, by the size of the input. A
+ * Generator with a GeneratorParam that picks among its schedules can
+ * be compiled once per schedule, under different function names, and
+ * linked into one library. The first calls for each power-of-two size
+ * bucket try each version in turn and time them. After that the
+ * fastest one is used for that bucket. The winners can be saved to a
+ * file, so that later runs on the same machine skip the trials.
+ *
+ * An example, with three versions of the same Generator:
+ *
+ *   Halide::Tools::ScheduleSelector<halide_buffer_t *, halide_buffer_t *> blur(
+ *       {blur_small, blur_tiled, blur_parallel},
+ *       [](halide_buffer_t *in, halide_buffer_t *out) {
+ *           return (int64_t)out->dim[0].extent * out->dim[1].extent;
+ *       },
+ *       "blur_schedules.txt");
+ *   for (...) {
+ *       blur(input, output);
+ *   }
+ *
+ * The versions are timed on the calling thread, so a version that
+ * runs on a GPU should not return before its work is done (e.g. by
+ * copying the output back to the host).
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace Halide {
+namespace Tools {
+
+template<typename... Args>
+class ScheduleSelector {
+public:
+    /** One version of the pipeline. Returns zero on success, like a
+     * Halide pipeline. */
+    using Candidate = std::function<int(Args...)>;
+
+    /** The size of a call, e.g. the number of output pixels. */
+    using Size = std::function<int64_t(Args...)>;
+
+    /** Choose between the given versions of a pipeline, of which
+     * there must be at least one, timing each one trials times for
+     * each bucket of sizes. If cache_file is not empty, the winners
+     * are loaded from it, if it exists, and written to it as they are
+     * found. */
+    ScheduleSelector(std::vector<Candidate> candidates, Size size,
+                     std::string cache_file = "", int trials = 3)
+        : candidates(std::move(candidates)), size(std::move(size)),
+          cache_file(std::move(cache_file)), trials(trials < 1 ? 1 : trials) {
+        assert(!this->candidates.empty());
+        load();
+    }
+
+    /** Call the best version for the size of this call, or the next
+     * one to try if the bucket hasn't been decided yet. */
+    int operator()(Args... args) {
+        const int b = bucket_of(size(args...));
+        int choice;
+        bool timing;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Bucket &bucket = buckets[b];
+            timing = bucket.winner < 0;
+            if (!timing) {
+                choice = bucket.winner;
+            } else {
+                choice = (int)(bucket.runs % candidates.size());
+                bucket.runs++;
+            }
+        }
+        if (!timing) {
+            return candidates[choice](args...);
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        int result = candidates[choice](args...);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (result != 0) {
+            return result;
+        }
+
+        bool decided;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decided = record(b, choice, seconds);
+        }
+        if (decided) {
+            save();
+        }
+        return 0;
+    }
+
+    /** The version chosen for calls of the given size, or -1 if it
+     * hasn't been decided yet. */
+    int winner(int64_t s) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = buckets.find(bucket_of(s));
+        return it == buckets.end() ? -1 : it->second.winner;
+    }
+
+private:
+    struct Bucket {
+        int winner = -1;
+        uint64_t runs = 0;
+        std::vector<double> best_seconds;
+        std::vector<int> timed;
+    };
+
+    // Record a timed run of a version for a bucket, returning true if
+    // that decides the bucket's winner. The mutex must be held.
+    bool record(int b, int choice, double seconds) {
+        Bucket &bucket = buckets[b];
+        if (bucket.winner >= 0) {
+            return false;
+        }
+        if (bucket.best_seconds.empty()) {
+            bucket.best_seconds.resize(candidates.size(), std::numeric_limits<double>::infinity());
+            bucket.timed.resize(candidates.size(), 0);
+        }
+        // The fastest run of each is the least noisy, and leaves out
+        // any one-time costs such as loading kernels.
+        bucket.best_seconds[choice] = std::min(bucket.best_seconds[choice], seconds);
+        bucket.timed[choice]++;
+        for (int t : bucket.timed) {
+            if (t < trials) {
+                return false;
+            }
+        }
+        int winner = 0;
+        for (size_t i = 1; i < candidates.size(); i++) {
+            if (bucket.best_seconds[i] < bucket.best_seconds[winner]) {
+                winner = (int)i;
+            }
+        }
+        bucket.winner = winner;
+        return true;
+    }
+
+    static int bucket_of(int64_t s) {
+        int b = 0;
+        while (s > 1) {
+            s >>= 1;
+            b++;
+        }
+        return b;
+    }
+
+    // The file has a header line with the number of versions, so that
+    // the winners found for a different set of them are ignored, and
+    // then a line per bucket with its number and its winner.
+    void load() {
+        if (cache_file.empty()) {
+            return;
+        }
+        std::ifstream f(cache_file);
+        std::string magic;
+        size_t count = 0;
+        if (!(f >> magic >> count) || magic != "halide_schedule_selector" || count != candidates.size()) {
+            return;
+        }
+        int b, w;
+        while (f >> b >> w) {
+            if (w >= 0 && w < (int)candidates.size()) {
+                buckets[b].winner = w;
+            }
+        }
+    }
+
+    // Write the winners found so far to the file. This only holds the
+    // mutex while it copies them, so that calls that are already
+    // decided aren't held up by the write. Writes are serialized by
+    // their own mutex, and each takes its copy after the previous one
+    // is done, so the last write has all of the winners.
+    void save() {
+        if (cache_file.empty()) {
+            return;
+        }
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        std::ostringstream contents;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            contents << "halide_schedule_selector " << candidates.size() << "\n";
+            for (const auto &it : buckets) {
+                if (it.second.winner >= 0) {
+                    contents << it.first << " " << it.second.winner << "\n";
+                }
+            }
+        }
+        std::ofstream f(cache_file);
+        f << contents.str();
+    }
+
+    std::vector<Candidate> candidates;
+    Size size;
+    std::string cache_file;
+    int trials;
+    std::mutex mutex, file_mutex;
+    std::map<int, Bucket> buckets;
+};
+
+}  // namespace Tools
+}  // namespace Halide
+
+#endif  // HALIDE_SCHEDULE_SELECTOR_H
@@ -0,0 +1,40 @@
+#include "Halide.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/** \file
+ *
+ * A tool which compiles a Module serialized by a process that is
+ * JIT-compiling a pipeline, for use as HL_JIT_REMOTE_COMPILER. It is
+ * run as
+ *
+ *   HalideJITCompile input.hlmod output.hlobj
+ *
+ * and writes the object code in the format of the JIT code cache. To
+ * compile on another machine, wrap it in a script that copies the
+ * input there and the output back, e.g. with ssh, and runs it with a
+ * libHalide of the same version as the client.
+ */
+
+using namespace Halide;
+using namespace Halide::Internal;
+
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s input.hlmod output.hlobj\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<char> input = read_entire_file(argv[1]);
+    std::vector<uint8_t> serialized_module(input.begin(), input.end());
+
+    JITCodeCacheEntry entry = compile_serialized_module_for_jit(serialized_module);
+    if (!write_jit_code_file(argv[2], entry)) {
+        fprintf(stderr, "Failed to write %s\n", argv[2]);
+        return 1;
+    }
+    return 0;
+}